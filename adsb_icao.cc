@@ -26,7 +26,9 @@
 
 #include "adsb_icao.h"
 
-kis_adsb_icao::kis_adsb_icao() {
+kis_adsb_icao::kis_adsb_icao() :
+    zmfile{nullptr},
+    index_complete{false} {
     mutex.set_name("kis_adsb_icao");
 
     auto entrytracker = Globalreg::fetch_mandatory_global_as<entry_tracker>();
@@ -94,8 +96,6 @@ kis_adsb_icao::kis_adsb_icao() {
                 expanded);
         return;
     }
-
-    index();
 }
 
 void kis_adsb_icao::index() {
@@ -156,13 +156,15 @@ void kis_adsb_icao::index() {
 
     _MSG_INFO("Completed indexing ADSB ICAO db, {} lines {} indexes",
             line, index_vec.size());
+
+    index_complete = true;
 }
 
 std::shared_ptr<tracked_adsb_icao> kis_adsb_icao::lookup_icao(uint32_t icao) {
     int matched = -1;
     char buf[2048];
 
-    if (zmfile == nullptr) {
+    if (!index_complete || zmfile == nullptr) {
         return unknown_icao;
     }
 
@@ -34,6 +34,7 @@
 
 #include <zlib.h>
 
+#include <atomic>
 #include <string>
 
 #include "util.h"
@@ -109,6 +110,8 @@ class kis_adsb_icao {
 public:
     kis_adsb_icao();
 
+    // Build the lookup index of the ICAO file; lookups resolve as unknown until it
+    // completes
     void index();
 
     std::shared_ptr<tracked_adsb_icao> get_unknown_icao() const {
@@ -140,6 +143,7 @@ protected:
     int icao_type_id;
     std::shared_ptr<tracked_adsb_icao> unknown_icao;
 
+    std::atomic<bool> index_complete;
     std::vector<index_pos> index_vec;
     robin_hood::unordered_node_map<uint32_t, std::shared_ptr<tracked_adsb_icao>> icao_map;
 };
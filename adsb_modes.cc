@@ -0,0 +1,255 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "adsb_modes.h"
+#include "fmt.h"
+
+namespace {
+
+// Mode-S CRC-24 generator polynomial
+const uint32_t modes_crc_poly = 0xFFF409;
+
+struct modes_crc_tables {
+    // Byte-at-a-time CRC table
+    uint32_t crc[256];
+
+    // Syndromes of single-bit errors in short and long frames, sorted by syndrome;
+    // the second of each pair is the bit in error
+    std::vector<std::pair<uint32_t, unsigned int>> short_syndromes;
+    std::vector<std::pair<uint32_t, unsigned int>> long_syndromes;
+
+    modes_crc_tables() {
+        for (unsigned int i = 0; i < 256; i++) {
+            uint32_t c = i << 16;
+
+            for (unsigned int b = 0; b < 8; b++) {
+                if (c & 0x800000)
+                    c = (c << 1) ^ modes_crc_poly;
+                else
+                    c <<= 1;
+            }
+
+            crc[i] = c & 0xFFFFFF;
+        }
+
+        build_syndromes(short_syndromes, ADSB_MODES_SHORT_LEN);
+        build_syndromes(long_syndromes, ADSB_MODES_LONG_LEN);
+    }
+
+    uint32_t syndrome(const uint8_t *data, size_t len) const {
+        uint32_t c = 0;
+
+        for (size_t i = 0; i < len - 3; i++)
+            c = ((c << 8) ^ crc[((c >> 16) ^ data[i]) & 0xFF]) & 0xFFFFFF;
+
+        return c ^ ((data[len - 3] << 16) | (data[len - 2] << 8) | data[len - 1]);
+    }
+
+    void build_syndromes(std::vector<std::pair<uint32_t, unsigned int>>& syndromes,
+            size_t len) {
+        uint8_t data[ADSB_MODES_LONG_LEN];
+
+        // The DF bits aren't repaired, a different DF changes the frame length
+        for (unsigned int bit = 5; bit < len * 8; bit++) {
+            memset(data, 0, sizeof(data));
+            data[bit / 8] = 1 << (7 - (bit % 8));
+            syndromes.push_back(std::make_pair(syndrome(data, len), bit));
+        }
+
+        std::sort(syndromes.begin(), syndromes.end());
+    }
+
+    // Bit in error for a syndrome, or -1 if it's not a single-bit error
+    int error_bit(uint32_t in_syndrome, size_t len) const {
+        const auto& syndromes = len == ADSB_MODES_LONG_LEN ? long_syndromes : short_syndromes;
+
+        auto i = std::lower_bound(syndromes.begin(), syndromes.end(),
+                std::make_pair(in_syndrome, 0U));
+
+        if (i == syndromes.end() || i->first != in_syndrome)
+            return -1;
+
+        return i->second;
+    }
+};
+
+const modes_crc_tables& crc_tables() {
+    static const modes_crc_tables tables;
+    return tables;
+}
+
+const char ais_charset[] =
+    "?ABCDEFGHIJKLMNOPQRSTUVWXYZ????? ???????????????0123456789??????";
+
+}
+
+void adsb_modes_frame::reset() {
+    df = 0;
+    icao = 0;
+    crc_recovered = false;
+    msg_len = 0;
+
+    has_callsign = false;
+    callsign.clear();
+    has_altitude = false;
+    altitude = 0;
+    has_position = false;
+    cpr_odd = false;
+    cpr_lat = cpr_lon = 0;
+    has_speed = false;
+    speed = 0;
+    has_heading = false;
+    heading = 0;
+
+    gsas.clear();
+}
+
+std::string adsb_modes_frame::icao_str() const {
+    return fmt::format("{:06x}", icao);
+}
+
+bool adsb_modes_frame::decode(const uint8_t *in_data, size_t in_len) {
+    reset();
+
+    if (in_len < ADSB_MODES_SHORT_LEN)
+        return false;
+
+    df = in_data[0] >> 3;
+
+    if (df == 16 || df == 17 || df == 19 || df == 20 || df == 21)
+        msg_len = ADSB_MODES_LONG_LEN;
+    else
+        msg_len = ADSB_MODES_SHORT_LEN;
+
+    if (in_len < msg_len)
+        return false;
+
+    memcpy(msg, in_data, msg_len);
+
+    const auto& tables = crc_tables();
+    auto syndrome = tables.syndrome(msg, msg_len);
+
+    if (syndrome != 0) {
+        if (df != 11 && df != 17)
+            return false;
+
+        auto bit = tables.error_bit(syndrome, msg_len);
+
+        if (bit < 0)
+            return false;
+
+        msg[bit / 8] ^= 1 << (7 - (bit % 8));
+        crc_recovered = true;
+    }
+
+    icao = (msg[1] << 16) | (msg[2] << 8) | msg[3];
+
+    if (df == 17) {
+        decode_extended_squitter();
+    } else if (df == 0 || df == 4 || df == 16 || df == 20) {
+        // 13-bit altitude, with the M and Q bits removed
+        if ((msg[3] & 0x40) == 0 && (msg[3] & 0x10)) {
+            unsigned int n = ((msg[2] & 0x1F) << 6) | ((msg[3] & 0x80) >> 2) |
+                ((msg[3] & 0x20) >> 1) | (msg[3] & 0x0F);
+
+            has_altitude = true;
+            altitude = (double) n * 25 - 1000;
+        }
+    }
+
+    return true;
+}
+
+void adsb_modes_frame::decode_extended_squitter() {
+    unsigned int me = msg[4] >> 3;
+    unsigned int me_sub = msg[4] & 0x07;
+
+    if (me >= 1 && me <= 4) {
+        char cs[8];
+
+        cs[0] = ais_charset[msg[5] >> 2];
+        cs[1] = ais_charset[((msg[5] & 0x03) << 4) | (msg[6] >> 4)];
+        cs[2] = ais_charset[((msg[6] & 0x0F) << 2) | (msg[7] >> 6)];
+        cs[3] = ais_charset[msg[7] & 0x3F];
+        cs[4] = ais_charset[msg[8] >> 2];
+        cs[5] = ais_charset[((msg[8] & 0x03) << 4) | (msg[9] >> 4)];
+        cs[6] = ais_charset[((msg[9] & 0x0F) << 2) | (msg[10] >> 6)];
+        cs[7] = ais_charset[msg[10] & 0x3F];
+
+        size_t start = 0, end = sizeof(cs);
+
+        while (start < end && cs[start] == ' ')
+            start++;
+        while (end > start && cs[end - 1] == ' ')
+            end--;
+
+        has_callsign = true;
+        callsign.assign(cs + start, end - start);
+    } else if (me >= 9 && me <= 18) {
+        // 12-bit altitude, with the Q bit removed
+        if (msg[5] & 0x01) {
+            unsigned int n = ((msg[5] >> 1) << 4) | ((msg[6] & 0xF0) >> 4);
+
+            has_altitude = true;
+            altitude = (double) n * 25 - 1000;
+        }
+
+        has_position = true;
+        cpr_odd = (msg[6] & 0x04) != 0;
+        cpr_lat = ((msg[6] & 0x03) << 15) | (msg[7] << 7) | (msg[8] >> 1);
+        cpr_lon = ((msg[8] & 0x01) << 16) | (msg[9] << 8) | msg[10];
+    } else if (me == 19) {
+        if (me_sub == 1 || me_sub == 2) {
+            // Ground speed, synthesized from the east-west and north-south velocities
+            bool ew_dir = (msg[5] & 0x04) != 0;
+            int ew_velocity = ((msg[5] & 0x03) << 8) | msg[6];
+            bool ns_dir = (msg[7] & 0x80) != 0;
+            int ns_velocity = ((msg[7] & 0x7F) << 3) | ((msg[8] & 0xE0) >> 5);
+
+            has_speed = true;
+            speed = sqrt((double) ns_velocity * ns_velocity + (double) ew_velocity * ew_velocity);
+
+            if (ew_dir)
+                ew_velocity = -ew_velocity;
+            if (ns_dir)
+                ns_velocity = -ns_velocity;
+
+            has_heading = true;
+            heading = atan2(ew_velocity, ns_velocity) * 360 / (M_PI * 2);
+
+            if (heading < 0)
+                heading += 360;
+        } else if (me_sub == 3 || me_sub == 4) {
+            // Airspeed, with a direct heading
+            if (msg[5] & 0x04) {
+                has_heading = true;
+                heading = (double) (((msg[5] & 0x03) << 5) | (msg[6] >> 3)) * (360.0 / 128);
+            }
+        }
+    }
+}
+
@@ -0,0 +1,97 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __ADSB_MODES_H__
+#define __ADSB_MODES_H__
+
+#include "config.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <string>
+
+// Raw Mode-S frames, 7 or 14 bytes with no preamble or framing, as sent by the
+// ADSB datasources; from the pcap user DLT range
+#ifndef KDLT_ADSB_MODES
+#define KDLT_ADSB_MODES     147
+#endif
+
+#define ADSB_MODES_SHORT_LEN    7
+#define ADSB_MODES_LONG_LEN     14
+
+// Decoded Mode-S frame
+//
+// Decodes the same downlink formats and fields the datasources used to report
+// as JSON: the ICAO address of any frame which passes the CRC (with single-bit
+// repair of DF11 and DF17), and the identification, airborne position, and
+// velocity messages of DF17 extended squitter.
+//
+// Fields are only meaningful when their has_ flag is set; a frame is re-used
+// by calling decode again.
+class adsb_modes_frame {
+public:
+    adsb_modes_frame() {
+        reset();
+    }
+
+    void reset();
+
+    // Decode a raw frame; returns false if the frame is too short for its downlink
+    // format or fails the CRC and can't be repaired
+    bool decode(const uint8_t *in_data, size_t in_len);
+
+    // ICAO address as the lower-case hex string the phy keys devices by
+    std::string icao_str() const;
+
+    unsigned int df;
+    uint32_t icao;
+    bool crc_recovered;
+
+    // Frame contents after any CRC repair
+    uint8_t msg[ADSB_MODES_LONG_LEN];
+    size_t msg_len;
+
+    bool has_callsign;
+    std::string callsign;
+
+    // Feet
+    bool has_altitude;
+    double altitude;
+
+    // Raw 17-bit CPR position
+    bool has_position;
+    bool cpr_odd;
+    uint32_t cpr_lat;
+    uint32_t cpr_lon;
+
+    bool has_speed;
+    double speed;
+
+    bool has_heading;
+    double heading;
+
+    // Only reported by JSON sources
+    std::string gsas;
+
+protected:
+    void decode_extended_squitter();
+};
+
+#endif
+
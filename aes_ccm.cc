@@ -0,0 +1,435 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <string.h>
+
+#include "aes_ccm.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define AES_CCM_HW_AESNI
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+// The ARMv8 AES instructions are only used when the build enables them, so the rest
+// of the build doesn't need +crypto
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define AES_CCM_HW_ARMV8
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+#endif
+#endif
+
+namespace {
+    const uint8_t aes_sbox[256] = {
+        0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+        0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+        0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+        0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+        0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+        0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+        0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+        0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+        0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+        0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+        0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+        0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+        0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+        0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+        0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+        0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+    };
+
+    inline uint8_t xtime(uint8_t v) {
+        return (uint8_t) ((v << 1) ^ ((v & 0x80) ? 0x1b : 0x00));
+    }
+
+    // Portable AES-128 block encryption
+    void aes_soft_encrypt(const uint8_t *rk, const uint8_t *in, uint8_t *out) {
+        uint8_t s[16];
+
+        for (unsigned int i = 0; i < 16; i++)
+            s[i] = in[i] ^ rk[i];
+
+        for (unsigned int r = 1; r <= 10; r++) {
+            uint8_t t[16];
+
+            // SubBytes and ShiftRows
+            for (unsigned int c = 0; c < 4; c++) {
+                for (unsigned int row = 0; row < 4; row++)
+                    t[c * 4 + row] = aes_sbox[s[((c + row) % 4) * 4 + row]];
+            }
+
+            // MixColumns, except in the last round
+            if (r != 10) {
+                for (unsigned int c = 0; c < 4; c++) {
+                    uint8_t *col = t + c * 4;
+                    uint8_t a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+                    uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+
+                    col[0] = a0 ^ all ^ xtime(a0 ^ a1);
+                    col[1] = a1 ^ all ^ xtime(a1 ^ a2);
+                    col[2] = a2 ^ all ^ xtime(a2 ^ a3);
+                    col[3] = a3 ^ all ^ xtime(a3 ^ a0);
+                }
+            }
+
+            for (unsigned int i = 0; i < 16; i++)
+                s[i] = t[i] ^ rk[r * 16 + i];
+        }
+
+        memcpy(out, s, 16);
+    }
+
+    // CCM formatting shared by every implementation: the B0 block, the counter block
+    // template (A0), and the length-prefixed, zero-padded AAD blocks
+    struct ccm_format {
+        uint8_t b0[16];
+        uint8_t a0[16];
+        uint8_t aad[32];
+        size_t aad_blocks;
+
+        ccm_format(const uint8_t *nonce, const uint8_t *aad_in, size_t aad_len, size_t len) {
+            // Adata, M = 8, L = 2
+            b0[0] = 0x40 | (((aes128_ccm::mic_len - 2) / 2) << 3) | 0x01;
+            memcpy(b0 + 1, nonce, aes128_ccm::nonce_len);
+            b0[14] = (uint8_t) (len >> 8);
+            b0[15] = (uint8_t) len;
+
+            a0[0] = 0x01;
+            memcpy(a0 + 1, nonce, aes128_ccm::nonce_len);
+            a0[14] = 0;
+            a0[15] = 0;
+
+            memset(aad, 0, sizeof(aad));
+
+            if (aad_len == 0) {
+                aad_blocks = 0;
+            } else {
+                aad[0] = (uint8_t) (aad_len >> 8);
+                aad[1] = (uint8_t) aad_len;
+                memcpy(aad + 2, aad_in, aad_len);
+                aad_blocks = (aad_len + 2 + 15) / 16;
+            }
+        }
+    };
+
+    inline bool mic_match(const uint8_t *tag, const uint8_t *mic) {
+        uint8_t diff = 0;
+
+        for (size_t i = 0; i < aes128_ccm::mic_len; i++)
+            diff |= tag[i] ^ mic[i];
+
+        return diff == 0;
+    }
+
+    typedef bool (*aes_ccm_decrypt_func)(const uint8_t *rk, const uint8_t *nonce,
+            const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len, uint8_t *out);
+
+    bool aes_ccm_decrypt_soft(const uint8_t *rk, const uint8_t *nonce,
+            const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len, uint8_t *out) {
+        ccm_format f(nonce, aad, aad_len, len);
+
+        uint8_t x[16], s0[16], ctr[16], ks[16];
+
+        aes_soft_encrypt(rk, f.b0, x);
+        aes_soft_encrypt(rk, f.a0, s0);
+
+        for (size_t b = 0; b < f.aad_blocks; b++) {
+            for (unsigned int i = 0; i < 16; i++)
+                x[i] ^= f.aad[b * 16 + i];
+            aes_soft_encrypt(rk, x, x);
+        }
+
+        memcpy(ctr, f.a0, 16);
+
+        for (size_t pos = 0, blk = 1; pos < len; pos += 16, blk++) {
+            auto blen = len - pos < 16 ? len - pos : 16;
+
+            ctr[14] = (uint8_t) (blk >> 8);
+            ctr[15] = (uint8_t) blk;
+            aes_soft_encrypt(rk, ctr, ks);
+
+            for (size_t i = 0; i < blen; i++) {
+                out[pos + i] = in[pos + i] ^ ks[i];
+                x[i] ^= out[pos + i];
+            }
+
+            aes_soft_encrypt(rk, x, x);
+        }
+
+        for (unsigned int i = 0; i < 16; i++)
+            x[i] ^= s0[i];
+
+        return mic_match(x, in + len);
+    }
+
+#ifdef AES_CCM_HW_AESNI
+    __attribute__((target("aes,sse2"), always_inline))
+    inline void aesni_enc1(const __m128i *k, __m128i& a) {
+        a = _mm_xor_si128(a, k[0]);
+        for (unsigned int r = 1; r < 10; r++)
+            a = _mm_aesenc_si128(a, k[r]);
+        a = _mm_aesenclast_si128(a, k[10]);
+    }
+
+    // Two independent blocks, interleaved round by round
+    __attribute__((target("aes,sse2"), always_inline))
+    inline void aesni_enc2(const __m128i *k, __m128i& a, __m128i& b) {
+        a = _mm_xor_si128(a, k[0]);
+        b = _mm_xor_si128(b, k[0]);
+        for (unsigned int r = 1; r < 10; r++) {
+            a = _mm_aesenc_si128(a, k[r]);
+            b = _mm_aesenc_si128(b, k[r]);
+        }
+        a = _mm_aesenclast_si128(a, k[10]);
+        b = _mm_aesenclast_si128(b, k[10]);
+    }
+
+    // Counter block; the counter occupies the last 16 bit word, big endian
+    __attribute__((target("aes,sse2"), always_inline))
+    inline __m128i aesni_counter(const __m128i& a0, size_t blk) {
+        return _mm_insert_epi16(a0, (int) (((blk & 0xFF) << 8) | ((blk >> 8) & 0xFF)), 7);
+    }
+
+    __attribute__((target("aes,sse2")))
+    bool aes_ccm_decrypt_aesni(const uint8_t *rk, const uint8_t *nonce,
+            const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len, uint8_t *out) {
+        ccm_format f(nonce, aad, aad_len, len);
+
+        __m128i k[11];
+        for (unsigned int r = 0; r < 11; r++)
+            k[r] = _mm_load_si128(reinterpret_cast<const __m128i *>(rk + r * 16));
+
+        const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(f.a0));
+
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(f.b0));
+        __m128i s0 = a0;
+
+        aesni_enc2(k, x, s0);
+
+        __m128i ks = aesni_counter(a0, 1);
+
+        if (f.aad_blocks == 0) {
+            aesni_enc1(k, ks);
+        } else {
+            for (size_t b = 0; b < f.aad_blocks; b++) {
+                x = _mm_xor_si128(x,
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(f.aad + b * 16)));
+
+                // The last AAD block shares its rounds with the first keystream block
+                if (b + 1 == f.aad_blocks)
+                    aesni_enc2(k, x, ks);
+                else
+                    aesni_enc1(k, x);
+            }
+        }
+
+        for (size_t pos = 0, blk = 1; pos < len; pos += 16, blk++) {
+            __m128i p;
+
+            if (len - pos >= 16) {
+                p = _mm_xor_si128(ks, _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + pos)));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + pos), p);
+            } else {
+                // The MAC covers the zero padded plaintext of a short final block
+                alignas(16) uint8_t tmp[16];
+                auto blen = len - pos;
+
+                _mm_store_si128(reinterpret_cast<__m128i *>(tmp), ks);
+
+                for (size_t i = 0; i < blen; i++) {
+                    tmp[i] ^= in[pos + i];
+                    out[pos + i] = tmp[i];
+                }
+
+                memset(tmp + blen, 0, 16 - blen);
+                p = _mm_load_si128(reinterpret_cast<const __m128i *>(tmp));
+            }
+
+            x = _mm_xor_si128(x, p);
+
+            // MAC this block while computing the keystream of the next
+            if (pos + 16 < len) {
+                ks = aesni_counter(a0, blk + 1);
+                aesni_enc2(k, x, ks);
+            } else {
+                aesni_enc1(k, x);
+            }
+        }
+
+        alignas(16) uint8_t tag[16];
+        _mm_store_si128(reinterpret_cast<__m128i *>(tag), _mm_xor_si128(x, s0));
+
+        return mic_match(tag, in + len);
+    }
+
+    bool aes_aesni_supported() {
+        unsigned int eax, ebx, ecx, edx;
+
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+            return false;
+
+        return (ecx & bit_AES) && (edx & bit_SSE2);
+    }
+#endif
+
+#ifdef AES_CCM_HW_ARMV8
+    inline uint8x16_t armv8_enc(const uint8x16_t *k, uint8x16_t a) {
+        for (unsigned int r = 0; r < 9; r++)
+            a = vaesmcq_u8(vaeseq_u8(a, k[r]));
+        a = vaeseq_u8(a, k[9]);
+        return veorq_u8(a, k[10]);
+    }
+
+    bool aes_ccm_decrypt_armv8(const uint8_t *rk, const uint8_t *nonce,
+            const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len, uint8_t *out) {
+        ccm_format f(nonce, aad, aad_len, len);
+
+        uint8x16_t k[11];
+        for (unsigned int r = 0; r < 11; r++)
+            k[r] = vld1q_u8(rk + r * 16);
+
+        uint8_t ctr[16];
+        memcpy(ctr, f.a0, 16);
+
+        uint8x16_t x = armv8_enc(k, vld1q_u8(f.b0));
+        uint8x16_t s0 = armv8_enc(k, vld1q_u8(f.a0));
+
+        for (size_t b = 0; b < f.aad_blocks; b++)
+            x = armv8_enc(k, veorq_u8(x, vld1q_u8(f.aad + b * 16)));
+
+        ctr[15] = 1;
+        uint8x16_t ks = armv8_enc(k, vld1q_u8(ctr));
+
+        for (size_t pos = 0, blk = 1; pos < len; pos += 16, blk++) {
+            uint8x16_t p;
+
+            if (len - pos >= 16) {
+                p = veorq_u8(ks, vld1q_u8(in + pos));
+                vst1q_u8(out + pos, p);
+            } else {
+                uint8_t tmp[16];
+                auto blen = len - pos;
+
+                vst1q_u8(tmp, ks);
+
+                for (size_t i = 0; i < blen; i++) {
+                    tmp[i] ^= in[pos + i];
+                    out[pos + i] = tmp[i];
+                }
+
+                memset(tmp + blen, 0, 16 - blen);
+                p = vld1q_u8(tmp);
+            }
+
+            x = veorq_u8(x, p);
+
+            // Independent chains; the compiler interleaves the two round sequences
+            if (pos + 16 < len) {
+                ctr[14] = (uint8_t) ((blk + 1) >> 8);
+                ctr[15] = (uint8_t) (blk + 1);
+                ks = armv8_enc(k, vld1q_u8(ctr));
+            }
+
+            x = armv8_enc(k, x);
+        }
+
+        uint8_t tag[16];
+        vst1q_u8(tag, veorq_u8(x, s0));
+
+        return mic_match(tag, in + len);
+    }
+
+    bool aes_armv8_supported() {
+#if defined(__APPLE__)
+        return true;
+#elif defined(__linux__)
+        return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+#else
+        return false;
+#endif
+    }
+#endif
+
+    const char *aes_ccm_impl_name = "portable";
+
+    aes_ccm_decrypt_func aes_ccm_select() {
+#ifdef AES_CCM_HW_AESNI
+        if (aes_aesni_supported()) {
+            aes_ccm_impl_name = "aes-ni";
+            return aes_ccm_decrypt_aesni;
+        }
+#endif
+
+#ifdef AES_CCM_HW_ARMV8
+        if (aes_armv8_supported()) {
+            aes_ccm_impl_name = "armv8-aes";
+            return aes_ccm_decrypt_armv8;
+        }
+#endif
+
+        return aes_ccm_decrypt_soft;
+    }
+
+    const aes_ccm_decrypt_func aes_ccm_decrypt_impl = aes_ccm_select();
+}
+
+aes128_ccm::aes128_ccm(const uint8_t *key) {
+    // The standard key schedule; every implementation uses the round keys as bytes
+    static const uint8_t rcon[10] = {
+        0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36
+    };
+
+    memcpy(round_keys, key, key_len);
+
+    for (unsigned int i = 4; i < 44; i++) {
+        uint8_t t[4];
+        memcpy(t, round_keys + (i - 1) * 4, 4);
+
+        if (i % 4 == 0) {
+            uint8_t t0 = t[0];
+            t[0] = aes_sbox[t[1]] ^ rcon[i / 4 - 1];
+            t[1] = aes_sbox[t[2]];
+            t[2] = aes_sbox[t[3]];
+            t[3] = aes_sbox[t0];
+        }
+
+        for (unsigned int j = 0; j < 4; j++)
+            round_keys[i * 4 + j] = round_keys[(i - 4) * 4 + j] ^ t[j];
+    }
+}
+
+bool aes128_ccm::decrypt(const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+        const uint8_t *in, size_t len, uint8_t *out) const {
+    if (aad_len > max_aad_len || len > 0xFFFF)
+        return false;
+
+    return aes_ccm_decrypt_impl(round_keys, nonce, aad, aad_len, in, len, out);
+}
+
+const char *aes128_ccm::impl_name() {
+    return aes_ccm_impl_name;
+}
+
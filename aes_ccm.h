@@ -0,0 +1,61 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __AES_CCM_H__
+#define __AES_CCM_H__
+
+#include "config.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+// AES-128 in CCM mode with the parameters 802.11 CCMP uses: a 13 byte nonce, a 2 byte
+// length field, and an 8 byte MIC.
+//
+// The AES rounds run on the AES instructions of the CPU when it has them (AES-NI on
+// x86, the ARMv8 crypto extensions on aarch64 builds which enable them), selected at
+// runtime, and on a portable implementation everywhere else.  The counter mode
+// keystream of each block is computed together with the CBC-MAC of the previous one,
+// so the hardware paths keep two independent AES chains in flight instead of waiting
+// on each round of one.
+class aes128_ccm {
+public:
+    static constexpr size_t key_len = 16;
+    static constexpr size_t nonce_len = 13;
+    static constexpr size_t mic_len = 8;
+
+    // The largest 802.11 CCMP AAD is 30 bytes
+    static constexpr size_t max_aad_len = 30;
+
+    aes128_ccm(const uint8_t *key);
+
+    // Decrypt len bytes of ciphertext followed by the mic_len byte MIC into out, which
+    // must hold len bytes.  Returns false when the MIC doesn't match, in which case the
+    // content of out is undefined.
+    bool decrypt(const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+            const uint8_t *in, size_t len, uint8_t *out) const;
+
+    // Name of the AES implementation in use
+    static const char *impl_name();
+
+protected:
+    alignas(16) uint8_t round_keys[16 * 11];
+};
+
+#endif
+
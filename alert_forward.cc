@@ -0,0 +1,405 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sstream>
+
+#include "alert_forward.h"
+#include "alertracker.h"
+#include "configfile.h"
+#include "globalregistry.h"
+#include "json_adapter.h"
+#include "messagebus.h"
+#include "util.h"
+
+// Seconds to wait connecting to or writing to a collector
+#define ALERT_SYSLOG_TIMEOUT    5
+
+alert_forwarder::alert_forwarder() :
+    num_exporters{0},
+    forward_shutdown{false},
+    queued{0},
+    dropped{0},
+    batches{0} {
+
+    auto config = Globalreg::globalreg->kismet_config;
+
+    max_queue = config->fetch_opt_uint("alert_forward_queue", 4096);
+    max_batch = std::max(1U, config->fetch_opt_uint("alert_forward_batch", 64));
+    batch_time = std::chrono::milliseconds(config->fetch_opt_uint("alert_forward_batch_ms", 250));
+}
+
+alert_forwarder::~alert_forwarder() {
+    stop();
+}
+
+void alert_forwarder::add_exporter(std::shared_ptr<alert_exporter> in_exporter) {
+    std::lock_guard<std::mutex> lk(mutex);
+
+    exporters.push_back(in_exporter);
+    num_exporters = exporters.size();
+
+    if (!forward_thread.joinable() && !forward_shutdown) {
+        forward_thread = std::thread([this]() {
+                thread_set_process_name("alertforward");
+                forward_loop();
+                });
+    }
+}
+
+void alert_forwarder::queue(std::shared_ptr<kis_alert_info> in_alert) {
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+
+        if (forward_shutdown || alert_queue.size() >= max_queue) {
+            dropped++;
+            return;
+        }
+
+        if (alert_queue.size() == 0)
+            oldest_queued = std::chrono::steady_clock::now();
+
+        alert_queue.push_back(in_alert);
+        queued++;
+
+        // The thread only needs waking to start timing a batch or to send a full one
+        if (alert_queue.size() != 1 && alert_queue.size() != max_batch)
+            return;
+    }
+
+    cv.notify_one();
+}
+
+void alert_forwarder::stop() {
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        forward_shutdown = true;
+    }
+
+    cv.notify_all();
+
+    if (forward_thread.joinable())
+        forward_thread.join();
+}
+
+void alert_forwarder::forward_loop() {
+    std::unique_lock<std::mutex> lk(mutex);
+
+    while (true) {
+        if (alert_queue.size() == 0) {
+            if (forward_shutdown)
+                break;
+
+            cv.wait(lk, [this]() { return forward_shutdown || alert_queue.size() > 0; });
+            continue;
+        }
+
+        // Wait for a full batch or for the oldest alert to have waited long enough;
+        // whatever is queued at shutdown is sent straight away
+        if (!forward_shutdown && alert_queue.size() < max_batch)
+            cv.wait_until(lk, oldest_queued + batch_time, [this]() {
+                    return forward_shutdown || alert_queue.size() >= max_batch;
+                    });
+
+        std::vector<std::shared_ptr<kis_alert_info>> batch;
+        batch.reserve(std::min(max_batch, alert_queue.size()));
+
+        while (alert_queue.size() > 0 && batch.size() < max_batch) {
+            batch.push_back(alert_queue.front());
+            alert_queue.pop_front();
+        }
+
+        auto send_exporters = exporters;
+
+        lk.unlock();
+
+        for (const auto& e : send_exporters) {
+            try {
+                if (e->send_alerts(batch))
+                    e->sent += batch.size();
+                else
+                    e->failed += batch.size();
+            } catch (const std::exception& ex) {
+                e->failed += batch.size();
+            }
+        }
+
+        batches++;
+
+        lk.lock();
+    }
+}
+
+void alert_forwarder::write_stats(std::ostream& os) {
+    std::lock_guard<std::mutex> lk(mutex);
+
+    os << "{\"kismet.alert.forward.queued\": " << queued <<
+        ", \"kismet.alert.forward.dropped\": " << dropped <<
+        ", \"kismet.alert.forward.batches\": " << batches <<
+        ", \"kismet.alert.forward.backlog\": " << alert_queue.size() <<
+        ", \"kismet.alert.forward.exporters\": [";
+
+    bool first = true;
+
+    for (const auto& e : exporters) {
+        if (!first)
+            os << ", ";
+        first = false;
+
+        os << "{\"kismet.alert.forward.exporter.name\": ";
+        json_adapter::write_escaped(os, e->exporter_name());
+        os << ", \"kismet.alert.forward.exporter.sent\": " << e->sent <<
+            ", \"kismet.alert.forward.exporter.failed\": " << e->failed << "}";
+    }
+
+    os << "]}";
+}
+
+alert_syslog_exporter::alert_syslog_exporter(const std::string& in_uri, unsigned int in_facility) :
+    alert_exporter(),
+    uri{in_uri},
+    use_tcp{false},
+    facility{std::min(in_facility, 23U)},
+    pid{getpid()},
+    fd{-1} {
+
+    auto proto_end = uri.find("://");
+
+    if (proto_end == std::string::npos)
+        return;
+
+    auto proto = str_lower(uri.substr(0, proto_end));
+
+    if (proto == "tcp")
+        use_tcp = true;
+    else if (proto != "udp")
+        return;
+
+    auto hostport = uri.substr(proto_end + 3);
+    auto port_start = hostport.rfind(':');
+
+    // Bracketed IPv6 literals carry their own colons
+    if (port_start == std::string::npos ||
+            (hostport.find(']') != std::string::npos && port_start < hostport.find(']'))) {
+        host = hostport;
+        port = "514";
+    } else {
+        host = hostport.substr(0, port_start);
+        port = hostport.substr(port_start + 1);
+    }
+
+    if (host.length() > 2 && host.front() == '[' && host.back() == ']')
+        host = host.substr(1, host.length() - 2);
+
+    if (host.length() == 0)
+        port = "";
+
+    char hbuf[256];
+
+    if (gethostname(hbuf, sizeof(hbuf)) == 0) {
+        hbuf[sizeof(hbuf) - 1] = 0;
+        hostname = hbuf;
+    }
+
+    if (hostname.length() == 0)
+        hostname = "-";
+}
+
+alert_syslog_exporter::~alert_syslog_exporter() {
+    close_socket();
+}
+
+void alert_syslog_exporter::close_socket() {
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+}
+
+bool alert_syslog_exporter::connect_socket() {
+    struct addrinfo hints, *result;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = use_tcp ? SOCK_STREAM : SOCK_DGRAM;
+
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0)
+        return false;
+
+    for (auto ai = result; ai != nullptr; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+
+        if (fd < 0)
+            continue;
+
+        struct timeval tv;
+        tv.tv_sec = ALERT_SYSLOG_TIMEOUT;
+        tv.tv_usec = 0;
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+        // Connect without blocking so an unreachable collector costs at most the timeout
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+        int r = connect(fd, ai->ai_addr, ai->ai_addrlen);
+
+        if (r < 0 && errno == EINPROGRESS) {
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLOUT;
+
+            int err = 0;
+            socklen_t errlen = sizeof(err);
+
+            if (poll(&pfd, 1, ALERT_SYSLOG_TIMEOUT * 1000) == 1 &&
+                    getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errlen) == 0 && err == 0)
+                r = 0;
+        }
+
+        if (r == 0) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+            freeaddrinfo(result);
+            return true;
+        }
+
+        close_socket();
+    }
+
+    freeaddrinfo(result);
+    return false;
+}
+
+std::string alert_syslog_exporter::format_message(const std::shared_ptr<kis_alert_info>& in_alert) const {
+    unsigned int severity;
+
+    switch (int_to_alert_severity(in_alert->severity)) {
+        case kis_alert_severity::critical:
+            severity = 2;
+            break;
+        case kis_alert_severity::high:
+            severity = 3;
+            break;
+        case kis_alert_severity::medium:
+            severity = 4;
+            break;
+        case kis_alert_severity::low:
+            severity = 5;
+            break;
+        default:
+            severity = 6;
+            break;
+    }
+
+    struct tm tmp;
+    time_t secs = in_alert->tm.tv_sec;
+    gmtime_r(&secs, &tmp);
+
+    char tbuf[32];
+    strftime(tbuf, sizeof(tbuf), "%Y-%m-%dT%H:%M:%S", &tmp);
+
+    // MSGID is limited to 32 printable characters
+    std::string msgid;
+    for (auto c : in_alert->header) {
+        if (msgid.length() >= 32)
+            break;
+        msgid += (c > 32 && c < 127) ? c : '_';
+    }
+
+    if (msgid.length() == 0)
+        msgid = "-";
+
+    return fmt::format("<{}>1 {}.{:06}Z {} kismet {} {} - server-ts={} bssid={} source={} "
+            "dest={} channel={} class={} {}",
+            facility * 8 + severity, tbuf, in_alert->tm.tv_usec, hostname, pid, msgid,
+            in_alert->tm.tv_sec, in_alert->bssid.mac_to_string(), 
+            in_alert->source.mac_to_string(), in_alert->dest.mac_to_string(),
+            in_alert->channel, in_alert->alertclass, in_alert->text);
+}
+
+bool alert_syslog_exporter::send_alerts(const std::vector<std::shared_ptr<kis_alert_info>>& in_alerts) {
+    if (!valid())
+        return false;
+
+    if (!use_tcp) {
+        if (fd < 0 && !connect_socket())
+            return false;
+
+        bool ok = true;
+
+        for (const auto& a : in_alerts) {
+            auto msg = format_message(a);
+
+            if (send(fd, msg.data(), msg.length(), MSG_NOSIGNAL) < 0)
+                ok = false;
+        }
+
+        return ok;
+    }
+
+    // Frame the whole batch with octet counting and write it at once
+    std::stringstream ss;
+
+    for (const auto& a : in_alerts) {
+        auto msg = format_message(a);
+        ss << msg.length() << " " << msg;
+    }
+
+    auto batch = ss.str();
+
+    // A connection which went away since the last batch only shows up once written to,
+    // so try again once on a fresh connection
+    for (unsigned int attempt = 0; attempt < 2; attempt++) {
+        if (fd < 0 && !connect_socket())
+            return false;
+
+        size_t pos = 0;
+
+        while (pos < batch.length()) {
+            auto r = send(fd, batch.data() + pos, batch.length() - pos, MSG_NOSIGNAL);
+
+            if (r < 0 && errno == EINTR)
+                continue;
+
+            if (r <= 0)
+                break;
+
+            pos += r;
+        }
+
+        if (pos == batch.length())
+            return true;
+
+        close_socket();
+
+        // Only resend whole batches which never got started
+        if (pos != 0)
+            return false;
+    }
+
+    return false;
+}
+
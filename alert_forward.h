@@ -0,0 +1,145 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __ALERT_FORWARD_H__
+#define __ALERT_FORWARD_H__
+
+#include "config.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class kis_alert_info;
+
+// Destination for forwarded alerts.  Exporters are called on the forwarding thread
+// with batches of alerts in the order they were raised, so they may block on the
+// network without holding up the code raising the alert.
+class alert_exporter {
+public:
+    alert_exporter() :
+        sent{0},
+        failed{0} { }
+
+    virtual ~alert_exporter() { }
+
+    virtual std::string exporter_name() const = 0;
+
+    // Deliver a batch of alerts; returns false if the batch could not be delivered
+    virtual bool send_alerts(const std::vector<std::shared_ptr<kis_alert_info>>& in_alerts) = 0;
+
+    std::atomic<uint64_t> sent;
+    std::atomic<uint64_t> failed;
+};
+
+// Asynchronous alert forwarding
+//
+// Raised alerts are queued and handed to the exporters in batches from a forwarding
+// thread; a batch is sent once alert_forward_batch alerts are waiting or the oldest has
+// waited alert_forward_batch_ms.  When the queue holds alert_forward_queue alerts
+// further alerts are dropped and counted instead of blocking the caller.
+//
+// The thread is only started once an exporter is added, so without any configured
+// forwarding raised alerts cost nothing more.
+class alert_forwarder {
+public:
+    alert_forwarder();
+    ~alert_forwarder();
+
+    void add_exporter(std::shared_ptr<alert_exporter> in_exporter);
+
+    bool has_exporters() const {
+        return num_exporters > 0;
+    }
+
+    // Queue an alert; never blocks on the exporters
+    void queue(std::shared_ptr<kis_alert_info> in_alert);
+
+    // Send what is queued and stop the thread
+    void stop();
+
+    void write_stats(std::ostream& os);
+
+protected:
+    void forward_loop();
+
+    size_t max_queue;
+    size_t max_batch;
+    std::chrono::milliseconds batch_time;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    std::deque<std::shared_ptr<kis_alert_info>> alert_queue;
+    std::chrono::steady_clock::time_point oldest_queued;
+
+    std::vector<std::shared_ptr<alert_exporter>> exporters;
+    std::atomic<size_t> num_exporters;
+
+    std::thread forward_thread;
+    bool forward_shutdown;
+
+    std::atomic<uint64_t> queued;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> batches;
+};
+
+// RFC5424 syslog over UDP, or over TCP with octet-counting framing (RFC6587), to a
+// collector configured as alert_syslog=udp://host:port or tcp://host:port.  TCP
+// connections are re-established on the next batch after a failure.
+class alert_syslog_exporter : public alert_exporter {
+public:
+    alert_syslog_exporter(const std::string& in_uri, unsigned int in_facility);
+    virtual ~alert_syslog_exporter();
+
+    // Returns false if the destination could not be parsed
+    bool valid() const {
+        return port.length() > 0;
+    }
+
+    virtual std::string exporter_name() const override {
+        return uri;
+    }
+
+    virtual bool send_alerts(const std::vector<std::shared_ptr<kis_alert_info>>& in_alerts) override;
+
+protected:
+    std::string format_message(const std::shared_ptr<kis_alert_info>& in_alert) const;
+
+    bool connect_socket();
+    void close_socket();
+
+    std::string uri;
+    bool use_tcp;
+    std::string host, port;
+    unsigned int facility;
+
+    std::string hostname;
+    pid_t pid;
+
+    int fd;
+};
+
+#endif
+
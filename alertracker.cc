@@ -18,6 +18,7 @@
 
 #include "config.h"
 
+#include <chrono>
 #include <string>
 #include <vector>
 #include <sstream>
@@ -30,10 +31,154 @@
 #include "kis_databaselogfile.h"
 #include "trackedelement_workers.h"
 
+static uint64_t alert_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void alert_rate_limiter::bucket::configure(uint64_t in_period_us, uint64_t in_tokens) {
+    interval_us = in_period_us / in_tokens;
+    tolerance_us = interval_us * (in_tokens - 1);
+    full_us = 0;
+}
+
+bool alert_rate_limiter::bucket::check(uint64_t in_now_us) const {
+    return full_us.load(std::memory_order_relaxed) <= in_now_us + tolerance_us;
+}
+
+bool alert_rate_limiter::bucket::take(uint64_t in_now_us) {
+    auto full = full_us.load(std::memory_order_relaxed);
+
+    do {
+        if (full > in_now_us + tolerance_us)
+            return false;
+    } while (!full_us.compare_exchange_weak(full, std::max(full, in_now_us) + interval_us,
+                std::memory_order_relaxed));
+
+    return true;
+}
+
+void alert_rate_limiter::bucket::put_back() {
+    full_us.fetch_sub(interval_us, std::memory_order_relaxed);
+}
+
+void alert_rate_limiter::configure(alert_time_unit in_limit_unit, uint64_t in_limit_rate,
+        alert_time_unit in_burst_unit, uint64_t in_limit_burst) {
+    squelched = (in_limit_rate == 0 || in_limit_burst == 0);
+
+    if (squelched)
+        return;
+
+    rate_bucket.configure(alert_time_unit_conv[in_limit_unit] * 1000000ULL, in_limit_rate);
+    burst_bucket.configure(alert_time_unit_conv[in_burst_unit] * 1000000ULL, in_limit_burst);
+}
+
+bool alert_rate_limiter::check(uint64_t in_now_us) const {
+    if (squelched)
+        return false;
+
+    return rate_bucket.check(in_now_us) && burst_bucket.check(in_now_us);
+}
+
+bool alert_rate_limiter::take(uint64_t in_now_us) {
+    if (squelched)
+        return false;
+
+    if (!rate_bucket.take(in_now_us))
+        return false;
+
+    if (!burst_bucket.take(in_now_us)) {
+        rate_bucket.put_back();
+        return false;
+    }
+
+    return true;
+}
+
+uint64_t alert_rate_limiter::burst_used(uint64_t in_now_us) const {
+    if (squelched)
+        return 0;
+
+    auto full = burst_bucket.full_us.load(std::memory_order_relaxed);
+
+    if (full <= in_now_us)
+        return 0;
+
+    return (full - in_now_us + burst_bucket.interval_us - 1) / burst_bucket.interval_us;
+}
+
+void tracked_alert_definition::pre_serialize() {
+    set_total_sent(sent_count.load());
+    set_burst_sent(limiter.burst_used(alert_now_us()));
+    set_time_last(sent_last.load());
+}
+
+void alert_backlog_ring::push(std::shared_ptr<tracked_alert> in_alert) {
+    if (slots.size() == 0)
+        return;
+
+    auto seq = head.fetch_add(1, std::memory_order_acq_rel);
+    in_alert->set_backlog_seq(seq);
+
+    auto& slot = slots[seq % slots.size()];
+
+    // A writer which lapped us may already have filled the slot with a newer alert
+    auto cur = std::atomic_load(&slot);
+
+    while (cur == nullptr || cur->get_backlog_seq() < seq) {
+        if (std::atomic_compare_exchange_weak(&slot, &cur, in_alert))
+            break;
+    }
+}
+
+void alert_backlog_ring::walk_newest(
+        const std::function<bool (const std::shared_ptr<tracked_alert>&)>& in_fn) const {
+    if (slots.size() == 0)
+        return;
+
+    auto end = next_seq();
+    uint64_t start = end > slots.size() ? end - slots.size() : 0;
+
+    for (auto seq = end; seq > start; seq--) {
+        auto a = std::atomic_load(&slots[(seq - 1) % slots.size()]);
+
+        // Not written yet; a slower writer is still storing it
+        if (a == nullptr || a->get_backlog_seq() < seq - 1)
+            continue;
+
+        // Overwritten while we walked; everything older is gone too
+        if (a->get_backlog_seq() > seq - 1)
+            return;
+
+        if (!in_fn(a))
+            return;
+    }
+}
+
+std::shared_ptr<tracker_element_vector> alert_backlog_ring::since(uint64_t in_seq, 
+        double in_ts, int in_id) const {
+    auto ret = std::make_shared<tracker_element_vector>(in_id);
+
+    walk_newest([&](const std::shared_ptr<tracked_alert>& a) -> bool {
+            if (a->get_backlog_seq() < in_seq || a->get_timestamp() <= in_ts)
+                return false;
+            ret->push_back(a);
+            return true;
+        });
+
+    std::reverse(ret->begin(), ret->end());
+
+    return ret;
+}
+
 alert_tracker::alert_tracker() : lifetime_global() {
     alert_mutex.set_name("alertracker");
 
 	next_alert_id = 0;
+    num_backlog = 50;
+
+    for (auto& a : alert_ref_table)
+        a = nullptr;
 
     packetchain = Globalreg::fetch_mandatory_global_as<packet_chain>();
     entrytracker = Globalreg::fetch_mandatory_global_as<entry_tracker>();
@@ -59,11 +204,16 @@ alert_tracker::alert_tracker() : lifetime_global() {
                 tracker_element_factory<tracker_element_vector>(), 
                 "Kismet alert definitions");
 
-    alert_backlog_vec =
-        entrytracker->register_and_get_field_as<tracker_element_vector>("kismet.alert.backlog",
+    alert_backlog_id =
+        entrytracker->register_field("kismet.alert.backlog",
                 tracker_element_factory<tracker_element_vector>(),
                 "Kismet alerts");
 
+    alert_cursor_id =
+        entrytracker->register_field("kismet.alert.cursor",
+                tracker_element_factory<tracker_element_uint64>(),
+                "alert backlog cursor");
+
     alert_def_id =
         entrytracker->register_field("kismet.alert.alert_definition",
                 tracker_element_factory<tracked_alert_definition>(),
@@ -84,6 +234,8 @@ alert_tracker::alert_tracker() : lifetime_global() {
                 "Server events", 
                 sat_day, 0, sat_day, 0, KIS_PHY_ANY);
 
+    forwarder.reset(new alert_forwarder());
+
     auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
 
     httpd->register_route("/alerts/definitions/define_alert", {"POST"}, httpd->LOGON_ROLE, {"cmd"}, 
@@ -102,7 +254,10 @@ alert_tracker::alert_tracker() : lifetime_global() {
             std::make_shared<kis_net_web_tracked_endpoint>(alert_defs_vec, alert_mutex));
 
     httpd->register_route("/alerts/all_alerts", {"GET", "POST"}, httpd->RO_ROLE, {}, 
-            std::make_shared<kis_net_web_tracked_endpoint>(alert_backlog_vec, alert_mutex));
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection>) -> std::shared_ptr<tracker_element> {
+                    return alert_backlog.since(0, 0, alert_backlog_id);
+                }));
 
     httpd->register_route("/alerts/alerts_view", {"GET", "POST"}, httpd->RO_ROLE, {},
             std::make_shared<kis_net_web_function_endpoint>(
@@ -116,16 +271,22 @@ alert_tracker::alert_tracker() : lifetime_global() {
                     auto hash_k = con->uri_params().find(":alertid");
                     auto hash = string_to_n<uint32_t>(hash_k->second);
 
-                    for (const auto& ai : *alert_backlog_vec) {
-                        auto a = std::static_pointer_cast<tracked_alert>(ai);
+                    std::shared_ptr<tracked_alert> ret;
 
-                        if (a->get_hash() == hash)
-                            return a;
-                    }
+                    alert_backlog.walk_newest([&](const std::shared_ptr<tracked_alert>& a) -> bool {
+                            if (a->get_hash() == hash) {
+                                ret = a;
+                                return false;
+                            }
+                            return true;
+                        });
+
+                    if (ret != nullptr)
+                        return ret;
 
                     con->set_status(404);
                     return std::make_shared<tracker_element_map>();
-                }, alert_mutex));
+                }));
 
     httpd->register_route("/alerts/last-time/:timestamp/alerts", {"GET", "POST"}, httpd->RO_ROLE, {}, 
             std::make_shared<kis_net_web_tracked_endpoint>(
@@ -139,6 +300,12 @@ alert_tracker::alert_tracker() : lifetime_global() {
                 return last_alerts_endpoint(con, true);
             }));
 
+    httpd->register_route("/alerts/wrapped/cursor/:cursor/alerts", {"GET", "POST"}, httpd->RO_ROLE,
+            {}, std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) -> std::shared_ptr<tracker_element> {
+                return cursor_alerts_endpoint(con);
+            }));
+
 #ifdef PRELUDE
     prelude_alerts = Globalreg::globalreg->kismet_config->fetch_opt_bool("prelude_alerts", true);
 
@@ -172,6 +339,8 @@ alert_tracker::alert_tracker() : lifetime_global() {
         num_backlog = scantmp;
     }
 
+    alert_backlog.resize(num_backlog);
+
     // Parse config file vector of all alerts
     if (parse_alert_config(Globalreg::globalreg->kismet_config) < 0) {
         _MSG("Failed to parse alert values from Kismet config file", MSGFLAG_FATAL);
@@ -180,6 +349,29 @@ alert_tracker::alert_tracker() : lifetime_global() {
     }
 
     log_alerts = Globalreg::globalreg->kismet_config->fetch_opt_bool("kis_log_alerts", true);
+
+    auto syslog_facility = 
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("alert_syslog_facility", 1);
+
+    for (const auto& s : Globalreg::globalreg->kismet_config->fetch_opt_vec("alert_syslog")) {
+        auto exporter = std::make_shared<alert_syslog_exporter>(s, syslog_facility);
+
+        if (!exporter->valid()) {
+            _MSG_ERROR("Invalid alert_syslog destination '{}', expected udp://host:port or "
+                    "tcp://host:port", s);
+            continue;
+        }
+
+        _MSG_INFO("Forwarding alerts to syslog collector {}", s);
+        add_alert_exporter(exporter);
+    }
+
+    httpd->register_route("/alerts/forwarding", {"GET"}, httpd->RO_ROLE, {"json"},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    std::ostream os(&con->response_stream());
+                    forwarder->write_stats(os);
+                }));
 }
 
 alert_tracker::~alert_tracker() {
@@ -188,6 +380,9 @@ alert_tracker::~alert_tracker() {
     Globalreg::globalreg->remove_global("ALERTTRACKER");
     Globalreg::globalreg->alertracker = NULL;
 
+    if (forwarder != nullptr)
+        forwarder->stop();
+
 #ifdef PRELUDE
     if (prelude_alerts) {
         prelude_deinit();
@@ -196,6 +391,10 @@ alert_tracker::~alert_tracker() {
 #endif
 }
 
+void alert_tracker::add_alert_exporter(std::shared_ptr<alert_exporter> in_exporter) {
+    forwarder->add_exporter(in_exporter);
+}
+
 void alert_tracker::trigger_deferred_startup() {
     gpstracker = Globalreg::fetch_mandatory_global_as<gps_tracker>();
 }
@@ -262,9 +461,14 @@ int alert_tracker::register_alert(std::string in_header, std::string in_class,
     arec->set_phy(in_phy);
     arec->set_time_last(0);
 
+    arec->get_limiter().configure(in_unit, in_rate, in_burstunit, in_burst);
+
     alert_name_map.insert(std::make_pair(arec->get_header(), arec->get_alert_ref()));
     alert_ref_map.insert(std::make_pair(arec->get_alert_ref(), arec));
 
+    if (arec->get_alert_ref() >= 0 && arec->get_alert_ref() < ALERT_REF_TABLE_MAX)
+        alert_ref_table[arec->get_alert_ref()].store(arec.get(), std::memory_order_release);
+
     alert_defs_vec->push_back(arec);
 
     return arec->get_alert_ref();
@@ -281,78 +485,49 @@ int alert_tracker::fetch_alert_ref(std::string in_header) {
     return -1;
 }
 
-int alert_tracker::check_times(shared_alert_def arec) {
-    // Alerts limited to 0 are squelched
-    if (arec->get_limit_rate() == 0) {
-        return 0;
-    }
+tracked_alert_definition *alert_tracker::fetch_alert_def(int in_ref) {
+    if (in_ref < 0)
+        return nullptr;
 
-    struct timeval now;
-    gettimeofday(&now, NULL);
+    if (in_ref < ALERT_REF_TABLE_MAX)
+        return alert_ref_table[in_ref].load(std::memory_order_acquire);
 
-    // If the last time we sent anything was longer than the main rate limit,
-    // then we reset back to empty
-    if (arec->get_time_last() < (now.tv_sec - 
-                alert_time_unit_conv[arec->get_limit_unit()])) {
-        arec->set_total_sent(0);
-        arec->set_burst_sent(0);
-        return 1;
-    }
+    kis_lock_guard<kis_mutex> lk(alert_mutex, "alert_tracker fetch_alert_def");
 
-    // If the last time we sent anything was longer than the burst rate, we can
-    // reset the burst to 0
-    if (arec->get_time_last() < (now.tv_sec - 
-                alert_time_unit_conv[arec->get_burst_unit()])) {
-        arec->set_burst_sent(0);
-    }
+    auto aritr = alert_ref_map.find(in_ref);
 
-    // If we're under the limit on both, we're good to go
-    if (arec->get_burst_sent() < arec->get_limit_burst() && 
-            arec->get_total_sent() < arec->get_limit_rate())
-        return 1;
+    if (aritr == alert_ref_map.end())
+        return nullptr;
 
-    return 0;
+    return aritr->second.get();
 }
 
 int alert_tracker::potential_alert(int in_ref) {
-    kis_lock_guard<kis_mutex> lk(alert_mutex, "alert_tracker potential_alert");
+    auto arec = fetch_alert_def(in_ref);
 
-    std::map<int, shared_alert_def>::iterator aritr = alert_ref_map.find(in_ref);
-
-    if (aritr == alert_ref_map.end())
+    if (arec == nullptr)
         return 0;
 
-    shared_alert_def arec = aritr->second;
-
-    return check_times(arec);
+    return arec->get_limiter().check(alert_now_us());
 }
 
 int alert_tracker::raise_alert(int in_ref, std::shared_ptr<kis_packet> in_pack,
         mac_addr bssid, mac_addr source, mac_addr dest, 
         mac_addr other, std::string in_channel, std::string in_text) {
 
-    kis_unique_lock<kis_mutex> lock(alert_mutex, std::defer_lock, "alert_tracker raise_alert");
-
-    lock.lock();
+    auto arec = fetch_alert_def(in_ref);
 
-    std::map<int, shared_alert_def>::iterator aritr = alert_ref_map.find(in_ref);
-
-    if (aritr == alert_ref_map.end())
+    if (arec == nullptr)
         return -1;
 
-    shared_alert_def arec = aritr->second;
-
     if (in_pack != nullptr) {
         in_pack->tag_map["ALERT"] = true;
         in_pack->tag_map[fmt::format("ALERT_{}", arec->get_header())] = true;
     }
 
-
-    if (check_times(arec) != 1)
+    if (!arec->get_limiter().take(alert_now_us()))
         return 0;
 
-    lock.unlock();
-
     auto info = std::make_shared<kis_alert_info>();
 
     info->header = arec->get_header();
@@ -374,26 +549,17 @@ int alert_tracker::raise_alert(int in_ref, std::shared_ptr<kis_packet> in_pack,
     if (gpstracker != nullptr)
         info->gps = gpstracker->get_best_location();
 
-    // Increment and set the timers
-    arec->inc_burst_sent(1);
-    arec->inc_total_sent(1);
-    arec->set_time_last(ts_to_double(info->tm));
-
-    lock.lock();
+    arec->count_sent(ts_to_double(info->tm));
 
     auto alert_t = std::make_shared<tracked_alert>(alert_entry_id, info);
 
-    alert_backlog_vec->push_back(alert_t);
-    if ((int) alert_backlog_vec->size() > num_backlog) 
-        alert_backlog_vec->erase(alert_backlog_vec->begin());
+    alert_backlog.push(alert_t);
 
     // Publish an alert to the eventbus
     auto event = eventbus->get_eventbus_event(alert_event());
     event->get_event_content()->insert(alert_event(), alert_t);
     eventbus->publish(event);
 
-    lock.unlock();
-
     // Try to get the existing alert info
     if (in_pack != NULL)  {
         auto acomp = in_pack->fetch<kis_alert_component>(pack_comp_alert);
@@ -412,6 +578,9 @@ int alert_tracker::raise_alert(int in_ref, std::shared_ptr<kis_packet> in_pack,
         info->gps = pack_gpsinfo;
     }
 
+    if (forwarder->has_exporters())
+        forwarder->queue(info);
+
 #ifdef PRELUDE
     // Send alert to Prelude
     if (prelude_alerts)
@@ -427,8 +596,6 @@ int alert_tracker::raise_alert(int in_ref, std::shared_ptr<kis_packet> in_pack,
 
 int alert_tracker::raise_one_shot(std::string in_header, std::string in_class, 
         kis_alert_severity in_severity, std::string in_text, int in_phy) {
-    kis_unique_lock<kis_mutex> lock(alert_mutex, std::defer_lock, "alert_tracker raise_one_shot");
-
 	kis_alert_info info;
 
 	info.header = in_header;
@@ -446,21 +613,18 @@ int alert_tracker::raise_one_shot(std::string in_header, std::string in_class,
 
 	info.text = in_text;
 
-    lock.lock();
-
     auto alert_t = std::make_shared<tracked_alert>(alert_entry_id, &info);
 
-    alert_backlog_vec->push_back(alert_t);
-    if ((int) alert_backlog_vec->size() > num_backlog) 
-        alert_backlog_vec->erase(alert_backlog_vec->begin());
+    alert_backlog.push(alert_t);
+
+    if (forwarder->has_exporters())
+        forwarder->queue(std::make_shared<kis_alert_info>(info));
 
     // Publish an alert to the eventbus
     auto event = eventbus->get_eventbus_event(alert_event());
     event->get_event_content()->insert(alert_event(), alert_t);
     eventbus->publish(event);
 
-    lock.unlock();
-
 #ifdef PRELUDE
     // Send alert to Prelude
     if (prelude_alerts)
@@ -709,11 +873,8 @@ alert_tracker::last_alerts_endpoint(std::shared_ptr<kis_net_beast_httpd_connecti
 
     std::shared_ptr<tracker_element> transmit;
     std::shared_ptr<tracker_element_map> wrapper;
-    std::shared_ptr<tracker_element_vector> msgvec = std::make_shared<tracker_element_vector>(alert_vec_id);
     double since_time = 0;
 
-    std::ostream os(&con->response_stream());
-
     auto ts_k = con->uri_params().find(":timestamp");
     try {
         since_time = string_to_n<double>(ts_k->second);
@@ -722,6 +883,11 @@ alert_tracker::last_alerts_endpoint(std::shared_ptr<kis_net_beast_httpd_connecti
         return transmit;
     }
 
+    // Take the cursor before walking the backlog, so an alert raised while we walk is 
+    // returned again by the next cursor request rather than skipped
+    auto cursor = alert_backlog.next_seq();
+    auto msgvec = alert_backlog.since(0, since_time, alert_vec_id);
+
     if (wrap) {
         wrapper = std::make_shared<tracker_element_map>();
         wrapper->insert(msgvec);
@@ -729,23 +895,36 @@ alert_tracker::last_alerts_endpoint(std::shared_ptr<kis_net_beast_httpd_connecti
         auto ts = std::make_shared<tracker_element_double>(alert_timestamp_id, ts_now_to_double());
         wrapper->insert(ts);
 
+        wrapper->insert(std::make_shared<tracker_element_uint64>(alert_cursor_id, cursor));
+
         transmit = wrapper;
     } else {
         transmit = msgvec;
     }
 
-    {
-        kis_lock_guard<kis_mutex> lk(alert_mutex, "alert_tracker last_alerts_endpoint");
+    return transmit;
+}
 
-        for (auto i : *alert_backlog_vec) {
-            auto ai = std::static_pointer_cast<tracked_alert>(i);
-            if (since_time < ai->get_timestamp()) {
-                msgvec->push_back(ai);
-            }
-        }
+std::shared_ptr<tracker_element> 
+alert_tracker::cursor_alerts_endpoint(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    uint64_t since_seq = 0;
+
+    auto cursor_k = con->uri_params().find(":cursor");
+    try {
+        since_seq = string_to_n<uint64_t>(cursor_k->second);
+    } catch (const std::exception& e) {
+        con->set_status(400);
+        return nullptr;
     }
 
-    return transmit;
+    auto cursor = alert_backlog.next_seq();
+
+    auto wrapper = std::make_shared<tracker_element_map>();
+    wrapper->insert(alert_backlog.since(since_seq, 0, alert_vec_id));
+    wrapper->insert(std::make_shared<tracker_element_double>(alert_timestamp_id, ts_now_to_double()));
+    wrapper->insert(std::make_shared<tracker_element_uint64>(alert_cursor_id, cursor));
+
+    return wrapper;
 }
 
 void alert_tracker::define_alert_endpoint(std::shared_ptr<kis_net_beast_httpd_connection> con) {
@@ -992,16 +1171,10 @@ void alert_tracker::alert_dt_endpoint(std::shared_ptr<kis_net_beast_httpd_connec
         fmt::print(os, "Invalid request: {}\n", e.what());
     }
 
-    // vector we do work on
-    auto next_work_vec = std::make_shared<tracker_element_vector>();
-
-    // Copy the alerts under lock; in the future this should populate them from the 
-    // databaselog too perhaps
-    {
-        kis_lock_guard<kis_mutex> lk(alert_mutex, "alertracker dt view copy");
-        next_work_vec->set(alert_backlog_vec->begin(), alert_backlog_vec->end());
-        total_sz_elem->set(next_work_vec->size());
-    }
+    // vector we do work on, copied from the backlog; in the future this should populate 
+    // them from the databaselog too perhaps
+    auto next_work_vec = alert_backlog.since(0, 0, alert_vec_id);
+    total_sz_elem->set(next_work_vec->size());
 
     if (search_term.length() > 0 && search_paths.size() > 0) {
         auto worker = tracker_element_icasestringmatch_worker(search_term, search_paths);
@@ -23,12 +23,15 @@
 
 #include <stdio.h>
 #include <time.h>
+#include <array>
+#include <atomic>
 #include <list>
 #include <map>
 #include <vector>
 #include <algorithm>
 #include <string>
 
+#include "alert_forward.h"
 #include "eventbus.h"
 #include "globalregistry.h"
 #include "kis_gps.h"
@@ -210,6 +213,10 @@ public:
 
     __ProxyTrackable(location, kis_tracked_location_triplet, location);
 
+    // Position in the alert backlog
+    uint64_t get_backlog_seq() const { return backlog_seq; }
+    void set_backlog_seq(uint64_t in_seq) { backlog_seq = in_seq; }
+
     void from_alert_info(std::shared_ptr<kis_alert_info> info) {
         from_alert_info(info.get());
     }
@@ -305,9 +312,14 @@ protected:
     std::shared_ptr<tracker_element_double> frequency;
     std::shared_ptr<tracker_element_string> text;
     std::shared_ptr<kis_tracked_location_triplet> location;
+
+    uint64_t backlog_seq{0};
 };
 
 
+// Alert references below this are looked up without locking
+#define ALERT_REF_TABLE_MAX     1024
+
 static const int alert_time_unit_conv[] = {
     1, 60, 3600, 86400
 };
@@ -316,6 +328,42 @@ enum alert_time_unit {
     sat_second, sat_minute, sat_hour, sat_day
 };
 
+// Lock-free rate limit of an alert, as two token buckets: the limit rate per limit unit,
+// and the burst per burst unit.  Each bucket is kept as the time at which it will be
+// full again (the generic cell rate algorithm), so taking a token is a single
+// compare-and-swap.  Alerts with a rate of 0 are squelched.
+class alert_rate_limiter {
+public:
+    alert_rate_limiter() { }
+
+    // Limits are set before the alert is published to other threads
+    void configure(alert_time_unit in_limit_unit, uint64_t in_limit_rate,
+            alert_time_unit in_burst_unit, uint64_t in_limit_burst);
+
+    // Is a token available, and take one if there is
+    bool check(uint64_t in_now_us) const;
+    bool take(uint64_t in_now_us);
+
+    // Tokens used from the burst, refilled as time passes
+    uint64_t burst_used(uint64_t in_now_us) const;
+
+protected:
+    struct bucket {
+        // Time to earn a token, and how far the bucket may run ahead of now
+        uint64_t interval_us{0};
+        uint64_t tolerance_us{0};
+        std::atomic<uint64_t> full_us{0};
+
+        void configure(uint64_t in_period_us, uint64_t in_tokens);
+        bool check(uint64_t in_now_us) const;
+        bool take(uint64_t in_now_us);
+        void put_back();
+    };
+
+    bool squelched{true};
+    bucket rate_bucket, burst_bucket;
+};
+
 class tracked_alert_definition : public tracker_component {
 public:
     tracked_alert_definition() :
@@ -390,6 +438,16 @@ public:
     int get_alert_ref() { return alert_ref; }
     void set_alert_ref(int in_ref) { alert_ref = in_ref; }
 
+    alert_rate_limiter& get_limiter() { return limiter; }
+
+    // Count a sent alert; the exported counts are filled in when serialized
+    void count_sent(double in_ts) {
+        sent_count++;
+        sent_last = in_ts;
+    }
+
+    virtual void pre_serialize() override;
+
 protected:
     virtual void register_fields() override {
         tracker_component::register_fields();
@@ -437,6 +495,41 @@ protected:
     // Timestamp of the last time
     std::shared_ptr<tracker_element_double> time_last;
 
+    alert_rate_limiter limiter;
+    std::atomic<uint64_t> sent_count{0};
+    std::atomic<double> sent_last{0};
+};
+
+// Fixed size ring of the most recent alerts.  Writers claim the next sequence number 
+// and store the alert in its slot; readers walk back from the newest sequence and stop
+// at a slot which has been overwritten, so nothing is copied or trimmed as alerts
+// arrive.
+class alert_backlog_ring {
+public:
+    alert_backlog_ring() { }
+
+    // Sized once, before alerts are raised
+    void resize(size_t in_size) {
+        slots = std::vector<std::shared_ptr<tracked_alert>>(in_size);
+    }
+
+    void push(std::shared_ptr<tracked_alert> in_alert);
+
+    // Sequence number the next alert will get
+    uint64_t next_seq() const {
+        return head.load(std::memory_order_acquire);
+    }
+
+    // Call a function with each alert, newest first, until it returns false or the 
+    // backlog runs out
+    void walk_newest(const std::function<bool (const std::shared_ptr<tracked_alert>&)>& in_fn) const;
+
+    // Alerts with a sequence number of at least in_seq, and any newer than in_ts, oldest first
+    std::shared_ptr<tracker_element_vector> since(uint64_t in_seq, double in_ts, int in_id) const;
+
+protected:
+    std::vector<std::shared_ptr<tracked_alert>> slots;
+    std::atomic<uint64_t> head{0};
 };
 
 typedef std::shared_ptr<tracked_alert_definition> shared_alert_def;
@@ -521,6 +614,10 @@ public:
     // Find an activated alert
     int find_activated_alert(std::string in_header);
 
+    // Hand raised alerts to an exporter from the asynchronous forwarding stage; 
+    // exporters run on the forwarding thread, never on the caller raising the alert
+    void add_alert_exporter(std::shared_ptr<alert_exporter> in_exporter);
+
     static std::string alert_event() {
         return "ALERT";
     }
@@ -533,10 +630,12 @@ protected:
     std::shared_ptr<event_bus> eventbus;
     std::shared_ptr<gps_tracker> gpstracker;
 
-    int alert_vec_id, alert_entry_id, alert_timestamp_id, alert_def_id;
+    int alert_vec_id, alert_entry_id, alert_timestamp_id, alert_def_id, alert_backlog_id,
+        alert_cursor_id;
 
-    // Check and age times
-    int check_times(shared_alert_def arec);
+    // Find a definition by reference; definitions are never removed, so the common refs
+    // are looked up without locking
+    tracked_alert_definition *fetch_alert_def(int in_ref);
 
 	// Parse a foo/bar rate/unit option
 	int parse_rate_unit(std::string in_ru, alert_time_unit *ret_unit, int *ret_rate);
@@ -549,6 +648,7 @@ protected:
     // Internal C++ mapping
     std::map<std::string, int> alert_name_map;
     std::map<int, shared_alert_def> alert_ref_map;
+    std::array<std::atomic<tracked_alert_definition *>, ALERT_REF_TABLE_MAX> alert_ref_table;
 
     // Tracked mapping for export
     std::shared_ptr<tracker_element_vector> alert_defs_vec;
@@ -556,7 +656,7 @@ protected:
     int num_backlog;
 
     // Backlog of alerts to be sent
-    std::shared_ptr<tracker_element_vector> alert_backlog_vec;
+    alert_backlog_ring alert_backlog;
 
     // Alert configs we read before we know the alerts themselves
 	std::map<std::string, alert_conf_rec *> alert_conf_map;
@@ -571,10 +671,13 @@ protected:
     // Do we log alerts to the kismet database?
     bool log_alerts;
 
+    std::unique_ptr<alert_forwarder> forwarder;
+
     void define_alert_endpoint(std::shared_ptr<kis_net_beast_httpd_connection> con);
     void raise_alert_endpoint(std::shared_ptr<kis_net_beast_httpd_connection> con);
 
     std::shared_ptr<tracker_element> last_alerts_endpoint(std::shared_ptr<kis_net_beast_httpd_connection> con, bool wrap);
+    std::shared_ptr<tracker_element> cursor_alerts_endpoint(std::shared_ptr<kis_net_beast_httpd_connection> con);
 
     void alert_dt_endpoint(std::shared_ptr<kis_net_beast_httpd_connection> con);
 };
@@ -34,6 +34,8 @@
 #include <sys/wait.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <time.h>
+#include <sys/time.h>
 
 #ifdef HAVE_CAPABILITY
 #include <sys/capability.h>
@@ -43,8 +45,13 @@
 #endif
 
 #ifdef SYS_LINUX
+#include <linux/futex.h>
 #include <linux/sched.h>
+#include <sys/mman.h>
 #include <sys/mount.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #endif
 
 #include "capture_framework.h"
@@ -55,6 +62,14 @@
 #include "protobuf_c/kismet.pb-c.h"
 #include "protobuf_c/datasource.pb-c.h"
 
+#ifndef KDLT_IEEE802_11
+#define KDLT_IEEE802_11             105
+#endif
+
+#ifndef KDLT_RADIOTAP
+#define KDLT_RADIOTAP               127
+#endif
+
 uint32_t adler32_append_csum(uint8_t *in_buf, size_t in_len, uint32_t cs) {
     size_t i;
     uint32_t ls1 = cs & 0xFFFF;
@@ -373,6 +388,17 @@ kis_capture_handler_t *cf_handler_init(const char *in_type) {
     ch->last_ping = time(0);
     ch->seqno = 1;
 
+    ch->has_kernel_stats = 0;
+    ch->kernel_packets = 0;
+    ch->kernel_drops = 0;
+    ch->ringbuf_full = 0;
+
+    ch->hop_count = 0;
+    ch->hop_dwell_total_usec = 0;
+    ch->hop_dwell_error_total_usec = 0;
+    ch->hop_switch_total_usec = 0;
+    ch->hop_switch_max_usec = 0;
+
     ch->capsource_type = strdup(in_type);
 
     ch->remote_capable = 1;
@@ -380,6 +406,14 @@ kis_capture_handler_t *cf_handler_init(const char *in_type) {
     ch->remote_host = NULL;
     ch->remote_port = 0;
 
+    ch->remote_servers = NULL;
+    ch->remote_server_ports = NULL;
+    ch->num_remote_servers = 0;
+    ch->remote_server_idx = 0;
+    ch->remote_balance_interval = 60;
+    ch->remote_last_balance = 0;
+    ch->remote_migrating = NULL;
+
     ch->use_tcp = 0;
     ch->use_ipc = 0;
     ch->use_ws = 0;
@@ -402,6 +436,12 @@ kis_capture_handler_t *cf_handler_init(const char *in_type) {
 
     ch->cli_sourcedef = NULL;
 
+    ch->extra_sourcedefs = NULL;
+    ch->num_extra_sourcedefs = 0;
+    ch->sub_handlers = NULL;
+    ch->num_sub_handlers = 0;
+    ch->parent_handler = NULL;
+
     ch->in_fd = -1;
     ch->out_fd = -1;
     ch->tcp_fd = -1;
@@ -421,6 +461,13 @@ kis_capture_handler_t *cf_handler_init(const char *in_type) {
     ch->in_ringbuf = NULL;
     ch->out_ringbuf = NULL;
 
+    ch->use_v3 = 0;
+
+    ch->shm_ring = NULL;
+    ch->shm_data = NULL;
+    ch->shm_map_sz = 0;
+    ch->shm_reserve_head = 0;
+
     pthread_mutexattr_init(&mutexattr);
     pthread_mutexattr_settype(&mutexattr, PTHREAD_MUTEX_RECURSIVE);
     pthread_mutex_init(&(ch->out_ringbuf_lock), &mutexattr);
@@ -428,6 +475,36 @@ kis_capture_handler_t *cf_handler_init(const char *in_type) {
     pthread_cond_init(&(ch->out_ringbuf_flush_cond), NULL);
     pthread_mutex_init(&(ch->out_ringbuf_flush_cond_mutex), NULL);
 
+    ch->out_reader_waiting = 0;
+    ch->out_writer_waiting = 0;
+#ifdef SYS_LINUX
+    ch->out_data_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ch->out_space_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+    ch->out_data_efd = -1;
+    ch->out_space_efd = -1;
+#endif
+
+    pthread_mutex_init(&(ch->batch_lock), NULL);
+    pthread_cond_init(&(ch->batch_cond), NULL);
+    ch->batch_buf = NULL;
+    ch->batch_max_bytes = 0;
+    ch->batch_len = 0;
+    ch->batch_count = 0;
+    ch->batch_flush_usec = 0;
+    ch->batch_running = 0;
+    ch->batch_shutdown = 0;
+    ch->batch_z_init = 0;
+    ch->batch_z_enabled = 0;
+    ch->batch_z_reset = 0;
+    ch->dgram_fd = -1;
+    ch->dgram_token = 0;
+    ch->dgram_seqno = 0;
+    ch->dgram_buf = NULL;
+    ch->dgram_max_bytes = 0;
+
+    ch->data_headers_only = 0;
+
     ch->shutdown = 0;
     ch->spindown = 0;
 
@@ -444,6 +521,8 @@ kis_capture_handler_t *cf_handler_init(const char *in_type) {
 
     ch->spectrumconfig_cb = NULL;
 
+    ch->newhandler_cb = NULL;
+
     ch->capture_cb = NULL;
 
     ch->userdata = NULL;
@@ -455,11 +534,13 @@ kis_capture_handler_t *cf_handler_init(const char *in_type) {
     ch->channel_hop_list = NULL;
     ch->custom_channel_hop_list = NULL;
     ch->channel_hop_list_sz = 0;
+    ch->channel_hop_dwell = NULL;
     ch->channel_hop_shuffle = 0;
     ch->channel_hop_shuffle_spacing = 1;
     ch->channel_hop_failure_list = NULL;
     ch->channel_hop_failure_list_sz = 0;
     ch->max_channel_hop_rate = 0;
+    ch->channel_set_latency_usec = 0;
 
     ch->verbose = 0;
 
@@ -483,6 +564,49 @@ void cf_handler_free(kis_capture_handler_t *caph) {
     if (caph == NULL)
         return;
 
+    for (szi = 0; szi < caph->num_sub_handlers; szi++)
+        cf_handler_free(caph->sub_handlers[szi]);
+
+    if (caph->sub_handlers != NULL)
+        free(caph->sub_handlers);
+
+    for (szi = 0; szi < caph->num_extra_sourcedefs; szi++)
+        free(caph->extra_sourcedefs[szi]);
+
+    if (caph->extra_sourcedefs != NULL)
+        free(caph->extra_sourcedefs);
+
+    /* Stop the batch thread before taking the ringbuf lock it may be waiting on */
+    pthread_mutex_lock(&(caph->batch_lock));
+    caph->batch_shutdown = 1;
+    pthread_cond_broadcast(&(caph->batch_cond));
+    pthread_mutex_unlock(&(caph->batch_lock));
+
+    if (caph->batch_running) {
+        pthread_join(caph->batchthread, NULL);
+        caph->batch_running = 0;
+    }
+
+    if (caph->batch_buf != NULL) {
+        free(caph->batch_buf);
+        caph->batch_buf = NULL;
+    }
+
+    if (caph->batch_z_init) {
+        deflateEnd(&(caph->batch_zstrm));
+        caph->batch_z_init = 0;
+    }
+
+    if (caph->dgram_fd >= 0) {
+        close(caph->dgram_fd);
+        caph->dgram_fd = -1;
+    }
+
+    if (caph->dgram_buf != NULL) {
+        free(caph->dgram_buf);
+        caph->dgram_buf = NULL;
+    }
+
     pthread_mutex_lock(&(caph->handler_lock));
     pthread_mutex_lock(&(caph->out_ringbuf_lock));
 
@@ -495,6 +619,15 @@ void cf_handler_free(kis_capture_handler_t *caph) {
     if (caph->remote_host)
         free(caph->remote_host);
 
+    for (szi = 0; szi < caph->num_remote_servers; szi++)
+        free(caph->remote_servers[szi]);
+
+    if (caph->remote_servers != NULL)
+        free(caph->remote_servers);
+
+    if (caph->remote_server_ports != NULL)
+        free(caph->remote_server_ports);
+
     if (caph->capsource_type)
         free(caph->capsource_type);
 
@@ -510,6 +643,17 @@ void cf_handler_free(kis_capture_handler_t *caph) {
     if (caph->out_ringbuf != NULL)
         kis_simple_ringbuf_free(caph->out_ringbuf);
 
+    if (caph->out_data_efd >= 0)
+        close(caph->out_data_efd);
+
+    if (caph->out_space_efd >= 0)
+        close(caph->out_space_efd);
+
+    if (caph->shm_ring != NULL) {
+        munmap(caph->shm_ring, caph->shm_map_sz);
+        caph->shm_ring = NULL;
+    }
+
     for (szi = 0; szi < caph->channel_hop_list_sz; szi++) {
         if (caph->channel_hop_list[szi] != NULL)
             free(caph->channel_hop_list[szi]);
@@ -527,6 +671,9 @@ void cf_handler_free(kis_capture_handler_t *caph) {
     if (caph->custom_channel_hop_list != NULL)
         free(caph->custom_channel_hop_list);
 
+    if (caph->channel_hop_dwell != NULL)
+        free(caph->channel_hop_dwell);
+
     if (caph->capture_running) {
         pthread_cancel(caph->capturethread);
         caph->capture_running = 0;
@@ -539,6 +686,8 @@ void cf_handler_free(kis_capture_handler_t *caph) {
 
     pthread_mutex_destroy(&(caph->out_ringbuf_lock));
     pthread_mutex_destroy(&(caph->handler_lock));
+    pthread_mutex_destroy(&(caph->batch_lock));
+    pthread_cond_destroy(&(caph->batch_cond));
 }
 
 cf_params_interface_t *cf_params_interface_new() {
@@ -633,8 +782,11 @@ void cf_handler_assign_hop_channels(kis_capture_handler_t *caph, char **stringch
         free(caph->channel_hop_list);
     if (caph->custom_channel_hop_list)
         free(caph->custom_channel_hop_list);
+    if (caph->channel_hop_dwell)
+        free(caph->channel_hop_dwell);
 
     caph->channel_hop_list = stringchans;
+    caph->channel_hop_dwell = NULL;
     caph->custom_channel_hop_list = privchans;
     caph->channel_hop_list_sz = chan_sz;
 
@@ -673,6 +825,38 @@ void cf_handler_assign_hop_channels(kis_capture_handler_t *caph, char **stringch
     cf_handler_launch_hopping_thread(caph);
 }
 
+void cf_handler_assign_hop_dwell(kis_capture_handler_t *caph, const double *dwell,
+        size_t dwell_sz) {
+    double *hop_dwell = NULL;
+    size_t szi;
+
+    pthread_mutex_lock(&(caph->handler_lock));
+
+    if (dwell_sz != 0 && caph->channel_hop_list_sz != 0) {
+        hop_dwell = (double *) malloc(sizeof(double) * caph->channel_hop_list_sz);
+
+        if (hop_dwell != NULL) {
+            for (szi = 0; szi < caph->channel_hop_list_sz; szi++) {
+                if (szi < dwell_sz && dwell[szi] > 0)
+                    hop_dwell[szi] = dwell[szi];
+                else
+                    hop_dwell[szi] = 1;
+            }
+        }
+    }
+
+    if (caph->channel_hop_dwell != NULL)
+        free(caph->channel_hop_dwell);
+
+    caph->channel_hop_dwell = hop_dwell;
+
+    pthread_mutex_unlock(&(caph->handler_lock));
+}
+
+void cf_handler_set_hop_latency(kis_capture_handler_t *caph, unsigned long latency_usec) {
+    __atomic_store_n(&caph->channel_set_latency_usec, latency_usec, __ATOMIC_RELAXED);
+}
+
 void cf_handler_set_hop_shuffle_spacing(kis_capture_handler_t *caph, int spacing) {
     pthread_mutex_lock(&(caph->handler_lock));
 
@@ -761,6 +945,319 @@ void cf_handler_list_devices(kis_capture_handler_t *caph) {
     }
 }
 
+/* Parse a --connect list of one or more comma-separated host:port servers; the first
+ * server is the initial remote host */
+static int cf_int_parse_remote_servers(kis_capture_handler_t *caph, const char *in_list) {
+    char parse_hname[513];
+    unsigned int parse_port;
+    const char *pos = in_list;
+    const char *end;
+    size_t len;
+    char *tok;
+    char **servers;
+    unsigned int *ports;
+
+    while (*pos != '\0') {
+        end = strchr(pos, ',');
+
+        if (end == NULL)
+            len = strlen(pos);
+        else
+            len = end - pos;
+
+        if ((tok = strndup(pos, len)) == NULL)
+            return -1;
+
+        if (sscanf(tok, "%512[^:]:%u", parse_hname, &parse_port) != 2) {
+            free(tok);
+            return -1;
+        }
+
+        free(tok);
+
+        servers = (char **) realloc(caph->remote_servers, 
+                sizeof(char *) * (caph->num_remote_servers + 1));
+        if (servers == NULL)
+            return -1;
+        caph->remote_servers = servers;
+
+        ports = (unsigned int *) realloc(caph->remote_server_ports,
+                sizeof(unsigned int) * (caph->num_remote_servers + 1));
+        if (ports == NULL)
+            return -1;
+        caph->remote_server_ports = ports;
+
+        caph->remote_servers[caph->num_remote_servers] = strdup(parse_hname);
+        caph->remote_server_ports[caph->num_remote_servers] = parse_port;
+        caph->num_remote_servers++;
+
+        if (end == NULL)
+            break;
+
+        pos = end + 1;
+    }
+
+    if (caph->num_remote_servers == 0)
+        return -1;
+
+    if (caph->remote_host != NULL)
+        free(caph->remote_host);
+
+    caph->remote_server_idx = 0;
+    caph->remote_host = strdup(caph->remote_servers[0]);
+    caph->remote_port = caph->remote_server_ports[0];
+
+    return 1;
+}
+
+/* Query the load of every remote server over UDP, in permille of the busiest of the
+ * packet backlog and the CPU, or -1 for a server which did not answer in time.  The
+ * number of running sources of each server is returned in in_sources. */
+static void cf_int_query_server_loads(kis_capture_handler_t *caph, int *in_loads, 
+        unsigned int *in_sources, unsigned int in_timeout_ms) {
+    kismet_remote_load_query query;
+    kismet_remote_load_report report;
+    struct addrinfo hints, *res;
+    struct timeval now, deadline, tm;
+    char portstr[16];
+    fd_set rset;
+    uint32_t nonce_base;
+    uint32_t nonce;
+    size_t i;
+    int sock;
+    int pending = 0;
+    ssize_t r;
+    unsigned int backlog, limit, cpus;
+    int load, cpu;
+
+    for (i = 0; i < caph->num_remote_servers; i++) {
+        in_loads[i] = -1;
+        in_sources[i] = 0;
+    }
+
+    if ((sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0)
+        return;
+
+    nonce_base = (uint32_t) rand();
+
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    for (i = 0; i < caph->num_remote_servers; i++) {
+        snprintf(portstr, 16, "%u", caph->remote_server_ports[i]);
+
+        if (getaddrinfo(caph->remote_servers[i], portstr, &hints, &res) != 0)
+            continue;
+
+        memset(&query, 0, sizeof(kismet_remote_load_query));
+        query.tag = htobe64(REMOTE_LOAD_TAG);
+        query.load_version = htobe16(REMOTE_LOAD_VERSION);
+        query.nonce = htobe32(nonce_base + (uint32_t) i);
+
+        if (sendto(sock, &query, sizeof(kismet_remote_load_query), 0, 
+                    res->ai_addr, res->ai_addrlen) > 0)
+            pending++;
+
+        freeaddrinfo(res);
+    }
+
+    gettimeofday(&deadline, NULL);
+    deadline.tv_sec += in_timeout_ms / 1000;
+    deadline.tv_usec += (in_timeout_ms % 1000) * 1000;
+    if (deadline.tv_usec >= 1000000) {
+        deadline.tv_sec++;
+        deadline.tv_usec -= 1000000;
+    }
+
+    while (pending > 0) {
+        gettimeofday(&now, NULL);
+
+        if (!timercmp(&now, &deadline, <))
+            break;
+
+        timersub(&deadline, &now, &tm);
+
+        FD_ZERO(&rset);
+        FD_SET(sock, &rset);
+
+        if (select(sock + 1, &rset, NULL, NULL, &tm) <= 0)
+            break;
+
+        if ((r = recv(sock, &report, sizeof(kismet_remote_load_report), 0)) < 
+                (ssize_t) sizeof(kismet_remote_load_report))
+            continue;
+
+        if (be64toh(report.tag) != REMOTE_LOAD_TAG ||
+                be16toh(report.load_version) != REMOTE_LOAD_VERSION)
+            continue;
+
+        nonce = be32toh(report.nonce) - nonce_base;
+
+        if (nonce >= caph->num_remote_servers || in_loads[nonce] >= 0)
+            continue;
+
+        backlog = be32toh(report.packet_backlog);
+        limit = be32toh(report.packet_backlog_limit);
+        cpus = be16toh(report.num_cpus);
+
+        load = 0;
+
+        if (limit > 0)
+            load = (int) (((uint64_t) backlog * 1000) / limit);
+
+        cpu = (int) (be32toh(report.cpu_permille) / (cpus > 0 ? cpus : 1));
+
+        if (cpu > load)
+            load = cpu;
+
+        if (load > 1000)
+            load = 1000;
+
+        in_loads[nonce] = load;
+        in_sources[nonce] = be32toh(report.num_sources);
+
+        pending--;
+    }
+
+    close(sock);
+}
+
+/* Pick the remote server to connect to:  the server reporting the lowest load, with
+ * servers of similar load ordered by how many sources they already have.  When no
+ * server answers, the next server in the list after a failure.  in_failed penalizes
+ * the current server, which the last connection failed to. */
+static void cf_int_select_remote_server(kis_capture_handler_t *caph, int in_failed) {
+    int *loads;
+    unsigned int *sources;
+    size_t i;
+    size_t best = caph->num_remote_servers;
+    int best_load = 0, load;
+
+    if (caph->num_remote_servers < 2)
+        return;
+
+    loads = (int *) malloc(sizeof(int) * caph->num_remote_servers);
+    sources = (unsigned int *) malloc(sizeof(unsigned int) * caph->num_remote_servers);
+
+    if (loads == NULL || sources == NULL) {
+        free(loads);
+        free(sources);
+        return;
+    }
+
+    cf_int_query_server_loads(caph, loads, sources, 500);
+
+    for (i = 0; i < caph->num_remote_servers; i++) {
+        if (loads[i] < 0)
+            continue;
+
+        /* Compare load in 5% steps, so a few more sources decide between near equals */
+        load = (loads[i] / 50) * 100000 + (sources[i] < 99999 ? sources[i] : 99999);
+
+        if (in_failed && i == caph->remote_server_idx)
+            load += 100000000;
+
+        if (best == caph->num_remote_servers || load < best_load) {
+            best = i;
+            best_load = load;
+        }
+    }
+
+    if (best == caph->num_remote_servers) {
+        if (in_failed)
+            best = (caph->remote_server_idx + 1) % caph->num_remote_servers;
+        else
+            best = caph->remote_server_idx;
+    }
+
+    if (best != caph->remote_server_idx || caph->remote_host == NULL) {
+        if (loads[best] >= 0)
+            fprintf(stderr, "INFO: Selected Kismet server %s:%u, load %d.%d%%\n",
+                    caph->remote_servers[best], caph->remote_server_ports[best],
+                    loads[best] / 10, loads[best] % 10);
+        else
+            fprintf(stderr, "INFO: Selected Kismet server %s:%u\n",
+                    caph->remote_servers[best], caph->remote_server_ports[best]);
+    }
+
+    caph->remote_server_idx = best;
+
+    if (caph->remote_host != NULL)
+        free(caph->remote_host);
+
+    caph->remote_host = strdup(caph->remote_servers[best]);
+    caph->remote_port = caph->remote_server_ports[best];
+
+    free(loads);
+    free(sources);
+}
+
+/* Called from the capture loop; every balance interval, check the load of every server
+ * and decide to leave a saturated server when another has room.  Returns 1 when the
+ * capture should spin down and migrate. */
+static int cf_int_check_rebalance(kis_capture_handler_t *caph) {
+    int *loads;
+    unsigned int *sources;
+    size_t i;
+    int best = -1;
+    int cur;
+    int migrate = 0;
+    time_t now = time(NULL);
+
+    if (caph->remote_migrating == NULL || caph->num_remote_servers < 2 ||
+            caph->remote_balance_interval == 0)
+        return 0;
+
+    if (caph->remote_last_balance == 0) {
+        caph->remote_last_balance = now;
+        return 0;
+    }
+
+    if (now - caph->remote_last_balance < (time_t) caph->remote_balance_interval)
+        return 0;
+
+    caph->remote_last_balance = now;
+
+    loads = (int *) malloc(sizeof(int) * caph->num_remote_servers);
+    sources = (unsigned int *) malloc(sizeof(unsigned int) * caph->num_remote_servers);
+
+    if (loads == NULL || sources == NULL) {
+        free(loads);
+        free(sources);
+        return 0;
+    }
+
+    /* Keep the query short, it holds up the capture loop */
+    cf_int_query_server_loads(caph, loads, sources, 250);
+
+    cur = loads[caph->remote_server_idx];
+
+    for (i = 0; i < caph->num_remote_servers; i++) {
+        if (i == caph->remote_server_idx || loads[i] < 0)
+            continue;
+
+        if (best < 0 || loads[i] < loads[best])
+            best = (int) i;
+    }
+
+    /* Only leave a saturated server for one with clear headroom, so sources don't
+     * bounce between servers of similar load */
+    if (cur >= 750 && best >= 0 && loads[best] <= 500 && cur - loads[best] >= 250) {
+        fprintf(stderr, "INFO: Kismet server %s:%u is saturated (load %d.%d%%); migrating "
+                "to %s:%u (load %d.%d%%)\n",
+                caph->remote_host, caph->remote_port, cur / 10, cur % 10,
+                caph->remote_servers[best], caph->remote_server_ports[best],
+                loads[best] / 10, loads[best] % 10);
+        migrate = 1;
+    }
+
+    free(loads);
+    free(sources);
+
+    return migrate;
+}
+
 int cf_handler_parse_opts(kis_capture_handler_t *caph, int argc, char *argv[]) {
     int option_idx;
 
@@ -794,11 +1291,13 @@ int cf_handler_parse_opts(kis_capture_handler_t *caph, int argc, char *argv[]) {
         { "apikey", required_argument, 0, 16},
         { "endpoint", required_argument, 0, 17},
         { "ssl-certificate", required_argument, 0, 18},
+        { "balance-interval", required_argument, 0, 19},
         { "help", no_argument, 0, 'h'},
         { 0, 0, 0, 0 }
     };
 
     char *gps_arg = NULL;
+    char **extra_defs;
     int pr;
 #ifdef HAVE_LIBWEBSOCKETS
     char *user = NULL, *password = NULL, *token = NULL, *endp_arg = NULL;
@@ -832,16 +1331,28 @@ int cf_handler_parse_opts(kis_capture_handler_t *caph, int argc, char *argv[]) {
             }
             caph->use_ipc = 1;
         } else if (r == 3) {
-            if (sscanf(optarg, "%512[^:]:%u", parse_hname, &parse_port) != 2) {
-                fprintf(stderr, "FATAL: Expected host:port for --connect\n");
+            if (cf_int_parse_remote_servers(caph, optarg) < 0) {
+                fprintf(stderr, "FATAL: Expected host:port, or a comma-separated list of "
+                        "host:port servers, for --connect\n");
                 ret = -1;
                 goto cleanup;
             }
-
-            caph->remote_host = strdup(parse_hname);
-            caph->remote_port = parse_port;
         } else if (r == 4) {
-            caph->cli_sourcedef = strdup(optarg);
+            if (caph->cli_sourcedef == NULL) {
+                caph->cli_sourcedef = strdup(optarg);
+            } else {
+                extra_defs = (char **) realloc(caph->extra_sourcedefs, 
+                        sizeof(char *) * (caph->num_extra_sourcedefs + 1));
+
+                if (extra_defs == NULL) {
+                    fprintf(stderr, "FATAL: Unable to allocate source list\n");
+                    ret = -1;
+                    goto cleanup;
+                }
+
+                caph->extra_sourcedefs = extra_defs;
+                caph->extra_sourcedefs[caph->num_extra_sourcedefs++] = strdup(optarg);
+            }
         } else if (r == 5) {
             fprintf(stderr, "INFO: Disabling automatic reconnection to remote servers\n");
             retry = 0;
@@ -925,6 +1436,12 @@ int cf_handler_parse_opts(kis_capture_handler_t *caph, int argc, char *argv[]) {
             return -1;
             goto cleanup;
 #endif
+        } else if (r == 19) {
+            if (sscanf(optarg, "%u", &(caph->remote_balance_interval)) != 1) {
+                fprintf(stderr, "FATAL: Expected a number of seconds for --balance-interval\n");
+                ret = -1;
+                goto cleanup;
+            }
         } 
     }
 
@@ -1000,6 +1517,12 @@ int cf_handler_parse_opts(kis_capture_handler_t *caph, int argc, char *argv[]) {
             return -1;
         }
 
+        if (caph->num_extra_sourcedefs != 0 && caph->newhandler_cb == NULL) {
+            fprintf(stderr, "FATAL: This capture driver supports only one --source per process\n");
+            ret = -1;
+            goto cleanup;
+        }
+
         /* Set retry only when we have a remote host */
         caph->remote_retry = retry;
 
@@ -1065,133 +1588,907 @@ cleanup:
         free(endp_arg);
 #endif
 
-    return ret;
+    return ret;
+
+}
+
+void cf_print_help(kis_capture_handler_t *caph, const char *argv0) {
+    fprintf(stderr, "%s is a capture driver for Kismet.  Typically it is started\n"
+            "automatically by the Kismet server.\n", argv0);
+    
+    if (caph->remote_capable) {
+        fprintf(stderr, "\n%s supports sending data to a remote Kismet server\n"
+                "usage: %s [options]\n"
+                " --connect [host]:[port]      Connect to remote Kismet server on [host] and [port]; by\n"
+                "                               default this now uses the new websockets interface built\n"
+                "                               into the Kismet webserver on port 2501; to connect using\n"
+                "                               the legacy remote capture protocol, specify the '--tcp'\n"
+                "                               option and the appropriate port, by default port 3501.\n"
+                "                               A comma-separated list of servers may be given; the\n"
+                "                               capture connects to the server reporting the lowest load,\n"
+                "                               fails over to the next server, and migrates away from a\n"
+                "                               saturated server.  Load is only reported by the legacy\n"
+                "                               remote capture port, so balancing needs '--tcp'.\n"
+                " --balance-interval [seconds] With several servers, how often to check the load of\n"
+                "                               every server while connected; 0 never migrates.  The\n"
+                "                               default is 60 seconds.\n"
+                " --tcp                        Use the legacy TCP remote capture protocol, when combined\n"
+                "                               with the --connect option.  The modern protocol uses \n"
+                "                               websockets built into the Kismet server and does not\n"
+                "                               need this option.\n"
+                " --ssl                        Use SSL to connect to a websocket-enabled Kismet server\n"
+                " --ssl-certificate [certfile] Use SSL to connect to a websocket-enabled Kismet server\n"
+                "                               and use the provided certificate authority certificate\n"
+                "                               to validate the server.\n"
+                " --user [username]            Kismet username for a websockets-based remote capture\n"
+                "                               source.  A username and password, or an API key, are\n"
+                "                               required for websockets mode.  A username and password\n"
+                "                               are ONLY used in websockets mode.\n"
+                " --password [password]        Kismet password for a websockets-based remote capture source.\n"
+                "                               A username and password, or an API key, are required for\n"
+                "                               websocket mode.  A username and password are ONLY used in\n"
+                "                               websockets mode.\n"
+                " --apikey [api key]           A Kismet API key for the 'datasource' role; this may be\n"
+                "                               supplied instead of a username and password for websockets\n"
+                "                               based remote capture.  An API key is ONLY used in websockets\n"
+                "                               mode.\n"
+                " --endpoint [endpoint]        An alternate endpoint for the websockets connection.  By\n"
+                "                               default remote datasources are terminated at\n"
+                "                                 /datasource/remote/remotesource.ws\n"
+                "                               This should typically only be changed when using a HTTP proxy\n"
+                "                               homing the Kismet service under a directory.  Endpoints \n"
+                "                               should include the full path to the websocket endpoint, for\n"
+                "                               example:\n"
+                "                                 --endpoint=/kismet/proxy/datasource/remote/remotesource.ws\n"
+                " --source [source def]        Specify a source to send to the remote \n"
+                "                              Kismet server; only used in conjunction with remote capture.\n"
+                "                               Capture drivers which support it accept multiple --source\n"
+                "                               options, and capture from all of them in one process.\n"
+                " --disable-retry              Do not attempt to reconnect to a remote server if there is an\n"
+                "                               error; exit immediately.  By default a remote capture will\n"
+                "                               attempt to reconnect indefinitely if the server is not\n"
+                "                               available.\n"
+                " --fixed-gps [lat,lon,alt]    Set a fixed location for this capture (remote only),\n"
+                "                               accepts lat,lon,alt or lat,lon\n"
+                " --gps-name [name]            Set an alternate GPS name for this source\n"
+                " --daemonize                  Background the capture tool and enter daemon mode.\n"
+                " --list                       List supported devices detected\n"
+				" --autodetect [uuid:optional] Look for a Kismet server in announcement mode, optionally \n"
+				"                              waiting for a specific server UUID to be seen.  Requires \n"
+				"                              a Kismet server configured for announcement mode.\n",
+                argv0, argv0);
+    }
+
+}
+
+
+void cf_handler_set_listdevices_cb(kis_capture_handler_t *capf, 
+        cf_callback_listdevices cb) {
+    pthread_mutex_lock(&(capf->handler_lock));
+    capf->listdevices_cb = cb;
+    pthread_mutex_unlock(&(capf->handler_lock));
+}
+
+void cf_handler_set_probe_cb(kis_capture_handler_t *capf, cf_callback_probe cb) {
+    pthread_mutex_lock(&(capf->handler_lock));
+    capf->probe_cb = cb;
+    pthread_mutex_unlock(&(capf->handler_lock));
+}
+
+void cf_handler_set_open_cb(kis_capture_handler_t *capf, 
+        cf_callback_open cb) {
+    pthread_mutex_lock(&(capf->handler_lock));
+    capf->open_cb = cb;
+    pthread_mutex_unlock(&(capf->handler_lock));
+}
+
+void cf_handler_set_newhandler_cb(kis_capture_handler_t *capf, cf_callback_newhandler cb) {
+    pthread_mutex_lock(&(capf->handler_lock));
+    capf->newhandler_cb = cb;
+    pthread_mutex_unlock(&(capf->handler_lock));
+}
+
+void cf_handler_set_userdata(kis_capture_handler_t *capf, void *userdata) {
+    pthread_mutex_lock(&(capf->handler_lock));
+    capf->userdata = userdata;
+    pthread_mutex_unlock(&(capf->handler_lock));
+}
+
+void cf_handler_set_capture_cb(kis_capture_handler_t *capf, cf_callback_capture cb) {
+    pthread_mutex_lock(&(capf->handler_lock));
+    capf->capture_cb = cb;
+    pthread_mutex_unlock(&(capf->handler_lock));
+}
+
+void cf_handler_set_spectrumconfig_cb(kis_capture_handler_t *capf, 
+        cf_callback_spectrumconfig cb) {
+    pthread_mutex_lock(&(capf->handler_lock));
+    capf->spectrumconfig_cb = cb;
+    pthread_mutex_unlock(&(capf->handler_lock));
+}
+
+void cf_handler_set_unknown_cb(kis_capture_handler_t *capf, cf_callback_unknown cb) {
+    pthread_mutex_lock(&(capf->handler_lock));
+    capf->unknown_cb = cb;
+    pthread_mutex_unlock(&(capf->handler_lock));
+}
+
+void cf_handler_set_chantranslate_cb(kis_capture_handler_t *capf, 
+        cf_callback_chantranslate cb) {
+    pthread_mutex_lock(&(capf->handler_lock));
+    capf->chantranslate_cb = cb;
+    pthread_mutex_unlock(&(capf->handler_lock));
+}
+
+void cf_handler_set_chancontrol_cb(kis_capture_handler_t *capf,
+        cf_callback_chancontrol cb) {
+    pthread_mutex_lock(&(capf->handler_lock));
+    capf->chancontrol_cb = cb; 
+    pthread_mutex_unlock(&(capf->handler_lock));
+}
+
+void cf_handler_set_chanfree_cb(kis_capture_handler_t *capf, cf_callback_chanfree cb) {
+    pthread_mutex_lock(&(capf->handler_lock));
+    capf->chanfree_cb = cb;
+    pthread_mutex_unlock(&(capf->handler_lock));
+}
+
+#ifdef SYS_LINUX
+/* The ring is shared with the server, so these are not private futexes */
+static void cf_int_futex_wait(uint32_t *addr, uint32_t val, long timeout_usec) {
+    struct timespec ts;
+    ts.tv_sec = timeout_usec / 1000000;
+    ts.tv_nsec = (timeout_usec % 1000000) * 1000;
+
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static void cf_int_futex_wake(uint32_t *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+#endif
+
+/* Map the shared memory ring the server offered in our environment, if any
+ *
+ * Returns:
+ *  0   No ring offered, or the ring could not be used
+ *  1   Ring attached
+ */
+static int cf_int_attach_shm(kis_capture_handler_t *caph) {
+#ifdef SYS_LINUX
+    const char *env = getenv(KIS_EXTERNAL_SHM_ENV);
+    kismet_external_shm_ring_t *hdr;
+    size_t map_sz;
+    int fd;
+
+    if (env == NULL || sscanf(env, "%d", &fd) != 1)
+        return 0;
+
+    /* Don't hand it to anything we launch */
+    unsetenv(KIS_EXTERNAL_SHM_ENV);
+
+    hdr = (kismet_external_shm_ring_t *) mmap(NULL, KIS_EXTERNAL_SHM_DATA_OFFSET, 
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (hdr == MAP_FAILED) {
+        close(fd);
+        return 0;
+    }
+
+    if (__atomic_load_n(&hdr->signature, __ATOMIC_ACQUIRE) != KIS_EXTERNAL_SHM_SIG ||
+            hdr->version != KIS_EXTERNAL_SHM_VERSION || hdr->ring_sz == 0 ||
+            (hdr->ring_sz & (hdr->ring_sz - 1)) != 0) {
+        munmap(hdr, KIS_EXTERNAL_SHM_DATA_OFFSET);
+        close(fd);
+        return 0;
+    }
+
+    map_sz = KIS_EXTERNAL_SHM_DATA_OFFSET + hdr->ring_sz;
+
+    munmap(hdr, KIS_EXTERNAL_SHM_DATA_OFFSET);
+
+    hdr = (kismet_external_shm_ring_t *) mmap(NULL, map_sz, 
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if (hdr == MAP_FAILED)
+        return 0;
+
+    caph->shm_ring = hdr;
+    caph->shm_data = (uint8_t *) hdr + KIS_EXTERNAL_SHM_DATA_OFFSET;
+    caph->shm_map_sz = map_sz;
+    caph->shm_reserve_head = hdr->head;
+
+    __atomic_store_n(&hdr->producer_attached, 1, __ATOMIC_RELEASE);
+
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/* Wake the IO loop if it is asleep waiting for data in out_ringbuf; called by writers
+ * after publishing data */
+static void cf_int_out_wake_reader(kis_capture_handler_t *caph) {
+#ifdef SYS_LINUX
+    uint64_t one = 1;
+
+    if (caph->out_data_efd < 0)
+        return;
+
+    /* Order the publish before looking at the flag, pairing with the fence in the IO 
+     * loop, so either it sees the data or we see it waiting */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&caph->out_reader_waiting, __ATOMIC_RELAXED) &&
+            __atomic_exchange_n(&caph->out_reader_waiting, 0, __ATOMIC_SEQ_CST)) {
+        if (write(caph->out_data_efd, &one, sizeof(one)) < 0) {
+            /* The counter can't overflow from single wakes; nothing to do */
+        }
+    }
+#endif
+}
+
+/* Wake a writer waiting in cf_handler_wait_ringbuffer; called by the IO loop after 
+ * consuming data */
+static void cf_int_out_wake_writer(kis_capture_handler_t *caph) {
+#ifdef SYS_LINUX
+    uint64_t one = 1;
+
+    if (caph->out_space_efd >= 0) {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(&caph->out_writer_waiting, __ATOMIC_RELAXED) &&
+                __atomic_exchange_n(&caph->out_writer_waiting, 0, __ATOMIC_SEQ_CST)) {
+            if (write(caph->out_space_efd, &one, sizeof(one)) < 0) {
+                /* Nothing to do */
+            }
+        }
+
+        return;
+    }
+#endif
+
+    pthread_cond_broadcast(&(caph->out_ringbuf_flush_cond));
+}
+
+/* Reserve space for an outbound frame, in the shared memory ring if we have one or 
+ * in the output ringbuffer; must be called with out_ringbuf_lock held.  Returns the 
+ * size reserved, which is less than the requested size if there is no room. */
+static size_t cf_int_out_reserve(kis_capture_handler_t *caph, void **buf, size_t sz) {
+    kismet_external_shm_ring_t *hdr = caph->shm_ring;
+    uint64_t head, tail, offt, pad = 0;
+    size_t asz;
+
+    if (hdr == NULL)
+        return kis_simple_ringbuf_reserve(caph->out_ringbuf, buf, sz);
+
+    asz = (sz + KIS_EXTERNAL_SHM_ALIGN - 1) & ~((size_t) KIS_EXTERNAL_SHM_ALIGN - 1);
+
+    head = hdr->head;
+    tail = __atomic_load_n(&hdr->tail, __ATOMIC_ACQUIRE);
+    offt = head & (hdr->ring_sz - 1);
+
+    /* Frames never wrap; pad out the end of the ring if this one won't fit */
+    if (offt + asz > hdr->ring_sz)
+        pad = hdr->ring_sz - offt;
+
+    if (asz + pad > hdr->ring_sz - (head - tail))
+        return 0;
+
+    if (pad) {
+        *((uint32_t *) (caph->shm_data + offt)) = 0;
+        head += pad;
+        offt = 0;
+    }
+
+    caph->shm_reserve_head = head;
+    *buf = caph->shm_data + offt;
+
+    return sz;
+}
+
+/* Publish a frame reserved by cf_int_out_reserve; sz may be smaller than the size 
+ * reserved.  Must be called with out_ringbuf_lock held */
+static void cf_int_out_commit(kis_capture_handler_t *caph, void *buf, size_t sz) {
+    kismet_external_shm_ring_t *hdr = caph->shm_ring;
+    size_t asz;
+
+    if (hdr == NULL) {
+        kis_simple_ringbuf_commit(caph->out_ringbuf, buf, sz);
+        cf_int_out_wake_reader(caph);
+        return;
+    }
+
+    asz = (sz + KIS_EXTERNAL_SHM_ALIGN - 1) & ~((size_t) KIS_EXTERNAL_SHM_ALIGN - 1);
+
+    __atomic_store_n(&hdr->head, caph->shm_reserve_head + asz, __ATOMIC_SEQ_CST);
+
+#ifdef SYS_LINUX
+    /* Only make the wake call when the server is actually asleep */
+    if (__atomic_load_n(&hdr->consumer_waiting, __ATOMIC_SEQ_CST) &&
+            __atomic_exchange_n(&hdr->consumer_waiting, 0, __ATOMIC_SEQ_CST))
+        cf_int_futex_wake(&hdr->consumer_waiting);
+#endif
+}
+
+/* Give back a reservation from cf_int_out_reserve without sending anything; must be 
+ * called with out_ringbuf_lock held */
+static void cf_int_out_release(kis_capture_handler_t *caph, void *buf) {
+    if (caph->shm_ring == NULL)
+        kis_simple_ringbuf_reserve_free(caph->out_ringbuf, buf);
+}
+
+/* Size of an outbound frame header; v3 headers are used once the server has offered
+ * the command table */
+static size_t cf_int_frame_header_sz(int use_v3) {
+    if (use_v3)
+        return sizeof(kismet_external_frame_v3_t);
+
+    return sizeof(kismet_external_frame_v2_t);
+}
+
+/* Fill in an outbound frame header and return the start of the payload */
+static uint8_t *cf_int_frame_header(uint8_t *buf, int use_v3, const char *command, 
+        uint32_t command_id, uint32_t seqno, size_t data_sz) {
+    kismet_external_frame_v2_t *frame_v2;
+    kismet_external_frame_v3_t *frame_v3;
+
+    if (use_v3) {
+        frame_v3 = (kismet_external_frame_v3_t *) buf;
+
+        frame_v3->signature = htonl(KIS_EXTERNAL_PROTO_SIG);
+        frame_v3->v2_sentinel = htons(KIS_EXTERNAL_V2_SIG);
+        frame_v3->frame_version = htons(3);
+        frame_v3->data_sz = htonl(data_sz);
+        frame_v3->command_id = htonl(command_id);
+        frame_v3->seqno = htonl(seqno);
+
+        return frame_v3->data;
+    }
+
+    frame_v2 = (kismet_external_frame_v2_t *) buf;
+
+    frame_v2->signature = htonl(KIS_EXTERNAL_PROTO_SIG);
+    frame_v2->data_sz = htonl(data_sz);
+
+    frame_v2->v2_sentinel = htons(KIS_EXTERNAL_V2_SIG);
+    frame_v2->frame_version = htons(2);
+
+    frame_v2->seqno = htonl(seqno);
+
+    strncpy(frame_v2->command, command, 32);
+
+    return frame_v2->data;
+}
+
+/* Is there anything in the shared memory ring the server hasn't consumed yet */
+static int cf_int_shm_pending(kis_capture_handler_t *caph) {
+    if (caph->shm_ring == NULL)
+        return 0;
+
+    return __atomic_load_n(&caph->shm_ring->tail, __ATOMIC_ACQUIRE) != 
+        __atomic_load_n(&caph->shm_ring->head, __ATOMIC_ACQUIRE);
+}
+
+/* Set the flush deadline of the current batch; must be called with batch_lock held */
+static void cf_int_batch_set_deadline(kis_capture_handler_t *caph) {
+    clock_gettime(CLOCK_REALTIME, &(caph->batch_deadline));
+
+    caph->batch_deadline.tv_nsec += (long) caph->batch_flush_usec * 1000;
+
+    while (caph->batch_deadline.tv_nsec >= 1000000000L) {
+        caph->batch_deadline.tv_sec++;
+        caph->batch_deadline.tv_nsec -= 1000000000L;
+    }
+}
+
+/* Compress the pending batch directly into the output buffer as a KDSDATABATCHZ 
+ * frame; must be called with batch_lock held.  Space for the worst case is reserved
+ * before anything is compressed, so the stream only advances when the frame is sent.
+ *
+ * Returns:
+ *  0   Insufficient space in buffer
+ *  1   Success
+ */
+static int cf_int_flush_batch_z_locked(kis_capture_handler_t *caph) {
+    kismet_external_batch_z_t *zhdr;
+    uint8_t *send_buffer;
+    size_t rs_sz, hdr_sz, z_max, z_len;
+    int use_v3 = caph->use_v3;
+    int r;
+
+    hdr_sz = cf_int_frame_header_sz(use_v3) + sizeof(kismet_external_batch_z_t);
+
+    /* Leave room for the sync flush marker */
+    z_max = deflateBound(&(caph->batch_zstrm), caph->batch_len) + 16;
+
+    if (z_max > KIS_EXTERNAL_BATCH_Z_MAX_SZ - sizeof(kismet_external_batch_z_t))
+        z_max = KIS_EXTERNAL_BATCH_Z_MAX_SZ - sizeof(kismet_external_batch_z_t);
+
+    pthread_mutex_lock(&(caph->out_ringbuf_lock));
+
+    rs_sz = cf_int_out_reserve(caph, (void **) &send_buffer, z_max + hdr_sz);
+
+    if (rs_sz != z_max + hdr_sz) {
+        pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+        return 0;
+    }
+
+    zhdr = (kismet_external_batch_z_t *) (send_buffer + cf_int_frame_header_sz(use_v3));
+    zhdr->flags = htons(caph->batch_z_reset ? KIS_EXTERNAL_BATCH_Z_RESET : 0);
+
+    caph->batch_zstrm.next_in = caph->batch_buf;
+    caph->batch_zstrm.avail_in = caph->batch_len;
+    caph->batch_zstrm.next_out = zhdr->data;
+    caph->batch_zstrm.avail_out = z_max;
+
+    r = deflate(&(caph->batch_zstrm), Z_SYNC_FLUSH);
+
+    if (r != Z_OK || caph->batch_zstrm.avail_in != 0) {
+        /* The stream is now in an unknown state; drop this batch and start over */
+        cf_int_out_release(caph, send_buffer);
+        pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+
+        deflateReset(&(caph->batch_zstrm));
+        caph->batch_z_reset = 1;
+
+        return 1;
+    }
+
+    z_len = z_max - caph->batch_zstrm.avail_out;
+
+    cf_int_frame_header(send_buffer, use_v3, KIS_EXTERNAL_BATCH_Z_CMD, 
+            KIS_EXTERNAL_CMD_DATABATCHZ, 0, sizeof(kismet_external_batch_z_t) + z_len);
+
+    cf_int_out_commit(caph, send_buffer, hdr_sz + z_len);
+
+    pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+
+    caph->batch_z_reset = 0;
+
+    return 1;
+}
+
+/* Send the pending batch to the server as a single datagram; must be called with 
+ * batch_lock held.  Datagrams are lossy by design: one the socket can't take now is 
+ * dropped, and the server sees the gap in the sequence. */
+static void cf_int_send_batch_datagram_locked(kis_capture_handler_t *caph) {
+    kismet_remote_datagram *dgram = (kismet_remote_datagram *) caph->dgram_buf;
+    size_t hdr_sz = sizeof(kismet_remote_datagram) + cf_int_frame_header_sz(caph->use_v3);
+
+    if (hdr_sz + caph->batch_len > caph->dgram_max_bytes)
+        return;
+
+    dgram->tag = htobe64(REMOTE_DATAGRAM_TAG);
+    dgram->datagram_version = htons(REMOTE_DATAGRAM_VERSION);
+    dgram->reserved = 0;
+    dgram->seqno = htonl(caph->dgram_seqno++);
+    dgram->token = htobe64(caph->dgram_token);
+
+    memcpy(cf_int_frame_header(dgram->data, caph->use_v3, KIS_EXTERNAL_BATCH_CMD,
+                KIS_EXTERNAL_CMD_DATABATCH, 0, caph->batch_len),
+            caph->batch_buf, caph->batch_len);
+
+    send(caph->dgram_fd, caph->dgram_buf, hdr_sz + caph->batch_len, MSG_DONTWAIT);
+}
+
+/* Write the pending batch to the output ringbuffer as a single KDSDATABATCH frame, or
+ * a KDSDATABATCHZ frame if compression was negotiated; must be called with batch_lock 
+ * held.
+ *
+ * Returns:
+ *  0   Insufficient space in buffer
+ *  1   Success, or nothing to send
+ */
+static int cf_int_flush_batch_locked(kis_capture_handler_t *caph) {
+    kismet_external_batch_t *batch;
+    uint8_t *send_buffer;
+    size_t rs_sz, hdr_sz;
+    int use_v3 = caph->use_v3;
+
+    if (caph->batch_count == 0)
+        return 1;
+
+    batch = (kismet_external_batch_t *) caph->batch_buf;
+    batch->version = htons(KIS_EXTERNAL_BATCH_VERSION);
+    batch->num_packets = htons(caph->batch_count);
+
+    if (caph->dgram_fd >= 0) {
+        cf_int_send_batch_datagram_locked(caph);
+
+        caph->batch_len = sizeof(kismet_external_batch_t);
+        caph->batch_count = 0;
+
+        return 1;
+    }
+
+    if (caph->batch_z_enabled) {
+        if (cf_int_flush_batch_z_locked(caph) == 0)
+            return 0;
+
+        caph->batch_len = sizeof(kismet_external_batch_t);
+        caph->batch_count = 0;
+
+        return 1;
+    }
+
+    hdr_sz = cf_int_frame_header_sz(use_v3);
+
+    pthread_mutex_lock(&(caph->out_ringbuf_lock));
+
+    rs_sz = cf_int_out_reserve(caph, (void **) &send_buffer, caph->batch_len + hdr_sz);
+
+    if (rs_sz != caph->batch_len + hdr_sz) {
+        pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+        return 0;
+    }
+
+    /* Data frames are never acknowledged, so batches don't take a sequence number; this
+     * also keeps the handler lock out of the batch path */
+    memcpy(cf_int_frame_header(send_buffer, use_v3, KIS_EXTERNAL_BATCH_CMD, 
+                KIS_EXTERNAL_CMD_DATABATCH, 0, caph->batch_len),
+            caph->batch_buf, caph->batch_len);
+
+    cf_int_out_commit(caph, send_buffer, rs_sz);
+
+    pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+
+    caph->batch_len = sizeof(kismet_external_batch_t);
+    caph->batch_count = 0;
+
+    return 1;
+}
+
+int cf_flush_batch(kis_capture_handler_t *caph) {
+    int r;
+
+    pthread_mutex_lock(&(caph->batch_lock));
+    r = cf_int_flush_batch_locked(caph);
+    pthread_mutex_unlock(&(caph->batch_lock));
+
+    return r;
+}
+
+/* Flush partial batches once they've been held for batch_flush_usec */
+void *cf_int_batch_thread(void *arg) {
+    kis_capture_handler_t *caph = (kis_capture_handler_t *) arg;
+    struct timespec now;
+
+    pthread_mutex_lock(&(caph->batch_lock));
+
+    while (!caph->batch_shutdown) {
+        if (caph->batch_count == 0) {
+            pthread_cond_wait(&(caph->batch_cond), &(caph->batch_lock));
+            continue;
+        }
+
+        if (pthread_cond_timedwait(&(caph->batch_cond), &(caph->batch_lock), 
+                    &(caph->batch_deadline)) != ETIMEDOUT)
+            continue;
+
+        /* The batch may have been flushed and restarted while we waited */
+        clock_gettime(CLOCK_REALTIME, &now);
+
+        if (caph->batch_count == 0 || now.tv_sec < caph->batch_deadline.tv_sec ||
+                (now.tv_sec == caph->batch_deadline.tv_sec && 
+                 now.tv_nsec < caph->batch_deadline.tv_nsec))
+            continue;
+
+        /* If the output buffer is full, try again after another interval; the sender
+         * will flush it first if the batch fills */
+        if (cf_int_flush_batch_locked(caph) == 0)
+            cf_int_batch_set_deadline(caph);
+    }
+
+    pthread_mutex_unlock(&(caph->batch_lock));
+
+    return NULL;
+}
+
+/* Configure batching and compression from the server KDSOPENSOURCE offer; a max_bytes
+ * of 0 disables batching.  Any pending batch is sent first, and a new compressed stream
+ * is always started. */
+static int cf_int_configure_batch(kis_capture_handler_t *caph, size_t max_bytes, 
+        unsigned int flush_usec, unsigned int compression, int compression_level) {
+    uint8_t *buf;
+
+    if (max_bytes > KIS_EXTERNAL_BATCH_MAX_SZ)
+        max_bytes = KIS_EXTERNAL_BATCH_MAX_SZ;
+
+    /* Too small to hold anything, don't bother */
+    if (max_bytes < sizeof(kismet_external_batch_t) + sizeof(kismet_external_batch_record_t))
+        max_bytes = 0;
+
+    pthread_mutex_lock(&(caph->batch_lock));
+
+    cf_int_flush_batch_locked(caph);
+
+    caph->batch_max_bytes = 0;
+    caph->batch_len = sizeof(kismet_external_batch_t);
+    caph->batch_count = 0;
+    caph->batch_z_enabled = 0;
+
+    if (max_bytes == 0) {
+        pthread_mutex_unlock(&(caph->batch_lock));
+        return 1;
+    }
+
+    buf = (uint8_t *) realloc(caph->batch_buf, max_bytes);
+
+    if (buf == NULL) {
+        pthread_mutex_unlock(&(caph->batch_lock));
+        return -1;
+    }
+
+    caph->batch_buf = buf;
+
+    if (!caph->batch_running) {
+        if (pthread_create(&(caph->batchthread), NULL, cf_int_batch_thread, caph) != 0) {
+            pthread_mutex_unlock(&(caph->batch_lock));
+            return -1;
+        }
+
+        caph->batch_running = 1;
+    }
+
+    caph->batch_max_bytes = max_bytes;
+    caph->batch_flush_usec = flush_usec;
+
+    if (compression == KIS_EXTERNAL_COMPRESSION_DEFLATE) {
+        if (caph->batch_z_init) {
+            deflateEnd(&(caph->batch_zstrm));
+            caph->batch_z_init = 0;
+        }
+
+        memset(&(caph->batch_zstrm), 0, sizeof(z_stream));
+
+        /* Raw deflate with the full window, so earlier batches act as the dictionary
+         * for later ones */
+        if (deflateInit2(&(caph->batch_zstrm), compression_level, Z_DEFLATED, -MAX_WBITS,
+                    8, Z_DEFAULT_STRATEGY) == Z_OK) {
+            caph->batch_z_init = 1;
+            caph->batch_z_enabled = 1;
+            caph->batch_z_reset = 1;
+        }
+    }
+
+    pthread_mutex_unlock(&(caph->batch_lock));
+
+    return 1;
+}
+
+/* Configure datagram transport from the server KDSOPENSOURCE offer; a token of 0 closes
+ * it.  The datagram socket is connected to the same server address and port as the TCP
+ * connection.
+ *
+ * Returns:
+ *  -1  Error, batches stay on the connection
+ *  1   Success
+ */
+static int cf_int_configure_datagram(kis_capture_handler_t *caph, uint64_t token,
+        size_t max_bytes) {
+    struct sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
+    uint8_t *buf;
+    int fd;
+    int r = 1;
+
+    pthread_mutex_lock(&(caph->batch_lock));
+
+    if (caph->dgram_fd >= 0) {
+        close(caph->dgram_fd);
+        caph->dgram_fd = -1;
+    }
+
+    caph->dgram_token = 0;
+    caph->dgram_seqno = 0;
+
+    if (token == 0 || caph->tcp_fd < 0 || max_bytes > REMOTE_DATAGRAM_MAX_SZ)
+        goto finish;
+
+    if (getpeername(caph->tcp_fd, (struct sockaddr *) &peer, &peer_len) < 0 ||
+            (fd = socket(peer.ss_family, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+        r = -1;
+        goto finish;
+    }
+
+    if (connect(fd, (struct sockaddr *) &peer, peer_len) < 0) {
+        close(fd);
+        r = -1;
+        goto finish;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    buf = (uint8_t *) realloc(caph->dgram_buf, max_bytes);
+
+    if (buf == NULL) {
+        close(fd);
+        r = -1;
+        goto finish;
+    }
+
+    caph->dgram_buf = buf;
+    caph->dgram_max_bytes = max_bytes;
+    caph->dgram_token = token;
+    caph->dgram_fd = fd;
+
+finish:
+    pthread_mutex_unlock(&(caph->batch_lock));
+
+    return r;
+}
+
+/* Length of the part of an 802.11 frame kept when only data headers are sent: the
+ * MAC header and the following 8 bytes, which hold the LLC/SNAP header or the IV of a
+ * protected frame.  Returns 0 if the whole frame should be sent; management and 
+ * control frames, and EAPOL which is needed for handshakes, are never cut. */
+static size_t cf_int_dot11_data_header_len(const uint8_t *frame, size_t len) {
+    size_t hdr_len = 24;
+
+    if (len < 24)
+        return 0;
+
+    /* Data frames only */
+    if (((frame[0] >> 2) & 0x03) != 2)
+        return 0;
+
+    /* 4-address frames */
+    if ((frame[1] & 0x03) == 0x03)
+        hdr_len += 6;
+
+    /* QoS control, and HT control if the order bit is set */
+    if (frame[0] & 0x80) {
+        hdr_len += 2;
+
+        if (frame[1] & 0x80)
+            hdr_len += 4;
+    }
+
+    hdr_len += 8;
+
+    if (hdr_len >= len)
+        return 0;
+
+    if (!(frame[1] & 0x40) && frame[hdr_len - 2] == 0x88 && frame[hdr_len - 1] == 0x8e)
+        return 0;
 
+    return hdr_len;
 }
 
-void cf_print_help(kis_capture_handler_t *caph, const char *argv0) {
-    fprintf(stderr, "%s is a capture driver for Kismet.  Typically it is started\n"
-            "automatically by the Kismet server.\n", argv0);
-    
-    if (caph->remote_capable) {
-        fprintf(stderr, "\n%s supports sending data to a remote Kismet server\n"
-                "usage: %s [options]\n"
-                " --connect [host]:[port]      Connect to remote Kismet server on [host] and [port]; by\n"
-                "                               default this now uses the new websockets interface built\n"
-                "                               into the Kismet webserver on port 2501; to connect using\n"
-                "                               the legacy remote capture protocol, specify the '--tcp'\n"
-                "                               option and the appropriate port, by default port 3501.\n"
-                " --tcp                        Use the legacy TCP remote capture protocol, when combined\n"
-                "                               with the --connect option.  The modern protocol uses \n"
-                "                               websockets built into the Kismet server and does not\n"
-                "                               need this option.\n"
-                " --ssl                        Use SSL to connect to a websocket-enabled Kismet server\n"
-                " --ssl-certificate [certfile] Use SSL to connect to a websocket-enabled Kismet server\n"
-                "                               and use the provided certificate authority certificate\n"
-                "                               to validate the server.\n"
-                " --user [username]            Kismet username for a websockets-based remote capture\n"
-                "                               source.  A username and password, or an API key, are\n"
-                "                               required for websockets mode.  A username and password\n"
-                "                               are ONLY used in websockets mode.\n"
-                " --password [password]        Kismet password for a websockets-based remote capture source.\n"
-                "                               A username and password, or an API key, are required for\n"
-                "                               websocket mode.  A username and password are ONLY used in\n"
-                "                               websockets mode.\n"
-                " --apikey [api key]           A Kismet API key for the 'datasource' role; this may be\n"
-                "                               supplied instead of a username and password for websockets\n"
-                "                               based remote capture.  An API key is ONLY used in websockets\n"
-                "                               mode.\n"
-                " --endpoint [endpoint]        An alternate endpoint for the websockets connection.  By\n"
-                "                               default remote datasources are terminated at\n"
-                "                                 /datasource/remote/remotesource.ws\n"
-                "                               This should typically only be changed when using a HTTP proxy\n"
-                "                               homing the Kismet service under a directory.  Endpoints \n"
-                "                               should include the full path to the websocket endpoint, for\n"
-                "                               example:\n"
-                "                                 --endpoint=/kismet/proxy/datasource/remote/remotesource.ws\n"
-                " --source [source def]        Specify a source to send to the remote \n"
-                "                              Kismet server; only used in conjunction with remote capture.\n"
-                " --disable-retry              Do not attempt to reconnect to a remote server if there is an\n"
-                "                               error; exit immediately.  By default a remote capture will\n"
-                "                               attempt to reconnect indefinitely if the server is not\n"
-                "                               available.\n"
-                " --fixed-gps [lat,lon,alt]    Set a fixed location for this capture (remote only),\n"
-                "                               accepts lat,lon,alt or lat,lon\n"
-                " --gps-name [name]            Set an alternate GPS name for this source\n"
-                " --daemonize                  Background the capture tool and enter daemon mode.\n"
-                " --list                       List supported devices detected\n"
-				" --autodetect [uuid:optional] Look for a Kismet server in announcement mode, optionally \n"
-				"                              waiting for a specific server UUID to be seen.  Requires \n"
-				"                              a Kismet server configured for announcement mode.\n",
-                argv0, argv0);
+/* Captured length of a packet when only data headers are sent; packets which aren't
+ * 802.11 or radiotap are always sent whole */
+static uint32_t cf_int_data_headers_len(uint32_t dlt, const uint8_t *pack, 
+        uint32_t packet_sz) {
+    size_t rtap_len = 0, hdr_len;
+
+    if (dlt == KDLT_RADIOTAP) {
+        if (packet_sz < 8)
+            return packet_sz;
+
+        rtap_len = pack[2] | (pack[3] << 8);
+
+        if (rtap_len >= packet_sz)
+            return packet_sz;
+    } else if (dlt != KDLT_IEEE802_11) {
+        return packet_sz;
     }
 
-}
+    hdr_len = cf_int_dot11_data_header_len(pack + rtap_len, packet_sz - rtap_len);
 
+    if (hdr_len == 0)
+        return packet_sz;
 
-void cf_handler_set_listdevices_cb(kis_capture_handler_t *capf, 
-        cf_callback_listdevices cb) {
-    pthread_mutex_lock(&(capf->handler_lock));
-    capf->listdevices_cb = cb;
-    pthread_mutex_unlock(&(capf->handler_lock));
+    return rtap_len + hdr_len;
 }
 
-void cf_handler_set_probe_cb(kis_capture_handler_t *capf, cf_callback_probe cb) {
-    pthread_mutex_lock(&(capf->handler_lock));
-    capf->probe_cb = cb;
-    pthread_mutex_unlock(&(capf->handler_lock));
-}
+/* Add a packet to the current batch, if batching is enabled and the packet fits in 
+ * a batch.  original_sz is the length of the packet before it was cut down, or 0.
+ *
+ * Returns:
+ * -1   An error occurred
+ *  0   Insufficient space in buffer
+ *  1   Success
+ *  2   Packet was not batched and must be sent as a data report; any pending batch
+ *      has been sent first so that ordering is preserved
+ */
+static int cf_int_batch_packet(kis_capture_handler_t *caph, int batchable,
+        KismetDatasource__SubSignal *kv_signal,
+        struct timeval ts, uint32_t dlt, uint32_t packet_sz, uint32_t original_sz,
+        uint8_t *pack) {
+    kismet_external_batch_record_t *rec;
+    size_t channel_len = 0;
+    size_t rec_sz;
+    uint16_t flags = 0;
+    int r;
 
-void cf_handler_set_open_cb(kis_capture_handler_t *capf, 
-        cf_callback_open cb) {
-    pthread_mutex_lock(&(capf->handler_lock));
-    capf->open_cb = cb;
-    pthread_mutex_unlock(&(capf->handler_lock));
-}
+    if (kv_signal != NULL && kv_signal->channel != NULL)
+        channel_len = strlen(kv_signal->channel);
 
-void cf_handler_set_userdata(kis_capture_handler_t *capf, void *userdata) {
-    pthread_mutex_lock(&(capf->handler_lock));
-    capf->userdata = userdata;
-    pthread_mutex_unlock(&(capf->handler_lock));
-}
+    rec_sz = sizeof(kismet_external_batch_record_t) + channel_len + packet_sz;
 
-void cf_handler_set_capture_cb(kis_capture_handler_t *capf, cf_callback_capture cb) {
-    pthread_mutex_lock(&(capf->handler_lock));
-    capf->capture_cb = cb;
-    pthread_mutex_unlock(&(capf->handler_lock));
-}
+    pthread_mutex_lock(&(caph->batch_lock));
 
-void cf_handler_set_spectrumconfig_cb(kis_capture_handler_t *capf, 
-        cf_callback_spectrumconfig cb) {
-    pthread_mutex_lock(&(capf->handler_lock));
-    capf->spectrumconfig_cb = cb;
-    pthread_mutex_unlock(&(capf->handler_lock));
-}
+    if (caph->batch_max_bytes == 0) {
+        pthread_mutex_unlock(&(caph->batch_lock));
+        return 2;
+    }
 
-void cf_handler_set_unknown_cb(kis_capture_handler_t *capf, cf_callback_unknown cb) {
-    pthread_mutex_lock(&(capf->handler_lock));
-    capf->unknown_cb = cb;
-    pthread_mutex_unlock(&(capf->handler_lock));
-}
+    if (!batchable || channel_len > 0xFFFF ||
+            sizeof(kismet_external_batch_t) + rec_sz > caph->batch_max_bytes) {
+        r = cf_int_flush_batch_locked(caph);
+        pthread_mutex_unlock(&(caph->batch_lock));
+        return r == 1 ? 2 : r;
+    }
 
-void cf_handler_set_chantranslate_cb(kis_capture_handler_t *capf, 
-        cf_callback_chantranslate cb) {
-    pthread_mutex_lock(&(capf->handler_lock));
-    capf->chantranslate_cb = cb;
-    pthread_mutex_unlock(&(capf->handler_lock));
-}
+    if (caph->batch_len + rec_sz > caph->batch_max_bytes || caph->batch_count == 0xFFFF) {
+        if (cf_int_flush_batch_locked(caph) == 0) {
+            pthread_mutex_unlock(&(caph->batch_lock));
+            return 0;
+        }
+    }
 
-void cf_handler_set_chancontrol_cb(kis_capture_handler_t *capf,
-        cf_callback_chancontrol cb) {
-    pthread_mutex_lock(&(capf->handler_lock));
-    capf->chancontrol_cb = cb; 
-    pthread_mutex_unlock(&(capf->handler_lock));
-}
+    rec = (kismet_external_batch_record_t *) (caph->batch_buf + caph->batch_len);
 
-void cf_handler_set_chanfree_cb(kis_capture_handler_t *capf, cf_callback_chanfree cb) {
-    pthread_mutex_lock(&(capf->handler_lock));
-    capf->chanfree_cb = cb;
-    pthread_mutex_unlock(&(capf->handler_lock));
+    memset(rec, 0, sizeof(kismet_external_batch_record_t));
+
+    rec->ts_sec = htonl((uint32_t) ts.tv_sec);
+    rec->ts_usec = htonl((uint32_t) ts.tv_usec);
+    rec->dlt = htonl(dlt);
+    rec->packet_sz = htonl(packet_sz);
+    rec->original_sz = htonl(original_sz);
+
+    if (kv_signal != NULL) {
+        if (kv_signal->has_signal_dbm) {
+            flags |= KIS_EXTERNAL_BATCH_SIGNAL_DBM;
+            rec->signal = htons((uint16_t) (int16_t) kv_signal->signal_dbm);
+        } else if (kv_signal->has_signal_rssi) {
+            flags |= KIS_EXTERNAL_BATCH_SIGNAL_RSSI;
+            rec->signal = htons((uint16_t) (int16_t) kv_signal->signal_rssi);
+        }
+
+        if (kv_signal->has_noise_dbm) {
+            flags |= KIS_EXTERNAL_BATCH_NOISE_DBM;
+            rec->noise = htons((uint16_t) (int16_t) kv_signal->noise_dbm);
+        } else if (kv_signal->has_noise_rssi) {
+            flags |= KIS_EXTERNAL_BATCH_NOISE_RSSI;
+            rec->noise = htons((uint16_t) (int16_t) kv_signal->noise_rssi);
+        }
+
+        if (kv_signal->has_freq_khz) {
+            flags |= KIS_EXTERNAL_BATCH_FREQ;
+            rec->freq_khz = htonl((uint32_t) kv_signal->freq_khz);
+        }
+
+        if (kv_signal->has_datarate) {
+            flags |= KIS_EXTERNAL_BATCH_DATARATE;
+            rec->datarate = htonl((uint32_t) (kv_signal->datarate * 1000));
+        }
+    }
+
+    rec->flags = htons(flags);
+    rec->channel_len = htons((uint16_t) channel_len);
+
+    if (channel_len > 0)
+        memcpy(rec->data, kv_signal->channel, channel_len);
+
+    memcpy(rec->data + channel_len, pack, packet_sz);
+
+    caph->batch_len += rec_sz;
+    caph->batch_count++;
+
+    /* Start the flush timer on the first packet of a batch */
+    if (caph->batch_count == 1) {
+        cf_int_batch_set_deadline(caph);
+        pthread_cond_signal(&(caph->batch_cond));
+    }
+
+    pthread_mutex_unlock(&(caph->batch_lock));
+
+    return 1;
 }
 
 /* Internal capture thread which spawns the capture callback
@@ -1210,6 +2507,9 @@ void *cf_int_capture_thread(void *arg) {
     }
 
     // cf_send_error(caph, 0, "capture thread ended, source is closed.");
+
+    /* Send anything still waiting in a batch before we spin down */
+    cf_flush_batch(caph);
    
     cf_handler_spindown(caph);
 
@@ -1248,13 +2548,98 @@ int cf_handler_launch_capture_thread(kis_capture_handler_t *caph) {
 }
 
 void cf_handler_wait_ringbuffer(kis_capture_handler_t *caph) {
-    pthread_cond_wait(&(caph->out_ringbuf_flush_cond),
-            &(caph->out_ringbuf_flush_cond_mutex));
+#ifdef SYS_LINUX
+    /* The server frees space in the shared memory ring directly; wait for it to 
+     * consume something */
+    if (caph->shm_ring != NULL) {
+        uint64_t tail = __atomic_load_n(&caph->shm_ring->tail, __ATOMIC_SEQ_CST);
+
+        __atomic_store_n(&caph->shm_ring->producer_waiting, 1, __ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(&caph->shm_ring->tail, __ATOMIC_SEQ_CST) == tail)
+            cf_int_futex_wait(&caph->shm_ring->producer_waiting, 1, 100000);
+
+        __atomic_store_n(&caph->shm_ring->producer_waiting, 0, __ATOMIC_RELAXED);
+        return;
+    }
+
+    /* Wait for the IO loop to consume something from the output ringbuffer */
+    if (caph->out_space_efd >= 0 && caph->out_ringbuf != NULL && !caph->use_ws) {
+        size_t avail = kis_simple_ringbuf_available(caph->out_ringbuf);
+        struct pollfd pfd;
+        uint64_t v;
+
+        /* Nothing left to consume */
+        if (avail == kis_simple_ringbuf_size(caph->out_ringbuf))
+            return;
+
+        __atomic_store_n(&caph->out_writer_waiting, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        if (kis_simple_ringbuf_available(caph->out_ringbuf) == avail) {
+            pfd.fd = caph->out_space_efd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+
+            poll(&pfd, 1, 100);
+        }
+
+        __atomic_store_n(&caph->out_writer_waiting, 0, __ATOMIC_SEQ_CST);
+
+        if (read(caph->out_space_efd, &v, sizeof(v)) < 0) {
+            /* Nothing pending */
+        }
+
+        return;
+    }
+#endif
+
+    /* Wait with a timeout; a flush in between our caller failing to write and us 
+     * starting to wait would otherwise be missed */
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += 100000000L;
+
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&(caph->out_ringbuf_flush_cond_mutex));
+    pthread_cond_timedwait(&(caph->out_ringbuf_flush_cond),
+            &(caph->out_ringbuf_flush_cond_mutex), &deadline);
     pthread_mutex_unlock(&(caph->out_ringbuf_flush_cond_mutex));
 }
 
 /* Internal capture thread which drives channel hopping
  */
+/* Sleep until a CLOCK_MONOTONIC deadline */
+static void cf_int_sleep_until(const struct timespec *deadline) {
+#ifdef SYS_LINUX
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL) == EINTR)
+        ;
+#else
+    struct timespec now, delay;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    delay.tv_sec = deadline->tv_sec - now.tv_sec;
+    delay.tv_nsec = deadline->tv_nsec - now.tv_nsec;
+
+    if (delay.tv_nsec < 0) {
+        delay.tv_sec--;
+        delay.tv_nsec += 1000000000L;
+    }
+
+    if (delay.tv_sec < 0)
+        return;
+
+    while (nanosleep(&delay, &delay) < 0 && errno == EINTR)
+        ;
+#endif
+}
+
 void *cf_int_chanhop_thread(void *arg) {
     kis_capture_handler_t *caph = (kis_capture_handler_t *) arg;
 
@@ -1264,9 +2649,20 @@ void *cf_int_chanhop_thread(void *arg) {
 
     size_t hoppos;
     
-    /* How long we're waiting until the next time */
-    unsigned int wait_sec = 0;
-    unsigned int wait_usec = 0;
+    /* How long we're waiting until the next time, and when the next hop is due; hops
+     * are scheduled from the previous deadline, so the time spent in the channel
+     * control callback doesn't slow the hop rate */
+    unsigned long wait_usec = 0;
+    unsigned long latency_usec;
+    struct timespec next_hop, now;
+
+    /* When the current channel finished tuning and how long it was scheduled to 
+     * dwell, to measure the actual dwell and switch time of each hop */
+    struct timespec tuned, switch_start, switch_end;
+    int have_tuned = 0;
+    size_t tuned_pos = 0;
+    unsigned long target_usec = 0;
+    uint64_t dwell_usec, switch_usec;
 
     char errstr[STATUS_MAX];
     
@@ -1279,6 +2675,7 @@ void *cf_int_chanhop_thread(void *arg) {
     caph->hopping_running = 1;
     pthread_mutex_unlock(&(caph->handler_lock));
 
+    clock_gettime(CLOCK_MONOTONIC, &next_hop);
 
     while (1) {
         pthread_mutex_lock(&(caph->handler_lock));
@@ -1292,19 +2689,44 @@ void *cf_int_chanhop_thread(void *arg) {
        
         wait_usec = 1000000L / caph->channel_hop_rate;
 
-        if (wait_usec < 50000) {
-            wait_sec = 0;
+        if (wait_usec < 50000)
             wait_usec = 50000;
-        } else if (wait_usec > 1000000L) {
-            wait_sec = wait_usec / 1000000L;
-            wait_usec = wait_usec % 1000000L;
+
+        /* Keep at least three quarters of each dwell listening instead of switching */
+        latency_usec = __atomic_load_n(&caph->channel_set_latency_usec, __ATOMIC_RELAXED);
+        if (latency_usec * 4 > wait_usec)
+            wait_usec = latency_usec * 4;
+
+        /* Stretch or shrink the dwell of the channel we're on */
+        if (have_tuned && caph->channel_hop_dwell != NULL && caph->channel_hop_list_sz != 0) {
+            wait_usec = (unsigned long) (wait_usec * 
+                    caph->channel_hop_dwell[tuned_pos % caph->channel_hop_list_sz]);
+
+            if (wait_usec < 50000)
+                wait_usec = 50000;
+            if (latency_usec * 4 > wait_usec)
+                wait_usec = latency_usec * 4;
         }
 
+        target_usec = wait_usec;
+
         pthread_mutex_unlock(&(caph->handler_lock));
 
+        next_hop.tv_sec += wait_usec / 1000000L;
+        next_hop.tv_nsec += (wait_usec % 1000000L) * 1000L;
+        if (next_hop.tv_nsec >= 1000000000L) {
+            next_hop.tv_sec++;
+            next_hop.tv_nsec -= 1000000000L;
+        }
+
+        /* If we've fallen more than a hop behind, such as after a stall, start the
+         * schedule over instead of hopping rapidly to catch up */
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > next_hop.tv_sec + (long) (wait_usec / 1000000L) + 1)
+            next_hop = now;
+
         /* Sleep until the next wakeup */
-        sleep(wait_sec);
-        usleep(wait_usec);
+        cf_int_sleep_until(&next_hop);
 
         pthread_mutex_lock(&caph->handler_lock);
 
@@ -1316,9 +2738,35 @@ void *cf_int_chanhop_thread(void *arg) {
         }
 
         errstr[0] = 0;
-        if ((r = (caph->chancontrol_cb)(caph, 0, 
-                    caph->custom_channel_hop_list[hoppos % caph->channel_hop_list_sz], 
-                    errstr)) < 0) {
+        clock_gettime(CLOCK_MONOTONIC, &switch_start);
+        r = (caph->chancontrol_cb)(caph, 0, 
+                caph->custom_channel_hop_list[hoppos % caph->channel_hop_list_sz], errstr);
+        clock_gettime(CLOCK_MONOTONIC, &switch_end);
+
+        /* How long we actually listened to the last channel, and how long this 
+         * switch took */
+        switch_usec = (uint64_t) (switch_end.tv_sec - switch_start.tv_sec) * 1000000L +
+            (switch_end.tv_nsec - switch_start.tv_nsec) / 1000L;
+
+        if (have_tuned) {
+            dwell_usec = (uint64_t) (switch_start.tv_sec - tuned.tv_sec) * 1000000L +
+                (switch_start.tv_nsec - tuned.tv_nsec) / 1000L;
+
+            caph->hop_dwell_total_usec += dwell_usec;
+            caph->hop_dwell_error_total_usec += dwell_usec > target_usec ?
+                dwell_usec - target_usec : target_usec - dwell_usec;
+        }
+
+        caph->hop_count++;
+        caph->hop_switch_total_usec += switch_usec;
+        if (switch_usec > caph->hop_switch_max_usec)
+            caph->hop_switch_max_usec = switch_usec;
+
+        tuned = switch_end;
+        tuned_pos = hoppos % caph->channel_hop_list_sz;
+        have_tuned = 1;
+
+        if (r < 0) {
             fprintf(stderr, "FATAL:  Datasource channel control callback failed.\n");
             cf_send_error(caph, 0, errstr);
             caph->hopping_running = 0;
@@ -1365,6 +2813,7 @@ void *cf_int_chanhop_thread(void *arg) {
                 caph->channel_hop_failure_list_sz != 0) {
             char **channel_hop_list_new;
             void **custom_channel_hop_list_new;
+            double *dwell_new;
             size_t new_sz;
             size_t i, ni;
             struct cf_channel_error *err, *errnext;
@@ -1402,6 +2851,11 @@ void *cf_int_chanhop_thread(void *arg) {
             channel_hop_list_new = (char **) malloc(sizeof(char *) * new_sz);
             custom_channel_hop_list_new = (void **) malloc(sizeof(void *) * new_sz);
 
+            if (caph->channel_hop_dwell != NULL)
+                dwell_new = (double *) malloc(sizeof(double) * new_sz);
+            else
+                dwell_new = NULL;
+
             // fprintf(stderr, "debug - allocating new channel list %lu\n", new_sz);
 
             for (i = 0, ni = 0; i < caph->channel_hop_list_sz && ni < new_sz; i++) {
@@ -1429,6 +2883,8 @@ void *cf_int_chanhop_thread(void *arg) {
                 /* Otherwise move the pointer to our new list */
                 channel_hop_list_new[ni] = caph->channel_hop_list[i];
                 custom_channel_hop_list_new[ni] = caph->custom_channel_hop_list[i];
+                if (dwell_new != NULL)
+                    dwell_new[ni] = caph->channel_hop_dwell[i];
                 ni++;
             }
 
@@ -1441,6 +2897,10 @@ void *cf_int_chanhop_thread(void *arg) {
             caph->custom_channel_hop_list = custom_channel_hop_list_new;
             caph->channel_hop_list_sz = new_sz;
 
+            if (caph->channel_hop_dwell != NULL)
+                free(caph->channel_hop_dwell);
+            caph->channel_hop_dwell = dwell_new;
+
             /* Spam a configresp which should trigger a reconfigure */
             snprintf(errstr, STATUS_MAX, "Removed %lu channels from the channel list "
                     "because the source could not tune to them", 
@@ -1505,6 +2965,7 @@ int cf_dispatch_rx_content(kis_capture_handler_t *caph, const char *command,
     if (strncasecmp(command, "PING", 32) == 0) {
         caph->last_ping = time(NULL);
         cf_send_pong(caph, seqno);
+        cf_send_capture_stats(caph);
         cbret = 1;
         goto finish;
     } else if (strncasecmp(command, "PONG", 32) == 0) {
@@ -1630,6 +3091,60 @@ int cf_dispatch_rx_content(kis_capture_handler_t *caph, const char *command,
                 cbret = -1;
                 goto finish;
             }
+
+            char *flag;
+            int flag_len;
+
+            /* Use v3 frames for data if the server knows every command we do; the
+             * table is only ever appended to */
+            caph->use_v3 = open_cmd->has_command_table && 
+                open_cmd->command_table >= KIS_EXTERNAL_CMD_TABLE_VERSION;
+
+            /* Batch plain packets if the server offered it; the websocket transport
+             * frames every message itself, so only tcp and ipc batch.  Compression
+             * is only worth the cpu over a network.  Over tcp, batches move to 
+             * datagrams if the server offered them; each batch has to fit in one
+             * datagram, and without a reliable stream batches can't be compressed. */
+            if (open_cmd->has_batch_max_bytes && (caph->use_tcp || caph->use_ipc)) {
+                size_t batch_max = open_cmd->batch_max_bytes;
+                size_t dgram_hdr_sz = sizeof(kismet_remote_datagram) + 
+                    sizeof(kismet_external_frame_v2_t);
+                int use_dgram = caph->use_tcp &&
+                    open_cmd->has_datagram_token && open_cmd->datagram_token != 0 &&
+                    open_cmd->has_datagram_max_bytes &&
+                    open_cmd->datagram_max_bytes > dgram_hdr_sz;
+
+                if (use_dgram && batch_max > open_cmd->datagram_max_bytes - dgram_hdr_sz)
+                    batch_max = open_cmd->datagram_max_bytes - dgram_hdr_sz;
+
+                cf_int_configure_batch(caph, batch_max,
+                        open_cmd->has_batch_flush_usec ? open_cmd->batch_flush_usec : 500,
+                        caph->use_tcp && !use_dgram && open_cmd->has_compression ? 
+                            open_cmd->compression : KIS_EXTERNAL_COMPRESSION_NONE,
+                        open_cmd->has_compression_level ? 
+                            (int) open_cmd->compression_level : Z_DEFAULT_COMPRESSION);
+
+                if (use_dgram && 
+                        cf_int_configure_datagram(caph, open_cmd->datagram_token, 
+                            open_cmd->datagram_max_bytes) < 0) {
+                    fprintf(stderr, "WARNING: Could not open a datagram socket to the "
+                            "Kismet server, sending packets on the connection: %s\n",
+                            strerror(errno));
+                } else if (!use_dgram) {
+                    cf_int_configure_datagram(caph, 0, 0);
+                }
+            } else {
+                cf_int_configure_batch(caph, 0, 0, KIS_EXTERNAL_COMPRESSION_NONE, 0);
+                cf_int_configure_datagram(caph, 0, 0);
+            }
+
+            caph->data_headers_only = 0;
+
+            if ((flag_len = cf_find_flag(&flag, "data_headers_only", 
+                            open_cmd->definition)) > 0) {
+                if (strncasecmp(flag, "true", flag_len) == 0)
+                    caph->data_headers_only = 1;
+            }
             
             msgstr[0] = 0;
             cbret = (*(caph->open_cb))(caph,
@@ -1819,6 +3334,10 @@ int cf_dispatch_rx_content(kis_capture_handler_t *caph, const char *command,
                     chanhop_priv_channels, chanhop_channels_sz, chanhop_rate,
                     chanhop_shuffle, chanhop_shuffle_spacing, chanhop_offset);
 
+            if (conf_cmd->hopping->n_dwell != 0)
+                cf_handler_assign_hop_dwell(caph, conf_cmd->hopping->dwell,
+                        conf_cmd->hopping->n_dwell);
+
             /* Return a completion, and we do NOT free the channel lists we
              * dynamically allocated out of the buffer with cf_get_CHANHOP, as
              * we're now using them for keeping the channel record in the
@@ -2028,6 +3547,9 @@ int cf_handler_tcp_remote_connect(kis_capture_handler_t *caph) {
         caph->tcp_fd = -1;
     }
 
+    /* Datagrams are offered again when the new connection opens the source */
+    cf_int_configure_datagram(caph, 0, 0);
+
     /* Reset the last ping */
     caph->last_ping = time(0);
 
@@ -2326,12 +3848,70 @@ static void ws_destroy_msg(void *in_msg) {
 }
 #endif
 
+static int cf_int_handler_loop(kis_capture_handler_t *caph);
+
+/* Run the loop of an additional source; when it ends, whether from an error or the
+ * server closing the source, shut down the handler which launched it so that the
+ * sources come down, and are restarted, together */
+static void *cf_int_sub_handler_thread(void *arg) {
+    kis_capture_handler_t *caph = (kis_capture_handler_t *) arg;
+
+    cf_int_handler_loop(caph);
+
+    cf_handler_shutdown(caph->parent_handler);
+
+    return NULL;
+}
+
 int cf_handler_loop(kis_capture_handler_t *caph) {
+    pthread_t *subthreads;
+    size_t num_launched = 0;
+    size_t szi;
+    int err;
+    int rv = -1;
+
+    if (caph->num_sub_handlers == 0)
+        return cf_int_handler_loop(caph);
+
+    subthreads = (pthread_t *) malloc(sizeof(pthread_t) * caph->num_sub_handlers);
+
+    if (subthreads == NULL) {
+        fprintf(stderr, "FATAL:  Could not allocate threads for additional sources\n");
+        return -1;
+    }
+
+    for (szi = 0; szi < caph->num_sub_handlers; szi++) {
+        if ((err = pthread_create(&(subthreads[szi]), NULL, cf_int_sub_handler_thread, 
+                    caph->sub_handlers[szi])) != 0) {
+            fprintf(stderr, "FATAL:  Could not launch thread for source '%s': %s\n",
+                    caph->sub_handlers[szi]->cli_sourcedef, strerror(err));
+            break;
+        }
+
+        num_launched++;
+    }
+
+    if (num_launched == caph->num_sub_handlers)
+        rv = cf_int_handler_loop(caph);
+
+    for (szi = 0; szi < num_launched; szi++)
+        cf_handler_shutdown(caph->sub_handlers[szi]);
+
+    for (szi = 0; szi < num_launched; szi++)
+        pthread_join(subthreads[szi], NULL);
+
+    free(subthreads);
+
+    return rv;
+}
+
+static int cf_int_handler_loop(kis_capture_handler_t *caph) {
     fd_set rset, wset;
     int max_fd;
     int read_fd, write_fd;
     struct timeval tm;
     int spindown;
+    int shm_pending;
     int ret;
     int rv = 0;
 
@@ -2362,6 +3942,10 @@ int cf_handler_loop(kis_capture_handler_t *caph) {
             fcntl(caph->in_fd, F_SETFL, fcntl(caph->in_fd, F_GETFL, 0) | O_NONBLOCK);
             fcntl(caph->out_fd, F_SETFL, fcntl(caph->out_fd, F_GETFL, 0) | O_NONBLOCK);
 
+            /* Write frames straight into shared memory if the server offered it */
+            if (caph->shm_ring == NULL && cf_int_attach_shm(caph) && caph->verbose)
+                fprintf(stderr, "INFO: Using shared memory ring to send data to Kismet\n");
+
             read_fd = caph->in_fd;
             write_fd = caph->out_fd;
         }
@@ -2397,6 +3981,18 @@ int cf_handler_loop(kis_capture_handler_t *caph) {
 
             pthread_mutex_unlock(&(caph->handler_lock));
 
+            /* Leave a saturated server once everything queued has been sent; the retry
+             * process reconnects to the new server immediately */
+            if (spindown == 0 && cf_int_check_rebalance(caph)) {
+                *(caph->remote_migrating) = 1;
+
+                pthread_mutex_lock(&(caph->handler_lock));
+                caph->spindown = 1;
+                pthread_mutex_unlock(&(caph->handler_lock));
+
+                spindown = 1;
+            }
+
             max_fd = 0;
 
             /* Only set read sets if we're not spinning down */
@@ -2406,33 +4002,71 @@ int cf_handler_loop(kis_capture_handler_t *caph) {
                 max_fd = read_fd;
             }
 
-            /* Inspect the write buffer - do we have data? */
-            pthread_mutex_lock(&(caph->out_ringbuf_lock));
+            /* Inspect the write buffer - do we have data?  We're the only reader of the
+             * write buffer, so this doesn't need the ringbuf lock */
+
+            /* Don't exit until the server has everything from the shared memory ring, 
+             * too; it stops reading the ring when we exit */
+            shm_pending = cf_int_shm_pending(caph);
 
             if (kis_simple_ringbuf_used(caph->out_ringbuf) != 0) {
                 FD_SET(write_fd, &wset);
                 if (max_fd < write_fd)
                     max_fd = write_fd;
-            } else if (spindown != 0) {
-                pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+            } else if (spindown != 0 && !shm_pending) {
                 rv = 0;
                 break;
+#ifdef SYS_LINUX
+            } else if (caph->out_data_efd >= 0) {
+                /* Sleep until a writer commits something instead of until the select
+                 * timeout; flag that we're waiting and look again, so a commit racing 
+                 * with us is either seen here or wakes us */
+                __atomic_store_n(&caph->out_reader_waiting, 1, __ATOMIC_SEQ_CST);
+                __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+                if (kis_simple_ringbuf_used(caph->out_ringbuf) != 0) {
+                    __atomic_store_n(&caph->out_reader_waiting, 0, __ATOMIC_SEQ_CST);
+
+                    FD_SET(write_fd, &wset);
+                    if (max_fd < write_fd)
+                        max_fd = write_fd;
+                } else {
+                    FD_SET(caph->out_data_efd, &rset);
+                    if (max_fd < caph->out_data_efd)
+                        max_fd = caph->out_data_efd;
+                }
+#endif
             }
 
-            pthread_mutex_unlock(&(caph->out_ringbuf_lock));
-
             tm.tv_sec = 0;
-            tm.tv_usec = 500000;
+            tm.tv_usec = (spindown != 0 && shm_pending) ? 1000 : 500000;
+
+            if ((ret = select(max_fd + 1, &rset, &wset, NULL, &tm)) < 0) {
+                if (errno != EINTR && errno != EAGAIN) {
+                    fprintf(stderr, "FATAL:  Error during select(): %s\n", strerror(errno));
+                    rv = -1;
+                    break;
+                }
+            }
+
+#ifdef SYS_LINUX
+            if (caph->out_data_efd >= 0) {
+                __atomic_store_n(&caph->out_reader_waiting, 0, __ATOMIC_SEQ_CST);
+
+                /* Data was committed; it's picked up on the next pass */
+                if (ret > 0 && FD_ISSET(caph->out_data_efd, &rset)) {
+                    uint64_t v;
+
+                    if (read(caph->out_data_efd, &v, sizeof(v)) < 0) {
+                        /* Nothing pending */
+                    }
 
-            if ((ret = select(max_fd + 1, &rset, &wset, NULL, &tm)) < 0) {
-                if (errno != EINTR && errno != EAGAIN) {
-                    fprintf(stderr, "FATAL:  Error during select(): %s\n", strerror(errno));
-                    rv = -1;
-                    break;
+                    continue;
                 }
             }
+#endif
 
-            if (ret == 0)
+            if (ret <= 0)
                 continue;
 
             if (FD_ISSET(read_fd, &rset)) {
@@ -2496,21 +4130,19 @@ int cf_handler_loop(kis_capture_handler_t *caph) {
             }
 
             if (FD_ISSET(write_fd, &wset)) {
-                /* We can write data - lock the ring buffer mutex and write out
-                 * whatever we can; we peek the ringbuffer and then flag off what
-                 * we've successfully written out */
+                /* We can write data - write out whatever we can; we peek the 
+                 * ringbuffer and then flag off what we've successfully written out.
+                 * Writers keep filling the buffer while we do, we're the only reader
+                 * so we don't need the ringbuf lock */
                 ssize_t written_sz;
                 size_t peeked_sz;
                 uint8_t *peek_buf = NULL;
 
-                pthread_mutex_lock(&(caph->out_ringbuf_lock));
-
                 peeked_sz = kis_simple_ringbuf_peek_zc(caph->out_ringbuf, (void **) &peek_buf, 0);
 
                 /* Don't know how we'd get here... */
                 if (peeked_sz == 0) {
                     kis_simple_ringbuf_peek_free(caph->out_ringbuf, peek_buf);
-                    pthread_mutex_unlock(&(caph->out_ringbuf_lock));
                     continue;
                 }
 
@@ -2525,26 +4157,23 @@ int cf_handler_loop(kis_capture_handler_t *caph) {
                 if (written_sz < 0) {
                     if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
                         kis_simple_ringbuf_peek_free(caph->out_ringbuf, peek_buf);
-                        pthread_mutex_unlock(&(caph->out_ringbuf_lock));
                         fprintf(stderr, "FATAL:  Error during write(): %s\n", strerror(errno));
-                        free(peek_buf);
                         rv = -1;
                         break;
                     }
-                }
 
-                /* Flag it as consumed */
-                kis_simple_ringbuf_read(caph->out_ringbuf, NULL, (size_t) written_sz);
+                    written_sz = 0;
+                }
 
                 /* Get rid of the peek */
                 kis_simple_ringbuf_peek_free(caph->out_ringbuf, peek_buf);
 
-                /* Unlock */
-                pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+                /* Flag it as consumed */
+                kis_simple_ringbuf_read(caph->out_ringbuf, NULL, (size_t) written_sz);
 
                 /* Signal to any waiting IO that the buffer has some
                  * headroom */
-                pthread_cond_broadcast(&(caph->out_ringbuf_flush_cond));
+                cf_int_out_wake_writer(caph);
             }
         }
     } else if (caph->use_ws) {
@@ -2604,6 +4233,8 @@ int cf_send_rb_raw_bytes(kis_capture_handler_t *caph, uint8_t *data, size_t len)
 
     pthread_mutex_unlock(&(caph->out_ringbuf_lock));
 
+    cf_int_out_wake_reader(caph);
+
     return 1;
 }
 
@@ -2677,7 +4308,7 @@ int cf_send_rb_packet(kis_capture_handler_t *caph, const char *command, uint32_t
 
     pthread_mutex_lock(&(caph->out_ringbuf_lock));
 
-    rs_sz = kis_simple_ringbuf_reserve(caph->out_ringbuf, (void **) &send_buffer, 
+    rs_sz = cf_int_out_reserve(caph, (void **) &send_buffer, 
             len + sizeof(kismet_external_frame_v2_t));
 
     if (rs_sz != len + sizeof(kismet_external_frame_v2_t)) {
@@ -2703,7 +4334,7 @@ int cf_send_rb_packet(kis_capture_handler_t *caph, const char *command, uint32_t
 
     memcpy(frame->data, data, len);
 
-    kis_simple_ringbuf_commit(caph->out_ringbuf, send_buffer, rs_sz);
+    cf_int_out_commit(caph, send_buffer, rs_sz);
 
     pthread_mutex_unlock(&(caph->out_ringbuf_lock));
 
@@ -3227,70 +4858,41 @@ int cf_send_openresp(kis_capture_handler_t *caph, uint32_t seq, unsigned int suc
     return cf_send_packet(caph, "KDSOPENSOURCEREPORT", buf, buf_len);
 }
 
-int cf_send_data(kis_capture_handler_t *caph,
-        KismetExternal__MsgbusMessage *kv_message,
-        KismetDatasource__SubSignal *kv_signal,
-        KismetDatasource__SubGps *kv_gps,
-        struct timeval ts, uint32_t dlt, uint32_t packet_sz, uint8_t *pack) {
-
-    kismet_external_frame_v2_t *frame;
-    size_t rs_sz;
-    uint8_t *send_buffer;
-    size_t buf_len = 0;
-    uint32_t seqno;
-
-    KismetDatasource__DataReport kedata;
-    KismetDatasource__SubPacket kepkt;
-    KismetDatasource__SubGps kegps;
-
-    kismet_datasource__data_report__init(&kedata);
-    kismet_datasource__sub_packet__init(&kepkt);
-    kismet_datasource__sub_gps__init(&kegps);
-
-    kedata.signal = kv_signal;
-    kedata.message = kv_message;
-
-    if (kv_gps != NULL) {
-        kedata.gps = kv_gps;
-    } else if (caph->gps_fixed_lat != 0) {
-        struct timeval tv;
-
-        kegps.lat = caph->gps_fixed_lat;
-        kegps.lon = caph->gps_fixed_lon;
-        kegps.alt = caph->gps_fixed_alt;
-        kegps.fix = 3;
-
-        gettimeofday(&tv, NULL);
-        kegps.time_sec = tv.tv_sec;
-        kegps.time_usec = tv.tv_usec;
+/* Fill in the fixed location of the source; the strings are only referenced by the 
+ * report, which is packed before they can change, so nothing is allocated */
+static void cf_int_fixed_gps(kis_capture_handler_t *caph, KismetDatasource__SubGps *kegps) {
+    struct timeval tv;
 
-        kegps.type = strdup("remote-fixed");
+    kegps->lat = caph->gps_fixed_lat;
+    kegps->lon = caph->gps_fixed_lon;
+    kegps->alt = caph->gps_fixed_alt;
+    kegps->fix = 3;
 
-        if (caph->gps_name != NULL)
-            kegps.name = strdup(caph->gps_name);
-        else
-            kegps.name = strdup("remote-fixed");
+    gettimeofday(&tv, NULL);
+    kegps->time_sec = tv.tv_sec;
+    kegps->time_usec = tv.tv_usec;
 
-        kedata.gps = &kegps;
-    }
+    kegps->type = (char *) "remote-fixed";
 
-    if (packet_sz > 0 && pack != NULL) {
-        kepkt.time_sec = ts.tv_sec;
-        kepkt.time_usec = ts.tv_usec;
-        kepkt.dlt = dlt;
-        kepkt.size = packet_sz;
-        kepkt.data.len = packet_sz;
-        kepkt.data.data = pack;
+    if (caph->gps_name != NULL)
+        kegps->name = caph->gps_name;
+    else
+        kegps->name = (char *) "remote-fixed";
+}
 
-        kedata.packet = &kepkt;
-    }
+/* Send a data report.  Over tcp and ipc the report is packed directly into space 
+ * reserved in the output buffer, so sending a report neither allocates nor copies; 
+ * websockets still need a temporary buffer for the ws ring. */
+static int cf_int_send_datareport(kis_capture_handler_t *caph, 
+        KismetDatasource__DataReport *kedata) {
+    size_t rs_sz, hdr_sz;
+    int use_v3;
+    uint8_t *send_buffer;
+    uint8_t *buf;
+    size_t buf_len;
+    uint32_t seqno;
 
     if (caph->use_tcp || caph->use_ipc) {
-        /* Shortcut internal state tests to use an optimized streaming method to write to 
-         * the tcp/ipc ringbuffer using a protobuf_c buffer writer.
-         * This is a bunch of code duplication but it's important enough that we get the
-         * maximum speed here */
-
         /* Lock the handler and get the next sequence number */
         pthread_mutex_lock(&(caph->handler_lock));
         if (++caph->seqno == 0)
@@ -3299,67 +4901,117 @@ int cf_send_data(kis_capture_handler_t *caph,
         pthread_mutex_unlock(&(caph->handler_lock));
 
         /* Reserve the buffer space and assemble the packet header just like cf_rb_send_packet */
+        use_v3 = caph->use_v3;
+        hdr_sz = cf_int_frame_header_sz(use_v3);
+
         pthread_mutex_lock(&(caph->out_ringbuf_lock));
 
-        buf_len = kismet_datasource__data_report__get_packed_size(&kedata);
+        buf_len = kismet_datasource__data_report__get_packed_size(kedata);
 
-        rs_sz = kis_simple_ringbuf_reserve(caph->out_ringbuf, (void **) &send_buffer, 
-                buf_len + sizeof(kismet_external_frame_v2_t));
+        rs_sz = cf_int_out_reserve(caph, (void **) &send_buffer, buf_len + hdr_sz);
 
-        if (rs_sz != buf_len + sizeof(kismet_external_frame_v2_t)) {
+        if (rs_sz != buf_len + hdr_sz) {
             // fprintf(stderr, "DEBUG - insufficient size in outgoing buffer for %lu\n", buf_len);
             pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+            __atomic_add_fetch(&caph->ringbuf_full, 1, __ATOMIC_RELAXED);
             return 0;
         }
 
-        /* Map to the tx frame */
-        frame = (kismet_external_frame_v2_t *) send_buffer;
+        kismet_datasource__data_report__pack(kedata, 
+                cf_int_frame_header(send_buffer, use_v3, "KDSDATAREPORT", 
+                    KIS_EXTERNAL_CMD_DATAREPORT, seqno, buf_len));
+
+        cf_int_out_commit(caph, send_buffer, rs_sz);
 
-        /* Set the signature and data size */
-        frame->signature = htonl(KIS_EXTERNAL_PROTO_SIG);
-        frame->data_sz = htonl(buf_len);
+        pthread_mutex_unlock(&(caph->out_ringbuf_lock));
 
-        frame->v2_sentinel = htons(KIS_EXTERNAL_V2_SIG);
-        frame->frame_version = htons(2);
+        return rs_sz;
+    } 
+    
+    /* Otherwise we need to use our legacy mode of serializing the packet into a temp
+     * buffer then putting that into the websocket ring */
+    buf_len = kismet_datasource__data_report__get_packed_size(kedata);
+    buf = (uint8_t *) malloc(buf_len);
 
-        frame->seqno = htonl(seqno);
+    if (buf == NULL) {
+        return -1;
+    }
 
-        strncpy(frame->command, "KDSDATAREPORT", 32);
+    kismet_datasource__data_report__pack(kedata, buf);
 
-        kismet_datasource__data_report__pack(&kedata, frame->data);
+    return cf_send_packet(caph, "KDSDATAREPORT", buf, buf_len);
+}
 
-        kis_simple_ringbuf_commit(caph->out_ringbuf, send_buffer, rs_sz);
+int cf_send_data(kis_capture_handler_t *caph,
+        KismetExternal__MsgbusMessage *kv_message,
+        KismetDatasource__SubSignal *kv_signal,
+        KismetDatasource__SubGps *kv_gps,
+        struct timeval ts, uint32_t dlt, uint32_t packet_sz, uint8_t *pack) {
 
-        pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+    uint32_t cap_sz, original_sz = 0;
 
-        if (kegps.name != NULL)
-            free(kegps.name);
-        if (kegps.type != NULL)
-            free(kegps.type);
+    KismetDatasource__DataReport kedata;
+    KismetDatasource__SubPacket kepkt;
+    KismetDatasource__SubGps kegps;
 
-        return rs_sz;
-    }  else {
-        /* Otherwise we need to use our legacy mode of serializing the packet into a temp
-         * buffer then putting that into the websocket ring */
-        uint8_t *buf;
-        size_t buf_len;
+    int r;
 
-        buf_len = kismet_datasource__data_report__get_packed_size(&kedata);
-        buf = (uint8_t *) malloc(buf_len);
+    /* Cut data frames down to their headers if the source was configured to */
+    if (caph->data_headers_only && packet_sz > 0 && pack != NULL) {
+        cap_sz = cf_int_data_headers_len(dlt, pack, packet_sz);
 
-        if (buf == NULL) {
-            return -1;
+        if (cap_sz != packet_sz) {
+            original_sz = packet_sz;
+            packet_sz = cap_sz;
         }
+    }
+
+    /* Plain packets go into the current batch when batching was negotiated; anything 
+     * carrying a message or a location is sent as a full report */
+    if (caph->use_tcp || caph->use_ipc) {
+        r = cf_int_batch_packet(caph, 
+                kv_message == NULL && kv_gps == NULL && caph->gps_fixed_lat == 0 &&
+                packet_sz > 0 && pack != NULL,
+                kv_signal, ts, dlt, packet_sz, original_sz, pack);
+
+        if (r == 0)
+            __atomic_add_fetch(&caph->ringbuf_full, 1, __ATOMIC_RELAXED);
+
+        if (r != 2)
+            return r;
+    }
+
+    kismet_datasource__data_report__init(&kedata);
+    kismet_datasource__sub_packet__init(&kepkt);
+    kismet_datasource__sub_gps__init(&kegps);
+
+    kedata.signal = kv_signal;
+    kedata.message = kv_message;
+
+    if (kv_gps != NULL) {
+        kedata.gps = kv_gps;
+    } else if (caph->gps_fixed_lat != 0) {
+        cf_int_fixed_gps(caph, &kegps);
+        kedata.gps = &kegps;
+    }
 
-        kismet_datasource__data_report__pack(&kedata, buf);
+    if (packet_sz > 0 && pack != NULL) {
+        kepkt.time_sec = ts.tv_sec;
+        kepkt.time_usec = ts.tv_usec;
+        kepkt.dlt = dlt;
+        kepkt.size = packet_sz;
+        kepkt.data.len = packet_sz;
+        kepkt.data.data = pack;
 
-        if (kegps.name != NULL)
-            free(kegps.name);
-        if (kegps.type != NULL)
-            free(kegps.type);
+        if (original_sz != 0) {
+            kepkt.has_cap_size = 1;
+            kepkt.cap_size = original_sz;
+        }
 
-        return cf_send_packet(caph, "KDSDATAREPORT", buf, buf_len);
+        kedata.packet = &kepkt;
     }
+
+    return cf_int_send_datareport(caph, &kedata);
 }
 
 
@@ -3383,24 +5035,7 @@ int cf_send_json(kis_capture_handler_t *caph,
     if (kv_gps != NULL) {
         kedata.gps = kv_gps;
     } else if (caph->gps_fixed_lat != 0) {
-        struct timeval tv;
-
-        kegps.lat = caph->gps_fixed_lat;
-        kegps.lon = caph->gps_fixed_lon;
-        kegps.alt = caph->gps_fixed_alt;
-        kegps.fix = 3;
-
-        gettimeofday(&tv, NULL);
-        kegps.time_sec = tv.tv_sec;
-        kegps.time_usec = tv.tv_usec;
-
-        kegps.type = strdup("remote-fixed");
-
-        if (caph->gps_name != NULL)
-            kegps.name = strdup(caph->gps_name);
-        else
-            kegps.name = strdup("remote-fixed");
-
+        cf_int_fixed_gps(caph, &kegps);
         kedata.gps = &kegps;
     }
 
@@ -3413,24 +5048,105 @@ int cf_send_json(kis_capture_handler_t *caph,
         kedata.json = &kejson;
     }
 
-    uint8_t *buf;
-    size_t buf_len;
+    return cf_int_send_datareport(caph, &kedata);
+}
 
-    buf_len = kismet_datasource__data_report__get_packed_size(&kedata);
-    buf = (uint8_t *) malloc(buf_len);
+/* Fill in a spectrum payload, which must have room for the header and the bins */
+static void cf_int_fill_spectrum(uint8_t *buf, struct timeval ts, uint32_t sweep,
+        uint64_t start_hz, uint32_t bin_hz, const float *bins, uint32_t num_bins,
+        int as_int8) {
+    kismet_external_spectrum_t *spec = (kismet_external_spectrum_t *) buf;
+    uint32_t i, fv;
+    float x;
+    int v;
+
+    spec->version = htons(KIS_EXTERNAL_SPECTRUM_VERSION);
+    spec->format = htons(as_int8 ? KIS_EXTERNAL_SPECTRUM_INT8 : KIS_EXTERNAL_SPECTRUM_FLOAT32);
+    spec->num_bins = htonl(num_bins);
+    spec->ts_sec = htonl(ts.tv_sec);
+    spec->ts_usec = htonl(ts.tv_usec);
+    spec->start_hz = htobe64(start_hz);
+    spec->bin_hz = htonl(bin_hz);
+    spec->sweep = htonl(sweep);
+
+    if (as_int8) {
+        for (i = 0; i < num_bins; i++) {
+            x = (bins[i] - KIS_EXTERNAL_SPECTRUM_INT8_BASE) * 2;
+
+            /* Round to the nearest half dB; anything out of range, or not a number, 
+             * pins to the ends of the range */
+            if (!(x > -128))
+                v = -128;
+            else if (x > 127)
+                v = 127;
+            else
+                v = x < 0 ? (int) (x - 0.5f) : (int) (x + 0.5f);
 
-    if (buf == NULL) {
+            ((int8_t *) spec->data)[i] = (int8_t) v;
+        }
+    } else {
+        for (i = 0; i < num_bins; i++) {
+            memcpy(&fv, &bins[i], sizeof(uint32_t));
+            fv = htonl(fv);
+            memcpy(spec->data + (i * sizeof(uint32_t)), &fv, sizeof(uint32_t));
+        }
+    }
+}
+
+int cf_send_spectrum(kis_capture_handler_t *caph, struct timeval ts, uint32_t sweep,
+        uint64_t start_hz, uint32_t bin_hz, const float *bins, uint32_t num_bins,
+        int as_int8) {
+    size_t data_sz, rs_sz, hdr_sz;
+    uint8_t *send_buffer;
+    uint32_t seqno;
+    int use_v3;
+
+    if (num_bins == 0 || num_bins > KIS_EXTERNAL_SPECTRUM_MAX_BINS)
         return -1;
+
+    data_sz = sizeof(kismet_external_spectrum_t) + 
+        (size_t) num_bins * (as_int8 ? sizeof(int8_t) : sizeof(float));
+
+    if (caph->use_tcp || caph->use_ipc) {
+        /* Build the frame directly in the output buffer */
+        pthread_mutex_lock(&(caph->handler_lock));
+        if (++caph->seqno == 0)
+            caph->seqno = 1;
+        seqno = caph->seqno;
+        pthread_mutex_unlock(&(caph->handler_lock));
+
+        use_v3 = caph->use_v3;
+        hdr_sz = cf_int_frame_header_sz(use_v3);
+
+        pthread_mutex_lock(&(caph->out_ringbuf_lock));
+
+        rs_sz = cf_int_out_reserve(caph, (void **) &send_buffer, data_sz + hdr_sz);
+
+        if (rs_sz != data_sz + hdr_sz) {
+            pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+            __atomic_add_fetch(&caph->ringbuf_full, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+
+        cf_int_fill_spectrum(cf_int_frame_header(send_buffer, use_v3, 
+                    KIS_EXTERNAL_SPECTRUM_CMD, KIS_EXTERNAL_CMD_SPECTRUM, seqno, data_sz),
+                ts, sweep, start_hz, bin_hz, bins, num_bins, as_int8);
+
+        cf_int_out_commit(caph, send_buffer, rs_sz);
+
+        pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+
+        return rs_sz;
     }
 
-    kismet_datasource__data_report__pack(&kedata, buf);
+    send_buffer = (uint8_t *) malloc(data_sz);
+
+    if (send_buffer == NULL)
+        return -1;
 
-    if (kegps.name != NULL)
-        free(kegps.name);
-    if (kegps.type != NULL)
-        free(kegps.type);
+    cf_int_fill_spectrum(send_buffer, ts, sweep, start_hz, bin_hz, bins, num_bins, as_int8);
 
-    return cf_send_packet(caph, "KDSDATAREPORT", buf, buf_len);
+    return cf_send_packet(caph, KIS_EXTERNAL_SPECTRUM_CMD, send_buffer, data_sz);
 }
 
 
@@ -3562,6 +5278,60 @@ int cf_send_pong(kis_capture_handler_t *caph, uint32_t in_seqno) {
     return cf_send_packet(caph, "PONG", buf, buf_len);
 }
 
+void cf_handler_set_kernel_stats(kis_capture_handler_t *caph, uint64_t packets,
+        uint64_t drops) {
+    pthread_mutex_lock(&(caph->handler_lock));
+    caph->has_kernel_stats = 1;
+    caph->kernel_packets = packets;
+    caph->kernel_drops = drops;
+    pthread_mutex_unlock(&(caph->handler_lock));
+}
+
+int cf_send_capture_stats(kis_capture_handler_t *caph) {
+    KismetDatasource__DataReport kedata;
+    KismetDatasource__SubCaptureStats kestats;
+
+    uint8_t *buf;
+    size_t buf_len;
+
+    kismet_datasource__data_report__init(&kedata);
+    kismet_datasource__sub_capture_stats__init(&kestats);
+
+    pthread_mutex_lock(&(caph->handler_lock));
+    kestats.has_kernel_packets = kestats.has_kernel_drops = caph->has_kernel_stats;
+    kestats.kernel_packets = caph->kernel_packets;
+    kestats.kernel_drops = caph->kernel_drops;
+    pthread_mutex_unlock(&(caph->handler_lock));
+
+    kestats.has_ringbuf_full = 1;
+    kestats.ringbuf_full = __atomic_load_n(&caph->ringbuf_full, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&(caph->handler_lock));
+    if (caph->hop_count != 0) {
+        kestats.has_hop_count = kestats.has_hop_dwell_usec = 
+            kestats.has_hop_dwell_error_usec = kestats.has_hop_switch_usec =
+            kestats.has_hop_switch_max_usec = 1;
+        kestats.hop_count = caph->hop_count;
+        kestats.hop_dwell_usec = caph->hop_dwell_total_usec;
+        kestats.hop_dwell_error_usec = caph->hop_dwell_error_total_usec;
+        kestats.hop_switch_usec = caph->hop_switch_total_usec;
+        kestats.hop_switch_max_usec = caph->hop_switch_max_usec;
+    }
+    pthread_mutex_unlock(&(caph->handler_lock));
+
+    kedata.capture_stats = &kestats;
+
+    buf_len = kismet_datasource__data_report__get_packed_size(&kedata);
+    buf = (uint8_t *) malloc(buf_len);
+
+    if (buf == NULL)
+        return -1;
+
+    kismet_datasource__data_report__pack(&kedata, buf);
+
+    return cf_send_packet(caph, "KDSDATAREPORT", buf, buf_len);
+}
+
 double cf_parse_frequency(const char *freq) {
     char *ufreq;
     unsigned int i;
@@ -3705,9 +5475,114 @@ int cf_jail_filesystem(kis_capture_handler_t *caph) {
 #endif
 }
 
+/* Connect a handler to the remote server, over tcp or by preparing the websockets
+ * context; returns 0 or the exit code for the failure */
+static int cf_int_remote_connect(kis_capture_handler_t *caph) {
+    if (caph->use_tcp) {
+        if (cf_handler_tcp_remote_connect(caph) < 1)
+            return KIS_EXTERNAL_RETCODE_TCP;
+    } else {
+#ifdef HAVE_LIBWEBSOCKETS
+        /* Prepare the libwebsockets ssl and context, but let the main connection callback 
+         * via the main lws_service loop */
+
+        memset(&caph->lwsinfo, 0, sizeof(struct lws_context_creation_info));
+
+        caph->lwsinfo.user = caph;
+
+        if (caph->lwsusessl)
+            caph->lwsinfo.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
+
+        if (caph->lwssslcapath != NULL)
+            caph->lwsinfo.client_ssl_ca_filepath = caph->lwssslcapath;
+
+        caph->lwsinfo.port = CONTEXT_PORT_NO_LISTEN;
+        caph->lwsinfo.protocols = kismet_lws_protocols;
+
+        /* Should only need to be 2 but lets be safe for now */
+        caph->lwsinfo.fd_limit_per_thread = 10;
+
+        caph->lwscontext = lws_create_context(&caph->lwsinfo);
+        if (!caph->lwscontext) {
+            fprintf(stderr, "FATAL:  Could not create websockets context\n");
+            return KIS_EXTERNAL_RETCODE_WEBSOCKET;
+        }
+#else
+        fprintf(stderr, "FATAL:  Not compiled with websocket support\n");
+        return KIS_EXTERNAL_RETCODE_WSCOMPILE;
+#endif
+    }
+
+    return 0;
+}
+
+/* Create and connect a handler for each additional --source; each gets a copy of the
+ * remote options of the handler which parsed the command line.  Returns 0 or the exit
+ * code for the failure */
+static int cf_int_connect_sub_handlers(kis_capture_handler_t *caph) {
+    kis_capture_handler_t *sub;
+    size_t szi;
+    int r;
+
+    if (caph->num_extra_sourcedefs == 0)
+        return 0;
+
+    caph->sub_handlers = (kis_capture_handler_t **) 
+        malloc(sizeof(kis_capture_handler_t *) * caph->num_extra_sourcedefs);
+
+    if (caph->sub_handlers == NULL) {
+        fprintf(stderr, "FATAL:  Could not allocate handlers for additional sources\n");
+        return KIS_EXTERNAL_RETCODE_ARGUMENTS;
+    }
+
+    for (szi = 0; szi < caph->num_extra_sourcedefs; szi++) {
+        sub = (*(caph->newhandler_cb))(caph);
+
+        if (sub == NULL) {
+            fprintf(stderr, "FATAL:  Could not create handler for source '%s'\n",
+                    caph->extra_sourcedefs[szi]);
+            return KIS_EXTERNAL_RETCODE_ARGUMENTS;
+        }
+
+        caph->sub_handlers[caph->num_sub_handlers++] = sub;
+
+        sub->parent_handler = caph;
+        sub->cli_sourcedef = strdup(caph->extra_sourcedefs[szi]);
+
+        sub->remote_host = strdup(caph->remote_host);
+        sub->remote_port = caph->remote_port;
+        sub->remote_retry = caph->remote_retry;
+        sub->use_tcp = caph->use_tcp;
+        sub->use_ws = caph->use_ws;
+        sub->verbose = caph->verbose;
+
+        sub->gps_fixed_lat = caph->gps_fixed_lat;
+        sub->gps_fixed_lon = caph->gps_fixed_lon;
+        sub->gps_fixed_alt = caph->gps_fixed_alt;
+        if (caph->gps_name != NULL)
+            sub->gps_name = strdup(caph->gps_name);
+
+#ifdef HAVE_LIBWEBSOCKETS
+        sub->lwsusessl = caph->lwsusessl;
+        if (caph->lwssslcapath != NULL)
+            sub->lwssslcapath = strdup(caph->lwssslcapath);
+        if (caph->lwsuri != NULL)
+            sub->lwsuri = strdup(caph->lwsuri);
+#endif
+
+        if ((r = cf_int_remote_connect(sub)) != 0)
+            return r;
+    }
+
+    return 0;
+}
+
 void cf_handler_remote_capture(kis_capture_handler_t *caph) {
     pid_t chpid;
     int status;
+    int r;
+    int failed = 0;
+    int *migrating;
 
     /* If we're going into daemon mode, fork-exec and drop out here */
     if (caph->daemonize) {
@@ -3729,10 +5604,26 @@ void cf_handler_remote_capture(kis_capture_handler_t *caph) {
         return;
     }
 
+    /* Migrating between servers relies on the retry process to reconnect */
+    if (caph->remote_retry && caph->num_remote_servers > 1) {
+        migrating = (int *) mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE, 
+                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+        if (migrating == MAP_FAILED) {
+            fprintf(stderr, "WARNING: Could not allocate migration state, sources will "
+                    "not migrate between servers: %s\n", strerror(errno));
+        } else {
+            *migrating = 0;
+            caph->remote_migrating = migrating;
+        }
+    }
+
     while (1) {
         caph->spindown = 0;
         caph->shutdown = 0;
 
+        cf_int_select_remote_server(caph, failed);
+
         if (caph->remote_retry && (chpid = fork()) > 0) {
             while (1) {
                 pid_t wpid;
@@ -3748,42 +5639,12 @@ void cf_handler_remote_capture(kis_capture_handler_t *caph) {
                 }
             }
         } else {
-            if (caph->use_tcp) {
-                if (cf_handler_tcp_remote_connect(caph) < 1) {
-                    exit(KIS_EXTERNAL_RETCODE_TCP);
-                }
-            } else {
-#ifdef HAVE_LIBWEBSOCKETS
-                /* Prepare the libwebsockets ssl and context, but let the main connection callback 
-                 * via the main lws_service loop */
-
-                memset(&caph->lwsinfo, 0, sizeof(struct lws_context_creation_info));
-
-                caph->lwsinfo.user = caph;
-
-                if (caph->lwsusessl)
-                    caph->lwsinfo.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
-
-                if (caph->lwssslcapath != NULL)
-                    caph->lwsinfo.client_ssl_ca_filepath = caph->lwssslcapath;
-
-                caph->lwsinfo.port = CONTEXT_PORT_NO_LISTEN;
-                caph->lwsinfo.protocols = kismet_lws_protocols;
-
-                /* Should only need to be 2 but lets be safe for now */
-                caph->lwsinfo.fd_limit_per_thread = 10;
-
-                caph->lwscontext = lws_create_context(&caph->lwsinfo);
-                if (!caph->lwscontext) {
-                    fprintf(stderr, "FATAL:  Could not create websockets context\n");
-                    exit(KIS_EXTERNAL_RETCODE_WEBSOCKET);
-                }
+            if ((r = cf_int_remote_connect(caph)) != 0)
+                exit(r);
 
-#else
-                fprintf(stderr, "FATAL:  Not compiled with websocket support\n");
-                exit(KIS_EXTERNAL_RETCODE_WSCOMPILE);
-#endif
-            }
+            /* Bring up any additional sources in this same process */
+            if ((r = cf_int_connect_sub_handlers(caph)) != 0)
+                exit(r);
 
             /* Exit so main loop continues */
             return;
@@ -3794,6 +5655,14 @@ void cf_handler_remote_capture(kis_capture_handler_t *caph) {
             exit(1);
         }
 
+        if (caph->remote_migrating != NULL && *(caph->remote_migrating)) {
+            *(caph->remote_migrating) = 0;
+            failed = 0;
+            continue;
+        }
+
+        failed = 1;
+
         fprintf(stderr, "INFO: Sleeping 5 seconds before attempting to reconnect to "
                 "remote server\n");
         sleep(5);
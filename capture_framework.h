@@ -38,6 +38,7 @@
 #include "config.h"
 
 #include <getopt.h>
+#include <zlib.h>
 #include <pthread.h>
 #include <fcntl.h>
 
@@ -48,6 +49,7 @@
 #include <sys/time.h>
 #include <sys/types.h>
 
+#include <time.h>
 #include <unistd.h>
 #include <errno.h>
 
@@ -253,6 +255,19 @@ typedef int (*cf_callback_spectrumconfig)(kis_capture_handler_t *, uint32_t seqn
     unsigned int amp, uint64_t if_amp, uint64_t baseband_amp, 
     KismetExternal__Command *command);
 
+/* New handler callback
+ * Creates a handler for an additional --source when one remote capture process drives
+ * several sources.  The new handler should use the same callbacks as caph, with its own
+ * userdata; the framework copies the remote connection options into it.
+ *
+ * Each handler runs its own capture and hopping threads and its own connection to the
+ * server, so each source is a separate datasource in Kismet.
+ *
+ * Returns:
+ *      A new handler, or NULL if one could not be created
+ */
+typedef kis_capture_handler_t *(*cf_callback_newhandler)(kis_capture_handler_t *caph);
+
 struct kis_capture_handler {
     /* Capture source type */
     char *capsource_type;
@@ -279,11 +294,30 @@ struct kis_capture_handler {
     /* Use websockets mode */
     int use_ws;
 
+    /* Send data frames as v3 frames with numeric command ids; negotiated by the server
+     * in KDSOPENSOURCE */
+    int use_v3;
+
     /* Remote host and port if acting as a remote drone in TCP mode, also used to
      * synthesize the websocket info */
     char *remote_host;
     unsigned int remote_port;
 
+    /* Every server given to --connect; with more than one, the helper connects to the
+     * server reporting the lowest load and migrates away from a saturated server */
+    char **remote_servers;
+    unsigned int *remote_server_ports;
+    size_t num_remote_servers;
+    size_t remote_server_idx;
+
+    /* Seconds between load checks while connected, 0 to never migrate */
+    unsigned int remote_balance_interval;
+    time_t remote_last_balance;
+
+    /* Shared with the retry process; set when the capture process leaves its server to
+     * migrate, so it reconnects without waiting */
+    volatile int *remote_migrating;
+
     /* Remote host for websocket api */
 #ifdef HAVE_LIBWEBSOCKETS
     struct lws_context *lwscontext;
@@ -315,6 +349,14 @@ struct kis_capture_handler {
     /* Specified commandline source, used for remote cap */
     char *cli_sourcedef;
 
+    /* Additional commandline sources, and the handlers driving them from this process
+     * once connected; sub-handlers point back to the handler which launched them */
+    char **extra_sourcedefs;
+    size_t num_extra_sourcedefs;
+    struct kis_capture_handler **sub_handlers;
+    size_t num_sub_handlers;
+    struct kis_capture_handler *parent_handler;
+
     /* Retry remote connections */
     int remote_retry;
 
@@ -331,6 +373,13 @@ struct kis_capture_handler {
     kis_simple_ringbuf_t *in_ringbuf;
     kis_simple_ringbuf_t *out_ringbuf;
 
+    /* Shared memory ring offered by the server in IPC mode; when attached, frames are
+     * written directly into the ring instead of out_ringbuf */
+    struct kismet_external_shm_ring *shm_ring;
+    uint8_t *shm_data;
+    size_t shm_map_sz;
+    uint64_t shm_reserve_head;
+
     /* websocket packet queue */
 #ifdef HAVE_LIBWEBSOCKETS
     struct lws_ring *ring;
@@ -345,6 +394,54 @@ struct kis_capture_handler {
     pthread_cond_t out_ringbuf_flush_cond;
     pthread_mutex_t out_ringbuf_flush_cond_mutex;
 
+    /* out_ringbuf_lock only serializes the writers; the IO loop is the only reader of 
+     * out_ringbuf and reads it without the lock.  On Linux a writer wakes a sleeping IO
+     * loop through out_data_efd, and the IO loop wakes a writer waiting for space 
+     * through out_space_efd; either side only makes the call when the other side has 
+     * flagged itself as waiting. */
+    int out_data_efd, out_space_efd;
+    int out_reader_waiting, out_writer_waiting;
+
+    /* Batched data frames, negotiated by the server in KDSOPENSOURCE; plain packets
+     * are accumulated in batch_buf and sent as a single KDSDATABATCH frame when the
+     * batch is full or batch_flush_usec has passed since the first packet was added.
+     * batch_max_bytes is 0 when batching is disabled. */
+    pthread_mutex_t batch_lock;
+    pthread_cond_t batch_cond;
+    uint8_t *batch_buf;
+    size_t batch_max_bytes;
+    size_t batch_len;
+    unsigned int batch_count;
+    unsigned int batch_flush_usec;
+    struct timespec batch_deadline;
+    int batch_running;
+    int batch_shutdown;
+    pthread_t batchthread;
+
+    /* Compressed batches, negotiated by the server in KDSOPENSOURCE for TCP remote
+     * capture; when batch_z_enabled, batches are compressed with batch_zstrm and sent 
+     * as KDSDATABATCHZ frames.  batch_z_reset marks the first frame of a new stream.
+     * Protected by batch_lock. */
+    z_stream batch_zstrm;
+    int batch_z_init;
+    int batch_z_enabled;
+    int batch_z_reset;
+
+    /* Datagram transport of batches, negotiated by the server in KDSOPENSOURCE for TCP
+     * remote capture (see remote_announcement.h); when dgram_fd is open, batches are sent
+     * to the server as datagrams tagged with dgram_token instead of on the connection, 
+     * and a datagram the socket can't take right away is dropped.  Batches are limited to
+     * what fits in dgram_max_bytes and are never compressed.  Protected by batch_lock. */
+    int dgram_fd;
+    uint64_t dgram_token;
+    uint32_t dgram_seqno;
+    uint8_t *dgram_buf;
+    size_t dgram_max_bytes;
+
+    /* Only send the 802.11 headers of data frames, set by the data_headers_only
+     * source option */
+    int data_headers_only;
+
     /* Are we shutting down? */
     int shutdown;
     pthread_mutex_t handler_lock;
@@ -364,6 +461,8 @@ struct kis_capture_handler {
 
     cf_callback_spectrumconfig spectrumconfig_cb;
 
+    cf_callback_newhandler newhandler_cb;
+
     /* Arbitrary data blob for capture specific content */
     void *userdata;
 
@@ -386,11 +485,19 @@ struct kis_capture_handler {
     size_t channel_hop_list_sz;
     double channel_hop_rate;
 
+    /* Dwell of each channel in the hop list as a multiple of the hop period, the same
+     * length as the channel hop list, or NULL if every channel dwells one period */
+    double *channel_hop_dwell;
+
     /* Maximum hop rate; if 0, ignored, if not zero, hop commands are forced to this
      * rate.
      */
     double max_channel_hop_rate;
 
+    /* Measured time for a channel change to take effect, in microseconds, reported
+     * by the capture binary; read and written atomically */
+    unsigned long channel_set_latency_usec;
+
     /* Linked list of failed channel sets so we can flush the channel array out */
     void *channel_hop_failure_list;
     size_t channel_hop_failure_list_sz;
@@ -409,6 +516,25 @@ struct kis_capture_handler {
 
     /* Are we in remote/verbose mode */
     int verbose;
+
+    /* Loss counters reported to the server with each pong; the kernel counters are
+     * supplied by the capture driver, if it tracks them, under handler_lock.  
+     * ringbuf_full counts packets refused because the output ringbuffer was full, and
+     * is updated atomically. */
+    int has_kernel_stats;
+    uint64_t kernel_packets;
+    uint64_t kernel_drops;
+    uint64_t ringbuf_full;
+
+    /* Hop timing measured by the hop thread and reported with the capture stats, under
+     * handler_lock:  hops made, and the total actual dwell, total difference between
+     * the actual and scheduled dwell, total and longest time spent in the channel
+     * control callback, all in microseconds */
+    uint64_t hop_count;
+    uint64_t hop_dwell_total_usec;
+    uint64_t hop_dwell_error_total_usec;
+    uint64_t hop_switch_total_usec;
+    uint64_t hop_switch_max_usec;
 };
 
 
@@ -603,9 +729,21 @@ void cf_handler_assign_hop_channels(kis_capture_handler_t *caph, char **stringch
         void **privchans, size_t chan_sz, double rate, int shuffle, int shuffle_spacing, 
         int offset);
 
+/* Assign the dwell of each channel of the current hop list as a multiple of the hop
+ * rate; channels past the end of the dwell list, and all channels when a new hop list
+ * is assigned, dwell for one period.  The dwell list is copied. */
+void cf_handler_assign_hop_dwell(kis_capture_handler_t *caph, const double *dwell,
+        size_t dwell_sz);
+
 /* Set a channel hop shuffle spacing */
 void cf_handler_set_hop_shuffle_spacing(kis_capture_handler_t *capf, int spacing);
 
+/* Report the measured time a channel change takes to take effect.  The hop thread
+ * hops on a fixed schedule regardless of how long the channel control callback
+ * takes, and lengthens the dwell when the radio would otherwise spend more than a
+ * quarter of each hop switching. */
+void cf_handler_set_hop_latency(kis_capture_handler_t *caph, unsigned long latency_usec);
+
 
 /* Parse command line options
  *
@@ -644,6 +782,10 @@ void cf_handler_set_unknown_cb(kis_capture_handler_t *capf, cf_callback_unknown
 /* Set the capture function, which runs inside its own thread */
 void cf_handler_set_capture_cb(kis_capture_handler_t *capf, cf_callback_capture cb);
 
+/* Allow --source to be given multiple times for remote capture, creating a handler for
+ * each additional source with the callback */
+void cf_handler_set_newhandler_cb(kis_capture_handler_t *capf, cf_callback_newhandler cb);
+
 
 
 /* Set random data blob */
@@ -705,6 +847,10 @@ int cf_handler_ws_remote_connect(kis_capture_handler_t *caph);
  * Capture drivers should call this after configuring callbacks and parsing options,
  * but before dropping privileges, setting up any unique state inside the main loop,
  * or running cf_handler_loop.
+ *
+ * When several --source options were given, a handler is created and connected for
+ * each additional source; they share the process, and the retry loop restarts them
+ * together if any of them fails.
  */
 void cf_handler_remote_capture(kis_capture_handler_t *caph);
 
@@ -713,7 +859,9 @@ void cf_handler_remote_capture(kis_capture_handler_t *caph);
  *
  * Capture drivers should typically define their IO in a callback which will
  * be run in a thread automatically via cf_handler_set_capture_cb. 
- * cf_handler_loop() should be called in the main() function.
+ * cf_handler_loop() should be called in the main() function.  Additional
+ * sources run their own loops in their own threads; when any loop exits, the
+ * rest are shut down.
  *
  * Returns:
  * -1   Error, process should exit
@@ -835,6 +983,10 @@ int cf_send_openresp(kis_capture_handler_t *caph, uint32_t seq, unsigned int suc
  *
  * If present, include message_kv, signal_kv, or gps_kv along with the packet data.
  *
+ * If the server negotiated batching, packets without a message or GPS are queued
+ * into the current KDSDATABATCH frame, which is sent when it fills or when the
+ * batch flush timer expires.
+ *
  * Returns:
  * -1   An error occurred 
  *  0   Insufficient space in buffer
@@ -846,6 +998,16 @@ int cf_send_data(kis_capture_handler_t *caph,
         KismetDatasource__SubGps *kv_gps,
         struct timeval ts, uint32_t dlt, uint32_t packet_sz, uint8_t *pack);
 
+/* Send any pending batched packets
+ * Can be called from any thread
+ *
+ * Returns:
+ * -1   An error occurred
+ *  0   Insufficient space in buffer
+ *  1   Success, or nothing to send
+ */
+int cf_flush_batch(kis_capture_handler_t *caph);
+
 /* Send a DATA frame with JSON non-packet data
  * Can be called from any thread
  *
@@ -862,6 +1024,22 @@ int cf_send_json(kis_capture_handler_t *caph,
         KismetDatasource__SubGps *kv_gps,
         struct timeval ts, char *type, char *json);
 
+/* Send a spectrum sweep, or one segment of a sweep, as a binary KDSSPECTRUM frame
+ * Can be called from any thread
+ *
+ * bins holds num_bins dBm values starting at start_hz, each bin_hz wide; every
+ * segment of the same sweep should have the same sweep counter.  When as_int8 is set
+ * the bins are sent in half-dB steps from -128 to -0.5 dBm, at a quarter of the size.
+ *
+ * Returns:
+ * -1   An error occurred
+ *  0   Insufficient space in buffer, try again
+ *  1   Success
+ */
+int cf_send_spectrum(kis_capture_handler_t *caph, struct timeval ts, uint32_t sweep,
+        uint64_t start_hz, uint32_t bin_hz, const float *bins, uint32_t num_bins,
+        int as_int8);
+
 /* Send a CONFIGRESP with only a success and optional message
  *
  * Returns:
@@ -890,6 +1068,22 @@ int cf_send_ping(kis_capture_handler_t *caph);
  */
 int cf_send_pong(kis_capture_handler_t *caph, uint32_t in_seqno);
 
+/* Update the kernel capture counters, as totals since the capture opened; they are 
+ * sent to the server periodically along with the ringbuffer overflow count
+ * Can be called from any thread
+ */
+void cf_handler_set_kernel_stats(kis_capture_handler_t *caph, uint64_t packets,
+        uint64_t drops);
+
+/* Send the capture loss counters as a DATA frame
+ *
+ * Returns:
+ * -1   An error occurred
+ *  0   Insufficient space in buffer
+ *  1   Success
+ */
+int cf_send_capture_stats(kis_capture_handler_t *caph);
+
 /* Send a NEWSOURCE command to initiate connecting to a remote server
  *
  * Returns:
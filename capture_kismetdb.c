@@ -19,6 +19,14 @@
 /* capture_kismetdb
  *
  * Basic capture binary for reading kismetdb logfiles.
+ *
+ * Source options:
+ *  realtime=true       Replay with the original timing between packets
+ *  pps=N               Throttle the replay to N packets per second
+ *  fast=true           Replay as fast as the server accepts packets
+ *  dedupe=true         Skip packets which have already been replayed
+ *  merge="a,b"         Merge additional kismetdb logs into the replay, by time
+ *  prefetch=N          Rows read ahead per batch from each log
  */
 
 #include <pcap.h>
@@ -46,6 +54,68 @@
 
 #include <sqlite3.h>
 
+/* Rows read ahead per batch, and batches queued per source, by the prefetch threads */
+#define KISMETDB_PREFETCH_ROWS      1024
+#define KISMETDB_PREFETCH_BATCHES   4
+
+/* Slots in the recent duplicate cache; must be a power of 2 */
+#define KISMETDB_DUPE_SLOTS         65536
+
+/* A packet or data record copied out of a kismetdb */
+typedef struct {
+    int is_data;
+
+    long ts_sec;
+    long ts_usec;
+
+    double lat, lon, alt, speed, heading;
+
+    unsigned int dlt;
+    uint32_t len;
+
+    /* Packet content, or the json of a data record */
+    uint8_t *content;
+    char *type;
+
+    /* crc32 of the packet and the packet id shared by duplicates, when logged */
+    uint32_t hash;
+    int64_t packetid;
+} kismetdb_row_t;
+
+typedef struct kismetdb_batch {
+    kismetdb_row_t *rows;
+    size_t n_rows;
+    struct kismetdb_batch *next;
+} kismetdb_batch_t;
+
+/* A kismetdb being replayed.  Each source has a prefetch thread which steps the 
+ * packet and data queries, merges them by time, and copies the rows out in batches, 
+ * so the database work runs alongside the merge and the IPC sends in the capture
+ * thread. */
+typedef struct {
+    sqlite3 *db;
+    char *dbname;
+    int db_version;
+    unsigned int index;
+    unsigned int batch_rows;
+
+    pthread_t thread;
+    int thread_running;
+
+    /* Queue of batches, protected by lock */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    kismetdb_batch_t *head;
+    kismetdb_batch_t *tail;
+    unsigned int n_batches;
+    int done;
+    char *error;
+
+    /* Batch being consumed by the capture thread */
+    kismetdb_batch_t *cur;
+    size_t cur_pos;
+} kismetdb_source_t;
+
 typedef struct {
     sqlite3 *db;
     char *dbname;
@@ -61,6 +131,24 @@ typedef struct {
     struct timeval last_ts;
 
     unsigned int pps_throttle;
+
+    /* Replay as fast as the server accepts packets; packets without a location are 
+     * sent without a GPS record so they can travel in batch frames */
+    int fast;
+
+    /* Skip packets already replayed, either logged again as a duplicate from another 
+     * datasource or present in more than one of the merged logs */
+    int dedupe;
+    uint64_t *dupe_table;
+    unsigned long dupes_skipped;
+
+    unsigned int batch_rows;
+
+    /* Additional kismetdb logs merged by time with the primary log */
+    char **merge_names;
+    sqlite3 **merge_dbs;
+    int *merge_versions;
+    size_t n_merge;
 } local_pcap_t;
 
 /* Version callback */
@@ -77,6 +165,69 @@ int sqlite_version_cb(void *ver, int argc, char **data, char **colnames) {
     return 0;
 }
 
+/* Open an additional kismetdb to merge into the replay, and fetch its version */
+int kismetdb_open_merge(const char *dbname, sqlite3 **db, int *db_version, char *msg) {
+    struct stat sbuf;
+    char *sErrMsg = NULL;
+    int sql_r;
+
+    *db = NULL;
+    *db_version = 0;
+
+    if (stat(dbname, &sbuf) < 0) {
+        snprintf(msg, STATUS_MAX, "Could not stat() merged kismetdb '%s': %s", 
+                dbname, strerror(errno));
+        return -1;
+    }
+
+    if (!S_ISREG(sbuf.st_mode)) {
+        snprintf(msg, STATUS_MAX, "Merged kismetdb '%s' is not a normal file", dbname);
+        return -1;
+    }
+
+    sql_r = sqlite3_open_v2(dbname, db, SQLITE_OPEN_READONLY, NULL);
+    if (sql_r) {
+        snprintf(msg, STATUS_MAX, "Unable to open merged kismetdb '%s': %s", 
+                dbname, sqlite3_errmsg(*db));
+        sqlite3_close(*db);
+        *db = NULL;
+        return -1;
+    }
+
+    sql_r = sqlite3_exec(*db, "SELECT db_version FROM KISMET", sqlite_version_cb, 
+            db_version, &sErrMsg);
+    if (sql_r != SQLITE_OK || *db_version == 0) {
+        snprintf(msg, STATUS_MAX, "Unable to find kismetdb version in merged database %s: %s", 
+                dbname, sqlite3_errmsg(*db));
+        sqlite3_free(sErrMsg);
+        sqlite3_close(*db);
+        *db = NULL;
+        return -1;
+    }
+
+    return 1;
+}
+
+void kismetdb_free_merge(local_pcap_t *local_pcap) {
+    size_t i;
+
+    for (i = 0; i < local_pcap->n_merge; i++) {
+        free(local_pcap->merge_names[i]);
+
+        if (local_pcap->merge_dbs[i] != NULL)
+            sqlite3_close(local_pcap->merge_dbs[i]);
+    }
+
+    free(local_pcap->merge_names);
+    free(local_pcap->merge_dbs);
+    free(local_pcap->merge_versions);
+
+    local_pcap->merge_names = NULL;
+    local_pcap->merge_dbs = NULL;
+    local_pcap->merge_versions = NULL;
+    local_pcap->n_merge = 0;
+}
+
 int probe_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
         char *msg, char **uuid, KismetExternal__Command *frame,
         cf_params_interface_t **ret_interface, 
@@ -196,6 +347,8 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
         local_pcap->db = NULL;
     }
 
+    kismetdb_free_merge(local_pcap);
+
     if ((placeholder_len = cf_parse_interface(&placeholder, definition)) <= 0) {
         /* What was not an error during probe definitely is an error during open */
         snprintf(msg, STATUS_MAX, "Unable to find PCAP file name in definition");
@@ -262,6 +415,77 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
         }
     }
 
+    if ((placeholder_len = cf_find_flag(&placeholder, "fast", definition)) > 0) {
+        if (strncasecmp(placeholder, "true", placeholder_len) == 0) {
+            if (local_pcap->realtime || local_pcap->pps_throttle) {
+                snprintf(errstr, 4096,
+                        "kismetdb '%s' will replay as fast as possible, ignoring the "
+                        "realtime and pps options", dbname);
+            } else {
+                snprintf(errstr, 4096,
+                        "kismetdb '%s' will replay as fast as possible", dbname);
+            }
+            cf_send_message(caph, errstr, MSGFLAG_INFO);
+
+            local_pcap->fast = 1;
+            local_pcap->realtime = 0;
+            local_pcap->pps_throttle = 0;
+        }
+    }
+
+    if ((placeholder_len = cf_find_flag(&placeholder, "dedupe", definition)) > 0) {
+        if (strncasecmp(placeholder, "true", placeholder_len) == 0) {
+            snprintf(errstr, 4096,
+                    "kismetdb '%s' will skip duplicate packets", dbname);
+            cf_send_message(caph, errstr, MSGFLAG_INFO);
+            local_pcap->dedupe = 1;
+        }
+    }
+
+    if ((placeholder_len = cf_find_flag(&placeholder, "prefetch", definition)) > 0) {
+        unsigned int rows;
+        if (sscanf(placeholder, "%u", &rows) == 1 && rows > 0) {
+            local_pcap->batch_rows = rows;
+        } else {
+            snprintf(msg, STATUS_MAX, "Invalid prefetch= option, expected a number of rows");
+            return -1;
+        }
+    }
+
+    if ((placeholder_len = cf_find_flag(&placeholder, "merge", definition)) > 0) {
+        char **merge_list = NULL;
+        size_t merge_sz = 0;
+        size_t i;
+
+        if (cf_split_list(placeholder, placeholder_len, ',', &merge_list, &merge_sz) < 0) {
+            snprintf(msg, STATUS_MAX, "Unable to parse merge= list of kismetdb files");
+            return -1;
+        }
+
+        local_pcap->merge_names = merge_list;
+        local_pcap->merge_dbs = (sqlite3 **) calloc(merge_sz, sizeof(sqlite3 *));
+        local_pcap->merge_versions = (int *) calloc(merge_sz, sizeof(int));
+        local_pcap->n_merge = merge_sz;
+
+        if (local_pcap->merge_dbs == NULL || local_pcap->merge_versions == NULL) {
+            snprintf(msg, STATUS_MAX, "Unable to allocate merged kismetdb list");
+            kismetdb_free_merge(local_pcap);
+            return -1;
+        }
+
+        for (i = 0; i < merge_sz; i++) {
+            if (kismetdb_open_merge(merge_list[i], &local_pcap->merge_dbs[i], 
+                        &local_pcap->merge_versions[i], msg) < 0) {
+                kismetdb_free_merge(local_pcap);
+                return -1;
+            }
+        }
+
+        snprintf(errstr, 4096, "kismetdb '%s' will be merged with %lu other kismetdb logs",
+                dbname, (unsigned long) merge_sz);
+        cf_send_message(caph, errstr, MSGFLAG_INFO);
+    }
+
     return 1;
 }
 
@@ -275,9 +499,15 @@ void kismetdb_dispatch_packet_cb(u_char *user, long ts_sec, long ts_usec,
     unsigned long delay_usec = 0;
 
     KismetDatasource__SubGps kegps;
+    KismetDatasource__SubGps *gps = &kegps;
 
     kismet_datasource__sub_gps__init(&kegps);
 
+    /* A fast replay sends packets with no location as plain packets, which the 
+     * framework can queue into batch frames */
+    if (local_pcap->fast && lat == 0 && lon == 0)
+        gps = NULL;
+
     /* If we're doing 'realtime' playback, delay accordingly based on the
      * previous packet. 
      *
@@ -345,7 +575,7 @@ void kismetdb_dispatch_packet_cb(u_char *user, long ts_sec, long ts_usec,
      * data out in the main select() loop */
     while (1) {
         if ((ret = cf_send_data(caph, 
-                        NULL, NULL, &kegps,
+                        NULL, NULL, gps,
                         ts, 
                         dlt,
                         len, (uint8_t *) data)) < 0) {
@@ -467,39 +697,103 @@ void kismetdb_dispatch_data_cb(u_char *user, long ts_sec, long ts_usec,
         free(kegps.type);
 }
 
-void capture_thread(kis_capture_handler_t *caph) {
-    local_pcap_t *local_pcap = (local_pcap_t *) caph->userdata;
+void kismetdb_free_batch(kismetdb_batch_t *batch) {
+    size_t i;
 
-    char errstr[4096];
+    for (i = 0; i < batch->n_rows; i++) {
+        free(batch->rows[i].content);
+        free(batch->rows[i].type);
+    }
 
-    int sql_r;
+    free(batch->rows);
+    free(batch);
+}
 
-    sqlite3_stmt *packet_stmt = NULL;
-    const char *packet_pz = NULL;
+/* Copy the current row of a packet query; the columns after the timestamp depend on
+ * the database version and whether the duplicate columns were found */
+void kismetdb_copy_packet(kismetdb_source_t *src, sqlite3_stmt *stmt, int with_ids,
+        kismetdb_row_t *row) {
+    int colno = 2;
+    const void *blob;
 
-    sqlite3_stmt *data_stmt = NULL;
-    const char *data_pz = NULL;
+    row->is_data = 0;
+    row->ts_sec = sqlite3_column_int64(stmt, 0);
+    row->ts_usec = sqlite3_column_int64(stmt, 1);
 
-    int packet_r, data_r;
+    /* frequency */
+    colno++;
+
+    row->lat = sqlite3_column_double(stmt, colno++);
+    row->lon = sqlite3_column_double(stmt, colno++);
+
+    if (src->db_version >= 5) {
+        row->alt = sqlite3_column_double(stmt, colno++);
+        row->speed = sqlite3_column_double(stmt, colno++);
+        row->heading = sqlite3_column_double(stmt, colno++);
+    }
 
-    /* Common between both packets and data */
-    double lat = 0, lon = 0, alt = 0, speed = 0, heading = 0;
+    row->dlt = sqlite3_column_int(stmt, colno++);
 
-    /* Last packet timestamp */
-    long packet_ts_sec, packet_ts_usec;
+    blob = sqlite3_column_blob(stmt, colno);
+    row->len = sqlite3_column_bytes(stmt, colno++);
 
-    /* Packet data */
-    unsigned int packet_len;
-    const void *packet_data;
-    double packet_frequency;
-    int dlt;
+    if (blob != NULL && row->len > 0) {
+        row->content = (uint8_t *) malloc(row->len);
 
-    /* Last data timestamp */
-    long data_ts_sec, data_ts_usec;
+        if (row->content != NULL)
+            memcpy(row->content, blob, row->len);
+        else
+            row->len = 0;
+    }
+
+    if (with_ids) {
+        row->hash = (uint32_t) sqlite3_column_int64(stmt, colno++);
+        row->packetid = sqlite3_column_int64(stmt, colno++);
+    }
+}
 
-    /* Data... data... */
-    char *data_type = NULL;
-    char *data_json = NULL;
+void kismetdb_copy_data(kismetdb_source_t *src, sqlite3_stmt *stmt, kismetdb_row_t *row) {
+    int colno = 2;
+    const unsigned char *text;
+
+    row->is_data = 1;
+    row->ts_sec = sqlite3_column_int64(stmt, 0);
+    row->ts_usec = sqlite3_column_int64(stmt, 1);
+
+    row->lat = sqlite3_column_double(stmt, colno++);
+    row->lon = sqlite3_column_double(stmt, colno++);
+
+    if (src->db_version >= 5) {
+        row->alt = sqlite3_column_double(stmt, colno++);
+        row->speed = sqlite3_column_double(stmt, colno++);
+        row->heading = sqlite3_column_double(stmt, colno++);
+    }
+
+    text = sqlite3_column_text(stmt, colno++);
+    row->type = strdup(text != NULL ? (const char *) text : "");
+
+    text = sqlite3_column_text(stmt, colno++);
+    row->content = (uint8_t *) strdup(text != NULL ? (const char *) text : "");
+}
+
+/* Prefetch thread for one source; steps the packet and data queries, merging the 
+ * timelines of the two tables, and queues the rows in batches */
+void *kismetdb_prefetch_thread(void *arg) {
+    kismetdb_source_t *src = (kismetdb_source_t *) arg;
+
+    char errstr[4096] = "";
+
+    sqlite3_stmt *packet_stmt = NULL;
+    sqlite3_stmt *data_stmt = NULL;
+
+    int packet_r, data_r;
+    int sql_r;
+    int with_ids = 0;
+
+    kismetdb_batch_t *batch;
+    kismetdb_row_t *row;
+
+    int take_packet;
 
     /* V4 didn't have speed, heading, etc, and used the normalized encoding */
     const char *basic_packet_sql_v4 = 
@@ -507,144 +801,336 @@ void capture_thread(kis_capture_handler_t *caph) {
 
     const char *basic_data_sql_v4 =
         "SELECT ts_sec, ts_usec, (lat / 100000.0), (lon / 100000.0), type, json FROM data ORDER BY ts_sec, ts_usec";
-    
    
     /* V5 has full GPS, and in natural doubles */
     const char *basic_packet_sql_v5 = 
         "SELECT ts_sec, ts_usec, frequency, lat, lon, alt, speed, heading, dlt, packet FROM packets ORDER BY ts_sec, ts_usec";
 
+    /* Newer logs also record the packet hash and the packet id shared by duplicates */
+    const char *ids_packet_sql_v5 = 
+        "SELECT ts_sec, ts_usec, frequency, lat, lon, alt, speed, heading, dlt, packet, hash, packetid FROM packets ORDER BY ts_sec, ts_usec";
+
     const char *basic_data_sql_v5 =
         "SELECT ts_sec, ts_usec, lat, lon, alt, speed, heading, type, json FROM data ORDER BY ts_sec, ts_usec";
 
-    int colno;
+    if (src->db_version <= 4) {
+        sql_r = sqlite3_prepare_v2(src->db, basic_packet_sql_v4, -1, &packet_stmt, NULL);
+    } else {
+        sql_r = sqlite3_prepare_v2(src->db, ids_packet_sql_v5, -1, &packet_stmt, NULL);
 
-    if (local_pcap->db_version <= 4) {
-        sql_r = sqlite3_prepare(local_pcap->db, basic_packet_sql_v4, strlen(basic_packet_sql_v4), &packet_stmt, &packet_pz);
-    } else if (local_pcap->db_version >= 5) {
-        sql_r = sqlite3_prepare(local_pcap->db, basic_packet_sql_v5, strlen(basic_packet_sql_v5), &packet_stmt, &packet_pz);
-    }  else {
-        sql_r = SQLITE_ERROR;
+        if (sql_r == SQLITE_OK)
+            with_ids = 1;
+        else
+            sql_r = sqlite3_prepare_v2(src->db, basic_packet_sql_v5, -1, &packet_stmt, NULL);
     }
 
     if (sql_r != SQLITE_OK) {
         snprintf(errstr, 4096, "KismetDB '%s' could not prepare packet query: %s",
-                local_pcap->dbname, sqlite3_errmsg(local_pcap->db));
-        cf_send_error(caph, 0, errstr);
-        return;
+                src->dbname, sqlite3_errmsg(src->db));
+        goto done;
     }
 
-    if (local_pcap->db_version <= 4) {
-        sql_r = sqlite3_prepare(local_pcap->db, basic_data_sql_v4, strlen(basic_data_sql_v4), &data_stmt, &data_pz);
-    } else if (local_pcap->db_version >= 5) {
-        sql_r = sqlite3_prepare(local_pcap->db, basic_data_sql_v5, strlen(basic_data_sql_v5), &data_stmt, &data_pz);
-    }  else {
-        sql_r = SQLITE_ERROR;
+    if (src->db_version <= 4) {
+        sql_r = sqlite3_prepare_v2(src->db, basic_data_sql_v4, -1, &data_stmt, NULL);
+    } else {
+        sql_r = sqlite3_prepare_v2(src->db, basic_data_sql_v5, -1, &data_stmt, NULL);
     }
 
     if (sql_r != SQLITE_OK) {
         snprintf(errstr, 4096, "KismetDB '%s' could not prepare data query: %s",
-                local_pcap->dbname, sqlite3_errmsg(local_pcap->db));
-        cf_send_error(caph, 0, errstr);
-        return;
+                src->dbname, sqlite3_errmsg(src->db));
+        goto done;
     }
 
-    sql_r = sqlite3_reset(packet_stmt);
-    if (sql_r != SQLITE_OK) {
-        snprintf(errstr, 4096, "KismetDB '%s' could not prepare packet query: %s",
-                local_pcap->dbname, sqlite3_errmsg(local_pcap->db));
-        cf_send_error(caph, 0, errstr);
-        return;
+    packet_r = sqlite3_step(packet_stmt);
+    data_r = sqlite3_step(data_stmt);
+
+    while (packet_r == SQLITE_ROW || data_r == SQLITE_ROW) {
+        batch = (kismetdb_batch_t *) calloc(1, sizeof(kismetdb_batch_t));
+
+        if (batch != NULL)
+            batch->rows = (kismetdb_row_t *) calloc(src->batch_rows, sizeof(kismetdb_row_t));
+
+        if (batch == NULL || batch->rows == NULL) {
+            free(batch);
+            snprintf(errstr, 4096, "KismetDB '%s' could not allocate prefetch batch",
+                    src->dbname);
+            goto done;
+        }
+
+        while (batch->n_rows < src->batch_rows && 
+                (packet_r == SQLITE_ROW || data_r == SQLITE_ROW)) {
+            row = &batch->rows[batch->n_rows++];
+
+            /* Merge the timelines of the two tables; if the packet comes first process it, 
+             * otherwise process the data, and repeat */
+            if (packet_r != SQLITE_ROW) {
+                take_packet = 0;
+            } else if (data_r != SQLITE_ROW) {
+                take_packet = 1;
+            } else {
+                long p_sec = sqlite3_column_int64(packet_stmt, 0);
+                long p_usec = sqlite3_column_int64(packet_stmt, 1);
+                long d_sec = sqlite3_column_int64(data_stmt, 0);
+                long d_usec = sqlite3_column_int64(data_stmt, 1);
+
+                take_packet = p_sec < d_sec || (p_sec == d_sec && p_usec <= d_usec);
+            }
+
+            if (take_packet) {
+                kismetdb_copy_packet(src, packet_stmt, with_ids, row);
+                packet_r = sqlite3_step(packet_stmt);
+            } else {
+                kismetdb_copy_data(src, data_stmt, row);
+                data_r = sqlite3_step(data_stmt);
+            }
+        }
+
+        pthread_mutex_lock(&src->lock);
+
+        while (src->n_batches >= KISMETDB_PREFETCH_BATCHES)
+            pthread_cond_wait(&src->cond, &src->lock);
+
+        if (src->tail != NULL)
+            src->tail->next = batch;
+        else
+            src->head = batch;
+        src->tail = batch;
+        src->n_batches++;
+
+        pthread_cond_broadcast(&src->cond);
+        pthread_mutex_unlock(&src->lock);
     }
 
-    sql_r = sqlite3_reset(data_stmt);
-    if (sql_r != SQLITE_OK) {
-        snprintf(errstr, 4096, "KismetDB '%s' could not prepare data query: %s",
-                local_pcap->dbname, sqlite3_errmsg(local_pcap->db));
-        cf_send_error(caph, 0, errstr);
+    if (packet_r != SQLITE_DONE || data_r != SQLITE_DONE) {
+        snprintf(errstr, 4096, "KismetDB '%s' could not read all packets and data: %s",
+                src->dbname, sqlite3_errmsg(src->db));
+    }
+
+done:
+    if (packet_stmt != NULL)
+        sqlite3_finalize(packet_stmt);
+    if (data_stmt != NULL)
+        sqlite3_finalize(data_stmt);
+
+    pthread_mutex_lock(&src->lock);
+    if (strlen(errstr) > 0)
+        src->error = strdup(errstr);
+    src->done = 1;
+    pthread_cond_broadcast(&src->cond);
+    pthread_mutex_unlock(&src->lock);
+
+    return NULL;
+}
+
+/* Next row of a source, waiting for the prefetch thread if needed, or NULL once the 
+ * source is exhausted */
+kismetdb_row_t *kismetdb_source_peek(kismetdb_source_t *src) {
+    kismetdb_batch_t *batch;
+
+    if (src->cur != NULL && src->cur_pos < src->cur->n_rows)
+        return &src->cur->rows[src->cur_pos];
+
+    if (src->cur != NULL) {
+        kismetdb_free_batch(src->cur);
+        src->cur = NULL;
+    }
+
+    pthread_mutex_lock(&src->lock);
+
+    while (src->head == NULL && !src->done)
+        pthread_cond_wait(&src->cond, &src->lock);
+
+    batch = src->head;
+
+    if (batch != NULL) {
+        src->head = batch->next;
+        if (src->head == NULL)
+            src->tail = NULL;
+        src->n_batches--;
+
+        pthread_cond_broadcast(&src->cond);
+    }
+
+    pthread_mutex_unlock(&src->lock);
+
+    if (batch == NULL)
+        return NULL;
+
+    src->cur = batch;
+    src->cur_pos = 0;
+
+    return &batch->rows[0];
+}
+
+uint64_t kismetdb_fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+/* Check and record a key in the recent duplicate cache.  Colliding keys replace each
+ * other, so a duplicate far from the original may be missed, but a packet is never 
+ * skipped unless it matches one already sent */
+int kismetdb_check_dupe(local_pcap_t *local_pcap, uint64_t key) {
+    size_t slot;
+
+    if (key == 0)
+        key = 1;
+
+    slot = key & (KISMETDB_DUPE_SLOTS - 1);
+
+    if (local_pcap->dupe_table[slot] == key)
+        return 1;
+
+    local_pcap->dupe_table[slot] = key;
+
+    return 0;
+}
+
+/* A packet is a duplicate if its packet id was already sent from the same log (the
+ * same packet seen by several datasources), or the same packet at the same time was
+ * already sent from any log (overlapping logs being merged) */
+int kismetdb_row_is_dupe(local_pcap_t *local_pcap, kismetdb_source_t *src, 
+        kismetdb_row_t *row) {
+    int dupe = 0;
+
+    if (row->is_data)
+        return 0;
+
+    if (row->packetid != 0)
+        dupe |= kismetdb_check_dupe(local_pcap, 
+                kismetdb_fmix64(((uint64_t) src->index << 56) ^ (uint64_t) row->packetid));
+
+    if (row->hash != 0)
+        dupe |= kismetdb_check_dupe(local_pcap,
+                kismetdb_fmix64(kismetdb_fmix64(((uint64_t) row->ts_sec << 20) ^ 
+                        (uint64_t) row->ts_usec) ^ (((uint64_t) row->len << 32) | row->hash)));
+
+    return dupe;
+}
+
+void capture_thread(kis_capture_handler_t *caph) {
+    local_pcap_t *local_pcap = (local_pcap_t *) caph->userdata;
+
+    char errstr[4096];
+
+    kismetdb_source_t *sources;
+    size_t n_sources = local_pcap->n_merge + 1;
+    size_t i;
+
+    kismetdb_source_t *best_src;
+    kismetdb_row_t *best_row, *row;
+
+    sources = (kismetdb_source_t *) calloc(n_sources, sizeof(kismetdb_source_t));
+
+    if (sources == NULL) {
+        cf_send_error(caph, 0, "Could not allocate kismetdb sources");
         return;
     }
 
-    packet_r = sqlite3_step(packet_stmt);
-    data_r = sqlite3_step(data_stmt);
+    if (local_pcap->dedupe) {
+        local_pcap->dupe_table = (uint64_t *) calloc(KISMETDB_DUPE_SLOTS, sizeof(uint64_t));
 
-    while (packet_r == SQLITE_ROW || data_r == SQLITE_ROW) {
-        lat = 0;
-        lon = 0;
-        alt = 0;
-        speed = 0;
-        heading = 0;
-
-        if (packet_r == SQLITE_ROW) {
-            packet_ts_sec = sqlite3_column_int64(packet_stmt, 0);
-            packet_ts_usec = sqlite3_column_int64(packet_stmt, 1);
-        } else {
-            packet_ts_sec = 0;
-            packet_ts_usec = 0;
+        if (local_pcap->dupe_table == NULL) {
+            cf_send_error(caph, 0, "Could not allocate kismetdb duplicate cache");
+            free(sources);
+            return;
         }
+    }
 
-        if (data_r == SQLITE_ROW) {
-            data_ts_sec = sqlite3_column_int64(data_stmt, 0);
-            data_ts_usec = sqlite3_column_int64(data_stmt, 1);
+    for (i = 0; i < n_sources; i++) {
+        if (i == 0) {
+            sources[i].db = local_pcap->db;
+            sources[i].dbname = local_pcap->dbname;
+            sources[i].db_version = local_pcap->db_version;
         } else {
-            data_ts_sec = 0;
-            data_ts_usec = 0;
+            sources[i].db = local_pcap->merge_dbs[i - 1];
+            sources[i].dbname = local_pcap->merge_names[i - 1];
+            sources[i].db_version = local_pcap->merge_versions[i - 1];
         }
 
-        /* Merge the timelines of the two tables; if the packet comes first process it, 
-         * otherwise process the data, and repeat */
-        if (data_ts_sec == 0 || packet_ts_sec < data_ts_sec ||
-                (packet_ts_sec == data_ts_sec && packet_ts_usec < data_ts_usec)) {
-            colno = 2;
+        sources[i].index = i;
+        sources[i].batch_rows = local_pcap->batch_rows;
 
-            packet_frequency = sqlite3_column_double(packet_stmt, colno++);
+        pthread_mutex_init(&sources[i].lock, NULL);
+        pthread_cond_init(&sources[i].cond, NULL);
 
-            lat = sqlite3_column_double(packet_stmt, colno++);
-            lon = sqlite3_column_double(packet_stmt, colno++);
-
-            if (local_pcap->db_version >= 5) {
-                alt = sqlite3_column_double(packet_stmt, colno++);
-                speed = sqlite3_column_double(packet_stmt, colno++);
-                heading = sqlite3_column_double(packet_stmt, colno++);
-            }
+        if (pthread_create(&sources[i].thread, NULL, kismetdb_prefetch_thread, 
+                    &sources[i]) != 0) {
+            snprintf(errstr, 4096, "KismetDB '%s' could not start prefetch thread: %s",
+                    sources[i].dbname, strerror(errno));
+            cf_send_error(caph, 0, errstr);
+            return;
+        }
 
-            dlt = sqlite3_column_int(packet_stmt, colno++);
+        sources[i].thread_running = 1;
+    }
 
-            packet_len = sqlite3_column_bytes(packet_stmt, colno);
-            packet_data = sqlite3_column_blob(packet_stmt, colno++);
+    /* Merge the sources by time; each is already in time order */
+    while (1) {
+        best_src = NULL;
+        best_row = NULL;
 
-            kismetdb_dispatch_packet_cb((u_char *) caph, packet_ts_sec, packet_ts_usec, dlt,
-                    packet_len, (const u_char *) packet_data,
-                    lat, lon, alt, speed, heading);
+        for (i = 0; i < n_sources; i++) {
+            row = kismetdb_source_peek(&sources[i]);
 
-            packet_r = sqlite3_step(packet_stmt);
-        } else {
-            colno = 2;
+            if (row == NULL) {
+                if (sources[i].error != NULL) {
+                    cf_send_error(caph, 0, sources[i].error);
+                    return;
+                }
 
-            lat = sqlite3_column_double(data_stmt, colno++);
-            lon = sqlite3_column_double(data_stmt, colno++);
+                continue;
+            }
 
-            if (local_pcap->db_version >= 5) {
-                alt = sqlite3_column_double(data_stmt, colno++);
-                speed = sqlite3_column_double(data_stmt, colno++);
-                heading = sqlite3_column_double(data_stmt, colno++);
+            if (best_row == NULL || row->ts_sec < best_row->ts_sec ||
+                    (row->ts_sec == best_row->ts_sec && row->ts_usec < best_row->ts_usec)) {
+                best_src = &sources[i];
+                best_row = row;
             }
+        }
 
-            data_type = strdup((const char *) sqlite3_column_text(data_stmt, colno++));
-            data_json = strdup((const char *) sqlite3_column_text(data_stmt, colno++));
+        if (best_row == NULL)
+            break;
 
-            kismetdb_dispatch_data_cb((u_char *) caph, packet_ts_sec, packet_ts_usec, 
-                    data_type, data_json,
-                    lat, lon, alt, speed, heading);
+        if (local_pcap->dedupe && kismetdb_row_is_dupe(local_pcap, best_src, best_row)) {
+            local_pcap->dupes_skipped++;
+        } else if (best_row->is_data) {
+            kismetdb_dispatch_data_cb((u_char *) caph, best_row->ts_sec, best_row->ts_usec,
+                    best_row->type, (char *) best_row->content,
+                    best_row->lat, best_row->lon, best_row->alt, 
+                    best_row->speed, best_row->heading);
+        } else {
+            kismetdb_dispatch_packet_cb((u_char *) caph, best_row->ts_sec, best_row->ts_usec,
+                    best_row->dlt, best_row->len, (const u_char *) best_row->content,
+                    best_row->lat, best_row->lon, best_row->alt, 
+                    best_row->speed, best_row->heading);
+        }
 
-            free(data_type);
-            free(data_json);
+        best_src->cur_pos++;
+    }
 
-            data_r = sqlite3_step(data_stmt);
-        }
+    for (i = 0; i < n_sources; i++) {
+        if (sources[i].thread_running)
+            pthread_join(sources[i].thread, NULL);
     }
 
-    snprintf(errstr, 4096, "KismetDB '%s' closed, all packets and data processed.", 
-            local_pcap->dbname);
+    /* Push out anything left in a partial batch frame */
+    while (cf_flush_batch(caph) == 0)
+        cf_handler_wait_ringbuffer(caph);
+
+    if (local_pcap->dedupe) {
+        snprintf(errstr, 4096, "KismetDB '%s' closed, all packets and data from %lu "
+                "kismetdb logs processed, %lu duplicate packets skipped.", 
+                local_pcap->dbname, (unsigned long) n_sources, local_pcap->dupes_skipped);
+    } else {
+        snprintf(errstr, 4096, "KismetDB '%s' closed, all packets and data from %lu "
+                "kismetdb logs processed.", local_pcap->dbname, (unsigned long) n_sources);
+    }
     cf_send_message(caph, errstr, MSGFLAG_INFO);
 
     /* Instead of dying, spin forever in a sleep loop */
@@ -665,6 +1151,15 @@ int main(int argc, char *argv[]) {
         .last_ts.tv_sec = 0,
         .last_ts.tv_usec = 0,
         .pps_throttle = 0,
+        .fast = 0,
+        .dedupe = 0,
+        .dupe_table = NULL,
+        .dupes_skipped = 0,
+        .batch_rows = KISMETDB_PREFETCH_ROWS,
+        .merge_names = NULL,
+        .merge_dbs = NULL,
+        .merge_versions = NULL,
+        .n_merge = 0,
     };
 
 #if 0
@@ -35,6 +35,11 @@
 
 /* Bluetooth devices are sent as complete device records in a custom
  * capsource packet, using the bluetooth protobuf entry
+ *
+ * With lescan=hci, LE devices are instead found by scanning directly over a raw
+ * HCI socket; advertising reports are read in batches, repeats of the same
+ * advertisement inside the dedupe window are folded together, and the rest are
+ * sent as batches of raw adverts for the server to decode.
  */
 
 #include "../config.h"
@@ -47,11 +52,13 @@
 #include <signal.h>
 #include <sys/signalfd.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/ioctl.h>
 #include <dirent.h>
 
 #include "mgmtlib/bluetooth.h"
 #include "mgmtlib/hci.h"
+#include "mgmtlib/hci_lib.h"
 #include "mgmtlib/mgmt.h"
 
 #include "linux_bt_rfkill.h"
@@ -61,6 +68,60 @@
 
 #include "../protobuf_c/linuxbluetooth.pb-c.h"
 
+/* Advertisements held in the dedupe table; a power of two */
+#define LE_SEEN_SLOTS       4096
+
+/* Slots checked for an advertisement before giving up on deduping it */
+#define LE_SEEN_PROBE       4
+
+/* Adverts sent per report, and longest an advert waits to be sent */
+#define LE_BATCH_MAX        64
+#define LE_BATCH_USEC       100000
+
+/* Default window repeats of an advert are folded into, in milliseconds */
+#define LE_DEDUPE_MS        1000
+
+/* Most HCI events read per wakeup */
+#define LE_READ_BATCH       64
+
+/* Recently sent advertisement */
+typedef struct {
+    uint32_t hash;
+    uint8_t addr[6];
+    uint8_t type;
+
+    /* When it was last sent, and how many repeats were folded in since */
+    struct timeval last_sent;
+    uint32_t merged;
+
+    /* Slot in the pending batch, or -1 */
+    int pending;
+} le_seen_t;
+
+/* Advertisement waiting to be sent */
+typedef struct {
+    struct timeval tv;
+    uint8_t addr[6];
+    uint8_t type;
+    uint16_t event_type;
+    int8_t rssi;
+    int8_t txpower;
+    int has_txpower;
+    uint8_t data_len;
+    uint8_t data[255];
+    uint32_t count;
+
+    /* Dedupe entry counting its repeats, if it has one */
+    le_seen_t *seen;
+} le_advert_t;
+
+/* Raw HCI scanning states */
+#define LE_HCI_IDLE         0
+#define LE_HCI_PROBE        1
+#define LE_HCI_PARAMS       2
+#define LE_HCI_ENABLE       3
+#define LE_HCI_SCANNING     4
+
 /* Unique instance data passed around by capframework */
 typedef struct {
     /* Target interface */
@@ -80,6 +141,18 @@ typedef struct {
     /* Scanning type */
     uint8_t scan_type;
 
+    /* Raw HCI LE scanning instead of bluez discovery */
+    int le_hci;
+    int hci_fd;
+    int le_hci_state;
+    int le_hci_extended;
+
+    unsigned int le_dedupe_ms;
+    le_seen_t *le_seen;
+
+    le_advert_t *le_batch;
+    unsigned int le_batch_len;
+
     kis_capture_handler_t *caph;
 } local_bluetooth_t;
 
@@ -101,6 +174,7 @@ typedef struct {
 static char *eir_get_name(const uint8_t *eir, uint16_t eir_len);
 static unsigned int eir_get_flags(const uint8_t *eir, uint16_t eir_len);
 void bdaddr_to_string(const uint8_t *bdaddr, char *str);
+void start_scanning(local_bluetooth_t *localbt);
 
 int cf_send_btdevice(local_bluetooth_t *localbt,
         struct mgmt_ev_device_found *dev,
@@ -336,7 +410,7 @@ void resp_controller_info(local_bluetooth_t *localbt, uint8_t status, uint16_t l
     }
 
     /* If the interface is on, start scanning */
-    cmd_start_discovery(localbt);
+    start_scanning(localbt);
 }
 
 void resp_controller_power(local_bluetooth_t *localbt, uint8_t status, uint16_t len,
@@ -350,7 +424,7 @@ void resp_controller_power(local_bluetooth_t *localbt, uint8_t status, uint16_t
 
     if (*settings & MGMT_SETTING_POWERED) {
         /* Initiate scanning mode */
-        cmd_start_discovery(localbt);
+        start_scanning(localbt);
     } else {
         snprintf(errstr, STATUS_MAX, "Interface %s failed to power on",
                 localbt->bt_interface);
@@ -366,7 +440,7 @@ void evt_controller_discovering(local_bluetooth_t *localbt, uint16_t len, const
         return;
     }
 
-    if (!dsc->discovering) {
+    if (!dsc->discovering && localbt->scan_type != 0) {
         cmd_start_discovery(localbt);
     }
 
@@ -437,6 +511,590 @@ void evt_device_found(local_bluetooth_t *localbt, uint16_t len, const void *para
     cf_send_btdevice(localbt, dev, NULL);
 }
 
+/* Extended scanning commands and reports, newer than the bluez headers we carry */
+#define OCF_LE_SET_EXT_SCAN_PARAMETERS      0x0041
+typedef struct {
+    uint8_t own_bdaddr_type;
+    uint8_t filter;
+    uint8_t phys;
+    /* Per-phy parameters, we only scan the 1M phy */
+    uint8_t type;
+    uint16_t interval;
+    uint16_t window;
+} __attribute__ ((packed)) le_set_ext_scan_parameters_cp;
+
+#define OCF_LE_SET_EXT_SCAN_ENABLE          0x0042
+typedef struct {
+    uint8_t enable;
+    uint8_t filter_dup;
+    uint16_t duration;
+    uint16_t period;
+} __attribute__ ((packed)) le_set_ext_scan_enable_cp;
+
+#define EVT_LE_EXT_ADVERTISING_REPORT       0x0D
+typedef struct {
+    uint16_t evt_type;
+    uint8_t bdaddr_type;
+    bdaddr_t bdaddr;
+    uint8_t primary_phy;
+    uint8_t secondary_phy;
+    uint8_t sid;
+    int8_t txpower;
+    int8_t rssi;
+    uint16_t periodic_interval;
+    uint8_t direct_bdaddr_type;
+    bdaddr_t direct_bdaddr;
+    uint8_t length;
+    uint8_t data[0];
+} __attribute__ ((packed)) le_ext_advertising_info;
+#define LE_EXT_ADVERTISING_INFO_SIZE 24
+
+/* HCI status for a command the controller doesn't know */
+#define HCI_STATUS_UNKNOWN_COMMAND          0x01
+
+/* HCI value for rssi and txpower not being available */
+#define HCI_LE_VALUE_UNAVAILABLE            127
+
+/* Connect a raw HCI socket to the device, seeing only the events we scan with */
+int hci_le_connect(int devid) {
+    struct sockaddr_hci addr;
+    struct hci_filter flt;
+    int fd;
+
+    if ((fd = socket(AF_BLUETOOTH, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                    BTPROTO_HCI)) < 0) {
+        return -errno;
+    }
+
+    hci_filter_clear(&flt);
+    hci_filter_set_ptype(HCI_EVENT_PKT, &flt);
+    hci_filter_set_event(EVT_LE_META_EVENT, &flt);
+    hci_filter_set_event(EVT_CMD_COMPLETE, &flt);
+    hci_filter_set_event(EVT_CMD_STATUS, &flt);
+
+    if (setsockopt(fd, SOL_HCI, HCI_FILTER, &flt, sizeof(flt)) < 0) {
+        int err = -errno;
+        close(fd);
+        return err;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.hci_family = AF_BLUETOOTH;
+    addr.hci_dev = devid;
+    addr.hci_channel = HCI_CHANNEL_RAW;
+
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        int err = -errno;
+        close(fd);
+        return err;
+    }
+
+    return fd;
+}
+
+/* Write an LE controller command */
+int hci_le_write_command(local_bluetooth_t *localbt, uint16_t ocf, uint8_t plen,
+        const void *param) {
+    uint8_t buf[HCI_TYPE_LEN + HCI_COMMAND_HDR_SIZE + 255];
+    hci_command_hdr *hdr = (hci_command_hdr *) (buf + HCI_TYPE_LEN);
+
+    buf[0] = HCI_COMMAND_PKT;
+    hdr->opcode = htole16(cmd_opcode_pack(OGF_LE_CTL, ocf));
+    hdr->plen = plen;
+
+    if (plen != 0 && param != NULL) {
+        memcpy(buf + HCI_TYPE_LEN + HCI_COMMAND_HDR_SIZE, param, plen);
+    }
+
+    if (write(localbt->hci_fd, buf, HCI_TYPE_LEN + HCI_COMMAND_HDR_SIZE + plen) < 0) {
+        return -errno;
+    }
+
+    return 1;
+}
+
+int cmd_le_scan_enable(local_bluetooth_t *localbt, uint8_t enable) {
+    /* Duplicates are filtered by us, over the dedupe window, rather than by the
+     * controller for the whole scan */
+    if (localbt->le_hci_extended) {
+        le_set_ext_scan_enable_cp cp;
+
+        memset(&cp, 0, sizeof(cp));
+        cp.enable = enable;
+
+        return hci_le_write_command(localbt, OCF_LE_SET_EXT_SCAN_ENABLE, sizeof(cp), &cp);
+    } else {
+        le_set_scan_enable_cp cp;
+
+        memset(&cp, 0, sizeof(cp));
+        cp.enable = enable;
+
+        return hci_le_write_command(localbt, OCF_LE_SET_SCAN_ENABLE, sizeof(cp), &cp);
+    }
+}
+
+int cmd_le_scan_parameters(local_bluetooth_t *localbt) {
+    /* Active scanning, with the window covering the whole interval */
+    if (localbt->le_hci_extended) {
+        le_set_ext_scan_parameters_cp cp;
+
+        memset(&cp, 0, sizeof(cp));
+        cp.phys = 0x01;
+        cp.type = 0x01;
+        cp.interval = htole16(0x0010);
+        cp.window = htole16(0x0010);
+
+        return hci_le_write_command(localbt, OCF_LE_SET_EXT_SCAN_PARAMETERS, sizeof(cp), &cp);
+    } else {
+        le_set_scan_parameters_cp cp;
+
+        memset(&cp, 0, sizeof(cp));
+        cp.type = 0x01;
+        cp.interval = htole16(0x0010);
+        cp.window = htole16(0x0010);
+
+        return hci_le_write_command(localbt, OCF_LE_SET_SCAN_PARAMETERS, sizeof(cp), &cp);
+    }
+}
+
+/* Start LE scanning over HCI.  Scanning has to be off to set the parameters; turning
+ * off extended scanning also tells us if the controller supports it. */
+int le_hci_start(local_bluetooth_t *localbt) {
+    localbt->le_hci_extended = 1;
+    localbt->le_hci_state = LE_HCI_PROBE;
+
+    return cmd_le_scan_enable(localbt, 0);
+}
+
+/* Advance the scanning setup on a command completing */
+void le_hci_command_done(local_bluetooth_t *localbt, uint16_t opcode, uint8_t status) {
+    char errstr[STATUS_MAX];
+    uint16_t ext_enable = cmd_opcode_pack(OGF_LE_CTL, OCF_LE_SET_EXT_SCAN_ENABLE);
+    uint16_t ext_params = cmd_opcode_pack(OGF_LE_CTL, OCF_LE_SET_EXT_SCAN_PARAMETERS);
+    uint16_t enable = cmd_opcode_pack(OGF_LE_CTL, OCF_LE_SET_SCAN_ENABLE);
+    uint16_t params = cmd_opcode_pack(OGF_LE_CTL, OCF_LE_SET_SCAN_PARAMETERS);
+
+    switch (localbt->le_hci_state) {
+        case LE_HCI_PROBE:
+            if (opcode == ext_enable && status == HCI_STATUS_UNKNOWN_COMMAND) {
+                /* Fall back to legacy scanning */
+                localbt->le_hci_extended = 0;
+                cmd_le_scan_enable(localbt, 0);
+            } else if (opcode == ext_enable || opcode == enable) {
+                /* Disabling a scan which isn't running fails harmlessly */
+                localbt->le_hci_state = LE_HCI_PARAMS;
+                cmd_le_scan_parameters(localbt);
+            }
+            break;
+
+        case LE_HCI_PARAMS:
+            if (opcode != ext_params && opcode != params)
+                break;
+
+            if (status != 0) {
+                snprintf(errstr, STATUS_MAX, "Interface %s failed to set LE scan "
+                        "parameters (HCI status 0x%02x)", localbt->bt_interface, status);
+                cf_send_error(localbt->caph, 0, errstr);
+                localbt->le_hci_state = LE_HCI_IDLE;
+                break;
+            }
+
+            localbt->le_hci_state = LE_HCI_ENABLE;
+            cmd_le_scan_enable(localbt, 1);
+            break;
+
+        case LE_HCI_ENABLE:
+            if (opcode != ext_enable && opcode != enable)
+                break;
+
+            if (status != 0) {
+                snprintf(errstr, STATUS_MAX, "Interface %s failed to enable LE scanning "
+                        "(HCI status 0x%02x)", localbt->bt_interface, status);
+                cf_send_error(localbt->caph, 0, errstr);
+                localbt->le_hci_state = LE_HCI_IDLE;
+                break;
+            }
+
+            localbt->le_hci_state = LE_HCI_SCANNING;
+
+            snprintf(errstr, STATUS_MAX, "Interface %s scanning LE over HCI (%s)",
+                    localbt->bt_interface, localbt->le_hci_extended ? "extended" : "legacy");
+            cf_send_message(localbt->caph, errstr, MSGFLAG_INFO);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Send the pending adverts as a single report */
+int cf_send_btadverts(local_bluetooth_t *localbt) {
+    KismetLinuxBluetooth__LinuxBluetoothAdvertReport kereport;
+    KismetLinuxBluetooth__SubLinuxBluetoothAdvert keadverts[LE_BATCH_MAX];
+    KismetLinuxBluetooth__SubLinuxBluetoothAdvert *keadvert_ptrs[LE_BATCH_MAX];
+    KismetDatasource__SubGps kegps;
+
+    struct timeval tv;
+    unsigned int i;
+
+    uint8_t *buf;
+    size_t len;
+    int ret;
+
+    if (localbt->le_batch_len == 0)
+        return 1;
+
+    kismet_linux_bluetooth__linux_bluetooth_advert_report__init(&kereport);
+    kismet_datasource__sub_gps__init(&kegps);
+
+    gettimeofday(&tv, NULL);
+
+    for (i = 0; i < localbt->le_batch_len; i++) {
+        le_advert_t *adv = &localbt->le_batch[i];
+        KismetLinuxBluetooth__SubLinuxBluetoothAdvert *ke = &keadverts[i];
+
+        kismet_linux_bluetooth__sub_linux_bluetooth_advert__init(ke);
+
+        ke->time_sec = adv->tv.tv_sec;
+        ke->time_usec = adv->tv.tv_usec;
+        ke->address.data = adv->addr;
+        ke->address.len = 6;
+        ke->type = adv->type;
+
+        ke->has_event_type = 1;
+        ke->event_type = adv->event_type;
+
+        if (adv->rssi != HCI_LE_VALUE_UNAVAILABLE) {
+            ke->has_rssi = 1;
+            ke->rssi = adv->rssi;
+        }
+
+        if (adv->has_txpower) {
+            ke->has_txpower = 1;
+            ke->txpower = adv->txpower;
+        }
+
+        if (adv->data_len != 0) {
+            ke->has_data = 1;
+            ke->data.data = adv->data;
+            ke->data.len = adv->data_len;
+        }
+
+        if (adv->count > 1) {
+            ke->has_count = 1;
+            ke->count = adv->count;
+        }
+
+        keadvert_ptrs[i] = ke;
+    }
+
+    kereport.n_advert = localbt->le_batch_len;
+    kereport.advert = keadvert_ptrs;
+
+    if (localbt->caph->gps_fixed_lat != 0) {
+        kegps.lat = localbt->caph->gps_fixed_lat;
+        kegps.lon = localbt->caph->gps_fixed_lon;
+        kegps.alt = localbt->caph->gps_fixed_alt;
+        kegps.fix = 3;
+
+        kegps.time_sec = tv.tv_sec;
+        kegps.time_usec = tv.tv_usec;
+
+        kegps.type = strdup("remote-fixed");
+
+        if (localbt->caph->gps_name != NULL)
+            kegps.name = strdup(localbt->caph->gps_name);
+        else
+            kegps.name = strdup("remote-fixed");
+
+        kereport.gps = &kegps;
+    }
+
+    len = kismet_linux_bluetooth__linux_bluetooth_advert_report__get_packed_size(&kereport);
+
+    while (1) {
+        buf = (uint8_t *) malloc(len);
+
+        if (buf == NULL) {
+            ret = -1;
+            break;
+        }
+
+        kismet_linux_bluetooth__linux_bluetooth_advert_report__pack(&kereport, buf);
+
+        /* The packet is consumed either way; wait for room and pack it again if the
+         * buffer to the server is full */
+        if ((ret = cf_send_packet(localbt->caph, "LBTADVREPORT", buf, len)) != 0)
+            break;
+
+        cf_handler_wait_ringbuffer(localbt->caph);
+    }
+
+    if (kegps.name != NULL)
+        free(kegps.name);
+    if (kegps.type != NULL)
+        free(kegps.type);
+
+    /* Repeats from here on are counted against the next send */
+    for (i = 0; i < localbt->le_batch_len; i++) {
+        le_seen_t *seen = localbt->le_batch[i].seen;
+
+        if (seen == NULL)
+            continue;
+
+        seen->pending = -1;
+        seen->last_sent = tv;
+        seen->merged = 0;
+    }
+
+    localbt->le_batch_len = 0;
+
+    return ret;
+}
+
+static uint32_t le_advert_hash(const uint8_t *addr, uint8_t type, uint16_t event_type,
+        const uint8_t *data, uint8_t data_len) {
+    /* FNV-1a */
+    uint32_t hash = 2166136261U;
+    unsigned int i;
+
+#define LE_HASH_BYTE(b) do { hash ^= (uint8_t) (b); hash *= 16777619U; } while (0)
+
+    for (i = 0; i < 6; i++)
+        LE_HASH_BYTE(addr[i]);
+
+    LE_HASH_BYTE(type);
+    LE_HASH_BYTE(event_type & 0xFF);
+    LE_HASH_BYTE(event_type >> 8);
+
+    for (i = 0; i < data_len; i++)
+        LE_HASH_BYTE(data[i]);
+
+#undef LE_HASH_BYTE
+
+    return hash;
+}
+
+static unsigned long le_elapsed_usec(const struct timeval *from, const struct timeval *to) {
+    if (to->tv_sec < from->tv_sec ||
+            (to->tv_sec == from->tv_sec && to->tv_usec < from->tv_usec))
+        return 0;
+
+    return (to->tv_sec - from->tv_sec) * 1000000UL + to->tv_usec - from->tv_usec;
+}
+
+/* Fold repeats of an advert inside the dedupe window into the last copy, and queue
+ * the rest to be sent */
+void le_queue_advert(local_bluetooth_t *localbt, const uint8_t *bdaddr, uint8_t addr_type,
+        uint16_t event_type, int8_t rssi, int8_t txpower, int has_txpower,
+        const uint8_t *data, uint8_t data_len) {
+    struct timeval tv;
+    uint8_t addr[6];
+    uint8_t type;
+    uint32_t hash;
+    unsigned int i;
+    le_seen_t *seen, *slot;
+    le_advert_t *adv;
+
+    gettimeofday(&tv, NULL);
+
+    /* HCI addresses are LSB first; send them in the same order as device records */
+    for (i = 0; i < 6; i++)
+        addr[i] = bdaddr[5 - i];
+
+    /* Public and random (or resolved) HCI addresses, as the mgmt LE address types */
+    type = (addr_type & 0x01) ? 2 : 1;
+
+    if (localbt->le_batch_len >= LE_BATCH_MAX)
+        cf_send_btadverts(localbt);
+
+    hash = le_advert_hash(addr, type, event_type, data, data_len);
+
+    /* Look for the advert in a short run of slots, noting the first which isn't
+     * waiting in the batch in case we need to take it */
+    seen = NULL;
+    slot = NULL;
+
+    for (i = 0; i < LE_SEEN_PROBE; i++) {
+        le_seen_t *s = &localbt->le_seen[(hash + i) & (LE_SEEN_SLOTS - 1)];
+
+        if (s->hash == hash && s->type == type && memcmp(s->addr, addr, 6) == 0) {
+            seen = s;
+            break;
+        }
+
+        if (slot == NULL && s->pending < 0)
+            slot = s;
+    }
+
+    if (seen != NULL) {
+        if (seen->pending >= 0) {
+            /* Still waiting to go out; count it and keep the latest signal */
+            adv = &localbt->le_batch[seen->pending];
+            adv->count++;
+            adv->rssi = rssi;
+            return;
+        }
+
+        if (le_elapsed_usec(&seen->last_sent, &tv) < localbt->le_dedupe_ms * 1000UL) {
+            seen->merged++;
+            return;
+        }
+    } else if (slot != NULL) {
+        seen = slot;
+        seen->hash = hash;
+        seen->type = type;
+        memcpy(seen->addr, addr, 6);
+        seen->merged = 0;
+    }
+
+    /* With no slot free the advert is sent without folding its repeats */
+
+    adv = &localbt->le_batch[localbt->le_batch_len];
+
+    adv->tv = tv;
+    memcpy(adv->addr, addr, 6);
+    adv->type = type;
+    adv->event_type = event_type;
+    adv->rssi = rssi;
+    adv->txpower = txpower;
+    adv->has_txpower = has_txpower;
+    adv->data_len = data_len;
+    memcpy(adv->data, data, data_len);
+    adv->count = 1;
+    adv->seen = seen;
+
+    if (seen != NULL) {
+        adv->count += seen->merged;
+        seen->merged = 0;
+        seen->pending = localbt->le_batch_len;
+    }
+
+    localbt->le_batch_len++;
+}
+
+/* Send the batch once the oldest advert in it has waited long enough */
+void le_flush_adverts(local_bluetooth_t *localbt) {
+    struct timeval tv;
+
+    if (localbt->le_batch_len == 0)
+        return;
+
+    gettimeofday(&tv, NULL);
+
+    if (le_elapsed_usec(&localbt->le_batch[0].tv, &tv) >= LE_BATCH_USEC)
+        cf_send_btadverts(localbt);
+}
+
+void evt_le_adv_report(local_bluetooth_t *localbt, const uint8_t *param, size_t len) {
+    const le_advertising_info *info;
+    unsigned int num, i;
+    size_t pos = 1;
+    int8_t rssi;
+
+    if (len < 1)
+        return;
+
+    num = param[0];
+
+    for (i = 0; i < num; i++) {
+        if (pos + LE_ADVERTISING_INFO_SIZE > len)
+            return;
+
+        info = (const le_advertising_info *) (param + pos);
+
+        /* The rssi follows the data */
+        if (pos + LE_ADVERTISING_INFO_SIZE + info->length + 1 > len)
+            return;
+
+        rssi = (int8_t) param[pos + LE_ADVERTISING_INFO_SIZE + info->length];
+
+        le_queue_advert(localbt, info->bdaddr.b, info->bdaddr_type, info->evt_type,
+                rssi, 0, 0, info->data, info->length);
+
+        pos += LE_ADVERTISING_INFO_SIZE + info->length + 1;
+    }
+}
+
+void evt_le_ext_adv_report(local_bluetooth_t *localbt, const uint8_t *param, size_t len) {
+    const le_ext_advertising_info *info;
+    unsigned int num, i;
+    size_t pos = 1;
+
+    if (len < 1)
+        return;
+
+    num = param[0];
+
+    for (i = 0; i < num; i++) {
+        if (pos + LE_EXT_ADVERTISING_INFO_SIZE > len)
+            return;
+
+        info = (const le_ext_advertising_info *) (param + pos);
+
+        if (pos + LE_EXT_ADVERTISING_INFO_SIZE + info->length > len)
+            return;
+
+        le_queue_advert(localbt, info->bdaddr.b, info->bdaddr_type,
+                le16toh(info->evt_type), info->rssi, info->txpower,
+                info->txpower != HCI_LE_VALUE_UNAVAILABLE, info->data, info->length);
+
+        pos += LE_EXT_ADVERTISING_INFO_SIZE + info->length;
+    }
+}
+
+void handle_hci_event(local_bluetooth_t *localbt, const uint8_t *buf, size_t len) {
+    const hci_event_hdr *hdr;
+    const uint8_t *param;
+    size_t plen;
+
+    if (len < HCI_TYPE_LEN + HCI_EVENT_HDR_SIZE || buf[0] != HCI_EVENT_PKT)
+        return;
+
+    hdr = (const hci_event_hdr *) (buf + HCI_TYPE_LEN);
+    param = buf + HCI_TYPE_LEN + HCI_EVENT_HDR_SIZE;
+
+    plen = len - HCI_TYPE_LEN - HCI_EVENT_HDR_SIZE;
+    if (hdr->plen < plen)
+        plen = hdr->plen;
+
+    if (hdr->evt == EVT_CMD_COMPLETE) {
+        const evt_cmd_complete *cc = (const evt_cmd_complete *) param;
+
+        /* The status is the first byte of the return parameters */
+        if (plen < EVT_CMD_COMPLETE_SIZE + 1)
+            return;
+
+        le_hci_command_done(localbt, le16toh(cc->opcode), param[EVT_CMD_COMPLETE_SIZE]);
+    } else if (hdr->evt == EVT_CMD_STATUS) {
+        const evt_cmd_status *cs = (const evt_cmd_status *) param;
+
+        /* Commands the controller doesn't know may be rejected with a status */
+        if (plen < EVT_CMD_STATUS_SIZE || cs->status == 0)
+            return;
+
+        le_hci_command_done(localbt, le16toh(cs->opcode), cs->status);
+    } else if (hdr->evt == EVT_LE_META_EVENT) {
+        if (plen < EVT_LE_META_EVENT_SIZE)
+            return;
+
+        if (param[0] == EVT_LE_ADVERTISING_REPORT)
+            evt_le_adv_report(localbt, param + 1, plen - 1);
+        else if (param[0] == EVT_LE_EXT_ADVERTISING_REPORT)
+            evt_le_ext_adv_report(localbt, param + 1, plen - 1);
+    }
+}
+
+/* Start scanning for devices once the controller is up; with HCI scanning bluez only
+ * looks for BR/EDR devices */
+void start_scanning(local_bluetooth_t *localbt) {
+    if (localbt->le_hci && localbt->le_hci_state == LE_HCI_IDLE)
+        le_hci_start(localbt);
+
+    if (localbt->scan_type != 0)
+        cmd_start_discovery(localbt);
+}
+
 void handle_mgmt_response(local_bluetooth_t *localbt) {
     /* Top-level command */
     bluez_mgmt_command_t *evt;
@@ -822,6 +1480,71 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
         return -1;
     }
 
+    /* Scan LE over a raw HCI socket instead of through bluez discovery */
+    localbt->le_hci = 0;
+    localbt->scan_type = SCAN_TYPE_DUAL;
+
+    if ((placeholder_len = cf_find_flag(&placeholder, "lescan", definition)) > 0) {
+        if (strncasecmp(placeholder, "hci", placeholder_len) == 0) {
+            localbt->le_hci = 1;
+        } else if (strncasecmp(placeholder, "mgmt", placeholder_len) != 0) {
+            snprintf(msg, STATUS_MAX, "Unknown lescan mode, expected 'mgmt' or 'hci'");
+            return -1;
+        }
+    }
+
+    localbt->le_dedupe_ms = LE_DEDUPE_MS;
+
+    if ((placeholder_len = cf_find_flag(&placeholder, "le_dedupe", definition)) > 0) {
+        char *dedupe = strndup(placeholder, placeholder_len);
+        unsigned int dedupe_ms;
+
+        if (sscanf(dedupe, "%u", &dedupe_ms) != 1) {
+            snprintf(msg, STATUS_MAX, "Could not parse le_dedupe, expected a time in "
+                    "milliseconds");
+            free(dedupe);
+            return -1;
+        }
+
+        free(dedupe);
+        localbt->le_dedupe_ms = dedupe_ms;
+    }
+
+    if (localbt->hci_fd >= 0) {
+        close(localbt->hci_fd);
+        localbt->hci_fd = -1;
+    }
+
+    free(localbt->le_seen);
+    localbt->le_seen = NULL;
+    free(localbt->le_batch);
+    localbt->le_batch = NULL;
+    localbt->le_batch_len = 0;
+    localbt->le_hci_state = LE_HCI_IDLE;
+
+    if (localbt->le_hci) {
+        if ((localbt->hci_fd = hci_le_connect(devid)) < 0) {
+            snprintf(msg, STATUS_MAX, "Could not open raw HCI socket for LE scanning: %s",
+                    strerror(-(localbt->hci_fd)));
+            localbt->hci_fd = -1;
+            return -1;
+        }
+
+        localbt->le_seen = (le_seen_t *) calloc(LE_SEEN_SLOTS, sizeof(le_seen_t));
+        localbt->le_batch = (le_advert_t *) calloc(LE_BATCH_MAX, sizeof(le_advert_t));
+
+        if (localbt->le_seen == NULL || localbt->le_batch == NULL) {
+            snprintf(msg, STATUS_MAX, "Could not allocate LE scanning tables");
+            return -1;
+        }
+
+        for (x = 0; x < LE_SEEN_SLOTS; x++)
+            localbt->le_seen[x].pending = -1;
+
+        /* bluez discovery is left to find BR/EDR devices */
+        localbt->scan_type &= ~SCAN_TYPE_LE;
+    }
+
     /* Set up our ringbuffers */
     if (localbt->read_rbuf)
         kis_simple_ringbuf_free(localbt->read_rbuf);
@@ -847,12 +1570,29 @@ void capture_thread(kis_capture_handler_t *caph) {
     fd_set rset;
     struct timeval tm;
     char errstr[STATUS_MAX];
+    int max_fd;
 
     while (1) {
         if (caph->spindown) {
             close(localbt->mgmt_fd);
             localbt->mgmt_fd = -1;
 
+            if (localbt->hci_fd >= 0) {
+                cf_send_btadverts(localbt);
+
+                if (localbt->le_hci_state == LE_HCI_SCANNING)
+                    cmd_le_scan_enable(localbt, 0);
+
+                close(localbt->hci_fd);
+                localbt->hci_fd = -1;
+            }
+
+            free(localbt->le_seen);
+            localbt->le_seen = NULL;
+            free(localbt->le_batch);
+            localbt->le_batch = NULL;
+            localbt->le_batch_len = 0;
+
             kis_simple_ringbuf_free(localbt->read_rbuf);
             localbt->read_rbuf = NULL;
             break;
@@ -865,8 +1605,16 @@ void capture_thread(kis_capture_handler_t *caph) {
 
         /* Always set read buffer */
         FD_SET(localbt->mgmt_fd, &rset);
+        max_fd = localbt->mgmt_fd;
+
+        if (localbt->hci_fd >= 0) {
+            FD_SET(localbt->hci_fd, &rset);
 
-        if (select(localbt->mgmt_fd + 1, &rset, NULL, NULL, &tm) < 0) {
+            if (localbt->hci_fd > max_fd)
+                max_fd = localbt->hci_fd;
+        }
+
+        if (select(max_fd + 1, &rset, NULL, NULL, &tm) < 0) {
             if (errno != EINTR && errno != EAGAIN) {
                 fprintf(stderr, "FATAL: Select failed %s\n", strerror(errno));
                 exit(1);
@@ -903,6 +1651,31 @@ void capture_thread(kis_capture_handler_t *caph) {
                 handle_mgmt_response(localbt);
             }
         }
+
+        if (localbt->hci_fd >= 0 && FD_ISSET(localbt->hci_fd, &rset)) {
+            uint8_t hbuf[HCI_MAX_EVENT_SIZE];
+            ssize_t amt_read;
+            unsigned int n;
+
+            /* Drain a run of events per wakeup so a busy channel doesn't cost a
+             * select per advert */
+            for (n = 0; n < LE_READ_BATCH; n++) {
+                if ((amt_read = read(localbt->hci_fd, hbuf, sizeof(hbuf))) <= 0) {
+                    if (amt_read < 0 && errno != EINTR && errno != EAGAIN) {
+                        snprintf(errstr, STATUS_MAX, "Failed to read from "
+                                "HCI socket: %s", strerror(errno));
+                        cf_send_error(caph, 0, errstr);
+                    }
+
+                    break;
+                }
+
+                handle_hci_event(localbt, hbuf, amt_read);
+            }
+        }
+
+        if (localbt->hci_fd >= 0)
+            le_flush_adverts(localbt);
     }
 }
 
@@ -914,6 +1687,14 @@ int main(int argc, char *argv[]) {
         .mgmt_fd = 0,
         .read_rbuf = NULL,
         .scan_type = SCAN_TYPE_DUAL,
+        .le_hci = 0,
+        .hci_fd = -1,
+        .le_hci_state = LE_HCI_IDLE,
+        .le_hci_extended = 0,
+        .le_dedupe_ms = LE_DEDUPE_MS,
+        .le_seen = NULL,
+        .le_batch = NULL,
+        .le_batch_len = 0,
         .caph = NULL,
     };
 
@@ -90,259 +90,13 @@
 #include "linux_netlink_control.h"
 #include "linux_wireless_rfkill.h"
 #include "linux_nexmon_control.h"
+#include "linux_wifi_bpf.h"
+#include "linux_wifi_ring.h"
 
 #include "../wifi_ht_channels.h"
 
 #define MAX_PACKET_LEN  8192
 
-// BPF program to parse radiotap and 802.11, and pass management and eapol ONLY
-struct bpf_insn rt_pgm[] = {
-    // 00 LDB [3]      a = pkt[3] second half of length
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_ABS) + BPF_SIZE(BPF_B), 3),
-    // 01 LSH #8       a = a << 8
-    BPF_STMT(BPF_ALU + BPF_OP(BPF_LSH), 8),
-    // 02 TAX          x = a
-    BPF_STMT(BPF_MISC + BPF_MISCOP(BPF_TAX), 0),
-    // 03 LDB [2]      a = pkt[2] first half of length
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_ABS) + BPF_SIZE(BPF_B), 2),
-    // 04 ADD X        a = a + x  // combine endian swapped
-    BPF_STMT(BPF_ALU + BPF_OP(BPF_ADD) + BPF_SRC(BPF_X), 0),
-
-    // 05 ST M[0]      m[0] = a (rtap length)
-    BPF_STMT(BPF_ST, 0),
-    // 06 TAX          x = a = rtap length
-    BPF_STMT(BPF_MISC + BPF_MISCOP(BPF_TAX), 0),
-
-    // 07 LDB [x + 0]  a = pkt[rtap + 0]
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IND) + BPF_SIZE(BPF_B), 0),
-    // 08 RSH #2       a = a >> 2
-    BPF_STMT(BPF_ALU + BPF_OP(BPF_RSH), 2),
-    // 09 AND 0x3      a = a & 0x3
-    BPF_STMT(BPF_ALU + BPF_OP(BPF_AND), 3),
-
-    // 10 JEQ #0       if a == 0 succeed
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x0, 0, 1),
-    // 11 RET 0x40000  return success
-    BPF_STMT(BPF_RET, 0x40000),
-
-    // 12 JEQ #2       if a == 2, continue, else fail
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x2, 1, 0),
-    // 13 RET 0x0      return fail
-    BPF_STMT(BPF_RET, 0),
-
-    // 14 LDB [x + 0]  a = pkt[rtap + 0]
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IND) + BPF_SIZE(BPF_B), 0),
-    // 15 RSH #4       a = a >> 4
-    BPF_STMT(BPF_ALU + BPF_OP(BPF_RSH), 4),
-
-    // 16 JEQ #0       a == 0x0 (subtype data)
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x0, 0, 2),
-    // 17 LD #24        a = 24 (non-qos header len)
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IMM), 24),
-    // 18 JMP          jump past qos
-    BPF_STMT(BPF_JMP + BPF_JA, 3),
-
-    // 19 JEQ #8       a == 0x8 (subtype qos data)
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x8, 1, 0),
-    // 20 RET 0x0      return fail, not normal or qos
-    BPF_STMT(BPF_RET, 0),
-
-    // 21 LD #26       a = 26 (qos header len)
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IMM), 26),
-
-    // 22 LDX M[0]     X = m[0] (rtap length)
-    BPF_STMT(BPF_LDX + BPF_MODE(BPF_MEM), 0),
-    // 23 ADD X        a = a + x
-    BPF_STMT(BPF_ALU + BPF_OP(BPF_ADD) + BPF_SRC(BPF_X), 0),
-    // 24 ST M[1]      m[1] = a (rtap length + offset length)
-    BPF_STMT(BPF_ST, 1),
-    // 25 TAX          x = a
-    BPF_STMT(BPF_MISC + BPF_MISCOP(BPF_TAX), 0),
-
-    // 26 LDH [x + 0]  a = pkt[rtap + header + 0]
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IND) + BPF_SIZE(BPF_H), 0),
-    // 27 JEQ 0xAAAA   a == 0xAAAA (SNAP header)
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0xAAAA, 0, 2),
-
-    // 28 LDH [x + 0]  a = pkt[rtap + header + 6]
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IND) + BPF_SIZE(BPF_H), 6),
-    // 29 JEQ 0x888e   a == 0x888E eapol sig
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x888E, 1, 0),
-
-    // 30 RET 0x0      return fail
-    BPF_STMT(BPF_RET, 0),
-    // 31 RET 0x0      return success
-    BPF_STMT(BPF_RET, 0x40000),
-};
-unsigned int rt_pgm_len = 32;
-
-// Pass management, EAPOL
-// Crop other data to rtap+dot11 headers
-struct bpf_insn rt_pgm_crop_data[] = {
-    // 00 LDB [3]      a = pkt[3] second half of length
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_ABS) + BPF_SIZE(BPF_B), 3),
-    // 01 LSH #8       a = a << 8
-    BPF_STMT(BPF_ALU + BPF_OP(BPF_LSH), 8),
-    // 02 TAX          x = a
-    BPF_STMT(BPF_MISC + BPF_MISCOP(BPF_TAX), 0),
-    // 03 LDB [2]      a = pkt[2] first half of length
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_ABS) + BPF_SIZE(BPF_B), 2),
-    // 04 ADD X         a = a + x  // combine endian swapped
-    BPF_STMT(BPF_ALU + BPF_OP(BPF_ADD) + BPF_SRC(BPF_X), 0),
-
-    // 05 ST M[0]      m[0] = a (rtap length)
-    BPF_STMT(BPF_ST, 0),
-    // 06 TAX          x = a = rtap length
-    BPF_STMT(BPF_MISC + BPF_MISCOP(BPF_TAX), 0),
-
-    // Fetch frame type
-
-    // 07 LDB [x + 0]  a = pkt[rtap + 0]
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IND) + BPF_SIZE(BPF_B), 0),
-
-    // 08 AND #0xC     a & 0xC - extract type
-    BPF_STMT(BPF_ALU + BPF_OP(BPF_AND), 0xC),
-
-    // 09 JEQ #0x0    if == 0, accept as management frame
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x0, 0, 1),
-    // 10 RET 0x40000  return success
-    BPF_STMT(BPF_RET, 0x40000),
-
-    // 11 JEQ #2       if a == 0x8, continue - process data frames (0x8 == b1000)
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x8, 1, 0),
-    // 12 RET 0x0      reject all other frames
-    BPF_STMT(BPF_RET, 0),
-
-    // 13 LDB [x + 0]  a = pkt[rtap + 0] - re-load A with FC byte
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IND) + BPF_SIZE(BPF_B), 0),
-    // 14 AND #0xF0    a = a & 0xF0 - isolate subtype
-    BPF_STMT(BPF_ALU + BPF_OP(BPF_AND), 0xF0),
-
-    // 15 JEQ #0       a == 0x0 (subtype normal data)
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x0, 0, 2),
-    // 16 LD #24        a = 24 (non-qos header len)
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IMM), 24),
-    // 17 JMP          jump past qos (22)
-    BPF_STMT(BPF_JMP + BPF_JA, 3),
-
-    // 18 JEQ #0x80    a == 0x80 (subtype qos data)
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x80, 1, 0),
-    // 29 RET 0x0      reject, data subtype we don't care to process
-    BPF_STMT(BPF_RET, 0),
-
-    // 20 LD #26       a = 26 - set qos header len
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IMM), 26),
-
-    // 21 ST M[1]      m[1] = a (offset length) -- Store length before checking protected flag
-    BPF_STMT(BPF_ST, 1),
-
-    // 22 LDB [ x + 1]  a = pkt[rtap + 1] (flags)
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IND) + BPF_SIZE(BPF_B), 1),
-    // 23 JSET 0x40   if a & 0x40 set protected bit
-    BPF_JUMP(BPF_JMP + BPF_JSET, 0x40, 1, 0),
-
-    // 24 LD #0       a = 0
-    BPF_STMT(BPF_LD + BPF_SRC(BPF_K), 0),
-    // 25 ST M[2]     m[2] = 0
-    BPF_STMT(BPF_ST, 2),
-
-    // 26 LDA m[1] .   a = m[1] (saved data offset length)
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_MEM), 1),
-    // 27 LDX M[0]     X = m[0] (rtap length)
-    BPF_STMT(BPF_LDX + BPF_MODE(BPF_MEM), 0),
-    // 28 ADD X        a = a + x
-    BPF_STMT(BPF_ALU + BPF_OP(BPF_ADD) + BPF_SRC(BPF_X), 0),
-    // 29 ST M[1]      m[1] = a (rtap length + offset length)
-    BPF_STMT(BPF_ST, 1),
-    // 30 TAX          x = a (x = total offset length)
-    BPF_STMT(BPF_MISC + BPF_MISCOP(BPF_TAX), 0),
-
-    // 31 LDA m[2] .   a = m[2] (saved flags)
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_MEM), 2),
-    // 32 JEQ #0 .     a == 0x0 - truncate if it's a protected frame
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x0, 0, 4),
-
-    // 33 LDH [x + 0]  a = pkt[rtap + header + 0] - X hasn't been changed since we loaded it
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IND) + BPF_SIZE(BPF_H), 0),
-    // 34 JEQ 0xAAAA   a == 0xAAAA (SNAP header) or truncate
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0xAAAA, 0, 2),
-
-    // 35 LDH [x + 0]  a = pkt[rtap + header + 6]
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IND) + BPF_SIZE(BPF_H), 6),
-    // 36 JEQ 0x888e   a == 0x888E eapol sig or truncate
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x888E, 0, 2),
-
-    // truncate - x is still the total length of the header restored from m2
-
-    // 37 TXA          a = x
-    BPF_STMT(BPF_MISC + BPF_MISCOP(BPF_TXA), 0),
-    // 38 RET a        Return a (limit packet length to rtap+dot11+qos?)
-    BPF_STMT(BPF_RET + BPF_RVAL(BPF_A), 0),
-
-    // 39 RET 0x0      return entire packet
-    BPF_STMT(BPF_RET, 0x40000),
-};
-unsigned int rt_pgm_crop_data_len = 40;
-
-// BPF program to parse raw 802.11 and pass management and eapol ONLY
-struct bpf_insn dot11_pgm[] = {
-    // 00 LDX #0       x = 0
-    BPF_STMT(BPF_LDX + BPF_MODE(BPF_IMM), 0),
-
-    // 01 LDB [x + 0]  a = pkt[0]
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IND) + BPF_SIZE(BPF_B), 0),
-    // 02 RSH #2       a = a >> 2
-    BPF_STMT(BPF_ALU + BPF_OP(BPF_RSH), 2),
-    // 03 AND 0x3      a = a & 0x3
-    BPF_STMT(BPF_ALU + BPF_OP(BPF_AND), 3),
-
-    // 04 JEQ #0       if a == 0 succeed
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x0, 0, 1),
-    // 05 RET 0x40000  return success
-    BPF_STMT(BPF_RET, 0x40000),
-
-    // 06 JEQ #2       if a == 2, continue, else fail
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x2, 1, 0),
-    // 07 RET 0x0      return fail
-    BPF_STMT(BPF_RET, 0),
-
-    // 08 LDB [x + 0]  a = pkt[rtap + 0]
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IND) + BPF_SIZE(BPF_B), 0),
-    // 09 RSH #4       a = a >> 4
-    BPF_STMT(BPF_ALU + BPF_OP(BPF_RSH), 4),
-
-    // 10 JEQ #0       a == 0x0 (subtype data)
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x0, 0, 2),
-    // 11 LDX #24      x = 24 (non-qos header len)
-    BPF_STMT(BPF_LDX + BPF_MODE(BPF_IMM), 24),
-    // 12 JMP          jump past qos
-    BPF_STMT(BPF_JMP + BPF_JA, 3),
-
-    // 13 JEQ #8       a == 0x8 (subtype qos data)
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x8, 1, 0),
-    // 14 RET 0x0      return fail, not normal or qos
-    BPF_STMT(BPF_RET, 0),
-
-    // 15 LDX #26      x = 26 (qos header len)
-    BPF_STMT(BPF_LDX + BPF_MODE(BPF_IMM), 26),
-
-    // 16 LDH [x + 0]  a = pkt[rtap + header + 0]
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IND) + BPF_SIZE(BPF_H), 0),
-    // 17 JEQ 0xAAAA   a == 0xAAAA (SNAP header)
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0xAAAA, 0, 2),
-
-    // 18 LDH [x + 0]  a = pkt[rtap + header + 6]
-    BPF_STMT(BPF_LD + BPF_MODE(BPF_IND) + BPF_SIZE(BPF_H), 6),
-    // 19 JEQ 0x888e   a == 0x888E eapol sig
-    BPF_JUMP(BPF_JMP + BPF_JEQ, 0x888E, 1, 0),
-
-    // 20 RET 0x0      return fail
-    BPF_STMT(BPF_RET, 0),
-    // 21 RET 0x0      return success
-    BPF_STMT(BPF_RET, 0x40000),
-};
-unsigned int dot11_pgm_len = 22;
-
 /* State tracking, put in userdata */
 typedef struct {
     pcap_t *pd;
@@ -377,9 +131,32 @@ typedef struct {
     int use_ht_channels;
     int use_vht_channels;
 
-    /* Do we filter traffic? */
-    bool wardrive_filter;
-    bool data_filter;
+    /* Frame classes passed by the kernel filter, the number of bytes of each data frame
+     * past the 802.11 header to keep (or -1 for all), and any user bpf expression
+     * applied first */
+    unsigned int frame_classes;
+    int data_snaplen;
+    char *bpf_filter;
+
+    /* Capture from a TPACKET_V3 block ring instead of pcap; the ring geometry, and
+     * the fanout group (or 0) and mode shared with other captures on the interface */
+    int use_ring;
+    linux_wifi_ring_t ring;
+    unsigned int ring_block_kb;
+    unsigned int ring_blocks;
+    unsigned int ring_timeout_ms;
+    unsigned int fanout_group;
+    unsigned int fanout_mode;
+
+    /* Kernel capture counters, polled once a second and reported to the server as 
+     * totals since the capture opened, and the totals at the last verbose statistics 
+     * message */
+    time_t stats_last;
+    uint64_t kernel_packets;
+    uint64_t kernel_drops;
+    time_t stats_msg_last;
+    uint64_t stats_msg_packets;
+    uint64_t stats_msg_drops;
 
     /* Number of sequential errors setting channel */
     unsigned int seq_channel_failure;
@@ -400,6 +177,13 @@ typedef struct {
     unsigned long channel_set_ns_avg;
     unsigned int channel_set_ns_count;
 
+    /* Hop with the asynchronous netlink channel controller, which is opened on the
+     * first hop against the current capture interface */
+    int use_async_channels;
+    int chanctl_open;
+    mac80211_chanctl_t chanctl;
+    unsigned int chanctl_stats_count;
+
 } local_wifi_t;
 
 /* Linux Wi-Fi Channels:
@@ -962,6 +746,116 @@ int populate_chanlist(kis_capture_handler_t *caph, char *interface, char *msg,
     return 1;
 }
 
+int chancontrol_callback(kis_capture_handler_t *caph, uint32_t seqno, void *privchan,
+        char *msg);
+
+/* Hop to a channel through the asynchronous channel controller.  Failures reported by
+ * the kernel for earlier hops are picked up here and counted against the run of
+ * failed channel sets. */
+int chancontrol_async(kis_capture_handler_t *caph, local_wifi_t *local_wifi,
+        local_channel_t *channel) {
+    char errstr[STATUS_MAX];
+    char chanstr[STATUS_MAX];
+    char msg[STATUS_MAX];
+    unsigned int errors;
+    mac80211_chanctl_stats_t stats;
+    int r;
+
+    /* The capture interface can change when a vif is created, so follow it */
+    if (local_wifi->chanctl_open && local_wifi->chanctl.ifidx != local_wifi->mac80211_ifidx) {
+        mac80211_chanctl_close(&local_wifi->chanctl);
+        local_wifi->chanctl_open = 0;
+    }
+
+    if (!local_wifi->chanctl_open) {
+        if (mac80211_chanctl_open(&local_wifi->chanctl, local_wifi->mac80211_ifidx, errstr) < 0) {
+            snprintf(msg, STATUS_MAX, "%s %s/%s could not open asynchronous channel control, "
+                    "waiting for each channel change instead: %s",
+                    local_wifi->name, local_wifi->interface, local_wifi->cap_interface, errstr);
+            cf_send_message(caph, msg, MSGFLAG_INFO);
+            local_wifi->use_async_channels = 0;
+            return chancontrol_callback(caph, 0, channel, msg);
+        }
+
+        local_wifi->chanctl_open = 1;
+    }
+
+    if ((errors = mac80211_chanctl_take_errors(&local_wifi->chanctl, errstr)) > 0) {
+        local_wifi->seq_channel_failure += errors;
+
+        if (local_wifi->seq_channel_failure >= 10) {
+            snprintf(msg, STATUS_MAX, "%s %s/%s failed to set channel: %s", 
+                    local_wifi->name, local_wifi->interface, local_wifi->cap_interface, 
+                    errstr);
+            cf_send_error(caph, 0, msg);
+            return -1;
+        }
+
+        if (local_wifi->verbose_diagnostics) {
+            snprintf(msg, STATUS_MAX, "%s %s/%s could not set channel; ignoring error "
+                    "and continuing (%s)", 
+                    local_wifi->name, local_wifi->interface, local_wifi->cap_interface, 
+                    errstr);
+            cf_send_message(caph, msg, MSGFLAG_ERROR);
+        }
+    } else {
+        local_wifi->seq_channel_failure = 0;
+    }
+
+    if (channel->chan_width != 0) {
+        r = mac80211_chanctl_set_frequency(&local_wifi->chanctl,
+                channel->control_freq, channel->chan_width,
+                channel->center_freq1, channel->center_freq2, errstr);
+    } else {
+        r = mac80211_chanctl_set_channel(&local_wifi->chanctl,
+                channel->control_freq, channel->chan_type, errstr);
+    }
+
+    if (r < 0) {
+        local_wifi->seq_channel_failure++;
+
+        if (local_wifi->seq_channel_failure >= 10) {
+            local_channel_to_str(channel, chanstr);
+            snprintf(msg, STATUS_MAX, "%s %s/%s failed to set channel %s: %s", 
+                    local_wifi->name, local_wifi->interface, local_wifi->cap_interface, 
+                    chanstr, errstr);
+            cf_send_error(caph, 0, msg);
+            return -1;
+        }
+
+        if (local_wifi->verbose_diagnostics) {
+            local_channel_to_str(channel, chanstr);
+            snprintf(msg, STATUS_MAX, "%s %s/%s could not set channel %s; ignoring error "
+                    "and continuing (%s)", 
+                    local_wifi->name, local_wifi->interface, local_wifi->cap_interface, 
+                    chanstr, errstr);
+            cf_send_message(caph, msg, MSGFLAG_ERROR);
+        }
+
+        return 0;
+    }
+
+    /* Let the hop scheduler account for the time the radio spends switching */
+    cf_handler_set_hop_latency(caph, mac80211_chanctl_latency(&local_wifi->chanctl) / 1000);
+
+    if (local_wifi->verbose_statistics && ++local_wifi->chanctl_stats_count >= 100) {
+        local_wifi->chanctl_stats_count = 0;
+
+        mac80211_chanctl_get_stats(&local_wifi->chanctl, &stats);
+
+        snprintf(msg, STATUS_MAX, "%s %s/%s channel switch latency average %luuS peak %luuS, "
+                "%lu channel changes, %lu failed, %lu unanswered",
+                local_wifi->name, local_wifi->interface, local_wifi->cap_interface,
+                (unsigned long) (stats.latency_avg_ns / 1000), 
+                (unsigned long) (stats.latency_peak_ns / 1000),
+                (unsigned long) stats.sets, (unsigned long) stats.errors, 
+                (unsigned long) stats.lost);
+        cf_send_message(caph, msg, MSGFLAG_INFO);
+    }
+
+    return 1;
+}
+
 /* Channel control callback; actually set a channel.  Determines if our
  * custom channel needs a VHT frequency set. */
 int chancontrol_callback(kis_capture_handler_t *caph, uint32_t seqno, void *privchan,
@@ -1019,6 +913,8 @@ int chancontrol_callback(kis_capture_handler_t *caph, uint32_t seqno, void *priv
              * immediately.
              *
              * */
+            local_wifi->seq_channel_failure++;
+
             if (local_wifi->seq_channel_failure < 10) {
                 if (seqno == 0 && local_wifi->verbose_diagnostics) {
                     local_channel_to_str(channel, chanstr);
@@ -1057,6 +953,12 @@ int chancontrol_callback(kis_capture_handler_t *caph, uint32_t seqno, void *priv
          * what kind of channel we're setting */
         /* fprintf(stderr, "debug - %s setting channel %d w %d\n", local_wifi->cap_interface, channel->control_freq, channel->chan_width); */
 
+        /* Hops go through the asynchronous controller, which returns as soon as the
+         * request is sent; explicit channel changes from the server wait for the
+         * kernel so the result can be reported */
+        if (seqno == 0 && local_wifi->use_async_channels)
+            return chancontrol_async(caph, local_wifi, channel);
+
         if (channel->chan_width != 0) {
             /* An explicit channel width means we need to use _set_freq to set
              * a control freq, a width, and possibly an extended center frequency
@@ -1136,6 +1038,8 @@ int chancontrol_callback(kis_capture_handler_t *caph, uint32_t seqno, void *priv
              * If we're sending an explicit channel change command, error out
              * immediately.
              */
+            local_wifi->seq_channel_failure++;
+
             if (local_wifi->seq_channel_failure < 10) {
                 if (local_wifi->verbose_diagnostics && seqno == 0) {
                     local_channel_to_str(channel, chanstr);
@@ -1522,6 +1426,79 @@ int build_explicit_filters(char **stringmacs, int num_macs, char **filter) {
     return num_macs;
 }
 
+/* Do we filter by frame class, truncate data, or have a bpf expression? */
+static int local_wifi_frame_filtered(local_wifi_t *local_wifi) {
+    return local_wifi->frame_classes != LINUX_WIFI_FILTER_ALL ||
+        local_wifi->data_snaplen >= 0 || local_wifi->bpf_filter != NULL;
+}
+
+/* Build and attach the bpf expression and frame class filters; pcap attaches them
+ * to the capture socket, so dropped frames are never copied out of the kernel
+ *
+ * Returns:
+ * -1   Error, with the reason in errstr
+ *  1   Success
+ */
+static int local_wifi_install_filter(local_wifi_t *local_wifi, char *errstr) {
+    struct bpf_program user_bpf, class_bpf, chain_bpf, *bpf;
+    int have_user = 0, have_class = 0, have_chain = 0;
+    int dlt = pcap_datalink(local_wifi->pd);
+    int ret = -1;
+
+    if (local_wifi->bpf_filter != NULL) {
+        if (pcap_compile(local_wifi->pd, &user_bpf, local_wifi->bpf_filter, 1, 0) < 0) {
+            snprintf(errstr, STATUS_MAX, "%s unable to compile bpf filter '%s': %s",
+                    local_wifi->name, local_wifi->bpf_filter, pcap_geterr(local_wifi->pd));
+            return -1;
+        }
+
+        have_user = 1;
+    }
+
+    if (local_wifi->frame_classes != LINUX_WIFI_FILTER_ALL || local_wifi->data_snaplen >= 0) {
+        if (linux_wifi_build_frame_filter(&class_bpf, dlt, local_wifi->frame_classes,
+                    local_wifi->data_snaplen) < 0) {
+            snprintf(errstr, STATUS_MAX, "%s unable to install frame filter on link type %u/%s",
+                    local_wifi->name, dlt, pcap_datalink_val_to_name(dlt));
+            goto finish;
+        }
+
+        have_class = 1;
+    }
+
+    if (have_user && have_class) {
+        if (linux_wifi_chain_filters(&chain_bpf, &user_bpf, &class_bpf) < 0) {
+            snprintf(errstr, STATUS_MAX, "%s unable to combine the bpf filter and the "
+                    "frame filter, the bpf filter is too large", local_wifi->name);
+            goto finish;
+        }
+
+        have_chain = 1;
+        bpf = &chain_bpf;
+    } else if (have_user) {
+        bpf = &user_bpf;
+    } else {
+        bpf = &class_bpf;
+    }
+
+    if (pcap_setfilter(local_wifi->pd, bpf) < 0) {
+        snprintf(errstr, STATUS_MAX, "%s unable to install packet filter: %s",
+                local_wifi->name, pcap_geterr(local_wifi->pd));
+        goto finish;
+    }
+
+    ret = 1;
+
+finish:
+    if (have_chain)
+        pcap_freecode(&chain_bpf);
+    if (have_class)
+        pcap_freecode(&class_bpf);
+    if (have_user)
+        pcap_freecode(&user_bpf);
+
+    return ret;
+}
 
 int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
         char *msg, uint32_t *dlt, char **uuid, KismetExternal__Command *frame,
@@ -1618,6 +1595,11 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
         local_wifi->name = NULL;
     }
 
+    if (local_wifi->chanctl_open) {
+        mac80211_chanctl_close(&local_wifi->chanctl);
+        local_wifi->chanctl_open = 0;
+    }
+
     if (local_wifi->mac80211_socket) {
         mac80211_disconnect(local_wifi->mac80211_socket);
         local_wifi->mac80211_socket = NULL;
@@ -1628,6 +1610,23 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
         local_wifi->pd = NULL;
     }
 
+    if (local_wifi->bpf_filter) {
+        free(local_wifi->bpf_filter);
+        local_wifi->bpf_filter = NULL;
+    }
+
+    local_wifi->frame_classes = LINUX_WIFI_FILTER_ALL;
+    local_wifi->data_snaplen = -1;
+
+    linux_wifi_ring_close(&local_wifi->ring);
+
+    local_wifi->use_ring = 0;
+    local_wifi->ring_block_kb = 1024;
+    local_wifi->ring_blocks = 8;
+    local_wifi->ring_timeout_ms = 10;
+    local_wifi->fanout_group = 0;
+    local_wifi->fanout_mode = LINUX_WIFI_RING_FANOUT_HASH;
+
     /* Start processing the open */
 
     if ((placeholder_len = cf_parse_interface(&placeholder, definition)) <= 0) {
@@ -1664,26 +1663,123 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
         }
     }
 
-    /* Do we filter packets for wardrive mode to mgmt only? */
+    /* Do we hop without waiting for the kernel to acknowledge each channel change? */
     if ((placeholder_len = 
-                cf_find_flag(&placeholder, "filter_mgmt", definition)) > 0) {
+                cf_find_flag(&placeholder, "async_channels", definition)) > 0) {
         if (strncasecmp(placeholder, "false", placeholder_len) == 0) {
-            local_wifi->wardrive_filter = false;
+            local_wifi->use_async_channels = 0;
         } else if (strncasecmp(placeholder, "true", placeholder_len) == 0) {
-            local_wifi->wardrive_filter = true;
+            local_wifi->use_async_channels = 1;
+        }
+    }
+
+    /* Do we filter packets for wardrive mode to mgmt only? */
+    if ((placeholder_len = 
+                cf_find_flag(&placeholder, "filter_mgmt", definition)) > 0) {
+        if (strncasecmp(placeholder, "true", placeholder_len) == 0) {
+            local_wifi->frame_classes = LINUX_WIFI_FILTER_MGMT | LINUX_WIFI_FILTER_EAPOL;
         }
     }
 
     /* Do we truncate all data? */
     if ((placeholder_len = 
                 cf_find_flag(&placeholder, "truncate_data", definition)) > 0) {
-        if (strncasecmp(placeholder, "false", placeholder_len) == 0) {
-            local_wifi->data_filter = false;
-        } else if (strncasecmp(placeholder, "true", placeholder_len) == 0) {
-            local_wifi->data_filter = true;
+        if (strncasecmp(placeholder, "true", placeholder_len) == 0) {
+            local_wifi->frame_classes &= ~LINUX_WIFI_FILTER_CTRL;
+            local_wifi->data_snaplen = 0;
         }
     }
-    
+
+    /* Which frame classes do we pass, such as mgmt+ctrl+eapol? */
+    if ((placeholder_len = 
+                cf_find_flag(&placeholder, "frame_filter", definition)) > 0) {
+        if (linux_wifi_parse_frame_classes(placeholder, placeholder_len, 
+                    &local_wifi->frame_classes) < 0 || local_wifi->frame_classes == 0) {
+            snprintf(msg, STATUS_MAX, "Unable to parse frame_filter '%.*s', expected "
+                    "frame classes mgmt, ctrl, data, eapol, or all, separated by '+'",
+                    placeholder_len, placeholder);
+            return -1;
+        }
+    }
+
+    /* Do we cut data frames down to their headers? */
+    if ((placeholder_len = 
+                cf_find_flag(&placeholder, "data_snaplen", definition)) > 0) {
+        if (sscanf(placeholder, "%d", &local_wifi->data_snaplen) != 1 ||
+                local_wifi->data_snaplen < 0 || local_wifi->data_snaplen > MAX_PACKET_LEN) {
+            snprintf(msg, STATUS_MAX, "Unable to parse data_snaplen, expected the number "
+                    "of bytes of each data frame to keep after the 802.11 header");
+            return -1;
+        }
+    }
+
+    /* Do we have a bpf filter expression, applied before the frame filter? */
+    if ((placeholder_len = 
+                cf_find_flag(&placeholder, "bpf", definition)) > 0) {
+        local_wifi->bpf_filter = strndup(placeholder, placeholder_len);
+    }
+
+    /* Do we capture from a memory mapped block ring? */
+    if ((placeholder_len = 
+                cf_find_flag(&placeholder, "ring", definition)) > 0) {
+        if (strncasecmp(placeholder, "true", placeholder_len) == 0) {
+            local_wifi->use_ring = 1;
+        }
+    }
+
+    if ((placeholder_len = 
+                cf_find_flag(&placeholder, "ring_block_kb", definition)) > 0) {
+        if (sscanf(placeholder, "%u", &local_wifi->ring_block_kb) != 1 ||
+                local_wifi->ring_block_kb == 0 || local_wifi->ring_block_kb > 65536) {
+            snprintf(msg, STATUS_MAX, "Unable to parse ring_block_kb, expected the size "
+                    "of each ring block in kB");
+            return -1;
+        }
+    }
+
+    if ((placeholder_len = 
+                cf_find_flag(&placeholder, "ring_blocks", definition)) > 0) {
+        if (sscanf(placeholder, "%u", &local_wifi->ring_blocks) != 1 ||
+                local_wifi->ring_blocks == 0 || local_wifi->ring_blocks > 4096) {
+            snprintf(msg, STATUS_MAX, "Unable to parse ring_blocks, expected the number "
+                    "of blocks in the ring");
+            return -1;
+        }
+    }
+
+    if ((placeholder_len = 
+                cf_find_flag(&placeholder, "ring_timeout", definition)) > 0) {
+        if (sscanf(placeholder, "%u", &local_wifi->ring_timeout_ms) != 1) {
+            snprintf(msg, STATUS_MAX, "Unable to parse ring_timeout, expected the time "
+                    "in milliseconds before a partial block is delivered");
+            return -1;
+        }
+    }
+
+    /* Do we share the interface with other captures in a fanout group?  Fanout is
+     * only available on the ring */
+    if ((placeholder_len = 
+                cf_find_flag(&placeholder, "fanout_group", definition)) > 0) {
+        if (sscanf(placeholder, "%u", &local_wifi->fanout_group) != 1 ||
+                local_wifi->fanout_group == 0 || local_wifi->fanout_group > 0xFFFF) {
+            snprintf(msg, STATUS_MAX, "Unable to parse fanout_group, expected a group "
+                    "id from 1 to 65535");
+            return -1;
+        }
+
+        local_wifi->use_ring = 1;
+    }
+
+    if ((placeholder_len = 
+                cf_find_flag(&placeholder, "fanout_mode", definition)) > 0) {
+        if (linux_wifi_ring_parse_fanout(placeholder, placeholder_len, 
+                    &local_wifi->fanout_mode) < 0) {
+            snprintf(msg, STATUS_MAX, "Unable to parse fanout_mode '%.*s', expected hash, "
+                    "lb, cpu, rollover, or random", placeholder_len, placeholder);
+            return -1;
+        }
+    }
+
 
     /* Do we ignore any other interfaces on this device? */
     if ((placeholder_len = 
@@ -1695,8 +1791,9 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
         }
     }
 
-    if (filter_locals && (local_wifi->wardrive_filter || local_wifi->data_filter)) {
-        snprintf(msg, STATUS_MAX, "Can not combine 'filter_mgmt', 'truncate_data', and "
+    if (filter_locals && local_wifi_frame_filtered(local_wifi)) {
+        snprintf(msg, STATUS_MAX, "Can not combine 'filter_mgmt', 'truncate_data', "
+                 "'frame_filter', 'data_snaplen', or 'bpf' and "
                  "'filter_locals' or 'filter_interface' "
                  "please pick just one option.");
         return -1;
@@ -1710,9 +1807,10 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
             return -1;
         }
 
-        if (local_wifi->wardrive_filter || local_wifi->data_filter) {
-            snprintf(msg, STATUS_MAX, "Can not combine 'filter_mgmt' or 'truncate_data' and 'filter_locals' or 'filter_interface' "
-                     "please pick just one option.");
+        if (local_wifi_frame_filtered(local_wifi)) {
+            snprintf(msg, STATUS_MAX, "Can not combine 'filter_mgmt', 'truncate_data', "
+                     "'frame_filter', 'data_snaplen', or 'bpf' and 'filter_locals' or "
+                     "'filter_interface' please pick just one option.");
             return -1;
         }
 
@@ -1756,6 +1854,13 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
             return -1;
         }
 
+        if (local_wifi_frame_filtered(local_wifi)) {
+            snprintf(msg, STATUS_MAX, "Can not combine 'filter_mgmt', 'truncate_data', "
+                     "'frame_filter', 'data_snaplen', or 'bpf' and 'filter_address' "
+                     "please pick just one option.");
+            return -1;
+        }
+
         filter_targets = (char **) malloc(sizeof(char *) * num_filter_addresses);
 
         for (i = 0; i < num_filter_addresses; i++)
@@ -2651,44 +2756,9 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
         return -1;
     }
 
-    if (local_wifi->wardrive_filter) {
-        if (pcap_datalink(local_wifi->pd) == DLT_IEEE802_11_RADIO) {
-            bpf.bf_len = rt_pgm_len;
-            bpf.bf_insns = rt_pgm;
-            if (pcap_setfilter(local_wifi->pd, &bpf) < 0) {
-                snprintf(errstr, STATUS_MAX, "%s unable to install management packet filter: %s",
-                         local_wifi->name, pcap_geterr(local_wifi->pd));
-                cf_send_message(caph, errstr, MSGFLAG_ERROR);
-            }
-        } else if (pcap_datalink(local_wifi->pd) == DLT_IEEE802_11) {
-            bpf.bf_len = dot11_pgm_len;
-            bpf.bf_insns = dot11_pgm;
-            if (pcap_setfilter(local_wifi->pd, &bpf) < 0) {
-                snprintf(errstr, STATUS_MAX, "%s unable to install management packet filter: %s",
-                         local_wifi->name, pcap_geterr(local_wifi->pd));
-                cf_send_message(caph, errstr, MSGFLAG_ERROR);
-            }
-        } else {
-            snprintf(errstr, STATUS_MAX, "%s unable to install management packet filter on unknown link type %u/%s",
-                     local_wifi->name, pcap_datalink(local_wifi->pd), 
-                     pcap_datalink_val_to_name(pcap_datalink(local_wifi->pd)));
-            cf_send_message(caph, errstr, MSGFLAG_ERROR);
-        }
-    } else if (local_wifi->data_filter) {
-        if (pcap_datalink(local_wifi->pd) == DLT_IEEE802_11_RADIO) {
-            bpf.bf_len = rt_pgm_crop_data_len;
-            bpf.bf_insns = rt_pgm_crop_data;
-            if (pcap_setfilter(local_wifi->pd, &bpf) < 0) {
-                snprintf(errstr, STATUS_MAX, "%s unable to install data packet filter: %s",
-                         local_wifi->name, pcap_geterr(local_wifi->pd));
-                cf_send_message(caph, errstr, MSGFLAG_ERROR);
-            }
-        } else {
-            snprintf(errstr, STATUS_MAX, "%s unable to install data filter on non-rtap link type %u/%s",
-                     local_wifi->name, pcap_datalink(local_wifi->pd), 
-                     pcap_datalink_val_to_name(pcap_datalink(local_wifi->pd)));
+    if (local_wifi_frame_filtered(local_wifi)) {
+        if (local_wifi_install_filter(local_wifi, errstr) < 0)
             cf_send_message(caph, errstr, MSGFLAG_ERROR);
-        }
     } else if (filter_locals) {
         if ((ret = build_first_localdev_filter(&ignore_filter)) > 0) {
             if (ret > 8) {
@@ -2769,6 +2839,34 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
     local_wifi->datalink_type = pcap_datalink(local_wifi->pd);
     *dlt = local_wifi->datalink_type;
 
+    /* Move capture to the ring; pcap has set up the interface and compiled and attached
+     * the filters, which are copied over before the pcap handle is closed */
+    if (local_wifi->use_ring) {
+        if (linux_wifi_ring_open(&local_wifi->ring, local_wifi->cap_interface,
+                    local_wifi->ring_block_kb, local_wifi->ring_blocks,
+                    local_wifi->ring_timeout_ms, local_wifi->fanout_group,
+                    local_wifi->fanout_mode, errstr) < 0) {
+            snprintf(msg, STATUS_MAX, "%s could not open capture ring on '%s': %s",
+                    local_wifi->name, local_wifi->cap_interface, errstr);
+            return -1;
+        }
+
+        if (linux_wifi_ring_copy_filter(&local_wifi->ring, 
+                    pcap_fileno(local_wifi->pd), errstr) < 0) {
+            snprintf(msg, STATUS_MAX, "%s could not move packet filter to capture ring "
+                    "on '%s': %s", local_wifi->name, local_wifi->cap_interface, errstr);
+            linux_wifi_ring_close(&local_wifi->ring);
+            return -1;
+        }
+
+        pcap_close(local_wifi->pd);
+        local_wifi->pd = NULL;
+    }
+
+    local_wifi->stats_last = local_wifi->stats_msg_last = time(NULL);
+    local_wifi->kernel_packets = local_wifi->kernel_drops = 0;
+    local_wifi->stats_msg_packets = local_wifi->stats_msg_drops = 0;
+
     if (strcmp(local_wifi->interface, local_wifi->cap_interface) != 0) {
         snprintf(msg, STATUS_MAX, "%s Linux Wi-Fi capturing from monitor vif '%s' on "
                 "interface '%s'", local_wifi->name, local_wifi->cap_interface, local_wifi->interface);
@@ -2940,37 +3038,124 @@ int list_callback(kis_capture_handler_t *caph, uint32_t seqno,
     return num_devs;
 }
 
-void pcap_dispatch_cb(u_char *user, const struct pcap_pkthdr *header,
-        const u_char *data)  {
-    kis_capture_handler_t *caph = (kis_capture_handler_t *) user;
+/* Send a packet, waiting for the write buffer to flush if it is full
+ *
+ * Returns:
+ * -1   Error, the handler is spinning down
+ *  1   Success
+ */
+static int local_wifi_send_packet(kis_capture_handler_t *caph, struct timeval ts,
+        uint32_t caplen, const uint8_t *data) {
     local_wifi_t *local_wifi = (local_wifi_t *) caph->userdata;
     int ret;
 
-    /* fprintf(stderr, "debug - pcap_dispatch - got packet %u\n", header->caplen); */
-
     /* Try repeatedly to send the packet; go into a thread wait state if
      * the write buffer is full & we'll be woken up as soon as it flushes
      * data out in the main select() loop */
     while (1) {
         if ((ret = cf_send_data(caph, 
                         NULL, NULL, NULL,
-                        header->ts, 
+                        ts, 
                         local_wifi->datalink_type,
-                        header->caplen, (uint8_t *) data)) < 0) {
-            pcap_breakloop(local_wifi->pd);
+                        caplen, (uint8_t *) data)) < 0) {
             fprintf(stderr, "%s %s/%s could not send packet to Kismet server, terminating.", 
                     local_wifi->name, local_wifi->interface, local_wifi->cap_interface);
             cf_handler_spindown(caph);
+            return -1;
         } else if (ret == 0) {
             /* Go into a wait for the write buffer to get flushed */
             cf_handler_wait_ringbuffer(caph);
             continue;
         } else {
-            break;
+            return 1;
         }
     }
 }
 
+/* Report the kernel counters to the framework, and to the user every 10 seconds if
+ * verbose statistics are on */
+static void local_wifi_update_stats(kis_capture_handler_t *caph) {
+    local_wifi_t *local_wifi = (local_wifi_t *) caph->userdata;
+    char msg[STATUS_MAX];
+
+    cf_handler_set_kernel_stats(caph, local_wifi->kernel_packets, local_wifi->kernel_drops);
+
+    if (!local_wifi->verbose_statistics || 
+            local_wifi->stats_last - local_wifi->stats_msg_last < 10)
+        return;
+
+    snprintf(msg, STATUS_MAX, "%s %s/%s capture received %llu packets and "
+            "dropped %llu since the last report", local_wifi->name, 
+            local_wifi->interface, local_wifi->cap_interface, 
+            (unsigned long long) (local_wifi->kernel_packets - local_wifi->stats_msg_packets),
+            (unsigned long long) (local_wifi->kernel_drops - local_wifi->stats_msg_drops));
+    cf_send_message(caph, msg, MSGFLAG_INFO);
+
+    local_wifi->stats_msg_last = local_wifi->stats_last;
+    local_wifi->stats_msg_packets = local_wifi->kernel_packets;
+    local_wifi->stats_msg_drops = local_wifi->kernel_drops;
+}
+
+void pcap_dispatch_cb(u_char *user, const struct pcap_pkthdr *header,
+        const u_char *data)  {
+    kis_capture_handler_t *caph = (kis_capture_handler_t *) user;
+    local_wifi_t *local_wifi = (local_wifi_t *) caph->userdata;
+    struct pcap_stat ps;
+    time_t now;
+
+    /* fprintf(stderr, "debug - pcap_dispatch - got packet %u\n", header->caplen); */
+
+    if (local_wifi_send_packet(caph, header->ts, header->caplen, data) < 0) {
+        pcap_breakloop(local_wifi->pd);
+        return;
+    }
+
+    /* pcap counters are already totals since the capture opened */
+    now = time(NULL);
+
+    if (now != local_wifi->stats_last && pcap_stats(local_wifi->pd, &ps) == 0) {
+        local_wifi->stats_last = now;
+        local_wifi->kernel_packets = ps.ps_recv;
+        local_wifi->kernel_drops = ps.ps_drop;
+        local_wifi_update_stats(caph);
+    }
+}
+
+int ring_frame_cb(void *aux, struct timeval ts, uint32_t caplen, uint32_t len,
+        const uint8_t *data) {
+    kis_capture_handler_t *caph = (kis_capture_handler_t *) aux;
+
+    if (caplen > MAX_PACKET_LEN)
+        caplen = MAX_PACKET_LEN;
+
+    return local_wifi_send_packet(caph, ts, caplen, data) < 0 ? -1 : 1;
+}
+
+void ring_block_cb(void *aux) {
+    kis_capture_handler_t *caph = (kis_capture_handler_t *) aux;
+    local_wifi_t *local_wifi = (local_wifi_t *) caph->userdata;
+    unsigned int packets, drops;
+    time_t now;
+
+    /* The block is the batch; send whatever is left of it now instead of holding it
+     * for the batch timer */
+    cf_flush_batch(caph);
+
+    now = time(NULL);
+
+    if (now == local_wifi->stats_last)
+        return;
+
+    local_wifi->stats_last = now;
+
+    /* Ring counters reset each time they're read */
+    if (linux_wifi_ring_stats(&local_wifi->ring, &packets, &drops) > 0) {
+        local_wifi->kernel_packets += packets;
+        local_wifi->kernel_drops += drops;
+        local_wifi_update_stats(caph);
+    }
+}
+
 void capture_thread(kis_capture_handler_t *caph) {
     local_wifi_t *local_wifi = (local_wifi_t *) caph->userdata;
     char errstr[PCAP_ERRBUF_SIZE];
@@ -2982,13 +3167,24 @@ void capture_thread(kis_capture_handler_t *caph) {
      * channel control is managed by the channel hopping thread, all we have
      * to do is enter a blocking pcap loop */
 
-    pcap_loop(local_wifi->pd, -1, pcap_dispatch_cb, (u_char *) caph);
+    if (local_wifi->use_ring) {
+        if (linux_wifi_ring_loop(&local_wifi->ring, ring_frame_cb, ring_block_cb, 
+                    caph, iferrstr) < 0) {
+            snprintf(errstr, PCAP_ERRBUF_SIZE, "%s interface '%s' closed: %s", 
+                    local_wifi->name, local_wifi->cap_interface, iferrstr);
+        } else {
+            snprintf(errstr, PCAP_ERRBUF_SIZE, "%s interface '%s' closed: %s", 
+                    local_wifi->name, local_wifi->cap_interface, "interface closed");
+        }
+    } else {
+        pcap_loop(local_wifi->pd, -1, pcap_dispatch_cb, (u_char *) caph);
 
-    pcap_errstr = pcap_geterr(local_wifi->pd);
+        pcap_errstr = pcap_geterr(local_wifi->pd);
 
-    snprintf(errstr, PCAP_ERRBUF_SIZE, "%s interface '%s' closed: %s", 
-            local_wifi->name, local_wifi->cap_interface, 
-            strlen(pcap_errstr) == 0 ? "interface closed" : pcap_errstr );
+        snprintf(errstr, PCAP_ERRBUF_SIZE, "%s interface '%s' closed: %s", 
+                local_wifi->name, local_wifi->cap_interface, 
+                strlen(pcap_errstr) == 0 ? "interface closed" : pcap_errstr );
+    }
 
     cf_send_error(caph, 0, errstr);
 
@@ -3005,8 +3201,8 @@ void capture_thread(kis_capture_handler_t *caph) {
     cf_handler_spindown(caph);
 }
 
-int main(int argc, char *argv[]) {
-    local_wifi_t local_wifi = {
+void local_wifi_init(local_wifi_t *local_wifi) {
+    *local_wifi = (local_wifi_t) {
         .pd = NULL,
         .interface = NULL,
         .cap_interface = NULL,
@@ -3022,9 +3218,15 @@ int main(int argc, char *argv[]) {
         .up_before_mode = false,
         .use_ht_channels = 1,
         .use_vht_channels = 1,
-        .wardrive_filter = 0,
-        .data_filter = 0,
+        .frame_classes = LINUX_WIFI_FILTER_ALL,
+        .data_snaplen = -1,
+        .bpf_filter = NULL,
+        .use_ring = 0,
+        .ring = { .fd = -1, .map = NULL },
         .seq_channel_failure = 0,
+        .use_async_channels = 1,
+        .chanctl_open = 0,
+        .chanctl_stats_count = 0,
         .reset_nm_management = 0,
         .nexmon = NULL,
         .verbose_diagnostics = 0,
@@ -3032,26 +3234,18 @@ int main(int argc, char *argv[]) {
         .channel_set_ns_avg = 0,
         .channel_set_ns_count = 0,
     };
+}
 
-#ifdef HAVE_LIBNM
-    NMClient *nmclient = NULL;
-    const GPtrArray *nmdevices;
-    GError *nmerror = NULL;
-    int i;
-#endif
-
-    /* fprintf(stderr, "CAPTURE_LINUX_WIFI launched on pid %d\n", getpid()); */
+kis_capture_handler_t *newhandler_callback(kis_capture_handler_t *caph);
 
+kis_capture_handler_t *linux_wifi_handler_init(local_wifi_t *local_wifi) {
     kis_capture_handler_t *caph = cf_handler_init("linuxwifi");
 
-    if (caph == NULL) {
-        fprintf(stderr, "FATAL: Could not allocate basic handler data, your system "
-                "is very low on RAM or something is wrong.\n");
-        return -1;
-    }
+    if (caph == NULL)
+        return NULL;
 
     /* Set the local data ptr */
-    cf_handler_set_userdata(caph, &local_wifi);
+    cf_handler_set_userdata(caph, local_wifi);
 
     /* Set the callback for opening  */
     cf_handler_set_open_cb(caph, open_callback);
@@ -3071,10 +3265,87 @@ int main(int argc, char *argv[]) {
     /* Set the capture thread */
     cf_handler_set_capture_cb(caph, capture_thread);
 
+    /* Drive additional --source interfaces from this same process, each with its 
+     * own state, capture thread, and connection */
+    cf_handler_set_newhandler_cb(caph, newhandler_callback);
+
     /* Set a channel hop spacing of 4 to get the most out of 2.4 overlap;
      * it does nothing and hurts nothing on 5ghz */
     cf_handler_set_hop_shuffle_spacing(caph, 4);
 
+    return caph;
+}
+
+kis_capture_handler_t *newhandler_callback(kis_capture_handler_t *caph) {
+    kis_capture_handler_t *subh;
+    local_wifi_t *local_wifi = (local_wifi_t *) malloc(sizeof(local_wifi_t));
+
+    if (local_wifi == NULL)
+        return NULL;
+
+    local_wifi_init(local_wifi);
+
+    if ((subh = linux_wifi_handler_init(local_wifi)) == NULL) {
+        free(local_wifi);
+        return NULL;
+    }
+
+    return subh;
+}
+
+#ifdef HAVE_LIBNM
+/* Try to reset the networkmanager awareness of the interface */
+void reset_nm_management(local_wifi_t *local_wifi) {
+    NMClient *nmclient = NULL;
+    const GPtrArray *nmdevices;
+    GError *nmerror = NULL;
+    int i;
+
+    if (!local_wifi->reset_nm_management)
+        return;
+
+    nmclient = nm_client_new(NULL, &nmerror);
+
+    if (nmclient != NULL) {
+        if (nm_client_get_nm_running(nmclient)) {
+            nmdevices = nm_client_get_devices(nmclient);
+
+            if (nmdevices != NULL) {
+                for (i = 0; i < nmdevices->len; i++) {
+                    const NMDevice *d = g_ptr_array_index(nmdevices, i);
+
+                    if (strcmp(nm_device_get_iface((NMDevice *) d), 
+                                local_wifi->interface) == 0) {
+                        nm_device_set_managed((NMDevice *) d, 1);
+                        break;
+                    }
+                }
+            }
+        }
+
+        g_object_unref(nmclient);
+    }
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    local_wifi_t local_wifi;
+#ifdef HAVE_LIBNM
+    size_t szi;
+#endif
+
+    /* fprintf(stderr, "CAPTURE_LINUX_WIFI launched on pid %d\n", getpid()); */
+
+    local_wifi_init(&local_wifi);
+
+    kis_capture_handler_t *caph = linux_wifi_handler_init(&local_wifi);
+
+    if (caph == NULL) {
+        fprintf(stderr, "FATAL: Could not allocate basic handler data, your system "
+                "is very low on RAM or something is wrong.\n");
+        return -1;
+    }
+
     if (cf_handler_parse_opts(caph, argc, argv) < 1) {
         cf_print_help(caph, argv[0]);
         return -1;
@@ -3091,32 +3362,12 @@ int main(int argc, char *argv[]) {
 
     cf_handler_loop(caph);
 
-    /* We're done - try to reset the networkmanager awareness of the interface */
-
+    /* We're done - try to reset the networkmanager awareness of the interfaces */
 #ifdef HAVE_LIBNM
-    if (local_wifi.reset_nm_management) {
-        nmclient = nm_client_new(NULL, &nmerror);
-
-        if (nmclient != NULL) {
-            if (nm_client_get_nm_running(nmclient)) {
-                nmdevices = nm_client_get_devices(nmclient);
+    reset_nm_management(&local_wifi);
 
-                if (nmdevices != NULL) {
-                    for (i = 0; i < nmdevices->len; i++) {
-                        const NMDevice *d = g_ptr_array_index(nmdevices, i);
-
-                        if (strcmp(nm_device_get_iface((NMDevice *) d), 
-                                    local_wifi.interface) == 0) {
-                            nm_device_set_managed((NMDevice *) d, 1);
-                            break;
-                        }
-                    }
-                }
-            }
-
-            g_object_unref(nmclient);
-        }
-    }
+    for (szi = 0; szi < caph->num_sub_handlers; szi++)
+        reset_nm_management((local_wifi_t *) caph->sub_handlers[szi]->userdata);
 #endif
 
     cf_handler_free(caph);
@@ -44,9 +44,12 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "linux_netlink_control.h"
 #include "../wifi_ht_channels.h"
@@ -378,6 +381,69 @@ nla_put_failure:
 #endif
 }
 
+#ifdef HAVE_LINUX_NETLINK
+/* Build a SET_WIPHY message for a channel and HT mode */
+static int mac80211_build_channel_msg(struct nl_msg *msg, int nl80211_id, int ifindex,
+        int channel, unsigned int chmode) {
+    genlmsg_put(msg, 0, 0, nl80211_id, 0, 0, NL80211_CMD_SET_WIPHY, 0);
+    NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, ifindex);
+    NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_FREQ, mac80211_chan_to_freq(channel));
+    NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_CHANNEL_TYPE, chmode);
+
+    return 0;
+
+nla_put_failure:
+    return -1;
+}
+
+/* Build a SET_WIPHY message for a frequency, width, and center frequency; the legacy
+ * channel type derived from the width is returned in chan_type, or -1 for widths
+ * which have none */
+static int mac80211_build_frequency_msg(struct nl_msg *msg, int nl80211_id, int ifindex,
+        unsigned int control_freq, unsigned int chan_width, unsigned int center_freq1,
+        int *chan_type) {
+    *chan_type = 0;
+
+    genlmsg_put(msg, 0, 0, nl80211_id, 0, 0, NL80211_CMD_SET_WIPHY, 0);
+    NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, ifindex);
+    NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_FREQ, 
+            mac80211_chan_to_freq(control_freq));
+    NLA_PUT_U32(msg, NL80211_ATTR_CHANNEL_WIDTH, chan_width);
+
+    switch (chan_width) {
+        case NL80211_CHAN_WIDTH_20_NOHT:
+            *chan_type = NL80211_CHAN_NO_HT;
+            NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_CHANNEL_TYPE, NL80211_CHAN_NO_HT);
+            break;
+        case NL80211_CHAN_WIDTH_20:
+            *chan_type = NL80211_CHAN_HT20;
+            NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_CHANNEL_TYPE, NL80211_CHAN_HT20);
+            break;
+        case NL80211_CHAN_WIDTH_40:
+            if (control_freq > center_freq1) {
+                *chan_type = NL80211_CHAN_HT40MINUS;
+                NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_CHANNEL_TYPE, NL80211_CHAN_HT40MINUS);
+            } else {
+                *chan_type = NL80211_CHAN_HT40PLUS;
+                NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_CHANNEL_TYPE, NL80211_CHAN_HT40PLUS);
+            }
+            break;
+        default:
+            *chan_type = -1;
+            break;
+    }
+
+    if (center_freq1 != 0) {
+        NLA_PUT_U32(msg, NL80211_ATTR_CENTER_FREQ1, mac80211_chan_to_freq(center_freq1));
+    }
+
+    return 0;
+
+nla_put_failure:
+    return -1;
+}
+#endif
+
 int mac80211_set_channel_cache(int ifindex, void *nl_sock,
         int nl80211_id, int channel, unsigned int chmode, char *errstr) {
 #ifndef HAVE_LINUX_NETLINK
@@ -399,10 +465,8 @@ int mac80211_set_channel_cache(int ifindex, void *nl_sock,
         return -1;
     }
 
-    genlmsg_put(msg, 0, 0, nl80211_id, 0, 0, NL80211_CMD_SET_WIPHY, 0);
-    NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, ifindex);
-    NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_FREQ, mac80211_chan_to_freq(channel));
-    NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_CHANNEL_TYPE, chmode);
+    if (mac80211_build_channel_msg(msg, nl80211_id, ifindex, channel, chmode) < 0)
+        goto nla_put_failure;
 
     if ((ret = nl_send_auto_complete(nl_sock, msg)) >= 0) {
         if ((ret = nl_wait_for_ack(nl_sock)) < 0) 
@@ -479,38 +543,9 @@ int mac80211_set_frequency_cache(int ifindex, void *nl_sock, int nl80211_id,
         return -1;
     }
 
-    genlmsg_put(msg, 0, 0, nl80211_id, 0, 0, NL80211_CMD_SET_WIPHY, 0);
-    NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, ifindex);
-    NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_FREQ, 
-            mac80211_chan_to_freq(control_freq));
-    NLA_PUT_U32(msg, NL80211_ATTR_CHANNEL_WIDTH, chan_width);
-
-    switch (chan_width) {
-        case NL80211_CHAN_WIDTH_20_NOHT:
-            chan_type = NL80211_CHAN_NO_HT;
-            NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_CHANNEL_TYPE, NL80211_CHAN_NO_HT);
-            break;
-        case NL80211_CHAN_WIDTH_20:
-            chan_type = NL80211_CHAN_HT20;
-            NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_CHANNEL_TYPE, NL80211_CHAN_HT20);
-            break;
-        case NL80211_CHAN_WIDTH_40:
-            if (control_freq > center_freq1) {
-                chan_type = NL80211_CHAN_HT40MINUS;
-                NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_CHANNEL_TYPE, NL80211_CHAN_HT40MINUS);
-            } else {
-                chan_type = NL80211_CHAN_HT40PLUS;
-                NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_CHANNEL_TYPE, NL80211_CHAN_HT40PLUS);
-            }
-            break;
-        default:
-            chan_type = -1;
-            break;
-    }
-
-    if (center_freq1 != 0) {
-        NLA_PUT_U32(msg, NL80211_ATTR_CENTER_FREQ1, mac80211_chan_to_freq(center_freq1));
-    }
+    if (mac80211_build_frequency_msg(msg, nl80211_id, ifindex, control_freq, chan_width,
+                center_freq1, &chan_type) < 0)
+        goto nla_put_failure;
 
     if ((ret = nl_send_auto_complete(nl_sock, msg)) >= 0) {
         if ((ret = nl_wait_for_ack(nl_sock)) < 0) 
@@ -1217,5 +1252,385 @@ char *mac80211_find_parent(const char *interface) {
     return NULL;
 }
 
+#ifdef HAVE_LINUX_NETLINK
+static uint64_t mac80211_chanctl_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Find and retire the in-flight request an ack or error answers; requests before it
+ * were answered out of order or lost.  Called with the lock held. */
+static mac80211_chanctl_req_t *mac80211_chanctl_retire(mac80211_chanctl_t *ctl, uint32_t seq,
+        mac80211_chanctl_req_t *ret) {
+    unsigned int i;
+
+    for (i = 0; i < ctl->inflight_count; i++) {
+        mac80211_chanctl_req_t *req =
+            &ctl->inflight[(ctl->inflight_pos + i) % MAC80211_CHANCTL_INFLIGHT];
+
+        if (req->seq != seq)
+            continue;
+
+        *ret = *req;
+
+        ctl->stats.lost += i;
+        ctl->inflight_pos = (ctl->inflight_pos + i + 1) % MAC80211_CHANCTL_INFLIGHT;
+        ctl->inflight_count -= i + 1;
+
+        return ret;
+    }
+
+    return NULL;
+}
+
+/* Time out requests the kernel never answered; called with the lock held */
+static void mac80211_chanctl_expire(mac80211_chanctl_t *ctl, uint64_t now) {
+    while (ctl->inflight_count > 0 &&
+            now - ctl->inflight[ctl->inflight_pos].sent_ns > MAC80211_CHANCTL_TIMEOUT_NS) {
+        ctl->stats.lost++;
+        ctl->inflight_pos = (ctl->inflight_pos + 1) % MAC80211_CHANCTL_INFLIGHT;
+        ctl->inflight_count--;
+    }
+}
+
+static int mac80211_chanctl_ack_cb(struct nl_msg *msg, void *arg) {
+    mac80211_chanctl_t *ctl = (mac80211_chanctl_t *) arg;
+    mac80211_chanctl_req_t req;
+    uint64_t now = mac80211_chanctl_now_ns();
+    uint64_t latency;
+
+    pthread_mutex_lock(&ctl->lock);
+
+    if (mac80211_chanctl_retire(ctl, nlmsg_hdr(msg)->nlmsg_seq, &req) != NULL) {
+        latency = now - req.sent_ns;
+
+        ctl->stats.acks++;
+        ctl->stats.latency_last_ns = latency;
+
+        /* Moving average over roughly the last 8 sets */
+        if (ctl->stats.latency_avg_ns == 0)
+            ctl->stats.latency_avg_ns = latency;
+        else
+            ctl->stats.latency_avg_ns = 
+                (ctl->stats.latency_avg_ns * 7 + latency) / 8;
+
+        if (latency > ctl->stats.latency_peak_ns)
+            ctl->stats.latency_peak_ns = latency;
+    }
+
+    pthread_mutex_unlock(&ctl->lock);
+
+    return NL_OK;
+}
+
+static int mac80211_chanctl_error_cb(struct sockaddr_nl *nla, struct nlmsgerr *err, void *arg) {
+    mac80211_chanctl_t *ctl = (mac80211_chanctl_t *) arg;
+    mac80211_chanctl_req_t req;
+
+    pthread_mutex_lock(&ctl->lock);
+
+    if (mac80211_chanctl_retire(ctl, err->msg.nlmsg_seq, &req) != NULL) {
+        ctl->stats.errors++;
+        ctl->pending_errors++;
+        ctl->last_error = err->error;
+        ctl->last_error_freq = req.freq;
+    }
+
+    pthread_mutex_unlock(&ctl->lock);
+
+    return NL_SKIP;
+}
+
+/* Requests are answered in order but the acks for several may arrive together, so
+ * libnl's single expected sequence number doesn't apply; we match them ourselves */
+static int mac80211_chanctl_seq_cb(struct nl_msg *msg, void *arg) {
+    return NL_OK;
+}
+
+static void *mac80211_chanctl_reader(void *arg) {
+    mac80211_chanctl_t *ctl = (mac80211_chanctl_t *) arg;
+    struct nl_cb *cb;
+    struct pollfd pfd[2];
+
+    cb = nl_cb_alloc(NL_CB_DEFAULT);
+
+    if (cb == NULL)
+        return NULL;
+
+    nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, mac80211_chanctl_ack_cb, ctl);
+    nl_cb_set(cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, mac80211_chanctl_seq_cb, NULL);
+    nl_cb_err(cb, NL_CB_CUSTOM, mac80211_chanctl_error_cb, ctl);
+
+    pfd[0].fd = nl_socket_get_fd(ctl->nl_sock);
+    pfd[0].events = POLLIN;
+    pfd[1].fd = ctl->wake_pipe[0];
+    pfd[1].events = POLLIN;
+
+    while (1) {
+        pfd[0].revents = 0;
+        pfd[1].revents = 0;
+
+        if (poll(pfd, 2, 1000) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (pfd[1].revents)
+            break;
+
+        /* Drain everything queued; the socket is non-blocking so this ends when
+         * there is nothing left to read */
+        if (pfd[0].revents & POLLIN) {
+            while (nl_recvmsgs(ctl->nl_sock, cb) >= 0)
+                ;
+        } else if (pfd[0].revents) {
+            break;
+        }
+
+        pthread_mutex_lock(&ctl->lock);
+        mac80211_chanctl_expire(ctl, mac80211_chanctl_now_ns());
+        pthread_mutex_unlock(&ctl->lock);
+    }
+
+    nl_cb_put(cb);
+
+    return NULL;
+}
+
+/* Send a built message and add it to the in-flight list */
+static int mac80211_chanctl_send(mac80211_chanctl_t *ctl, struct nl_msg *msg,
+        unsigned int freq, char *errstr) {
+    mac80211_chanctl_req_t *req;
+    uint64_t now;
+    int ret;
+
+    pthread_mutex_lock(&ctl->lock);
+
+    now = mac80211_chanctl_now_ns();
+    mac80211_chanctl_expire(ctl, now);
+
+    if (ctl->inflight_count >= MAC80211_CHANCTL_INFLIGHT) {
+        pthread_mutex_unlock(&ctl->lock);
+        snprintf(errstr, STATUS_MAX, "unable to set frequency %u: %u channel changes "
+                "already waiting for the kernel", freq, ctl->inflight_count);
+        return -1;
+    }
+
+    /* Hold the lock over the send so the ack can't be processed before the
+     * request is recorded */
+    if ((ret = nl_send_auto_complete(ctl->nl_sock, msg)) < 0) {
+        pthread_mutex_unlock(&ctl->lock);
+        snprintf(errstr, STATUS_MAX, "unable to set frequency %u: netlink send failed, "
+                "error %d", freq, ret);
+        return -1;
+    }
+
+    req = &ctl->inflight[(ctl->inflight_pos + ctl->inflight_count) % MAC80211_CHANCTL_INFLIGHT];
+    req->seq = nlmsg_hdr(msg)->nlmsg_seq;
+    req->sent_ns = now;
+    req->freq = freq;
+
+    ctl->inflight_count++;
+    ctl->stats.sets++;
+
+    pthread_mutex_unlock(&ctl->lock);
+
+    return 0;
+}
+#endif
+
+int mac80211_chanctl_open(mac80211_chanctl_t *ctl, int ifidx, char *errstr) {
+#ifndef HAVE_LINUX_NETLINK
+    snprintf(errstr, STATUS_MAX, "Kismet was not compiled with netlink/mac80211 "
+            "support, check the output of ./configure for why");
+    return -1;
+#else
+    memset(ctl, 0, sizeof(mac80211_chanctl_t));
+    ctl->wake_pipe[0] = -1;
+    ctl->wake_pipe[1] = -1;
+    ctl->ifidx = ifidx;
+
+    pthread_mutex_init(&ctl->lock, NULL);
+
+    if (mac80211_connect(&ctl->nl_sock, &ctl->nl80211_id, errstr) < 0) {
+        ctl->nl_sock = NULL;
+        return -1;
+    }
+
+    if (nl_socket_set_nonblocking(ctl->nl_sock) < 0) {
+        snprintf(errstr, STATUS_MAX, "unable to open channel control: could not set "
+                "the netlink socket non-blocking");
+        mac80211_chanctl_close(ctl);
+        return -1;
+    }
+
+    if (pipe(ctl->wake_pipe) < 0) {
+        snprintf(errstr, STATUS_MAX, "unable to open channel control: could not create "
+                "the wakeup pipe: %s", strerror(errno));
+        ctl->wake_pipe[0] = -1;
+        ctl->wake_pipe[1] = -1;
+        mac80211_chanctl_close(ctl);
+        return -1;
+    }
+
+    if (pthread_create(&ctl->reader, NULL, mac80211_chanctl_reader, ctl) != 0) {
+        snprintf(errstr, STATUS_MAX, "unable to open channel control: could not start "
+                "the netlink reader thread");
+        mac80211_chanctl_close(ctl);
+        return -1;
+    }
+
+    ctl->reader_running = 1;
+
+    return 0;
+#endif
+}
+
+void mac80211_chanctl_close(mac80211_chanctl_t *ctl) {
+#ifdef HAVE_LINUX_NETLINK
+    if (ctl->reader_running) {
+        if (write(ctl->wake_pipe[1], "x", 1) < 0)
+            pthread_cancel(ctl->reader);
+        pthread_join(ctl->reader, NULL);
+        ctl->reader_running = 0;
+    }
+
+    if (ctl->wake_pipe[0] >= 0)
+        close(ctl->wake_pipe[0]);
+    if (ctl->wake_pipe[1] >= 0)
+        close(ctl->wake_pipe[1]);
+    ctl->wake_pipe[0] = -1;
+    ctl->wake_pipe[1] = -1;
+
+    if (ctl->nl_sock != NULL) {
+        mac80211_disconnect(ctl->nl_sock);
+        ctl->nl_sock = NULL;
+        pthread_mutex_destroy(&ctl->lock);
+    }
+#endif
+}
+
+int mac80211_chanctl_set_channel(mac80211_chanctl_t *ctl, int channel,
+        unsigned int chmode, char *errstr) {
+#ifndef HAVE_LINUX_NETLINK
+    snprintf(errstr, STATUS_MAX, "Kismet was not compiled with netlink/mac80211 "
+            "support, check the output of ./configure for why");
+    return -1;
+#else
+    struct nl_msg *msg;
+    int ret;
+
+    if (chmode >= 4) {
+        snprintf(errstr, STATUS_MAX, "unable to set channel: invalid channel mode");
+        return -1;
+    }
+
+    if ((msg = nlmsg_alloc()) == NULL) {
+        snprintf(errstr, STATUS_MAX, 
+                "unable to set channel: unable to allocate mac80211 control message.");
+        return -1;
+    }
+
+    if (mac80211_build_channel_msg(msg, ctl->nl80211_id, ctl->ifidx, channel, chmode) < 0) {
+        snprintf(errstr, STATUS_MAX, "unable to set channel %u mode %u: unable to build "
+                "mac80211 control message", channel, chmode);
+        nlmsg_free(msg);
+        return -1;
+    }
+
+    ret = mac80211_chanctl_send(ctl, msg, mac80211_chan_to_freq(channel), errstr);
+
+    nlmsg_free(msg);
+
+    return ret;
+#endif
+}
+
+int mac80211_chanctl_set_frequency(mac80211_chanctl_t *ctl, unsigned int control_freq,
+        unsigned int chan_width, unsigned int center_freq1, unsigned int center_freq2,
+        char *errstr) {
+#ifndef HAVE_LINUX_NETLINK
+    snprintf(errstr, STATUS_MAX, "Kismet was not compiled with netlink/mac80211 "
+            "support, check the output of ./configure for why");
+    return -1;
+#else
+    struct nl_msg *msg;
+    int chan_type;
+    int ret;
+
+    if ((msg = nlmsg_alloc()) == NULL) {
+        snprintf(errstr, STATUS_MAX, 
+                "unable to set channel/frequency: unable to allocate "
+                "mac80211 control message.");
+        return -1;
+    }
+
+    if (mac80211_build_frequency_msg(msg, ctl->nl80211_id, ctl->ifidx, control_freq,
+                chan_width, center_freq1, &chan_type) < 0) {
+        snprintf(errstr, STATUS_MAX, "unable to set frequency %u width %u center %u: "
+                "unable to build mac80211 control message", 
+                control_freq, chan_width, center_freq1);
+        nlmsg_free(msg);
+        return -1;
+    }
+
+    ret = mac80211_chanctl_send(ctl, msg, mac80211_chan_to_freq(control_freq), errstr);
+
+    nlmsg_free(msg);
+
+    return ret;
+#endif
+}
+
+unsigned int mac80211_chanctl_take_errors(mac80211_chanctl_t *ctl, char *errstr) {
+#ifndef HAVE_LINUX_NETLINK
+    return 0;
+#else
+    unsigned int errors;
+
+    pthread_mutex_lock(&ctl->lock);
+
+    errors = ctl->pending_errors;
+
+    if (errors != 0)
+        snprintf(errstr, STATUS_MAX, "unable to set frequency %u, error %d (%s)%s",
+                ctl->last_error_freq, ctl->last_error, strerror(-ctl->last_error),
+                errors > 1 ? ", and earlier channel changes also failed" : "");
+
+    ctl->pending_errors = 0;
+
+    pthread_mutex_unlock(&ctl->lock);
+
+    return errors;
+#endif
+}
+
+uint64_t mac80211_chanctl_latency(mac80211_chanctl_t *ctl) {
+#ifndef HAVE_LINUX_NETLINK
+    return 0;
+#else
+    uint64_t latency;
+
+    pthread_mutex_lock(&ctl->lock);
+    latency = ctl->stats.latency_avg_ns;
+    pthread_mutex_unlock(&ctl->lock);
+
+    return latency;
+#endif
+}
+
+void mac80211_chanctl_get_stats(mac80211_chanctl_t *ctl, mac80211_chanctl_stats_t *stats) {
+#ifndef HAVE_LINUX_NETLINK
+    memset(stats, 0, sizeof(mac80211_chanctl_stats_t));
+#else
+    pthread_mutex_lock(&ctl->lock);
+    *stats = ctl->stats;
+    ctl->stats.latency_peak_ns = 0;
+    pthread_mutex_unlock(&ctl->lock);
+#endif
+}
+
 #endif /* linux */
 
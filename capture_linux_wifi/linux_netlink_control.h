@@ -24,6 +24,7 @@
 /* Use local copy of nl80211.h */
 #include "nl80211.h"
 
+#include <pthread.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -189,6 +190,102 @@ int mac80211_get_chanlist(const char *interface, unsigned int extended_flags, ch
         unsigned int default_ht20, unsigned int expand_ht20,
         char ***ret_chanlist, size_t *ret_chanlist_len);
 
+/* Asynchronous channel control
+ *
+ * Channel sets are sent on a dedicated netlink socket without waiting for the
+ * kernel to acknowledge them, so the hop thread never blocks on the driver and
+ * several sets may be in flight.  A reader thread collects the acks and times
+ * each set from the request to the ack; the measured switch latency is kept as
+ * a running average and a peak for the hop scheduler and for statistics.
+ *
+ * Errors from the kernel arrive after the set call has returned; they are
+ * counted and the most recent is kept until mac80211_chanctl_take_errors(...).
+ */
+#define MAC80211_CHANCTL_INFLIGHT       16
+
+/* Sets not acknowledged within this time are counted as lost */
+#define MAC80211_CHANCTL_TIMEOUT_NS     1000000000ULL
+
+typedef struct {
+    uint32_t seq;
+    uint64_t sent_ns;
+    unsigned int freq;
+} mac80211_chanctl_req_t;
+
+typedef struct {
+    uint64_t sets;
+    uint64_t acks;
+    uint64_t errors;
+    uint64_t lost;
+
+    /* Switch latency; last, moving average, and peak since the last stats call */
+    uint64_t latency_last_ns;
+    uint64_t latency_avg_ns;
+    uint64_t latency_peak_ns;
+} mac80211_chanctl_stats_t;
+
+typedef struct {
+    void *nl_sock;
+    int nl80211_id;
+    int ifidx;
+
+    /* Reader thread, and the pipe which wakes it to shut down */
+    pthread_t reader;
+    int reader_running;
+    int wake_pipe[2];
+
+    pthread_mutex_t lock;
+
+    /* Sets waiting for an ack, oldest first */
+    mac80211_chanctl_req_t inflight[MAC80211_CHANCTL_INFLIGHT];
+    unsigned int inflight_pos;
+    unsigned int inflight_count;
+
+    mac80211_chanctl_stats_t stats;
+
+    /* Errors since the last take_errors call, and the last of them */
+    unsigned int pending_errors;
+    int last_error;
+    unsigned int last_error_freq;
+} mac80211_chanctl_t;
+
+/* Open an asynchronous channel controller for an interface index; opens its own
+ * netlink socket and starts the reader thread.
+ *
+ * Returns:
+ * -1   Error
+ *  0   Success
+ */
+int mac80211_chanctl_open(mac80211_chanctl_t *ctl, int ifidx, char *errstr);
+
+/* Stop the reader thread and close the socket; safe to call on a controller which
+ * failed to open */
+void mac80211_chanctl_close(mac80211_chanctl_t *ctl);
+
+/* Request a channel or frequency change, with the same arguments as
+ * mac80211_set_channel_cache and mac80211_set_frequency_cache, without waiting for
+ * the kernel.
+ *
+ * Returns:
+ * -1   Error sending the request, or too many requests already in flight
+ *  0   Success
+ */
+int mac80211_chanctl_set_channel(mac80211_chanctl_t *ctl, int channel,
+        unsigned int chmode, char *errstr);
+int mac80211_chanctl_set_frequency(mac80211_chanctl_t *ctl, unsigned int control_freq,
+        unsigned int chan_width, unsigned int center_freq1, unsigned int center_freq2,
+        char *errstr);
+
+/* Fetch and clear the count of failed sets since the last call; when there were
+ * failures, errstr describes the most recent */
+unsigned int mac80211_chanctl_take_errors(mac80211_chanctl_t *ctl, char *errstr);
+
+/* Average switch latency, in nanoseconds */
+uint64_t mac80211_chanctl_latency(mac80211_chanctl_t *ctl);
+
+/* Copy the stats, and reset the peak latency */
+void mac80211_chanctl_get_stats(mac80211_chanctl_t *ctl, mac80211_chanctl_stats_t *stats);
+
 
 #endif
 
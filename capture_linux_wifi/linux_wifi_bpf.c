@@ -0,0 +1,254 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "../config.h"
+#include "linux_wifi_bpf.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* Accepted frames are passed up to this length, ie whole */
+#define WIFI_BPF_ACCEPT     0x40000
+
+/* The longest frame filter we generate is well under this */
+#define WIFI_BPF_MAX_INSNS  64
+
+/* Scratch memory slots */
+#define WIFI_BPF_M_DOT11    0   /* Offset of the 802.11 header */
+#define WIFI_BPF_M_HDRLEN   1   /* Length of the 802.11 header */
+#define WIFI_BPF_M_BODY     2   /* Offset of the frame body */
+
+typedef struct {
+    struct bpf_insn *insns;
+    unsigned int len;
+} wifi_bpf_t;
+
+static unsigned int wifi_bpf_stmt(wifi_bpf_t *p, unsigned short code, bpf_u_int32 k) {
+    p->insns[p->len].code = code;
+    p->insns[p->len].jt = 0;
+    p->insns[p->len].jf = 0;
+    p->insns[p->len].k = k;
+
+    return p->len++;
+}
+
+/* Conditional jumps fall through on both branches until they are pointed somewhere */
+static unsigned int wifi_bpf_jump(wifi_bpf_t *p, unsigned short code, bpf_u_int32 k) {
+    return wifi_bpf_stmt(p, BPF_JMP | code, k);
+}
+
+/* Point a branch of a jump at the next instruction to be emitted */
+static void wifi_bpf_jt_here(wifi_bpf_t *p, unsigned int j) {
+    p->insns[j].jt = p->len - j - 1;
+}
+
+static void wifi_bpf_jf_here(wifi_bpf_t *p, unsigned int j) {
+    p->insns[j].jf = p->len - j - 1;
+}
+
+int linux_wifi_parse_frame_classes(const char *classes, size_t len,
+        unsigned int *ret_classes) {
+    size_t pos = 0, tlen;
+    const char *plus;
+
+    *ret_classes = 0;
+
+    while (pos < len) {
+        plus = memchr(classes + pos, '+', len - pos);
+        tlen = plus == NULL ? len - pos : (size_t) (plus - (classes + pos));
+
+        if (tlen == 4 && strncasecmp(classes + pos, "mgmt", 4) == 0)
+            *ret_classes |= LINUX_WIFI_FILTER_MGMT;
+        else if (tlen == 4 && strncasecmp(classes + pos, "ctrl", 4) == 0)
+            *ret_classes |= LINUX_WIFI_FILTER_CTRL;
+        else if (tlen == 4 && strncasecmp(classes + pos, "data", 4) == 0)
+            *ret_classes |= LINUX_WIFI_FILTER_DATA;
+        else if (tlen == 5 && strncasecmp(classes + pos, "eapol", 5) == 0)
+            *ret_classes |= LINUX_WIFI_FILTER_EAPOL;
+        else if (tlen == 3 && strncasecmp(classes + pos, "all", 3) == 0)
+            *ret_classes |= LINUX_WIFI_FILTER_ALL;
+        else
+            return -1;
+
+        pos += tlen + 1;
+    }
+
+    return 1;
+}
+
+int linux_wifi_build_frame_filter(struct bpf_program *ret_program, int dlt,
+        unsigned int classes, int data_snaplen) {
+    wifi_bpf_t p;
+    unsigned int j, j_qos, j_order, j_prot, j_short, j_snap, j_eapol;
+
+    if (dlt != DLT_IEEE802_11_RADIO && dlt != DLT_IEEE802_11)
+        return -1;
+
+    p.insns = (struct bpf_insn *) malloc(sizeof(struct bpf_insn) * WIFI_BPF_MAX_INSNS);
+    p.len = 0;
+
+    if (p.insns == NULL)
+        return -1;
+
+    /* Find the 802.11 header; the radiotap length is little endian */
+    if (dlt == DLT_IEEE802_11_RADIO) {
+        wifi_bpf_stmt(&p, BPF_LD | BPF_B | BPF_ABS, 3);
+        wifi_bpf_stmt(&p, BPF_ALU | BPF_LSH | BPF_K, 8);
+        wifi_bpf_stmt(&p, BPF_MISC | BPF_TAX, 0);
+        wifi_bpf_stmt(&p, BPF_LD | BPF_B | BPF_ABS, 2);
+        wifi_bpf_stmt(&p, BPF_ALU | BPF_ADD | BPF_X, 0);
+    } else {
+        wifi_bpf_stmt(&p, BPF_LD | BPF_IMM, 0);
+    }
+
+    wifi_bpf_stmt(&p, BPF_ST, WIFI_BPF_M_DOT11);
+    wifi_bpf_stmt(&p, BPF_MISC | BPF_TAX, 0);
+
+    /* Frame type; X holds the 802.11 offset from here on until the body is found */
+    wifi_bpf_stmt(&p, BPF_LD | BPF_B | BPF_IND, 0);
+    wifi_bpf_stmt(&p, BPF_ALU | BPF_AND | BPF_K, 0x0C);
+
+    j = wifi_bpf_jump(&p, BPF_JEQ | BPF_K, 0x00);
+    p.insns[j].jf = 1;
+    wifi_bpf_stmt(&p, BPF_RET | BPF_K,
+            (classes & LINUX_WIFI_FILTER_MGMT) ? WIFI_BPF_ACCEPT : 0);
+
+    j = wifi_bpf_jump(&p, BPF_JEQ | BPF_K, 0x04);
+    p.insns[j].jf = 1;
+    wifi_bpf_stmt(&p, BPF_RET | BPF_K,
+            (classes & LINUX_WIFI_FILTER_CTRL) ? WIFI_BPF_ACCEPT : 0);
+
+    if (!(classes & (LINUX_WIFI_FILTER_DATA | LINUX_WIFI_FILTER_EAPOL))) {
+        wifi_bpf_stmt(&p, BPF_RET | BPF_K, 0);
+        goto done;
+    }
+
+    j = wifi_bpf_jump(&p, BPF_JEQ | BPF_K, 0x08);
+    p.insns[j].jt = 1;
+    wifi_bpf_stmt(&p, BPF_RET | BPF_K, 0);
+
+    /* Data frames pass whole with no need to look any further */
+    if ((classes & LINUX_WIFI_FILTER_DATA) && data_snaplen < 0) {
+        wifi_bpf_stmt(&p, BPF_RET | BPF_K, WIFI_BPF_ACCEPT);
+        goto done;
+    }
+
+    /* Header length; 4-address frames carry a fourth address, QoS frames carry QoS
+     * control, and QoS frames with the order bit carry HT control */
+    wifi_bpf_stmt(&p, BPF_LD | BPF_B | BPF_IND, 1);
+    wifi_bpf_stmt(&p, BPF_ALU | BPF_AND | BPF_K, 0x03);
+    j = wifi_bpf_jump(&p, BPF_JEQ | BPF_K, 0x03);
+    p.insns[j].jf = 2;
+    wifi_bpf_stmt(&p, BPF_LD | BPF_IMM, 30);
+    wifi_bpf_stmt(&p, BPF_JMP | BPF_JA, 1);
+    wifi_bpf_stmt(&p, BPF_LD | BPF_IMM, 24);
+    wifi_bpf_stmt(&p, BPF_ST, WIFI_BPF_M_HDRLEN);
+
+    wifi_bpf_stmt(&p, BPF_LD | BPF_B | BPF_IND, 0);
+    j_qos = wifi_bpf_jump(&p, BPF_JSET | BPF_K, 0x80);
+    wifi_bpf_stmt(&p, BPF_LD | BPF_MEM, WIFI_BPF_M_HDRLEN);
+    wifi_bpf_stmt(&p, BPF_ALU | BPF_ADD | BPF_K, 2);
+    wifi_bpf_stmt(&p, BPF_ST, WIFI_BPF_M_HDRLEN);
+    wifi_bpf_stmt(&p, BPF_LD | BPF_B | BPF_IND, 1);
+    j_order = wifi_bpf_jump(&p, BPF_JSET | BPF_K, 0x80);
+    wifi_bpf_stmt(&p, BPF_LD | BPF_MEM, WIFI_BPF_M_HDRLEN);
+    wifi_bpf_stmt(&p, BPF_ALU | BPF_ADD | BPF_K, 4);
+    wifi_bpf_stmt(&p, BPF_ST, WIFI_BPF_M_HDRLEN);
+    wifi_bpf_jf_here(&p, j_qos);
+    wifi_bpf_jf_here(&p, j_order);
+
+    wifi_bpf_stmt(&p, BPF_LD | BPF_MEM, WIFI_BPF_M_HDRLEN);
+    wifi_bpf_stmt(&p, BPF_ALU | BPF_ADD | BPF_X, 0);
+    wifi_bpf_stmt(&p, BPF_ST, WIFI_BPF_M_BODY);
+
+    /* EAPOL passes whole; it has to be unprotected and long enough to hold the
+     * LLC/SNAP header, since a load past the end of the frame would drop it */
+    wifi_bpf_stmt(&p, BPF_LD | BPF_B | BPF_IND, 1);
+    j_prot = wifi_bpf_jump(&p, BPF_JSET | BPF_K, 0x40);
+
+    wifi_bpf_stmt(&p, BPF_LD | BPF_MEM, WIFI_BPF_M_BODY);
+    wifi_bpf_stmt(&p, BPF_ALU | BPF_ADD | BPF_K, 8);
+    wifi_bpf_stmt(&p, BPF_MISC | BPF_TAX, 0);
+    wifi_bpf_stmt(&p, BPF_LD | BPF_W | BPF_LEN, 0);
+    j_short = wifi_bpf_jump(&p, BPF_JGE | BPF_X, 0);
+
+    wifi_bpf_stmt(&p, BPF_LDX | BPF_MEM, WIFI_BPF_M_BODY);
+    wifi_bpf_stmt(&p, BPF_LD | BPF_H | BPF_IND, 0);
+    j_snap = wifi_bpf_jump(&p, BPF_JEQ | BPF_K, 0xAAAA);
+    wifi_bpf_stmt(&p, BPF_LD | BPF_H | BPF_IND, 6);
+    j_eapol = wifi_bpf_jump(&p, BPF_JEQ | BPF_K, 0x888E);
+    wifi_bpf_stmt(&p, BPF_RET | BPF_K, WIFI_BPF_ACCEPT);
+
+    wifi_bpf_jt_here(&p, j_prot);
+    wifi_bpf_jf_here(&p, j_short);
+    wifi_bpf_jf_here(&p, j_snap);
+    wifi_bpf_jf_here(&p, j_eapol);
+
+    /* Everything else is dropped, or cut to the headers */
+    if (!(classes & LINUX_WIFI_FILTER_DATA)) {
+        wifi_bpf_stmt(&p, BPF_RET | BPF_K, 0);
+    } else {
+        wifi_bpf_stmt(&p, BPF_LD | BPF_MEM, WIFI_BPF_M_BODY);
+        wifi_bpf_stmt(&p, BPF_ALU | BPF_ADD | BPF_K, (bpf_u_int32) data_snaplen);
+        wifi_bpf_stmt(&p, BPF_RET | BPF_A, 0);
+    }
+
+done:
+    ret_program->bf_len = p.len;
+    ret_program->bf_insns = p.insns;
+
+    return 1;
+}
+
+int linux_wifi_chain_filters(struct bpf_program *ret_program,
+        const struct bpf_program *first, const struct bpf_program *second) {
+    struct bpf_insn *insns;
+    unsigned int i, len;
+
+    len = first->bf_len + second->bf_len;
+
+    if (len > BPF_MAXINSNS)
+        return -1;
+
+    insns = (struct bpf_insn *) malloc(sizeof(struct bpf_insn) * len);
+
+    if (insns == NULL)
+        return -1;
+
+    memcpy(insns, first->bf_insns, sizeof(struct bpf_insn) * first->bf_len);
+    memcpy(insns + first->bf_len, second->bf_insns,
+            sizeof(struct bpf_insn) * second->bf_len);
+
+    /* Wherever the first program accepts, continue into the second instead */
+    for (i = 0; i < first->bf_len; i++) {
+        if (BPF_CLASS(insns[i].code) == BPF_RET && BPF_RVAL(insns[i].code) == BPF_K &&
+                insns[i].k != 0) {
+            insns[i].code = BPF_JMP | BPF_JA;
+            insns[i].jt = 0;
+            insns[i].jf = 0;
+            insns[i].k = first->bf_len - i - 1;
+        }
+    }
+
+    ret_program->bf_len = len;
+    ret_program->bf_insns = insns;
+
+    return 1;
+}
+
@@ -0,0 +1,78 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __LINUX_WIFI_BPF_H__
+#define __LINUX_WIFI_BPF_H__
+
+#include "../config.h"
+
+#include <stddef.h>
+
+#include <pcap.h>
+
+/* Frame class filtering
+ *
+ * Builds BPF programs which pass or drop 802.11 frames by class, and cut data frames
+ * down to their headers.  The programs are attached to the capture with pcap, which
+ * installs them in the kernel, so filtered traffic never reaches the capture tool.
+ * Radiotap and raw 802.11 link types are supported.
+ *
+ * EAPOL frames are always passed whole when data frames are passed, so handshakes are
+ * never lost to truncation.
+ */
+
+#define LINUX_WIFI_FILTER_MGMT      (1 << 0)
+#define LINUX_WIFI_FILTER_CTRL      (1 << 1)
+#define LINUX_WIFI_FILTER_DATA      (1 << 2)
+/* Only the EAPOL data frames */
+#define LINUX_WIFI_FILTER_EAPOL     (1 << 3)
+#define LINUX_WIFI_FILTER_ALL       \
+    (LINUX_WIFI_FILTER_MGMT | LINUX_WIFI_FILTER_CTRL | LINUX_WIFI_FILTER_DATA)
+
+/* Parse a frame class list such as 'mgmt+ctrl+eapol'
+ *
+ * Returns:
+ * -1   Unknown frame class
+ *  1   Success
+ */
+int linux_wifi_parse_frame_classes(const char *classes, size_t len,
+        unsigned int *ret_classes);
+
+/* Build a program passing the frame classes; data frames are cut to data_snaplen
+ * bytes after the 802.11 header, or passed whole if data_snaplen is negative.  The
+ * program is freed with pcap_freecode.
+ *
+ * Returns:
+ * -1   Unsupported link type or error
+ *  1   Success
+ */
+int linux_wifi_build_frame_filter(struct bpf_program *ret_program, int dlt,
+        unsigned int classes, int data_snaplen);
+
+/* Combine two programs so a frame must pass the first, and is then filtered and
+ * truncated by the second.  The program is freed with pcap_freecode.
+ *
+ * Returns:
+ * -1   Error, or combined program too large
+ *  1   Success
+ */
+int linux_wifi_chain_filters(struct bpf_program *ret_program,
+        const struct bpf_program *first, const struct bpf_program *second);
+
+#endif
+
@@ -0,0 +1,337 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "../config.h"
+#include "linux_wifi_ring.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* Slots in the ring; frames are packed into blocks regardless of this, but the kernel
+ * requires the frame geometry to describe the ring */
+#define WIFI_RING_FRAME_SZ  2048
+
+/* Smallest block which still holds a full size frame */
+#define WIFI_RING_MIN_BLOCK_KB  64
+
+int linux_wifi_ring_parse_fanout(const char *mode, size_t len, unsigned int *ret_mode) {
+    if (len == 4 && strncasecmp(mode, "hash", 4) == 0)
+        *ret_mode = LINUX_WIFI_RING_FANOUT_HASH;
+    else if (len == 2 && strncasecmp(mode, "lb", 2) == 0)
+        *ret_mode = LINUX_WIFI_RING_FANOUT_LB;
+    else if (len == 3 && strncasecmp(mode, "cpu", 3) == 0)
+        *ret_mode = LINUX_WIFI_RING_FANOUT_CPU;
+    else if (len == 8 && strncasecmp(mode, "rollover", 8) == 0)
+        *ret_mode = LINUX_WIFI_RING_FANOUT_ROLLOVER;
+    else if (len == 6 && strncasecmp(mode, "random", 6) == 0)
+        *ret_mode = LINUX_WIFI_RING_FANOUT_RND;
+    else
+        return -1;
+
+    return 1;
+}
+
+int linux_wifi_ring_open(linux_wifi_ring_t *ring, const char *interface,
+        unsigned int block_kb, unsigned int block_nr, unsigned int block_timeout_ms,
+        unsigned int fanout_group, unsigned int fanout_mode, char *errstr) {
+    struct tpacket_req3 req;
+    struct sockaddr_ll sll;
+    unsigned int page_sz = (unsigned int) sysconf(_SC_PAGESIZE);
+    unsigned int block_sz;
+    int version = TPACKET_V3;
+    int fanout_arg;
+    unsigned int ifindex;
+
+    ring->fd = -1;
+    ring->map = NULL;
+    ring->map_sz = 0;
+    ring->block_pos = 0;
+
+    if ((ifindex = if_nametoindex(interface)) == 0) {
+        snprintf(errstr, STATUS_MAX, "unable to find interface index for '%s': %s",
+                interface, strerror(errno));
+        return -1;
+    }
+
+    if (block_kb < WIFI_RING_MIN_BLOCK_KB)
+        block_kb = WIFI_RING_MIN_BLOCK_KB;
+
+    if (block_nr == 0)
+        block_nr = 1;
+
+    /* The kernel allocates each block as a power-of-two number of pages, round up so
+     * none of it is wasted */
+    block_sz = page_sz;
+    while (block_sz < block_kb * 1024)
+        block_sz <<= 1;
+
+    /* Open without a protocol so nothing is queued until the ring is bound */
+    if ((ring->fd = socket(AF_PACKET, SOCK_RAW, 0)) < 0) {
+        snprintf(errstr, STATUS_MAX, "unable to open packet socket: %s", strerror(errno));
+        return -1;
+    }
+
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+        snprintf(errstr, STATUS_MAX, "unable to use TPACKET_V3 rings, the kernel may be "
+                "too old: %s", strerror(errno));
+        goto fail;
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = block_sz;
+    req.tp_block_nr = block_nr;
+    req.tp_frame_size = WIFI_RING_FRAME_SZ;
+    req.tp_frame_nr = (block_sz / WIFI_RING_FRAME_SZ) * block_nr;
+    req.tp_retire_blk_tov = block_timeout_ms;
+
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+        snprintf(errstr, STATUS_MAX, "unable to allocate a %u block ring of %ukB blocks: %s",
+                block_nr, block_sz / 1024, strerror(errno));
+        goto fail;
+    }
+
+    ring->block_sz = block_sz;
+    ring->block_nr = block_nr;
+    ring->map_sz = (size_t) block_sz * block_nr;
+
+    ring->map = (uint8_t *) mmap(NULL, ring->map_sz, PROT_READ | PROT_WRITE,
+            MAP_SHARED, ring->fd, 0);
+
+    if (ring->map == MAP_FAILED) {
+        ring->map = NULL;
+        snprintf(errstr, STATUS_MAX, "unable to map capture ring: %s", strerror(errno));
+        goto fail;
+    }
+
+    memset(&sll, 0, sizeof(sll));
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_ALL);
+    sll.sll_ifindex = (int) ifindex;
+
+    if (bind(ring->fd, (struct sockaddr *) &sll, sizeof(sll)) < 0) {
+        snprintf(errstr, STATUS_MAX, "unable to bind capture ring to '%s': %s",
+                interface, strerror(errno));
+        goto fail;
+    }
+
+    if (fanout_group != 0) {
+        switch (fanout_mode) {
+            case LINUX_WIFI_RING_FANOUT_LB:
+                fanout_arg = PACKET_FANOUT_LB;
+                break;
+            case LINUX_WIFI_RING_FANOUT_CPU:
+                fanout_arg = PACKET_FANOUT_CPU;
+                break;
+            case LINUX_WIFI_RING_FANOUT_ROLLOVER:
+                fanout_arg = PACKET_FANOUT_ROLLOVER;
+                break;
+            case LINUX_WIFI_RING_FANOUT_RND:
+                fanout_arg = PACKET_FANOUT_RND;
+                break;
+            default:
+                fanout_arg = PACKET_FANOUT_HASH;
+                break;
+        }
+
+        fanout_arg = (int) ((fanout_group & 0xFFFF) | ((unsigned int) fanout_arg << 16));
+
+        if (setsockopt(ring->fd, SOL_PACKET, PACKET_FANOUT,
+                    &fanout_arg, sizeof(fanout_arg)) < 0) {
+            snprintf(errstr, STATUS_MAX, "unable to join fanout group %u on '%s', the "
+                    "group may already use a different mode: %s", fanout_group,
+                    interface, strerror(errno));
+            goto fail;
+        }
+    }
+
+    return 1;
+
+fail:
+    linux_wifi_ring_close(ring);
+    return -1;
+}
+
+int linux_wifi_ring_set_filter(linux_wifi_ring_t *ring, const struct bpf_program *bpf,
+        char *errstr) {
+    struct sock_fprog fprog;
+
+    /* pcap programs share the kernel classic bpf layout */
+    fprog.len = (unsigned short) bpf->bf_len;
+    fprog.filter = (struct sock_filter *) bpf->bf_insns;
+
+    if (setsockopt(ring->fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) < 0) {
+        snprintf(errstr, STATUS_MAX, "unable to attach filter to capture ring: %s",
+                strerror(errno));
+        return -1;
+    }
+
+    return 1;
+}
+
+int linux_wifi_ring_copy_filter(linux_wifi_ring_t *ring, int from_fd, char *errstr) {
+    struct bpf_program bpf;
+    socklen_t len = 0;
+    int r;
+
+    /* Asking with no room returns the length of the program, in instructions */
+    if (getsockopt(from_fd, SOL_SOCKET, SO_GET_FILTER, NULL, &len) < 0) {
+        snprintf(errstr, STATUS_MAX, "unable to fetch capture filter: %s", strerror(errno));
+        return -1;
+    }
+
+    if (len == 0)
+        return 0;
+
+    bpf.bf_len = len;
+    bpf.bf_insns = (struct bpf_insn *) malloc(sizeof(struct bpf_insn) * len);
+
+    if (bpf.bf_insns == NULL) {
+        snprintf(errstr, STATUS_MAX, "unable to allocate capture filter");
+        return -1;
+    }
+
+    if (getsockopt(from_fd, SOL_SOCKET, SO_GET_FILTER, bpf.bf_insns, &len) < 0) {
+        snprintf(errstr, STATUS_MAX, "unable to fetch capture filter: %s", strerror(errno));
+        free(bpf.bf_insns);
+        return -1;
+    }
+
+    bpf.bf_len = len;
+
+    r = linux_wifi_ring_set_filter(ring, &bpf, errstr);
+
+    free(bpf.bf_insns);
+
+    return r;
+}
+
+int linux_wifi_ring_loop(linux_wifi_ring_t *ring, linux_wifi_ring_frame_cb frame_cb,
+        linux_wifi_ring_block_cb block_cb, void *aux, char *errstr) {
+    struct tpacket_block_desc *block;
+    struct tpacket3_hdr *frame;
+    struct pollfd pfd;
+    struct timeval ts;
+    unsigned int num_pkts, i;
+    int sock_err;
+    socklen_t sock_err_len;
+    int r;
+
+    pfd.fd = ring->fd;
+    pfd.events = POLLIN | POLLERR;
+
+    while (1) {
+        block = (struct tpacket_block_desc *) (ring->map +
+                (size_t) ring->block_pos * ring->block_sz);
+
+        if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) &
+                    TP_STATUS_USER) == 0) {
+            pfd.revents = 0;
+
+            if (poll(&pfd, 1, -1) < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                snprintf(errstr, STATUS_MAX, "error waiting for capture ring: %s",
+                        strerror(errno));
+                return -1;
+            }
+
+            if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                sock_err = 0;
+                sock_err_len = sizeof(sock_err);
+                getsockopt(ring->fd, SOL_SOCKET, SO_ERROR, &sock_err, &sock_err_len);
+
+                snprintf(errstr, STATUS_MAX, "capture ring error: %s",
+                        sock_err == 0 ? "socket closed" : strerror(sock_err));
+                return -1;
+            }
+
+            continue;
+        }
+
+        num_pkts = block->hdr.bh1.num_pkts;
+        frame = (struct tpacket3_hdr *) ((uint8_t *) block +
+                block->hdr.bh1.offset_to_first_pkt);
+
+        r = 0;
+
+        for (i = 0; i < num_pkts; i++) {
+            ts.tv_sec = frame->tp_sec;
+            ts.tv_usec = frame->tp_nsec / 1000;
+
+            if ((r = (*frame_cb)(aux, ts, frame->tp_snaplen, frame->tp_len,
+                            (uint8_t *) frame + frame->tp_mac)) < 0)
+                break;
+
+            frame = (struct tpacket3_hdr *) ((uint8_t *) frame + frame->tp_next_offset);
+        }
+
+        /* Return the block to the kernel; anything left in it when the frame callback
+         * stopped us is dropped along with the rest of the ring on close */
+        __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        ring->block_pos = (ring->block_pos + 1) % ring->block_nr;
+
+        if (r < 0)
+            return 0;
+
+        if (block_cb != NULL)
+            (*block_cb)(aux);
+    }
+}
+
+int linux_wifi_ring_stats(linux_wifi_ring_t *ring, unsigned int *ret_packets,
+        unsigned int *ret_drops) {
+    struct tpacket_stats_v3 stats;
+    socklen_t len = sizeof(stats);
+
+    if (getsockopt(ring->fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) < 0)
+        return -1;
+
+    *ret_packets = stats.tp_packets;
+    *ret_drops = stats.tp_drops;
+
+    return 1;
+}
+
+void linux_wifi_ring_close(linux_wifi_ring_t *ring) {
+    if (ring->map != NULL) {
+        munmap(ring->map, ring->map_sz);
+        ring->map = NULL;
+    }
+
+    if (ring->fd >= 0) {
+        close(ring->fd);
+        ring->fd = -1;
+    }
+
+    ring->map_sz = 0;
+    ring->block_pos = 0;
+}
+
@@ -0,0 +1,132 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __LINUX_WIFI_RING_H__
+#define __LINUX_WIFI_RING_H__
+
+#include "../config.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/time.h>
+
+#include <pcap.h>
+
+/* TPACKET_V3 memory mapped capture
+ *
+ * The kernel fills whole blocks of frames in a ring shared with the capture tool, and
+ * hands each block over once it is full or has been open for the block timeout; a busy
+ * interface costs one wakeup per block instead of one read per packet.
+ *
+ * Optionally the socket joins a PACKET_FANOUT group, so that multiple capture tools on
+ * the same interface split the traffic between them instead of each seeing every frame.
+ */
+
+#define LINUX_WIFI_RING_FANOUT_HASH         0
+#define LINUX_WIFI_RING_FANOUT_LB           1
+#define LINUX_WIFI_RING_FANOUT_CPU          2
+#define LINUX_WIFI_RING_FANOUT_ROLLOVER     3
+#define LINUX_WIFI_RING_FANOUT_RND          4
+
+typedef struct {
+    int fd;
+
+    uint8_t *map;
+    size_t map_sz;
+
+    unsigned int block_sz;
+    unsigned int block_nr;
+    unsigned int block_pos;
+} linux_wifi_ring_t;
+
+/* Called for each frame in a block; returning < 0 stops the capture loop */
+typedef int (*linux_wifi_ring_frame_cb)(void *aux, struct timeval ts,
+        uint32_t caplen, uint32_t len, const uint8_t *data);
+
+/* Called once all the frames in a block have been handed to the frame callback */
+typedef void (*linux_wifi_ring_block_cb)(void *aux);
+
+/* Parse a fanout mode name (hash, lb, cpu, rollover, random)
+ *
+ * Returns:
+ * -1   Unknown mode
+ *  1   Success
+ */
+int linux_wifi_ring_parse_fanout(const char *mode, size_t len, unsigned int *ret_mode);
+
+/* Open a ring on an interface; block_kb is rounded up to a power-of-two number of
+ * pages, and block_timeout_ms of 0 lets the kernel pick the timeout.  A fanout_group
+ * of 0 disables fanout.
+ *
+ * errstr must be allocated by the caller and must be able to hold STATUS_MAX
+ *
+ * Returns:
+ * -1   Error
+ *  1   Success
+ */
+int linux_wifi_ring_open(linux_wifi_ring_t *ring, const char *interface,
+        unsigned int block_kb, unsigned int block_nr, unsigned int block_timeout_ms,
+        unsigned int fanout_group, unsigned int fanout_mode, char *errstr);
+
+/* Attach a filter program to the ring, replacing any existing filter
+ *
+ * errstr must be allocated by the caller and must be able to hold STATUS_MAX
+ *
+ * Returns:
+ * -1   Error
+ *  1   Success
+ */
+int linux_wifi_ring_set_filter(linux_wifi_ring_t *ring, const struct bpf_program *bpf,
+        char *errstr);
+
+/* Copy the filter attached to another socket, such as a pcap handle, to the ring
+ *
+ * errstr must be allocated by the caller and must be able to hold STATUS_MAX
+ *
+ * Returns:
+ * -1   Error
+ *  0   No filter attached to the socket
+ *  1   Success
+ */
+int linux_wifi_ring_copy_filter(linux_wifi_ring_t *ring, int from_fd, char *errstr);
+
+/* Hand frames to the callbacks until the frame callback stops the loop or the
+ * socket fails, typically because the interface went away
+ *
+ * errstr must be allocated by the caller and must be able to hold STATUS_MAX
+ *
+ * Returns:
+ * -1   Socket error
+ *  0   Stopped by the frame callback
+ */
+int linux_wifi_ring_loop(linux_wifi_ring_t *ring, linux_wifi_ring_frame_cb frame_cb,
+        linux_wifi_ring_block_cb block_cb, void *aux, char *errstr);
+
+/* Fetch and reset the kernel packet and drop counters
+ *
+ * Returns:
+ * -1   Error
+ *  1   Success
+ */
+int linux_wifi_ring_stats(linux_wifi_ring_t *ring, unsigned int *ret_packets,
+        unsigned int *ret_drops);
+
+void linux_wifi_ring_close(linux_wifi_ring_t *ring);
+
+#endif
+
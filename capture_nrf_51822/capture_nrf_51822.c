@@ -10,6 +10,7 @@
 #include <unistd.h>
 
 #include "../capture_framework.h"
+#include "../capture_serial.h"
 #include "../config.h"
 #include "nrf_51822.h"
 
@@ -23,6 +24,8 @@
 
 #define CHECK_BIT(var, pos) ((var) & (1 << (pos)))
 
+static cf_serial_delim_t nrf_slip_delim = { SLIP_START, SLIP_END };
+
 /* Unique instance data passed around by capframework */
 typedef struct {
     pthread_mutex_t serial_mutex;
@@ -40,6 +43,9 @@ typedef struct {
     unsigned int error_ctr;
     unsigned int ping_ctr;
 
+    /* Serial receive buffer, split into SLIP frames */
+    cf_serial_t *serial;
+
     kis_capture_handler_t *caph;
 } local_nrf_t;
 
@@ -126,21 +132,24 @@ bool ping_check(kis_capture_handler_t *caph) {
     return found;
 }
 
-int nrf_receive_payload(
-    kis_capture_handler_t *caph, uint8_t *rx_buf, size_t rx_max) {
+/* Read whatever the device has sent into the serial buffer; a device which stays
+ * silent for long enough is pinged to make sure we're talking to a sniffer at all */
+ssize_t nrf_receive_payload(kis_capture_handler_t *caph) {
     local_nrf_t *localnrf = (local_nrf_t *) caph->userdata;
 
-    int actual_len = 0;
+    ssize_t actual_len = 0;
 
     pthread_mutex_lock(&(localnrf->serial_mutex));
-    actual_len = read(localnrf->fd, rx_buf, rx_max);
+    actual_len = cf_serial_fill(localnrf->serial, 500);
     pthread_mutex_unlock(&(localnrf->serial_mutex));
 
     if (actual_len == 0) {
         localnrf->error_ctr++;
         if (localnrf->error_ctr > 1000000) {
             // try to send a ping packet to verify we are actually talking to
-            // the correct device
+            // the correct device; the ping flushes the device, so anything
+            // we had buffered is gone as well
+            cf_serial_reset(localnrf->serial);
             if (ping_check(caph)) {
                 localnrf->error_ctr = 0;
                 localnrf->ping_ctr = 0;
@@ -336,6 +345,14 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
         return -1;
     }
 
+    localnrf->serial = cf_serial_new(localnrf->fd, 4096, cf_serial_frame_delimited,
+            &nrf_slip_delim);
+
+    if (localnrf->serial == NULL) {
+        snprintf(msg, STATUS_MAX, "%s failed to allocate serial buffer", localnrf->name);
+        return -1;
+    }
+
     return 1;
 }
 
@@ -344,17 +361,12 @@ void capture_thread(kis_capture_handler_t *caph) {
     local_nrf_t *localnrf = (local_nrf_t *) caph->userdata;
 
     char errstr[STATUS_MAX];
-    uint8_t buf[BUFFER_SIZE];
-    int buf_rx_len = 0;
-    unsigned char pkt[BUFFER_SIZE-1];
-    memset(pkt, 0x00, sizeof(pkt));
+    uint8_t *frame;
+    size_t frame_len;
+    ssize_t buf_rx_len = 0;
 
-    int pkt_start = 0;
     int hdr_len = 0;
     int pkt_len = 0;
-    /* int pld_ctr = 0; */
-    int pkt_ctr = 0;
-    bool valid_pkt = false;
 
     int r = 0;
 
@@ -365,87 +377,62 @@ void capture_thread(kis_capture_handler_t *caph) {
             break;
         }
 
-        valid_pkt = false;
-	memset(buf, 0, sizeof(buf));
-        buf_rx_len = nrf_receive_payload(caph, buf, BUFFER_SIZE);
+        buf_rx_len = nrf_receive_payload(caph);
 
         if (buf_rx_len < 0) {
+            snprintf(errstr, STATUS_MAX, "%s failed to read from serial device",
+                    localnrf->name);
             cf_send_error(caph, 0, errstr);
             cf_handler_spindown(caph);
             break;
         }
 
-        if (buf_rx_len > 0 ) {
-	    if (buf[0] == SLIP_START && buf[buf_rx_len - 1] != SLIP_END) {
-		while(buf[buf_rx_len - 1] != SLIP_END && buf_rx_len < BUFFER_SIZE)
-		{
-		    int size_read = 0, size_to_read = BUFFER_SIZE - buf_rx_len;
-                    size_read = nrf_receive_payload(caph, &buf[buf_rx_len], size_to_read);
-		    buf_rx_len += size_read;
-		}
-	    }
-        }
-
-        /* multiple packets can be returned at the same time.
-         * I had tried passing it all to the data source, but
-         * that caused some issues. It was easier to break them
-         * apart here and send along to the data source.
-         */
-        /* do some parsing or validation */
-
-        if (buf[0] == SLIP_START && buf[buf_rx_len - 1] == SLIP_END) {
-            for (int xp = 0; xp < buf_rx_len; xp++) {
-                if ((buf[xp] == SLIP_START && xp == 0) ||
-                    (buf[xp] == SLIP_START && buf[xp - 1] == SLIP_END)) {
-                    pkt_start = xp;
-                    xp++;
-                    /* check the protocol version */
-                    if (buf[pkt_start + 3] == 0x01) {
-                        hdr_len = buf[pkt_start + 1];
-                        pkt_len = buf[pkt_start + 2];
-                    } else if (buf[pkt_start + 3] == 0x02 ||
-                        buf[pkt_start + 3] == 0x03) {
-                        hdr_len = 0x06;
-                        pkt_len = buf[pkt_start + 1];
-                    }
-                }
-
-                /* check the packet_type from the header */
-                if (buf[pkt_start + 6] == EVENT_PACKET_DATA ||
-                        (buf[pkt_start + 3] == 0x03 && buf[pkt_start + 6] == EVENT_PACKET_ADVERTISING)) {
-                    valid_pkt = true;
-                    /* pld_ctr = 0; */
-                    pkt_ctr = 0;
-                    memset(pkt, 0x00, sizeof(pkt));
-
-                    for (int hctr = (pkt_start + 1 + hdr_len);
-                         hctr < (pkt_len + pkt_start + 1 + hdr_len); hctr++) {
-                        xp++;
-                        pkt[pkt_ctr] = buf[hctr];
-                        pkt_ctr++;
-                    }
-                }
+        /* multiple packets can be returned at the same time, and packets can be
+         * split across reads; the serial buffer hands us each complete SLIP frame */
+        while ((frame_len = cf_serial_next_frame(localnrf->serial, &frame)) > 0) {
+            if (frame_len < 8)
+                continue;
+
+            /* check the protocol version */
+            if (frame[3] == 0x01) {
+                hdr_len = frame[1];
+                pkt_len = frame[2];
+            } else if (frame[3] == 0x02 || frame[3] == 0x03) {
+                hdr_len = 0x06;
+                pkt_len = frame[1];
+            } else {
+                continue;
+            }
 
-                /* send the packet along */
-                if (pkt_ctr > 0 && valid_pkt) {
-                    while (1) {
-                        struct timeval tv;
-
-                        gettimeofday(&tv, NULL);
-
-                        if ((r = cf_send_data(caph, NULL, NULL, NULL, tv, 0,
-                                 pkt_ctr, pkt)) < 0) {
-                            cf_send_error(caph, 0, "unable to send DATA frame");
-                            cf_handler_spindown(caph);
-                        } else if (r == 0) {
-                            cf_handler_wait_ringbuffer(caph);
-                            continue;
-                        } else {
-                            break;
-                        }
-                    }
+            /* check the packet_type from the header */
+            if (frame[6] != EVENT_PACKET_DATA &&
+                    !(frame[3] == 0x03 && frame[6] == EVENT_PACKET_ADVERTISING))
+                continue;
+
+            if (pkt_len == 0 || (size_t) (1 + hdr_len + pkt_len) > frame_len)
+                continue;
+
+            /* send the packet along */
+            while (1) {
+                struct timeval tv;
+
+                gettimeofday(&tv, NULL);
+
+                if ((r = cf_send_data(caph, NULL, NULL, NULL, tv, 0,
+                         pkt_len, &frame[1 + hdr_len])) < 0) {
+                    cf_send_error(caph, 0, "unable to send DATA frame");
+                    cf_handler_spindown(caph);
+                    break;
+                } else if (r == 0) {
+                    cf_handler_wait_ringbuffer(caph);
+                    continue;
+                } else {
+                    break;
                 }
             }
+
+            if (r < 0)
+                break;
         }
     }
     cf_handler_spindown(caph);
@@ -457,6 +444,7 @@ int main(int argc, char *argv[]) {
         .name = NULL,
         .interface = NULL,
         .fd = -1,
+        .serial = NULL,
     };
 
     kis_capture_handler_t *caph = cf_handler_init("nrf51822");
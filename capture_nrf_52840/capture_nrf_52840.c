@@ -14,6 +14,7 @@
 #include "nrf_52840.h"
 
 #include "../capture_framework.h"
+#include "../capture_serial.h"
 
 volatile int STOP=FALSE;
 
@@ -40,6 +41,10 @@ typedef struct {
     bool ready;
 
     uint16_t error_ctr;
+
+    /* Serial receive buffer */
+    cf_serial_t *serial;
+
     kis_capture_handler_t *caph;
 } local_nrf_t;
 
@@ -94,80 +99,25 @@ int nrf_set_channel(kis_capture_handler_t *caph, uint8_t channel)
     return 1;
 }
 
-int nrf_receive_payload(kis_capture_handler_t *caph, uint8_t *rx_buf, size_t rx_max) {
-    
-    local_nrf_t *localnrf = (local_nrf_t *) caph->userdata;
-    unsigned char buf[256];memset(buf,0x00,256);
-    unsigned char pkt[256];memset(pkt,0x00,256);
-    int actual_len = 0;
-    bool endofpkt=false;
-        int pkt_ctr = 0;
-    int res = 0;
-    unsigned int loop_ctr = 0;
-    char errstr[STATUS_MAX];
+/* Packets are ascii records labelled received:, power:, lqi:, and time:; BTLE
+ * firmware instead sends binary frames between 0xAB and 0xBC, which we pass back so
+ * we can tell the user to use the right source */
+ssize_t nrf_framer(const uint8_t *data, size_t len, void *aux) {
+    static cf_serial_delim_t btle_delim = { 0xAB, 0xBC };
+    static cf_serial_text_t pkt_text = { "received:", "time:" };
+    const uint8_t *btle;
+    ssize_t r;
 
-    while(1) {
-        memset(buf,0x00,256);
-        pthread_mutex_lock(&(localnrf->serial_mutex));
-	    res = read(localnrf->fd,buf,255);
-        pthread_mutex_unlock(&(localnrf->serial_mutex));
-        
-	    if(res > 0)
-	    {
-            if (buf[0] == 0xAB && buf[res-1] == 0xBC) {
-                if(localnrf->error_ctr == 0)
-                {
-                    snprintf(errstr, STATUS_MAX, "nRF52840 with BTLE firmware detected please use the nRF51822 capture source instead");
-                    cf_send_message(caph, errstr, MSGFLAG_INFO);
-                }
-                localnrf->error_ctr++;
-                if(localnrf->error_ctr >= 1000)
-                    localnrf->error_ctr=0;
-            }
-            else
-            {
-                loop_ctr = 0;
-                for(int xp = 0;xp < res;xp++)
-                {
-                    if(buf[xp] == 'r' && buf[xp+1] == 'e' && buf[xp+2] == 'c') {
-                        memset(pkt,0x00,256);
-                        pkt_ctr = 0;//start over
-                    }
-
-                    pkt[pkt_ctr] = buf[xp];
-                    pkt_ctr++;
-                    if(pkt_ctr > 254)
-                            break;
-                    if(strstr((char*)pkt,"received:") > 0
-                    && strstr((char*)pkt,"power:") > 0
-                    && strstr((char*)pkt,"lqi:") > 0
-                    && strstr((char*)pkt,"time:") > 0
-                    )
-                    {
-                        endofpkt = true;
-                        break;
-                    }
-                }
-                if(pkt_ctr > 0 && endofpkt)
-                {
-                    memcpy(rx_buf,pkt,pkt_ctr);
-                    actual_len = pkt_ctr;
-                    break;
-                }
-            }
-	    }
-	    else
-	    {
-            // to keep us from looking for a packet when we only got a partial
-		    loop_ctr++;
-		    if(loop_ctr > 1)
-            {
-                break;
-            }
-	    }
-    }
+    if (data[0] == 0xAB)
+        return cf_serial_frame_delimited(data, len, &btle_delim);
+
+    r = cf_serial_frame_text(data, len, &pkt_text);
+
+    /* Don't skip past the start of a BTLE frame */
+    if (r < 0 && (btle = (const uint8_t *) memchr(data, 0xAB, -r)) != NULL)
+        r = -(btle - data);
 
-    return actual_len;
+    return r;
 }
 
 int probe_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
@@ -333,8 +283,15 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
     tcflush(localnrf->fd, TCIFLUSH);
     tcsetattr(localnrf->fd, TCSANOW, &localnrf->newtio);
 
+    localnrf->serial = cf_serial_new(localnrf->fd, 4096, nrf_framer, NULL);
+
     pthread_mutex_unlock(&(localnrf->serial_mutex));
 
+    if (localnrf->serial == NULL) {
+        snprintf(msg, STATUS_MAX, "%s failed to allocate serial buffer", localnrf->name);
+        return -1;
+    }
+
     nrf_set_channel(caph, 11);
 
     return 1;
@@ -387,8 +344,9 @@ void capture_thread(kis_capture_handler_t *caph) {
     local_nrf_t *localnrf = (local_nrf_t *) caph->userdata;
 
     char errstr[STATUS_MAX];
-    uint8_t buf[256];
-    int buf_rx_len = 0;
+    uint8_t *frame;
+    size_t frame_len;
+    ssize_t rx_len;
     int r = 0;
 
     while(1) {
@@ -400,40 +358,63 @@ void capture_thread(kis_capture_handler_t *caph) {
             pthread_mutex_unlock(&(localnrf->serial_mutex));
             break;
 	    }
-        if(localnrf->ready)
-        {
-            buf_rx_len = nrf_receive_payload(caph, buf, 256);
-            if (buf_rx_len < 0) {
-                cf_send_error(caph, 0, errstr);
-                cf_handler_spindown(caph);
-                break;
+
+        if (!localnrf->ready)
+            continue;
+
+        /* Read everything the device has buffered, which may be several packets or
+         * only part of one */
+        pthread_mutex_lock(&(localnrf->serial_mutex));
+        rx_len = cf_serial_fill(localnrf->serial, 100);
+        pthread_mutex_unlock(&(localnrf->serial_mutex));
+
+        if (rx_len < 0) {
+            snprintf(errstr, STATUS_MAX, "%s failed to read from serial device - %s",
+                    localnrf->name, strerror(errno));
+            cf_send_error(caph, 0, errstr);
+            cf_handler_spindown(caph);
+            break;
+        }
+
+        while ((frame_len = cf_serial_next_frame(localnrf->serial, &frame)) > 0) {
+            if (frame[0] == 0xAB) {
+                if(localnrf->error_ctr == 0)
+                {
+                    snprintf(errstr, STATUS_MAX, "nRF52840 with BTLE firmware detected please use the nRF51822 capture source instead");
+                    cf_send_message(caph, errstr, MSGFLAG_INFO);
+                }
+                localnrf->error_ctr++;
+                if(localnrf->error_ctr >= 1000)
+                    localnrf->error_ctr=0;
+                continue;
             }
-            //send the packet along
-            if(buf_rx_len > 0){
-                /* insert the channel into the packet header*/
-                if(buf[0] != 0xAB && buf[buf_rx_len-1] != 0xBC)
-                    buf[2] = (uint8_t)localnrf->channel;
-                while (1) {
-                    struct timeval tv;
-
-                    gettimeofday(&tv, NULL);
-
-                    if ((r = cf_send_data(caph,
-                                    NULL, NULL, NULL,
-                                    tv,
-                                    0,
-                                    buf_rx_len, buf)) < 0) {
-                        cf_send_error(caph, 0, "unable to send DATA frame");
-                        cf_handler_spindown(caph);
-                    } else if (r == 0) {
-                        cf_handler_wait_ringbuffer(caph);
-                        continue;
-                    } else {
-                        break;
-                    }
+
+            /* insert the channel into the packet header*/
+            frame[2] = (uint8_t)localnrf->channel;
+
+            while (1) {
+                struct timeval tv;
+
+                gettimeofday(&tv, NULL);
+
+                if ((r = cf_send_data(caph,
+                                NULL, NULL, NULL,
+                                tv,
+                                0,
+                                frame_len, frame)) < 0) {
+                    cf_send_error(caph, 0, "unable to send DATA frame");
+                    cf_handler_spindown(caph);
+                    break;
+                } else if (r == 0) {
+                    cf_handler_wait_ringbuffer(caph);
+                    continue;
+                } else {
+                    break;
                 }
             }
 
+            if (r < 0)
+                break;
         }
     }
     cf_handler_spindown(caph);
@@ -446,6 +427,7 @@ int main(int argc, char *argv[]) {
         .interface = NULL,
         .fd = -1,
         .error_ctr = 0,
+        .serial = NULL,
     };
 
     kis_capture_handler_t *caph = cf_handler_init("nrf52840");
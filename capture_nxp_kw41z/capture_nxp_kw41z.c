@@ -32,6 +32,7 @@
 #include "nxp_kw41z.h"
 
 #include "../capture_framework.h"
+#include "../capture_serial.h"
 
 #ifndef CRTSCTS
 #define CRTSCTS 020000000000 /*should be defined but isn't with the C99*/
@@ -55,6 +56,9 @@ typedef struct {
     
     bool ready;
 
+    /* Serial receive buffer, split into FSCI frames */
+    cf_serial_t *serial;
+
     kis_capture_handler_t *caph;
 } local_nxp_t;
 
@@ -75,6 +79,36 @@ bool checksum(uint8_t *payload, uint8_t len) {
     return checksum == chk;
 }
 
+/* FSCI frames are 0x02, the opcode group and opcode, a little endian 16 bit payload
+ * length, the payload, and an xor checksum; a frame with a bad checksum is treated
+ * as a false start and we resync on the next byte */
+ssize_t nxp_framer(const uint8_t *data, size_t len, void *aux) {
+    const uint8_t *stx;
+    size_t frame_len;
+
+    if (data[0] != 0x02) {
+        if ((stx = (const uint8_t *) memchr(data, 0x02, len)) == NULL)
+            return -((ssize_t) len);
+        return -(stx - data);
+    }
+
+    if (len < 5)
+        return 0;
+
+    frame_len = 6 + (data[3] | (data[4] << 8));
+
+    if (frame_len > 255)
+        return -1;
+
+    if (len < frame_len)
+        return 0;
+
+    if (!checksum((uint8_t *) data, frame_len))
+        return -1;
+
+    return frame_len;
+}
+
 int nxp_write_cmd(kis_capture_handler_t *caph, uint8_t *tx_buf, size_t tx_len, uint8_t *resp,
                   size_t resp_len, uint8_t *rx_buf, size_t rx_max) {
 
@@ -548,7 +582,14 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
     tcflush(localnxp->fd, TCIFLUSH);
     tcsetattr(localnxp->fd, TCSANOW, &localnxp->newtio);
 
+    localnxp->serial = cf_serial_new(localnxp->fd, 4096, nxp_framer, NULL);
+
     pthread_mutex_unlock(&(localnxp->serial_mutex));
+
+    if (localnxp->serial == NULL) {
+        snprintf(msg, STATUS_MAX, "%s failed to allocate serial buffer", localnxp->name);
+        return -1;
+    }
    
     localnxp->ready = false;
  
@@ -653,8 +694,9 @@ void capture_thread(kis_capture_handler_t *caph) {
     local_nxp_t *localnxp = (local_nxp_t *) caph->userdata;
 
     char errstr[STATUS_MAX];
-    uint8_t buf[256];
-    int buf_rx_len = 0;
+    uint8_t *frame;
+    size_t frame_len;
+    ssize_t rx_len;
     int r = 0;
 
     while (1) {
@@ -666,32 +708,36 @@ void capture_thread(kis_capture_handler_t *caph) {
             pthread_mutex_unlock(&(localnxp->serial_mutex));
             break;
         }
-        buf_rx_len = 0;
-        if (localnxp->ready) {
-            memset(buf,0x00,256);
-            buf_rx_len = nxp_receive_payload(caph, buf, 256);
-            if (buf_rx_len < 0) {
-                cf_send_error(caph, 0, errstr);
-                cf_handler_spindown(caph);
-                break;
-            }
-        }
-        //check the checksum
-        if (!checksum(buf,buf_rx_len)) {
-            //printf("bad checksum\n");
-            buf_rx_len = 0;
+
+        if (!localnxp->ready)
+            continue;
+
+        /* Read everything the device has buffered, which may be several frames or
+         * only part of one */
+        pthread_mutex_lock(&(localnxp->serial_mutex));
+        rx_len = cf_serial_fill(localnxp->serial, 100);
+        pthread_mutex_unlock(&(localnxp->serial_mutex));
+
+        if (rx_len < 0) {
+            snprintf(errstr, STATUS_MAX, "%s failed to read from serial device - %s",
+                    localnxp->name, strerror(errno));
+            cf_send_error(caph, 0, errstr);
+            cf_handler_spindown(caph);
+            break;
         }
-        if (buf_rx_len > 0) {
+
+        /* Frames come out of the serial buffer with their checksum verified */
+        while ((frame_len = cf_serial_next_frame(localnxp->serial, &frame)) > 0) {
             //printf("channel:%d prevchannel:%d\n",(uint8_t)localnxp->channel,(uint8_t)localnxp->prevchannel);
             /* btle channel is part of the packet, zigbee is not*/
             if((uint8_t)localnxp->prevchannel == 0){
                 if((uint8_t)localnxp->channel >= 11 && (uint8_t)localnxp->channel <= 26) {
-                    buf[4] = (uint8_t)localnxp->channel;
+                    frame[4] = (uint8_t)localnxp->channel;
                 }
             }
             else {
                 if((uint8_t)localnxp->prevchannel >= 11 && (uint8_t)localnxp->prevchannel <= 26) {
-                    buf[4] = (uint8_t)localnxp->prevchannel;
+                    frame[4] = (uint8_t)localnxp->prevchannel;
                 }
             }
 
@@ -700,10 +746,11 @@ void capture_thread(kis_capture_handler_t *caph) {
 
                 gettimeofday(&tv, NULL);
 
-                if ((r = cf_send_data(caph, NULL, NULL, NULL, tv, 0, buf_rx_len,
-                                      buf)) < 0) {
+                if ((r = cf_send_data(caph, NULL, NULL, NULL, tv, 0, frame_len,
+                                      frame)) < 0) {
                     cf_send_error(caph, 0, "unable to send DATA frame");
                     cf_handler_spindown(caph);
+                    break;
                 } else if (r == 0) {
                     cf_handler_wait_ringbuffer(caph);
                     continue;
@@ -711,6 +758,9 @@ void capture_thread(kis_capture_handler_t *caph) {
                     break;
                 }
             }
+
+            if (r < 0)
+                break;
         }
     }
     cf_handler_spindown(caph);
@@ -724,6 +774,7 @@ int main(int argc, char *argv[]) {
         .fd = -1,
         .ready = false,
         .prevchannel = 0,
+        .serial = NULL,
     };
 
     pthread_mutex_init(&(localnxp.serial_mutex), NULL);
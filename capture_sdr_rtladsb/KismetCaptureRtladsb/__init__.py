@@ -9,6 +9,7 @@ Accepts standard options:
 Additionally accepts:
     ppm     error offset 
     gain    fixed gain 
+    demod_threads   number of threads demodulating samples from the radio
 
 """
 
@@ -34,9 +35,13 @@ import threading
 import time
 import uuid
 
+from . import iqpipeline
 from . import rtlsdr
 from . import kismetexternal
 
+# Raw Mode-S frames; must match KDLT_ADSB_MODES in adsb_modes.h
+LINKTYPE_ADSB_MODES = 147
+
 class KismetRtladsb(object):
     def __init__(self):
         self.opts = {}
@@ -63,7 +68,14 @@ class KismetRtladsb(object):
         self.allowed_errors = 5
         self.usb_buf_sz = 16 * 16384
 
-        self.square_lut = np.zeros(256)
+        # Samples from the preamble to the end of a long frame
+        self.frame_span = self.preamble_len + 2 * self.long_frame
+
+        # Demodulator threads
+        self.opts['demod_threads'] = 2
+        self.iq_pipeline = None
+
+        self.square_lut = np.zeros(256, dtype=np.int32)
         for i in range(0, 256):
             self.square_lut[i] = abs(127 - i)
             self.square_lut[i] *= self.square_lut[i]
@@ -174,74 +186,11 @@ class KismetRtladsb(object):
                 if not msg:
                     break
 
-                output = {}
-
-                msgtype = self.adsb_msg_get_type(msg)
-                msgbits = self.adsb_len_by_type(msgtype)
-                msgcrc = self.adsb_msg_get_crc(msg, msgbits)
-                msgcrc2 = self.adsb_crc(msg, msgbits)
-
-                output['adsb_msg_type'] = msgtype
-                output['adsb_raw_msg'] = msg.hex()
-                output['crc_valid'] = False
-
-                if msgcrc != msgcrc2:
-                    if msgtype == 11 or msgtype == 17:
-                        msg2 = self.adsb_msg_fix_single_bit(msg, msgbits)
-     
-                        if msg2 != None:
-                            msg = msg2
-                            output['crc_valid'] = True
-                            output['crc_recovered'] = 1
-                else:
-                    output['crc_valid'] = True
-
-                # Process valid messages
-                if output['crc_valid']:
-                    output['adsb_msg'] = msg.hex()
-
-                    msgicao = self.adsb_msg_get_icao(msg).hex()
-
-                    output['icao'] = msgicao
-
-                    if msgtype == 17:
-                        msgme, msgsubme = self.adsb_msg_get_me_subme(msg)
-
-                        if msgme >= 1 and msgme <= 4:
-                            msgflight = self.adsb_msg_get_flight(msg)
-                            output['callsign'] = msgflight
-
-                        elif msgme >= 9 and msgme <= 18:
-                            msgalt = self.adsb_msg_get_ac12_altitude(msg)
-                            output['altitude'] = msgalt
-
-                            msgpair, msglat, msglon = self.adsb_msg_get_airborne_position(msg)
-                            output['coordpair_even'] = msgpair
-                            output['raw_lat'] = msglat
-                            output['raw_lon'] = msglon
-
-                        elif msgme == 19 and (msgsubme >= 1 and msgsubme <= 4):
-                            if msgsubme == 1 or msgsubme == 2:
-                                msgvelocity = self.adsb_msg_get_airborne_velocity(msg)
-                                msgheading = self.adsb_msg_get_airborne_heading(msg)
-
-                                output['speed'] = msgvelocity
-                                output['heading'] = msgheading
-                            elif msgsubme == 3 or msgsubme == 4:
-                                msgheadvalid, msgheading = self.adsb_msg_get_airborne_heading(msg)
-                                if msgheadvalid:
-                                    out['heading'] = heading
-            
-                    elif msgtype == 0 or msgtype == 4 or msgtype == 16 or msgtype == 20:
-                        msgalt = self.adsb_msg_get_ac13_altitude(msg)
-                        output['altitude'] = msgalt
-
+                # Frames are sent raw; Kismet checks the CRC and decodes them
                 if print_stderr:
-                    print(output, file=sys.stderr)
-
-                l = json.dumps(output)
+                    print(msg.hex(), file=sys.stderr)
 
-                if not self.handle_json(l):
+                if not self.handle_modes(msg):
                     raise RuntimeError('could not process response from rtladsb')
         except Exception as e:
             traceback.print_exc(file=sys.stderr)
@@ -407,6 +356,14 @@ class KismetRtladsb(object):
         if 'gain' in options:
             self.opts['gain'] = options['gain']
 
+        if 'demod_threads' in options:
+            try:
+                self.opts['demod_threads'] = max(1, int(options['demod_threads']))
+            except ValueError:
+                ret['success'] = False
+                ret['message'] = "Could not parse demod_threads"
+                return ret
+
         ret['hardware'] = self.rtlsdr.rtl_get_device_name(intnum)
         if ('uuid' in options):
             ret['uuid'] = options['uuid']
@@ -431,6 +388,26 @@ class KismetRtladsb(object):
 
         return {"success": True}
 
+    def handle_modes(self, msg):
+        try:
+            packet = kismetexternal.datasource_pb2.SubPacket()
+
+            dt = datetime.now()
+            packet.time_sec = int(time.mktime(dt.timetuple()))
+            packet.time_usec = int(dt.microsecond)
+
+            packet.dlt = LINKTYPE_ADSB_MODES
+
+            packet.size = len(msg)
+            packet.data = bytes(msg)
+
+            self.kismet.send_datasource_data_report(full_packet=packet)
+        except Exception as e:
+            self.kismet.send_datasource_error_report(message = "Could not handle output")
+            return False
+
+        return True
+
     def handle_json(self, injson):
         try:
             j = json.loads(injson)
@@ -458,147 +435,96 @@ class KismetRtladsb(object):
         return True
 
     # Raw ADSB decode of the IQ data and manchester encoded data,
-    # turning it into packets.  Referenced from the rtl_adsb implementation
-    # but rewritten for numpy and other python semantics
-    def _iq_magnitude(self, buf, buflen):
+    # turning it into packets.  Referenced from the rtl_adsb implementation,
+    # vectorized over a whole buffer of samples with numpy
+    def _iq_magnitude(self, iq):
         """
         Convert IQ to magnitude
         """
+        return self.square_lut[iq[0::2]] + self.square_lut[iq[1::2]]
 
-        nb = np.ctypeslib.as_array(buf, shape=(buflen,)).astype(np.uint8)
-
-        self.magnitude_buf = np.add(self.square_lut[nb[::2]], self.square_lut[nb[1::2]])
-        # self.magnitude_buf = ((np.abs(127 - nb[::2]) ** 2) + (np.abs(127 - nb[1::2]) ** 2))
-
-    def _single_manchester(self, a, b, c, d):
-        bit_p = a > b
-        bit = c > d
-
-        if bit and bit_p and c > b:
-            return 1
-        if bit and not bit_p and d < b:
-            return 1
-        if not bit and bit_p and d > b:
-            return 0
-        if not bit and not bit_p and c < b:
-            return 0
-
-        return None
-
-    def _adsb_preamble(self, buf, i):
-        low = 0
-        high = 65535
-
-        for i2 in range(0, self.preamble_len):
-            if i2 == 0 or i2 == 2 or i2 == 7 or i2 == 9:
-                high = buf[i + i2]
-            else:
-                low = buf[i + i2]
-
-            if high <= low:
-                return 0
-
-        return 1
-
-    def _adsb_np_preamble(self, buf, i):
-        preamble = np.array([1, 0, 1, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0]) - 0.25 
-        corr = np.correlate(buf[i:], preamble)
-        return np.argmax(corr) + i
-
-    def _manchester(self):
-        a = 0
-        b = 0
-
-        i = 0
-        while True:
-            if i >= len(self.magnitude_buf) - 1:
-                break
-
-            p = self._adsb_np_preamble(self.magnitude_buf, i)
-
-            if p + self.preamble_len >= len(self.magnitude_buf):
-                break
+    def _adsb_preambles(self, mag):
+        """
+        Find every position which could start a long frame; this is the rtl_adsb
+        preamble test, where each high sample must be above the low samples around it
+        """
+        n = len(mag) - self.frame_span + 1
 
-            a = self.magnitude_buf[p]
-            b = self.magnitude_buf[p + 1]
-            i = p + self.preamble_len
+        if n <= 0:
+            return np.zeros(0, dtype=np.intp)
 
-            # # Look for a preamble
-            # for ix in range(i, (len(self.magnitude_buf) - self.preamble_len)):
-            #     if not self._adsb_preamble(self.magnitude_buf, ix):
-            #         i = ix
-            #         continue
+        s = [mag[i:i + n] for i in range(0, self.preamble_len)]
 
-            #     a = self.magnitude_buf[ix]
-            #     b = self.magnitude_buf[ix + 1]
-            #     i = ix + self.preamble_len
-            #     break
+        cond = (s[0] > 0) & (s[0] > s[1]) & (s[2] > s[1])
+        for i in range(3, 7):
+            cond &= s[2] > s[i]
+        cond &= (s[7] > s[6]) & (s[7] > s[8]) & (s[9] > s[8])
+        for i in range(10, self.preamble_len):
+            cond &= s[9] > s[i]
 
-            errors = 0
-            m_i = 0
+        return np.flatnonzero(cond)
 
-            message_buf = bytearray(b'\xFF' * self.long_frame)
+    def _manchester(self, mag, preambles):
+        """
+        Slice the bits of every candidate frame at once; a bit is the higher of its two
+        samples, and a bit where the transition from the previous bit makes no sense is
+        an error.  The bit after an error is always accepted, as in rtl_adsb.  Returns the
+        bits of the frames with few enough errors.
+        """
+        offt = self.preamble_len + 2 * np.arange(0, self.long_frame)
+        c = mag[preambles[:, None] + offt]
+        d = mag[preambles[:, None] + offt + 1]
 
-            # Read the message until we get errors
-            for ix in range(i, len(self.magnitude_buf) - 1, 2):
-                i = ix + 1
+        a = np.concatenate((mag[preambles][:, None], c[:, :-1]), axis=1)
+        b = np.concatenate((mag[preambles + 1][:, None], d[:, :-1]), axis=1)
 
-                bit = self._single_manchester(a, b, self.magnitude_buf[ix], self.magnitude_buf[ix + 1])
+        bit = c > d
+        bit_p = a > b
 
-                a = self.magnitude_buf[ix]
-                b = self.magnitude_buf[ix + 1]
+        valid = (bit & bit_p & (c > b)) | (bit & ~bit_p & (d < b)) | \
+                (~bit & bit_p & (d > b)) | (~bit & ~bit_p & (c < b))
 
-                if bit == None:
-                    errors += 1
+        errors = ~valid
+        for i in range(1, self.long_frame):
+            errors[:, i] &= ~errors[:, i - 1]
 
-                    if errors > self.allowed_errors:
-                        message_buf = message_buf[:m_i]
-                        break
-                    else:
-                        if a > b:
-                            bit = 1
-                        else:
-                            bit = 0
-                        a = 0
-                        b = 65535
+        # Only long frames are reported, so the first bit must be set
+        ok = bit[:, 0] & (np.count_nonzero(errors, axis=1) <= self.allowed_errors)
 
-                message_buf[m_i] = bit
-                m_i = m_i + 1
+        return (preambles[ok], bit[ok])
 
-                if m_i >= self.long_frame:
-                    break
+    def demod_adsb(self, iq):
+        """
+        IQ pipeline demodulator; called from the pipeline worker threads
+        """
+        mag = self._iq_magnitude(iq)
 
-            if m_i < self.short_frame:
-                continue
-            self._adsb_message(message_buf)
+        preambles = self._adsb_preambles(mag)
 
-    def _adsb_message(self, message_buf):
-        msg_hdr = np.packbits(message_buf[0])
-        if msg_hdr == 0:
+        if len(preambles) == 0:
             return
 
-        adsb_frame = None
-        frame_len = self.long_frame
+        (starts, bits) = self._manchester(mag, preambles)
 
-        if msg_hdr & 0x80:
-            frame_len = self.long_frame
-        else:
-            frame_len = self.short_frame
+        # Skip frames which start inside a frame we've already taken
+        next_start = 0
+        for (p, fbits) in zip(starts, bits):
+            if p < next_start:
+                continue
 
-        if len(message_buf) < frame_len:
-            return
+            next_start = p + self.frame_span
 
-        adsb_frame = bytearray(np.packbits(message_buf[:frame_len]).tobytes())
-        
-        if frame_len > self.short_frame:
-            # print("*{};".format(adsb_frame.hex()))
-            self.kismet.add_task(self.message_queue.put, [adsb_frame])
+            adsb_frame = bytearray(np.packbits(fbits).tobytes())
+            self.kismet.loop.call_soon_threadsafe(self.message_queue.put_nowait, adsb_frame)
 
     def rtl_data_cb(self, buf, buflen, ctx):
-        self._iq_magnitude(buf, buflen)
-        self._manchester()
+        self.iq_pipeline.push(buf, buflen)
         return 
 
+    def __iq_pipeline_error(self, e):
+        self.kismet.send_datasource_error_report(message = f"Error demodulating ADSB: {e}")
+        self.kill_adsb()
+
     def __async_radio_thread(self):
         # This function blocks forever until cancelled
         try:
@@ -619,6 +545,15 @@ class KismetRtladsb(object):
         except Exception as e:
             return [False, f"Error opening RTLSDR device: {e.args[0]}"]
 
+        # Each buffer repeats the end of the previous read, so a frame which spans two
+        # reads is found whole in the second
+        self.iq_pipeline = iqpipeline.IQPipeline(self.usb_buf_sz, 
+                overlap = 2 * (self.frame_span - 1), 
+                workers = self.opts['demod_threads'],
+                error_cb = self.__iq_pipeline_error)
+        self.iq_pipeline.add_demodulator(self.demod_adsb)
+        self.iq_pipeline.start()
+
         self.rtl_thread = threading.Thread(target=self.__async_radio_thread)
         self.rtl_thread.daemon = True
         self.rtl_thread.start()
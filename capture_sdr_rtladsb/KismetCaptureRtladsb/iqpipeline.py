@@ -0,0 +1,121 @@
+"""
+IQ demodulation pipeline
+
+Samples from one radio are copied out of the librtlsdr callback into a fixed ring of
+buffers and demodulated by a pool of worker threads, so the USB callback never waits
+on a demodulator and a slow demodulator only costs dropped buffers instead of stalling
+the radio.  Any number of demodulators may be attached to one pipeline; each is called
+with every buffer, so several demodulators can share one radio.
+
+Each buffer starts with the end of the previous one, so a demodulator sees any signal
+which spans two reads from the radio complete in the second buffer.  Demodulators must
+treat the buffer as read-only; it is shared by every demodulator and recycled once they
+have all seen it.
+"""
+
+import queue
+import threading
+
+import numpy as np
+
+class IQPipeline(object):
+    def __init__(self, bufsz, overlap = 0, nbufs = 16, workers = 2, error_cb = None):
+        """
+        bufsz - size of a read from the radio, in bytes
+        overlap - bytes of the previous read to repeat at the start of each buffer
+        nbufs - number of buffers in the ring
+        workers - number of demodulation threads
+        error_cb - called with the exception when a demodulator fails; the worker
+                   thread exits
+        """
+        self.bufsz = bufsz
+        self.overlap = overlap
+        self.workers = max(1, workers)
+        self.error_cb = error_cb
+
+        self.buffers = [np.zeros(overlap + bufsz, dtype=np.uint8) for i in range(0, max(nbufs, self.workers))]
+        self.tail = np.zeros(overlap, dtype=np.uint8)
+
+        self.free_q = queue.Queue()
+        self.ready_q = queue.Queue()
+
+        for i in range(0, len(self.buffers)):
+            self.free_q.put(i)
+
+        self.demodulators = []
+        self.threads = []
+
+        # Reads dropped because every buffer was still being demodulated
+        self.overruns = 0
+
+    def add_demodulator(self, demod):
+        """
+        Add a demodulator, called from the worker threads with a numpy uint8 array of
+        interleaved IQ samples
+        """
+        self.demodulators.append(demod)
+
+    def start(self):
+        for i in range(0, self.workers):
+            t = threading.Thread(target=self.__worker)
+            t.daemon = True
+            t.start()
+            self.threads.append(t)
+
+    def stop(self):
+        for t in self.threads:
+            self.ready_q.put(None)
+
+        for t in self.threads:
+            t.join()
+
+        self.threads = []
+
+    def push(self, buf, buflen):
+        """
+        Add a read from the radio; called from the librtlsdr async callback with the
+        ctypes buffer
+        """
+        src = np.ctypeslib.as_array(buf, shape=(buflen,))
+
+        try:
+            bnum = self.free_q.get_nowait()
+        except queue.Empty:
+            bnum = None
+            self.overruns += 1
+
+        if bnum is not None:
+            b = self.buffers[bnum]
+            b[:self.overlap] = self.tail
+            b[self.overlap:self.overlap + buflen] = src
+            self.ready_q.put((bnum, self.overlap + buflen))
+
+        # The tail is kept even when the read is dropped, so the next buffer continues
+        # from the right place
+        if self.overlap == 0:
+            return
+
+        if buflen >= self.overlap:
+            self.tail[:] = src[buflen - self.overlap:]
+        else:
+            self.tail[:] = np.concatenate((self.tail[buflen:], src))
+
+    def __worker(self):
+        while True:
+            r = self.ready_q.get()
+
+            if r is None:
+                break
+
+            (bnum, sz) = r
+            iq = self.buffers[bnum][:sz]
+
+            try:
+                for d in self.demodulators:
+                    d(iq)
+            except Exception as e:
+                if self.error_cb is not None:
+                    self.error_cb(e)
+                break
+            finally:
+                self.free_q.put(bnum)
@@ -0,0 +1,274 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#define _GNU_SOURCE
+
+#include "config.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capture_serial.h"
+
+cf_serial_t *cf_serial_new(int fd, size_t buf_sz, cf_serial_framer framer, void *aux) {
+    cf_serial_t *port;
+
+    if (buf_sz == 0 || framer == NULL)
+        return NULL;
+
+    port = (cf_serial_t *) malloc(sizeof(cf_serial_t));
+
+    if (port == NULL)
+        return NULL;
+
+    port->buf = (uint8_t *) malloc(buf_sz);
+
+    if (port->buf == NULL) {
+        free(port);
+        return NULL;
+    }
+
+    port->fd = fd;
+    port->buf_sz = buf_sz;
+    port->start = 0;
+    port->len = 0;
+    port->framer = framer;
+    port->framer_aux = aux;
+    port->frames = 0;
+    port->discarded = 0;
+
+    return port;
+}
+
+void cf_serial_free(cf_serial_t *port) {
+    if (port == NULL)
+        return;
+
+    free(port->buf);
+    free(port);
+}
+
+void cf_serial_reset(cf_serial_t *port) {
+    port->start = 0;
+    port->len = 0;
+}
+
+/* Read everything available once poll has flagged the fd as readable */
+static ssize_t cf_serial_read_avail(cf_serial_t *port) {
+    ssize_t total = 0;
+    ssize_t r;
+
+    /* Move the unparsed tail to the front so the whole free space is usable */
+    if (port->start != 0) {
+        if (port->len != 0)
+            memmove(port->buf, port->buf + port->start, port->len);
+        port->start = 0;
+    }
+
+    /* A full buffer with no frame in it can never produce one; drop it and resync */
+    if (port->len == port->buf_sz) {
+        port->discarded += port->len;
+        port->len = 0;
+    }
+
+    while (port->len < port->buf_sz) {
+        r = read(port->fd, port->buf + port->len, port->buf_sz - port->len);
+
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return -1;
+        }
+
+        if (r == 0)
+            break;
+
+        port->len += r;
+        total += r;
+
+        /* A short read means the device has nothing more queued right now */
+        if (port->len < port->buf_sz)
+            break;
+    }
+
+    return total;
+}
+
+ssize_t cf_serial_fill(cf_serial_t *port, int timeout_ms) {
+    struct pollfd pfd;
+    int r;
+
+    pfd.fd = port->fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    while ((r = poll(&pfd, 1, timeout_ms)) < 0 && errno == EINTR)
+        ;
+
+    if (r < 0)
+        return -1;
+
+    if (r == 0)
+        return 0;
+
+    /* Unplugged USB serial devices report as hung up or in error */
+    if ((pfd.revents & (POLLERR | POLLNVAL)) ||
+            ((pfd.revents & POLLHUP) && !(pfd.revents & POLLIN)))
+        return -1;
+
+    return cf_serial_read_avail(port);
+}
+
+int cf_serial_fill_multi(cf_serial_t **ports, size_t n_ports, int timeout_ms,
+        size_t *err_port) {
+    struct pollfd pfd_stack[8];
+    struct pollfd *pfd = pfd_stack;
+    size_t i;
+    int r, filled = 0;
+
+    if (n_ports > sizeof(pfd_stack) / sizeof(struct pollfd)) {
+        pfd = (struct pollfd *) malloc(sizeof(struct pollfd) * n_ports);
+
+        if (pfd == NULL)
+            return -1;
+    }
+
+    for (i = 0; i < n_ports; i++) {
+        pfd[i].fd = ports[i]->fd;
+        pfd[i].events = POLLIN;
+        pfd[i].revents = 0;
+    }
+
+    while ((r = poll(pfd, n_ports, timeout_ms)) < 0 && errno == EINTR)
+        ;
+
+    if (r < 0)
+        filled = -1;
+
+    for (i = 0; r > 0 && i < n_ports; i++) {
+        if (pfd[i].revents == 0)
+            continue;
+
+        if ((pfd[i].revents & (POLLERR | POLLNVAL)) ||
+                ((pfd[i].revents & POLLHUP) && !(pfd[i].revents & POLLIN)) ||
+                cf_serial_read_avail(ports[i]) < 0) {
+            if (err_port != NULL)
+                *err_port = i;
+            filled = -1;
+            break;
+        }
+
+        filled++;
+    }
+
+    if (pfd != pfd_stack)
+        free(pfd);
+
+    return filled;
+}
+
+size_t cf_serial_next_frame(cf_serial_t *port, uint8_t **frame) {
+    ssize_t r;
+
+    while (port->len != 0) {
+        r = (*(port->framer))(port->buf + port->start, port->len, port->framer_aux);
+
+        if (r == 0)
+            return 0;
+
+        if (r < 0) {
+            if ((size_t) -r > port->len)
+                r = -((ssize_t) port->len);
+
+            port->start += -r;
+            port->len -= -r;
+            port->discarded += -r;
+            continue;
+        }
+
+        if ((size_t) r > port->len)
+            return 0;
+
+        *frame = port->buf + port->start;
+
+        port->start += r;
+        port->len -= r;
+        port->frames++;
+
+        if (port->len == 0)
+            port->start = 0;
+
+        return r;
+    }
+
+    port->start = 0;
+
+    return 0;
+}
+
+ssize_t cf_serial_frame_delimited(const uint8_t *data, size_t len, void *aux) {
+    cf_serial_delim_t *delim = (cf_serial_delim_t *) aux;
+    const uint8_t *end;
+
+    if (data[0] != delim->start) {
+        const uint8_t *start = (const uint8_t *) memchr(data, delim->start, len);
+
+        if (start == NULL)
+            return -((ssize_t) len);
+
+        return -((ssize_t) (start - data));
+    }
+
+    end = (const uint8_t *) memchr(data + 1, delim->end, len - 1);
+
+    if (end == NULL)
+        return 0;
+
+    return (end - data) + 1;
+}
+
+ssize_t cf_serial_frame_text(const uint8_t *data, size_t len, void *aux) {
+    cf_serial_text_t *text = (cf_serial_text_t *) aux;
+    size_t start_len = strlen(text->start);
+    size_t end_len = strlen(text->end);
+    const uint8_t *start, *end;
+
+    start = (const uint8_t *) memmem(data, len, text->start, start_len);
+
+    if (start == NULL) {
+        /* Keep enough of the tail to complete a marker split across reads */
+        if (len < start_len)
+            return 0;
+        return -((ssize_t) (len - start_len + 1));
+    }
+
+    if (start != data)
+        return -((ssize_t) (start - data));
+
+    end = (const uint8_t *) memmem(data + start_len, len - start_len, text->end, end_len);
+
+    if (end == NULL)
+        return 0;
+
+    return (end - data) + end_len;
+}
+
@@ -0,0 +1,130 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Shared serial receive layer for datasources built around USB serial dongles.
+ *
+ * Serial dongles deliver frames in arbitrary chunks; a single read may hold part of
+ * a frame, or several frames at once.  A cf_serial_t reads everything the device has
+ * available into one receive buffer, and hands back complete frames found by a
+ * framing callback, so a capture thread does one read per burst of frames instead
+ * of one per frame, and frames split across reads are reassembled.
+ *
+ * Frames returned by cf_serial_next_frame point into the receive buffer and are only
+ * valid until the next fill or reset.  Sending each of them with cf_send_data lets
+ * the capture framework batch them when the server negotiated batching.
+ *
+ * A serial port is not thread safe; callers which also send commands to the device
+ * from the channel control thread must serialize access to the fd as they already do.
+ */
+
+#ifndef __CAPTURE_SERIAL_H__
+#define __CAPTURE_SERIAL_H__
+
+#include "config.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+/* Framing callback:  examine the buffered data, which always starts at the position
+ * following the last frame, and return:
+ *  >0  length of a complete frame at the start of the data
+ *   0  no complete frame yet, wait for more data
+ *  <0  discard that many bytes of the data before trying again, such as noise before
+ *      the start of the next frame
+ */
+typedef ssize_t (*cf_serial_framer)(const uint8_t *data, size_t len, void *aux);
+
+typedef struct {
+    int fd;
+
+    uint8_t *buf;
+    size_t buf_sz;
+
+    /* Start of unparsed data, and length of the unparsed data */
+    size_t start;
+    size_t len;
+
+    cf_serial_framer framer;
+    void *framer_aux;
+
+    /* Frames returned, and bytes discarded while resyncing */
+    uint64_t frames;
+    uint64_t discarded;
+} cf_serial_t;
+
+/* Allocate a receive buffer of buf_sz for an already open and configured serial fd;
+ * buf_sz must exceed the largest frame. */
+cf_serial_t *cf_serial_new(int fd, size_t buf_sz, cf_serial_framer framer, void *aux);
+void cf_serial_free(cf_serial_t *port);
+
+/* Drop any buffered data, such as after flushing the device */
+void cf_serial_reset(cf_serial_t *port);
+
+/* Wait up to timeout_ms for data and read everything available into the receive
+ * buffer.
+ *
+ * Returns:
+ * -1   Read error or the device went away
+ *  0   No data within the timeout
+ * >0   Number of bytes read
+ */
+ssize_t cf_serial_fill(cf_serial_t *port, int timeout_ms);
+
+/* Wait up to timeout_ms for data on any of several ports, such as an array of dongles
+ * serviced by one thread, and fill every port which has data.
+ *
+ * Returns:
+ * -1   Read error on any port; *err_port is set to it, if err_port is not NULL
+ *  0   No data within the timeout
+ * >0   Number of ports with new data
+ */
+int cf_serial_fill_multi(cf_serial_t **ports, size_t n_ports, int timeout_ms,
+        size_t *err_port);
+
+/* Fetch the next complete frame from the receive buffer.
+ *
+ * Returns:
+ *  0   No complete frame buffered
+ * >0   Length of the frame, *frame is set to the start of it
+ */
+size_t cf_serial_next_frame(cf_serial_t *port, uint8_t **frame);
+
+/* Common framers */
+
+/* Frames which start with one byte and end with another, such as SLIP-style framing;
+ * aux points to a cf_serial_delim_t */
+typedef struct {
+    uint8_t start;
+    uint8_t end;
+} cf_serial_delim_t;
+
+ssize_t cf_serial_frame_delimited(const uint8_t *data, size_t len, void *aux);
+
+/* Text frames which start with one marker string and end with another, such as
+ * labelled ascii records; the frame includes both markers.  aux points to a
+ * cf_serial_text_t */
+typedef struct {
+    const char *start;
+    const char *end;
+} cf_serial_text_t;
+
+ssize_t cf_serial_frame_text(const uint8_t *data, size_t len, void *aux);
+
+#endif
+
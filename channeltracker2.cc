@@ -22,13 +22,13 @@
 #include "json_adapter.h"
 #include "devicetracker.h"
 #include "devicetracker_component.h"
-#include "devicetracker_view_workers.h"
 #include "packinfo_signal.h"
 
 channel_tracker_v2::channel_tracker_v2() :
     lifetime_global() {
 
     lock.set_name("channeltrackerv2");
+    activity_mutex.set_name("channeltrackerv2 activity");
 
     // Number of seconds we consider a device to be active on a frequency 
     // after the last time we see it
@@ -52,6 +52,12 @@ channel_tracker_v2::channel_tracker_v2() :
     devicetracker =
         Globalreg::fetch_mandatory_global_as<device_tracker>("DEVICETRACKER");
 
+    // Device counts are kept as devices are updated, instead of scanning every device
+    devicetracker->set_device_activity_cb(
+            [this](double prev_freq, time_t prev_ts, double freq, time_t ts) {
+                device_activity(prev_freq, prev_ts, freq, ts);
+            });
+
     frequency_map =
         entrytracker->register_and_get_field_as<tracker_element_double_map>(
                 "kismet.channeltracker.frequency_map", 
@@ -95,6 +101,10 @@ channel_tracker_v2::~channel_tracker_v2() {
     if (timetracker != nullptr)
         timetracker->remove_timer(timer_id);
 
+    auto devicetracker = Globalreg::fetch_global_as<device_tracker>("DEVICETRACKER");
+    if (devicetracker != nullptr)
+        devicetracker->set_device_activity_cb(nullptr);
+
     auto packetchain = Globalreg::fetch_global_as<packet_chain>("PACKETCHAIN");
     if (packetchain != nullptr)
         packetchain->remove_handler(&packet_chain_handler, CHAINPOS_LOGGING);
@@ -102,54 +112,65 @@ channel_tracker_v2::~channel_tracker_v2() {
     Globalreg::globalreg->remove_global("CHANNEL_TRACKER");
 }
 
-class channeltracker_v2_device_worker : public device_tracker_view_worker {
-public:
-    channeltracker_v2_device_worker(channel_tracker_v2 *channelv2) {
-        this->channelv2 = channelv2;
-        stime = time(0);
-    }
-
-    virtual ~channeltracker_v2_device_worker() { }
+void channel_tracker_v2::device_activity(double in_prev_freq, time_t in_prev_ts,
+        double in_freq, time_t in_ts) {
+    kis_lock_guard<kis_mutex> lk(activity_mutex, "channel_tracker_v2 device_activity");
 
-    // Count all the devices.  We use a filter worker but 'match' on all
-    // and count them into our local map
-    virtual bool match_device(std::shared_ptr<kis_tracked_device_base> device) override {
-        auto freq = device->get_frequency();
-        if (freq == 0)
-            return false;
+    // Take the device out of the bucket it was last counted in, if that bucket hasn't
+    // been recycled for a newer second
+    if (in_prev_freq != 0 && in_prev_ts != 0) {
+        auto ai = activity_map.find(in_prev_freq);
 
-        auto i = device_count.find(freq);
+        if (ai != activity_map.end()) {
+            auto slot = in_prev_ts % device_decay;
 
-        if (i != device_count.end()) {
-            if (device->get_last_time() > (stime - channelv2->device_decay))
-                i->second++;
-        } else {
-            if (device->get_last_time() > (stime - channelv2->device_decay))
-                device_count[freq] = 1;
-            else
-                device_count[freq] = 0;
+            if (ai->second.seconds[slot] == in_prev_ts && ai->second.counts[slot] > 0)
+                ai->second.counts[slot]--;
         }
+    }
 
-        return false;
+    if (in_freq == 0 || in_ts == 0)
+        return;
+
+    auto ai = activity_map.find(in_freq);
+
+    if (ai == activity_map.end()) {
+        frequency_activity fa;
+        fa.counts.resize(device_decay, 0);
+        fa.seconds.resize(device_decay, 0);
+        ai = activity_map.emplace(in_freq, fa).first;
     }
 
-    // Send it back to our channel tracker
-    virtual void finalize() override {
-        channelv2->update_device_counts(device_count, stime);
+    auto slot = in_ts % device_decay;
+
+    if (ai->second.seconds[slot] != in_ts) {
+        ai->second.seconds[slot] = in_ts;
+        ai->second.counts[slot] = 0;
     }
 
-protected:
-    channel_tracker_v2 *channelv2;
+    ai->second.counts[slot]++;
+}
 
+int channel_tracker_v2::gather_devices_event(int event_id __attribute__((unused))) {
     std::unordered_map<double, unsigned int> device_count;
+    auto stime = time(0);
 
-    time_t stime;
-};
+    {
+        kis_lock_guard<kis_mutex> lk(activity_mutex, "channel_tracker_v2 gather_devices_event");
 
+        for (const auto& a : activity_map) {
+            unsigned int count = 0;
 
-int channel_tracker_v2::gather_devices_event(int event_id __attribute__((unused))) {
-    channeltracker_v2_device_worker worker(this);
-    devicetracker->do_readonly_device_work(worker);
+            for (int s = 0; s < device_decay; s++) {
+                if (a.second.seconds[s] > (stime - device_decay))
+                    count += a.second.counts[s];
+            }
+
+            device_count[a.first] = count;
+        }
+    }
+
+    update_device_counts(device_count, stime);
 
     return 1;
 }
@@ -177,6 +198,43 @@ void channel_tracker_v2::update_device_counts(std::unordered_map<double, unsigne
     }
 }
 
+bool channel_tracker_v2::get_channel_activity(const std::string& in_channel, 
+        double& ret_packets_sec, double& ret_devices) {
+    kis_lock_guard<kis_mutex> lk(lock, "channel_tracker_v2 get_channel_activity");
+
+    auto smi = channel_map->find(in_channel);
+
+    if (smi == channel_map->end())
+        return false;
+
+    auto chan_channel = std::static_pointer_cast<channel_tracker_v2_channel>(smi->second);
+
+    time_t now = time(0);
+
+    ret_packets_sec = chan_channel->get_packets_rrd()->get_minute_avg(now);
+    ret_devices = 0;
+
+    // Devices are only counted by frequency
+    if (chan_channel->get_frequency() != 0) {
+        auto imi = frequency_map->find(chan_channel->get_frequency());
+
+        if (imi != frequency_map->end()) {
+            auto freq_channel = std::static_pointer_cast<channel_tracker_v2_channel>(imi->second);
+            ret_devices = freq_channel->get_device_rrd()->get_minute_avg(now);
+        }
+    }
+
+    return true;
+}
+
+void channel_tracker_v2::iterate_frequencies(const std::function<void (double, 
+            std::shared_ptr<channel_tracker_v2_channel>)>& in_cb) {
+    kis_lock_guard<kis_mutex> lk(lock, "channel_tracker_v2 iterate_frequencies");
+
+    for (const auto& fi : *frequency_map)
+        in_cb(fi.first, std::static_pointer_cast<channel_tracker_v2_channel>(fi.second));
+}
+
 int channel_tracker_v2::packet_chain_handler(CHAINCALL_PARMS) {
     channel_tracker_v2 *cv2 = (channel_tracker_v2 *) auxdata;
 
@@ -243,6 +301,10 @@ int channel_tracker_v2::packet_chain_handler(CHAINCALL_PARMS) {
     }
 
     if (chan_channel) {
+        // Remember where the channel lives so device counts can be found by channel
+        if (l1info->freq_khz != 0 && chan_channel->get_frequency() != l1info->freq_khz)
+            chan_channel->set_frequency(l1info->freq_khz);
+
         chan_channel->get_signal_data()->append_signal(*l1info, false, 0);
         chan_channel->get_packets_rrd()->add_sample(1, stime);
 
@@ -21,9 +21,11 @@
 
 #include "config.h"
 
+#include <functional>
 #include <map>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "globalregistry.h"
 #include "kis_mutex.h"
@@ -149,10 +151,25 @@ private:
 public:
     virtual ~channel_tracker_v2();
 
-    // Update device counts - kept public so that the worker can access it
+    // Number of seconds a device is counted as active on a frequency after it was last seen
     int device_decay;
     void update_device_counts(std::unordered_map<double, unsigned int> in_counts, time_t in_ts);
 
+    // A device moved from one frequency and last-seen time to another; called by the 
+    // device tracker as devices are updated
+    void device_activity(double in_prev_freq, time_t in_prev_ts, double in_freq, time_t in_ts);
+
+    // Recent activity on a named channel, averaged over the last minute: packets per
+    // second, and active devices on the frequency the channel was last seen on.
+    // Returns false if the channel has never been seen.
+    bool get_channel_activity(const std::string& in_channel, double& ret_packets_sec,
+            double& ret_devices);
+
+    // Call a function with the record of every frequency seen; the channel tracker is
+    // locked while iterating
+    void iterate_frequencies(const std::function<void (double, 
+                std::shared_ptr<channel_tracker_v2_channel>)>& in_cb);
+
 protected:
     kis_mutex lock;
 
@@ -177,6 +194,16 @@ protected:
     int timer_id;
     int gather_devices_event(int event_id);
 
+    // Devices active on each frequency, by the second they were last seen in; a ring of 
+    // device_decay one-second buckets per frequency, and the second each bucket holds
+    struct frequency_activity {
+        std::vector<unsigned int> counts;
+        std::vector<time_t> seconds;
+    };
+
+    kis_mutex activity_mutex;
+    std::unordered_map<double, frequency_activity> activity_map;
+
 
 };
 
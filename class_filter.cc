@@ -111,7 +111,9 @@ bool class_filter::filterstring_to_bool(const std::string& str) {
 }
 
 class_filter_mac_addr::class_filter_mac_addr(const std::string& in_id, const std::string& in_description) :
-    class_filter(in_id, in_description, "mac_addr") {
+    class_filter(in_id, in_description, "mac_addr"),
+    compiled_filters{std::make_shared<compiled_filter_map>()},
+    filters_dirty{false} {
 
         register_fields();
         reserve_fields(nullptr);
@@ -179,12 +181,14 @@ void class_filter_mac_addr::set_filter(mac_addr in_mac, const std::string& in_ph
 
     // Cache unknown for future lookups
     if (phy == nullptr) {
-        unknown_phy_mac_filter_map[in_phy][in_mac] = value;
+        unknown_phy_mac_filter_map[in_phy].add(in_mac, value);
         return;
     }
 
     // Set known phy types
-    phy_mac_filter_map[phy->fetch_phy_id()][in_mac] = value;
+    phy_mac_filter_map[phy->fetch_phy_id()].add(in_mac, value);
+
+    filters_dirty = true;
 }
 
 void class_filter_mac_addr::remove_filter(mac_addr in_mac, const std::string& in_phy) {
@@ -209,10 +213,7 @@ void class_filter_mac_addr::remove_filter(mac_addr in_mac, const std::string& in
         if (unknown_phy == unknown_phy_mac_filter_map.end())
             return;
 
-        auto unknown_match = unknown_phy->second.find(in_mac);
-
-        if (unknown_match != unknown_phy->second.end())
-            unknown_phy->second.erase(unknown_match);
+        unknown_phy->second.remove(in_mac);
 
         return;
     }
@@ -222,10 +223,9 @@ void class_filter_mac_addr::remove_filter(mac_addr in_mac, const std::string& in
     if (known_phy == phy_mac_filter_map.end())
         return;
 
-    auto known_match = known_phy->second.find(in_mac);
+    known_phy->second.remove(in_mac);
 
-    if (known_match != known_phy->second.end())
-        known_phy->second.erase(known_match);
+    filters_dirty = true;
 }
 
 void class_filter_mac_addr::update_phy_map(std::shared_ptr<eventbus_event> evt) {
@@ -256,30 +256,53 @@ void class_filter_mac_addr::update_phy_map(std::shared_ptr<eventbus_event> evt)
 
     // Purge the unknown record
     unknown_phy_mac_filter_map.erase(unknown_key);
+
+    compile_filters();
+}
+
+void class_filter_mac_addr::compile_filters() {
+    auto compiled = std::make_shared<compiled_filter_map>(phy_mac_filter_map);
+
+    filters_dirty = false;
+    std::atomic_store(&compiled_filters, compiled);
+}
+
+std::shared_ptr<class_filter_mac_addr::compiled_filter_map> class_filter_mac_addr::fetch_compiled_filters() {
+    // Filters set outside of the REST endpoints, such as from the config file, are
+    // copied once by the first lookup after them
+    if (filters_dirty) {
+        kis_lock_guard<kis_mutex> lk(mutex, "class_filter_mac_addr compile");
+
+        if (filters_dirty)
+            compile_filters();
+    }
+
+    return std::atomic_load(&compiled_filters);
 }
 
 void class_filter_mac_addr::edit_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
     std::ostream stream(&con->response_stream());
 
     try {
-        auto filter = con->json()["filter"];
+        auto phy_k = con->uri_params().find(":phyname");
+
+        // Filter lists are read from the body without building a document
+        auto found = con->json_bool_members("filter", [&](const std::string& i, bool v) {
+                mac_addr m(i);
 
-        if (!filter.isObject()) {
+                if (m.state.error) 
+                    throw std::runtime_error(fmt::format("Invalid MAC address: '{}'", con->escape_html(i)));
+
+                set_filter(m, phy_k->second, v);
+                });
+
+        if (!found) {
             con->set_status(500);
             stream << "Expected 'filter' as a dictionary\n";
             return;
         }
 
-        for (const auto& i : filter.getMemberNames()) {
-            mac_addr m(i);
-            bool v = filter[i].asBool();
-
-            if (m.state.error) 
-                throw std::runtime_error(fmt::format("Invalid MAC address: '{}'", con->escape_html(i)));
-
-            auto phy_k = con->uri_params().find(":phyname");
-            set_filter(m, phy_k->second, v);
-        }
+        compile_filters();
 
         stream << "Set filter\n";
         return;
@@ -297,23 +320,24 @@ void class_filter_mac_addr::remove_endp_handler(std::shared_ptr<kis_net_beast_ht
     std::ostream stream(&con->response_stream());
 
     try {
-        auto filter = con->json()["filter"];
+        auto phy_k = con->uri_params().find(":phyname");
+
+        auto found = con->json_strings("filter", [&](const std::string& i) {
+                mac_addr m(i);
 
-        if (!filter.isArray()) {
+                if (m.state.error) 
+                    throw std::runtime_error(fmt::format("Invalid MAC address: '{}'", con->escape_html(i)));
+
+                remove_filter(m, phy_k->second);
+                });
+
+        if (!found) {
             con->set_status(500);
             stream << "Expected 'filter' as an array\n";
             return;
         }
 
-        for (const auto& i : filter) {
-            mac_addr m(i.asString());
-
-            if (m.state.error) 
-                throw std::runtime_error(fmt::format("Invalid MAC address: '{}'", con->escape_html(i.asString())));
-
-            auto phy_k = con->uri_params().find(":phyname");
-            remove_filter(m, phy_k->second);
-        }
+        compile_filters();
 
         stream << "Removed filter\n";
         return;
@@ -329,19 +353,19 @@ void class_filter_mac_addr::remove_endp_handler(std::shared_ptr<kis_net_beast_ht
 }
 
 bool class_filter_mac_addr::filter(mac_addr mac, unsigned int phy) {
-    kis_lock_guard<kis_mutex> lk(mutex, "class_filter_mac_addr filter");
+    auto compiled = fetch_compiled_filters();
 
-    auto pi = phy_mac_filter_map.find(phy);
+    auto pi = compiled->find(phy);
 
-    if (pi == phy_mac_filter_map.end())
+    if (pi == compiled->end())
         return get_filter_default();
 
-    auto si = pi->second.find(mac);
+    bool value;
 
-    if (si == pi->second.end())
+    if (!pi->second.match(mac, value))
         return get_filter_default();
 
-    return si->second;
+    return value;
 }
 
 std::shared_ptr<tracker_element_map> class_filter_mac_addr::self_endp_handler() {
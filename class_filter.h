@@ -18,6 +18,9 @@
 
 #include "config.h"
 
+#include <atomic>
+
+#include "mac_filter_table.h"
 #include "packetchain.h"
 #include "packet.h"
 
@@ -127,10 +130,23 @@ protected:
     int filter_sub_mac_id, filter_sub_value_id;
 
 	// Internal fast lookup tables per-phy we use for actual filtering
-	std::map<int, std::map<mac_addr, bool>> phy_mac_filter_map;
+	std::map<int, mac_filter_table> phy_mac_filter_map;
 
 	// Internal unknown phy map for filters registered before we had a phy ID
-	std::map<std::string, std::map<mac_addr, bool>> unknown_phy_mac_filter_map;
+	std::map<std::string, mac_filter_table> unknown_phy_mac_filter_map;
+
+    // Copy of phy_mac_filter_map which lookups use; replaced when the filters change,
+    // so filtering never takes the lock
+    using compiled_filter_map = std::map<int, mac_filter_table>;
+
+    std::shared_ptr<compiled_filter_map> compiled_filters;
+    std::atomic<bool> filters_dirty;
+
+    // Replace the lookup tables; called with the mutex held
+    void compile_filters();
+
+    // Current lookup tables, replacing them first if the filters changed since
+    std::shared_ptr<compiled_filter_map> fetch_compiled_filters();
 
     // Address management endpoint keyed on path
     void edit_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
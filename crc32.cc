@@ -657,6 +657,269 @@ uint32_t crc32_combine(uint32_t crcA, uint32_t crcB, size_t lengthB)
 }
 
 
+// //////////////////////////////////////////////////////////
+// hardware accelerated CRC32, selected at runtime
+
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+  #define CRC32_HW_PCLMUL
+  #include <cpuid.h>
+  #include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__)) && __BYTE_ORDER == __LITTLE_ENDIAN
+  #define CRC32_HW_ARMV8
+  #include <string.h>
+  #if defined(__linux__)
+    #include <sys/auxv.h>
+    #ifndef HWCAP_CRC32
+      #define HWCAP_CRC32 (1 << 7)
+    #endif
+  #endif
+#endif
+
+
+namespace
+{
+  typedef uint32_t (*crc32_hw_func)(const void* data, size_t length, uint32_t previousCrc32);
+
+#ifdef CRC32_HW_PCLMUL
+  /// fold 16 byte blocks with carry-less multiplication, from "Fast CRC Computation for
+  /// Generic Polynomials Using PCLMULQDQ Instruction" (Gopal, Ozturk, et al, Intel 2009);
+  /// length must be a multiple of 16 and at least 64, and crc is the raw (inverted) state
+  __attribute__((target("pclmul,sse2")))
+  uint32_t crc32_pclmul_fold(const uint8_t* buf, size_t length, uint32_t crc)
+  {
+    // bit-reflected fold constants and CRC32 / Barrett reduction polynomials
+    alignas(16) static const uint64_t k1k2[] = { 0x0154442bd4, 0x01c6e41596 };
+    alignas(16) static const uint64_t k3k4[] = { 0x01751997d0, 0x00ccaa009e };
+    alignas(16) static const uint64_t k5k0[] = { 0x0163cd6124, 0x0000000000 };
+    alignas(16) static const uint64_t poly[] = { 0x01db710641, 0x01f7011641 };
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128((const __m128i*) (buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i*) (buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i*) (buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i*) (buf + 0x30));
+
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+
+    x0 = _mm_load_si128((const __m128i*) k1k2);
+
+    buf    += 64;
+    length -= 64;
+
+    // fold four blocks at a time
+    while (length >= 64)
+    {
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+      x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+      x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+      x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+      x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+      x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+      x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+      y5 = _mm_loadu_si128((const __m128i*) (buf + 0x00));
+      y6 = _mm_loadu_si128((const __m128i*) (buf + 0x10));
+      y7 = _mm_loadu_si128((const __m128i*) (buf + 0x20));
+      y8 = _mm_loadu_si128((const __m128i*) (buf + 0x30));
+
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+      x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+      x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+      x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+      buf    += 64;
+      length -= 64;
+    }
+
+    // fold the four blocks into one
+    x0 = _mm_load_si128((const __m128i*) k3k4);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // fold any remaining single blocks
+    while (length >= 16)
+    {
+      x2 = _mm_loadu_si128((const __m128i*) buf);
+
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+      buf    += 16;
+      length -= 16;
+    }
+
+    // fold 128 bits to 64
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+
+    x0 = _mm_loadl_epi64((const __m128i*) k5k0);
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits
+    x0 = _mm_load_si128((const __m128i*) poly);
+
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+  }
+
+  uint32_t crc32_pclmul(const void* data, size_t length, uint32_t previousCrc32)
+  {
+    if (length < 64)
+      return crc32_16bytes(data, length, previousCrc32);
+
+    const uint8_t* current = (const uint8_t*) data;
+    size_t blocks = length & ~(size_t) 15;
+
+    uint32_t crc = ~crc32_pclmul_fold(current, blocks, ~previousCrc32);
+
+    return crc32_16bytes(current + blocks, length - blocks, crc);
+  }
+
+  bool crc32_pclmul_supported()
+  {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+      return false;
+
+    return (ecx & bit_PCLMUL) && (edx & bit_SSE2);
+  }
+#endif
+
+#ifdef CRC32_HW_ARMV8
+  // the ARMv8 CRC32 instructions use the same (zlib / 802.3) polynomial; they are
+  // emitted directly so the rest of the build doesn't need +crc
+  inline uint32_t crc32_armv8_x(uint32_t crc, uint64_t v)
+  {
+    __asm__(".arch_extension crc\n\tcrc32x %w0, %w0, %x1" : "+r"(crc) : "r"(v));
+    return crc;
+  }
+
+  inline uint32_t crc32_armv8_b(uint32_t crc, uint8_t v)
+  {
+    __asm__(".arch_extension crc\n\tcrc32b %w0, %w0, %w1" : "+r"(crc) : "r"((uint32_t) v));
+    return crc;
+  }
+
+  uint32_t crc32_armv8(const void* data, size_t length, uint32_t previousCrc32)
+  {
+    uint32_t crc = ~previousCrc32;
+    const uint8_t* current = (const uint8_t*) data;
+
+    // four independent 8 byte words per iteration keep the CRC unit busy
+    while (length >= 32)
+    {
+      uint64_t v[4];
+      memcpy(v, current, sizeof(v));
+
+      crc = crc32_armv8_x(crc, v[0]);
+      crc = crc32_armv8_x(crc, v[1]);
+      crc = crc32_armv8_x(crc, v[2]);
+      crc = crc32_armv8_x(crc, v[3]);
+
+      current += 32;
+      length  -= 32;
+    }
+
+    while (length >= 8)
+    {
+      uint64_t v;
+      memcpy(&v, current, sizeof(v));
+
+      crc = crc32_armv8_x(crc, v);
+
+      current += 8;
+      length  -= 8;
+    }
+
+    while (length-- != 0)
+      crc = crc32_armv8_b(crc, *current++);
+
+    return ~crc;
+  }
+
+  bool crc32_armv8_supported()
+  {
+  #if defined(__APPLE__)
+    // every 64-bit Apple CPU implements the CRC32 instructions
+    return true;
+  #elif defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+  #else
+    return false;
+  #endif
+  }
+#endif
+
+  const char* crc32_hw_impl_name = "slicing-by-16";
+
+  crc32_hw_func crc32_hw_select()
+  {
+#ifdef CRC32_HW_PCLMUL
+    if (crc32_pclmul_supported())
+    {
+      crc32_hw_impl_name = "pclmul";
+      return crc32_pclmul;
+    }
+#endif
+
+#ifdef CRC32_HW_ARMV8
+    if (crc32_armv8_supported())
+    {
+      crc32_hw_impl_name = "armv8-crc32";
+      return crc32_armv8;
+    }
+#endif
+
+    return crc32_16bytes;
+  }
+
+  const crc32_hw_func crc32_hw_impl = crc32_hw_select();
+} // anonymous namespace
+
+
+/// compute CRC32 with the fastest implementation the CPU supports
+uint32_t crc32_hw(const void* data, size_t length, uint32_t previousCrc32)
+{
+  return crc32_hw_impl(data, length, previousCrc32);
+}
+
+
+/// name of the implementation used by crc32_hw
+const char* crc32_hw_name()
+{
+  return crc32_hw_impl_name;
+}
+
+
 // //////////////////////////////////////////////////////////
 // constants
 
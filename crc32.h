@@ -67,3 +67,10 @@ uint32_t crc32_16bytes (const void* data, size_t length, uint32_t previousCrc32
 /// compute CRC32 (Slicing-by-16 algorithm, prefetch upcoming data blocks)
 uint32_t crc32_16bytes_prefetch(const void* data, size_t length, uint32_t previousCrc32 = 0, size_t prefetchAhead = 256);
 #endif
+
+/// compute CRC32 with the fastest implementation the CPU supports, selected at runtime:
+/// carry-less multiplication (PCLMULQDQ) on x86, the CRC32 instructions on ARMv8, and
+/// slicing-by-16 everywhere else
+uint32_t crc32_hw      (const void* data, size_t length, uint32_t previousCrc32 = 0);
+/// name of the implementation crc32_hw uses
+const char* crc32_hw_name();
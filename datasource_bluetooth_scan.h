@@ -39,6 +39,7 @@ public:
 private:
     bluetooth_scan_source() :
         datasource_scan_source("/phy/phybluetooth/scan/scan_report",
+                "/phy/phybluetooth/scan/bulk_report",
                 "Bluetooth/BTLE Scan",
                 "BLUETOOTHSCAN"),
         lifetime_global() { }
@@ -42,6 +42,7 @@ public:
 private:
     dot11_scan_source() : 
         datasource_scan_source("/phy/phy80211/scan/scan_report",
+                "/phy/phy80211/scan/bulk_report",
                 "IEEE80211 scan",
                 "DOT11SCAN"),
         lifetime_global() { }
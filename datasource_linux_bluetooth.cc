@@ -45,6 +45,11 @@ bool kis_datasource_linux_bluetooth::dispatch_rx_packet(const nonstd::string_vie
         return true;
     }
 
+    if (command.compare("LBTADVREPORT") == 0) {
+        handle_packet_linuxbtadverts(seqno, content);
+        return true;
+    }
+
     return false;
 }
 
@@ -107,8 +112,26 @@ void kis_datasource_linux_bluetooth::handle_packet_linuxbtdevice(uint32_t in_seq
     for (auto u : report.btdevice().uuid_list()) 
         bpi->service_uuid_vec.push_back(uuid(u));
 
+    packet->insert(pack_comp_meta, make_bluetooth_metablob(bpi));
+
+    auto datasrcinfo = packetchain->new_packet_component<packetchain_comp_datasource>();
+    datasrcinfo->ref_source = this;
+
+    packet->insert(pack_comp_datasrc, datasrcinfo);
+
+    inc_source_num_packets(1);
+    get_source_packet_rrd()->add_sample(1, time(0));
+
+    // Inject the packet into the packetchain if we have one
+    packetchain->process_packet(packet);
+
+}
+
+std::shared_ptr<packet_metablob> 
+    kis_datasource_linux_bluetooth::make_bluetooth_metablob(const std::shared_ptr<bluetooth_packinfo>& bpi) {
     // Forge a metablob until we transition the capture protocols
     std::stringstream fake_json;
+
     fake_json << "{";
     fake_json << "\"bt_address\":\"" << bpi->address << "\",";
     fake_json << "\"bt_name\":\"" << json_adapter::sanitize_string(bpi->name) << "\",";
@@ -118,10 +141,11 @@ void kis_datasource_linux_bluetooth::handle_packet_linuxbtdevice(uint32_t in_seq
 
     bool need_comma = false;
     for (auto u : bpi->service_uuid_vec) {
-        fake_json << "\"" << u << "\"";
         if (need_comma) 
             fake_json << ",";
         need_comma = true;
+
+        fake_json << "\"" << u << "\"";
     }
 
     fake_json << "]";
@@ -129,19 +153,147 @@ void kis_datasource_linux_bluetooth::handle_packet_linuxbtdevice(uint32_t in_seq
 
     auto metablob = packetchain->new_packet_component<packet_metablob>();
     metablob->set_data("LINUXBLUETOOTH", fake_json.str());
-    packet->insert(pack_comp_meta, metablob);
 
-    auto datasrcinfo = packetchain->new_packet_component<packetchain_comp_datasource>();
-    datasrcinfo->ref_source = this;
+    return metablob;
+}
 
-    packet->insert(pack_comp_datasrc, datasrcinfo);
+// Pull the name, tx power, and service uuids out of the AD structures of an advert
+static void decode_le_advert_data(const std::string& in_data, std::shared_ptr<bluetooth_packinfo> bpi) {
+    size_t pos = 0;
+
+    while (pos < in_data.length()) {
+        auto len = static_cast<uint8_t>(in_data[pos]);
+
+        // A zero length ends the significant part of the data
+        if (len == 0 || pos + 1 + len > in_data.length())
+            break;
+
+        auto ad_type = static_cast<uint8_t>(in_data[pos + 1]);
+        auto field = reinterpret_cast<const uint8_t *>(in_data.data() + pos + 2);
+        size_t field_len = len - 1;
+
+        switch (ad_type) {
+            case 0x02:
+            case 0x03:
+                // 16 bit service uuids, little endian
+                for (size_t i = 0; i + 2 <= field_len; i += 2)
+                    bpi->service_uuid_vec.push_back(uuid(fmt::format("0000{:02X}{:02X}-0000-1000-8000-00805F9B34FB",
+                                    field[i + 1], field[i])));
+                break;
+            case 0x04:
+            case 0x05:
+                // 32 bit service uuids
+                for (size_t i = 0; i + 4 <= field_len; i += 4)
+                    bpi->service_uuid_vec.push_back(uuid(fmt::format("{:02X}{:02X}{:02X}{:02X}-0000-1000-8000-00805F9B34FB",
+                                    field[i + 3], field[i + 2], field[i + 1], field[i])));
+                break;
+            case 0x06:
+            case 0x07:
+                // 128 bit service uuids, little endian
+                for (size_t i = 0; i + 16 <= field_len; i += 16) {
+                    const uint8_t *u = field + i;
+                    bpi->service_uuid_vec.push_back(uuid(fmt::format("{:02X}{:02X}{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-"
+                                    "{:02X}{:02X}-{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}",
+                                    u[15], u[14], u[13], u[12], u[11], u[10], u[9], u[8],
+                                    u[7], u[6], u[5], u[4], u[3], u[2], u[1], u[0])));
+                }
+                break;
+            case 0x08:
+                // Shortened name, only if there's no complete one
+                if (bpi->name.length() == 0)
+                    bpi->name = munge_to_printable(std::string(reinterpret_cast<const char *>(field), field_len));
+                break;
+            case 0x09:
+                bpi->name = munge_to_printable(std::string(reinterpret_cast<const char *>(field), field_len));
+                break;
+            case 0x0A:
+                if (field_len >= 1)
+                    bpi->txpower = static_cast<int8_t>(field[0]);
+                break;
+            default:
+                break;
+        }
+
+        pos += 1 + len;
+    }
+}
 
-    inc_source_num_packets(1);
-    get_source_packet_rrd()->add_sample(1, time(0));
+void kis_datasource_linux_bluetooth::handle_packet_linuxbtadverts(uint32_t in_seqno,
+        const nonstd::string_view& in_content) {
 
-    // Inject the packet into the packetchain if we have one
-    packetchain->process_packet(packet);
+    // If we're paused, throw away this packet
+    {
+        kis_lock_guard<kis_mutex> lk(ext_mutex, 
+                "kis_datasource_linux_bluetooth handle_packet_linuxbtadverts");
+
+        if (get_source_paused())
+            return;
+    }
+
+    KismetLinuxBluetooth::LinuxBluetoothAdvertReport report;
+
+    if (!report.ParseFromArray(in_content.data(), in_content.length())) {
+        _MSG(std::string("Kismet datasource driver ") + get_source_builder()->get_source_type() + 
+                std::string(" could not parse the advert report, something is wrong with "
+                    "the remote capture tool"), MSGFLAG_ERROR);
+        trigger_error("Invalid LBTADVREPORT");
+        return;
+    }
+
+    uint64_t num_adverts = 0;
+
+    for (const auto& a : report.advert()) {
+        if (a.address().length() != 6)
+            continue;
+
+        auto packet = packetchain->generate_packet();
+        auto bpi = packetchain->new_packet_component<bluetooth_packinfo>();
+
+        packet->insert(pack_comp_btdevice, bpi);
+
+        if (clobber_timestamp && get_source_remote()) {
+            gettimeofday(&(packet->ts), NULL);
+        } else {
+            packet->ts.tv_sec = a.time_sec();
+            packet->ts.tv_usec = a.time_usec();
+        }
+
+        bpi->address = mac_addr(reinterpret_cast<const uint8_t *>(a.address().data()), 6);
+        bpi->type = a.type();
+
+        decode_le_advert_data(a.data(), bpi);
+
+        if (a.has_txpower())
+            bpi->txpower = a.txpower();
+
+        if (a.has_rssi()) {
+            auto siginfo = packetchain->new_packet_component<kis_layer1_packinfo>();
+            siginfo->signal_type = kis_l1_signal_type_dbm;
+            siginfo->signal_dbm = a.rssi();
+            packet->insert(pack_comp_l1info, siginfo);
+        }
+
+        if (report.has_gps()) {
+            auto gpsinfo = handle_sub_gps(report.gps());
+            packet->insert(pack_comp_gps, gpsinfo);
+        }
+
+        packet->insert(pack_comp_meta, make_bluetooth_metablob(bpi));
+
+        auto datasrcinfo = packetchain->new_packet_component<packetchain_comp_datasource>();
+        datasrcinfo->ref_source = this;
+        packet->insert(pack_comp_datasrc, datasrcinfo);
+
+        // Repeats folded together by the helper still count as seen packets
+        auto count = std::max<uint32_t>(1, a.count());
+        inc_source_num_packets(count);
+        num_adverts += count;
+
+        packetchain->process_packet(packet);
+    }
 
+    if (num_adverts != 0)
+        get_source_packet_rrd()->add_sample(num_adverts, time(0));
 }
 
 #endif
@@ -26,6 +26,7 @@
 #include "kis_datasource.h"
 
 class kis_datasource_linux_bluetooth;
+class bluetooth_packinfo;
 typedef std::shared_ptr<kis_datasource_linux_bluetooth> shared_datasource_linux_bluetooth;
 
 class kis_datasource_linux_bluetooth : public kis_datasource {
@@ -40,6 +41,13 @@ protected:
     virtual void handle_packet_linuxbtdevice(uint32_t in_seqno, 
                                              const nonstd::string_view& in_content);
 
+    // Batches of raw LE adverts from helpers scanning over HCI
+    virtual void handle_packet_linuxbtadverts(uint32_t in_seqno,
+                                              const nonstd::string_view& in_content);
+
+    // Forge the metablob of a device record
+    std::shared_ptr<packet_metablob> make_bluetooth_metablob(const std::shared_ptr<bluetooth_packinfo>& bpi);
+
     int pack_comp_btdevice, pack_comp_meta;
 };
 
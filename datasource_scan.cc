@@ -16,16 +16,20 @@
     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include "configfile.h"
 #include "datasourcetracker.h"
 #include "datasource_virtual.h"
 #include "datasource_scan.h"
 #include "json_adapter.h"
 
-datasource_scan_source::datasource_scan_source(const std::string& uri, const std::string& source_type,
-        const std::string& json_component_type) :
+datasource_scan_source::datasource_scan_source(const std::string& uri, const std::string& bulk_uri,
+        const std::string& source_type, const std::string& json_component_type) :
     endpoint_uri{uri},
+    bulk_endpoint_uri{bulk_uri},
     virtual_source_type{source_type},
-    json_component_type{json_component_type} {
+    json_component_type{json_component_type},
+    bulk_next_id{1},
+    bulk_shutdown{false} {
 
     packetchain =
         Globalreg::fetch_mandatory_global_as<packet_chain>();
@@ -43,6 +47,12 @@ datasource_scan_source::datasource_scan_source(const std::string& uri, const std
     pack_comp_l1info = 
         packetchain->register_packet_component("RADIODATA");
 
+    bulk_queue_max =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<size_t>("scan_bulk_queue_max", 64);
+
+    auto bulk_limit_kb =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<size_t>("scan_bulk_max_kb", 16384);
+
     auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
 
     httpd->register_route(endpoint_uri, {"POST"}, "scanreport", {},
@@ -50,153 +60,179 @@ datasource_scan_source::datasource_scan_source(const std::string& uri, const std
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
                     return scan_result_endp_handler(con);
                 }));
+
+    httpd->register_route(bulk_endpoint_uri, {"POST"}, "scanreport", {},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return bulk_result_endp_handler(con);
+                }));
+    httpd->set_body_limit(bulk_endpoint_uri, bulk_limit_kb * 1024);
+
+    httpd->register_route(bulk_endpoint_uri + "/status/:batch", {"GET", "POST"}, 
+            std::list<std::string>{"scanreport", httpd->RO_ROLE}, {},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return bulk_status_endp_handler(con);
+                }));
+
+    bulk_thread = std::thread([this]() {
+            thread_set_process_name("scan bulk");
+            bulk_worker();
+        });
 }
 
 datasource_scan_source::~datasource_scan_source() {
+    {
+        std::lock_guard<std::mutex> lk(bulk_mutex);
+        bulk_shutdown = true;
+    }
 
+    bulk_cv.notify_all();
+
+    if (bulk_thread.joinable())
+        bulk_thread.join();
 }
 
-void datasource_scan_source::scan_result_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
-    std::ostream stream(&con->response_stream());
-    std::shared_ptr<kis_packet> packet;
+std::shared_ptr<kis_datasource> datasource_scan_source::fetch_virtual_source(const std::string& in_uuid,
+        const std::string& in_name) {
+    if (in_uuid == "" || in_name == "")
+        throw std::runtime_error("source_uuid and source_name required");
 
-    try {
-        std::shared_ptr<kis_datasource> virtual_source;
+    auto src_uuid = uuid(in_uuid);
 
-        auto uuid_s = con->json().get("source_uuid", "").asString();
-        uuid src_uuid;
-        auto name = con->json().get("source_name", "").asString();
+    if (src_uuid.error)
+        throw std::runtime_error("invalid source uuid");
 
-        if (uuid_s == "" || name == "") {
-            con->set_status(500);
-            stream << "{\"status\": \"source_uuid and source_name required\", \"success\": false}\n";
-            return;
-        }
+    kis_lock_guard<kis_mutex> lk(mutex, "datasource_scan_source fetch_virtual_source");
 
-        if (uuid_s != "") {
-            src_uuid = uuid(uuid_s);
+    // Look up the source by either the uuid provided or the uuid we made based on the name
+    auto virtual_source = datasourcetracker->find_datasource(src_uuid);
 
-            if (src_uuid.error) {
-                con->set_status(500);
-                stream << "{\"status\": \"invalid source uuid\", \"success\": false}\n";
-                return;
-            }
-        }
+    if (virtual_source == nullptr) {
+        auto virtual_builder = Globalreg::fetch_mandatory_global_as<datasource_virtual_builder>();
 
-        if (!con->json()["reports"].isArray()) {
-            con->set_status(500);
-            stream << "{\"status\": \"expected 'reports' array\", \"success\": false}\n";
-        }
+        virtual_source = virtual_builder->build_datasource(virtual_builder);
 
-        // Look up the source by either the uuid provided or the uuid we made based on the name
-        virtual_source = datasourcetracker->find_datasource(src_uuid);
+        auto vs_cast = std::static_pointer_cast<kis_datasource_virtual>(virtual_source);
 
-        if (virtual_source == nullptr) {
-            auto virtual_builder = Globalreg::fetch_mandatory_global_as<datasource_virtual_builder>();
+        vs_cast->set_virtual_hardware(virtual_source_type);
 
-            virtual_source = virtual_builder->build_datasource(virtual_builder);
+        virtual_source->set_source_uuid(src_uuid);
+        virtual_source->set_source_key(adler32_checksum(src_uuid.uuid_to_string()));
+        virtual_source->set_source_name(in_name);
 
-            auto vs_cast = std::static_pointer_cast<kis_datasource_virtual>(virtual_source);
+        datasourcetracker->merge_source(virtual_source);
+    } else {
+        // Update the name
+        virtual_source->set_source_name(in_name);
+    }
 
-            vs_cast->set_virtual_hardware(virtual_source_type);
+    return virtual_source;
+}
 
-            virtual_source->set_source_uuid(src_uuid);
-            virtual_source->set_source_key(adler32_checksum(src_uuid.uuid_to_string()));
-            virtual_source->set_source_name(name);
+void datasource_scan_source::submit_report(const Json::Value& r, std::string in_json,
+        std::shared_ptr<kis_datasource> virtual_source) {
+    if (!validate_report(r)) {
+        throw std::runtime_error("invalid report");
+    }
 
-            datasourcetracker->merge_source(virtual_source);
-        } else {
-            // Update the name
-            virtual_source->set_source_name(name);
-        }
+    // TS is optional
+    uint64_t ts_s = r.get("timestamp", 0).asUInt64();
 
-        for (auto r : con->json()["reports"]) {
-            if (!validate_report(r)) {
-                throw std::runtime_error("invalid report");
-            }
+    auto packet = packetchain->generate_packet();
 
-            // TS is optional
-            uint64_t ts_s = r.get("timestamp", 0).asUInt64();
+    // Timestamp based on packet data, or now
+    if (ts_s != 0) {
+        packet->ts.tv_sec = ts_s;
+        packet->ts.tv_usec = 0;
+    } else {
+        gettimeofday(&packet->ts, nullptr);
+    }
 
-            packet = packetchain->generate_packet();
+    // Re-pack the submitted record into json for this packet
+    auto jsoninfo = std::make_shared<kis_json_packinfo>();
+    jsoninfo->type = json_component_type;
+    jsoninfo->json_string = std::move(in_json);
 
-            // Timestamp based on packet data, or now
-            if (ts_s != 0) {
-                packet->ts.tv_sec = ts_s;
-                packet->ts.tv_usec = 0;
-            } else {
-                gettimeofday(&packet->ts, nullptr);
-            }
+    packet->insert(pack_comp_json, jsoninfo);
 
-            // Re-pack the submitted record into json for this packet
-            auto jsoninfo = std::make_shared<kis_json_packinfo>();
-            jsoninfo->type = json_component_type;
+    auto lat = r.get("lat", 0).asDouble();
+    auto lon = r.get("lon", 0).asDouble();
+    auto alt = r.get("alt", 0).asDouble();
+    auto speed = r.get("speed", 0).asDouble();
 
-            std::stringstream s;
-            s << r;
-            jsoninfo->json_string = s.str();
+    if (lat != 0 && lon != 0) {
+        auto gpsinfo = std::make_shared<kis_gps_packinfo>();
 
-            packet->insert(pack_comp_json, jsoninfo);
+        gpsinfo->lat = lat;
+        gpsinfo->lon = lon;
+        
+        if (alt != 0)
+            gpsinfo->fix = 3;
+        else
+            gpsinfo->fix = 2;
 
-            auto lat = r.get("lat", 0).asDouble();
-            auto lon = r.get("lon", 0).asDouble();
-            auto alt = r.get("alt", 0).asDouble();
-            auto speed = r.get("speed", 0).asDouble();
+        gpsinfo->alt = alt;
+        gpsinfo->speed = speed;
 
-            if (lat != 0 && lon != 0) {
-                auto gpsinfo = std::make_shared<kis_gps_packinfo>();
+        packet->insert(pack_comp_gps, gpsinfo);
+    }
 
-                gpsinfo->lat = lat;
-                gpsinfo->lon = lon;
-                
-                if (alt != 0)
-                    gpsinfo->fix = 3;
-                else
-                    gpsinfo->fix = 2;
+    std::shared_ptr<kis_layer1_packinfo> l1info;
 
-                gpsinfo->alt = alt;
-                gpsinfo->speed = speed;
+    if (!r["signal"].isNull()) {
+        if (l1info == nullptr)
+            l1info = std::make_shared<kis_layer1_packinfo>();
 
-                packet->insert(pack_comp_gps, gpsinfo);
-            }
+        l1info->signal_dbm = r["signal"].asInt();
+        l1info->signal_type = kis_l1_signal_type_dbm;
+    }
 
-            std::shared_ptr<kis_layer1_packinfo> l1info;
+    if (!r["freqkhz"].isNull()) {
+        if (l1info == nullptr)
+            l1info = std::make_shared<kis_layer1_packinfo>();
 
-            if (!r["signal"].isNull()) {
-                if (l1info == nullptr)
-                    l1info = std::make_shared<kis_layer1_packinfo>();
+        l1info->freq_khz = r["freqkhz"].asUInt();
+    }
 
-                l1info->signal_dbm = r["signal"].asInt();
-                l1info->signal_type = kis_l1_signal_type_dbm;
-            }
+    if (!r["channel"].isNull()) {
+        if (l1info == nullptr)
+            l1info = std::make_shared<kis_layer1_packinfo>();
 
-            if (!r["freqkhz"].isNull()) {
-                if (l1info == nullptr)
-                    l1info = std::make_shared<kis_layer1_packinfo>();
+        l1info->channel = r["channel"].asString();
+    }
 
-                l1info->freq_khz = r["freqkhz"].asUInt();
-            }
+    if (l1info != nullptr)
+        packet->insert(pack_comp_l1info, l1info);
 
-            if (!r["channel"].isNull()) {
-                if (l1info == nullptr)
-                    l1info = std::make_shared<kis_layer1_packinfo>();
+    auto srcinfo = std::make_shared<packetchain_comp_datasource>();
+    srcinfo->ref_source = virtual_source.get();
+    packet->insert(pack_comp_datasrc, srcinfo);
 
-                l1info->channel = r["channel"].asString();
-            }
+    packetchain->process_packet(packet);
 
-            if (l1info != nullptr)
-                packet->insert(pack_comp_l1info, l1info);
+    virtual_source->inc_source_num_packets(1);
+}
 
-            auto srcinfo = std::make_shared<packetchain_comp_datasource>();
-            srcinfo->ref_source = virtual_source.get();
-            packet->insert(pack_comp_datasrc, srcinfo);
+void datasource_scan_source::scan_result_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    std::ostream stream(&con->response_stream());
 
-            packetchain->process_packet(packet);
+    try {
+        auto virtual_source = 
+            fetch_virtual_source(con->json().get("source_uuid", "").asString(),
+                    con->json().get("source_name", "").asString());
 
-            // Null out our local packet, it's destroyed by packetchain
-            packet = nullptr;
+        if (!con->json()["reports"].isArray()) {
+            con->set_status(500);
+            stream << "{\"status\": \"expected 'reports' array\", \"success\": false}\n";
+            return;
+        }
 
-            virtual_source->inc_source_num_packets(1);
+        for (auto r : con->json()["reports"]) {
+            std::stringstream s;
+            s << r;
+
+            submit_report(r, s.str(), virtual_source);
         }
 
         stream << "{\"status\": \"Scan report accepted\", \"success\": true}\n";
@@ -212,3 +248,162 @@ void datasource_scan_source::scan_result_endp_handler(std::shared_ptr<kis_net_be
     stream << "{\"status\": \"unhandled request\", \"success\": false}\n";
 }
 
+void datasource_scan_source::bulk_result_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    std::ostream stream(&con->response_stream());
+
+    try {
+        auto uuid_k = con->http_variables().find("source_uuid");
+        auto name_k = con->http_variables().find("source_name");
+
+        auto virtual_source =
+            fetch_virtual_source(uuid_k == con->http_variables().end() ? "" : uuid_k->second,
+                    name_k == con->http_variables().end() ? "" : name_k->second);
+
+        uint64_t id;
+
+        {
+            std::lock_guard<std::mutex> lk(bulk_mutex);
+
+            // Push back on scanners instead of buffering without limit
+            if (bulk_queue.size() >= bulk_queue_max) {
+                con->set_status(503);
+                con->append_header("Retry-After", "1");
+                stream << "{\"status\": \"bulk report queue full\", \"success\": false}\n";
+                return;
+            }
+
+            id = bulk_next_id++;
+
+            bulk_queue.push_back(bulk_batch{id, virtual_source, con->request().body()});
+            bulk_statuses[id] = bulk_status{false, 0, 0, ""};
+
+            while (bulk_statuses.size() > bulk_status_max)
+                bulk_statuses.erase(bulk_statuses.begin());
+        }
+
+        bulk_cv.notify_one();
+
+        con->set_status(202);
+        stream << "{\"status\": \"Scan reports queued\", \"success\": true, \"batch\": " << id << "}\n";
+        return;
+
+    } catch (const std::exception& e) {
+        con->set_status(500);
+        stream << "{\"status\": \"" << e.what() << "\", \"success\": false}\n";
+        return;
+    }
+}
+
+void datasource_scan_source::bulk_status_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    std::ostream stream(&con->response_stream());
+
+    auto id = string_to_n_dfl<uint64_t>(con->uri_params()[":batch"], 0);
+
+    std::lock_guard<std::mutex> lk(bulk_mutex);
+
+    auto si = bulk_statuses.find(id);
+
+    if (si == bulk_statuses.end()) {
+        con->set_status(404);
+        stream << "{\"status\": \"unknown batch\", \"success\": false}\n";
+        return;
+    }
+
+    Json::Value r;
+
+    r["batch"] = Json::Value::UInt64(id);
+    r["complete"] = si->second.complete;
+    r["accepted"] = Json::Value::UInt64(si->second.accepted);
+    r["rejected"] = Json::Value::UInt64(si->second.rejected);
+
+    if (si->second.first_error.length())
+        r["first_error"] = si->second.first_error;
+
+    r["success"] = true;
+
+    stream << r << "\n";
+}
+
+void datasource_scan_source::bulk_worker() {
+    while (true) {
+        bulk_batch batch;
+
+        {
+            std::unique_lock<std::mutex> lk(bulk_mutex);
+
+            bulk_cv.wait(lk, [this]() { return bulk_shutdown || bulk_queue.size() > 0; });
+
+            if (bulk_shutdown)
+                return;
+
+            batch = std::move(bulk_queue.front());
+            bulk_queue.pop_front();
+        }
+
+        bulk_process(batch);
+    }
+}
+
+void datasource_scan_source::bulk_process(bulk_batch& batch) {
+    Json::CharReaderBuilder cbuilder;
+    cbuilder["collectComments"] = false;
+    std::unique_ptr<Json::CharReader> reader(cbuilder.newCharReader());
+
+    uint64_t accepted = 0, rejected = 0;
+    std::string first_error;
+    size_t line_no = 0;
+
+    Json::Value r;
+    std::string errs;
+
+    const char *pos = batch.body.data();
+    const char *end = pos + batch.body.length();
+
+    // Parse one line at a time; only one report is ever held as a json tree
+    while (pos < end) {
+        auto eol = static_cast<const char *>(memchr(pos, '\n', end - pos));
+
+        if (eol == nullptr)
+            eol = end;
+
+        auto line_start = pos;
+        auto line_end = eol;
+
+        pos = eol + 1;
+        line_no++;
+
+        if (line_end > line_start && *(line_end - 1) == '\r')
+            line_end--;
+
+        // Skip blank lines
+        while (line_start < line_end && (*line_start == ' ' || *line_start == '\t'))
+            line_start++;
+
+        if (line_start == line_end)
+            continue;
+
+        try {
+            r = Json::Value();
+
+            if (!reader->parse(line_start, line_end, &r, &errs))
+                throw std::runtime_error(fmt::format("invalid json: {}", errs));
+
+            if (!r.isObject())
+                throw std::runtime_error("expected a report object");
+
+            submit_report(r, std::string(line_start, line_end - line_start), batch.source);
+            accepted++;
+        } catch (const std::exception& e) {
+            if (rejected == 0)
+                first_error = fmt::format("line {}: {}", line_no, e.what());
+            rejected++;
+        }
+    }
+
+    std::lock_guard<std::mutex> lk(bulk_mutex);
+
+    auto si = bulk_statuses.find(batch.id);
+
+    if (si != bulk_statuses.end())
+        si->second = bulk_status{true, accepted, rejected, first_error};
+}
@@ -21,17 +21,30 @@
 
 #include "config.h"
 
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
 #include "globalregistry.h"
 #include "kis_datasource.h"
 #include "kis_net_beast_httpd.h"
 
 // Virtual dot11 datasource which supports scanning results from other systems; scans are turned
 // into dot11 networks with as much info as is available
+//
+// Reports may be posted one JSON object at a time to the scan report endpoint, or in bulk
+// to the bulk report endpoint as newline-delimited JSON, one report per line, with the
+// source named by the source_uuid and source_name URI variables.  Bulk posts are
+// answered as soon as they are queued, with a batch id which can be polled at
+// [bulk uri]/status/[batch]; a single worker per source type parses the queued batches
+// one line at a time and feeds the reports to the packet chain.
 
 class datasource_scan_source {
 public:
-    datasource_scan_source(const std::string& uri, const std::string& source_type, 
-            const std::string& json_component_type);
+    datasource_scan_source(const std::string& uri, const std::string& bulk_uri,
+            const std::string& source_type, const std::string& json_component_type);
 
     virtual ~datasource_scan_source();
 
@@ -39,6 +52,7 @@ protected:
     kis_mutex mutex;
 
     std::string endpoint_uri;
+    std::string bulk_endpoint_uri;
     std::string virtual_source_type;
     std::string json_component_type;
 
@@ -46,6 +60,16 @@ protected:
     std::shared_ptr<packet_chain> packetchain;
 
     void scan_result_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
+    void bulk_result_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
+    void bulk_status_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
+
+    // Find the virtual source for a scanner, or create it; throws on invalid values
+    std::shared_ptr<kis_datasource> fetch_virtual_source(const std::string& in_uuid,
+            const std::string& in_name);
+
+    // Build and submit the packet for one report; in_json is the text of the report
+    void submit_report(const Json::Value& report, std::string in_json,
+            std::shared_ptr<kis_datasource> source);
 
     int pack_comp_common, pack_comp_json, pack_comp_datasrc, pack_comp_gps,
         pack_comp_l1info;
@@ -53,6 +77,34 @@ protected:
     // Validation function; can either return 'false' for generic error, or throw a specific error
     // exception to be returned to the submitter
     bool validate_report(const Json::Value& report) { return true; }
+
+    struct bulk_batch {
+        uint64_t id;
+        std::shared_ptr<kis_datasource> source;
+        std::string body;
+    };
+
+    struct bulk_status {
+        bool complete;
+        uint64_t accepted;
+        uint64_t rejected;
+        std::string first_error;
+    };
+
+    void bulk_worker();
+    void bulk_process(bulk_batch& batch);
+
+    // Queued batches, and the status of the most recent batches; protected by bulk_mutex
+    std::mutex bulk_mutex;
+    std::condition_variable bulk_cv;
+    std::deque<bulk_batch> bulk_queue;
+    std::map<uint64_t, bulk_status> bulk_statuses;
+    uint64_t bulk_next_id;
+    size_t bulk_queue_max;
+    bool bulk_shutdown;
+    std::thread bulk_thread;
+
+    static constexpr size_t bulk_status_max = 256;
 };
 
 #endif /* ifndef DATASOURCE_SCAN_H__ */
@@ -25,6 +25,10 @@
 #include "kis_datasource.h"
 #include "udpserver.h"
 
+// The TZSP listener is not yet part of the build; the UDP datagram server and pollable
+// tracker it was written against are not in the tree, and the receive path is
+// unfinished.
+
 // TZSP per-frame header
 typedef struct {
     uint8_t tzsp_version;
@@ -18,19 +18,32 @@
 
 #include "config.h"
 
+#include <stdio.h>
 #include <string.h>
 #include <getopt.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
 
 #include "alertracker.h"
 #include "base64.h"
+#include "channeltracker2.h"
 #include "configfile.h"
 #include "datasourcetracker.h"
 #include "endian_magic.h"
 #include "globalregistry.h"
 #include "kis_databaselogfile.h"
+#include "kis_endian.h"
 #include "kis_httpd_registry.h"
+#include "kis_spectrum_ring.h"
 #include "messagebus.h"
+#include "packetchain.h"
 #include "pcapng_stream_futurebuf.h"
+#include "remote_announcement.h"
 #include "streamtracker.h"
 #include "timetracker.h"
 
@@ -326,9 +339,17 @@ void datasource_tracker_source_list::list_sources(std::shared_ptr<datasource_tra
 
 datasource_tracker::datasource_tracker() :
     remotecap_enabled{false},
-    remotecap_port{0} {
+    remotecap_port{0},
+    launch_active{0},
+    launch_parallel{8},
+    probe_cache_enabled{false},
+    hop_planner_timer{-1},
+    hop_planner_explore{0.25} {
 
     dst_lock.set_name("datasourcetracker");
+    datagram_lock.set_name("datasourcetracker datagram");
+
+    Globalreg::enable_pool_type<KismetDatasource::DataReport>([](auto *r) { r->Clear(); });
 
     timetracker = Globalreg::fetch_mandatory_global_as<time_tracker>();
     eventbus = Globalreg::fetch_mandatory_global_as<event_bus>();
@@ -367,6 +388,9 @@ datasource_tracker::~datasource_tracker() {
         databaselog_write_datasources();
     }
 
+    if (hop_planner_timer >= 0)
+        timetracker->remove_timer(hop_planner_timer);
+
     for (auto i : probing_map)
         i.second->cancel();
 
@@ -455,6 +479,14 @@ void datasource_tracker::trigger_deferred_startup() {
         config_defaults->set_retry_on_error(true);
     }
 
+    if (Globalreg::globalreg->kismet_config->fetch_opt_bool("channel_hop_adaptive", false)) {
+        _MSG("Sources will weight their channel hopping by recent channel activity", MSGFLAG_INFO);
+        config_defaults->set_adaptive_hop(true);
+    }
+
+    config_defaults->set_adaptive_hop_interval(
+            Globalreg::globalreg->kismet_config->fetch_opt_uint("channel_hop_adaptive_interval", 10));
+
     remotecap_listen = Globalreg::globalreg->kismet_config->fetch_opt("remote_capture_listen");
     remotecap_port = 
         Globalreg::globalreg->kismet_config->fetch_opt_uint("remote_capture_port", 0);
@@ -522,6 +554,30 @@ void datasource_tracker::trigger_deferred_startup() {
         database_log_timer = -1;
     }
 
+    if (Globalreg::globalreg->kismet_config->fetch_opt_bool("channel_hop_planner", false)) {
+        auto interval =
+            Globalreg::globalreg->kismet_config->fetch_opt_uint("channel_hop_planner_interval", 30);
+
+        if (interval == 0)
+            interval = 30;
+
+        hop_planner_explore =
+            Globalreg::globalreg->kismet_config->fetch_opt_as<double>("channel_hop_planner_explore", 0.25);
+
+        if (hop_planner_explore < 0)
+            hop_planner_explore = 0;
+        else if (hop_planner_explore > 1)
+            hop_planner_explore = 1;
+
+        _MSG_INFO("Planning channel hopping from channel activity every {} seconds", interval);
+
+        hop_planner_timer = 
+            timetracker->register_timer(std::chrono::seconds(interval), true, [this](int) -> int {
+                    plan_source_hopping();
+                    return 1;
+                });
+    }
+
 
     // Create an alert for source errors
     auto alertracker = Globalreg::fetch_mandatory_global_as<alert_tracker>("ALERTTRACKER");
@@ -908,8 +964,21 @@ void datasource_tracker::trigger_deferred_startup() {
                     // We use the future stalling function in the pcap future streambuf to hold
                     // this thread in wait until the stream is closed, keeping the http connection
                     // going.  The stream is fed from the packetchain callbacks.
+                    //
+                    // An optional 'filter' variable selects the packets with a filter
+                    // expression, compiled once for the stream
+                    std::function<bool (std::shared_ptr<kis_packet>)> accept = nullptr;
+
+                    auto filter_k = con->http_variables().find("filter");
+                    if (filter_k != con->http_variables().end() && filter_k->second.length()) {
+                        auto filter = packet_filter_program::compile(filter_k->second);
+                        accept = [filter](std::shared_ptr<kis_packet> packet) -> bool {
+                            return filter->match(packet);
+                        };
+                    }
+
                     auto pcapng = std::make_shared<pcapng_stream_packetchain>(con->response_stream(),
-                            nullptr, nullptr,
+                            accept, nullptr,
                             1024*512);
 
                     con->clear_timeout();
@@ -925,7 +994,7 @@ void datasource_tracker::trigger_deferred_startup() {
                     pcapng->block_until_stream_done();
 
                     streamtracker->remove_streamer(sid);
-                }));
+                }, nullptr, nullptr, true));
 
     httpd->register_route("/datasource/pcap/by-uuid/:uuid/packets", {"GET"}, httpd->RO_ROLE, {"pcapng"},
             std::make_shared<kis_net_web_function_endpoint>(
@@ -940,8 +1009,14 @@ void datasource_tracker::trigger_deferred_startup() {
 
                     auto dsnum = ds->get_source_number();
 
+                    std::shared_ptr<packet_filter_program> filter;
+
+                    auto filter_k = con->http_variables().find("filter");
+                    if (filter_k != con->http_variables().end() && filter_k->second.length())
+                        filter = packet_filter_program::compile(filter_k->second);
+
                     auto pcapng = std::make_shared<pcapng_stream_packetchain>(con->response_stream(),
-                            [this, dsnum](std::shared_ptr<kis_packet> packet) -> bool {
+                            [this, dsnum, filter](std::shared_ptr<kis_packet> packet) -> bool {
                                 auto datasrcinfo = packet->fetch<packetchain_comp_datasource>(pack_comp_datasrc);
 
                                 if (datasrcinfo == nullptr)
@@ -950,6 +1025,9 @@ void datasource_tracker::trigger_deferred_startup() {
                                 if (datasrcinfo->ref_source->get_source_number() != dsnum)
                                     return false;
 
+                                if (filter != nullptr && !filter->match(packet))
+                                    return false;
+
                                 return true;
                             },
                             nullptr,
@@ -970,6 +1048,58 @@ void datasource_tracker::trigger_deferred_startup() {
                     pcapng->block_until_stream_done();
 
                     streamtracker->remove_streamer(sid);
+                }, nullptr, nullptr, true));
+
+    httpd->register_websocket_route("/datasource/by-uuid/:uuid/spectrum", httpd->RO_ROLE, {"ws"},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    // Stream binary spectrum frames (see kis_spectrum_ring.h) as the source
+                    // reports them; an optional 'backlog' variable limits how many of the
+                    // most recent frames are sent first, and defaults to the whole ring
+                    auto dsuuid = string_to_n<uuid>(con->uri_params()[":uuid"]);
+                    if (dsuuid.error)
+                        throw std::runtime_error("invalid uuid");
+
+                    auto ds = find_datasource(dsuuid);
+                    if (ds == nullptr)
+                        throw std::runtime_error("no such datasource");
+
+                    size_t backlog = std::numeric_limits<size_t>::max();
+
+                    auto backlog_k = con->http_variables().find("backlog");
+                    if (backlog_k != con->http_variables().end() && backlog_k->second.length())
+                        backlog = string_to_n<size_t>(backlog_k->second);
+
+                    auto ring = ds->get_spectrum_ring();
+
+                    auto ws = 
+                        std::make_shared<kis_net_web_websocket_endpoint>(con, 
+                            [](std::shared_ptr<kis_net_web_websocket_endpoint> ws,
+                                boost::beast::flat_buffer& buf, bool text) {
+                                // Nothing to receive from the client
+                            });
+
+                    ws->binary();
+
+                    // The consumer is only added once the websocket is open, so the
+                    // backlog isn't dropped
+                    unsigned int cid = 0;
+
+                    ws->set_open_cb([ring, backlog, &cid](std::shared_ptr<kis_net_web_websocket_endpoint> ws) {
+                            cid = ring->add_consumer([ws](spectrum_ring::frame_t frame) {
+                                    ws->write(frame);
+                                }, backlog);
+                        });
+
+                    // Blind-catch all errors b/c we must release our consumer at the end
+                    try {
+                        ws->handle_request(con);
+                    } catch (const std::exception& e) {
+                        ;
+                    }
+
+                    if (cid != 0)
+                        ring->remove_consumer(cid);
                 }));
 
     httpd->register_websocket_route("/datasource/remote/remotesource", "datasource", {"ws"},
@@ -1107,16 +1237,49 @@ void datasource_tracker::trigger_deferred_startup() {
         return;
     }
 
-    auto stagger_thresh = 
-        Globalreg::globalreg->kismet_config->fetch_opt_uint("source_stagger_threshold", 16);
-    auto simul_open = 
-        Globalreg::globalreg->kismet_config->fetch_opt_uint("source_launch_group", 10);
-    auto simul_open_delay = 
-        Globalreg::globalreg->kismet_config->fetch_opt_uint("source_launch_delay", 10);
+    launch_parallel =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("source_launch_parallel", 8);
+
+    if (launch_parallel == 0)
+        launch_parallel = src_vec.size();
+
+    probe_cache_enabled =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("source_probe_cache", true);
+
+    if (probe_cache_enabled)
+        load_probe_cache();
+
+    {
+        kis_lock_guard<kis_mutex> lk(launch_lock, "dst startup launch_queue");
+
+        for (const auto& i : src_vec)
+            launch_queue.push_back(i);
+    }
+
+    launch_queued_sources();
+
+    return;
+}
+
+void datasource_tracker::launch_queued_sources() {
+    while (true) {
+        std::string src;
+
+        {
+            kis_lock_guard<kis_mutex> lk(launch_lock, "dst launch_queued_sources");
+
+            if (launch_queue.size() == 0 || launch_active >= launch_parallel)
+                return;
+
+            src = launch_queue.front();
+            launch_queue.pop_front();
+            launch_active++;
+        }
 
-    auto launch_func = [](datasource_tracker *dst, std::string src) {
-            dst->open_datasource(src, 
-                    [src](bool success, std::string reason, shared_datasource) {
+        // Each completed launch frees a slot for the next queued source; completion may
+        // happen immediately, inside open_datasource, if the definition is bad
+        open_datasource(src, 
+                [this, src](bool success, std::string reason, shared_datasource) {
                 if (success) {
                     _MSG_INFO("Data source '{}' launched successfully", src);
                 } else {
@@ -1126,60 +1289,87 @@ void datasource_tracker::trigger_deferred_startup() {
                         _MSG_ERROR("Data source '{}' failed to launch, no error provided.", src);
                     }
                 }
-            });
-    };
 
-    if (stagger_thresh == 0 || src_vec.size() <= stagger_thresh) {
-        auto source_t = std::thread([launch_func](datasource_tracker *dst, 
-                    const std::vector<std::string>& src_vec) {
-                for (auto i : src_vec) {
-                    launch_func(dst, i);
+                {
+                    kis_lock_guard<kis_mutex> lk(launch_lock, "dst launch_queued_sources complete");
+                    launch_active--;
                 }
-                }, this, src_vec);
-        source_t.detach();
-    } else {
-        std::vector<std::string> work_vec;
-        unsigned int group_number = 0;
 
-        for (auto i : src_vec) {
-            work_vec.push_back(i);
+                launch_queued_sources();
+            });
+    }
+}
 
-            if (work_vec.size() > simul_open) {
-                // Pass a copy of the work vec so that we can immediately clear it
-                auto launch_t = std::thread([launch_func, simul_open_delay](datasource_tracker *dst,
-                            const std::vector<std::string> src_vec, unsigned int gn) {
+void datasource_tracker::load_probe_cache() {
+    auto config_dir = 
+        Globalreg::globalreg->kismet_config->expand_log_path(
+                Globalreg::globalreg->kismet_config->fetch_opt("configdir"), "", "", 0, 1);
 
-                    // All the threads launch more or less at once, so each thread sleeps for
-                    // its allocated amount of time before launching the vector
-                    sleep(gn * simul_open_delay);
-                    _MSG_INFO("Launching local source group {}", gn + 1);
+    kis_lock_guard<kis_mutex> lk(probe_cache_lock, "dst load_probe_cache");
 
-                    for (auto i : src_vec) {
-                        launch_func(dst, i);
-                    }
-                }, this, work_vec, group_number);
-                launch_t.detach();
+    probe_cache_path = config_dir + "/source_probe_cache";
+    probe_cache.clear();
 
-                work_vec.clear();
-                group_number++;
-            }
-        }
+    std::ifstream cachef(probe_cache_path);
+    std::string line;
 
-        // Launch the last of the group
-        auto launch_t = std::thread([launch_func, simul_open_delay](datasource_tracker *dst,
-                    const std::vector<std::string> src_vec, unsigned int gn) {
+    // Each line is the interface and the driver type which claimed it, tab separated
+    while (std::getline(cachef, line)) {
+        if (line.length() == 0 || line[0] == '#')
+            continue;
 
-                    sleep(gn * simul_open_delay);
-                    _MSG_INFO("Launching local source group {}", gn);
+        auto tpos = line.find('\t');
 
-                    for (auto i : src_vec) {
-                        launch_func(dst, i);
-                    }
-                }, this, work_vec, group_number);
-                launch_t.detach();
+        if (tpos == std::string::npos || tpos == 0 || tpos == line.length() - 1)
+            continue;
+
+        probe_cache[line.substr(0, tpos)] = line.substr(tpos + 1);
     }
+}
 
-    return;
+void datasource_tracker::update_probe_cache(const std::string& in_interface, 
+        const std::string& in_type) {
+    if (!probe_cache_enabled)
+        return;
+
+    kis_lock_guard<kis_mutex> lk(probe_cache_lock, "dst update_probe_cache");
+
+    auto ci = probe_cache.find(in_interface);
+
+    if (in_type.length() == 0) {
+        if (ci == probe_cache.end())
+            return;
+
+        probe_cache.erase(ci);
+    } else {
+        if (ci != probe_cache.end() && ci->second == in_type)
+            return;
+
+        probe_cache[in_interface] = in_type;
+    }
+
+    // Write a new file and move it over the old one, so a crash never leaves a
+    // partial cache behind
+    auto tmp_path = probe_cache_path + ".tmp";
+
+    {
+        std::ofstream cachef(tmp_path, std::ios::trunc);
+
+        if (!cachef) {
+            _MSG_ERROR("Unable to write the source probe cache '{}'", tmp_path);
+            return;
+        }
+
+        cachef << "# Kismet source probe cache; interfaces and the datasource types which "
+            "claimed them\n";
+
+        for (const auto& c : probe_cache)
+            cachef << c.first << "\t" << c.second << "\n";
+    }
+
+    if (rename(tmp_path.c_str(), probe_cache_path.c_str()) < 0)
+        _MSG_ERROR("Unable to replace the source probe cache '{}': {}", probe_cache_path,
+                kis_strerror_r(errno));
 }
 
 void datasource_tracker::trigger_deferred_shutdown() {
@@ -1245,6 +1435,42 @@ shared_datasource datasource_tracker::find_datasource(const uuid& in_uuid) {
     return nullptr;
 }
 
+void datasource_tracker::register_datagram_source(uint64_t in_token, shared_datasource in_source) {
+    kis_lock_guard<kis_mutex> lk(datagram_lock, "dst register_datagram_source");
+    datagram_map[in_token] = in_source;
+}
+
+void datasource_tracker::remove_datagram_source(uint64_t in_token) {
+    kis_lock_guard<kis_mutex> lk(datagram_lock, "dst remove_datagram_source");
+    datagram_map.erase(in_token);
+}
+
+shared_datasource datasource_tracker::find_datagram_source(uint64_t in_token) {
+    kis_lock_guard<kis_mutex> lk(datagram_lock, "dst find_datagram_source");
+
+    auto di = datagram_map.find(in_token);
+
+    if (di == datagram_map.end())
+        return nullptr;
+
+    return di->second.lock();
+}
+
+size_t datasource_tracker::get_num_running_sources() {
+    kis_lock_guard<kis_mutex> lk(dst_lock, "datasource_tracker get_num_running_sources");
+
+    size_t n = 0;
+
+    for (const auto& i : *datasource_vec) {
+        auto ds = std::static_pointer_cast<kis_datasource>(i);
+
+        if (ds->get_source_running())
+            n++;
+    }
+
+    return n;
+}
+
 bool datasource_tracker::close_datasource(const uuid& in_uuid) {
     kis_lock_guard<kis_mutex> lk(dst_lock, "dst close_datasource");
 
@@ -1359,6 +1585,78 @@ void datasource_tracker::open_datasource(const std::string& in_source,
         return;
     }
 
+    // If an earlier probe found the driver for this interface, try it first
+    std::string cached_type;
+
+    if (probe_cache_enabled) {
+        kis_lock_guard<kis_mutex> lk(probe_cache_lock, "dst open_datasource probe_cache");
+
+        auto ci = probe_cache.find(interface);
+        if (ci != probe_cache.end())
+            cached_type = ci->second;
+    }
+
+    if (cached_type.length() != 0) {
+        kis_unique_lock<kis_mutex> lock(dst_lock, "dst open_datasource cached");
+
+        for (auto i : *proto_vec) {
+            auto proto = std::static_pointer_cast<kis_datasource_builder>(i);
+
+            if (proto->get_source_type() != cached_type)
+                continue;
+
+            if (std::find(auto_masked_types.begin(), auto_masked_types.end(), 
+                        cached_type) != auto_masked_types.end())
+                break;
+
+            lock.unlock();
+            open_cached_datasource(in_source, interface, proto, in_cb);
+            return;
+        }
+    }
+
+    probe_datasource(in_source, interface, in_cb);
+}
+
+void datasource_tracker::open_cached_datasource(const std::string& in_source,
+        const std::string& in_interface, shared_datasource_builder in_proto,
+        const std::function<void (bool, std::string, shared_datasource)>& in_cb) {
+
+    _MSG_INFO("Using cached type '{}' for interface '{}'", in_proto->get_source_type(), 
+            in_interface);
+
+    shared_datasource ds = in_proto->build_datasource(in_proto);
+
+    ds->open_interface(in_source, 0,
+        [this, ds, in_source, in_interface, in_cb] (unsigned int, bool success, 
+            std::string reason) mutable {
+            if (success) {
+                merge_source(ds);
+                in_cb(true, "", ds);
+                return;
+            }
+
+            // The interface may have changed since it was cached; the source was never 
+            // merged, so shut it down for good and probe from scratch
+            _MSG_INFO("Cached type '{}' could not open interface '{}' ({}), probing it "
+                    "again", ds->get_source_builder()->get_source_type(), in_interface, reason);
+
+            ds->disable_source();
+
+            {
+                kis_lock_guard<kis_mutex> lk(dst_lock, "dst open_cached_datasource broken");
+                broken_source_vec.push_back(ds);
+                schedule_cleanup();
+            }
+
+            update_probe_cache(in_interface, "");
+            probe_datasource(in_source, in_interface, in_cb);
+        });
+}
+
+void datasource_tracker::probe_datasource(const std::string& in_source, 
+        const std::string& interface,
+        const std::function<void (bool, std::string, shared_datasource)>& in_cb) {
     // Otherwise we have to initiate a probe, which is async itself, and 
     // tell it to call our CB when it completes.  The probe will find if there 
     // is a driver that can claim the source string we were given, and 
@@ -1395,7 +1693,7 @@ void datasource_tracker::open_datasource(const std::string& in_source,
     }
 
     // Initiate the probe
-    dst_probe->probe_sources([this, probeid, in_cb](shared_datasource_builder builder) {
+    dst_probe->probe_sources([this, probeid, interface, in_cb](shared_datasource_builder builder) {
         // Lock on completion
         kis_unique_lock<kis_mutex> lock(dst_lock, std::defer_lock, "dst probe_sources lambda");
         lock.lock();
@@ -1426,6 +1724,8 @@ void datasource_tracker::open_datasource(const std::string& in_source,
                 // Let go of the lock
                 lock.unlock();
 
+                update_probe_cache(interface, builder->get_source_type());
+
                 // Initiate an open w/ a known builder, associate the prototype definition with it
                 open_datasource(probe_ref->get_definition(), builder, in_cb);
             }
@@ -1887,6 +2187,263 @@ void datasource_tracker::calculate_source_hopping(shared_datasource in_ds) {
     }
 }
 
+// Collect the sources which are hopping and could be re-planned
+class dst_hopplan_worker : public datasource_tracker_worker {
+public:
+    dst_hopplan_worker() { }
+
+    virtual void handle_datasource(shared_datasource in_src) override {
+        if (!in_src->get_source_running() || in_src->get_source_paused() ||
+                !in_src->get_source_hopping())
+            return;
+
+        if (!in_src->get_source_builder()->get_tune_capable() ||
+                !in_src->get_source_builder()->get_hop_capable())
+            return;
+
+        if (!in_src->get_definition_opt_bool("channel_hop", true))
+            return;
+
+        // Sources weighting their own lists are left alone
+        if (in_src->get_source_hop_adaptive())
+            return;
+
+        sources.push_back(in_src);
+    }
+
+    std::vector<shared_datasource> sources;
+};
+
+// Channel activity is recorded by the channel number, while hop lists carry the width
+// as well, such as 6HT40+; named channels are used as-is
+static std::string dst_hopplan_key(const std::string& in_channel) {
+    size_t i = 0;
+
+    while (i < in_channel.length() && isdigit(in_channel[i]))
+        i++;
+
+    if (i == 0)
+        return in_channel;
+
+    return in_channel.substr(0, i);
+}
+
+void datasource_tracker::plan_source_hopping() {
+    auto chantracker = Globalreg::fetch_global_as<channel_tracker_v2>();
+
+    if (chantracker == nullptr)
+        return;
+
+    dst_hopplan_worker worker;
+    iterate_datasources(&worker);
+
+    kis_lock_guard<kis_mutex> lk(hop_planner_lock, "dst plan_source_hopping");
+
+    // Group sources with the same driver and the same base list of channels, in 
+    // source number order so the assignment of lists to sources is stable
+    std::map<std::string, std::vector<std::pair<shared_datasource, std::vector<std::string>>>> groups;
+    std::map<uuid, bool> seen;
+
+    std::sort(worker.sources.begin(), worker.sources.end(), 
+            [](const shared_datasource& a, const shared_datasource& b) {
+                return a->get_source_number() < b->get_source_number();
+            });
+
+    for (const auto& ds : worker.sources) {
+        std::vector<std::string> current;
+
+        for (const auto& c : *ds->get_source_hop_vec())
+            current.push_back(get_tracker_value<std::string>(c));
+
+        if (current.size() == 0)
+            continue;
+
+        auto u = ds->get_source_uuid();
+        seen[u] = true;
+
+        // If the list isn't the one we planned, it's a new base list; the capture may
+        // shuffle the list, so compare them unordered
+        auto sorted_current = current;
+        std::sort(sorted_current.begin(), sorted_current.end());
+
+        auto si = hop_planner_sent.find(u);
+
+        if (si == hop_planner_sent.end() || si->second != sorted_current) {
+            hop_planner_base[u] = current;
+            hop_planner_sent.erase(u);
+        }
+
+        auto sorted_base = hop_planner_base[u];
+        std::sort(sorted_base.begin(), sorted_base.end());
+
+        auto group_key = ds->get_source_builder()->get_source_type();
+        for (const auto& c : sorted_base)
+            group_key += "," + c;
+
+        groups[group_key].push_back(std::make_pair(ds, current));
+    }
+
+    // Forget sources which have gone away
+    for (auto bi = hop_planner_base.begin(); bi != hop_planner_base.end(); ) {
+        if (seen.find(bi->first) == seen.end()) {
+            hop_planner_sent.erase(bi->first);
+            bi = hop_planner_base.erase(bi);
+        } else {
+            ++bi;
+        }
+    }
+
+    for (const auto& g : groups) {
+        const auto& members = g.second;
+        auto type = members[0].first->get_source_builder()->get_source_type();
+        auto base = hop_planner_base[members[0].first->get_source_uuid()];
+
+        size_t nradios = members.size();
+        size_t nchans = base.size();
+
+        // More radios than channels can't be spread any further than the split does
+        if (nradios > nchans)
+            continue;
+
+        // How much of a radio each channel had since the last plan; what we saw on a
+        // channel depends on how long we listened to it
+        std::map<std::string, double> coverage;
+
+        for (const auto& m : members) {
+            for (const auto& c : m.second)
+                coverage[dst_hopplan_key(c)] += 1.0f / m.second.size();
+        }
+
+        std::map<std::string, unsigned int> key_entries;
+        for (const auto& c : base)
+            key_entries[dst_hopplan_key(c)]++;
+
+        double total_packets = 0, total_devices = 0;
+
+        for (const auto& k : key_entries) {
+            double packets = 0, devices = 0;
+
+            chantracker->get_channel_activity(k.first, packets, devices);
+
+            auto cov = std::max(coverage[k.first], 0.05);
+            packets /= cov;
+            devices /= cov;
+
+            // Smooth against the last plan so schedules change gradually
+            auto& act = hop_planner_activity[type + "/" + k.first];
+            act.first = (act.first + packets) / 2;
+            act.second = (act.second + devices) / 2;
+
+            total_packets += act.first;
+            total_devices += act.second;
+        }
+
+        // Each radio hops through twice as many slots as there are channels, so every
+        // channel keeps at least one slot and the rest go to the busiest channels, up
+        // to one radio's worth of time per channel
+        size_t radio_slots = nchans * 2;
+        size_t total_slots = radio_slots * nradios;
+        size_t spare = total_slots - nchans;
+
+        std::vector<double> want(nchans);
+        std::vector<size_t> slots(nchans, 1);
+
+        for (size_t i = 0; i < nchans; i++) {
+            auto key = dst_hopplan_key(base[i]);
+            const auto& act = hop_planner_activity[type + "/" + key];
+            double share = 0;
+
+            if (total_packets > 0 && total_devices > 0)
+                share = (act.first / total_packets + act.second / total_devices) / 2;
+            else if (total_packets > 0)
+                share = act.first / total_packets;
+            else if (total_devices > 0)
+                share = act.second / total_devices;
+            else
+                share = 1.0f / key_entries.size();
+
+            share /= key_entries[key];
+
+            want[i] = spare * (hop_planner_explore / nchans + (1 - hop_planner_explore) * share);
+        }
+
+        // Hand out whole slots, then the remainders to the largest fractions
+        size_t assigned = 0;
+
+        for (size_t i = 0; i < nchans; i++) {
+            auto w = std::min((size_t) want[i], radio_slots - 1);
+            slots[i] += w;
+            want[i] -= w;
+            assigned += w;
+        }
+
+        while (assigned < spare) {
+            size_t best = nchans;
+
+            for (size_t i = 0; i < nchans; i++) {
+                if (slots[i] >= radio_slots)
+                    continue;
+
+                if (best == nchans || want[best] < want[i])
+                    best = i;
+            }
+
+            if (best == nchans)
+                break;
+
+            slots[best]++;
+            want[best] = -1;
+            assigned++;
+
+            // Everyone got a remainder; start a new round
+            if (std::all_of(want.begin(), want.end(), [](double v) { return v < 0; })) {
+                for (size_t i = 0; i < nchans; i++)
+                    want[i] = 0;
+            }
+        }
+
+        // Interleave the slots with a smooth weighted round robin so each channel's
+        // slots are spread evenly, then deal them out across the radios
+        std::vector<std::vector<std::string>> plans(nradios);
+        std::vector<long> current_weight(nchans, 0);
+
+        for (size_t pos = 0; pos < total_slots; pos++) {
+            size_t pick = 0;
+
+            for (size_t i = 0; i < nchans; i++) {
+                current_weight[i] += slots[i];
+
+                if (current_weight[i] > current_weight[pick])
+                    pick = i;
+            }
+
+            current_weight[pick] -= total_slots;
+            plans[pos % nradios].push_back(base[pick]);
+        }
+
+        bool changed = false;
+
+        for (size_t r = 0; r < nradios; r++) {
+            const auto& ds = members[r].first;
+
+            if (plans[r] == members[r].second)
+                continue;
+
+            auto sorted_plan = plans[r];
+            std::sort(sorted_plan.begin(), sorted_plan.end());
+            hop_planner_sent[ds->get_source_uuid()] = sorted_plan;
+
+            ds->set_channel_hop(ds->get_source_hop_rate(), plans[r], false, 0, 0, NULL);
+
+            changed = true;
+        }
+
+        if (changed)
+            _MSG_INFO("Re-planned channel hopping for {} '{}' source(s) from channel activity",
+                    nradios, type);
+    }
+}
+
 double datasource_tracker::string_to_rate(std::string in_str, double in_default) {
     double v, dv;
 
@@ -2013,6 +2570,152 @@ void datasource_tracker_remote_server::stop() {
             ;
         }
     }
+
+    if (load_socket.is_open()) {
+        try {
+            load_socket.cancel();
+            load_socket.close();
+        } catch (const std::exception& e) {
+            ;
+        }
+    }
+}
+
+void datasource_tracker_remote_server::start_load(const tcp::endpoint& endpoint) {
+    // Load queries are optional; helpers with a single server never send them
+    try {
+        auto ep = boost::asio::ip::udp::endpoint(endpoint.address(), endpoint.port());
+        load_socket.open(ep.protocol());
+        load_socket.set_option(boost::asio::socket_base::reuse_address(true));
+        load_socket.bind(ep);
+    } catch (const std::exception& e) {
+        _MSG_ERROR("Could not open the remote capture load query socket, remote capture "
+                "helpers will not be able to balance across servers: {}", e.what());
+        return;
+    }
+
+    start_load_receive();
+}
+
+void datasource_tracker_remote_server::start_load_receive() {
+    if (stopped)
+        return;
+
+    load_socket.async_receive_from(boost::asio::buffer(load_buf), load_peer,
+            [this](const boost::system::error_code& ec, size_t sz) {
+                if (stopped)
+                    return;
+
+                // Load queries and packet datagrams share the socket
+                if (!ec && sz >= sizeof(uint64_t)) {
+                    uint64_t tag;
+                    memcpy(&tag, load_buf.data(), sizeof(uint64_t));
+
+                    if (be64toh(tag) == REMOTE_LOAD_TAG)
+                        handle_load_query(sz);
+                    else if (be64toh(tag) == REMOTE_DATAGRAM_TAG)
+                        handle_datagram(sz);
+                }
+
+                if (ec == boost::asio::error::operation_aborted)
+                    return;
+
+                start_load_receive();
+            });
+}
+
+uint32_t datasource_tracker_remote_server::update_load_cpu() {
+    struct rusage ru;
+    struct timeval tv;
+
+    if (getrusage(RUSAGE_SELF, &ru) < 0)
+        return load_cpu_permille;
+
+    gettimeofday(&tv, nullptr);
+
+    uint64_t cpu_usec = 
+        (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL +
+        ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+    uint64_t wall_usec = tv.tv_sec * 1000000ULL + tv.tv_usec;
+
+    if (load_last_wall_usec == 0) {
+        load_last_cpu_usec = cpu_usec;
+        load_last_wall_usec = wall_usec;
+        return load_cpu_permille;
+    }
+
+    if (wall_usec - load_last_wall_usec < 1000000)
+        return load_cpu_permille;
+
+    load_cpu_permille = 
+        (uint32_t) (((cpu_usec - load_last_cpu_usec) * 1000) / (wall_usec - load_last_wall_usec));
+
+    load_last_cpu_usec = cpu_usec;
+    load_last_wall_usec = wall_usec;
+
+    return load_cpu_permille;
+}
+
+void datasource_tracker_remote_server::handle_load_query(size_t in_sz) {
+    if (in_sz < sizeof(kismet_remote_load_query))
+        return;
+
+    auto query = reinterpret_cast<const kismet_remote_load_query *>(load_buf.data());
+
+    if (be64toh(query->tag) != REMOTE_LOAD_TAG || 
+            be16toh(query->load_version) != REMOTE_LOAD_VERSION)
+        return;
+
+    kismet_remote_load_report report;
+    memset(&report, 0, sizeof(kismet_remote_load_report));
+
+    report.tag = htobe64(REMOTE_LOAD_TAG);
+    report.load_version = htobe16(REMOTE_LOAD_VERSION);
+    report.nonce = query->nonce;
+
+    auto packetchain = Globalreg::globalreg->packetchain;
+
+    if (packetchain != nullptr) {
+        report.packet_backlog = htobe32((uint32_t) std::max((int64_t) 0, packetchain->get_packets_backlog()));
+        report.packet_backlog_limit = htobe32(packetchain->get_packets_backlog_limit());
+    }
+
+    report.cpu_permille = htobe32(update_load_cpu());
+
+    auto ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    report.num_cpus = htobe16((uint16_t) (ncpus > 0 ? ncpus : 1));
+
+    report.num_sources = htobe32((uint32_t) datasourcetracker->get_num_running_sources());
+
+    auto uuid_str = Globalreg::globalreg->server_uuid->get().as_string();
+
+    if (uuid_str.length() == 36)
+        memcpy(report.uuid, uuid_str.c_str(), 36);
+
+    boost::system::error_code ec;
+    load_socket.send_to(boost::asio::buffer(&report, sizeof(kismet_remote_load_report)),
+            load_peer, 0, ec);
+}
+
+void datasource_tracker_remote_server::handle_datagram(size_t in_sz) {
+    if (in_sz < sizeof(kismet_remote_datagram))
+        return;
+
+    auto dgram = reinterpret_cast<const kismet_remote_datagram *>(load_buf.data());
+
+    if (be16toh(dgram->datagram_version) != REMOTE_DATAGRAM_VERSION)
+        return;
+
+    auto ds = datasourcetracker->find_datagram_source(be64toh(dgram->token));
+
+    if (ds == nullptr)
+        return;
+
+    // The buffer is reused by the next receive, so the frame is copied for the source
+    auto frame = std::make_shared<std::string>(load_buf.data() + sizeof(kismet_remote_datagram),
+            in_sz - sizeof(kismet_remote_datagram));
+
+    ds->handle_datagram(load_peer.address(), be32toh(dgram->seqno), frame);
 }
 
 void datasource_tracker_remote_server::start_accept() {
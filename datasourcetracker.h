@@ -21,11 +21,14 @@
 
 #include "config.h"
 
+#include <array>
 #include <atomic>
+#include <deque>
 #include <string>
 #include <vector>
 #include <map>
 #include <functional>
+#include <unordered_map>
 
 #include "globalregistry.h"
 #include "util.h"
@@ -40,6 +43,7 @@
 #include "eventbus.h"
 #include "messagebus.h"
 #include "streamtracker.h"
+#include "remote_announcement.h"
 
 /* Data source tracker
  *
@@ -235,6 +239,8 @@ public:
     __Proxy(split_same_sources, uint8_t, bool, bool, split_same_sources);
     __Proxy(random_channel_order, uint8_t, bool, bool, random_channel_order);
     __Proxy(retry_on_error, uint8_t, bool, bool, retry_on_error);
+    __Proxy(adaptive_hop, uint8_t, bool, bool, adaptive_hop);
+    __Proxy(adaptive_hop_interval, uint32_t, unsigned int, unsigned int, adaptive_hop_interval);
 
     __Proxy(remote_cap_listen, std::string, std::string, std::string, remote_cap_listen);
     __Proxy(remote_cap_port, uint32_t, uint32_t, uint32_t, remote_cap_port);
@@ -257,6 +263,10 @@ protected:
                 &random_channel_order);
         register_field("kismet.datasourcetracker.default.retry_on_error", 
                 "re-open sources if an error occurs", &retry_on_error);
+        register_field("kismet.datasourcetracker.default.adaptive_hop",
+                "weight hop lists by recent channel discoveries", &adaptive_hop);
+        register_field("kismet.datasourcetracker.default.adaptive_hop_interval",
+                "seconds between adaptive hop list updates", &adaptive_hop_interval);
 
         register_field("kismet.datasourcetracker.default.remote_cap_listen", 
                 "listen address for remote capture",
@@ -285,6 +295,10 @@ protected:
     // Boolean, do we retry on errors?
     std::shared_ptr<tracker_element_uint8> retry_on_error;
 
+    // Boolean, do we weight the hop list by activity, and how often do we update it
+    std::shared_ptr<tracker_element_uint8> adaptive_hop;
+    std::shared_ptr<tracker_element_uint32> adaptive_hop_interval;
+
     // Remote listen
     std::shared_ptr<tracker_element_string> remote_cap_listen;
     std::shared_ptr<tracker_element_uint32> remote_cap_port;
@@ -359,6 +373,12 @@ public:
     // Find a datasource
     shared_datasource find_datasource(const uuid& in_uuid);
 
+    // Route remote capture datagrams (see remote_announcement.h) to the source which
+    // offered the token in KDSOPENSOURCE
+    void register_datagram_source(uint64_t in_token, shared_datasource in_source);
+    void remove_datagram_source(uint64_t in_token);
+    shared_datasource find_datagram_source(uint64_t in_token);
+
     // List potential sources
     //
     // Optional completion function will be called with list of possible sources.
@@ -390,6 +410,9 @@ public:
         return remotecap_listen;
     }
 
+    // Number of running datasources
+    size_t get_num_running_sources();
+
 protected:
     // Log the datasources
     virtual void databaselog_write_datasources();
@@ -407,6 +430,10 @@ protected:
 
     kis_mutex dst_lock;
 
+    // Datagram tokens of remote sources; sources remove themselves when deleted
+    kis_mutex datagram_lock;
+    std::unordered_map<uint64_t, std::weak_ptr<kis_datasource>> datagram_map;
+
     int pack_comp_datasrc;
 
     int proto_id;
@@ -422,6 +449,34 @@ protected:
     std::map<unsigned int, shared_dst_source_probe> probing_map;
     std::atomic<unsigned int> next_probe_id;
 
+    // Probe an auto type source definition and open it with whatever driver claims it
+    void probe_datasource(const std::string& in_source, const std::string& in_interface,
+            const std::function<void (bool, std::string, shared_datasource)>& in_cb);
+
+    // Open an auto type source with the driver type cached from an earlier probe, falling
+    // back to a full probe if it no longer opens
+    void open_cached_datasource(const std::string& in_source, const std::string& in_interface,
+            shared_datasource_builder in_proto,
+            const std::function<void (bool, std::string, shared_datasource)>& in_cb);
+
+    // Startup sources waiting for a launch slot; at most launch_parallel sources are
+    // probed and opened at once
+    kis_mutex launch_lock;
+    std::deque<std::string> launch_queue;
+    unsigned int launch_active;
+    unsigned int launch_parallel;
+    void launch_queued_sources();
+
+    // Interface to driver type map from earlier probes, saved in the config dir so a
+    // restart can skip probing known interfaces
+    kis_mutex probe_cache_lock;
+    bool probe_cache_enabled;
+    std::string probe_cache_path;
+    std::map<std::string, std::string> probe_cache;
+    void load_probe_cache();
+    // Set or, with an empty type, remove an interface and rewrite the cache file
+    void update_probe_cache(const std::string& in_interface, const std::string& in_type);
+
     // Masked datasource types that won't be used for scan or autoprobing,
     // for systems where python takes so long to load it causes problems
     std::vector<std::string> auto_masked_types;
@@ -454,6 +509,18 @@ protected:
     // and want to do channel split
     void calculate_source_hopping(shared_datasource in_ds);
 
+    // Activity based hop planning: hopping sources sharing a driver and channel list
+    // share a weighted schedule which gives busier channels more dwell time.  The base
+    // list of each source, and the list we last planned for it, are kept so that lists
+    // changed by the user are picked up as the new base.
+    kis_mutex hop_planner_lock;
+    int hop_planner_timer;
+    double hop_planner_explore;
+    std::map<std::string, std::pair<double, double>> hop_planner_activity;
+    std::map<uuid, std::vector<std::string>> hop_planner_base;
+    std::map<uuid, std::vector<std::string>> hop_planner_sent;
+    void plan_source_hopping();
+
     // Datasource logging
     int database_log_timer;
     bool database_log_enabled;
@@ -513,15 +580,25 @@ protected:
 
 // Remote capture server helper, we need to instantiate this outside of the main dst instance, and we
 // may make multiple copies of it for different types of endpoint
+//
+// The server also answers remote capture load queries (see remote_announcement.h) over
+// UDP on the same address and port, so helpers given several servers can pick the
+// least loaded one, and receives the packet datagrams of remote sources which were
+// offered datagram transport
 class datasource_tracker_remote_server {
 public:
     datasource_tracker_remote_server(const tcp::endpoint& endpoint) :
         stopped{false},
         acceptor{Globalreg::globalreg->io, endpoint},
-        incoming_socket{Globalreg::globalreg->io} {
+        incoming_socket{Globalreg::globalreg->io},
+        load_socket{Globalreg::globalreg->io},
+        load_cpu_permille{0},
+        load_last_cpu_usec{0},
+        load_last_wall_usec{0} {
         acceptor.set_option(boost::asio::socket_base::reuse_address(true));
         datasourcetracker = Globalreg::fetch_mandatory_global_as<datasource_tracker>();
         start_accept();
+        start_load(endpoint);
     }
 
     virtual ~datasource_tracker_remote_server();
@@ -532,10 +609,25 @@ public:
     void handle_accept(const boost::system::error_code& ec, tcp::socket socket);
 
 protected:
+    void start_load(const tcp::endpoint& endpoint);
+    void start_load_receive();
+    void handle_load_query(size_t in_sz);
+    void handle_datagram(size_t in_sz);
+
+    // Process CPU use since the last query, at most once a second
+    uint32_t update_load_cpu();
+
     std::atomic<bool> stopped;
     tcp::acceptor acceptor;
     tcp::socket incoming_socket;
     std::shared_ptr<datasource_tracker> datasourcetracker;
+
+    boost::asio::ip::udp::socket load_socket;
+    boost::asio::ip::udp::endpoint load_peer;
+    std::array<char, REMOTE_DATAGRAM_MAX_SZ> load_buf;
+
+    uint32_t load_cpu_permille;
+    uint64_t load_last_cpu_usec, load_last_wall_usec;
 };
 
 
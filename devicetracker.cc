@@ -28,12 +28,9 @@
 
 #include "kismet_algorithm.h"
 
-#ifdef HAVE_CPP17_PARALLEL
-#include <execution>
-#endif
-
 #include <string>
 #include <sstream>
+#include <thread>
 
 #include "alertracker.h"
 #include "base64.h"
@@ -53,6 +50,7 @@
 #include "packet.h"
 #include "packetchain.h"
 #include "pcapng_stream_futurebuf.h"
+#include "trackedelement_codec.h"
 #include "util.h"
 #include "zstr.hpp"
 
@@ -71,6 +69,14 @@ device_tracker::device_tracker() :
     // create a vector
     immutable_tracked_vec = std::make_shared<tracker_element_vector>();
 
+    n_tracked_devices = 0;
+
+    device_mod_seq = 0;
+
+    pressure_idle_expiration = 0;
+    pressure_no_rrd = false;
+    pressure_sketch = false;
+
     entrytracker =
         Globalreg::fetch_mandatory_global_as<entry_tracker>();
 
@@ -164,7 +170,7 @@ device_tracker::device_tracker() :
     packetchain_common_id = 
         packetchain->register_handler([this](std::shared_ptr<kis_packet> in_packet) -> int {
                 return common_tracker(in_packet);
-            }, CHAINPOS_TRACKER, -100);
+            }, CHAINPOS_TRACKER, -100, "device_tracker common_tracker");
 
 
     // Post any events related to the device generated during tracking mode
@@ -174,10 +180,48 @@ device_tracker::device_tracker() :
     // phy-specific attachments.
     packetchain_tracking_done_id =
         packetchain->register_handler([this](std::shared_ptr<kis_packet> in_packet) -> int {
+            // Stamp the devices once the entire tracker chain has finished with them, so
+            // that a client syncing by sequence sees every change from this packet
+            auto devinfo = in_packet->fetch<kis_tracked_device_info>(pack_comp_device);
+
+            if (devinfo != nullptr) {
+                kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "device_tracker tracking_done");
+
+                for (const auto& d : devinfo->devrefs)
+                    stamp_device_modified(d.second);
+            }
+
+            // Let sources with adaptive hopping know what this packet found on its channel
+            auto datasrc = in_packet->fetch<packetchain_comp_datasource>(pack_comp_datasrc);
+
+            if (datasrc != nullptr && datasrc->ref_source != nullptr && 
+                    datasrc->ref_source->get_source_hop_adaptive()) {
+                auto common = in_packet->fetch<kis_common_info>(pack_comp_common);
+                auto l1info = in_packet->fetch<kis_layer1_packinfo>(pack_comp_radiodata);
+
+                std::string channel;
+
+                if (common != nullptr && common->channel != "0" && common->channel != "")
+                    channel = common->channel;
+                else if (l1info != nullptr && l1info->channel != "0" && l1info->channel != "")
+                    channel = l1info->channel;
+
+                if (channel.length() != 0) {
+                    unsigned int new_devices = 0;
+
+                    for (const auto& e : in_packet->process_complete_events) {
+                        if (e->get_event_id() == event_new_device())
+                            new_devices++;
+                    }
+
+                    datasrc->ref_source->record_channel_activity(channel, 1, new_devices);
+                }
+            }
+
             for (const auto& e : in_packet->process_complete_events)
                 eventbus->publish(e);
             return 1;
-        }, CHAINPOS_TRACKER, 0x7FFFFFFF);
+        }, CHAINPOS_TRACKER, 0x7FFFFFFF, "device_tracker tracking_done");
 
     if (!Globalreg::globalreg->kismet_config->fetch_opt_bool("track_device_rrds", true)) {
         _MSG("Not tracking historical packet data to save RAM", MSGFLAG_INFO);
@@ -250,14 +294,28 @@ device_tracker::device_tracker() :
 
     immutable_tracked_vec->reserve(preload_sz);
 
+    // Number of threads read-only view workers may split large views across
+    view_work_threads =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("tracker_view_threads", 0);
+    if (view_work_threads == 0)
+        view_work_threads = std::max(1U, std::thread::hardware_concurrency());
+
+    view_cache_ms =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("tracker_view_cache_ms", 1000);
+
+    view_search_index =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("tracker_view_search_index", true);
+
+    view_tile_cluster_zoom =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("tracker_view_tile_cluster_zoom", 10);
+
     // Set up the device timeout
     device_idle_expiration =
         Globalreg::globalreg->kismet_config->fetch_opt_int("tracker_device_timeout", 0);
+    device_idle_min_packets =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("tracker_device_packets", 0);
 
     if (device_idle_expiration != 0) {
-        device_idle_min_packets =
-            Globalreg::globalreg->kismet_config->fetch_opt_uint("tracker_device_packets", 0);
-
         std::stringstream ss;
         ss << "Removing tracked devices which have been inactive for more than " <<
             device_idle_expiration << " seconds";
@@ -266,18 +324,17 @@ device_tracker::device_tracker() :
             ss << " and fewer than " << device_idle_min_packets << " packets";
 
         _MSG(ss.str(), MSGFLAG_INFO);
-
-		// Schedule device idle reaping every minute
-        device_idle_timer =
-            timetracker->register_timer(std::chrono::seconds(60), 1,
-                [this](int eventid) -> int {
-                    timetracker_event(eventid);
-                    return 1;
-                });
-    } else {
-        device_idle_timer = -1;
     }
 
+    // Schedule device idle reaping every minute; with no timeout configured the timer
+    // only does work while the memory governor shortens it
+    device_idle_timer =
+        timetracker->register_timer(std::chrono::seconds(60), 1,
+            [this](int eventid) -> int {
+                timetracker_event(eventid);
+                return 1;
+            });
+
 	max_num_devices =
 		Globalreg::globalreg->kismet_config->fetch_opt_uint("tracker_max_devices", 0);
 
@@ -304,10 +361,73 @@ device_tracker::device_tracker() :
     track_history_cloud =
         Globalreg::globalreg->kismet_config->fetch_opt_bool("keep_location_cloud_history", false);
 
+    track_location_trail =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("keep_location_trail", false);
+
+    if (track_location_trail) {
+        auto& tp = kis_location_trail::params;
+
+        tp.min_distance = 
+            Globalreg::globalreg->kismet_config->fetch_opt_as<double>("location_trail_distance", 
+                    tp.min_distance);
+        tp.min_interval = 
+            Globalreg::globalreg->kismet_config->fetch_opt_as<time_t>("location_trail_min_time", 
+                    tp.min_interval);
+        tp.max_interval = 
+            Globalreg::globalreg->kismet_config->fetch_opt_as<time_t>("location_trail_max_time", 
+                    tp.max_interval);
+        tp.tolerance = 
+            Globalreg::globalreg->kismet_config->fetch_opt_as<double>("location_trail_tolerance", 
+                    tp.tolerance);
+        tp.max_points = 
+            std::max((size_t) 4, Globalreg::globalreg->kismet_config->fetch_opt_as<size_t>(
+                        "location_trail_points", tp.max_points));
+    }
+
+    device_spill_timeout =
+        Globalreg::globalreg->kismet_config->fetch_opt_int("tracker_spill_timeout", 0);
+
+    device_arena =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("tracker_device_arena", true);
+
+    spill_db = nullptr;
+    spill_insert_stmt = spill_select_stmt = spill_delete_stmt = nullptr;
+
+    if (device_spill_timeout > 0) {
+        spill_open();
+
+        if (spill_db != nullptr) {
+            _MSG_INFO("Spilling the records of devices which have been inactive for more "
+                    "than {} seconds to {}", device_spill_timeout, spill_dbfile);
+
+            // Spilled records are freed one at a time, which an arena can't do
+            if (device_arena) {
+                _MSG_INFO("Device record arenas (tracker_device_arena) are disabled while "
+                        "spilling devices.");
+                device_arena = false;
+            }
+
+            device_spill_timer =
+                timetracker->register_timer(std::chrono::seconds(60), 1,
+                        [this](int) -> int {
+                            spill_idle_devices();
+                            return 1;
+                        });
+        } else {
+            device_spill_timer = -1;
+        }
+    } else {
+        device_spill_timer = -1;
+    }
+
     if (track_history_cloud)
         _MSG_INFO("Location history cloud tracking enabled; this may use more RAM.  To "
                   "save RAM, set keep_location_cloud_history=false");
 
+    if (track_location_trail)
+        _MSG_INFO("Keeping a location trail of up to {} points per device", 
+                kis_location_trail::params.max_points);
+
     // Initialize the view system
     view_vec = std::make_shared<tracker_element_vector>();
 
@@ -320,27 +440,41 @@ device_tracker::device_tracker() :
             std::make_shared<kis_net_web_tracked_endpoint>(
                 [this](shared_con con) -> std::shared_ptr<tracker_element> {
                     return multimac_endp_handler(con);
-                }, get_devicelist_mutex()));
+                }));
 
     httpd->register_route("/devices/multikey/devices", {"POST"}, httpd->RO_ROLE, {},
             std::make_shared<kis_net_web_tracked_endpoint>(
                 [this](shared_con con) -> std::shared_ptr<tracker_element> {
                     return multikey_endp_handler(con, false);
-                }, get_devicelist_mutex()));
+                }));
 
     httpd->register_route("/devices/multikey/as-object/devices", {"POST"}, httpd->RO_ROLE, {},
             std::make_shared<kis_net_web_tracked_endpoint>(
                 [this](shared_con con) -> std::shared_ptr<tracker_element> {
                     return multikey_endp_handler(con, true);
-                }, get_devicelist_mutex()));
+                }));
 
-    httpd->register_route("/devices/all_devices", {"GET", "POST"}, httpd->RO_ROLE, {"ekjson", "itjson"},
-            std::make_shared<kis_net_web_tracked_endpoint>(
-                [this](shared_con con) -> std::shared_ptr<tracker_element> {
-                    auto device_ro = std::make_shared<tracker_element_vector>();
-                    device_ro->set(immutable_tracked_vec->begin(), immutable_tracked_vec->end());
-                    return device_ro;
-                }, get_devicelist_mutex()));
+    // All devices is streamed a device at a time; only the list of device references is
+    // copied, and each device is serialized from a snapshot without the devicelist lock
+    httpd->register_route("/devices/all_devices", {"GET", "POST"}, httpd->RO_ROLE, 
+            {"ekjson", "itjson", "msgpack", "dmsgpack"},
+            std::make_shared<kis_net_web_streamed_endpoint>(
+                [this](shared_con con, const kis_net_web_streamed_endpoint::emit_func_t& emit) {
+                    auto device_ro = std::vector<std::shared_ptr<tracker_element>>{};
+
+                    {
+                        kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "all_devices snapshot");
+                        device_ro.assign(immutable_tracked_vec->begin(), immutable_tracked_vec->end());
+                    }
+
+                    for (const auto& d : device_ro) {
+                        if (d == nullptr)
+                            continue;
+
+                        if (!emit(snapshot_device(std::static_pointer_cast<kis_tracked_device_base>(d))))
+                            break;
+                    }
+                }));
 
     httpd->register_route("/devices/by-key/:key/device", {"GET", "POST"}, httpd->RO_ROLE, {},
             std::make_shared<kis_net_web_tracked_endpoint>(
@@ -356,8 +490,8 @@ device_tracker::device_tracker() :
                     if (dev == nullptr)
                         throw std::runtime_error("nonexistent device key");
 
-                    return dev;
-                }, get_devicelist_mutex()));
+                    return snapshot_device(dev);
+                }));
 
     httpd->register_route("/devices/by-mac/:mac/devices", {"GET", "POST"}, httpd->RO_ROLE, {},
             std::make_shared<kis_net_web_tracked_endpoint>(
@@ -370,12 +504,11 @@ device_tracker::device_tracker() :
 
                     auto devvec = std::make_shared<tracker_element_vector>();
 
-                    const auto mmp = tracked_mac_multimap.equal_range(mac);
-                    for (auto mmpi = mmp.first; mmpi != mmp.second; ++mmpi)
-                        devvec->push_back(mmpi->second);
+                    for (const auto& d : fetch_devices(mac))
+                        devvec->push_back(snapshot_device(d));
 
                     return devvec;
-                }, get_devicelist_mutex()));
+                }));
 
     httpd->register_route("/devices/last-time/:timestamp/devices", {"GET", "POST"}, httpd->RO_ROLE, {},
             std::make_shared<kis_net_web_tracked_endpoint>(
@@ -398,8 +531,8 @@ device_tracker::device_tracker() :
                             return true;
                         });
 
-                    return do_readonly_device_work(ts_worker);
-                }, get_devicelist_mutex()));
+                    return snapshot_devices(do_readonly_device_work(ts_worker));
+                }));
 
     httpd->register_route("/devices/by-key/:key/set_name", {"POST"}, httpd->LOGON_ROLE, {"cmd"},
             std::make_shared<kis_net_web_function_endpoint>(
@@ -446,6 +579,40 @@ device_tracker::device_tracker() :
                     os << "Device tag set\n";
                 }, get_devicelist_mutex()));
 
+    httpd->register_route("/devices/by-key/:key/location_trail", {"GET"}, httpd->RO_ROLE, {"json"},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](shared_con con) {
+                    auto key_k = con->uri_params().find(":key");
+                    auto devkey = string_to_n<device_key>(key_k->second);
+
+                    if (devkey.get_error())
+                        throw std::runtime_error("invalid device key");
+
+                    auto dev = fetch_device(devkey);
+
+                    if (dev == nullptr)
+                        throw std::runtime_error("no such device");
+
+                    std::ostream os(&con->response_stream());
+
+                    // [time, lat, lon, alt] per point, oldest first
+                    os << "[";
+
+                    if (dev->has_location_trail()) {
+                        bool first = true;
+
+                        for (const auto& p : dev->get_location_trail()->get_points()) {
+                            if (!first)
+                                os << ",";
+                            first = false;
+
+                            os << fmt::format("[{},{},{},{}]", p.time, p.lat, p.lon, p.alt);
+                        }
+                    }
+
+                    os << "]";
+                }, get_devicelist_mutex()));
+
     httpd->register_route("/devices/pcap/by-key/:key/packets", {"GET"}, httpd->RO_ROLE, {"pcapng"},
             std::make_shared<kis_net_web_function_endpoint>(
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
@@ -485,7 +652,7 @@ device_tracker::device_tracker() :
                     pcapng->block_until_stream_done();
 
                     streamtracker->remove_streamer(sid);
-                }));
+                }, nullptr, nullptr, true));
 
     httpd->register_route("/devices/alerts/mac/:type/add", {"POST"}, httpd->LOGON_ROLE, {"cmd"},
             std::make_shared<kis_net_web_function_endpoint>(
@@ -686,45 +853,38 @@ device_tracker::device_tracker() :
                                 auto tid = 
                                     timetracker->register_timer(std::chrono::seconds(rate), true,
                                             [this, con, dev_r, dev_k, dev_m, json, ws, &last_tm, rename_map, format_t](int) -> int {
+                                                // Changed devices are snapshotted under the devicelist
+                                                // lock and serialized after it's released
+                                                auto changed = std::vector<std::shared_ptr<kis_tracked_device_base>>{};
+
                                                 if (dev_r == "*") {
-                                                    auto worker = device_tracker_view_function_worker([json, last_tm, format_t, this, ws](std::shared_ptr<kis_tracked_device_base> dev) -> bool {
-                                                        if (dev->get_mod_time() > last_tm) {
-                                                            std::stringstream ss;
-                                                            entrytracker->serialize_with_json_summary(format_t, ss, dev, json);
-                                                            auto data = ss.str();
-                                                            ws->write(data);
-                                                        }
+                                                    auto worker = device_tracker_view_function_worker([last_tm, this, &changed](std::shared_ptr<kis_tracked_device_base> dev) -> bool {
+                                                        if (dev->get_mod_time() > last_tm)
+                                                            changed.push_back(snapshot_device(dev));
 
                                                         return false;
                                                     });
 
                                                     do_device_work(worker);
                                                 } else if (!dev_k.get_error()) {
-                                                    kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "ws monitor timer serialize lambda");
-
                                                     auto dev = fetch_device(dev_k);
-                                                    if (dev != nullptr) {
-                                                        if (dev->get_mod_time() > last_tm) {
-                                                            std::stringstream ss;
-                                                            entrytracker->serialize_with_json_summary(format_t, ss, dev, json);
-                                                            auto data = ss.str();
-                                                            ws->write(data);
-                                                        }
-                                                    }
+
+                                                    if (dev != nullptr && dev->get_mod_time() > last_tm)
+                                                        changed.push_back(snapshot_device(dev));
                                                 } else if (!dev_m.error()) {
-                                                    kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "ws monitor timer serialize lambda");
-
-                                                    const auto mmp = tracked_mac_multimap.equal_range(dev_m);
-                                                    for (auto mmpi = mmp.first; mmpi != mmp.second; ++mmpi) {
-                                                        if (mmpi->second->get_mod_time() > last_tm) {
-                                                            std::stringstream ss;
-                                                            entrytracker->serialize_with_json_summary(format_t, ss, mmpi->second, json);
-                                                            auto data = ss.str();
-                                                            ws->write(data);
-                                                        }
+                                                    for (const auto& dev : fetch_devices(dev_m)) {
+                                                        if (dev->get_mod_time() > last_tm)
+                                                            changed.push_back(snapshot_device(dev));
                                                     }
                                                 }
 
+                                                for (const auto& dev : changed) {
+                                                    std::stringstream ss;
+                                                    entrytracker->serialize_with_json_summary(format_t, ss, dev, json);
+                                                    auto data = ss.str();
+                                                    ws->write(data);
+                                                }
+
                                                 last_tm = (time_t) Globalreg::globalreg->last_tv_sec;
 
                                                 return 1;
@@ -783,6 +943,47 @@ device_tracker::device_tracker() :
                     return all_phys_endp_handler(con);
             }));
 
+    memory_devices_id =
+        entrytracker->register_field("kismet.system.memory.devices",
+                tracker_element_factory<tracker_element_map>(),
+                "Estimated memory held by devices");
+
+    memory_devices_total_id =
+        entrytracker->register_field("kismet.system.memory.devices.total",
+                tracker_element_factory<tracker_element_uint64>(),
+                "Estimated bytes held by all devices");
+
+    memory_devices_phys_id =
+        entrytracker->register_field("kismet.system.memory.devices.phys",
+                tracker_element_factory<tracker_element_vector>(),
+                "Estimated memory held by devices of each phy");
+
+    memory_devices_top_id =
+        entrytracker->register_field("kismet.system.memory.devices.top",
+                tracker_element_factory<tracker_element_vector>(),
+                "Devices holding the most memory");
+
+    memory_device_id =
+        entrytracker->register_field("kismet.system.memory.device",
+                tracker_element_factory<tracker_element_map>(),
+                "Estimated memory held by a device");
+
+    memory_device_bytes_id =
+        entrytracker->register_field("kismet.system.memory.device.bytes",
+                tracker_element_factory<tracker_element_uint64>(),
+                "Estimated bytes held");
+
+    httpd->register_route("/system/memory/devices", {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](shared_con con) -> std::shared_ptr<tracker_element> {
+                    return memory_devices_endp_handler(con);
+            }));
+
+    sketch_init();
+    group_init();
+    geoindex_init();
+    snapshot_init();
+
     // Open and upgrade the DB, default path
     database_open("");
     database_upgrade_db();
@@ -869,8 +1070,11 @@ void device_tracker::trigger_deferred_startup() {
                 [](std::shared_ptr<kis_tracked_device_base>) -> bool {
                     return true;
                 });
+    all_view->set_update_deps(VIEW_DEP_NONE);
     add_view(all_view);
 
+    // Every phy is registered by now, so devices of every phy can be restored
+    load_device_snapshot();
 }
 
 device_tracker::~device_tracker() {
@@ -893,8 +1097,12 @@ device_tracker::~device_tracker() {
         timetracker->remove_timer(device_idle_timer);
         timetracker->remove_timer(max_devices_timer);
         timetracker->remove_timer(device_storage_timer);
+        timetracker->remove_timer(device_spill_timer);
+        timetracker->remove_timer(device_snapshot_timer);
     }
 
+    spill_close();
+
     // TODO broken for now
     /*
 	if (track_filter != NULL)
@@ -971,9 +1179,7 @@ std::string device_tracker::fetch_phy_name(int in_phy) {
 }
 
 int device_tracker::fetch_num_devices() {
-    kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "device_tracker fetch_num_devices");
-
-    return tracked_map.size();
+    return n_tracked_devices;
 }
 
 int device_tracker::fetch_num_packets() {
@@ -1013,6 +1219,7 @@ int device_tracker::register_phy_handler(kis_phy_handler *in_weak_handler) {
                             return dev->get_phyid() == phy_id;
                         }
                         );
+            phy_view->set_update_deps(VIEW_DEP_PHY);
             phy_view_map[phy_id] = phy_view;
             add_view(phy_view);
         }
@@ -1034,25 +1241,88 @@ void device_tracker::update_full_refresh() {
 }
 
 std::shared_ptr<kis_tracked_device_base> device_tracker::fetch_device(device_key in_key) {
-    kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "device_tracker fetch_device");
+    auto device = fetch_device_nr(in_key);
 
-	device_itr i = tracked_map.find(in_key);
+    if (device != nullptr && device->get_spilled())
+        restore_spilled_device(device);
 
-	if (i != tracked_map.end())
-		return i->second;
-
-	return NULL;
+    return device;
 }
 
 std::shared_ptr<kis_tracked_device_base> device_tracker::fetch_device_nr(device_key in_key) {
-	device_itr i = tracked_map.find(in_key);
+    auto& shard = shard_for(in_key);
+    std::shared_lock<kis_shared_mutex> lk(shard.mutex);
 
-	if (i != tracked_map.end())
+	auto i = shard.devices.find(in_key);
+
+	if (i != shard.devices.end())
 		return i->second;
 
 	return NULL;
 }
 
+void device_tracker::shard_insert(std::shared_ptr<kis_tracked_device_base> device) {
+    auto& shard = shard_for(device->get_key());
+    kis_lock_guard<kis_shared_mutex> lk(shard.mutex, "device_tracker shard_insert");
+
+    auto r = shard.devices.insert_or_assign(device->get_key(), device);
+
+    if (r.second)
+        n_tracked_devices++;
+
+    index_device_lastseen(device);
+}
+
+void device_tracker::shard_remove(std::shared_ptr<kis_tracked_device_base> device) {
+    auto& shard = shard_for(device->get_key());
+
+    {
+        kis_lock_guard<kis_shared_mutex> lk(shard.mutex, "device_tracker shard_remove");
+
+        auto i = shard.devices.find(device->get_key());
+
+        if (i != shard.devices.end()) {
+            shard.devices.erase(i);
+            n_tracked_devices--;
+        }
+    }
+
+    geo_index->remove(device->get_key());
+
+    unindex_device_lastseen(device);
+}
+
+void device_tracker::index_device_lastseen(std::shared_ptr<kis_tracked_device_base> device) {
+    auto last_time = device->get_last_time();
+    auto idx_time = device->get_lastseen_index_time();
+
+    if (idx_time == last_time)
+        return;
+
+    auto id = device->get_kis_internal_id();
+
+    // Re-key the existing index node instead of allocating a new one
+    auto node = device_lastseen_index.extract(lastseen_key_t(idx_time, id));
+
+    if (!node.empty()) {
+        node.key() = lastseen_key_t(last_time, id);
+        device_lastseen_index.insert(std::move(node));
+    } else {
+        device_lastseen_index.emplace(lastseen_key_t(last_time, id), device);
+    }
+
+    device->set_lastseen_index_time(last_time);
+}
+
+void device_tracker::unindex_device_lastseen(std::shared_ptr<kis_tracked_device_base> device) {
+    if (device->get_lastseen_index_time() < 0)
+        return;
+
+    device_lastseen_index.erase(lastseen_key_t(device->get_lastseen_index_time(),
+                device->get_kis_internal_id()));
+    device->set_lastseen_index_time(-1);
+}
+
 // Fetch one or more devices by mac address or mac mask
 std::vector<std::shared_ptr<kis_tracked_device_base>> device_tracker::fetch_devices(mac_addr in_mac) {
     kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "device_tracker fetch_device mac");
@@ -1060,12 +1330,84 @@ std::vector<std::shared_ptr<kis_tracked_device_base>> device_tracker::fetch_devi
    
     const auto mmp = tracked_mac_multimap.equal_range(in_mac);
     for (auto mmpi = mmp.first; mmpi != mmp.second; ++mmpi) {
+        if (mmpi->second->get_spilled())
+            restore_spilled_device(mmpi->second);
+
         ret.push_back(mmpi->second);
     }
 
     return ret;
 }
 
+std::shared_ptr<kis_tracked_device_base> device_tracker::snapshot_device(std::shared_ptr<kis_tracked_device_base> in_device) {
+    if (in_device == nullptr)
+        return nullptr;
+
+    kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "device_tracker snapshot_device");
+
+    if (in_device->get_spilled())
+        restore_spilled_device(in_device);
+
+    auto seq = in_device->get_mod_seq();
+    auto snap = in_device->get_snapshot(seq);
+
+    if (snap != nullptr)
+        return snap;
+
+    snap = std::static_pointer_cast<kis_tracked_device_base>(tracker_element_deep_copy(in_device));
+    snap->set_kis_internal_id(in_device->get_kis_internal_id());
+
+    in_device->set_snapshot(seq, snap);
+
+    return snap;
+}
+
+size_t device_tracker::device_memory_size(std::shared_ptr<kis_tracked_device_base> in_device) {
+    if (in_device == nullptr)
+        return 0;
+
+    kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "device_tracker device_memory_size");
+
+    auto seq = in_device->get_mod_seq();
+    auto sz = in_device->get_mem_estimate(seq);
+
+    if (sz != 0)
+        return sz;
+
+    sz = tracker_element_estimate_size(in_device);
+    in_device->set_mem_estimate(seq, sz);
+
+    return sz;
+}
+
+size_t device_tracker::devices_memory_size() {
+    kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "device_tracker devices_memory_size");
+
+    size_t sz = 0;
+
+    for (const auto& d : *immutable_tracked_vec)
+        sz += device_memory_size(std::static_pointer_cast<kis_tracked_device_base>(d));
+
+    return sz;
+}
+
+std::shared_ptr<tracker_element_vector> device_tracker::snapshot_devices(std::shared_ptr<tracker_element> in_devices) {
+    if (in_devices == nullptr)
+        return nullptr;
+
+    kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "device_tracker snapshot_devices");
+
+    auto ret = std::make_shared<tracker_element_vector>();
+    auto devices = std::static_pointer_cast<tracker_element_vector>(in_devices);
+
+    ret->reserve(devices->size());
+
+    for (const auto& d : *devices)
+        ret->push_back(snapshot_device(std::static_pointer_cast<kis_tracked_device_base>(d)));
+
+    return ret;
+}
+
 int device_tracker::common_tracker(std::shared_ptr<kis_packet> in_pack) {
     kis_lock_guard<kis_mutex> lk(phy_mutex, "device_tracker common_tracker");
 
@@ -1082,7 +1424,7 @@ int device_tracker::common_tracker(std::shared_ptr<kis_packet> in_pack) {
 
     auto pack_common = in_pack->fetch<kis_common_info>(pack_comp_common);
 
-    if (!ram_no_rrd)
+    if (!no_rrd())
         packets_rrd->add_sample(1, Globalreg::globalreg->last_tv_sec);
 
     num_packets++;
@@ -1168,7 +1510,17 @@ std::shared_ptr<kis_tracked_device_base>
         if (in_flags & UCD_UPDATE_EXISTING_ONLY)
             return NULL;
 
-        device = std::make_shared<kis_tracked_device_base>(device_builder.get());
+        std::shared_ptr<tracker_arena> arena;
+
+        if (device_arena)
+            arena = std::make_shared<tracker_arena>();
+
+        {
+            tracker_arena_scope as(arena);
+            device = tracker_arena_make_shared<kis_tracked_device_base>(device_builder.get());
+        }
+
+        device->set_arena(arena);
 
         // Device ID is the size of the vector so a new device always gets put
         // in it's numbered slot
@@ -1194,6 +1546,8 @@ std::shared_ptr<kis_tracked_device_base>
         load_stored_tags(device);
 
         new_device = true;
+    } else if (device->get_spilled()) {
+        restore_spilled_device(device);
     }
 
     // Tag the packet with the base device
@@ -1240,14 +1594,25 @@ std::shared_ptr<kis_tracked_device_base>
 
     }
 
-    if (device->get_last_time() < in_pack->ts.tv_sec)
+    auto prev_frequency = device->get_frequency();
+    auto prev_time = device->get_last_time();
+
+    if (device->get_last_time() < in_pack->ts.tv_sec) {
         device->set_last_time(in_pack->ts.tv_sec);
 
+        // New devices are indexed when they are added to the device list
+        if (!new_device)
+            index_device_lastseen(device);
+    }
+
     if (in_flags & UCD_UPDATE_PACKETS) {
-        device->inc_packets();
+        // Sampled data frames stand in for the frames skipped since the last one
+        uint64_t weight = std::max(1U, in_pack->sample_weight);
+
+        device->inc_packets(weight);
 
-        if (!ram_no_rrd)
-            device->get_packets_rrd()->add_sample(1, Globalreg::globalreg->last_tv_sec);
+        if (!no_rrd())
+            device->get_packets_rrd()->add_sample(weight, Globalreg::globalreg->last_tv_sec);
 
         if (pack_common != NULL) {
             if (pack_common->error)
@@ -1255,11 +1620,12 @@ std::shared_ptr<kis_tracked_device_base>
 
             if (pack_common->type == packet_basic_data) {
                 // TODO fix directional data
-                device->inc_data_packets();
-                device->inc_datasize(pack_common->datasize);
+                device->inc_data_packets(weight);
+                device->inc_datasize(pack_common->datasize * weight);
 
-                if (!ram_no_rrd) {
-                    device->get_data_rrd()->add_sample(pack_common->datasize, Globalreg::globalreg->last_tv_sec);
+                if (!no_rrd()) {
+                    device->get_data_rrd()->add_sample(pack_common->datasize * weight, 
+                            Globalreg::globalreg->last_tv_sec);
                 }
 
             } else if (pack_common->type == packet_basic_mgmt ||
@@ -1279,7 +1645,7 @@ std::shared_ptr<kis_tracked_device_base>
                 device->set_frequency(pack_l1info->freq_khz);
 
             auto sc = std::make_shared<packinfo_sig_combo>(pack_l1info, pack_gpsinfo);
-            device->get_signal_data()->append_signal(*sc, !ram_no_rrd, in_pack->ts.tv_sec);
+            device->get_signal_data()->append_signal(*sc, !no_rrd(), in_pack->ts.tv_sec);
 
             device->inc_frequency_count((int) pack_l1info->freq_khz);
         } else if (pack_common != NULL) {
@@ -1293,6 +1659,11 @@ std::shared_ptr<kis_tracked_device_base>
         }
 	}
 
+    if (device_activity != nullptr && (device->get_frequency() != prev_frequency ||
+                device->get_last_time() != prev_time))
+        device_activity(prev_frequency, prev_time, 
+                device->get_frequency(), device->get_last_time());
+
     if (((in_flags & UCD_UPDATE_LOCATION) || 
          ((in_flags & UCD_UPDATE_EMPTY_LOCATION) && !device->has_location_cloud())) &&
             pack_gpsinfo != NULL && (device_location_signal_threshold == 0 || 
@@ -1308,6 +1679,10 @@ std::shared_ptr<kis_tracked_device_base>
                     pack_gpsinfo->alt, pack_gpsinfo->fix, pack_gpsinfo->speed,
                     pack_gpsinfo->heading);
 
+            if (pack_gpsinfo->fix >= 2)
+                geo_index->update(device, pack_gpsinfo->lat, pack_gpsinfo->lon,
+                        in_pack->ts.tv_sec);
+
             // Throttle history cloud to one update per second to prevent floods of
             // data from swamping the cloud
             if (track_history_cloud && pack_gpsinfo->fix >= 2) {
@@ -1331,6 +1706,10 @@ std::shared_ptr<kis_tracked_device_base>
 
                 device->get_location_cloud()->add_sample(histloc);
             }
+
+            if (track_location_trail && pack_gpsinfo->fix >= 2)
+                device->get_location_trail()->add_fix(pack_gpsinfo->lat, pack_gpsinfo->lon,
+                        pack_gpsinfo->alt, in_pack->ts.tv_sec);
         } else {
             devloc->add_loc(pack_gpsinfo->lat, pack_gpsinfo->lon,
                             pack_gpsinfo->alt, pack_gpsinfo->fix, pack_gpsinfo->speed,
@@ -1348,17 +1727,22 @@ std::shared_ptr<kis_tracked_device_base>
         if (pack_l1info != NULL)
             f = pack_l1info->freq_khz;
 
+        auto n_seenby = device->get_seenby_map()->size();
+
         if (track_persource_history) {
             // Only populate signal, frequency map, etc per-source if we're tracking that
             auto sc = std::make_shared<packinfo_sig_combo>(pack_l1info, pack_gpsinfo);
             device->inc_seenby_count(pack_datasrc->ref_source, in_pack->ts.tv_sec, f, 
-                    sc.get(), !ram_no_rrd);
+                    sc.get(), !no_rrd());
         } else {
             device->inc_seenby_count(pack_datasrc->ref_source, in_pack->ts.tv_sec, 0, 0, false);
         }
 
+        // The seenby views only change when a datasource sees the device for the
+        // first time
         if (map_seenby_views)
-            update_view_device(device);
+            update_view_device(device, device->get_seenby_map()->size() != n_seenby ?
+                    VIEW_DEP_SEENBY : VIEW_DEP_NONE);
 
         if (sc != NULL)
             delete(sc);
@@ -1367,9 +1751,13 @@ std::shared_ptr<kis_tracked_device_base>
     if (pack_common != NULL)
         device->add_basic_crypt(pack_common->basic_crypt_set);
 
+    // Flag the device for re-sorting in any view indexes
+    if (!new_device)
+        modified_view_device(device);
+
     if (new_device) {
         // Add the new device to the list
-        tracked_map[key] = device;
+        shard_insert(device);
 
         immutable_tracked_vec->push_back(device);
 
@@ -1399,6 +1787,86 @@ std::shared_ptr<kis_tracked_device_base>
     return device;
 }
 
+std::shared_ptr<kis_tracked_device_base> device_tracker::fetch_or_create_device(mac_addr in_mac,
+        kis_phy_handler *in_phy, const std::string& in_basic_type, time_t in_first_time,
+        bool& r_new) {
+    kis_lock_guard<kis_mutex> lg(get_devicelist_mutex(), "device_tracker fetch_or_create_device");
+
+    auto key = device_key(in_phy->fetch_phyname_hash(), in_mac);
+    auto device = fetch_device_nr(key);
+
+    r_new = false;
+
+    if (device != nullptr) {
+        if (device->get_spilled())
+            restore_spilled_device(device);
+
+        return device;
+    }
+
+    std::shared_ptr<tracker_arena> arena;
+
+    if (device_arena)
+        arena = std::make_shared<tracker_arena>();
+
+    {
+        tracker_arena_scope as(arena);
+        device = tracker_arena_make_shared<kis_tracked_device_base>(device_builder.get());
+    }
+
+    device->set_arena(arena);
+
+    device->set_kis_internal_id(immutable_tracked_vec->size());
+
+    device->set_key(key);
+
+    device->set_macaddr(in_mac);
+    device->set_tracker_phyname(get_cached_phyname(in_phy->fetch_phy_name()));
+    device->set_phyid(in_phy->fetch_phy_id());
+
+    device->set_server_uuid(Globalreg::globalreg->server_uuid);
+
+    device->set_first_time(in_first_time);
+    device->set_last_time(in_first_time);
+
+    device->set_tracker_type_string(get_cached_devicetype(in_basic_type));
+
+    if (Globalreg::globalreg->manufdb != NULL) {
+        device->set_manuf(Globalreg::globalreg->manufdb->lookup_oui(in_mac));
+    }
+
+    load_stored_username(device);
+    load_stored_tags(device);
+
+    shard_insert(device);
+    immutable_tracked_vec->push_back(device);
+    tracked_mac_multimap.emplace(std::make_pair(in_mac, device));
+
+    r_new = true;
+
+    return device;
+}
+
+void device_tracker::commit_device(std::shared_ptr<kis_tracked_device_base> in_device, bool in_new) {
+    kis_lock_guard<kis_mutex> lg(get_devicelist_mutex(), "device_tracker commit_device");
+
+    in_device->update_modtime();
+    index_device_lastseen(in_device);
+
+    if (!in_new) {
+        update_view_device(in_device);
+        modified_view_device(in_device);
+        return;
+    }
+
+    stamp_device_modified(in_device);
+    new_view_device(in_device);
+
+    auto evt = eventbus->get_eventbus_event(event_new_device());
+    evt->get_event_content()->insert(event_new_device(), in_device);
+    eventbus->publish(evt);
+}
+
 // Sort based on internal kismet ID
 bool devicetracker_sort_internal_id(std::shared_ptr<kis_tracked_device_base> a,
 	std::shared_ptr<kis_tracked_device_base> b) {
@@ -1419,62 +1887,58 @@ std::shared_ptr<tracker_element_vector> device_tracker::do_readonly_device_work(
     return all_view->do_readonly_device_work(worker);
 }
 
-// Simple std::sort comparison function to order by the least frequently
-// seen devices
-bool devicetracker_sort_lastseen(std::shared_ptr<tracker_element> a, std::shared_ptr<tracker_element> b) {
-    if (a == nullptr)
-        return true;
-    if (b == nullptr)
-        return true;
+void device_tracker::expire_device(std::shared_ptr<kis_tracked_device_base> device) {
+    shard_remove(device);
+    forget_spilled_device(device);
 
-    return std::static_pointer_cast<kis_tracked_device_base>(a)->get_last_time() <
-        std::static_pointer_cast<kis_tracked_device_base>(b)->get_last_time();
-}
+    device_change_log.erase(device->get_mod_seq());
 
-void device_tracker::timetracker_event(int eventid) {
-    if (eventid == device_idle_timer) {
-        kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "device_tracker timetracker_event device_idle_timer");
-
-        time_t ts_now = Globalreg::globalreg->last_tv_sec;
-        bool purged = false;
-
-        // Reset the smart pointer of any devices we're dropping from the device list
-        for (size_t pi = 0; pi < immutable_tracked_vec->size(); pi++) {
-            auto d = std::static_pointer_cast<kis_tracked_device_base>(*(immutable_tracked_vec->begin() + pi));
-
-            if (d == nullptr)
-                continue;
+    // Erase it from the multimap
+    auto mmp = tracked_mac_multimap.equal_range(device->get_macaddr());
 
-            if (ts_now - d->get_last_time() > device_idle_expiration &&
-                (d->get_packets() < device_idle_min_packets ||
-                 device_idle_min_packets <= 0)) {
-
-                device_itr mi = tracked_map.find(d->get_key());
-                if (mi != tracked_map.end())
-                    tracked_map.erase(mi);
+    for (auto mmpi = mmp.first; mmpi != mmp.second; ++mmpi) {
+        if (mmpi->second->get_key() == device->get_key()) {
+            tracked_mac_multimap.erase(mmpi);
+            break;
+        }
+    }
 
-                // Erase it from the multimap
-                auto mmp = tracked_mac_multimap.equal_range(d->get_macaddr());
+    // Forget it from any views
+    remove_view_device(device);
 
-                for (auto mmpi = mmp.first; mmpi != mmp.second; ++mmpi) {
-                    if (mmpi->second->get_key() == d->get_key()) {
-                        tracked_mac_multimap.erase(mmpi);
-                        break;
-                    }
-                }
+    // Forget it from the immutable vec, but keep its position; we need to have
+    // vecpos = devid
+    (immutable_tracked_vec->begin() + device->get_kis_internal_id())->reset();
+}
 
-                // Forget it from any views
-                remove_view_device(d);
+void device_tracker::timetracker_event(int eventid) {
+    if (eventid == device_idle_timer) {
+        kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "device_tracker timetracker_event device_idle_timer");
 
-                // Forget the immutable vec pointer to it
-                (immutable_tracked_vec->begin() + pi)->reset();
+        int idle_expiration = effective_idle_expiration();
 
-                purged = true;
+        if (idle_expiration <= 0)
+            return;
 
-            }
+        time_t ts_now = Globalreg::globalreg->last_tv_sec;
+        std::vector<std::shared_ptr<kis_tracked_device_base>> expired;
+
+        // Walk the oldest devices until we reach one which is still active.  Idle
+        // devices with too many packets to expire stay at the front of the index and
+        // are passed over again on the next run.
+        for (const auto& i : device_lastseen_index) {
+            if (ts_now - i.first.first <= idle_expiration)
+                break;
+
+            if (i.second->get_packets() < device_idle_min_packets ||
+                    device_idle_min_packets <= 0)
+                expired.push_back(i.second);
         }
 
-        if (purged)
+        for (const auto& d : expired)
+            expire_device(d);
+
+        if (expired.size())
             update_full_refresh();
 
     } else if (eventid == max_devices_timer) {
@@ -1485,45 +1949,70 @@ void device_tracker::timetracker_event(int eventid) {
             return;
 
 		// Do nothing if the number of devices is less than the max
-		if (tracked_map.size() <= max_num_devices)
+		if (n_tracked_devices <= max_num_devices)
             return;
 
-        // Now this gets expensive; clone the immutable vec, sort it, and then we start
-        // zeroing out the immutable vec records
-        tracker_element_vector sorted_vec(immutable_tracked_vec);
+        // Remove the oldest devices over the limit from the front of the index
+        std::vector<std::shared_ptr<kis_tracked_device_base>> expired;
+        size_t n_excess = n_tracked_devices - max_num_devices;
 
-#if defined(HAVE_CPP17_PARALLEL)
-        std::stable_sort(std::execution::par_unseq, sorted_vec.begin(), sorted_vec.end(), devicetracker_sort_lastseen);
-#else
-        std::stable_sort(sorted_vec.begin(), sorted_vec.end(), devicetracker_sort_lastseen);
-#endif
+        for (auto i = device_lastseen_index.begin();
+                i != device_lastseen_index.end() && expired.size() < n_excess; ++i)
+            expired.push_back(i->second);
 
-        for (auto i = sorted_vec.begin() + max_num_devices; i != sorted_vec.end(); ++i) {
-            auto d = std::static_pointer_cast<kis_tracked_device_base>(*i);
+        for (const auto& d : expired)
+            expire_device(d);
 
-            device_itr mi = tracked_map.find(d->get_key());
-            if (mi != tracked_map.end())
-                tracked_map.erase(mi);
+        // Do an update since we're trimming something
+        update_full_refresh();
 
-            // Erase it from the multimap
-            auto mmp = tracked_mac_multimap.equal_range(d->get_macaddr());
+	}
+}
 
-            for (auto mmpi = mmp.first; mmpi != mmp.second; ++mmpi) {
-                if (mmpi->second->get_key() == d->get_key()) {
-                    tracked_mac_multimap.erase(mmpi);
-                    break;
-                }
-            }
+void device_tracker::set_pressure_idle_expiration(int in_timeout) {
+    auto prev = effective_idle_expiration();
 
-            // Forget it from the immutable vec, but keep its
-            // position; we need to have vecpos = devid
-            (immutable_tracked_vec->begin() + d->get_kis_internal_id())->reset();
-        }
+    pressure_idle_expiration = in_timeout;
 
-        // Do an update since we're trimming something
-        update_full_refresh();
+    // Expire immediately when the timeout gets shorter instead of waiting for the timer
+    auto next = effective_idle_expiration();
 
-	}
+    if (next > 0 && (prev <= 0 || next < prev))
+        timetracker_event(device_idle_timer);
+}
+
+void device_tracker::set_pressure_rrd(bool in_drop, int in_idle) {
+    pressure_no_rrd = in_drop;
+
+    if (!in_drop)
+        return;
+
+    kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "device_tracker set_pressure_rrd");
+
+    time_t ts_now = Globalreg::globalreg->last_tv_sec;
+
+    // The oldest devices are at the front of the index; spilled devices have already
+    // released their records
+    for (const auto& i : device_lastseen_index) {
+        if (ts_now - i.first.first <= in_idle)
+            break;
+
+        auto d = i.second;
+
+        if (d->get_spilled())
+            continue;
+
+        d->clear_packets_rrd();
+        d->clear_data_rrd();
+        d->clear_location_cloud();
+
+        if (d->has_signal_data())
+            d->get_signal_data()->clear_signal_min_rrd();
+    }
+}
+
+void device_tracker::set_pressure_sketch(bool in_sketch) {
+    pressure_sketch = in_sketch;
 }
 
 void device_tracker::usage(const char *name __attribute__((unused))) {
@@ -1631,9 +2120,16 @@ void device_tracker::add_device(std::shared_ptr<kis_tracked_device_base> device)
     // in it's numbered slot
     device->set_kis_internal_id(immutable_tracked_vec->size());
 
-    tracked_map[device->get_key()] = device;
+    shard_insert(device);
     immutable_tracked_vec->push_back(device);
 
+    // Devices restored with a location are indexed at their last location
+    if (device->has_location() && device->get_location()->get_valid() &&
+            device->get_location()->has_last_loc()) {
+        auto loc = device->get_location()->get_last_loc();
+        geo_index->update(device, loc->get_lat(), loc->get_lon(), device->get_last_time());
+    }
+
     auto mm_pair = std::make_pair(device->get_macaddr(), device);
     tracked_mac_multimap.emplace(mm_pair);
 }
@@ -1678,12 +2174,59 @@ void device_tracker::new_view_device(std::shared_ptr<kis_tracked_device_base> in
     }
 }
 
-void device_tracker::update_view_device(std::shared_ptr<kis_tracked_device_base> in_device) {
+void device_tracker::update_view_device(std::shared_ptr<kis_tracked_device_base> in_device,
+        uint32_t in_changed) {
+    kis_lock_guard<kis_mutex> lk(devicelist_mutex);
+
+    stamp_device_modified(in_device);
+
+    for (const auto& i : *view_vec) {
+        auto vi = std::static_pointer_cast<device_tracker_view>(i);
+
+        if (vi->get_update_deps() & in_changed)
+            vi->update_device(in_device);
+        else
+            vi->device_modified(in_device);
+    }
+}
+
+void device_tracker::stamp_device_modified(std::shared_ptr<kis_tracked_device_base> in_device) {
+    kis_lock_guard<kis_mutex> lk(devicelist_mutex, "device_tracker stamp_device_modified");
+
+    auto seq = ++device_mod_seq;
+
+    // Re-key the existing change log node instead of allocating a new one
+    auto node = device_change_log.extract(in_device->get_mod_seq());
+
+    if (!node.empty() && node.mapped() != in_device)
+        device_change_log.insert(std::move(node));
+
+    if (!node.empty()) {
+        node.key() = seq;
+        device_change_log.insert(std::move(node));
+    } else {
+        device_change_log.emplace(seq, in_device);
+    }
+
+    in_device->set_mod_seq(seq);
+}
+
+void device_tracker::do_modified_since(uint64_t in_seq, 
+        const std::function<bool (const std::shared_ptr<kis_tracked_device_base>&)>& cb) {
+    kis_lock_guard<kis_mutex> lk(devicelist_mutex, "device_tracker do_modified_since");
+
+    for (auto i = device_change_log.upper_bound(in_seq); i != device_change_log.end(); ++i) {
+        if (!cb(i->second))
+            return;
+    }
+}
+
+void device_tracker::modified_view_device(std::shared_ptr<kis_tracked_device_base> in_device) {
     kis_lock_guard<kis_mutex> lk(devicelist_mutex);
 
     for (const auto& i : *view_vec) {
         auto vi = std::static_pointer_cast<device_tracker_view>(i);
-        vi->update_device(in_device);
+        vi->device_modified(in_device);
     }
 }
 
@@ -1712,10 +2255,11 @@ void device_tracker::databaselog_write_devices() {
     if (dbf == nullptr)
         return;
 
-    device_tracker_view_function_worker worker([this, dbf](std::shared_ptr<kis_tracked_device_base> dev) -> bool {
-            if (dev->get_mod_time() >= last_database_logged) {
-                dbf->log_device(dev);
-            }
+    auto changed = std::vector<std::shared_ptr<kis_tracked_device_base>>{};
+
+    device_tracker_view_function_worker worker([this, &changed](std::shared_ptr<kis_tracked_device_base> dev) -> bool {
+            if (dev->get_mod_time() >= last_database_logged) 
+                changed.push_back(dev);
 
             return false;
         });
@@ -1726,6 +2270,11 @@ void device_tracker::databaselog_write_devices() {
     // Explicitly use the non-ro worker, because we're phasing out the RO version because of too much contention
     do_device_work(worker);
 
+    // Each device is logged from a snapshot, so serializing it doesn't hold the devicelist
+    // lock
+    for (const auto& dev : changed)
+        dbf->log_device(snapshot_device(dev));
+
     // Then update the log; we might catch a few high-change devices twice, but this is
     // safer by far
     last_database_logged = log_time;
@@ -1849,6 +2398,7 @@ void device_tracker::set_device_user_name(std::shared_ptr<kis_tracked_device_bas
     kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "set_device_user_name");
 
     in_dev->set_username(in_username);
+    stamp_device_modified(in_dev);
 
     if (!database_valid()) {
         _MSG("Unable to store device name to permanent storage, the database connection "
@@ -1910,6 +2460,8 @@ void device_tracker::set_device_tag(std::shared_ptr<kis_tracked_device_base> in_
         sm->insert(in_tag, e);
     }
 
+    stamp_device_modified(in_dev);
+
     if (!database_valid()) {
         _MSG("Unable to store device name to permanent storage, the database connection "
                 "is not available", MSGFLAG_ERROR);
@@ -1979,6 +2531,7 @@ void device_tracker::handle_new_datasource_event(std::shared_ptr<eventbus_event>
                         [source_key](std::shared_ptr<kis_tracked_device_base> dev) -> bool {
                             return dev->get_seenby_map()->find(source_key) != dev->get_seenby_map()->end();
                         });
+            seenby_view->set_update_deps(VIEW_DEP_SEENBY);
             seenby_view_map[source_uuid] = seenby_view;
             add_view(seenby_view);
         }
@@ -21,11 +21,13 @@
 
 #include "config.h"
 
+#include <array>
 #include <atomic>
 #include <stdio.h>
 #include <time.h>
 #include <list>
 #include <map>
+#include <set>
 #include <unordered_map>
 #include <vector>
 #include <algorithm>
@@ -43,11 +45,15 @@
 #include "entrytracker.h"
 #include "packetchain.h"
 #include "timetracker.h"
+#include "trackedelement_codec.h"
 #include "uuid.h"
 #include "configfile.h"
 #include "kis_datasource.h"
 #include "packinfo_signal.h"
 #include "devicetracker_component.h"
+#include "devicetracker_geoindex.h"
+#include "devicetracker_group.h"
+#include "devicetracker_sketch.h"
 #include "trackercomponent_legacy.h"
 #include "timetracker.h"
 #include "kis_net_beast_httpd.h"
@@ -118,11 +124,89 @@ public:
 	// Look for an existing device record under read-only shared lock
     std::shared_ptr<kis_tracked_device_base> fetch_device(device_key in_key);
 
+    // Assign a device the next modification sequence number, moving it to the end of
+    // the change log
+    void stamp_device_modified(std::shared_ptr<kis_tracked_device_base> in_device);
+
+    // Walk the devices modified after the given sequence number, in order of their most
+    // recent change; the callback returns false to end the walk.  Must be called under
+    // the devicelist lock.
+    void do_modified_since(uint64_t in_seq, 
+            const std::function<bool (const std::shared_ptr<kis_tracked_device_base>&)>& cb);
+
+    unsigned int get_view_work_threads() const {
+        return view_work_threads;
+    }
+
+    unsigned int get_view_cache_ms() const {
+        return view_cache_ms;
+    }
+
+    bool get_view_search_index() const {
+        return view_search_index;
+    }
+
+    unsigned int get_view_tile_cluster_zoom() const {
+        return view_tile_cluster_zoom;
+    }
+
+    uint64_t get_device_mod_seq() {
+        kis_lock_guard<kis_mutex> lk(devicelist_mutex, "device_tracker get_device_mod_seq");
+        return device_mod_seq;
+    }
+
     // Fetch one or more devices by mac address or mac mask
     std::vector<std::shared_ptr<kis_tracked_device_base>> fetch_devices(mac_addr in_mac);
 
-    // Look for an existing device record, without lock - must be called under some form of existing
-    // lock to be safely used
+    // Immutable copy of a device which can be serialized without holding the devicelist
+    // lock while packets keep updating the device.  The copy is shared by every caller
+    // until the device is modified again, and is released with the last reference to it.
+    std::shared_ptr<kis_tracked_device_base> snapshot_device(std::shared_ptr<kis_tracked_device_base> in_device);
+
+    // Vector of snapshots of a vector of devices
+    std::shared_ptr<tracker_element_vector> snapshot_devices(std::shared_ptr<tracker_element> in_devices);
+
+    // Estimated memory held by a device (see tracker_element_estimate_size), cached until
+    // the device is next modified.  Spilled records are not counted.
+    size_t device_memory_size(std::shared_ptr<kis_tracked_device_base> in_device);
+
+    // Estimated memory held by all devices
+    size_t devices_memory_size();
+
+    // Phys listed in tracker_sketch_phy count some classes of device, such as devices
+    // using randomized addresses, in a fixed size tracked_device_sketch instead of
+    // creating device records.  Phys call this before update_common_device for a
+    // device of such a class; if it returns true the packet has been counted and no
+    // device should be created.  Devices which already have a record are never
+    // sketched.
+    bool sketch_device(kis_phy_handler *in_phy, mac_addr in_mac, 
+            std::shared_ptr<kis_packet> in_pack);
+
+    // Phys listed in tracker_group_phy group devices using randomized addresses which
+    // are likely the same device, by fingerprints of what they send (see
+    // device_group_index).  Phys call this before update_common_device with the features
+    // of the packet; out_group is set to the group of the device, to be recorded on the
+    // device with set_device_group once it has been created.  With
+    // tracker_group_ephemeral, returns true if the device has no record and its group
+    // already has one, and no device should be created.
+    bool groups_phy(kis_phy_handler *in_phy);
+    bool group_device(kis_phy_handler *in_phy, mac_addr in_mac,
+            const std::vector<uint64_t>& in_features, std::shared_ptr<kis_packet> in_pack,
+            uint64_t& out_group);
+    void set_device_group(std::shared_ptr<kis_tracked_device_base> in_device, uint64_t in_group);
+
+    // Retention overrides applied by the memory governor of the system monitor while
+    // memory is short.  An idle timeout shorter than tracker_device_timeout expires
+    // idle devices sooner (0 restores the configured timeout); dropping RRDs stops
+    // recording device history and frees the RRDs of devices idle longer than in_idle;
+    // sketching counts the devices with random addresses of the
+    // memory_governor_sketch_phy phys as if they were listed in tracker_sketch_phy.
+    void set_pressure_idle_expiration(int in_timeout);
+    void set_pressure_rrd(bool in_drop, int in_idle);
+    void set_pressure_sketch(bool in_sketch);
+
+    // Look for an existing device record, taking only the shard lock; the record may be
+    // removed once this returns unless the devicelist lock is held
     std::shared_ptr<kis_tracked_device_base> fetch_device_nr(device_key in_key);
 
     // Do work on all devices, this applies to the 'all' device view
@@ -190,6 +274,28 @@ public:
             std::shared_ptr<kis_packet> in_pack, unsigned int in_flags,
             std::string in_basic_type);
 
+    // Fetch or create a device which is not built from a packet, such as a device merged
+    // from a federated server (see kis_federation).  Must be called under the devicelist
+    // lock.  r_new is set for a new device, which is indexed immediately but only added
+    // to the views and announced once the caller fills it in and calls commit_device.
+    std::shared_ptr<kis_tracked_device_base> fetch_or_create_device(mac_addr in_mac,
+            kis_phy_handler *in_phy, const std::string& in_basic_type, time_t in_first_time,
+            bool& r_new);
+
+    // Add a device from fetch_or_create_device to the views or, for an existing device,
+    // flag it as modified
+    void commit_device(std::shared_ptr<kis_tracked_device_base> in_device, bool in_new);
+
+    // Called from update_common_device when a device moves to a new frequency or is seen
+    // in a new second, with the previous and current frequency and last time; used by 
+    // the channel tracker to keep per-frequency device counts without scanning every
+    // device.  Set once at startup, before packets are processed.
+    using device_activity_cb = std::function<void (double, time_t, double, time_t)>;
+
+    void set_device_activity_cb(device_activity_cb in_cb) {
+        device_activity = in_cb;
+    }
+
     // Set the common name of a device (and log it in the database for future runs)
     void set_device_user_name(std::shared_ptr<kis_tracked_device_base> in_dev,
             std::string in_username);
@@ -214,13 +320,19 @@ public:
     // Store all devices to the database
     virtual void databaselog_write_devices();
 
+    // Write the device snapshot, if snapshots are enabled
+    void write_device_snapshot();
+
     // View API
     virtual bool add_view(std::shared_ptr<device_tracker_view> in_view);
     virtual void remove_view(const std::string& in_view_id);
 
     virtual void new_view_device(std::shared_ptr<kis_tracked_device_base> in_device);
-    virtual void update_view_device(std::shared_ptr<kis_tracked_device_base> in_device);
+    // Re-evaluate the views depending on any of the changed VIEW_DEP_ inputs of a device
+    virtual void update_view_device(std::shared_ptr<kis_tracked_device_base> in_device,
+            uint32_t in_changed = VIEW_DEP_ALL);
     virtual void remove_view_device(std::shared_ptr<kis_tracked_device_base> in_device);
+    virtual void modified_view_device(std::shared_ptr<kis_tracked_device_base> in_device);
 
     // Get phy views
     std::shared_ptr<device_tracker_view> get_phy_view(int in_phy);
@@ -237,6 +349,8 @@ public:
     }
 
 protected:
+    device_activity_cb device_activity;
+
     std::shared_ptr<entry_tracker> entrytracker;
     std::shared_ptr<packet_chain> packetchain;
     std::shared_ptr<event_bus> eventbus;
@@ -289,6 +403,20 @@ protected:
     int device_idle_expiration;
     int device_idle_timer;
 
+    // Idle timeout forced by the memory governor, or 0
+    std::atomic<int> pressure_idle_expiration;
+
+    // Configured idle timeout or the shorter memory governor timeout, 0 if devices
+    // never expire
+    int effective_idle_expiration() const {
+        int p = pressure_idle_expiration;
+
+        if (p > 0 && (device_idle_expiration <= 0 || p < device_idle_expiration))
+            return p;
+
+        return device_idle_expiration;
+    }
+
     // Minimum number of packets a device may have to be eligible for
     // being timed out
     unsigned int device_idle_min_packets;
@@ -304,8 +432,87 @@ protected:
     std::atomic<time_t> full_refresh_time;
 
     bool track_history_cloud;
+    bool track_location_trail;
     bool track_persource_history;
 
+    // Build each device record in its own arena
+    bool device_arena;
+
+    // Devices idle for longer than device_spill_timeout have the records held only by
+    // the device (phy records, RRDs, location history, and other sub-maps) encoded to
+    // the spill store and freed.  The device stays in the device list, views, and
+    // lookups with its summary fields, and the records are restored when the device
+    // is fetched or seen again.  The store only lives for this run of Kismet, and
+    // is only used under the devicelist lock.
+    int device_spill_timeout;
+    int device_spill_timer;
+
+    std::string spill_dbfile;
+    sqlite3 *spill_db;
+    sqlite3_stmt *spill_insert_stmt, *spill_select_stmt, *spill_delete_stmt;
+
+    void spill_open();
+    void spill_close();
+
+    // Spill idle devices, a limited number per pass
+    void spill_idle_devices();
+
+    void spill_device(std::shared_ptr<kis_tracked_device_base> device);
+    void restore_spilled_device(std::shared_ptr<kis_tracked_device_base> device);
+
+    // Drop the stored records of a device which is being removed
+    void forget_spilled_device(std::shared_ptr<kis_tracked_device_base> device);
+
+    // Every device_snapshot_interval seconds, and at shutdown, the whole device list is
+    // encoded to the snapshot file, and the devices are restored from it when Kismet
+    // starts.  Restored devices keep their user names and tags, so the stored name and
+    // tag queries are only made for devices which are new.  The snapshot is written
+    // in the byte order of the host, and isn't meant to be moved between systems.
+    int device_snapshot_interval;
+    int device_snapshot_timer;
+    unsigned int device_snapshot_max_age;
+    std::string snapshot_file;
+    kis_mutex snapshot_mutex;
+    std::atomic<bool> snapshot_writing;
+
+    void snapshot_init();
+    void load_device_snapshot();
+    std::shared_ptr<kis_tracked_device_base> restore_snapshot_device(const std::string& in_base,
+            const std::string& in_spilled, const tracker_element_id_map& in_ids);
+
+    // Sketched phys, and the sketch of each by phy id; the pressure phys are only
+    // sketched while the memory governor asks for it
+    std::set<std::string> sketch_phys;
+    std::set<std::string> pressure_sketch_phys;
+    std::atomic<bool> pressure_sketch;
+    kis_mutex sketch_mutex;
+    std::map<int, std::shared_ptr<tracked_device_sketch>> sketch_map;
+    std::shared_ptr<tracker_element_vector> sketch_vec;
+    int sketch_entry_id;
+
+    void sketch_init();
+    std::shared_ptr<tracked_device_sketch> fetch_sketch(kis_phy_handler *in_phy, bool in_create);
+
+    // Grouped phys, the groups by id, and the fingerprint index of the groups
+    std::set<std::string> group_phys;
+    bool group_ephemeral;
+    double group_similarity;
+    size_t group_max;
+    kis_mutex group_mutex;
+    std::unordered_map<uint64_t, std::shared_ptr<tracked_device_group>> group_map;
+    device_group_index group_index;
+    uint64_t next_group_id;
+    int group_entry_id;
+    int device_group_id;
+
+    void group_init();
+    void expire_groups_nl();
+
+    // Index of the last location of located devices, for area queries
+    std::shared_ptr<device_geo_index> geo_index;
+
+    void geoindex_init();
+
 	// Common device component
 	int devcomp_ref_common;
 
@@ -336,8 +543,50 @@ protected:
     // Signal threshold
     int device_location_signal_threshold;
 
-	// Tracked devices
-    device_map_t tracked_map;
+    // Tracked devices, partitioned by key hash.  Each shard has its own shared lock so
+    // device lookups never wait on the devicelist lock or on lookups in other shards; 
+    // adding and removing devices happens under the devicelist lock and takes the shard
+    // lock exclusively.  The devicelist lock must never be acquired while holding a
+    // shard lock.  Only lookups are sharded; updating a device, in update_common_device
+    // and the phy handlers, still serializes on the devicelist lock.
+    struct device_shard {
+        kis_shared_mutex mutex;
+        device_map_t devices;
+    };
+
+    static constexpr size_t n_device_shards = 64;
+    std::array<device_shard, n_device_shards> device_shards;
+    std::atomic<size_t> n_tracked_devices;
+
+    // The device key hash leaves the low bits to the phy key, since the mac half keeps 
+    // its mask in the low 16 bits, so mix the mac into every bit before picking a shard
+    device_shard& shard_for(const device_key& in_key) {
+        uint64_t h = in_key.get_spkey() ^ (in_key.get_dkey() >> 16);
+
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        h = h ^ (h >> 31);
+
+        return device_shards[h % n_device_shards];
+    }
+
+    void shard_insert(std::shared_ptr<kis_tracked_device_base> device);
+    void shard_remove(std::shared_ptr<kis_tracked_device_base> device);
+
+    // Every tracked device ordered by last seen time, keyed by the time and internal id,
+    // so idle expiration and the max device limit only visit the devices they remove
+    // instead of scanning and sorting the whole device list.  Devices are indexed when
+    // they are inserted into the shards, re-filed whenever their last seen time
+    // advances, and dropped when they are removed; only used under the devicelist lock.
+    typedef std::pair<time_t, uint64_t> lastseen_key_t;
+    std::map<lastseen_key_t, std::shared_ptr<kis_tracked_device_base>> device_lastseen_index;
+
+    void index_device_lastseen(std::shared_ptr<kis_tracked_device_base> device);
+    void unindex_device_lastseen(std::shared_ptr<kis_tracked_device_base> device);
+
+    // Remove a device from the shards, lookups, change log, and views, and clear its
+    // slot in the immutable vector
+    void expire_device(std::shared_ptr<kis_tracked_device_base> device);
 
     // MAC address lookups are incredibly expensive from the webui if we don't
     // track by map; in theory multiple objects in different PHYs could have the
@@ -352,13 +601,31 @@ protected:
     // List of views using new API as we transition the rest to the new API
     std::shared_ptr<tracker_element_vector> view_vec;
 
+    unsigned int view_work_threads;
+
+    // How long identical view queries may share a result
+    unsigned int view_cache_ms;
+    bool view_search_index;
+
+    // Map tiles below this zoom cluster nearby devices
+    unsigned int view_tile_cluster_zoom;
+
+    // Last assigned modification sequence, and the change log of every device keyed by
+    // its most recent sequence
+    uint64_t device_mod_seq;
+    std::map<uint64_t, std::shared_ptr<kis_tracked_device_base>> device_change_log;
+
     using shared_con = std::shared_ptr<kis_net_beast_httpd_connection>;
     std::shared_ptr<tracker_element> multimac_endp_handler(shared_con con);
     std::shared_ptr<tracker_element> all_phys_endp_handler(shared_con con);
+    std::shared_ptr<tracker_element> memory_devices_endp_handler(shared_con con);
 
     int phy_phyentry_id, phy_phyname_id, phy_devices_count_id, 
         phy_packets_count_id, phy_phyid_id;
 
+    int memory_devices_id, memory_devices_total_id, memory_devices_phys_id,
+        memory_devices_top_id, memory_device_id, memory_device_bytes_id;
+
     // Multikey endpoint
     std::shared_ptr<tracker_element> multikey_endp_handler(shared_con con, bool as_object);
 
@@ -378,8 +645,14 @@ protected:
     time_t last_database_logged;
     std::atomic<bool> databaselog_logging;
 
-    // Do we constrain memory by not tracking RRD data?
+    // Do we constrain memory by not tracking RRD data?  RRDs may also be suspended by
+    // the memory governor
     bool ram_no_rrd;
+    std::atomic<bool> pressure_no_rrd;
+
+    bool no_rrd() const {
+        return ram_no_rrd || pressure_no_rrd;
+    }
 
     // Handle new datasources and create endpoints for them
     void handle_new_datasource_event(std::shared_ptr<eventbus_event> evt);
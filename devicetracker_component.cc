@@ -463,6 +463,8 @@ void kis_tracked_device_base::register_fields() {
     register_field("kismet.device.base.last_time", "last time seen time_t", &last_time);
     register_field("kismet.device.base.mod_time", 
             "timestamp of last seen time (local clock)", &mod_time);
+    register_field("kismet.device.base.mod_seq", 
+            "modification sequence number of last change", &mod_seq);
     register_field("kismet.device.base.packets.total", "total packets seen of all types", &packets);
     register_field("kismet.device.base.packets.llc", "observed protocol control packets", &llc_packets);
     register_field("kismet.device.base.packets.error", "corrupt/error packets", &error_packets);
@@ -516,6 +518,9 @@ void kis_tracked_device_base::register_fields() {
 
     location_cloud_id = register_dynamic_field<kis_location_rrd>(
         "kismet.device.base.location_cloud", "RRD-like location history");
+
+    location_trail_id = register_dynamic_field<kis_location_trail>(
+        "kismet.device.base.location_trail", "decimated location trail");
 }
 
 void kis_tracked_device_base::reserve_fields(std::shared_ptr<tracker_element_map> e) {
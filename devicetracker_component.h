@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <algorithm>
+#include <atomic>
 #include <list>
 #include <map>
 #include <string>
@@ -65,7 +66,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -94,7 +95,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -156,7 +157,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -225,7 +226,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -343,6 +344,7 @@ public:
             __ImportField(first_time, p);
             __ImportField(last_time, p);
             __ImportField(mod_time, p);
+            __ImportField(mod_seq, p);
 
             __ImportField(packets, p);
             __ImportField(llc_packets, p);
@@ -380,6 +382,7 @@ public:
             __ImportId(related_device_group_id, p);
 
             __ImportId(location_cloud_id, p);
+            __ImportId(location_trail_id, p);
 
 
             reserve_fields(nullptr);
@@ -397,7 +400,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -489,7 +492,7 @@ public:
     }
 
 
-    __Proxy(crypt_string, std::string, std::string, std::string, crypt_string);
+    __ProxyInternedString(crypt_string, crypt_string);
 
     __Proxy(basic_crypt_set, uint64_t, uint64_t, uint64_t, basic_crypt_set);
     void add_basic_crypt(uint64_t in) { (*basic_crypt_set) |= in; }
@@ -503,6 +506,10 @@ public:
         set_mod_time(Globalreg::globalreg->last_tv_sec);
     }
 
+    // Global modification sequence, assigned by the devicetracker whenever the device
+    // changes
+    __Proxy(mod_seq, uint64_t, uint64_t, uint64_t, mod_seq);
+
     __Proxy(packets, uint64_t, uint64_t, uint64_t, packets);
     __ProxyIncDec(packets, uint64_t, uint64_t, packets);
 
@@ -530,7 +537,7 @@ public:
     __ProxyFullyDynamicTrackable(location, kis_tracked_location, location_id);
     __ProxyFullyDynamicTrackable(data_rrd, rrdt, data_rrd_id);
 
-    __Proxy(channel, std::string, std::string, std::string, channel);
+    __ProxyInternedString(channel, channel);
     __Proxy(frequency, double, double, double, frequency);
 
     __ProxyTrackable(manuf, tracker_element_string, manuf);
@@ -568,9 +575,81 @@ public:
         kis_internal_id = in_id;
     }
 
+    // Arena holding the device record, if one is used; phy records and other
+    // sub-components attached to the device should be built inside a
+    // tracker_arena_scope for it
+    std::shared_ptr<tracker_arena> get_arena() {
+        return arena;
+    }
+
+    void set_arena(std::shared_ptr<tracker_arena> in_arena) {
+        arena = in_arena;
+    }
+
+    // Device records have been spilled to the on-disk device store and only the
+    // summary fields remain in memory; the device tracker restores them when the
+    // device is fetched or seen again
+    bool get_spilled() const {
+        return spilled;
+    }
+
+    void set_spilled(bool in_spilled) {
+        spilled = in_spilled;
+    }
+
+    // Immutable copy of the device shared by everything serializing it, valid while the
+    // device keeps the modification sequence it was copied at; see
+    // device_tracker::snapshot_device
+    std::shared_ptr<kis_tracked_device_base> get_snapshot(uint64_t in_seq) {
+        if (in_seq == 0 || in_seq != snapshot_seq)
+            return nullptr;
+
+        return snapshot.lock();
+    }
+
+    void set_snapshot(uint64_t in_seq, std::shared_ptr<kis_tracked_device_base> in_snapshot) {
+        snapshot_seq = in_seq;
+        snapshot = in_snapshot;
+    }
+
+    // Serialized devices are cached until the device is next modified; the sequence
+    // of a device which has never been stamped is 0, which isn't cached
+    virtual bool get_serial_cache_key(device_key& key, uint64_t& seq) override {
+        key = get_key();
+        seq = get_mod_seq();
+        return seq != 0;
+    }
+
+    // Estimated memory held by the device, valid while the device keeps the modification
+    // sequence it was measured at, or 0; see device_tracker::device_memory_size
+    size_t get_mem_estimate(uint64_t in_seq) const {
+        if (in_seq == 0 || in_seq != mem_estimate_seq)
+            return 0;
+
+        return mem_estimate;
+    }
+
+    void set_mem_estimate(uint64_t in_seq, size_t in_sz) {
+        mem_estimate_seq = in_seq;
+        mem_estimate = in_sz;
+    }
+
+    // Last seen time the device is filed under in the device tracker expiration index,
+    // or -1 if it is not indexed; see device_tracker::index_device_lastseen
+    time_t get_lastseen_index_time() const {
+        return lastseen_index_time;
+    }
+
+    void set_lastseen_index_time(time_t in_time) {
+        lastseen_index_time = in_time;
+    }
+
     // Optional location cloud
     __ProxyFullyDynamicTrackable(location_cloud, kis_location_rrd, location_cloud_id);
 
+    // Optional decimated location trail
+    __ProxyFullyDynamicTrackable(location_trail, kis_location_trail, location_trail_id);
+
 protected:
     virtual void register_fields() override;
     virtual void reserve_fields(std::shared_ptr<tracker_element_map> e) override;
@@ -581,6 +660,18 @@ protected:
     // up long-running queries.
     uint64_t kis_internal_id;
 
+    std::shared_ptr<tracker_arena> arena;
+
+    std::atomic<bool> spilled{false};
+
+    std::weak_ptr<kis_tracked_device_base> snapshot;
+    uint64_t snapshot_seq{0};
+
+    size_t mem_estimate{0};
+    uint64_t mem_estimate_seq{0};
+
+    time_t lastseen_index_time{-1};
+
     // Unique key
     std::shared_ptr<tracker_element_device_key> key;
 
@@ -621,6 +712,7 @@ protected:
     std::shared_ptr<tracker_element_uint64> first_time;
     std::shared_ptr<tracker_element_uint64> last_time;
     std::shared_ptr<tracker_element_uint64> mod_time;
+    std::shared_ptr<tracker_element_uint64> mod_seq;
 
     // Packet counts
     std::shared_ptr<tracker_element_uint64> packets;
@@ -679,6 +771,7 @@ protected:
     uint16_t related_device_group_id;
 
     uint16_t location_cloud_id;
+    uint16_t location_trail_id;
 };
 
 // Packinfo references
@@ -0,0 +1,296 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "configfile.h"
+#include "devicetracker.h"
+#include "devicetracker_geoindex.h"
+#include "globalregistry.h"
+#include "messagebus.h"
+
+device_geo_index::device_geo_index(double in_cell_deg) :
+    cell_deg{in_cell_deg} {
+
+    geo_mutex.set_name("device_geo_index");
+
+    if (cell_deg <= 0 || cell_deg > 90)
+        cell_deg = DEVICE_GEO_INDEX_CELL;
+
+    n_lat_cells = (int32_t) ceil(180.0 / cell_deg);
+    n_lon_cells = (int32_t) ceil(360.0 / cell_deg);
+}
+
+int32_t device_geo_index::lat_cell(double in_lat) const {
+    auto c = (int32_t) floor((in_lat + 90) / cell_deg);
+    return std::max(0, std::min(c, n_lat_cells - 1));
+}
+
+int32_t device_geo_index::lon_cell(double in_lon) const {
+    auto c = (int32_t) floor((in_lon + 180) / cell_deg);
+    return std::max(0, std::min(c, n_lon_cells - 1));
+}
+
+void device_geo_index::update(std::shared_ptr<kis_tracked_device_base> in_device,
+        double in_lat, double in_lon, time_t in_ts) {
+    if (in_lat < -90 || in_lat > 90 || in_lon < -180 || in_lon > 180)
+        return;
+
+    auto cell = cell_key(lat_cell(in_lat), lon_cell(in_lon));
+    const auto& key = in_device->get_key();
+
+    kis_lock_guard<kis_mutex> lk(geo_mutex, "device_geo_index update");
+
+    auto di = devices.find(key);
+
+    if (di == devices.end()) {
+        devices.emplace(key, entry{cell, in_lat, in_lon, in_ts, in_device});
+        cells[cell].insert(key);
+        return;
+    }
+
+    if (di->second.cell != cell) {
+        auto ci = cells.find(di->second.cell);
+
+        if (ci != cells.end()) {
+            ci->second.erase(key);
+
+            if (ci->second.size() == 0)
+                cells.erase(ci);
+        }
+
+        cells[cell].insert(key);
+        di->second.cell = cell;
+    }
+
+    di->second.lat = in_lat;
+    di->second.lon = in_lon;
+    di->second.ts = in_ts;
+}
+
+void device_geo_index::remove(const device_key& in_key) {
+    kis_lock_guard<kis_mutex> lk(geo_mutex, "device_geo_index remove");
+
+    auto di = devices.find(in_key);
+
+    if (di == devices.end())
+        return;
+
+    auto ci = cells.find(di->second.cell);
+
+    if (ci != cells.end()) {
+        ci->second.erase(in_key);
+
+        if (ci->second.size() == 0)
+            cells.erase(ci);
+    }
+
+    devices.erase(di);
+}
+
+size_t device_geo_index::size() {
+    kis_lock_guard<kis_mutex> lk(geo_mutex, "device_geo_index size");
+    return devices.size();
+}
+
+void device_geo_index::query_box_nl(double in_min_lat, double in_min_lon,
+        double in_max_lat, double in_max_lon, time_t in_since,
+        std::vector<query_result>& ret) {
+
+    auto check_cell = [&](const std::unordered_set<device_key>& in_cell) {
+        for (const auto& k : in_cell) {
+            auto di = devices.find(k);
+
+            if (di == devices.end())
+                continue;
+
+            const auto& e = di->second;
+
+            if (e.ts < in_since)
+                continue;
+
+            if (e.lat < in_min_lat || e.lat > in_max_lat ||
+                    e.lon < in_min_lon || e.lon > in_max_lon)
+                continue;
+
+            auto d = e.device.lock();
+
+            if (d != nullptr)
+                ret.push_back(query_result{d, e.lat, e.lon});
+        }
+    };
+
+    auto lat_min_c = lat_cell(in_min_lat);
+    auto lat_max_c = lat_cell(in_max_lat);
+    auto lon_min_c = lon_cell(in_min_lon);
+    auto lon_max_c = lon_cell(in_max_lon);
+
+    auto n_query_cells = (uint64_t) (lat_max_c - lat_min_c + 1) * (uint64_t) (lon_max_c - lon_min_c + 1);
+
+    // A box covering more cells than are occupied is answered by walking the occupied
+    // cells instead
+    if (n_query_cells > cells.size()) {
+        for (const auto& c : cells) {
+            auto lat_c = (int32_t) (c.first >> 32);
+            auto lon_c = (int32_t) (uint32_t) (c.first & 0xFFFFFFFF);
+
+            if (lat_c < lat_min_c || lat_c > lat_max_c || lon_c < lon_min_c || lon_c > lon_max_c)
+                continue;
+
+            check_cell(c.second);
+        }
+
+        return;
+    }
+
+    for (auto lat_c = lat_min_c; lat_c <= lat_max_c; lat_c++) {
+        for (auto lon_c = lon_min_c; lon_c <= lon_max_c; lon_c++) {
+            auto ci = cells.find(cell_key(lat_c, lon_c));
+
+            if (ci != cells.end())
+                check_cell(ci->second);
+        }
+    }
+}
+
+std::vector<device_geo_index::query_result> device_geo_index::query_box(double in_min_lat,
+        double in_min_lon, double in_max_lat, double in_max_lon, time_t in_since) {
+    std::vector<query_result> ret;
+
+    in_min_lat = std::max(in_min_lat, -90.0);
+    in_max_lat = std::min(in_max_lat, 90.0);
+    in_min_lon = std::max(in_min_lon, -180.0);
+    in_max_lon = std::min(in_max_lon, 180.0);
+
+    if (in_min_lat > in_max_lat)
+        return ret;
+
+    kis_lock_guard<kis_mutex> lk(geo_mutex, "device_geo_index query_box");
+
+    if (in_min_lon > in_max_lon) {
+        query_box_nl(in_min_lat, in_min_lon, in_max_lat, 180, in_since, ret);
+        query_box_nl(in_min_lat, -180, in_max_lat, in_max_lon, in_since, ret);
+    } else {
+        query_box_nl(in_min_lat, in_min_lon, in_max_lat, in_max_lon, in_since, ret);
+    }
+
+    return ret;
+}
+
+std::vector<device_geo_index::query_result> device_geo_index::query_radius(double in_lat,
+        double in_lon, double in_radius_m, time_t in_since) {
+    const double earth_r = 6371008.8;
+    const double deg_m = earth_r * M_PI / 180;
+
+    if (in_radius_m < 0)
+        return {};
+
+    // Bounding box of the circle, then trimmed to the distance
+    auto d_lat = in_radius_m / deg_m;
+    auto min_lat = in_lat - d_lat;
+    auto max_lat = in_lat + d_lat;
+
+    double min_lon, max_lon;
+    auto cos_lat = cos(in_lat * M_PI / 180);
+
+    if (max_lat >= 90 || min_lat <= -90 || cos_lat <= 0 ||
+            in_radius_m / (deg_m * cos_lat) >= 180) {
+        min_lon = -180;
+        max_lon = 180;
+    } else {
+        auto d_lon = in_radius_m / (deg_m * cos_lat);
+
+        min_lon = in_lon - d_lon;
+        max_lon = in_lon + d_lon;
+
+        if (min_lon < -180)
+            min_lon += 360;
+        if (max_lon > 180)
+            max_lon -= 360;
+    }
+
+    auto box = query_box(min_lat, min_lon, max_lat, max_lon, in_since);
+
+    auto lat_r = in_lat * M_PI / 180;
+
+    box.erase(std::remove_if(box.begin(), box.end(),
+                [&](const query_result& r) -> bool {
+                    auto r_lat_r = r.lat * M_PI / 180;
+                    auto h_lat = sin((r_lat_r - lat_r) / 2);
+                    auto h_lon = sin(((r.lon - in_lon) * M_PI / 180) / 2);
+                    auto a = h_lat * h_lat + cos(lat_r) * cos(r_lat_r) * h_lon * h_lon;
+                    auto dist = 2 * earth_r * asin(std::min(1.0, sqrt(a)));
+
+                    return dist > in_radius_m;
+                }), box.end());
+
+    return box;
+}
+
+void device_tracker::geoindex_init() {
+    geo_index =
+        std::make_shared<device_geo_index>(
+                Globalreg::globalreg->kismet_config->fetch_opt_as<double>("tracker_geo_index_cell",
+                    DEVICE_GEO_INDEX_CELL));
+
+    auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
+
+    // Devices within a box (min_lat, min_lon, max_lat, max_lon) or within a radius in
+    // meters of a point (lat, lon, radius), optionally only those located since
+    // last_time; a negative last_time is relative to now
+    httpd->register_route("/devices/by-location/devices", {"POST"}, httpd->RO_ROLE,
+            {"ekjson", "itjson", "msgpack", "dmsgpack"},
+            std::make_shared<kis_net_web_streamed_endpoint>(
+                [this](shared_con con, const kis_net_web_streamed_endpoint::emit_func_t& emit) {
+                    const auto& json = con->json();
+
+                    auto since = json.get("last_time", 0).asInt64();
+
+                    if (since < 0)
+                        since = Globalreg::globalreg->last_tv_sec + since;
+
+                    std::vector<device_geo_index::query_result> located;
+
+                    if (json.isMember("radius")) {
+                        if (!json.isMember("lat") || !json.isMember("lon"))
+                            throw std::runtime_error("radius query requires lat and lon");
+
+                        located = geo_index->query_radius(json["lat"].asDouble(),
+                                json["lon"].asDouble(), json["radius"].asDouble(), since);
+                    } else {
+                        if (!json.isMember("min_lat") || !json.isMember("min_lon") ||
+                                !json.isMember("max_lat") || !json.isMember("max_lon"))
+                            throw std::runtime_error("box query requires min_lat, min_lon, "
+                                    "max_lat, and max_lon");
+
+                        located = geo_index->query_box(json["min_lat"].asDouble(),
+                                json["min_lon"].asDouble(), json["max_lat"].asDouble(),
+                                json["max_lon"].asDouble(), since);
+                    }
+
+                    for (const auto& l : located) {
+                        if (!emit(snapshot_device(l.device)))
+                            break;
+                    }
+                }));
+}
+
@@ -0,0 +1,105 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __DEVICETRACKER_GEOINDEX_H__
+#define __DEVICETRACKER_GEOINDEX_H__
+
+#include "config.h"
+
+#include <stdint.h>
+#include <time.h>
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "kis_mutex.h"
+#include "trackedelement.h"
+
+class kis_tracked_device_base;
+
+// Default size of a grid cell, in degrees
+#define DEVICE_GEO_INDEX_CELL       0.01
+
+// Index of the last known location of devices, as a grid of fixed size cells of
+// latitude and longitude.  The index is updated as device locations change (see
+// device_tracker::update_common_device), so a query for the devices within an area
+// only looks at the cells covering the area instead of every device.
+//
+// The index holds the devices weakly; devices are removed from it when they are
+// removed from the tracker.
+class device_geo_index {
+public:
+    struct query_result {
+        std::shared_ptr<kis_tracked_device_base> device;
+        double lat, lon;
+    };
+
+    device_geo_index(double in_cell_deg = DEVICE_GEO_INDEX_CELL);
+
+    // Move a device to a new location
+    void update(std::shared_ptr<kis_tracked_device_base> in_device, double in_lat, double in_lon,
+            time_t in_ts);
+
+    void remove(const device_key& in_key);
+
+    // Devices within a box, located at or after a time.  Boxes with a min_lon greater
+    // than the max_lon cross the antimeridian.
+    std::vector<query_result> query_box(double in_min_lat, double in_min_lon,
+            double in_max_lat, double in_max_lon, time_t in_since = 0);
+
+    // Devices within a distance, in meters, of a point
+    std::vector<query_result> query_radius(double in_lat, double in_lon, double in_radius_m,
+            time_t in_since = 0);
+
+    size_t size();
+
+    double get_cell_deg() const { return cell_deg; }
+
+protected:
+    struct entry {
+        int64_t cell;
+        double lat, lon;
+        time_t ts;
+        std::weak_ptr<kis_tracked_device_base> device;
+    };
+
+    kis_mutex geo_mutex;
+
+    double cell_deg;
+    int32_t n_lat_cells, n_lon_cells;
+
+    std::unordered_map<device_key, entry> devices;
+    std::unordered_map<int64_t, std::unordered_set<device_key>> cells;
+
+    int32_t lat_cell(double in_lat) const;
+    int32_t lon_cell(double in_lon) const;
+
+    int64_t cell_key(int32_t in_lat_cell, int32_t in_lon_cell) const {
+        return ((int64_t) in_lat_cell << 32) | (uint32_t) in_lon_cell;
+    }
+
+    // Collect devices in a box which does not cross the antimeridian; the geo lock
+    // must be held
+    void query_box_nl(double in_min_lat, double in_min_lon, double in_max_lat,
+            double in_max_lon, time_t in_since, std::vector<query_result>& ret);
+};
+
+#endif
+
@@ -0,0 +1,341 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <algorithm>
+
+#include "configfile.h"
+#include "devicetracker.h"
+#include "devicetracker_group.h"
+#include "globalregistry.h"
+#include "messagebus.h"
+
+device_group_index::signature device_group_index::make_signature(const std::vector<uint64_t>& in_features) {
+    signature sig;
+    sig.fill(UINT64_MAX);
+
+    // Each row is the minimum of a differently seeded remix of the feature hashes
+    for (auto f : in_features) {
+        for (unsigned int i = 0; i < DEVICE_GROUP_HASHES; i++) {
+            auto h = kis_sketch_hash(f ^ (0x9E3779B97F4A7C15ULL * (i + 1)));
+
+            if (h < sig[i])
+                sig[i] = h;
+        }
+    }
+
+    return sig;
+}
+
+double device_group_index::similarity(const signature& a, const signature& b) {
+    unsigned int n = 0;
+
+    for (unsigned int i = 0; i < DEVICE_GROUP_HASHES; i++) {
+        if (a[i] == b[i])
+            n++;
+    }
+
+    return (double) n / DEVICE_GROUP_HASHES;
+}
+
+uint64_t device_group_index::band_key(uint32_t in_phy, unsigned int in_band, const signature& in_sig) {
+    return XXH64(&in_sig[in_band * DEVICE_GROUP_ROWS], sizeof(uint64_t) * DEVICE_GROUP_ROWS,
+            ((uint64_t) in_phy << 32) | in_band);
+}
+
+uint64_t device_group_index::find(uint32_t in_phy, const signature& in_sig,
+        double in_min_similarity) const {
+    uint64_t best = 0;
+    double best_sim = 0;
+
+    for (unsigned int b = 0; b < DEVICE_GROUP_BANDS; b++) {
+        auto bi = buckets.find(band_key(in_phy, b, in_sig));
+
+        if (bi == buckets.end())
+            continue;
+
+        for (auto g : bi->second) {
+            auto si = signatures.find(g);
+
+            if (si == signatures.end() || si->second.phy != in_phy)
+                continue;
+
+            auto sim = similarity(in_sig, si->second.sig);
+
+            if (sim >= in_min_similarity && sim > best_sim) {
+                best = g;
+                best_sim = sim;
+
+                if (sim == 1)
+                    return best;
+            }
+        }
+    }
+
+    return best;
+}
+
+void device_group_index::add(uint32_t in_phy, uint64_t in_group, const signature& in_sig) {
+    signatures[in_group] = group_sig{in_phy, in_sig};
+
+    for (unsigned int b = 0; b < DEVICE_GROUP_BANDS; b++)
+        buckets[band_key(in_phy, b, in_sig)].push_back(in_group);
+}
+
+void device_group_index::remove(uint64_t in_group) {
+    auto si = signatures.find(in_group);
+
+    if (si == signatures.end())
+        return;
+
+    for (unsigned int b = 0; b < DEVICE_GROUP_BANDS; b++) {
+        auto bi = buckets.find(band_key(si->second.phy, b, si->second.sig));
+
+        if (bi == buckets.end())
+            continue;
+
+        auto& v = bi->second;
+        v.erase(std::remove(v.begin(), v.end(), in_group), v.end());
+
+        if (v.size() == 0)
+            buckets.erase(bi);
+    }
+
+    signatures.erase(si);
+}
+
+void tracked_device_group::register_fields() {
+    tracker_component::register_fields();
+
+    register_field("kismet.device_group.id", "group id", &group_id);
+    register_field("kismet.device_group.phyname", "phy name", &phyname);
+    register_field("kismet.device_group.first_time", "first time seen", &first_time);
+    register_field("kismet.device_group.last_time", "last time seen", &last_time);
+    register_field("kismet.device_group.packets", "packets from grouped addresses", &packets);
+    register_field("kismet.device_group.untracked_packets",
+            "packets from grouped addresses without a device record", &untracked_packets);
+    register_field("kismet.device_group.addresses", "estimated distinct addresses", &addresses);
+    register_field("kismet.device_group.last_mac", "last address seen", &last_mac);
+    register_field("kismet.device_group.devices", "grouped devices with device records", &devices);
+
+    device_key_id =
+        register_field("kismet.device_group.device_key",
+                tracker_element_factory<tracker_element_device_key>(),
+                "grouped device key");
+}
+
+void tracked_device_group::add(const mac_addr& in_mac, time_t in_ts, bool in_tracked) {
+    if (get_first_time() == 0 || in_ts < get_first_time())
+        set_first_time(in_ts);
+
+    if (in_ts > get_last_time())
+        set_last_time(in_ts);
+
+    inc_packets();
+
+    if (!in_tracked)
+        inc_untracked_packets();
+
+    set_last_mac(in_mac);
+
+    address_sketch.add(kis_sketch_hash(in_mac.longmac));
+}
+
+void tracked_device_group::add_device(const device_key& in_key) {
+    if (devices->size() >= DEVICE_GROUP_MAX_DEVICES)
+        return;
+
+    for (const auto& d : *devices) {
+        if (std::static_pointer_cast<tracker_element_device_key>(d)->get() == in_key)
+            return;
+    }
+
+    auto k = std::make_shared<tracker_element_device_key>(device_key_id);
+    k->set(in_key);
+    devices->push_back(k);
+}
+
+void tracked_device_group::pre_serialize() {
+    set_addresses(address_sketch.estimate());
+}
+
+void device_tracker::group_init() {
+    group_mutex.set_name("device_tracker::group_mutex");
+
+    auto config = Globalreg::globalreg->kismet_config;
+
+    for (const auto& p : config->fetch_opt_vec("tracker_group_phy"))
+        group_phys.insert(p);
+
+    group_ephemeral = config->fetch_opt_bool("tracker_group_ephemeral", false);
+    group_max = std::max(1U, config->fetch_opt_uint("tracker_group_max", 65536));
+    next_group_id = 1;
+
+    try {
+        group_similarity = config->fetch_opt_as<double>("tracker_group_similarity", 0.9);
+    } catch (const std::runtime_error& e) {
+        _MSG_ERROR("Invalid tracker_group_similarity, expected a fraction between 0 and 1; "
+                "using 0.9");
+        group_similarity = 0.9;
+    }
+
+    group_similarity = std::min(1.0, std::max(1.0 / DEVICE_GROUP_HASHES, group_similarity));
+
+    for (const auto& p : group_phys)
+        _MSG_INFO("Devices of phy {} with randomized addresses will be grouped by fingerprint{}",
+                p, group_ephemeral ? "; grouped devices will not get their own records" : "");
+
+    group_entry_id =
+        entrytracker->register_field("kismet.device_group",
+                tracker_element_factory<tracked_device_group>(),
+                "group of likely-same devices");
+
+    device_group_id =
+        entrytracker->register_field("kismet.device.base.group_id",
+                tracker_element_factory<tracker_element_uint64>(),
+                "group of likely-same devices this device belongs to");
+
+    auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
+
+    httpd->register_route("/devices/groups/all_groups", {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](shared_con con) -> std::shared_ptr<tracker_element> {
+                    auto ret = std::make_shared<tracker_element_vector>();
+
+                    for (const auto& g : group_map)
+                        ret->push_back(g.second);
+
+                    return ret;
+                }, group_mutex));
+
+    httpd->register_route("/devices/groups/by-id/:id/group", {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](shared_con con) -> std::shared_ptr<tracker_element> {
+                    auto id_k = con->uri_params().find(":id");
+                    auto id = string_to_n<uint64_t>(id_k->second);
+
+                    auto gi = group_map.find(id);
+
+                    if (gi == group_map.end())
+                        throw std::runtime_error("unknown device group");
+
+                    return gi->second;
+                }, group_mutex));
+}
+
+bool device_tracker::groups_phy(kis_phy_handler *in_phy) {
+    if (group_phys.size() == 0)
+        return false;
+
+    return group_phys.find(in_phy->fetch_phy_name()) != group_phys.end();
+}
+
+void device_tracker::expire_groups_nl() {
+    // Drop the eighth of the groups idle the longest
+    std::vector<std::pair<time_t, uint64_t>> idle;
+    idle.reserve(group_map.size());
+
+    for (const auto& g : group_map)
+        idle.push_back(std::make_pair(g.second->get_last_time(), g.first));
+
+    auto n = std::max<size_t>(1, idle.size() / 8);
+
+    std::nth_element(idle.begin(), idle.begin() + (n - 1), idle.end());
+
+    for (size_t i = 0; i < n; i++) {
+        group_index.remove(idle[i].second);
+        group_map.erase(idle[i].second);
+    }
+}
+
+bool device_tracker::group_device(kis_phy_handler *in_phy, mac_addr in_mac,
+        const std::vector<uint64_t>& in_features, std::shared_ptr<kis_packet> in_pack,
+        uint64_t& out_group) {
+    out_group = 0;
+
+    if (!groups_phy(in_phy) || in_features.size() == 0)
+        return false;
+
+    auto tracked =
+        fetch_device_nr(device_key(in_phy->fetch_phyname_hash(), in_mac)) != nullptr;
+
+    auto sig = device_group_index::make_signature(in_features);
+
+    kis_lock_guard<kis_mutex> lk(group_mutex, "device_tracker group_device");
+
+    std::shared_ptr<tracked_device_group> group;
+
+    auto group_id = group_index.find(in_phy->fetch_phyname_hash(), sig, group_similarity);
+
+    if (group_id != 0) {
+        group = group_map[group_id];
+    } else {
+        if (group_map.size() >= group_max)
+            expire_groups_nl();
+
+        group_id = next_group_id++;
+
+        group = std::make_shared<tracked_device_group>(group_entry_id);
+        group->set_group_id(group_id);
+        group->set_phyname(in_phy->fetch_phy_name());
+
+        group_map[group_id] = group;
+        group_index.add(in_phy->fetch_phyname_hash(), group_id, sig);
+    }
+
+    out_group = group_id;
+
+    // Once a group has a device record, new addresses are folded into the group
+    // instead of getting records of their own
+    auto fold = group_ephemeral && !tracked && group->num_devices() != 0;
+
+    if (!in_pack->duplicate)
+        group->add(in_mac, in_pack->ts.tv_sec, !fold);
+
+    return fold;
+}
+
+void device_tracker::set_device_group(std::shared_ptr<kis_tracked_device_base> in_device,
+        uint64_t in_group) {
+    if (in_device == nullptr || in_group == 0)
+        return;
+
+    {
+        kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "device_tracker set_device_group");
+
+        auto g = in_device->get_sub_as<tracker_element_uint64>(device_group_id);
+
+        if (g != nullptr && g->get() == in_group)
+            return;
+
+        if (g == nullptr) {
+            g = std::make_shared<tracker_element_uint64>(device_group_id);
+            in_device->insert(g);
+        }
+
+        g->set(in_group);
+    }
+
+    kis_lock_guard<kis_mutex> lk(group_mutex, "device_tracker set_device_group");
+
+    auto gi = group_map.find(in_group);
+
+    if (gi != group_map.end())
+        gi->second->add_device(in_device->get_key());
+}
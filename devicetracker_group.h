@@ -0,0 +1,168 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __DEVICETRACKER_GROUP_H__
+#define __DEVICETRACKER_GROUP_H__
+
+#include "config.h"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "devicetracker_component.h"
+#include "kis_sketch.h"
+#include "macaddr.h"
+#include "trackedcomponent.h"
+#include "xxhash.h"
+
+// MinHash values in a group signature, split into bands of rows for the LSH buckets;
+// two signatures share a bucket when every row of a band matches
+#define DEVICE_GROUP_HASHES         16
+#define DEVICE_GROUP_BANDS          8
+#define DEVICE_GROUP_ROWS           (DEVICE_GROUP_HASHES / DEVICE_GROUP_BANDS)
+
+// Tracked devices listed in a group record; later members are only counted
+#define DEVICE_GROUP_MAX_DEVICES    32
+
+// Precision of the per-group address count (see kis_hll_sketch)
+#define DEVICE_GROUP_PRECISION      6
+
+// Hash of one feature of what a device sends, such as an IE tag and its contents; the
+// kind keeps equal bytes from different kinds of feature apart
+inline uint64_t device_group_feature(uint64_t in_kind, const void *in_data = nullptr,
+        size_t in_len = 0) {
+    return XXH64(in_data, in_len, in_kind);
+}
+
+// Incremental locality sensitive index of device fingerprints
+//
+// A device is described by the set of features of what it sends which stay the same
+// when it changes address: the IE tags of its probe requests, or the structure of its
+// adverts.  The set is reduced to a MinHash signature, where the fraction of matching
+// values estimates the Jaccard similarity of two sets, and each band of the signature
+// is hashed to a bucket.  Looking up a signature only compares it against the groups
+// sharing one of its buckets, so the cost doesn't grow with the number of groups.
+//
+// Not locked; the device tracker holds the group mutex.
+class device_group_index {
+public:
+    using signature = std::array<uint64_t, DEVICE_GROUP_HASHES>;
+
+    static signature make_signature(const std::vector<uint64_t>& in_features);
+
+    // Fraction of matching signature values
+    static double similarity(const signature& a, const signature& b);
+
+    // Most similar group of the phy with at least the minimum similarity, or 0
+    uint64_t find(uint32_t in_phy, const signature& in_sig, double in_min_similarity) const;
+
+    void add(uint32_t in_phy, uint64_t in_group, const signature& in_sig);
+    void remove(uint64_t in_group);
+
+    size_t size() const {
+        return signatures.size();
+    }
+
+protected:
+    static uint64_t band_key(uint32_t in_phy, unsigned int in_band, const signature& in_sig);
+
+    struct group_sig {
+        uint32_t phy;
+        signature sig;
+    };
+
+    std::unordered_map<uint64_t, group_sig> signatures;
+    std::unordered_map<uint64_t, std::vector<uint64_t>> buckets;
+};
+
+// Devices of a phy grouped as likely the same device across address changes (see
+// device_tracker::group_device).  Addresses are counted in a small sketch; the first
+// DEVICE_GROUP_MAX_DEVICES members with device records are listed by key.
+class tracked_device_group : public tracker_component {
+public:
+    tracked_device_group() :
+        tracker_component() {
+        register_fields();
+        reserve_fields(nullptr);
+    }
+
+    tracked_device_group(int in_id) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(nullptr);
+    }
+
+    tracked_device_group(int in_id, std::shared_ptr<tracker_element_map> e) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(e);
+    }
+
+    virtual std::shared_ptr<tracker_element> clone_type() override {
+        using this_t = typename std::remove_pointer<decltype(this)>::type;
+        auto r = std::make_shared<this_t>();
+        r->set_id(this->get_id());
+        return r;
+    }
+
+    virtual ~tracked_device_group() { }
+
+    __Proxy(group_id, uint64_t, uint64_t, uint64_t, group_id);
+    __Proxy(phyname, std::string, std::string, std::string, phyname);
+    __Proxy(first_time, uint64_t, time_t, time_t, first_time);
+    __Proxy(last_time, uint64_t, time_t, time_t, last_time);
+    __Proxy(packets, uint64_t, uint64_t, uint64_t, packets);
+    __ProxyIncDec(packets, uint64_t, uint64_t, packets);
+    __Proxy(untracked_packets, uint64_t, uint64_t, uint64_t, untracked_packets);
+    __ProxyIncDec(untracked_packets, uint64_t, uint64_t, untracked_packets);
+    __Proxy(addresses, uint64_t, uint64_t, uint64_t, addresses);
+    __Proxy(last_mac, mac_addr, mac_addr, mac_addr, last_mac);
+
+    // Count a packet from an address
+    void add(const mac_addr& in_mac, time_t in_ts, bool in_tracked);
+
+    // List a tracked member
+    void add_device(const device_key& in_key);
+
+    size_t num_devices() const {
+        return devices->size();
+    }
+
+    virtual void pre_serialize() override;
+
+protected:
+    virtual void register_fields() override;
+
+    std::shared_ptr<tracker_element_uint64> group_id;
+    std::shared_ptr<tracker_element_string> phyname;
+    std::shared_ptr<tracker_element_uint64> first_time;
+    std::shared_ptr<tracker_element_uint64> last_time;
+    std::shared_ptr<tracker_element_uint64> packets;
+    std::shared_ptr<tracker_element_uint64> untracked_packets;
+    std::shared_ptr<tracker_element_uint64> addresses;
+    std::shared_ptr<tracker_element_mac_addr> last_mac;
+    std::shared_ptr<tracker_element_vector> devices;
+    int device_key_id;
+
+    kis_hll_sketch address_sketch{DEVICE_GROUP_PRECISION};
+};
+
+#endif
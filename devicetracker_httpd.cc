@@ -51,18 +51,19 @@ std::shared_ptr<tracker_element> device_tracker::multimac_endp_handler(shared_co
     auto ret_devices = std::make_shared<tracker_element_vector>();
     auto macs = std::vector<mac_addr>{};
 
-    if (con->json()["devices"].isNull())
-        throw std::runtime_error("Missing 'devices' key in command dictionary");
+    // Device lists can be long; read them from the body without building a document
+    auto found = con->json_strings("devices", [&](const std::string& m) {
+            mac_addr ma{m};
 
-    for (auto m : con->json()["devices"]) {
-        mac_addr ma{m.asString()};
+            if (ma.state.error) 
+                throw std::runtime_error(fmt::format("Invalid MAC address '{}' in 'devices' list",
+                            con->escape_html(m)));
 
-        if (ma.state.error) 
-            throw std::runtime_error(fmt::format("Invalid MAC address '{}' in 'devices' list",
-                        con->escape_html(m.asString())));
+            macs.push_back(ma);
+            });
 
-        macs.push_back(ma);
-    }
+    if (!found)
+        throw std::runtime_error("Missing 'devices' key in command dictionary");
 
     // Duplicate the mac index so that we're 'immune' to things changing it under us; because we
     // may have quite a number of devices in our query list, this is safest.
@@ -72,11 +73,12 @@ std::shared_ptr<tracker_element> device_tracker::multimac_endp_handler(shared_co
         std::multimap<mac_addr, std::shared_ptr<kis_tracked_device_base>>{tracked_mac_multimap};
     devlist_locker.unlock();
 
-    // Pull all the devices out of the list
+    // Pull all the devices out of the list; snapshots are serialized without the
+    // devicelist lock
     for (auto m : macs) {
         const auto& mi = immutable_copy.equal_range(m);
         for (auto msi = mi.first; msi != mi.second; ++msi)
-            ret_devices->push_back(msi->second);
+            ret_devices->push_back(snapshot_device(msi->second));
     }
 
     return ret_devices;
@@ -114,26 +116,115 @@ std::shared_ptr<tracker_element> device_tracker::all_phys_endp_handler(shared_co
     return ret_vec;
 }
 
+std::shared_ptr<tracker_element> device_tracker::memory_devices_endp_handler(shared_con con) {
+    unsigned int top_n = 50;
+
+    auto count_k = con->http_variables().find("count");
+    if (count_k != con->http_variables().end())
+        top_n = string_to_n_dfl<unsigned int>(count_k->second, top_n);
+    else if (con->json().isMember("count"))
+        top_n = con->json()["count"].asUInt();
+
+    kis_lock_guard<kis_mutex> lg(get_devicelist_mutex(), "memory_devices_endp_handler");
+
+    struct phy_memory {
+        uint64_t bytes;
+        uint64_t devices;
+    };
+
+    std::vector<std::pair<size_t, std::shared_ptr<kis_tracked_device_base>>> sized;
+    std::map<int, phy_memory> phy_totals;
+    uint64_t total = 0;
+
+    sized.reserve(immutable_tracked_vec->size());
+
+    for (const auto& i : *immutable_tracked_vec) {
+        auto d = std::static_pointer_cast<kis_tracked_device_base>(i);
+        auto sz = device_memory_size(d);
+
+        auto& pt = phy_totals[d->get_phyid()];
+        pt.bytes += sz;
+        pt.devices++;
+
+        total += sz;
+
+        sized.push_back(std::make_pair(sz, d));
+    }
+
+    if (top_n > sized.size())
+        top_n = sized.size();
+
+    std::partial_sort(sized.begin(), sized.begin() + top_n, sized.end(),
+            [](const std::pair<size_t, std::shared_ptr<kis_tracked_device_base>>& a,
+                const std::pair<size_t, std::shared_ptr<kis_tracked_device_base>>& b) -> bool {
+            return a.first > b.first;
+            });
+
+    auto ret = std::make_shared<tracker_element_map>(memory_devices_id);
+    ret->insert(std::make_shared<tracker_element_uint64>(memory_devices_total_id, total));
+
+    auto phys = std::make_shared<tracker_element_vector>(memory_devices_phys_id);
+    ret->insert(phys);
+
+    for (const auto& p : phy_totals) {
+        auto phy = fetch_phy_handler(p.first);
+
+        auto tracked_phy = std::make_shared<tracker_element_map>(phy_phyentry_id);
+        tracked_phy->insert(std::make_shared<tracker_element_string>(phy_phyname_id,
+                    phy == nullptr ? "UNKNOWN" : phy->fetch_phy_name()));
+        tracked_phy->insert(std::make_shared<tracker_element_uint64>(phy_devices_count_id,
+                    p.second.devices));
+        tracked_phy->insert(std::make_shared<tracker_element_uint64>(memory_device_bytes_id,
+                    p.second.bytes));
+        phys->push_back(tracked_phy);
+    }
+
+    // Report copies of the identifying fields, since the response is serialized after
+    // the devicelist lock is released
+    auto top = std::make_shared<tracker_element_vector>(memory_devices_top_id);
+    ret->insert(top);
+
+    for (unsigned int i = 0; i < top_n; i++) {
+        const auto& d = sized[i].second;
+
+        auto tracked_dev = std::make_shared<tracker_element_map>(memory_device_id);
+        auto tracked_key = std::make_shared<tracker_element_device_key>(d->get_tracker_key()->get_id());
+        tracked_key->set(d->get_key());
+        tracked_dev->insert(tracked_key);
+        tracked_dev->insert(std::make_shared<tracker_element_mac_addr>(
+                    d->get_tracker_macaddr()->get_id(), d->get_macaddr()));
+        tracked_dev->insert(std::make_shared<tracker_element_string>(
+                    d->get_tracker_phyname()->get_id(), d->get_phyname()));
+        tracked_dev->insert(std::make_shared<tracker_element_string>(
+                    d->get_tracker_commonname()->get_id(), d->get_commonname()));
+        tracked_dev->insert(std::make_shared<tracker_element_uint64>(memory_device_bytes_id,
+                    sized[i].first));
+        top->push_back(tracked_dev);
+    }
+
+    return ret;
+}
+
 std::shared_ptr<tracker_element> device_tracker::multikey_endp_handler(shared_con con, bool as_object) {
     auto ret_devices_obj = std::make_shared<tracker_element_device_key_map>();
     auto ret_devices_vec = std::make_shared<tracker_element_vector>();
     auto keys = std::vector<device_key>{};
 
-    if (con->json()["devices"].isNull())
-        throw std::runtime_error("Missing 'devices' key in command dictionary");
+    auto found = con->json_strings("devices", [&](const std::string& k) {
+            device_key ka{k};
 
-    for (auto k : con->json()["devices"]) {
-        device_key ka{k.asString()};
+            if (ka.get_error()) 
+                throw std::runtime_error(fmt::format("Invalid device key '{}' in 'devices' list",
+                            con->escape_html(k)));
 
-        if (ka.get_error()) 
-            throw std::runtime_error(fmt::format("Invalid device key '{}' in 'devices' list",
-                        con->escape_html(k.asString())));
+            keys.push_back(ka);
+            });
 
-        keys.push_back(ka);
-    }
+    if (!found)
+        throw std::runtime_error("Missing 'devices' key in command dictionary");
 
     for (auto k : keys) { 
-        auto d = fetch_device(k);
+        auto d = snapshot_device(fetch_device(k));
 
         if (d == nullptr)
             continue;
@@ -0,0 +1,402 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "configfile.h"
+#include "devicetracker_component.h"
+#include "devicetracker_pkthistory.h"
+#include "kis_datasource.h"
+#include "messagebus.h"
+#include "packetchain.h"
+#include "pcapng_stream_futurebuf.h"
+#include "streamtracker.h"
+#include "timetracker.h"
+#include "util.h"
+
+namespace {
+
+// pcapng writer for stored packets, with an interface per source and DLT
+class pcapng_stream_history : public pcapng_stream_futurebuf {
+public:
+    pcapng_stream_history(future_chainbuf& buffer) :
+        pcapng_stream_futurebuf(buffer, nullptr, nullptr, 1024*512, true) { }
+
+    int write_history_packet(const device_packet_history::history_packet& in_packet,
+            const std::string& in_interface, const std::string& in_desc) {
+        auto h1 = std::hash<unsigned int>{}(in_packet.source_number);
+        auto h2 = std::hash<unsigned int>{}(in_packet.dlt);
+        auto ds_index = h1 ^ (h2 << 1);
+
+        int ng_interface_id;
+
+        auto ds_id_rec = datasource_id_map.find(ds_index);
+
+        if (ds_id_rec == datasource_id_map.end()) {
+            ng_interface_id = pcapng_make_idb(in_packet.source_number, in_interface,
+                    in_desc, in_packet.dlt);
+
+            if (ng_interface_id < 0)
+                return -1;
+        } else {
+            ng_interface_id = ds_id_rec->second;
+        }
+
+        return pcapng_write_packet(ng_interface_id, in_packet.ts, in_packet.data);
+    }
+};
+
+}
+
+device_packet_history::device_packet_history() :
+    lifetime_global(),
+    packets_stored{0},
+    packets_evicted{0},
+    packets_oversized{0},
+    packetchain_id{-1},
+    expire_timer{-1} {
+
+    mutex.set_name("device_packet_history");
+
+    enabled = Globalreg::globalreg->kismet_config->fetch_opt_bool("packet_history", false);
+
+    auto max_mb =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<size_t>("packet_history_mb", 64);
+    auto device_kb =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<size_t>("packet_history_device_kb", 512);
+    max_age =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<time_t>("packet_history_age", 600);
+
+    max_slabs = (max_mb * 1024 * 1024) / slab_size;
+    max_device_slabs = std::max((size_t) 1, (device_kb * 1024) / slab_size);
+
+    if (max_slabs == 0)
+        enabled = false;
+
+    auto packetchain = Globalreg::fetch_mandatory_global_as<packet_chain>();
+
+    pack_comp_device = packetchain->register_packet_component("DEVICE");
+    pack_comp_linkframe = packetchain->register_packet_component("LINKFRAME");
+    pack_comp_datasrc = packetchain->register_packet_component("KISDATASRC");
+
+    if (enabled) {
+        _MSG_INFO("Keeping up to {}KB of recent packets per device, and up to {}MB in total, "
+                "for device pcap history", device_kb, max_mb);
+
+        packetchain_id =
+            packetchain->register_handler([this](std::shared_ptr<kis_packet> in_packet) -> int {
+                    return handle_packet(in_packet);
+                }, CHAINPOS_LOGGING, -50, "device_packet_history");
+
+        if (max_age > 0) {
+            auto timetracker = Globalreg::fetch_mandatory_global_as<time_tracker>();
+
+            expire_timer =
+                timetracker->register_timer(std::chrono::seconds(60), 1,
+                        [this](int) -> int {
+                            expire_packets();
+                            return 1;
+                        });
+        }
+    }
+
+    auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
+
+    httpd->register_route("/devices/by-key/:key/pcap", {"GET"}, httpd->RO_ROLE, {"pcapng"},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return pcap_endp_handler(con);
+                }, nullptr, nullptr, true));
+
+    httpd->register_route("/devices/pcap/history_stats", {"GET"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return get_stats();
+                }));
+}
+
+device_packet_history::~device_packet_history() {
+    Globalreg::globalreg->remove_global(global_name());
+
+    auto packetchain = Globalreg::fetch_global_as<packet_chain>();
+    if (packetchain != nullptr && packetchain_id >= 0)
+        packetchain->remove_handler(packetchain_id, CHAINPOS_LOGGING);
+
+    auto timetracker = Globalreg::fetch_global_as<time_tracker>();
+    if (timetracker != nullptr && expire_timer >= 0)
+        timetracker->remove_timer(expire_timer);
+}
+
+int device_packet_history::handle_packet(std::shared_ptr<kis_packet> in_packet) {
+    // Duplicates of a frame seen by several sources are only kept once
+    if (in_packet->filtered || in_packet->duplicate)
+        return 1;
+
+    auto devinfo = in_packet->fetch<kis_tracked_device_info>(pack_comp_device);
+    auto linkframe = in_packet->fetch<kis_datachunk>(pack_comp_linkframe);
+    auto datasrc = in_packet->fetch<packetchain_comp_datasource>(pack_comp_datasrc);
+
+    if (devinfo == nullptr || linkframe == nullptr || datasrc == nullptr ||
+            datasrc->ref_source == nullptr)
+        return 1;
+
+    if (linkframe->dlt == 0 || linkframe->length() == 0)
+        return 1;
+
+    auto source_number = datasrc->ref_source->get_source_number();
+
+    kis_lock_guard<kis_fast_mutex> lk(mutex, "device_packet_history handle_packet");
+
+    if (linkframe->length() > slab_size) {
+        packets_oversized++;
+        return 1;
+    }
+
+    if (sources.find(source_number) == sources.end())
+        sources[source_number] = source_rec{datasrc->ref_source->get_source_name(),
+            datasrc->ref_source->get_source_interface()};
+
+    // A device can be referenced by more than one address of the same packet
+    std::vector<device_key> stored;
+
+    for (const auto& dri : devinfo->devrefs) {
+        auto key = dri.second->get_key();
+
+        if (std::find(stored.begin(), stored.end(), key) != stored.end())
+            continue;
+
+        stored.push_back(key);
+
+        store_packet(key, in_packet->ts, source_number, linkframe->dlt,
+                linkframe->data(), linkframe->length());
+    }
+
+    return 1;
+}
+
+void device_packet_history::store_packet(const device_key& in_key, const struct timeval& in_ts,
+        uint64_t in_source, int in_dlt, const char *in_data, size_t in_len) {
+    auto& ring = rings[in_key];
+
+    slab *s = nullptr;
+
+    if (!ring.slabs.empty() && slab_size - ring.slabs.back()->used >= in_len)
+        s = ring.slabs.back();
+
+    if (s == nullptr) {
+        if (ring.slabs.size() >= max_device_slabs)
+            release_oldest_slab(ring);
+
+        s = acquire_slab(in_key);
+        s->owner = in_key;
+        ring.slabs.push_back(s);
+    }
+
+    memcpy(s->data.get() + s->used, in_data, in_len);
+
+    ring.records.push_back(record{s, (uint32_t) s->used, (uint32_t) in_len, in_ts, 
+            in_source, in_dlt});
+
+    s->used += in_len;
+    s->last_time = Globalreg::globalreg->last_tv_sec;
+
+    slab_lru.splice(slab_lru.begin(), slab_lru, s->lru_pos);
+
+    packets_stored++;
+}
+
+device_packet_history::slab *device_packet_history::acquire_slab(const device_key& in_key) {
+    if (free_slabs.empty()) {
+        if (all_slabs.size() < max_slabs) {
+            auto s = std::unique_ptr<slab>(new slab());
+            s->data = std::unique_ptr<char[]>(new char[slab_size]);
+            free_slabs.push_back(s.get());
+            all_slabs.push_back(std::move(s));
+        } else {
+            // Slabs of a device are written in order, so the least recently written
+            // slab is always the oldest slab of its device
+            auto victim = rings.find(slab_lru.back()->owner);
+
+            release_oldest_slab(victim->second);
+
+            if (victim->second.slabs.empty() && !(victim->first == in_key))
+                rings.erase(victim);
+        }
+    }
+
+    auto s = free_slabs.back();
+    free_slabs.pop_back();
+
+    s->used = 0;
+    s->last_time = 0;
+
+    slab_lru.push_front(s);
+    s->lru_pos = slab_lru.begin();
+
+    return s;
+}
+
+void device_packet_history::release_oldest_slab(device_ring& ring) {
+    if (ring.slabs.empty())
+        return;
+
+    auto s = ring.slabs.front();
+    ring.slabs.pop_front();
+
+    while (!ring.records.empty() && ring.records.front().s == s) {
+        ring.records.pop_front();
+        packets_evicted++;
+    }
+
+    slab_lru.erase(s->lru_pos);
+    free_slabs.push_back(s);
+}
+
+void device_packet_history::expire_packets() {
+    kis_lock_guard<kis_fast_mutex> lk(mutex, "device_packet_history expire_packets");
+
+    auto expire_time = Globalreg::globalreg->last_tv_sec - max_age;
+
+    while (!slab_lru.empty() && slab_lru.back()->last_time < expire_time) {
+        auto ring = rings.find(slab_lru.back()->owner);
+
+        release_oldest_slab(ring->second);
+
+        if (ring->second.slabs.empty())
+            rings.erase(ring);
+    }
+}
+
+std::vector<device_packet_history::history_packet> device_packet_history::fetch_packets(
+        const device_key& in_key, time_t in_since) {
+    std::vector<history_packet> ret;
+
+    kis_lock_guard<kis_fast_mutex> lk(mutex, "device_packet_history fetch_packets");
+
+    auto ring = rings.find(in_key);
+
+    if (ring == rings.end())
+        return ret;
+
+    for (const auto& r : ring->second.records) {
+        if (r.ts.tv_sec < in_since)
+            continue;
+
+        ret.push_back(history_packet{r.ts, r.source_number, r.dlt, 
+                std::string(r.s->data.get() + r.offset, r.len)});
+    }
+
+    return ret;
+}
+
+std::shared_ptr<tracker_element> device_packet_history::get_stats() {
+    auto ret = std::make_shared<tracker_element_string_map>();
+
+    kis_lock_guard<kis_fast_mutex> lk(mutex, "device_packet_history get_stats");
+
+    ret->insert(std::make_pair("kismet.packet_history.enabled",
+                std::make_shared<tracker_element_uint8>(0, enabled)));
+    ret->insert(std::make_pair("kismet.packet_history.devices",
+                std::make_shared<tracker_element_uint64>(0, rings.size())));
+    ret->insert(std::make_pair("kismet.packet_history.slabs",
+                std::make_shared<tracker_element_uint64>(0, slab_lru.size())));
+    ret->insert(std::make_pair("kismet.packet_history.max_slabs",
+                std::make_shared<tracker_element_uint64>(0, max_slabs)));
+    ret->insert(std::make_pair("kismet.packet_history.slab_size",
+                std::make_shared<tracker_element_uint64>(0, slab_size)));
+    ret->insert(std::make_pair("kismet.packet_history.stored",
+                std::make_shared<tracker_element_uint64>(0, packets_stored)));
+    ret->insert(std::make_pair("kismet.packet_history.evicted",
+                std::make_shared<tracker_element_uint64>(0, packets_evicted)));
+    ret->insert(std::make_pair("kismet.packet_history.oversized",
+                std::make_shared<tracker_element_uint64>(0, packets_oversized)));
+
+    return ret;
+}
+
+void device_packet_history::pcap_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    if (!enabled)
+        throw std::runtime_error("device packet history is not enabled, see 'packet_history' "
+                "in kismet_memory.conf");
+
+    auto key_k = con->uri_params().find(":key");
+    auto devkey = string_to_n<device_key>(key_k->second);
+
+    if (devkey.get_error())
+        throw std::runtime_error("invalid device key");
+
+    // Optionally only the last N seconds
+    time_t since = 0;
+
+    auto seconds_k = con->http_variables().find("seconds");
+    if (seconds_k != con->http_variables().end()) {
+        auto seconds = string_to_n<time_t>(seconds_k->second);
+
+        if (seconds > 0)
+            since = Globalreg::globalreg->last_tv_sec - seconds;
+    }
+
+    // Copy the packets and sources out so the stream doesn't hold the history
+    auto packets = fetch_packets(devkey, since);
+
+    std::unordered_map<uint64_t, source_rec> pkt_sources;
+
+    {
+        kis_lock_guard<kis_fast_mutex> lk(mutex, "device_packet_history pcap sources");
+        pkt_sources = sources;
+    }
+
+    con->clear_timeout();
+    con->set_target_file(fmt::format("kismet-device-{}-history.pcapng", devkey));
+
+    auto pcapng = std::make_shared<pcapng_stream_history>(con->response_stream());
+
+    con->set_closure_cb([pcapng]() { pcapng->stop_stream("http connection lost"); });
+
+    auto streamtracker = Globalreg::fetch_mandatory_global_as<stream_tracker>();
+    auto sid =
+        streamtracker->register_streamer(pcapng, 
+                fmt::format("kismet-device-{}-history.pcapng", devkey),
+                "pcapng", "httpd", 
+                fmt::format("pcapng of packet history for dev key {}", devkey));
+
+    pcapng->start_stream();
+
+    for (const auto& p : packets) {
+        auto si = pkt_sources.find(p.source_number);
+
+        std::string ifname, ifdesc;
+
+        if (si != pkt_sources.end()) {
+            ifname = si->second.name;
+
+            if (si->second.interface.length())
+                ifdesc = fmt::format("capture interface {}", si->second.interface);
+        }
+
+        if (pcapng->write_history_packet(p, ifname, ifdesc) <= 0)
+            break;
+    }
+
+    streamtracker->remove_streamer(sid);
+}
+
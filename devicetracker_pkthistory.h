@@ -0,0 +1,159 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __DEVICETRACKER_PKTHISTORY_H__
+#define __DEVICETRACKER_PKTHISTORY_H__
+
+#include "config.h"
+
+#include <deque>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "globalregistry.h"
+#include "kis_mutex.h"
+#include "kis_net_beast_httpd.h"
+#include "packet.h"
+#include "trackedelement.h"
+
+// Recent packets of each device, in memory
+//
+// With packet_history enabled, the raw link frames of every packet are copied into a
+// ring per device (each device a packet refers to, so a client's packets are kept by
+// both the client and its AP) and can be fetched as a pcapng from
+// /devices/by-key/:key/pcap/history.pcapng, whether or not packets are logged.
+//
+// Packets are stored in fixed size slabs drawn from a shared pool.  The pool is
+// limited to packet_history_mb, and once it's spent the least recently written slab of
+// any device is reused; each device is also limited to packet_history_device_kb, and
+// packets older than packet_history_age seconds are dropped.
+class device_packet_history : public lifetime_global {
+public:
+    static std::string global_name() { return "DEVICE_PACKET_HISTORY"; }
+
+    static std::shared_ptr<device_packet_history> create_packet_history() {
+        std::shared_ptr<device_packet_history> mon(new device_packet_history());
+        Globalreg::globalreg->register_lifetime_global(mon);
+        Globalreg::globalreg->insert_global(global_name(), mon);
+        return mon;
+    }
+
+    static constexpr size_t slab_size = 16384;
+
+private:
+    device_packet_history();
+
+public:
+    virtual ~device_packet_history();
+
+    // Copy of a stored packet
+    struct history_packet {
+        struct timeval ts;
+        uint64_t source_number;
+        int dlt;
+        std::string data;
+    };
+
+    // Packets of a device newer than the given time, oldest first
+    std::vector<history_packet> fetch_packets(const device_key& in_key, time_t in_since);
+
+    std::shared_ptr<tracker_element> get_stats();
+
+protected:
+    struct slab;
+
+    struct record {
+        slab *s;
+        uint32_t offset;
+        uint32_t len;
+        struct timeval ts;
+        uint64_t source_number;
+        int dlt;
+    };
+
+    struct device_ring {
+        // Oldest first
+        std::deque<slab *> slabs;
+        std::deque<record> records;
+    };
+
+    struct slab {
+        std::unique_ptr<char[]> data;
+        size_t used;
+
+        // Time the slab was last written, by the server clock
+        time_t last_time;
+        device_key owner;
+        std::list<slab *>::iterator lru_pos;
+    };
+
+    struct source_rec {
+        std::string name;
+        std::string interface;
+    };
+
+    int handle_packet(std::shared_ptr<kis_packet> in_packet);
+
+    void store_packet(const device_key& in_key, const struct timeval& in_ts,
+            uint64_t in_source, int in_dlt, const char *in_data, size_t in_len);
+
+    // Take a free slab, a new slab, or the least recently written slab of any device,
+    // for the ring of a device; mutex must be held
+    slab *acquire_slab(const device_key& in_key);
+
+    // Drop the oldest slab of a device and its packets, returning the slab to the free
+    // list; mutex must be held
+    void release_oldest_slab(device_ring& ring);
+
+    void expire_packets();
+
+    void pcap_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
+
+    kis_fast_mutex mutex;
+
+    bool enabled;
+
+    size_t max_slabs;
+    size_t max_device_slabs;
+    time_t max_age;
+
+    std::unordered_map<device_key, device_ring> rings;
+
+    // Slabs are kept in the pool once allocated, up to max_slabs
+    std::vector<std::unique_ptr<slab>> all_slabs;
+    std::vector<slab *> free_slabs;
+
+    // Slabs holding packets, most recently written first
+    std::list<slab *> slab_lru;
+
+    std::unordered_map<uint64_t, source_rec> sources;
+
+    uint64_t packets_stored;
+    uint64_t packets_evicted;
+    uint64_t packets_oversized;
+
+    int pack_comp_device, pack_comp_linkframe, pack_comp_datasrc;
+    int packetchain_id;
+    int expire_timer;
+};
+
+#endif
+
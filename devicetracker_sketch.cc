@@ -0,0 +1,243 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include "configfile.h"
+#include "datasourcetracker.h"
+#include "devicetracker.h"
+#include "devicetracker_sketch.h"
+#include "globalregistry.h"
+#include "messagebus.h"
+
+void tracked_device_sketch::register_fields() {
+    tracker_component::register_fields();
+
+    register_field("kismet.sketch.phyname", "phy name", &phyname);
+    register_field("kismet.sketch.packets", "packets from sketched addresses", &packets);
+    register_field("kismet.sketch.addresses", "estimated distinct addresses", &addresses);
+    register_field("kismet.sketch.channels",
+            "estimated distinct addresses per channel", &channel_addresses);
+    register_field("kismet.sketch.datasources",
+            "estimated distinct addresses per datasource", &source_addresses);
+    register_field("kismet.sketch.minutes",
+            "estimated distinct addresses per minute, most recent first", &minute_addresses);
+
+    address_count_id =
+        register_field("kismet.sketch.address_count",
+                tracker_element_factory<tracker_element_uint64>(),
+                "estimated distinct addresses");
+}
+
+void tracked_device_sketch::add(const mac_addr& in_mac, const std::string& in_channel,
+        const uuid& in_source, time_t in_ts) {
+    kis_lock_guard<kis_mutex> lk(sketch_mutex, "tracked_device_sketch add");
+
+    auto h = kis_sketch_hash(in_mac.longmac);
+
+    packets->set(packets->get() + 1);
+
+    all_sketch.add(h);
+    packet_sketch.add(h);
+
+    if (in_channel.length() != 0) {
+        auto ci = channel_sketches.find(in_channel);
+
+        if (ci == channel_sketches.end())
+            ci = channel_sketches.emplace(in_channel,
+                    kis_hll_sketch(DEVICE_SKETCH_SUB_PRECISION)).first;
+
+        ci->second.add(h);
+    }
+
+    if (!in_source.error) {
+        auto si = source_sketches.find(in_source);
+
+        if (si == source_sketches.end())
+            si = source_sketches.emplace(in_source,
+                    kis_hll_sketch(DEVICE_SKETCH_SUB_PRECISION)).first;
+
+        si->second.add(h);
+    }
+
+    auto minute = in_ts / 60;
+    auto slot = minute % DEVICE_SKETCH_MINUTES;
+
+    if (minute_ts[slot] != minute) {
+        minute_sketches[slot].clear();
+        minute_ts[slot] = minute;
+    }
+
+    minute_sketches[slot].add(h);
+}
+
+uint64_t tracked_device_sketch::estimate_packets(const mac_addr& in_mac) {
+    kis_lock_guard<kis_mutex> lk(sketch_mutex, "tracked_device_sketch estimate_packets");
+    return packet_sketch.estimate(kis_sketch_hash(in_mac.longmac));
+}
+
+void tracked_device_sketch::pre_serialize() {
+    kis_lock_guard<kis_mutex> lk(sketch_mutex, "tracked_device_sketch pre_serialize");
+
+    set_addresses(all_sketch.estimate());
+
+    channel_addresses->clear();
+    for (const auto& c : channel_sketches)
+        channel_addresses->insert(c.first,
+                std::make_shared<tracker_element_uint64>(address_count_id, c.second.estimate()));
+
+    source_addresses->clear();
+    for (const auto& s : source_sketches)
+        source_addresses->insert(s.first,
+                std::make_shared<tracker_element_uint64>(address_count_id, s.second.estimate()));
+
+    // Minutes with no sketched packets are reported as 0
+    minute_addresses->clear();
+
+    auto minute = Globalreg::globalreg->last_tv_sec / 60;
+
+    for (unsigned int m = 0; m < DEVICE_SKETCH_MINUTES; m++) {
+        auto slot = (minute - m) % DEVICE_SKETCH_MINUTES;
+        uint64_t e = 0;
+
+        if (minute_ts[slot] == minute - m)
+            e = minute_sketches[slot].estimate();
+
+        minute_addresses->push_back(std::make_shared<tracker_element_uint64>(address_count_id, e));
+    }
+}
+
+void device_tracker::sketch_init() {
+    sketch_mutex.set_name("device_tracker::sketch_mutex");
+
+    for (const auto& p : Globalreg::globalreg->kismet_config->fetch_opt_vec("tracker_sketch_phy"))
+        sketch_phys.insert(p);
+
+    for (const auto& p : sketch_phys)
+        _MSG_INFO("Devices of phy {} with randomized addresses will be counted instead of "
+                "tracked", p);
+
+    auto pressure_phys = Globalreg::globalreg->kismet_config->fetch_opt_vec("memory_governor_sketch_phy");
+
+    if (pressure_phys.size() == 0)
+        pressure_phys.push_back("BTLE");
+
+    for (const auto& p : pressure_phys)
+        pressure_sketch_phys.insert(p);
+
+    sketch_vec = std::make_shared<tracker_element_vector>();
+
+    sketch_entry_id =
+        entrytracker->register_field("kismet.sketch",
+                tracker_element_factory<tracked_device_sketch>(),
+                "sketched device counts");
+
+    auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
+
+    httpd->register_route("/devices/sketches/all_sketches", {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(sketch_vec, sketch_mutex));
+
+    httpd->register_route("/devices/sketches/by-phy/:phyname/mac/:mac/packets",
+            {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](shared_con con) -> std::shared_ptr<tracker_element> {
+                    auto phy_k = con->uri_params().find(":phyname");
+                    auto mac_k = con->uri_params().find(":mac");
+
+                    auto phy = fetch_phy_handler_by_name(phy_k->second);
+
+                    if (phy == nullptr)
+                        throw std::runtime_error("unknown phy");
+
+                    auto mac = string_to_n<mac_addr>(mac_k->second);
+
+                    if (mac.error())
+                        throw std::runtime_error("invalid device MAC");
+
+                    auto sketch = fetch_sketch(phy, false);
+
+                    if (sketch == nullptr)
+                        throw std::runtime_error("phy is not sketched");
+
+                    auto r = std::make_shared<tracker_element_uint64>();
+                    r->set(sketch->estimate_packets(mac));
+                    return r;
+                }));
+}
+
+std::shared_ptr<tracked_device_sketch> device_tracker::fetch_sketch(kis_phy_handler *in_phy,
+        bool in_create) {
+    kis_lock_guard<kis_mutex> lk(sketch_mutex, "device_tracker fetch_sketch");
+
+    auto si = sketch_map.find(in_phy->fetch_phy_id());
+
+    if (si != sketch_map.end())
+        return si->second;
+
+    if (!in_create)
+        return nullptr;
+
+    auto sketch = std::make_shared<tracked_device_sketch>(sketch_entry_id);
+    sketch->set_phyname(in_phy->fetch_phy_name());
+
+    sketch_map[in_phy->fetch_phy_id()] = sketch;
+    sketch_vec->push_back(sketch);
+
+    return sketch;
+}
+
+bool device_tracker::sketch_device(kis_phy_handler *in_phy, mac_addr in_mac,
+        std::shared_ptr<kis_packet> in_pack) {
+    if (sketch_phys.size() == 0 && !pressure_sketch)
+        return false;
+
+    if (sketch_phys.find(in_phy->fetch_phy_name()) == sketch_phys.end() &&
+            (!pressure_sketch ||
+             pressure_sketch_phys.find(in_phy->fetch_phy_name()) == pressure_sketch_phys.end()))
+        return false;
+
+    // Devices which are already tracked keep being tracked
+    if (fetch_device_nr(device_key(in_phy->fetch_phyname_hash(), in_mac)) != nullptr)
+        return false;
+
+    // Duplicates of a packet another source already saw are not counted again
+    if (in_pack->duplicate)
+        return true;
+
+    std::string channel;
+    uuid source_uuid;
+
+    auto pack_l1info = in_pack->fetch<kis_layer1_packinfo>(pack_comp_radiodata);
+    auto pack_common = in_pack->fetch<kis_common_info>(pack_comp_common);
+    auto pack_datasrc = in_pack->fetch<packetchain_comp_datasource>(pack_comp_datasrc);
+
+    if (pack_l1info != nullptr && pack_l1info->channel != "0" && pack_l1info->channel != "")
+        channel = pack_l1info->channel;
+    else if (pack_common != nullptr && pack_common->channel != "0" && pack_common->channel != "")
+        channel = pack_common->channel;
+    else if (pack_l1info != nullptr && pack_l1info->freq_khz != 0)
+        channel = fmt::format("{}", (unsigned int) pack_l1info->freq_khz);
+
+    if (pack_datasrc != nullptr && pack_datasrc->ref_source != nullptr)
+        source_uuid = pack_datasrc->ref_source->get_source_uuid();
+
+    fetch_sketch(in_phy, true)->add(in_mac, channel, source_uuid, in_pack->ts.tv_sec);
+
+    return true;
+}
+
@@ -0,0 +1,115 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __DEVICETRACKER_SKETCH_H__
+#define __DEVICETRACKER_SKETCH_H__
+
+#include "config.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kis_mutex.h"
+#include "kis_sketch.h"
+#include "macaddr.h"
+#include "trackedcomponent.h"
+#include "uuid.h"
+
+// Number of one minute buckets of address counts kept
+#define DEVICE_SKETCH_MINUTES       60
+
+// Precision of the total address sketch, and of the per-channel, per-datasource, 
+// and per-minute sketches (see kis_hll_sketch)
+#define DEVICE_SKETCH_PRECISION     14
+#define DEVICE_SKETCH_SUB_PRECISION 10
+
+// Counts of the devices of a phy which are sketched instead of tracked, such as BTLE
+// and Wi-Fi probing clients using randomized addresses (see device_tracker::sketch_device).
+// A device costs nothing once it has been added; the counts are estimates, refreshed
+// from the sketches when the record is serialized.
+class tracked_device_sketch : public tracker_component {
+public:
+    tracked_device_sketch() :
+        tracker_component() {
+        register_fields();
+        reserve_fields(nullptr);
+    }
+
+    tracked_device_sketch(int in_id) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(nullptr);
+    }
+
+    tracked_device_sketch(int in_id, std::shared_ptr<tracker_element_map> e) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(e);
+    }
+
+    virtual std::shared_ptr<tracker_element> clone_type() override {
+        using this_t = typename std::remove_pointer<decltype(this)>::type;
+        auto r = std::make_shared<this_t>();
+        r->set_id(this->get_id());
+        return r;
+    }
+
+    virtual ~tracked_device_sketch() { }
+
+    __Proxy(phyname, std::string, std::string, std::string, phyname);
+    __Proxy(packets, uint64_t, uint64_t, uint64_t, packets);
+    __Proxy(addresses, uint64_t, uint64_t, uint64_t, addresses);
+
+    // Add a packet from an address
+    void add(const mac_addr& in_mac, const std::string& in_channel, const uuid& in_source,
+            time_t in_ts);
+
+    // Estimated packets seen from an address
+    uint64_t estimate_packets(const mac_addr& in_mac);
+
+    virtual void pre_serialize() override;
+
+protected:
+    virtual void register_fields() override;
+
+    kis_mutex sketch_mutex;
+
+    std::shared_ptr<tracker_element_string> phyname;
+    std::shared_ptr<tracker_element_uint64> packets;
+    std::shared_ptr<tracker_element_uint64> addresses;
+    std::shared_ptr<tracker_element_string_map> channel_addresses;
+    std::shared_ptr<tracker_element_uuid_map> source_addresses;
+    std::shared_ptr<tracker_element_vector> minute_addresses;
+    int address_count_id;
+
+    kis_hll_sketch all_sketch{DEVICE_SKETCH_PRECISION};
+    kis_count_min_sketch packet_sketch;
+
+    std::map<std::string, kis_hll_sketch> channel_sketches;
+    std::map<uuid, kis_hll_sketch> source_sketches;
+
+    // Ring of per-minute sketches, indexed by minute, and the minute each holds
+    std::vector<kis_hll_sketch> minute_sketches = 
+        std::vector<kis_hll_sketch>(DEVICE_SKETCH_MINUTES, kis_hll_sketch(DEVICE_SKETCH_SUB_PRECISION));
+    std::vector<time_t> minute_ts = std::vector<time_t>(DEVICE_SKETCH_MINUTES, 0);
+};
+
+#endif
+
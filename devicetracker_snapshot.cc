@@ -0,0 +1,473 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "configfile.h"
+#include "devicetracker.h"
+#include "globalregistry.h"
+#include "messagebus.h"
+#include "trackedelement_codec.h"
+
+// Snapshot layout, in host byte order:
+//
+//   header     magic, byte order mark, version, write time, offset of the field table
+//   devices    per device: uint32 length, base record, uint32 length, spilled records;
+//              a base length of 0 ends the devices
+//   fields     uint32 count, then per field: uint16 id, uint8 type, uint32 length, name
+//
+// The field table is written last, so it covers any fields registered while the
+// devices were being written.
+static const char device_snapshot_magic[8] = { 'K', 'I', 'S', 'D', 'E', 'V', 'S', 'N' };
+static const uint32_t device_snapshot_bom = 0x01020304;
+static const uint32_t device_snapshot_version = 1;
+
+struct device_snapshot_header {
+    char magic[8];
+    uint32_t bom;
+    uint32_t version;
+    uint64_t write_time;
+    uint64_t fields_offset;
+};
+
+// Devices encoded per hold of the devicelist lock
+#define DEVICE_SNAPSHOT_BATCH       500
+
+static bool snapshot_write_record(FILE *f, const std::string& in_rec) {
+    uint32_t len = in_rec.length();
+
+    if (fwrite(&len, sizeof(len), 1, f) != 1)
+        return false;
+
+    if (len != 0 && fwrite(in_rec.data(), len, 1, f) != 1)
+        return false;
+
+    return true;
+}
+
+// Bounds-checked reader over the mapped snapshot
+class snapshot_reader {
+public:
+    snapshot_reader(const char *in_data, size_t in_len) :
+        data{in_data},
+        len{in_len},
+        pos{0} { }
+
+    template<typename T>
+    T get() {
+        if (pos + sizeof(T) > len)
+            throw std::runtime_error("truncated device snapshot");
+
+        T v;
+        memcpy(&v, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return v;
+    }
+
+    std::string get_bytes(size_t in_n) {
+        if (pos + in_n > len)
+            throw std::runtime_error("truncated device snapshot");
+
+        std::string r(data + pos, in_n);
+        pos += in_n;
+        return r;
+    }
+
+    std::string get_record() {
+        return get_bytes(get<uint32_t>());
+    }
+
+    void seek(size_t in_pos) {
+        if (in_pos > len)
+            throw std::runtime_error("invalid device snapshot offset");
+        pos = in_pos;
+    }
+
+    size_t get_pos() const {
+        return pos;
+    }
+
+protected:
+    const char *data;
+    size_t len;
+    size_t pos;
+};
+
+void device_tracker::snapshot_init() {
+    device_snapshot_timer = -1;
+    snapshot_writing = false;
+
+    device_snapshot_interval =
+        Globalreg::globalreg->kismet_config->fetch_opt_int("tracker_snapshot_interval", 0);
+    device_snapshot_max_age =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("tracker_snapshot_max_age", 0);
+
+    if (device_snapshot_interval <= 0)
+        return;
+
+    snapshot_file = Globalreg::globalreg->kismet_config->fetch_opt("tracker_snapshot_file");
+
+    if (snapshot_file.length() == 0) {
+        auto config_dir_path =
+            Globalreg::globalreg->kismet_config->expand_log_path(
+                    Globalreg::globalreg->kismet_config->fetch_opt("configdir"), "", "", 0, 1);
+        snapshot_file = config_dir_path + "/kismet_device_snapshot.bin";
+    } else {
+        snapshot_file =
+            Globalreg::globalreg->kismet_config->expand_log_path(snapshot_file, "", "", 0, 1);
+    }
+
+    _MSG_INFO("Saving a snapshot of all devices to {} every {} seconds; devices will be "
+            "restored from it when Kismet restarts.", snapshot_file, device_snapshot_interval);
+
+    device_snapshot_timer =
+        timetracker->register_timer(std::chrono::seconds(device_snapshot_interval), 1,
+                [this](int) -> int {
+                    if (snapshot_writing) {
+                        _MSG_ERROR("Attempting to save the device snapshot, but the last "
+                                "snapshot is still being written.  Try increasing "
+                                "'tracker_snapshot_interval' in kismet_memory.conf");
+                        return 1;
+                    }
+
+                    snapshot_writing = true;
+
+                    std::thread t([this] {
+                        write_device_snapshot();
+                        snapshot_writing = false;
+                    });
+
+                    t.detach();
+
+                    return 1;
+                });
+}
+
+void device_tracker::write_device_snapshot() {
+    if (snapshot_file.length() == 0)
+        return;
+
+    kis_lock_guard<kis_mutex> lk(snapshot_mutex, "device_tracker write_device_snapshot");
+
+    auto tmp_file = snapshot_file + ".tmp";
+
+    FILE *f = fopen(tmp_file.c_str(), "wb");
+
+    if (f == nullptr) {
+        _MSG_ERROR("Unable to write the device snapshot to {}: {}", tmp_file,
+                kis_strerror_r(errno));
+        return;
+    }
+
+    device_snapshot_header hdr;
+    memcpy(hdr.magic, device_snapshot_magic, sizeof(hdr.magic));
+    hdr.bom = device_snapshot_bom;
+    hdr.version = device_snapshot_version;
+    hdr.write_time = Globalreg::globalreg->last_tv_sec;
+    hdr.fields_offset = 0;
+
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+
+    size_t n_devices = 0;
+    size_t idx = 0;
+    std::string base, spilled;
+
+    while (ok) {
+        // Encode a batch at a time, so packet processing isn't held off for the whole
+        // device list; the vector only grows, so later devices are picked up by later
+        // batches
+        kis_lock_guard<kis_mutex> dlk(get_devicelist_mutex(), "device_tracker write_device_snapshot");
+
+        if (idx >= immutable_tracked_vec->size())
+            break;
+
+        auto end = std::min(idx + DEVICE_SNAPSHOT_BATCH, immutable_tracked_vec->size());
+
+        for (; idx < end && ok; idx++) {
+            auto d = std::static_pointer_cast<kis_tracked_device_base>((*immutable_tracked_vec)[idx]);
+
+            if (d == nullptr)
+                continue;
+
+            base.clear();
+            spilled.clear();
+
+            if (!tracker_element_encode(d, base))
+                continue;
+
+            // Spilled records are copied from the spill store as they are
+            if (d->get_spilled() && spill_db != nullptr) {
+                auto key = d->get_key().as_string();
+
+                sqlite3_reset(spill_select_stmt);
+                sqlite3_bind_text(spill_select_stmt, 1, key.data(), key.length(), SQLITE_TRANSIENT);
+
+                if (sqlite3_step(spill_select_stmt) == SQLITE_ROW)
+                    spilled.assign((const char *) sqlite3_column_blob(spill_select_stmt, 0),
+                            sqlite3_column_bytes(spill_select_stmt, 0));
+
+                sqlite3_clear_bindings(spill_select_stmt);
+                sqlite3_reset(spill_select_stmt);
+            }
+
+            ok = snapshot_write_record(f, base) && snapshot_write_record(f, spilled);
+            n_devices++;
+        }
+    }
+
+    // End of the devices
+    if (ok)
+        ok = snapshot_write_record(f, "");
+
+    if (ok) {
+        long fields_offset = ftell(f);
+
+        auto fields = entrytracker->get_field_names();
+        uint32_t n_fields = 0;
+
+        std::string table;
+
+        for (const auto& fi : fields) {
+            auto builder = entrytracker->get_field_builder(fi.first);
+
+            if (builder == nullptr)
+                continue;
+
+            uint16_t id = fi.first;
+            uint8_t type = static_cast<uint8_t>(builder->get_type());
+            uint32_t len = fi.second.length();
+
+            table.append((const char *) &id, sizeof(id));
+            table.append((const char *) &type, sizeof(type));
+            table.append((const char *) &len, sizeof(len));
+            table.append(fi.second);
+
+            n_fields++;
+        }
+
+        ok = fwrite(&n_fields, sizeof(n_fields), 1, f) == 1 &&
+            (table.length() == 0 || fwrite(table.data(), table.length(), 1, f) == 1);
+
+        hdr.fields_offset = fields_offset;
+
+        if (ok)
+            ok = fseek(f, 0, SEEK_SET) == 0 && fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+    }
+
+    if (ok)
+        ok = fflush(f) == 0 && fsync(fileno(f)) == 0;
+
+    fclose(f);
+
+    if (!ok || rename(tmp_file.c_str(), snapshot_file.c_str()) != 0) {
+        _MSG_ERROR("Unable to write the device snapshot to {}: {}", snapshot_file,
+                kis_strerror_r(errno));
+        unlink(tmp_file.c_str());
+        return;
+    }
+
+    _MSG_DEBUG("Saved {} devices to the device snapshot {}", n_devices, snapshot_file);
+}
+
+void device_tracker::load_device_snapshot() {
+    if (snapshot_file.length() == 0)
+        return;
+
+    int fd = open(snapshot_file.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        if (errno != ENOENT)
+            _MSG_ERROR("Unable to open the device snapshot {}: {}", snapshot_file,
+                    kis_strerror_r(errno));
+        return;
+    }
+
+    struct stat sb;
+
+    if (fstat(fd, &sb) < 0 || sb.st_size < (off_t) sizeof(device_snapshot_header)) {
+        _MSG_ERROR("Ignoring the device snapshot {}, it is empty or unreadable", snapshot_file);
+        close(fd);
+        return;
+    }
+
+    // The snapshot is mapped rather than read, so only the page cache holds the
+    // encoded devices while they are restored
+    void *map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        _MSG_ERROR("Unable to map the device snapshot {}: {}", snapshot_file,
+                kis_strerror_r(errno));
+        return;
+    }
+
+    madvise(map, sb.st_size, MADV_SEQUENTIAL);
+
+    size_t n_restored = 0, n_skipped = 0;
+
+    try {
+        snapshot_reader rd((const char *) map, sb.st_size);
+
+        auto hdr = rd.get<device_snapshot_header>();
+
+        if (memcmp(hdr.magic, device_snapshot_magic, sizeof(hdr.magic)) != 0 ||
+                hdr.bom != device_snapshot_bom || hdr.version != device_snapshot_version)
+            throw std::runtime_error("not a device snapshot from this version of Kismet "
+                    "on this system");
+
+        if (hdr.fields_offset == 0)
+            throw std::runtime_error("incomplete device snapshot");
+
+        time_t now = Globalreg::globalreg->last_tv_sec;
+
+        if (device_snapshot_max_age > 0 && now > (time_t) hdr.write_time &&
+                now - (time_t) hdr.write_time > (time_t) device_snapshot_max_age) {
+            _MSG_INFO("Not restoring devices from the device snapshot {}, it is older "
+                    "than tracker_snapshot_max_age", snapshot_file);
+            munmap(map, sb.st_size);
+            return;
+        }
+
+        // Map the field ids of the writing run to this run, by name; fields which
+        // aren't registered now, or changed type, are skipped
+        tracker_element_id_map ids;
+
+        auto devices_pos = rd.get_pos();
+        rd.seek(hdr.fields_offset);
+
+        auto n_fields = rd.get<uint32_t>();
+
+        for (uint32_t n = 0; n < n_fields; n++) {
+            auto id = rd.get<uint16_t>();
+            auto type = rd.get<uint8_t>();
+            auto name = rd.get_record();
+
+            auto cur_id = entrytracker->get_field_id(name);
+
+            if (cur_id == (uint16_t) -1)
+                continue;
+
+            auto builder = entrytracker->get_field_builder(cur_id);
+
+            if (builder == nullptr || static_cast<uint8_t>(builder->get_type()) != type)
+                continue;
+
+            ids[id] = cur_id;
+        }
+
+        rd.seek(devices_pos);
+
+        while (true) {
+            auto base = rd.get_record();
+
+            if (base.length() == 0)
+                break;
+
+            auto spilled = rd.get_record();
+
+            std::shared_ptr<kis_tracked_device_base> device;
+
+            // A malformed record only loses that device
+            try {
+                device = restore_snapshot_device(base, spilled, ids);
+            } catch (const std::runtime_error&) {
+                device = nullptr;
+            }
+
+            if (device == nullptr) {
+                n_skipped++;
+                continue;
+            }
+
+            n_restored++;
+        }
+    } catch (const std::runtime_error& e) {
+        _MSG_ERROR("Unable to restore devices from the device snapshot {}: {}",
+                snapshot_file, e.what());
+    }
+
+    munmap(map, sb.st_size);
+
+    if (n_restored != 0 || n_skipped != 0)
+        _MSG_INFO("Restored {} devices from the device snapshot {}{}", n_restored, snapshot_file,
+                n_skipped != 0 ? fmt::format(", skipped {} devices which could not be restored",
+                    n_skipped) : "");
+}
+
+std::shared_ptr<kis_tracked_device_base> device_tracker::restore_snapshot_device(
+        const std::string& in_base, const std::string& in_spilled,
+        const tracker_element_id_map& in_ids) {
+
+    std::shared_ptr<tracker_arena> arena;
+
+    if (device_arena)
+        arena = std::make_shared<tracker_arena>();
+
+    std::shared_ptr<kis_tracked_device_base> device;
+
+    {
+        tracker_arena_scope as(arena);
+        device = tracker_arena_make_shared<kis_tracked_device_base>(device_builder.get());
+    }
+
+    device->set_arena(arena);
+
+    size_t pos = 0;
+    tracker_element_decode(in_base, pos, in_ids, device);
+
+    if (in_spilled.length() != 0) {
+        pos = 0;
+        tracker_element_decode(in_spilled, pos, in_ids, device);
+    }
+
+    // Phy ids are assigned as phys are registered; devices of phys which aren't loaded
+    // now can't be restored
+    auto phy = fetch_phy_handler_by_name(device->get_phyname());
+
+    if (phy == nullptr || device->get_key().get_error())
+        return nullptr;
+
+    if (fetch_device_nr(device->get_key()) != nullptr)
+        return nullptr;
+
+    device->set_phyid(phy->fetch_phy_id());
+    device->set_tracker_phyname(get_cached_phyname(phy->fetch_phy_name()));
+    device->set_tracker_type_string(get_cached_devicetype(device->get_type_string()));
+    device->set_server_uuid(Globalreg::globalreg->server_uuid);
+
+    // Sequences of the writing run mean nothing to this one
+    device->set_mod_seq(0);
+
+    add_device(device);
+    stamp_device_modified(device);
+    new_view_device(device);
+
+    return device;
+}
@@ -0,0 +1,259 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "configfile.h"
+#include "devicetracker.h"
+#include "globalregistry.h"
+#include "messagebus.h"
+#include "trackedelement_codec.h"
+
+// Maximum number of devices spilled in a single pass of the spill timer, so that a
+// large number of devices going idle at once doesn't hold the devicelist lock for long
+#define DEVICE_SPILL_PASS_MAX       1000
+
+static bool spill_container_type(tracker_type t) {
+    switch (t) {
+        case tracker_type::tracker_vector:
+        case tracker_type::tracker_vector_double:
+        case tracker_type::tracker_vector_string:
+        case tracker_type::tracker_map:
+        case tracker_type::tracker_int_map:
+        case tracker_type::tracker_hashkey_map:
+        case tracker_type::tracker_double_map:
+        case tracker_type::tracker_mac_map:
+        case tracker_type::tracker_string_map:
+        case tracker_type::tracker_key_map:
+        case tracker_type::tracker_uuid_map:
+        case tracker_type::tracker_double_map_double:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void device_tracker::spill_open() {
+    spill_dbfile = Globalreg::globalreg->kismet_config->fetch_opt("tracker_spill_file");
+
+    if (spill_dbfile.length() == 0) {
+        auto config_dir_path =
+            Globalreg::globalreg->kismet_config->expand_log_path(
+                    Globalreg::globalreg->kismet_config->fetch_opt("configdir"), "", "", 0, 1);
+        spill_dbfile = config_dir_path + "/kismet_device_spill.db3";
+    } else {
+        spill_dbfile =
+            Globalreg::globalreg->kismet_config->expand_log_path(spill_dbfile, "", "", 0, 1);
+    }
+
+    // Records in the store are only meaningful to the server which wrote them
+    unlink(spill_dbfile.c_str());
+
+    int r = sqlite3_open_v2(spill_dbfile.c_str(), &spill_db,
+            SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+
+    if (r != SQLITE_OK) {
+        _MSG_ERROR("Unable to open device spill store {}: {}; idle devices will not "
+                "be spilled.", spill_dbfile, sqlite3_errmsg(spill_db));
+        spill_close();
+        return;
+    }
+
+    // Nothing in the store needs to survive a crash
+    const char *setup =
+        "PRAGMA journal_mode=OFF; "
+        "PRAGMA synchronous=OFF; "
+        "CREATE TABLE spill (devkey TEXT PRIMARY KEY, records BLOB)";
+
+    char *err = NULL;
+
+    r = sqlite3_exec(spill_db, setup, NULL, NULL, &err);
+
+    if (r != SQLITE_OK) {
+        _MSG_ERROR("Unable to create device spill store {}: {}; idle devices will not "
+                "be spilled.", spill_dbfile, err);
+        sqlite3_free(err);
+        spill_close();
+        return;
+    }
+
+    if (sqlite3_prepare_v2(spill_db,
+                "INSERT OR REPLACE INTO spill (devkey, records) VALUES (?, ?)",
+                -1, &spill_insert_stmt, NULL) != SQLITE_OK ||
+            sqlite3_prepare_v2(spill_db,
+                "SELECT records FROM spill WHERE devkey = ?",
+                -1, &spill_select_stmt, NULL) != SQLITE_OK ||
+            sqlite3_prepare_v2(spill_db,
+                "DELETE FROM spill WHERE devkey = ?",
+                -1, &spill_delete_stmt, NULL) != SQLITE_OK) {
+        _MSG_ERROR("Unable to prepare device spill store {}: {}; idle devices will not "
+                "be spilled.", spill_dbfile, sqlite3_errmsg(spill_db));
+        spill_close();
+        return;
+    }
+}
+
+void device_tracker::spill_close() {
+    if (spill_insert_stmt != nullptr)
+        sqlite3_finalize(spill_insert_stmt);
+    if (spill_select_stmt != nullptr)
+        sqlite3_finalize(spill_select_stmt);
+    if (spill_delete_stmt != nullptr)
+        sqlite3_finalize(spill_delete_stmt);
+
+    spill_insert_stmt = spill_select_stmt = spill_delete_stmt = nullptr;
+
+    if (spill_db != nullptr) {
+        sqlite3_close(spill_db);
+        spill_db = nullptr;
+
+        unlink(spill_dbfile.c_str());
+    }
+}
+
+void device_tracker::spill_idle_devices() {
+    kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "device_tracker spill_idle_devices");
+
+    if (spill_db == nullptr)
+        return;
+
+    time_t ts_now = Globalreg::globalreg->last_tv_sec;
+    unsigned int n_spilled = 0;
+
+    sqlite3_exec(spill_db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+
+    for (const auto& i : *immutable_tracked_vec) {
+        if (n_spilled >= DEVICE_SPILL_PASS_MAX)
+            break;
+
+        auto d = std::static_pointer_cast<kis_tracked_device_base>(i);
+
+        if (d == nullptr || d->get_spilled())
+            continue;
+
+        if (ts_now - d->get_last_time() < device_spill_timeout)
+            continue;
+
+        spill_device(d);
+        n_spilled++;
+    }
+
+    sqlite3_exec(spill_db, "COMMIT TRANSACTION", NULL, NULL, NULL);
+}
+
+void device_tracker::spill_device(std::shared_ptr<kis_tracked_device_base> device) {
+    // Only records held solely by the device map can be released; anything the device
+    // or another part of Kismet holds a pointer to stays in memory
+    auto spill = std::make_shared<tracker_element_map>(device->get_id());
+
+    for (const auto& f : *device) {
+        if (f.second == nullptr || !spill_container_type(f.second->get_type()))
+            continue;
+
+        if (f.second.use_count() != 1)
+            continue;
+
+        spill->insert(f.second);
+    }
+
+    if (spill->size() != 0) {
+        std::string records;
+
+        if (!tracker_element_encode(spill, records))
+            return;
+
+        auto key = device->get_key().as_string();
+
+        sqlite3_reset(spill_insert_stmt);
+        sqlite3_bind_text(spill_insert_stmt, 1, key.data(), key.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_blob(spill_insert_stmt, 2, records.data(), records.length(), SQLITE_STATIC);
+
+        int r = sqlite3_step(spill_insert_stmt);
+        sqlite3_clear_bindings(spill_insert_stmt);
+
+        if (r != SQLITE_DONE) {
+            _MSG_ERROR("Unable to spill device {} to {}: {}", key, spill_dbfile,
+                    sqlite3_errmsg(spill_db));
+            return;
+        }
+
+        for (const auto& f : *spill)
+            device->erase(device->find(f.first));
+
+        device->set_mem_estimate(0, 0);
+    }
+
+    // Devices with nothing to spill are still flagged, so they aren't examined again
+    // until they've been seen
+    device->set_spilled(true);
+}
+
+void device_tracker::restore_spilled_device(std::shared_ptr<kis_tracked_device_base> device) {
+    kis_lock_guard<kis_mutex> lk(get_devicelist_mutex(), "device_tracker restore_spilled_device");
+
+    if (!device->get_spilled())
+        return;
+
+    device->set_spilled(false);
+    device->set_mem_estimate(0, 0);
+
+    if (spill_db == nullptr)
+        return;
+
+    auto key = device->get_key().as_string();
+
+    sqlite3_reset(spill_select_stmt);
+    sqlite3_bind_text(spill_select_stmt, 1, key.data(), key.length(), SQLITE_TRANSIENT);
+
+    if (sqlite3_step(spill_select_stmt) == SQLITE_ROW) {
+        std::string records((const char *) sqlite3_column_blob(spill_select_stmt, 0),
+                sqlite3_column_bytes(spill_select_stmt, 0));
+
+        try {
+            size_t pos = 0;
+            tracker_element_decode(records, pos, device);
+        } catch (const std::runtime_error& e) {
+            _MSG_ERROR("Unable to restore spilled device {} from {}: {}", key,
+                    spill_dbfile, e.what());
+        }
+    }
+
+    sqlite3_clear_bindings(spill_select_stmt);
+    sqlite3_reset(spill_select_stmt);
+
+    forget_spilled_device(device);
+}
+
+void device_tracker::forget_spilled_device(std::shared_ptr<kis_tracked_device_base> device) {
+    if (spill_db == nullptr)
+        return;
+
+    auto key = device->get_key().as_string();
+
+    sqlite3_reset(spill_delete_stmt);
+    sqlite3_bind_text(spill_delete_stmt, 1, key.data(), key.length(), SQLITE_TRANSIENT);
+    sqlite3_step(spill_delete_stmt);
+    sqlite3_clear_bindings(spill_delete_stmt);
+}
+
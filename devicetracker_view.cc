@@ -22,19 +22,759 @@
 #include <execution>
 #endif
 
+#include <array>
+#include <cmath>
+#include <iterator>
+#include <unordered_set>
+
 #include "devicetracker_view.h"
 #include "devicetracker.h"
 #include "devicetracker_component.h"
 #include "util.h"
+#include "xxhash.h"
 
 #include "kis_mutex.h"
 #include "kismet_algorithm.h"
+#include "alphanum.hpp"
+
+// Request cost charged to the client quota for each device a regex filter examines;
+// other filters, sorting, and serializing are charged one unit per device
+static const uint64_t regex_cost_units = 4;
+
+bool device_tracker_view_index::key_less(const index_key& a, const index_key& b) {
+    if (a.present != b.present)
+        return !a.present;
+
+    if (a.num != b.num)
+        return a.num < b.num;
+
+    // Match the natural ordering of string fields
+    auto sc = doj::alphanum_comp(a.str, b.str);
+    if (sc != 0)
+        return sc < 0;
+
+    return a.key < b.key;
+}
+
+bool device_tracker_view_index::key_equal(const index_key& a, const index_key& b) {
+    return a.present == b.present && a.num == b.num && a.str == b.str && a.key == b.key;
+}
+
+device_tracker_view_index::index_key 
+device_tracker_view_index::make_key(const std::shared_ptr<kis_tracked_device_base>& device) const {
+    index_key k{false, 0, "", device->get_key()};
+
+    auto f = get_tracker_element_path(path_, device);
+
+    if (f == nullptr)
+        return k;
+
+    k.present = true;
+
+    switch (f->get_type()) {
+        case tracker_type::tracker_string:
+            k.str = static_cast<tracker_element_string *>(f.get())->get();
+            break;
+        case tracker_type::tracker_int8:
+            k.num = static_cast<tracker_element_int8 *>(f.get())->get();
+            break;
+        case tracker_type::tracker_uint8:
+            k.num = static_cast<tracker_element_uint8 *>(f.get())->get();
+            break;
+        case tracker_type::tracker_int16:
+            k.num = static_cast<tracker_element_int16 *>(f.get())->get();
+            break;
+        case tracker_type::tracker_uint16:
+            k.num = static_cast<tracker_element_uint16 *>(f.get())->get();
+            break;
+        case tracker_type::tracker_int32:
+            k.num = static_cast<tracker_element_int32 *>(f.get())->get();
+            break;
+        case tracker_type::tracker_uint32:
+            k.num = static_cast<tracker_element_uint32 *>(f.get())->get();
+            break;
+        case tracker_type::tracker_int64:
+            k.num = static_cast<tracker_element_int64 *>(f.get())->get();
+            break;
+        case tracker_type::tracker_uint64:
+            k.num = static_cast<int64_t>(static_cast<tracker_element_uint64 *>(f.get())->get());
+            break;
+        default:
+            k.present = false;
+            break;
+    }
+
+    return k;
+}
+
+size_t device_tracker_view_index::find_block(const index_key& k) const {
+    // First block whose last entry is not less than the key, or the last block
+    auto bi = std::lower_bound(blocks.begin(), blocks.end(), k,
+            [](const std::vector<index_entry>& b, const index_key& k) -> bool {
+                return key_less(b.back().key, k);
+            });
+
+    if (bi == blocks.end())
+        return blocks.size() - 1;
+
+    return bi - blocks.begin();
+}
+
+void device_tracker_view_index::insert_key(const index_key& k, 
+        std::shared_ptr<kis_tracked_device_base> device) {
+    if (blocks.size() == 0) {
+        blocks.emplace_back();
+        blocks.back().reserve(block_max);
+    }
+
+    auto bn = find_block(k);
+    auto& b = blocks[bn];
+
+    auto ei = std::lower_bound(b.begin(), b.end(), k,
+            [](const index_entry& e, const index_key& k) -> bool {
+                return key_less(e.key, k);
+            });
+
+    b.insert(ei, index_entry{k, device});
+    n_entries++;
+
+    // Split full blocks in half
+    if (b.size() > block_max) {
+        std::vector<index_entry> upper;
+        upper.reserve(block_max);
+        upper.insert(upper.end(), std::make_move_iterator(b.begin() + b.size() / 2),
+                std::make_move_iterator(b.end()));
+        b.resize(b.size() / 2);
+        blocks.insert(blocks.begin() + bn + 1, std::move(upper));
+    }
+}
+
+void device_tracker_view_index::remove_key(const index_key& k) {
+    if (blocks.size() == 0)
+        return;
+
+    auto bn = find_block(k);
+    auto& b = blocks[bn];
+
+    auto ei = std::lower_bound(b.begin(), b.end(), k,
+            [](const index_entry& e, const index_key& k) -> bool {
+                return key_less(e.key, k);
+            });
+
+    if (ei == b.end() || !key_equal(ei->key, k))
+        return;
+
+    b.erase(ei);
+    n_entries--;
+
+    if (b.size() == 0)
+        blocks.erase(blocks.begin() + bn);
+}
+
+void device_tracker_view_index::insert(std::shared_ptr<kis_tracked_device_base> device) {
+    if (indexed_keys.find(device->get_key()) != indexed_keys.end())
+        return update(device);
+
+    auto k = make_key(device);
+    indexed_keys[device->get_key()] = k;
+    insert_key(k, device);
+}
+
+void device_tracker_view_index::remove(std::shared_ptr<kis_tracked_device_base> device) {
+    auto ki = indexed_keys.find(device->get_key());
+
+    if (ki == indexed_keys.end())
+        return;
+
+    remove_key(ki->second);
+    indexed_keys.erase(ki);
+}
+
+void device_tracker_view_index::update(std::shared_ptr<kis_tracked_device_base> device) {
+    auto ki = indexed_keys.find(device->get_key());
+
+    if (ki == indexed_keys.end())
+        return insert(device);
+
+    auto k = make_key(device);
+
+    if (key_equal(k, ki->second))
+        return;
+
+    remove_key(ki->second);
+    ki->second = k;
+    insert_key(k, device);
+}
+
+void device_tracker_view_index::walk(bool descending, size_t offset,
+        const std::function<bool (const std::shared_ptr<kis_tracked_device_base>&)>& cb) const {
+    if (offset >= n_entries)
+        return;
+
+    if (!descending) {
+        size_t bn = 0;
+
+        while (bn < blocks.size() && offset >= blocks[bn].size()) 
+            offset -= blocks[bn++].size();
+
+        for (; bn < blocks.size(); bn++, offset = 0) {
+            for (size_t i = offset; i < blocks[bn].size(); i++) {
+                if (!cb(blocks[bn][i].device))
+                    return;
+            }
+        }
+    } else {
+        size_t bn = blocks.size();
+
+        while (bn > 0 && offset >= blocks[bn - 1].size())
+            offset -= blocks[--bn].size();
+
+        for (; bn > 0; bn--, offset = 0) {
+            const auto& b = blocks[bn - 1];
+
+            for (size_t i = b.size() - offset; i > 0; i--) {
+                if (!cb(b[i - 1].device))
+                    return;
+            }
+        }
+    }
+}
+
+size_t device_tracker_view_index::count_at_least(int64_t in_val) const {
+    if (n_entries == 0)
+        return 0;
+
+    // Smallest possible key with this value
+    index_key k{true, in_val, "", device_key()};
+
+    auto bn = find_block(k);
+
+    size_t rank = 0;
+    for (size_t i = 0; i < bn; i++)
+        rank += blocks[i].size();
+
+    const auto& b = blocks[bn];
+    auto ei = std::lower_bound(b.begin(), b.end(), k,
+            [](const index_entry& e, const index_key& k) -> bool {
+                return key_less(e.key, k);
+            });
+
+    rank += ei - b.begin();
+
+    return n_entries - rank;
+}
+
+void device_tracker_view_search_index::text_grams(const std::string& in_text, 
+        std::vector<gram>& grams) {
+    if (in_text.length() < 3)
+        return;
+
+    // Fold the same way the icasestringmatch worker compares
+    auto fold = [](char c) -> gram {
+        return static_cast<uint8_t>(std::toupper(static_cast<unsigned char>(c)));
+    };
+
+    gram g = (fold(in_text[0]) << 8) | fold(in_text[1]);
+
+    for (size_t i = 2; i < in_text.length(); i++) {
+        g = ((g << 8) | fold(in_text[i])) & 0xFFFFFF;
+        grams.push_back(g);
+    }
+}
+
+void device_tracker_view_search_index::mac_grams(const uint8_t *in_bytes, size_t in_len,
+        std::vector<gram>& grams) {
+    // Tagged by length so they never collide with text trigrams
+    for (size_t l = 1; l <= 3 && l <= in_len; l++) {
+        for (size_t p = 0; p + l <= in_len; p++) {
+            gram g = 0;
+
+            for (size_t b = 0; b < l; b++)
+                g = (g << 8) | in_bytes[p + b];
+
+            grams.push_back(static_cast<gram>(0x10 | l) << 24 | g);
+        }
+    }
+}
+
+std::vector<device_tracker_view_search_index::gram> 
+device_tracker_view_search_index::make_grams(const std::shared_ptr<kis_tracked_device_base>& device) const {
+    std::vector<gram> grams;
+
+    // Extract the same text from each field as the icasestringmatch worker
+    for (const auto& p : paths_) {
+        auto field = get_tracker_element_path(p, device);
+        std::string val;
+
+        if (field == nullptr)
+            continue;
+
+        switch (field->get_type()) {
+            case tracker_type::tracker_string:
+                text_grams(get_tracker_value<std::string>(field), grams);
+                break;
+            case tracker_type::tracker_byte_array:
+                text_grams(std::static_pointer_cast<tracker_element_byte_array>(field)->get(), grams);
+                break;
+            case tracker_type::tracker_mac_addr:
+                {
+                    // Partial mac searches compare the bytes of the mac as stored
+                    auto longmac = std::static_pointer_cast<tracker_element_mac_addr>(field)->get().longmac;
+                    mac_grams(reinterpret_cast<const uint8_t *>(&longmac), MAC_LEN_MAX, grams);
+                }
+                break;
+            default:
+                if (Globalreg::globalreg->entrytracker->search_xform(field, val))
+                    text_grams(val, grams);
+                break;
+        }
+    }
+
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+    return grams;
+}
+
+void device_tracker_view_search_index::add_grams(uint32_t slot, const std::vector<gram>& grams) {
+    for (const auto& g : grams)
+        postings[g].insert(slot);
+}
+
+void device_tracker_view_search_index::remove_grams(uint32_t slot, const std::vector<gram>& grams) {
+    for (const auto& g : grams) {
+        auto pi = postings.find(g);
+
+        if (pi == postings.end())
+            continue;
+
+        pi->second.erase(slot);
+
+        if (pi->second.empty())
+            postings.erase(pi);
+    }
+}
+
+void device_tracker_view_search_index::insert(std::shared_ptr<kis_tracked_device_base> device) {
+    if (slot_map.find(device->get_key()) != slot_map.end())
+        return update(device);
+
+    uint32_t slot;
+
+    if (free_slots.size() > 0) {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(slots.size());
+        slots.emplace_back();
+    }
+
+    slot_map[device->get_key()] = slot;
+
+    auto& s = slots[slot];
+    s.device = device;
+    s.grams = make_grams(device);
+
+    add_grams(slot, s.grams);
+}
+
+void device_tracker_view_search_index::remove(std::shared_ptr<kis_tracked_device_base> device) {
+    auto si = slot_map.find(device->get_key());
+
+    if (si == slot_map.end())
+        return;
+
+    auto& s = slots[si->second];
+
+    remove_grams(si->second, s.grams);
+
+    s.device.reset();
+    s.grams.clear();
+    s.grams.shrink_to_fit();
+
+    free_slots.push_back(si->second);
+    slot_map.erase(si);
+}
+
+void device_tracker_view_search_index::update(std::shared_ptr<kis_tracked_device_base> device) {
+    auto si = slot_map.find(device->get_key());
+
+    if (si == slot_map.end())
+        return insert(device);
+
+    auto slot = si->second;
+    auto& s = slots[slot];
+
+    auto grams = make_grams(device);
+
+    if (grams == s.grams)
+        return;
+
+    // Only touch the postings of grams which came or went
+    std::vector<gram> removed, added;
+
+    std::set_difference(s.grams.begin(), s.grams.end(), grams.begin(), grams.end(),
+            std::back_inserter(removed));
+    std::set_difference(grams.begin(), grams.end(), s.grams.begin(), s.grams.end(),
+            std::back_inserter(added));
+
+    remove_grams(slot, removed);
+    add_grams(slot, added);
+
+    s.grams = std::move(grams);
+}
+
+bool device_tracker_view_search_index::candidates(const std::string& in_query,
+        std::shared_ptr<tracker_element_vector> ret) const {
+    if (in_query.length() < min_query_len)
+        return false;
+
+    // Slots holding every gram
+    auto intersect = [this](std::vector<gram> grams, robin_hood::unordered_flat_set<uint32_t>& matched) {
+        std::sort(grams.begin(), grams.end());
+        grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+        std::vector<const robin_hood::unordered_flat_set<uint32_t> *> lists;
+
+        for (const auto& g : grams) {
+            auto pi = postings.find(g);
+
+            if (pi == postings.end())
+                return;
+
+            lists.push_back(&pi->second);
+        }
+
+        if (lists.size() == 0)
+            return;
+
+        std::sort(lists.begin(), lists.end(), 
+                [](const robin_hood::unordered_flat_set<uint32_t> *a,
+                    const robin_hood::unordered_flat_set<uint32_t> *b) -> bool {
+                    return a->size() < b->size();
+                });
+
+        for (const auto& slot : *lists[0]) {
+            bool all = true;
+
+            for (size_t l = 1; l < lists.size() && all; l++)
+                all = lists[l]->find(slot) != lists[l]->end();
+
+            if (all)
+                matched.insert(slot);
+        }
+    };
+
+    robin_hood::unordered_flat_set<uint32_t> matched;
+
+    std::vector<gram> grams;
+    text_grams(in_query, grams);
+    intersect(grams, matched);
+
+    // Queries which parse as part of a mac address also match mac fields
+    uint64_t mac_term;
+    unsigned int mac_term_len;
+
+    if (mac_addr::prepare_search_term(in_query, mac_term, mac_term_len) && mac_term_len != 0) {
+        auto term_bytes = reinterpret_cast<const uint8_t *>(&mac_term);
+        std::vector<gram> mgrams;
+
+        if (mac_term_len <= 3) {
+            // One gram of the full term
+            std::vector<gram> all;
+            mac_grams(term_bytes, mac_term_len, all);
+            mgrams.push_back(all.back());
+        } else {
+            // Every 3 byte run of the term
+            std::vector<gram> all;
+            mac_grams(term_bytes, mac_term_len, all);
+            for (const auto& g : all)
+                if ((g >> 24) == (0x10 | 3))
+                    mgrams.push_back(g);
+        }
+
+        intersect(mgrams, matched);
+    }
+
+    ret->reserve(matched.size());
+
+    for (const auto& slot : matched)
+        ret->push_back(slots[slot].device);
+
+    return true;
+}
+
+bool device_tracker_view_topk::parse_metric(const std::string& in_name, topk_metric& out_metric) {
+    if (in_name == "signal")
+        out_metric = topk_metric::signal;
+    else if (in_name == "packets")
+        out_metric = topk_metric::packets;
+    else if (in_name == "packet_rate")
+        out_metric = topk_metric::packet_rate;
+    else if (in_name == "last_time")
+        out_metric = topk_metric::last_time;
+    else
+        return false;
+
+    return true;
+}
+
+int64_t device_tracker_view_topk::value(const std::shared_ptr<kis_tracked_device_base>& device) const {
+    switch (metric_) {
+        case topk_metric::signal:
+            // Devices without a signal rank below every device with one
+            if (!device->has_signal_data() || device->get_signal_data()->get_last_signal() == 0)
+                return INT64_MIN;
+            return device->get_signal_data()->get_last_signal();
+        case topk_metric::packets:
+            return (int64_t) device->get_packets();
+        case topk_metric::packet_rate:
+            // Packets per second over the past minute, in thousandths
+            if (!device->has_packets_rrd())
+                return 0;
+            return (int64_t) (device->get_packets_rrd()->get_minute_avg(Globalreg::globalreg->last_tv_sec) * 1000);
+        case topk_metric::last_time:
+            return (int64_t) device->get_last_time();
+    }
+
+    return 0;
+}
+
+void device_tracker_view_topk::update(std::shared_ptr<kis_tracked_device_base> device) {
+    auto v = value(device);
+    auto key = device->get_key();
+
+    auto mi = members.find(key);
+
+    if (mi != members.end()) {
+        if (mi->second.value == v)
+            return;
+
+        ranked.erase(std::make_pair(mi->second.value, key));
+        ranked.insert(std::make_pair(v, key));
+        mi->second.value = v;
+        return;
+    }
+
+    if (members.size() >= k_ * 2) {
+        auto lowest = ranked.begin();
+
+        if (v <= lowest->first) {
+            raise_floor(v);
+            return;
+        }
+
+        raise_floor(lowest->first);
+        members.erase(lowest->second);
+        ranked.erase(lowest);
+    }
+
+    members[key] = member{v, device};
+    ranked.insert(std::make_pair(v, key));
+}
+
+void device_tracker_view_topk::remove(std::shared_ptr<kis_tracked_device_base> device) {
+    auto mi = members.find(device->get_key());
+
+    if (mi == members.end())
+        return;
+
+    ranked.erase(std::make_pair(mi->second.value, mi->first));
+    members.erase(mi);
+}
+
+void device_tracker_view_topk::rebuild(std::shared_ptr<tracker_element_vector> devices) {
+    ranked.clear();
+    members.clear();
+    floor = INT64_MIN;
+
+    for (const auto& d : *devices)
+        update(std::static_pointer_cast<kis_tracked_device_base>(d));
+}
+
+void device_tracker_view_topk::refresh() {
+    // The packet rate of a device decays without the device being updated; members
+    // are re-ranked before every read, and devices outside the set can only have
+    // decayed below the value they were rejected at
+    if (metric_ != topk_metric::packet_rate)
+        return;
+
+    for (auto& m : members) {
+        auto v = value(m.second.device);
+
+        if (v == m.second.value)
+            continue;
+
+        ranked.erase(std::make_pair(m.second.value, m.first));
+        ranked.insert(std::make_pair(v, m.first));
+        m.second.value = v;
+    }
+}
+
+bool device_tracker_view_topk::walk(size_t view_sz,
+        const std::function<void (const std::shared_ptr<kis_tracked_device_base>&)>& cb) {
+    refresh();
+
+    // Every device in the view is a member, or the members hold the top k
+    if (members.size() < view_sz) {
+        if (ranked.size() < k_)
+            return false;
+
+        if (std::next(ranked.rbegin(), k_ - 1)->first < floor)
+            return false;
+    }
+
+    size_t n = 0;
+
+    for (auto ri = ranked.rbegin(); ri != ranked.rend() && n < k_; ++ri, ++n)
+        cb(members[ri->second].device);
+
+    return true;
+}
+
+bool device_tracker_view_spatial_index::project(const std::shared_ptr<kis_tracked_device_base>& device,
+        double& wx, double& wy) {
+    if (!device->has_location())
+        return false;
+
+    auto loc = device->get_tracker_location();
+
+    if (!loc->has_last_loc())
+        return false;
+
+    auto lat = loc->get_last_loc()->get_lat();
+    auto lon = loc->get_last_loc()->get_lon();
+
+    if (lat == 0 || lon == 0)
+        return false;
+
+    // Web mercator stops short of the poles
+    lat = std::max(-85.05112878, std::min(85.05112878, lat));
+
+    auto lat_r = lat * M_PI / 180;
+
+    wx = (lon + 180) / 360;
+    wy = (1 - std::log(std::tan(lat_r) + 1 / std::cos(lat_r)) / M_PI) / 2;
+
+    wx = std::max(0.0, std::min(1.0, wx));
+    wy = std::max(0.0, std::min(1.0, wy));
+
+    return true;
+}
+
+void device_tracker_view_spatial_index::unproject(double wx, double wy, double& lat, double& lon) {
+    lon = wx * 360 - 180;
+    lat = std::atan(std::sinh(M_PI * (1 - 2 * wy))) * 180 / M_PI;
+}
+
+uint32_t device_tracker_view_spatial_index::tile_coord(double w, unsigned int z) {
+    auto n = (uint64_t) 1 << z;
+    return (uint32_t) std::min<uint64_t>((uint64_t) (w * n), n - 1);
+}
+
+void device_tracker_view_spatial_index::update(std::shared_ptr<kis_tracked_device_base> device) {
+    double wx, wy;
+
+    if (!project(device, wx, wy)) {
+        remove(device);
+        return;
+    }
+
+    auto key = device->get_key();
+    auto cell = cell_key(tile_coord(wx, cell_zoom), tile_coord(wy, cell_zoom));
+
+    auto li = located.find(key);
+
+    if (li != located.end() && li->second != cell) {
+        auto ci = cells.find(li->second);
+
+        if (ci != cells.end()) {
+            ci->second.erase(key);
+
+            if (ci->second.size() == 0)
+                cells.erase(ci);
+        }
+    }
+
+    located[key] = cell;
+    cells[cell][key] = entry{wx, wy, device};
+}
+
+void device_tracker_view_spatial_index::remove(std::shared_ptr<kis_tracked_device_base> device) {
+    auto li = located.find(device->get_key());
+
+    if (li == located.end())
+        return;
+
+    auto ci = cells.find(li->second);
+
+    if (ci != cells.end()) {
+        ci->second.erase(li->first);
+
+        if (ci->second.size() == 0)
+            cells.erase(ci);
+    }
+
+    located.erase(li);
+}
+
+void device_tracker_view_spatial_index::walk_cell(uint64_t key, 
+        const std::function<void (double, double, 
+            const std::shared_ptr<kis_tracked_device_base>&)>& cb) const {
+    auto ci = cells.find(key);
+
+    if (ci == cells.end())
+        return;
+
+    for (const auto& e : ci->second)
+        cb(e.second.wx, e.second.wy, e.second.device);
+}
+
+void device_tracker_view_spatial_index::walk(unsigned int z, uint32_t x, uint32_t y,
+        const std::function<void (double, double, 
+            const std::shared_ptr<kis_tracked_device_base>&)>& cb) const {
+    if (z >= cell_zoom) {
+        // Tile is inside one cell; filter the devices of the cell
+        auto shift = z - cell_zoom;
+
+        walk_cell(cell_key(x >> shift, y >> shift),
+                [&](double wx, double wy, const std::shared_ptr<kis_tracked_device_base>& dev) {
+                    if (tile_coord(wx, z) == x && tile_coord(wy, z) == y)
+                        cb(wx, wy, dev);
+                });
+
+        return;
+    }
+
+    // Tile covers a square of cells; look them up if there are fewer of them than there
+    // are occupied cells, otherwise scan the occupied cells
+    auto shift = cell_zoom - z;
+    uint64_t span = (uint64_t) 1 << shift;
+
+    if (span * span <= cells.size()) {
+        for (uint64_t cx = (uint64_t) x << shift; cx < ((uint64_t) x + 1) << shift; cx++) {
+            for (uint64_t cy = (uint64_t) y << shift; cy < ((uint64_t) y + 1) << shift; cy++)
+                walk_cell(cell_key(cx, cy), cb);
+        }
+
+        return;
+    }
+
+    for (const auto& c : cells) {
+        if ((uint32_t) (c.first >> 32) >> shift != x || (uint32_t) c.first >> shift != y)
+            continue;
+
+        for (const auto& e : c.second)
+            cb(e.second.wx, e.second.wy, e.second.device);
+    }
+}
 
 device_tracker_view::device_tracker_view(const std::string& in_id, const std::string& in_description, 
         new_device_cb in_new_cb, updated_device_cb in_update_cb) :
     tracker_component{},
     new_cb {in_new_cb},
-    update_cb {in_update_cb} {
+    update_cb {in_update_cb},
+    update_deps {VIEW_DEP_ALL} {
 
     devicetracker = Globalreg::fetch_mandatory_global_as<device_tracker>();
 
@@ -45,6 +785,13 @@ device_tracker_view::device_tracker_view(const std::string& in_id, const std::st
     view_description->set(in_description);
 
     device_list = std::make_shared<tracker_element_vector>();
+    snapshot_valid = false;
+    list_mod_seq = 0;
+
+    query_cache_mutex.set_name(fmt::format("device_tracker_view {} query cache", in_id));
+
+    subscription_mutex.set_name(fmt::format("device_tracker_view {} subscriptions", in_id));
+    n_subscriptions = 0;
 
     auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
 
@@ -53,14 +800,51 @@ device_tracker_view::device_tracker_view(const std::string& in_id, const std::st
             std::make_shared<kis_net_web_function_endpoint>(
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
                     return device_endpoint_handler(con);
-                }, devicetracker->get_devicelist_mutex()));
+                }));
 
     uri = fmt::format("/devices/views/{}/last-time/:timestamp/devices", in_id);
     httpd->register_route(uri, {"GET", "POST"}, httpd->RO_ROLE, {},
             std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) -> std::shared_ptr<tracker_element> {
+                    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+                            "device_tracker_view device_time_endpoint");
+                    return devicetracker->snapshot_devices(device_time_endpoint(con));
+                }));
+
+    uri = fmt::format("/devices/views/{}/since-seq/:seq/devices", in_id);
+    httpd->register_route(uri, {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) -> std::shared_ptr<tracker_element> {
+                    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+                            "device_tracker_view device_seq_endpoint");
+                    return devicetracker->snapshot_devices(device_seq_endpoint(con));
+                },
+                [this]() -> uint64_t {
+                    return endpoint_version();
+                }));
+
+    uri = fmt::format("/devices/views/{}/top/:metric/:count/devices", in_id);
+    httpd->register_route(uri, {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) -> std::shared_ptr<tracker_element> {
+                    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+                            "device_tracker_view device_topk_endpoint");
+                    return devicetracker->snapshot_devices(device_topk_endpoint(con));
+                }));
+
+    uri = fmt::format("/devices/views/{}/tile/:z/:x/:y/devices", in_id);
+    httpd->register_route(uri, {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_function_endpoint>(
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
-                    return device_time_endpoint(con);
-                }, devicetracker->get_devicelist_mutex()));
+                    return device_tile_endpoint_handler(con);
+                }));
+
+    uri = fmt::format("/devices/views/{}/subscribe", in_id);
+    httpd->register_websocket_route(uri, httpd->RO_ROLE, {"ws"},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return subscribe_endpoint_handler(con);
+                }));
 }
 
 device_tracker_view::device_tracker_view(const std::string& in_id, const std::string& in_description,
@@ -68,7 +852,8 @@ device_tracker_view::device_tracker_view(const std::string& in_id, const std::st
         new_device_cb in_new_cb, updated_device_cb in_update_cb) :
     tracker_component{},
     new_cb {in_new_cb},
-    update_cb {in_update_cb} {
+    update_cb {in_update_cb},
+    update_deps {VIEW_DEP_ALL} {
 
     devicetracker = Globalreg::fetch_mandatory_global_as<device_tracker>();
 
@@ -79,22 +864,66 @@ device_tracker_view::device_tracker_view(const std::string& in_id, const std::st
     view_description->set(in_description);
 
     device_list = std::make_shared<tracker_element_vector>();
+    snapshot_valid = false;
+    list_mod_seq = 0;
+
+    query_cache_mutex.set_name(fmt::format("device_tracker_view {} query cache", in_id));
+
+    subscription_mutex.set_name(fmt::format("device_tracker_view {} subscriptions", in_id));
+    n_subscriptions = 0;
+
+    auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
+
+    auto uri = fmt::format("/devices/views/{}/devices", in_id);
+    httpd->register_route(uri, {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return device_endpoint_handler(con);
+                }));
+
+    uri = fmt::format("/devices/views/{}/last-time/:timestamp/devices", in_id);
+    httpd->register_route(uri, {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) -> std::shared_ptr<tracker_element> {
+                    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+                            "device_tracker_view device_time_endpoint");
+                    return devicetracker->snapshot_devices(device_time_endpoint(con));
+                }));
+
+    uri = fmt::format("/devices/views/{}/since-seq/:seq/devices", in_id);
+    httpd->register_route(uri, {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) -> std::shared_ptr<tracker_element> {
+                    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+                            "device_tracker_view device_seq_endpoint");
+                    return devicetracker->snapshot_devices(device_seq_endpoint(con));
+                },
+                [this]() -> uint64_t {
+                    return endpoint_version();
+                }));
 
-    auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
+    uri = fmt::format("/devices/views/{}/top/:metric/:count/devices", in_id);
+    httpd->register_route(uri, {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) -> std::shared_ptr<tracker_element> {
+                    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+                            "device_tracker_view device_topk_endpoint");
+                    return devicetracker->snapshot_devices(device_topk_endpoint(con));
+                }));
 
-    auto uri = fmt::format("/devices/views/{}/devices", in_id);
+    uri = fmt::format("/devices/views/{}/tile/:z/:x/:y/devices", in_id);
     httpd->register_route(uri, {"GET", "POST"}, httpd->RO_ROLE, {},
             std::make_shared<kis_net_web_function_endpoint>(
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
-                    return device_endpoint_handler(con);
-                }, devicetracker->get_devicelist_mutex()));
+                    return device_tile_endpoint_handler(con);
+                }));
 
-    uri = fmt::format("/devices/views/{}/last-time/:timestamp/devices", in_id);
-    httpd->register_route(uri, {"GET", "POST"}, httpd->RO_ROLE, {},
-            std::make_shared<kis_net_web_tracked_endpoint>(
+    uri = fmt::format("/devices/views/{}/subscribe", in_id);
+    httpd->register_websocket_route(uri, httpd->RO_ROLE, {"ws"},
+            std::make_shared<kis_net_web_function_endpoint>(
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
-                    return device_time_endpoint(con);
-                }, devicetracker->get_devicelist_mutex()));
+                    return subscribe_endpoint_handler(con);
+                }));
 
     uri = fmt::format("/devices/views/{}/monitor", in_id);
     httpd->register_websocket_route(uri, httpd->RO_ROLE, {"ws"},
@@ -161,31 +990,26 @@ device_tracker_view::device_tracker_view(const std::string& in_id, const std::st
                                 auto tid = 
                                     timetracker->register_timer(std::chrono::seconds(rate), true,
                                             [this, con, dev_r, dev_k, dev_m, json, ws, &last_tm, rename_map, format_t](int) -> int {
+                                                // Changed devices are snapshotted under the devicelist
+                                                // lock and serialized after it's released
+                                                auto changed = std::vector<std::shared_ptr<kis_tracked_device_base>>{};
+
                                                 if (dev_r == "*") {
-                                                    auto worker = device_tracker_view_function_worker([json, last_tm, format_t, ws](std::shared_ptr<kis_tracked_device_base> dev) -> bool {
-                                                        if (dev->get_mod_time() > last_tm) {
-                                                            std::stringstream ss;
-                                                            Globalreg::globalreg->entrytracker->serialize_with_json_summary(format_t, ss, dev, json);
-                                                            ws->write(ss.str());
-                                                        }
+                                                    auto worker = device_tracker_view_function_worker([this, last_tm, &changed](std::shared_ptr<kis_tracked_device_base> dev) -> bool {
+                                                        if (dev->get_mod_time() > last_tm)
+                                                            changed.push_back(devicetracker->snapshot_device(dev));
 
                                                         return false;
                                                     });
 
                                                     do_device_work(worker);
                                                 } else if (!dev_k.get_error()) {
-                                                    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), "view ws monitor timer serialize lambda");
-
                                                     auto dev = fetch_device(dev_k);
-                                                    if (dev != nullptr) {
-                                                        if (dev->get_mod_time() > last_tm) {
-                                                            std::stringstream ss;
-                                                            Globalreg::globalreg->entrytracker->serialize_with_json_summary(format_t, ss, dev, json);
-                                                            ws->write(ss.str());
-                                                        }
-                                                    }
+
+                                                    if (dev != nullptr && dev->get_mod_time() > last_tm)
+                                                        changed.push_back(devicetracker->snapshot_device(dev));
                                                 } else if (!dev_m.error()) {
-                                                    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), "view ws monitor timer serialize lambda");
+                                                    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), "view ws monitor timer snapshot");
 
                                                     auto mvec = devicetracker->fetch_devices(dev_m);
 
@@ -194,14 +1018,17 @@ device_tracker_view::device_tracker_view(const std::string& in_id, const std::st
                                                         if (pk == device_presence_map.end() || pk->second == false)
                                                             continue;
 
-                                                        if (i->get_mod_time() > last_tm) {
-                                                            std::stringstream ss;
-                                                            Globalreg::globalreg->entrytracker->serialize_with_json_summary(format_t, ss, i, json);
-                                                            ws->write(ss.str());
-                                                        }
+                                                        if (i->get_mod_time() > last_tm)
+                                                            changed.push_back(devicetracker->snapshot_device(i));
                                                     }
                                                 }
 
+                                                for (const auto& dev : changed) {
+                                                    std::stringstream ss;
+                                                    Globalreg::globalreg->entrytracker->serialize_with_json_summary(format_t, ss, dev, json);
+                                                    ws->write(ss.str());
+                                                }
+
                                                 last_tm = time(0);
 
                                                 return 1;
@@ -243,14 +1070,44 @@ device_tracker_view::device_tracker_view(const std::string& in_id, const std::st
             std::make_shared<kis_net_web_function_endpoint>(
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
                     return device_endpoint_handler(con);
-                }, devicetracker->get_devicelist_mutex()));
+                }));
 
     uri = fmt::format("/devices/views/{}last-time/:timestamp/devices", ss.str());
     httpd->register_route(uri, {"GET", "POST"}, httpd->RO_ROLE, {},
             std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) -> std::shared_ptr<tracker_element> {
+                    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+                            "device_tracker_view device_time_endpoint");
+                    return devicetracker->snapshot_devices(device_time_endpoint(con));
+                }));
+
+    uri = fmt::format("/devices/views/{}since-seq/:seq/devices", ss.str());
+    httpd->register_route(uri, {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) -> std::shared_ptr<tracker_element> {
+                    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+                            "device_tracker_view device_seq_endpoint");
+                    return devicetracker->snapshot_devices(device_seq_endpoint(con));
+                },
+                [this]() -> uint64_t {
+                    return endpoint_version();
+                }));
+
+    uri = fmt::format("/devices/views/{}top/:metric/:count/devices", ss.str());
+    httpd->register_route(uri, {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) -> std::shared_ptr<tracker_element> {
+                    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+                            "device_tracker_view device_topk_endpoint");
+                    return devicetracker->snapshot_devices(device_topk_endpoint(con));
+                }));
+
+    uri = fmt::format("/devices/views/{}tile/:z/:x/:y/devices", ss.str());
+    httpd->register_route(uri, {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_function_endpoint>(
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
-                    return device_time_endpoint(con);
-                }, devicetracker->get_devicelist_mutex()));
+                    return device_tile_endpoint_handler(con);
+                }));
 }
 
 void device_tracker_view::pre_serialize() {
@@ -261,26 +1118,34 @@ void device_tracker_view::post_serialize() {
     kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), std::adopt_lock, "devicetracker_view post_serialize");
 }
 
-std::shared_ptr<tracker_element_vector> device_tracker_view::do_device_work(device_tracker_view_worker& worker) {
-    // Make a copy of the vector in case the worker manipulates the original
-    std::shared_ptr<tracker_element_vector> immutable_copy;
-    {
-        kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex());
-        immutable_copy = std::make_shared<tracker_element_vector>(device_list);
+std::shared_ptr<tracker_element_vector> device_tracker_view::get_device_snapshot() {
+    // Fast path: the published snapshot is still current, no lock required
+    if (snapshot_valid) {
+        auto snap = std::atomic_load(&device_snapshot);
+        if (snap != nullptr)
+            return snap;
     }
 
-    return do_device_work(worker, immutable_copy);
-}
+    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), "device_tracker_view get_device_snapshot");
 
-std::shared_ptr<tracker_element_vector> device_tracker_view::do_readonly_device_work(device_tracker_view_worker& worker) {
-    // Make a copy of the vector in case the worker manipulates the original
-    std::shared_ptr<tracker_element_vector> immutable_copy;
-    {
-        kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex());
-        immutable_copy = std::make_shared<tracker_element_vector>(device_list);
+    if (!snapshot_valid || device_snapshot == nullptr) {
+        // Changes to the list happen under the devicelist lock, so nothing can invalidate
+        // the copy while we build it; readers of the previous snapshot keep it alive until
+        // they release it
+        snapshot_valid = true;
+        std::atomic_store(&device_snapshot, std::make_shared<tracker_element_vector>(device_list));
     }
 
-    return do_readonly_device_work(worker, immutable_copy);
+    return std::atomic_load(&device_snapshot);
+}
+
+std::shared_ptr<tracker_element_vector> device_tracker_view::do_device_work(device_tracker_view_worker& worker) {
+    // Work on the immutable snapshot in case the worker manipulates the original
+    return do_device_work(worker, get_device_snapshot());
+}
+
+std::shared_ptr<tracker_element_vector> device_tracker_view::do_readonly_device_work(device_tracker_view_worker& worker) {
+    return do_readonly_device_work(worker, get_device_snapshot());
 }
 
 std::shared_ptr<tracker_element_vector> device_tracker_view::do_device_work(device_tracker_view_worker& worker,
@@ -318,40 +1183,109 @@ std::shared_ptr<tracker_element_vector> device_tracker_view::do_device_work(devi
 
 std::shared_ptr<tracker_element_vector> device_tracker_view::do_readonly_device_work(device_tracker_view_worker& worker,
         std::shared_ptr<tracker_element_vector> devices) {
+    // Large views are split across threads when the worker allows it; each thread 
+    // should get a useful amount of work to amortize starting it
+    const size_t min_parallel_sz = 8192;
+    auto n_threads = std::min<size_t>(devicetracker->get_view_work_threads(), 
+            devices->size() / min_parallel_sz);
 
-    // read-only workers are currently disabled because it may not be reasonable to solve conflicts
-    // at the per-device level, use the locked worker.
+    if (worker.parallel_safe() && n_threads > 1)
+        return do_parallel_device_work(worker, devices, n_threads);
 
-    return do_device_work(worker, devices);
-
-#if 0
     auto ret = std::make_shared<tracker_element_vector>();
     ret->reserve(devices->size());
 
-    kis_lock_guard<kis_mutex> ul_devlist(devicetracker->get_devicelist_mutex(), 
-            "device_tracker_view do_readonly_device_work");
+    // The vector is immutable, but the devices are not; instead of holding the devicelist
+    // for the entire walk, hold it for blocks of devices so that packet processing can
+    // interleave with long-running workers.  If the caller already holds the devicelist
+    // this degrades to the fully locked behavior.
+    const size_t block_sz = 512;
 
-    std::for_each(devices->begin(), devices->end(),
-            [&](shared_tracker_element val) {
+    for (size_t bi = 0; bi < devices->size(); bi += block_sz) {
+        kis_lock_guard<kis_mutex> dev_lg(devicetracker->get_devicelist_mutex(), 
+                "device_tracker_view do_readonly_device_work");
+
+        auto be = std::min(devices->size(), bi + block_sz);
+
+        for (size_t i = bi; i < be; i++) {
+            const auto& val = (*devices)[i];
 
             if (val == nullptr)
-                return;
+                continue;
 
             auto dev = std::static_pointer_cast<kis_tracked_device_base>(val);
 
-            auto m = worker.match_device(dev);
-
-            if (m) 
+            if (worker.match_device(dev))
                 ret->push_back(dev);
+        }
+    }
 
-        });
+    kis_lock_guard<kis_mutex> dev_lg(devicetracker->get_devicelist_mutex(), 
+            "device_tracker_view do_readonly_device_work finalize");
+
+    worker.set_matched_devices(ret);
+
+    worker.finalize();
+
+    return ret;
+}
+
+std::shared_ptr<tracker_element_vector> device_tracker_view::do_parallel_device_work(device_tracker_view_worker& worker,
+        std::shared_ptr<tracker_element_vector> devices, size_t n_threads) {
+
+    // The calling thread holds the devicelist for all the workers, which only read the
+    // devices; the pass completes in a fraction of the time of a single-threaded walk
+    kis_lock_guard<kis_mutex> dev_lg(devicetracker->get_devicelist_mutex(), 
+            "device_tracker_view do_parallel_device_work");
+
+    std::vector<std::vector<std::shared_ptr<kis_tracked_device_base>>> partial(n_threads);
+    std::vector<std::thread> threads;
+    threads.reserve(n_threads - 1);
+
+    auto part_sz = (devices->size() + n_threads - 1) / n_threads;
+
+    auto match_part = [&worker, &devices, &partial, part_sz](size_t pn) {
+        auto start = pn * part_sz;
+        auto end = std::min(devices->size(), start + part_sz);
+
+        for (size_t i = start; i < end; i++) {
+            const auto& val = (*devices)[i];
+
+            if (val == nullptr)
+                continue;
+
+            auto dev = std::static_pointer_cast<kis_tracked_device_base>(val);
+
+            if (worker.match_device(dev))
+                partial[pn].push_back(dev);
+        }
+    };
+
+    for (size_t pn = 1; pn < n_threads; pn++)
+        threads.emplace_back(match_part, pn);
+
+    match_part(0);
+
+    for (auto& t : threads)
+        t.join();
+
+    // Merge in partition order so the results match the order of the view
+    size_t n_matched = 0;
+    for (const auto& p : partial)
+        n_matched += p.size();
+
+    auto ret = std::make_shared<tracker_element_vector>();
+    ret->reserve(n_matched);
+
+    for (const auto& p : partial)
+        for (const auto& d : p)
+            ret->push_back(d);
 
     worker.set_matched_devices(ret);
 
     worker.finalize();
 
     return ret;
-#endif
 }
 
 std::shared_ptr<kis_tracked_device_base> device_tracker_view::fetch_device(device_key in_key) {
@@ -376,9 +1310,14 @@ void device_tracker_view::new_device(std::shared_ptr<kis_tracked_device_base> de
             if (dpmi == device_presence_map.end()) {
                 device_presence_map[device->get_key()] = true;
                 device_list->push_back(device);
+                index_add(device);
+                subscription_changed(device);
             }
 
             list_sz->set(device_list->size());
+
+            snapshot_valid = false;
+            list_mod_seq++;
         }
     }
 }
@@ -393,64 +1332,413 @@ void device_tracker_view::update_device(std::shared_ptr<kis_tracked_device_base>
     
     bool retain = update_cb(device);
 
-    auto dpmi = device_presence_map.find(device->get_key());
+    auto dpmi = device_presence_map.find(device->get_key());
+
+    // If we're adding the device (or keeping it) and we don't have it tracked,
+    // add it and record it in the presence map
+    if (retain && dpmi == device_presence_map.end()) {
+        device_list->push_back(device);
+        device_presence_map[device->get_key()] = true;
+        index_add(device);
+        subscription_changed(device);
+        list_sz->set(device_list->size());
+        snapshot_valid = false;
+        list_mod_seq++;
+        return;
+    }
+
+    // if we're removing the device, find it in the vector and remove it, and remove
+    // it from the presence map; this is expensive
+    if (!retain && dpmi != device_presence_map.end()) {
+        for (auto di = device_list->begin(); di != device_list->end(); ++di) {
+            if (*di == device) {
+                device_list->erase(di);
+                break;
+            }
+        }
+        device_presence_map.erase(dpmi);
+        index_remove(device);
+        subscription_removed(device);
+        list_sz->set(device_list->size());
+        snapshot_valid = false;
+        list_mod_seq++;
+        return;
+    }
+
+    if (retain)
+        device_modified(device);
+}
+
+uint64_t device_tracker_view::endpoint_version() {
+    // Endpoint output changes when a device changes or when the view gains or
+    // loses one
+    uint64_t seqs[2] = { devicetracker->get_device_mod_seq(), list_mod_seq };
+    return XXH64(seqs, sizeof(seqs), 0);
+}
+
+void device_tracker_view::remove_device(std::shared_ptr<kis_tracked_device_base> device) {
+    // Only called under guard from devicetracker
+    // kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex());
+
+    auto di = device_presence_map.find(device->get_key());
+
+    if (di != device_presence_map.end()) {
+        device_presence_map.erase(di);
+
+        for (auto vi = device_list->begin(); vi != device_list->end(); ++vi) {
+            if (*vi == device) {
+                device_list->erase(vi);
+                break;
+            }
+        }
+
+        index_remove(device);
+        subscription_removed(device);
+        
+        list_sz->set(device_list->size());
+        
+        snapshot_valid = false;
+        list_mod_seq++;
+    }
+}
+
+void device_tracker_view::add_device_direct(std::shared_ptr<kis_tracked_device_base> device) {
+    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex());
+
+    auto di = device_presence_map.find(device->get_key());
+
+    if (di != device_presence_map.end())
+        return;
+
+    device_presence_map[device->get_key()] = true;
+    device_list->push_back(device);
+    index_add(device);
+    subscription_changed(device);
+
+    list_sz->set(device_list->size());
+
+    snapshot_valid = false;
+    list_mod_seq++;
+}
+
+void device_tracker_view::device_modified(std::shared_ptr<kis_tracked_device_base> device) {
+    if (indexes.size() == 0 && search_indexes.size() == 0 && topks.size() == 0 && 
+            spatial_index == nullptr && n_subscriptions == 0)
+        return;
+
+    if (device_presence_map.find(device->get_key()) == device_presence_map.end())
+        return;
+
+    if (indexes.size() != 0 || search_indexes.size() != 0)
+        index_dirty[device->get_key()] = device;
+
+    // Top-k sets are cheap enough to update in place
+    for (const auto& t : topks)
+        t->update(device);
+
+    if (spatial_index != nullptr)
+        spatial_index->update(device);
+
+    subscription_changed(device);
+}
+
+void device_tracker_view::subscription_changed(std::shared_ptr<kis_tracked_device_base> device) {
+    // Called under the devicelist lock
+    if (n_subscriptions == 0)
+        return;
+
+    kis_lock_guard<kis_mutex> lk(subscription_mutex, "device_tracker_view subscription_changed");
+
+    for (const auto& s : subscriptions)
+        s->changed[device->get_key()] = device;
+}
+
+void device_tracker_view::subscription_removed(std::shared_ptr<kis_tracked_device_base> device) {
+    // Called under the devicelist lock
+    if (n_subscriptions == 0)
+        return;
+
+    kis_lock_guard<kis_mutex> lk(subscription_mutex, "device_tracker_view subscription_removed");
+
+    for (const auto& s : subscriptions) {
+        s->changed.erase(device->get_key());
+        s->removed.push_back(device->get_key());
+    }
+}
+
+void device_tracker_view::subscription_flush(std::shared_ptr<device_tracker_view_subscription> sub) {
+    auto changed = std::unordered_map<device_key, std::shared_ptr<kis_tracked_device_base>>{};
+    auto removed = std::vector<device_key>{};
+
+    {
+        kis_lock_guard<kis_mutex> lk(subscription_mutex, "device_tracker_view subscription_flush");
+        changed.swap(sub->changed);
+        removed.swap(sub->removed);
+    }
+
+    if (changed.size() == 0 && removed.size() == 0)
+        return;
+
+    // Snapshot under the devicelist lock and serialize after it's released
+    auto updated = std::make_shared<tracker_element_vector>();
+    updated->reserve(changed.size());
+
+    {
+        kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+                "device_tracker_view subscription_flush");
+
+        for (const auto& d : changed)
+            updated->push_back(devicetracker->snapshot_device(d.second));
+    }
+
+    std::stringstream ss;
+
+    ss << "{\"kismet.devices.view.removed\": [";
+
+    bool first = true;
+    for (const auto& k : removed) {
+        if (!first)
+            ss << ",";
+        first = false;
+
+        ss << "\"" << k.as_string() << "\"";
+    }
+
+    ss << "], \"kismet.devices.view.updated\": ";
+
+    Globalreg::globalreg->entrytracker->serialize_with_json_summary("json", ss, updated, sub->json);
+
+    ss << "}";
+
+    sub->ws->write(ss.str());
+}
+
+void device_tracker_view::subscribe_endpoint_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    // Subscriptions of this websocket, by client request id
+    std::unordered_map<unsigned int, std::shared_ptr<device_tracker_view_subscription>> sub_map;
+    auto timetracker = Globalreg::fetch_mandatory_global_as<time_tracker>();
+
+    auto cancel_sub = [this, timetracker](std::shared_ptr<device_tracker_view_subscription> sub) {
+        timetracker->remove_timer(sub->timer_id);
+
+        kis_lock_guard<kis_mutex> lk(subscription_mutex, "device_tracker_view subscription cancel");
+
+        for (auto i = subscriptions.begin(); i != subscriptions.end(); ++i) {
+            if (*i == sub) {
+                subscriptions.erase(i);
+                n_subscriptions--;
+                break;
+            }
+        }
+    };
+
+    auto ws = 
+        std::make_shared<kis_net_web_websocket_endpoint>(con,
+            [this, timetracker, &sub_map, cancel_sub](std::shared_ptr<kis_net_web_websocket_endpoint> ws,
+                boost::beast::flat_buffer& buf, bool text) {
+
+            if (!text) {
+                ws->close();
+                return;
+            }
+
+            std::stringstream ss(boost::beast::buffers_to_string(buf.data()));
+            Json::Value json;
+
+            try {
+                ss >> json;
+
+                if (!json["cancel"].isNull()) {
+                    auto si = sub_map.find(json["cancel"].asUInt());
+                    if (si != sub_map.end()) {
+                        cancel_sub(si->second);
+                        sub_map.erase(si);
+                    }
+                }
+
+                if (!json["subscribe"].isNull()) {
+                    auto req_id = json["subscribe"].asUInt();
+
+                    auto rate = json["rate"].asUInt();
+                    if (rate < 1)
+                        rate = 1;
+
+                    // Replace any existing subscription under this ID
+                    auto si = sub_map.find(req_id);
+                    if (si != sub_map.end()) {
+                        cancel_sub(si->second);
+                        sub_map.erase(si);
+                    }
+
+                    auto sub = std::make_shared<device_tracker_view_subscription>();
+                    sub->ws = ws;
+                    sub->json = json;
+
+                    {
+                        kis_lock_guard<kis_mutex> dlk(devicetracker->get_devicelist_mutex(), 
+                                "device_tracker_view subscribe");
+                        kis_lock_guard<kis_mutex> slk(subscription_mutex, "device_tracker_view subscribe");
+
+                        // Optionally start with everything currently in the view
+                        if (json["initial"].asBool()) {
+                            for (const auto& d : *device_list) {
+                                auto dev = std::static_pointer_cast<kis_tracked_device_base>(d);
+                                sub->changed[dev->get_key()] = dev;
+                            }
+                        }
+
+                        subscriptions.push_back(sub);
+                        n_subscriptions++;
+                    }
+
+                    sub->timer_id = 
+                        timetracker->register_timer(std::chrono::seconds(rate), true,
+                                [this, sub](int) -> int {
+                                    subscription_flush(sub);
+                                    return 1;
+                                });
+
+                    if (json["initial"].asBool())
+                        subscription_flush(sub);
+
+                    sub_map[req_id] = sub;
+                }
+
+            } catch (const std::exception& e) {
+                _MSG_ERROR("Invalid device view subscription request: {}", e.what());
+                return;
+            }
+        });
+
+    ws->text();
+
+    try {
+        ws->handle_request(con);
+    } catch (const std::exception& e) {
+        ;
+    }
+
+    for (const auto& s : sub_map)
+        cancel_sub(s.second);
+}
+
+void device_tracker_view::index_add(std::shared_ptr<kis_tracked_device_base> device) {
+    for (const auto& i : indexes)
+        i->insert(device);
+
+    for (const auto& i : search_indexes)
+        i->insert(device);
+
+    for (const auto& t : topks)
+        t->update(device);
+
+    if (spatial_index != nullptr)
+        spatial_index->update(device);
+}
+
+void device_tracker_view::index_remove(std::shared_ptr<kis_tracked_device_base> device) {
+    index_dirty.erase(device->get_key());
+
+    for (const auto& i : indexes)
+        i->remove(device);
+
+    for (const auto& i : search_indexes)
+        i->remove(device);
+
+    for (const auto& t : topks)
+        t->remove(device);
+
+    if (spatial_index != nullptr)
+        spatial_index->remove(device);
+}
+
+void device_tracker_view::index_flush() {
+    for (const auto& d : index_dirty) {
+        for (const auto& i : indexes)
+            i->update(d.second);
+
+        for (const auto& i : search_indexes)
+            i->update(d.second);
+    }
+
+    index_dirty.clear();
+}
+
+std::shared_ptr<device_tracker_view_search_index>
+device_tracker_view::get_search_index(const std::vector<std::vector<int>>& paths) {
+    for (const auto& i : search_indexes) {
+        if (i->paths() == paths)
+            return i;
+    }
+
+    // Drop the oldest set of search fields
+    if (search_indexes.size() >= max_search_indexes)
+        search_indexes.erase(search_indexes.begin());
+
+    auto index = std::make_shared<device_tracker_view_search_index>(paths);
+
+    for (const auto& d : *device_list)
+        index->insert(std::static_pointer_cast<kis_tracked_device_base>(d));
+
+    search_indexes.push_back(index);
 
-    // If we're adding the device (or keeping it) and we don't have it tracked,
-    // add it and record it in the presence map
-    if (retain && dpmi == device_presence_map.end()) {
-        device_list->push_back(device);
-        device_presence_map[device->get_key()] = true;
-        list_sz->set(device_list->size());
-        return;
-    }
+    return index;
+}
 
-    // if we're removing the device, find it in the vector and remove it, and remove
-    // it from the presence map; this is expensive
-    if (!retain && dpmi != device_presence_map.end()) {
-        for (auto di = device_list->begin(); di != device_list->end(); ++di) {
-            if (*di == device) {
-                device_list->erase(di);
-                break;
-            }
+std::shared_ptr<device_tracker_view_topk>
+device_tracker_view::get_topk(device_tracker_view_topk::topk_metric metric, size_t k) {
+    for (auto ti = topks.begin(); ti != topks.end(); ++ti) {
+        if ((*ti)->metric() == metric && (*ti)->k() == k) {
+            // Keep the most recently used sets at the end
+            auto topk = *ti;
+            topks.erase(ti);
+            topks.push_back(topk);
+            return topk;
         }
-        device_presence_map.erase(dpmi);
-        list_sz->set(device_list->size());
-        return;
     }
-}
 
-void device_tracker_view::remove_device(std::shared_ptr<kis_tracked_device_base> device) {
-    // Only called under guard from devicetracker
-    // kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex());
+    if (topks.size() >= max_topks)
+        topks.erase(topks.begin());
 
-    auto di = device_presence_map.find(device->get_key());
+    auto topk = std::make_shared<device_tracker_view_topk>(metric, k);
+    topk->rebuild(device_list);
 
-    if (di != device_presence_map.end()) {
-        device_presence_map.erase(di);
+    topks.push_back(topk);
 
-        for (auto vi = device_list->begin(); vi != device_list->end(); ++vi) {
-            if (*vi == device) {
-                device_list->erase(vi);
-                break;
-            }
+    return topk;
+}
+
+std::shared_ptr<device_tracker_view_index> 
+device_tracker_view::get_index(const std::vector<int>& path) {
+    // Fields the UI commonly sorts on; resolved on first use since the nested fields may
+    // not be registered when the view is created
+    if (indexable_paths.size() == 0) {
+        for (const auto& f : {"kismet.device.base.last_time", 
+                "kismet.device.base.signal/kismet.common.signal.last_signal",
+                "kismet.device.base.commonname", 
+                "kismet.device.base.type"}) {
+            indexable_paths.push_back(tracker_element_summary(f).resolved_path);
         }
-        
-        list_sz->set(device_list->size());
+
+        last_time_path = indexable_paths[0];
     }
-}
 
-void device_tracker_view::add_device_direct(std::shared_ptr<kis_tracked_device_base> device) {
-    kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex());
+    if (std::find(indexable_paths.begin(), indexable_paths.end(), path) == indexable_paths.end())
+        return nullptr;
 
-    auto di = device_presence_map.find(device->get_key());
+    for (const auto& i : indexes) {
+        if (i->path() == path)
+            return i;
+    }
 
-    if (di != device_presence_map.end())
-        return;
+    auto index = std::make_shared<device_tracker_view_index>(path);
 
-    device_presence_map[device->get_key()] = true;
-    device_list->push_back(device);
+    for (const auto& d : *device_list)
+        index->insert(std::static_pointer_cast<kis_tracked_device_base>(d));
 
-    list_sz->set(device_list->size());
+    indexes.push_back(index);
+
+    return index;
 }
 
 void device_tracker_view::remove_device_direct(std::shared_ptr<kis_tracked_device_base> device) {
@@ -467,8 +1755,14 @@ void device_tracker_view::remove_device_direct(std::shared_ptr<kis_tracked_devic
                 break;
             }
         }
+
+        index_remove(device);
+        subscription_removed(device);
         
         list_sz->set(device_list->size());
+        
+        snapshot_valid = false;
+        list_mod_seq++;
     }
 }
 
@@ -498,13 +1792,17 @@ device_tracker_view::device_time_endpoint(std::shared_ptr<kis_net_beast_httpd_co
                 return true;
                 });
 
-    auto next_work_vec = do_device_work(worker);
+    auto snapshot = get_device_snapshot();
+    con->add_cost(snapshot->size());
+
+    auto next_work_vec = do_device_work(worker, snapshot);
 
     // Apply a regex filter
     if (!regex.isNull()) {
         try {
             auto worker = 
                 device_tracker_view_regex_worker(regex);
+            con->add_cost(next_work_vec->size() * regex_cost_units);
             auto r_vec = do_readonly_device_work(worker, next_work_vec);
             next_work_vec = r_vec;
         } catch (const std::exception& e) {
@@ -514,14 +1812,230 @@ device_tracker_view::device_time_endpoint(std::shared_ptr<kis_net_beast_httpd_co
         }
     }
 
+    con->add_cost(next_work_vec->size());
+
     return next_work_vec;
 }
 
+std::shared_ptr<tracker_element> 
+device_tracker_view::device_seq_endpoint(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    auto ret = std::make_shared<tracker_element_vector>();
+    std::ostream os(&con->response_stream());
+
+    auto seq_k = con->uri_params().find(":seq");
+    auto seq = string_to_n_dfl<uint64_t>(seq_k->second, 0);
+
+    // Walk the change log instead of the view; each device carries its own sequence 
+    // number so the client can resume from the highest one it has seen
+    devicetracker->do_modified_since(seq, 
+            [this, &ret](const std::shared_ptr<kis_tracked_device_base>& dev) -> bool {
+                auto pi = device_presence_map.find(dev->get_key());
+
+                if (pi != device_presence_map.end() && pi->second)
+                    ret->push_back(dev);
+
+                return true;
+            });
+
+    // Regular expression terms, if any
+    auto regex = con->json()["regex"];
+
+    if (!regex.isNull()) {
+        try {
+            auto worker = 
+                device_tracker_view_regex_worker(regex);
+            con->add_cost(ret->size() * regex_cost_units);
+            ret = do_readonly_device_work(worker, ret);
+        } catch (const std::exception& e) {
+            con->set_status(400);
+            os << "Invalid regex: " << e.what() << "\n";
+            return nullptr;
+        }
+    }
+
+    con->add_cost(ret->size());
+
+    return ret;
+}
+
+std::shared_ptr<tracker_element> 
+device_tracker_view::device_topk_endpoint(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    std::ostream os(&con->response_stream());
+
+    auto metric_k = con->uri_params().find(":metric");
+    auto count_k = con->uri_params().find(":count");
+
+    device_tracker_view_topk::topk_metric metric;
+
+    if (!device_tracker_view_topk::parse_metric(metric_k->second, metric)) {
+        con->set_status(400);
+        os << "Unknown metric, expected signal, packets, packet_rate, or last_time\n";
+        return nullptr;
+    }
+
+    auto count = string_to_n_dfl<size_t>(count_k->second, 0);
+
+    if (count == 0 || count > max_topk_count) {
+        con->set_status(400);
+        os << "Invalid count, expected 1 to " << max_topk_count << "\n";
+        return nullptr;
+    }
+
+    auto ret = std::make_shared<tracker_element_vector>();
+    ret->reserve(std::min(count, device_list->size()));
+
+    auto topk = get_topk(metric, count);
+
+    auto cb = [&ret](const std::shared_ptr<kis_tracked_device_base>& dev) {
+        ret->push_back(dev);
+    };
+
+    if (!topk->walk(device_list->size(), cb)) {
+        con->add_cost(device_list->size());
+        topk->rebuild(device_list);
+        topk->walk(device_list->size(), cb);
+    }
+
+    con->add_cost(ret->size());
+
+    return ret;
+}
+
+void device_tracker_view::device_tile_endpoint_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    std::ostream os(&con->response_stream());
+
+    auto z_k = con->uri_params().find(":z");
+    auto x_k = con->uri_params().find(":x");
+    auto y_k = con->uri_params().find(":y");
+
+    auto z = string_to_n_dfl<unsigned int>(z_k->second, device_tracker_view_spatial_index::max_zoom + 1);
+    auto x = string_to_n_dfl<uint64_t>(x_k->second, UINT64_MAX);
+    auto y = string_to_n_dfl<uint64_t>(y_k->second, UINT64_MAX);
+
+    if (z > device_tracker_view_spatial_index::max_zoom || 
+            x >= ((uint64_t) 1 << z) || y >= ((uint64_t) 1 << z)) {
+        con->set_status(400);
+        os << "Invalid tile, expected a zoom from 0 to " << 
+            device_tracker_view_spatial_index::max_zoom << " and a tile at that zoom\n";
+        return;
+    }
+
+    auto summary_plan = tracker_element_summary_plan::from_json(Json::Value(Json::arrayValue));
+    auto rename_map = Globalreg::new_from_pool<tracker_element_serializer::rename_map>();
+
+    // Only devices changed after this modification sequence are sent in full
+    uint64_t since = 0;
+
+    try {
+        auto fields = con->json().get("fields", Json::Value(Json::arrayValue));
+        summary_plan = tracker_element_summary_plan::from_json(fields);
+
+        since = con->json().get("since", 0).asUInt64();
+    } catch (const std::exception& e) {
+        con->set_status(400);
+        os << "Invalid request: " << e.what() << "\n";
+        return;
+    }
+
+    if (tile_entry_id < 0)
+        tile_entry_id = 
+            Globalreg::globalreg->entrytracker->register_field("kismet.devices.tile",
+                    tracker_element_factory<device_tracker_view_tile>(),
+                    "devices in a map tile");
+
+    auto tile = std::make_shared<device_tracker_view_tile>(tile_entry_id);
+
+    tile->set_zoom(z);
+    tile->set_x(x);
+    tile->set_y(y);
+
+    kis_unique_lock<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+            "device_tracker_view device_tile_endpoint");
+
+    if (spatial_index == nullptr) {
+        spatial_index = std::make_shared<device_tracker_view_spatial_index>();
+
+        for (const auto& d : *device_list)
+            spatial_index->update(std::static_pointer_cast<kis_tracked_device_base>(d));
+
+        con->add_cost(device_list->size());
+    }
+
+    tile->set_seq(devicetracker->get_device_mod_seq());
+
+    auto add_device = [&](const std::shared_ptr<kis_tracked_device_base>& dev) {
+        tile->add_key(dev->get_key());
+
+        if (dev->get_mod_seq() > since)
+            tile->get_devices()->push_back(summarize_tracker_element(
+                        devicetracker->snapshot_device(dev), summary_plan, rename_map));
+    };
+
+    uint64_t total = 0;
+
+    if (z < devicetracker->get_view_tile_cluster_zoom()) {
+        // Group the devices of each eighth of the tile; groups of one are sent as
+        // devices
+        struct tile_bin {
+            uint64_t count;
+            double sum_wx, sum_wy;
+            std::shared_ptr<kis_tracked_device_base> device;
+        };
+
+        std::array<tile_bin, 64> bins{};
+
+        spatial_index->walk(z, x, y, 
+                [&](double wx, double wy, const std::shared_ptr<kis_tracked_device_base>& dev) {
+                    auto bx = device_tracker_view_spatial_index::tile_coord(wx, z + 3) & 7;
+                    auto by = device_tracker_view_spatial_index::tile_coord(wy, z + 3) & 7;
+                    auto& b = bins[by * 8 + bx];
+
+                    b.count++;
+                    b.sum_wx += wx;
+                    b.sum_wy += wy;
+                    b.device = dev;
+
+                    total++;
+                });
+
+        for (const auto& b : bins) {
+            if (b.count == 0)
+                continue;
+
+            if (b.count == 1) {
+                add_device(b.device);
+                continue;
+            }
+
+            double lat, lon;
+            device_tracker_view_spatial_index::unproject(b.sum_wx / b.count, b.sum_wy / b.count,
+                    lat, lon);
+            tile->add_cluster(lat, lon, b.count);
+        }
+    } else {
+        spatial_index->walk(z, x, y, 
+                [&](double wx, double wy, const std::shared_ptr<kis_tracked_device_base>& dev) {
+                    add_device(dev);
+                    total++;
+                });
+    }
+
+    tile->set_total(total);
+
+    con->add_cost(total);
+
+    // The devices are snapshots, so the tile serializes without the lock
+    lk.unlock();
+
+    Globalreg::globalreg->entrytracker->serialize(static_cast<std::string>(con->uri()), os, 
+            tile, rename_map);
+}
+
 void device_tracker_view::device_endpoint_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
     std::ostream os(&con->response_stream());
 
-    // Summarization vector based on simplification part of shared data
-    auto summary_vec = std::vector<SharedElementSummary>{};
+    // Compiled summarization plan based on simplification part of shared data
+    auto summary_plan = tracker_element_summary_plan::from_json(Json::Value(Json::arrayValue));
 
     // Rename cache generated by summarization
     auto rename_map = Globalreg::new_from_pool<tracker_element_serializer::rename_map>();
@@ -565,18 +2079,7 @@ void device_tracker_view::device_endpoint_handler(std::shared_ptr<kis_net_beast_
         // If the json has a 'fields' record, derive the fields simplification
         auto fields = con->json().get("fields", Json::Value(Json::arrayValue));
 
-        for (const auto& i : fields) {
-            if (i.isString()) {
-                summary_vec.push_back(std::make_shared<tracker_element_summary>(i.asString()));
-            } else if (i.isArray()) {
-                if (i.size() != 2) 
-                    throw std::runtime_error("Invalid field map, expected [field, rename]");
-
-                summary_vec.push_back(std::make_shared<tracker_element_summary>(i[0].asString(), i[1].asString()));
-            } else {
-                throw std::runtime_error("Invalid field map, exected field or [field, rename]");
-            }
-        }
+        summary_plan = tracker_element_summary_plan::from_json(fields);
 
         // Capture timestamp and negative-offset timestamp
         auto raw_ts = con->json().get("last_time", 0).asInt64();
@@ -621,7 +2124,7 @@ void device_tracker_view::device_endpoint_handler(std::shared_ptr<kis_net_beast_
 
             // Search every field we return
             if (search_term.length() != 0) 
-                for (const auto& svi : summary_vec)
+                for (const auto& svi : summary_plan->summaries)
                     search_paths.push_back(svi->resolved_path);
 
             // We only allow ordering by a single column, we don't do sub-ordering;
@@ -682,14 +2185,195 @@ void device_tracker_view::device_endpoint_handler(std::shared_ptr<kis_net_beast_
         return;
     }
 
-    // Next vector we do work on
-    auto next_work_vec = std::make_shared<tracker_element_vector>();
+    // Publishes our result to identical queries waiting on it; returning without a result,
+    // such as for an invalid filter, tells them to run the query themselves
+    struct query_publisher {
+        std::shared_ptr<std::promise<std::shared_ptr<query_result>>> promise;
+
+        void publish(std::shared_ptr<query_result> result) {
+            if (promise != nullptr) {
+                promise->set_value(result);
+                promise.reset();
+            }
+        }
+
+        ~query_publisher() {
+            publish(nullptr);
+        }
+    } publisher;
+
+    if (devicetracker->get_view_cache_ms() > 0) {
+        auto cache_key = query_cache_key(con);
+        auto now = std::chrono::steady_clock::now();
+        std::shared_future<std::shared_ptr<query_result>> shared;
+
+        {
+            kis_lock_guard<kis_mutex> lk(query_cache_mutex, "device_tracker_view query cache");
+
+            auto ci = query_cache.find(cache_key);
+
+            if (ci != query_cache.end() && ci->second.list_seq == list_mod_seq &&
+                    (ci->second.expires > now ||
+                     ci->second.result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)) {
+                shared = ci->second.result;
+            } else {
+                for (auto i = query_cache.begin(); i != query_cache.end(); ) {
+                    if (i->second.expires <= now &&
+                            i->second.result.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                        i = query_cache.erase(i);
+                    else
+                        ++i;
+                }
+
+                publisher.promise = std::make_shared<std::promise<std::shared_ptr<query_result>>>();
+
+                query_cache[cache_key] = query_cache_entry{publisher.promise->get_future().share(),
+                    list_mod_seq, now + std::chrono::milliseconds(devicetracker->get_view_cache_ms())};
+            }
+        }
+
+        auto result = shared.valid() ? shared.get() : nullptr;
+
+        if (result != nullptr) {
+            con->add_cost(result->devices->size());
+
+            if (wrapper_elem == nullptr) {
+                os.write(result->serialized.data(), result->serialized.length());
+                return;
+            }
+
+            // Datatables responses echo the draw counter of each request, so only the 
+            // devices are shared
+            total_sz_elem->set(result->total_sz);
+            filtered_sz_elem->set(result->filtered_sz);
+
+            auto dt_wrapper = std::make_shared<tracker_element_string_map>();
+            dt_wrapper->insert("draw", dt_draw_elem);
+            dt_wrapper->insert("data", result->devices);
+            dt_wrapper->insert("recordsTotal", total_sz_elem);
+            dt_wrapper->insert("recordsFiltered", filtered_sz_elem);
+
+            Globalreg::globalreg->entrytracker->serialize(static_cast<std::string>(con->uri()), os, 
+                    dt_wrapper, result->rename_map);
+
+            return;
+        }
+    }
+
+    // Serialize the output and share it with identical queries
+    auto send_output = [&]() {
+        if (transmit == nullptr)
+            transmit = output_devices_elem;
+
+        if (publisher.promise == nullptr) {
+            Globalreg::globalreg->entrytracker->serialize(static_cast<std::string>(con->uri()), os, 
+                    transmit, rename_map);
+            return;
+        }
+
+        auto result = std::make_shared<query_result>();
+        result->devices = output_devices_elem;
+        result->rename_map = rename_map;
+        result->total_sz = total_sz_elem->get();
+        result->filtered_sz = filtered_sz_elem->get();
+
+        if (transmit == output_devices_elem) {
+            std::stringstream ss;
+            Globalreg::globalreg->entrytracker->serialize(static_cast<std::string>(con->uri()), ss, 
+                    transmit, rename_map);
+            result->serialized = ss.str();
+
+            publisher.publish(result);
+
+            os.write(result->serialized.data(), result->serialized.length());
+            return;
+        }
+
+        publisher.publish(result);
+
+        Globalreg::globalreg->entrytracker->serialize(static_cast<std::string>(con->uri()), os, 
+                transmit, rename_map);
+    };
+
+    // Sorted windows without a search or regex filter are answered directly from the sort
+    // index, without copying or sorting the view
+    if (in_order_column_num.length() && order_field.size() > 0 && 
+            search_term.length() == 0 && regex.isNull()) {
+        kis_unique_lock<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+                "device_tracker_view device_endpoint_handler index");
+
+        auto index = get_index(order_field);
+
+        if (index != nullptr) {
+            std::shared_ptr<device_tracker_view_index> time_index;
+
+            if (timestamp_min > 0)
+                time_index = get_index(last_time_path);
+
+            index_flush();
+
+            total_sz_elem->set(device_list->size());
+
+            size_t filtered_sz = 
+                time_index != nullptr ? time_index->count_at_least(timestamp_min) : index->size();
+
+            filtered_sz_elem->set(filtered_sz);
+
+            if (in_window_start >= filtered_sz)
+                in_window_start = 0;
+
+            start_elem->set(in_window_start);
+
+            size_t window_len = in_window_len;
+            if (window_len == 0 || in_window_start + window_len > filtered_sz)
+                window_len = filtered_sz - in_window_start;
+
+            length_elem->set(window_len);
+
+            // Without a time filter we can seek straight to the window; otherwise walk the
+            // sorted list and skip anything outside the time range
+            size_t skip = time_index != nullptr ? in_window_start : 0;
+            size_t seek = time_index != nullptr ? 0 : in_window_start;
+            size_t taken = 0;
+
+            if (window_len > 0) {
+                index->walk(in_order_direction != 0, seek, 
+                        [&](const std::shared_ptr<kis_tracked_device_base>& dev) -> bool {
+                            if (time_index != nullptr && dev->get_last_time() < timestamp_min)
+                                return true;
+
+                            if (skip > 0) {
+                                skip--;
+                                return true;
+                            }
+
+                            output_devices_elem->push_back(summarize_tracker_element(
+                                        devicetracker->snapshot_device(dev), summary_plan, rename_map));
+
+                            return ++taken < window_len;
+                        });
+            }
+
+            // The window is made of device snapshots, so it serializes without the lock
+            lk.unlock();
+
+            con->add_cost(in_window_start + taken);
+
+            send_output();
+
+            return;
+        }
+    }
 
-    // Copy the entire vector list, under lock, to the next work vector; this makes it an independent copy
-    // we can sort and manipulate
-    next_work_vec->set(device_list->begin(), device_list->end());
+    // Start from the immutable snapshot of the view; filters only hold the devicelist
+    // lock for blocks of devices at a time, so a slow search or regex doesn't stall 
+    // packet processing
+    auto snapshot = get_device_snapshot();
+    auto next_work_vec = snapshot;
     total_sz_elem->set(next_work_vec->size());
 
+    // Filters are charged by how many devices they examine
+
     // If we have a time filter, apply that first, it's the fastest.
     if (timestamp_min > 0) {
         auto worker = 
@@ -699,17 +2383,56 @@ void device_tracker_view::device_endpoint_handler(std::shared_ptr<kis_net_beast_
                 return true;
             });
 
-        // Do the work and copy the vector
-        auto ts_vec = do_readonly_device_work(worker, next_work_vec);
-        next_work_vec->set(ts_vec->begin(), ts_vec->end());
+        con->add_cost(next_work_vec->size());
+        next_work_vec = do_readonly_device_work(worker, next_work_vec);
     }
 
     // Apply a string filter
     if (search_term.length() > 0 && search_paths.size() > 0) {
         auto worker =
             device_tracker_view_icasestringmatch_worker(search_term, search_paths);
-        auto s_vec = do_readonly_device_work(worker, next_work_vec);
-        next_work_vec->set(s_vec->begin(), s_vec->end());
+
+        // Only search the devices the search index finds, when the query is long enough
+        std::shared_ptr<tracker_element_vector> candidates;
+
+        if (devicetracker->get_view_search_index() && 
+                search_term.length() >= device_tracker_view_search_index::min_query_len) {
+            kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+                    "device_tracker_view device_endpoint_handler search index");
+
+            auto index = get_search_index(search_paths);
+            index_flush();
+
+            candidates = std::make_shared<tracker_element_vector>();
+            if (!index->candidates(search_term, candidates))
+                candidates.reset();
+        }
+
+        if (candidates != nullptr) {
+            con->add_cost(candidates->size());
+            auto matched_vec = do_readonly_device_work(worker, candidates);
+
+            // Keep the order (and the time filter) of the work list; devices are compared
+            // by identity so this doesn't need the lock
+            std::unordered_set<const tracker_element *> matched_set;
+            for (const auto& d : *matched_vec)
+                matched_set.insert(d.get());
+
+            auto filtered_vec = std::make_shared<tracker_element_vector>();
+            filtered_vec->reserve(matched_set.size());
+
+            if (matched_set.size() > 0) {
+                for (const auto& d : *next_work_vec) {
+                    if (matched_set.find(d.get()) != matched_set.end())
+                        filtered_vec->push_back(d);
+                }
+            }
+
+            next_work_vec = filtered_vec;
+        } else {
+            con->add_cost(next_work_vec->size());
+            next_work_vec = do_readonly_device_work(worker, next_work_vec);
+        }
     }
 
     // Apply a regex filter
@@ -717,6 +2440,7 @@ void device_tracker_view::device_endpoint_handler(std::shared_ptr<kis_net_beast_
         try {
             auto worker = 
                 device_tracker_view_regex_worker(regex);
+            con->add_cost(next_work_vec->size() * regex_cost_units);
             auto r_vec = do_readonly_device_work(worker, next_work_vec);
             next_work_vec = r_vec;
             // next_work_vec->set(r_vec->begin(), r_vec->end());
@@ -727,6 +2451,15 @@ void device_tracker_view::device_endpoint_handler(std::shared_ptr<kis_net_beast_
         }
     }
 
+    // Sorting and summarizing read the devices directly; the summaries are built from
+    // device snapshots, so serializing doesn't hold the lock
+    kis_unique_lock<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+            "device_tracker_view device_endpoint_handler");
+
+    // Never sort the shared snapshot in place
+    if (next_work_vec == snapshot && in_order_column_num.length() && order_field.size() > 0)
+        next_work_vec = std::make_shared<tracker_element_vector>(snapshot);
+
     // Apply the filtered length
     filtered_sz_elem->set(next_work_vec->size());
 
@@ -748,7 +2481,11 @@ void device_tracker_view::device_endpoint_handler(std::shared_ptr<kis_net_beast_
     // Update the end
     length_elem->set(ei - si);
 
+    con->add_cost(ei - si);
+
     if (in_order_column_num.length() && order_field.size() > 0) {
+        con->add_cost(next_work_vec->size());
+
         std::stable_sort(
 #if defined(HAVE_CPP17_PARALLEL)
             std::execution::par_unseq,
@@ -779,15 +2516,45 @@ void device_tracker_view::device_endpoint_handler(std::shared_ptr<kis_net_beast_
 
     for (auto i = si; i != ei; ++i) {
         final_devices_vec->push_back(*i);
-        output_devices_elem->push_back(summarize_tracker_element(*i, summary_vec, rename_map));
+        output_devices_elem->push_back(summarize_tracker_element(
+                    devicetracker->snapshot_device(std::static_pointer_cast<kis_tracked_device_base>(*i)), 
+                    summary_plan, rename_map));
     }
 
-    // If the transmit wasn't assigned to a wrapper...
-    if (transmit == nullptr)
-        transmit = output_devices_elem;
+    lk.unlock();
 
     // Done
-    Globalreg::globalreg->entrytracker->serialize(static_cast<std::string>(con->uri()), os, transmit, rename_map);
+    send_output();
+}
+
+std::string device_tracker_view::query_cache_key(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    auto uri = static_cast<std::string>(con->uri());
+    auto qpos = uri.find('?');
+
+    if (qpos != std::string::npos)
+        uri = uri.substr(0, qpos);
+
+    // Json objects write their keys in order, so equivalent requests write the same
+    Json::StreamWriterBuilder wb;
+    wb["indentation"] = "";
+
+    auto key = uri + "\n" + Json::writeString(wb, con->json());
+
+    // Variables are sorted for the same reason; the jquery cache buster is skipped too
+    std::map<std::string, std::string> vars;
+
+    for (const auto& v : con->http_variables()) {
+        if (v.first == "json" || v.first == "draw" || v.first == "_" || 
+                v.first == kis_net_beast_httpd::AUTH_COOKIE)
+            continue;
+
+        vars[v.first] = v.second;
+    }
+
+    for (const auto& v : vars)
+        key += fmt::format("\n{}={}", v.first, v.second);
+
+    return key;
 }
 
 
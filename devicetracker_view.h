@@ -21,9 +21,14 @@
 
 #include "config.h"
 
+#include <chrono>
 #include <functional>
+#include <future>
+#include <set>
 #include <unordered_map>
+#include <vector>
 
+#include "robin_hood.h"
 #include "uuid.h"
 #include "trackedelement.h"
 #include "trackedcomponent.h"
@@ -48,10 +53,424 @@
 //
 // Main device sorting/filtering/datatables view lives under:
 // /devices/view/[view id]/devices.json
+//
+// Devices changed since a previous poll, by device modification sequence number, live under:
+// /devices/view/[view id]/since-seq/[seq]/devices.json
+//
+// The devices with the highest value of a metric (signal, packets, packet_rate, or
+// last_time) live under:
+// /devices/view/[view id]/top/[metric]/[count]/devices.json
+//
+// The devices of the view in one web mercator map tile (clustered at low zoom, and
+// optionally only those changed since a previous poll) live under:
+// /devices/view/[view id]/tile/[z]/[x]/[y]/devices.json
+//
+// Changes to the view can be pushed to websocket clients instead of polled, under:
+// /devices/view/[view id]/subscribe.ws
 
 class kis_tracked_device;
 class device_tracker_view;
 
+// Device inputs the update callback of a view can depend on.  Code which changes a device
+// reports the inputs it changed to device_tracker::update_view_device, and only views
+// depending on one of them have their update callback run; the rest only see the
+// device as modified.
+#define VIEW_DEP_NONE       0
+// Phy of the device, which never changes once it is created
+#define VIEW_DEP_PHY        1
+// Set of datasources which have seen the device
+#define VIEW_DEP_SEENBY     (1 << 1)
+// Type of the device and the records of its phy
+#define VIEW_DEP_TYPE       (1 << 2)
+// Anything; views which don't declare their inputs are always updated
+#define VIEW_DEP_ALL        0xFFFFFFFF
+
+// Websocket subscription to a view.  Devices which change, join, or leave the view are
+// collected by the view as it is updated, and pushed to the client as one batch per
+// interval; nothing is scanned to find them.
+struct device_tracker_view_subscription {
+    std::shared_ptr<kis_net_web_websocket_endpoint> ws;
+
+    // Field summary request
+    Json::Value json;
+
+    int timer_id;
+
+    // Pending changes, protected by the view subscription mutex
+    std::unordered_map<device_key, std::shared_ptr<kis_tracked_device_base>> changed;
+    std::vector<device_key> removed;
+};
+
+// Incrementally maintained sort index over the devices in a view, keyed on a single
+// numeric or string field.  Entries are held in bounded sorted blocks so that inserting,
+// removing, and seeking to a window in the sorted order never requires copying or 
+// re-sorting the whole view.
+//
+// Indexes are not thread safe; like the rest of the view they must be manipulated under the
+// devicelist lock.
+class device_tracker_view_index {
+public:
+    device_tracker_view_index(const std::vector<int>& in_path) :
+        path_{in_path},
+        n_entries{0} { }
+
+    const std::vector<int>& path() const { return path_; }
+    size_t size() const { return n_entries; }
+
+    void insert(std::shared_ptr<kis_tracked_device_base> device);
+    void remove(std::shared_ptr<kis_tracked_device_base> device);
+
+    // Re-sort a device if its key has changed since it was indexed
+    void update(std::shared_ptr<kis_tracked_device_base> device);
+
+    // Walk the index in sorted order, starting at the offset'th entry; the callback returns
+    // false to end the walk
+    void walk(bool descending, size_t offset, 
+            const std::function<bool (const std::shared_ptr<kis_tracked_device_base>&)>& cb) const;
+
+    // Number of devices with a numeric key greater than or equal to in_val
+    size_t count_at_least(int64_t in_val) const;
+
+protected:
+    struct index_key {
+        bool present;
+        int64_t num;
+        std::string str;
+        device_key key;
+    };
+
+    struct index_entry {
+        index_key key;
+        std::shared_ptr<kis_tracked_device_base> device;
+    };
+
+    static bool key_less(const index_key& a, const index_key& b);
+    static bool key_equal(const index_key& a, const index_key& b);
+
+    index_key make_key(const std::shared_ptr<kis_tracked_device_base>& device) const;
+
+    // Block which would contain a key
+    size_t find_block(const index_key& k) const;
+
+    void insert_key(const index_key& k, std::shared_ptr<kis_tracked_device_base> device);
+    void remove_key(const index_key& k);
+
+    static constexpr size_t block_max = 512;
+
+    std::vector<int> path_;
+    std::vector<std::vector<index_entry>> blocks;
+    std::unordered_map<device_key, index_key> indexed_keys;
+    size_t n_entries;
+};
+
+// Incrementally maintained n-gram index of the text a case-insensitive string search
+// examines in the devices of a view, for one set of search fields.  Every string field
+// is indexed by its case folded trigrams, and MAC address fields by their 1 to 3 byte
+// substrings, so a search only needs to examine the devices which contain every gram
+// of the query instead of every device in the view.
+//
+// Candidates are a superset of the matches; they are confirmed with the same
+// icasestringmatch worker a linear search uses, so indexed and unindexed searches
+// return the same devices.
+//
+// Like the sort indexes, search indexes must be manipulated under the devicelist lock.
+class device_tracker_view_search_index {
+public:
+    device_tracker_view_search_index(const std::vector<std::vector<int>>& in_paths) :
+        paths_{in_paths} { }
+
+    const std::vector<std::vector<int>>& paths() const { return paths_; }
+    size_t size() const { return slot_map.size(); }
+
+    void insert(std::shared_ptr<kis_tracked_device_base> device);
+    void remove(std::shared_ptr<kis_tracked_device_base> device);
+
+    // Re-index a device if its searchable text has changed since it was indexed
+    void update(std::shared_ptr<kis_tracked_device_base> device);
+
+    // Devices which may match a search for in_query; returns false if the query is too
+    // short to use the index, and every device has to be searched
+    bool candidates(const std::string& in_query, std::shared_ptr<tracker_element_vector> ret) const;
+
+    // Queries shorter than this (after case folding) can't use the index
+    static constexpr size_t min_query_len = 3;
+
+protected:
+    using gram = uint32_t;
+
+    struct indexed_device {
+        std::shared_ptr<kis_tracked_device_base> device;
+        // Sorted, unique
+        std::vector<gram> grams;
+    };
+
+    std::vector<gram> make_grams(const std::shared_ptr<kis_tracked_device_base>& device) const;
+
+    static void text_grams(const std::string& in_text, std::vector<gram>& grams);
+    static void mac_grams(const uint8_t *in_bytes, size_t in_len, std::vector<gram>& grams);
+
+    void add_grams(uint32_t slot, const std::vector<gram>& grams);
+    void remove_grams(uint32_t slot, const std::vector<gram>& grams);
+
+    std::vector<std::vector<int>> paths_;
+
+    std::unordered_map<device_key, uint32_t> slot_map;
+    std::vector<indexed_device> slots;
+    std::vector<uint32_t> free_slots;
+
+    robin_hood::unordered_flat_map<gram, robin_hood::unordered_flat_set<uint32_t>> postings;
+};
+
+// Bounded set of the devices of a view with the highest value of one metric, for
+// "strongest / most active N" queries.  A top-k set keeps up to twice its k devices;
+// updating a device is O(log k), and reading the top k is O(k) unless the set has to
+// be rebuilt from the view.
+//
+// Devices which are rejected or evicted raise the floor to their value; every device
+// outside the set had at most the floor value when it was last seen, so the set holds
+// the true top k as long as k of its members are at least the floor.  When members
+// drop below it the set is rebuilt from the view on the next read.
+//
+// Like the sort indexes, top-k sets must be manipulated under the devicelist lock.
+class device_tracker_view_topk {
+public:
+    enum class topk_metric {
+        signal, packets, packet_rate, last_time
+    };
+
+    device_tracker_view_topk(topk_metric in_metric, size_t in_k) :
+        metric_{in_metric},
+        k_{in_k},
+        floor{INT64_MIN} { }
+
+    topk_metric metric() const { return metric_; }
+    size_t k() const { return k_; }
+
+    // Parse a metric name from a URI
+    static bool parse_metric(const std::string& in_name, topk_metric& out_metric);
+
+    void update(std::shared_ptr<kis_tracked_device_base> device);
+    void remove(std::shared_ptr<kis_tracked_device_base> device);
+
+    // Repopulate from every device in the view
+    void rebuild(std::shared_ptr<tracker_element_vector> devices);
+
+    // Walk the top k devices, highest first; returns false if the set no longer holds
+    // the top k and has to be rebuilt first
+    bool walk(size_t view_sz,
+            const std::function<void (const std::shared_ptr<kis_tracked_device_base>&)>& cb);
+
+protected:
+    int64_t value(const std::shared_ptr<kis_tracked_device_base>& device) const;
+
+    // Re-rank the members by their current value, for metrics which change without
+    // the device changing
+    void refresh();
+
+    void raise_floor(int64_t in_val) {
+        if (in_val > floor)
+            floor = in_val;
+    }
+
+    struct member {
+        int64_t value;
+        std::shared_ptr<kis_tracked_device_base> device;
+    };
+
+    topk_metric metric_;
+    size_t k_;
+    int64_t floor;
+
+    std::set<std::pair<int64_t, device_key>> ranked;
+    std::unordered_map<device_key, member> members;
+};
+
+// Grid of the locations of the devices in a view, in web mercator (slippy map) tiles
+// at a fixed zoom, so a map tile only has to examine the devices in the grid cells
+// under it instead of every device in the view.  Devices are placed by their last
+// location, and devices without one are left out.
+//
+// Like the sort indexes, the spatial index must be manipulated under the devicelist lock.
+class device_tracker_view_spatial_index {
+public:
+    // Zoom of the grid cells, about 10km across at the equator
+    static constexpr unsigned int cell_zoom = 12;
+    // Deepest queryable zoom
+    static constexpr unsigned int max_zoom = 24;
+
+    size_t size() const { return located.size(); }
+
+    // Place, move, or remove a device according to its current location
+    void update(std::shared_ptr<kis_tracked_device_base> device);
+    void remove(std::shared_ptr<kis_tracked_device_base> device);
+
+    // Walk the devices in tile x, y at zoom z, with their projected location
+    void walk(unsigned int z, uint32_t x, uint32_t y,
+            const std::function<void (double wx, double wy, 
+                const std::shared_ptr<kis_tracked_device_base>&)>& cb) const;
+
+    // Project the last location of a device onto the unit square of the web mercator
+    // world; returns false if the device has no location
+    static bool project(const std::shared_ptr<kis_tracked_device_base>& device, 
+            double& wx, double& wy);
+    static void unproject(double wx, double wy, double& lat, double& lon);
+
+    // Tile of a projected coordinate at zoom z
+    static uint32_t tile_coord(double w, unsigned int z);
+
+protected:
+    struct entry {
+        double wx, wy;
+        std::shared_ptr<kis_tracked_device_base> device;
+    };
+
+    static uint64_t cell_key(uint32_t cx, uint32_t cy) {
+        return ((uint64_t) cx << 32) | cy;
+    }
+
+    void walk_cell(uint64_t key, const std::function<void (double, double,
+                const std::shared_ptr<kis_tracked_device_base>&)>& cb) const;
+
+    std::unordered_map<uint64_t, std::unordered_map<device_key, entry>> cells;
+    std::unordered_map<device_key, uint64_t> located;
+};
+
+// Group of devices too close together to show individually in a map tile
+class device_tracker_view_tile_cluster : public tracker_component {
+public:
+    device_tracker_view_tile_cluster() :
+        tracker_component() {
+        register_fields();
+        reserve_fields(nullptr);
+    }
+
+    device_tracker_view_tile_cluster(int in_id) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(nullptr);
+    }
+
+    device_tracker_view_tile_cluster(int in_id, std::shared_ptr<tracker_element_map> e) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(e);
+    }
+
+    virtual std::shared_ptr<tracker_element> clone_type() override {
+        using this_t = typename std::remove_pointer<decltype(this)>::type;
+        auto r = std::make_shared<this_t>();
+        r->set_id(this->get_id());
+        return r;
+    }
+
+    __Proxy(lat, double, double, double, lat);
+    __Proxy(lon, double, double, double, lon);
+    __Proxy(count, uint64_t, uint64_t, uint64_t, count);
+
+protected:
+    virtual void register_fields() override {
+        tracker_component::register_fields();
+
+        register_field("kismet.devices.tile.cluster.lat", "center latitude", &lat);
+        register_field("kismet.devices.tile.cluster.lon", "center longitude", &lon);
+        register_field("kismet.devices.tile.cluster.count", "number of devices", &count);
+    }
+
+    std::shared_ptr<tracker_element_double> lat;
+    std::shared_ptr<tracker_element_double> lon;
+    std::shared_ptr<tracker_element_uint64> count;
+};
+
+// Devices of a view in one map tile
+class device_tracker_view_tile : public tracker_component {
+public:
+    device_tracker_view_tile() :
+        tracker_component() {
+        register_fields();
+        reserve_fields(nullptr);
+    }
+
+    device_tracker_view_tile(int in_id) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(nullptr);
+    }
+
+    device_tracker_view_tile(int in_id, std::shared_ptr<tracker_element_map> e) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(e);
+    }
+
+    virtual std::shared_ptr<tracker_element> clone_type() override {
+        using this_t = typename std::remove_pointer<decltype(this)>::type;
+        auto r = std::make_shared<this_t>();
+        r->set_id(this->get_id());
+        return r;
+    }
+
+    __Proxy(zoom, uint8_t, unsigned int, unsigned int, zoom);
+    __Proxy(x, uint32_t, uint32_t, uint32_t, x);
+    __Proxy(y, uint32_t, uint32_t, uint32_t, y);
+    __Proxy(seq, uint64_t, uint64_t, uint64_t, seq);
+    __Proxy(total, uint64_t, uint64_t, uint64_t, total);
+
+    __ProxyTrackable(devices, tracker_element_vector, devices);
+    __ProxyTrackable(keys, tracker_element_vector, keys);
+    __ProxyTrackable(clusters, tracker_element_vector, clusters);
+
+    void add_key(const device_key& in_key) {
+        auto k = std::make_shared<tracker_element_device_key>(device_key_id);
+        k->set(in_key);
+        keys->push_back(k);
+    }
+
+    void add_cluster(double in_lat, double in_lon, uint64_t in_count) {
+        auto c = std::make_shared<device_tracker_view_tile_cluster>(cluster_id);
+        c->set_lat(in_lat);
+        c->set_lon(in_lon);
+        c->set_count(in_count);
+        clusters->push_back(c);
+    }
+
+protected:
+    virtual void register_fields() override {
+        tracker_component::register_fields();
+
+        register_field("kismet.devices.tile.zoom", "tile zoom", &zoom);
+        register_field("kismet.devices.tile.x", "tile x", &x);
+        register_field("kismet.devices.tile.y", "tile y", &y);
+        register_field("kismet.devices.tile.seq", 
+                "device modification sequence to request changes since", &seq);
+        register_field("kismet.devices.tile.total", "devices in the tile", &total);
+        register_field("kismet.devices.tile.devices", 
+                "devices in the tile changed since the requested sequence", &devices);
+        register_field("kismet.devices.tile.keys", 
+                "keys of the devices in the tile outside of clusters", &keys);
+        register_field("kismet.devices.tile.clusters", "clusters of devices", &clusters);
+
+        device_key_id =
+            register_field("kismet.devices.tile.key",
+                    tracker_element_factory<tracker_element_device_key>(),
+                    "device key");
+        cluster_id = 
+            register_field("kismet.devices.tile.cluster",
+                    tracker_element_factory<device_tracker_view_tile_cluster>(),
+                    "cluster of devices");
+    }
+
+    std::shared_ptr<tracker_element_uint8> zoom;
+    std::shared_ptr<tracker_element_uint32> x;
+    std::shared_ptr<tracker_element_uint32> y;
+    std::shared_ptr<tracker_element_uint64> seq;
+    std::shared_ptr<tracker_element_uint64> total;
+    std::shared_ptr<tracker_element_vector> devices;
+    std::shared_ptr<tracker_element_vector> keys;
+    std::shared_ptr<tracker_element_vector> clusters;
+    int device_key_id;
+    int cluster_id;
+};
+
 class device_tracker_view : public tracker_component {
 public:
     // The new device callback is called whenever a new device is created by the devicetracker;
@@ -86,10 +505,17 @@ public:
     virtual void pre_serialize() override;
     virtual void post_serialize() override;
 
-    // Do work on the base list of all devices in this view; this makes an immutable copy
-    // before performing work
+    // Immutable snapshot of the devices in this view.  Snapshots are only rebuilt after the
+    // view has changed, and a snapshot stays valid for as long as a caller holds it, so
+    // readers can walk it without holding the devicelist lock.  The devices themselves are
+    // not copied and must still be accessed under the devicelist lock.
+    std::shared_ptr<tracker_element_vector> get_device_snapshot();
+
+    // Do work on the base list of all devices in this view; this works on the immutable 
+    // snapshot of the view
     virtual std::shared_ptr<tracker_element_vector> do_device_work(device_tracker_view_worker& worker);
-    // Do read-only work; this MAY NOT modify devices in the worker!
+    // Do read-only work; this MAY NOT modify devices in the worker!  Read-only work only
+    // holds the devicelist lock for blocks of devices at a time.
     virtual std::shared_ptr<tracker_element_vector> do_readonly_device_work(device_tracker_view_worker& worker);
 
     // Do work on a specific vector; this does NOT make an immutable copy of the vector.  You
@@ -100,11 +526,26 @@ public:
     virtual std::shared_ptr<tracker_element_vector> do_readonly_device_work(device_tracker_view_worker& worker,
             std::shared_ptr<tracker_element_vector> vec);
 
+    // Split read-only work across multiple threads; only valid for workers which are 
+    // parallel_safe()
+    std::shared_ptr<tracker_element_vector> do_parallel_device_work(device_tracker_view_worker& worker,
+            std::shared_ptr<tracker_element_vector> vec, size_t n_threads);
+
     // Called when a device undergoes a change that might make it eligible for inclusion
     // into a view; Integration with view filtering needs to be added to other locations
     // to activate this.
     virtual void update_device(std::shared_ptr<kis_tracked_device_base> device);
 
+    // Inputs the update callback depends on, as VIEW_DEP_ flags; VIEW_DEP_ALL unless set
+    // when the view is created
+    uint32_t get_update_deps() const {
+        return update_deps;
+    }
+
+    void set_update_deps(uint32_t in_deps) {
+        update_deps = in_deps;
+    }
+
     // Direct calls to views that do not participate in the traditional view population 
     // and are instead directly manipulated by another component (such as the ssidscan system which
     // maintains a view by directly adding target devices)
@@ -114,6 +555,11 @@ public:
 	// Look for an existing device record under read-only shared lock
     std::shared_ptr<kis_tracked_device_base> fetch_device(device_key in_key);
 
+    // Called by the devicetracker when any device is modified; if this view holds the
+    // device and has built sort or search indexes, the device is re-indexed the next
+    // time the indexes are used.  Must be called under the devicelist lock.
+    void device_modified(std::shared_ptr<kis_tracked_device_base> device);
+
 protected:
     std::shared_ptr<device_tracker> devicetracker;
 
@@ -135,14 +581,100 @@ protected:
 
     new_device_cb new_cb;
     updated_device_cb update_cb;
+    uint32_t update_deps;
 
     // Main vector of devices
     std::shared_ptr<tracker_element_vector> device_list;
     // Map of device presence in our list for fast reference during updates
     std::unordered_map<device_key, bool> device_presence_map;
 
+    // Published snapshot of device_list, swapped atomically
+    std::shared_ptr<tracker_element_vector> device_snapshot;
+    std::atomic<bool> snapshot_valid;
+
+    // Bumped whenever the list membership changes, for endpoint ETags
+    std::atomic<uint64_t> list_mod_seq;
+    uint64_t endpoint_version();
+
+    // Sort indexes, built the first time a windowed query orders by an indexable field
+    // and maintained afterwards
+    std::vector<std::shared_ptr<device_tracker_view_index>> indexes;
+    std::vector<std::vector<int>> indexable_paths;
+    std::vector<int> last_time_path;
+
+    // Search indexes, built the first time a search uses a set of search fields, and
+    // maintained afterwards; only the most recent sets of fields are kept
+    std::vector<std::shared_ptr<device_tracker_view_search_index>> search_indexes;
+    static constexpr size_t max_search_indexes = 4;
+
+    // Devices modified since the indexes were last used
+    std::unordered_map<device_key, std::shared_ptr<kis_tracked_device_base>> index_dirty;
+
+    // Top-k sets, built the first time a metric and count are queried and maintained as
+    // devices change; only the most recent are kept
+    std::vector<std::shared_ptr<device_tracker_view_topk>> topks;
+    static constexpr size_t max_topks = 4;
+    static constexpr size_t max_topk_count = 1000;
+
+    std::shared_ptr<device_tracker_view_topk> 
+        get_topk(device_tracker_view_topk::topk_metric metric, size_t k);
+    std::shared_ptr<tracker_element> device_topk_endpoint(std::shared_ptr<kis_net_beast_httpd_connection> con);
+
+    // Spatial index, built the first time a map tile is queried and maintained afterwards
+    std::shared_ptr<device_tracker_view_spatial_index> spatial_index;
+    int tile_entry_id = -1;
+
+    void device_tile_endpoint_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
+
+    std::shared_ptr<device_tracker_view_index> get_index(const std::vector<int>& path);
+    std::shared_ptr<device_tracker_view_search_index> 
+        get_search_index(const std::vector<std::vector<int>>& paths);
+    void index_add(std::shared_ptr<kis_tracked_device_base> device);
+    void index_remove(std::shared_ptr<kis_tracked_device_base> device);
+    void index_flush();
+
     void device_endpoint_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
+
+    // Results of device list queries.  Identical queries share one result while the view
+    // membership is unchanged, for up to tracker_view_cache_ms; queries which arrive while
+    // the result is being generated wait for it instead of repeating the work.
+    struct query_result {
+        // Summarized output window and the names generated by the summary
+        std::shared_ptr<tracker_element_vector> devices;
+        std::shared_ptr<tracker_element_serializer::rename_map> rename_map;
+
+        uint64_t total_sz;
+        uint64_t filtered_sz;
+
+        // Serialized device list, for queries without a datatables wrapper
+        std::string serialized;
+    };
+
+    struct query_cache_entry {
+        std::shared_future<std::shared_ptr<query_result>> result;
+        uint64_t list_seq;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    kis_mutex query_cache_mutex;
+    std::unordered_map<std::string, query_cache_entry> query_cache;
+
+    // Normalized query: the target, the request json, and the request variables other
+    // than the session and the per-request datatables draw counter
+    std::string query_cache_key(std::shared_ptr<kis_net_beast_httpd_connection> con);
+    void subscribe_endpoint_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
+
+    // Push subscriptions; updates are only recorded while there are subscribers.
+    // The subscription mutex is taken under the devicelist lock, never the reverse.
+    kis_mutex subscription_mutex;
+    std::vector<std::shared_ptr<device_tracker_view_subscription>> subscriptions;
+    std::atomic<size_t> n_subscriptions;
+
+    void subscription_changed(std::shared_ptr<kis_tracked_device_base> device);
+    void subscription_removed(std::shared_ptr<kis_tracked_device_base> device);
+    void subscription_flush(std::shared_ptr<device_tracker_view_subscription> sub);
     std::shared_ptr<tracker_element> device_time_endpoint(std::shared_ptr<kis_net_beast_httpd_connection> con);
+    std::shared_ptr<tracker_element> device_seq_endpoint(std::shared_ptr<kis_net_beast_httpd_connection> con);
 
     // device_tracker has direct access to protected methods for new devices and purging devices,
     // nobody else should be calling those
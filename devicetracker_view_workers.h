@@ -29,9 +29,7 @@
 #include "trackedcomponent.h"
 #include "devicetracker_component.h"
 
-#ifdef HAVE_LIBPCRE
-#include <pcre.h>
-#endif
+#include "kis_regex_cache.h"
 
 class device_tracker_view_worker {
 public:
@@ -47,6 +45,10 @@ public:
 
     virtual void finalize() { }
 
+    // Workers which keep no state in match_device may be run across multiple threads
+    // against large views
+    virtual bool parallel_safe() const { return false; }
+
 protected:
     friend class device_tracker_view;
 
@@ -80,11 +82,9 @@ public:
     struct pcre_filter {
 #ifdef HAVE_LIBPCRE
         pcre_filter(const std::string& target, const std::string& in_regex);
-        ~pcre_filter();
 
         std::string target;
-        pcre *re;
-        pcre_extra *study;
+        std::shared_ptr<kis_pcre_pattern> re;
 #endif
     };
 
@@ -109,6 +109,8 @@ public:
 
     virtual bool match_device(std::shared_ptr<kis_tracked_device_base> device) override;
 
+    virtual bool parallel_safe() const override { return true; }
+
 protected:
     std::vector<std::shared_ptr<device_tracker_view_regex_worker::pcre_filter>> filter_vec;
 
@@ -133,6 +135,8 @@ public:
 
     virtual bool match_device(std::shared_ptr<kis_tracked_device_base> device) override;
 
+    virtual bool parallel_safe() const override { return true; }
+
 protected:
     std::string query;
     std::vector<std::vector<int>> fieldpaths;
@@ -160,6 +164,8 @@ public:
 
     virtual bool match_device(std::shared_ptr<kis_tracked_device_base> device) override;
 
+    virtual bool parallel_safe() const override { return true; }
+
 protected:
     std::string query;
     std::vector<std::vector<int>> fieldpaths;
@@ -16,19 +16,78 @@
     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include <stdexcept>
+
 #include "globalregistry.h"
 #include "dot11_ie.h"
 
 void dot11_ie::parse(std::shared_ptr<kaitai::kstream> p_io) {
+    auto data = p_io->read_bytes_full();
+    parse(data.data(), data.length());
+}
+
+void dot11_ie::parse(const char *data, size_t len) {
+    reset();
+
+    m_data.assign(data, len);
+
+    // Walk the tag headers; each tag is a number, a length, and length bytes 
+    // of content
+    const auto buf = reinterpret_cast<const uint8_t *>(m_data.data());
+    size_t pos = 0;
+
+    m_index.reserve(32);
+
+    while (pos < len) {
+        if (pos + 2 > len)
+            throw std::runtime_error("truncated IE tag header");
+
+        uint8_t tlen = buf[pos + 1];
+
+        if (pos + 2 + tlen > len)
+            throw std::runtime_error("truncated IE tag");
+
+        m_index.push_back(tag_entry{buf[pos], tlen, static_cast<uint32_t>(pos + 2)});
+        pos += 2 + tlen;
+    }
+}
+
+std::shared_ptr<dot11_ie::dot11_ie_tag> dot11_ie::tag(size_t n) {
+    if (m_tag_objs.size() != m_index.size())
+        m_tag_objs.resize(m_index.size());
+
+    auto& t = m_tag_objs[n];
+
+    if (t == nullptr) {
+        t = Globalreg::new_from_pool<dot11_ie_tag>();
+        t->parse(tag_num(n), tag_view(n));
+    }
+
+    return t;
+}
+
+std::shared_ptr<dot11_ie::shared_ie_tag_vector> dot11_ie::tags() {
+    if (m_tags != nullptr)
+        return m_tags;
+
     m_tags = Globalreg::new_from_pool<shared_ie_tag_vector>();
+
+    for (size_t n = 0; n < m_index.size(); n++)
+        m_tags->push_back(tag(n));
+
+    return m_tags;
+}
+
+std::shared_ptr<dot11_ie::shared_ie_tag_map> dot11_ie::tags_map() {
+    if (m_tags_map != nullptr)
+        return m_tags_map;
+
     m_tags_map = Globalreg::new_from_pool<shared_ie_tag_map>();
 
-    while (!p_io->is_eof()) {
-        auto t = Globalreg::new_from_pool<dot11_ie_tag>();
-        t->parse(p_io);
-        m_tags->push_back(t);
-        (*m_tags_map)[t->tag_num()] = t;
-    }
+    for (size_t n = 0; n < m_index.size(); n++)
+        (*m_tags_map)[tag_num(n)] = tag(n);
+
+    return m_tags_map;
 }
 
 void dot11_ie::dot11_ie_tag::parse(std::shared_ptr<kaitai::kstream> p_io) {
@@ -38,3 +97,9 @@ void dot11_ie::dot11_ie_tag::parse(std::shared_ptr<kaitai::kstream> p_io) {
     m_tag_data_stream.reset(new kaitai::kstream(m_tag_data));
 }
 
+void dot11_ie::dot11_ie_tag::parse(uint8_t tag_num, std::string_view tag_data) {
+    m_tag_num = tag_num;
+    m_tag_len = tag_data.length();
+    m_tag_data.assign(tag_data.data(), tag_data.length());
+    m_tag_data_stream.reset(new kaitai::kstream(m_tag_data));
+}
@@ -21,7 +21,12 @@
 
 /* Parse a dot11 ie stream into individual objects.
  *
- * This uses the kaitai stream buffer from the kaitai runtime as it is a 
+ * The tag stream is copied once and scanned in a single pass into a compact
+ * index of tag numbers, lengths, and offsets; most consumers only need the tag
+ * number and raw bytes, so the per-tag objects (and their kaitai sub-streams)
+ * are only built when requested via tag(), tags(), or tags_map().
+ *
+ * Tag objects use the kaitai stream buffer from the kaitai runtime as it is a 
  * solid implementation of buffer-bounded operations and data extraction.
  *
  * Much of this is modeled on how kaitai generates parsers.
@@ -29,6 +34,7 @@
  */
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <vector>
 #include <unordered_map>
@@ -41,6 +47,12 @@ public:
     typedef std::vector<std::shared_ptr<dot11_ie_tag>> shared_ie_tag_vector;
     typedef std::unordered_map<uint8_t, std::shared_ptr<dot11_ie_tag>> shared_ie_tag_map;
 
+    struct tag_entry {
+        uint8_t num;
+        uint8_t len;
+        uint32_t offset;
+    };
+
     dot11_ie() {
 
     }
@@ -49,22 +61,71 @@ public:
 
     }
 
+    // Parse the remainder of a stream
     void parse(std::shared_ptr<kaitai::kstream> p_io);
 
-    std::shared_ptr<shared_ie_tag_vector> tags() const {
-        return m_tags;
+    // Parse a tag buffer; throws std::runtime_error on a truncated tag
+    void parse(const char *data, size_t len);
+
+    size_t n_tags() const {
+        return m_index.size();
+    }
+
+    uint8_t tag_num(size_t n) const {
+        return m_index[n].num;
+    }
+
+    uint8_t tag_len(size_t n) const {
+        return m_index[n].len;
+    }
+
+    std::string_view tag_view(size_t n) const {
+        return std::string_view(m_data.data() + m_index[n].offset, m_index[n].len);
     }
 
-    std::shared_ptr<shared_ie_tag_map> tags_map() const {
-        return m_tags_map;
+    // OUI and vendor type of a vendor tag (150, 221); the tag must be at least 3 bytes
+    uint32_t tag_vendor_oui(size_t n) const {
+        auto v = tag_view(n);
+        return (uint32_t) (
+                ((v[0] & 0xFF) << 16) + 
+                ((v[1] & 0xFF) << 8) +
+                ((v[2] & 0xFF)));
     }
 
+    uint8_t tag_vendor_type(size_t n) const {
+        auto v = tag_view(n);
+
+        if (v.length() < 4)
+            return 0;
+
+        return v[3];
+    }
+
+    const std::vector<tag_entry>& tag_index() const {
+        return m_index;
+    }
+
+    // Tag object for a single tag
+    std::shared_ptr<dot11_ie_tag> tag(size_t n);
+
+    std::shared_ptr<shared_ie_tag_vector> tags();
+    std::shared_ptr<shared_ie_tag_map> tags_map();
+
     void reset() {
-        m_tags->clear();
-        m_tags_map->clear();
+        m_data.clear();
+        m_index.clear();
+        m_tag_objs.clear();
+        m_tags.reset();
+        m_tags_map.reset();
     }
 
 protected:
+    std::string m_data;
+    std::vector<tag_entry> m_index;
+
+    // Tag objects, built on demand and indexed the same as m_index
+    std::vector<std::shared_ptr<dot11_ie_tag>> m_tag_objs;
+
     std::shared_ptr<shared_ie_tag_vector> m_tags;
     std::shared_ptr<shared_ie_tag_map> m_tags_map;
 
@@ -75,6 +136,7 @@ public:
         ~dot11_ie_tag() { }
 
         void parse(std::shared_ptr<kaitai::kstream> p_io);
+        void parse(uint8_t tag_num, std::string_view tag_data);
 
         constexpr17 uint8_t tag_num() const {
             return m_tag_num;
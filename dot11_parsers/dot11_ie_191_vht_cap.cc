@@ -19,10 +19,17 @@
 #include "dot11_ie_191_vht_cap.h"
 
 void dot11_ie_191_vht_cap::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_vht_capabilities = p_io->read_u4le();
-    m_rx_mcs_map = p_io->read_u2le();
-    m_rx_mcs_set = p_io->read_u2le();
-    m_tx_mcs_map = p_io->read_u2le();
-    m_tx_mcs_set = p_io->read_u2le();
+    auto data = p_io->read_bytes_full();
+    parse(std::string_view(data));
+}
+
+void dot11_ie_191_vht_cap::parse(std::string_view p_view) {
+    dot11_view_reader p_io(p_view);
+
+    m_vht_capabilities = p_io.read_u4le();
+    m_rx_mcs_map = p_io.read_u2le();
+    m_rx_mcs_set = p_io.read_u2le();
+    m_tx_mcs_map = p_io.read_u2le();
+    m_tx_mcs_set = p_io.read_u2le();
 }
 
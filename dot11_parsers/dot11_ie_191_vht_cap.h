@@ -26,10 +26,12 @@
  */
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <vector>
 #include <kaitai/kaitaistream.h>
 #include "multi_constexpr.h"
+#include "dot11_view_reader.h"
 
 class dot11_ie_191_vht_cap {
 public:
@@ -43,6 +45,7 @@ public:
     ~dot11_ie_191_vht_cap() { }
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
+    void parse(std::string_view p_view);
 
     constexpr17 uint32_t vht_capabilities() const {
         return m_vht_capabilities;
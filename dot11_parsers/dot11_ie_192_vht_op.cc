@@ -19,9 +19,16 @@
 #include "dot11_ie_192_vht_op.h"
 
 void dot11_ie_192_vht_op::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_channel_width = p_io->read_u1();
-    m_center1 = p_io->read_u1();
-    m_center2 = p_io->read_u1();
-    m_basic_mcs_map = p_io->read_u2be();
+    auto data = p_io->read_bytes_full();
+    parse(std::string_view(data));
+}
+
+void dot11_ie_192_vht_op::parse(std::string_view p_view) {
+    dot11_view_reader p_io(p_view);
+
+    m_channel_width = p_io.read_u1();
+    m_center1 = p_io.read_u1();
+    m_center2 = p_io.read_u1();
+    m_basic_mcs_map = p_io.read_u2be();
 }
 
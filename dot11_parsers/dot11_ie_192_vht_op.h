@@ -26,10 +26,12 @@
  */
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <vector>
 #include <kaitai/kaitaistream.h>
 #include "multi_constexpr.h"
+#include "dot11_view_reader.h"
 
 class dot11_ie_192_vht_op {
 public:
@@ -44,6 +46,7 @@ public:
     };
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
+    void parse(std::string_view p_view);
 
     constexpr17 ch_channel_width channel_width() const {
         return (ch_channel_width) m_channel_width;
@@ -16,22 +16,27 @@
     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
-#include "globalregistry.h"
 #include "dot11_ie_45_ht_cap.h"
 
 void dot11_ie_45_ht_cap::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_ht_capabilities = p_io->read_u2le();
-    m_ampdu = p_io->read_u1();
-    m_mcs = Globalreg::new_from_pool<dot11_ie_45_rx_mcs>();
-    m_mcs->parse(p_io);
-    m_ht_extended_caps = p_io->read_u2be();
-    m_txbf_caps = p_io->read_u4be();
-    m_asel_caps = p_io->read_u1();
+    auto data = p_io->read_bytes_full();
+    parse(std::string_view(data));
 }
 
-void dot11_ie_45_ht_cap::dot11_ie_45_rx_mcs::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_rx_mcs = p_io->read_bytes(10);
-    m_supported_data_rate = p_io->read_u2le();
-    m_txflags = p_io->read_u4be();
+void dot11_ie_45_ht_cap::parse(std::string_view p_view) {
+    dot11_view_reader p_io(p_view);
+
+    m_ht_capabilities = p_io.read_u2le();
+    m_ampdu = p_io.read_u1();
+    m_mcs.parse(p_io);
+    m_ht_extended_caps = p_io.read_u2be();
+    m_txbf_caps = p_io.read_u4be();
+    m_asel_caps = p_io.read_u1();
+}
+
+void dot11_ie_45_ht_cap::dot11_ie_45_rx_mcs::parse(dot11_view_reader& p_io) {
+    m_rx_mcs.assign(p_io.read_bytes(10));
+    m_supported_data_rate = p_io.read_u2le();
+    m_txflags = p_io.read_u4be();
 }
 
@@ -16,44 +16,59 @@
     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
-#include "globalregistry.h"
 #include "dot11_ie_48_rsn.h"
 
 void dot11_ie_48_rsn::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_rsn_version = p_io->read_u2le();
-    m_group_cipher = Globalreg::new_from_pool<dot11_ie_48_rsn::dot11_ie_48_rsn_rsn_cipher>();
-    m_group_cipher->parse(p_io);
-    m_pairwise_count = p_io->read_u2le();
-    m_pairwise_ciphers.reset(new shared_rsn_cipher_vector());
-    m_pairwise_ciphers = Globalreg::new_from_pool<shared_rsn_cipher_vector>();
+    auto data = p_io->read_bytes_full();
+    parse(std::string_view(data));
+}
+
+void dot11_ie_48_rsn::parse(std::string_view p_view) {
+    dot11_view_reader p_io(p_view);
+
+    m_rsn_version = p_io.read_u2le();
+    m_group_cipher.parse(p_io);
+
+    m_pairwise_count = p_io.read_u2le();
+    m_pairwise_ciphers.clear();
+
+    // Don't trust the count to size the vector; a hostile count runs out of
+    // data long before it runs out of vector
     for (unsigned int i = 0; i < pairwise_count(); i++) {
-        auto c = Globalreg::new_from_pool<dot11_ie_48_rsn_rsn_cipher>();
-        c->parse(p_io);
-        m_pairwise_ciphers->push_back(c);
+        m_pairwise_ciphers.emplace_back();
+        m_pairwise_ciphers.back().parse(p_io);
     }
-    m_akm_count = p_io->read_u2le();
-    m_akm_ciphers.reset(new shared_rsn_management_vector());
+
+    m_akm_count = p_io.read_u2le();
+    m_akm_ciphers.clear();
     for (unsigned int i = 0; i < akm_count(); i++) {
-        auto a = Globalreg::new_from_pool<dot11_ie_48_rsn_rsn_management>();
-        a->parse(p_io);
-        m_akm_ciphers->push_back(a);
+        m_akm_ciphers.emplace_back();
+        m_akm_ciphers.back().parse(p_io);
     }
-    m_rsn_capabilities = p_io->read_u2le();
+
+    m_rsn_capabilities = p_io.read_u2le();
 }
 
-void dot11_ie_48_rsn::dot11_ie_48_rsn_rsn_cipher::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_cipher_suite_oui = p_io->read_bytes(3);
-    m_cipher_type = p_io->read_u1();
+void dot11_ie_48_rsn::dot11_ie_48_rsn_rsn_cipher::parse(dot11_view_reader& p_io) {
+    m_cipher_suite_oui.assign(p_io.read_bytes(3));
+    m_cipher_type = p_io.read_u1();
 }
 
-void dot11_ie_48_rsn::dot11_ie_48_rsn_rsn_management::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_management_suite_oui = p_io->read_bytes(3);
-    m_management_type = p_io->read_u1();
+void dot11_ie_48_rsn::dot11_ie_48_rsn_rsn_management::parse(dot11_view_reader& p_io) {
+    m_management_suite_oui.assign(p_io.read_bytes(3));
+    m_management_type = p_io.read_u1();
 }
 
 void dot11_ie_48_rsn_partial::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_rsn_version = p_io->read_u2le();
-    m_group_cipher = p_io->read_bytes(4);
-    m_pairwise_count = p_io->read_u2le();
+    auto data = p_io->read_bytes_full();
+    parse(std::string_view(data));
+}
+
+void dot11_ie_48_rsn_partial::parse(std::string_view p_view) {
+    dot11_view_reader p_io(p_view);
+
+    m_rsn_version = p_io.read_u2le();
+    m_group_cipher.assign(p_io.read_bytes(4));
+    m_pairwise_count = p_io.read_u2le();
 }
 
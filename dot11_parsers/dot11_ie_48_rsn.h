@@ -29,95 +29,14 @@
  */
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <vector>
 #include <kaitai/kaitaistream.h>
 #include "multi_constexpr.h"
+#include "dot11_view_reader.h"
 
 class dot11_ie_48_rsn {
-public:
-    class dot11_ie_48_rsn_rsn_cipher;
-    class dot11_ie_48_rsn_rsn_management;
-
-    typedef std::vector<std::shared_ptr<dot11_ie_48_rsn_rsn_cipher> > shared_rsn_cipher_vector;
-    typedef std::vector<std::shared_ptr<dot11_ie_48_rsn_rsn_management> > shared_rsn_management_vector;
-
-    dot11_ie_48_rsn() { }
-    ~dot11_ie_48_rsn() { }
-
-    void parse(std::shared_ptr<kaitai::kstream> p_io);
-
-    constexpr17 uint16_t rsn_version() const {
-        return m_rsn_version;
-    }
-
-    std::shared_ptr<dot11_ie_48_rsn_rsn_cipher> group_cipher() const {
-        return m_group_cipher;
-    }
-
-    constexpr17 uint16_t pairwise_count() const {
-        return m_pairwise_count;
-    }
-
-    std::shared_ptr<shared_rsn_cipher_vector> pairwise_ciphers() const {
-        return m_pairwise_ciphers;
-    }
-
-    constexpr17 uint16_t akm_count() const {
-        return m_akm_count;
-    }
-
-    std::shared_ptr<shared_rsn_management_vector> akm_ciphers() const {
-        return m_akm_ciphers;
-    }
-
-    constexpr17 uint16_t rsn_capabilities() const {
-        return m_rsn_capabilities;
-    }
-
-    constexpr17 bool rsn_capability_preauth() const {
-        return rsn_capabilities() & 0x01;
-    }
-
-    constexpr17 bool rsn_capability_wep_pairwise() const {
-        return rsn_capabilities() & 0x02;
-    }
-
-    constexpr17 uint8_t rsn_capability_ptksa_replay() const {
-        return (rsn_capabilities() & 0x0C) >> 2;
-    }
-
-    constexpr17 uint8_t rsn_capability_gtksa_replay() const {
-        return (rsn_capabilities() & 0x30) >> 4;
-    }
-
-    constexpr17 bool rsn_capability_mfp_required() const {
-        return (rsn_capabilities() & 0x40);
-    }
-
-    constexpr17 bool rsn_capability_mfp_supported() const {
-        return (rsn_capabilities() & 0x80);
-    }
-
-    void reset() {
-        m_rsn_version = 0;
-        m_group_cipher.reset();
-        m_pairwise_count = 0;
-        m_pairwise_ciphers.reset();
-        m_akm_count = 0;
-        m_akm_ciphers.reset();
-        m_rsn_capabilities = 0;
-    }
-
-protected:
-    uint16_t m_rsn_version;
-    std::shared_ptr<dot11_ie_48_rsn_rsn_cipher> m_group_cipher;
-    uint16_t m_pairwise_count;
-    std::shared_ptr<shared_rsn_cipher_vector> m_pairwise_ciphers;
-    uint16_t m_akm_count;
-    std::shared_ptr<shared_rsn_management_vector> m_akm_ciphers;
-    uint16_t m_rsn_capabilities;
-
 public:
     class dot11_ie_48_rsn_rsn_cipher {
     public:
@@ -137,7 +56,7 @@ public:
 
         ~dot11_ie_48_rsn_rsn_cipher() { }
 
-        void parse(std::shared_ptr<kaitai::kstream> p_io);
+        void parse(dot11_view_reader& p_io);
 
         std::string cipher_suite_oui() const {
             return m_cipher_suite_oui;
@@ -174,7 +93,7 @@ public:
         dot11_ie_48_rsn_rsn_management() { }
         ~dot11_ie_48_rsn_rsn_management() { }
 
-        void parse(std::shared_ptr<kaitai::kstream> p_io);
+        void parse(dot11_view_reader& p_io);
 
         std::string management_suite_oui() const {
             return m_management_suite_oui;
@@ -194,6 +113,87 @@ public:
         uint8_t m_management_type;
     };
 
+    // Ciphers are held by value; a pooled RSN object keeps the vector capacity
+    // between packets, so parsing a beacon does not allocate
+    typedef std::vector<dot11_ie_48_rsn_rsn_cipher> rsn_cipher_vector;
+    typedef std::vector<dot11_ie_48_rsn_rsn_management> rsn_management_vector;
+
+    dot11_ie_48_rsn() { }
+    ~dot11_ie_48_rsn() { }
+
+    void parse(std::shared_ptr<kaitai::kstream> p_io);
+    void parse(std::string_view p_view);
+
+    constexpr17 uint16_t rsn_version() const {
+        return m_rsn_version;
+    }
+
+    const dot11_ie_48_rsn_rsn_cipher& group_cipher() const {
+        return m_group_cipher;
+    }
+
+    constexpr17 uint16_t pairwise_count() const {
+        return m_pairwise_count;
+    }
+
+    const rsn_cipher_vector& pairwise_ciphers() const {
+        return m_pairwise_ciphers;
+    }
+
+    constexpr17 uint16_t akm_count() const {
+        return m_akm_count;
+    }
+
+    const rsn_management_vector& akm_ciphers() const {
+        return m_akm_ciphers;
+    }
+
+    constexpr17 uint16_t rsn_capabilities() const {
+        return m_rsn_capabilities;
+    }
+
+    constexpr17 bool rsn_capability_preauth() const {
+        return rsn_capabilities() & 0x01;
+    }
+
+    constexpr17 bool rsn_capability_wep_pairwise() const {
+        return rsn_capabilities() & 0x02;
+    }
+
+    constexpr17 uint8_t rsn_capability_ptksa_replay() const {
+        return (rsn_capabilities() & 0x0C) >> 2;
+    }
+
+    constexpr17 uint8_t rsn_capability_gtksa_replay() const {
+        return (rsn_capabilities() & 0x30) >> 4;
+    }
+
+    constexpr17 bool rsn_capability_mfp_required() const {
+        return (rsn_capabilities() & 0x40);
+    }
+
+    constexpr17 bool rsn_capability_mfp_supported() const {
+        return (rsn_capabilities() & 0x80);
+    }
+
+    void reset() {
+        m_rsn_version = 0;
+        m_group_cipher.reset();
+        m_pairwise_count = 0;
+        m_pairwise_ciphers.clear();
+        m_akm_count = 0;
+        m_akm_ciphers.clear();
+        m_rsn_capabilities = 0;
+    }
+
+protected:
+    uint16_t m_rsn_version;
+    dot11_ie_48_rsn_rsn_cipher m_group_cipher;
+    uint16_t m_pairwise_count;
+    rsn_cipher_vector m_pairwise_ciphers;
+    uint16_t m_akm_count;
+    rsn_management_vector m_akm_ciphers;
+    uint16_t m_rsn_capabilities;
 };
 
 class dot11_ie_48_rsn_partial {
@@ -202,6 +202,7 @@ public:
     ~dot11_ie_48_rsn_partial() { }
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
+    void parse(std::string_view p_view);
 
     constexpr17 uint16_t rsn_version() const {
         return m_rsn_version;
@@ -19,10 +19,17 @@
 #include "dot11_ie_61_ht_op.h"
 
 void dot11_ie_61_ht_op::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_primary_channel = p_io->read_u1();
-    m_info_subset_1 = p_io->read_u1();
-    m_info_subset_2 = p_io->read_u2be();
-    m_info_subset_3 = p_io->read_u2be();
-    m_rx_coding_scheme = p_io->read_u2le();
+    auto data = p_io->read_bytes_full();
+    parse(std::string_view(data));
+}
+
+void dot11_ie_61_ht_op::parse(std::string_view p_view) {
+    dot11_view_reader p_io(p_view);
+
+    m_primary_channel = p_io.read_u1();
+    m_info_subset_1 = p_io.read_u1();
+    m_info_subset_2 = p_io.read_u2be();
+    m_info_subset_3 = p_io.read_u2be();
+    m_rx_coding_scheme = p_io.read_u2le();
 }
 
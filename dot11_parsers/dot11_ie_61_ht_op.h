@@ -26,10 +26,12 @@
  */
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <vector>
 #include <kaitai/kaitaistream.h>
 #include "multi_constexpr.h"
+#include "dot11_view_reader.h"
 
 class dot11_ie_61_ht_op {
 public:
@@ -37,6 +39,7 @@ public:
     ~dot11_ie_61_ht_op() { }
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
+    void parse(std::string_view p_view);
 
     constexpr17 uint8_t primary_channel() const {
         return m_primary_channel;
@@ -0,0 +1,126 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __DOT11_VIEW_READER_H__
+#define __DOT11_VIEW_READER_H__
+
+/* Bounds-checked reader over a view of a packet buffer
+ *
+ * A lightweight replacement for kaitai::kstream for the IE parsers; it
+ * does not copy or allocate, and reads past the end of the view throw
+ * std::runtime_error, which the dissectors already treat as a corrupt tag.
+ *
+ * Views returned by read_bytes and read_bytes_full point into the original
+ * buffer, so parsers must copy anything they keep.
+ */
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+
+class dot11_view_reader {
+public:
+    dot11_view_reader(std::string_view in_view) :
+        m_view{in_view},
+        m_pos{0} { }
+
+    bool is_eof() const {
+        return m_pos >= m_view.length();
+    }
+
+    size_t pos() const {
+        return m_pos;
+    }
+
+    size_t size() const {
+        return m_view.length();
+    }
+
+    void seek(size_t in_pos) {
+        if (in_pos > m_view.length())
+            throw std::runtime_error("seek past end of IE data");
+
+        m_pos = in_pos;
+    }
+
+    uint8_t read_u1() {
+        require(1);
+        return byte(m_pos++);
+    }
+
+    uint16_t read_u2le() {
+        require(2);
+        uint16_t r = byte(m_pos) | (byte(m_pos + 1) << 8);
+        m_pos += 2;
+        return r;
+    }
+
+    uint16_t read_u2be() {
+        require(2);
+        uint16_t r = (byte(m_pos) << 8) | byte(m_pos + 1);
+        m_pos += 2;
+        return r;
+    }
+
+    uint32_t read_u4le() {
+        require(4);
+        uint32_t r = (uint32_t) byte(m_pos) | ((uint32_t) byte(m_pos + 1) << 8) |
+            ((uint32_t) byte(m_pos + 2) << 16) | ((uint32_t) byte(m_pos + 3) << 24);
+        m_pos += 4;
+        return r;
+    }
+
+    uint32_t read_u4be() {
+        require(4);
+        uint32_t r = ((uint32_t) byte(m_pos) << 24) | ((uint32_t) byte(m_pos + 1) << 16) |
+            ((uint32_t) byte(m_pos + 2) << 8) | (uint32_t) byte(m_pos + 3);
+        m_pos += 4;
+        return r;
+    }
+
+    std::string_view read_bytes(size_t n) {
+        require(n);
+        auto r = m_view.substr(m_pos, n);
+        m_pos += n;
+        return r;
+    }
+
+    std::string_view read_bytes_full() {
+        auto r = m_view.substr(std::min(m_pos, m_view.length()));
+        m_pos = m_view.length();
+        return r;
+    }
+
+protected:
+    std::string_view m_view;
+    size_t m_pos;
+
+    void require(size_t n) const {
+        if (n > m_view.length() || m_pos > m_view.length() - n)
+            throw std::runtime_error("read past end of IE data");
+    }
+
+    uint8_t byte(size_t p) const {
+        return static_cast<uint8_t>(m_view[p]);
+    }
+};
+
+#endif
+
@@ -16,11 +16,335 @@
     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include <algorithm>
+
 #include "configfile.h"
 #include "datasourcetracker.h"
 #include "devicetracker.h"
 #include "dot11_ssidscan.h"
 #include "entrytracker.h"
+#include "phy_80211.h"
+
+dot11_ssidscan_planner::dot11_ssidscan_planner() :
+    min_hop{30},
+    max_dwell{30},
+    dwell_beacons{50},
+    hopping_sources{1},
+    target_timeout{300},
+    dirty{false},
+    next_plan{0},
+    next_expire{0} { }
+
+void dot11_ssidscan_planner::set_limits(time_t in_min_hop, time_t in_max_dwell) {
+    min_hop = in_min_hop;
+    max_dwell = std::max(in_max_dwell, (time_t) 1);
+    dirty = true;
+}
+
+void dot11_ssidscan_planner::set_dwell_beacons(unsigned int in_beacons) {
+    dwell_beacons = std::max(in_beacons, 1U);
+    dirty = true;
+}
+
+void dot11_ssidscan_planner::set_hopping_sources(unsigned int in_hopping) {
+    hopping_sources = in_hopping;
+    dirty = true;
+}
+
+void dot11_ssidscan_planner::set_target_timeout(time_t in_timeout) {
+    target_timeout = std::max(in_timeout, (time_t) 1);
+}
+
+void dot11_ssidscan_planner::add_source(const uuid& in_uuid, 
+        const std::vector<std::string>& in_channels) {
+    auto& src = sources[in_uuid];
+
+    src.channels = std::set<std::string>(in_channels.begin(), in_channels.end());
+    src.channel = "";
+    src.since = 0;
+    src.until = 0;
+
+    dirty = true;
+}
+
+void dot11_ssidscan_planner::remove_source(const uuid& in_uuid) {
+    if (sources.erase(in_uuid))
+        dirty = true;
+}
+
+void dot11_ssidscan_planner::clear() {
+    targets.clear();
+    channels.clear();
+    sources.clear();
+
+    dirty = false;
+    next_plan = 0;
+    next_expire = 0;
+}
+
+bool dot11_ssidscan_planner::can_tune(const source_t& in_source, 
+        const std::string& in_channel) const {
+    return in_source.channels.empty() || 
+        in_source.channels.find(in_channel) != in_source.channels.end();
+}
+
+time_t dot11_ssidscan_planner::contended_dwell(const channel_t& in_channel) const {
+    // Long enough to hear dwell_beacons beacons from the slowest target; a TU is 1024us
+    unsigned int tu = 100;
+
+    if (!in_channel.beacon_tu.empty())
+        tu = *(in_channel.beacon_tu.rbegin());
+
+    auto dwell = (time_t) ((uint64_t) dwell_beacons * tu * 1024 / 1000000) + 1;
+
+    return std::min(dwell, max_dwell);
+}
+
+void dot11_ssidscan_planner::add_active(const std::string& in_channel, unsigned int in_beacon_tu) {
+    auto& c = channels[in_channel];
+    c.num_active++;
+    c.beacon_tu.insert(in_beacon_tu);
+}
+
+void dot11_ssidscan_planner::remove_active(const std::string& in_channel, unsigned int in_beacon_tu) {
+    auto c = channels.find(in_channel);
+
+    if (c == channels.end())
+        return;
+
+    auto b = c->second.beacon_tu.find(in_beacon_tu);
+    if (b != c->second.beacon_tu.end())
+        c->second.beacon_tu.erase(b);
+
+    if (--c->second.num_active == 0)
+        channels.erase(c);
+}
+
+bool dot11_ssidscan_planner::sighting(const mac_addr& in_bssid, const std::string& in_channel,
+        unsigned int in_beacon_tu, time_t in_now) {
+    if (in_channel.empty() || in_channel == "0")
+        return false;
+
+    if (in_beacon_tu == 0)
+        in_beacon_tu = 100;
+
+    auto t = targets.find(in_bssid);
+
+    if (t == targets.end()) {
+        targets[in_bssid] = target_t{in_channel, in_beacon_tu, in_now, false};
+        add_active(in_channel, in_beacon_tu);
+
+        if (next_expire == 0)
+            next_expire = in_now + target_timeout;
+
+        dirty = true;
+        return true;
+    }
+
+    t->second.last_seen = in_now;
+
+    if (t->second.complete)
+        return false;
+
+    if (t->second.channel != in_channel || t->second.beacon_tu != in_beacon_tu) {
+        remove_active(t->second.channel, t->second.beacon_tu);
+        t->second.channel = in_channel;
+        t->second.beacon_tu = in_beacon_tu;
+        add_active(in_channel, in_beacon_tu);
+
+        dirty = true;
+        return true;
+    }
+
+    return false;
+}
+
+bool dot11_ssidscan_planner::complete(const mac_addr& in_bssid) {
+    auto t = targets.find(in_bssid);
+
+    if (t == targets.end() || t->second.complete)
+        return false;
+
+    t->second.complete = true;
+    remove_active(t->second.channel, t->second.beacon_tu);
+
+    dirty = true;
+    return true;
+}
+
+void dot11_ssidscan_planner::expire(time_t in_now) {
+    if (next_expire == 0 || in_now < next_expire)
+        return;
+
+    next_expire = 0;
+
+    for (auto t = targets.begin(); t != targets.end(); ) {
+        if (t->second.last_seen + target_timeout <= in_now) {
+            if (!t->second.complete)
+                remove_active(t->second.channel, t->second.beacon_tu);
+
+            t = targets.erase(t);
+            continue;
+        }
+
+        if (next_expire == 0 || t->second.last_seen + target_timeout < next_expire)
+            next_expire = t->second.last_seen + target_timeout;
+
+        ++t;
+    }
+}
+
+std::vector<dot11_ssidscan_planner::change> dot11_ssidscan_planner::plan(time_t in_now) {
+    dirty = false;
+    next_plan = 0;
+
+    expire(in_now);
+
+    using channel_ref = std::map<std::string, channel_t>::value_type *;
+
+    std::map<uuid, std::string> previous;
+    std::set<std::string> served;
+    size_t num_locked = 0;
+
+    auto release = [in_now](source_t& src) {
+        src.channel = "";
+        src.since = in_now;
+        src.until = 0;
+    };
+
+    // Keep the assignments which still have targets
+    for (auto& si : sources) {
+        auto& src = si.second;
+
+        previous[si.first] = src.channel;
+
+        if (src.channel.empty())
+            continue;
+
+        if (channels.find(src.channel) == channels.end() || 
+                served.find(src.channel) != served.end()) {
+            release(src);
+            continue;
+        }
+
+        served.insert(src.channel);
+        num_locked++;
+    }
+
+    // Channels with targets and no source, least recently served first, then busiest
+    std::vector<channel_ref> waiting;
+
+    for (auto& c : channels) {
+        if (served.find(c.first) == served.end())
+            waiting.push_back(&c);
+    }
+
+    std::sort(waiting.begin(), waiting.end(), 
+            [](channel_ref a, channel_ref b) -> bool {
+                if (a->second.last_served != b->second.last_served)
+                    return a->second.last_served < b->second.last_served;
+                return a->second.num_active > b->second.num_active;
+            });
+
+    // With no source left hopping, locked sources return to hopping for a while after
+    // each lock to find new targets
+    bool rotate_hop = sources.size() <= hopping_sources;
+
+    size_t max_locked = 
+        sources.size() > hopping_sources ? sources.size() - hopping_sources : sources.size();
+
+    // Sources which have used up their dwell give way; their channels rejoin the back
+    // of the queue
+    if (!waiting.empty() || rotate_hop) {
+        for (auto& si : sources) {
+            auto& src = si.second;
+
+            if (src.channel.empty() || src.until > in_now)
+                continue;
+
+            waiting.push_back(&(*channels.find(src.channel)));
+            served.erase(src.channel);
+            release(src);
+            num_locked--;
+        }
+    }
+
+    for (auto w : waiting) {
+        if (num_locked >= max_locked)
+            break;
+
+        if (served.find(w->first) != served.end())
+            continue;
+
+        // Of the free sources which can tune the channel, take the one able to tune the 
+        // fewest channels, leaving the more flexible sources for other channels
+        source_t *best = nullptr;
+
+        for (auto& si : sources) {
+            auto& src = si.second;
+
+            if (!src.channel.empty() || !can_tune(src, w->first))
+                continue;
+
+            if (rotate_hop && src.since != 0 && in_now < src.since + min_hop)
+                continue;
+
+            if (best == nullptr || 
+                    (!src.channels.empty() && 
+                     (best->channels.empty() || src.channels.size() < best->channels.size())))
+                best = &src;
+        }
+
+        if (best == nullptr)
+            continue;
+
+        best->channel = w->first;
+        best->since = in_now;
+        w->second.last_served = in_now;
+
+        served.insert(w->first);
+        num_locked++;
+    }
+
+    bool contended = false;
+    for (auto w : waiting) {
+        if (served.find(w->first) == served.end()) {
+            contended = true;
+            break;
+        }
+    }
+
+    std::vector<change> ret;
+
+    for (auto& si : sources) {
+        auto& src = si.second;
+
+        if (src.channel.empty()) {
+            // Recheck once a rotating source has hopped long enough
+            if (rotate_hop && !channels.empty() && src.since != 0) {
+                auto t = src.since + min_hop;
+                if (next_plan == 0 || t < next_plan)
+                    next_plan = t;
+            }
+        } else {
+            auto c = channels.find(src.channel);
+
+            src.until = src.since + (contended ? contended_dwell(c->second) : max_dwell);
+
+            // An expired assignment with nothing waiting is kept until a target turns up
+            if (contended || rotate_hop) {
+                auto t = std::max(src.until, in_now + 1);
+                if (next_plan == 0 || t < next_plan)
+                    next_plan = t;
+            }
+        }
+
+        if (previous[si.first] != src.channel)
+            ret.push_back(change{si.first, src.channel});
+    }
+
+    return ret;
+}
 
 dot11_ssid_scan::dot11_ssid_scan() {
     mutex.set_name("dot11_ssid_scan");
@@ -43,6 +367,15 @@ dot11_ssid_scan::dot11_ssid_scan() {
     databaselog =
         Globalreg::fetch_mandatory_global_as<kis_database_logfile>();
 
+    packetchain =
+        Globalreg::fetch_mandatory_global_as<packet_chain>();
+    pack_comp_80211 = packetchain->register_packet_component("PHY80211");
+    pack_comp_datasrc = packetchain->register_packet_component("KISDATASRC");
+    packet_handler_id = -1;
+
+    plan_timer = -1;
+    handshake_eventbus_id = 0;
+
     // We aren't a tracked component so we register our sub elements directly
     ssidscan_enabled =
         entrytracker->register_and_get_field_as<tracker_element_uint8>("dot11.ssidscan.enabled",
@@ -60,7 +393,7 @@ dot11_ssid_scan::dot11_ssid_scan() {
                 "Usable datasource pool (UUIDs)");
 
     ssidscan_datasources =
-        entrytracker->register_and_get_field_as<tracker_element_vector>("dot11.ssidscan.datasources",
+        entrytracker->register_and_get_field_as<tracker_element_vector>("dot11.ssidscan.active_datasources",
                 tracker_element_factory<tracker_element_vector>(),
                 "Active datasource pool");
 
@@ -94,13 +427,18 @@ dot11_ssid_scan::dot11_ssid_scan() {
     ssidscan_enabled->set(config->fetch_opt_bool("dot11_ssidscan_enabled", false));
 
     for (auto s : config->fetch_opt_vec("dot11_ssidscan_ssid")) {
-        target_ssids->push_back(s);
+        try {
+            target_ssid_res.push_back(std::regex(s));
+            target_ssids->push_back(s);
+        } catch (const std::regex_error& e) {
+            _MSG_ERROR("Invalid dot11_ssidscan_ssid '{}': {}", s, e.what());
+        }
     }
 
     for (auto hu : config->fetch_opt_vec("dot11_ssidscan_datasource")) {
         auto hu_uuid = 
-            std::make_shared<tracker_element_uuid>(uuid(hu));
-        ssidscan_datasources->push_back(hu_uuid);
+            std::make_shared<tracker_element_uuid>(0, uuid(hu));
+        ssidscan_datasources_uuids->push_back(hu_uuid);
     }
 
     ignore_after_handshake->set(config->fetch_opt_bool("dot11_ssidscan_ignore_after_handshake", true));
@@ -111,6 +449,11 @@ dot11_ssid_scan::dot11_ssid_scan() {
     min_scan_seconds->set(config->fetch_opt_uint("dot11_ssidscan_minimum_hop", 30));
     max_contend_cap_seconds->set(config->fetch_opt_uint("dot11_ssidscan_maximum_lock", 30));
 
+    planner.set_limits(min_scan_seconds->get(), max_contend_cap_seconds->get());
+    planner.set_dwell_beacons(config->fetch_opt_uint("dot11_ssidscan_dwell_beacons", 50));
+    planner.set_hopping_sources(config->fetch_opt_uint("dot11_ssidscan_hopping_sources", 1));
+    planner.set_target_timeout(config->fetch_opt_uint("dot11_ssidscan_target_timeout", 300));
+
     auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
 
     auto status_map = std::make_shared<tracker_element_map>();
@@ -124,7 +467,7 @@ dot11_ssid_scan::dot11_ssid_scan() {
     status_map->insert(max_contend_cap_seconds);
 
     httpd->register_route("/phy/phy80211/ssidscan/status", {"GET", "POST"}, httpd->RO_ROLE, {},
-            std::make_shared<kis_net_web_tracked_endpoint>(status_map, &mutex));
+            std::make_shared<kis_net_web_tracked_endpoint>(status_map, mutex));
 
     httpd->register_route("/phy/phy80211/ssidscan/config", {"POST"}, httpd->LOGON_ROLE, {"cmd"},
             std::make_shared<kis_net_web_function_endpoint>(
@@ -148,22 +491,238 @@ dot11_ssid_scan::dot11_ssid_scan() {
     devicetracker->add_view(completed_device_view);
 
     eventbus_id =
-        eventbus->register_listener("NEW_DATASOURCE",
+        eventbus->register_listener(datasource_tracker::event_new_datasource(),
                 [this](std::shared_ptr<eventbus_event> evt) { handle_eventbus_evt(evt); });
 
+    if (ssidscan_enabled->get()) {
+        ssidscan_enabled->set(false);
+        enable_ssidscan();
+    }
 }
 
 dot11_ssid_scan::~dot11_ssid_scan() {
     eventbus->remove_listener(eventbus_id);
+    eventbus->remove_listener(handshake_eventbus_id);
     timetracker->remove_timer(hopping_mode_end_timer);
     timetracker->remove_timer(capture_mode_end_timer);
+    timetracker->remove_timer(plan_timer);
 
+    if (packet_handler_id >= 0)
+        packetchain->remove_handler(packet_handler_id, CHAINPOS_TRACKER);
 }
 
 void dot11_ssid_scan::handle_eventbus_evt(std::shared_ptr<eventbus_event> evt) {
-    auto source_evt = 
-        std::static_pointer_cast<datasource_tracker::event_new_datasource>(evt);
+    auto ds_k = evt->get_event_content()->find(datasource_tracker::event_new_datasource());
+
+    if (ds_k == evt->get_event_content()->end())
+        return;
+
+    auto datasource = std::static_pointer_cast<kis_datasource>(ds_k->second);
+
+    kis_lock_guard<kis_mutex> lk(mutex, "dot11_ssid_scan new datasource");
 
+    if (!ssidscan_enabled->get())
+        return;
+
+    for (const auto& u : *ssidscan_datasources_uuids) {
+        if (get_tracker_value<uuid>(u) == datasource->get_source_uuid()) {
+            add_scan_source(datasource);
+            break;
+        }
+    }
+}
+
+void dot11_ssid_scan::add_scan_source(std::shared_ptr<kis_datasource> in_source) {
+    auto ds_uuid = in_source->get_source_uuid();
+
+    if (previous_datasource_hop_map.find(ds_uuid) != previous_datasource_hop_map.end())
+        return;
+
+    datasource_state state;
+    state.hopping = in_source->get_source_hopping();
+    state.hop_rate = in_source->get_source_hop_rate();
+    state.hop_shuffle = in_source->get_source_hop_shuffle();
+    state.hop_offset = in_source->get_source_hop_offset();
+    state.source_hop_vec = in_source->get_source_hop_vec();
+    state.source_channel = in_source->get_source_channel();
+    previous_datasource_hop_map[ds_uuid] = state;
+
+    std::vector<std::string> channels;
+    for (const auto& c : *(in_source->get_source_channels_vec()))
+        channels.push_back(get_tracker_value<std::string>(c));
+
+    planner.add_source(ds_uuid, channels);
+
+    ssidscan_datasources->push_back(std::make_shared<tracker_element_uuid>(0, ds_uuid));
+}
+
+void dot11_ssid_scan::restore_scan_source(const uuid& in_uuid) {
+    auto s = previous_datasource_hop_map.find(in_uuid);
+
+    if (s == previous_datasource_hop_map.end())
+        return;
+
+    auto datasourcetracker = Globalreg::fetch_mandatory_global_as<datasource_tracker>();
+    auto ds = datasourcetracker->find_datasource(in_uuid);
+
+    if (ds != nullptr) {
+        if (s->second.hopping)
+            ds->set_channel_hop(s->second.hop_rate, s->second.source_hop_vec, 
+                    s->second.hop_shuffle, s->second.hop_offset, 0, nullptr);
+        else
+            ds->set_channel(s->second.source_channel, 0, nullptr);
+    }
+
+    previous_datasource_hop_map.erase(s);
+}
+
+void dot11_ssid_scan::apply_changes(const std::vector<dot11_ssidscan_planner::change>& in_changes) {
+    auto datasourcetracker = Globalreg::fetch_mandatory_global_as<datasource_tracker>();
+
+    for (const auto& c : in_changes) {
+        auto ds = datasourcetracker->find_datasource(c.source);
+
+        if (ds == nullptr)
+            continue;
+
+        if (c.channel.length()) {
+            ds->set_channel(c.channel, 0, nullptr);
+            continue;
+        }
+
+        // Back to the hopping pattern the source had before we took it over
+        std::shared_ptr<tracker_element_vector> hop_vec;
+        double hop_rate;
+        bool hop_shuffle;
+        unsigned int hop_offset;
+
+        {
+            kis_lock_guard<kis_mutex> lk(mutex, "dot11_ssid_scan apply_changes");
+
+            auto s = previous_datasource_hop_map.find(c.source);
+
+            if (s == previous_datasource_hop_map.end())
+                continue;
+
+            hop_vec = s->second.source_hop_vec;
+            hop_rate = s->second.hop_rate;
+            hop_shuffle = s->second.hop_shuffle;
+            hop_offset = s->second.hop_offset;
+        }
+
+        if (hop_vec == nullptr || hop_vec->size() == 0)
+            hop_vec = ds->get_source_channels_vec();
+
+        if (hop_rate <= 0)
+            hop_rate = 5;
+
+        ds->set_channel_hop(hop_rate, hop_vec, hop_shuffle, hop_offset, 0, nullptr);
+    }
+}
+
+void dot11_ssid_scan::plan_event() {
+    std::vector<dot11_ssidscan_planner::change> changes;
+
+    {
+        kis_lock_guard<kis_mutex> lk(mutex, "dot11_ssid_scan plan_event");
+
+        time_t now = Globalreg::globalreg->last_tv_sec;
+
+        if (!ssidscan_enabled->get() || !planner.plan_due(now))
+            return;
+
+        changes = planner.plan(now);
+    }
+
+    apply_changes(changes);
+}
+
+int dot11_ssid_scan::packet_handler(std::shared_ptr<kis_packet> in_pack) {
+    auto dot11info = in_pack->fetch<dot11_packinfo>(pack_comp_80211);
+
+    if (dot11info == nullptr || dot11info->type != packet_management ||
+            (dot11info->subtype != packet_sub_beacon && dot11info->subtype != packet_sub_probe_resp))
+        return 1;
+
+    kis_lock_guard<kis_mutex> lk(mutex, "dot11_ssid_scan packet_handler");
+
+    if (!ssidscan_enabled->get())
+        return 1;
+
+    // Only match the SSID when a BSSID is new or changes what it advertises
+    auto m = ssid_match_map.find(dot11info->bssid_mac);
+
+    if (m == ssid_match_map.end() || m->second.ssid_csum != dot11info->ssid_csum) {
+        bool match = false;
+
+        for (const auto& re : target_ssid_res) {
+            if (std::regex_search(dot11info->ssid, re)) {
+                match = true;
+                break;
+            }
+        }
+
+        ssid_match_map[dot11info->bssid_mac] = ssid_match{dot11info->ssid_csum, match};
+
+        if (!match)
+            return 1;
+
+        if (dot11info->bssid_dev != nullptr)
+            target_devices_view->add_device_direct(dot11info->bssid_dev);
+    } else if (!m->second.match) {
+        return 1;
+    }
+
+    planner.sighting(dot11info->bssid_mac, dot11info->channel, dot11info->beacon_interval, 
+            in_pack->ts.tv_sec);
+
+    return 1;
+}
+
+void dot11_ssid_scan::handle_handshake_evt(std::shared_ptr<eventbus_event> evt) {
+    auto devicetracker = Globalreg::fetch_mandatory_global_as<device_tracker>();
+    auto d11phy =
+        static_cast<kis_80211_phy *>(devicetracker->fetch_phy_handler_by_name("IEEE802.11"));
+
+    auto base_k = evt->get_event_content()->find(d11phy->dot11_wpa_handshake_event_base);
+    auto dot11_k = evt->get_event_content()->find(d11phy->dot11_wpa_handshake_event_dot11);
+
+    if (base_k == evt->get_event_content()->end() || dot11_k == evt->get_event_content()->end())
+        return;
+
+    auto base_dev = std::static_pointer_cast<kis_tracked_device_base>(base_k->second);
+    auto dot11_dev = std::static_pointer_cast<dot11_tracked_device>(dot11_k->second);
+
+    // The event fires for every stored handshake message; a target is done once
+    // some client has all four
+    bool handshake = false;
+
+    {
+        kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), 
+                "dot11_ssid_scan handle_handshake_evt");
+
+        if (dot11_dev->has_wpa_key_map()) {
+            for (const auto& k : *(dot11_dev->get_wpa_key_map())) {
+                if (std::static_pointer_cast<tracker_element_vector>(k.second)->size() == 4) {
+                    handshake = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!handshake)
+        return;
+
+    kis_lock_guard<kis_mutex> lk(mutex, "dot11_ssid_scan handle_handshake_evt");
+
+    if (!ssidscan_enabled->get() || !planner.is_target(base_dev->get_macaddr()))
+        return;
+
+    completed_device_view->add_device_direct(base_dev);
+
+    if (ignore_after_handshake->get())
+        planner.complete(base_dev->get_macaddr());
 }
 
 void dot11_ssid_scan::config_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
@@ -187,10 +746,15 @@ void dot11_ssid_scan::config_endp_handler(std::shared_ptr<kis_net_beast_httpd_co
         ignore_after_handshake->set(con->json()["ignore_after_handshake"].asBool());
 
     if (!con->json()["max_capture_seconds"].isNull()) 
-        max_contend_cap_seconds->set(con->json()["max_capture_seconds"].asBool());
+        max_contend_cap_seconds->set(con->json()["max_capture_seconds"].asUInt());
 
     if (!con->json()["min_scan_seconds"].isNull()) 
-        min_scan_seconds->set(con->json()["min_scan_seconds"].asBool());
+        min_scan_seconds->set(con->json()["min_scan_seconds"].asUInt());
+
+    {
+        kis_lock_guard<kis_mutex> lk(mutex, "dot11_ssid_scan config_endp_handler");
+        planner.set_limits(min_scan_seconds->get(), max_contend_cap_seconds->get());
+    }
 
     if (con->json()["restrict_log_filters"].isNull()) {
         auto enabled = con->json()["restrict_log_filters"].asBool();
@@ -206,17 +770,70 @@ void dot11_ssid_scan::config_endp_handler(std::shared_ptr<kis_net_beast_httpd_co
 bool dot11_ssid_scan::enable_ssidscan() {
     kis_lock_guard<kis_mutex> lk(mutex, "dot11_ssid_scan enable_ssidscan");
 
+    if (ssidscan_enabled->get())
+        return true;
+
     ssidscan_enabled->set(true);
 
+    auto datasourcetracker = Globalreg::fetch_mandatory_global_as<datasource_tracker>();
 
-    return false;
+    // Sources which aren't open yet are added when they appear
+    for (const auto& u : *ssidscan_datasources_uuids) {
+        auto ds = datasourcetracker->find_datasource(get_tracker_value<uuid>(u));
+
+        if (ds != nullptr)
+            add_scan_source(ds);
+    }
+
+    packet_handler_id =
+        packetchain->register_handler([this](std::shared_ptr<kis_packet> in_pack) -> int {
+                return packet_handler(in_pack);
+            }, CHAINPOS_TRACKER, 100, "dot11_ssid_scan");
+
+    auto devicetracker = Globalreg::fetch_mandatory_global_as<device_tracker>();
+    auto d11phy =
+        static_cast<kis_80211_phy *>(devicetracker->fetch_phy_handler_by_name("IEEE802.11"));
+    handshake_eventbus_id =
+        eventbus->register_listener(d11phy->dot11_wpa_handshake_event,
+                [this](std::shared_ptr<eventbus_event> evt) { handle_handshake_evt(evt); });
+
+    // The planner only does work when a sighting or completion changes a channel,
+    // or an assignment ends
+    plan_timer =
+        timetracker->register_timer(SERVER_TIMESLICES_SEC, nullptr, 1,
+                [this](int) -> int {
+                    plan_event();
+                    return 1;
+                });
+
+    return true;
 }
 
 bool dot11_ssid_scan::disable_ssidscan() {
     kis_lock_guard<kis_mutex> lk(mutex, "dot11_ssid_scan disable_ssidscan");
 
-    ssidscan_enabled->set(true);
+    if (!ssidscan_enabled->get())
+        return true;
 
-    return false;
+    ssidscan_enabled->set(false);
+
+    timetracker->remove_timer(plan_timer);
+    plan_timer = -1;
+
+    eventbus->remove_listener(handshake_eventbus_id);
+    handshake_eventbus_id = 0;
+
+    if (packet_handler_id >= 0)
+        packetchain->remove_handler(packet_handler_id, CHAINPOS_TRACKER);
+    packet_handler_id = -1;
+
+    while (previous_datasource_hop_map.size())
+        restore_scan_source(previous_datasource_hop_map.begin()->first);
+
+    planner.clear();
+    ssid_match_map.clear();
+    ssidscan_datasources->clear();
+
+    return true;
 }
 
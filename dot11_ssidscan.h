@@ -21,10 +21,16 @@
 
 #include "config.h"
 
+#include <map>
+#include <regex>
+#include <set>
+#include <unordered_map>
+
 #include "devicetracker_view.h"
 #include "eventbus.h"
 #include "globalregistry.h"
 #include "kis_databaselogfile.h"
+#include "packetchain.h"
 #include "timetracker.h"
 #include "trackedelement.h"
 #include "trackedcomponent.h"
@@ -71,6 +77,16 @@
  * capture a handshake
  * uint: dot11_ssidscan_maximum_lock=123
  *
+ * Beacons to hear from the slowest target on a channel before a contended
+ * source moves on to another channel
+ * uint: dot11_ssidscan_dwell_beacons=50
+ *
+ * Sources kept hopping to find new targets, when there are more sources
+ * uint: dot11_ssidscan_hopping_sources=1
+ *
+ * Seconds after the last sighting a target is forgotten
+ * uint: dot11_ssidscan_target_timeout=300
+ *
  *
  * Endpoints
  * GET  AUTH /phy/phy80211/ssidscan/status.json
@@ -80,6 +96,114 @@
  *
  */
 
+class kis_datasource;
+
+// Assignment of ssidscan sources to target channels
+//
+// Targets are BSSIDs advertising a wanted SSID, grouped by channel so one source locked
+// to a channel covers every target on it.  Sources are assigned to the channels with
+// targets, least recently served first, and a source is only given a channel it can
+// tune; the rest keep hopping.  When there are more channels with targets than sources,
+// each assignment lasts long enough to hear dwell_beacons beacons from the slowest
+// target on the channel, bounded by the dwell limits, and then the channels rotate;
+// otherwise a source stays on its channel until the maximum dwell and is then kept there
+// if nothing is waiting.
+//
+// Planning is incremental; sightings and completions only mark the plan dirty when they
+// change a channel group, and a plan keeps every assignment which is still useful, so
+// only the sources whose channel changes are retuned.
+class dot11_ssidscan_planner {
+public:
+    dot11_ssidscan_planner();
+
+    // Minimum time spent hopping between locks when no source is left hopping, and
+    // the maximum time a source is locked to a channel
+    void set_limits(time_t in_min_hop, time_t in_max_dwell);
+    void set_dwell_beacons(unsigned int in_beacons);
+    void set_hopping_sources(unsigned int in_hopping);
+    void set_target_timeout(time_t in_timeout);
+
+    // Channels the source can tune; an empty list allows any channel
+    void add_source(const uuid& in_uuid, const std::vector<std::string>& in_channels);
+    void remove_source(const uuid& in_uuid);
+
+    // A target was seen; returns true if the plan needs to change
+    bool sighting(const mac_addr& in_bssid, const std::string& in_channel,
+            unsigned int in_beacon_tu, time_t in_now);
+
+    // A target is finished with; returns true if the plan needs to change
+    bool complete(const mac_addr& in_bssid);
+
+    bool is_target(const mac_addr& in_bssid) const {
+        return targets.find(in_bssid) != targets.end();
+    }
+
+    // Should plan() be called?
+    bool plan_due(time_t in_now) const {
+        return dirty || (next_plan != 0 && in_now >= next_plan) ||
+            (next_expire != 0 && in_now >= next_expire);
+    }
+
+    // A source to retune; an empty channel returns the source to hopping
+    struct change {
+        uuid source;
+        std::string channel;
+    };
+
+    std::vector<change> plan(time_t in_now);
+
+    void clear();
+
+protected:
+    struct target_t {
+        std::string channel;
+        unsigned int beacon_tu;
+        time_t last_seen;
+        bool complete;
+    };
+
+    struct channel_t {
+        channel_t() :
+            num_active{0},
+            last_served{0} { }
+
+        unsigned int num_active;
+        time_t last_served;
+        // Beacon intervals of the active targets, for the slowest
+        std::multiset<unsigned int> beacon_tu;
+    };
+
+    struct source_t {
+        std::set<std::string> channels;
+        // Assigned channel, or empty when hopping
+        std::string channel;
+        // When the source was last retuned, and when its assignment ends
+        time_t since;
+        time_t until;
+    };
+
+    bool can_tune(const source_t& in_source, const std::string& in_channel) const;
+    time_t contended_dwell(const channel_t& in_channel) const;
+
+    void add_active(const std::string& in_channel, unsigned int in_beacon_tu);
+    void remove_active(const std::string& in_channel, unsigned int in_beacon_tu);
+
+    std::unordered_map<mac_addr, target_t> targets;
+    std::map<std::string, channel_t> channels;
+    std::map<uuid, source_t> sources;
+
+    void expire(time_t in_now);
+
+    time_t min_hop, max_dwell;
+    unsigned int dwell_beacons;
+    unsigned int hopping_sources;
+    time_t target_timeout;
+
+    bool dirty;
+    time_t next_plan;
+    time_t next_expire;
+};
+
 class dot11_ssid_scan : public lifetime_global {
 public:
     static std::string global_name() { return "DOT11_SSIDSCAN"; }
@@ -165,6 +289,9 @@ protected:
     // Original state for interfaces
     struct datasource_state {
         bool hopping;
+        double hop_rate;
+        bool hop_shuffle;
+        unsigned int hop_offset;
         std::shared_ptr<tracker_element_vector> source_hop_vec;
         std::string source_channel;
     };
@@ -173,6 +300,37 @@ protected:
     bool enable_ssidscan();
     bool disable_ssidscan();
 
+    // Add a pool source to the planner, saving its original state
+    void add_scan_source(std::shared_ptr<kis_datasource> in_source);
+    void restore_scan_source(const uuid& in_uuid);
+
+    // Retune sources; called without the mutex held
+    void apply_changes(const std::vector<dot11_ssidscan_planner::change>& in_changes);
+
+    void plan_event();
+
+    int packet_handler(std::shared_ptr<kis_packet> in_pack);
+    void handle_handshake_evt(std::shared_ptr<eventbus_event> evt);
+
+    dot11_ssidscan_planner planner;
+
+    std::vector<std::regex> target_ssid_res;
+
+    // Matching is cached per BSSID, and only redone when the advertised SSID changes
+    struct ssid_match {
+        uint32_t ssid_csum;
+        bool match;
+    };
+    std::unordered_map<mac_addr, ssid_match> ssid_match_map;
+
+    std::shared_ptr<packet_chain> packetchain;
+    int pack_comp_80211, pack_comp_datasrc;
+    int packet_handler_id;
+
+    int plan_timer;
+
+    unsigned long handshake_eventbus_id;
+
 
 };
 
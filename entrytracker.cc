@@ -21,6 +21,7 @@
 
 #include "util.h"
 
+#include "configfile.h"
 #include "entrytracker.h"
 #include "messagebus.h"
 #include "kis_net_beast_httpd.h"
@@ -31,6 +32,16 @@ entry_tracker::entry_tracker() {
 
     next_field_num = 1;
 
+    for (auto& c : field_id_chunks)
+        c = nullptr;
+
+    for (auto& h : hashed_fields)
+        h = nullptr;
+    n_hashed_fields = 0;
+
+    field_names_snapshot = nullptr;
+    field_names_snapshot_sz = 0;
+
     Globalreg::enable_pool_type<tracker_element_alias>([](auto *a) { a->reset(); });
     Globalreg::enable_pool_type<tracker_element_string>([](auto *s) { s->reset(); });
     Globalreg::enable_pool_type<tracker_element_byte_array>([](auto *b) { b->reset(); });
@@ -64,11 +75,35 @@ entry_tracker::~entry_tracker() {
     kis_lock_guard<kis_mutex> lk(entry_mutex, "~entrytracker");
 
     Globalreg::globalreg->remove_global("ENTRYTRACKER");
+
+    for (auto& c : field_id_chunks)
+        delete[] c.load();
+
+    for (auto& h : hashed_fields)
+        delete h.load();
+
+    delete field_names_snapshot.load();
 }
 
 void entry_tracker::trigger_deferred_startup() {
+    {
+        // Most fields are registered by now
+        kis_lock_guard<kis_mutex> lk(entry_mutex, "entry_tracker trigger_deferred_startup");
+        publish_name_snapshot();
+    }
+
+    fragment_cache.set_limits(
+            Globalreg::globalreg->kismet_config->fetch_opt_as<size_t>("tracker_fragment_cache_mb", 32) * 1024 * 1024,
+            Globalreg::globalreg->kismet_config->fetch_opt_as<time_t>("tracker_fragment_cache_age", 15));
+
     auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
 
+    httpd->register_route("/system/fragment_cache", {"GET"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return fragment_cache.get_stats();
+                }));
+
     httpd->register_route("/system/tracked_fields", {"GET"}, httpd->RO_ROLE, {"html"},
             std::make_shared<kis_net_web_function_endpoint>(
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
@@ -113,6 +148,67 @@ void entry_tracker::tracked_fields_endp_handler(std::shared_ptr<kis_net_beast_ht
 }
 
 
+void entry_tracker::publish_field(std::shared_ptr<reserved_field> in_def) {
+    field_name_map[in_def->field_name] = in_def;
+    field_id_map[in_def->field_id] = in_def;
+
+    auto& chunk_ref = field_id_chunks[in_def->field_id / field_chunk_sz];
+    auto chunk = chunk_ref.load(std::memory_order_relaxed);
+
+    if (chunk == nullptr) {
+        chunk = new std::atomic<const reserved_field *>[field_chunk_sz];
+
+        for (size_t i = 0; i < field_chunk_sz; i++)
+            chunk[i].store(nullptr, std::memory_order_relaxed);
+
+        chunk_ref.store(chunk, std::memory_order_release);
+    }
+
+    chunk[in_def->field_id % field_chunk_sz].store(in_def.get(), std::memory_order_release);
+
+    if (field_name_map.size() >= field_names_snapshot_sz * 2 + 64)
+        publish_name_snapshot();
+}
+
+void entry_tracker::publish_name_snapshot() {
+    if (field_name_map.size() == field_names_snapshot_sz)
+        return;
+
+    auto snap = new field_name_snapshot();
+    snap->reserve(field_name_map.size());
+
+    for (const auto& f : field_name_map)
+        snap->emplace(f.first, f.second.get());
+
+    auto prev = field_names_snapshot.exchange(snap, std::memory_order_acq_rel);
+
+    if (prev != nullptr)
+        retired_name_snapshots.emplace_back(prev);
+
+    field_names_snapshot_sz = field_name_map.size();
+}
+
+const entry_tracker::reserved_field *entry_tracker::find_field(const std::string& in_name) {
+    auto snap = field_names_snapshot.load(std::memory_order_acquire);
+
+    if (snap != nullptr) {
+        auto i = snap->find(in_name);
+
+        if (i != snap->end())
+            return i->second;
+    }
+
+    // Registered since the last snapshot, or not registered at all
+    kis_lock_guard<kis_mutex> lk(entry_mutex, "entry_tracker find_field");
+
+    auto i = field_name_map.find(in_name);
+
+    if (i == field_name_map.end())
+        return nullptr;
+
+    return i->second.get();
+}
+
 int entry_tracker::register_field(const std::string& in_name,
         std::shared_ptr<tracker_element> in_builder,
         const std::string& in_desc) {
@@ -140,8 +236,7 @@ int entry_tracker::register_field(const std::string& in_name,
     definition->builder = in_builder;
     definition->builder->set_id(definition->field_id);
 
-    field_name_map[in_name] = definition;
-    field_id_map[definition->field_id] = definition;
+    publish_field(definition);
 
     return definition->field_id;
 }
@@ -173,71 +268,107 @@ std::shared_ptr<tracker_element> entry_tracker::register_and_get_field(const std
     definition->builder = in_builder;
     definition->builder->set_id(definition->field_id);
 
-    field_name_map[in_name] = definition;
-    field_id_map[definition->field_id] = definition;
+    publish_field(definition);
 
     return definition->builder->clone_type();
 }
 
 
-uint16_t entry_tracker::get_field_id(const std::string& in_name) {
-    kis_lock_guard<kis_mutex> lk(entry_mutex, "entry_tracker get_field_id");
+void entry_tracker::publish_hashed_field(const static_field_name& in_name, 
+        const std::type_info& in_type, int in_id) {
+    kis_lock_guard<kis_mutex> lk(entry_mutex, "entry_tracker publish_hashed_field");
+
+    if (n_hashed_fields >= (hashed_field_slots / 4) * 3)
+        return;
 
-    // std::string mod_name = str_lower(in_name);
+    for (size_t i = 0; i < hashed_field_slots; i++) {
+        auto& slot = hashed_fields[(in_name.hash + i) % hashed_field_slots];
+        auto f = slot.load(std::memory_order_relaxed);
+
+        if (f == nullptr) {
+            auto nf = new hashed_field();
+            nf->hash = in_name.hash;
+            nf->name = std::string(in_name.name, in_name.len);
+            nf->type = &in_type;
+            nf->field_id = in_id;
+
+            slot.store(nf, std::memory_order_release);
+            n_hashed_fields++;
+            return;
+        }
+
+        // Already published, possibly by another thread building the same component, or
+        // under a different builder type which keeps using register_field
+        if (f->hash == in_name.hash && f->name.length() == in_name.len &&
+                f->name.compare(0, in_name.len, in_name.name, in_name.len) == 0)
+            return;
+    }
+}
 
-    auto iter = field_name_map.find(in_name);
-    if (iter == field_name_map.end()) 
+uint16_t entry_tracker::get_field_id(const std::string& in_name) {
+    auto f = find_field(in_name);
+
+    if (f == nullptr)
         return -1;
 
-    return iter->second->field_id;
+    return f->field_id;
 }
 
 std::string entry_tracker::get_field_name(uint16_t in_id) {
-    kis_lock_guard<kis_mutex> lk(entry_mutex, "entry_tracker get_field_name");
+    auto f = find_field(in_id);
 
-    auto iter = field_id_map.find(in_id);
-    if (iter == field_id_map.end()) 
+    if (f == nullptr)
         return "field.unknown.not.registered";
 
-    return iter->second->field_name;
+    return f->field_name;
 }
 
-std::string entry_tracker::get_field_description(uint16_t in_id) {
-    kis_lock_guard<kis_mutex> lk(entry_mutex, "entry_tracker get_field_description");
+std::vector<std::pair<uint16_t, std::string>> entry_tracker::get_field_names() {
+    kis_lock_guard<kis_mutex> lk(entry_mutex, "entry_tracker get_field_names");
 
-    auto iter = field_id_map.find(in_id);
+    auto ret = std::vector<std::pair<uint16_t, std::string>>{};
+    ret.reserve(field_id_map.size());
+
+    for (const auto& f : field_id_map)
+        ret.push_back(std::make_pair(f.first, f.second->field_name));
+
+    return ret;
+}
 
-    if (iter == field_id_map.end()) {
+std::string entry_tracker::get_field_description(uint16_t in_id) {
+    auto f = find_field(in_id);
+
+    if (f == nullptr)
         return "untracked field, description not available";
-    }
 
-    return iter->second->field_description;
+    return f->field_description;
 }
 
 std::shared_ptr<tracker_element> entry_tracker::get_shared_instance(uint16_t in_id) {
-    kis_unique_lock<kis_mutex> lock(entry_mutex, std::defer_lock, "entry_tracker get_shared_instance id");
+    auto f = find_field(in_id);
+
+    if (f == nullptr)
+        return nullptr;
 
-    lock.lock();
-    auto iter = field_id_map.find(in_id);
-    lock.unlock();
+    return f->builder->clone_type();
+}
+
+std::shared_ptr<tracker_element> entry_tracker::get_field_builder(uint16_t in_id) {
+    auto f = find_field(in_id);
 
-    if (iter == field_id_map.end()) 
+    if (f == nullptr)
         return nullptr;
 
-    return iter->second->builder->clone_type();
+    return f->builder;
 }
 
 std::shared_ptr<tracker_element> entry_tracker::get_shared_instance(const std::string& in_name) {
-    kis_unique_lock<kis_mutex> lock(entry_mutex, std::defer_lock, "entry_tracker get_shared_instance name");
-
-    lock.lock();
-    auto iter = field_name_map.find(in_name);
-    lock.unlock();
+    auto f = find_field(in_name);
 
-    if (iter == field_name_map.end()) 
+    if (f == nullptr)
         return nullptr;
 
-    return iter->second->builder->clone_type();
+    return f->builder->clone_type();
 }
 
 void entry_tracker::register_serializer(const std::string& in_name, 
@@ -274,6 +405,18 @@ bool entry_tracker::can_serialize(const std::string& in_name) {
     return false;
 }
 
+std::shared_ptr<tracker_element_serializer> entry_tracker::get_serializer(const std::string& in_name) {
+    auto dpos = in_name.find_last_of(".");
+
+    auto i = serializer_map.find(dpos == std::string::npos ? 
+            in_name : in_name.substr(dpos + 1, in_name.length()));
+
+    if (i == serializer_map.end())
+        return nullptr;
+
+    return i->second;
+}
+
 int entry_tracker::serialize(const std::string& in_name, std::ostream &stream,
         shared_tracker_element e,
         std::shared_ptr<tracker_element_serializer::rename_map> name_map) {
@@ -314,6 +457,63 @@ int entry_tracker::serialize_with_json_summary(const std::string& type, std::ost
     return serialize(type, stream, sumelem, name_map);
 }
 
+std::shared_ptr<const std::string> entry_tracker::fetch_fragment(
+        const std::shared_ptr<tracker_element_serializer>& in_serializer,
+        shared_tracker_element elem, const shared_summary_plan& in_plan) {
+
+    if (!fragment_cache.enabled() || in_serializer == nullptr || elem == nullptr)
+        return nullptr;
+
+    // Only plans compiled from a field spec can be told apart, and incomplete plans may
+    // resolve differently once more fields are registered
+    std::string fields;
+
+    if (in_plan != nullptr && in_plan->summaries.size() != 0) {
+        if (!in_plan->complete || in_plan->spec.length() == 0)
+            return nullptr;
+
+        fields = in_plan->spec;
+    }
+
+    device_key key;
+    uint64_t seq;
+
+    if (!elem->get_serial_cache_key(key, seq))
+        return nullptr;
+
+    return fragment_cache.fetch(key, seq, in_serializer.get(), fields,
+            [&](std::ostream& os) -> bool {
+                if (in_plan == nullptr) {
+                    in_serializer->stream_vector_item(elem, os, nullptr, true);
+                    return true;
+                }
+
+                auto rename_map = Globalreg::new_from_pool<tracker_element_serializer::rename_map>();
+                auto summary = summarize_tracker_element(elem, in_plan, rename_map);
+
+                in_serializer->stream_vector_item(summary, os, rename_map, true);
+                return true;
+            });
+}
+
+void entry_tracker::stream_vector_item(const std::shared_ptr<tracker_element_serializer>& in_serializer,
+        std::ostream& stream, shared_tracker_element elem,
+        const shared_summary_plan& in_plan, bool first) {
+
+    auto fragment = fetch_fragment(in_serializer, elem, in_plan);
+
+    if (fragment != nullptr) {
+        in_serializer->stream_vector_fragment(*fragment, stream, first);
+        return;
+    }
+
+    // Each record gets its own rename map so the map doesn't grow with the response
+    auto rename_map = Globalreg::new_from_pool<tracker_element_serializer::rename_map>();
+    auto summary = summarize_tracker_element(elem, in_plan, rename_map);
+
+    in_serializer->stream_vector_item(summary, stream, rename_map, first);
+}
+
 void entry_tracker::register_search_xform(uint16_t in_field_id, std::function<void (std::shared_ptr<tracker_element>,
             std::string& mapped_str)> in_xform) {
 
@@ -24,19 +24,38 @@
 #include <stdio.h>
 #include <stdint.h>
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <string>
+#include <typeinfo>
 #include <unordered_map>
+#include <vector>
 
 #include "globalregistry.h"
+#include "kis_fragment_cache.h"
 #include "kis_mutex.h"
+#include "multi_constexpr.h"
 #include "objectpool.h"
 #include "robin_hood.h"
 #include "trackedelement.h"
 
 class kis_net_beast_httpd_connection;
 
+// Field name given as a string literal, with the hash of the name computed from the
+// literal at compile time
+struct static_field_name {
+    template<size_t N>
+    constexpr14 static_field_name(const char (&in_name)[N]) :
+        name{in_name},
+        len{N - 1},
+        hash{constexpr_fnv1a_64(in_name, N - 1)} { }
+
+    const char *name;
+    size_t len;
+    uint64_t hash;
+};
+
 // Allocate and track named fields and give each one a custom int
 class entry_tracker : public lifetime_global, public deferred_startup {
 public:
@@ -88,10 +107,36 @@ public:
                     in_desc));
     }
 
+    // Resolve a field registered by hashed name before, with a builder of the same type;
+    // this takes no locks and builds nothing, so components registering their fields by 
+    // literal name only go through register_field the first time.  Returns -1 if the
+    // field needs to be registered.
+    int find_hashed_field(const static_field_name& in_name, const std::type_info& in_type) const {
+        for (size_t i = 0; i < hashed_field_slots; i++) {
+            auto f = hashed_fields[(in_name.hash + i) % hashed_field_slots].load(std::memory_order_acquire);
+
+            if (f == nullptr)
+                return -1;
+
+            if (f->hash == in_name.hash && f->name.length() == in_name.len &&
+                    f->name.compare(0, in_name.len, in_name.name, in_name.len) == 0)
+                return *(f->type) == in_type ? f->field_id : -1;
+        }
+
+        return -1;
+    }
+
+    // Add a field registered by register_field to the hashed name table
+    void publish_hashed_field(const static_field_name& in_name, const std::type_info& in_type,
+            int in_id);
+
     uint16_t get_field_id(const std::string& in_name);
     std::string get_field_name(uint16_t in_id);
     std::string get_field_description(uint16_t in_id);
 
+    // Snapshot of every registered field id and name
+    std::vector<std::pair<uint16_t, std::string>> get_field_names();
+
     // Generate a shared field instance, using the builder
     template<class T> std::shared_ptr<T> get_shared_instance_as(const std::string& in_name) {
         return std::static_pointer_cast<T>(get_shared_instance(in_name));
@@ -103,6 +148,9 @@ public:
     }
     std::shared_ptr<tracker_element> get_shared_instance(uint16_t in_id);
 
+    // Builder instance of a field, for callers constructing fields themselves
+    std::shared_ptr<tracker_element> get_field_builder(uint16_t in_id);
+
     // Serializer manipulation
     //
     // These ARE NOT THREAD SAFE.  
@@ -118,9 +166,26 @@ public:
 
     bool can_serialize(const std::string& type);
 
+    // Find the serializer for a type or a uri ending in a type; returns nullptr if there
+    // is no matching serializer
+    std::shared_ptr<tracker_element_serializer> get_serializer(const std::string& type);
+
     int serialize(const std::string& type, std::ostream& stream, shared_tracker_element elem,
             std::shared_ptr<tracker_element_serializer::rename_map> name_map = nullptr);
 
+    // Serialized text of a record, summarized by a plan (or whole, with no plan), the same
+    // as the first item of a vector streamed by the serializer.  Records which report a
+    // serialization cache key are kept in the fragment cache; returns nullptr if the
+    // record can't be cached or the fragment cache is disabled.
+    std::shared_ptr<const std::string> fetch_fragment(
+            const std::shared_ptr<tracker_element_serializer>& in_serializer,
+            shared_tracker_element elem, const shared_summary_plan& in_plan);
+
+    // Stream a record as an item of a vector, from the fragment cache when possible
+    void stream_vector_item(const std::shared_ptr<tracker_element_serializer>& in_serializer,
+            std::ostream& stream, shared_tracker_element elem,
+            const shared_summary_plan& in_plan, bool first);
+
     int serialize_with_json_summary(const std::string& type, std::ostream& stream, shared_tracker_element elem,
             const Json::Value& json_summary);
 
@@ -153,8 +218,57 @@ protected:
 
     robin_hood::unordered_node_map<std::string, std::shared_ptr<reserved_field> > field_name_map;
     robin_hood::unordered_node_map<uint16_t, std::shared_ptr<reserved_field> > field_id_map;
+
+    // Lock-free read side of the registry.  Fields are never removed and are immutable
+    // once registered, so lookups by id read an append-only table of chunks, and
+    // lookups by name read an immutable snapshot of the names map.  The snapshot is
+    // rebuilt under entry_mutex as the registry doubles, and at the end of startup;
+    // names registered since the last snapshot are found under the lock.  Replaced
+    // snapshots are retired, not freed, since readers may still hold them, and the
+    // doubling keeps the retired total within the size of the live snapshot.
+    using field_name_snapshot = robin_hood::unordered_flat_map<std::string, const reserved_field *>;
+
+    const static size_t field_chunk_sz = 256;
+    std::atomic<std::atomic<const reserved_field *> *> field_id_chunks[65536 / field_chunk_sz];
+
+    std::atomic<const field_name_snapshot *> field_names_snapshot;
+    std::vector<std::unique_ptr<const field_name_snapshot>> retired_name_snapshots;
+    size_t field_names_snapshot_sz;
+
+    // Add a new field to the maps and the id table; entry_mutex must be held
+    void publish_field(std::shared_ptr<reserved_field> in_def);
+
+    // Rebuild the name snapshot from field_name_map; entry_mutex must be held
+    void publish_name_snapshot();
+
+    // Fields registered by hashed name, in an open addressed table which is only ever
+    // appended to under entry_mutex; the table is kept at most three quarters full, and
+    // fields past that are only found through register_field
+    struct hashed_field {
+        uint64_t hash;
+        std::string name;
+        const std::type_info *type;
+        int field_id;
+    };
+
+    static const size_t hashed_field_slots = 8192;
+    std::atomic<const hashed_field *> hashed_fields[hashed_field_slots];
+    size_t n_hashed_fields;
+
+    const reserved_field *find_field(uint16_t in_id) const {
+        auto chunk = field_id_chunks[in_id / field_chunk_sz].load(std::memory_order_acquire);
+
+        if (chunk == nullptr)
+            return nullptr;
+
+        return chunk[in_id % field_chunk_sz].load(std::memory_order_acquire);
+    }
+
+    const reserved_field *find_field(const std::string& in_name);
     robin_hood::unordered_node_map<std::string, std::shared_ptr<tracker_element_serializer> > serializer_map;
 
+    kis_fragment_cache fragment_cache;
+
     // Field IDs to optional search xform function
     robin_hood::unordered_node_map<uint16_t, std::function<void (std::shared_ptr<tracker_element>, 
             std::string& mapped_str)>> search_xform_map;
@@ -16,8 +16,203 @@
     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include "config.h"
+
+#include <chrono>
+#include <list>
+#include <shared_mutex>
+
+#include "configfile.h"
 #include "eventbus.h"
 #include "kis_net_beast_httpd.h"
+#include "kis_thread_placement.h"
+#include "kis_trace.h"
+#include "timetracker.h"
+#include "util.h"
+
+// Maximum events held for a coalescing subscription; the oldest are dropped once a
+// window holds more
+#define EVENTBUS_WS_PENDING_MAX     1024
+
+// Server-side shaping of an eventbus websocket subscription.  The subscribe request
+// may set:
+//   coalesce_ms   hold events and send them every coalesce_ms milliseconds
+//   dedupe        path of a key in the event content ("CONTENT_NAME/field/field");
+//                 of events held in a window with the same key, only the latest
+//                 is sent
+//   max_rate      maximum number of events sent per second; held events wait for
+//                 their turn, and without coalescing events over the rate are dropped
+//   fields        the usual field summarization of the event content
+// Events are only serialized once they are sent, so events which are dropped or
+// replaced cost nothing more.
+class eventbus_ws_subscription {
+public:
+    eventbus_ws_subscription(std::shared_ptr<kis_net_web_websocket_endpoint> in_ws,
+            const Json::Value& in_json) :
+        listener_id{0},
+        timer_id{-1},
+        ws{in_ws},
+        json{in_json} {
+
+        mutex.set_name("eventbus_ws_subscription");
+
+        coalesce_ms = json.get("coalesce_ms", 0).asUInt();
+        max_rate = json.get("max_rate", 0).asDouble();
+
+        // Subscribers with the same summarization share one serialization of each event
+        Json::StreamWriterBuilder wb;
+        wb["indentation"] = "";
+        serialized_key = "json\n" + 
+            Json::writeString(wb, json.get("fields", Json::Value(Json::arrayValue)));
+
+        auto dedupe = json.get("dedupe", "").asString();
+        if (dedupe.length() != 0)
+            dedupe_path = str_tokenize(dedupe, "/");
+
+        tokens = max_rate;
+        token_tm = std::chrono::steady_clock::now();
+    }
+
+    unsigned int get_coalesce_ms() const {
+        return coalesce_ms;
+    }
+
+    void handle_event(std::shared_ptr<eventbus_event> evt) {
+        kis_unique_lock<kis_mutex> lk(mutex, "eventbus_ws_subscription handle_event");
+
+        if (coalesce_ms == 0) {
+            if (!take_token())
+                return;
+
+            lk.unlock();
+            send(evt);
+            return;
+        }
+
+        auto key = dedupe_key(evt);
+
+        if (key.length() != 0) {
+            auto k = pending_keys.find(key);
+
+            if (k != pending_keys.end()) {
+                *(k->second) = evt;
+                return;
+            }
+        }
+
+        if (pending.size() >= EVENTBUS_WS_PENDING_MAX) {
+            forget_key(pending.front());
+            pending.pop_front();
+        }
+
+        pending.push_back(evt);
+
+        if (key.length() != 0)
+            pending_keys[key] = std::prev(pending.end());
+    }
+
+    // Send the held events, as many as the rate allows
+    void flush() {
+        std::vector<std::shared_ptr<eventbus_event>> sendvec;
+
+        {
+            kis_lock_guard<kis_mutex> lk(mutex, "eventbus_ws_subscription flush");
+
+            while (pending.size() > 0 && take_token()) {
+                forget_key(pending.front());
+                sendvec.push_back(pending.front());
+                pending.pop_front();
+            }
+        }
+
+        for (const auto& e : sendvec)
+            send(e);
+    }
+
+    unsigned long listener_id;
+    int timer_id;
+
+protected:
+    bool take_token() {
+        if (max_rate <= 0)
+            return true;
+
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed = now - token_tm;
+        token_tm = now;
+
+        tokens = std::min(max_rate, tokens + elapsed.count() * max_rate);
+
+        if (tokens < 1)
+            return false;
+
+        tokens -= 1;
+        return true;
+    }
+
+    std::string dedupe_key(const std::shared_ptr<eventbus_event>& evt) {
+        if (dedupe_path.size() == 0)
+            return "";
+
+        auto c = evt->get_event_content()->find(dedupe_path[0]);
+
+        if (c == evt->get_event_content()->end())
+            return "";
+
+        auto e = c->second;
+
+        for (size_t p = 1; p < dedupe_path.size() && e != nullptr; p++) {
+            if (e->get_type() != tracker_type::tracker_map)
+                return "";
+
+            auto id = Globalreg::globalreg->entrytracker->get_field_id(dedupe_path[p]);
+
+            if (id < 0)
+                return "";
+
+            e = static_cast<tracker_element_map *>(e.get())->get_sub(id);
+        }
+
+        if (e == nullptr || !e->is_stringable())
+            return "";
+
+        return e->as_string();
+    }
+
+    void forget_key(const std::shared_ptr<eventbus_event>& evt) {
+        auto key = dedupe_key(evt);
+
+        if (key.length() != 0)
+            pending_keys.erase(key);
+    }
+
+    void send(const std::shared_ptr<eventbus_event>& evt) {
+        ws->write(evt->get_serialized(serialized_key,
+                    [this, &evt]() -> std::string {
+                        std::stringstream os;
+                        Globalreg::globalreg->entrytracker->serialize_with_json_summary("json", os, 
+                                evt->get_event_content(), json);
+                        return os.str();
+                    }));
+    }
+
+    kis_mutex mutex;
+
+    std::shared_ptr<kis_net_web_websocket_endpoint> ws;
+    Json::Value json;
+    std::string serialized_key;
+
+    unsigned int coalesce_ms;
+    double max_rate;
+    std::vector<std::string> dedupe_path;
+
+    using pending_list = std::list<std::shared_ptr<eventbus_event>>;
+    pending_list pending;
+    std::unordered_map<std::string, pending_list::iterator> pending_keys;
+
+    double tokens;
+    std::chrono::steady_clock::time_point token_tm;
+};
 
 event_bus::event_bus() :
     lifetime_global(),
@@ -30,42 +225,106 @@ event_bus::event_bus() :
 
     next_cbl_id = 1;
 
+    started = false;
     shutdown = false;
 
     eventbus_event_id = 
         Globalreg::globalreg->entrytracker->register_field("kismet.eventbus.event",
                 tracker_element_factory<eventbus_event>(),
                 "Eventbus event");
-
-    event_cl.lock();
-
-    event_dispatch_t =
-        std::thread([this]() {
-                thread_set_process_name("eventbus");
-                event_queue_dispatcher();
-            });
-
 }
 
 event_bus::~event_bus() {
     shutdown = true;
 
-    event_cl.unlock(0);
-    event_dispatch_t.join();
+    for (auto& l : lanes)
+        l->queue.enqueue(nullptr);
+
+    for (size_t i = 0; i < async_threads.size(); i++)
+        async_queue.enqueue(async_call{nullptr, nullptr});
+
+    for (auto& l : lanes) {
+        if (l->thread.joinable())
+            l->thread.join();
+    }
+
+    for (auto& t : async_threads) {
+        if (t.joinable())
+            t.join();
+    }
 }
 
 void event_bus::trigger_deferred_startup() {
+    // The config isn't loaded when the event bus is created, so the dispatch threads
+    // are started here
+    auto n_lanes = 
+        Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("eventbus_threads", 2);
+    auto n_async = 
+        Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("eventbus_async_threads", 2);
+
+    if (n_lanes == 0)
+        n_lanes = 1;
+    if (n_async == 0)
+        n_async = 1;
+
+    {
+        std::lock_guard<kis_mutex> lk(mutex);
+
+        for (unsigned int i = 0; i < n_lanes; i++) {
+            auto lane = std::make_unique<dispatch_lane>();
+            auto lane_p = lane.get();
+
+            lane->thread =
+                std::thread([this, lane_p, i]() {
+                        thread_set_process_name("eventbus");
+                        kis_thread_placement::place_current_thread("eventbus",
+                                kis_thread_placement::thread_role::eventbus, i);
+                        lane_dispatcher(lane_p);
+                        });
+
+            lanes.push_back(std::move(lane));
+        }
+
+        for (unsigned int i = 0; i < n_async; i++) {
+            async_threads.push_back(std::thread([this, i]() {
+                        thread_set_process_name("eventbus_async");
+                        kis_thread_placement::place_current_thread("eventbus_async",
+                                kis_thread_placement::thread_role::eventbus, i);
+                        async_dispatcher();
+                        }));
+        }
+
+        for (const auto& e : startup_queue)
+            enqueue_event(e);
+
+        startup_queue.clear();
+
+        started = true;
+    }
+
     auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
 
     httpd->register_websocket_route("/eventbus/events", httpd->RO_ROLE, {"ws"},
             std::make_shared<kis_net_web_function_endpoint>(
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
 
-                std::unordered_map<std::string, unsigned long> reg_map;
+                std::unordered_map<std::string, std::shared_ptr<eventbus_ws_subscription>> reg_map;
+
+                auto timetracker = Globalreg::fetch_mandatory_global_as<time_tracker>();
+
+                auto unsubscribe = [this, &reg_map, timetracker](const std::string& channel) {
+                    auto e_k = reg_map.find(channel);
+                    if (e_k != reg_map.end()) {
+                        remove_listener(e_k->second->listener_id);
+                        if (e_k->second->timer_id >= 0)
+                            timetracker->remove_timer(e_k->second->timer_id);
+                        reg_map.erase(e_k);
+                    }
+                };
 
                 auto ws = 
                     std::make_shared<kis_net_web_websocket_endpoint>(con, 
-                        [this, &reg_map](std::shared_ptr<kis_net_web_websocket_endpoint> ws,
+                        [this, &reg_map, &unsubscribe, timetracker](std::shared_ptr<kis_net_web_websocket_endpoint> ws,
                             boost::beast::flat_buffer& buf, bool text) mutable {
 
                             if (!text) {
@@ -85,32 +344,34 @@ void event_bus::trigger_deferred_startup() {
                             }
 
                             if (!json["SUBSCRIBE"].isNull()) {
-                                auto e_k = reg_map.find(json["SUBSCRIBE"].asString());
-                                if (e_k != reg_map.end()) {
-                                    remove_listener(e_k->second);
-                                    reg_map.erase(e_k);
-                                }
+                                unsubscribe(json["SUBSCRIBE"].asString());
+
+                                auto sub = std::make_shared<eventbus_ws_subscription>(ws, json);
 
-                                auto id = 
+                                sub->listener_id = 
                                     register_listener(json["SUBSCRIBE"].asString(), 
-                                            [ws, json](std::shared_ptr<eventbus_event> evt) {
-                                                std::stringstream os;
-                                                Globalreg::globalreg->entrytracker->serialize_with_json_summary("json", os, 
-                                                        evt->get_event_content(), json);
-												auto data = os.str();
-                                                ws->write(data);
-                                            });
-
-                                reg_map[json["SUBSCRIBE"].asString()] = id;
+                                            [sub](std::shared_ptr<eventbus_event> evt) {
+                                                sub->handle_event(evt);
+                                            }, delivery::concurrent);
+
+                                // Coalesced events are sent from a timer, at the 
+                                // timetracker resolution of 100ms
+                                if (sub->get_coalesce_ms() != 0) {
+                                    auto slices = std::max(1U, (sub->get_coalesce_ms() + 99) / 100);
+
+                                    sub->timer_id =
+                                        timetracker->register_timer(time_tracker::slice(slices), 1,
+                                                [sub](int) -> int {
+                                                    sub->flush();
+                                                    return 1;
+                                                }, "eventbus websocket coalesce");
+                                }
+
+                                reg_map[json["SUBSCRIBE"].asString()] = sub;
                             } 
 
                             if (!json["UNSUBSCRIBE"].isNull()) {
-                                auto e_k = reg_map.find(json["UNSUBSCRIBE"].asString());
-                                if (e_k != reg_map.end()) {
-                                    remove_listener(e_k->second);
-                                    reg_map.erase(e_k);
-                                }
-
+                                unsubscribe(json["UNSUBSCRIBE"].asString());
                             }
                         });
 
@@ -123,8 +384,8 @@ void event_bus::trigger_deferred_startup() {
                     ws->close();
                 }
 
-                for (auto s : reg_map)
-                    remove_listener(s.second);
+                while (reg_map.size() > 0)
+                    unsubscribe(reg_map.begin()->first);
                 }));
 
 }
@@ -136,85 +397,100 @@ std::shared_ptr<eventbus_event> event_bus::get_eventbus_event(const std::string&
     return evt;
 }
 
-void event_bus::event_queue_dispatcher() {
-    //kis_unique_lock<kis_mutex> lock(mutex, std::defer_lock, "event_bus event_queue_dispatcher");
-    std::unique_lock<kis_mutex> lock(mutex, std::defer_lock);
+void event_bus::enqueue_event(std::shared_ptr<eventbus_event> evt) {
+    auto lane = std::hash<std::string>{}(evt->get_event_id()) % lanes.size();
+    lanes[lane]->queue.enqueue(evt);
+}
 
+void event_bus::lane_dispatcher(dispatch_lane *lane) {
     while (!shutdown && 
             !Globalreg::globalreg->spindown && 
             !Globalreg::globalreg->fatal_condition &&
             !Globalreg::globalreg->complete) {
 
-        // Lock while we examine the queue
-        lock.lock();
         std::shared_ptr<eventbus_event> e;
-        if (event_queue.size() > 0) {
-            e = event_queue.front();
-            event_queue.pop();
-        }
-        lock.unlock();
 
-        if (e != nullptr) {
-            // Lock the handler mutex while we're processing an event
-            // kis_unique_lock<kis_mutex> rl(handler_mutex, std::defer_lock, "event_bus dispatch");
-            std::unique_lock<kis_mutex> rl(handler_mutex, std::defer_lock);
+        lane->queue.wait_dequeue(e);
 
-            rl.lock();
+        if (e == nullptr)
+            break;
 
-            auto ch_listeners = callback_table.find(e->get_event_id());
-            auto ch_all_listeners = callback_table.find("*");
+        dispatch_event(e);
+    }
+}
 
-            if (ch_listeners == callback_table.end() && ch_all_listeners == callback_table.end()) {
-                continue;
-            }
+void event_bus::async_dispatcher() {
+    while (!shutdown && 
+            !Globalreg::globalreg->spindown && 
+            !Globalreg::globalreg->fatal_condition &&
+            !Globalreg::globalreg->complete) {
 
-            // Copy into a workvec in case one of the event handlers removes itself from the events
-            // in the future
-            std::vector<std::shared_ptr<callback_listener>> workvec;
+        async_call c;
 
-            if (ch_listeners != callback_table.end()) {
-                for (const auto& cbl : ch_listeners->second)  {
-                    workvec.push_back(cbl);
-                }
-            }
+        async_queue.wait_dequeue(c);
 
-            if (ch_all_listeners != callback_table.end()) {
-                for (const auto& cbl : ch_all_listeners->second) {
-                    workvec.push_back(cbl);
-                }
-            }
+        if (c.cbl == nullptr)
+            break;
 
-            rl.unlock();
+        call_listener(c.cbl, c.evt);
+    }
+}
 
-            for (const auto& cbl : workvec) {
-                try {
-                    cbl->cb(e);
-                } catch (const std::exception& e) {
-                    _MSG_ERROR("Error in eventbus handler: {}", e.what());
-                }
+void event_bus::dispatch_event(std::shared_ptr<eventbus_event> evt) {
+    // Copy into a workvec in case one of the event handlers removes itself from the events
+    // in the future
+    std::vector<std::shared_ptr<callback_listener>> workvec;
+
+    {
+        std::shared_lock<kis_shared_mutex> rl(handler_mutex);
+
+        auto ch_listeners = callback_table.find(evt->get_event_id());
+        auto ch_all_listeners = callback_table.find("*");
+
+        if (ch_listeners != callback_table.end()) {
+            for (const auto& cbl : ch_listeners->second)  {
+                workvec.push_back(cbl);
             }
+        }
 
-            // Loop for more events
-            continue;
+        if (ch_all_listeners != callback_table.end()) {
+            for (const auto& cbl : ch_all_listeners->second) {
+                workvec.push_back(cbl);
+            }
         }
+    }
+
+    for (const auto& cbl : workvec) {
+        if (cbl->cb_delivery == delivery::concurrent)
+            async_queue.enqueue(async_call{cbl, evt});
+        else
+            call_listener(cbl, evt);
+    }
+}
 
-        // Reset the lock
-        event_cl.lock();
+void event_bus::call_listener(const std::shared_ptr<callback_listener>& cbl,
+        const std::shared_ptr<eventbus_event>& evt) {
+    kis_trace_span span("eventbus",
+            kis_tracer::enabled.load(std::memory_order_relaxed) ?
+            kis_tracer::intern(evt->get_event_id()) : nullptr);
 
-        // Wait until new events
-        event_cl.block_until();
+    try {
+        cbl->cb(evt);
+    } catch (const std::exception& e) {
+        _MSG_ERROR("Error in eventbus handler: {}", e.what());
     }
 }
 
-unsigned long event_bus::register_listener(const std::string& channel, cb_func cb) {
-    return register_listener(std::list<std::string>{channel}, cb);
+unsigned long event_bus::register_listener(const std::string& channel, cb_func cb,
+        delivery in_delivery) {
+    return register_listener(std::list<std::string>{channel}, cb, in_delivery);
 }
 
-unsigned long event_bus::register_listener(const std::list<std::string>& channels, cb_func cb) {
-    std::lock_guard<kis_mutex> lk(handler_mutex);
-    // kis_lock_guard<kis_mutex> lk(handler_mutex, "event_bus register_listener (vector)");
+unsigned long event_bus::register_listener(const std::list<std::string>& channels, cb_func cb,
+        delivery in_delivery) {
+    kis_lock_guard<kis_shared_mutex> lk(handler_mutex, "event_bus register_listener");
 
-    auto cbl = std::make_shared<callback_listener>(channels, cb, next_cbl_id++);
+    auto cbl = std::make_shared<callback_listener>(channels, cb, in_delivery, next_cbl_id++);
 
     for (auto i : channels) {
         callback_table[i].push_back(cbl);
@@ -226,8 +502,7 @@ unsigned long event_bus::register_listener(const std::list<std::string>& channel
 }
 
 void event_bus::remove_listener(unsigned long id) {
-    std::lock_guard<kis_mutex> lk(handler_mutex);
-    // kis_lock_guard<kis_mutex> lk(handler_mutex, "event_bus remove_listener");
+    kis_lock_guard<kis_shared_mutex> lk(handler_mutex, "event_bus remove_listener");
 
     // Find matching cbl
     auto cbl = callback_id_table.find(id);
@@ -34,6 +34,13 @@
  *   DEVICETRACKER_NEW_DEVICE
  *   PHYTRACKER_NEW_PHY
  *   ALERTRACKER_NEW_ALERT
+ *
+ * Events are dispatched by a pool of threads.  Each channel is assigned to one 
+ * dispatch lane, so the events of a channel are always delivered in the order they
+ * were published.  Ordered listeners are called by the lane itself; concurrent
+ * listeners are handed to a separate pool and may be called for several events at
+ * once, so a slow subscriber (such as a websocket client) doesn't hold up the other
+ * listeners of its lane.
  */
 
 #ifndef __EVENTBUS_H__
@@ -41,10 +48,10 @@
 
 #include "config.h"
 
+#include <atomic>
 #include <functional>
 #include <list>
 #include <memory>
-#include <queue>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -52,6 +59,7 @@
 
 #include "globalregistry.h"
 #include "kis_mutex.h"
+#include "moodycamel/blockingconcurrentqueue.h"
 #include "trackedcomponent.h"
 
 // Most basic event bus event that all other events are derived from
@@ -87,12 +95,36 @@ public:
     void reset() {
         event_id->reset();
         event_content->reset();
+
+        kis_lock_guard<kis_mutex> lk(serialized_mutex, "eventbus_event reset");
+        serialized.clear();
+    }
+
+    // Serialized form of the event, shared by every subscriber which serializes it the
+    // same way.  The key names the serializer and summarization; the generator is only
+    // called by the first subscriber to ask for a key.
+    std::shared_ptr<const std::string> get_serialized(const std::string& in_key,
+            const std::function<std::string ()>& in_generator) {
+        kis_lock_guard<kis_mutex> lk(serialized_mutex, "eventbus_event get_serialized");
+
+        for (const auto& s : serialized)
+            if (s.first == in_key)
+                return s.second;
+
+        auto r = std::make_shared<const std::string>(in_generator());
+        serialized.push_back(std::make_pair(in_key, r));
+        return r;
     }
 
 protected:
     std::shared_ptr<tracker_element_string> event_id;
     std::shared_ptr<tracker_element_string_map> event_content;
 
+    // Events are immutable once published, so serializations are never invalidated
+    // until the event is recycled
+    kis_mutex serialized_mutex;
+    std::vector<std::pair<std::string, std::shared_ptr<const std::string>>> serialized;
+
     virtual void register_fields() override {
         tracker_component::register_fields();
         register_field("kismet.eventbus.type", "Event type", &event_id);
@@ -122,42 +154,61 @@ public:
 
     void trigger_deferred_startup() override;
 
-    unsigned long register_listener(const std::string& channel, cb_func cb);
-    unsigned long register_listener(const std::list<std::string>& channels, cb_func cb);
+    // Ordered listeners are called one event at a time, in the order the events of
+    // each channel were published.  Concurrent listeners must be safe to call from
+    // several threads at once and make no assumptions about event order.
+    enum class delivery {
+        ordered, concurrent
+    };
+
+    unsigned long register_listener(const std::string& channel, cb_func cb,
+            delivery in_delivery = delivery::ordered);
+    unsigned long register_listener(const std::list<std::string>& channels, cb_func cb,
+            delivery in_delivery = delivery::ordered);
     void remove_listener(unsigned long id);
 
     std::shared_ptr<eventbus_event> get_eventbus_event(const std::string& type);
 
     template<typename T>
     void publish(T event) {
-        // kis_lock_guard<kis_mutex> lk(mutex, "eventbus publish");
-        std::lock_guard<kis_mutex> lk(mutex);
-
         auto evt_cast = 
             std::static_pointer_cast<eventbus_event>(event);
 
-        event_queue.push(evt_cast);
-        event_cl.unlock(1);
+        // Events published before the dispatch threads are started are held until 
+        // they are
+        if (!started) {
+            std::lock_guard<kis_mutex> lk(mutex);
+
+            if (!started) {
+                startup_queue.push_back(evt_cast);
+                return;
+            }
+        }
+
+        enqueue_event(evt_cast);
     }
 
 protected:
-    // We need 2 mutexes - we have to block removing a callback while we're dispatching
-    // an event, because we need to not lock up the entire event bus while we're 
-    // sending out events
-    kis_mutex mutex, handler_mutex;
+    // The mutex protects startup; the handler mutex protects the listener tables, and 
+    // is only held exclusively while listeners are added or removed
+    kis_mutex mutex;
+    kis_shared_mutex handler_mutex;
 
     int eventbus_event_id;
 
     unsigned long next_cbl_id;
 
     struct callback_listener {
-        callback_listener(const std::list<std::string>& channels, cb_func cb, unsigned long id) :
+        callback_listener(const std::list<std::string>& channels, cb_func cb, 
+                delivery in_delivery, unsigned long id) :
             cb{cb},
             channels{channels},
+            cb_delivery{in_delivery},
             id{id} { }
 
         cb_func cb;
         std::list<std::string> channels;
+        delivery cb_delivery;
         unsigned long id;
     };
 
@@ -165,13 +216,35 @@ protected:
     std::unordered_map<std::string, std::vector<std::shared_ptr<callback_listener>>> callback_table;
     std::unordered_map<unsigned long, std::shared_ptr<callback_listener>> callback_id_table;
 
-    // Event pool and handler thread
-    std::queue<std::shared_ptr<eventbus_event>> event_queue;
-    std::thread event_dispatch_t;
-    conditional_locker<int> event_cl;
+    // Dispatch lane; a null event stops the lane
+    struct dispatch_lane {
+        moodycamel::BlockingConcurrentQueue<std::shared_ptr<eventbus_event>> queue;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<dispatch_lane>> lanes;
+
+    // Concurrent listener calls; a null listener stops the thread
+    struct async_call {
+        std::shared_ptr<callback_listener> cbl;
+        std::shared_ptr<eventbus_event> evt;
+    };
+
+    moodycamel::BlockingConcurrentQueue<async_call> async_queue;
+    std::vector<std::thread> async_threads;
+
+    std::vector<std::shared_ptr<eventbus_event>> startup_queue;
+    std::atomic<bool> started;
     std::atomic<bool> shutdown;
-    void event_queue_dispatcher();
-    
+
+    void enqueue_event(std::shared_ptr<eventbus_event> evt);
+
+    void lane_dispatcher(dispatch_lane *lane);
+    void async_dispatcher();
+
+    void dispatch_event(std::shared_ptr<eventbus_event> evt);
+    void call_listener(const std::shared_ptr<callback_listener>& cbl,
+            const std::shared_ptr<eventbus_event>& evt);
 };
 
 #endif
@@ -26,6 +26,7 @@
 #include <mutex>
 #include <future>
 #include <list>
+#include <vector>
 
 #include <stdlib.h>
 #include <string.h>
@@ -45,6 +46,10 @@
 // wait() - waits until data is *present in the buffer*, should be called by the consumer
 // wait_write() - waits until the buffer *has flushed data*, should be called by a producer
 //  looking to throttle size buffer size.
+//
+// The consumer can either take the first chunk with get(), or a scatter/gather view of
+// every buffered chunk with get_buffers(), which can be handed to a socket write without
+// copying.  Consumed chunks are pooled and reused instead of being freed.
 class future_chainbuf : public std::stringbuf {
 protected:
     class data_chunk {
@@ -52,7 +57,8 @@ protected:
         data_chunk(size_t sz):
             sz_{sz},
             start_{0},
-            end_{0} {
+            end_{0},
+            wrapped_{false} {
             chunk_ = std::shared_ptr<char>(new char[sz], std::default_delete<char[]>());
         }
 
@@ -60,7 +66,15 @@ protected:
             chunk_{data},
             sz_{sz},
             start_{0},
-            end_{sz} { }
+            end_{sz},
+            wrapped_{true} { }
+
+        void wrap(std::shared_ptr<char> data, size_t sz) {
+            chunk_ = data;
+            sz_ = sz;
+            start_ = 0;
+            end_ = sz;
+        }
 
         ~data_chunk() { }
 
@@ -107,8 +121,54 @@ protected:
         std::shared_ptr<char> chunk_;
         size_t sz_;
         size_t start_, end_;
+
+        // Wraps a caller-provided buffer instead of owning a chunk_sz_ buffer
+        bool wrapped_;
     };
 
+    // Maximum number of idle chunks of each kind held for reuse
+    static constexpr size_t max_pooled_chunks = 32;
+
+    // Chunk management, called with the mutex held
+    data_chunk *new_chunk() {
+        if (chunk_pool_.size() > 0) {
+            auto c = chunk_pool_.back();
+            chunk_pool_.pop_back();
+            c->recycle();
+            return c;
+        }
+
+        return new data_chunk(chunk_sz_);
+    }
+
+    data_chunk *new_packet_chunk(std::shared_ptr<char> data, size_t sz) {
+        if (packet_pool_.size() > 0) {
+            auto c = packet_pool_.back();
+            packet_pool_.pop_back();
+            c->wrap(data, sz);
+            return c;
+        }
+
+        return new data_chunk(data, sz);
+    }
+
+    void release_chunk(data_chunk *c) {
+        if (c->wrapped_) {
+            // Drop our reference to the packet now, not when the shell is reused
+            c->chunk_.reset();
+
+            if (packet_pool_.size() < max_pooled_chunks) {
+                packet_pool_.push_back(c);
+                return;
+            }
+        } else if (c->sz_ == chunk_sz_ && chunk_pool_.size() < max_pooled_chunks) {
+            chunk_pool_.push_back(c);
+            return;
+        }
+
+        delete c;
+    }
+
 public:
     future_chainbuf() :
         chunk_sz_{4096},
@@ -136,6 +196,12 @@ public:
         for (auto c : chunk_list_) {
             delete c;
         }
+
+        for (auto c : chunk_pool_)
+            delete c;
+
+        for (auto c : packet_pool_)
+            delete c;
     }
 
     size_t get(char **data) {
@@ -151,6 +217,36 @@ public:
         return target->used();
     }
 
+    // Fill out with views of up to max_sz bytes of buffered data, spanning as many chunks
+    // as are buffered, and return the total size.  BufferT is constructed from a pointer
+    // and length (such as boost::asio::const_buffer), so the result can be written as a 
+    // buffer sequence directly.  The views remain valid until they are consumed.
+    template<typename BufferT>
+    size_t get_buffers(std::vector<BufferT>& out, size_t max_sz) {
+        const std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+        out.clear();
+
+        size_t total_sz = 0;
+
+        for (auto c : chunk_list_) {
+            if (total_sz >= max_sz)
+                break;
+
+            auto used = c->used();
+
+            if (used == 0)
+                continue;
+
+            auto take_sz = std::min(used, max_sz - total_sz);
+
+            out.emplace_back(c->content(), take_sz);
+            total_sz += take_sz;
+        }
+
+        return total_sz;
+    }
+
     void consume(size_t sz) {
         const std::lock_guard<std::recursive_mutex> lock(mutex_);
 
@@ -164,14 +260,14 @@ public:
         while (consumed_sz < sz && consumed_sz < total_sz_) {
             size_t consumed_chunk_sz;
 
-            consumed_chunk_sz = target->consume(sz);
+            consumed_chunk_sz = target->consume(sz - consumed_sz);
             consumed_sz += consumed_chunk_sz;
 
             if (target->exhausted()) {
                 if (chunk_list_.size() == 1) {
                     if (packet_) {
                         chunk_list_.pop_front();
-                        delete target;
+                        release_chunk(target);
                         target = nullptr;
                     } else {
                         target->recycle();
@@ -180,9 +276,11 @@ public:
                     break;
                 } else {
                     chunk_list_.pop_front();
-                    delete target;
+                    release_chunk(target);
                     target = chunk_list_.front();
                 }
+            } else if (consumed_chunk_sz == 0) {
+                break;
             }
         }
 
@@ -218,7 +316,7 @@ public:
         if (chunk_list_.size() != 0) {
             target = chunk_list_.back();
         } else {
-            target = new data_chunk(chunk_sz_);
+            target = new_chunk();
             chunk_list_.push_back(target);
         }
 
@@ -231,7 +329,7 @@ public:
             written_sz += written_chunk_sz;
 
             if (target->available() == 0) {
-                target = new data_chunk(chunk_sz_);
+                target = new_chunk();
                 chunk_list_.push_back(target);
             }
         }
@@ -256,7 +354,7 @@ public:
         }
 
         if (packet_) {
-            data_chunk *target = new data_chunk(data, sz);
+            data_chunk *target = new_packet_chunk(data, sz);
             chunk_list_.push_back(target);
             total_sz_ += sz;
             mutex_.unlock();
@@ -272,7 +370,7 @@ public:
         if (chunk_list_.size() != 0) {
             target = chunk_list_.back();
         } else {
-            target = new data_chunk(chunk_sz_);
+            target = new_chunk();
             chunk_list_.push_back(target);
         }
 
@@ -285,7 +383,7 @@ public:
             written_sz += written_chunk_sz;
 
             if (target->available() == 0) {
-                target = new data_chunk(chunk_sz_);
+                target = new_chunk();
                 chunk_list_.push_back(target);
             }
         }
@@ -352,9 +450,9 @@ public:
             throw std::runtime_error("reset futurechainbuf while waiting");
 
         for (auto c : chunk_list_)
-            delete c;
+            release_chunk(c);
         chunk_list_.clear();
-        chunk_list_.push_front(new data_chunk(chunk_sz_));
+        chunk_list_.push_front(new_chunk());
 
         total_sz_ = 0;
         complete_ = false;
@@ -365,6 +463,15 @@ public:
     void cancel() {
         mutex_.lock();
         cancel_ = true;
+
+        // Release any producer blocked on the backlog
+        try {
+            if (write_waiting_)
+                write_wait_promise_.set_value();
+        } catch (const std::future_error& e) {
+            ;
+        }
+
         mutex_.unlock();
         sync();
     }
@@ -415,14 +522,44 @@ public:
 
         ft.wait();
 
+        write_waiting_ = false;
+
         return total_sz_;
     }
 
+    // Block the producer until the unsent backlog is at or below max_sz, or the buffer
+    // is no longer running.  The size is checked under the buffer lock so a consumer
+    // draining the buffer between the check and the wait can't strand the producer.
+    size_t wait_write_below(size_t max_sz) {
+        while (true) {
+            std::unique_lock<std::recursive_mutex> lk(mutex_);
+
+            if (total_sz_ <= max_sz || !running())
+                return total_sz_;
+
+            if (write_waiting_)
+                throw std::runtime_error("future_stream already blocking for write");
+
+            write_waiting_ = true;
+            write_wait_promise_ = std::promise<void>();
+            auto ft = write_wait_promise_.get_future();
+            lk.unlock();
+
+            ft.wait();
+
+            write_waiting_ = false;
+        }
+    }
+
 protected:
     std::recursive_mutex mutex_;
 
     std::list<data_chunk *> chunk_list_;
 
+    // Idle owned chunks and packet wrappers
+    std::vector<data_chunk *> chunk_pool_;
+    std::vector<data_chunk *> packet_pool_;
+
     std::atomic<size_t> chunk_sz_;
     std::atomic<size_t> sync_sz_;
     std::atomic<size_t> total_sz_;
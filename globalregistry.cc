@@ -226,4 +226,6 @@ void global_registry::shutdown_deferred() {
 std::atomic<unsigned long> Globalreg::n_tracked_fields;
 std::atomic<unsigned long> Globalreg::n_tracked_components;
 std::atomic<unsigned long> Globalreg::n_tracked_http_connections;
+bool Globalreg::tracker_inline_fields = false;
+bool Globalreg::tracker_intern_strings = false;
 
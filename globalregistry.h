@@ -31,6 +31,7 @@
 #include "macaddr.h"
 #include "objectpool.h"
 #include "robin_hood.h"
+#include "trackedarena.h"
 #include "util.h"
 #include "uuid.h"
 
@@ -255,8 +256,9 @@ public:
     void start_deferred();
     void shutdown_deferred();
 
-    // Global ASIO contexts and IO threads
-    const int n_io_threads = static_cast<int>(std::thread::hardware_concurrency() * 4);
+    // Global ASIO contexts and IO threads; the number of threads is set from the
+    // config at startup
+    int n_io_threads = static_cast<int>(std::thread::hardware_concurrency() * 4);
     boost::asio::io_context io{n_io_threads};
 
     kis_mutex ext_mutex;
@@ -282,6 +284,12 @@ namespace Globalreg {
     extern std::atomic<unsigned long> n_tracked_components;
     extern std::atomic<unsigned long> n_tracked_http_connections;
 
+    // Build the scalar fields of tracked components in a single block
+    extern bool tracker_inline_fields;
+
+    // Share the records of low-cardinality string fields through the string pool
+    extern bool tracker_intern_strings;
+
     extern global_registry *globalreg;
 
     template<typename T> 
@@ -352,6 +360,10 @@ namespace Globalreg {
     // is not enabled for this type.  By default a uniqueptr is constructed with a generic new
     template<typename T>
     std::shared_ptr<T> new_from_pool(std::function<std::shared_ptr<T> ()> fallback_new = nullptr) {
+        // Objects built for a record with its own arena come from the arena instead
+        if (fallback_new == nullptr && tracker_arena::current() != nullptr)
+            return tracker_arena_make_shared<T>();
+
         kis_unique_lock<kis_mutex> lk(Globalreg::globalreg->pool_map_mutex, "globalreg new_from_pool");
 
         auto p = Globalreg::globalreg->object_pool_map.find(typeid(T).hash_code());
@@ -370,6 +382,9 @@ namespace Globalreg {
 
     template<typename T>
         std::shared_ptr<T> new_from_pool(const T* model, std::function<std::shared_ptr<T> (const T*)> fallback_new = nullptr) {
+            if (fallback_new == nullptr && tracker_arena::current() != nullptr)
+                return tracker_arena_make_shared<T>(model);
+
             kis_unique_lock<kis_mutex> lk(Globalreg::globalreg->pool_map_mutex, "globalreg new_from_pool");
 
             auto p = Globalreg::globalreg->object_pool_map.find(typeid(T).hash_code());
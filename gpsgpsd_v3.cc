@@ -18,15 +18,187 @@
 
 #include "config.h"
 
+#include <stdlib.h>
 #include <time.h>
 #include <future>
 
+#include "boost/utility/string_view.hpp"
+
 #include "gpsgpsd_v3.h"
 #include "gpstracker.h"
 #include "messagebus.h"
 #include "timetracker.h"
 #include "util.h"
 
+namespace {
+    // gpsd reports are flat JSON objects of strings and numbers, so rather than
+    // building a document for every line, the members of the top level object are
+    // scanned in place.  Nested values are skipped whole.
+
+    const char *gpsd_skip_ws(const char *p, const char *e) {
+        while (p < e && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+            p++;
+        return p;
+    }
+
+    // Skip a string starting at the opening quote, returning the position after the
+    // closing quote or nullptr if it is not terminated
+    const char *gpsd_skip_string(const char *p, const char *e) {
+        for (p++; p < e; p++) {
+            if (*p == '\\')
+                p++;
+            else if (*p == '"')
+                return p + 1;
+        }
+
+        return nullptr;
+    }
+
+    const char *gpsd_skip_value(const char *p, const char *e) {
+        if (p >= e)
+            return nullptr;
+
+        if (*p == '"')
+            return gpsd_skip_string(p, e);
+
+        if (*p == '{' || *p == '[') {
+            int depth = 0;
+
+            while (p < e) {
+                if (*p == '"') {
+                    p = gpsd_skip_string(p, e);
+
+                    if (p == nullptr)
+                        return nullptr;
+
+                    continue;
+                }
+
+                if (*p == '{' || *p == '[') {
+                    depth++;
+                } else if (*p == '}' || *p == ']') {
+                    if (--depth == 0)
+                        return p + 1;
+                }
+
+                p++;
+            }
+
+            return nullptr;
+        }
+
+        // Numbers, true, false, and null
+        auto s = p;
+
+        while (p < e && *p != ',' && *p != '}' && *p != ']' &&
+                *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+            p++;
+
+        return p == s ? nullptr : p;
+    }
+
+    // Call in_cb(key, value, value_end) for every member of the top level object,
+    // where value is the raw text of the member value; returns false if the line is
+    // not a well formed object
+    template<typename F>
+    bool gpsd_scan_members(const std::string& in_line, F in_cb) {
+        auto p = in_line.data();
+        auto e = p + in_line.length();
+
+        p = gpsd_skip_ws(p, e);
+
+        if (p >= e || *p != '{')
+            return false;
+
+        p = gpsd_skip_ws(p + 1, e);
+
+        if (p < e && *p == '}')
+            return true;
+
+        while (p < e) {
+            if (*p != '"')
+                return false;
+
+            auto kend = gpsd_skip_string(p, e);
+
+            if (kend == nullptr)
+                return false;
+
+            auto key = boost::string_view(p + 1, kend - p - 2);
+
+            p = gpsd_skip_ws(kend, e);
+
+            if (p >= e || *p != ':')
+                return false;
+
+            p = gpsd_skip_ws(p + 1, e);
+
+            auto vend = gpsd_skip_value(p, e);
+
+            if (vend == nullptr)
+                return false;
+
+            in_cb(key, p, vend);
+
+            p = gpsd_skip_ws(vend, e);
+
+            if (p >= e)
+                return false;
+
+            if (*p == '}')
+                return true;
+
+            if (*p != ',')
+                return false;
+
+            p = gpsd_skip_ws(p + 1, e);
+        }
+
+        return false;
+    }
+
+    bool gpsd_value_double(const char *in_value, const char *in_end, double& out) {
+        char *end;
+
+        if (in_value >= in_end || *in_value == '"')
+            return false;
+
+        out = strtod(in_value, &end);
+
+        return end == in_end;
+    }
+
+    std::string gpsd_value_string(const char *in_value, const char *in_end) {
+        if (in_end - in_value < 2 || *in_value != '"')
+            return "";
+
+        return std::string(in_value + 1, in_end - in_value - 2);
+    }
+
+    // Class of a gpsd record; gpsd always leads with the class member, so check for it
+    // directly before falling back to scanning the object
+    bool gpsd_json_class(const std::string& in_line, std::string& out_class) {
+        const std::string prefix = "{\"class\":\"";
+
+        if (in_line.compare(0, prefix.length(), prefix) == 0) {
+            auto end = in_line.find('"', prefix.length());
+
+            if (end != std::string::npos) {
+                out_class = in_line.substr(prefix.length(), end - prefix.length());
+                return true;
+            }
+        }
+
+        out_class = "";
+
+        return gpsd_scan_members(in_line,
+                [&out_class](boost::string_view key, const char *v, const char *ve) {
+                    if (key == "class")
+                        out_class = gpsd_value_string(v, ve);
+                });
+    }
+}
+
 kis_gps_gpsd_v3::kis_gps_gpsd_v3(shared_gps_builder in_builder) : 
     kis_gps(in_builder),
     resolver{Globalreg::globalreg->io},
@@ -272,24 +444,72 @@ void kis_gps_gpsd_v3::handle_read(const boost::system::error_code& error, std::s
         return start_read();
     }
 
+    // A watching gpsd sends far more SKY, DEVICE, and other records than it sends TPV
+    // records, so classify JSON records first, and handle everything but a TPV without
+    // building a location or taking the data lock
+    if (line[0] == '{') {
+        std::string msg_class;
+
+        if (!gpsd_json_class(line, msg_class)) {
+            _MSG_ERROR("(GPS) Received an invalid JSON record from GPSD {}:{}", host, port);
+            close_impl();
+            handle_error();
+            return;
+        }
+
+        if (msg_class == "VERSION") {
+            std::string version;
+
+            gpsd_scan_members(line, 
+                    [&version](boost::string_view key, const char *v, const char *ve) {
+                        if (key == "release")
+                            version = gpsd_value_string(v, ve);
+                    });
+
+            _MSG_INFO("(GPS) Connected to a JSON-enabled GPSD ({}), enabling JSON mode", 
+                    munge_to_printable(version));
+
+            // Set JSON mode
+            poll_mode = 10;
+            // We get speed in meters/sec
+            si_units = 1;
+
+            write_gpsd("?WATCH={\"json\":true};\n");
+        } else if (msg_class == "ATT") {
+            gpsd_scan_members(line, 
+                    [this](boost::string_view key, const char *v, const char *ve) {
+                        double d;
+
+                        if (key == "heading" && gpsd_value_double(v, ve, d)) {
+                            last_att_heading_time = time(0);
+                            last_att_heading = d;
+                        }
+                    });
+        }
+
+        if (msg_class != "TPV") {
+            last_data_time = time(0);
+            return start_read();
+        }
+    }
+
     // Aggregate into a new location; then copy into the main location
     // depending on what we found.  Locations can come in multiple sentences
     // so if we're within a second of the previous one we can aggregate them.
    
     // We don't have to worry about mutexes here because we're the only ones 
-    // who can alter this, so we can blind read and copy gps_location
+    // who can alter this, so we can blind read and copy gps_location; the
+    // published location is never modified, a new one replaces it.
 
     auto new_location = packetchain->new_packet_component<kis_gps_packinfo>();
 
     // If it's been < 1 second since the last time, inherit it
     struct timeval now;
-    struct timeval tdiff;
 
     gettimeofday(&now, NULL);
 
-    subtract_timeval(&gps_location->tv, &now, &tdiff);
-
-    if (now.tv_sec < 1)
+    if ((now.tv_sec - gps_location->tv.tv_sec) * 1000000L + 
+            (now.tv_usec - gps_location->tv.tv_usec) < 1000000L)
         new_location->set(gps_location);
 
     bool set_lat_lon = false;
@@ -298,153 +518,92 @@ void kis_gps_gpsd_v3::handle_read(const boost::system::error_code& error, std::s
     bool set_heading = false;
     bool set_magheading = false;
 
-    // We don't know what we're going to get from GPSD.  If it starts with 
-    // { then it probably is json, try to parse it
+    // Only TPV records get this far; extract the members used for the location
     if (line[0] == '{') {
-        Json::Value json;
-
-        try {
-            std::stringstream ss(line);
-            ss >> json;
-
-            std::string msg_class = json["class"].asString();
-
-            if (msg_class == "VERSION") {
-                std::string version  = munge_to_printable(json["release"].asString());
-
-                _MSG_INFO("(GPS) Connected to a JSON-enabled GPSD ({}), enabling JSON mode", version);
-
-                // Set JSON mode
-                poll_mode = 10;
-                // We get speed in meters/sec
-                si_units = 1;
-
-                write_gpsd("?WATCH={\"json\":true};\n");
-            } else if (msg_class == "TPV") {
-                if (json.isMember("mode")) {
-                    new_location->fix = json["mode"].asInt();
-                    set_fix = true;
-                }
-
-                // If we have a valid alt, use it
-                if (set_fix && new_location->fix > 2) {
-                    if (json.isMember("alt")) {
-                        new_location->alt = json["alt"].asDouble();
-                        set_alt = true;
+        bool has_mode = false, has_alt = false, has_lat = false, has_lon = false;
+        bool has_track = false, has_magtrack = false, has_speed = false;
+        int mode = 0;
+        double alt = 0, lat = 0, lon = 0, track = 0, magtrack = 0, speed = 0;
+
+        auto valid = gpsd_scan_members(line, 
+                [&](boost::string_view key, const char *v, const char *ve) {
+                    double d;
+
+                    if (!gpsd_value_double(v, ve, d))
+                        return;
+
+                    if (key == "mode") {
+                        mode = static_cast<int>(d);
+                        has_mode = true;
+                    } else if (key == "alt") {
+                        alt = d;
+                        has_alt = true;
+                    } else if (key == "lat") {
+                        lat = d;
+                        has_lat = true;
+                    } else if (key == "lon") {
+                        lon = d;
+                        has_lon = true;
+                    } else if (key == "track") {
+                        track = d;
+                        has_track = true;
+                    } else if (key == "magtrack") {
+                        magtrack = d;
+                        has_magtrack = true;
+                    } else if (key == "speed") {
+                        speed = d;
+                        has_speed = true;
+                    } else if (key == "epx") {
+                        new_location->error_x = d;
+                    } else if (key == "epy") {
+                        new_location->error_y = d;
+                    } else if (key == "epv") {
+                        new_location->error_v = d;
                     }
-                } 
-
-                if (json.isMember("epx")) {
-                    new_location->error_x = json["epx"].asDouble();
-                }
-
-                if (json.isMember("epy")) {
-                    new_location->error_y = json["epy"].asDouble();
-                }
-
-                if (json.isMember("epv")) {
-                    new_location->error_v = json["epv"].asDouble();
-                }
-
-                if (set_fix && new_location->fix >= 2) {
-                    // If we have LAT and LON, use them
-                    if (json.isMember("lat") && json.isMember("lon")) {
-                        new_location->lat = json["lat"].asDouble();
-                        new_location->lon = json["lon"].asDouble();
-
-                        if (new_location->lat != 0 && new_location->lon != 0)
-                            set_lat_lon = true;
-                    }
-
-                    if (json.isMember("track")) {
-                        auto t = json["track"].asDouble();
-                        if (t != 0) {
-                            new_location->heading = t;
-                            set_heading = true;
-                        }
-                    }
-
-                    if (json.isMember("magtrack")) {
-                        auto t = json["magtrack"].asDouble();
-                        if (t != 0) {
-                            new_location->magheading = t;
-                            set_magheading = true;
-                        }
-                    }
-
-                    if (json.isMember("speed")) {
-                        new_location->speed = json["speed"].asDouble();
-
-                        // GPSD JSON reports in meters/second, convert to kph
-                        new_location->speed *= 3.6;
-                    }
-                }
-            } else if (msg_class == "ATT") {
-                if (json.isMember("heading")) {
-                    last_att_heading_time = time(0);
-                    last_att_heading = json["heading"].asDouble();
-                }
-#if 0
-            } else if (msg_class == "SKY") {
-                GPSCore::sat_pos sp;
-                struct JSON_value *v = NULL, *s = NULL;
-
-                gps_connected = 1;
-
-                v = JSON_dict_get_value(json, "satellites", err);
-
-                if (err.length() == 0 && v != NULL) {
-                    sat_pos_map.clear();
-
-                    if (v->value.tok_type == JSON_arrstart) {
-                        for (unsigned int z = 0; z < v->value_array.size(); z++) {
-                            float prn, ele, az, snr;
-                            int valid = 1;
-
-                            s = v->value_array[z];
-
-                            // If we're not a dictionary in the sat array, skip
-                            if (s->value.tok_type != JSON_start) {
-                                continue;
-                            }
-
-                            prn = JSON_dict_get_number(s, "PRN", err);
-                            if (err.length() != 0) 
-                                valid = 0;
+                });
 
-                            ele = JSON_dict_get_number(s, "el", err);
-                            if (err.length() != 0)
-                                valid = 0;
+        if (!valid) {
+            _MSG_ERROR("(GPS) Received an invalid JSON record from GPSD {}:{}", host, port);
+            close_impl();
+            handle_error();
+            return;
+        }
 
-                            az = JSON_dict_get_number(s, "az", err);
-                            if (err.length() != 0)
-                                valid = 0;
+        if (has_mode) {
+            new_location->fix = mode;
+            set_fix = true;
+        }
 
-                            snr = JSON_dict_get_number(s, "ss", err);
-                            if (err.length() != 0)
-                                valid = 0;
+        // If we have a valid alt, use it
+        if (set_fix && new_location->fix > 2 && has_alt) {
+            new_location->alt = alt;
+            set_alt = true;
+        }
 
-                            if (valid) {
-                                sp.prn = prn;
-                                sp.elevation = ele;
-                                sp.azimuth = az;
-                                sp.snr = snr;
+        if (set_fix && new_location->fix >= 2) {
+            // If we have LAT and LON, use them
+            if (has_lat && has_lon) {
+                new_location->lat = lat;
+                new_location->lon = lon;
 
-                                sat_pos_map[prn] = sp;
-                            }
-                        }
+                if (new_location->lat != 0 && new_location->lon != 0)
+                    set_lat_lon = true;
+            }
 
-                    }
+            if (has_track && track != 0) {
+                new_location->heading = track;
+                set_heading = true;
+            }
 
-                }
-#endif
+            if (has_magtrack && magtrack != 0) {
+                new_location->magheading = magtrack;
+                set_magheading = true;
             }
 
-        } catch (std::exception& e) {
-            _MSG_ERROR("(GPS) Received an invalid JSON record from GPSD {}:{} - '{}'", host, port, e.what());
-            close_impl();
-            handle_error();
-            return;
+            if (has_speed) {
+                // GPSD JSON reports in meters/second, convert to kph
+                new_location->speed = speed * 3.6;
+            }
         }
     } else if (poll_mode == 0 && line == "GPSD") {
         // Look for a really old gpsd which doesn't do anything intelligent
@@ -39,6 +39,8 @@ gps_tracker::gps_tracker() :
 
     gpsmanager_mutex.set_name("gps_tracker");
 
+    best_location_timer_id = -1;
+
     Globalreg::enable_pool_type<kis_tracked_location_triplet>([](auto *a) { a->reset(); });
     Globalreg::enable_pool_type<kis_tracked_location>([](auto *a) { a->reset(); });
     Globalreg::enable_pool_type<kis_tracked_location_full>([](auto *a) { a->reset(); });
@@ -55,6 +57,7 @@ gps_tracker::~gps_tracker() {
 
     timetracker->remove_timer(log_snapshot_timer);
     timetracker->remove_timer(event_timer_id);
+    timetracker->remove_timer(best_location_timer_id);
 }
 
 void gps_tracker::trigger_deferred_startup() {
@@ -234,6 +237,15 @@ void gps_tracker::trigger_deferred_startup() {
                     stream << "Removed GPS\n";
                 }));
 
+    // GPS devices report at most a few fixes a second, far slower than packets arrive, so
+    // the best location is found once per timeslice instead of once per packet
+    best_location_timer_id =
+        timetracker->register_timer(time_tracker::slice(1), true,
+                [this](int) -> int {
+                    update_best_location();
+                    return 1;
+                }, "gps_tracker best location");
+
     event_timer_id = 
         timetracker->register_timer(std::chrono::seconds(1), true, 
                 [this](int) -> int {
@@ -459,8 +471,8 @@ std::shared_ptr<kis_gps> gps_tracker::find_gps_by_name(const std::string& in_nam
     return nullptr;
 }
 
-std::shared_ptr<kis_gps_packinfo> gps_tracker::get_best_location() {
-    kis_lock_guard<kis_mutex> lk(gpsmanager_mutex, "get_best_location");
+std::shared_ptr<kis_gps_packinfo> gps_tracker::find_best_location() {
+    kis_lock_guard<kis_mutex> lk(gpsmanager_mutex, "find_best_location");
 
     if (gps_instances_vec == nullptr)
         return nullptr;
@@ -480,6 +492,15 @@ std::shared_ptr<kis_gps_packinfo> gps_tracker::get_best_location() {
     return nullptr;
 }
 
+void gps_tracker::update_best_location() {
+    auto loc = find_best_location();
+
+    // Drivers replace their location record with a new one for each fix, so an unchanged
+    // record needs no swap
+    if (loc != std::atomic_load(&best_location))
+        std::atomic_store(&best_location, loc);
+}
+
 int gps_tracker::kis_gpspack_hook(CHAINCALL_PARMS) {
     // We're an 'external user' of gps_tracker despite being inside it,
     // so don't do thread locking - that's up to gps_tracker internals
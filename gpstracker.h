@@ -21,6 +21,8 @@
 
 #include "config.h"
 
+#include <memory>
+
 #include "eventbus.h"
 #include "globalregistry.h"
 #include "kis_mutex.h"
@@ -188,8 +190,12 @@ public:
     // Set a primary GPS
     bool set_primary_gps(uuid in_uuid);
 
-    // get the best location (as in the 'best' gps devices first)
-    std::shared_ptr<kis_gps_packinfo> get_best_location();
+    // get the best location (as in the 'best' gps devices first).  The best location is
+    // refreshed from the gps devices every timeslice and the same record is shared by 
+    // every packet and caller until the next refresh, so it must not be modified.
+    std::shared_ptr<kis_gps_packinfo> get_best_location() {
+        return std::atomic_load(&best_location);
+    }
 
     // Populate packets that don't have a GPS location
     static int kis_gpspack_hook(CHAINCALL_PARMS);
@@ -208,6 +214,13 @@ protected:
     // Extra field we insert into a location record
     int tracked_uuid_addition_id;
 
+    // Current best location, swapped atomically so packets can be tagged without locking
+    std::shared_ptr<kis_gps_packinfo> best_location;
+    int best_location_timer_id;
+
+    std::shared_ptr<kis_gps_packinfo> find_best_location();
+    void update_best_location();
+
     // Logging function
     void log_snapshot_gps();
 
@@ -24,9 +24,26 @@
 #include <map>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <sstream>
 #include <string>
 #include <math.h>
 #include <cmath>
+#include <limits>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define JSON_ADAPTER_TO_CHARS 1
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "globalregistry.h"
 #include "trackedelement.h"
@@ -36,136 +53,349 @@
 #include "devicetracker_component.h"
 #include "json_adapter.h"
 
-/* sanitize_extra_space and sanitize_string taken from nlohmann's jsonhpp library,
-   Copyright 2013-2015 Niels Lohmann. and under the MIT license */
+// Escaped form of each byte which needs it in a JSON string; 0 for bytes written as-is
+// and 'u' for control characters written as \u00xx
+static const char json_escape_table[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0,
+};
+
+// Position of the next byte at or after in_pos which needs escaping, or len
+static size_t json_escape_scan(const char *in, size_t in_pos, size_t len) {
+    auto pos = in_pos;
+
+#ifdef __SSE2__
+    const auto quote = _mm_set1_epi8('"');
+    const auto backslash = _mm_set1_epi8('\\');
+    const auto ctrl = _mm_set1_epi8(0x1f);
+
+    while (pos + 16 <= len) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + pos));
+
+        // Control characters are those where max(v, 0x1f) == 0x1f, unsigned
+        auto m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                _mm_cmpeq_epi8(_mm_max_epu8(v, ctrl), ctrl));
+
+        auto mask = _mm_movemask_epi8(m);
+
+        if (mask != 0)
+            return pos + __builtin_ctz(mask);
+
+        pos += 16;
+    }
+#endif
+
+    while (pos < len && json_escape_table[static_cast<uint8_t>(in[pos])] == 0)
+        pos++;
+
+    return pos;
+}
+
+// Call in_write with each run of the escaped string
+template<typename W>
+static void json_escape(const char *in, size_t len, W in_write) {
+    static const char hex[] = "0123456789abcdef";
+    size_t start = 0;
+
+    while (start < len) {
+        auto pos = json_escape_scan(in, start, len);
+
+        if (pos != start)
+            in_write(in + start, pos - start);
+
+        if (pos >= len)
+            break;
+
+        auto c = static_cast<uint8_t>(in[pos]);
+        auto e = json_escape_table[c];
+
+        if (e == 'u') {
+            char u[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+            in_write(u, 6);
+        } else {
+            char u[2] = {'\\', e};
+            in_write(u, 2);
+        }
+
+        start = pos + 1;
+    }
+}
+
 std::size_t json_adapter::sanitize_extra_space(const std::string& s) noexcept {
     std::size_t result = 0;
 
     for (const auto& c : s) {
-        switch (c) {
-            case '"':
-            case '\\':
-            case '\b':
-            case '\f':
-            case '\n':
-            case '\r':
-            case '\t':
-                {
-                    // from c (1 byte) to \x (2 bytes)
-                    result += 1;
-                    break;
-                }
+        auto e = json_escape_table[static_cast<uint8_t>(c)];
 
-            default:
-                {
-                    if (c >= 0x00 and c <= 0x1f)
-                    {
-                        // from c (1 byte) to \uxxxx (6 bytes)
-                        result += 5;
-                    }
-                    break;
-                }
-        }
+        // \x is 1 extra byte, \u00xx is 5
+        if (e == 'u')
+            result += 5;
+        else if (e != 0)
+            result += 1;
     }
 
     return result;
 }
 
 std::string json_adapter::sanitize_string(const std::string& s) noexcept {
-    const auto space = sanitize_extra_space(s);
-    if (space == 0) {
+    if (json_escape_scan(s.data(), 0, s.length()) == s.length())
         return s;
+
+    std::string result;
+    result.reserve(s.length() + 16);
+
+    json_escape(s.data(), s.length(), [&result](const char *d, size_t l) {
+            result.append(d, l);
+        });
+
+    return result;
+}
+
+void json_adapter::write_escaped(std::ostream& stream, const char *in, size_t len) {
+    json_escape(in, len, [&stream](const char *d, size_t l) {
+            stream.write(d, l);
+        });
+}
+
+void json_adapter::write_int(std::ostream& stream, int64_t in) {
+    fmt::format_int f(static_cast<long long>(in));
+    stream.write(f.data(), f.size());
+}
+
+void json_adapter::write_uint(std::ostream& stream, uint64_t in) {
+    fmt::format_int f(static_cast<unsigned long long>(in));
+    stream.write(f.data(), f.size());
+}
+
+template<typename F>
+static void json_write_floating(std::ostream& stream, F in) {
+    if (std::isnan(in) || std::isinf(in)) {
+        stream.put('0');
+        return;
     }
 
-    // create a result string of necessary size
-    std::string result(s.size() + space, '\\');
-    std::size_t pos = 0;
+    // Integral values within the exact range of a double are written as integers
+    if (std::floor(in) == in && std::fabs(in) < 9007199254740992.0) {
+        json_adapter::write_int(stream, static_cast<int64_t>(in));
+        return;
+    }
 
-    for (const auto& c : s) {
-        switch (c) {
-            // quotation mark (0x22)
-            case '"':
-                {
-                    result[pos + 1] = '"';
-                    pos += 2;
-                    break;
-                }
+    char buf[32];
 
-                // reverse solidus (0x5c)
-            case '\\':
-                {
-                    // nothing to change
-                    pos += 2;
-                    break;
-                }
+#ifdef JSON_ADAPTER_TO_CHARS
+    auto r = std::to_chars(buf, buf + sizeof(buf), in);
+    stream.write(buf, r.ptr - buf);
+#else
+    // Shortest precision which reads back as the same value
+    const int min_prec = std::numeric_limits<F>::digits10;
+    const int max_prec = std::numeric_limits<F>::max_digits10;
+    int n = 0;
 
-                // backspace (0x08)
-            case '\b':
-                {
-                    result[pos + 1] = 'b';
-                    pos += 2;
-                    break;
-                }
+    for (int prec = min_prec; prec <= max_prec; prec++) {
+        n = snprintf(buf, sizeof(buf), "%.*g", prec, static_cast<double>(in));
 
-                // formfeed (0x0c)
-            case '\f':
-                {
-                    result[pos + 1] = 'f';
-                    pos += 2;
-                    break;
-                }
+        if (static_cast<F>(strtod(buf, nullptr)) == in)
+            break;
+    }
 
-                // newline (0x0a)
-            case '\n':
-                {
-                    result[pos + 1] = 'n';
-                    pos += 2;
-                    break;
-                }
+    stream.write(buf, n);
+#endif
+}
 
-                // carriage return (0x0d)
-            case '\r':
-                {
-                    result[pos + 1] = 'r';
-                    pos += 2;
-                    break;
-                }
+void json_adapter::write_double(std::ostream& stream, double in) {
+    json_write_floating(stream, in);
+}
 
-                // horizontal tab (0x09)
-            case '\t':
-                {
-                    result[pos + 1] = 't';
-                    pos += 2;
-                    break;
-                }
+void json_adapter::write_float(std::ostream& stream, float in) {
+    json_write_floating(stream, in);
+}
 
-            default:
-                {
-                    if (c >= 0x00 and c <= 0x1f)
-                    {
-                        // print character c as \uxxxx
-                        sprintf(&result[pos + 1], "u%04x", int(c));
-                        pos += 6;
-                        // overwrite trailing null character
-                        result[pos] = '\\';
-                    }
-                    else
-                    {
-                        // all other characters are added as-is
-                        result[pos++] = c;
-                    }
-                    break;
-                }
+void json_adapter::write_stringable(std::ostream& stream, tracker_element *e) {
+    switch (e->get_type()) {
+        case tracker_type::tracker_string:
+            stream.put('"');
+            write_escaped(stream, static_cast<tracker_element_string *>(e)->get());
+            stream.put('"');
+            return;
+        case tracker_type::tracker_int8:
+            write_int(stream, static_cast<tracker_element_int8 *>(e)->get());
+            return;
+        case tracker_type::tracker_uint8:
+            write_uint(stream, static_cast<tracker_element_uint8 *>(e)->get());
+            return;
+        case tracker_type::tracker_int16:
+            write_int(stream, static_cast<tracker_element_int16 *>(e)->get());
+            return;
+        case tracker_type::tracker_uint16:
+            write_uint(stream, static_cast<tracker_element_uint16 *>(e)->get());
+            return;
+        case tracker_type::tracker_int32:
+            write_int(stream, static_cast<tracker_element_int32 *>(e)->get());
+            return;
+        case tracker_type::tracker_uint32:
+            write_uint(stream, static_cast<tracker_element_uint32 *>(e)->get());
+            return;
+        case tracker_type::tracker_int64:
+            write_int(stream, static_cast<tracker_element_int64 *>(e)->get());
+            return;
+        case tracker_type::tracker_uint64:
+            write_uint(stream, static_cast<tracker_element_uint64 *>(e)->get());
+            return;
+        case tracker_type::tracker_float:
+            write_float(stream, static_cast<tracker_element_float *>(e)->get());
+            return;
+        case tracker_type::tracker_double:
+            write_double(stream, static_cast<tracker_element_double *>(e)->get());
+            return;
+        case tracker_type::tracker_mac_addr: {
+            // Formatted MACs are only hex and colons, and never need escaping
+            char buf[mac_addr::max_chars];
+            auto end = static_cast<tracker_element_mac_addr *>(e)->get().to_chars(buf);
+            stream.put('"');
+            stream.write(buf, end - buf);
+            stream.put('"');
+            return;
         }
+        default:
+            break;
     }
 
-    return result;
+    if (e->needs_quotes())
+        stream.put('"');
+
+    write_escaped(stream, e->as_string());
+
+    if (e->needs_quotes())
+        stream.put('"');
+}
+
+namespace json_adapter {
+namespace {
+
+// How field names are written as object keys; the built-in styles write keys from
+// the field key tables instead of looking up and escaping the name of every field
+enum class key_style {
+    plain, underscored, custom
+};
+
+using name_permuter_t = std::function<std::string (const std::string&)>;
+
+// Object keys of registered fields, written out once as '"name": ' and kept by field id.
+// Fields are never removed or renamed once registered, so the table is append-only and
+// read without locking, like the entry tracker field table.
+class field_key_table {
+public:
+    const std::string *find(uint16_t in_id) const {
+        auto chunk = chunks[in_id / chunk_sz].load(std::memory_order_acquire);
+
+        if (chunk == nullptr)
+            return nullptr;
+
+        return chunk[in_id % chunk_sz].load(std::memory_order_acquire);
+    }
+
+    // Publish a rendered key; if another thread got there first its key is kept
+    const std::string *insert(uint16_t in_id, std::string&& in_key) {
+        auto chunk = chunks[in_id / chunk_sz].load(std::memory_order_acquire);
+
+        if (chunk == nullptr) {
+            auto n_chunk = new std::atomic<const std::string *>[chunk_sz];
+            for (size_t i = 0; i < chunk_sz; i++)
+                n_chunk[i] = nullptr;
+
+            if (chunks[in_id / chunk_sz].compare_exchange_strong(chunk, n_chunk))
+                chunk = n_chunk;
+            else
+                delete[] n_chunk;
+        }
+
+        const std::string *expected = nullptr;
+        auto key = new std::string(std::move(in_key));
+
+        if (!chunk[in_id % chunk_sz].compare_exchange_strong(expected, key)) {
+            delete key;
+            return expected;
+        }
+
+        return key;
+    }
+
+protected:
+    static const size_t chunk_sz = 256;
+    std::atomic<std::atomic<const std::string *> *> chunks[65536 / chunk_sz];
+};
+
+// Never destroyed; serialization may still be running during static destruction
+field_key_table& key_table(key_style in_style) {
+    static auto plain = new field_key_table();
+    static auto underscored = new field_key_table();
+
+    return in_style == key_style::underscored ? *underscored : *plain;
+}
+
+std::string permute_name(const std::string& in_name, key_style in_style,
+        const name_permuter_t *in_permuter) {
+    switch (in_style) {
+        case key_style::underscored:
+            return multi_replace_all(in_name, ".", "_");
+        case key_style::custom:
+            return (*in_permuter)(in_name);
+        default:
+            return in_name;
+    }
+}
+
+const std::string& field_key(uint16_t in_id, key_style in_style) {
+    auto& table = key_table(in_style);
+    auto key = table.find(in_id);
+
+    if (key != nullptr)
+        return *key;
+
+    std::stringstream ss;
+    ss.put('"');
+    write_escaped(ss, 
+            permute_name(Globalreg::globalreg->entrytracker->get_field_name(in_id), in_style, nullptr));
+    ss << "\": ";
+
+    return *table.insert(in_id, ss.str());
+}
+
+void pack_impl(std::ostream &stream, shared_tracker_element e, 
+        const std::shared_ptr<tracker_element_serializer::rename_map>& name_map,
+        bool prettyprint, unsigned int depth, key_style style, const name_permuter_t *permuter);
+
+}
+}
+
+void json_adapter::pack(std::ostream &stream, shared_tracker_element e, 
+        std::shared_ptr<tracker_element_serializer::rename_map> name_map,
+        bool prettyprint, unsigned int depth) {
+    pack_impl(stream, e, name_map, prettyprint, depth, key_style::plain, nullptr);
 }
 
 void json_adapter::pack(std::ostream &stream, shared_tracker_element e, 
         std::shared_ptr<tracker_element_serializer::rename_map> name_map,
         bool prettyprint, unsigned int depth,
         std::function<std::string (const std::string&)> name_permuter) {
+    pack_impl(stream, e, name_map, prettyprint, depth, key_style::custom, &name_permuter);
+}
+
+void json_adapter::pack_underscored(std::ostream &stream, shared_tracker_element e, 
+        std::shared_ptr<tracker_element_serializer::rename_map> name_map) {
+    pack_impl(stream, e, name_map, false, 0, key_style::underscored, nullptr);
+}
+
+namespace json_adapter {
+namespace {
+
+void pack_impl(std::ostream &stream, shared_tracker_element e, 
+        const std::shared_ptr<tracker_element_serializer::rename_map>& name_map,
+        bool prettyprint, unsigned int depth, key_style style, const name_permuter_t *permuter) {
 
     std::string indent;
     std::string ppendl;
@@ -189,8 +419,6 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
 
     bool as_vector, as_key_vector;
 
-    float_numerical_string<double> dblstr;
-
     // If we're serializing an alias, remap as the aliased element
     if (e->get_type() == tracker_type::tracker_alias) {
         e = static_cast<tracker_element_alias *>(e.get())->get();
@@ -201,10 +429,7 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
     }
 
     if (e->is_stringable()) {
-        if (e->needs_quotes())
-            stream << "\"" << sanitize_string(e->as_string()) << "\"";
-        else
-            stream << sanitize_string(e->as_string());
+        write_stringable(stream, e.get());
     } else {
         switch (e->get_type()) {
             case tracker_type::tracker_vector:
@@ -223,7 +448,7 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
                     if (prettyprint)
                         stream << indent;
 
-                    json_adapter::pack(stream, i, name_map, prettyprint, depth + 1, name_permuter);
+                    pack_impl(stream, i, name_map, prettyprint, depth + 1, style, permuter);
                 }
                 stream << ppendl << indent << "]";
                 break;
@@ -240,13 +465,7 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
                     if (prettyprint)
                         stream << indent;
 
-                    if (std::isnan(i) || std::isinf(i))
-                        stream << "0";
-
-                    if (floor(i) == i)
-                        stream << fmt::format("{}", (long long) i);
-                    else
-                        stream << fmt::format("{:f}", i);
+                    write_double(stream, i);
                 }
                 stream << ppendl << indent << "]";
                 break;
@@ -263,7 +482,9 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
                     if (prettyprint)
                         stream << indent;
 
-                    stream << i;
+                    stream.put('"');
+                    write_escaped(stream, i);
+                    stream.put('"');
                 }
                 stream << ppendl << indent << "]";
                 break;
@@ -301,6 +522,18 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
                             }
                         }
 
+                        // Registered fields are written from the key table; renamed,
+                        // missing, and aliased fields carry their own names
+                        if (!named && !prettyprint && style != key_style::custom &&
+                                i.second->get_type() != tracker_type::tracker_placeholder_missing &&
+                                i.second->get_type() != tracker_type::tracker_alias) {
+                            const auto& key = field_key(i.first, style);
+                            stream.write(key.data(), key.length());
+
+                            pack_impl(stream, i.second, name_map, prettyprint, depth + 1, style, permuter);
+                            continue;
+                        }
+
                         if (!named) {
                             if (i.second == NULL) {
                                 tname = Globalreg::globalreg->entrytracker->get_field_name(i.first);
@@ -319,23 +552,27 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
                             }
                         }
 
-                        tname = json_adapter::sanitize_string(name_permuter(tname));
+                        tname = permute_name(tname, style, permuter);
 
                         if (prettyprint) {
-                            stream << indent << "\"description." << tname << "\": ";
+                            stream << indent << "\"description.";
+                            write_escaped(stream, tname);
+                            stream << "\": ";
                             stream << "\"";
                             if (i.second != nullptr) {
-                                stream << sanitize_string(i.second->get_type_as_string());
+                                write_escaped(stream, i.second->get_type_as_string());
                                 stream << ", ";
                             }
-                            stream << sanitize_string(Globalreg::globalreg->entrytracker->get_field_description(i.first));
+                            write_escaped(stream, Globalreg::globalreg->entrytracker->get_field_description(i.first));
                             stream << "\"," << ppendl;
                         }
 
-                        stream << indent << "\"" << tname << "\": ";
+                        stream << indent << "\"";
+                        write_escaped(stream, tname);
+                        stream << "\": ";
                     }
 
-                    json_adapter::pack(stream, i.second, name_map, prettyprint, depth + 1, name_permuter);
+                    pack_impl(stream, i.second, name_map, prettyprint, depth + 1, style, permuter);
 
                 }
 
@@ -372,7 +609,7 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
                     }
 
                     if (!as_key_vector) {
-                        json_adapter::pack(stream, i.second, name_map, prettyprint, depth + 1, name_permuter);
+                        pack_impl(stream, i.second, name_map, prettyprint, depth + 1, style, permuter);
                     }
                 }
 
@@ -409,7 +646,7 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
                     }
 
                     if (!as_key_vector) {
-                        json_adapter::pack(stream, i.second, name_map, prettyprint, depth + 1, name_permuter);
+                        pack_impl(stream, i.second, name_map, prettyprint, depth + 1, style, permuter);
                     }
                 }
 
@@ -446,7 +683,7 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
                     }
 
                     if (!as_key_vector) {
-                        json_adapter::pack(stream, i.second, name_map, prettyprint, depth + 1, name_permuter);
+                        pack_impl(stream, i.second, name_map, prettyprint, depth + 1, style, permuter);
                     }
                 }
 
@@ -475,14 +712,16 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
                     prepend_comma = true;
 
                     if (!as_vector) {
-                        stream << indent << "\"" << json_adapter::sanitize_string(i.first) << "\"";
+                        stream << indent << "\"";
+                        write_escaped(stream, i.first);
+                        stream << "\"";
 
                         if (!as_key_vector)
                             stream << ": ";
                     }
 
                     if (!as_key_vector) {
-                        json_adapter::pack(stream, i.second, name_map, prettyprint, depth + 1, name_permuter);
+                        pack_impl(stream, i.second, name_map, prettyprint, depth + 1, style, permuter);
                     }
                 }
 
@@ -512,22 +751,16 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
 
                     if (!as_vector) {
                         // Double keys are handled as strings in json
-                        if (std::isnan(i.first) || std::isinf(i.first)) {
-                            stream << indent << "\"0\"";
-                        } else if (floor(i.first) == i.first)  {
-                            auto prec = stream.precision(0);
-                            stream << indent << "\"" << std::fixed << i.first << "\"";
-                            stream.precision(prec);
-                        } else {
-                            stream << indent << "\"" << std::fixed << i.first << "\"";
-                        }
+                        stream << indent << "\"";
+                        write_double(stream, i.first);
+                        stream << "\"";
 
                         if (!as_key_vector)
                             stream << ": ";
                     }
 
                     if (!as_key_vector) {
-                        json_adapter::pack(stream, i.second, name_map, prettyprint, depth + 1, name_permuter);
+                        pack_impl(stream, i.second, name_map, prettyprint, depth + 1, style, permuter);
                     }
                 }
 
@@ -570,7 +803,7 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
                     }
 
                     if (!as_key_vector) {
-                        json_adapter::pack(stream, i.second, name_map, prettyprint, depth + 1, name_permuter);
+                        pack_impl(stream, i.second, name_map, prettyprint, depth + 1, style, permuter);
                     }
                 }
 
@@ -598,26 +831,16 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
 
                     if (!as_vector) {
                         // Double keys are handled as strings in json
-                        if (std::isnan(i.first) || std::isinf(i.first)) {
-                            stream << indent << "\"0\"";
-                        } else if (floor(i.first) == i.first)  {
-                            stream << indent << "\"" << (long) i.first << "\"";
-                        } else {
-                            stream << indent << "\"" << std::fixed << i.first << "\"";
-                        }
+                        stream << indent << "\"";
+                        write_double(stream, i.first);
+                        stream << "\"";
 
                         if (!as_key_vector)
                             stream << ": ";
                     }
 
                     if (!as_key_vector) {
-                        if (std::isnan(i.second) || std::isinf(i.second))
-                            stream << "0";
-
-                        if (floor(i.second) == i.second)
-                            stream << fmt::format("{}", (long long) i.second);
-                        else
-                            stream << fmt::format("{:f}", i.second);
+                        write_double(stream, i.second);
                     }
                 }
 
@@ -654,7 +877,7 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
                     }
 
                     if (!as_key_vector) {
-                        json_adapter::pack(stream,i.second, name_map, prettyprint, depth + 1, name_permuter);
+                        pack_impl(stream, i.second, name_map, prettyprint, depth + 1, style, permuter);
                     }
                 }
 
@@ -665,14 +888,17 @@ void json_adapter::pack(std::ostream &stream, shared_tracker_element e,
 
                 break;
             case tracker_type::tracker_pair_double:
-                stream << "[" << 
-                    dblstr.as_string(std::get<0>(static_cast<tracker_element_pair_double *>(e.get())->get()))
-                    << ", " << 
-                    dblstr.as_string(std::get<1>(static_cast<tracker_element_pair_double *>(e.get())->get()))
-                    << "]"; 
+                stream << "[";
+                write_double(stream, std::get<0>(static_cast<tracker_element_pair_double *>(e.get())->get()));
+                stream << ", ";
+                write_double(stream, std::get<1>(static_cast<tracker_element_pair_double *>(e.get())->get()));
+                stream << "]";
+                break;
             default:
                 break;
         }
     }
 }
 
+}
+}
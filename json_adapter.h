@@ -31,16 +31,49 @@
 namespace json_adapter {
 
 // Basic packer with some defaulted options - prettyprint and depth used for
-// recursive indenting and prettifying the output
+// recursive indenting and prettifying the output.  Compact output writes the keys of
+// registered fields from a table filled the first time each field is written, instead
+// of looking up and escaping the field name for every record.
 void pack(std::ostream &stream, shared_tracker_element e,
         std::shared_ptr<tracker_element_serializer::rename_map> name_map = nullptr,
-        bool prettyprint = false, unsigned int depth = 0,
-        std::function<std::string (const std::string&)> name_permuter = 
-            [](const std::string& s) -> std::string { return s; });
+        bool prettyprint = false, unsigned int depth = 0);
+
+// Pack with every field name passed through a permuter; keys are generated for every
+// field, so the built-in styles below should be used where possible
+void pack(std::ostream &stream, shared_tracker_element e,
+        std::shared_ptr<tracker_element_serializer::rename_map> name_map,
+        bool prettyprint, unsigned int depth,
+        std::function<std::string (const std::string&)> name_permuter);
+
+// Compact pack with dots in field names replaced by underscores, for the ELK-style and
+// translated serializers
+void pack_underscored(std::ostream &stream, shared_tracker_element e,
+        std::shared_ptr<tracker_element_serializer::rename_map> name_map = nullptr);
 
 std::string sanitize_string(const std::string& in) noexcept;
 std::size_t sanitize_extra_space(const std::string& in) noexcept;
 
+// Write a string to the stream with JSON escaping, without building an intermediate
+// string; runs which need no escaping are found 16 bytes at a time where SSE2 is
+// available, and written in one piece
+void write_escaped(std::ostream& stream, const char *in, size_t len);
+
+inline void write_escaped(std::ostream& stream, const std::string& in) {
+    write_escaped(stream, in.data(), in.length());
+}
+
+// Numbers are formatted into a stack buffer; integral doubles are written as
+// integers, others as the shortest form which round-trips, and NaN and infinity
+// as 0 since JSON can't represent them
+void write_int(std::ostream& stream, int64_t in);
+void write_uint(std::ostream& stream, uint64_t in);
+void write_double(std::ostream& stream, double in);
+void write_float(std::ostream& stream, float in);
+
+// Write a scalar element; strings are escaped from the element and numbers are
+// formatted directly, other stringable types go through as_string()
+void write_stringable(std::ostream& stream, tracker_element *e);
+
 class serializer : public tracker_element_serializer {
 public:
     serializer() :
@@ -64,10 +97,7 @@ public:
 
     virtual int serialize(shared_tracker_element in_elem, std::ostream &stream,
             std::shared_ptr<rename_map> name_map = nullptr) override {
-        json_adapter::pack(stream, in_elem, name_map, false, 0,
-                           [](const std::string& s) { 
-                               return multi_replace_all(s, ".", "_");
-                           });
+        json_adapter::pack_underscored(stream, in_elem, name_map);
         return 0;
     }
 };
@@ -99,22 +129,33 @@ public:
                 if (i == nullptr)
                     continue;
 
-                json_adapter::pack(stream, i, name_map, false, 0,
-                        [](const std::string& s) { 
-                            return multi_replace_all(s, ".", "_");
-                        });
+                json_adapter::pack_underscored(stream, i, name_map);
                 stream << "\n";
             }
         } else {
-            json_adapter::pack(stream, in_elem, name_map, false, 0,
-                    [](const std::string& s) { 
-                    return multi_replace_all(s, ".", "_");
-                    });
+            json_adapter::pack_underscored(stream, in_elem, name_map);
             stream << "\n";
         }
 
         return 0;
     }
+
+    virtual void stream_vector_start(std::ostream& stream) override { }
+
+    virtual void stream_vector_item(shared_tracker_element in_elem, std::ostream& stream,
+            std::shared_ptr<rename_map> name_map, bool first) override {
+        if (in_elem == nullptr)
+            return;
+
+        serialize(in_elem, stream, name_map);
+    }
+
+    virtual void stream_vector_fragment(const std::string& in_item, std::ostream& stream,
+            bool first) override {
+        stream << in_item;
+    }
+
+    virtual void stream_vector_end(std::ostream& stream) override { }
 };
 
 }
@@ -144,6 +185,20 @@ public:
 
         return 1;
     }
+
+    virtual void stream_vector_start(std::ostream& stream) override { }
+
+    virtual void stream_vector_item(shared_tracker_element in_elem, std::ostream& stream,
+            std::shared_ptr<rename_map> name_map, bool first) override {
+        serialize(in_elem, stream, name_map);
+    }
+
+    virtual void stream_vector_fragment(const std::string& in_item, std::ostream& stream,
+            bool first) override {
+        stream << in_item;
+    }
+
+    virtual void stream_vector_end(std::ostream& stream) override { }
 };
 
 }
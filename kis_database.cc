@@ -68,6 +68,8 @@ bool kis_database::database_open(std::string in_file_path, int in_flags) {
         return false;
     }
 
+    database_configure();
+
     // Do we have a KISMET table?  If not, this is probably a new database.
     bool k_t_exists = false;
 
@@ -78,6 +78,10 @@ public:
     virtual int database_upgrade_db() = 0;
 
 protected:
+    // Called once the database file is open, before any tables are created; subclasses
+    // can apply pragmas which only take effect on a new file, such as the page size
+    virtual void database_configure() { }
+
     virtual bool database_create_master_table();
 
     // Force-set db version, to be called after upgrading the db or
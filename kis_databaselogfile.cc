@@ -19,16 +19,148 @@
 #include "config.h"
 
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "globalregistry.h"
 #include "json_adapter.h"
 #include "kis_databaselogfile.h"
 #include "kis_datasource.h"
+#include "kis_trace.h"
 #include "messagebus.h"
 #include "packetchain.h"
 #include "sqlite3_cpp11.h"
 
+namespace {
+    void hash_mix(uint64_t& h, uint64_t v) {
+        h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    }
+
+    void hash_structure(uint64_t& h, const shared_tracker_element& e);
+
+    // Inflate a packet compressed by compress_packet
+    bool inflate_packet(const std::string& dictionary, const std::string& in, size_t len,
+            std::string& out) {
+        z_stream zs;
+        memset(&zs, 0, sizeof(z_stream));
+
+        if (inflateInit2(&zs, -15) != Z_OK)
+            return false;
+
+        if (dictionary.length() > 0 && 
+                inflateSetDictionary(&zs, reinterpret_cast<const Bytef *>(dictionary.data()),
+                    dictionary.length()) != Z_OK) {
+            inflateEnd(&zs);
+            return false;
+        }
+
+        out.resize(len);
+
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+        zs.avail_in = in.length();
+        zs.next_out = reinterpret_cast<Bytef *>(&out[0]);
+        zs.avail_out = out.length();
+
+        auto r = inflate(&zs, Z_FINISH);
+        inflateEnd(&zs);
+
+        return r == Z_STREAM_END && zs.avail_out == 0;
+    }
+
+    template<typename M>
+    void hash_keyed_map(uint64_t& h, M *m) {
+        hash_mix(h, m->size());
+
+        for (const auto& i : *m) {
+            hash_mix(h, std::hash<typename std::decay<decltype(i.first)>::type>{}(i.first));
+            hash_structure(h, i.second);
+        }
+    }
+
+    // Hash the shape of a device record: the fields present, container sizes and keys,
+    // and the string-like values.  Numeric scalars (times, counters, signal, location) are
+    // skipped, since they change on nearly every packet and are logged as update rows.
+    void hash_structure(uint64_t& h, const shared_tracker_element& e) {
+        if (e == nullptr) {
+            hash_mix(h, 0);
+            return;
+        }
+
+        hash_mix(h, static_cast<uint64_t>(e->get_type()));
+        hash_mix(h, e->get_id());
+
+        switch (e->get_type()) {
+            case tracker_type::tracker_string:
+                hash_mix(h, std::hash<std::string>{}(
+                            static_cast<tracker_element_string *>(e.get())->get()));
+                break;
+            case tracker_type::tracker_byte_array:
+                hash_mix(h, static_cast<tracker_element_byte_array *>(e.get())->length());
+                break;
+            case tracker_type::tracker_mac_addr:
+            case tracker_type::tracker_uuid:
+            case tracker_type::tracker_key:
+            case tracker_type::tracker_ipv4_addr:
+                hash_mix(h, std::hash<std::string>{}(e->as_string()));
+                break;
+            case tracker_type::tracker_vector:
+                {
+                    auto v = static_cast<tracker_element_vector *>(e.get());
+                    hash_mix(h, v->size());
+                    for (const auto& i : *v)
+                        hash_structure(h, i);
+                }
+                break;
+            case tracker_type::tracker_vector_double:
+                hash_mix(h, static_cast<tracker_element_vector_double *>(e.get())->size());
+                break;
+            case tracker_type::tracker_vector_string:
+                for (const auto& i : *static_cast<tracker_element_vector_string *>(e.get()))
+                    hash_mix(h, std::hash<std::string>{}(i));
+                break;
+            case tracker_type::tracker_map:
+                {
+                    auto m = static_cast<tracker_element_map *>(e.get());
+                    hash_mix(h, m->size());
+                    for (const auto& i : *m)
+                        hash_structure(h, i.second);
+                }
+                break;
+            case tracker_type::tracker_int_map:
+                hash_keyed_map(h, static_cast<tracker_element_int_map *>(e.get()));
+                break;
+            case tracker_type::tracker_mac_map:
+                hash_keyed_map(h, static_cast<tracker_element_mac_map *>(e.get()));
+                break;
+            case tracker_type::tracker_uuid_map:
+                hash_keyed_map(h, static_cast<tracker_element_uuid_map *>(e.get()));
+                break;
+            case tracker_type::tracker_string_map:
+                hash_keyed_map(h, static_cast<tracker_element_string_map *>(e.get()));
+                break;
+            case tracker_type::tracker_double_map:
+                hash_keyed_map(h, static_cast<tracker_element_double_map *>(e.get()));
+                break;
+            case tracker_type::tracker_hashkey_map:
+                hash_keyed_map(h, static_cast<tracker_element_hashkey_map *>(e.get()));
+                break;
+            case tracker_type::tracker_key_map:
+                hash_keyed_map(h, static_cast<tracker_element_device_key_map *>(e.get()));
+                break;
+            case tracker_type::tracker_double_map_double:
+                {
+                    auto m = static_cast<tracker_element_double_map_double *>(e.get());
+                    hash_mix(h, m->size());
+                    for (const auto& i : *m)
+                        hash_mix(h, std::hash<double>{}(i.first));
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
 kis_database_logfile::kis_database_logfile():
     kis_logfile(shared_log_builder(NULL)), 
     kis_database("kismetlog"),
@@ -37,6 +169,8 @@ kis_database_logfile::kis_database_logfile():
     eventbus = Globalreg::fetch_mandatory_global_as<event_bus>();
 
     transaction_mutex.set_name("kis_database_logfile_transaction");
+    device_log_mutex.set_name("kis_database_logfile_device_log");
+    segment_mutex.set_name("kis_database_logfile_segment");
 
     std::shared_ptr<packet_chain> packetchain =
         Globalreg::fetch_mandatory_global_as<packet_chain>("PACKETCHAIN");
@@ -49,6 +183,7 @@ kis_database_logfile::kis_database_logfile():
     pack_comp_datasource = packetchain->register_packet_component("KISDATASRC");
     pack_comp_common = packetchain->register_packet_component("COMMON");
     pack_comp_metablob = packetchain->register_packet_component("METABLOB");
+    pack_comp_decap = packetchain->register_packet_component("DECAP");
 
     last_device_log = 0;
 
@@ -56,6 +191,48 @@ kis_database_logfile::kis_database_logfile():
         Globalreg::fetch_mandatory_global_as<device_tracker>();
 
     db_enabled = false;
+    in_transaction_sync = false;
+
+    write_queue_sz = 0;
+    write_queue_max = 65536;
+    write_policy = write_queue_policy::block;
+    write_queue_dropped = 0;
+    write_queue_spilled = false;
+    commit_count = 10000;
+    commit_interval = 10;
+    writer_shutdown = false;
+
+    wal_mode = false;
+    checkpoint_pending = false;
+    checkpoint_interval = 30;
+    checkpoint_timer = -1;
+    read_db = nullptr;
+
+    device_incremental = true;
+    device_full_interval = 300;
+
+    packet_dedupe = false;
+
+    packet_compression = false;
+    packet_compression_level = Z_DEFAULT_COMPRESSION;
+    packet_zstrm_init = false;
+
+    packet_index = packet_index_mode::none;
+
+    data_compact = false;
+    data_jsonb = false;
+
+    data_batch_mutex.set_name("kis_database_logfile data_batch");
+    data_batch_max = 1024;
+
+    rotate_size = 0;
+    rotate_age = 0;
+    rotate_packets = 0;
+    rotate_timer = -1;
+    rotate_queued = false;
+    segment_packets = 0;
+    segment_start = 0;
+    segment_num = 1;
 
     message_evt_id = 0;
     alert_evt_id = 0;
@@ -82,6 +259,59 @@ bool kis_database_logfile::open_log(std::string in_path) {
     auto timetracker = 
         Globalreg::fetch_mandatory_global_as<time_tracker>("TIMETRACKER");
 
+    // The packet storage layout is decided when the tables are created
+    packet_dedupe =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("kis_log_packet_dedupe", false);
+
+    payload_cache.clear();
+    payload_cache_fifo.clear();
+
+    packet_compression =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("kis_log_packet_compression", false);
+    packet_compression_level =
+        Globalreg::globalreg->kismet_config->fetch_opt_int("kis_log_packet_compression_level", 6);
+
+    if (packet_compression_level < 1 || packet_compression_level > 9)
+        packet_compression_level = Z_DEFAULT_COMPRESSION;
+
+    // The packets view in dedupe mode reassembles packets in sql, which can't inflate them
+    if (packet_compression && packet_dedupe) {
+        _MSG_INFO("Packet deduplication is enabled in the KismetDB log, ignoring "
+                "'kis_log_packet_compression'.");
+        packet_compression = false;
+    }
+
+    reset_packet_compression();
+
+    // The data storage layout is decided when the tables are created too
+    data_compact =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("kis_log_data_compact", false);
+
+    // JSONB arrived in sqlite 3.45; older libraries store the JSON text in the compact
+    // record instead, which the data view renders the same way
+    data_jsonb = sqlite3_libversion_number() >= 3045000;
+
+    data_type_ids.clear();
+
+    {
+        kis_lock_guard<kis_mutex> lk(data_batch_mutex, "open_log");
+        data_batch.reset();
+    }
+
+    auto index_opt = str_lower(
+            Globalreg::globalreg->kismet_config->fetch_opt_dfl("kis_log_packet_index", "none"));
+
+    if (index_opt == "live") {
+        packet_index = packet_index_mode::live;
+    } else if (index_opt == "close") {
+        packet_index = packet_index_mode::close;
+    } else {
+        if (index_opt != "none") 
+            _MSG_ERROR("Unknown 'kis_log_packet_index' option '{}', expected none, close, "
+                    "or live; packet indexes will not be created.", index_opt);
+        packet_index = packet_index_mode::none;
+    }
+
     bool dbr = database_open(in_path, SQLITE_OPEN_FULLMUTEX);
 
     if (!dbr) {
@@ -99,27 +329,109 @@ bool kis_database_logfile::open_log(std::string in_path) {
         return false;
     }
 
-    sqlite3_exec(db, "PRAGMA journal_mode=PERSIST", NULL, NULL, NULL);
-    
-    // Go into transactional mode where we only commit every 10 seconds
+    if (packet_index == packet_index_mode::live)
+        create_packet_indexes();
+
+    {
+        std::lock_guard<kis_shared_mutex> lk(segment_mutex);
+
+        uuid series;
+        series.generate_random_time_uuid();
+
+        segment_series = series.uuid_to_string();
+        segment_base_path = in_path;
+        segment_num = 1;
+        segment_vec.clear();
+        segment_start = time(0);
+        segment_packets = 0;
+        rotate_queued = false;
+
+        if (!write_segment_manifest()) {
+            _MSG_FATAL("Unable to write the segment manifest to KismetDB log {}", in_path);
+            Globalreg::globalreg->fatal_condition = true;
+            return false;
+        }
+    }
+
+    {
+        kis_lock_guard<kis_mutex> lk(summary_mutex, "open_log summary");
+        summary_map.clear();
+        summary_closed.clear();
+        summary_devices.clear();
+    }
+
+    if (!create_summary_table()) {
+        _MSG_FATAL("Unable to create the summary table in KismetDB log {}", in_path);
+        Globalreg::globalreg->fatal_condition = true;
+        return false;
+    }
+
+    // Go into transactional mode; the writer thread group-commits by count and time
     sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL);
 
-    transaction_timer = 
-        timetracker->register_timer(SERVER_TIMESLICES_SEC * 10, NULL, 1,
-            [this](int) -> int {
+    write_queue_max =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<size_t>("kis_log_write_queue_max", 65536);
+    commit_count =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_commit_count", 10000);
+    commit_interval =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_commit_interval", 10);
 
-            // local_locker dblock(&ds_mutex, "kismetdb transaction_timer");
+    if (write_queue_max == 0)
+        write_queue_max = 1;
 
-            in_transaction_sync = true;
+    if (commit_count == 0)
+        commit_count = 1;
 
-            sqlite3_exec(db, "END TRANSACTION", NULL, NULL, NULL);
-            sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+    auto policy = 
+        Globalreg::globalreg->kismet_config->fetch_opt_dfl("kis_log_write_queue_policy", "block");
 
-            in_transaction_sync = false;
+    if (policy == "drop") {
+        write_policy = write_queue_policy::drop;
+    } else if (policy == "spill") {
+        write_policy = write_queue_policy::spill;
+    } else {
+        if (policy != "block")
+            _MSG_ERROR("Couldn't parse 'kis_log_write_queue_policy', expected 'block', 'drop', or "
+                    "'spill', defaulting to 'block'.");
+        write_policy = write_queue_policy::block;
+    }
 
-            return 1;
-        });
+    write_queue_sz = 0;
+    write_queue_dropped = 0;
+    write_queue_spilled = false;
+    writer_shutdown = false;
+
+    // The writer records its own id before it can queue anything, so queue_write always
+    // recognizes it
+    writer_thread = std::thread([this]() {
+        thread_set_process_name("kismetdb writer");
+        writer_thread_id = std::this_thread::get_id();
+        writer_loop();
+    });
+
+    if (wal_mode) {
+        if (sqlite3_open_v2(in_path.c_str(), &read_db, 
+                    SQLITE_OPEN_READONLY | SQLITE_OPEN_FULLMUTEX, NULL) != SQLITE_OK) {
+            _MSG_ERROR("Unable to open a read-only connection to KismetDB log {}, readers "
+                    "will share the writer connection: {}", in_path, sqlite3_errmsg(read_db));
+            sqlite3_close(read_db);
+            read_db = nullptr;
+        }
 
+        checkpoint_interval =
+            Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_checkpoint_interval", 30);
+
+        if (checkpoint_interval != 0) {
+            checkpoint_timer =
+                timetracker->register_timer(SERVER_TIMESLICES_SEC * checkpoint_interval, NULL, 1,
+                        [this](int) -> int {
+                        checkpoint_pending = true;
+                        return 1;
+                        });
+        } else {
+            checkpoint_timer = -1;
+        }
+    }
 
     set_int_log_path(in_path);
 
@@ -131,6 +443,72 @@ bool kis_database_logfile::open_log(std::string in_path) {
         unlink(in_path.c_str());
     }
 
+    rotate_size =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<uint64_t>("kis_log_rotate_size", 0) * 1024 * 1024;
+    rotate_age =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_rotate_age", 0);
+    rotate_packets =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<uint64_t>("kis_log_rotate_packets", 0);
+
+    if (Globalreg::globalreg->kismet_config->fetch_opt_bool("kis_log_ephemeral_dangerous", false) &&
+            (rotate_size != 0 || rotate_age != 0 || rotate_packets != 0)) {
+        _MSG_INFO("KismetDB log is ephemeral, ignoring segment rotation.");
+        rotate_size = 0;
+        rotate_age = 0;
+        rotate_packets = 0;
+    }
+
+    if (rotate_size != 0 || rotate_age != 0 || rotate_packets != 0) {
+        rotate_timer =
+            timetracker->register_timer(SERVER_TIMESLICES_SEC * 10, NULL, 1,
+                    [this](int) -> int {
+                    if (!db_enabled || rotate_queued)
+                        return 1;
+
+                    bool rotate = false;
+
+                    if (rotate_age != 0 && time(0) - segment_start >= (time_t) rotate_age)
+                        rotate = true;
+
+                    if (rotate_packets != 0 && segment_packets >= rotate_packets)
+                        rotate = true;
+
+                    if (!rotate && rotate_size != 0) {
+                        std::shared_lock<kis_shared_mutex> lk(segment_mutex, std::try_to_lock);
+
+                        if (!lk.owns_lock())
+                            return 1;
+
+                        uint64_t sz = 0;
+                        struct stat sb;
+
+                        if (stat(ds_dbfile.c_str(), &sb) == 0)
+                            sz += sb.st_size;
+
+                        if (stat(fmt::format("{}-wal", ds_dbfile).c_str(), &sb) == 0)
+                            sz += sb.st_size;
+
+                        if (sz >= rotate_size)
+                            rotate = true;
+                    }
+
+                    if (!rotate)
+                        return 1;
+
+                    // The rotation runs in order on the writer, so everything queued after
+                    // it lands in the new segment; it can't be dropped by the queue policy
+                    rotate_queued = true;
+                    write_queue_sz++;
+                    write_queue.enqueue([this]() {
+                        rotate_segment();
+                    });
+
+                    return 1;
+                    });
+    } else {
+        rotate_timer = -1;
+    }
+
     packet_timeout =
         Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_packet_timeout", 0);
 
@@ -139,15 +517,30 @@ bool kis_database_logfile::open_log(std::string in_path) {
             timetracker->register_timer(SERVER_TIMESLICES_SEC * 15, NULL, 1,
                     [this](int) -> int {
 
-                    auto pkt_delete = 
-                        fmt::format("DELETE FROM packets WHERE ts_sec < {}",
-                                time(0) - packet_timeout);
+                    std::string pkt_delete;
+
+                    // Duplicates of a payload are all seen within the dedupe window of
+                    // the first observation, so old payloads can be dropped by time
+                    // along with their observations
+                    if (packet_dedupe)
+                        pkt_delete = 
+                            fmt::format("DELETE FROM packet_observations WHERE ts_sec < {0}; "
+                                    "DELETE FROM packet_payloads WHERE ts_sec < {0}",
+                                    time(0) - packet_timeout);
+                    else
+                        pkt_delete = 
+                            fmt::format("DELETE FROM packets WHERE ts_sec < {}",
+                                    time(0) - packet_timeout);
+
                     auto data_delete =
-                        fmt::format("DELETE FROM data WHERE ts_sec < {}",
+                        fmt::format("DELETE FROM {} WHERE ts_sec < {}",
+                                data_compact ? "data_records" : "data",
                                 time(0) - packet_timeout);
 
-                    sqlite3_exec(db, pkt_delete.c_str(), NULL, NULL, NULL);
-                    sqlite3_exec(db, data_delete.c_str(), NULL, NULL, NULL);
+                    queue_write([this, pkt_delete, data_delete]() {
+                        sqlite3_exec(db, pkt_delete.c_str(), NULL, NULL, NULL);
+                        sqlite3_exec(db, data_delete.c_str(), NULL, NULL, NULL);
+                    });
 
                     return 1;
                     });
@@ -158,6 +551,16 @@ bool kis_database_logfile::open_log(std::string in_path) {
     device_timeout =
         Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_device_timeout", 0);
 
+    device_incremental =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("kis_log_device_incremental", true);
+    device_full_interval =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_device_full_interval", 300);
+
+    {
+        kis_lock_guard<kis_mutex> lk(device_log_mutex, "open_log");
+        device_log_map.clear();
+    }
+
     if (device_timeout != 0) {
         device_timeout_timer = 
             timetracker->register_timer(SERVER_TIMESLICES_SEC * 60, NULL, 1,
@@ -166,8 +569,25 @@ bool kis_database_logfile::open_log(std::string in_path) {
                     auto pkt_delete = 
                         fmt::format("DELETE FROM devices WHERE last_time < {}",
                                 time(0) - device_timeout);
+                    auto update_delete = 
+                        fmt::format("DELETE FROM device_updates WHERE ts_sec < {}",
+                                time(0) - device_timeout);
 
-                    sqlite3_exec(db, pkt_delete.c_str(), NULL, NULL, NULL);
+                    queue_write([this, pkt_delete, update_delete]() {
+                        sqlite3_exec(db, pkt_delete.c_str(), NULL, NULL, NULL);
+                        sqlite3_exec(db, update_delete.c_str(), NULL, NULL, NULL);
+                    });
+
+                    {
+                        kis_lock_guard<kis_mutex> lk(device_log_mutex, "device timeout");
+
+                        for (auto i = device_log_map.begin(); i != device_log_map.end(); ) {
+                            if (i->second.last_full < (time_t) (time(0) - device_timeout))
+                                i = device_log_map.erase(i);
+                            else
+                                ++i;
+                        }
+                    }
 
                     return 1;
                     });
@@ -187,7 +607,9 @@ bool kis_database_logfile::open_log(std::string in_path) {
                         fmt::format("DELETE FROM messages WHERE ts_sec < {}",
                                 time(0) - message_timeout);
 
-                    sqlite3_exec(db, pkt_delete.c_str(), NULL, NULL, NULL);
+                    queue_write([this, pkt_delete]() {
+                        sqlite3_exec(db, pkt_delete.c_str(), NULL, NULL, NULL);
+                    });
 
                     return 1;
                     });
@@ -207,7 +629,9 @@ bool kis_database_logfile::open_log(std::string in_path) {
                         fmt::format("DELETE FROM alerts WHERE ts_sec < {}",
                                 time(0) - alert_timeout);
 
-                    sqlite3_exec(db, pkt_delete.c_str(), NULL, NULL, NULL);
+                    queue_write([this, pkt_delete]() {
+                        sqlite3_exec(db, pkt_delete.c_str(), NULL, NULL, NULL);
+                    });
 
                     return 1;
                     });
@@ -227,7 +651,9 @@ bool kis_database_logfile::open_log(std::string in_path) {
                         fmt::format("DELETE FROM snapshots WHERE ts_sec < {}",
                                 time(0) - snapshot_timeout);
 
-                    sqlite3_exec(db, pkt_delete.c_str(), NULL, NULL, NULL);
+                    queue_write([this, pkt_delete]() {
+                        sqlite3_exec(db, pkt_delete.c_str(), NULL, NULL, NULL);
+                    });
 
                     return 1;
                     });
@@ -261,11 +687,17 @@ bool kis_database_logfile::open_log(std::string in_path) {
                     return list_poi_endp_handler(con);
                 }));
 
+    httpd->register_route("/logging/kismetdb/summary", {"GET"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return summary_endp_handler(con);
+                }));
+
     httpd->register_route("/logging/kismetdb/pcap/:title", {"GET", "POST"}, httpd->RO_ROLE, {"pcapng"},
             std::make_shared<kis_net_web_function_endpoint>(
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
                     return pcapng_endp_handler(con);
-                }));
+                }, nullptr, nullptr, true));
 
     device_mac_filter = 
         std::make_shared<class_filter_mac_addr>("kismetdb_devices", 
@@ -362,6 +794,21 @@ bool kis_database_logfile::open_log(std::string in_path) {
         packet_mac_filter->set_filter(m, filter_toks[0], filter_toks[1], filter_opt);
     }
 
+    packet_expr_filter =
+        std::make_shared<packet_filter_expression>("kismetdb_packets_expression",
+                "Kismetdb packet expression filtering");
+
+    auto packet_filter_expr =
+        Globalreg::globalreg->kismet_config->fetch_opt_dfl("kis_log_packet_filter_expression", "");
+
+    if (packet_filter_expr.length()) {
+        try {
+            packet_expr_filter->set_expression(packet_filter_expr);
+        } catch (const std::exception& e) {
+            _MSG_ERROR("Ignoring kis_log_packet_filter_expression: {}", e.what());
+        }
+    }
+
     if (Globalreg::globalreg->kismet_config->fetch_opt_bool("kis_log_messages", true)) {
         message_evt_id = 
             eventbus->register_listener(message_bus::event_message(), 
@@ -407,9 +854,9 @@ bool kis_database_logfile::open_log(std::string in_path) {
 
         auto this_ref = shared_from_this();
         packet_handler_id = 
-            packetchain->register_handler([this, this_ref](std::shared_ptr<kis_packet> packet) -> int {
-                    return log_packet(packet);
-                }, CHAINPOS_LOGGING, -100);
+            packetchain->register_batch_handler([this, this_ref](const packet_chain::packet_batch& batch) -> int {
+                    return log_packets(batch);
+                }, CHAINPOS_LOGGING, -100, "kismetdb log_packets");
     } else {
         packet_handler_id = -1;
         _MSG_INFO("Packets will not be saved to the Kismet database log.");
@@ -429,12 +876,13 @@ void kis_database_logfile::close_log() {
         Globalreg::fetch_global_as<time_tracker>();
 
     if (timetracker != NULL) {
-        timetracker->remove_timer(transaction_timer);
         timetracker->remove_timer(packet_timeout_timer);
         timetracker->remove_timer(alert_timeout_timer);
         timetracker->remove_timer(device_timeout_timer);
         timetracker->remove_timer(message_timeout_timer);
         timetracker->remove_timer(snapshot_timeout_timer);
+        timetracker->remove_timer(checkpoint_timer);
+        timetracker->remove_timer(rotate_timer);
     }
 
     // Kill the eventbus subs
@@ -448,12 +896,47 @@ void kis_database_logfile::close_log() {
     if (packetchain != NULL && packet_handler_id >= 0) 
         packetchain->remove_handler(packet_handler_id, CHAINPOS_LOGGING);
 
+    // Stop the writer, letting it flush anything already queued.  If the writer is the
+    // one closing the log after an error, it exits once we return.
+    writer_shutdown = true;
+
+    {
+        std::lock_guard<std::mutex> lk(write_block_mutex);
+    }
+    write_block_cv.notify_all();
+
+    if (writer_thread.joinable()) {
+        if (writer_thread.get_id() == std::this_thread::get_id())
+            writer_thread.detach();
+        else
+            writer_thread.join();
+    }
+
     set_int_log_open(false);
     db_enabled = false;
 
+    if (packet_zstrm_init) {
+        deflateEnd(&packet_zstrm);
+        packet_zstrm_init = false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(write_block_mutex);
+    }
+    write_block_cv.notify_all();
+
+    // Readers have to be gone before leaving WAL mode
+    if (read_db != nullptr) {
+        sqlite3_close_v2(read_db);
+        read_db = nullptr;
+    }
+
     // End the transaction
     sqlite3_exec(db, "END TRANSACTION", NULL, NULL, NULL);
 
+    if (db != nullptr && packet_index == packet_index_mode::close)
+        create_packet_indexes();
+
     sqlite3_exec(db, "PRAGMA journal_mode=DELETE", NULL, NULL, NULL);
     sqlite3_exec(db, "BEGIN_EXCLUSIVE", NULL, NULL, NULL);
     sqlite3_exec(db, "COMMIT", NULL, NULL, NULL);
@@ -461,6 +944,283 @@ void kis_database_logfile::close_log() {
     database_close();
 }
 
+bool kis_database_logfile::create_packet_indexes() {
+    // Every index ends in the timestamp, so a filtered export comes back in time order 
+    // straight off the index; the packet blob is fetched from the row only for matches
+    auto table = packet_dedupe ? "packet_observations" : "packets";
+
+    const std::vector<std::pair<std::string, std::string>> indexes{
+        {"packets_ts", "ts_sec, ts_usec"},
+        {"packets_sourcemac", "sourcemac, ts_sec, ts_usec"},
+        {"packets_destmac", "destmac, ts_sec, ts_usec"},
+        {"packets_transmac", "transmac, ts_sec, ts_usec"},
+        {"packets_devkey", "devkey, ts_sec, ts_usec"},
+        {"packets_datasource", "datasource, ts_sec, ts_usec"},
+    };
+
+    for (const auto& i : indexes) {
+        auto sql = fmt::format("CREATE INDEX IF NOT EXISTS {} ON {} ({})", 
+                i.first, table, i.second);
+
+        if (sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL) != SQLITE_OK) {
+            _MSG_ERROR("Kismet log was unable to create packet index {} in {}: {}",
+                    i.first, ds_dbfile, sqlite3_errmsg(db));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string kis_database_logfile::segment_path(unsigned int n) {
+    if (n <= 1)
+        return segment_base_path;
+
+    // Keep the extension so the segments are still recognizable kismetdb logs
+    auto slash = segment_base_path.find_last_of('/');
+    auto dot = segment_base_path.find_last_of('.');
+
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return fmt::format("{}-seg{:04}", segment_base_path, n);
+
+    return fmt::format("{}-seg{:04}{}", segment_base_path.substr(0, dot), n, 
+            segment_base_path.substr(dot));
+}
+
+bool kis_database_logfile::write_segment_manifest() {
+    auto r = sqlite3_exec(db, 
+            "CREATE TABLE IF NOT EXISTS segments ("
+            "series TEXT, " // Series uuid shared by all segments of a log
+            "segment INT, " // Segment number, starting at 1
+            "path TEXT, " // Segment file name, relative to the segment directory
+            "first_time INT, "
+            "last_time INT" // 0 while the segment is open
+            ")", NULL, NULL, NULL);
+
+    if (r != SQLITE_OK) {
+        _MSG_ERROR("Kismet log was unable to create segments table in {}: {}", 
+                ds_dbfile, sqlite3_errmsg(db));
+        return false;
+    }
+
+    auto basename = [](const std::string& path) -> std::string {
+        auto slash = path.find_last_of('/');
+        if (slash == std::string::npos)
+            return path;
+        return path.substr(slash + 1);
+    };
+
+    std::vector<segment_record> records = segment_vec;
+    records.push_back(segment_record{segment_num, basename(ds_dbfile), segment_start, 0});
+
+    for (const auto& rec : records) {
+        sqlite3_stmt *seg_stmt;
+        const char *seg_pz;
+
+        std::string sql = 
+            "INSERT INTO segments (series, segment, path, first_time, last_time) "
+            "VALUES (?, ?, ?, ?, ?)";
+
+        if (sqlite3_prepare(db, sql.c_str(), sql.length(), &seg_stmt, &seg_pz) != SQLITE_OK) {
+            _MSG_ERROR("Kismet log was unable to prepare segment insert in {}: {}", 
+                    ds_dbfile, sqlite3_errmsg(db));
+            return false;
+        }
+
+        sqlite3_bind_text(seg_stmt, 1, segment_series.c_str(), segment_series.length(), 
+                SQLITE_TRANSIENT);
+        sqlite3_bind_int(seg_stmt, 2, rec.segment);
+        sqlite3_bind_text(seg_stmt, 3, rec.path.c_str(), rec.path.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_int64(seg_stmt, 4, rec.first_time);
+        sqlite3_bind_int64(seg_stmt, 5, rec.last_time);
+
+        r = sqlite3_step(seg_stmt);
+        sqlite3_finalize(seg_stmt);
+
+        if (r != SQLITE_DONE) {
+            _MSG_ERROR("Kismet log was unable to insert segment record in {}: {}", 
+                    ds_dbfile, sqlite3_errmsg(db));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void kis_database_logfile::rotate_segment() {
+    if (!db_enabled) {
+        rotate_queued = false;
+        return;
+    }
+
+    // A reader streaming from the current segment holds the segment shared; don't stall the
+    // writer behind it, the next check will try again
+    std::unique_lock<kis_shared_mutex> lk(segment_mutex, std::defer_lock);
+
+    if (!lk.try_lock_for(std::chrono::seconds(1))) {
+        rotate_queued = false;
+        return;
+    }
+
+    auto now = time(0);
+    auto prev_path = ds_dbfile;
+    auto next_path = segment_path(segment_num + 1);
+
+    sqlite3_exec(db, fmt::format("UPDATE segments SET last_time = {} WHERE segment = {}", 
+                now, segment_num).c_str(), NULL, NULL, NULL);
+
+    write_summary();
+
+    in_transaction_sync = true;
+    sqlite3_exec(db, "END TRANSACTION", NULL, NULL, NULL);
+    in_transaction_sync = false;
+
+    if (packet_index == packet_index_mode::close)
+        create_packet_indexes();
+
+    if (read_db != nullptr) {
+        sqlite3_close_v2(read_db);
+        read_db = nullptr;
+    }
+
+    sqlite3_exec(db, "PRAGMA journal_mode=DELETE", NULL, NULL, NULL);
+
+    database_close();
+
+    auto slash = prev_path.find_last_of('/');
+    segment_vec.push_back(segment_record{segment_num, 
+            slash == std::string::npos ? prev_path : prev_path.substr(slash + 1),
+            segment_start, now});
+
+    segment_num++;
+    segment_start = now;
+    segment_packets = 0;
+
+    {
+        kis_lock_guard<kis_mutex> slk(summary_mutex, "rotate_segment summary");
+
+        for (const auto& si : summary_map)
+            summary_merge(summary_closed[si.first], si.second);
+
+        summary_map.clear();
+        summary_devices.clear();
+    }
+
+    if (!database_open(next_path, SQLITE_OPEN_FULLMUTEX) || database_upgrade_db() <= 0 ||
+            !write_segment_manifest() || !create_summary_table()) {
+        _MSG_FATAL("Unable to open KismetDB log segment '{}'; check that the disk is not full.",
+                next_path);
+        Globalreg::globalreg->fatal_condition = true;
+        db_enabled = false;
+        rotate_queued = false;
+        return;
+    }
+
+    if (packet_index == packet_index_mode::live)
+        create_packet_indexes();
+
+    sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+
+    if (wal_mode) {
+        if (sqlite3_open_v2(next_path.c_str(), &read_db, 
+                    SQLITE_OPEN_READONLY | SQLITE_OPEN_FULLMUTEX, NULL) != SQLITE_OK) {
+            sqlite3_close(read_db);
+            read_db = nullptr;
+        }
+    }
+
+    set_int_log_path(next_path);
+
+    // Full device records and payloads have to be written again into the new segment
+    {
+        kis_lock_guard<kis_mutex> dlk(device_log_mutex, "rotate_segment");
+        device_log_map.clear();
+    }
+
+    payload_cache.clear();
+    payload_cache_fifo.clear();
+
+    reset_packet_compression();
+
+    data_type_ids.clear();
+
+    rotate_queued = false;
+
+    _MSG_INFO("Continuing kismetdb log in segment {} '{}'", segment_num, next_path);
+}
+
+void kis_database_logfile::database_configure() {
+    auto cfg = Globalreg::globalreg->kismet_config;
+
+    if (db == nullptr)
+        return;
+
+    // Page size has to be set before the first table is created; it's ignored on an
+    // existing log
+    auto page_size = cfg->fetch_opt_uint("kis_log_page_size", 0);
+    if (page_size != 0) {
+        if (page_size < 512 || page_size > 65536 || (page_size & (page_size - 1)) != 0) 
+            _MSG_ERROR("Invalid 'kis_log_page_size' {}, expected a power of 2 between 512 and "
+                    "65536, using the sqlite default.", page_size);
+        else
+            sqlite3_exec(db, fmt::format("PRAGMA page_size={}", page_size).c_str(), 
+                    NULL, NULL, NULL);
+    }
+
+    auto journal_mode = str_lower(cfg->fetch_opt_dfl("kis_log_journal_mode", "persist"));
+
+    if (journal_mode != "persist" && journal_mode != "wal" && journal_mode != "delete" &&
+            journal_mode != "truncate") {
+        _MSG_ERROR("Couldn't parse 'kis_log_journal_mode', expected 'persist', 'wal', "
+                "'delete', or 'truncate', defaulting to 'persist'.");
+        journal_mode = "persist";
+    }
+
+    // Ephemeral logs are unlinked as soon as they're opened, which would orphan the WAL
+    if (journal_mode == "wal" && cfg->fetch_opt_bool("kis_log_ephemeral_dangerous", false)) {
+        _MSG_INFO("KismetDB log is ephemeral, ignoring 'kis_log_journal_mode=wal'.");
+        journal_mode = "persist";
+    }
+
+    // The journal_mode pragma returns the mode actually in effect, which won't be WAL if 
+    // the filesystem can't support it
+    std::string effective_mode;
+    sqlite3_exec(db, fmt::format("PRAGMA journal_mode={}", journal_mode).c_str(),
+            [](void *aux, int argc, char **argv, char **) -> int {
+                if (argc > 0 && argv[0] != nullptr)
+                    *static_cast<std::string *>(aux) = argv[0];
+                return 0;
+            }, &effective_mode, NULL);
+
+    wal_mode = (str_lower(effective_mode) == "wal");
+
+    if (journal_mode == "wal" && !wal_mode)
+        _MSG_ERROR("Unable to put KismetDB log into WAL mode, using '{}' instead.", 
+                effective_mode);
+
+    auto synchronous = str_lower(cfg->fetch_opt("kis_log_synchronous"));
+    if (synchronous.length()) {
+        if (synchronous != "off" && synchronous != "normal" && synchronous != "full" &&
+                synchronous != "extra")
+            _MSG_ERROR("Couldn't parse 'kis_log_synchronous', expected 'off', 'normal', "
+                    "'full', or 'extra', using the sqlite default.");
+        else
+            sqlite3_exec(db, fmt::format("PRAGMA synchronous={}", synchronous).c_str(),
+                    NULL, NULL, NULL);
+    }
+
+    // Positive cache sizes are pages, negative sizes are KiB, matching sqlite
+    auto cache_size = cfg->fetch_opt("kis_log_cache_size");
+    if (cache_size.length())
+        sqlite3_exec(db, fmt::format("PRAGMA cache_size={}", 
+                    cfg->fetch_opt_int("kis_log_cache_size", -2000)).c_str(), NULL, NULL, NULL);
+
+    auto mmap_size = cfg->fetch_opt_as<uint64_t>("kis_log_mmap_size", 0);
+    if (mmap_size != 0)
+        sqlite3_exec(db, fmt::format("PRAGMA mmap_size={}", mmap_size).c_str(), 
+                NULL, NULL, NULL);
+}
+
 int kis_database_logfile::database_upgrade_db() {
     // kis_lock_guard<kis_mutex> lk(ds_mutex, "kismetdb upgrade_db");
 
@@ -510,87 +1270,245 @@ int kis_database_logfile::database_upgrade_db() {
         return -1;
     }
 
-    sql =
-        "CREATE TABLE packets ("
-
-        "ts_sec INT, " // Timestamps
-        "ts_usec INT, "
+    if (!packet_dedupe) {
+        sql =
+            "CREATE TABLE packets ("
 
-        "phyname TEXT, " // Packet phy
+            "ts_sec INT, " // Timestamps
+            "ts_usec INT, "
 
-        "sourcemac TEXT, " // Source, dest, and network addresses
-        "destmac TEXT, "
-        "transmac TEXT, "
+            "phyname TEXT, " // Packet phy
 
-        "frequency REAL, " // Freq in khz
+            "sourcemac TEXT, " // Source, dest, and network addresses
+            "destmac TEXT, "
+            "transmac TEXT, "
 
-        "devkey TEXT, " // Device key
+            "frequency REAL, " // Freq in khz
 
-        "lat REAL, " // location
-        "lon REAL, "
-        "alt REAL, "
-        "speed REAL, "
-        "heading REAL, "
+            "devkey TEXT, " // Device key
 
-        "packet_len INT, " // Packet length
+            "lat REAL, " // location
+            "lon REAL, "
+            "alt REAL, "
+            "speed REAL, "
+            "heading REAL, "
 
-        "signal INT, " // Signal level
+            "packet_len INT, " // Packet length
 
-        "datasource TEXT, " // UUID of data source
+            "signal INT, " // Signal level
 
-        "dlt INT, " // pcap data - datalinktype and packet bin
-        "packet BLOB, "
+            "datasource TEXT, " // UUID of data source
 
-        "error INT, " // Packet was flagged as invalid
+            "dlt INT, " // pcap data - datalinktype and packet bin
+            "packet BLOB, "
 
-        "tags TEXT, "  // Arbitrary packet tags
+            "error INT, " // Packet was flagged as invalid
 
-        "datarate REAL, " // datarate, if known
+            "tags TEXT, "  // Arbitrary packet tags
 
-        "hash INT, " // crc32 hash
-        "packetid INT " // packet id (shared with duplicate packets)
-        ")";
+            "datarate REAL, " // datarate, if known
 
-    r = sqlite3_exec(db, sql.c_str(),
-            [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
+            "hash INT, " // crc32 hash
+            "packetid INT, " // packet id (shared with duplicate packets)
 
-    if (r != SQLITE_OK) {
-        _MSG("Kismet log was unable to create packet table in " + ds_dbfile + ": " +
-                std::string(sErrMsg), MSGFLAG_ERROR);
-        close_log();
-        return -1;
-    }
+            "compression INT " // packet_dictionaries id, or 0 for a raw packet
+            ")";
 
-    sql =
-        "CREATE TABLE data ("
+        r = sqlite3_exec(db, sql.c_str(),
+                [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
 
-        "ts_sec INT, " // Timestamps
-        "ts_usec INT, "
+        if (r != SQLITE_OK) {
+            _MSG("Kismet log was unable to create packet table in " + ds_dbfile + ": " +
+                    std::string(sErrMsg), MSGFLAG_ERROR);
+            close_log();
+            return -1;
+        }
+    } else {
+        // Unique payloads, stored once no matter how many datasources saw them
+        sql =
+            "CREATE TABLE packet_payloads ("
+            "id INTEGER PRIMARY KEY, "
+            "ts_sec INT, " // First seen
+            "hash INT, " // crc32 hash of the payload
+            "packet BLOB "
+            ")";
 
-        "phyname TEXT, " // Packet name and phy
-        "devmac TEXT, "
+        r = sqlite3_exec(db, sql.c_str(),
+                [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
 
-        "lat REAL, " // Location
-        "lon REAL, "
-        "alt REAL, "
-        "speed REAL, "
-        "heading REAL, "
+        if (r != SQLITE_OK) {
+            _MSG("Kismet log was unable to create packet payload table in " + ds_dbfile + ": " +
+                    std::string(sErrMsg), MSGFLAG_ERROR);
+            close_log();
+            return -1;
+        }
 
-        "datasource TEXT, " // UUID of data source
+        // Per-datasource observations; the link headers (radiotap, etc) around the payload
+        // differ between sources, so they're kept with the observation
+        sql =
+            "CREATE TABLE packet_observations ("
+            "ts_sec INT, "
+            "ts_usec INT, "
+            "phyname TEXT, "
+            "sourcemac TEXT, "
+            "destmac TEXT, "
+            "transmac TEXT, "
+            "frequency REAL, "
+            "devkey TEXT, "
+            "lat REAL, "
+            "lon REAL, "
+            "alt REAL, "
+            "speed REAL, "
+            "heading REAL, "
+            "packet_len INT, "
+            "signal INT, "
+            "datasource TEXT, "
+            "dlt INT, "
+            "payload_id INT, " // Row in packet_payloads
+            "packet_prefix BLOB, " // Link bytes before and after the payload
+            "packet_suffix BLOB, "
+            "error INT, "
+            "tags TEXT, "
+            "datarate REAL, "
+            "hash INT, "
+            "packetid INT "
+            ")";
+
+        r = sqlite3_exec(db, sql.c_str(),
+                [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
 
-        "type TEXT, " // Type of arbitrary record
+        if (r != SQLITE_OK) {
+            _MSG("Kismet log was unable to create packet observation table in " + ds_dbfile + ": " +
+                    std::string(sErrMsg), MSGFLAG_ERROR);
+            close_log();
+            return -1;
+        }
 
-        "json BLOB " // Arbitrary JSON record
-        ")";
+        // Reassemble the original packets table for readers
+        sql =
+            "CREATE VIEW packets AS SELECT "
+            "o.ts_sec AS ts_sec, o.ts_usec AS ts_usec, o.phyname AS phyname, "
+            "o.sourcemac AS sourcemac, o.destmac AS destmac, o.transmac AS transmac, "
+            "o.frequency AS frequency, o.devkey AS devkey, "
+            "o.lat AS lat, o.lon AS lon, o.alt AS alt, o.speed AS speed, o.heading AS heading, "
+            "o.packet_len AS packet_len, o.signal AS signal, o.datasource AS datasource, "
+            "o.dlt AS dlt, "
+            "CAST(o.packet_prefix || p.packet || o.packet_suffix AS BLOB) AS packet, "
+            "o.error AS error, o.tags AS tags, o.datarate AS datarate, "
+            "o.hash AS hash, o.packetid AS packetid "
+            "FROM packet_observations o JOIN packet_payloads p ON o.payload_id = p.id";
+
+        r = sqlite3_exec(db, sql.c_str(),
+                [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
 
-    r = sqlite3_exec(db, sql.c_str(),
-            [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
+        if (r != SQLITE_OK) {
+            _MSG("Kismet log was unable to create packet view in " + ds_dbfile + ": " +
+                    std::string(sErrMsg), MSGFLAG_ERROR);
+            close_log();
+            return -1;
+        }
+    }
 
-    if (r != SQLITE_OK) {
-        _MSG("Kismet log was unable to create data table in " + ds_dbfile + ": " +
-                std::string(sErrMsg), MSGFLAG_ERROR);
-        close_log();
-        return -1;
+    if (!data_compact) {
+        sql =
+            "CREATE TABLE data ("
+
+            "ts_sec INT, " // Timestamps
+            "ts_usec INT, "
+
+            "phyname TEXT, " // Packet name and phy
+            "devmac TEXT, "
+
+            "lat REAL, " // Location
+            "lon REAL, "
+            "alt REAL, "
+            "speed REAL, "
+            "heading REAL, "
+
+            "datasource TEXT, " // UUID of data source
+
+            "type TEXT, " // Type of arbitrary record
+
+            "json BLOB " // Arbitrary JSON record
+            ")";
+
+        r = sqlite3_exec(db, sql.c_str(),
+                [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
+
+        if (r != SQLITE_OK) {
+            _MSG("Kismet log was unable to create data table in " + ds_dbfile + ": " +
+                    std::string(sErrMsg), MSGFLAG_ERROR);
+            close_log();
+            return -1;
+        }
+    } else {
+        // Phy, datasource, and type combinations, shared by all their records
+        sql =
+            "CREATE TABLE data_types ("
+            "id INTEGER PRIMARY KEY, "
+            "phyname TEXT, "
+            "datasource TEXT, "
+            "type TEXT "
+            ")";
+
+        r = sqlite3_exec(db, sql.c_str(),
+                [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
+
+        if (r != SQLITE_OK) {
+            _MSG("Kismet log was unable to create data type table in " + ds_dbfile + ": " +
+                    std::string(sErrMsg), MSGFLAG_ERROR);
+            close_log();
+            return -1;
+        }
+
+        // Location is null when there was no GPS, and the device mac is the 48 bits
+        // of the address as an integer
+        sql =
+            "CREATE TABLE data_records ("
+            "ts_sec INT, "
+            "ts_usec INT, "
+            "type_id INT, " // Row in data_types
+            "devmac INT, "
+            "lat REAL, "
+            "lon REAL, "
+            "alt REAL, "
+            "speed REAL, "
+            "heading REAL, "
+            "record BLOB " // JSONB, or the original text if it isn't valid JSON or sqlite is too old
+            ")";
+
+        r = sqlite3_exec(db, sql.c_str(),
+                [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
+
+        if (r != SQLITE_OK) {
+            _MSG("Kismet log was unable to create data record table in " + ds_dbfile + ": " +
+                    std::string(sErrMsg), MSGFLAG_ERROR);
+            close_log();
+            return -1;
+        }
+
+        // Render the original data table for readers
+        sql =
+            "CREATE VIEW data AS SELECT "
+            "r.ts_sec AS ts_sec, r.ts_usec AS ts_usec, t.phyname AS phyname, "
+            "printf('%02X:%02X:%02X:%02X:%02X:%02X', (r.devmac >> 40) & 255, "
+            "(r.devmac >> 32) & 255, (r.devmac >> 24) & 255, (r.devmac >> 16) & 255, "
+            "(r.devmac >> 8) & 255, r.devmac & 255) AS devmac, "
+            "IFNULL(r.lat, 0) AS lat, IFNULL(r.lon, 0) AS lon, IFNULL(r.alt, 0) AS alt, "
+            "IFNULL(r.speed, 0) AS speed, IFNULL(r.heading, 0) AS heading, "
+            "t.datasource AS datasource, t.type AS type, "
+            "CASE WHEN typeof(r.record) = 'blob' THEN json(r.record) ELSE r.record END AS json "
+            "FROM data_records r JOIN data_types t ON r.type_id = t.id";
+
+        r = sqlite3_exec(db, sql.c_str(),
+                [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
+
+        if (r != SQLITE_OK) {
+            _MSG("Kismet log was unable to create data view in " + ds_dbfile + ": " +
+                    std::string(sErrMsg), MSGFLAG_ERROR);
+            close_log();
+            return -1;
+        }
     }
 
     sql =
@@ -693,6 +1611,57 @@ int kis_database_logfile::database_upgrade_db() {
         return -1;
     }
 
+    sql =
+        "CREATE TABLE packet_dictionaries ("
+        "id INTEGER PRIMARY KEY, "
+        "dlt INT, " // Link type the dictionary was trained on
+        "dictionary BLOB " // Raw deflate preset dictionary
+        ")";
+
+    r = sqlite3_exec(db, sql.c_str(),
+            [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
+
+    if (r != SQLITE_OK) {
+        _MSG("Kismet log was unable to create packet_dictionaries table in " + ds_dbfile + ": " +
+                std::string(sErrMsg), MSGFLAG_ERROR);
+        close_log();
+        return -1;
+    }
+
+    sql =
+        "CREATE TABLE device_updates ("
+
+        "ts_sec INT, " // Time of the logging cycle
+
+        "devkey TEXT, " // Device key
+
+        "phyname TEXT, " // Phy records
+        "devmac TEXT, "
+
+        "last_time INT, " // Last seen
+
+        "packets INT, " // Packet and data counters
+        "data_packets INT, "
+        "bytes_data INT, "
+
+        "last_signal INT, " // Signal
+        "strongest_signal INT, "
+
+        "avg_lat REAL, " // Average location
+        "avg_lon REAL "
+
+        ")";
+
+    r = sqlite3_exec(db, sql.c_str(),
+            [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
+
+    if (r != SQLITE_OK) {
+        _MSG("Kismet log was unable to create device_updates table in " + ds_dbfile + ": " +
+                std::string(sErrMsg), MSGFLAG_ERROR);
+        close_log();
+        return -1;
+    }
+
     database_set_db_version(KISMETDB_LOG_VERSION);
 
     return 1;
@@ -706,42 +1675,16 @@ void kis_database_logfile::handle_message(std::shared_ptr<tracked_message> msg)
     if (!db_enabled)
         return;
 
-    int r;
-    std::string sql;
-    sqlite3_stmt *msg_stmt;
-    const char *msg_pz;
-
     std::shared_ptr<kis_gps_packinfo> loc;
 
     if (gpstracker != nullptr) 
         loc = gpstracker->get_best_location();
 
-    sql =
-        "INSERT INTO messages "
-        "(ts_sec, "
-        "lat, lon, "
-        "msgtype, message) "
-        "VALUES (?, ?, ?, ?, ?)";
-
-    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &msg_stmt, &msg_pz);
-
-    if (r != SQLITE_OK) {
-        _MSG("kis_database_logfile unable to prepare database insert for messages in " +
-                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-        close_log();
-        return;
-    }
-
-    unsigned int spos = 1;
-
-    sqlite3_bind_int64(msg_stmt, spos++, time(0));
+    double lat = 0, lon = 0;
 
     if (loc != nullptr && loc->fix >= 2) {
-        sqlite3_bind_double(msg_stmt, spos++, loc->lat);
-        sqlite3_bind_double(msg_stmt, spos++, loc->lon);
-    } else {
-        sqlite3_bind_double(msg_stmt, spos++, 0);
-        sqlite3_bind_double(msg_stmt, spos++, 0);
+        lat = loc->lat;
+        lon = loc->lon;
     }
 
     std::string msgtype;
@@ -755,148 +1698,284 @@ void kis_database_logfile::handle_message(std::shared_ptr<tracked_message> msg)
     else if (msg->get_flags() & MSGFLAG_FATAL)
         msgtype = "FATAL";
 
-    sqlite3_bind_text(msg_stmt, spos++, msgtype.c_str(), msgtype.length(), SQLITE_TRANSIENT);
-    sqlite3_bind_text(msg_stmt, spos++, msg->get_message().c_str(), msg->get_message().length(), SQLITE_TRANSIENT);
+    auto ts = time(0);
+    auto message = msg->get_message();
 
-#if 0
-    kis_unique_lock<kis_mutex> dblock(ds_mutex, std::defer_lock, "kismetdb handle_message");
-    db_lock_with_sync_check(dblock, return);
-#endif
+    queue_write([this, ts, lat, lon, msgtype, message]() {
+        int r;
+        std::string sql;
+        sqlite3_stmt *msg_stmt;
+        const char *msg_pz;
 
-    if (sqlite3_step(msg_stmt) != SQLITE_DONE) {
-        close_log();
-        _MSG_ERROR("Unable to insert message into {}: {}", ds_dbfile, sqlite3_errmsg(db));
-    }
+        sql =
+            "INSERT INTO messages "
+            "(ts_sec, "
+            "lat, lon, "
+            "msgtype, message) "
+            "VALUES (?, ?, ?, ?, ?)";
+
+        r = sqlite3_prepare(db, sql.c_str(), sql.length(), &msg_stmt, &msg_pz);
+
+        if (r != SQLITE_OK) {
+            _MSG("kis_database_logfile unable to prepare database insert for messages in " +
+                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+            close_log();
+            return;
+        }
+
+        unsigned int spos = 1;
+
+        sqlite3_bind_int64(msg_stmt, spos++, ts);
+        sqlite3_bind_double(msg_stmt, spos++, lat);
+        sqlite3_bind_double(msg_stmt, spos++, lon);
+        sqlite3_bind_text(msg_stmt, spos++, msgtype.c_str(), msgtype.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(msg_stmt, spos++, message.c_str(), message.length(), SQLITE_TRANSIENT);
+
+        if (sqlite3_step(msg_stmt) != SQLITE_DONE) {
+            close_log();
+            _MSG_ERROR("Unable to insert message into {}: {}", ds_dbfile, sqlite3_errmsg(db));
+        }
 
-    sqlite3_finalize(msg_stmt);
+        sqlite3_finalize(msg_stmt);
+    });
 }
 
 int kis_database_logfile::log_device(std::shared_ptr<kis_tracked_device_base> d) {
     if (!db_enabled)
         return 0;
 
-    std::string sql;
-
-    std::string phystring;
-    std::string macstring;
-    std::string typestring;
-    std::string keystring;
-
     if (d == nullptr)
         return 0;
 
     if (device_mac_filter->filter(d->get_macaddr(), d->get_phyid()))
         return 0;
 
-    phystring = d->get_phyname();
-    macstring = d->get_macaddr().mac_to_string();
-    typestring = d->get_type_string();
-    keystring = d->get_key().as_string();
+    // Everything is read from the device here, since devices are logged from snapshots
+    // which don't change under us; only the insert is handed to the writer
+    auto phystring = d->get_phyname();
+    auto macstring = d->get_macaddr().mac_to_string();
+    auto typestring = d->get_type_string();
+    auto keystring = d->get_key().as_string();
 
-    int spos = 1;
+    auto first_time = d->get_first_time();
+    auto last_time = d->get_last_time();
+    auto max_signal = d->get_signal_data()->get_max_signal();
+    auto datasize = d->get_datasize();
 
-    std::stringstream sstr;
+    // min lat, min lon, max lat, max lon, avg lat, avg lon
+    std::array<double, 6> loc{0, 0, 0, 0, 0, 0};
 
-    // We don't have to lock because we're called by a device worker, which locks
+    if (d->has_location() && (d->get_location()->has_min_loc() &&
+                              d->get_location()->has_max_loc() &&
+                              d->get_location()->has_avg_loc())) {
+        loc = {d->get_location()->get_min_loc()->get_lat(),
+            d->get_location()->get_min_loc()->get_lon(),
+            d->get_location()->get_max_loc()->get_lat(),
+            d->get_location()->get_max_loc()->get_lon(),
+            d->get_location()->get_avg_loc()->get_lat(),
+            d->get_location()->get_avg_loc()->get_lon()};
+    }
+
+    if (device_incremental) {
+        auto ts = time(0);
+        auto packets = d->get_packets();
+        auto data_packets = d->get_data_packets();
+        auto last_signal = d->get_signal_data()->get_last_signal();
+
+        queue_write([this, ts, keystring, phystring, macstring, last_time, packets, 
+                data_packets, datasize, last_signal, max_signal, loc]() {
+            int spos = 1;
+
+            sqlite3_stmt *update_stmt;
+            const char *update_pz;
+
+            std::string sql =
+                "INSERT INTO device_updates "
+                "(ts_sec, devkey, phyname, devmac, last_time, packets, data_packets, "
+                "bytes_data, last_signal, strongest_signal, avg_lat, avg_lon) "
+                "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+
+            if (sqlite3_prepare(db, sql.c_str(), sql.length(), 
+                        &update_stmt, &update_pz) != SQLITE_OK) {
+                _MSG("kis_database_logfile unable to prepare database insert for device updates "
+                        "in " + ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+                close_log();
+                return;
+            }
+
+            sqlite3_bind_int64(update_stmt, spos++, ts);
+            sqlite3_bind_text(update_stmt, spos++, keystring.c_str(), 
+                    keystring.length(), SQLITE_TRANSIENT);
+            sqlite3_bind_text(update_stmt, spos++, phystring.c_str(), 
+                    phystring.length(), SQLITE_TRANSIENT);
+            sqlite3_bind_text(update_stmt, spos++, macstring.c_str(), 
+                    macstring.length(), SQLITE_TRANSIENT);
+            sqlite3_bind_int64(update_stmt, spos++, last_time);
+            sqlite3_bind_int64(update_stmt, spos++, packets);
+            sqlite3_bind_int64(update_stmt, spos++, data_packets);
+            sqlite3_bind_int64(update_stmt, spos++, datasize);
+            sqlite3_bind_int(update_stmt, spos++, last_signal);
+            sqlite3_bind_int(update_stmt, spos++, max_signal);
+            sqlite3_bind_double(update_stmt, spos++, loc[4]);
+            sqlite3_bind_double(update_stmt, spos++, loc[5]);
+
+            if (sqlite3_step(update_stmt) != SQLITE_DONE) {
+                _MSG("kis_database_logfile unable to insert device update in " +
+                        ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+                close_log();
+                return;
+            }
+
+            sqlite3_finalize(update_stmt);
+        });
+
+        // Only rewrite the full record when the structure changed or it's gone stale
+        uint64_t structure_hash = 0;
+        hash_structure(structure_hash, d);
+
+        kis_lock_guard<kis_mutex> lk(device_log_mutex, "log_device");
+
+        auto& state = device_log_map[d->get_key()];
+
+        if (state.last_full != 0 && state.structure_hash == structure_hash &&
+                (device_full_interval == 0 || ts - state.last_full < (time_t) device_full_interval))
+            return 1;
+
+        state.structure_hash = structure_hash;
+        state.last_full = ts;
+    }
+
+    // A json record is written the same on its own and as a streamed item, so devices
+    // logged unchanged, or already fetched whole over the REST API, aren't serialized
+    // again
+    std::string streamstring;
+
+    auto fragment = Globalreg::globalreg->entrytracker->fetch_fragment(
+            Globalreg::globalreg->entrytracker->get_serializer("json"), d, nullptr);
+
+    if (fragment != nullptr) {
+        streamstring = *fragment;
+    } else {
+        std::stringstream sstr;
 
-#if 0
-    {
-        kis_lock_guard<kis_mutex> lg_dl(devicetracker->get_devicelist_mutex(), "database_logfile::log_device");
         int r = Globalreg::globalreg->entrytracker->serialize("json", sstr, d, nullptr);
 
         if (r < 0) {
             _MSG_ERROR("Failure serializing device key {} to the kisdatabaselog", d->get_key());
             return 0;
         }
+
+        streamstring = sstr.str();
     }
-#endif
 
-    int r = Globalreg::globalreg->entrytracker->serialize("json", sstr, d, nullptr);
+    return queue_write([this, first_time, last_time, keystring, phystring, macstring, max_signal,
+            loc, datasize, typestring, streamstring]() {
+        std::string sql;
+        int spos = 1;
+        int r;
 
-    if (r < 0) {
-        _MSG_ERROR("Failure serializing device key {} to the kisdatabaselog", d->get_key());
-        return 0;
-    }
+        sqlite3_stmt *device_stmt;
+        const char *device_pz;
 
-    std::string streamstring = sstr.str();
+        sql =
+            "INSERT INTO devices "
+            "(first_time, last_time, devkey, phyname, devmac, strongest_signal, "
+            "min_lat, min_lon, max_lat, max_lon, "
+            "avg_lat, avg_lon, "
+            "bytes_data, type, device) "
+            "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
 
-    sqlite3_stmt *device_stmt;
-    const char *device_pz;
+        r = sqlite3_prepare(db, sql.c_str(), sql.length(), &device_stmt, &device_pz);
 
-    sql =
-        "INSERT INTO devices "
-        "(first_time, last_time, devkey, phyname, devmac, strongest_signal, "
-        "min_lat, min_lon, max_lat, max_lon, "
-        "avg_lat, avg_lon, "
-        "bytes_data, type, device) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+        if (r != SQLITE_OK) {
+            _MSG("kis_database_logfile unable to prepare database insert for devices in " +
+                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+            close_log();
+            return;
+        }
 
-    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &device_stmt, &device_pz);
+        sqlite3_bind_int64(device_stmt, spos++, first_time);
+        sqlite3_bind_int64(device_stmt, spos++, last_time);
+        sqlite3_bind_text(device_stmt, spos++, keystring.c_str(), 
+                keystring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(device_stmt, spos++, phystring.c_str(), 
+                phystring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(device_stmt, spos++, macstring.c_str(), 
+                macstring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_int(device_stmt, spos++, max_signal);
 
-    if (r != SQLITE_OK) {
-        _MSG("kis_database_logfile unable to prepare database insert for devices in " +
-                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-        close_log();
-        return -1;
-    }
+        for (const auto& l : loc)
+            sqlite3_bind_double(device_stmt, spos++, l);
 
-    sqlite3_bind_int64(device_stmt, spos++, d->get_first_time());
-    sqlite3_bind_int64(device_stmt, spos++, d->get_last_time());
-    sqlite3_bind_text(device_stmt, spos++, keystring.c_str(), 
-            keystring.length(), SQLITE_TRANSIENT);
-    sqlite3_bind_text(device_stmt, spos++, phystring.c_str(), 
-            phystring.length(), SQLITE_TRANSIENT);
-    sqlite3_bind_text(device_stmt, spos++, macstring.c_str(), 
-            macstring.length(), SQLITE_TRANSIENT);
-    sqlite3_bind_int(device_stmt, spos++, d->get_signal_data()->get_max_signal());
+        sqlite3_bind_int64(device_stmt, spos++, datasize);
+        sqlite3_bind_text(device_stmt, spos++, typestring.c_str(), 
+                typestring.length(), SQLITE_TRANSIENT);
 
-    if (d->has_location() && (d->get_location()->has_min_loc() &&
-                              d->get_location()->has_max_loc() &&
-                              d->get_location()->has_avg_loc())) {
-        sqlite3_bind_double(device_stmt, spos++, 
-                            d->get_location()->get_min_loc()->get_lat());
-        sqlite3_bind_double(device_stmt, spos++,
-                            d->get_location()->get_min_loc()->get_lon());
-        sqlite3_bind_double(device_stmt, spos++,
-                            d->get_location()->get_max_loc()->get_lat());
-        sqlite3_bind_double(device_stmt, spos++,
-                            d->get_location()->get_max_loc()->get_lon());
-        sqlite3_bind_double(device_stmt, spos++,
-                            d->get_location()->get_avg_loc()->get_lat());
-        sqlite3_bind_double(device_stmt, spos++,
-                            d->get_location()->get_avg_loc()->get_lon());
-    } else {
-        // Empty location
-        sqlite3_bind_double(device_stmt, spos++, 0);
-        sqlite3_bind_double(device_stmt, spos++, 0);
-        sqlite3_bind_double(device_stmt, spos++, 0);
-        sqlite3_bind_double(device_stmt, spos++, 0);
-        sqlite3_bind_double(device_stmt, spos++, 0);
-        sqlite3_bind_double(device_stmt, spos++, 0);
-    }
+        sqlite3_bind_blob(device_stmt, spos++, streamstring.c_str(), 
+                streamstring.length(), SQLITE_TRANSIENT);
 
-    sqlite3_bind_int64(device_stmt, spos++, d->get_datasize());
-    sqlite3_bind_text(device_stmt, spos++, typestring.c_str(), 
-            typestring.length(), SQLITE_TRANSIENT);
+        if (sqlite3_step(device_stmt) != SQLITE_DONE) {
+            _MSG("kis_database_logfile unable to insert device in " +
+                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+            close_log();
+            return;
+        }
 
-    sqlite3_bind_blob(device_stmt, spos++, streamstring.c_str(), 
-            streamstring.length(), SQLITE_TRANSIENT);
+        sqlite3_finalize(device_stmt);
 
-#if 0
-    kis_unique_lock<kis_mutex> dblock(ds_mutex, std::defer_lock, "kismetdb log_device");
-    db_lock_with_sync_check(dblock, return);
-#endif
+        // Device rows are replaced as the device is logged again, so only count each
+        // device once per segment
+        bool has_loc = loc[0] != 0 && loc[1] != 0 && loc[2] != 0 && loc[3] != 0;
 
-    if (sqlite3_step(device_stmt) != SQLITE_DONE) {
-        _MSG("kis_database_logfile unable to insert device in " +
-                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-        close_log();
-        return -1;
-    }
+        kis_lock_guard<kis_mutex> lk(summary_mutex, "log_device summary");
 
-    sqlite3_finalize(device_stmt);
+        auto& s = summary_map[log_summary_key{"devices", phystring, "", ""}];
+        auto di = summary_devices.find(phystring + " " + macstring);
 
-    return 1;
+        if (di == summary_devices.end()) {
+            s.count++;
+            if (has_loc)
+                s.with_location++;
+            summary_devices[phystring + " " + macstring] = has_loc;
+        } else if (has_loc && !di->second) {
+            s.with_location++;
+            di->second = true;
+        }
+
+        if (s.first_time == 0 || first_time < s.first_time)
+            s.first_time = first_time;
+        if (last_time > s.last_time)
+            s.last_time = last_time;
+
+        if (has_loc) {
+            if (s.min_lat == 0 || loc[0] < s.min_lat)
+                s.min_lat = loc[0];
+            if (s.min_lon == 0 || loc[1] < s.min_lon)
+                s.min_lon = loc[1];
+            if (s.max_lat == 0 || loc[2] > s.max_lat)
+                s.max_lat = loc[2];
+            if (s.max_lon == 0 || loc[3] > s.max_lon)
+                s.max_lon = loc[3];
+        }
+
+        s.dirty = true;
+    });
+}
+
+bool kis_database_logfile::packet_loggable(const std::shared_ptr<kis_packet>& in_pack) {
+    if (in_pack->duplicate && !log_duplicate_packets)
+        return false;
+
+    if (in_pack->filtered)
+        return false;
+
+    if (packet_mac_filter->filter_packet(in_pack))
+        return false;
+
+    if (packet_expr_filter->filter_packet(in_pack))
+        return false;
+
+    return true;
 }
 
 int kis_database_logfile::log_packet(std::shared_ptr<kis_packet> in_pack) {
@@ -904,27 +1983,57 @@ int kis_database_logfile::log_packet(std::shared_ptr<kis_packet> in_pack) {
         return 0;
     }
 
-    std::string phystring;
-    std::string macstring;
-    std::string deststring;
-    std::string transstring;
-    std::string keystring;
-    std::string sourceuuidstring;
-    double frequency;
-
     if (!log_data_packets)
         return 0;
 
-    if (in_pack->duplicate && !log_duplicate_packets)
+    if (!packet_loggable(in_pack))
         return 0;
 
-    if (in_pack->filtered)
+    // The packet is complete once it reaches the logging stage of the chain, so the
+    // writer can read it directly; the reference keeps it out of the packet pool
+    // until it's been written
+    queue_write([this, in_pack]() {
+        write_packet(in_pack);
+    });
+
+    return 1;
+}
+
+int kis_database_logfile::log_packets(const packet_chain::packet_batch& in_batch) {
+    if (!db_enabled) {
         return 0;
+    }
 
-    if (packet_mac_filter->filter_packet(in_pack)) {
+    if (!log_data_packets)
         return 0;
+
+    auto logged = std::make_shared<packet_chain::packet_batch>();
+    logged->reserve(in_batch.size());
+
+    for (const auto& p : in_batch) {
+        if (packet_loggable(p))
+            logged->push_back(p);
     }
 
+    if (logged->size() == 0)
+        return 0;
+
+    // One queued write per batch instead of per packet; the writer inserts them in
+    // chain order inside its current transaction
+    queue_write([this, logged]() {
+        for (const auto& p : *logged)
+            write_packet(p);
+    });
+
+    return 1;
+}
+
+void kis_database_logfile::write_packet(std::shared_ptr<kis_packet> in_pack) {
+    std::string phystring;
+    std::string keystring;
+    std::string sourceuuidstring;
+    double frequency;
+
     auto chunk = in_pack->fetch<kis_datachunk>(pack_comp_linkframe);
     auto radioinfo = in_pack->fetch<kis_layer1_packinfo>(pack_comp_radiodata);
     auto gpsdata = in_pack->fetch<kis_gps_packinfo>(pack_comp_gps);
@@ -937,16 +2046,22 @@ int kis_database_logfile::log_packet(std::shared_ptr<kis_packet> in_pack) {
     // Packets are no longer a 1:1 with a device
     keystring = "0";
 
+    // MACs are formatted straight into the buffers bound to the insert
+    char macstring[mac_addr::max_chars], deststring[mac_addr::max_chars],
+         transstring[mac_addr::max_chars];
+    size_t maclen, destlen, translen;
+
     if (commoninfo != NULL) {
         phyh = devicetracker->fetch_phy_handler(commoninfo->phyid);
-        macstring = commoninfo->source.mac_to_string();
-        deststring = commoninfo->dest.mac_to_string();
-        transstring = commoninfo->transmitter.mac_to_string();
+        maclen = commoninfo->source.to_chars(macstring) - macstring;
+        destlen = commoninfo->dest.to_chars(deststring) - deststring;
+        translen = commoninfo->transmitter.to_chars(transstring) - transstring;
         frequency = commoninfo->freq_khz;
     } else {
-        macstring = "00:00:00:00:00:00";
-        deststring = "00:00:00:00:00:00";
-        transstring = "00:00:00:00:00:00";
+        mac_addr zero;
+        maclen = zero.to_chars(macstring) - macstring;
+        destlen = zero.to_chars(deststring) - deststring;
+        translen = zero.to_chars(transstring) - transstring;
         frequency = 0;
     }
 
@@ -969,16 +2084,65 @@ int kis_database_logfile::log_packet(std::shared_ptr<kis_packet> in_pack) {
         sqlite3_stmt *packet_stmt;
         const char *packet_pz;
 
-        sql =
-            "INSERT INTO packets "
-            "(ts_sec, ts_usec, phyname, "
-            "sourcemac, destmac, transmac, devkey, frequency, " 
-            "lat, lon, alt, speed, heading, "
-            "packet_len, signal, "
-            "datasource, "
-            "dlt, packet, "
-            "error, tags, datarate, hash, packetid) "
-            "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+        nonstd::string_view prefix, suffix;
+        int64_t payload_id = -1;
+
+        std::string compressed;
+        int64_t compression_id = 0;
+
+        if (packet_compression)
+            compression_id = compress_packet(chunk->dlt, *chunk, compressed);
+
+        if (packet_dedupe) {
+            // Store the decapsulated frame as the shared payload when it lies within the 
+            // link frame, since that's what duplicate detection hashed; otherwise the whole
+            // link frame is the payload and isn't shared
+            auto decap = in_pack->fetch<kis_datachunk>(pack_comp_decap);
+            nonstd::string_view payload = *chunk;
+            bool cacheable = false;
+
+            if (decap == chunk) {
+                cacheable = true;
+            } else if (decap != nullptr && decap->length() > 0 &&
+                    decap->data() >= chunk->data() && 
+                    decap->data() + decap->length() <= chunk->data() + chunk->length()) {
+                auto offt = decap->data() - chunk->data();
+                prefix = chunk->substr(0, offt);
+                suffix = chunk->substr(offt + decap->length());
+                payload = *decap;
+                cacheable = true;
+            } else if (decap == nullptr) {
+                cacheable = true;
+            }
+
+            payload_id = write_payload(in_pack->packet_no, in_pack->hash, payload, 
+                    cacheable && in_pack->hash != 0);
+
+            if (payload_id < 0)
+                return;
+
+            sql =
+                "INSERT INTO packet_observations "
+                "(ts_sec, ts_usec, phyname, "
+                "sourcemac, destmac, transmac, devkey, frequency, " 
+                "lat, lon, alt, speed, heading, "
+                "packet_len, signal, "
+                "datasource, "
+                "dlt, payload_id, packet_prefix, packet_suffix, "
+                "error, tags, datarate, hash, packetid) "
+                "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+        } else {
+            sql =
+                "INSERT INTO packets "
+                "(ts_sec, ts_usec, phyname, "
+                "sourcemac, destmac, transmac, devkey, frequency, " 
+                "lat, lon, alt, speed, heading, "
+                "packet_len, signal, "
+                "datasource, "
+                "dlt, packet, "
+                "error, tags, datarate, hash, packetid, compression) "
+                "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+        }
 
         r = sqlite3_prepare(db, sql.c_str(), sql.length(), &packet_stmt, &packet_pz);
 
@@ -986,7 +2150,7 @@ int kis_database_logfile::log_packet(std::shared_ptr<kis_packet> in_pack) {
             _MSG("kis_database_logfile unable to prepare database insert for packets in " +
                     ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
             close_log();
-            return -1;
+            return;
         }
 
         int sql_pos = 1;
@@ -995,9 +2159,9 @@ int kis_database_logfile::log_packet(std::shared_ptr<kis_packet> in_pack) {
         sqlite3_bind_int64(packet_stmt, sql_pos++, in_pack->ts.tv_usec);
 
         sqlite3_bind_text(packet_stmt, sql_pos++, phystring.c_str(), phystring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(packet_stmt, sql_pos++, macstring.c_str(), macstring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(packet_stmt, sql_pos++, deststring.c_str(), deststring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(packet_stmt, sql_pos++, transstring.c_str(), transstring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(packet_stmt, sql_pos++, macstring, maclen, SQLITE_TRANSIENT);
+        sqlite3_bind_text(packet_stmt, sql_pos++, deststring, destlen, SQLITE_TRANSIENT);
+        sqlite3_bind_text(packet_stmt, sql_pos++, transstring, translen, SQLITE_TRANSIENT);
         sqlite3_bind_text(packet_stmt, sql_pos++, keystring.c_str(), keystring.length(), SQLITE_TRANSIENT);
         sqlite3_bind_double(packet_stmt, sql_pos++, frequency);
 
@@ -1027,7 +2191,23 @@ int kis_database_logfile::log_packet(std::shared_ptr<kis_packet> in_pack) {
                 sourceuuidstring.length(), SQLITE_TRANSIENT);
 
         sqlite3_bind_int(packet_stmt, sql_pos++, chunk->dlt);
-        sqlite3_bind_blob(packet_stmt, sql_pos++, (const char *) chunk->data(), chunk->length(), 0);
+
+        if (packet_dedupe) {
+            sqlite3_bind_int64(packet_stmt, sql_pos++, payload_id);
+
+            // Empty link headers have to be empty blobs rather than null, or the packets
+            // view would concatenate to null
+            for (const auto& b : {prefix, suffix}) {
+                if (b.length() == 0)
+                    sqlite3_bind_zeroblob(packet_stmt, sql_pos++, 0);
+                else
+                    sqlite3_bind_blob(packet_stmt, sql_pos++, b.data(), b.length(), 0);
+            }
+        } else if (compression_id > 0) {
+            sqlite3_bind_blob(packet_stmt, sql_pos++, compressed.data(), compressed.length(), 0);
+        } else {
+            sqlite3_bind_blob(packet_stmt, sql_pos++, (const char *) chunk->data(), chunk->length(), 0);
+        }
 
         sqlite3_bind_int(packet_stmt, sql_pos++, in_pack->error);
 
@@ -1052,19 +2232,35 @@ int kis_database_logfile::log_packet(std::shared_ptr<kis_packet> in_pack) {
         sqlite3_bind_int(packet_stmt, sql_pos++, in_pack->hash);
         sqlite3_bind_int64(packet_stmt, sql_pos++, in_pack->packet_no);
 
-#if 0
-        kis_unique_lock<kis_mutex> dblock(ds_mutex, std::defer_lock, "kismetdb log_packet");
-        db_lock_with_sync_check(dblock, return -1);
-#endif
+        if (!packet_dedupe)
+            sqlite3_bind_int64(packet_stmt, sql_pos++, compression_id);
 
         if (sqlite3_step(packet_stmt) != SQLITE_DONE) {
             _MSG("kis_database_logfile unable to insert packet in " +
                     ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
             close_log();
-            return -1;
+            return;
         }
 
         sqlite3_finalize(packet_stmt);
+
+        segment_packets++;
+
+        double lat = 0, lon = 0;
+
+        if (gpsdata != nullptr) {
+            lat = gpsdata->lat;
+            lon = gpsdata->lon;
+        }
+
+        kis_lock_guard<kis_mutex> lk(summary_mutex, "write_packet summary");
+
+        summary_count(log_summary_key{"packets", phystring, sourceuuidstring, ""}, 
+                in_pack->ts.tv_sec, lat, lon);
+
+        for (const auto& tag : in_pack->tag_map)
+            summary_count(log_summary_key{"packettag", phystring, sourceuuidstring, tag.first},
+                    in_pack->ts.tv_sec, lat, lon);
     }
 
     // If the packet has a metablob record, log that; if the packet ONLY has meta data we should only get a 'data'
@@ -1079,91 +2275,410 @@ int kis_database_logfile::log_packet(std::shared_ptr<kis_packet> in_pack) {
         if (datasrc != nullptr) 
             puuid = datasrc->ref_source->get_source_uuid();
 
-        log_data(gpsdata, in_pack->ts, phystring, smac, puuid,
+        write_data(gpsdata, in_pack->ts, phystring, smac, puuid,
                 metablob->meta_type, metablob->meta_data);
     }
+}
 
-    return 1;
+void kis_database_logfile::reset_packet_compression() {
+    // Dictionaries live in the log file, so every new file trains its own
+    packet_dicts.clear();
+    packet_dict_training.clear();
 }
 
-int kis_database_logfile::log_data(std::shared_ptr<kis_gps_packinfo> gps, struct timeval tv, 
-        std::string phystring, mac_addr devmac, uuid datasource_uuid, 
-        std::string type, std::string json) {
+int64_t kis_database_logfile::compress_packet(int dlt, const nonstd::string_view& data,
+        std::string& out) {
+    auto di = packet_dicts.find(dlt);
 
-    if (!db_enabled)
-        return 0;
+    if (di == packet_dicts.end()) {
+        // Train on the small frames (beacons, probes, adverts, and the like) which compress
+        // well; everything is stored raw until the dictionary is ready
+        auto& training = packet_dict_training[dlt];
 
-    std::string macstring = devmac.mac_to_string();
-    std::string uuidstring = datasource_uuid.uuid_to_string();
+        if (data.length() <= 512)
+            training.samples[std::string(data.data(), data.length())]++;
 
-    int r;
-    std::string sql;
-    sqlite3_stmt *data_stmt;
-    const char *data_pz;
+        if (++training.seen < 1024)
+            return 0;
 
-    sql =
-        "INSERT INTO data "
-        "(ts_sec, ts_usec, "
-        "phyname, devmac, "
-        "lat, lon, alt, speed, heading, "
-        "datasource, "
-        "type, json) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+        // Most common samples go last, closest to the data, where deflate matches them
+        // most cheaply; keep the dictionary small since it's primed for every packet
+        std::vector<std::pair<unsigned int, const std::string *>> ranked;
+        for (const auto& s : training.samples)
+            ranked.push_back(std::make_pair(s.second, &s.first));
 
-    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &data_stmt, &data_pz);
+        std::sort(ranked.begin(), ranked.end(), 
+                [](const std::pair<unsigned int, const std::string *>& a,
+                    const std::pair<unsigned int, const std::string *>& b) {
+                    return a.first > b.first;
+                });
 
-    if (r != SQLITE_OK) {
-        _MSG("kis_database_logfile unable to prepare database insert for data in " +
+        std::vector<const std::string *> picked;
+        size_t dict_sz = 0;
+
+        for (const auto& r : ranked) {
+            if (dict_sz + r.second->length() > 8192)
+                continue;
+            dict_sz += r.second->length();
+            picked.push_back(r.second);
+        }
+
+        std::string dictionary;
+        dictionary.reserve(dict_sz);
+
+        for (auto p = picked.rbegin(); p != picked.rend(); ++p)
+            dictionary.append(**p);
+
+        packet_dict_training.erase(dlt);
+
+        sqlite3_stmt *dict_stmt;
+        const char *dict_pz;
+
+        std::string sql = "INSERT INTO packet_dictionaries (dlt, dictionary) VALUES (?, ?)";
+
+        if (sqlite3_prepare(db, sql.c_str(), sql.length(), &dict_stmt, &dict_pz) != SQLITE_OK) {
+            _MSG_ERROR("kis_database_logfile unable to prepare packet dictionary insert in {}: {}",
+                    ds_dbfile, sqlite3_errmsg(db));
+            packet_dicts[dlt] = std::make_pair(0, std::string());
+            return 0;
+        }
+
+        sqlite3_bind_int(dict_stmt, 1, dlt);
+        sqlite3_bind_blob(dict_stmt, 2, dictionary.data(), dictionary.length(), SQLITE_TRANSIENT);
+
+        auto r = sqlite3_step(dict_stmt);
+        sqlite3_finalize(dict_stmt);
+
+        if (r != SQLITE_DONE) {
+            _MSG_ERROR("kis_database_logfile unable to insert packet dictionary in {}: {}",
+                    ds_dbfile, sqlite3_errmsg(db));
+            packet_dicts[dlt] = std::make_pair(0, std::string());
+            return 0;
+        }
+
+        di = packet_dicts.emplace(dlt, 
+                std::make_pair(sqlite3_last_insert_rowid(db), std::move(dictionary))).first;
+    }
+
+    // A failed dictionary disables compression for this link type
+    if (di->second.first <= 0)
+        return 0;
+
+    if (!packet_zstrm_init) {
+        memset(&packet_zstrm, 0, sizeof(z_stream));
+
+        if (deflateInit2(&packet_zstrm, packet_compression_level, Z_DEFLATED, -15, 8,
+                    Z_DEFAULT_STRATEGY) != Z_OK) 
+            return 0;
+
+        packet_zstrm_init = true;
+    } else {
+        deflateReset(&packet_zstrm);
+    }
+
+    const auto& dictionary = di->second.second;
+
+    if (dictionary.length() > 0)
+        deflateSetDictionary(&packet_zstrm, 
+                reinterpret_cast<const Bytef *>(dictionary.data()), dictionary.length());
+
+    out.resize(deflateBound(&packet_zstrm, data.length()));
+
+    packet_zstrm.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    packet_zstrm.avail_in = data.length();
+    packet_zstrm.next_out = reinterpret_cast<Bytef *>(&out[0]);
+    packet_zstrm.avail_out = out.length();
+
+    if (deflate(&packet_zstrm, Z_FINISH) != Z_STREAM_END)
+        return 0;
+
+    out.resize(out.length() - packet_zstrm.avail_out);
+
+    // Frames which don't shrink (encrypted data, mostly) are stored raw
+    if (out.length() >= data.length())
+        return 0;
+
+    return di->second.first;
+}
+
+int64_t kis_database_logfile::write_payload(uint64_t packet_no, uint32_t hash,
+        const nonstd::string_view& payload, bool cacheable) {
+    // Duplicates arrive shortly after the original, and share its packet number as long 
+    // as the hash matched, so a small recent cache finds nearly all of them without 
+    // reading back from the log
+    if (cacheable) {
+        auto ci = payload_cache.find(packet_no);
+
+        if (ci != payload_cache.end()) {
+            for (const auto& p : ci->second) {
+                if (p.first == payload.length())
+                    return p.second;
+            }
+        }
+    }
+
+    sqlite3_stmt *payload_stmt;
+    const char *payload_pz;
+
+    std::string sql = 
+        "INSERT INTO packet_payloads (ts_sec, hash, packet) VALUES (?, ?, ?)";
+
+    if (sqlite3_prepare(db, sql.c_str(), sql.length(), &payload_stmt, &payload_pz) != SQLITE_OK) {
+        _MSG("kis_database_logfile unable to prepare database insert for packet payloads in " +
+                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+        close_log();
+        return -1;
+    }
+
+    sqlite3_bind_int64(payload_stmt, 1, time(0));
+    sqlite3_bind_int(payload_stmt, 2, hash);
+    sqlite3_bind_blob(payload_stmt, 3, payload.data(), payload.length(), 0);
+
+    if (sqlite3_step(payload_stmt) != SQLITE_DONE) {
+        _MSG("kis_database_logfile unable to insert packet payload in " +
                 ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+        sqlite3_finalize(payload_stmt);
         close_log();
         return -1;
     }
 
-    sqlite3_reset(data_stmt);
-    sqlite3_clear_bindings(data_stmt);
+    sqlite3_finalize(payload_stmt);
 
-    int sql_pos = 1;
+    auto id = sqlite3_last_insert_rowid(db);
 
-    sqlite3_bind_int64(data_stmt, sql_pos++, tv.tv_sec);
-    sqlite3_bind_int64(data_stmt, sql_pos++, tv.tv_usec);
+    if (cacheable) {
+        auto& ce = payload_cache[packet_no];
 
-    sqlite3_bind_text(data_stmt, sql_pos++, phystring.c_str(), phystring.length(), SQLITE_TRANSIENT);
-    sqlite3_bind_text(data_stmt, sql_pos++, macstring.c_str(), macstring.length(), SQLITE_TRANSIENT);
+        if (ce.size() == 0) {
+            payload_cache_fifo.push_back(packet_no);
 
-    if (gps != NULL) {
-        sqlite3_bind_double(data_stmt, sql_pos++, gps->lat);
-        sqlite3_bind_double(data_stmt, sql_pos++, gps->lon);
-        sqlite3_bind_double(data_stmt, sql_pos++, gps->alt);
-        sqlite3_bind_double(data_stmt, sql_pos++, gps->speed);
-        sqlite3_bind_double(data_stmt, sql_pos++, gps->heading);
-    } else {
-        sqlite3_bind_double(data_stmt, sql_pos++, 0);
-        sqlite3_bind_double(data_stmt, sql_pos++, 0);
-        sqlite3_bind_double(data_stmt, sql_pos++, 0);
-        sqlite3_bind_double(data_stmt, sql_pos++, 0);
-        sqlite3_bind_double(data_stmt, sql_pos++, 0);
+            if (payload_cache_fifo.size() > 8192) {
+                payload_cache.erase(payload_cache_fifo.front());
+                payload_cache_fifo.pop_front();
+            }
+        }
+
+        ce.push_back(std::make_pair(payload.length(), id));
     }
 
-    sqlite3_bind_text(data_stmt, sql_pos++, uuidstring.c_str(), uuidstring.length(), SQLITE_TRANSIENT);
+    return id;
+}
 
-    sqlite3_bind_text(data_stmt, sql_pos++, type.data(), type.length(), SQLITE_TRANSIENT);
-    sqlite3_bind_text(data_stmt, sql_pos++, json.data(), json.length(), SQLITE_TRANSIENT);
+int kis_database_logfile::log_data(std::shared_ptr<kis_gps_packinfo> gps, struct timeval tv, 
+        std::string phystring, mac_addr devmac, uuid datasource_uuid, 
+        std::string type, std::string json) {
 
-#if 0
-    kis_unique_lock<kis_mutex> dblock(ds_mutex, std::defer_lock, "kismetdb log_data");
-    db_lock_with_sync_check(dblock, return -1);
-#endif
+    if (!db_enabled)
+        return 0;
+
+    std::shared_ptr<std::vector<data_record>> batch;
+
+    {
+        kis_lock_guard<kis_mutex> lk(data_batch_mutex, "log_data");
+
+        // Join the batch already waiting to be written, if there's room
+        if (data_batch != nullptr && data_batch->size() < data_batch_max) {
+            data_batch->push_back(data_record{gps, tv, phystring, devmac, datasource_uuid,
+                    type, json});
+            return 1;
+        }
+
+        batch = std::make_shared<std::vector<data_record>>();
+        batch->reserve(64);
+        batch->push_back(data_record{gps, tv, phystring, devmac, datasource_uuid, type, json});
+
+        data_batch = batch;
+    }
+
+    // The writer takes the batch lock, so the write is queued outside of it
+    auto r = queue_write([this, batch]() {
+        {
+            kis_lock_guard<kis_mutex> lk(data_batch_mutex, "log_data write");
+
+            if (data_batch == batch)
+                data_batch.reset();
+        }
+
+        write_data_batch(*batch);
+    });
+
+    if (!r) {
+        kis_lock_guard<kis_mutex> lk(data_batch_mutex, "log_data");
+
+        if (data_batch == batch)
+            data_batch.reset();
+    }
+
+    return r;
+}
+
+void kis_database_logfile::write_data(std::shared_ptr<kis_gps_packinfo> gps, struct timeval tv, 
+        const std::string& phystring, mac_addr devmac, uuid datasource_uuid, 
+        const std::string& type, const std::string& json) {
+
+    write_data_batch(std::vector<data_record>{
+            data_record{gps, tv, phystring, devmac, datasource_uuid, type, json}});
+}
+
+int64_t kis_database_logfile::write_data_type(const std::string& phystring, 
+        const std::string& uuidstring, const std::string& type) {
+
+    auto key = phystring + '\0' + uuidstring + '\0' + type;
+
+    auto ti = data_type_ids.find(key);
+    if (ti != data_type_ids.end())
+        return ti->second;
+
+    std::string sql = 
+        "INSERT INTO data_types (phyname, datasource, type) VALUES (?, ?, ?)";
 
-    if (sqlite3_step(data_stmt) != SQLITE_DONE) {
-        _MSG("kis_database_logfile unable to insert data in " +
+    sqlite3_stmt *type_stmt;
+    const char *type_pz;
+
+    if (sqlite3_prepare(db, sql.c_str(), sql.length(), &type_stmt, &type_pz) != SQLITE_OK) {
+        _MSG("kis_database_logfile unable to prepare database insert for data type in " +
                 ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-        close_log();
         return -1;
     }
 
-    sqlite3_finalize(data_stmt);
+    sqlite3_bind_text(type_stmt, 1, phystring.c_str(), phystring.length(), SQLITE_TRANSIENT);
+    sqlite3_bind_text(type_stmt, 2, uuidstring.c_str(), uuidstring.length(), SQLITE_TRANSIENT);
+    sqlite3_bind_text(type_stmt, 3, type.c_str(), type.length(), SQLITE_TRANSIENT);
 
-    return 1;
+    if (sqlite3_step(type_stmt) != SQLITE_DONE) {
+        _MSG("kis_database_logfile unable to insert data type in " +
+                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+        sqlite3_finalize(type_stmt);
+        return -1;
+    }
+
+    sqlite3_finalize(type_stmt);
+
+    auto id = sqlite3_last_insert_rowid(db);
+
+    data_type_ids[key] = id;
+
+    return id;
+}
+
+void kis_database_logfile::write_data_batch(const std::vector<data_record>& in_batch) {
+    if (in_batch.size() == 0)
+        return;
+
+    int r;
+    std::string sql;
+    sqlite3_stmt *data_stmt;
+    const char *data_pz;
+
+    if (data_compact)
+        sql = fmt::format("INSERT INTO data_records "
+            "(ts_sec, ts_usec, "
+            "type_id, devmac, "
+            "lat, lon, alt, speed, heading, "
+            "record) "
+            "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, {})", 
+            data_jsonb ? "CASE WHEN json_valid(?10) THEN jsonb(?10) ELSE ?10 END" : "?");
+    else
+        sql =
+            "INSERT INTO data "
+            "(ts_sec, ts_usec, "
+            "phyname, devmac, "
+            "lat, lon, alt, speed, heading, "
+            "datasource, "
+            "type, json) "
+            "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+
+    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &data_stmt, &data_pz);
+
+    if (r != SQLITE_OK) {
+        _MSG("kis_database_logfile unable to prepare database insert for data in " +
+                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+        close_log();
+        return;
+    }
+
+    // One statement for the whole batch
+    for (const auto& d : in_batch) {
+        std::string uuidstring = d.datasource_uuid.uuid_to_string();
+
+        sqlite3_reset(data_stmt);
+        sqlite3_clear_bindings(data_stmt);
+
+        int sql_pos = 1;
+
+        sqlite3_bind_int64(data_stmt, sql_pos++, d.tv.tv_sec);
+        sqlite3_bind_int64(data_stmt, sql_pos++, d.tv.tv_usec);
+
+        if (data_compact) {
+            auto type_id = write_data_type(d.phystring, uuidstring, d.type);
+
+            if (type_id < 0) {
+                sqlite3_finalize(data_stmt);
+                close_log();
+                return;
+            }
+
+            sqlite3_bind_int64(data_stmt, sql_pos++, type_id);
+            sqlite3_bind_int64(data_stmt, sql_pos++, (int64_t) (d.devmac.longmac >> 16));
+
+            // Unbound location columns are left null
+            if (d.gps != nullptr) {
+                sqlite3_bind_double(data_stmt, sql_pos++, d.gps->lat);
+                sqlite3_bind_double(data_stmt, sql_pos++, d.gps->lon);
+                sqlite3_bind_double(data_stmt, sql_pos++, d.gps->alt);
+                sqlite3_bind_double(data_stmt, sql_pos++, d.gps->speed);
+                sqlite3_bind_double(data_stmt, sql_pos++, d.gps->heading);
+            } else {
+                sql_pos += 5;
+            }
+        } else {
+            char macstring[mac_addr::max_chars];
+            size_t maclen = d.devmac.to_chars(macstring) - macstring;
+
+            sqlite3_bind_text(data_stmt, sql_pos++, d.phystring.c_str(), d.phystring.length(), 
+                    SQLITE_TRANSIENT);
+            sqlite3_bind_text(data_stmt, sql_pos++, macstring, maclen, SQLITE_TRANSIENT);
+
+            if (d.gps != NULL) {
+                sqlite3_bind_double(data_stmt, sql_pos++, d.gps->lat);
+                sqlite3_bind_double(data_stmt, sql_pos++, d.gps->lon);
+                sqlite3_bind_double(data_stmt, sql_pos++, d.gps->alt);
+                sqlite3_bind_double(data_stmt, sql_pos++, d.gps->speed);
+                sqlite3_bind_double(data_stmt, sql_pos++, d.gps->heading);
+            } else {
+                sqlite3_bind_double(data_stmt, sql_pos++, 0);
+                sqlite3_bind_double(data_stmt, sql_pos++, 0);
+                sqlite3_bind_double(data_stmt, sql_pos++, 0);
+                sqlite3_bind_double(data_stmt, sql_pos++, 0);
+                sqlite3_bind_double(data_stmt, sql_pos++, 0);
+            }
+
+            sqlite3_bind_text(data_stmt, sql_pos++, uuidstring.c_str(), uuidstring.length(), 
+                    SQLITE_TRANSIENT);
+
+            sqlite3_bind_text(data_stmt, sql_pos++, d.type.data(), d.type.length(), SQLITE_TRANSIENT);
+        }
+
+        sqlite3_bind_text(data_stmt, sql_pos++, d.json.data(), d.json.length(), SQLITE_TRANSIENT);
+
+        if (sqlite3_step(data_stmt) != SQLITE_DONE) {
+            _MSG("kis_database_logfile unable to insert data in " +
+                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+            sqlite3_finalize(data_stmt);
+            close_log();
+            return;
+        }
+
+        kis_lock_guard<kis_mutex> lk(summary_mutex, "write_data summary");
+
+        if (d.gps != nullptr)
+            summary_count(log_summary_key{"data", d.phystring, uuidstring, ""}, 
+                    d.tv.tv_sec, d.gps->lat, d.gps->lon);
+        else
+            summary_count(log_summary_key{"data", d.phystring, uuidstring, ""}, d.tv.tv_sec, 0, 0);
+    }
+
+    sqlite3_finalize(data_stmt);
 }
 
 int kis_database_logfile::log_datasources(shared_tracker_element in_datasource_vec) {
@@ -1201,51 +2716,46 @@ int kis_database_logfile::log_datasource(shared_tracker_element in_datasource) {
     json_adapter::pack(ss, in_datasource, NULL);
     jsonstring = ss.str();
 
-    int r;
-    std::string sql;
-    sqlite3_stmt *datasource_stmt;
-    const char *datasource_pz;
-
-    sql =
-        "INSERT INTO datasources "
-        "(uuid, "
-        "typestring, definition, "
-        "name, interface, "
-        "json) "
-        "VALUES (?, ?, ?, ?, ?, ?)";
-
-    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &datasource_stmt, &datasource_pz);
+    return queue_write([this, uuidstring, typestring, defstring, namestring, intfstring, jsonstring]() {
+        int r;
+        std::string sql;
+        sqlite3_stmt *datasource_stmt;
+        const char *datasource_pz;
 
-    if (r != SQLITE_OK) {
-        _MSG("kis_database_logfile unable to prepare database insert for datasources in " +
-                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-        close_log();
-        return -1;
-    }
+        sql =
+            "INSERT INTO datasources "
+            "(uuid, "
+            "typestring, definition, "
+            "name, interface, "
+            "json) "
+            "VALUES (?, ?, ?, ?, ?, ?)";
 
-    sqlite3_bind_text(datasource_stmt, 1, uuidstring.data(), uuidstring.length(), SQLITE_TRANSIENT);
-    sqlite3_bind_text(datasource_stmt, 2, typestring.data(), typestring.length(), SQLITE_TRANSIENT);
-    sqlite3_bind_text(datasource_stmt, 3, defstring.data(), defstring.length(), SQLITE_TRANSIENT);
-    sqlite3_bind_text(datasource_stmt, 4, namestring.data(), namestring.length(), SQLITE_TRANSIENT);
-    sqlite3_bind_text(datasource_stmt, 5, intfstring.data(), intfstring.length(), SQLITE_TRANSIENT);
+        r = sqlite3_prepare(db, sql.c_str(), sql.length(), &datasource_stmt, &datasource_pz);
 
-    sqlite3_bind_blob(datasource_stmt, 6, jsonstring.data(), jsonstring.length(), SQLITE_TRANSIENT);
+        if (r != SQLITE_OK) {
+            _MSG("kis_database_logfile unable to prepare database insert for datasources in " +
+                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+            close_log();
+            return;
+        }
 
-#if 0
-    kis_unique_lock<kis_mutex> dblock(ds_mutex, std::defer_lock, "kismetdb log_datasource");
-    db_lock_with_sync_check(dblock, return -1);
-#endif
+        sqlite3_bind_text(datasource_stmt, 1, uuidstring.data(), uuidstring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(datasource_stmt, 2, typestring.data(), typestring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(datasource_stmt, 3, defstring.data(), defstring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(datasource_stmt, 4, namestring.data(), namestring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(datasource_stmt, 5, intfstring.data(), intfstring.length(), SQLITE_TRANSIENT);
 
-    if (sqlite3_step(datasource_stmt) != SQLITE_DONE) {
-        _MSG("kis_database_logfile unable to insert datasource in " +
-                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-        close_log();
-        return -1;
-    }
+        sqlite3_bind_blob(datasource_stmt, 6, jsonstring.data(), jsonstring.length(), SQLITE_TRANSIENT);
 
-    sqlite3_finalize(datasource_stmt);
+        if (sqlite3_step(datasource_stmt) != SQLITE_DONE) {
+            _MSG("kis_database_logfile unable to insert datasource in " +
+                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+            close_log();
+            return;
+        }
 
-    return 1;
+        sqlite3_finalize(datasource_stmt);
+    });
 }
 
 int kis_database_logfile::log_alert(std::shared_ptr<tracked_alert> in_alert) {
@@ -1266,60 +2776,58 @@ int kis_database_logfile::log_alert(std::shared_ptr<tracked_alert> in_alert) {
     double intpart, fractpart;
     fractpart = modf(in_alert->get_timestamp(), &intpart);
 
-    int r;
-    std::string sql;
-    sqlite3_stmt *alert_stmt;
-    const char *alert_pz;
+    double lat = 0, lon = 0;
 
-    sql =
-        "INSERT INTO alerts "
-        "(ts_sec, ts_usec, phyname, devmac, "
-        "lat, lon, "
-        "header, "
-        "json) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
+    if (in_alert->get_location()->get_valid()) {
+        lat = in_alert->get_location()->get_lat();
+        lon = in_alert->get_location()->get_lon();
+    }
 
-    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &alert_stmt, &alert_pz);
+    return queue_write([this, macstring, phystring, headerstring, jsonstring, intpart, fractpart, 
+            lat, lon]() {
+        int r;
+        std::string sql;
+        sqlite3_stmt *alert_stmt;
+        const char *alert_pz;
 
-    if (r != SQLITE_OK) {
-        _MSG("kis_database_logfile unable to prepare database insert for alerts in " +
-                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-        close_log();
-        return -1;
-    }
+        sql =
+            "INSERT INTO alerts "
+            "(ts_sec, ts_usec, phyname, devmac, "
+            "lat, lon, "
+            "header, "
+            "json) "
+            "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
 
-    sqlite3_bind_int64(alert_stmt, 1, intpart);
-    sqlite3_bind_int64(alert_stmt, 2, fractpart * 1000000);
+        r = sqlite3_prepare(db, sql.c_str(), sql.length(), &alert_stmt, &alert_pz);
 
-    sqlite3_bind_text(alert_stmt, 3, phystring.c_str(), phystring.length(), SQLITE_TRANSIENT);
-    sqlite3_bind_text(alert_stmt, 4, macstring.c_str(), macstring.length(), SQLITE_TRANSIENT);
+        if (r != SQLITE_OK) {
+            _MSG("kis_database_logfile unable to prepare database insert for alerts in " +
+                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+            close_log();
+            return;
+        }
 
-    if (in_alert->get_location()->get_valid()) {
-        sqlite3_bind_double(alert_stmt, 5, in_alert->get_location()->get_lat());
-        sqlite3_bind_double(alert_stmt, 6, in_alert->get_location()->get_lon());
-    } else {
-        sqlite3_bind_int(alert_stmt, 5, 0);
-        sqlite3_bind_int(alert_stmt, 6, 0);
-    }
+        sqlite3_bind_int64(alert_stmt, 1, intpart);
+        sqlite3_bind_int64(alert_stmt, 2, fractpart * 1000000);
 
-    sqlite3_bind_text(alert_stmt, 7, headerstring.c_str(), headerstring.length(), SQLITE_TRANSIENT);
-    sqlite3_bind_blob(alert_stmt, 8, jsonstring.data(), jsonstring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(alert_stmt, 3, phystring.c_str(), phystring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(alert_stmt, 4, macstring.c_str(), macstring.length(), SQLITE_TRANSIENT);
 
-#if 0
-    kis_unique_lock<kis_mutex> dblock(ds_mutex, std::defer_lock, "kismetdb log_alert");
-    db_lock_with_sync_check(dblock, return -1);
-#endif
+        sqlite3_bind_double(alert_stmt, 5, lat);
+        sqlite3_bind_double(alert_stmt, 6, lon);
 
-    if (sqlite3_step(alert_stmt) != SQLITE_DONE) {
-        _MSG("kis_database_logfile unable to insert alert in " +
-                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-        close_log();
-        return -1;
-    }
+        sqlite3_bind_text(alert_stmt, 7, headerstring.c_str(), headerstring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_blob(alert_stmt, 8, jsonstring.data(), jsonstring.length(), SQLITE_TRANSIENT);
 
-    sqlite3_finalize(alert_stmt);
+        if (sqlite3_step(alert_stmt) != SQLITE_DONE) {
+            _MSG("kis_database_logfile unable to insert alert in " +
+                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+            close_log();
+            return;
+        }
 
-    return 1;
+        sqlite3_finalize(alert_stmt);
+    });
 }
 
 int kis_database_logfile::log_snapshot(std::shared_ptr<kis_gps_packinfo> gps, struct timeval tv,
@@ -1328,162 +2836,506 @@ int kis_database_logfile::log_snapshot(std::shared_ptr<kis_gps_packinfo> gps, st
     if (!db_enabled)
         return 0;
 
-    int r;
-    std::string sql;
-    sqlite3_stmt *snapshot_stmt;
-    const char *snapshot_pz;
+    double lat = 0, lon = 0;
 
-    std::shared_ptr<kis_gps_packinfo> loc;
+    if (gps != NULL) {
+        lat = gps->lat;
+        lon = gps->lon;
+    } else if (gpstracker != nullptr) {
+        auto loc = gpstracker->get_best_location();
 
-    if (gps == nullptr && gpstracker != nullptr) 
-        loc = gpstracker->get_best_location();
+        if (loc != nullptr && loc->fix >= 2) {
+            lat = loc->lat;
+            lon = loc->lon;
+        }
+    }
 
-    sql =
-        "INSERT INTO snapshots "
-        "(ts_sec, ts_usec, "
-        "lat, lon, "
-        "snaptype, json) "
-        "VALUES (?, ?, ?, ?, ?, ?)";
+    return queue_write([this, tv, lat, lon, snaptype, json]() {
+        int r;
+        std::string sql;
+        sqlite3_stmt *snapshot_stmt;
+        const char *snapshot_pz;
 
-    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &snapshot_stmt, &snapshot_pz);
+        sql =
+            "INSERT INTO snapshots "
+            "(ts_sec, ts_usec, "
+            "lat, lon, "
+            "snaptype, json) "
+            "VALUES (?, ?, ?, ?, ?, ?)";
 
-    if (r != SQLITE_OK) {
-        _MSG("kis_database_logfile unable to prepare database insert for snapshots in " +
-                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-        close_log();
-        return -1;
+        r = sqlite3_prepare(db, sql.c_str(), sql.length(), &snapshot_stmt, &snapshot_pz);
+
+        if (r != SQLITE_OK) {
+            _MSG("kis_database_logfile unable to prepare database insert for snapshots in " +
+                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+            close_log();
+            return;
+        }
+
+        sqlite3_bind_int64(snapshot_stmt, 1, tv.tv_sec);
+        sqlite3_bind_int64(snapshot_stmt, 2, tv.tv_usec);
+
+        sqlite3_bind_double(snapshot_stmt, 3, lat);
+        sqlite3_bind_double(snapshot_stmt, 4, lon);
+
+        sqlite3_bind_text(snapshot_stmt, 5, snaptype.c_str(), snaptype.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(snapshot_stmt, 6, json.data(), json.length(), SQLITE_TRANSIENT);
+
+        if (sqlite3_step(snapshot_stmt) != SQLITE_DONE) {
+            _MSG("kis_database_logfile unable to insert snapshot in " +
+                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+            close_log();
+            return;
+        }
+
+        sqlite3_finalize(snapshot_stmt);
+    });
+}
+
+bool kis_database_logfile::queue_write(db_write_t&& in_write) {
+    if (!db_enabled)
+        return false;
+
+    // The writer can log messages about its own failures; never block it on its own queue
+    bool writer_self = std::this_thread::get_id() == writer_thread_id.load();
+
+    if (write_queue_sz >= write_queue_max && !writer_self) {
+        if (write_policy == write_queue_policy::drop) {
+            if (write_queue_dropped++ == 0)
+                _MSG_ERROR("The kismetdb log write queue is full ({} records); the disk may be too slow "
+                        "to keep up.  Records will be dropped until it drains.", write_queue_max);
+            return false;
+        } else if (write_policy == write_queue_policy::block) {
+            std::unique_lock<std::mutex> lk(write_block_mutex);
+            write_block_cv.wait(lk, [this]() {
+                return write_queue_sz < write_queue_max || !db_enabled || writer_shutdown;
+            });
+
+            if (!db_enabled)
+                return false;
+        } else if (!write_queue_spilled) {
+            write_queue_spilled = true;
+            _MSG_ERROR("The kismetdb log write queue is over its limit ({} records); the disk may be "
+                    "too slow to keep up.  Records will continue to be queued in memory.", write_queue_max);
+        }
     }
 
-    sqlite3_bind_int64(snapshot_stmt, 1, tv.tv_sec);
-    sqlite3_bind_int64(snapshot_stmt, 2, tv.tv_usec);
+    write_queue_sz++;
+    write_queue.enqueue(std::move(in_write));
 
-    if (gps != NULL) {
-        sqlite3_bind_double(snapshot_stmt, 3, gps->lat);
-        sqlite3_bind_double(snapshot_stmt, 4, gps->lon);
+    return true;
+}
+
+void kis_database_logfile::writer_loop() {
+    auto last_commit = std::chrono::steady_clock::now();
+    unsigned int uncommitted = 0;
+
+    std::vector<db_write_t> batch(256);
+
+    while (true) {
+        if (writer_shutdown && (write_queue_sz == 0 || !db_enabled))
+            break;
+
+        auto n = write_queue.wait_dequeue_bulk_timed(batch.begin(), batch.size(), 
+                std::chrono::milliseconds(100));
+
+        for (size_t i = 0; i < n; i++) {
+            if (db_enabled)
+                batch[i]();
+            batch[i] = nullptr;
+        }
+
+        if (n > 0) {
+            write_queue_sz -= n;
+            uncommitted += n;
+
+            if (write_queue_sz < write_queue_max) {
+                write_queue_spilled = false;
+
+                {
+                    std::lock_guard<std::mutex> lk(write_block_mutex);
+                }
+                write_block_cv.notify_all();
+            }
+        }
+
+        if (!db_enabled)
+            continue;
+
+        if (uncommitted == 0 && !checkpoint_pending)
+            continue;
+
+        auto now = std::chrono::steady_clock::now();
+
+        // Group commit once enough records are pending or enough time has passed; only
+        // this thread ever waits on the sync.  A pending checkpoint forces a commit, since
+        // it can only run outside of our transaction.
+        if (checkpoint_pending || uncommitted >= commit_count || 
+                now - last_commit >= std::chrono::seconds(commit_interval)) {
+            in_transaction_sync = true;
+
+            kis_trace_span span("kismetdb", "commit", uncommitted);
+
+            write_summary();
+
+            sqlite3_exec(db, "END TRANSACTION", NULL, NULL, NULL);
+
+            // Passive checkpoints never wait on readers; frames still in use by a reader
+            // are picked up by the next one
+            if (checkpoint_pending) {
+                checkpoint_pending = false;
+                sqlite3_wal_checkpoint_v2(db, NULL, SQLITE_CHECKPOINT_PASSIVE, NULL, NULL);
+            }
+
+            sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+
+            in_transaction_sync = false;
+
+            uncommitted = 0;
+            last_commit = now;
+        }
+    }
+
+    // The final commit happens when the log is closed
+    if (db_enabled)
+        write_summary();
+}
+
+void kis_database_logfile::summary_count(const log_summary_key& key, time_t ts, 
+        double lat, double lon) {
+    auto& s = summary_map[key];
+
+    s.count++;
+    s.dirty = true;
+
+    if (s.first_time == 0 || ts < s.first_time)
+        s.first_time = ts;
+    if (ts > s.last_time)
+        s.last_time = ts;
+
+    if (lat == 0 || lon == 0)
+        return;
+
+    if (s.with_location == 0) {
+        s.min_lat = s.max_lat = lat;
+        s.min_lon = s.max_lon = lon;
     } else {
-        if (loc != nullptr && loc->fix >= 2) {
-            sqlite3_bind_double(snapshot_stmt, 3, loc->lat);
-            sqlite3_bind_double(snapshot_stmt, 4, loc->lon);
+        s.min_lat = std::min(s.min_lat, lat);
+        s.min_lon = std::min(s.min_lon, lon);
+        s.max_lat = std::max(s.max_lat, lat);
+        s.max_lon = std::max(s.max_lon, lon);
+    }
+
+    s.with_location++;
+}
+
+void kis_database_logfile::summary_merge(log_summary& into, const log_summary& from) {
+    if (from.count == 0)
+        return;
+
+    if (into.count == 0 || from.first_time < into.first_time)
+        into.first_time = from.first_time;
+    if (from.last_time > into.last_time)
+        into.last_time = from.last_time;
+
+    if (from.with_location != 0) {
+        if (into.with_location == 0) {
+            into.min_lat = from.min_lat;
+            into.min_lon = from.min_lon;
+            into.max_lat = from.max_lat;
+            into.max_lon = from.max_lon;
         } else {
-            sqlite3_bind_int(snapshot_stmt, 3, 0);
-            sqlite3_bind_int(snapshot_stmt, 4, 0);
+            into.min_lat = std::min(into.min_lat, from.min_lat);
+            into.min_lon = std::min(into.min_lon, from.min_lon);
+            into.max_lat = std::max(into.max_lat, from.max_lat);
+            into.max_lon = std::max(into.max_lon, from.max_lon);
         }
     }
 
-    sqlite3_bind_text(snapshot_stmt, 5, snaptype.c_str(), snaptype.length(), SQLITE_TRANSIENT);
-    sqlite3_bind_text(snapshot_stmt, 6, json.data(), json.length(), SQLITE_TRANSIENT);
+    into.count += from.count;
+    into.with_location += from.with_location;
+}
 
-#if 0
-    kis_unique_lock<kis_mutex> dblock(ds_mutex, std::defer_lock, "kismetdb log_snapshot");
-    db_lock_with_sync_check(dblock, return -1);
-#endif
+bool kis_database_logfile::create_summary_table() {
+    auto r = sqlite3_exec(db, 
+            "CREATE TABLE IF NOT EXISTS summary ("
+            "kind TEXT, " // packets, data, devices, or packettag
+            "phyname TEXT, "
+            "datasource TEXT, " // Datasource uuid, empty for devices
+            "tag TEXT, " // Packet tag, for packettag rows
+            "count INT, "
+            "with_location INT, " // Records (or devices) with a location
+            "first_time INT, "
+            "last_time INT, "
+            "min_lat REAL, " // Bounding rectangle of the located records
+            "min_lon REAL, "
+            "max_lat REAL, "
+            "max_lon REAL, "
+            "UNIQUE(kind, phyname, datasource, tag) ON CONFLICT REPLACE)", NULL, NULL, NULL);
 
-    if (sqlite3_step(snapshot_stmt) != SQLITE_DONE) {
-        _MSG("kis_database_logfile unable to insert snapshot in " +
-                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-        close_log();
-        return -1;
+    if (r != SQLITE_OK) {
+        _MSG_ERROR("Kismet log was unable to create summary table in {}: {}", 
+                ds_dbfile, sqlite3_errmsg(db));
+        return false;
     }
 
-    sqlite3_finalize(snapshot_stmt);
-
-    return 1;
+    return true;
 }
 
+bool kis_database_logfile::write_summary() {
+    kis_lock_guard<kis_mutex> lk(summary_mutex, "write_summary");
 
-void kis_database_logfile::usage(const char *argv0) {
+    sqlite3_stmt *summary_stmt = nullptr;
+    const char *summary_pz;
+
+    for (auto& si : summary_map) {
+        auto& s = si.second;
+
+        if (!s.dirty)
+            continue;
+
+        if (summary_stmt == nullptr) {
+            std::string sql = 
+                "INSERT INTO summary (kind, phyname, datasource, tag, count, with_location, "
+                "first_time, last_time, min_lat, min_lon, max_lat, max_lon) "
+                "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+
+            if (sqlite3_prepare(db, sql.c_str(), sql.length(), 
+                        &summary_stmt, &summary_pz) != SQLITE_OK) {
+                _MSG_ERROR("Kismet log was unable to prepare summary insert in {}: {}", 
+                        ds_dbfile, sqlite3_errmsg(db));
+                return false;
+            }
+        }
 
+        sqlite3_reset(summary_stmt);
+        sqlite3_clear_bindings(summary_stmt);
+
+        int spos = 1;
+
+        for (const auto& k : {std::get<0>(si.first), std::get<1>(si.first), 
+                std::get<2>(si.first), std::get<3>(si.first)})
+            sqlite3_bind_text(summary_stmt, spos++, k.c_str(), k.length(), SQLITE_TRANSIENT);
+
+        sqlite3_bind_int64(summary_stmt, spos++, s.count);
+        sqlite3_bind_int64(summary_stmt, spos++, s.with_location);
+        sqlite3_bind_int64(summary_stmt, spos++, s.first_time);
+        sqlite3_bind_int64(summary_stmt, spos++, s.last_time);
+        sqlite3_bind_double(summary_stmt, spos++, s.min_lat);
+        sqlite3_bind_double(summary_stmt, spos++, s.min_lon);
+        sqlite3_bind_double(summary_stmt, spos++, s.max_lat);
+        sqlite3_bind_double(summary_stmt, spos++, s.max_lon);
+
+        if (sqlite3_step(summary_stmt) != SQLITE_DONE) {
+            _MSG_ERROR("Kismet log was unable to write summary in {}: {}", 
+                    ds_dbfile, sqlite3_errmsg(db));
+            sqlite3_finalize(summary_stmt);
+            return false;
+        }
+
+        s.dirty = false;
+    }
+
+    if (summary_stmt != nullptr)
+        sqlite3_finalize(summary_stmt);
+
+    return true;
 }
 
+void kis_database_logfile::summary_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    std::ostream stream(&con->response_stream());
 
-void kis_database_logfile::pcapng_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
-	using namespace kissqlite3;
+    std::map<log_summary_key, log_summary> merged;
 
-	auto query = _SELECT(db, "packets", {"ts_sec", "ts_usec", "datasource", "dlt", "packet"});
+    {
+        kis_lock_guard<kis_mutex> lk(summary_mutex, "summary_endp_handler");
 
-	auto ts_start_k = con->http_variables().find("timestamp_start");
-	if (ts_start_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("ts_sec", GE, string_to_n<uint64_t>(ts_start_k->second)));
+        merged = summary_closed;
 
-	auto ts_end_k = con->http_variables().find("timestamp_end");
-	if (ts_end_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("ts_sec", LE, string_to_n<uint64_t>(ts_end_k->second)));
+        for (const auto& si : summary_map)
+            summary_merge(merged[si.first], si.second);
+    }
+
+    std::map<std::string, log_summary> totals;
+
+    for (const auto& kind : {"packets", "data", "devices"})
+        totals[kind] = log_summary{};
+
+    for (const auto& si : merged)
+        if (std::get<0>(si.first) != "packettag")
+            summary_merge(totals[std::get<0>(si.first)], si.second);
+
+    auto format_summary = [](const log_summary& s) -> std::string {
+        return fmt::format("\"count\":{},\"with_location\":{},\"first_time\":{},"
+                "\"last_time\":{},\"min_lat\":{},\"min_lon\":{},\"max_lat\":{},"
+                "\"max_lon\":{}", s.count, s.with_location, s.first_time, s.last_time,
+                s.min_lat, s.min_lon, s.max_lat, s.max_lon);
+    };
+
+    con->set_mime_type("application/json");
+
+    stream << fmt::format("{{\"segments\":{},\"totals\":{{", segment_num);
+
+    bool first = true;
+
+    for (const auto& ti : totals) {
+        if (!first)
+            stream << ",";
+        first = false;
+
+        stream << fmt::format("\"{}\":{{{}}}", ti.first, format_summary(ti.second));
+    }
+
+    stream << "},\"rows\":[";
 
-	auto datasource_k = con->http_variables().find("datasource");
-	if (datasource_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("datasource", LIKE, datasource_k->second));
+    first = true;
 
-	auto deviceid_k = con->http_variables().find("device_id");
-	if (deviceid_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("devkey", LIKE, deviceid_k->second));
+    for (const auto& si : merged) {
+        if (!first)
+            stream << ",";
+        first = false;
 
-	auto dlt_k = con->http_variables().find("dlt");
-	if (dlt_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("dlt", EQ, string_to_n<unsigned int>(dlt_k->second)));
+        stream << fmt::format("{{\"kind\":\"{}\",\"phyname\":\"{}\",\"datasource\":\"{}\","
+                "\"tag\":\"{}\",{}}}",
+                std::get<0>(si.first), 
+                json_adapter::sanitize_string(std::get<1>(si.first)),
+                std::get<2>(si.first), 
+                json_adapter::sanitize_string(std::get<3>(si.first)),
+                format_summary(si.second));
+    }
+
+    stream << "]}";
+}
+
+
+void kis_database_logfile::usage(const char *argv0) {
 
-	auto frequency_k = con->http_variables().find("frequency");
-	if (frequency_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("frequency", EQ, string_to_n<unsigned int>(frequency_k->second)));
+}
 
-	auto frequency_min_k = con->http_variables().find("frequency_min");
-	if (frequency_min_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("frequency", GE, string_to_n<unsigned int>(frequency_min_k->second)));
 
-	auto frequency_max_k = con->http_variables().find("frequency_max");
-	if (frequency_max_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("frequency", LE, string_to_n<unsigned int>(frequency_max_k->second)));
+void kis_database_logfile::pcapng_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+	using namespace kissqlite3;
 
-	auto signal_min_k = con->http_variables().find("signal_min");
-	if (signal_min_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("signal", GE, string_to_n<int>(signal_min_k->second)));
+	// The same query is run against every segment of the log
+	// Only the packets table (not the dedupe view) carries the compression columns
+	std::list<std::string> fields{"ts_sec", "ts_usec", "datasource", "dlt", "packet"};
 
-	auto signal_max_k = con->http_variables().find("signal_max");
-	if (signal_max_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("signal", LE, string_to_n<int>(signal_max_k->second)));
+	if (!packet_dedupe) {
+		fields.push_back("packet_len");
+		fields.push_back("compression");
+	}
 
-	auto address_source_k = con->http_variables().find("address_source");
-	if (address_source_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("sourcemac", LIKE, address_source_k->second));
+	auto ordered = packet_index != packet_index_mode::none;
+
+	auto build_query = [&con, &fields, ordered](sqlite3 *qdb) -> kissqlite3::query {
+		auto query = _SELECT(qdb, "packets", fields);
+
+		// Keys are stored in upper case; a plain key is matched exactly so the packet
+		// indexes can be used, and only a value with a wildcard falls back to LIKE
+		auto key_where = [](const std::string& field, const std::string& value) {
+			if (value.find('%') != std::string::npos)
+				return _WHERE(field, LIKE, value);
+			return _WHERE(field, EQ, str_upper(value));
+		};
+
+		auto ts_start_k = con->http_variables().find("timestamp_start");
+		if (ts_start_k != con->http_variables().end()) 
+			query.append_where(AND, _WHERE("ts_sec", GE, string_to_n<uint64_t>(ts_start_k->second)));
+
+		auto ts_end_k = con->http_variables().find("timestamp_end");
+		if (ts_end_k != con->http_variables().end()) 
+			query.append_where(AND, _WHERE("ts_sec", LE, string_to_n<uint64_t>(ts_end_k->second)));
+
+		auto datasource_k = con->http_variables().find("datasource");
+		if (datasource_k != con->http_variables().end()) 
+			query.append_where(AND, key_where("datasource", datasource_k->second));
+
+		auto deviceid_k = con->http_variables().find("device_id");
+		if (deviceid_k != con->http_variables().end()) 
+			query.append_where(AND, key_where("devkey", deviceid_k->second));
+
+		auto dlt_k = con->http_variables().find("dlt");
+		if (dlt_k != con->http_variables().end()) 
+			query.append_where(AND, _WHERE("dlt", EQ, string_to_n<unsigned int>(dlt_k->second)));
+
+		auto frequency_k = con->http_variables().find("frequency");
+		if (frequency_k != con->http_variables().end()) 
+			query.append_where(AND, _WHERE("frequency", EQ, string_to_n<unsigned int>(frequency_k->second)));
+
+		auto frequency_min_k = con->http_variables().find("frequency_min");
+		if (frequency_min_k != con->http_variables().end()) 
+			query.append_where(AND, _WHERE("frequency", GE, string_to_n<unsigned int>(frequency_min_k->second)));
+
+		auto frequency_max_k = con->http_variables().find("frequency_max");
+		if (frequency_max_k != con->http_variables().end()) 
+			query.append_where(AND, _WHERE("frequency", LE, string_to_n<unsigned int>(frequency_max_k->second)));
+
+		auto signal_min_k = con->http_variables().find("signal_min");
+		if (signal_min_k != con->http_variables().end()) 
+			query.append_where(AND, _WHERE("signal", GE, string_to_n<int>(signal_min_k->second)));
+
+		auto signal_max_k = con->http_variables().find("signal_max");
+		if (signal_max_k != con->http_variables().end()) 
+			query.append_where(AND, _WHERE("signal", LE, string_to_n<int>(signal_max_k->second)));
+
+		auto address_source_k = con->http_variables().find("address_source");
+		if (address_source_k != con->http_variables().end()) 
+			query.append_where(AND, key_where("sourcemac", address_source_k->second));
+
+		auto address_dest_k = con->http_variables().find("address_dest");
+		if (address_dest_k != con->http_variables().end()) 
+			query.append_where(AND, key_where("destmac", address_dest_k->second));
+
+		auto address_trans_k = con->http_variables().find("address_trans");
+		if (address_trans_k != con->http_variables().end()) 
+			query.append_where(AND, key_where("transmac", address_trans_k->second));
+
+		auto address_k = con->http_variables().find("address");
+		if (address_k != con->http_variables().end()) {
+			auto address_clause = key_where("sourcemac", address_k->second);
+			address_clause = _WHERE(address_clause, OR, key_where("destmac", address_k->second));
+			address_clause = _WHERE(address_clause, OR, key_where("transmac", address_k->second));
+			query.append_where(AND, address_clause);
+		}
 
-	auto address_dest_k = con->http_variables().find("address_dest");
-	if (address_dest_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("destmac", LIKE, address_dest_k->second));
+		auto location_lat_min_k = con->http_variables().find("location_lat_min");
+		if (location_lat_min_k != con->http_variables().end()) 
+			query.append_where(AND, _WHERE("lat", GE, string_to_n<double>(location_lat_min_k->second)));
 
-	auto address_trans_k = con->http_variables().find("address_trans");
-	if (address_trans_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("transmac", LIKE, address_trans_k->second));
+		auto location_lat_max_k = con->http_variables().find("location_lat_max");
+		if (location_lat_max_k != con->http_variables().end()) 
+			query.append_where(AND, _WHERE("lat", LE, string_to_n<double>(location_lat_max_k->second)));
 
-	auto location_lat_min_k = con->http_variables().find("location_lat_min");
-	if (location_lat_min_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("lat", GE, string_to_n<double>(location_lat_min_k->second)));
+		auto location_lon_min_k = con->http_variables().find("location_lon_min");
+		if (location_lon_min_k != con->http_variables().end()) 
+			query.append_where(AND, _WHERE("lon", GE, string_to_n<double>(location_lon_min_k->second)));
 
-	auto location_lat_max_k = con->http_variables().find("location_lat_max");
-	if (location_lat_max_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("lat", LE, string_to_n<double>(location_lat_max_k->second)));
+		auto location_lon_max_k = con->http_variables().find("location_lon_max");
+		if (location_lon_max_k != con->http_variables().end()) 
+			query.append_where(AND, _WHERE("lon", LE, string_to_n<double>(location_lon_max_k->second)));
 
-	auto location_lon_min_k = con->http_variables().find("location_lon_min");
-	if (location_lon_min_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("lon", GE, string_to_n<double>(location_lon_min_k->second)));
+		auto size_min_k = con->http_variables().find("size_min");
+		if (size_min_k != con->http_variables().end()) 
+			query.append_where(AND, _WHERE("packet_len", GE, string_to_n<unsigned long int>(size_min_k->second)));
 
-	auto location_lon_max_k = con->http_variables().find("location_lon_max");
-	if (location_lon_max_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("lon", LE, string_to_n<double>(location_lon_max_k->second)));
+		auto size_max_k = con->http_variables().find("size_max");
+		if (size_max_k != con->http_variables().end()) 
+			query.append_where(AND, _WHERE("packet_len", LE, string_to_n<unsigned long int>(size_max_k->second)));
 
-	auto size_min_k = con->http_variables().find("size_min");
-	if (size_min_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("packet_len", GE, string_to_n<unsigned long int>(size_min_k->second)));
+		auto tag_k = con->http_variables().find("tag");
+		if (tag_k != con->http_variables().end())
+			query.append_where(AND, _WHERE("tags", LIKE, tag_k->second));
 
-	auto size_max_k = con->http_variables().find("size_max");
-	if (size_max_k != con->http_variables().end()) 
-		query.append_where(AND, _WHERE("packet_len", LE, string_to_n<unsigned long int>(size_max_k->second)));
+		// Walking the index in time order streams matches without a sort pass
+		if (ordered)
+			query.append_clause(ORDERBY, "ts_sec, ts_usec");
 
-	auto tag_k = con->http_variables().find("tag");
-	if (tag_k != con->http_variables().end())
-		query.append_where(AND, _WHERE("tags", LIKE, tag_k->second));
+		auto limit_k = con->http_variables().find("limit");
+		if (limit_k != con->http_variables().end()) 
+			query.append_clause(LIMIT, string_to_n<unsigned long>(limit_k->second));
 
-	auto limit_k = con->http_variables().find("limit");
-	if (limit_k != con->http_variables().end()) 
-		query.append_clause(LIMIT, string_to_n<unsigned long>(limit_k->second));
+		return query;
+	};
 
 	con->clear_timeout();
 
@@ -1501,27 +3353,127 @@ void kis_database_logfile::pcapng_endp_handler(std::shared_ptr<kis_net_beast_htt
 
 	pcapng->start_stream();
 
+	uint64_t ts_start = 0, ts_end = 0;
+
+	auto ts_start_k = con->http_variables().find("timestamp_start");
+	if (ts_start_k != con->http_variables().end())
+		ts_start = string_to_n<uint64_t>(ts_start_k->second);
+
+	auto ts_end_k = con->http_variables().find("timestamp_end");
+	if (ts_end_k != con->http_variables().end())
+		ts_end = string_to_n<uint64_t>(ts_end_k->second);
+
+	// Closed segments are read through their own read-only connections; segments entirely
+	// outside the requested time range are skipped
+	std::vector<std::string> closed_segments;
+
+	{
+		std::shared_lock<kis_shared_mutex> lk(segment_mutex);
+
+		auto dir_slash = segment_base_path.find_last_of('/');
+		auto dir = dir_slash == std::string::npos ? std::string("") : 
+			segment_base_path.substr(0, dir_slash + 1);
+
+		for (const auto& seg : segment_vec) {
+			if (ts_start != 0 && seg.last_time != 0 && (uint64_t) seg.last_time < ts_start)
+				continue;
+			if (ts_end != 0 && (uint64_t) seg.first_time > ts_end)
+				continue;
+
+			closed_segments.push_back(dir + seg.path);
+		}
+	}
+
 	// Get the list of all the interfaces we know about in the database and push them into the
-	// pcapng handler
-	auto datasource_query = _SELECT(db, "datasources", {"uuid", "name", "interface"});
+	// pcapng handler, then stream the packets; returns false if the stream was closed
+	auto stream_segment = [&](sqlite3 *qdb) -> bool {
+		auto datasource_query = _SELECT(qdb, "datasources", {"uuid", "name", "interface"});
+
+		for (auto ds : datasource_query)  {
+			pcapng->add_database_interface(sqlite3_column_as<std::string>(ds, 0),
+					sqlite3_column_as<std::string>(ds, 1),
+					sqlite3_column_as<std::string>(ds, 2));
+		}
+
+		auto query = build_query(qdb);
+
+		// Dictionaries are loaded as they're first referenced, since the writer can add
+		// new ones while we stream
+		std::map<int64_t, std::string> dictionaries;
+		std::string inflated;
+
+		// Database handler registers itself as timing out so this should be OK to just blitz through
+		// now, we'll block as necessary
+		for (auto p : query) {
+			auto packet = sqlite3_column_as<std::string>(p, 4);
+
+			int64_t compression = 0;
+			if (!packet_dedupe)
+				compression = sqlite3_column_as<int64_t>(p, 6);
+
+			if (compression > 0) {
+				auto di = dictionaries.find(compression);
 
-	for (auto ds : datasource_query)  {
-		pcapng->add_database_interface(sqlite3_column_as<std::string>(ds, 0),
-				sqlite3_column_as<std::string>(ds, 1),
-				sqlite3_column_as<std::string>(ds, 2));
+				if (di == dictionaries.end()) {
+					auto dict_q = _SELECT(qdb, "packet_dictionaries", {"dictionary"},
+							_WHERE("id", EQ, compression));
+					auto dict_r = dict_q.begin();
+
+					if (dict_r == dict_q.end())
+						continue;
+
+					di = dictionaries.emplace(compression, 
+							sqlite3_column_as<std::string>(*dict_r, 0)).first;
+				}
+
+				if (!inflate_packet(di->second, packet, 
+							sqlite3_column_as<std::uint64_t>(p, 5), inflated))
+					continue;
+
+				packet = inflated;
+			}
+
+			if (pcapng->pcapng_write_database_packet(
+						sqlite3_column_as<std::uint64_t>(p, 0),
+						sqlite3_column_as<std::uint64_t>(p, 1),
+						sqlite3_column_as<std::string>(p, 2),
+						sqlite3_column_as<unsigned int>(p, 3),
+						packet) < 0) {
+				return false;
+			}
+		}
+
+		return true;
+	};
+
+	for (const auto& seg : closed_segments) {
+		sqlite3 *seg_db = nullptr;
+
+		if (sqlite3_open_v2(seg.c_str(), &seg_db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+			_MSG_ERROR("Unable to open KismetDB log segment {} for pcapng export: {}", 
+					seg, sqlite3_errmsg(seg_db));
+			sqlite3_close(seg_db);
+			continue;
+		}
+
+		bool ok = stream_segment(seg_db);
+
+		sqlite3_close(seg_db);
+
+		if (!ok)
+			return;
 	}
 
-	// Database handler registers itself as timing out so this should be OK to just blitz through
-	// now, we'll block as necessary
-	for (auto p : query) {
-		if (pcapng->pcapng_write_database_packet(
-					sqlite3_column_as<std::uint64_t>(p, 0),
-					sqlite3_column_as<std::uint64_t>(p, 1),
-					sqlite3_column_as<std::string>(p, 2),
-					sqlite3_column_as<unsigned int>(p, 3),
-					sqlite3_column_as<std::string>(p, 4)) < 0) {
+	// Read the current segment from the read-only WAL connection when we have one so the
+	// query never holds up the writer; the segment can't rotate out from under us while
+	// we hold the segment lock
+	{
+		std::shared_lock<kis_shared_mutex> lk(segment_mutex);
+
+		auto rdb = read_db != nullptr ? read_db : db;
+
+		if (rdb != nullptr && !stream_segment(rdb))
 			return;
-		}
 	}
 
 	streamtracker->remove_streamer(sid);
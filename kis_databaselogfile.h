@@ -38,8 +38,19 @@
 #include "config.h"
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <shared_mutex>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "globalregistry.h"
 #include "kis_mutex.h"
@@ -53,10 +64,13 @@
 #include "class_filter.h"
 #include "packet_filter.h"
 #include "messagebus.h"
+#include "moodycamel/blockingconcurrentqueue.h"
+
+#include <zlib.h>
 
 // Kismetdb version
 
-#define KISMETDB_LOG_VERSION        8
+#define KISMETDB_LOG_VERSION        9
 
 // This is a bit of a unique case - because so many things plug into this, it has
 // to exist as a global record; we build it like we do any other global record;
@@ -93,6 +107,12 @@ public:
 
     virtual int database_upgrade_db() override;
 
+protected:
+    // Apply the journal mode and tunable pragmas from the config before the log tables
+    // are created
+    virtual void database_configure() override;
+
+public:
     // Log a vector of multiple devices, replacing any old device records
     virtual int log_device(std::shared_ptr<kis_tracked_device_base> in_device);
 
@@ -100,8 +120,13 @@ public:
     // device logs so that we can update just the logs we need.
     virtual time_t get_last_device_log_ts() { return last_device_log; }
 
+    // Number of records waiting for the writer thread
+    size_t get_write_queue_size() const { return write_queue_sz; }
+
     // Log a packet
     virtual int log_packet(std::shared_ptr<kis_packet> in_packet);
+    // Log the packets of a packet chain batch with one queued write
+    int log_packets(const packet_chain::packet_batch& in_batch);
 
     // Log data that isn't a packet; this is a slightly more clunky API because we 
     // can't derive the data from the simple packet interface.  GPS may be null,
@@ -130,6 +155,10 @@ public:
         return packet_mac_filter;
     }
 
+    std::shared_ptr<packet_filter_expression> get_packet_expression_filter() {
+        return packet_expr_filter;
+    }
+
     std::shared_ptr<class_filter_mac_addr> get_device_filter() {
         return device_mac_filter;
     }
@@ -146,7 +175,8 @@ protected:
     std::shared_ptr<gps_tracker> gpstracker;
 
     int pack_comp_linkframe, pack_comp_gps, pack_comp_no_gps, pack_comp_radiodata,
-        pack_comp_device, pack_comp_datasource, pack_comp_common, pack_comp_metablob;
+        pack_comp_device, pack_comp_datasource, pack_comp_common, pack_comp_metablob,
+        pack_comp_decap;
 
     std::atomic<time_t> last_device_log;
 
@@ -172,10 +202,162 @@ protected:
 
     int packet_handler_id;
 
-    // Keep track of our commit cycles; to avoid thrashing the filesystem with
-    // commit state we run a 10 second tranasction commit loop
     kis_mutex transaction_mutex;
-    int transaction_timer;
+
+    // Database writes are handed to a single writer thread which owns every insert and
+    // commit; callers format their records and queue them, so packet threads never wait
+    // on sqlite or on the transaction sync.  The writer group-commits once commit_count
+    // records are pending or commit_interval seconds have passed.
+    using db_write_t = std::function<void ()>;
+
+    enum class write_queue_policy {
+        block, drop, spill
+    };
+
+    moodycamel::BlockingConcurrentQueue<db_write_t> write_queue;
+    std::atomic<size_t> write_queue_sz;
+    size_t write_queue_max;
+    write_queue_policy write_policy;
+    std::atomic<uint64_t> write_queue_dropped;
+    std::atomic<bool> write_queue_spilled;
+
+    // Producers blocked on a full queue under the block policy
+    std::mutex write_block_mutex;
+    std::condition_variable write_block_cv;
+
+    unsigned int commit_count;
+    unsigned int commit_interval;
+
+    std::thread writer_thread;
+    std::atomic<std::thread::id> writer_thread_id;
+    std::atomic<bool> writer_shutdown;
+
+    // In WAL mode readers (the pcapng endpoint and external kismetdb tools) never block
+    // the writer; the writer runs a passive checkpoint at the first commit after each
+    // checkpoint interval so the WAL doesn't grow without bound.  Readers use a separate
+    // read-only connection so they don't share the writer's open transaction.
+    bool wal_mode;
+    std::atomic<bool> checkpoint_pending;
+    unsigned int checkpoint_interval;
+    int checkpoint_timer;
+    sqlite3 *read_db;
+
+    // Queue a write; returns false if the database is closed or the write was dropped
+    bool queue_write(db_write_t&& in_write);
+    void writer_loop();
+
+    // Non-packet data records, written in batches; records logged while a batch is
+    // waiting in the write queue join it, so under load a single prepared insert
+    // covers many records
+    struct data_record {
+        std::shared_ptr<kis_gps_packinfo> gps;
+        struct timeval tv;
+        std::string phystring;
+        mac_addr devmac;
+        uuid datasource_uuid;
+        std::string type;
+        std::string json;
+    };
+
+    kis_mutex data_batch_mutex;
+    std::shared_ptr<std::vector<data_record>> data_batch;
+    size_t data_batch_max;
+
+    // Packet passes the duplicate, filtered, and packet filter checks
+    bool packet_loggable(const std::shared_ptr<kis_packet>& in_pack);
+
+    // Writer-side packet and data inserts
+    void write_packet(std::shared_ptr<kis_packet> in_pack);
+    void write_data(std::shared_ptr<kis_gps_packinfo> gps, struct timeval tv, 
+            const std::string& phystring, mac_addr devmac, uuid datasource_uuid, 
+            const std::string& type, const std::string& json);
+    void write_data_batch(const std::vector<data_record>& in_batch);
+
+    // Incremental device logging; every logging cycle writes a compact row of the hot
+    // device fields (times, counters, signal, and location) to device_updates, and the
+    // full device record is only rewritten when the structure of the device changes, or
+    // every device_full_interval seconds
+    struct device_log_state {
+        uint64_t structure_hash;
+        time_t last_full;
+    };
+
+    bool device_incremental;
+    unsigned int device_full_interval;
+    kis_mutex device_log_mutex;
+    std::unordered_map<device_key, device_log_state> device_log_map;
+
+    // Segment rotation; once the current file passes the size, age, or packet limit the
+    // writer closes it and continues in a new segment file.  Every segment carries a
+    // segments manifest table listing the segments before it and itself, so readers can
+    // walk the whole series.
+    uint64_t rotate_size;
+    unsigned int rotate_age;
+    uint64_t rotate_packets;
+    int rotate_timer;
+    std::atomic<bool> rotate_queued;
+    std::atomic<uint64_t> segment_packets;
+    std::atomic<time_t> segment_start;
+    unsigned int segment_num;
+    std::string segment_base_path;
+    std::string segment_series;
+
+    struct segment_record {
+        unsigned int segment;
+        std::string path;
+        time_t first_time;
+        time_t last_time;
+    };
+
+    // Closed segments, oldest first
+    std::vector<segment_record> segment_vec;
+
+    // Held exclusively by the writer while it swaps segments; readers of the current 
+    // segment and of segment_vec hold it shared
+    kis_shared_mutex segment_mutex;
+
+    // Path of segment n; the first segment is the log path itself, and later segments
+    // add a -seg0002 style suffix before the extension
+    std::string segment_path(unsigned int n);
+    bool write_segment_manifest();
+    void rotate_segment();
+
+    // Running summary of the current segment, kept by the writer and stored in the
+    // summary table at every commit, so the statistics of a log (or of the running
+    // server) don't need a scan of the packets, data, and devices tables.  Rows are
+    // keyed by record kind (packets, data, devices, or packettag), phy name, datasource
+    // uuid, and packet tag; the summary table of each segment only covers that segment.
+    struct log_summary {
+        uint64_t count;
+        uint64_t with_location;
+        time_t first_time;
+        time_t last_time;
+        double min_lat;
+        double min_lon;
+        double max_lat;
+        double max_lon;
+        bool dirty;
+    };
+
+    using log_summary_key = std::tuple<std::string, std::string, std::string, std::string>;
+
+    kis_mutex summary_mutex;
+    std::map<log_summary_key, log_summary> summary_map;
+
+    // Totals of the closed segments, for the summary endpoint
+    std::map<log_summary_key, log_summary> summary_closed;
+
+    // Devices counted in the current segment, and if they had a location
+    std::unordered_map<std::string, bool> summary_devices;
+
+    // Count a record; called with the summary mutex held
+    void summary_count(const log_summary_key& key, time_t ts, double lat, double lon);
+    static void summary_merge(log_summary& into, const log_summary& from);
+
+    bool create_summary_table();
+    bool write_summary();
+
+    void summary_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
 
     // Packet time limit
     unsigned int packet_timeout;
@@ -212,6 +394,7 @@ protected:
 
     // Packet log filter
     std::shared_ptr<packet_filter_mac_addr> packet_mac_filter;
+    std::shared_ptr<packet_filter_expression> packet_expr_filter;
 
     // Eventbus listeners
     std::shared_ptr<event_bus> eventbus;
@@ -223,6 +406,67 @@ protected:
 
     bool log_duplicate_packets;
     bool log_data_packets;
+
+    // Deduplicated packet storage; each unique frame payload is stored once in
+    // packet_payloads, and every observation of it by a datasource is a row in
+    // packet_observations carrying the per-source link headers.  The packets view joins
+    // them back together, so readers of the packets table are unchanged.
+    bool packet_dedupe;
+
+    // Writer-thread cache of recently stored payloads, keyed by the packet number shared
+    // by duplicates of the same frame, holding the payload length and row id
+    std::unordered_map<uint64_t, std::vector<std::pair<size_t, int64_t>>> payload_cache;
+    std::deque<uint64_t> payload_cache_fifo;
+
+    // Find or insert a payload, returning the row id or -1 on error
+    int64_t write_payload(uint64_t packet_no, uint32_t hash, 
+            const nonstd::string_view& payload, bool cacheable);
+
+    // Compressed packet storage; packet blobs are raw-deflated against a preset dictionary
+    // trained per DLT from the first small frames of each segment, and stored in the
+    // packet_dictionaries table.  The packets compression column holds the dictionary id
+    // a row was compressed with, or 0 for a raw packet.  Only the writer thread touches the
+    // training state and stream.
+    bool packet_compression;
+    int packet_compression_level;
+
+    struct packet_dictionary_training {
+        std::unordered_map<std::string, unsigned int> samples;
+        size_t seen;
+    };
+
+    std::unordered_map<int, std::pair<int64_t, std::string>> packet_dicts;
+    std::unordered_map<int, packet_dictionary_training> packet_dict_training;
+
+    z_stream packet_zstrm;
+    bool packet_zstrm_init;
+
+    // Compress a packet into out, returning the dictionary id, or 0 if the packet should
+    // be stored raw
+    int64_t compress_packet(int dlt, const nonstd::string_view& data, std::string& out);
+    void reset_packet_compression();
+
+    // Packet lookup indexes on time, addresses, device, and datasource, so filtered
+    // exports walk an index instead of scanning the packets table.  Live indexes are
+    // maintained on every insert; close indexes are built once when a segment is closed.
+    enum class packet_index_mode { none, close, live };
+    packet_index_mode packet_index;
+
+    bool create_packet_indexes();
+
+    // Compact data storage; the phy, datasource, and type of each record are stored once
+    // in data_types, the device mac as an integer, and the record itself as sqlite JSONB
+    // when the sqlite library supports it.  The data view renders the original data
+    // table, JSON included, so readers of the data table are unchanged.
+    bool data_compact;
+    bool data_jsonb;
+
+    // Writer-thread cache of data_types rows, keyed by phy, datasource, and type
+    std::unordered_map<std::string, int64_t> data_type_ids;
+
+    // Find or insert a data type, returning the row id or -1 on error
+    int64_t write_data_type(const std::string& phystring, const std::string& uuidstring,
+            const std::string& type);
 };
 
 class kis_database_logfile_builder : public kis_logfile_builder {
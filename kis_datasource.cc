@@ -18,20 +18,28 @@
 
 #include "config.h"
 
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <set>
+
 #include "kis_datasource.h"
 #include "endian_magic.h"
 #include "configfile.h"
 #include "datasourcetracker.h"
 #include "entrytracker.h"
 #include "alertracker.h"
+#include "kis_ingest_pool.h"
+#include "kis_spectrum_ring.h"
 #include "packetchain.h"
+#include "remote_announcement.h"
 #include "timetracker.h"
 
 // We never instantiate from a generic tracker component or from a stored
 // record so we always re-allocate ourselves
 kis_datasource::kis_datasource(shared_datasource_builder in_builder) :
     tracker_component(),
-    kis_external_interface() {
+    kis_external_interface(kis_ingest_pool::assign_context()) {
 
     next_transaction = 1;
 
@@ -45,6 +53,8 @@ kis_datasource::kis_datasource(shared_datasource_builder in_builder) :
     register_fields();
     reserve_fields(nullptr);
 
+    source_ingest_thread->set(kis_ingest_pool::context_group(ext_io));
+
     if (in_builder != nullptr) {
         set_source_builder(in_builder);
         insert(in_builder);
@@ -68,9 +78,31 @@ kis_datasource::kis_datasource(shared_datasource_builder in_builder) :
 
     suppress_gps = false;
 
+    batch_zstrm_init = false;
+
+    datagram_token = 0;
+    datagram_next_seqno = 0;
+    datagram_started = false;
+
     error_timer_id = -1;
     ping_timer_id = -1;
 
+    sample_frames = 0;
+    sample_processed = 0;
+    sample_ratio = 1;
+    sample_window = 0;
+    sample_window_frames = 0;
+
+    hop_adaptive = false;
+    hop_adaptive_interval = 10;
+    hop_adaptive_timer_id = -1;
+    hop_adaptive_mutex.set_name("kds_adaptive_hop");
+
+    last_hop_count = last_hop_dwell_total = last_hop_dwell_error_total = 
+        last_hop_switch_total = 0;
+
+    spectrum_mutex.set_name("kds_spectrum");
+
     mode_probing = false;
     mode_listing = false;
 
@@ -90,11 +122,22 @@ kis_datasource::~kis_datasource() {
     // Cancel any timer
     timetracker->remove_timer(error_timer_id);
     timetracker->remove_timer(ping_timer_id);
+    timetracker->remove_timer(hop_adaptive_timer_id);
 
     cancel_all_commands("source deleted");
 
     command_ack_map.clear();
 
+    if (batch_zstrm_init)
+        inflateEnd(&batch_zstrm);
+
+    if (datagram_token != 0) {
+        auto datasourcetracker = Globalreg::fetch_global_as<datasource_tracker>("DATASOURCETRACKER");
+
+        if (datasourcetracker != nullptr)
+            datasourcetracker->remove_datagram_source(datagram_token);
+    }
+
     // We don't call a normal close here because we can't risk double-free
     // or going through commands again - if the source is being deleted, it should
     // be completed!
@@ -428,6 +471,204 @@ void kis_datasource::set_channel_hop_list(std::vector<std::string> in_chans,
             get_source_hop_offset(), in_transaction, in_cb);
 }
 
+// Activity is reported by the channel number, while hop lists may carry the width as
+// well, such as 6HT40+; named channels are used as-is
+static std::string adaptive_channel_key(const std::string& in_channel) {
+    size_t i = 0;
+
+    while (i < in_channel.length() && isdigit(in_channel[i]))
+        i++;
+
+    if (i == 0)
+        return in_channel;
+
+    return in_channel.substr(0, i);
+}
+
+unsigned int kis_datasource::count_sample_frame(time_t in_now, unsigned int in_fixed_ratio,
+        unsigned int in_target_rate) {
+    sample_frames.fetch_add(1, std::memory_order_relaxed);
+
+    auto window = sample_window.load(std::memory_order_relaxed);
+
+    // The first frame of each second recomputes the ratio from the frames of the last
+    if (window != in_now && sample_window.compare_exchange_strong(window, in_now)) {
+        auto frames = sample_window_frames.exchange(0);
+
+        unsigned int ratio = 1;
+
+        if (in_target_rate != 0) {
+            auto secs = window == 0 ? 1 : std::max((time_t) 1, in_now - window);
+            auto rate = frames / secs;
+
+            ratio = (rate + in_target_rate - 1) / in_target_rate;
+        }
+
+        sample_ratio = std::max(ratio, std::max(in_fixed_ratio, 1U));
+    }
+
+    sample_window_frames.fetch_add(1, std::memory_order_relaxed);
+
+    return sample_ratio.load(std::memory_order_relaxed);
+}
+
+void kis_datasource::record_channel_activity(const std::string& in_channel, 
+        unsigned int in_packets, unsigned int in_discoveries) {
+    if (!hop_adaptive)
+        return;
+
+    kis_lock_guard<kis_mutex> lk(hop_adaptive_mutex, "datasource record_channel_activity");
+
+    auto& a = hop_adaptive_activity[adaptive_channel_key(in_channel)];
+    a.first += in_packets;
+    a.second += in_discoveries;
+}
+
+void kis_datasource::start_adaptive_hopping() {
+    {
+        kis_lock_guard<kis_mutex> lk(hop_adaptive_mutex, "datasource start_adaptive_hopping");
+        hop_adaptive_activity.clear();
+        hop_adaptive_score.clear();
+        hop_adaptive_base.clear();
+    }
+
+    timetracker->remove_timer(hop_adaptive_timer_id);
+    hop_adaptive_timer_id = 
+        timetracker->register_timer(std::chrono::seconds(hop_adaptive_interval), true, 
+                [this](int) -> int {
+                    update_adaptive_hopping();
+                    return 1;
+                });
+}
+
+void kis_datasource::stop_adaptive_hopping() {
+    if (hop_adaptive_timer_id > 0) {
+        timetracker->remove_timer(hop_adaptive_timer_id);
+        hop_adaptive_timer_id = -1;
+    }
+}
+
+void kis_datasource::update_adaptive_hopping() {
+    kis_lock_guard<kis_mutex> lk(ext_mutex, "datasource update_adaptive_hopping");
+
+    if (!get_source_running() || get_source_paused() || !get_source_hopping())
+        return;
+
+    std::vector<std::string> current;
+
+    for (const auto& c : *source_hop_vec)
+        current.push_back(get_tracker_value<std::string>(c));
+
+    if (current.size() == 0)
+        return;
+
+    kis_lock_guard<kis_mutex> alk(hop_adaptive_mutex, "datasource update_adaptive_hopping");
+
+    // The weighted list only repeats channels from the base list; a list with other 
+    // channels was configured by the user or the tracker, and becomes the new base
+    std::set<std::string> current_set(current.begin(), current.end());
+    std::set<std::string> base_set(hop_adaptive_base.begin(), hop_adaptive_base.end());
+
+    if (current_set != base_set) {
+        hop_adaptive_base.clear();
+        hop_adaptive_score.clear();
+
+        std::set<std::string> seen;
+
+        for (const auto& c : current) {
+            if (seen.insert(c).second)
+                hop_adaptive_base.push_back(c);
+        }
+    }
+
+    // Discoveries decay by half each update; silent channels get a single slot, 
+    // channels with traffic two, and channels with recent discoveries up to six
+    std::map<std::string, unsigned int> key_weights;
+
+    for (const auto& c : hop_adaptive_base) {
+        auto key = adaptive_channel_key(c);
+
+        if (key_weights.find(key) != key_weights.end())
+            continue;
+
+        unsigned int packets = 0, discoveries = 0;
+        auto ai = hop_adaptive_activity.find(key);
+
+        if (ai != hop_adaptive_activity.end()) {
+            packets = ai->second.first;
+            discoveries = ai->second.second;
+        }
+
+        auto& score = hop_adaptive_score[key];
+        score = score / 2 + discoveries;
+
+        if (packets == 0 && score < 1)
+            key_weights[key] = 1;
+        else
+            key_weights[key] = 2 + std::min(4, (int) std::log2(1 + score));
+    }
+
+    hop_adaptive_activity.clear();
+
+    std::vector<unsigned int> weights;
+
+    for (const auto& c : hop_adaptive_base)
+        weights.push_back(key_weights[adaptive_channel_key(c)]);
+
+    // Keep the list as short as possible
+    unsigned int div = weights[0];
+
+    for (auto w : weights) {
+        auto a = div, b = w;
+
+        while (b != 0) {
+            auto t = a % b;
+            a = b;
+            b = t;
+        }
+
+        div = a;
+    }
+
+    unsigned int total = 0;
+
+    for (auto& w : weights) {
+        w /= div;
+        total += w;
+    }
+
+    // Interleave repeated channels with a smooth weighted round robin so each
+    // channel's visits are spread across the list
+    std::vector<std::string> weighted;
+    std::vector<long> current_weight(weights.size(), 0);
+
+    for (unsigned int pos = 0; pos < total; pos++) {
+        size_t pick = 0;
+
+        for (size_t i = 0; i < weights.size(); i++) {
+            current_weight[i] += weights[i];
+
+            if (current_weight[i] > current_weight[pick])
+                pick = i;
+        }
+
+        current_weight[pick] -= total;
+        weighted.push_back(hop_adaptive_base[pick]);
+    }
+
+    if (weighted == current)
+        return;
+
+    auto vec = std::make_shared<tracker_element_vector>(source_hop_vec_id);
+
+    for (const auto& c : weighted)
+        vec->push_back(std::make_shared<tracker_element_string>(channel_entry_id, c));
+
+    // Shuffling the list would bunch up the repeated channels
+    send_configure_channel_hop(get_source_hop_rate(), vec, false, get_source_hop_offset(), 
+            next_transaction++, nullptr);
+}
+
 void kis_datasource::connect_remote(std::string in_definition, kis_datasource* in_remote, 
         bool in_tcp, configure_callback_t in_cb) {
     kis_lock_guard<kis_mutex> lk(ext_mutex, "datasource connect_remote");
@@ -590,6 +831,8 @@ void kis_datasource::close_external() {
         ping_timer_id = -1;
     }
 
+    stop_adaptive_hopping();
+
     auto evt = eventbus->get_eventbus_event(event_datasource_closed());
     evt->get_event_content()->insert(event_datasource_closed(), source_uuid);
     eventbus->publish(evt);
@@ -736,6 +979,34 @@ bool kis_datasource::parse_source_definition(std::string in_definition) {
     clobber_timestamp = get_definition_opt_bool("timestamp", 
             datasourcetracker->get_config_defaults()->get_remote_cap_timestamp());
 
+    hop_adaptive = get_definition_opt_bool("adaptive_hop",
+            datasourcetracker->get_config_defaults()->get_adaptive_hop());
+    hop_adaptive_interval = get_definition_opt_double("adaptive_hop_interval",
+            datasourcetracker->get_config_defaults()->get_adaptive_hop_interval());
+
+    if (hop_adaptive_interval == 0)
+        hop_adaptive_interval = 10;
+
+    // channel_dwell=channel:multiple,... 
+    hop_dwell.clear();
+
+    for (const auto& d : str_tokenize(get_definition_opt("channel_dwell"), ",")) {
+        auto sep = d.rfind(':');
+
+        if (sep == std::string::npos || sep == 0)
+            continue;
+
+        auto m = string_to_n_dfl<double>(d.substr(sep + 1), 0);
+
+        if (m <= 0) {
+            _MSG_ERROR("Ignoring invalid channel_dwell entry '{}' for source '{}', expected "
+                    "channel:multiple", d, get_source_name());
+            continue;
+        }
+
+        hop_dwell[d.substr(0, sep)] = m;
+    }
+
     set_source_info_antenna_type(get_definition_opt("info_antenna_type"));
     set_source_info_antenna_gain(get_definition_opt_double("info_antenna_gain", 0.0f));
     set_source_info_antenna_orientation(get_definition_opt_double("info_antenna_orientation", 0.0f));
@@ -879,6 +1150,22 @@ void kis_datasource::cancel_all_commands(std::string in_error) {
 
 bool kis_datasource::dispatch_rx_packet(const nonstd::string_view& command,
         uint32_t seqno, const nonstd::string_view& content) {
+    // Data is the overwhelming majority of traffic, so check for it before anything
+    // else
+    if (command.compare("KDSDATAREPORT") == 0) {
+        handle_packet_data_report(seqno, content);
+        return true;
+    } else if (command.compare(KIS_EXTERNAL_BATCH_CMD) == 0) {
+        handle_packet_data_batch(seqno, content);
+        return true;
+    } else if (command.compare(KIS_EXTERNAL_BATCH_Z_CMD) == 0) {
+        handle_packet_data_batch_z(seqno, content);
+        return true;
+    } else if (command.compare(KIS_EXTERNAL_SPECTRUM_CMD) == 0) {
+        handle_packet_spectrum(seqno, content);
+        return true;
+    }
+
     // Handle all the default options first; ping, pong, message, etc are all
     // handled for us by the overhead of the KismetExternal protocol, we only need
     // to worry about our specific ones
@@ -889,9 +1176,6 @@ bool kis_datasource::dispatch_rx_packet(const nonstd::string_view& command,
     if (command.compare("KDSCONFIGUREREPORT") == 0) {
         handle_packet_configure_report(seqno, content);
         return true;
-    } else if (command.compare("KDSDATAREPORT") == 0) {
-        handle_packet_data_report(seqno, content);
-        return true;
     } else if (command.compare("KDSERRORREPORT") == 0) {
         handle_packet_error_report(seqno, content);
         return true;
@@ -914,6 +1198,34 @@ bool kis_datasource::dispatch_rx_packet(const nonstd::string_view& command,
     return false;
 }
 
+bool kis_datasource::dispatch_rx_packet_id(uint32_t command_id, uint32_t seqno,
+        const nonstd::string_view& content) {
+    switch (command_id) {
+        case KIS_EXTERNAL_CMD_DATAREPORT:
+            handle_packet_data_report(seqno, content);
+            return true;
+        case KIS_EXTERNAL_CMD_DATABATCH:
+            handle_packet_data_batch(seqno, content);
+            return true;
+        case KIS_EXTERNAL_CMD_DATABATCHZ:
+            handle_packet_data_batch_z(seqno, content);
+            return true;
+        case KIS_EXTERNAL_CMD_SPECTRUM:
+            handle_packet_spectrum(seqno, content);
+            return true;
+        case KIS_EXTERNAL_CMD_CONFIGUREREPORT:
+            handle_packet_configure_report(seqno, content);
+            return true;
+        case KIS_EXTERNAL_CMD_WARNINGREPORT:
+            handle_packet_warning_report(seqno, content);
+            return true;
+        default:
+            break;
+    }
+
+    return kis_external_interface::dispatch_rx_packet_id(command_id, seqno, content);
+}
+
 void kis_datasource::handle_msg_proxy(const std::string& msg, const int type) {
     if (get_source_remote())
         _MSG(fmt::format("{} - {}", get_source_name(), msg), type);
@@ -1179,6 +1491,15 @@ void kis_datasource::handle_packet_opensource_report(uint32_t in_seqno,
     set_int_source_running(report.success().success());
     set_int_source_error(!report.success().success());
 
+    if (report.success().success() && hop_adaptive)
+        start_adaptive_hopping();
+
+    // The capture only knows the dwell table once we send it
+    if (report.success().success() && hop_dwell.size() && get_source_hopping() &&
+            !hop_adaptive)
+        send_configure_channel_hop(get_source_hop_rate(), source_hop_vec, 
+                get_source_hop_shuffle(), get_source_hop_offset(), next_transaction++, nullptr);
+
     uint32_t seq = report.success().seqno();
     auto ci = command_ack_map.find(seq);
     if (ci != command_ack_map.end()) {
@@ -1363,7 +1684,9 @@ void kis_datasource::handle_packet_data_report(uint32_t in_seqno,
             return;
     }
 
-    auto report = std::make_shared<KismetDatasource::DataReport>();
+    // Reports are pooled; the packet holds the report for the life of the packet so
+    // the packet data can reference the decoded report directly
+    auto report = Globalreg::new_from_pool<KismetDatasource::DataReport>();
 
     if (!report->ParseFromArray(in_content.data(), in_content.length())) {
         _MSG(std::string("Kismet datasource driver ") + get_source_builder()->get_source_type() + 
@@ -1379,8 +1702,19 @@ void kis_datasource::handle_packet_data_report(uint32_t in_seqno,
     if (report->has_warning())
         set_int_source_warning(report->warning());
 
+    if (report->has_capture_stats()) {
+        handle_sub_capture_stats(report->capture_stats());
+
+        // Reports which only carry counters have nothing for the packet chain
+        if (!report->has_packet() && !report->has_json() && !report->has_buffer() &&
+                !report->has_signal() && !report->has_gps())
+            return;
+    }
+
     auto packet = packetchain->generate_packet();
 
+    packet->data_owner = report;
+
     auto packreport = packetchain->new_packet_component<kis_packreport_packinfo>();
     packreport->set_report(report);
 
@@ -1431,11 +1765,456 @@ void kis_datasource::handle_packet_data_report(uint32_t in_seqno,
             packet->insert(pack_comp_gps, gpsinfo);
     }
 
-    // TODO handle spectrum
+    if (report->has_spectrum())
+        handle_sub_spectrum(report->spectrum());
    
     handle_rx_packet(packet);
 }
 
+void kis_datasource::handle_packet_data_batch(uint32_t in_seqno,
+        const nonstd::string_view& in_content) {
+    {
+        kis_lock_guard<kis_mutex> lk(ext_mutex, "datasource handle_packet_data_batch");
+
+        if (get_source_paused())
+            return;
+    }
+
+    // Copy the batch out of the socket buffer once; every packet in the batch references
+    // its slice of the shared copy, which is released when the last packet is freed
+    auto buf = packetchain->new_packet_buffer(in_content.length());
+    memcpy(buf->data(), in_content.data(), in_content.length());
+
+    handle_data_batch(buf, in_content.length());
+}
+
+void kis_datasource::handle_packet_data_batch_z(uint32_t in_seqno,
+        const nonstd::string_view& in_content) {
+    if (in_content.length() < sizeof(kismet_external_batch_z_t)) {
+        _MSG_ERROR("Kismet datasource driver {} could not parse a compressed batched data frame, "
+                "something is wrong with the remote capture tool", 
+                get_source_builder()->get_source_type());
+        trigger_error("Invalid KDSDATABATCHZ");
+        return;
+    }
+
+    auto zhdr = reinterpret_cast<const kismet_external_batch_z_t *>(in_content.data());
+
+    // Every compressed frame has to be inflated, even while paused, to keep the stream 
+    // in step with the capture tool
+    if (!batch_zstrm_init) {
+        memset(&batch_zstrm, 0, sizeof(z_stream));
+
+        if (inflateInit2(&batch_zstrm, -MAX_WBITS) != Z_OK) {
+            _MSG_ERROR("Kismet datasource driver {} could not initialize decompression",
+                    get_source_builder()->get_source_type());
+            trigger_error("Unable to initialize KDSDATABATCHZ decompression");
+            return;
+        }
+
+        batch_zstrm_init = true;
+    } else if (kis_ntoh16(zhdr->flags) & KIS_EXTERNAL_BATCH_Z_RESET) {
+        inflateReset(&batch_zstrm);
+    }
+
+    if (batch_zbuf.size() < KIS_EXTERNAL_BATCH_MAX_SZ)
+        batch_zbuf.resize(KIS_EXTERNAL_BATCH_MAX_SZ);
+
+    batch_zstrm.next_in = (Bytef *) zhdr->data;
+    batch_zstrm.avail_in = in_content.length() - sizeof(kismet_external_batch_z_t);
+    batch_zstrm.next_out = (Bytef *) batch_zbuf.data();
+    batch_zstrm.avail_out = batch_zbuf.size();
+
+    auto r = inflate(&batch_zstrm, Z_SYNC_FLUSH);
+
+    // A frame holds exactly one batch, so anything left over means the batch was larger
+    // than any batch we allow or the stream is corrupt
+    if ((r != Z_OK && r != Z_BUF_ERROR) || batch_zstrm.avail_in != 0) {
+        _MSG_ERROR("Kismet datasource driver {} could not decompress a batched data frame, "
+                "something is wrong with the remote capture tool", 
+                get_source_builder()->get_source_type());
+        trigger_error("Invalid KDSDATABATCHZ");
+        return;
+    }
+
+    size_t len = batch_zbuf.size() - batch_zstrm.avail_out;
+
+    {
+        kis_lock_guard<kis_mutex> lk(ext_mutex, "datasource handle_packet_data_batch_z");
+
+        if (get_source_paused())
+            return;
+    }
+
+    auto buf = packetchain->new_packet_buffer(len);
+    memcpy(buf->data(), batch_zbuf.data(), len);
+
+    handle_data_batch(buf, len);
+}
+
+void kis_datasource::handle_packet_spectrum(uint32_t in_seqno,
+        const nonstd::string_view& in_content) {
+    if (in_content.length() < sizeof(kismet_external_spectrum_t)) {
+        _MSG_ERROR("Kismet datasource driver {} could not parse a spectrum frame, something "
+                "is wrong with the remote capture tool", get_source_builder()->get_source_type());
+        trigger_error("Invalid KDSSPECTRUM");
+        return;
+    }
+
+    auto spec = reinterpret_cast<const kismet_external_spectrum_t *>(in_content.data());
+
+    if (kis_ntoh16(spec->version) != KIS_EXTERNAL_SPECTRUM_VERSION) {
+        _MSG_ERROR("Kismet datasource driver {} got a spectrum frame with an unsupported "
+                "version ({})", get_source_builder()->get_source_type(), kis_ntoh16(spec->version));
+        trigger_error("Unsupported KDSSPECTRUM version");
+        return;
+    }
+
+    auto format = kis_ntoh16(spec->format);
+    auto num_bins = kis_ntoh32(spec->num_bins);
+    size_t bin_sz = format == KIS_EXTERNAL_SPECTRUM_INT8 ? 1 : 4;
+
+    if ((format != KIS_EXTERNAL_SPECTRUM_INT8 && format != KIS_EXTERNAL_SPECTRUM_FLOAT32) ||
+            num_bins > KIS_EXTERNAL_SPECTRUM_MAX_BINS ||
+            in_content.length() < sizeof(kismet_external_spectrum_t) + num_bins * bin_sz) {
+        _MSG_ERROR("Kismet datasource driver {} could not parse a spectrum frame, something "
+                "is wrong with the remote capture tool", get_source_builder()->get_source_type());
+        trigger_error("Invalid KDSSPECTRUM");
+        return;
+    }
+
+    {
+        kis_lock_guard<kis_mutex> lk(ext_mutex, "datasource handle_packet_spectrum");
+
+        if (get_source_paused())
+            return;
+    }
+
+    auto ring = get_spectrum_ring();
+
+    kis_lock_guard<kis_mutex> lk(spectrum_mutex, "datasource handle_packet_spectrum");
+
+    spectrum_bins.resize(num_bins);
+
+    if (format == KIS_EXTERNAL_SPECTRUM_INT8) {
+        auto data = reinterpret_cast<const int8_t *>(spec->data);
+
+        for (uint32_t i = 0; i < num_bins; i++) {
+            if (data[i] == -128)
+                spectrum_bins[i] = NAN;
+            else
+                spectrum_bins[i] = KIS_EXTERNAL_SPECTRUM_INT8_BASE + data[i] / 2.0f;
+        }
+    } else {
+        for (uint32_t i = 0; i < num_bins; i++) {
+            uint32_t v;
+            memcpy(&v, spec->data + i * 4, 4);
+            v = kis_ntoh32(v);
+            memcpy(&spectrum_bins[i], &v, 4);
+        }
+    }
+
+    ring->add_sweep(kis_ntoh32(spec->ts_sec), kis_ntoh32(spec->ts_usec), kis_ntoh32(spec->sweep),
+            kis_ntoh64(spec->start_hz), kis_ntoh32(spec->bin_hz), spectrum_bins.data(), num_bins);
+}
+
+std::shared_ptr<spectrum_ring> kis_datasource::get_spectrum_ring() {
+    kis_lock_guard<kis_mutex> lk(spectrum_mutex, "datasource get_spectrum_ring");
+
+    if (spectrum == nullptr) {
+        auto format =
+            Globalreg::globalreg->kismet_config->fetch_opt_dfl("spectrum_bin_format", "int8");
+
+        spectrum = std::make_shared<spectrum_ring>(
+                std::max(Globalreg::globalreg->kismet_config->fetch_opt_uint("spectrum_ring_sweeps", 256), 1U),
+                std::max(Globalreg::globalreg->kismet_config->fetch_opt_uint("spectrum_max_bins", 2048), 1U),
+                format != "float32");
+    }
+
+    return spectrum;
+}
+
+// Is a datagram exactly one v2 or v3 packet data frame; anything else, including
+// commands, has no place outside the TCP connection
+static bool datagram_data_frame(const std::string& in_frame) {
+    if (in_frame.size() < sizeof(kismet_external_frame_v3_t))
+        return false;
+
+    auto frame_v2 = reinterpret_cast<const kismet_external_frame_v2_t *>(in_frame.data());
+
+    if (kis_ntoh32(frame_v2->signature) != KIS_EXTERNAL_PROTO_SIG ||
+            kis_ntoh16(frame_v2->v2_sentinel) != KIS_EXTERNAL_V2_SIG)
+        return false;
+
+    if (kis_ntoh16(frame_v2->frame_version) == 0x03) {
+        auto frame_v3 = reinterpret_cast<const kismet_external_frame_v3_t *>(frame_v2);
+        auto command_id = kis_ntoh32(frame_v3->command_id);
+
+        return (command_id == KIS_EXTERNAL_CMD_DATABATCH ||
+                command_id == KIS_EXTERNAL_CMD_DATAREPORT) &&
+            sizeof(kismet_external_frame_v3_t) + kis_ntoh32(frame_v3->data_sz) == in_frame.size();
+    }
+
+    if (kis_ntoh16(frame_v2->frame_version) == 0x02) {
+        if (in_frame.size() < sizeof(kismet_external_frame_v2_t))
+            return false;
+
+        nonstd::string_view command(frame_v2->command, 32);
+
+        auto trim_pos = command.find('\0');
+        if (trim_pos != command.npos)
+            command.remove_suffix(command.size() - trim_pos);
+
+        return (command == KIS_EXTERNAL_BATCH_CMD || command == "KDSDATAREPORT") &&
+            sizeof(kismet_external_frame_v2_t) + kis_ntoh32(frame_v2->data_sz) == in_frame.size();
+    }
+
+    return false;
+}
+
+void kis_datasource::handle_datagram(const boost::asio::ip::address& in_peer, uint32_t in_seqno,
+        std::shared_ptr<std::string> in_frame) {
+    auto ref = shared_from_this();
+
+    boost::asio::post(strand_,
+            [this, ref, in_peer, in_seqno, in_frame]() {
+                {
+                    kis_lock_guard<kis_mutex> lk(ext_mutex, "datasource handle_datagram");
+
+                    if (stopped || cancelled || datagram_token == 0 || in_peer != datagram_peer)
+                        return;
+                }
+
+                if (!get_source_running() || !datagram_data_frame(*in_frame))
+                    return;
+
+                // Late datagrams are processed when they arrive instead of holding back
+                // everything after them; a late datagram fills a gap counted as lost
+                if (!datagram_started) {
+                    datagram_started = true;
+                    datagram_next_seqno = in_seqno + 1;
+                } else {
+                    auto delta = static_cast<int32_t>(in_seqno - datagram_next_seqno);
+
+                    if (delta >= 0) {
+                        if (delta > 0)
+                            inc_int_source_datagrams_lost(delta);
+
+                        datagram_next_seqno = in_seqno + 1;
+                    } else {
+                        inc_int_source_datagrams_late();
+
+                        if (get_source_datagrams_lost() > 0)
+                            dec_int_source_datagrams_lost();
+                    }
+                }
+
+                inc_int_source_datagrams();
+
+                handle_external_command(boost::asio::buffer(in_frame->data(), in_frame->size()),
+                        in_frame->size());
+            });
+}
+
+void kis_datasource::handle_data_batch(std::shared_ptr<packet_data_buffer> buf, size_t len) {
+    if (len < sizeof(kismet_external_batch_t)) {
+        _MSG_ERROR("Kismet datasource driver {} could not parse a batched data frame, something "
+                "is wrong with the remote capture tool", get_source_builder()->get_source_type());
+        trigger_error("Invalid KDSDATABATCH");
+        return;
+    }
+
+    auto batch = reinterpret_cast<const kismet_external_batch_t *>(buf->data());
+
+    if (kis_ntoh16(batch->version) != KIS_EXTERNAL_BATCH_VERSION) {
+        _MSG_ERROR("Kismet datasource driver {} got a batched data frame with an unsupported "
+                "version ({})", get_source_builder()->get_source_type(), kis_ntoh16(batch->version));
+        trigger_error("Unsupported KDSDATABATCH version");
+        return;
+    }
+
+    auto num_packets = kis_ntoh16(batch->num_packets);
+
+    const char *data = buf->data();
+    size_t pos = sizeof(kismet_external_batch_t);
+
+    auto override_dlt = get_source_override_linktype();
+    bool clobber = clobber_timestamp && get_source_remote();
+
+    // The oldest packet in the batch waited the longest
+    struct timeval oldest_ts = {0, 0};
+
+    for (unsigned int i = 0; i < num_packets; i++) {
+        if (len - pos < sizeof(kismet_external_batch_record_t)) {
+            _MSG_ERROR("Kismet datasource driver {} got a truncated batched data frame",
+                    get_source_builder()->get_source_type());
+            trigger_error("Truncated KDSDATABATCH");
+            return;
+        }
+
+        auto rec = reinterpret_cast<const kismet_external_batch_record_t *>(data + pos);
+
+        auto channel_len = kis_ntoh16(rec->channel_len);
+        auto packet_sz = kis_ntoh32(rec->packet_sz);
+
+        pos += sizeof(kismet_external_batch_record_t);
+
+        if (len - pos < (size_t) channel_len + packet_sz) {
+            _MSG_ERROR("Kismet datasource driver {} got a truncated batched data frame",
+                    get_source_builder()->get_source_type());
+            trigger_error("Truncated KDSDATABATCH");
+            return;
+        }
+
+        auto packet = packetchain->generate_packet();
+
+        if (clobber) {
+            gettimeofday(&(packet->ts), NULL);
+        } else {
+            packet->ts.tv_sec = kis_ntoh32(rec->ts_sec);
+            packet->ts.tv_usec = kis_ntoh32(rec->ts_usec);
+
+            if (oldest_ts.tv_sec == 0 || timercmp(&(packet->ts), &oldest_ts, <))
+                oldest_ts = packet->ts;
+        }
+
+        auto datachunk = packetchain->new_packet_component<kis_datachunk>();
+
+        if (override_dlt)
+            datachunk->dlt = override_dlt;
+        else
+            datachunk->dlt = kis_ntoh32(rec->dlt);
+
+        auto original_sz = kis_ntoh32(rec->original_sz);
+        packet->original_len = original_sz == 0 ? packet_sz : original_sz;
+
+        packet->set_data_ref(buf, nonstd::string_view(data + pos + channel_len, packet_sz));
+        datachunk->set_data(packet->data);
+
+        packet->insert(pack_comp_linkframe, datachunk);
+
+        auto flags = kis_ntoh16(rec->flags);
+
+        if (flags != 0 || channel_len != 0) {
+            auto siginfo = packetchain->new_packet_component<kis_layer1_packinfo>();
+
+            if (flags & KIS_EXTERNAL_BATCH_SIGNAL_DBM) {
+                siginfo->signal_type = kis_l1_signal_type_dbm;
+                siginfo->signal_dbm = (int16_t) kis_ntoh16(rec->signal);
+            }
+
+            if (flags & KIS_EXTERNAL_BATCH_NOISE_DBM) {
+                siginfo->signal_type = kis_l1_signal_type_dbm;
+                siginfo->noise_dbm = (int16_t) kis_ntoh16(rec->noise);
+            }
+
+            if (flags & KIS_EXTERNAL_BATCH_SIGNAL_RSSI) {
+                siginfo->signal_type = kis_l1_signal_type_rssi;
+                siginfo->signal_rssi = (int16_t) kis_ntoh16(rec->signal);
+            }
+
+            if (flags & KIS_EXTERNAL_BATCH_NOISE_RSSI) {
+                siginfo->signal_type = kis_l1_signal_type_rssi;
+                siginfo->noise_rssi = (int16_t) kis_ntoh16(rec->noise);
+            }
+
+            if (flags & KIS_EXTERNAL_BATCH_FREQ)
+                siginfo->freq_khz = kis_ntoh32(rec->freq_khz);
+
+            if (flags & KIS_EXTERNAL_BATCH_DATARATE)
+                siginfo->datarate = (double) kis_ntoh32(rec->datarate) / 1000;
+
+            if (channel_len != 0)
+                siginfo->channel = std::string(data + pos, channel_len);
+
+            packet->insert(pack_comp_l1info, siginfo);
+        }
+
+        pos += channel_len + packet_sz;
+
+        if (suppress_gps) {
+            auto nogpsinfo = packetchain->new_packet_component<kis_no_gps_packinfo>();
+            packet->insert(pack_comp_no_gps, nogpsinfo);
+        } else if (device_gps != nullptr) {
+            auto gpsinfo = device_gps->get_location();
+
+            if (gpsinfo != nullptr)
+                packet->insert(pack_comp_gps, gpsinfo);
+        }
+
+        get_source_packet_size_rrd()->add_sample(packet_sz, Globalreg::globalreg->last_tv_sec);
+
+        handle_rx_packet(packet);
+    }
+
+    if (oldest_ts.tv_sec != 0) {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        add_latency_sample(oldest_ts, now);
+    }
+}
+
+void kis_datasource::handle_sub_capture_stats(const KismetDatasource::SubCaptureStats& in_stats) {
+    time_t now = Globalreg::globalreg->last_tv_sec;
+
+    // A capture which restarted begins counting again from zero
+    auto delta = [](uint64_t last, uint64_t cur) -> uint64_t {
+        return cur >= last ? cur - last : cur;
+    };
+
+    if (in_stats.has_kernel_packets())
+        set_int_source_kernel_packets(in_stats.kernel_packets());
+
+    if (in_stats.has_kernel_drops()) {
+        get_source_kernel_drop_rrd()->add_sample(delta(get_source_kernel_drops(), 
+                    in_stats.kernel_drops()), now);
+        set_int_source_kernel_drops(in_stats.kernel_drops());
+    }
+
+    if (in_stats.has_ringbuf_full()) {
+        get_source_ringbuf_full_rrd()->add_sample(delta(get_source_ringbuf_full(), 
+                    in_stats.ringbuf_full()), now);
+        set_int_source_ringbuf_full(in_stats.ringbuf_full());
+    }
+
+    if (in_stats.has_hop_count()) {
+        auto hops = delta(last_hop_count, in_stats.hop_count());
+
+        // Restarted captures start the totals over, too
+        if (in_stats.hop_count() < last_hop_count)
+            last_hop_dwell_total = last_hop_dwell_error_total = last_hop_switch_total = 0;
+
+        if (hops != 0) {
+            set_int_source_hop_dwell_usec(delta(last_hop_dwell_total, 
+                        in_stats.hop_dwell_usec()) / hops);
+            set_int_source_hop_dwell_error_usec(delta(last_hop_dwell_error_total, 
+                        in_stats.hop_dwell_error_usec()) / hops);
+            set_int_source_hop_switch_usec(delta(last_hop_switch_total, 
+                        in_stats.hop_switch_usec()) / hops);
+        }
+
+        set_int_source_hop_count(in_stats.hop_count());
+        set_int_source_hop_switch_max_usec(in_stats.hop_switch_max_usec());
+
+        last_hop_count = in_stats.hop_count();
+        last_hop_dwell_total = in_stats.hop_dwell_usec();
+        last_hop_dwell_error_total = in_stats.hop_dwell_error_usec();
+        last_hop_switch_total = in_stats.hop_switch_usec();
+    }
+}
+
+void kis_datasource::add_latency_sample(const struct timeval& in_captured,
+        const struct timeval& in_now) {
+    int64_t ms = (int64_t) (in_now.tv_sec - in_captured.tv_sec) * 1000 +
+        ((int64_t) in_now.tv_usec - (int64_t) in_captured.tv_usec) / 1000;
+
+    // Capture clocks ahead of ours can't be measured
+    if (ms < 0)
+        ms = 0;
+
+    get_source_latency_rrd()->add_sample(ms, in_now.tv_sec);
+}
+
 void kis_datasource::handle_rx_datalayer(std::shared_ptr<kis_packet> packet,
         const KismetDatasource::SubPacket& report) {
 
@@ -1446,6 +2225,10 @@ void kis_datasource::handle_rx_datalayer(std::shared_ptr<kis_packet> packet,
     } else {
         packet->ts.tv_sec = report.time_sec();
         packet->ts.tv_usec = report.time_usec();
+
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        add_latency_sample(packet->ts, now);
     }
 
     // Override the DLT if we have one
@@ -1464,7 +2247,9 @@ void kis_datasource::handle_rx_datalayer(std::shared_ptr<kis_packet> packet,
         packet->original_len = report.data().length();
     }
 
-    packet->set_data(report.data());
+    // The data report is held by the packet (see handle_packet_data_report), so
+    // reference the payload in place instead of copying it
+    packet->set_data_ref(packet->data_owner, report.data());
     datachunk->set_data(packet->data);
 
     get_source_packet_size_rrd()->add_sample(report.data().length(), Globalreg::globalreg->last_tv_sec);
@@ -1520,7 +2305,7 @@ void kis_datasource::handle_packet_warning_report(uint32_t in_seqno,
     set_int_source_warning(report.warning());
 }
 
-std::shared_ptr<kis_layer1_packinfo> kis_datasource::handle_sub_signal(KismetDatasource::SubSignal in_sig) {
+std::shared_ptr<kis_layer1_packinfo> kis_datasource::handle_sub_signal(const KismetDatasource::SubSignal& in_sig) {
     // Extract l1 info from a KV pair so we can add it to a packet
     auto siginfo = packetchain->new_packet_component<kis_layer1_packinfo>();
 
@@ -1556,7 +2341,28 @@ std::shared_ptr<kis_layer1_packinfo> kis_datasource::handle_sub_signal(KismetDat
     return siginfo;
 }
 
-std::shared_ptr<kis_gps_packinfo> kis_datasource::handle_sub_gps(KismetDatasource::SubGps in_gps) {
+void kis_datasource::handle_sub_spectrum(const KismetDatasource::SubSpectrum& in_spectrum) {
+    if (in_spectrum.data_size() == 0 ||
+            in_spectrum.data_size() > KIS_EXTERNAL_SPECTRUM_MAX_BINS)
+        return;
+
+    auto ring = get_spectrum_ring();
+
+    kis_lock_guard<kis_mutex> lk(spectrum_mutex, "datasource handle_sub_spectrum");
+
+    spectrum_bins.resize(in_spectrum.data_size());
+
+    for (int i = 0; i < in_spectrum.data_size(); i++)
+        spectrum_bins[i] = in_spectrum.data(i);
+
+    // Spectrum reports carry no sweep counter, so each report is a sweep of its own
+    ring->add_sweep(in_spectrum.time_sec(), in_spectrum.time_usec(), 
+            (uint32_t) ring->get_num_segments(), 
+            (uint64_t) (in_spectrum.start_mhz() * 1000000), in_spectrum.bucket_width_hz(),
+            spectrum_bins.data(), spectrum_bins.size());
+}
+
+std::shared_ptr<kis_gps_packinfo> kis_datasource::handle_sub_gps(const KismetDatasource::SubGps& in_gps) {
     // Extract a GPS record from a packet and turn it into a packinfo gps log
     auto gpsinfo = packetchain->new_packet_component<kis_gps_packinfo>();
 
@@ -1630,6 +2436,55 @@ unsigned int kis_datasource::send_open_source(std::string in_definition,
     KismetDatasource::OpenSource o;
     o.set_definition(in_definition);
 
+    // Offer batched data frames and v3 command ids; only v2 capture tools can send them,
+    // and older tools ignore the fields
+    if (protocol_version == 2) {
+        auto batch_bytes =
+            Globalreg::globalreg->kismet_config->fetch_opt_uint("datasource_batch_bytes", 16384);
+
+        if (batch_bytes > 0) {
+            o.set_batch_max_bytes(std::min(batch_bytes, (unsigned int) KIS_EXTERNAL_BATCH_MAX_SZ));
+            o.set_batch_flush_usec(Globalreg::globalreg->kismet_config->fetch_opt_uint("datasource_batch_flush_usec", 500));
+        }
+
+        o.set_command_table(KIS_EXTERNAL_CMD_TABLE_VERSION);
+
+        // Offer compressed batches to remote captures, which are often on slow links
+        if (batch_bytes > 0 && get_source_remote() &&
+                Globalreg::globalreg->kismet_config->fetch_opt_bool("remote_capture_compression", false)) {
+            o.set_compression(KIS_EXTERNAL_COMPRESSION_DEFLATE);
+            o.set_compression_level(std::min(Globalreg::globalreg->kismet_config->fetch_opt_uint("remote_capture_compression_level", 6), 9U));
+        }
+
+        // Offer datagram transport of batches to TCP remote captures on lossy links; the
+        // token is kept across reopens of the source
+        boost::system::error_code ec;
+        auto peer = tcpsocket.is_open() ? tcpsocket.remote_endpoint(ec) : tcp::endpoint{};
+
+        if (batch_bytes > 0 && get_source_remote() && tcpsocket.is_open() && !ec &&
+                Globalreg::globalreg->kismet_config->fetch_opt_bool("remote_capture_datagram", false)) {
+            if (datagram_token == 0) {
+                std::random_device rnd;
+                auto dist = std::uniform_int_distribution<uint64_t>(1, UINT64_MAX);
+                datagram_token = dist(rnd);
+
+                auto datasourcetracker =
+                    Globalreg::fetch_mandatory_global_as<datasource_tracker>("DATASOURCETRACKER");
+                datasourcetracker->register_datagram_source(datagram_token,
+                        std::static_pointer_cast<kis_datasource>(shared_from_this()));
+            }
+
+            datagram_peer = peer.address();
+            datagram_started = false;
+
+            o.set_datagram_token(datagram_token);
+            auto datagram_bytes =
+                Globalreg::globalreg->kismet_config->fetch_opt_uint("remote_capture_datagram_bytes", 1400);
+            o.set_datagram_max_bytes(std::min(std::max(datagram_bytes, 512U), 
+                        (unsigned int) REMOTE_DATAGRAM_MAX_SZ));
+        }
+    }
+
     if (protocol_version == 0) {
         std::shared_ptr<KismetExternal::Command> c(new KismetExternal::Command());
         c->set_command("KDSOPENSOURCE");
@@ -1728,6 +2583,13 @@ unsigned int kis_datasource::send_configure_channel_hop(double in_rate,
         ch->add_channels(get_tracker_value<std::string>(chi));
     }
 
+    if (hop_dwell.size()) {
+        for (auto chi : *in_chans) {
+            auto di = hop_dwell.find(get_tracker_value<std::string>(chi));
+            ch->add_dwell(di == hop_dwell.end() ? 1.0 : di->second);
+        }
+    }
+
     o.set_allocated_hopping(ch);
 
     if (protocol_version == 0) {
@@ -1874,6 +2736,74 @@ void kis_datasource::register_fields() {
                 "received data RRD (in bytes)",
                 &packet_size_rrd);
 
+    register_field("kismet.datasource.kernel_packets",
+            "Packets received by the kernel capture socket, if known", &source_kernel_packets);
+    register_field("kismet.datasource.kernel_drops",
+            "Packets dropped by the kernel before the capture read them, if known", 
+            &source_kernel_drops);
+    register_field("kismet.datasource.ringbuf_full",
+            "Packets which found the capture ringbuffer to Kismet full", &source_ringbuf_full);
+
+    register_field("kismet.datasource.datagrams",
+            "Packet datagrams received from a remote capture", &source_datagrams);
+    register_field("kismet.datasource.datagrams_lost",
+            "Packet datagrams from a remote capture missing from the sequence", 
+            &source_datagrams_lost);
+    register_field("kismet.datasource.datagrams_late",
+            "Packet datagrams from a remote capture received out of order",
+            &source_datagrams_late);
+
+    register_field("kismet.datasource.hop_count", "Channel hops, if reported", &source_hop_count);
+    register_field("kismet.datasource.hop_dwell_usec", 
+            "Average time spent on a channel between hops (us)", &source_hop_dwell_usec);
+    register_field("kismet.datasource.hop_dwell_error_usec", 
+            "Average difference between the scheduled and actual channel dwell (us)",
+            &source_hop_dwell_error_usec);
+    register_field("kismet.datasource.hop_switch_usec",
+            "Average time taken to switch channels (us)", &source_hop_switch_usec);
+    register_field("kismet.datasource.hop_switch_max_usec",
+            "Longest time taken to switch channels (us)", &source_hop_switch_max_usec);
+
+    register_field("kismet.datasource.ingest_thread",
+            "Ingest thread the source connection runs on, or -1 for the shared IO threads",
+            &source_ingest_thread);
+    register_field("kismet.datasource.sample_data_packets",
+            "Data frames eligible for sampling", &source_sample_frames);
+    register_field("kismet.datasource.sample_processed_packets",
+            "Sampled data frames which were fully processed", &source_sample_processed);
+    register_field("kismet.datasource.sample_ratio",
+            "Current data frame sampling ratio (1 in N), or 1 when not sampling",
+            &source_sample_ratio);
+
+    register_field("kismet.datasource.ingest_reads",
+            "Reads processed from the capture", &source_ingest_reads);
+    register_field("kismet.datasource.ingest_read_usec",
+            "Average time spent processing a read from the capture (us)",
+            &source_ingest_read_usec);
+    register_field("kismet.datasource.ingest_read_max_usec",
+            "Longest time spent processing a read from the capture in the last minute (us)",
+            &source_ingest_read_max_usec);
+
+    kernel_drop_rrd_id =
+        register_dynamic_field("kismet.datasource.kernel_drops_rrd",
+                "kernel capture drop RRD",
+                &kernel_drop_rrd);
+
+    ringbuf_full_rrd_id =
+        register_dynamic_field("kismet.datasource.ringbuf_full_rrd",
+                "capture ringbuffer overflow RRD",
+                &ringbuf_full_rrd);
+
+    chain_drop_rrd_id =
+        register_dynamic_field("kismet.datasource.chain_drops_rrd",
+                "packets shed by the packet chain RRD",
+                &chain_drop_rrd);
+
+    latency_rrd_id =
+        register_dynamic_field("kismet.datasource.capture_latency_rrd",
+                "worst capture to server delay RRD (in ms)",
+                &latency_rrd);
+
     register_field("kismet.datasource.retry", 
             "Source will try to re-open after failure", &source_retry);
     register_field("kismet.datasource.retry_attempts", 
@@ -1911,6 +2841,8 @@ void kis_datasource::handle_source_error() {
         ping_timer_id = -1;
     }
 
+    stop_adaptive_hopping();
+
     // Do nothing if we don't handle retry
     if (get_source_remote()) {
         if (get_source_running()) {
@@ -2031,6 +2963,10 @@ bool kis_datasource::launch_ipc() {
 
     external_binary = get_source_ipc_binary();
 
+    // Local capture tools may write directly into a shared memory ring instead of the pipe
+    ipc_shm_ring_sz =
+        (size_t) Globalreg::globalreg->kismet_config->fetch_opt_uint("ipc_shm_ring_kb", 0) * 1024;
+
     if (run_ipc()) {
         set_int_source_ipc_pid(ipc.pid);
         return true;
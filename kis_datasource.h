@@ -21,7 +21,11 @@
 
 #include "config.h"
 
+#include <atomic>
 #include <functional>
+#include <map>
+
+#include <zlib.h>
 
 #include "globalregistry.h"
 #include "kis_mutex.h"
@@ -52,6 +56,7 @@ class datasource_tracker;
 class kis_datasource;
 
 class kis_gps;
+class spectrum_ring;
 
 class kis_packreport_packinfo : public packet_component {
 public:
@@ -307,6 +312,27 @@ public:
     virtual void set_channel_hop_list(std::vector<std::string> in_chans, 
             unsigned int in_transaction, configure_callback_t in_cb);
 
+    // Record packets and discoveries (new devices, handshakes) seen by this source on a
+    // channel; with adaptive hopping, channels with recent discoveries are visited more
+    // often and silent channels less
+    void record_channel_activity(const std::string& in_channel, unsigned int in_packets,
+            unsigned int in_discoveries);
+
+    bool get_source_hop_adaptive() const {
+        return hop_adaptive;
+    }
+
+    // Count a data frame eligible for sampling (see packet_chain) and return the 1-in-N
+    // ratio the source samples data frames at: the fixed ratio, or with a target rate,
+    // the ratio which keeps the fully processed data frames of the source to about that
+    // many per second over the last second, whichever is higher
+    unsigned int count_sample_frame(time_t in_now, unsigned int in_fixed_ratio,
+            unsigned int in_target_rate);
+
+    void count_sample_processed() {
+        sample_processed.fetch_add(1, std::memory_order_relaxed);
+    }
+
 
     // Instantiate from an incoming remote; caller must then assign tcpsocket or callbacks and trigger
     // a datasource open
@@ -398,6 +424,47 @@ public:
     __ProxyDynamicTrackableM(source_packet_size_rrd, kis_tracked_rrd<>, 
             packet_size_rrd, packet_size_rrd_id, data_mutex);
 
+    // Where packets are lost: in the kernel before the capture read them, in the 
+    // capture ringbuffer to Kismet, or shed by the packet chain
+    __ProxyGetM(source_kernel_packets, uint64_t, uint64_t, source_kernel_packets, data_mutex);
+    __ProxyGetM(source_kernel_drops, uint64_t, uint64_t, source_kernel_drops, data_mutex);
+    __ProxyGetM(source_ringbuf_full, uint64_t, uint64_t, source_ringbuf_full, data_mutex);
+
+    // Packet datagrams from a remote capture: received, missing from the sequence, and
+    // received after a later datagram.  A late datagram fills a gap counted as lost.
+    __ProxyGetM(source_datagrams, uint64_t, uint64_t, source_datagrams, data_mutex);
+    __ProxyGetM(source_datagrams_lost, uint64_t, uint64_t, source_datagrams_lost, data_mutex);
+    __ProxyGetM(source_datagrams_late, uint64_t, uint64_t, source_datagrams_late, data_mutex);
+
+    // Channel hop timing reported by the capture; averages are over the last stats
+    // report
+    __ProxyGetM(source_hop_count, uint64_t, uint64_t, source_hop_count, data_mutex);
+    __ProxyGetM(source_hop_dwell_usec, uint64_t, uint64_t, source_hop_dwell_usec, data_mutex);
+    __ProxyGetM(source_hop_dwell_error_usec, uint64_t, uint64_t, 
+            source_hop_dwell_error_usec, data_mutex);
+    __ProxyGetM(source_hop_switch_usec, uint64_t, uint64_t, source_hop_switch_usec, data_mutex);
+    __ProxyGetM(source_hop_switch_max_usec, uint64_t, uint64_t, 
+            source_hop_switch_max_usec, data_mutex);
+
+    // Ingest thread group the source connection runs on, and the time spent processing
+    // reads from the capture; updated when the source is serialized
+    __ProxyGetM(source_ingest_thread, int32_t, int32_t, source_ingest_thread, data_mutex);
+    __ProxyGetM(source_ingest_reads, uint64_t, uint64_t, source_ingest_reads, data_mutex);
+    __ProxyGetM(source_ingest_read_usec, uint64_t, uint64_t, source_ingest_read_usec, data_mutex);
+    __ProxyGetM(source_ingest_read_max_usec, uint64_t, uint64_t, 
+            source_ingest_read_max_usec, data_mutex);
+
+    __ProxyDynamicTrackableM(source_kernel_drop_rrd, kis_tracked_rrd<>,
+            kernel_drop_rrd, kernel_drop_rrd_id, data_mutex);
+    __ProxyDynamicTrackableM(source_ringbuf_full_rrd, kis_tracked_rrd<>,
+            ringbuf_full_rrd, ringbuf_full_rrd_id, data_mutex);
+    __ProxyDynamicTrackableM(source_chain_drop_rrd, kis_tracked_rrd<>,
+            chain_drop_rrd, chain_drop_rrd_id, data_mutex);
+
+    // Worst delay between the capture timestamp and the packet reaching Kismet, in ms
+    __ProxyDynamicTrackableM(source_latency_rrd, kis_tracked_rrd<kis_tracked_rrd_extreme_aggregator>,
+            latency_rrd, latency_rrd_id, data_mutex);
+
     // IPC binary name, if any
     __ProxyGetM(source_ipc_binary, std::string, std::string, source_ipc_binary, data_mutex);
     // IPC channel pid, if any
@@ -441,6 +508,14 @@ public:
 
     virtual void pre_serialize() override {
         kis_lock_guard<kis_mutex> lk(data_mutex, kismet::retain_lock, "datasource preserialize");
+
+        source_ingest_reads->set(ingest_reads.load(std::memory_order_relaxed));
+        source_ingest_read_usec->set(ingest_read_usec.load(std::memory_order_relaxed));
+        source_ingest_read_max_usec->set(ingest_read_max_usec.load(std::memory_order_relaxed));
+
+        source_sample_frames->set(sample_frames.load(std::memory_order_relaxed));
+        source_sample_processed->set(sample_processed.load(std::memory_order_relaxed));
+        source_sample_ratio->set(sample_ratio.load(std::memory_order_relaxed));
     }
 
     virtual void post_serialize() override {
@@ -477,6 +552,15 @@ public:
     virtual void set_device_gps(std::shared_ptr<kis_gps> in_gps);
     virtual void clear_device_gps();
 
+    // Ring of recent spectrum sweeps reported by the source, created on first use
+    std::shared_ptr<spectrum_ring> get_spectrum_ring();
+
+    // Handle a packet datagram from a remote capture (see remote_announcement.h); it is
+    // dropped unless it came from the host of the TCP connection the token was offered
+    // on and holds a single data frame, and is otherwise processed on the source strand
+    void handle_datagram(const boost::asio::ip::address& in_peer, uint32_t in_seqno,
+            std::shared_ptr<std::string> in_frame);
+
 protected:
     // Mutex for data elements
     kis_mutex data_mutex;
@@ -575,11 +659,16 @@ protected:
     // Central packet dispatch override to add the datasource commands
     virtual bool dispatch_rx_packet(const nonstd::string_view& command,
             uint32_t seqno, const nonstd::string_view& content) override;
+    virtual bool dispatch_rx_packet_id(uint32_t command_id, uint32_t seqno,
+            const nonstd::string_view& content) override;
 
     virtual void handle_msg_proxy(const std::string& msg, const int type) override;
 
     virtual void handle_packet_configure_report(uint32_t in_seqno, const nonstd::string_view& in_packet);
     virtual void handle_packet_data_report(uint32_t in_seqno, const nonstd::string_view& in_packet);
+    virtual void handle_packet_data_batch(uint32_t in_seqno, const nonstd::string_view& in_packet);
+    virtual void handle_packet_data_batch_z(uint32_t in_seqno, const nonstd::string_view& in_packet);
+    virtual void handle_packet_spectrum(uint32_t in_seqno, const nonstd::string_view& in_packet);
     virtual void handle_packet_error_report(uint32_t in_seqno, const nonstd::string_view& in_packet);
     virtual void handle_packet_interfaces_report(uint32_t in_seqno, const nonstd::string_view& in_packet);
     virtual void handle_packet_opensource_report(uint32_t in_seqno, const nonstd::string_view& in_packet);
@@ -600,8 +689,9 @@ protected:
 
     // Break out packet generation sub-functions so that custom datasources can easily
     // piggyback onto the decoders
-    virtual std::shared_ptr<kis_gps_packinfo> handle_sub_gps(KismetDatasource::SubGps in_gps);
-    virtual std::shared_ptr<kis_layer1_packinfo> handle_sub_signal(KismetDatasource::SubSignal in_signal);
+    virtual std::shared_ptr<kis_gps_packinfo> handle_sub_gps(const KismetDatasource::SubGps& in_gps);
+    virtual std::shared_ptr<kis_layer1_packinfo> handle_sub_signal(const KismetDatasource::SubSignal& in_signal);
+    virtual void handle_sub_spectrum(const KismetDatasource::SubSpectrum& in_spectrum);
 
 
     // Launch the IPC binary
@@ -697,6 +787,79 @@ protected:
     int packet_size_rrd_id;
     std::shared_ptr<kis_tracked_rrd<>> packet_size_rrd;
 
+    __ProxySetM(int_source_kernel_packets, uint64_t, uint64_t, source_kernel_packets, data_mutex);
+    __ProxySetM(int_source_kernel_drops, uint64_t, uint64_t, source_kernel_drops, data_mutex);
+    __ProxySetM(int_source_ringbuf_full, uint64_t, uint64_t, source_ringbuf_full, data_mutex);
+    std::shared_ptr<tracker_element_uint64> source_kernel_packets;
+    std::shared_ptr<tracker_element_uint64> source_kernel_drops;
+    std::shared_ptr<tracker_element_uint64> source_ringbuf_full;
+
+    __ProxyIncDecM(int_source_datagrams, uint64_t, uint64_t, source_datagrams, data_mutex);
+    __ProxyIncDecM(int_source_datagrams_lost, uint64_t, uint64_t, source_datagrams_lost, data_mutex);
+    __ProxyIncDecM(int_source_datagrams_late, uint64_t, uint64_t, source_datagrams_late, data_mutex);
+    std::shared_ptr<tracker_element_uint64> source_datagrams;
+    std::shared_ptr<tracker_element_uint64> source_datagrams_lost;
+    std::shared_ptr<tracker_element_uint64> source_datagrams_late;
+
+    // Datagram transport offered to a remote capture in KDSOPENSOURCE: the token routing
+    // datagrams to this source, the address of the connection it was offered on, and the
+    // next datagram expected.  Protected by ext_mutex; the sequence is only used on the
+    // strand.
+    uint64_t datagram_token;
+    boost::asio::ip::address datagram_peer;
+    uint32_t datagram_next_seqno;
+    bool datagram_started;
+
+    __ProxySetM(int_source_hop_count, uint64_t, uint64_t, source_hop_count, data_mutex);
+    __ProxySetM(int_source_hop_dwell_usec, uint64_t, uint64_t, source_hop_dwell_usec, data_mutex);
+    __ProxySetM(int_source_hop_dwell_error_usec, uint64_t, uint64_t, 
+            source_hop_dwell_error_usec, data_mutex);
+    __ProxySetM(int_source_hop_switch_usec, uint64_t, uint64_t, source_hop_switch_usec, data_mutex);
+    __ProxySetM(int_source_hop_switch_max_usec, uint64_t, uint64_t, 
+            source_hop_switch_max_usec, data_mutex);
+    std::shared_ptr<tracker_element_uint64> source_hop_count;
+    std::shared_ptr<tracker_element_uint64> source_hop_dwell_usec;
+    std::shared_ptr<tracker_element_uint64> source_hop_dwell_error_usec;
+    std::shared_ptr<tracker_element_uint64> source_hop_switch_usec;
+    std::shared_ptr<tracker_element_uint64> source_hop_switch_max_usec;
+
+    std::shared_ptr<tracker_element_int32> source_ingest_thread;
+    std::shared_ptr<tracker_element_uint64> source_ingest_reads;
+    std::shared_ptr<tracker_element_uint64> source_ingest_read_usec;
+    std::shared_ptr<tracker_element_uint64> source_ingest_read_max_usec;
+
+    // Data frame sampling counters, and the published copies updated when the source
+    // is serialized
+    std::atomic<uint64_t> sample_frames, sample_processed;
+    std::atomic<unsigned int> sample_ratio;
+    std::atomic<time_t> sample_window;
+    std::atomic<uint64_t> sample_window_frames;
+
+    std::shared_ptr<tracker_element_uint64> source_sample_frames;
+    std::shared_ptr<tracker_element_uint64> source_sample_processed;
+    std::shared_ptr<tracker_element_uint32> source_sample_ratio;
+
+    // Hop timing totals of the last stats report, to average over the interval
+    uint64_t last_hop_count, last_hop_dwell_total, last_hop_dwell_error_total, 
+             last_hop_switch_total;
+
+    int kernel_drop_rrd_id;
+    std::shared_ptr<kis_tracked_rrd<>> kernel_drop_rrd;
+
+    int ringbuf_full_rrd_id;
+    std::shared_ptr<kis_tracked_rrd<>> ringbuf_full_rrd;
+
+    int chain_drop_rrd_id;
+    std::shared_ptr<kis_tracked_rrd<>> chain_drop_rrd;
+
+    int latency_rrd_id;
+    std::shared_ptr<kis_tracked_rrd<kis_tracked_rrd_extreme_aggregator>> latency_rrd;
+
+    // Capture counters are totals since the capture opened; the RRDs get the difference
+    virtual void handle_sub_capture_stats(const KismetDatasource::SubCaptureStats& in_stats);
+
+    void add_latency_sample(const struct timeval& in_captured, const struct timeval& in_now);
+
 
     // Local ID number is an increasing number assigned to each 
     // unique UUID; it's used inside Kismet for fast mapping for seenby, 
@@ -735,6 +898,24 @@ protected:
     // Timer ID for trying to recover from an error
     int error_timer_id;
 
+    // Adaptive hopping; activity is counted per channel between updates, and the hop
+    // list is built from the base list the source was configured with
+    std::atomic<bool> hop_adaptive;
+    unsigned int hop_adaptive_interval;
+    int hop_adaptive_timer_id;
+    kis_mutex hop_adaptive_mutex;
+    std::map<std::string, std::pair<unsigned int, unsigned int>> hop_adaptive_activity;
+    std::map<std::string, double> hop_adaptive_score;
+    std::vector<std::string> hop_adaptive_base;
+
+    // Dwell of channels as a multiple of the hop period, from channel_dwell=; sent with
+    // every hop configuration, channels not listed dwell for one period
+    std::map<std::string, double> hop_dwell;
+
+    void start_adaptive_hopping();
+    void stop_adaptive_hopping();
+    void update_adaptive_hopping();
+
     // Function that gets called when we encounter an error; allows for scheduling
     // bringup, etc
     virtual void handle_source_error();
@@ -785,6 +966,20 @@ protected:
     // We suppress automatically adding GPS to packets from this source
     bool suppress_gps;
 
+    // Turn a batch payload, already copied into a packet buffer, into packets
+    void handle_data_batch(std::shared_ptr<packet_data_buffer> buf, size_t len);
+
+    // Inflate stream for KDSDATABATCHZ frames, started over each time the source is
+    // opened, and the scratch buffer batches are inflated into
+    z_stream batch_zstrm;
+    bool batch_zstrm_init;
+    std::vector<char> batch_zbuf;
+
+    // Spectrum sweeps, and the scratch buffer incoming bins are converted into
+    kis_mutex spectrum_mutex;
+    std::shared_ptr<spectrum_ring> spectrum;
+    std::vector<float> spectrum_bins;
+
     // packet_chain
     std::shared_ptr<packet_chain> packetchain;
 
@@ -0,0 +1,59 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include "configfile.h"
+#include "globalregistry.h"
+#include "kis_dissection_profile.h"
+#include "messagebus.h"
+#include "util.h"
+
+kis_dissection_profile fetch_dissection_profile(const std::string& in_phy_prefix) {
+    std::string profile;
+
+    if (in_phy_prefix.length() > 0)
+        profile = Globalreg::globalreg->kismet_config->fetch_opt(in_phy_prefix + "_dissection_profile");
+
+    if (profile.length() == 0)
+        profile = Globalreg::globalreg->kismet_config->fetch_opt_dfl("dissection_profile", "forensic");
+
+    profile = str_lower(profile);
+
+    if (profile == "survey")
+        return kis_dissection_profile::survey;
+    else if (profile == "wids")
+        return kis_dissection_profile::wids;
+    else if (profile != "forensic")
+        _MSG_ERROR("Unknown dissection profile '{}', expected survey, wids, or forensic; "
+                "using forensic.", profile);
+
+    return kis_dissection_profile::forensic;
+}
+
+std::string dissection_profile_to_string(kis_dissection_profile in_profile) {
+    switch (in_profile) {
+        case kis_dissection_profile::survey:
+            return "survey";
+        case kis_dissection_profile::wids:
+            return "wids";
+        default:
+            return "forensic";
+    }
+}
+
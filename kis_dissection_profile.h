@@ -0,0 +1,48 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_DISSECTION_PROFILE_H__
+#define __KIS_DISSECTION_PROFILE_H__
+
+#include "config.h"
+
+#include <string>
+
+// Dissection profiles select how much of each packet the phys decode.
+//
+// survey   - devices, SSIDs, and basic capabilities only; no data frame
+//            contents, no EAPOL retention, and no alert-only decoding
+// wids     - everything the alerts need, but none of the detail only shown
+//            in the UI
+// forensic - everything (the default)
+//
+// The profile only changes the defaults of the individual dissection options;
+// any option set explicitly in the config still wins.
+enum class kis_dissection_profile {
+    survey, wids, forensic
+};
+
+// Profile for a phy; the per-phy option {prefix}_dissection_profile (such as
+// dot11_dissection_profile) overrides the global dissection_profile.  An empty
+// prefix fetches the global profile.  Unknown profiles fall back to forensic.
+kis_dissection_profile fetch_dissection_profile(const std::string& in_phy_prefix);
+
+std::string dissection_profile_to_string(kis_dissection_profile in_profile);
+
+#endif
+
@@ -26,8 +26,16 @@
 #include "packetchain.h"
 #include "alertracker.h"
 
+#include "configfile.h"
+#include "entrytracker.h"
 #include "kis_dissector_ipdata.h"
+#include "kis_net_beast_httpd.h"
 #include "phy_80211_packetsignatures.h"
+#include "xxhash.h"
+
+std::size_t kis_ipdata_flow_key_hash::operator()(const kis_ipdata_flow_key& k) const {
+    return XXH32(&k, sizeof(k), 0);
+}
 
 int get_length_tag_offsets(unsigned int init_offset, 
         std::shared_ptr<kis_datachunk> in_chunk, std::map<int, std::vector<int> > *tag_cache_map) {
@@ -106,6 +114,136 @@ kis_dissector_ip_data::kis_dissector_ip_data() {
                 "MAC of the packet.  A client which fails to do so may "
                 "be attempting to exhaust the DHCP pool with spoofed requests.");
 
+    flow_mutex.set_name("kis_dissector_ip_data flows");
+
+    flow_table_size =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("ipdata_flow_table_size", 1024);
+
+    auto entrytracker =
+        Globalreg::fetch_mandatory_global_as<entry_tracker>();
+
+    flow_vec_id =
+        entrytracker->register_field("kismet.ipdata.flows",
+                tracker_element_factory<tracker_element_vector>(),
+                "recent IP flows");
+    flow_client_id =
+        entrytracker->register_field("kismet.ipdata.flow.client",
+                tracker_element_factory<tracker_element_mac_addr>(),
+                "transmitting client");
+    flow_ip_proto_id =
+        entrytracker->register_field("kismet.ipdata.flow.ip_proto",
+                tracker_element_factory<tracker_element_uint8>(),
+                "IP protocol");
+    flow_source_ip_id =
+        entrytracker->register_field("kismet.ipdata.flow.source_ip",
+                tracker_element_factory<tracker_element_ipv4_addr>(),
+                "source IP");
+    flow_dest_ip_id =
+        entrytracker->register_field("kismet.ipdata.flow.dest_ip",
+                tracker_element_factory<tracker_element_ipv4_addr>(),
+                "destination IP");
+    flow_source_port_id =
+        entrytracker->register_field("kismet.ipdata.flow.source_port",
+                tracker_element_factory<tracker_element_uint16>(),
+                "source port");
+    flow_dest_port_id =
+        entrytracker->register_field("kismet.ipdata.flow.dest_port",
+                tracker_element_factory<tracker_element_uint16>(),
+                "destination port");
+    flow_packets_id =
+        entrytracker->register_field("kismet.ipdata.flow.packets",
+                tracker_element_factory<tracker_element_uint64>(),
+                "packets");
+    flow_bytes_id =
+        entrytracker->register_field("kismet.ipdata.flow.bytes",
+                tracker_element_factory<tracker_element_uint64>(),
+                "payload bytes");
+    flow_first_time_id =
+        entrytracker->register_field("kismet.ipdata.flow.first_time",
+                tracker_element_factory<tracker_element_uint64>(),
+                "first time seen");
+    flow_last_time_id =
+        entrytracker->register_field("kismet.ipdata.flow.last_time",
+                tracker_element_factory<tracker_element_uint64>(),
+                "last time seen");
+
+    auto httpd =
+        Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
+
+    httpd->register_route("/ipdata/flows", {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection>) {
+                    return flows_endp_handler();
+                }));
+}
+
+bool kis_dissector_ip_data::update_flow(const kis_ipdata_flow_key& in_key,
+        const mac_addr& in_client, size_t in_bytes, time_t in_ts) {
+    if (flow_table_size == 0)
+        return true;
+
+    kis_lock_guard<kis_mutex> lk(flow_mutex, "kis_dissector_ip_data update_flow");
+
+    auto fi = flow_map.find(in_key);
+
+    if (fi != flow_map.end()) {
+        // Move to the front of the LRU
+        flow_lru.splice(flow_lru.begin(), flow_lru, fi->second);
+
+        auto& flow = *(fi->second);
+        flow.packets++;
+        flow.bytes += in_bytes;
+        flow.last_time = in_ts;
+
+        return false;
+    }
+
+    // Re-use the least recently seen flow once the table is full
+    if (flow_lru.size() >= flow_table_size) {
+        flow_map.erase(flow_lru.back().key);
+        flow_lru.splice(flow_lru.begin(), flow_lru, std::prev(flow_lru.end()));
+    } else {
+        flow_lru.emplace_front();
+    }
+
+    auto& flow = flow_lru.front();
+    flow.key = in_key;
+    flow.client = in_client;
+    flow.packets = 1;
+    flow.bytes = in_bytes;
+    flow.first_time = flow.last_time = in_ts;
+
+    flow_map[in_key] = flow_lru.begin();
+
+    return true;
+}
+
+std::shared_ptr<tracker_element> kis_dissector_ip_data::flows_endp_handler() {
+    auto ret = std::make_shared<tracker_element_vector>(flow_vec_id);
+
+    kis_lock_guard<kis_mutex> lk(flow_mutex, "kis_dissector_ip_data flows_endp_handler");
+
+    for (const auto& f : flow_lru) {
+        in_addr source, dest;
+        source.s_addr = f.key.source_addr;
+        dest.s_addr = f.key.dest_addr;
+
+        auto fmap = std::make_shared<tracker_element_map>();
+        fmap->insert(std::make_shared<tracker_element_mac_addr>(flow_client_id, f.client));
+        fmap->insert(std::make_shared<tracker_element_uint8>(flow_ip_proto_id, f.key.ip_proto));
+        fmap->insert(std::make_shared<tracker_element_ipv4_addr>(flow_source_ip_id, source));
+        fmap->insert(std::make_shared<tracker_element_ipv4_addr>(flow_dest_ip_id, dest));
+        fmap->insert(std::make_shared<tracker_element_uint16>(flow_source_port_id, f.key.source_port));
+        fmap->insert(std::make_shared<tracker_element_uint16>(flow_dest_port_id, f.key.dest_port));
+        fmap->insert(std::make_shared<tracker_element_uint64>(flow_packets_id, f.packets));
+        fmap->insert(std::make_shared<tracker_element_uint64>(flow_bytes_id, f.bytes));
+        fmap->insert(std::make_shared<tracker_element_uint64>(flow_first_time_id, f.first_time));
+        fmap->insert(std::make_shared<tracker_element_uint64>(flow_last_time_id, f.last_time));
+
+        ret->push_back(fmap);
+    }
+
+    return ret;
 }
 
 kis_dissector_ip_data::~kis_dissector_ip_data() {
@@ -329,6 +467,19 @@ int kis_dissector_ip_data::handle_packet(std::shared_ptr<kis_packet> in_pack) {
 		memcpy(&addr, &(chunk->data()[IP_OFFSET + 7]), 4);
 		datainfo->ip_dest_addr.s_addr = kis_hton32(addr);
 
+		kis_ipdata_flow_key flow_key;
+		flow_key.client = common->source.longmac;
+		flow_key.source_addr = datainfo->ip_source_addr.s_addr;
+		flow_key.dest_addr = datainfo->ip_dest_addr.s_addr;
+		flow_key.source_port = datainfo->ip_source_port;
+		flow_key.dest_port = datainfo->ip_dest_port;
+		flow_key.ip_proto = 17;
+
+		// Payloads of known flows aren't parsed again, except for DHCP where
+		// every packet matters for the spoofing alert
+		bool inspect_payload = update_flow(flow_key, common->source,
+				chunk->length(), in_pack->ts.tv_sec);
+
 #if 0
 		if (datainfo->ip_source_port == IAPP_PORT &&
 			datainfo->ip_dest_port == IAPP_PORT &&
@@ -542,7 +693,8 @@ int kis_dissector_ip_data::handle_packet(std::shared_ptr<kis_packet> in_pack) {
 		}
 
 		// MDNS extractor
-		if (datainfo->ip_source_port == 5353 &&
+		if (inspect_payload &&
+			datainfo->ip_source_port == 5353 &&
 			datainfo->ip_dest_port == 5353) {
 			uint16_t mdns_flag_response = (1 << 15);
 
@@ -686,6 +838,16 @@ mdns_end:
 
 		datainfo->proto = proto_tcp;
 
+		kis_ipdata_flow_key flow_key;
+		flow_key.client = common->source.longmac;
+		flow_key.source_addr = datainfo->ip_source_addr.s_addr;
+		flow_key.dest_addr = datainfo->ip_dest_addr.s_addr;
+		flow_key.source_port = datainfo->ip_source_port;
+		flow_key.dest_port = datainfo->ip_dest_port;
+		flow_key.ip_proto = 6;
+
+		update_flow(flow_key, common->source, chunk->length(), in_pack->ts.tv_sec);
+
 		/*
 		if (datainfo->ip_source_port == PPTP_PORT || 
 			datainfo->ip_dest_port == PPTP_PORT) {
@@ -21,9 +21,47 @@
 
 #include "config.h"
 
+#include <time.h>
+
+#include <list>
+#include <unordered_map>
+
 #include "globalregistry.h"
+#include "kis_mutex.h"
 #include "packet.h"
 #include "packetchain.h"
+#include "trackedelement.h"
+
+// IP flow seen in data frames, keyed by the transmitting client and the 5-tuple
+struct kis_ipdata_flow_key {
+    uint64_t client;
+    uint32_t source_addr;
+    uint32_t dest_addr;
+    uint16_t source_port;
+    uint16_t dest_port;
+    uint32_t ip_proto;
+
+    bool operator==(const kis_ipdata_flow_key& k) const {
+        return client == k.client && source_addr == k.source_addr &&
+            dest_addr == k.dest_addr && source_port == k.source_port &&
+            dest_port == k.dest_port && ip_proto == k.ip_proto;
+    }
+};
+
+struct kis_ipdata_flow_key_hash {
+    std::size_t operator()(const kis_ipdata_flow_key& k) const;
+};
+
+struct kis_ipdata_flow {
+    kis_ipdata_flow_key key;
+    mac_addr client;
+
+    uint64_t packets;
+    uint64_t bytes;
+
+    time_t first_time;
+    time_t last_time;
+};
 
 class kis_dissector_ip_data : public lifetime_global {
 public:
@@ -47,6 +85,24 @@ public:
 protected:
 	int pack_comp_datapayload, pack_comp_basicdata, pack_comp_common;
 	int alert_dhcpclient_ref;
+
+    // LRU table of recent flows; the front is the most recently seen
+    kis_mutex flow_mutex;
+    std::list<kis_ipdata_flow> flow_lru;
+    std::unordered_map<kis_ipdata_flow_key, std::list<kis_ipdata_flow>::iterator,
+        kis_ipdata_flow_key_hash> flow_map;
+    size_t flow_table_size;
+
+    // Count a packet against its flow; returns true if this is the first packet
+    // of the flow (or the table is disabled) and the payload should be inspected
+    bool update_flow(const kis_ipdata_flow_key& in_key, const mac_addr& in_client,
+            size_t in_bytes, time_t in_ts);
+
+    int flow_vec_id, flow_client_id, flow_ip_proto_id, flow_source_ip_id,
+        flow_dest_ip_id, flow_source_port_id, flow_dest_port_id, flow_packets_id,
+        flow_bytes_id, flow_first_time_id, flow_last_time_id;
+
+    std::shared_ptr<tracker_element> flows_endp_handler();
 };
 
 #endif
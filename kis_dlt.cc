@@ -37,7 +37,7 @@ kis_dlt_handler::kis_dlt_handler() :
         packetchain->register_handler([this](std::shared_ptr<kis_packet> p) -> int {
                     return handle_packet(p);
                 },
-                CHAINPOS_POSTCAP, 0);
+                CHAINPOS_POSTCAP, 0, "dlt handle_packet");
 
 	pack_comp_linkframe =
 		packetchain->register_packet_component("LINKFRAME");
@@ -35,9 +35,11 @@ public:
 	virtual int fetch_dlt() { return dlt; }
 	virtual std::string fetch_dlt_name() { return dlt_name; }
 
-protected:
+	// Decapsulate a packet; normally only called from the packet chain
 	virtual int handle_packet(std::shared_ptr<kis_packet> in_pack) = 0;
 
+protected:
+
 	std::string dlt_name;
 	int dlt;
 	int chainid;
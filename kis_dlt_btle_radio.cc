@@ -28,6 +28,7 @@
 #include "kis_datasource.h"
 
 #include "kis_dlt_btle_radio.h"
+#include "phy_btle.h"
 
 kis_dlt_btle_radio::kis_dlt_btle_radio() :
     kis_dlt_handler() {
@@ -49,7 +50,7 @@ int kis_dlt_btle_radio::handle_packet(std::shared_ptr<kis_packet> in_pack) {
         uint8_t payload[0];
     } __attribute__((packed)) btle_rf;
 
-    // const uint16_t btle_rf_flag_dewhitened = (1 << 0);
+    const uint16_t btle_rf_flag_dewhitened = (1 << 0);
     const uint16_t btle_rf_flag_signalvalid = (1 << 1);
     const uint16_t btle_rf_flag_noisevalid = (1 << 2);
     // const uint16_t btle_rf_flag_reference_access_valid = (1 << 5);
@@ -120,10 +121,20 @@ int kis_dlt_btle_radio::handle_packet(std::shared_ptr<kis_packet> in_pack) {
 
     in_pack->insert(pack_comp_radiodata, radioheader);
 
-    // TODO handle dewhitening
-    
     auto decapchunk = std::make_shared<kis_datachunk>();
-    decapchunk->set_data(in_pack->data.substr(sizeof(btle_rf), in_pack->data.length() - sizeof(btle_rf)));
+
+    if (flags & btle_rf_flag_dewhitened) {
+        decapchunk->set_data(in_pack->data.substr(sizeof(btle_rf), in_pack->data.length() - sizeof(btle_rf)));
+    } else {
+        // Everything after the access address is whitened
+        auto ll_len = linkchunk->length() - sizeof(btle_rf);
+        std::string ll(reinterpret_cast<const char *>(rf_ll->payload), ll_len);
+
+        kis_btle_phy::dewhiten(rf_ll->monitor_channel, ll.data() + 4, &ll[4], ll_len - 4);
+
+        decapchunk->copy_raw_data(ll);
+    }
+
     decapchunk->dlt = KDLT_BLUETOOTH_LE_LL;
     in_pack->insert(pack_comp_decap, decapchunk);
 
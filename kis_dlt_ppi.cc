@@ -26,6 +26,7 @@
 #include "messagebus.h"
 #include "packet.h"
 #include "packetchain.h"
+#include "crc32.h"
 
 #include "kis_datasource.h"
 
@@ -287,27 +288,22 @@ int kis_dlt_ppi::handle_packet(std::shared_ptr<kis_packet> in_pack) {
         in_pack->insert(pack_comp_checksum, fcschunk);
     }
 
-    // We've put the FCS in the fcschunk, so we just call the datasource FCS function
+    // PPI only encapsulates 802.11 here, so the FCS can be checked locally the same
+    // way as radiotap
     if (datasrc != NULL && datasrc->ref_source != NULL && fcschunk != NULL &&
             fcschunk->checksum_valid) {
-        datasrc->ref_source->checksum_packet(in_pack);
-    }
-
-#if 0
-    if (capsrc != NULL && capsrc->ref_source->FetchValidateCRC() && fcschunk != NULL) {
-        // Compare it and flag the packet
-        uint32_t calc_crc =
-            crc32_le_80211(globalreg->crc32_table, decapchunk->data, 
-                    decapchunk->length);
+        uint32_t calc_crc = crc32_hw(decapchunk->data(), decapchunk->length());
+        uint32_t flipped_crc = kis_swap32(calc_crc);
 
-        if (memcmp(fcschunk->checksum_ptr, &calc_crc, 4)) {
-            in_pack->error = 1;
+        // compare both representations
+        if (memcmp(fcschunk->data(), &calc_crc, 4) && memcmp(fcschunk->data(), &flipped_crc, 4))
             fcschunk->checksum_valid = 0;
-        } else {
+        else
             fcschunk->checksum_valid = 1;
-        }
     }
-#endif
+
+    if (fcschunk != NULL && fcschunk->checksum_valid == 0)
+        in_pack->error = 1;
 
 
     return 1;
@@ -20,12 +20,15 @@
 
 #include "config.h"
 
+#include <vector>
+
 #include "globalregistry.h"
 #include "util.h"
 #include "endian_magic.h"
 #include "messagebus.h"
 #include "packet.h"
 #include "packetchain.h"
+#include "crc32.h"
 
 #if defined(SYS_OPENBSD) || defined(SYS_NETBSD)
 #include <net80211/ieee80211.h>
@@ -72,8 +75,7 @@ kis_dlt_radiotap::kis_dlt_radiotap() :
 	dlt = DLT_IEEE802_11_RADIO;
 
 	_MSG("Registering support for DLT_RADIOTAP packet header decoding", MSGFLAG_INFO);
-
-    crc32_init_table_80211(crc32_table);
+    _MSG_INFO("Validating packet FCS with {} CRC32", crc32_hw_name());
 }
 
 #define ALIGN_OFFSET(offset, width) \
@@ -127,6 +129,146 @@ kis_dlt_radiotap::kis_dlt_radiotap() :
 #define BITNO_4(x) (((x) >> 2) ? 2 + BITNO_2((x) >> 2) : BITNO_2((x)))
 #define BITNO_2(x) (((x) & 2) ? 1 : 0)
 #define BIT(n)	(1 << n)
+
+namespace {
+
+// A field the parse plan extracts; fields we only need to skip over are folded
+// into the offsets
+struct radiotap_plan_field {
+    enum ieee80211_radiotap_presence bit;
+    unsigned int record;
+    unsigned int offset;
+    unsigned int size;
+};
+
+// Compiled layout of one sequence of presence words.  Field offsets only depend
+// on the presence words, so once a layout has been seen every later frame with
+// the same presence words is read through fixed offsets.
+struct radiotap_plan {
+    std::vector<uint32_t> presence;
+    std::vector<radiotap_plan_field> fields;
+};
+
+// Sources only emit a handful of layouts
+#define RADIOTAP_PLAN_CACHE_MAX     16
+
+void build_radiotap_plan(radiotap_plan& plan, const std::vector<uint32_t>& presence) {
+    plan.presence = presence;
+    plan.fields.clear();
+
+    // Fields start after the version, pad, length, and the presence words, and are
+    // aligned from the start of the header
+    unsigned int offset = 4 + (4 * presence.size());
+    unsigned int bit0 = 0;
+    unsigned int record = 0;
+
+    for (auto p : presence) {
+        uint32_t present, next_present;
+
+        for (present = p; present; present = next_present) {
+            unsigned int align = 1, size = 0;
+            bool extract = false;
+
+            /* clear the least significant bit that is set */
+            next_present = present & (present - 1);
+
+            /* extract the least significant bit that is set */
+            auto bit = (enum ieee80211_radiotap_presence) ((bit0 + BITNO_32(present ^ next_present)) % 32);
+
+            switch (bit) {
+                case IEEE80211_RADIOTAP_FLAGS:
+                case IEEE80211_RADIOTAP_RATE:
+                case IEEE80211_RADIOTAP_ANTENNA:
+                case IEEE80211_RADIOTAP_DBM_ANTSIGNAL:
+                case IEEE80211_RADIOTAP_DBM_ANTNOISE:
+                    size = 1;
+                    extract = true;
+                    break;
+                case IEEE80211_RADIOTAP_DBM_TX_POWER:
+                    size = 1;
+                    break;
+                case IEEE80211_RADIOTAP_CHANNEL:
+                    align = 2;
+                    size = 4;
+                    extract = true;
+                    break;
+                case IEEE80211_RADIOTAP_FHSS:
+                case IEEE80211_RADIOTAP_LOCK_QUALITY:
+                case IEEE80211_RADIOTAP_TX_ATTENUATION:
+                case IEEE80211_RADIOTAP_DB_TX_ATTENUATION:
+                case IEEE80211_RADIOTAP_RX_FLAGS:
+                    align = 2;
+                    size = 2;
+                    break;
+                case IEEE80211_RADIOTAP_TSFT:
+                    align = 8;
+                    size = 8;
+                    break;
+#if defined(SYS_OPENBSD)
+                case IEEE80211_RADIOTAP_RSSI:
+                    size = 2;
+                    extract = true;
+                    break;
+#endif
+                case IEEE80211_RADIOTAP_VHT:
+                    /* TODO actually handle this data */
+                    align = 2;
+                    size = 12;
+                    break;
+                case IEEE80211_RADIOTAP_MCS:
+                    /* TODO actually handle this data! */
+                    size = 3;
+                    break;
+                case IEEE80211_RADIOTAP_RADIOTAP_NAMESPACE:
+                case IEEE80211_RADIOTAP_EXT:
+                    /* Do nothing but acknowledge it */
+                    break;
+                default:
+                    /* this bit indicates a field whose
+                     * size we do not know, so we cannot
+                     * proceed.
+                     */
+                    next_present = 0;
+                    continue;
+            }
+
+            offset += ALIGN_OFFSET(offset, align);
+
+            if (extract)
+                plan.fields.push_back(radiotap_plan_field{bit, record, offset, size});
+
+            offset += size;
+        }
+
+        bit0 += 32;
+        record++;
+    }
+}
+
+const radiotap_plan& fetch_radiotap_plan(const std::vector<uint32_t>& presence) {
+    // Plans are per packet thread, so they never need a lock
+    static thread_local std::vector<radiotap_plan> plans;
+    static thread_local unsigned int next_plan = 0;
+
+    for (const auto& p : plans) {
+        if (p.presence == presence)
+            return p;
+    }
+
+    if (plans.size() < RADIOTAP_PLAN_CACHE_MAX) {
+        plans.emplace_back();
+        build_radiotap_plan(plans.back(), presence);
+        return plans.back();
+    }
+
+    auto& plan = plans[next_plan];
+    next_plan = (next_plan + 1) % RADIOTAP_PLAN_CACHE_MAX;
+    build_radiotap_plan(plan, presence);
+    return plan;
+}
+
+}
+
 int kis_dlt_radiotap::handle_packet(std::shared_ptr<kis_packet> in_pack) {
     if (in_pack->has(pack_comp_decap))
         return 1;
@@ -148,36 +290,10 @@ int kis_dlt_radiotap::handle_packet(std::shared_ptr<kis_packet> in_pack) {
 		return 1;
 	}
 
-	union {
-		int8_t	i8;
-		int16_t	i16;
-		u_int8_t	u8;
-		u_int16_t	u16;
-		u_int32_t	u32;
-		u_int64_t	u64;
-	} u;
-	union {
-		int8_t		i8;
-		int16_t		i16;
-		u_int8_t	u8;
-		u_int16_t	u16;
-		u_int32_t	u32;
-		u_int64_t	u64;
-	} u2;
-
-	u2.u64 = 0;
-
 	const struct ieee80211_radiotap_header *hdr;
-	u_int32_t present, next_present;
-	const u_int32_t *presentp, *last_presentp;
-	enum ieee80211_radiotap_presence bit;
-	int bit0;
-	const u_char *iter;
-	const u_char *iter_start;
-	unsigned int iter_align;
+	const u_int32_t *last_presentp;
 	int fcs_cut = 0; // Is the FCS bit set?
     bool fcs_flag_invalid = false; // Do we have a flag that tells us the fcs is known bad?
-    int record_num = 0;
 
     std::shared_ptr<kis_layer1_packinfo> radioheader;
 
@@ -191,11 +307,18 @@ int kis_dlt_radiotap::handle_packet(std::shared_ptr<kis_packet> in_pack) {
         return 0;
     }
 
+    auto it_len = EXTRACT_LE_16BITS(&(hdr->it_len));
+
+    // Collect the presence words; they're the key of the parse plan
+    static thread_local std::vector<uint32_t> presence;
+    presence.clear();
+
 	// null-statement for-loop
     for (last_presentp = &hdr->it_present;
          (EXTRACT_LE_32BITS(last_presentp) & BIT(IEEE80211_RADIOTAP_EXT)) != 0 &&
-         (const u_char *) (last_presentp + 1) <= (const u_char *) linkchunk->data() + 
-         EXTRACT_LE_16BITS(&(hdr->it_len)); last_presentp++);
+         (const u_char *) (last_presentp + 1) <= (const u_char *) linkchunk->data() + it_len;
+         last_presentp++)
+        presence.push_back(EXTRACT_LE_32BITS(last_presentp));
 
     /* are there more bitmap extensions than bytes in header? */
     if ((EXTRACT_LE_32BITS(last_presentp) & BIT(IEEE80211_RADIOTAP_EXT)) != 0) {
@@ -204,188 +327,28 @@ int kis_dlt_radiotap::handle_packet(std::shared_ptr<kis_packet> in_pack) {
         return 0;
     }
 
+    presence.push_back(EXTRACT_LE_32BITS(last_presentp));
+
+    const auto& plan = fetch_radiotap_plan(presence);
+
     auto decapchunk = packetchain->new_packet_component<kis_datachunk>();
     radioheader = packetchain->new_packet_component<kis_layer1_packinfo>();
 
 	decapchunk->dlt = KDLT_IEEE802_11;
-	
-    iter = (const u_char*) (last_presentp + 1); 
-    // Alignment in Radiotap must be done from the beginning of the header, 
-    // not from the byte following the last bitmap. 
-    iter_start = (const u_char*) (linkchunk->data()); 
-
-    bool assigned_signal = false;
-
-    for (bit0 = 0, presentp = &hdr->it_present; presentp <= last_presentp; presentp++, bit0 += 32) {
-        // printf("record num %d\n", record_num);
-        // printf("present %x\n", *presentp);
-        
-        int record_antenna = -1;
-        int record_signal = 0;
-        bool signal_present = false;
-
-        for (present = EXTRACT_LE_32BITS(presentp); present; present = next_present) {
-            /* clear the least significant bit that is set */
-            next_present = present & (present - 1);
-
-            /* extract the least significant bit that is set */
-            bit = (enum ieee80211_radiotap_presence) ((bit0 + BITNO_32(present ^ next_present)) % 32);
-
-            // printf("record %d bit %d\n", record_num, bit);
-
-            switch (bit) {
-                case IEEE80211_RADIOTAP_FLAGS:
-                case IEEE80211_RADIOTAP_RATE:
-                case IEEE80211_RADIOTAP_ANTENNA:
-                case IEEE80211_RADIOTAP_DBM_ANTSIGNAL:
-                case IEEE80211_RADIOTAP_DBM_ANTNOISE:
-                    u.u8 = *iter++;
-                    break;
-                case IEEE80211_RADIOTAP_DBM_TX_POWER:
-                    u.i8 = *iter++;
-                    break;
-                case IEEE80211_RADIOTAP_CHANNEL:
-					iter_align = ALIGN_OFFSET((unsigned int) (iter - iter_start), 2);
-					iter += iter_align;
-
-                    u.u16 = EXTRACT_LE_16BITS(iter);
-                    iter += sizeof(u.u16);
-                    u2.u16 = EXTRACT_LE_16BITS(iter);
-                    iter += sizeof(u2.u16);
-                    break;
-                case IEEE80211_RADIOTAP_FHSS:
-                case IEEE80211_RADIOTAP_LOCK_QUALITY:
-                case IEEE80211_RADIOTAP_TX_ATTENUATION:
-                case IEEE80211_RADIOTAP_DB_TX_ATTENUATION:
-					iter_align = ALIGN_OFFSET((unsigned int) (iter - iter_start), 2);
-					iter += iter_align;
-
-                    u.u16 = EXTRACT_LE_16BITS(iter);
-                    iter += sizeof(u.u16);
-                    break;
-                case IEEE80211_RADIOTAP_TSFT:
-					iter_align = ALIGN_OFFSET((unsigned int) (iter - iter_start), 8);
-					iter += iter_align;
 
-                    u.u64 = EXTRACT_LE_64BITS(iter);
-                    iter += sizeof(u.u64);
-                    break;
-#if defined(SYS_OPENBSD)
-                case IEEE80211_RADIOTAP_RSSI:
-                    u.u8 = EXTRACT_LE_8BITS(iter);
-                    iter += sizeof(u.u8);
-                    u2.u8 = EXTRACT_LE_8BITS(iter);
-                    iter += sizeof(u2.u8);
-                    break;
-#endif
-                case IEEE80211_RADIOTAP_RX_FLAGS:
-					iter_align = ALIGN_OFFSET((unsigned int) (iter - iter_start), 2);
-					iter += iter_align;
-
-                    u.u16 = EXTRACT_LE_16BITS(iter);
-                    iter += sizeof(u.u16);
-                    break;
-                case IEEE80211_RADIOTAP_VHT:
-                    /* TODO actually handle this data */
-                    iter_align = ALIGN_OFFSET((unsigned int) (iter - iter_start), 2);
-                    iter += iter_align;
-
-                    iter += 12;
-                    break;
-                case IEEE80211_RADIOTAP_MCS:
-                    /* TODO actually handle this data! */
-                    iter += 3;
-                    break;
-
-                case IEEE80211_RADIOTAP_RADIOTAP_NAMESPACE:
-                    /* Do nothing but acknowledge it */
-                    break;
-
-                case IEEE80211_RADIOTAP_EXT:
-                    /* Do nothing but acknowledge it */
-                    break;
-
-                default:
-                    /* this bit indicates a field whose
-                     * size we do not know, so we cannot
-                     * proceed.
-                     */
-                    // printf("Unknown bit %d\n", bit);
-                    next_present = 0;
-                    continue;
-            }
-
-			// static int pnum = 0;
-            switch (bit) {
-                case IEEE80211_RADIOTAP_CHANNEL:
-                    // radioheader->channel = ieee80211_mhz2ieee(u.u16, u2.u16);
-                    radioheader->freq_khz = (double) u.u16 * 1000;
-					// printf("debug - %d freq %u\n", pnum++, radioheader->freq_mhz);
-                    if (IEEE80211_IS_CHAN_FHSS(u2.u16))
-                        radioheader->carrier = carrier_80211fhss;
-                    else if (IEEE80211_IS_CHAN_A(u2.u16))
-                        radioheader->carrier = carrier_80211a;
-                    else if (IEEE80211_IS_CHAN_BPLUS(u2.u16))
-                        radioheader->carrier = carrier_80211bplus;
-                    else if (IEEE80211_IS_CHAN_B(u2.u16))
-                        radioheader->carrier = carrier_80211b;
-                    else if (IEEE80211_IS_CHAN_PUREG(u2.u16))
-                        radioheader->carrier = carrier_80211g;
-                    else if (IEEE80211_IS_CHAN_G(u2.u16))
-                        radioheader->carrier = carrier_80211g;
-                    else if (IEEE80211_IS_CHAN_T(u2.u16))
-                        radioheader->carrier = carrier_80211a;/*XXX*/
-                    else
-                        radioheader->carrier = carrier_unknown;
-                    if ((u2.u16 & IEEE80211_CHAN_CCK) == IEEE80211_CHAN_CCK)
-                        radioheader->encoding = encoding_cck;
-                    else if ((u2.u16 & IEEE80211_CHAN_OFDM) == IEEE80211_CHAN_OFDM)
-                        radioheader->encoding = encoding_ofdm;
-                    else if ((u2.u16 & IEEE80211_CHAN_DYN) == IEEE80211_CHAN_DYN)
-                        radioheader->encoding = encoding_dynamiccck;
-                    else if ((u2.u16 & IEEE80211_CHAN_GFSK) == IEEE80211_CHAN_GFSK)
-                        radioheader->encoding = encoding_gfsk;
-                    else
-                        radioheader->encoding = encoding_unknown;
-                    break;
-                case IEEE80211_RADIOTAP_RATE:
-					/* strip basic rate bit & convert to kismet units */
-                    radioheader->datarate = ((float) (u.u8 &~ 0x80) / 2) * 10;
-                    break;
-                case IEEE80211_RADIOTAP_ANTENNA:
-                    record_antenna = u.u8;
-                    break;
-				case IEEE80211_RADIOTAP_DBM_ANTSIGNAL:
-                    record_signal = u.i8;
-                    signal_present = true;
-					break;
-				case IEEE80211_RADIOTAP_DBM_ANTNOISE:
-                    radioheader->signal_type = kis_l1_signal_type_dbm;
-					radioheader->noise_dbm = u.i8;
-					break;
-                case IEEE80211_RADIOTAP_FLAGS:
-                    if (u.u8 & IEEE80211_RADIOTAP_F_FCS) {
-						fcs_cut = 4;
-					}
+    // Alignment in Radiotap is done from the beginning of the header, which the
+    // plan offsets are relative to
+    auto iter_start = reinterpret_cast<const u_char *>(linkchunk->data());
 
-                    if (u.u8 & IEEE80211_RADIOTAP_F_BADFCS) {
-                        fcs_flag_invalid = true;
-                    }
+    bool assigned_signal = false;
 
-                    break;
-#if defined(SYS_OPENBSD)
-                case IEEE80211_RADIOTAP_RSSI:
-                    /* Convert to Kismet units...  No reason to use RSSI units
-					 * here since we know the conversion factor */
-                    radioheader->signal_type = kis_l1_signal_type_dbm;
-                    radioheader->signal_dbm = int((float(u.u8) / float(u2.u8) * 255));
-                    break;
-#endif
-                default:
-                    break;
-            }
-        }
+    // Antenna and signal are paired per presence word
+    unsigned int record_num = 0;
+    int record_antenna = -1;
+    int record_signal = 0;
+    bool signal_present = false;
 
+    auto commit_record = [&]() {
         if (signal_present) {
             // If we haven't assigned a signal, assign the first one we see as the
             // overall signal level
@@ -401,11 +364,105 @@ int kis_dlt_radiotap::handle_packet(std::shared_ptr<kis_packet> in_pack) {
             }
         }
 
-        record_num++;
+        record_antenna = -1;
+        record_signal = 0;
+        signal_present = false;
+    };
+
+    for (const auto& f : plan.fields) {
+        // Don't read fields the header claims but doesn't have room for
+        if (f.offset + f.size > it_len)
+            break;
+
+        if (f.record != record_num) {
+            commit_record();
+            record_num = f.record;
+        }
+
+        auto iter = iter_start + f.offset;
+
+        switch (f.bit) {
+            case IEEE80211_RADIOTAP_CHANNEL: {
+                auto freq = EXTRACT_LE_16BITS(iter);
+                auto flags = EXTRACT_LE_16BITS(iter + 2);
+
+                // radioheader->channel = ieee80211_mhz2ieee(u.u16, u2.u16);
+                radioheader->freq_khz = (double) freq * 1000;
+                if (IEEE80211_IS_CHAN_FHSS(flags))
+                    radioheader->carrier = carrier_80211fhss;
+                else if (IEEE80211_IS_CHAN_A(flags))
+                    radioheader->carrier = carrier_80211a;
+                else if (IEEE80211_IS_CHAN_BPLUS(flags))
+                    radioheader->carrier = carrier_80211bplus;
+                else if (IEEE80211_IS_CHAN_B(flags))
+                    radioheader->carrier = carrier_80211b;
+                else if (IEEE80211_IS_CHAN_PUREG(flags))
+                    radioheader->carrier = carrier_80211g;
+                else if (IEEE80211_IS_CHAN_G(flags))
+                    radioheader->carrier = carrier_80211g;
+                else if (IEEE80211_IS_CHAN_T(flags))
+                    radioheader->carrier = carrier_80211a;/*XXX*/
+                else
+                    radioheader->carrier = carrier_unknown;
+                if ((flags & IEEE80211_CHAN_CCK) == IEEE80211_CHAN_CCK)
+                    radioheader->encoding = encoding_cck;
+                else if ((flags & IEEE80211_CHAN_OFDM) == IEEE80211_CHAN_OFDM)
+                    radioheader->encoding = encoding_ofdm;
+                else if ((flags & IEEE80211_CHAN_DYN) == IEEE80211_CHAN_DYN)
+                    radioheader->encoding = encoding_dynamiccck;
+                else if ((flags & IEEE80211_CHAN_GFSK) == IEEE80211_CHAN_GFSK)
+                    radioheader->encoding = encoding_gfsk;
+                else
+                    radioheader->encoding = encoding_unknown;
+                break;
+            }
+            case IEEE80211_RADIOTAP_RATE:
+                /* strip basic rate bit & convert to kismet units */
+                radioheader->datarate = ((float) (*iter &~ 0x80) / 2) * 10;
+                break;
+            case IEEE80211_RADIOTAP_ANTENNA:
+                record_antenna = *iter;
+                break;
+            case IEEE80211_RADIOTAP_DBM_ANTSIGNAL:
+                record_signal = (int8_t) *iter;
+                signal_present = true;
+                break;
+            case IEEE80211_RADIOTAP_DBM_ANTNOISE:
+                radioheader->signal_type = kis_l1_signal_type_dbm;
+                radioheader->noise_dbm = (int8_t) *iter;
+                break;
+            case IEEE80211_RADIOTAP_FLAGS:
+                if (*iter & IEEE80211_RADIOTAP_F_FCS) {
+                    fcs_cut = 4;
+                }
+
+                if (*iter & IEEE80211_RADIOTAP_F_BADFCS) {
+                    fcs_flag_invalid = true;
+                }
+
+                break;
+#if defined(SYS_OPENBSD)
+            case IEEE80211_RADIOTAP_RSSI:
+                /* Convert to Kismet units...  No reason to use RSSI units
+                 * here since we know the conversion factor */
+                radioheader->signal_type = kis_l1_signal_type_dbm;
+                radioheader->signal_dbm = int((float(iter[0]) / float(iter[1]) * 255));
+                break;
+#endif
+            default:
+                break;
+        }
     }
 
-    auto offset = EXTRACT_LE_16BITS(&(hdr->it_len));
-    
+    commit_record();
+
+    auto offset = it_len;
+
+    // Sources which only send the headers of data frames cut off the FCS along with
+    // the payload
+    if (in_pack->original_len > linkchunk->length())
+        fcs_cut = 0;
+
     if (fcs_cut && offset + fcs_cut > (int) linkchunk->length()) {
         return 0;
 	}
@@ -450,8 +507,7 @@ int kis_dlt_radiotap::handle_packet(std::shared_ptr<kis_packet> in_pack) {
         fcschunk->checksum_valid) {
 
 		// Compare it and flag the packet
-		uint32_t calc_crc =
-			crc32_le_80211(crc32_table, decapchunk->data(), decapchunk->length());
+		uint32_t calc_crc = crc32_hw(decapchunk->data(), decapchunk->length());
         uint32_t flipped_crc = kis_swap32(calc_crc);
 
         auto checksum_ptr = reinterpret_cast<const uint32_t *>(fcschunk->data());
@@ -480,48 +536,3 @@ int kis_dlt_radiotap::handle_packet(std::shared_ptr<kis_packet> in_pack) {
 #undef BITNO_4
 #undef BITNO_2
 #undef BIT
-
-// Taken from the BBN USRP 802.11 encoding code
-unsigned int kis_dlt_radiotap::update_crc32_80211(unsigned int crc, const char *data,
-        int len, unsigned int poly) {
-	int i, j;
-	unsigned short ch;
-
-	for ( i = 0; i < len; ++i) {
-		ch = data[i];
-		for (j = 0; j < 8; ++j) {
-			if ((crc ^ ch) & 0x0001) {
-				crc = (crc >> 1) ^ poly;
-			} else {
-				crc = (crc >> 1);
-			}
-			ch >>= 1;
-		}
-	}
-	return crc;
-}
-
-void kis_dlt_radiotap::crc32_init_table_80211(unsigned int *crc32_table) {
-	int i;
-	char c;
-
-	for (i = 0; i < 256; ++i) {
-		c = i;
-		crc32_table[i] = update_crc32_80211(0, &c, 1, IEEE_802_3_CRC32_POLY);
-	}
-}
-
-unsigned int kis_dlt_radiotap::crc32_le_80211(unsigned int *crc32_table, 
-        const char *buf, int len) {
-	int i;
-	unsigned int crc = 0xFFFFFFFF;
-
-	for (i = 0; i < len; ++i) {
-		crc = (crc >> 8) ^ crc32_table[(crc ^ buf[i]) & 0xFF];
-	}
-
-	crc ^= 0xFFFFFFFF;
-
-	return crc;
-}
-
@@ -0,0 +1,183 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "alertracker.h"
+#include "devicetracker.h"
+#include "entrytracker.h"
+#include "eventbus.h"
+#include "fmt.h"
+#include "json_adapter.h"
+#include "kis_elk_bulk.h"
+#include "util.h"
+
+namespace {
+
+// Alerts held for a slow client before the oldest are dropped
+const size_t elk_max_queued_alerts = 4096;
+
+struct elk_tail_state {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool closed = false;
+    std::deque<std::shared_ptr<tracked_alert>> alerts;
+};
+
+}
+
+kis_elk_bulk::kis_elk_bulk() {
+    auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
+
+    httpd->register_route("/logging/elk/bulk", {"GET"}, httpd->RO_ROLE, {"ndjson"},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return bulk_endp_handler(con);
+                }, nullptr, nullptr, true));
+}
+
+kis_elk_bulk::~kis_elk_bulk() {
+    Globalreg::globalreg->remove_global(global_name());
+}
+
+void kis_elk_bulk::write_bulk_record(std::ostream& stream, const std::string& in_index,
+        const std::string& in_id, shared_tracker_element in_elem) {
+    if (in_id.length())
+        stream << fmt::format("{{\"index\":{{\"_index\":\"{}\",\"_id\":\"{}\"}}}}\n",
+                json_adapter::sanitize_string(in_index), json_adapter::sanitize_string(in_id));
+    else
+        stream << fmt::format("{{\"index\":{{\"_index\":\"{}\"}}}}\n",
+                json_adapter::sanitize_string(in_index));
+
+    // The ekjson serializer ends each record with a newline
+    Globalreg::globalreg->entrytracker->serialize("ekjson", stream, in_elem, nullptr);
+}
+
+void kis_elk_bulk::bulk_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    unsigned int interval = 10;
+    std::string index = "kismet";
+    time_t since = 0;
+
+    auto vi = con->http_variables().find("interval");
+    if (vi != con->http_variables().end()) {
+        interval = string_to_n<unsigned int>(vi->second);
+        if (interval == 0)
+            throw std::runtime_error("invalid 'interval' value");
+    }
+
+    auto ii = con->http_variables().find("index");
+    if (ii != con->http_variables().end() && ii->second.length())
+        index = ii->second;
+
+    // Only devices seen after 'since' are in the first update; the default of every
+    // device fills a new index
+    auto si = con->http_variables().find("since");
+    if (si != con->http_variables().end())
+        since = string_to_n<time_t>(si->second);
+
+    auto devicetracker = Globalreg::fetch_mandatory_global_as<device_tracker>();
+    auto eventbus = Globalreg::fetch_mandatory_global_as<event_bus>();
+
+    auto state = std::make_shared<elk_tail_state>();
+
+    con->clear_timeout();
+    con->set_closure_cb([state]() {
+            std::lock_guard<std::mutex> lk(state->mutex);
+            state->closed = true;
+            state->cv.notify_all();
+            });
+
+    auto alert_evt_id =
+        eventbus->register_listener(alert_tracker::alert_event(),
+                [state](std::shared_ptr<eventbus_event> evt) {
+                auto al_k = evt->get_event_content()->find(alert_tracker::alert_event());
+                if (al_k == evt->get_event_content()->end())
+                    return;
+
+                std::lock_guard<std::mutex> lk(state->mutex);
+
+                if (state->alerts.size() >= elk_max_queued_alerts)
+                    state->alerts.pop_front();
+
+                state->alerts.push_back(std::static_pointer_cast<tracked_alert>(al_k->second));
+                state->cv.notify_all();
+                });
+
+    std::ostream stream(&con->response_stream());
+
+    auto device_index = fmt::format("{}-devices", index);
+    auto alert_index = fmt::format("{}-alerts", index);
+
+    auto next_devices = std::chrono::steady_clock::now();
+
+    try {
+        while (!Globalreg::globalreg->spindown) {
+            std::deque<std::shared_ptr<tracked_alert>> alerts;
+
+            {
+                std::unique_lock<std::mutex> lk(state->mutex);
+
+                state->cv.wait_until(lk, next_devices, [state]() {
+                        return state->closed || state->alerts.size() != 0;
+                        });
+
+                if (state->closed)
+                    break;
+
+                alerts.swap(state->alerts);
+            }
+
+            for (const auto& a : alerts)
+                write_bulk_record(stream, alert_index, "", a);
+
+            if (std::chrono::steady_clock::now() >= next_devices) {
+                // Devices updated within the second of the last pass are sent again, which
+                // only replaces them in the index
+                auto start = (time_t) Globalreg::globalreg->last_tv_sec;
+
+                auto worker = device_tracker_view_function_worker(
+                        [since](std::shared_ptr<kis_tracked_device_base> d) -> bool {
+                            return d->get_last_time() >= since;
+                        });
+
+                auto devices = devicetracker->snapshot_devices(
+                        devicetracker->do_readonly_device_work(worker));
+
+                for (const auto& d : *devices) {
+                    auto dev = std::static_pointer_cast<kis_tracked_device_base>(d);
+                    write_bulk_record(stream, device_index, dev->get_key().as_string(), dev);
+                }
+
+                since = start;
+                next_devices = std::chrono::steady_clock::now() + std::chrono::seconds(interval);
+            }
+
+            stream.flush();
+        }
+    } catch (const std::exception& e) {
+        eventbus->remove_listener(alert_evt_id);
+        throw;
+    }
+
+    eventbus->remove_listener(alert_evt_id);
+}
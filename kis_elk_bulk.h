@@ -0,0 +1,67 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_ELK_BULK_H__
+#define __KIS_ELK_BULK_H__
+
+#include "config.h"
+
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "globalregistry.h"
+#include "kis_net_beast_httpd.h"
+#include "trackedelement.h"
+
+// Live Elasticsearch feed
+//
+// /logging/elk/bulk.ndjson streams devices and alerts as Elasticsearch _bulk records
+// for as long as the client stays connected, in the same form kismetdb_to_elk exports
+// from a log:  every record is serialized with the ekjson serializer and preceded by
+// an index action, and devices are indexed by device key so each update replaces the
+// last.  Alerts are written as they're raised; devices seen since the last update are
+// written every 'interval' seconds.
+
+class kis_elk_bulk : public lifetime_global {
+public:
+    static std::string global_name() { return "KIS_ELK_BULK"; }
+
+    static std::shared_ptr<kis_elk_bulk> create_elk_bulk() {
+        std::shared_ptr<kis_elk_bulk> mon(new kis_elk_bulk());
+        Globalreg::globalreg->register_lifetime_global(mon);
+        Globalreg::globalreg->insert_global(global_name(), mon);
+        return mon;
+    }
+
+private:
+    kis_elk_bulk();
+
+public:
+    virtual ~kis_elk_bulk();
+
+    // Write a single record as an index action and ekjson document; an empty id lets
+    // Elasticsearch assign one
+    static void write_bulk_record(std::ostream& stream, const std::string& in_index,
+            const std::string& in_id, shared_tracker_element in_elem);
+
+protected:
+    void bulk_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
+};
+
+#endif
@@ -16,9 +16,18 @@
     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include "config.h"
+
 #include <memory>
+#include <thread>
 #include <sys/stat.h>
 
+#ifdef SYS_LINUX
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
 #include "configfile.h"
 
 #include "json_adapter.h"
@@ -35,7 +44,94 @@
 #include "protobuf_cpp/http.pb.h"
 #include "protobuf_cpp/eventbus.pb.h"
 
+#ifdef SYS_LINUX
+// The ring is shared between processes, so these are not private futexes
+static void shm_futex_wait(uint32_t *addr, uint32_t val, long timeout_usec) {
+    struct timespec ts;
+    ts.tv_sec = timeout_usec / 1000000;
+    ts.tv_nsec = (timeout_usec % 1000000) * 1000;
+
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, nullptr, 0);
+}
+
+static void shm_futex_wake(uint32_t *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+#endif
+
+kis_external_shm_ring::~kis_external_shm_ring() {
+#ifdef SYS_LINUX
+    if (map != nullptr)
+        munmap(map, map_sz);
+#endif
+
+    close_fd();
+}
+
+bool kis_external_shm_ring::create(size_t in_sz) {
+#ifdef SYS_LINUX
+    size_t ring_sz = KIS_EXTERNAL_SHM_DATA_OFFSET;
+
+    while (ring_sz < in_sz)
+        ring_sz <<= 1;
+
+    fd = syscall(SYS_memfd_create, "kismet-ipc-ring", 0);
+
+    if (fd < 0) {
+        _MSG_ERROR("Kismet external interface could not create shared memory ring: {}",
+                kis_strerror_r(errno));
+        return false;
+    }
+
+    map_sz = KIS_EXTERNAL_SHM_DATA_OFFSET + ring_sz;
+
+    if (ftruncate(fd, map_sz) < 0) {
+        _MSG_ERROR("Kismet external interface could not size shared memory ring: {}",
+                kis_strerror_r(errno));
+        close_fd();
+        return false;
+    }
+
+    map = mmap(nullptr, map_sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (map == MAP_FAILED) {
+        _MSG_ERROR("Kismet external interface could not map shared memory ring: {}",
+                kis_strerror_r(errno));
+        map = nullptr;
+        close_fd();
+        return false;
+    }
+
+    hdr = static_cast<kismet_external_shm_ring_t *>(map);
+    data = static_cast<const char *>(map) + KIS_EXTERNAL_SHM_DATA_OFFSET;
+
+    hdr->ring_sz = ring_sz;
+    hdr->head = 0;
+    hdr->tail = 0;
+    hdr->producer_waiting = 0;
+    hdr->producer_attached = 0;
+    hdr->consumer_waiting = 0;
+    hdr->version = KIS_EXTERNAL_SHM_VERSION;
+
+    __atomic_store_n(&hdr->signature, KIS_EXTERNAL_SHM_SIG, __ATOMIC_RELEASE);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+void kis_external_shm_ring::close_fd() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
 kis_external_interface::kis_external_interface() :
+    kis_external_interface(Globalreg::globalreg->io) { }
+
+kis_external_interface::kis_external_interface(boost::asio::io_context& in_io) :
     stopped{true},
     cancelled{false},
     timetracker{Globalreg::fetch_mandatory_global_as<time_tracker>()},
@@ -43,14 +139,22 @@ kis_external_interface::kis_external_interface() :
     seqno{0},
     last_pong{0},
     ping_timer_id{-1},
-    strand_{Globalreg::globalreg->io},
-    ipc_in{Globalreg::globalreg->io},
-    ipc_out{Globalreg::globalreg->io},
+    ext_io{in_io},
+    strand_{ext_io},
+    ipc_in{ext_io},
+    ipc_out{ext_io},
     ipc_running{false},
     protocol_version{0},
-    tcpsocket{Globalreg::globalreg->io},
+    ipc_shm_ring_sz{0},
+    tcpsocket{ext_io},
+    ingest_reads{0},
+    ingest_read_usec{0},
+    ingest_read_max_usec{0},
+    ingest_read_max_ts{0},
     eventbus{Globalreg::fetch_mandatory_global_as<event_bus>()},
-    http_session_id{0} {
+    http_session_id{0},
+    http_throttled_sessions{0},
+    reads_parked{false} {
 
     ext_mutex.set_name("kis_external_interface");
 }
@@ -79,7 +183,13 @@ bool kis_external_interface::attach_tcp_socket(tcp::socket& socket) {
             in_buf.consume(in_buf.size());
             out_bufs.clear();
 
-            tcpsocket = std::move(socket);
+            // Sockets are accepted on the shared IO context; move the descriptor to ours
+            if (&socket.get_executor().context() != &ext_io) {
+                auto proto = socket.local_endpoint().protocol();
+                tcpsocket = tcp::socket(ext_io, proto, socket.release());
+            } else {
+                tcpsocket = std::move(socket);
+            }
 
             tcp_promise.set_value(true);
             });
@@ -112,6 +222,7 @@ void kis_external_interface::close_external() {
     // Kill any active http sessions
     for (auto s : http_proxy_session_map) {
         // Fail them
+        s.second->cancelled = true;
         s.second->connection->response_stream().cancel();
         // Unlock them and let the cleanup in the thread handle it and close down 
         // the http server session
@@ -170,6 +281,8 @@ void kis_external_interface::ipc_soft_kill() {
         kill(ipc.pid, SIGTERM);
     }
 
+    stop_ipc_shm();
+
     ipc_running = false;
 }
 
@@ -201,9 +314,131 @@ void kis_external_interface::ipc_hard_kill() {
         kill(ipc.pid, SIGKILL);
     }
 
+    stop_ipc_shm();
+
     ipc_running = false;
 }
 
+void kis_external_interface::start_ipc_shm(std::shared_ptr<kis_external_shm_ring> shm) {
+    stop_ipc_shm();
+
+    kis_lock_guard<kis_mutex> lk(ext_mutex, "kei start_ipc_shm");
+
+    ipc_shm = shm;
+
+    // The consumer thread holds the ring and only a weak reference to us, so it exits
+    // on its own once the ring is stopped or we go away
+    std::weak_ptr<kis_external_interface> weak_self = shared_from_this();
+
+    std::thread([shm, weak_self]() {
+            thread_set_process_name("ipc-shm");
+            ipc_shm_consume(shm, weak_self);
+            }).detach();
+}
+
+void kis_external_interface::stop_ipc_shm() {
+    kis_lock_guard<kis_mutex> lk(ext_mutex, "kei stop_ipc_shm");
+
+    if (ipc_shm == nullptr)
+        return;
+
+    ipc_shm->stop = true;
+
+#ifdef SYS_LINUX
+    __atomic_store_n(&ipc_shm->hdr->consumer_waiting, 0, __ATOMIC_SEQ_CST);
+    shm_futex_wake(&ipc_shm->hdr->consumer_waiting);
+#endif
+
+    ipc_shm.reset();
+}
+
+void kis_external_interface::ipc_shm_consume(std::shared_ptr<kis_external_shm_ring> shm,
+        std::weak_ptr<kis_external_interface> weak_self) {
+#ifdef SYS_LINUX
+    auto hdr = shm->hdr;
+    const uint64_t ring_sz = hdr->ring_sz;
+    const uint64_t mask = ring_sz - 1;
+
+    while (!shm->stop) {
+        auto tail = hdr->tail;
+        auto head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+
+        if (head == tail) {
+            // Announce we're going to sleep, then look again so a frame published
+            // before the producer could see the flag isn't missed
+            __atomic_store_n(&hdr->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+
+            if (__atomic_load_n(&hdr->head, __ATOMIC_SEQ_CST) == tail && !shm->stop)
+                shm_futex_wait(&hdr->consumer_waiting, 1, 100000);
+
+            __atomic_store_n(&hdr->consumer_waiting, 0, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        auto self = weak_self.lock();
+
+        if (self == nullptr)
+            break;
+
+        while (tail != head && !shm->stop) {
+            auto offt = tail & mask;
+            auto frame = reinterpret_cast<const kismet_external_frame_v2_t *>(shm->data + offt);
+            size_t avail = std::min(head - tail, ring_sz - offt);
+
+            // Padding up to the end of the ring
+            if (frame->signature == 0) {
+                tail += ring_sz - offt;
+                continue;
+            }
+
+            // v3 frames have a shorter header; the common fields are in the same place
+            size_t hdr_sz = sizeof(kismet_external_frame_v2_t);
+
+            if (avail >= sizeof(kismet_external_frame_v3_t) && 
+                    kis_ntoh16(frame->frame_version) == 0x03)
+                hdr_sz = sizeof(kismet_external_frame_v3_t);
+
+            if (avail < hdr_sz || hdr_sz + kis_ntoh32(frame->data_sz) > avail) {
+                _MSG_ERROR("Kismet external interface got a corrupt frame in the shared memory ring");
+                self->trigger_error("corrupt shared memory ring");
+                return;
+            }
+
+            size_t frame_sz = hdr_sz + kis_ntoh32(frame->data_sz);
+
+            // Leave the frames in the ring while a proxied http response is backed up;
+            // once the ring fills the helper blocks writing
+            while (self->http_throttled_sessions > 0 && !shm->stop)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+            if (shm->stop)
+                break;
+
+            kis_external_shm_frame buf(shm->data + offt, frame_sz);
+
+            auto read_start = std::chrono::steady_clock::now();
+            auto r = self->handle_packet(buf);
+            self->record_ingest_read(read_start);
+
+            if (r < 0)
+                return;
+
+            tail += (frame_sz + KIS_EXTERNAL_SHM_ALIGN - 1) & ~((uint64_t) KIS_EXTERNAL_SHM_ALIGN - 1);
+
+            // Release the space as soon as we're done with it, and wake the producer if it
+            // ran out of room
+            __atomic_store_n(&hdr->tail, tail, __ATOMIC_SEQ_CST);
+
+            if (__atomic_load_n(&hdr->producer_waiting, __ATOMIC_SEQ_CST) &&
+                    __atomic_exchange_n(&hdr->producer_waiting, 0, __ATOMIC_SEQ_CST))
+                shm_futex_wake(&hdr->producer_waiting);
+        }
+
+        __atomic_store_n(&hdr->tail, tail, __ATOMIC_SEQ_CST);
+    }
+#endif
+}
+
 void kis_external_interface::trigger_error(const std::string& in_error) {
     // Don't loop if we're already stopped
     if (stopped)
@@ -246,11 +481,20 @@ void kis_external_interface::start_ipc_read() {
                         return trigger_error(fmt::format("IPC connection error: {}", ec.message()));
                     } 
 
+                    auto read_start = std::chrono::steady_clock::now();
                     auto r = handle_packet(in_buf);
+                    record_ingest_read(read_start);
 
                     if (r < 0)
                         return trigger_error("IPC read processing error");
 
+                    // Stop reading while a proxied http response is backed up, the
+                    // helper blocks once the pipe fills
+                    if (http_throttled_sessions > 0) {
+                        reads_parked = true;
+                        return;
+                    }
+
                     return start_ipc_read();
                 }));
 }
@@ -287,15 +531,46 @@ void kis_external_interface::start_tcp_read(std::shared_ptr<kis_external_interfa
                 return trigger_error(fmt::format("TCP connection error: {}", ec.message()));
             } 
 
+            auto read_start = std::chrono::steady_clock::now();
             auto r = handle_packet(in_buf);
+            record_ingest_read(read_start);
 
             if (r < 0)
                 return trigger_error("TCP read processing error");
 
+            if (http_throttled_sessions > 0) {
+                reads_parked = true;
+                return;
+            }
+
             return start_tcp_read(ref);
             }));
 }
 
+void kis_external_interface::record_ingest_read(const std::chrono::steady_clock::time_point& in_start) {
+    auto usec = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - in_start).count());
+
+    // The shared memory consumer and the pipe reads can overlap; a lost update only
+    // skews the statistics, so plain load/store is enough
+    auto avg = ingest_read_usec.load(std::memory_order_relaxed);
+
+    if (ingest_reads++ == 0)
+        avg = usec;
+    else
+        avg = (avg * 15 + usec) / 16;
+
+    ingest_read_usec.store(avg, std::memory_order_relaxed);
+
+    time_t now = Globalreg::globalreg->last_tv_sec;
+
+    if (usec > ingest_read_max_usec.load(std::memory_order_relaxed) ||
+            now - ingest_read_max_ts.load(std::memory_order_relaxed) > 60) {
+        ingest_read_max_usec.store(usec, std::memory_order_relaxed);
+        ingest_read_max_ts.store(now, std::memory_order_relaxed);
+    }
+}
+
 bool kis_external_interface::check_ipc(const std::string& in_binary) {
     struct stat fstat;
 
@@ -445,6 +720,17 @@ bool kis_external_interface::run_ipc() {
         return false;
     }
 
+    // Offer a shared memory ring for the helper to write frames into; helpers which
+    // don't support it keep using the pipe
+    std::shared_ptr<kis_external_shm_ring> shm;
+
+    if (ipc_shm_ring_sz > 0) {
+        shm = std::make_shared<kis_external_shm_ring>();
+
+        if (!shm->create(ipc_shm_ring_sz))
+            shm.reset();
+    }
+
     // We don't need to do signal masking because we run a dedicated signal handling thread
 
     char **cmdarg;
@@ -488,6 +774,9 @@ bool kis_external_interface::run_ipc() {
         ::close(inpipepair[1]);
         ::close(outpipepair[0]);
 
+        if (shm != nullptr)
+            setenv(KIS_EXTERNAL_SHM_ENV, fmt::format("{}", shm->fd).c_str(), 1);
+
         execvp(cmdarg[0], cmdarg);
 
         exit(255);
@@ -499,8 +788,8 @@ bool kis_external_interface::run_ipc() {
     ::close(inpipepair[0]);
     ::close(outpipepair[1]);
 
-    ipc_out = boost::asio::posix::stream_descriptor(Globalreg::globalreg->io, inpipepair[1]);
-    ipc_in = boost::asio::posix::stream_descriptor(Globalreg::globalreg->io, outpipepair[0]);
+    ipc_out = boost::asio::posix::stream_descriptor(ext_io, inpipepair[1]);
+    ipc_in = boost::asio::posix::stream_descriptor(ext_io, outpipepair[0]);
 
     stopped = false;
     cancelled = false;
@@ -518,6 +807,12 @@ bool kis_external_interface::run_ipc() {
 
     ipctracker->register_ipc(ipc);
 
+    // The helper has its own copy of the ring descriptor now
+    if (shm != nullptr) {
+        shm->close_fd();
+        start_ipc_shm(shm);
+    }
+
     boost::asio::post(strand_,
                       [self = shared_from_this()]() {
                           self->start_ipc_read();
@@ -674,6 +969,37 @@ unsigned int kis_external_interface::send_packet(std::shared_ptr<KismetExternal:
     return c->seqno();
 }
 
+unsigned int kis_external_interface::send_packet_v2_raw(const std::string& command, 
+        uint32_t in_seqno, const std::string& content) {
+    if (stopped || cancelled) {
+        _MSG_DEBUG("Attempt to send {} on closed external interface", command);
+        return 0;
+    }
+
+    if (in_seqno == 0) {
+        kis_lock_guard<kis_mutex> lk(ext_mutex, "kei send_packet_v2_raw");
+        if (++seqno == 0)
+            seqno = 1;
+        in_seqno = seqno;
+    }
+
+    std::string frame_buf(sizeof(kismet_external_frame_v2_t) + content.size(), 0);
+    auto frame = reinterpret_cast<kismet_external_frame_v2_t *>(&frame_buf[0]);
+
+    frame->signature = kis_hton32(KIS_EXTERNAL_PROTO_SIG);
+    frame->data_sz = kis_hton32(content.size());
+    frame->v2_sentinel = kis_hton16(KIS_EXTERNAL_V2_SIG);
+    frame->frame_version = kis_hton16(2);
+    strncpy(frame->command, command.c_str(), 31);
+    frame->seqno = kis_hton32(in_seqno);
+
+    memcpy(frame->data, content.data(), content.size());
+
+    start_write(frame_buf.data(), frame_buf.size());
+
+    return in_seqno;
+}
+
 bool kis_external_interface::dispatch_rx_packet(const nonstd::string_view& command,
         uint32_t seqno, const nonstd::string_view& content) {
     // Simple dispatcher; this should be called by child implementations who
@@ -711,6 +1037,67 @@ bool kis_external_interface::dispatch_rx_packet(const nonstd::string_view& comma
 
 }
 
+// Names of the v3 command table entries, indexed by KIS_EXTERNAL_CMD_ id
+static const char *kis_external_command_names[KIS_EXTERNAL_CMD_MAX + 1] = {
+    nullptr,
+    "KDSDATAREPORT",
+    KIS_EXTERNAL_BATCH_CMD,
+    "MESSAGE",
+    "PING",
+    "PONG",
+    "SHUTDOWN",
+    "KDSCONFIGUREREPORT",
+    "KDSERRORREPORT",
+    "KDSINTERFACESREPORT",
+    "KDSOPENSOURCEREPORT",
+    "KDSPROBESOURCEREPORT",
+    "KDSWARNINGREPORT",
+    "KDSNEWSOURCE",
+    "HTTPREGISTERURI",
+    "HTTPRESPONSE",
+    "HTTPAUTHREQ",
+    "EVENTBUSREGISTER",
+    "EVENTBUSPUBLISH",
+    KIS_EXTERNAL_BATCH_Z_CMD,
+    KIS_EXTERNAL_SPECTRUM_CMD,
+};
+
+const char *kis_external_interface::command_name(uint32_t command_id) {
+    if (command_id > KIS_EXTERNAL_CMD_MAX)
+        return nullptr;
+
+    return kis_external_command_names[command_id];
+}
+
+bool kis_external_interface::dispatch_rx_packet_id(uint32_t command_id, uint32_t seqno,
+        const nonstd::string_view& content) {
+    switch (command_id) {
+        case KIS_EXTERNAL_CMD_MESSAGE:
+            handle_packet_message(seqno, content);
+            return true;
+        case KIS_EXTERNAL_CMD_PING:
+            handle_packet_ping(seqno, content);
+            return true;
+        case KIS_EXTERNAL_CMD_PONG:
+            handle_packet_pong(seqno, content);
+            return true;
+        default:
+            break;
+    }
+
+    // Everything else goes through the named dispatch so that implementations which
+    // only override dispatch_rx_packet still see it
+    auto name = command_name(command_id);
+
+    if (name == nullptr) {
+        _MSG_ERROR("Kismet external interface got a frame with an unknown command id ({})",
+                command_id);
+        return false;
+    }
+
+    return dispatch_rx_packet(name, seqno, content);
+}
+
 void kis_external_interface::handle_packet_message(uint32_t in_seqno, 
         const nonstd::string_view& in_content) {
     KismetExternal::MsgbusMessage m;
@@ -812,19 +1199,147 @@ unsigned int kis_external_interface::send_shutdown(std::string reason) {
     return -1;
 }
 
-void kis_external_interface::proxy_event(std::shared_ptr<eventbus_event> evt) {
-    std::stringstream ss;
-    json_adapter::pack(ss, evt);
-    KismetEventBus::EventbusEvent ebe;
-    ebe.set_event_json(ss.str());
+shared_tracker_element kis_external_interface::resolve_event_path(
+        const std::shared_ptr<eventbus_event>& evt, const std::vector<std::string>& path) {
+    if (path.size() == 0)
+        return nullptr;
+
+    auto c = evt->get_event_content()->find(path[0]);
+
+    if (c == evt->get_event_content()->end())
+        return nullptr;
+
+    auto e = c->second;
+
+    for (size_t p = 1; p < path.size() && e != nullptr; p++) {
+        if (e->get_type() != tracker_type::tracker_map)
+            return nullptr;
+
+        auto id = Globalreg::globalreg->entrytracker->get_field_id(path[p]);
+
+        if (id < 0)
+            return nullptr;
+
+        e = static_cast<tracker_element_map *>(e.get())->get_sub(id);
+    }
+
+    return e;
+}
+
+std::string kis_external_interface::encode_event(const std::shared_ptr<eventbus_event>& evt,
+        const eventbus_subscription& sub) {
+    if (!sub.binary) {
+        KismetEventBus::EventbusEvent ebe;
+        std::stringstream ss;
+
+        if (sub.fields.size() == 0) {
+            json_adapter::pack(ss, evt);
+        } else {
+            // Projected events are sent as an object of the requested paths
+            ss << "{\"kismet.eventbus.event\": ";
+            json_adapter::write_escaped(ss, evt->get_event_id());
+
+            for (const auto& f : sub.fields) {
+                auto e = resolve_event_path(evt, f);
+
+                if (e == nullptr)
+                    continue;
+
+                ss << ", ";
+                json_adapter::write_escaped(ss, str_join(f, "/"));
+                ss << ": ";
+                json_adapter::pack(ss, e);
+            }
+
+            ss << "}";
+        }
+
+        ebe.set_event_json(ss.str());
+        return ebe.SerializeAsString();
+    }
+
+    KismetEventBus::EventbusBinaryEvent ebe;
+    ebe.set_event(evt->get_event_id());
+
+    for (size_t fi = 0; fi < sub.fields.size(); fi++) {
+        auto e = resolve_event_path(evt, sub.fields[fi]);
+
+        if (e == nullptr)
+            continue;
+
+        auto bf = ebe.add_field();
+        bf->set_index(fi);
+
+        switch (e->get_type()) {
+            case tracker_type::tracker_int8:
+                bf->set_int_value(static_cast<tracker_element_int8 *>(e.get())->get());
+                break;
+            case tracker_type::tracker_int16:
+                bf->set_int_value(static_cast<tracker_element_int16 *>(e.get())->get());
+                break;
+            case tracker_type::tracker_int32:
+                bf->set_int_value(static_cast<tracker_element_int32 *>(e.get())->get());
+                break;
+            case tracker_type::tracker_int64:
+                bf->set_int_value(static_cast<tracker_element_int64 *>(e.get())->get());
+                break;
+            case tracker_type::tracker_uint8:
+                bf->set_uint_value(static_cast<tracker_element_uint8 *>(e.get())->get());
+                break;
+            case tracker_type::tracker_uint16:
+                bf->set_uint_value(static_cast<tracker_element_uint16 *>(e.get())->get());
+                break;
+            case tracker_type::tracker_uint32:
+                bf->set_uint_value(static_cast<tracker_element_uint32 *>(e.get())->get());
+                break;
+            case tracker_type::tracker_uint64:
+                bf->set_uint_value(static_cast<tracker_element_uint64 *>(e.get())->get());
+                break;
+            case tracker_type::tracker_float:
+                bf->set_double_value(static_cast<tracker_element_float *>(e.get())->get());
+                break;
+            case tracker_type::tracker_double:
+                bf->set_double_value(static_cast<tracker_element_double *>(e.get())->get());
+                break;
+            default:
+                if (e->is_stringable()) {
+                    bf->set_bytes_value(e->as_string());
+                } else {
+                    std::stringstream ss;
+                    json_adapter::pack(ss, e);
+                    bf->set_json_value(ss.str());
+                }
+                break;
+        }
+    }
+
+    return ebe.SerializeAsString();
+}
+
+void kis_external_interface::proxy_event(std::shared_ptr<eventbus_event> evt,
+        const std::shared_ptr<eventbus_subscription>& sub) {
+    for (const auto& m : sub->match) {
+        auto e = resolve_event_path(evt, m.first);
+
+        if (e == nullptr || !e->is_stringable() || e->as_string() != m.second)
+            return;
+    }
+
+    // Encoded once per event for all the helpers subscribed the same way
+    auto content = evt->get_serialized(sub->serialized_key, 
+            [&evt, &sub]() -> std::string {
+                return encode_event(evt, *sub);
+            });
+
+    auto command = sub->binary ? "EVENTBIN" : "EVENT";
 
     if (protocol_version == 0) {
         auto c = std::make_shared<KismetExternal::Command>();
-        c->set_command("EVENT");
-        c->set_content(ebe.SerializeAsString());
+        c->set_command(command);
+        c->set_content(*content);
         send_packet(c);
     } else if (protocol_version == 2) {
-        send_packet_v2("EVENT", 0, ebe);
+        send_packet_v2_raw(command, 0, *content);
     }
 
     return;
@@ -842,19 +1357,46 @@ void kis_external_interface::handle_packet_eventbus_register(uint32_t in_seqno,
         return;
     }
 
-    for (int e = 0; e < evtlisten.event_size(); e++) {
-        auto k = eventbus_callback_map.find(evtlisten.event(e));
+    auto subscribe = [this](const std::string& event, std::shared_ptr<eventbus_subscription> sub) {
+        auto k = eventbus_callback_map.find(event);
 
         if (k != eventbus_callback_map.end())
             eventbus->remove_listener(k->second);
 
         unsigned long eid = 
-            eventbus->register_listener(evtlisten.event(e), 
-                    [this](std::shared_ptr<eventbus_event> e) {
-                    proxy_event(e);
+            eventbus->register_listener(event, 
+                    [this, sub](std::shared_ptr<eventbus_event> e) {
+                    proxy_event(e, sub);
                     });
 
-        eventbus_callback_map[evtlisten.event(e)] = eid;
+        eventbus_callback_map[event] = eid;
+    };
+
+    for (int e = 0; e < evtlisten.event_size(); e++) {
+        auto sub = std::make_shared<eventbus_subscription>();
+        sub->binary = false;
+        sub->serialized_key = "external\njson";
+        subscribe(evtlisten.event(e), sub);
+    }
+
+    for (int s = 0; s < evtlisten.subscription_size(); s++) {
+        const auto& es = evtlisten.subscription(s);
+
+        auto sub = std::make_shared<eventbus_subscription>();
+        sub->binary = es.has_binary() && es.binary();
+
+        for (int m = 0; m < es.match_size(); m++)
+            sub->match.push_back(std::make_pair(str_tokenize(es.match(m).path(), "/"), 
+                        es.match(m).value()));
+
+        sub->serialized_key = fmt::format("external\n{}", sub->binary ? "binary" : "json");
+
+        for (int f = 0; f < es.field_size(); f++) {
+            sub->fields.push_back(str_tokenize(es.field(f), "/"));
+            sub->serialized_key += "\n" + es.field(f);
+        }
+
+        subscribe(es.event(), sub);
     }
 }
 
@@ -912,21 +1454,48 @@ void kis_external_interface::handle_packet_http_register(uint32_t in_seqno,
                     send_http_request(sess_id, static_cast<std::string>(con->uri()), 
                             fmt::format("{}", con->verb()), var_remap);
 
-                    con->set_closure_cb([session]() { session->locker->unlock(-1); });
+                    con->set_closure_cb([session]() { 
+                            session->cancelled = true;
+                            session->locker->unlock(-1); 
+                            });
 
-                    // Unlock the external mutex prior to blocking
-                    l.unlock();
+                    while (true) {
+                        // Unlock the external mutex prior to blocking
+                        l.unlock();
 
-                    // Block until we get a response
-                    session->locker->block_until();
+                        // Block until the response completes or backs up
+                        session->locker->block_until();
 
-                    // Reacquire the lock on the external interface
-                    l.lock();
+                        if (session->complete || session->cancelled) {
+                            l.lock();
+                            break;
+                        }
+
+                        // Let the client drain the response, then pick up reading from
+                        // the helper again
+                        con->response_stream().wait_write_below(http_proxy_backlog / 2);
+
+                        // Reacquire the lock on the external interface; the response
+                        // handler only changes the session under it, so a completion
+                        // can't slip between checking and re-locking the session
+                        l.lock();
+
+                        session->locker->lock();
+
+                        if (session->throttled)
+                            release_http_throttle(session);
+
+                        if (session->complete || session->cancelled)
+                            break;
+                    }
+
+                    if (session->throttled)
+                        release_http_throttle(session);
 
                     auto mi = http_proxy_session_map.find(sess_id);
                     if (mi != http_proxy_session_map.end())
                         http_proxy_session_map.erase(mi);
-            }));
+            }, nullptr, nullptr, true));
 }
 
 void kis_external_interface::handle_packet_http_response(uint32_t in_seqno, 
@@ -975,7 +1544,7 @@ void kis_external_interface::handle_packet_http_response(uint32_t in_seqno,
         return;
     }
 
-    // Copy any response data
+    // Forward any response data to the client as it arrives
     if (resp.has_content() && resp.content().size() > 0) {
         session->connection->response_stream().put_data(resp.content().data(), resp.content().size());
     }
@@ -983,10 +1552,44 @@ void kis_external_interface::handle_packet_http_response(uint32_t in_seqno,
     // Are we finishing the connection?
     if (resp.has_close_response() && resp.close_response()) {
         session->connection->response_stream().complete();
-        session->locker->unlock();
+        session->complete = true;
+        session->locker->unlock(0);
+        return;
+    }
+
+    // Hold off reading from the helper until the client catches up; the request thread
+    // waits for the response to drain and restarts reading
+    if (!session->throttled && session->connection->response_stream().running() &&
+            session->connection->response_stream().size() > http_proxy_backlog) {
+        session->throttled = true;
+        http_throttled_sessions++;
+        session->locker->unlock(1);
     }
 }
 
+void kis_external_interface::release_http_throttle(std::shared_ptr<kis_external_http_session> session) {
+    session->throttled = false;
+
+    if (--http_throttled_sessions > 0)
+        return;
+
+    boost::asio::post(strand_,
+            [self = shared_from_this()]() {
+                if (!self->reads_parked || self->http_throttled_sessions > 0)
+                    return;
+
+                self->reads_parked = false;
+
+                if (self->stopped || self->cancelled)
+                    return;
+
+                if (self->tcpsocket.is_open())
+                    self->start_tcp_read(self);
+                else if (self->ipc_in.is_open())
+                    self->start_ipc_read();
+            });
+}
+
 void kis_external_interface::handle_packet_http_auth_request(uint32_t in_seqno, 
         const nonstd::string_view& in_content) {
     KismetExternalHttp::HttpAuthTokenRequest rt;
@@ -32,6 +32,8 @@
 
 #include "config.h"
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <list>
 
@@ -57,16 +59,76 @@ namespace KismetExternal {
     class Command;
 };
 
+// Proxied HTTP request to a helper.  Responses are streamed to the connection as they
+// arrive; the request thread is woken when the helper finishes, when the client goes
+// away, or when the response has backed up and reading from the helper was paused.
 struct kis_external_http_session {
+    kis_external_http_session() :
+        complete{false},
+        cancelled{false},
+        throttled{false} { }
+
     std::shared_ptr<kis_net_beast_httpd_connection> connection;
     std::shared_ptr<conditional_locker<int> > locker;
+
+    std::atomic<bool> complete;
+    std::atomic<bool> cancelled;
+
+    // Holding reads from the helper until the client catches up
+    bool throttled;
 };
 
 
+// Shared memory ring an IPC helper writes frames into, see kis_external_packet.h.  The
+// ring is owned by the interface and by the thread consuming it.
+struct kis_external_shm_ring {
+    kis_external_shm_ring() :
+        fd{-1},
+        map{nullptr},
+        map_sz{0},
+        hdr{nullptr},
+        data{nullptr},
+        stop{false} { }
+
+    ~kis_external_shm_ring();
+
+    // Create a ring of at least in_sz bytes
+    bool create(size_t in_sz);
+
+    // Close the descriptor once the helper has inherited it; the mapping stays
+    void close_fd();
+
+    int fd;
+    void *map;
+    size_t map_sz;
+    kismet_external_shm_ring_t *hdr;
+    const char *data;
+
+    std::atomic<bool> stop;
+};
+
+// Present one frame in the shared memory ring as a buffer for handle_packet
+class kis_external_shm_frame {
+public:
+    kis_external_shm_frame(const char *data, size_t sz) :
+        data_{data},
+        sz_{sz} { }
+
+    size_t size() const { return sz_; }
+    boost::asio::const_buffer data() const { return boost::asio::const_buffer(data_, sz_); }
+    void consume(size_t n) { data_ += n; sz_ -= n; }
+
+protected:
+    const char *data_;
+    size_t sz_;
+};
+
 // External interface API bridge;
 class kis_external_interface : public std::enable_shared_from_this<kis_external_interface> {
 public:
     kis_external_interface();
+    // Run the connection IO on a specific context, such as a datasource ingest thread
+    kis_external_interface(boost::asio::io_context& in_io);
     virtual ~kis_external_interface();
 
     std::shared_ptr<kis_external_interface> get_shared() {
@@ -177,10 +239,39 @@ protected:
         return in_seqno;
     }
 
+    // Transmit already serialized protobuf content in a v2 header
+    unsigned int send_packet_v2_raw(const std::string& command, uint32_t in_seqno,
+            const std::string& content);
+
     // Central packet dispatch handler, common layer and v2+ handler
     virtual bool dispatch_rx_packet(const nonstd::string_view& command, 
             uint32_t seqno, const nonstd::string_view& content);
 
+    // v3 dispatch by KIS_EXTERNAL_CMD_ id; implementations handle their high rate 
+    // commands directly and pass everything else up, where it is dispatched by name
+    virtual bool dispatch_rx_packet_id(uint32_t command_id, uint32_t seqno,
+            const nonstd::string_view& content);
+
+    // Name of a command in the v3 command table, or nullptr if unknown
+    static const char *command_name(uint32_t command_id);
+
+    // Batched data frames are allowed to be larger than command frames
+    static bool large_frame_ok(uint32_t command_id, size_t data_sz) {
+        if (command_id == KIS_EXTERNAL_CMD_DATABATCH)
+            return data_sz <= KIS_EXTERNAL_BATCH_MAX_SZ;
+        if (command_id == KIS_EXTERNAL_CMD_DATABATCHZ)
+            return data_sz <= KIS_EXTERNAL_BATCH_Z_MAX_SZ;
+        return false;
+    }
+
+    static bool large_frame_ok(const nonstd::string_view& command, size_t data_sz) {
+        if (command.compare(KIS_EXTERNAL_BATCH_CMD) == 0)
+            return data_sz <= KIS_EXTERNAL_BATCH_MAX_SZ;
+        if (command.compare(KIS_EXTERNAL_BATCH_Z_CMD) == 0)
+            return data_sz <= KIS_EXTERNAL_BATCH_Z_MAX_SZ;
+        return false;
+    }
+
     // Generic msg proxy
     virtual void handle_msg_proxy(const std::string& msg, const int msgtype); 
 
@@ -217,6 +308,9 @@ protected:
     void start_write(const char *data, size_t len);
     void write_impl();
 
+    // Context the connection IO runs on; the shared IO context unless one was given
+    boost::asio::io_context& ext_io;
+
     // Common strand
     boost::asio::io_service::strand strand_;
 
@@ -233,6 +327,16 @@ protected:
 
     void start_ipc_read();
 
+    // Size of the shared memory ring to offer the next IPC helper, 0 to only use the
+    // pipes
+    size_t ipc_shm_ring_sz;
+    std::shared_ptr<kis_external_shm_ring> ipc_shm;
+
+    void start_ipc_shm(std::shared_ptr<kis_external_shm_ring> shm);
+    void stop_ipc_shm();
+    static void ipc_shm_consume(std::shared_ptr<kis_external_shm_ring> shm,
+            std::weak_ptr<kis_external_interface> weak_self);
+
     void ipc_soft_kill();
     void ipc_hard_kill();
 
@@ -241,12 +345,41 @@ protected:
 
     void start_tcp_read(std::shared_ptr<kis_external_interface> ref);
 
+    // Time spent processing each read from the helper, which holds the IO thread the
+    // connection runs on.  The average is a moving average, the peak covers roughly
+    // the last minute.
+    std::atomic<uint64_t> ingest_reads;
+    std::atomic<uint64_t> ingest_read_usec;
+    std::atomic<uint64_t> ingest_read_max_usec;
+    std::atomic<time_t> ingest_read_max_ts;
+
+    void record_ingest_read(const std::chrono::steady_clock::time_point& in_start);
+
 
     // Eventbus proxy code
     std::shared_ptr<event_bus> eventbus;
     std::map<std::string, unsigned long> eventbus_callback_map;
 
-    void proxy_event(std::shared_ptr<eventbus_event>);
+    // Subscription of a helper to an event.  Events are only sent when every match
+    // holds; with fields set, only those fields are sent, and binary subscriptions get
+    // an EVENTBIN of typed fields instead of the event as JSON.  Paths name a record in
+    // the event content and the fields within it, CONTENT_NAME/field/field.
+    struct eventbus_subscription {
+        std::vector<std::pair<std::vector<std::string>, std::string>> match;
+        std::vector<std::vector<std::string>> fields;
+        bool binary;
+
+        // Key of the encoded event, shared by every helper subscribed the same way
+        std::string serialized_key;
+    };
+
+    void proxy_event(std::shared_ptr<eventbus_event> evt,
+            const std::shared_ptr<eventbus_subscription>& sub);
+
+    static shared_tracker_element resolve_event_path(const std::shared_ptr<eventbus_event>& evt,
+            const std::vector<std::string>& path);
+    static std::string encode_event(const std::shared_ptr<eventbus_event>& evt,
+            const eventbus_subscription& sub);
 
 
     // Webserver proxy code
@@ -263,6 +396,19 @@ protected:
     uint32_t http_session_id;
     std::map<uint32_t, std::shared_ptr<kis_external_http_session> > http_proxy_session_map;
 
+    // Unsent response data a proxied request may back up before reading from the helper
+    // is paused; reading resumes once the client has drained half of it
+    static constexpr size_t http_proxy_backlog = 256 * 1024;
+
+    // Sessions holding reads from the helper, and if the read loop stopped for them;
+    // reads_parked is only touched on the strand
+    std::atomic<unsigned int> http_throttled_sessions;
+    bool reads_parked;
+
+    // Release a throttled session, and restart reading if it was the last; ext_mutex
+    // must be held
+    void release_http_throttle(std::shared_ptr<kis_external_http_session> session);
+
 public:
     static const int result_handle_packet_cancelled = -2;
     static const int result_handle_packet_error = -1;
@@ -297,14 +443,52 @@ public:
                 return result_handle_packet_error;
             }
 
-            // Detect and process the v2 frames
+            // Detect and process v3 frames, which carry a numeric command id
             if (kis_ntoh16(frame_v2->v2_sentinel) == KIS_EXTERNAL_V2_SIG &&
+                    kis_ntoh16(frame_v2->frame_version) == 0x03) {
+                auto frame_v3 = reinterpret_cast<const kismet_external_frame_v3_t *>(frame_v2);
+
+                data_sz = kis_ntoh32(frame_v3->data_sz);
+                frame_sz = data_sz + sizeof(kismet_external_frame_v3);
+
+                uint32_t command_id = kis_ntoh32(frame_v3->command_id);
+
+                // Batched data frames are allowed to be larger than command frames
+                if (frame_sz >= 8192 && !large_frame_ok(command_id, data_sz)) {
+                    _MSG_ERROR("Kismet external interface got a command frame which is too large to "
+                            "be processed ({}); the frame is malformed", frame_sz);
+                    trigger_error("Command frame too large for buffer");
+                    return result_handle_packet_error;
+                }
+
+                // If we don't have the whole buffer available, bail on this read
+                if (frame_sz > buffamt) {
+                    return result_handle_packet_needbuf;
+                }
+
+                nonstd::string_view content((const char *) frame_v3->data, data_sz);
+
+                // v3 frames are only sent to a v2 server which offered the command table
+                protocol_version = 2;
+
+                dispatch_rx_packet_id(command_id, kis_ntoh32(frame_v3->seqno), content);
+
+                buffer.consume(frame_sz);
+            } else if (kis_ntoh16(frame_v2->v2_sentinel) == KIS_EXTERNAL_V2_SIG &&
                     kis_ntoh16(frame_v2->frame_version) == 0x02) {
+                // v2 frames carry the command name
 
                 data_sz = kis_ntoh32(frame_v2->data_sz);
                 frame_sz = data_sz + sizeof(kismet_external_frame_v2);
 
-                if (frame_sz >= 8192) {
+                nonstd::string_view command(frame_v2->command, 32);
+
+                auto trim_pos = command.find('\0');
+                if (trim_pos != command.npos)
+                    command.remove_suffix(command.size() - trim_pos);
+
+                // Batched data frames are allowed to be larger than command frames
+                if (frame_sz >= 8192 && !large_frame_ok(command, data_sz)) {
                     _MSG_ERROR("Kismet external interface got a command frame which is too large to "
                             "be processed ({}); either the frame is malformed or you are connecting to "
                             "a legacy Kismet remote capture drone; make sure you have updated to modern "
@@ -322,12 +506,6 @@ public:
 
                 uint32_t seqno = kis_ntoh32(frame_v2->seqno);
 
-                nonstd::string_view command(frame_v2->command, 32);
-
-                auto trim_pos = command.find('\0');
-                if (trim_pos != command.npos)
-                    command.remove_suffix(command.size() - trim_pos);
-
                 nonstd::string_view content((const char *) frame_v2->data, data_sz);
 
                 // If we've gotten this far it's a valid newer protocol, switch to v2 mode
@@ -367,10 +545,9 @@ public:
                     cached_cmd->Clear();
                 }
 
-                auto ai = new google::protobuf::io::ArrayInputStream(frame->data, data_sz);
-
-                if (!cached_cmd->ParseFromZeroCopyStream(ai)) {
-                    delete(ai);
+                // Parse straight from the frame; the cached command keeps the storage of its
+                // fields between frames, so steady state decoding does not allocate
+                if (!cached_cmd->ParseFromArray(frame->data, data_sz)) {
                     _MSG_ERROR("Kismet external interface could not interpret the payload of the "
                             "command frame; either the frame is malformed, a network error occurred, or "
                             "an unsupported tool is connected to the external interface API");
@@ -382,8 +559,6 @@ public:
                 dispatch_rx_packet(cached_cmd->command(), cached_cmd->seqno(),
                         cached_cmd->content());
 
-                delete(ai);
-
                 buffer.consume(frame_sz);
             }
         }
@@ -415,14 +590,52 @@ public:
             return result_handle_packet_error;
         }
 
-        // Detect and process the v2 frames
+        // Detect and process v3 frames, which carry a numeric command id
         if (kis_ntoh16(frame_v2->v2_sentinel) == KIS_EXTERNAL_V2_SIG &&
+                kis_ntoh16(frame_v2->frame_version) == 0x03) {
+            auto frame_v3 = reinterpret_cast<const kismet_external_frame_v3_t *>(frame_v2);
+
+            data_sz = kis_ntoh32(frame_v3->data_sz);
+            frame_sz = data_sz + sizeof(kismet_external_frame_v3);
+
+            uint32_t command_id = kis_ntoh32(frame_v3->command_id);
+
+            // Batched data frames are allowed to be larger than command frames
+            if (frame_sz >= 8192 && !large_frame_ok(command_id, data_sz)) {
+                _MSG_ERROR("Kismet external interface got a command frame which is too large to "
+                        "be processed ({}); the frame is malformed", frame_sz);
+                trigger_error("Command frame too large for buffer");
+                return result_handle_packet_error;
+            }
+
+            // If we don't have the whole buffer available, bail on this read
+            if (frame_sz > sz) {
+                return result_handle_packet_needbuf;
+            }
+
+            nonstd::string_view content((const char *) frame_v3->data, data_sz);
+
+            // v3 frames are only sent to a v2 server which offered the command table
+            protocol_version = 2;
+
+            dispatch_rx_packet_id(command_id, kis_ntoh32(frame_v3->seqno), content);
+
+            return result_handle_packet_ok;
+        } else if (kis_ntoh16(frame_v2->v2_sentinel) == KIS_EXTERNAL_V2_SIG &&
                 kis_ntoh16(frame_v2->frame_version) == 0x02) {
+            // v2 frames carry the command name
 
             data_sz = kis_ntoh32(frame_v2->data_sz);
             frame_sz = data_sz + sizeof(kismet_external_frame_v2);
 
-            if (frame_sz >= 8192) {
+            nonstd::string_view command(frame_v2->command, 32);
+
+            auto trim_pos = command.find('\0');
+            if (trim_pos != command.npos)
+                command.remove_suffix(command.size() - trim_pos);
+
+            // Batched data frames are allowed to be larger than command frames
+            if (frame_sz >= 8192 && !large_frame_ok(command, data_sz)) {
                 _MSG_ERROR("Kismet external interface got a command frame which is too large to "
                            "be processed ({}); either the frame is malformed or you are connecting to "
                            "a legacy Kismet remote capture drone; make sure you have updated to modern "
@@ -440,12 +653,6 @@ public:
 
             uint32_t seqno = kis_ntoh32(frame_v2->seqno);
 
-            nonstd::string_view command(frame_v2->command, 32);
-
-            auto trim_pos = command.find('\0');
-            if (trim_pos != command.npos)
-                command.remove_suffix(command.size() - trim_pos);
-
             nonstd::string_view content((const char *) frame_v2->data, data_sz);
 
             // If we've gotten this far it's a valid newer protocol, switch to v2 mode
@@ -496,10 +703,9 @@ public:
                 cached_cmd->Clear();
             }
 
-            auto ai = new google::protobuf::io::ArrayInputStream(frame->data, data_sz);
-
-            if (!cached_cmd->ParseFromZeroCopyStream(ai)) {
-                delete(ai);
+            // Parse straight from the frame; the cached command keeps the storage of its
+            // fields between frames, so steady state decoding does not allocate
+            if (!cached_cmd->ParseFromArray(frame->data, data_sz)) {
                 _MSG_ERROR("Kismet external interface could not interpret the payload of the "
                            "command frame; either the frame is malformed, a network error occurred, or "
                            "an unsupported tool is connected to the external interface API");
@@ -511,8 +717,6 @@ public:
             dispatch_rx_packet(cached_cmd->command(), cached_cmd->seqno(),
                     cached_cmd->content());
 
-            delete(ai);
-
             return result_handle_packet_ok;
 
         }
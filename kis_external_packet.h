@@ -70,6 +70,234 @@ struct kismet_external_frame_v2 {
 } __attribute__((packed));
 typedef struct kismet_external_frame_v2 kismet_external_frame_v2_t;
 
+/* v3 wrapper which replaces the command name with a numeric id from the command table
+ * below, so the receiver can dispatch without comparing strings.  The server offers its
+ * command table version in KDSOPENSOURCE; a capture binary built with the same table
+ * version may then send v3 frames for commands in the table.  Commands which are not in
+ * the table are always sent as v2 frames. */
+struct kismet_external_frame_v3 {
+    /* Fixed Start-of-packet signature, big endian */
+    uint32_t signature;
+
+    /* Fixed v2 sentinel 0xABCD */
+    uint16_t v2_sentinel;
+    /* Frame version, 3 */
+    uint16_t frame_version;
+
+    /* Size of data payload encoded in data[0] */
+    uint32_t data_sz;
+
+    /* KIS_EXTERNAL_CMD_ command id */
+    uint32_t command_id;
+
+    /* Sequence number */
+    uint32_t seqno;
+
+    /* Encoded payload */
+    uint8_t data[0];
+} __attribute__((packed));
+typedef struct kismet_external_frame_v3 kismet_external_frame_v3_t;
+
+/* Command table; ids are only ever appended, and the table version is bumped when 
+ * they are */
+#define KIS_EXTERNAL_CMD_TABLE_VERSION      3
+
+#define KIS_EXTERNAL_CMD_UNKNOWN            0
+#define KIS_EXTERNAL_CMD_DATAREPORT         1   /* KDSDATAREPORT */
+#define KIS_EXTERNAL_CMD_DATABATCH          2   /* KDSDATABATCH */
+#define KIS_EXTERNAL_CMD_MESSAGE            3   /* MESSAGE */
+#define KIS_EXTERNAL_CMD_PING               4   /* PING */
+#define KIS_EXTERNAL_CMD_PONG               5   /* PONG */
+#define KIS_EXTERNAL_CMD_SHUTDOWN           6   /* SHUTDOWN */
+#define KIS_EXTERNAL_CMD_CONFIGUREREPORT    7   /* KDSCONFIGUREREPORT */
+#define KIS_EXTERNAL_CMD_ERRORREPORT        8   /* KDSERRORREPORT */
+#define KIS_EXTERNAL_CMD_INTERFACESREPORT   9   /* KDSINTERFACESREPORT */
+#define KIS_EXTERNAL_CMD_OPENSOURCEREPORT   10  /* KDSOPENSOURCEREPORT */
+#define KIS_EXTERNAL_CMD_PROBESOURCEREPORT  11  /* KDSPROBESOURCEREPORT */
+#define KIS_EXTERNAL_CMD_WARNINGREPORT      12  /* KDSWARNINGREPORT */
+#define KIS_EXTERNAL_CMD_NEWSOURCE          13  /* KDSNEWSOURCE */
+#define KIS_EXTERNAL_CMD_HTTPREGISTERURI    14  /* HTTPREGISTERURI */
+#define KIS_EXTERNAL_CMD_HTTPRESPONSE       15  /* HTTPRESPONSE */
+#define KIS_EXTERNAL_CMD_HTTPAUTHREQ        16  /* HTTPAUTHREQ */
+#define KIS_EXTERNAL_CMD_EVENTBUSREGISTER   17  /* EVENTBUSREGISTER */
+#define KIS_EXTERNAL_CMD_EVENTBUSPUBLISH    18  /* EVENTBUSPUBLISH */
+/* Table version 2 */
+#define KIS_EXTERNAL_CMD_DATABATCHZ         19  /* KDSDATABATCHZ */
+/* Table version 3 */
+#define KIS_EXTERNAL_CMD_SPECTRUM           20  /* KDSSPECTRUM */
+#define KIS_EXTERNAL_CMD_MAX                20
+
+/* Batched data frames
+ *
+ * When the server offers batching in KDSOPENSOURCE (batch_max_bytes), a capture
+ * binary may pack multiple plain packets into a single KDSDATABATCH v2 frame instead
+ * of sending a protobuf DataReport per packet.  The frame payload is a batch header
+ * followed by num_packets records; each record is a record header, channel_len bytes
+ * of channel name (not null terminated), and packet_sz bytes of packet data.  All
+ * fields are big endian.
+ *
+ * Reports carrying GPS, messages, JSON, or other data are always sent as DataReport
+ * frames; a capture binary flushes any pending batch before sending them so that
+ * ordering is preserved.
+ */
+#define KIS_EXTERNAL_BATCH_CMD          "KDSDATABATCH"
+#define KIS_EXTERNAL_BATCH_VERSION      1
+/* Largest batch payload either side will accept, regardless of what is negotiated */
+#define KIS_EXTERNAL_BATCH_MAX_SZ       65536
+
+/* Record signal fields which are present */
+#define KIS_EXTERNAL_BATCH_SIGNAL_DBM   (1 << 0)
+#define KIS_EXTERNAL_BATCH_NOISE_DBM    (1 << 1)
+#define KIS_EXTERNAL_BATCH_SIGNAL_RSSI  (1 << 2)
+#define KIS_EXTERNAL_BATCH_NOISE_RSSI   (1 << 3)
+#define KIS_EXTERNAL_BATCH_FREQ         (1 << 4)
+#define KIS_EXTERNAL_BATCH_DATARATE     (1 << 5)
+
+/* Compressed batches
+ *
+ * When the server offers compression in KDSOPENSOURCE, a capture binary connected
+ * over TCP may send its batches as KDSDATABATCHZ frames instead.  All compressed
+ * batches on a connection form a single raw deflate stream (no zlib header, 32KB
+ * window); each frame payload is a short header followed by the output of compressing
+ * one complete batch payload and ending with a sync flush, so the receiver can inflate
+ * and process each frame as it arrives.  Because the stream spans every batch, the 
+ * repetitive headers of earlier frames of the same link type act as the dictionary for
+ * later ones.
+ *
+ * The capture binary starts a new stream each time the source is opened, and marks the
+ * first frame of the new stream so the receiver starts over as well. */
+#define KIS_EXTERNAL_BATCH_Z_CMD        "KDSDATABATCHZ"
+/* Largest compressed batch payload; deflate may grow incompressible data slightly */
+#define KIS_EXTERNAL_BATCH_Z_MAX_SZ     (KIS_EXTERNAL_BATCH_MAX_SZ + 1024)
+
+#define KIS_EXTERNAL_COMPRESSION_NONE       0
+#define KIS_EXTERNAL_COMPRESSION_DEFLATE    1
+
+/* Frame starts a new deflate stream */
+#define KIS_EXTERNAL_BATCH_Z_RESET      (1 << 0)
+
+struct kismet_external_batch_z {
+    uint16_t flags;
+    uint8_t data[0];
+} __attribute__((packed));
+typedef struct kismet_external_batch_z kismet_external_batch_z_t;
+
+struct kismet_external_batch {
+    uint16_t version;
+    uint16_t num_packets;
+    uint8_t data[0];
+} __attribute__((packed));
+typedef struct kismet_external_batch kismet_external_batch_t;
+
+struct kismet_external_batch_record {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t dlt;
+    /* Captured length of the packet data following this record */
+    uint32_t packet_sz;
+    /* Original length on the wire, or 0 if the packet was not truncated */
+    uint32_t original_sz;
+
+    /* KIS_EXTERNAL_BATCH_ fields which are set */
+    uint16_t flags;
+
+    /* Signal and noise; dBm or RSSI depending on the flags */
+    int16_t signal;
+    int16_t noise;
+
+    /* Length of the channel name which follows the record header */
+    uint16_t channel_len;
+
+    uint32_t freq_khz;
+    /* Data rate * 1000 */
+    uint32_t datarate;
+
+    uint8_t data[0];
+} __attribute__((packed));
+typedef struct kismet_external_batch_record kismet_external_batch_record_t;
+
+/* Spectrum sweeps
+ *
+ * Spectrum capture binaries send sweeps as KDSSPECTRUM frames instead of protobuf 
+ * reports with a value per bin.  The frame payload is a spectrum header followed by
+ * num_bins dBm values, as big endian IEEE754 float32 or as int8.  int8 bins are in
+ * half-dB steps from KIS_EXTERNAL_SPECTRUM_INT8_BASE, covering -128 to -0.5 dBm, which
+ * is all a spectrum display needs at a quarter of the size.
+ *
+ * A sweep may be sent as several frames, such as one per tuning step; every frame of
+ * a sweep carries the same sweep counter.  All fields are big endian.
+ */
+#define KIS_EXTERNAL_SPECTRUM_CMD       "KDSSPECTRUM"
+#define KIS_EXTERNAL_SPECTRUM_VERSION   1
+/* Most bins either side will accept in a single frame */
+#define KIS_EXTERNAL_SPECTRUM_MAX_BINS  16384
+
+#define KIS_EXTERNAL_SPECTRUM_FLOAT32   1
+#define KIS_EXTERNAL_SPECTRUM_INT8      2
+
+#define KIS_EXTERNAL_SPECTRUM_INT8_BASE (-64)
+
+struct kismet_external_spectrum {
+    uint16_t version;
+    /* KIS_EXTERNAL_SPECTRUM_ bin format */
+    uint16_t format;
+    uint32_t num_bins;
+
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+
+    /* Frequency of the first bin, and the width of each bin */
+    uint64_t start_hz;
+    uint32_t bin_hz;
+
+    uint32_t sweep;
+
+    uint8_t data[0];
+} __attribute__((packed));
+typedef struct kismet_external_spectrum kismet_external_spectrum_t;
+
+/* Shared memory ring transport
+ *
+ * When the server launches a helper over IPC it may also create a shared memory ring
+ * and pass the inherited descriptor in the KIS_EXTERNAL_SHM_ENV environment variable.
+ * A helper which supports it maps the ring and writes its v2 frames directly into the
+ * ring instead of the output pipe; the pipes remain open and are still used for
+ * commands from the server and to detect the helper exiting.  Helpers which do not
+ * know about the ring ignore the environment and continue to use the pipe.
+ *
+ * The ring has a single producer (the helper) and a single consumer (the server).
+ * head and tail are free-running byte counts, frames start on 8 byte boundaries, and
+ * a frame never wraps around the end of the ring; if a frame does not fit before the
+ * end, the producer writes a zero signature and continues at the start.
+ *
+ * Each side sets its waiting word before sleeping on it with a futex, and the other
+ * side only makes the wake call when the word is set, so while both sides are busy no
+ * system calls are made at all.  All fields are host byte order.
+ */
+#define KIS_EXTERNAL_SHM_ENV            "KISMET_IPC_SHM_FD"
+#define KIS_EXTERNAL_SHM_SIG            0x4B534852
+#define KIS_EXTERNAL_SHM_VERSION        1
+/* Data region offset from the start of the mapping */
+#define KIS_EXTERNAL_SHM_DATA_OFFSET    4096
+#define KIS_EXTERNAL_SHM_ALIGN          8
+
+struct kismet_external_shm_ring {
+    uint32_t signature;
+    uint32_t version;
+    /* Size of the data region, always a power of two */
+    uint64_t ring_sz;
+
+    /* Written by the producer */
+    uint64_t head __attribute__((aligned(64)));
+    uint32_t producer_waiting;
+    uint32_t producer_attached;
+
+    /* Written by the consumer */
+    uint64_t tail __attribute__((aligned(64)));
+    uint32_t consumer_waiting;
+} __attribute__((aligned(64)));
+typedef struct kismet_external_shm_ring kismet_external_shm_ring_t;
+
 /* Error codes from capture binaries */
 #define KIS_EXTERNAL_RETCODE_OK             0
 #define KIS_EXTERNAL_RETCODE_GENERIC        1
@@ -0,0 +1,499 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <chrono>
+#include <limits>
+#include <sstream>
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include "configfile.h"
+#include "entrytracker.h"
+#include "fmt.h"
+#include "kis_federation.h"
+#include "kis_net_beast_httpd.h"
+#include "messagebus.h"
+#include "util.h"
+
+namespace {
+
+// Fields requested from each sensor; the simplified records are keyed by the last
+// component of each path
+const char *federation_fields[] = {
+    "kismet.device.base.macaddr",
+    "kismet.device.base.phyname",
+    "kismet.device.base.type",
+    "kismet.device.base.name",
+    "kismet.device.base.first_time",
+    "kismet.device.base.last_time",
+    "kismet.device.base.packets.total",
+    "kismet.device.base.channel",
+    "kismet.device.base.frequency",
+    "kismet.device.base.mod_seq",
+    "kismet.server.uuid",
+    "kismet.device.base.signal/kismet.common.signal.last_signal",
+};
+
+}
+
+struct kis_federation::sensor {
+    std::shared_ptr<kis_tracked_federation_sensor> status;
+
+    std::string name, host, port, apikey;
+
+    // Highest sensor sequence number merged; reset to 0 to resync everything after
+    // the sensor has been unreachable, as it may have restarted with a new change log
+    uint64_t seq;
+    bool resync;
+
+    boost::asio::io_context ioc;
+    std::unique_ptr<boost::beast::tcp_stream> stream;
+    boost::beast::flat_buffer buffer;
+
+    std::thread thread;
+};
+
+kis_federation::kis_federation() :
+    shutdown{false},
+    poll_interval{5},
+    poll_timeout{30} {
+
+    federation_mutex.set_name("kis_federation");
+
+    sensor_status_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.federation.sensor",
+                tracker_element_factory<kis_tracked_federation_sensor>(),
+                "federated sensor");
+
+    federation_device_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.device.federation",
+                tracker_element_factory<kis_tracked_federation_device>(),
+                "federated sensors reporting a device");
+
+    federation_seenby_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.federation.seenby",
+                tracker_element_factory<kis_tracked_federation_seenby>(),
+                "federated sensor record");
+
+    sensor_status_vec = std::make_shared<tracker_element_vector>();
+
+    auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
+
+    httpd->register_route("/federation/sensors", {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(sensor_status_vec, federation_mutex));
+}
+
+kis_federation::~kis_federation() {
+    trigger_deferred_shutdown();
+    Globalreg::globalreg->remove_global(global_name());
+}
+
+bool kis_federation::sensor_in_shard(const std::string& in_name, unsigned int in_shard,
+        unsigned int in_num_shards) {
+    if (in_num_shards <= 1)
+        return true;
+
+    return adler32_checksum(in_name) % in_num_shards == in_shard;
+}
+
+void kis_federation::trigger_deferred_startup() {
+    devicetracker = Globalreg::fetch_mandatory_global_as<device_tracker>();
+
+    auto config = Globalreg::globalreg->kismet_config;
+
+    poll_interval = std::max(1U, config->fetch_opt_uint("federation_interval", poll_interval));
+    poll_timeout = std::max(1U, config->fetch_opt_uint("federation_timeout", poll_timeout));
+
+    unsigned int shard = 0, num_shards = 1;
+    auto shard_s = config->fetch_opt("federation_shard");
+
+    if (shard_s.length()) {
+        auto sv = str_tokenize(shard_s, "/");
+
+        if (sv.size() != 2 ||
+                (shard = string_to_n_dfl<unsigned int>(sv[0], 0)) >=
+                (num_shards = std::max(1U, string_to_n_dfl<unsigned int>(sv[1], 1)))) {
+            _MSG_ERROR("Invalid federation_shard '{}', expected shard/count such as 0/4; "
+                    "polling every federated sensor", shard_s);
+            shard = 0;
+            num_shards = 1;
+        }
+    }
+
+    for (const auto& s : config->fetch_opt_vec("federation_sensor")) {
+        // name:host=...,port=...,apikey=...
+        auto cpos = s.find(':');
+        std::vector<opt_pair> opts;
+
+        auto name = s.substr(0, cpos);
+
+        if (cpos != std::string::npos)
+            string_to_opts(s.substr(cpos + 1), ",", &opts);
+
+        auto host = fetch_opt("host", &opts);
+
+        if (name.length() == 0 || host.length() == 0) {
+            _MSG_ERROR("Invalid federation_sensor '{}', expected name:host=...,port=...,apikey=...",
+                    s);
+            continue;
+        }
+
+        if (!sensor_in_shard(name, shard, num_shards))
+            continue;
+
+        auto port = fetch_opt("port", &opts);
+
+        if (port.length() == 0)
+            port = "2501";
+
+        auto sens = std::make_shared<sensor>();
+
+        sens->name = name;
+        sens->host = host;
+        sens->port = port;
+        sens->apikey = fetch_opt("apikey", &opts);
+        sens->seq = 0;
+        sens->resync = true;
+
+        sens->status = std::make_shared<kis_tracked_federation_sensor>(sensor_status_id);
+        sens->status->set_name(name);
+        sens->status->set_host(host);
+        sens->status->set_port(port);
+
+        {
+            kis_lock_guard<kis_mutex> lk(federation_mutex, "kis_federation startup");
+            sensor_status_vec->push_back(sens->status);
+        }
+
+        sensors.push_back(sens);
+    }
+
+    if (sensors.size() == 0)
+        return;
+
+    _MSG_INFO("Federating devices from {} sensor(s) (shard {}/{}), polling every {} seconds",
+            sensors.size(), shard, num_shards, poll_interval);
+
+    for (auto& s : sensors) {
+        s->thread = std::thread([this, s]() {
+                thread_set_process_name("FEDERATION");
+                sensor_worker(s);
+            });
+    }
+}
+
+void kis_federation::trigger_deferred_shutdown() {
+    {
+        std::lock_guard<std::mutex> lk(shutdown_mutex);
+
+        if (shutdown)
+            return;
+
+        shutdown = true;
+    }
+
+    shutdown_cv.notify_all();
+
+    // Abort any request in progress
+    for (auto& s : sensors)
+        s->ioc.stop();
+
+    for (auto& s : sensors) {
+        if (s->thread.joinable())
+            s->thread.join();
+    }
+}
+
+void kis_federation::sensor_worker(std::shared_ptr<sensor> in_sensor) {
+    while (!shutdown) {
+        try {
+            auto n = poll_sensor(in_sensor);
+
+            kis_lock_guard<kis_mutex> lk(federation_mutex, "kis_federation sensor_worker");
+
+            if (!in_sensor->status->get_connected())
+                _MSG_INFO("Federated sensor {} ({}:{}) connected", in_sensor->name,
+                        in_sensor->host, in_sensor->port);
+
+            in_sensor->status->set_connected(true);
+            in_sensor->status->set_last_seq(in_sensor->seq);
+            in_sensor->status->set_last_poll(time(0));
+            in_sensor->status->inc_num_polls(1);
+            in_sensor->status->inc_num_merged(n);
+        } catch (const std::exception& e) {
+            in_sensor->stream.reset();
+            in_sensor->resync = true;
+
+            if (shutdown)
+                break;
+
+            kis_lock_guard<kis_mutex> lk(federation_mutex, "kis_federation sensor_worker");
+
+            if (in_sensor->status->get_connected() || in_sensor->status->get_num_errors() == 0)
+                _MSG_ERROR("Federated sensor {} ({}:{}) failed: {}", in_sensor->name,
+                        in_sensor->host, in_sensor->port, e.what());
+
+            in_sensor->status->set_connected(false);
+            in_sensor->status->set_last_error(e.what());
+            in_sensor->status->inc_num_errors(1);
+        }
+
+        std::unique_lock<std::mutex> lk(shutdown_mutex);
+        shutdown_cv.wait_for(lk, std::chrono::seconds(poll_interval), [this]() { return shutdown.load(); });
+    }
+}
+
+size_t kis_federation::poll_sensor(std::shared_ptr<sensor> in_sensor) {
+    namespace beast = boost::beast;
+    namespace http = beast::http;
+    using tcp = boost::asio::ip::tcp;
+
+    if (in_sensor->resync) {
+        in_sensor->seq = 0;
+        in_sensor->resync = false;
+    }
+
+    Json::Value req_json;
+    req_json["fields"] = Json::Value(Json::arrayValue);
+
+    for (auto f : federation_fields)
+        req_json["fields"].append(f);
+
+    http::request<http::string_body> req{http::verb::post,
+        fmt::format("/devices/views/all/since-seq/{}/devices.json", in_sensor->seq), 11};
+    req.set(http::field::host, in_sensor->host);
+    req.set(http::field::user_agent, "Kismet federation");
+    req.set(http::field::content_type, "application/json");
+    if (in_sensor->apikey.length())
+        req.set(http::field::cookie,
+                fmt::format("{}={}", kis_net_beast_httpd::AUTH_COOKIE, in_sensor->apikey));
+    req.keep_alive(true);
+    req.body() = Json::writeString(Json::StreamWriterBuilder(), req_json);
+    req.prepare_payload();
+
+    // The change log of a busy sensor can be large on the first poll
+    http::response_parser<http::string_body> parser;
+    parser.body_limit(std::numeric_limits<std::uint64_t>::max());
+
+    boost::system::error_code result_ec;
+    auto timeout = std::chrono::seconds(poll_timeout);
+
+    auto do_request = [&]() {
+        in_sensor->stream->expires_after(timeout);
+        http::async_write(*in_sensor->stream, req,
+                [&](const boost::system::error_code& ec, size_t) {
+                    if (ec) {
+                        result_ec = ec;
+                        return;
+                    }
+
+                    in_sensor->stream->expires_after(timeout);
+                    http::async_read(*in_sensor->stream, in_sensor->buffer, parser,
+                            [&](const boost::system::error_code& ec, size_t) {
+                                result_ec = ec;
+                            });
+                });
+    };
+
+    in_sensor->ioc.restart();
+
+    tcp::resolver resolver(in_sensor->ioc);
+
+    if (in_sensor->stream == nullptr) {
+        in_sensor->buffer.clear();
+        in_sensor->stream.reset(new beast::tcp_stream(in_sensor->ioc));
+
+        resolver.async_resolve(in_sensor->host, in_sensor->port,
+                [&](const boost::system::error_code& ec, tcp::resolver::results_type results) {
+                    if (ec) {
+                        result_ec = ec;
+                        return;
+                    }
+
+                    in_sensor->stream->expires_after(timeout);
+                    in_sensor->stream->async_connect(results,
+                            [&](const boost::system::error_code& ec, tcp::endpoint) {
+                                if (ec) {
+                                    result_ec = ec;
+                                    return;
+                                }
+
+                                do_request();
+                            });
+                });
+    } else {
+        do_request();
+    }
+
+    in_sensor->ioc.run();
+
+    if (shutdown)
+        throw std::runtime_error("shutting down");
+
+    if (result_ec)
+        throw std::runtime_error(result_ec.message());
+
+    if (!parser.is_done())
+        throw std::runtime_error("incomplete response");
+
+    auto& res = parser.get();
+
+    if (!res.keep_alive())
+        in_sensor->stream.reset();
+
+    if (res.result_int() != 200)
+        throw std::runtime_error(fmt::format("HTTP error {}", res.result_int()));
+
+    Json::Value devices;
+    std::string errs;
+    std::stringstream ss(res.body());
+
+    if (!Json::parseFromStream(Json::CharReaderBuilder(), ss, &devices, &errs) ||
+            !devices.isArray())
+        throw std::runtime_error(fmt::format("invalid device list: {}", errs));
+
+    size_t n_merged = 0, n_skipped = 0;
+
+    {
+        kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(),
+                "kis_federation poll_sensor");
+
+        for (const auto& d : devices) {
+            if (merge_device(in_sensor, d))
+                n_merged++;
+            else
+                n_skipped++;
+
+            // Resume after the highest change seen, even from devices we can't merge
+            auto seq = d["kismet.device.base.mod_seq"].asUInt64();
+            if (seq > in_sensor->seq)
+                in_sensor->seq = seq;
+        }
+    }
+
+    if (n_skipped) {
+        kis_lock_guard<kis_mutex> lk(federation_mutex, "kis_federation poll_sensor");
+        in_sensor->status->inc_num_skipped(n_skipped);
+    }
+
+    return n_merged;
+}
+
+bool kis_federation::merge_device(std::shared_ptr<sensor> in_sensor, const Json::Value& in_json) {
+    if (!in_json.isObject())
+        return false;
+
+    // Devices of phys this server doesn't have, such as from plugins, can't be merged
+    auto phy = devicetracker->fetch_phy_handler_by_name(in_json["kismet.device.base.phyname"].asString());
+
+    if (phy == nullptr)
+        return false;
+
+    mac_addr mac(in_json["kismet.device.base.macaddr"].asString());
+
+    if (mac.error())
+        return false;
+
+    time_t first_time = in_json["kismet.device.base.first_time"].asUInt64();
+    time_t last_time = in_json["kismet.device.base.last_time"].asUInt64();
+    auto packets = in_json["kismet.device.base.packets.total"].asUInt64();
+
+    bool new_dev;
+    auto device = devicetracker->fetch_or_create_device(mac, phy,
+            in_json["kismet.device.base.type"].asString(), first_time, new_dev);
+
+    auto fed = device->get_sub_as<kis_tracked_federation_device>(federation_device_id);
+
+    if (fed == nullptr) {
+        fed = std::make_shared<kis_tracked_federation_device>(federation_device_id);
+        device->insert(fed);
+    }
+
+    auto sensors_map = fed->get_sensors();
+    std::shared_ptr<kis_tracked_federation_seenby> seenby;
+
+    auto si = sensors_map->find(in_sensor->name);
+
+    if (si != sensors_map->end()) {
+        seenby = std::static_pointer_cast<kis_tracked_federation_seenby>(si->second);
+    } else {
+        seenby = std::make_shared<kis_tracked_federation_seenby>(federation_seenby_id);
+        seenby->set_sensor(in_sensor->name);
+        seenby->set_first_time(first_time);
+        sensors_map->insert(in_sensor->name, seenby);
+    }
+
+    // Add only the packets the sensor has seen since it last reported the device, so
+    // the count covers every sensor and any local sources; a sensor reporting fewer
+    // packets than before has restarted
+    auto prev_packets = seenby->get_packets();
+
+    if (packets >= prev_packets)
+        device->set_packets(device->get_packets() + (packets - prev_packets));
+    else
+        device->set_packets(device->get_packets() + packets);
+
+    // The most recent report decides where the device is now
+    if (last_time >= device->get_last_time()) {
+        auto channel = in_json["kismet.device.base.channel"].asString();
+
+        if (channel.length() != 0 && channel != "0")
+            device->set_channel(channel);
+
+        auto freq = in_json["kismet.device.base.frequency"].asDouble();
+
+        if (freq != 0)
+            device->set_frequency(freq);
+    }
+
+    if (first_time != 0 && first_time < device->get_first_time())
+        device->set_first_time(first_time);
+
+    if (last_time > device->get_last_time())
+        device->set_last_time(last_time);
+
+    auto name = in_json["kismet.device.base.name"].asString();
+
+    if (name.length() != 0 && device->get_devicename().length() == 0)
+        device->set_devicename(name);
+
+    if (first_time != 0 && first_time < seenby->get_first_time())
+        seenby->set_first_time(first_time);
+
+    seenby->set_last_time(last_time);
+    seenby->set_packets(packets);
+    seenby->set_mod_seq(in_json["kismet.device.base.mod_seq"].asUInt64());
+
+    auto server_uuid = in_json["kismet.server.uuid"].asString();
+
+    if (server_uuid.length() != 0)
+        seenby->set_server_uuid(uuid(server_uuid));
+
+    auto signal = in_json["kismet.common.signal.last_signal"];
+
+    if (signal.isNumeric())
+        seenby->set_last_signal(signal.asInt());
+
+    devicetracker->commit_device(device, new_dev);
+
+    return true;
+}
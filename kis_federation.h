@@ -0,0 +1,310 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_FEDERATION_H__
+#define __KIS_FEDERATION_H__
+
+#include "config.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "devicetracker.h"
+#include "globalregistry.h"
+#include "kis_mutex.h"
+#include "trackedcomponent.h"
+#include "trackedelement.h"
+
+// Server federation
+//
+// An aggregating server polls the device change log of any number of downstream
+// Kismet servers (sensors) and merges the devices into its own device tracker, so one
+// UI and one set of logs covers every sensor.  Each sensor is polled from its own
+// thread with the /devices/views/all/since-seq/ endpoint, asking only for the devices
+// modified since the highest sequence number already merged, and only for the fields
+// needed to merge them.
+//
+// Devices are merged by device key; the key is built from the phy name and MAC, so
+// the same device seen by several sensors becomes a single device on the aggregator.
+// Each merged device carries a kismet.device.federation record of the sensors which
+// reported it, with the per-sensor times, packets, and signal.
+//
+// Sensors are sharded across aggregators by a hash of the sensor name: every
+// aggregator may be given the same list of sensors, and one configured as shard i of n
+// only polls the sensors which hash to i.
+
+// Per-sensor attribution of a federated device
+class kis_tracked_federation_seenby : public tracker_component {
+public:
+    kis_tracked_federation_seenby() :
+        tracker_component() {
+        register_fields();
+        reserve_fields(NULL);
+    }
+
+    kis_tracked_federation_seenby(int in_id) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(NULL);
+    }
+
+    kis_tracked_federation_seenby(int in_id, std::shared_ptr<tracker_element_map> e) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(e);
+    }
+
+    kis_tracked_federation_seenby(const kis_tracked_federation_seenby *p) :
+        tracker_component{p} {
+        __ImportField(sensor, p);
+        __ImportField(server_uuid, p);
+        __ImportField(first_time, p);
+        __ImportField(last_time, p);
+        __ImportField(packets, p);
+        __ImportField(last_signal, p);
+        __ImportField(mod_seq, p);
+
+        reserve_fields(nullptr);
+    }
+
+    virtual uint32_t get_signature() const override {
+        return adler32_checksum("kis_tracked_federation_seenby");
+    }
+
+    virtual std::shared_ptr<tracker_element> clone_type() override {
+        using this_t = typename std::remove_pointer<decltype(this)>::type;
+        auto r = tracker_arena_make_shared<this_t>(this);
+        return r;
+    }
+
+    __Proxy(sensor, std::string, std::string, std::string, sensor);
+    __Proxy(server_uuid, uuid, uuid, uuid, server_uuid);
+    __Proxy(first_time, uint64_t, time_t, time_t, first_time);
+    __Proxy(last_time, uint64_t, time_t, time_t, last_time);
+    __Proxy(packets, uint64_t, uint64_t, uint64_t, packets);
+    __Proxy(last_signal, int32_t, int32_t, int32_t, last_signal);
+    __Proxy(mod_seq, uint64_t, uint64_t, uint64_t, mod_seq);
+
+protected:
+    virtual void register_fields() override {
+        register_field("kismet.federation.seenby.sensor", "sensor name", &sensor);
+        register_field("kismet.federation.seenby.server_uuid", "sensor server UUID", &server_uuid);
+        register_field("kismet.federation.seenby.first_time", "first time seen by sensor", &first_time);
+        register_field("kismet.federation.seenby.last_time", "last time seen by sensor", &last_time);
+        register_field("kismet.federation.seenby.packets", "packets seen by sensor", &packets);
+        register_field("kismet.federation.seenby.last_signal", "last signal seen by sensor", &last_signal);
+        register_field("kismet.federation.seenby.mod_seq",
+                "sensor modification sequence number of last merge", &mod_seq);
+    }
+
+    std::shared_ptr<tracker_element_string> sensor;
+    std::shared_ptr<tracker_element_uuid> server_uuid;
+    std::shared_ptr<tracker_element_uint64> first_time;
+    std::shared_ptr<tracker_element_uint64> last_time;
+    std::shared_ptr<tracker_element_uint64> packets;
+    std::shared_ptr<tracker_element_int32> last_signal;
+    std::shared_ptr<tracker_element_uint64> mod_seq;
+};
+
+// Federation record of a device, the sensors which reported it
+class kis_tracked_federation_device : public tracker_component {
+public:
+    kis_tracked_federation_device() :
+        tracker_component() {
+        register_fields();
+        reserve_fields(NULL);
+    }
+
+    kis_tracked_federation_device(int in_id) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(NULL);
+    }
+
+    kis_tracked_federation_device(int in_id, std::shared_ptr<tracker_element_map> e) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(e);
+    }
+
+    kis_tracked_federation_device(const kis_tracked_federation_device *p) :
+        tracker_component{p} {
+        __ImportField(sensors, p);
+
+        reserve_fields(nullptr);
+    }
+
+    virtual uint32_t get_signature() const override {
+        return adler32_checksum("kis_tracked_federation_device");
+    }
+
+    virtual std::shared_ptr<tracker_element> clone_type() override {
+        using this_t = typename std::remove_pointer<decltype(this)>::type;
+        auto r = tracker_arena_make_shared<this_t>(this);
+        return r;
+    }
+
+    __ProxyTrackable(sensors, tracker_element_string_map, sensors);
+
+protected:
+    virtual void register_fields() override {
+        register_field("kismet.federation.sensors", "sensors reporting this device", &sensors);
+    }
+
+    std::shared_ptr<tracker_element_string_map> sensors;
+};
+
+// State of a downstream sensor
+class kis_tracked_federation_sensor : public tracker_component {
+public:
+    kis_tracked_federation_sensor() :
+        tracker_component() {
+        register_fields();
+        reserve_fields(NULL);
+    }
+
+    kis_tracked_federation_sensor(int in_id) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(NULL);
+    }
+
+    kis_tracked_federation_sensor(int in_id, std::shared_ptr<tracker_element_map> e) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(e);
+    }
+
+    virtual uint32_t get_signature() const override {
+        return adler32_checksum("kis_tracked_federation_sensor");
+    }
+
+    virtual std::shared_ptr<tracker_element> clone_type() override {
+        using this_t = typename std::remove_pointer<decltype(this)>::type;
+        auto r = std::make_shared<this_t>();
+        r->set_id(this->get_id());
+        return r;
+    }
+
+    __Proxy(name, std::string, std::string, std::string, name);
+    __Proxy(host, std::string, std::string, std::string, host);
+    __Proxy(port, std::string, std::string, std::string, port);
+    __Proxy(connected, uint8_t, bool, bool, connected);
+    __Proxy(last_seq, uint64_t, uint64_t, uint64_t, last_seq);
+    __Proxy(last_poll, uint64_t, time_t, time_t, last_poll);
+    __Proxy(num_polls, uint64_t, uint64_t, uint64_t, num_polls);
+    __ProxyIncDec(num_polls, uint64_t, uint64_t, num_polls);
+    __Proxy(num_merged, uint64_t, uint64_t, uint64_t, num_merged);
+    __ProxyIncDec(num_merged, uint64_t, uint64_t, num_merged);
+    __Proxy(num_skipped, uint64_t, uint64_t, uint64_t, num_skipped);
+    __ProxyIncDec(num_skipped, uint64_t, uint64_t, num_skipped);
+    __Proxy(num_errors, uint64_t, uint64_t, uint64_t, num_errors);
+    __ProxyIncDec(num_errors, uint64_t, uint64_t, num_errors);
+    __Proxy(last_error, std::string, std::string, std::string, last_error);
+
+protected:
+    virtual void register_fields() override {
+        register_field("kismet.federation.sensor.name", "sensor name", &name);
+        register_field("kismet.federation.sensor.host", "sensor host", &host);
+        register_field("kismet.federation.sensor.port", "sensor port", &port);
+        register_field("kismet.federation.sensor.connected", "sensor is reachable", &connected);
+        register_field("kismet.federation.sensor.last_seq",
+                "highest sensor modification sequence number merged", &last_seq);
+        register_field("kismet.federation.sensor.last_poll", "time of last successful poll", &last_poll);
+        register_field("kismet.federation.sensor.num_polls", "successful polls", &num_polls);
+        register_field("kismet.federation.sensor.num_merged", "device updates merged", &num_merged);
+        register_field("kismet.federation.sensor.num_skipped",
+                "device updates skipped, such as devices of unknown phys", &num_skipped);
+        register_field("kismet.federation.sensor.num_errors", "failed polls", &num_errors);
+        register_field("kismet.federation.sensor.last_error", "last poll error", &last_error);
+    }
+
+    std::shared_ptr<tracker_element_string> name;
+    std::shared_ptr<tracker_element_string> host;
+    std::shared_ptr<tracker_element_string> port;
+    std::shared_ptr<tracker_element_uint8> connected;
+    std::shared_ptr<tracker_element_uint64> last_seq;
+    std::shared_ptr<tracker_element_uint64> last_poll;
+    std::shared_ptr<tracker_element_uint64> num_polls;
+    std::shared_ptr<tracker_element_uint64> num_merged;
+    std::shared_ptr<tracker_element_uint64> num_skipped;
+    std::shared_ptr<tracker_element_uint64> num_errors;
+    std::shared_ptr<tracker_element_string> last_error;
+};
+
+class kis_federation : public lifetime_global, public deferred_startup {
+public:
+    static std::string global_name() { return "KIS_FEDERATION"; }
+
+    static std::shared_ptr<kis_federation> create_federation() {
+        std::shared_ptr<kis_federation> shared(new kis_federation());
+        Globalreg::globalreg->register_lifetime_global(shared);
+        Globalreg::globalreg->insert_global(global_name(), shared);
+        Globalreg::globalreg->register_deferred_global(shared);
+        return shared;
+    }
+
+private:
+    kis_federation();
+
+public:
+    virtual ~kis_federation();
+
+    // Is a sensor assigned to this aggregator, for shard in_shard of in_num_shards
+    static bool sensor_in_shard(const std::string& in_name, unsigned int in_shard,
+            unsigned int in_num_shards);
+
+protected:
+    virtual void trigger_deferred_startup() override;
+    virtual void trigger_deferred_shutdown() override;
+
+    struct sensor;
+
+    void sensor_worker(std::shared_ptr<sensor> in_sensor);
+
+    // Fetch the devices modified since the last poll and merge them, returning the
+    // number of devices merged; throws on any connection or protocol error
+    size_t poll_sensor(std::shared_ptr<sensor> in_sensor);
+
+    // Merge one device record from a sensor; must be called under the devicelist lock
+    bool merge_device(std::shared_ptr<sensor> in_sensor, const Json::Value& in_json);
+
+    std::shared_ptr<device_tracker> devicetracker;
+
+    // Protects the sensor status records
+    kis_mutex federation_mutex;
+
+    std::shared_ptr<tracker_element_vector> sensor_status_vec;
+    std::vector<std::shared_ptr<sensor>> sensors;
+
+    std::mutex shutdown_mutex;
+    std::condition_variable shutdown_cv;
+    std::atomic<bool> shutdown;
+
+    unsigned int poll_interval;
+    unsigned int poll_timeout;
+
+    int sensor_status_id, federation_device_id, federation_seenby_id;
+};
+
+#endif
@@ -0,0 +1,241 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_FLAT_MAP_H__
+#define __KIS_FLAT_MAP_H__
+
+#include "config.h"
+
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "robin_hood.h"
+
+// Unordered map holding its entries in one contiguous vector.
+//
+// Most keyed maps in tracked records - the per-datasource seen-by records, the
+// frequencies of a device, the clients and SSIDs of a typical AP - hold only a handful
+// of entries, and a node map spends an allocation on each entry plus the bucket table.
+// Up to N entries are found by a linear scan of the vector; past that a hash index of
+// key to position is built, so large maps keep constant time lookups.
+//
+// Unlike a node map, inserting may move existing entries, so references to values
+// must not be held across an insert.  Erasing moves the last entry into the erased
+// position, and returns an iterator to that position, so erase-while-iterating loops
+// still visit every entry.
+template<typename K, typename V, size_t N = 8>
+class kis_flat_map {
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using size_type = size_t;
+    using iterator = value_type *;
+    using const_iterator = const value_type *;
+
+    kis_flat_map() { }
+
+    kis_flat_map(const kis_flat_map& o) :
+        entries{o.entries} {
+        if (o.index != nullptr)
+            build_index();
+    }
+
+    kis_flat_map(kis_flat_map&& o) noexcept :
+        entries{std::move(o.entries)},
+        index{std::move(o.index)} { }
+
+    kis_flat_map& operator=(const kis_flat_map& o) {
+        if (this != &o) {
+            entries = o.entries;
+            index.reset();
+
+            if (o.index != nullptr)
+                build_index();
+        }
+
+        return *this;
+    }
+
+    kis_flat_map& operator=(kis_flat_map&& o) noexcept {
+        entries = std::move(o.entries);
+        index = std::move(o.index);
+        return *this;
+    }
+
+    iterator begin() { return entries.data(); }
+    iterator end() { return entries.data() + entries.size(); }
+    const_iterator begin() const { return entries.data(); }
+    const_iterator end() const { return entries.data() + entries.size(); }
+    const_iterator cbegin() const { return entries.data(); }
+    const_iterator cend() const { return entries.data() + entries.size(); }
+
+    size_t size() const { return entries.size(); }
+    bool empty() const noexcept { return entries.empty(); }
+
+    void clear() noexcept {
+        entries.clear();
+        index.reset();
+    }
+
+    void reserve(size_t n) {
+        entries.reserve(n);
+    }
+
+    iterator find(const K& k) {
+        return begin() + position(k);
+    }
+
+    const_iterator find(const K& k) const {
+        return begin() + position(k);
+    }
+
+    size_t count(const K& k) const {
+        return position(k) == entries.size() ? 0 : 1;
+    }
+
+    V& at(const K& k) {
+        auto i = find(k);
+
+        if (i == end())
+            throw std::out_of_range("kis_flat_map::at");
+
+        return i->second;
+    }
+
+    V& operator[](const K& k) {
+        auto i = find(k);
+
+        if (i != end())
+            return i->second;
+
+        return append(value_type{k, V{}})->second;
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) {
+        auto i = find(v.first);
+
+        if (i != end())
+            return std::make_pair(i, false);
+
+        return std::make_pair(append(v), true);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& v) {
+        auto i = find(v.first);
+
+        if (i != end())
+            return std::make_pair(i, false);
+
+        return std::make_pair(append(std::move(v)), true);
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+
+    iterator erase(const_iterator pos) {
+        size_t p = pos - cbegin();
+
+        if (p >= entries.size())
+            return end();
+
+        if (index != nullptr)
+            index->erase(entries[p].first);
+
+        if (p != entries.size() - 1) {
+            entries[p] = std::move(entries.back());
+
+            if (index != nullptr)
+                (*index)[entries[p].first] = p;
+        }
+
+        entries.pop_back();
+
+        if (index != nullptr && entries.size() <= N / 2)
+            index.reset();
+
+        return begin() + p;
+    }
+
+    // Erase from the back of the range so the entries moved into erased positions
+    // always come from past the range
+    iterator erase(const_iterator first, const_iterator last) {
+        size_t f = first - cbegin();
+        size_t l = last - cbegin();
+
+        while (l > f)
+            erase(cbegin() + --l);
+
+        return begin() + f;
+    }
+
+    size_t erase(const K& k) {
+        auto i = find(k);
+
+        if (i == end())
+            return 0;
+
+        erase(i);
+        return 1;
+    }
+
+protected:
+    size_t position(const K& k) const {
+        if (index != nullptr) {
+            auto i = index->find(k);
+            return i == index->end() ? entries.size() : i->second;
+        }
+
+        for (size_t p = 0; p < entries.size(); p++) {
+            if (entries[p].first == k)
+                return p;
+        }
+
+        return entries.size();
+    }
+
+    template<typename T>
+    iterator append(T&& v) {
+        entries.emplace_back(std::forward<T>(v));
+
+        if (index != nullptr)
+            (*index)[entries.back().first] = entries.size() - 1;
+        else if (entries.size() > N)
+            build_index();
+
+        return end() - 1;
+    }
+
+    void build_index() {
+        index = std::make_unique<robin_hood::unordered_flat_map<K, size_t>>();
+        index->reserve(entries.size());
+
+        for (size_t p = 0; p < entries.size(); p++)
+            (*index)[entries[p].first] = p;
+    }
+
+    std::vector<value_type> entries;
+    std::unique_ptr<robin_hood::unordered_flat_map<K, size_t>> index;
+};
+
+#endif
+
@@ -0,0 +1,138 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "kis_fragment_cache.h"
+
+#include <sstream>
+
+kis_fragment_cache::kis_fragment_cache() :
+    max_bytes{0},
+    max_age{0},
+    total_bytes{0},
+    hits{0},
+    misses{0} {
+    mutex.set_name("kis_fragment_cache");
+}
+
+void kis_fragment_cache::set_limits(size_t in_max_bytes, time_t in_max_age) {
+    kis_lock_guard<kis_fast_mutex> lk(mutex, "kis_fragment_cache set_limits");
+
+    max_bytes = in_max_bytes;
+    max_age = in_max_age;
+
+    while (!lru.empty() && total_bytes > max_bytes) {
+        total_bytes -= fragment_size(lru.back());
+        index.erase(lru.back().key);
+        lru.pop_back();
+    }
+}
+
+std::shared_ptr<const std::string> kis_fragment_cache::fetch(const device_key& in_key,
+        uint64_t in_seq, const tracker_element_serializer *in_serializer,
+        const std::string& in_fields, const std::function<bool (std::ostream&)>& produce) {
+
+    auto now = time(0);
+
+    cache_key key{in_key, in_serializer, in_fields};
+
+    if (in_seq != 0) {
+        kis_lock_guard<kis_fast_mutex> lk(mutex, "kis_fragment_cache fetch");
+
+        if (max_bytes != 0) {
+            auto i = index.find(key);
+
+            if (i != index.end() && i->second->seq == in_seq &&
+                    (max_age == 0 || now - i->second->created < max_age)) {
+                lru.splice(lru.begin(), lru, i->second);
+                hits++;
+                return i->second->text;
+            }
+
+            misses++;
+        }
+    }
+
+    // Serialize outside of the lock; two threads missing the same record at once each
+    // serialize it, and the newest sequence is kept
+    std::stringstream ss;
+
+    if (!produce(ss))
+        return nullptr;
+
+    auto text = std::make_shared<const std::string>(ss.str());
+
+    if (in_seq == 0)
+        return text;
+
+    kis_lock_guard<kis_fast_mutex> lk(mutex, "kis_fragment_cache insert");
+
+    if (max_bytes == 0)
+        return text;
+
+    auto i = index.find(key);
+
+    if (i != index.end()) {
+        if (i->second->seq > in_seq)
+            return text;
+
+        total_bytes -= fragment_size(*(i->second));
+        lru.erase(i->second);
+        index.erase(i);
+    }
+
+    lru.push_front(fragment{std::move(key), in_seq, now, text});
+
+    auto sz = fragment_size(lru.front());
+
+    // Records too large to ever fit aren't kept
+    if (sz > max_bytes) {
+        lru.pop_front();
+        return text;
+    }
+
+    index[lru.front().key] = lru.begin();
+    total_bytes += sz;
+
+    while (total_bytes > max_bytes) {
+        total_bytes -= fragment_size(lru.back());
+        index.erase(lru.back().key);
+        lru.pop_back();
+    }
+
+    return text;
+}
+
+std::shared_ptr<tracker_element> kis_fragment_cache::get_stats() {
+    auto ret = std::make_shared<tracker_element_string_map>();
+
+    kis_lock_guard<kis_fast_mutex> lk(mutex, "kis_fragment_cache get_stats");
+
+    ret->insert(std::make_pair("kismet.fragment_cache.records",
+                std::make_shared<tracker_element_uint64>(0, lru.size())));
+    ret->insert(std::make_pair("kismet.fragment_cache.bytes",
+                std::make_shared<tracker_element_uint64>(0, total_bytes)));
+    ret->insert(std::make_pair("kismet.fragment_cache.max_bytes",
+                std::make_shared<tracker_element_uint64>(0, max_bytes)));
+    ret->insert(std::make_pair("kismet.fragment_cache.hits",
+                std::make_shared<tracker_element_uint64>(0, hits)));
+    ret->insert(std::make_pair("kismet.fragment_cache.misses",
+                std::make_shared<tracker_element_uint64>(0, misses)));
+
+    return ret;
+}
+
@@ -0,0 +1,114 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_FRAGMENT_CACHE_H__
+#define __KIS_FRAGMENT_CACHE_H__
+
+#include "config.h"
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "kis_mutex.h"
+#include "trackedelement.h"
+
+// Serialized record fragment cache
+//
+// Most devices in a long running session haven't changed since the last time they
+// were written, yet every device list and every kismetdb device record serializes
+// the whole device again.  Elements which report a serialization cache key (devices,
+// keyed by the device key and their modification sequence) have the serialized text
+// of a record kept per serializer and field summary, and spliced into later output
+// until the record changes.
+//
+// Cached text is only reused while the modification sequence matches, the same as
+// device snapshots, and for at most max_age seconds, since some fields (such as
+// RRDs, which are brought up to the current time as they're serialized) change with
+// time alone.  The cache is bounded by the total size of the cached text, and the
+// least recently used records are dropped first.
+class kis_fragment_cache {
+public:
+    kis_fragment_cache();
+
+    // Limits are set from the config once it's loaded; a size of 0 disables caching
+    void set_limits(size_t in_max_bytes, time_t in_max_age);
+
+    bool enabled() const {
+        return max_bytes != 0;
+    }
+
+    // Cached text of a record, or the text written by produce, which is cached under the
+    // sequence given; the sequence must be read before the record is serialized, so that
+    // a change during serialization is never hidden.  Returns nullptr if produce fails.
+    std::shared_ptr<const std::string> fetch(const device_key& in_key, uint64_t in_seq,
+            const tracker_element_serializer *in_serializer, const std::string& in_fields,
+            const std::function<bool (std::ostream&)>& produce);
+
+    std::shared_ptr<tracker_element> get_stats();
+
+protected:
+    struct cache_key {
+        device_key key;
+        const tracker_element_serializer *serializer;
+        std::string fields;
+
+        bool operator==(const cache_key& k) const {
+            return key == k.key && serializer == k.serializer && fields == k.fields;
+        }
+    };
+
+    struct cache_key_hash {
+        size_t operator()(const cache_key& k) const {
+            return std::hash<device_key>{}(k.key) ^
+                (std::hash<const void *>{}(k.serializer) << 1) ^
+                (std::hash<std::string>{}(k.fields) << 2);
+        }
+    };
+
+    struct fragment {
+        cache_key key;
+        uint64_t seq;
+        time_t created;
+        std::shared_ptr<const std::string> text;
+    };
+
+    using lru_list = std::list<fragment>;
+
+    size_t fragment_size(const fragment& f) const {
+        return f.text->length() + f.key.fields.length() + sizeof(fragment);
+    }
+
+    kis_fast_mutex mutex;
+
+    size_t max_bytes;
+    time_t max_age;
+
+    // Most recently used first
+    lru_list lru;
+    std::unordered_map<cache_key, lru_list::iterator, cache_key_hash> index;
+    size_t total_bytes;
+
+    uint64_t hits;
+    uint64_t misses;
+};
+
+#endif
+
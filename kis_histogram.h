@@ -0,0 +1,120 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_HISTOGRAM_H__
+#define __KIS_HISTOGRAM_H__
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+
+// Sampled latency histogram, in nanoseconds.  Buckets are log-linear like an
+// HDR histogram:  each power of two is split into 16 linear sub-buckets, giving ~6%
+// precision from 1ns up to ~68 seconds.  Recording is lock-free so any thread can
+// add samples.
+class kis_latency_histogram {
+public:
+    static const unsigned int sub_bits = 4;
+    static const unsigned int max_bits = 36;
+    static const unsigned int n_buckets = (max_bits - sub_bits + 1) << sub_bits;
+
+    kis_latency_histogram() :
+        count{0},
+        sum{0},
+        min{UINT64_MAX},
+        max{0} {
+        for (unsigned int i = 0; i < n_buckets; i++)
+            buckets[i] = 0;
+    }
+
+    void record(uint64_t ns) {
+        if (ns >= (1ULL << max_bits))
+            ns = (1ULL << max_bits) - 1;
+
+        buckets[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(ns, std::memory_order_relaxed);
+
+        auto m = min.load(std::memory_order_relaxed);
+        while (ns < m && !min.compare_exchange_weak(m, ns, std::memory_order_relaxed))
+            ;
+
+        m = max.load(std::memory_order_relaxed);
+        while (ns > m && !max.compare_exchange_weak(m, ns, std::memory_order_relaxed))
+            ;
+    }
+
+    // Upper bound of the value at percentile pct (0-100)
+    uint64_t percentile(double pct) const {
+        uint64_t total = count.load(std::memory_order_relaxed);
+
+        if (total == 0)
+            return 0;
+
+        uint64_t target = static_cast<uint64_t>((pct / 100.0) * total);
+        if (target == 0)
+            target = 1;
+
+        uint64_t seen = 0;
+
+        for (unsigned int i = 0; i < n_buckets; i++) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+
+            if (seen >= target)
+                return std::min(bucket_upper(i), max.load(std::memory_order_relaxed));
+        }
+
+        return max.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_count() const { return count.load(std::memory_order_relaxed); }
+    uint64_t get_sum() const { return sum.load(std::memory_order_relaxed); }
+    uint64_t get_max() const { return max.load(std::memory_order_relaxed); }
+
+    uint64_t get_min() const {
+        if (count.load(std::memory_order_relaxed) == 0)
+            return 0;
+        return min.load(std::memory_order_relaxed);
+    }
+
+protected:
+    static unsigned int bucket_of(uint64_t ns) {
+        if (ns < (1ULL << sub_bits))
+            return static_cast<unsigned int>(ns);
+
+        unsigned int shift = (63 - __builtin_clzll(ns)) - sub_bits;
+        return ((shift + 1) << sub_bits) + ((ns >> shift) & ((1ULL << sub_bits) - 1));
+    }
+
+    static uint64_t bucket_upper(unsigned int b) {
+        if (b < (1U << sub_bits))
+            return b;
+
+        unsigned int shift = (b >> sub_bits) - 1;
+        uint64_t base = (1ULL << sub_bits) + (b & ((1U << sub_bits) - 1));
+        return ((base + 1) << shift) - 1;
+    }
+
+    std::atomic<uint64_t> buckets[n_buckets];
+    std::atomic<uint64_t> count, sum, min, max;
+};
+
+#endif
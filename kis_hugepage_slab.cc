@@ -0,0 +1,275 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <fstream>
+#include <new>
+
+#include "kis_hugepage_slab.h"
+
+kis_hugepage_slab::kis_hugepage_slab() :
+    mode{slab_mode::off},
+    range_start{nullptr},
+    range_end{nullptr},
+    range_pos{nullptr},
+    in_use_bytes{0},
+    fallbacks{0} {
+
+    range_mutex.set_name("kis_hugepage_slab range");
+
+    for (size_t c = 0; c < n_classes; c++) {
+        classes[c].mutex.set_name("kis_hugepage_slab class");
+        classes[c].free_list = nullptr;
+        classes[c].pos = nullptr;
+        classes[c].remaining = 0;
+    }
+}
+
+kis_hugepage_slab& kis_hugepage_slab::instance() {
+    // Objects in the slab may be released during static destruction, so the slab
+    // itself is never destroyed
+    static kis_hugepage_slab *s = new kis_hugepage_slab();
+    return *s;
+}
+
+std::string kis_hugepage_slab::mode_name(slab_mode in_mode) {
+    switch (in_mode) {
+        case slab_mode::transparent:
+            return "transparent";
+        case slab_mode::explicit_pages:
+            return "explicit";
+        default:
+            return "off";
+    }
+}
+
+size_t kis_hugepage_slab::class_size(size_t in_class) {
+    // 16 byte steps to 128 bytes, then four steps per doubling to 8192 bytes
+    if (in_class < 8)
+        return (in_class + 1) * 16;
+
+    auto base = static_cast<size_t>(128) << ((in_class - 8) / 4);
+    return base + ((in_class - 8) % 4 + 1) * (base / 4);
+}
+
+size_t kis_hugepage_slab::size_class(size_t in_sz) {
+    if (in_sz == 0)
+        in_sz = 1;
+
+    if (in_sz <= 128)
+        return (in_sz + 15) / 16 - 1;
+
+    for (size_t c = 8; c < n_classes; c++) {
+        if (class_size(c) >= in_sz)
+            return c;
+    }
+
+    return n_classes;
+}
+
+kis_hugepage_slab::slab_mode kis_hugepage_slab::configure(slab_mode in_mode, size_t in_size) {
+    auto& s = instance();
+
+    if (in_mode == slab_mode::off || s.range_start.load() != nullptr)
+        return s.mode;
+
+    // Whole huge pages
+    auto sz = ((in_size + slab_sz - 1) / slab_sz) * slab_sz;
+
+    if (sz == 0)
+        return s.mode;
+
+    uint8_t *start = nullptr;
+
+#ifdef MAP_HUGETLB
+    if (in_mode == slab_mode::explicit_pages) {
+        auto m = mmap(nullptr, sz, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (m != MAP_FAILED)
+            start = static_cast<uint8_t *>(m);
+        else
+            in_mode = slab_mode::transparent;
+    }
+#else
+    in_mode = slab_mode::transparent;
+#endif
+
+    if (start == nullptr) {
+        // Map an extra huge page so the range can be aligned to one; untouched pages
+        // are never committed, so the range only costs address space until used
+        auto m = mmap(nullptr, sz + slab_sz, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        if (m == MAP_FAILED)
+            return s.mode;
+
+        auto base = static_cast<uint8_t *>(m);
+        auto pad = (slab_sz - (reinterpret_cast<uintptr_t>(base) % slab_sz)) % slab_sz;
+
+        if (pad != 0)
+            munmap(base, pad);
+        if (slab_sz - pad != 0)
+            munmap(base + pad + sz, slab_sz - pad);
+
+        start = base + pad;
+
+#ifdef MADV_HUGEPAGE
+        madvise(start, sz, MADV_HUGEPAGE);
+#endif
+    }
+
+    kis_lock_guard<kis_mutex> lk(s.range_mutex, "kis_hugepage_slab configure");
+
+    // Until the end is set nothing is inside the range, so a concurrent release of a
+    // heap block still goes to the heap
+    s.mode = in_mode;
+    s.range_pos = start;
+    s.range_start = start;
+    s.range_end = start + sz;
+
+    return s.mode;
+}
+
+void *kis_hugepage_slab::allocate(size_t in_sz) {
+    auto& s = instance();
+    auto c = size_class(in_sz);
+
+    if (s.range_start.load(std::memory_order_relaxed) == nullptr || c >= n_classes)
+        return ::operator new(in_sz);
+
+    auto& sc = s.classes[c];
+    auto csz = class_size(c);
+
+    {
+        kis_lock_guard<kis_mutex> lk(sc.mutex, "kis_hugepage_slab allocate");
+
+        if (sc.free_list != nullptr) {
+            auto b = sc.free_list;
+            sc.free_list = b->next;
+            s.in_use_bytes += csz;
+            return b;
+        }
+
+        if (sc.remaining < csz) {
+            // Carve a new slab for this class from the range
+            kis_lock_guard<kis_mutex> rlk(s.range_mutex, "kis_hugepage_slab allocate");
+
+            if (s.range_pos + slab_sz > s.range_end.load()) {
+                s.fallbacks++;
+                return ::operator new(in_sz);
+            }
+
+            sc.pos = s.range_pos;
+            sc.remaining = slab_sz;
+            s.range_pos += slab_sz;
+        }
+
+        auto r = sc.pos;
+        sc.pos += csz;
+        sc.remaining -= csz;
+        s.in_use_bytes += csz;
+
+        return r;
+    }
+}
+
+void kis_hugepage_slab::release(void *in_ptr, size_t in_sz) {
+    if (in_ptr == nullptr)
+        return;
+
+    auto& s = instance();
+    auto p = static_cast<uint8_t *>(in_ptr);
+
+    if (p < s.range_start.load(std::memory_order_relaxed) ||
+            p >= s.range_end.load(std::memory_order_relaxed)) {
+        ::operator delete(in_ptr);
+        return;
+    }
+
+    auto c = size_class(in_sz);
+    auto& sc = s.classes[c];
+
+    kis_lock_guard<kis_mutex> lk(sc.mutex, "kis_hugepage_slab release");
+
+    auto b = static_cast<free_block *>(in_ptr);
+    b->next = sc.free_list;
+    sc.free_list = b;
+
+    s.in_use_bytes -= class_size(c);
+}
+
+kis_hugepage_slab::slab_stats kis_hugepage_slab::get_stats() {
+    auto& s = instance();
+
+    slab_stats r;
+
+    r.mode = s.mode;
+    r.reserved_bytes = s.range_end.load() - s.range_start.load();
+    r.in_use_bytes = s.in_use_bytes.load();
+    r.fallbacks = s.fallbacks.load();
+
+    {
+        kis_lock_guard<kis_mutex> lk(s.range_mutex, "kis_hugepage_slab get_stats");
+        r.slab_bytes = s.range_pos - s.range_start.load();
+    }
+
+    return r;
+}
+
+uint64_t kis_hugepage_slab::get_hugepage_bytes() {
+    auto& s = instance();
+    uint64_t r = 0;
+
+    if (s.range_start.load() == nullptr)
+        return r;
+
+    // Sum the huge pages of every mapping inside the range
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool in_range = false;
+
+    while (std::getline(smaps, line)) {
+        unsigned long long start, end;
+        unsigned long long kb;
+        char field[64];
+
+        if (sscanf(line.c_str(), "%llx-%llx ", &start, &end) == 2) {
+            in_range = start >= reinterpret_cast<uintptr_t>(s.range_start.load()) &&
+                start < reinterpret_cast<uintptr_t>(s.range_end.load());
+            continue;
+        }
+
+        if (!in_range)
+            continue;
+
+        if (sscanf(line.c_str(), "%63[^:]: %llu kB", field, &kb) != 2)
+            continue;
+
+        if (strcmp(field, "AnonHugePages") == 0 || strcmp(field, "Private_Hugetlb") == 0 ||
+                strcmp(field, "Shared_Hugetlb") == 0)
+            r += kb * 1024;
+    }
+
+    return r;
+}
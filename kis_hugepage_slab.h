@@ -0,0 +1,112 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_HUGEPAGE_SLAB_H__
+#define __KIS_HUGEPAGE_SLAB_H__
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+#include "kis_mutex.h"
+
+// Huge page backed slab allocator
+//
+// The object pools behind packets and packet components, the packet data buffers, and
+// the arenas holding device records all allocate through the slab.  When enabled, one
+// large range of memory is mapped at startup and backed by huge pages, either
+// transparent huge pages (madvise) or explicit hugetlbfs pages reserved by the
+// administrator.  Allocations are rounded to a size class, and every size class is
+// carved out of its own huge page sized slabs, so objects of one type are packed into
+// as few TLB entries as possible.
+//
+// Freed blocks are kept on the free list of their size class and never returned to
+// the system, matching the object pools above them.  Allocations which are too large
+// for a size class, made once the range is exhausted, or made while the slab is off,
+// fall back to the heap; release() accepts either.
+class kis_hugepage_slab {
+public:
+    enum class slab_mode {
+        off, transparent, explicit_pages
+    };
+
+    // Map the slab range; must be called before any other threads are started.  The
+    // mode actually used is returned, falling back from explicit to transparent pages
+    // when no huge pages are reserved.
+    static slab_mode configure(slab_mode in_mode, size_t in_size);
+
+    static void *allocate(size_t in_sz);
+    static void release(void *in_ptr, size_t in_sz);
+
+    static std::string mode_name(slab_mode in_mode);
+
+    struct slab_stats {
+        slab_mode mode;
+        // Size of the range, bytes carved into slabs, and bytes of those in use
+        uint64_t reserved_bytes;
+        uint64_t slab_bytes;
+        uint64_t in_use_bytes;
+        // Allocations which fell back to the heap because the range was exhausted
+        uint64_t fallbacks;
+    };
+
+    static slab_stats get_stats();
+
+    // Bytes of the range the kernel has backed with huge pages, from smaps
+    static uint64_t get_hugepage_bytes();
+
+protected:
+    kis_hugepage_slab();
+
+    static kis_hugepage_slab& instance();
+
+    static const size_t slab_sz = 2 * 1024 * 1024;
+    static const size_t n_classes = 32;
+
+    // Smallest size class holding a size, or n_classes if there is none
+    static size_t size_class(size_t in_sz);
+    static size_t class_size(size_t in_class);
+
+    struct free_block {
+        free_block *next;
+    };
+
+    struct size_class_rec {
+        kis_mutex mutex;
+        free_block *free_list;
+        uint8_t *pos;
+        size_t remaining;
+    };
+
+    size_class_rec classes[n_classes];
+
+    kis_mutex range_mutex;
+
+    slab_mode mode;
+    std::atomic<uint8_t *> range_start, range_end;
+    uint8_t *range_pos;
+
+    std::atomic<uint64_t> in_use_bytes;
+    std::atomic<uint64_t> fallbacks;
+};
+
+#endif
+
@@ -0,0 +1,90 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include "configfile.h"
+#include "kis_ingest_pool.h"
+#include "kis_thread_placement.h"
+#include "messagebus.h"
+#include "util.h"
+
+kis_ingest_pool::kis_ingest_pool() :
+    next_group{0} {
+
+    auto n_groups =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("datasource_ingest_threads", 0);
+
+    for (unsigned int g = 0; g < n_groups; g++) {
+        auto group = new ingest_group();
+
+        group->work.reset(new boost::asio::executor_work_guard<boost::asio::io_context::executor_type>(
+                    boost::asio::make_work_guard(group->io)));
+
+        group->thread = std::thread([group, g]() {
+                auto name = fmt::format("INGEST {}", g);
+                thread_set_process_name(name);
+                kis_thread_placement::place_current_thread(name,
+                        kis_thread_placement::thread_role::io, g);
+                group->io.run();
+            });
+
+        groups.push_back(group);
+    }
+
+    if (n_groups > 0)
+        _MSG_INFO("Running datasource connections on {} dedicated ingest threads", n_groups);
+}
+
+kis_ingest_pool::~kis_ingest_pool() {
+    Globalreg::globalreg->remove_global(global_name());
+
+    for (auto g : groups) {
+        g->work.reset();
+        g->io.stop();
+    }
+
+    for (auto g : groups) {
+        if (g->thread.joinable())
+            g->thread.join();
+    }
+}
+
+boost::asio::io_context& kis_ingest_pool::assign_context() {
+    auto pool = Globalreg::fetch_global_as<kis_ingest_pool>();
+
+    if (pool == nullptr || pool->groups.size() == 0)
+        return Globalreg::globalreg->io;
+
+    return pool->groups[pool->next_group++ % pool->groups.size()]->io;
+}
+
+int kis_ingest_pool::context_group(const boost::asio::io_context& in_io) {
+    auto pool = Globalreg::fetch_global_as<kis_ingest_pool>();
+
+    if (pool == nullptr)
+        return -1;
+
+    for (size_t g = 0; g < pool->groups.size(); g++) {
+        if (&pool->groups[g]->io == &in_io)
+            return static_cast<int>(g);
+    }
+
+    return -1;
+}
+
@@ -0,0 +1,88 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_INGEST_POOL_H__
+#define __KIS_INGEST_POOL_H__
+
+#include "config.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "globalregistry.h"
+
+// Datasource ingest threads
+//
+// Datasource IPC and TCP connections normally run on the shared IO context with the
+// webserver and GPS connections, so a burst of packets from one busy source can hold
+// IO threads long enough to delay everything else.  With datasource_ingest_threads
+// set, datasources are instead spread over that many dedicated IO contexts, each run
+// by its own thread; the sources assigned to one context form an ingest group which
+// only competes with itself.  Packets are handed from the ingest threads to the
+// packet chain, which bounds them with packet_backlog_limit as before.
+//
+// With no ingest threads configured every source uses the shared IO context.
+class kis_ingest_pool : public lifetime_global {
+public:
+    static std::string global_name() { return "KIS_INGEST_POOL"; }
+
+    static std::shared_ptr<kis_ingest_pool> create_ingest_pool() {
+        std::shared_ptr<kis_ingest_pool> mon(new kis_ingest_pool());
+        Globalreg::globalreg->register_lifetime_global(mon);
+        Globalreg::globalreg->insert_global(global_name(), mon);
+        return mon;
+    }
+
+private:
+    kis_ingest_pool();
+
+public:
+    virtual ~kis_ingest_pool();
+
+    // IO context for a new datasource; groups are filled round-robin.  The shared IO
+    // context when there are no ingest threads, or when the pool hasn't been created,
+    // such as in tools.
+    static boost::asio::io_context& assign_context();
+
+    // Ingest group running an IO context, or -1 for the shared IO context
+    static int context_group(const boost::asio::io_context& in_io);
+
+    size_t get_num_groups() const {
+        return groups.size();
+    }
+
+protected:
+    struct ingest_group {
+        boost::asio::io_context io{1};
+        std::unique_ptr<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> work;
+        std::thread thread;
+    };
+
+    // Groups are never freed; sockets of datasources destroyed during shutdown may
+    // still refer to their context
+    std::vector<ingest_group *> groups;
+
+    std::atomic<unsigned int> next_group;
+};
+
+#endif
+
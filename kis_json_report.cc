@@ -0,0 +1,469 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <stdexcept>
+
+#include "kis_json_report.h"
+
+// Deepest nesting of objects and arrays inside a report
+#define KIS_JSON_REPORT_MAX_DEPTH   64
+
+namespace {
+
+struct json_scanner {
+    const char *p;
+    const char *end;
+
+    void skip_ws() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            p++;
+    }
+
+    [[noreturn]] void fail(const char *in_msg) const {
+        throw std::runtime_error(in_msg);
+    }
+
+    void expect(char c) {
+        skip_ws();
+
+        if (p >= end || *p != c)
+            fail("malformed JSON report");
+
+        p++;
+    }
+
+    // Scan a string starting at the opening quote; returns the contents without
+    // the quotes
+    std::string_view scan_string(bool& escaped) {
+        if (p >= end || *p != '"')
+            fail("expected JSON string");
+
+        const char *start = ++p;
+        escaped = false;
+
+        while (p < end) {
+            if (*p == '"')
+                return std::string_view(start, (p++) - start);
+
+            if (*p == '\\') {
+                escaped = true;
+
+                if (++p >= end)
+                    break;
+            } else if ((unsigned char) *p < 0x20) {
+                fail("control character in JSON string");
+            }
+
+            p++;
+        }
+
+        fail("unterminated JSON string");
+    }
+
+    std::string_view scan_number() {
+        const char *start = p;
+
+        if (p < end && *p == '-')
+            p++;
+
+        if (p >= end || *p < '0' || *p > '9')
+            fail("malformed JSON number");
+
+        while (p < end && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' ||
+                    *p == 'E' || *p == '+' || *p == '-'))
+            p++;
+
+        return std::string_view(start, p - start);
+    }
+
+    void scan_literal(const char *in_lit) {
+        auto l = strlen(in_lit);
+
+        if ((size_t) (end - p) < l || memcmp(p, in_lit, l) != 0)
+            fail("malformed JSON literal");
+
+        p += l;
+    }
+
+    // Skip a nested object or array starting at the opening bracket, checking only
+    // that brackets balance outside of strings
+    std::string_view skip_nested() {
+        const char *start = p;
+        char stack[KIS_JSON_REPORT_MAX_DEPTH];
+        int depth = 0;
+        bool escaped;
+
+        while (p < end) {
+            char c = *p;
+
+            if (c == '"') {
+                scan_string(escaped);
+                continue;
+            }
+
+            if (c == '{' || c == '[') {
+                if (depth >= KIS_JSON_REPORT_MAX_DEPTH)
+                    fail("JSON report nested too deeply");
+
+                stack[depth++] = c == '{' ? '}' : ']';
+            } else if (c == '}' || c == ']') {
+                if (depth == 0 || stack[depth - 1] != c)
+                    fail("mismatched brackets in JSON report");
+
+                if (--depth == 0) {
+                    p++;
+                    return std::string_view(start, p - start);
+                }
+            }
+
+            p++;
+        }
+
+        fail("unterminated JSON object");
+    }
+};
+
+void append_utf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += (char) cp;
+    } else if (cp < 0x800) {
+        out += (char) (0xC0 | (cp >> 6));
+        out += (char) (0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += (char) (0xE0 | (cp >> 12));
+        out += (char) (0x80 | ((cp >> 6) & 0x3F));
+        out += (char) (0x80 | (cp & 0x3F));
+    } else {
+        out += (char) (0xF0 | (cp >> 18));
+        out += (char) (0x80 | ((cp >> 12) & 0x3F));
+        out += (char) (0x80 | ((cp >> 6) & 0x3F));
+        out += (char) (0x80 | (cp & 0x3F));
+    }
+}
+
+uint32_t parse_hex4(std::string_view in_str, size_t pos) {
+    if (pos + 4 > in_str.length())
+        throw std::runtime_error("truncated JSON unicode escape");
+
+    uint32_t r = 0;
+
+    for (size_t i = pos; i < pos + 4; i++) {
+        char c = in_str[i];
+        r <<= 4;
+
+        if (c >= '0' && c <= '9')
+            r |= c - '0';
+        else if (c >= 'a' && c <= 'f')
+            r |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            r |= c - 'A' + 10;
+        else
+            throw std::runtime_error("invalid JSON unicode escape");
+    }
+
+    return r;
+}
+
+std::string unescape(std::string_view in_str) {
+    std::string r;
+    r.reserve(in_str.length());
+
+    for (size_t i = 0; i < in_str.length(); i++) {
+        if (in_str[i] != '\\') {
+            r += in_str[i];
+            continue;
+        }
+
+        if (++i >= in_str.length())
+            break;
+
+        switch (in_str[i]) {
+            case 'b':
+                r += '\b';
+                break;
+            case 'f':
+                r += '\f';
+                break;
+            case 'n':
+                r += '\n';
+                break;
+            case 'r':
+                r += '\r';
+                break;
+            case 't':
+                r += '\t';
+                break;
+            case 'u': {
+                auto cp = parse_hex4(in_str, i + 1);
+                i += 4;
+
+                // Surrogate pair
+                if (cp >= 0xD800 && cp <= 0xDBFF && i + 6 < in_str.length() &&
+                        in_str[i + 1] == '\\' && in_str[i + 2] == 'u') {
+                    auto lo = parse_hex4(in_str, i + 3);
+
+                    if (lo >= 0xDC00 && lo <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        i += 6;
+                    }
+                }
+
+                append_utf8(r, cp);
+                break;
+            }
+            default:
+                r += in_str[i];
+                break;
+        }
+    }
+
+    return r;
+}
+
+}
+
+void kis_json_report::parse(std::string_view in_json) {
+    m_fields.clear();
+
+    json_scanner s{in_json.data(), in_json.data() + in_json.length()};
+
+    s.expect('{');
+    s.skip_ws();
+
+    if (s.p < s.end && *s.p == '}') {
+        s.p++;
+    } else {
+        while (true) {
+            field f;
+            bool key_escaped;
+
+            s.skip_ws();
+            f.key = s.scan_string(key_escaped);
+            s.expect(':');
+            s.skip_ws();
+
+            if (s.p >= s.end)
+                s.fail("truncated JSON report");
+
+            switch (*s.p) {
+                case '"':
+                    f.val.m_type = value_type::string_value;
+                    f.val.m_raw = s.scan_string(f.val.m_escaped);
+                    break;
+                case '{':
+                    f.val.m_type = value_type::object_value;
+                    f.val.m_raw = s.skip_nested();
+                    break;
+                case '[':
+                    f.val.m_type = value_type::array_value;
+                    f.val.m_raw = s.skip_nested();
+                    break;
+                case 't':
+                    s.scan_literal("true");
+                    f.val.m_type = value_type::bool_value;
+                    f.val.m_raw = "true";
+                    break;
+                case 'f':
+                    s.scan_literal("false");
+                    f.val.m_type = value_type::bool_value;
+                    f.val.m_raw = "false";
+                    break;
+                case 'n':
+                    s.scan_literal("null");
+                    break;
+                default:
+                    f.val.m_type = value_type::number_value;
+                    f.val.m_raw = s.scan_number();
+                    break;
+            }
+
+            m_fields.push_back(f);
+
+            s.skip_ws();
+
+            if (s.p < s.end && *s.p == ',') {
+                s.p++;
+                continue;
+            }
+
+            s.expect('}');
+            break;
+        }
+    }
+
+    s.skip_ws();
+
+    if (s.p != s.end)
+        s.fail("trailing data after JSON report");
+}
+
+const kis_json_report::value *kis_json_report::find(std::string_view in_key) const {
+    // Like jsoncpp, the last of any duplicate keys wins
+    for (auto i = m_fields.rbegin(); i != m_fields.rend(); ++i) {
+        if (i->key == in_key)
+            return &i->val;
+    }
+
+    return nullptr;
+}
+
+bool kis_json_report::value::is_integral() const {
+    return m_raw.find_first_of(".eE") == std::string_view::npos;
+}
+
+std::string kis_json_report::value::asString() const {
+    switch (m_type) {
+        case value_type::null_value:
+            return "";
+        case value_type::string_value:
+            if (m_escaped)
+                return unescape(m_raw);
+            return std::string(m_raw);
+        case value_type::bool_value:
+        case value_type::number_value:
+            return std::string(m_raw);
+        default:
+            throw std::runtime_error("JSON value is not convertible to string");
+    }
+}
+
+bool kis_json_report::value::asBool() const {
+    switch (m_type) {
+        case value_type::null_value:
+            return false;
+        case value_type::bool_value:
+            return m_raw[0] == 't';
+        case value_type::number_value:
+            return asDouble() != 0;
+        default:
+            throw std::runtime_error("JSON value is not convertible to bool");
+    }
+}
+
+double kis_json_report::value::asDouble() const {
+    switch (m_type) {
+        case value_type::null_value:
+            return 0;
+        case value_type::bool_value:
+            return asBool() ? 1 : 0;
+        case value_type::number_value: {
+            // strtod needs a terminated string; JSON numbers are short
+            char buf[64];
+
+            if (m_raw.length() >= sizeof(buf))
+                throw std::runtime_error("JSON number too long");
+
+            memcpy(buf, m_raw.data(), m_raw.length());
+            buf[m_raw.length()] = 0;
+
+            return strtod(buf, nullptr);
+        }
+        default:
+            throw std::runtime_error("JSON value is not convertible to double");
+    }
+}
+
+int64_t kis_json_report::value::asInt64() const {
+    if (m_type == value_type::number_value && is_integral()) {
+        int64_t r = 0;
+        bool neg = false;
+        size_t i = 0;
+
+        if (m_raw[0] == '-') {
+            neg = true;
+            i++;
+        }
+
+        for (; i < m_raw.length(); i++) {
+            int d = m_raw[i] - '0';
+
+            if (d < 0 || d > 9)
+                throw std::runtime_error("malformed JSON integer");
+
+            if (r > (INT64_MAX - d) / 10)
+                throw std::runtime_error("JSON integer out of Int64 range");
+
+            r = r * 10 + d;
+        }
+
+        return neg ? -r : r;
+    }
+
+    auto d = asDouble();
+
+    if (d < (double) INT64_MIN || d >= (double) INT64_MAX)
+        throw std::runtime_error("JSON number out of Int64 range");
+
+    return (int64_t) d;
+}
+
+uint64_t kis_json_report::value::asUInt64() const {
+    if (m_type == value_type::number_value && is_integral()) {
+        if (m_raw[0] == '-')
+            throw std::runtime_error("negative JSON integer is out of UInt64 range");
+
+        uint64_t r = 0;
+
+        for (size_t i = 0; i < m_raw.length(); i++) {
+            int d = m_raw[i] - '0';
+
+            if (d < 0 || d > 9)
+                throw std::runtime_error("malformed JSON integer");
+
+            if (r > (UINT64_MAX - d) / 10)
+                throw std::runtime_error("JSON integer out of UInt64 range");
+
+            r = r * 10 + d;
+        }
+
+        return r;
+    }
+
+    auto d = asDouble();
+
+    if (d < 0 || d >= (double) UINT64_MAX)
+        throw std::runtime_error("JSON number out of UInt64 range");
+
+    return (uint64_t) d;
+}
+
+int kis_json_report::value::asInt() const {
+    auto r = asInt64();
+
+    if (r < INT_MIN || r > INT_MAX)
+        throw std::runtime_error("JSON number out of Int range");
+
+    return (int) r;
+}
+
+unsigned int kis_json_report::value::asUInt() const {
+    auto r = asUInt64();
+
+    if (r > UINT_MAX)
+        throw std::runtime_error("JSON number out of UInt range");
+
+    return (unsigned int) r;
+}
+
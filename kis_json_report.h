@@ -0,0 +1,147 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_JSON_REPORT_H__
+#define __KIS_JSON_REPORT_H__
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Decoder for the flat JSON reports sent by the SDR datasources (rtl433, rtladsb,
+// rtlamr).
+//
+// The report is scanned once into an index of the top-level fields, each a view of
+// the original JSON text; no value tree is built, strings are only unescaped and
+// numbers only converted when they are read.  Nested objects and arrays are
+// validated and skipped, and can be fetched as raw JSON text.
+//
+// Values mirror the Json::Value accessors the phys use (isNull, isNumeric,
+// asString, asInt, ...), including throwing when a value can't be converted.
+//
+// A report refers to the JSON it was parsed from, which must outlive it.
+class kis_json_report {
+public:
+    enum class value_type {
+        null_value, bool_value, number_value, string_value, object_value, array_value
+    };
+
+    class value {
+    public:
+        value() :
+            m_type{value_type::null_value},
+            m_escaped{false} { }
+
+        value_type type() const {
+            return m_type;
+        }
+
+        bool isNull() const {
+            return m_type == value_type::null_value;
+        }
+
+        bool isBool() const {
+            return m_type == value_type::bool_value;
+        }
+
+        bool isNumeric() const {
+            return m_type == value_type::number_value;
+        }
+
+        bool isDouble() const {
+            return isNumeric();
+        }
+
+        bool isString() const {
+            return m_type == value_type::string_value;
+        }
+
+        bool isObject() const {
+            return m_type == value_type::object_value;
+        }
+
+        bool isArray() const {
+            return m_type == value_type::array_value;
+        }
+
+        // Raw JSON text of the value; strings do not include the quotes
+        std::string_view raw() const {
+            return m_raw;
+        }
+
+        std::string asString() const;
+        bool asBool() const;
+        int asInt() const;
+        unsigned int asUInt() const;
+        int64_t asInt64() const;
+        uint64_t asUInt64() const;
+        double asDouble() const;
+
+    protected:
+        friend class kis_json_report;
+
+        value_type m_type;
+        std::string_view m_raw;
+        bool m_escaped;
+
+        bool is_integral() const;
+    };
+
+    kis_json_report() {
+        m_fields.reserve(32);
+    }
+
+    // Index a JSON object; throws std::runtime_error if the JSON is malformed or is
+    // not an object
+    void parse(std::string_view in_json);
+
+    bool isMember(std::string_view in_key) const {
+        return find(in_key) != nullptr;
+    }
+
+    // Value of a field, or a null value if the report doesn't have it
+    value operator[](std::string_view in_key) const {
+        auto f = find(in_key);
+
+        if (f == nullptr)
+            return value();
+
+        return *f;
+    }
+
+    size_t size() const {
+        return m_fields.size();
+    }
+
+protected:
+    struct field {
+        std::string_view key;
+        value val;
+    };
+
+    std::vector<field> m_fields;
+
+    const value *find(std::string_view in_key) const;
+};
+
+#endif
+
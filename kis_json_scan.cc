@@ -0,0 +1,376 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <stdexcept>
+
+#include "kis_json_scan.h"
+
+// Deepest nesting of arrays and objects accepted
+#define JSON_SCAN_MAX_DEPTH     128
+
+namespace {
+
+[[noreturn]] void malformed(size_t pos) {
+    throw std::runtime_error("malformed JSON at offset " + std::to_string(pos));
+}
+
+size_t skip_ws(nonstd::string_view in, size_t pos) {
+    while (pos < in.length() &&
+            (in[pos] == ' ' || in[pos] == '\t' || in[pos] == '\n' || in[pos] == '\r'))
+        pos++;
+
+    return pos;
+}
+
+// Position after the string starting at pos
+size_t skip_string(nonstd::string_view in, size_t pos) {
+    if (pos >= in.length() || in[pos] != '"')
+        malformed(pos);
+
+    for (pos = pos + 1; pos < in.length(); pos++) {
+        auto c = static_cast<unsigned char>(in[pos]);
+
+        if (c == '"')
+            return pos + 1;
+
+        if (c < 0x20)
+            malformed(pos);
+
+        if (c == '\\')
+            pos++;
+    }
+
+    malformed(pos);
+}
+
+// Position after the value starting at pos.  Containers are skipped by matching their
+// brackets rather than decoding their contents.
+size_t skip_value(nonstd::string_view in, size_t pos) {
+    if (pos >= in.length())
+        malformed(pos);
+
+    auto c = in[pos];
+
+    if (c == '"')
+        return skip_string(in, pos);
+
+    if (c == '{' || c == '[') {
+        char stack[JSON_SCAN_MAX_DEPTH];
+        size_t depth = 0;
+
+        while (pos < in.length()) {
+            c = in[pos];
+
+            if (c == '"') {
+                pos = skip_string(in, pos);
+                continue;
+            }
+
+            if (c == '{' || c == '[') {
+                if (depth == JSON_SCAN_MAX_DEPTH)
+                    throw std::runtime_error("JSON nested too deeply");
+
+                stack[depth++] = (c == '{') ? '}' : ']';
+            } else if (c == '}' || c == ']') {
+                if (depth == 0 || stack[depth - 1] != c)
+                    malformed(pos);
+
+                if (--depth == 0)
+                    return pos + 1;
+            }
+
+            pos++;
+        }
+
+        malformed(pos);
+    }
+
+    // Numbers and literals run to the next delimiter
+    auto start = pos;
+
+    while (pos < in.length() && in[pos] != ',' && in[pos] != '}' && in[pos] != ']' &&
+            in[pos] != ' ' && in[pos] != '\t' && in[pos] != '\n' && in[pos] != '\r')
+        pos++;
+
+    auto lit = in.substr(start, pos - start);
+
+    if (lit.length() == 0 || !(lit == "true" || lit == "false" || lit == "null" ||
+                lit[0] == '-' || (lit[0] >= '0' && lit[0] <= '9')))
+        malformed(start);
+
+    return pos;
+}
+
+void append_utf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+uint32_t parse_hex4(nonstd::string_view in, size_t pos) {
+    if (pos + 4 > in.length())
+        malformed(pos);
+
+    uint32_t v = 0;
+
+    for (size_t i = pos; i < pos + 4; i++) {
+        auto c = in[i];
+        v <<= 4;
+
+        if (c >= '0' && c <= '9')
+            v |= c - '0';
+        else if (c >= 'a' && c <= 'f')
+            v |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            v |= c - 'A' + 10;
+        else
+            malformed(i);
+    }
+
+    return v;
+}
+
+// Decode the string starting at pos into out; returns the position after it.  Runs
+// without escapes are copied in one piece.
+size_t decode_string(nonstd::string_view in, size_t pos, std::string& out) {
+    if (pos >= in.length() || in[pos] != '"')
+        malformed(pos);
+
+    out.clear();
+    pos++;
+
+    while (pos < in.length()) {
+        auto run = pos;
+
+        while (pos < in.length() && in[pos] != '"' && in[pos] != '\\' &&
+                static_cast<unsigned char>(in[pos]) >= 0x20)
+            pos++;
+
+        out.append(in.data() + run, pos - run);
+
+        if (pos >= in.length())
+            break;
+
+        if (in[pos] == '"')
+            return pos + 1;
+
+        if (in[pos] != '\\')
+            malformed(pos);
+
+        if (++pos >= in.length())
+            break;
+
+        switch (in[pos]) {
+            case '"':
+            case '\\':
+            case '/':
+                out += in[pos];
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'u': {
+                auto cp = parse_hex4(in, pos + 1);
+                pos += 4;
+
+                // Surrogate pairs combine into one code point
+                if (cp >= 0xD800 && cp <= 0xDBFF && pos + 6 < in.length() &&
+                        in[pos + 1] == '\\' && in[pos + 2] == 'u') {
+                    auto lo = parse_hex4(in, pos + 3);
+
+                    if (lo >= 0xDC00 && lo <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        pos += 6;
+                    }
+                }
+
+                append_utf8(out, cp);
+                break;
+            }
+            default:
+                malformed(pos);
+        }
+
+        pos++;
+    }
+
+    malformed(pos);
+}
+
+// Walk the members of the object starting at pos; the callback returns false to stop
+void walk_object(nonstd::string_view in, size_t pos, std::string& key,
+        const std::function<bool (const std::string&, nonstd::string_view)>& in_fn) {
+    pos = skip_ws(in, pos);
+
+    if (pos >= in.length() || in[pos] != '{')
+        throw std::runtime_error("expected a JSON object");
+
+    pos = skip_ws(in, pos + 1);
+
+    if (pos < in.length() && in[pos] == '}')
+        return;
+
+    while (true) {
+        pos = decode_string(in, pos, key);
+        pos = skip_ws(in, pos);
+
+        if (pos >= in.length() || in[pos] != ':')
+            malformed(pos);
+
+        pos = skip_ws(in, pos + 1);
+
+        auto end = skip_value(in, pos);
+
+        if (!in_fn(key, in.substr(pos, end - pos)))
+            return;
+
+        pos = skip_ws(in, end);
+
+        if (pos < in.length() && in[pos] == ',') {
+            pos = skip_ws(in, pos + 1);
+            continue;
+        }
+
+        if (pos < in.length() && in[pos] == '}')
+            return;
+
+        malformed(pos);
+    }
+}
+
+}
+
+namespace json_scan {
+
+bool find_member(nonstd::string_view in_json, const std::string& in_key,
+        nonstd::string_view& out_value) {
+    auto pos = skip_ws(in_json, 0);
+
+    if (pos >= in_json.length() || in_json[pos] != '{')
+        return false;
+
+    std::string key;
+    bool found = false;
+
+    walk_object(in_json, pos, key,
+            [&](const std::string& k, nonstd::string_view v) -> bool {
+                if (k != in_key)
+                    return true;
+
+                out_value = v;
+                found = true;
+                return false;
+            });
+
+    return found;
+}
+
+void for_each_element(nonstd::string_view in_array,
+        const std::function<void (nonstd::string_view)>& in_fn) {
+    auto pos = skip_ws(in_array, 0);
+
+    if (pos >= in_array.length() || in_array[pos] != '[')
+        throw std::runtime_error("expected a JSON array");
+
+    pos = skip_ws(in_array, pos + 1);
+
+    if (pos < in_array.length() && in_array[pos] == ']')
+        return;
+
+    while (true) {
+        auto end = skip_value(in_array, pos);
+
+        in_fn(in_array.substr(pos, end - pos));
+
+        pos = skip_ws(in_array, end);
+
+        if (pos < in_array.length() && in_array[pos] == ',') {
+            pos = skip_ws(in_array, pos + 1);
+            continue;
+        }
+
+        if (pos < in_array.length() && in_array[pos] == ']')
+            return;
+
+        malformed(pos);
+    }
+}
+
+void for_each_member(nonstd::string_view in_object,
+        const std::function<void (const std::string&, nonstd::string_view)>& in_fn) {
+    std::string key;
+
+    walk_object(in_object, 0, key,
+            [&](const std::string& k, nonstd::string_view v) -> bool {
+                in_fn(k, v);
+                return true;
+            });
+}
+
+bool is_null(nonstd::string_view in_value) {
+    return in_value == "null";
+}
+
+void as_string(nonstd::string_view in_value, std::string& out_str) {
+    if (in_value.length() == 0 || in_value[0] != '"')
+        throw std::runtime_error("expected a JSON string");
+
+    decode_string(in_value, 0, out_str);
+}
+
+bool as_bool(nonstd::string_view in_value) {
+    if (in_value == "true")
+        return true;
+
+    if (in_value == "false" || in_value == "null")
+        return false;
+
+    if (in_value.length() > 0 && (in_value[0] == '-' || (in_value[0] >= '0' && in_value[0] <= '9')))
+        return std::stod(std::string(in_value.data(), in_value.length())) != 0;
+
+    throw std::runtime_error("expected a JSON boolean");
+}
+
+}
+
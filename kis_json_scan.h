@@ -0,0 +1,65 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_JSON_SCAN_H__
+#define __KIS_JSON_SCAN_H__
+
+#include "config.h"
+
+#include <functional>
+#include <string>
+
+#include "string_view.hpp"
+
+// In-place JSON access
+//
+// Request bodies can be large lists of keys or filters; building a jsoncpp document of
+// them costs a node and usually a string allocation per element.  These functions walk
+// the JSON text directly instead: values are returned as views of the text and only
+// decoded when asked for, and strings are decoded into a buffer the caller reuses.
+//
+// Malformed JSON throws std::runtime_error when it is reached.
+namespace json_scan {
+
+// Find a member of a top-level object; returns false if the text is not an object or has
+// no such member
+bool find_member(nonstd::string_view in_json, const std::string& in_key,
+        nonstd::string_view& out_value);
+
+// Call a function with each element of an array; throws if the value is not an array
+void for_each_element(nonstd::string_view in_array,
+        const std::function<void (nonstd::string_view)>& in_fn);
+
+// Call a function with the key and value of each member of an object; throws if the value
+// is not an object.  The key string is reused between members.
+void for_each_member(nonstd::string_view in_object,
+        const std::function<void (const std::string&, nonstd::string_view)>& in_fn);
+
+bool is_null(nonstd::string_view in_value);
+
+// Decode a string value into out_str, replacing its contents; throws if the value is not
+// a string
+void as_string(nonstd::string_view in_value, std::string& out_str);
+
+// Booleans, with numbers as true when not zero and null as false
+bool as_bool(nonstd::string_view in_value);
+
+}
+
+#endif
+
@@ -0,0 +1,201 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "configfile.h"
+#include "json/json.h"
+#include "kis_lock_profile.h"
+#include "kis_net_beast_httpd.h"
+#include "messagebus.h"
+
+std::atomic<unsigned int> kis_lock_profiler::sample_rate{0};
+
+namespace {
+
+// Most distinct lock names; further names are all counted as 'other'
+const size_t lock_profile_max_names = 1024;
+
+// The registry can't use a kis_mutex, since locking one records into it
+struct lock_profile_registry {
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<kis_lock_profile_stats>> stats;
+};
+
+lock_profile_registry& registry() {
+    static lock_profile_registry r;
+    return r;
+}
+
+kis_lock_profile_stats *stats_for(const std::string& in_name) {
+    auto& r = registry();
+
+    std::lock_guard<std::mutex> lk(r.mutex);
+
+    auto i = r.stats.find(in_name);
+    if (i != r.stats.end())
+        return i->second.get();
+
+    std::string key = in_name;
+
+    if (r.stats.size() >= lock_profile_max_names) {
+        key = "other";
+
+        i = r.stats.find(key);
+        if (i != r.stats.end())
+            return i->second.get();
+    }
+
+    auto s = new kis_lock_profile_stats(key);
+    r.stats[key].reset(s);
+
+    return s;
+}
+
+Json::Value histogram_json(const kis_latency_histogram& h, unsigned int in_rate) {
+    Json::Value v;
+
+    v["samples"] = (Json::UInt64) h.get_count();
+    v["est_total_ms"] = h.get_sum() * (double) in_rate / 1e6;
+    v["min_ns"] = (Json::UInt64) h.get_min();
+    v["mean_ns"] = (Json::UInt64) (h.get_count() ? h.get_sum() / h.get_count() : 0);
+    v["p50_ns"] = (Json::UInt64) h.percentile(50);
+    v["p90_ns"] = (Json::UInt64) h.percentile(90);
+    v["p99_ns"] = (Json::UInt64) h.percentile(99);
+    v["p999_ns"] = (Json::UInt64) h.percentile(99.9);
+    v["max_ns"] = (Json::UInt64) h.get_max();
+
+    return v;
+}
+
+}
+
+void kis_lock_profiler::record(std::atomic<kis_lock_profile_stats *>& cache,
+        const std::string& name, lock_event ev, uint64_t ns, bool contended) {
+    auto stats = cache.load(std::memory_order_acquire);
+
+    if (stats == nullptr) {
+        stats = stats_for(name);
+        cache.store(stats, std::memory_order_release);
+    }
+
+    switch (ev) {
+        case lock_event::wait:
+            stats->wait.record(ns);
+            if (contended)
+                stats->contended.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case lock_event::shared_wait:
+            stats->shared_wait.record(ns);
+            if (contended)
+                stats->shared_contended.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case lock_event::hold:
+            stats->hold.record(ns);
+            break;
+    }
+}
+
+kis_lock_profile::kis_lock_profile() {
+    auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
+
+    httpd->register_route("/debug/locks", {"GET"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    std::ostream stream(&con->response_stream());
+
+                    con->set_mime_type("application/json");
+
+                    write_lock_stats(stream);
+                }));
+
+    if (Globalreg::globalreg->kismet_config->fetch_opt_bool("lock_profile", false)) {
+        auto rate = Globalreg::globalreg->kismet_config->fetch_opt_uint("lock_profile_sample", 64);
+
+        if (rate == 0)
+            rate = 1;
+
+        _MSG_INFO("Profiling lock contention of 1 in {} lock acquisitions; statistics are "
+                "available at /debug/locks", rate);
+
+        kis_lock_profiler::sample_rate = rate;
+    }
+}
+
+kis_lock_profile::~kis_lock_profile() {
+    kis_lock_profiler::sample_rate = 0;
+
+    Globalreg::globalreg->remove_global(global_name());
+}
+
+void kis_lock_profile::write_lock_stats(std::ostream& stream) {
+    auto rate = kis_lock_profiler::sample_rate.load();
+
+    std::vector<kis_lock_profile_stats *> stats;
+
+    {
+        auto& r = registry();
+        std::lock_guard<std::mutex> lk(r.mutex);
+
+        for (const auto& s : r.stats)
+            stats.push_back(s.second.get());
+    }
+
+    std::sort(stats.begin(), stats.end(),
+            [](const kis_lock_profile_stats *a, const kis_lock_profile_stats *b) {
+                return a->wait.get_sum() + a->shared_wait.get_sum() >
+                    b->wait.get_sum() + b->shared_wait.get_sum();
+            });
+
+    Json::Value root;
+
+    root["sample_rate"] = rate;
+    root["locks"] = Json::Value(Json::arrayValue);
+
+    for (auto s : stats) {
+        Json::Value l;
+
+        auto samples = s->wait.get_count();
+        auto shared_samples = s->shared_wait.get_count();
+
+        l["name"] = s->name;
+
+        // Acquisitions are sampled, so counts and totals are estimates
+        l["est_acquisitions"] = (Json::UInt64) (samples * rate);
+        l["contended"] = (Json::UInt64) s->contended.load();
+        l["contended_pct"] = samples ? s->contended.load() * 100.0 / samples : 0;
+        l["wait"] = histogram_json(s->wait, rate);
+        l["hold"] = histogram_json(s->hold, rate);
+
+        if (shared_samples) {
+            l["est_shared_acquisitions"] = (Json::UInt64) (shared_samples * rate);
+            l["shared_contended"] = (Json::UInt64) s->shared_contended.load();
+            l["shared_contended_pct"] = s->shared_contended.load() * 100.0 / shared_samples;
+            l["shared_wait"] = histogram_json(s->shared_wait, rate);
+        }
+
+        root["locks"].append(l);
+    }
+
+    stream << root;
+}
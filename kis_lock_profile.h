@@ -0,0 +1,77 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_LOCK_PROFILE_H__
+#define __KIS_LOCK_PROFILE_H__
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "globalregistry.h"
+#include "kis_histogram.h"
+#include "kis_mutex.h"
+
+// Lock contention statistics of every mutex sharing a name; mutexes which are never
+// named are all counted as 'UNNAMED'.  Stats are never freed, so mutexes can cache
+// them.
+struct kis_lock_profile_stats {
+    kis_lock_profile_stats(const std::string& in_name) :
+        name{in_name},
+        contended{0},
+        shared_contended{0} { }
+
+    const std::string name;
+
+    kis_latency_histogram wait;
+    kis_latency_histogram hold;
+    kis_latency_histogram shared_wait;
+
+    std::atomic<uint64_t> contended;
+    std::atomic<uint64_t> shared_contended;
+};
+
+// Configures the lock profiler and serves /debug/locks
+class kis_lock_profile : public lifetime_global {
+public:
+    static std::string global_name() { return "KIS_LOCK_PROFILE"; }
+
+    static std::shared_ptr<kis_lock_profile> create_lock_profile() {
+        std::shared_ptr<kis_lock_profile> mon(new kis_lock_profile());
+        Globalreg::globalreg->register_lifetime_global(mon);
+        Globalreg::globalreg->insert_global(global_name(), mon);
+        return mon;
+    }
+
+private:
+    kis_lock_profile();
+
+public:
+    virtual ~kis_lock_profile();
+
+    // Write the stats of every lock name as JSON, ordered by the estimated total
+    // time spent waiting
+    void write_lock_stats(std::ostream& stream);
+};
+
+#endif
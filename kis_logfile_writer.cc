@@ -0,0 +1,329 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "configfile.h"
+#include "globalregistry.h"
+#include "kis_logfile_writer.h"
+#include "messagebus.h"
+#include "util.h"
+
+// Alignment of buffers and of direct writes
+#define LOGFILE_WRITER_ALIGN    4096
+
+kis_logfile_writer::kis_logfile_writer() :
+    fd{-1},
+    direct_io{false},
+    buffer_sz{1024 * 1024},
+    max_pending{32},
+    flush_interval{1},
+    sync_interval{10},
+    writer_shutdown{false},
+    write_error{false},
+    dropped_bytes{0} { }
+
+kis_logfile_writer::~kis_logfile_writer() {
+    close();
+}
+
+bool kis_logfile_writer::open(const std::string& in_path) {
+    close();
+
+    path = in_path;
+
+    auto config = Globalreg::globalreg->kismet_config;
+
+    buffer_sz = (size_t) config->fetch_opt_uint("log_write_buffer_size", 1024) * 1024;
+    max_pending = config->fetch_opt_uint("log_write_max_pending", 32);
+    flush_interval = std::chrono::seconds(config->fetch_opt_uint("log_write_flush_interval", 1));
+    sync_interval = std::chrono::seconds(config->fetch_opt_uint("log_write_sync_interval", 10));
+    direct_io = config->fetch_opt_bool("log_write_direct", false);
+
+    // Keep buffers a multiple of the alignment so full buffers are valid direct writes
+    buffer_sz = ((buffer_sz + LOGFILE_WRITER_ALIGN - 1) / LOGFILE_WRITER_ALIGN) * LOGFILE_WRITER_ALIGN;
+    if (buffer_sz == 0)
+        buffer_sz = LOGFILE_WRITER_ALIGN;
+
+    if (max_pending == 0)
+        max_pending = 1;
+
+    if (flush_interval.count() == 0)
+        flush_interval = std::chrono::seconds(1);
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+#ifdef O_DIRECT
+    if (direct_io) {
+        fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+
+        // Not every filesystem supports direct io (tmpfs, for instance)
+        if (fd < 0 && errno == EINVAL) {
+            _MSG_INFO("Log file '{}' does not support direct IO, using buffered IO", path);
+            direct_io = false;
+        }
+    }
+#else
+    if (direct_io) {
+        _MSG_INFO("Direct IO is not available on this platform, using buffered IO for "
+                "log file '{}'", path);
+        direct_io = false;
+    }
+#endif
+
+    if (fd < 0 && !direct_io)
+        fd = ::open(path.c_str(), flags, 0644);
+
+    if (fd < 0) {
+        _MSG_ERROR("Failed to open log file '{}' for writing: {}", path, kis_strerror_r(errno));
+        return false;
+    }
+
+    write_error = false;
+    dropped_bytes = 0;
+    writer_shutdown = false;
+    last_sync = std::chrono::steady_clock::now();
+
+    current_buffer = acquire_buffer();
+
+    if (current_buffer == nullptr) {
+        _MSG_ERROR("Failed to allocate write buffers for log file '{}'", path);
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    writer_thread = std::thread([this]() {
+            thread_set_process_name("logwriter");
+            writer_loop();
+            });
+
+    return true;
+}
+
+void kis_logfile_writer::close() {
+    if (writer_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            writer_shutdown = true;
+        }
+
+        cv.notify_all();
+        writer_thread.join();
+    }
+
+    // Writers racing the close see the closed file and drop their data
+    std::lock_guard<std::mutex> lk(mutex);
+
+    if (fd < 0)
+        return;
+
+    // The writer leaves any partial buffer for us; direct writes have to be aligned, so
+    // drop back to buffered io for the tail
+    if (current_buffer != nullptr && current_buffer->len > 0 && !write_error) {
+#ifdef O_DIRECT
+        if (direct_io)
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_DIRECT);
+#endif
+        write_fully(current_buffer->data.get(), current_buffer->len);
+    }
+
+    if (sync_interval.count() > 0)
+        sync_file();
+
+    ::close(fd);
+    fd = -1;
+
+    current_buffer.reset();
+    pending_buffers.clear();
+    free_buffers.clear();
+}
+
+std::shared_ptr<kis_logfile_writer::write_buffer> kis_logfile_writer::acquire_buffer() {
+    if (free_buffers.size() > 0) {
+        auto buf = free_buffers.back();
+        free_buffers.pop_back();
+        buf->len = 0;
+        return buf;
+    }
+
+    void *mem = nullptr;
+
+    if (posix_memalign(&mem, LOGFILE_WRITER_ALIGN, buffer_sz) != 0)
+        return nullptr;
+
+    auto buf = std::make_shared<write_buffer>();
+    buf->data = std::unique_ptr<char, aligned_free>(static_cast<char *>(mem));
+    buf->len = 0;
+
+    return buf;
+}
+
+void kis_logfile_writer::release_buffer(std::shared_ptr<write_buffer> buf) {
+    // Keep enough to refill the queue without allocating
+    if (free_buffers.size() < max_pending + 1)
+        free_buffers.push_back(buf);
+}
+
+bool kis_logfile_writer::append_locked(const char *src, size_t len, bool& queued) {
+    while (len > 0) {
+        if (current_buffer->len == buffer_sz) {
+            auto next = acquire_buffer();
+
+            if (next == nullptr)
+                return false;
+
+            pending_buffers.push_back(current_buffer);
+            current_buffer = next;
+            queued = true;
+        }
+
+        auto copy_sz = std::min(len, buffer_sz - current_buffer->len);
+        memcpy(current_buffer->data.get() + current_buffer->len, src, copy_sz);
+
+        current_buffer->len += copy_sz;
+        src += copy_sz;
+        len -= copy_sz;
+    }
+
+    return true;
+}
+
+bool kis_logfile_writer::write(const void *data, size_t len, const void *data2, size_t len2) {
+    std::unique_lock<std::mutex> lk(mutex);
+
+    if (fd < 0 || write_error) {
+        dropped_bytes += len + len2;
+        return false;
+    }
+
+    // Records are all or nothing, so a full queue never leaves a partial record in the file
+    size_t avail = buffer_sz - current_buffer->len;
+    if (pending_buffers.size() < max_pending)
+        avail += (max_pending - pending_buffers.size()) * buffer_sz;
+
+    if (len + len2 > avail) {
+        dropped_bytes += len + len2;
+        return false;
+    }
+
+    bool queued = false;
+
+    bool r = append_locked(static_cast<const char *>(data), len, queued);
+
+    if (r && len2 > 0)
+        r = append_locked(static_cast<const char *>(data2), len2, queued);
+
+    lk.unlock();
+
+    if (queued)
+        cv.notify_one();
+
+    return r;
+}
+
+bool kis_logfile_writer::write_fully(const char *data, size_t len) {
+    while (len > 0) {
+        auto r = ::write(fd, data, len);
+
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+
+            if (!write_error)
+                _MSG_ERROR("Error writing to log file '{}': {}", path, kis_strerror_r(errno));
+
+            write_error = true;
+            return false;
+        }
+
+        data += r;
+        len -= r;
+    }
+
+    return true;
+}
+
+void kis_logfile_writer::sync_file() {
+#ifdef __linux__
+    fdatasync(fd);
+#else
+    fsync(fd);
+#endif
+
+    last_sync = std::chrono::steady_clock::now();
+}
+
+void kis_logfile_writer::writer_loop() {
+    std::unique_lock<std::mutex> lk(mutex);
+
+    auto last_flush = std::chrono::steady_clock::now();
+
+    while (true) {
+        cv.wait_for(lk, flush_interval, [this]() {
+                return pending_buffers.size() > 0 || writer_shutdown;
+                });
+
+        auto now = std::chrono::steady_clock::now();
+
+        // Push out a partial buffer once it has been sitting long enough; direct io can
+        // only write whole buffers, so it waits for close
+        if (!direct_io && !writer_shutdown && pending_buffers.size() == 0 &&
+                current_buffer->len > 0 && now - last_flush >= flush_interval) {
+            auto next = acquire_buffer();
+
+            if (next != nullptr) {
+                pending_buffers.push_back(current_buffer);
+                current_buffer = next;
+            }
+        }
+
+        if (pending_buffers.size() == 0) {
+            if (writer_shutdown)
+                break;
+
+            continue;
+        }
+
+        std::deque<std::shared_ptr<write_buffer>> writing;
+        writing.swap(pending_buffers);
+
+        lk.unlock();
+
+        for (const auto& b : writing) {
+            if (!write_error)
+                write_fully(b->data.get(), b->len);
+        }
+
+        last_flush = std::chrono::steady_clock::now();
+
+        if (sync_interval.count() > 0 && last_flush - last_sync >= sync_interval)
+            sync_file();
+
+        lk.lock();
+
+        for (const auto& b : writing)
+            release_buffer(b);
+    }
+}
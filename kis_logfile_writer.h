@@ -0,0 +1,127 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_LOGFILE_WRITER_H__
+#define __KIS_LOGFILE_WRITER_H__
+
+#include "config.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Buffered asynchronous file writer for logfiles.
+//
+// Writes are copied into large page-aligned buffers and handed to a writer thread, so
+// callers on the packet chain never wait on the disk.  Partially filled buffers are
+// flushed to the file periodically, and the file is optionally fdatasync'd periodically
+// instead of being flushed per record.  If the disk falls far enough behind that the
+// maximum number of pending buffers is reached, further writes are dropped and counted
+// instead of blocking.
+//
+// On Linux the file may be opened with O_DIRECT to bypass the page cache; in that mode
+// only full buffers are written until the log is closed, since direct writes must be
+// aligned.
+//
+// Configuration (kismet_logging.conf):
+//   log_write_buffer_size      Buffer size in KB
+//   log_write_max_pending      Maximum number of full buffers waiting to be written
+//   log_write_flush_interval   Seconds before a partial buffer is written
+//   log_write_sync_interval    Seconds between fdatasync calls, 0 to never sync
+//   log_write_direct           Use O_DIRECT where available
+class kis_logfile_writer {
+public:
+    kis_logfile_writer();
+    ~kis_logfile_writer();
+
+    bool open(const std::string& in_path);
+
+    // Write everything buffered, sync, and close the file
+    void close();
+
+    // Queue data for writing; returns false if the data was dropped.  Each write is 
+    // queued or dropped as a whole.
+    bool write(const void *data, size_t len) {
+        return write(data, len, nullptr, 0);
+    }
+
+    bool write(const std::string& data) {
+        return write(data.data(), data.length(), nullptr, 0);
+    }
+
+    // Queue a record in two parts, such as a header and its payload
+    bool write(const void *data, size_t len, const void *data2, size_t len2);
+
+    bool is_open() const { return fd >= 0; }
+
+    // The writer stops writing after the first failed write
+    bool get_error() const { return write_error; }
+
+    uint64_t get_dropped_bytes() const { return dropped_bytes; }
+
+protected:
+    struct aligned_free {
+        void operator()(char *p) const { free(p); }
+    };
+
+    struct write_buffer {
+        std::unique_ptr<char, aligned_free> data;
+        size_t len;
+    };
+
+    std::shared_ptr<write_buffer> acquire_buffer();
+    bool append_locked(const char *src, size_t len, bool& queued);
+    void release_buffer(std::shared_ptr<write_buffer> buf);
+
+    bool write_fully(const char *data, size_t len);
+    void sync_file();
+
+    void writer_loop();
+
+    std::string path;
+    int fd;
+
+    bool direct_io;
+    size_t buffer_sz;
+    size_t max_pending;
+    std::chrono::seconds flush_interval;
+    std::chrono::seconds sync_interval;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    std::shared_ptr<write_buffer> current_buffer;
+    std::deque<std::shared_ptr<write_buffer>> pending_buffers;
+    std::vector<std::shared_ptr<write_buffer>> free_buffers;
+
+    std::thread writer_thread;
+    bool writer_shutdown;
+
+    std::atomic<bool> write_error;
+    std::atomic<uint64_t> dropped_bytes;
+
+    std::chrono::steady_clock::time_point last_sync;
+};
+
+#endif
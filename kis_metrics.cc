@@ -0,0 +1,352 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include "datasourcetracker.h"
+#include "devicetracker.h"
+#include "fmt.h"
+#include "kis_databaselogfile.h"
+#include "kis_metrics.h"
+#include "kis_net_beast_httpd.h"
+#include "packetchain.h"
+#include "system_monitor.h"
+#include "trackedstringpool.h"
+
+namespace {
+
+struct datasource_metrics {
+    kis_metric_labels labels;
+
+    uint64_t packets;
+    uint64_t error_packets;
+    uint64_t kernel_packets;
+    uint64_t kernel_drops;
+    uint64_t ringbuf_full;
+
+    double packet_rate;
+    double chain_drop_rate;
+
+    bool running;
+    bool error;
+    bool paused;
+};
+
+class metrics_datasource_worker : public datasource_tracker_worker {
+public:
+    metrics_datasource_worker(time_t in_now) :
+        now{in_now} { }
+
+    virtual void handle_datasource(std::shared_ptr<kis_datasource> in_src) override {
+        datasource_metrics m;
+
+        std::string type;
+        auto builder = in_src->get_source_builder();
+
+        if (builder != nullptr)
+            type = builder->get_source_type();
+
+        m.labels = {
+            {"name", in_src->get_source_name()},
+            {"uuid", in_src->get_source_uuid().as_string()},
+            {"type", type},
+            {"interface", in_src->get_source_interface()},
+        };
+
+        m.packets = in_src->get_source_num_packets();
+        m.error_packets = in_src->get_source_num_error_packets();
+        m.kernel_packets = in_src->get_source_kernel_packets();
+        m.kernel_drops = in_src->get_source_kernel_drops();
+        m.ringbuf_full = in_src->get_source_ringbuf_full();
+
+        // Only sources which have seen traffic have rrds
+        auto rate_rrd = in_src->get_tracker_source_packet_rrd();
+        m.packet_rate = rate_rrd != nullptr ? rate_rrd->get_minute_avg(now) : 0;
+
+        auto drop_rrd = in_src->get_tracker_source_chain_drop_rrd();
+        m.chain_drop_rate = drop_rrd != nullptr ? drop_rrd->get_minute_avg(now) : 0;
+
+        m.running = in_src->get_source_running();
+        m.error = in_src->get_source_error();
+        m.paused = in_src->get_source_paused();
+
+        sources.push_back(m);
+    }
+
+    time_t now;
+    std::vector<datasource_metrics> sources;
+};
+
+}
+
+void kis_openmetrics_writer::family(const std::string& in_name, const std::string& in_type,
+        const std::string& in_help) {
+    stream << "# TYPE " << in_name << " " << in_type << "\n";
+    stream << "# HELP " << in_name << " " << in_help << "\n";
+
+    if (in_type == "counter")
+        sample_name = in_name + "_total";
+    else if (in_type == "info")
+        sample_name = in_name + "_info";
+    else
+        sample_name = in_name;
+}
+
+void kis_openmetrics_writer::write_sample_name(const kis_metric_labels& in_labels) {
+    stream << sample_name;
+
+    if (in_labels.size() == 0)
+        return;
+
+    stream << "{";
+
+    bool first = true;
+
+    for (const auto& l : in_labels) {
+        if (!first)
+            stream << ",";
+        first = false;
+
+        stream << l.first << "=\"" << escape_label(l.second) << "\"";
+    }
+
+    stream << "}";
+}
+
+void kis_openmetrics_writer::sample(uint64_t in_value, const kis_metric_labels& in_labels) {
+    write_sample_name(in_labels);
+    stream << " " << in_value << "\n";
+}
+
+void kis_openmetrics_writer::sample(int64_t in_value, const kis_metric_labels& in_labels) {
+    write_sample_name(in_labels);
+    stream << " " << in_value << "\n";
+}
+
+void kis_openmetrics_writer::sample(double in_value, const kis_metric_labels& in_labels) {
+    write_sample_name(in_labels);
+    stream << " " << fmt::format("{}", in_value) << "\n";
+}
+
+void kis_openmetrics_writer::finish() {
+    stream << "# EOF\n";
+}
+
+std::string kis_openmetrics_writer::escape_label(const std::string& in_str) {
+    std::string ret;
+    ret.reserve(in_str.length());
+
+    for (auto c : in_str) {
+        switch (c) {
+            case '\\':
+                ret += "\\\\";
+                break;
+            case '"':
+                ret += "\\\"";
+                break;
+            case '\n':
+                ret += "\\n";
+                break;
+            default:
+                ret += c;
+        }
+    }
+
+    return ret;
+}
+
+kis_metrics::kis_metrics() {
+    auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
+
+    httpd->register_route("/metrics", {"GET"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    std::ostream stream(&con->response_stream());
+
+                    con->set_mime_type("application/openmetrics-text; version=1.0.0; charset=utf-8");
+
+                    write_metrics(stream);
+                }));
+}
+
+kis_metrics::~kis_metrics() {
+    Globalreg::globalreg->remove_global(global_name());
+}
+
+void kis_metrics::write_metrics(std::ostream& stream) {
+    kis_openmetrics_writer w(stream);
+
+    write_server_metrics(w);
+    write_packetchain_metrics(w);
+    write_datasource_metrics(w);
+
+    w.finish();
+}
+
+void kis_metrics::write_server_metrics(kis_openmetrics_writer& w) {
+    w.family("kismet_build", "info", "Kismet server version");
+    w.sample((uint64_t) 1, {
+            {"version", fmt::format("{}-{}-{}", Globalreg::globalreg->version_major,
+                    Globalreg::globalreg->version_minor, Globalreg::globalreg->version_tiny)},
+            {"git", Globalreg::globalreg->version_git_rev},
+            });
+
+    w.single("kismet_start_time_seconds", "gauge", "Server start time, in seconds since the epoch",
+            (int64_t) Globalreg::globalreg->start_time);
+
+    auto sysmon = Globalreg::fetch_global_as<Systemmonitor>();
+    if (sysmon != nullptr)
+        w.single("kismet_memory_rss_bytes", "gauge", "Resident memory of the server",
+                (uint64_t) sysmon->get_memory_kb() * 1024);
+
+    auto devicetracker = Globalreg::fetch_global_as<device_tracker>();
+    if (devicetracker != nullptr)
+        w.single("kismet_devices", "gauge", "Tracked devices",
+                (int64_t) devicetracker->fetch_num_devices());
+
+    w.single("kismet_string_pool_records", "gauge", "Records in the shared string pool",
+            (uint64_t) tracker_string_pool::size());
+
+    w.single("kismet_tracked_fields", "gauge", "Allocated tracked element fields",
+            (uint64_t) Globalreg::n_tracked_fields.load());
+
+    w.single("kismet_http_connections", "gauge", "Concurrent HTTP connections",
+            (uint64_t) Globalreg::n_tracked_http_connections.load());
+
+    auto kismetdb = Globalreg::fetch_global_as<kis_database_logfile>();
+    if (kismetdb != nullptr)
+        w.single("kismet_log_queue_records", "gauge",
+                "Records waiting to be written to the kismetdb log",
+                (uint64_t) kismetdb->get_write_queue_size());
+}
+
+void kis_metrics::write_packetchain_metrics(kis_openmetrics_writer& w) {
+    auto packetchain = Globalreg::fetch_global_as<packet_chain>();
+
+    if (packetchain == nullptr)
+        return;
+
+    w.single("kismet_packets_processed", "counter", "Packets processed by the packet chain",
+            packetchain->get_packets_processed());
+    w.single("kismet_packets_dropped", "counter",
+            "Packets dropped instead of being queued for the packet chain",
+            packetchain->get_packets_dropped());
+    w.single("kismet_packets_error", "counter", "Processed packets flagged as errors",
+            packetchain->get_packets_error());
+    w.single("kismet_packets_duplicate", "counter", "Processed packets flagged as duplicates",
+            packetchain->get_packets_duplicate());
+
+    auto shed = packetchain->get_shed_stats();
+    w.family("kismet_packets_shed", "counter", "Packets shed by the drop policy, by reason");
+    w.sample(shed.duplicates, {{"reason", "duplicate"}});
+    w.sample(shed.fairness, {{"reason", "fairness"}});
+    w.sample(shed.data, {{"reason", "data"}});
+
+    auto dedupe = packetchain->get_dedupe_stats();
+    w.family("kismet_packet_dedupe", "counter", "Packet duplicate cache lookups, by result");
+    w.sample(dedupe.hits, {{"result", "hit"}});
+    w.sample(dedupe.misses, {{"result", "miss"}});
+    w.sample(dedupe.evictions, {{"result", "eviction"}});
+
+    w.single("kismet_packet_backlog", "gauge", "Packets accepted and not yet processed",
+            packetchain->get_packets_backlog());
+
+    auto threads = packetchain->get_packet_thread_stats();
+
+    w.family("kismet_packet_thread_queue_depth", "gauge", "Packets queued for a packet thread");
+    for (size_t n = 0; n < threads.size(); n++)
+        w.sample(threads[n].queue_depth, {{"thread", std::to_string(n)}});
+
+    w.family("kismet_packet_thread_processed", "counter", "Packets processed by a packet thread");
+    for (size_t n = 0; n < threads.size(); n++)
+        w.sample(threads[n].processed, {{"thread", std::to_string(n)}});
+
+    w.family("kismet_packet_thread_steals", "counter",
+            "Packet groups a packet thread has stolen from other threads");
+    for (size_t n = 0; n < threads.size(); n++)
+        w.sample(threads[n].steals, {{"thread", std::to_string(n)}});
+
+    uint64_t in_use = 0, pooled = 0;
+
+    for (const auto& bs : packetchain->get_packet_buffer_stats()) {
+        in_use += bs.in_use * bs.size;
+        pooled += bs.pooled * bs.size;
+    }
+
+    w.family("kismet_packet_buffers_bytes", "gauge", "Packet data buffer memory, by state");
+    w.sample(in_use, {{"state", "in_use"}});
+    w.sample(pooled, {{"state", "pooled"}});
+}
+
+void kis_metrics::write_datasource_metrics(kis_openmetrics_writer& w) {
+    auto datasourcetracker = Globalreg::fetch_global_as<datasource_tracker>();
+
+    if (datasourcetracker == nullptr)
+        return;
+
+    metrics_datasource_worker worker(Globalreg::globalreg->last_tv_sec);
+    datasourcetracker->iterate_datasources(&worker);
+
+    const auto& sources = worker.sources;
+
+    w.family("kismet_datasource_packets", "counter", "Packets received from a datasource");
+    for (const auto& s : sources)
+        w.sample(s.packets, s.labels);
+
+    w.family("kismet_datasource_error_packets", "counter",
+            "Invalid packets received from a datasource");
+    for (const auto& s : sources)
+        w.sample(s.error_packets, s.labels);
+
+    w.family("kismet_datasource_kernel_packets", "counter",
+            "Packets seen by the kernel on a datasource, when the capture reports it");
+    for (const auto& s : sources)
+        w.sample(s.kernel_packets, s.labels);
+
+    w.family("kismet_datasource_kernel_drops", "counter",
+            "Packets dropped by the kernel before the capture read them");
+    for (const auto& s : sources)
+        w.sample(s.kernel_drops, s.labels);
+
+    w.family("kismet_datasource_ringbuf_full", "counter",
+            "Packets lost because the capture ringbuffer to Kismet was full");
+    for (const auto& s : sources)
+        w.sample(s.ringbuf_full, s.labels);
+
+    w.family("kismet_datasource_packet_rate", "gauge",
+            "Packets per second from a datasource, averaged over the last minute");
+    for (const auto& s : sources)
+        w.sample(s.packet_rate, s.labels);
+
+    w.family("kismet_datasource_chain_drop_rate", "gauge",
+            "Packets per second from a datasource shed by the packet chain, averaged over the last minute");
+    for (const auto& s : sources)
+        w.sample(s.chain_drop_rate, s.labels);
+
+    w.family("kismet_datasource_running", "gauge", "Datasource is running");
+    for (const auto& s : sources)
+        w.sample((uint64_t) s.running, s.labels);
+
+    w.family("kismet_datasource_error", "gauge", "Datasource is in an error state");
+    for (const auto& s : sources)
+        w.sample((uint64_t) s.error, s.labels);
+
+    w.family("kismet_datasource_paused", "gauge", "Datasource is paused");
+    for (const auto& s : sources)
+        w.sample((uint64_t) s.paused, s.labels);
+}
@@ -0,0 +1,104 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_METRICS_H__
+#define __KIS_METRICS_H__
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "globalregistry.h"
+
+// OpenMetrics (Prometheus) exporter
+//
+// /metrics is written directly from the packet chain, datasource, device, and memory
+// counters as OpenMetrics text, without building or serializing tracked elements,
+// so it is cheap to scrape often.  Prefer counters over the rrd rates; the scraper
+// can compute rates over any window from them.
+
+typedef std::vector<std::pair<std::string, std::string>> kis_metric_labels;
+
+// Writes OpenMetrics text; every sample of a metric family must be written right
+// after the family header
+class kis_openmetrics_writer {
+public:
+    kis_openmetrics_writer(std::ostream& in_stream) :
+        stream{in_stream} { }
+
+    // Start a metric family; counter samples are written with a _total suffix and
+    // info samples with an _info suffix
+    void family(const std::string& in_name, const std::string& in_type,
+            const std::string& in_help);
+
+    void sample(uint64_t in_value, const kis_metric_labels& in_labels = {});
+    void sample(int64_t in_value, const kis_metric_labels& in_labels = {});
+    void sample(double in_value, const kis_metric_labels& in_labels = {});
+
+    // Write a family with a single unlabeled sample
+    template<typename T>
+    void single(const std::string& in_name, const std::string& in_type,
+            const std::string& in_help, T in_value) {
+        family(in_name, in_type, in_help);
+        sample(in_value);
+    }
+
+    // End of the exposition
+    void finish();
+
+    static std::string escape_label(const std::string& in_str);
+
+protected:
+    void write_sample_name(const kis_metric_labels& in_labels);
+
+    std::ostream& stream;
+    std::string sample_name;
+};
+
+class kis_metrics : public lifetime_global {
+public:
+    static std::string global_name() { return "KIS_METRICS"; }
+
+    static std::shared_ptr<kis_metrics> create_metrics() {
+        std::shared_ptr<kis_metrics> mon(new kis_metrics());
+        Globalreg::globalreg->register_lifetime_global(mon);
+        Globalreg::globalreg->insert_global(global_name(), mon);
+        return mon;
+    }
+
+private:
+    kis_metrics();
+
+public:
+    virtual ~kis_metrics();
+
+    void write_metrics(std::ostream& stream);
+
+protected:
+    void write_server_metrics(kis_openmetrics_writer& w);
+    void write_packetchain_metrics(kis_openmetrics_writer& w);
+    void write_datasource_metrics(kis_openmetrics_writer& w);
+};
+
+#endif
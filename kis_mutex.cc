@@ -0,0 +1,105 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#ifdef SYS_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "kis_mutex.h"
+
+namespace {
+
+// Attempts before a contended lock parks; long enough to ride out a short critical
+// section on another core, short enough not to burn a timeslice
+const unsigned int fast_mutex_spins = 100;
+
+inline void cpu_relax() {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Sleep while the lock word still holds val, or until the timeout
+void park(std::atomic<uint32_t>& word, uint32_t val, long timeout_usec) {
+#ifdef SYS_LINUX
+    struct timespec ts;
+    ts.tv_sec = timeout_usec / 1000000;
+    ts.tv_nsec = (timeout_usec % 1000000) * 1000;
+
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE, val,
+            timeout_usec > 0 ? &ts : nullptr, nullptr, 0);
+#else
+    (void) word;
+    (void) val;
+    (void) timeout_usec;
+    std::this_thread::yield();
+#endif
+}
+
+}
+
+void kis_fast_mutex::lock_contended() {
+    auto c = state.load(std::memory_order_relaxed);
+
+    for (unsigned int i = 0; i < fast_mutex_spins; i++) {
+        if (c == 0 && state.compare_exchange_weak(c, 1, std::memory_order_acquire,
+                    std::memory_order_relaxed))
+            return;
+
+        cpu_relax();
+        c = state.load(std::memory_order_relaxed);
+    }
+
+#ifdef DEBUG_MUTEX_DEADLOCK
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(KIS_THREAD_TIMEOUT);
+    const long park_usec = 100000;
+#else
+    const long park_usec = 0;
+#endif
+
+    // Mark the lock as having waiters so the owner wakes us; whoever takes it this
+    // way leaves it marked, which costs at most one spurious wake
+    if (c != 2)
+        c = state.exchange(2, std::memory_order_acquire);
+
+    while (c != 0) {
+        park(state, 2, park_usec);
+
+#ifdef DEBUG_MUTEX_DEADLOCK
+        if (std::chrono::steady_clock::now() > deadline)
+            throw std::runtime_error(fmt::format("potential deadlock: mutex {} not available "
+                        "within timeout period", name));
+#endif
+
+        c = state.exchange(2, std::memory_order_acquire);
+    }
+}
+
+void kis_fast_mutex::wake_waiter() {
+#ifdef SYS_LINUX
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&state), FUTEX_WAKE_PRIVATE, 1,
+            nullptr, nullptr, 0);
+#endif
+}
@@ -37,10 +37,61 @@
 
 #define KIS_THREAD_TIMEOUT      30
 
+struct kis_lock_profile_stats;
+
+// Optional lock contention profiler
+//
+// When enabled (lock_profile=true), 1 in N lock acquisitions on each thread are
+// timed:  the wait to acquire the lock and, for exclusive locks, how long it was
+// held.  Samples are aggregated by mutex name and served from /debug/locks (see
+// kis_lock_profile.h).  When disabled, locking costs one relaxed atomic load.
+class kis_lock_profiler {
+public:
+    enum class lock_event {
+        wait, shared_wait, hold
+    };
+
+    // Time 1 in sample_rate acquisitions; 0 when profiling is disabled
+    static std::atomic<unsigned int> sample_rate;
+
+    static bool sample() {
+        auto rate = sample_rate.load(std::memory_order_relaxed);
+
+        if (rate == 0)
+            return false;
+
+        static thread_local unsigned int counter = 0;
+
+        return (++counter % rate) == 0;
+    }
+
+    static uint64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Record a sample against the stats of a mutex name; the stats are looked up
+    // the first time and cached in the mutex
+    static void record(std::atomic<kis_lock_profile_stats *>& cache, const std::string& name,
+            lock_event ev, uint64_t ns, bool contended = false);
+};
+
 class kis_mutex : public std::recursive_timed_mutex {
 private:
     std::string name;
 
+    std::atomic<kis_lock_profile_stats *> profile_stats{nullptr};
+
+    // Sampled hold of the current owner; only touched while the mutex is held.  Nested
+    // locks by the owner extend the hold until the outermost unlock.
+    uint64_t hold_start{0};
+    unsigned int hold_depth{0};
+
+    void note_locked() {
+        if (hold_start != 0)
+            hold_depth++;
+    }
+
 public:
     kis_mutex() :
         name{"UNNAMED"} { }
@@ -54,12 +105,77 @@ public:
 
     void set_name(const std::string& name) {
         this->name = name;
+        profile_stats = nullptr;
     }
 
     const std::string& get_name() const {
         return name;
     }
 
+    void lock() {
+        if (!kis_lock_profiler::sample()) {
+            std::recursive_timed_mutex::lock();
+            note_locked();
+            return;
+        }
+
+        auto start = kis_lock_profiler::now_ns();
+        bool contended = !std::recursive_timed_mutex::try_lock();
+
+        if (contended)
+            std::recursive_timed_mutex::lock();
+
+        auto acquired = kis_lock_profiler::now_ns();
+
+        kis_lock_profiler::record(profile_stats, name, kis_lock_profiler::lock_event::wait,
+                acquired - start, contended);
+
+        if (hold_start != 0) {
+            hold_depth++;
+        } else {
+            hold_start = acquired;
+            hold_depth = 1;
+        }
+    }
+
+    bool try_lock() {
+        if (!std::recursive_timed_mutex::try_lock())
+            return false;
+
+        note_locked();
+        return true;
+    }
+
+    template<class Rep, class Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& timeout_duration) {
+        if (!std::recursive_timed_mutex::try_lock_for(timeout_duration))
+            return false;
+
+        note_locked();
+        return true;
+    }
+
+    template<class Clock, class Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& timeout_time) {
+        if (!std::recursive_timed_mutex::try_lock_until(timeout_time))
+            return false;
+
+        note_locked();
+        return true;
+    }
+
+    void unlock() {
+        if (hold_start != 0 && --hold_depth == 0) {
+            auto start = hold_start;
+            hold_start = 0;
+
+            kis_lock_profiler::record(profile_stats, name, kis_lock_profiler::lock_event::hold,
+                    kis_lock_profiler::now_ns() - start);
+        }
+
+        std::recursive_timed_mutex::unlock();
+    }
+
     // Previous workaround for gcc try_lock_for bugs here, but now we require c++14 so we don't
     // need them
 
@@ -86,11 +202,150 @@ public:
     }
 };
 
+// Non-recursive, non-timed mutex for short, hot critical sections
+//
+// Acquiring an uncontended kis_fast_mutex is a single compare-and-swap; a contended
+// lock spins briefly before parking the thread (on a futex on Linux, elsewhere by
+// yielding) until the owner releases it.  Unlike kis_mutex it can not be locked again
+// by the thread which holds it, and has no try_lock_for; it is meant for locks which
+// are only ever held around a few operations on a container, and never while calling
+// out to code which could take the lock again.
+//
+// Builds configured with --enable-mutex-deadlock-debug track the owner, throw on a
+// recursive lock, and throw if the lock can't be acquired within KIS_THREAD_TIMEOUT
+// seconds, like the old timed locks did.
+class kis_fast_mutex {
+private:
+    // 0 unlocked, 1 locked, 2 locked with parked waiters
+    std::atomic<uint32_t> state{0};
+
+    std::string name;
+
+    std::atomic<kis_lock_profile_stats *> profile_stats{nullptr};
+
+    // Sampled hold of the current owner; only touched while the mutex is held
+    uint64_t hold_start{0};
+
+#ifdef DEBUG_MUTEX_DEADLOCK
+    std::atomic<std::thread::id> owner{std::thread::id()};
+#endif
+
+    bool try_acquire() {
+        uint32_t expected = 0;
+        return state.compare_exchange_strong(expected, 1, std::memory_order_acquire,
+                std::memory_order_relaxed);
+    }
+
+    void acquired() {
+#ifdef DEBUG_MUTEX_DEADLOCK
+        owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+#endif
+    }
+
+    // Spin, then park until the lock is acquired; in kis_mutex.cc
+    void lock_contended();
+
+    // Wake one parked waiter
+    void wake_waiter();
+
+public:
+    kis_fast_mutex() :
+        name{"UNNAMED"} { }
+    kis_fast_mutex(const std::string& name) :
+        name{name} { }
+
+    kis_fast_mutex(const kis_fast_mutex&) = delete;
+    kis_fast_mutex& operator=(const kis_fast_mutex&) = delete;
+
+    ~kis_fast_mutex() = default;
+
+    void set_name(const std::string& name) {
+        this->name = name;
+        profile_stats = nullptr;
+    }
+
+    const std::string& get_name() const {
+        return name;
+    }
+
+    void lock() {
+#ifdef DEBUG_MUTEX_DEADLOCK
+        if (owner.load(std::memory_order_relaxed) == std::this_thread::get_id())
+            throw std::runtime_error(fmt::format("invalid use: thread {} attempted to lock "
+                        "non-recursive mutex {} it already holds", std::this_thread::get_id(),
+                        name));
+#endif
+
+        if (!kis_lock_profiler::sample()) {
+            if (!try_acquire())
+                lock_contended();
+            acquired();
+            return;
+        }
+
+        auto start = kis_lock_profiler::now_ns();
+        bool contended = !try_acquire();
+
+        if (contended)
+            lock_contended();
+
+        acquired();
+
+        hold_start = kis_lock_profiler::now_ns();
+
+        kis_lock_profiler::record(profile_stats, name, kis_lock_profiler::lock_event::wait,
+                hold_start - start, contended);
+    }
+
+    bool try_lock() {
+        if (!try_acquire())
+            return false;
+
+        acquired();
+        return true;
+    }
+
+    // Unlocking a mutex which isn't held does nothing
+    void unlock() {
+        if (hold_start != 0) {
+            auto start = hold_start;
+            hold_start = 0;
+
+            kis_lock_profiler::record(profile_stats, name, kis_lock_profiler::lock_event::hold,
+                    kis_lock_profiler::now_ns() - start);
+        }
+
+#ifdef DEBUG_MUTEX_DEADLOCK
+        owner.store(std::thread::id(), std::memory_order_relaxed);
+#endif
+
+        if (state.exchange(0, std::memory_order_release) == 2)
+            wake_waiter();
+    }
+
+    void lock_shared() {
+        throw std::runtime_error("lock_shared called on non-shared mutex");
+    }
+
+    bool try_lock_shared() {
+        throw std::runtime_error("try_lock_shared called on non-shared mutex");
+    }
+
+    void unlock_shared() {
+        throw std::runtime_error("unlock_shared called on non-shared mutex");
+    }
+};
+
 class kis_shared_mutex {
 private:
     std::shared_timed_mutex mutex;
     std::string name;
 
+    std::atomic<kis_lock_profile_stats *> profile_stats{nullptr};
+
+    // Sampled hold of the exclusive owner; shared holds overlap and aren't timed
+    uint64_t hold_start{0};
+
 public:
     kis_shared_mutex() :
         name{"UNNAMED"} { }
@@ -104,6 +359,7 @@ public:
 
     void set_name(const std::string& name) {
         this->name = name;
+        profile_stats = nullptr;
     }
 
     const std::string& get_name() const {
@@ -111,7 +367,21 @@ public:
     }
 
     void lock() {
-        mutex.lock();
+        if (!kis_lock_profiler::sample()) {
+            mutex.lock();
+            return;
+        }
+
+        auto start = kis_lock_profiler::now_ns();
+        bool contended = !mutex.try_lock();
+
+        if (contended)
+            mutex.lock();
+
+        hold_start = kis_lock_profiler::now_ns();
+
+        kis_lock_profiler::record(profile_stats, name, kis_lock_profiler::lock_event::wait,
+                hold_start - start, contended);
     }
 
     bool try_lock() {
@@ -129,11 +399,31 @@ public:
     }
 
     void unlock() {
+        if (hold_start != 0) {
+            auto start = hold_start;
+            hold_start = 0;
+
+            kis_lock_profiler::record(profile_stats, name, kis_lock_profiler::lock_event::hold,
+                    kis_lock_profiler::now_ns() - start);
+        }
+
         return mutex.unlock();
     }
 
     void lock_shared() {
-        mutex.lock_shared();
+        if (!kis_lock_profiler::sample()) {
+            mutex.lock_shared();
+            return;
+        }
+
+        auto start = kis_lock_profiler::now_ns();
+        bool contended = !mutex.try_lock_shared();
+
+        if (contended)
+            mutex.lock_shared();
+
+        kis_lock_profiler::record(profile_stats, name, kis_lock_profiler::lock_event::shared_wait,
+                kis_lock_profiler::now_ns() - start, contended);
     }
 
     bool try_lock_shared() {
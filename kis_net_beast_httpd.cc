@@ -18,6 +18,8 @@
 
 #include "kis_net_beast_httpd.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <random>
@@ -27,8 +29,10 @@
 #include "alertracker.h"
 #include "base64.h"
 #include "configfile.h"
+#include "kis_trace.h"
 #include "messagebus.h"
 #include "util.h"
+#include "xxhash.h"
 
 const std::string kis_net_beast_httpd::LOGON_ROLE{"admin"};
 const std::string kis_net_beast_httpd::ANY_ROLE{"any"};
@@ -78,9 +82,15 @@ kis_net_beast_httpd::kis_net_beast_httpd(boost::asio::ip::tcp::endpoint& endpoin
     deferred_startup{},
     running{false},
     endpoint{endpoint},
-    acceptor{Globalreg::globalreg->io} {
+    acceptor{Globalreg::globalreg->io},
+    n_connection_threads{0},
+    max_connections{0},
+    idle_timeout{30},
+    n_connections{0} {
 
     route_mutex.set_name("kis_net_beast_httpd route vector");
+    rebuild_routers();
+    body_limits = std::make_shared<std::unordered_map<std::string, size_t>>();
     auth_mutex.set_name("kis_net_beast_httpd auth");
 }
 
@@ -95,8 +105,11 @@ void kis_net_beast_httpd::trigger_deferred_startup() {
     register_mime_type("prettyjson", "application/json");
     register_mime_type("ekjson", "application/json");
     register_mime_type("itjson", "application/json");
+    register_mime_type("ndjson", "application/x-ndjson");
     register_mime_type("cmd", "application/json");
     register_mime_type("jcmd", "application/json");
+    register_mime_type("msgpack", "application/msgpack");
+    register_mime_type("dmsgpack", "application/msgpack");
     register_mime_type("xml", "application/xml");
     register_mime_type("png", "image/png");
     register_mime_type("jpg", "image/jpeg");
@@ -127,6 +140,16 @@ void kis_net_beast_httpd::trigger_deferred_startup() {
         register_mime_type(comps[0], comps[1]);
     }
 
+    n_connection_threads = 
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("httpd_connection_threads", 0);
+    if (n_connection_threads == 0)
+        n_connection_threads = std::max(2U, std::thread::hardware_concurrency());
+
+    max_connections = 
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("httpd_max_connections", 256);
+    idle_timeout = 
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("httpd_idle_timeout", 30);
+
     allow_auth_creation = Globalreg::globalreg->kismet_config->fetch_opt_bool("httpd_allow_auth_creation", true);
     allow_auth_view = Globalreg::globalreg->kismet_config->fetch_opt_bool("httpd_allow_auth_view", true);
 
@@ -194,6 +217,33 @@ void kis_net_beast_httpd::trigger_deferred_startup() {
         Globalreg::globalreg->kismet_config->fetch_opt_dfl("httpd_redirect_unknown", "");
     redirect_unknown_ = redirect_unknown_target_.length();
 
+    compression_level_ =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<int>("httpd_compression_level", 6);
+    if (compression_level_ < 0 || compression_level_ > 9) {
+        _MSG_ERROR("(HTTPD) Invalid httpd_compression_level {}, expected 0 to 9; using 6",
+                compression_level_);
+        compression_level_ = 6;
+    }
+
+    quota_mutex.set_name("kis_net_beast_httpd quota");
+
+    quota_rate =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<double>("httpd_quota_rate", 0);
+    quota_burst =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<double>("httpd_quota_burst", 0);
+    if (quota_burst <= 0)
+        quota_burst = quota_rate * 10;
+    else if (quota_burst < quota_rate)
+        quota_burst = quota_rate;
+    quota_expensive =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<uint64_t>("httpd_quota_expensive", 1000);
+    quota_wait_ms =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("httpd_quota_wait", 2000);
+
+    if (quota_rate > 0)
+        _MSG_INFO("(HTTPD) Limiting each client to {} request cost units per second, up to {} "
+                "banked", quota_rate, quota_burst);
+
     auto http_data_dir =
         Globalreg::globalreg->kismet_config->fetch_opt_path("httpd_home", "");
     if (http_data_dir == "") {
@@ -361,6 +411,41 @@ void kis_net_beast_httpd::trigger_deferred_startup() {
                 }, auth_mutex));
 
 
+    register_route("/system/http_quotas", {"GET"}, LOGON_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+
+                auto ret = std::make_shared<tracker_element_vector>();
+                auto now = std::chrono::steady_clock::now();
+
+                for (const auto& qi : quota_map) {
+                    refill_quota(*qi.second, now);
+
+                    // As with the auth list, a full tracked element isn't worth it here
+                    auto qmap = std::make_shared<tracker_element_string_map>();
+                    qmap->insert(std::make_pair("kismet.httpd.quota.client",
+                                std::make_shared<tracker_element_string>(qi.second->name)));
+                    qmap->insert(std::make_pair("kismet.httpd.quota.balance",
+                                std::make_shared<tracker_element_double>(0, qi.second->balance)));
+                    qmap->insert(std::make_pair("kismet.httpd.quota.last_seen",
+                                std::make_shared<tracker_element_uint64>(0, qi.second->last_seen)));
+                    qmap->insert(std::make_pair("kismet.httpd.quota.requests",
+                                std::make_shared<tracker_element_uint64>(0, qi.second->requests)));
+                    qmap->insert(std::make_pair("kismet.httpd.quota.charged",
+                                std::make_shared<tracker_element_uint64>(0, qi.second->charged)));
+                    qmap->insert(std::make_pair("kismet.httpd.quota.delayed",
+                                std::make_shared<tracker_element_uint64>(0, qi.second->delayed)));
+                    qmap->insert(std::make_pair("kismet.httpd.quota.rejected",
+                                std::make_shared<tracker_element_uint64>(0, qi.second->rejected)));
+
+                    ret->push_back(qmap);
+                }
+
+                return ret;
+
+                }, quota_mutex));
+
+
     // Test echo websocket
     register_websocket_route("/debug/echo", LOGON_ROLE, {"ws"},
             std::make_shared<kis_net_web_function_endpoint>(
@@ -427,6 +512,9 @@ int kis_net_beast_httpd::start_httpd() {
 
     running = true;
 
+    for (unsigned int i = 0; i < n_connection_threads; i++)
+        connection_threads.push_back(std::thread([this]() { connection_worker(); }));
+
     start_accept();
 
     return 1;
@@ -447,6 +535,17 @@ int kis_net_beast_httpd::stop_httpd() {
         }
     }
 
+    // Wake up and shut down the connection pool
+    for (size_t i = 0; i < connection_threads.size(); i++)
+        connection_queue.enqueue(nullptr);
+
+    for (auto& t : connection_threads) {
+        if (t.joinable())
+            t.join();
+    }
+
+    connection_threads.clear();
+
     return 1;
 }
 
@@ -466,39 +565,155 @@ void kis_net_beast_httpd::handle_connection(const boost::system::error_code& ec,
     if (!running)
         return;
 
-	// Spin each connection into its own thread
     if (!ec) {
-        std::thread conthread([this, tcp_socket = boost::beast::tcp_stream(std::move(socket))]() mutable {
-                thread_set_process_name("beast connection");
+        if (max_connections != 0 && n_connections >= max_connections) {
+            // Tell the client we're full without blocking the acceptor on a client which
+            // isn't reading
+            static const std::string busy = 
+                "HTTP/1.1 503 Service Unavailable\r\n"
+                "Server: Kismet\r\n"
+                "Connection: close\r\n"
+                "Content-Length: 0\r\n\r\n";
+
+            auto busy_sock = std::make_shared<boost::asio::ip::tcp::socket>(std::move(socket));
+
+            boost::asio::async_write(*busy_sock, boost::asio::buffer(busy),
+                    [busy_sock](const boost::system::error_code&, std::size_t) {
+                        boost::system::error_code w_ec;
+                        busy_sock->shutdown(boost::asio::ip::tcp::socket::shutdown_both, w_ec);
+                        busy_sock->close(w_ec);
+                    });
+        } else {
+            // New connections wait for their first request on the io reactor like idle
+            // keep-alive connections, so clients which connect and send nothing can't
+            // hold a pool thread
+            n_connections++;
+            idle_connection(std::make_shared<connection_slot>(std::move(socket)));
+        }
+    }
 
-                while (tcp_socket.socket().is_open()) {
-					// Reset the timeout every loop through; each request in this 
-					// socket pipeline has up to 30 seconds to complete
-					boost::beast::get_lowest_layer(tcp_socket).expires_after(std::chrono::seconds(30));
+    // Accept another connection
+    return start_accept();
+}
 
-                    // Associate the socket
-                    auto conn = 
-                        std::make_shared<kis_net_beast_httpd_connection>(tcp_socket, shared_from_this());
+void kis_net_beast_httpd::connection_worker() {
+    thread_set_process_name("beast connection");
 
-                    // Run the connection
-                    auto retain = conn->start();
+    while (true) {
+        std::shared_ptr<connection_slot> slot;
 
-                    if (retain == false)
-                        break;
-                }
+        connection_queue.wait_dequeue(slot);
 
-                try {
-                    tcp_socket.socket().shutdown(boost::asio::ip::tcp::socket::shutdown_send);
-                } catch (...) {
-                    ;
+        if (slot == nullptr || !running) {
+            if (slot != nullptr)
+                close_connection(slot);
+            return;
+        }
+
+        try {
+            serve_connection(slot);
+        } catch (const std::exception& e) {
+            close_connection(slot);
+        }
+    }
+}
+
+void kis_net_beast_httpd::serve_connection(std::shared_ptr<connection_slot> slot) {
+    if (!slot->stream.socket().is_open()) {
+        close_connection(slot);
+        return;
+    }
+
+    // Each request in this socket pipeline has up to 30 seconds to complete
+    boost::beast::get_lowest_layer(slot->stream).expires_after(std::chrono::seconds(30));
+
+    auto conn = 
+        std::make_shared<kis_net_beast_httpd_connection>(slot->stream, shared_from_this());
+    conn->slot_ = slot;
+
+    auto retain = conn->start();
+
+    // Websockets and streams complete the connection from their own thread
+    if (conn->handed_off())
+        return;
+
+    finish_connection(slot, retain);
+}
+
+void kis_net_beast_httpd::finish_connection(std::shared_ptr<connection_slot> slot, bool retain) {
+    if (slot == nullptr)
+        return;
+
+    if (retain && running && slot->stream.socket().is_open())
+        idle_connection(slot);
+    else
+        close_connection(slot);
+}
+
+void kis_net_beast_httpd::idle_connection(std::shared_ptr<connection_slot> slot) {
+    // The socket and timer share the connection strand, so the idle flag resolves any
+    // race between the timeout and the next request arriving
+    auto this_ref = shared_from_this();
+
+    boost::asio::post(slot->stream.get_executor(), [this, this_ref, slot]() {
+        // A pipelined request may already be waiting in the buffer
+        if (slot->buffer.size() > 0)
+            return read_request_header(slot);
+
+        slot->idle = true;
+
+        slot->idle_timer.expires_after(std::chrono::seconds(idle_timeout));
+        slot->idle_timer.async_wait([slot](const boost::system::error_code& ec) {
+                if (ec || !slot->idle)
+                    return;
+
+                boost::system::error_code c_ec;
+                slot->stream.socket().cancel(c_ec);
+            });
+
+        slot->stream.socket().async_wait(boost::asio::ip::tcp::socket::wait_read,
+                [this, this_ref, slot](const boost::system::error_code& ec) {
+                    slot->idle = false;
+                    slot->idle_timer.cancel();
+
+                    if (ec || !running) {
+                        close_connection(slot);
+                        return;
+                    }
+
+                    read_request_header(slot);
+                });
+        });
+}
+
+void kis_net_beast_httpd::read_request_header(std::shared_ptr<connection_slot> slot) {
+    // Slow clients trickle the header in on the io reactor; only complete headers take a
+    // pool thread to read the body and serve the request
+    auto this_ref = shared_from_this();
+
+    slot->parser.emplace();
+    slot->parser->body_limit(default_body_limit);
+
+    slot->stream.expires_after(std::chrono::seconds(30));
+
+    boost::beast::http::async_read_header(slot->stream, slot->buffer, *slot->parser,
+            [this, this_ref, slot](const boost::system::error_code& ec, std::size_t) {
+                if (ec || !running) {
+                    close_connection(slot);
+                    return;
                 }
+
+                connection_queue.enqueue(slot);
             });
+}
 
-        conthread.detach();
-    }
+void kis_net_beast_httpd::close_connection(std::shared_ptr<connection_slot> slot) {
+    boost::system::error_code ec;
 
-    // Accept another connection
-    return start_accept();
+    slot->stream.socket().shutdown(boost::asio::ip::tcp::socket::shutdown_send, ec);
+    slot->stream.socket().close(ec);
+
+    n_connections--;
 }
 
 std::string kis_net_beast_httpd::decode_uri(boost::beast::string_view in, bool query) {
@@ -682,6 +897,7 @@ void kis_net_beast_httpd::register_route(const std::string& route, const std::li
         b_verbs.emplace_back(boost::beast::http::string_to_verb(v));
 
     route_vec.emplace_back(std::make_shared<kis_net_beast_route>(route, b_verbs, true, roles, handler));
+    rebuild_routers();
 }
 
 void kis_net_beast_httpd::register_route(const std::string& route, 
@@ -708,6 +924,7 @@ void kis_net_beast_httpd::register_route(const std::string& route,
         b_verbs.emplace_back(boost::beast::http::string_to_verb(v));
 
     route_vec.emplace_back(std::make_shared<kis_net_beast_route>(route, b_verbs, true, roles, extensions, handler));
+    rebuild_routers();
 }
 
 void kis_net_beast_httpd::remove_route(const std::string& route) {
@@ -716,11 +933,46 @@ void kis_net_beast_httpd::remove_route(const std::string& route) {
     for (auto i = route_vec.begin(); i != route_vec.end(); ++i) {
         if ((*i)->route() == route) {
             route_vec.erase(i);
+            rebuild_routers();
             return;
         }
     }
 }
 
+void kis_net_beast_httpd::set_body_limit(const std::string& route, size_t limit) {
+    kis_lock_guard<kis_mutex> lk(route_mutex, "beast_httpd set_body_limit");
+
+    auto limits = std::make_shared<std::unordered_map<std::string, size_t>>(*body_limits);
+    (*limits)[route] = limit;
+    std::atomic_store(&body_limits, limits);
+}
+
+size_t kis_net_beast_httpd::body_limit(boost::beast::string_view target) {
+    auto limits = std::atomic_load(&body_limits);
+
+    if (limits->size() == 0)
+        return default_body_limit;
+
+    strip_uri_prefix(target);
+
+    auto q = target.find('?');
+    if (q != boost::beast::string_view::npos)
+        target = target.substr(0, q);
+
+    auto l = limits->find(static_cast<std::string>(target));
+
+    if (l == limits->end())
+        return default_body_limit;
+
+    return l->second;
+}
+
+void kis_net_beast_httpd::rebuild_routers() {
+    // Called with the route mutex held
+    std::atomic_store(&router, std::make_shared<kis_net_beast_router>(route_vec));
+    std::atomic_store(&websocket_router, std::make_shared<kis_net_beast_router>(websocket_route_vec));
+}
+
 void kis_net_beast_httpd::register_unauth_route(const std::string& route, 
         const std::list<std::string>& verbs,
         std::shared_ptr<kis_net_web_endpoint> handler) {
@@ -730,6 +982,7 @@ void kis_net_beast_httpd::register_unauth_route(const std::string& route,
         b_verbs.emplace_back(boost::beast::http::string_to_verb(v));
     route_vec.emplace_back(std::make_shared<kis_net_beast_route>(route, b_verbs, false, 
                 std::list<std::string>{""}, handler));
+    rebuild_routers();
 }
 
 void kis_net_beast_httpd::register_unauth_route(const std::string& route, 
@@ -742,6 +995,7 @@ void kis_net_beast_httpd::register_unauth_route(const std::string& route,
     route_vec.emplace_back(std::make_shared<kis_net_beast_route>(route, b_verbs, false, 
                 std::list<std::string>{""},
                 extensions, handler));
+    rebuild_routers();
 }
 
 void kis_net_beast_httpd::register_websocket_route(const std::string& route, 
@@ -757,6 +1011,7 @@ void kis_net_beast_httpd::register_websocket_route(const std::string& route,
 
     websocket_route_vec.emplace_back(std::make_shared<kis_net_beast_route>(route, 
                 std::list<boost::beast::http::verb>{}, true, roles, extensions, handler));
+    rebuild_routers();
 
 }
 
@@ -915,25 +1170,23 @@ void kis_net_beast_httpd::load_auth() {
 }
 
 std::shared_ptr<kis_net_beast_route> kis_net_beast_httpd::find_endpoint(std::shared_ptr<kis_net_beast_httpd_connection> con) {
-    kis_lock_guard<kis_mutex> lk(route_mutex, "beast_httpd find_endpoint");
+    auto r = std::atomic_load(&router);
 
-    for (const auto& r : route_vec) {
-        if (r->match_url(static_cast<const std::string>(con->uri()), con->uri_params_, con->http_variables_)) 
-            return r;
-    }
-
-    return nullptr;
+    return r->find(static_cast<const std::string>(con->uri()), con->uri_params_, con->http_variables_);
 }
 
 std::shared_ptr<kis_net_beast_route> kis_net_beast_httpd::find_websocket_endpoint(std::shared_ptr<kis_net_beast_httpd_connection> con) {
-    kis_lock_guard<kis_mutex> lk(route_mutex, "beast_httpd find_websocket_endpoint");
+    auto r = std::atomic_load(&websocket_router);
 
-    for (const auto& r : websocket_route_vec) {
-        if (r->match_url(static_cast<const std::string>(con->uri()), con->uri_params_, con->http_variables_))
-            return r;
-    }
+    return r->find(static_cast<const std::string>(con->uri()), con->uri_params_, con->http_variables_);
+}
 
-    return nullptr;
+bool kis_net_beast_httpd::compressible_type(const boost::beast::string_view& content_type) const {
+    // Binary content (pcap, images, fonts) doesn't compress usefully
+    return content_type.starts_with("text/") ||
+        content_type.find("json") != boost::beast::string_view::npos ||
+        content_type.find("javascript") != boost::beast::string_view::npos ||
+        content_type.find("xml") != boost::beast::string_view::npos;
 }
 
 void kis_net_beast_httpd::register_static_dir(const std::string& prefix, const std::string& path) {
@@ -1081,17 +1334,143 @@ void kis_net_beast_httpd::strip_uri_prefix(boost::beast::string_view& uri_view)
 
 
 
+void kis_net_beast_httpd::refill_quota(client_quota& quota, 
+        const std::chrono::steady_clock::time_point& now) {
+    auto elapsed = std::chrono::duration<double>(now - quota.last_refill).count();
+
+    if (elapsed <= 0)
+        return;
+
+    quota.balance = std::min(quota_burst, quota.balance + elapsed * quota_rate);
+    quota.last_refill = now;
+}
+
+unsigned int kis_net_beast_httpd::admit_request(std::shared_ptr<kis_net_beast_httpd_connection> con,
+        std::shared_ptr<kis_net_beast_route> route) {
+    if (quota_rate <= 0)
+        return 0;
+
+    // Sessions are charged by token; anything without a session is charged by address
+    std::string key, name;
+
+    auto auth = con->login_valid_ ? check_auth_token(con->auth_token_) : nullptr;
+
+    if (auth != nullptr) {
+        key = fmt::format("t:{}", con->auth_token_);
+        name = auth->name();
+    } else {
+        boost::system::error_code ec;
+        auto remote = con->stream_.socket().remote_endpoint(ec);
+
+        name = ec ? "unknown" : remote.address().to_string();
+        key = fmt::format("a:{}", name);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+
+    kis_unique_lock<kis_mutex> lk(quota_mutex, "httpd admit_request");
+
+    auto qi = quota_map.find(key);
+    std::shared_ptr<client_quota> quota;
+
+    if (qi == quota_map.end()) {
+        // Forget clients which have been gone for a while, so scanning clients can't grow
+        // the map without bound
+        if (quota_map.size() >= 1024) {
+            for (auto i = quota_map.begin(); i != quota_map.end(); ) {
+                if (i->second->last_seen < time(0) - 600 && !i->second->waiting)
+                    i = quota_map.erase(i);
+                else
+                    ++i;
+            }
+        }
+
+        quota = std::make_shared<client_quota>();
+        quota->name = name;
+        quota->balance = quota_burst;
+        quota->last_refill = now;
+        quota->requests = quota->charged = quota->delayed = quota->rejected = 0;
+        quota->waiting = false;
+
+        quota_map[key] = quota;
+    } else {
+        quota = qi->second;
+    }
+
+    con->quota_ = quota;
+
+    quota->last_seen = time(0);
+    quota->requests++;
+
+    refill_quota(*quota, now);
+
+    auto estimate = route->cost_estimate();
+
+    if (estimate < quota_expensive)
+        return 0;
+
+    auto needed = std::min(static_cast<double>(estimate), quota_burst);
+
+    if (quota->balance >= needed)
+        return 0;
+
+    auto wait_s = (needed - quota->balance) / quota_rate;
+
+    // Only one request per client waits for budget, so a client can't tie up the
+    // connection pool with queued requests
+    if (quota->waiting || wait_s * 1000 > quota_wait_ms) {
+        quota->rejected++;
+        return static_cast<unsigned int>(std::max(1.0, std::ceil(wait_s)));
+    }
+
+    quota->waiting = true;
+    quota->delayed++;
+
+    lk.unlock();
+    std::this_thread::sleep_for(std::chrono::duration<double>(wait_s));
+    lk.lock();
+
+    quota->waiting = false;
+
+    return 0;
+}
+
+void kis_net_beast_httpd::charge_request(std::shared_ptr<client_quota> quota,
+        std::shared_ptr<kis_net_beast_route> route, uint64_t cost) {
+    if (quota == nullptr)
+        return;
+
+    route->update_cost(cost);
+
+    kis_lock_guard<kis_mutex> lk(quota_mutex, "httpd charge_request");
+
+    refill_quota(*quota, std::chrono::steady_clock::now());
+
+    // Debt is capped at one burst, so one huge request can't lock a client out forever
+    quota->balance = std::max(-quota_burst, quota->balance - static_cast<double>(cost));
+    quota->charged += cost;
+}
+
 kis_net_beast_httpd_connection::kis_net_beast_httpd_connection(boost::beast::tcp_stream& socket,
         std::shared_ptr<kis_net_beast_httpd> httpd) :
     httpd{httpd},
     stream_{socket},
+    compress_response_{false},
+    not_modified_{false},
     login_valid_{false},
-    first_response_write{false} {
+    json_parsed_{false},
+    first_response_write{false},
+    handed_off_{false},
+    request_cost_{0} {
         Globalreg::n_tracked_http_connections++;
     }
 
 kis_net_beast_httpd_connection::~kis_net_beast_httpd_connection() {
     Globalreg::n_tracked_http_connections--;
+
+    if (compress_response_)
+        deflateEnd(&compress_stream_);
+
     if (closure_cb)
         closure_cb();
 }
@@ -1136,19 +1515,158 @@ void kis_net_beast_httpd_connection::append_header(const std::string& header, co
     response.set(header, value);
 }
 
+Json::Value& kis_net_beast_httpd_connection::json() {
+    if (json_parsed_)
+        return json_;
+
+    json_parsed_ = true;
+
+    if (json_body_.length() == 0)
+        return json_;
+
+    Json::CharReaderBuilder cbuilder;
+    cbuilder["collectComments"] = false;
+    std::unique_ptr<Json::CharReader> reader(cbuilder.newCharReader());
+    std::string errs;
+
+    if (!reader->parse(json_body_.data(), json_body_.data() + json_body_.length(), &json_, &errs))
+        json_ = Json::Value();
+
+    return json_;
+}
+
+bool kis_net_beast_httpd_connection::json_strings(const std::string& in_key,
+        const std::function<void (const std::string&)>& in_fn) {
+    nonstd::string_view value;
+
+    if (!json_scan::find_member(json_body_, in_key, value) || json_scan::is_null(value))
+        return false;
+
+    std::string str;
+
+    json_scan::for_each_element(value, [&](nonstd::string_view v) {
+            json_scan::as_string(v, str);
+            in_fn(str);
+            });
+
+    return true;
+}
+
+bool kis_net_beast_httpd_connection::json_bool_members(const std::string& in_key,
+        const std::function<void (const std::string&, bool)>& in_fn) {
+    nonstd::string_view value;
+
+    if (!json_scan::find_member(json_body_, in_key, value) || json_scan::is_null(value))
+        return false;
+
+    json_scan::for_each_member(value, [&](const std::string& k, nonstd::string_view v) {
+            in_fn(k, json_scan::as_bool(v));
+            });
+
+    return true;
+}
+
+bool kis_net_beast_httpd_connection::check_etag(uint64_t version) {
+    if (first_response_write)
+        throw std::runtime_error("tried to set an etag on a connection already in progress");
+
+    auto target = request_.target();
+    auto hash = XXH64(target.data(), target.length(), 0);
+    hash = XXH64(http_post.data(), http_post.length(), hash);
+
+    // Weak, since the same version may be sent with or without compression
+    auto etag = fmt::format("W/\"{:x}-{:x}\"", version, hash);
+    response.set(boost::beast::http::field::etag, etag);
+
+    auto inm_h = request_.find(boost::beast::http::field::if_none_match);
+    if (inm_h == request_.end())
+        return false;
+
+    auto tag_view = boost::beast::string_view(etag).substr(2);
+    auto inm = inm_h->value();
+
+    while (inm.length()) {
+        auto c = inm.find(',');
+        auto t = inm.substr(0, c);
+
+        inm = c == boost::beast::string_view::npos ? 
+            boost::beast::string_view() : inm.substr(c + 1);
+
+        while (t.length() && t.front() == ' ')
+            t.remove_prefix(1);
+        while (t.length() && t.back() == ' ')
+            t.remove_suffix(1);
+
+        if (t.starts_with("W/"))
+            t.remove_prefix(2);
+
+        if (t == "*" || t == tag_view) {
+            response.result(boost::beast::http::status::not_modified);
+            not_modified_ = true;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool kis_net_beast_httpd_connection::accepts_gzip() {
+    auto ae_h = request_.find(boost::beast::http::field::accept_encoding);
+    if (ae_h == request_.end())
+        return false;
+
+    auto ae = ae_h->value();
+
+    while (ae.length()) {
+        auto c = ae.find(',');
+        auto t = ae.substr(0, c);
+
+        ae = c == boost::beast::string_view::npos ? 
+            boost::beast::string_view() : ae.substr(c + 1);
+
+        auto p = t.find(';');
+        auto coding = t.substr(0, p);
+
+        while (coding.length() && coding.front() == ' ')
+            coding.remove_prefix(1);
+        while (coding.length() && coding.back() == ' ')
+            coding.remove_suffix(1);
+
+        if (!boost::beast::iequals(coding, "gzip"))
+            continue;
+
+        // Explicitly refused with a zero quality
+        if (p != boost::beast::string_view::npos) {
+            auto q = t.substr(p + 1);
+
+            while (q.length() && q.front() == ' ')
+                q.remove_prefix(1);
+
+            if (q.starts_with("q=0") && q.find_first_not_of("0.", 3) == boost::beast::string_view::npos)
+                return false;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
 bool kis_net_beast_httpd_connection::start() {
-    parser_.emplace();
-    parser_->body_limit(100000);
+    // The header has already been read into the slot parser; the body limit depends on
+    // the target
+    auto& parser = *slot_->parser;
 
     try {
-        boost::beast::http::read(stream_, buffer, *parser_);
+        parser.body_limit(httpd->body_limit(parser.get().target()));
+        boost::beast::http::read(stream_, slot_->buffer, parser);
     } catch (const boost::system::system_error& e) {
         // Silently catch and fail on any error from the transport layer, because we don't
         // care; we can't deal with a broken client spamming us
         return do_close();
     }
 
-    request_ = boost::beast::http::request<boost::beast::http::string_body>(parser_->release());
+    request_ = boost::beast::http::request<boost::beast::http::string_body>(parser.release());
 
     uri_ = request_.target();
     verb_ = request_.method();
@@ -1327,9 +1845,26 @@ bool kis_net_beast_httpd_connection::start() {
 
         boost::beast::get_lowest_layer(stream_).expires_never();
 
-        route->invoke(shared_from_this());
+        // Websockets live for the duration of the session; get them off the connection
+        // pool and let them own a thread
+        handed_off_ = true;
 
-        return do_close();
+        std::thread wst([this, route, self = shared_from_this()]() {
+                thread_set_process_name("beast websocket");
+
+                try {
+                    route->invoke(self);
+                } catch (const std::exception& e) {
+                    ;
+                }
+
+                do_close();
+
+                httpd->finish_connection(slot_, false);
+            });
+        wst.detach();
+
+        return false;
     }
 
     // Look for a route
@@ -1424,6 +1959,30 @@ bool kis_net_beast_httpd_connection::start() {
         return true;
     }
 
+    auto retry_after = httpd->admit_request(shared_from_this(), route);
+
+    if (retry_after > 0) {
+        boost::beast::http::response<boost::beast::http::string_body> 
+            res{boost::beast::http::status::too_many_requests, request_.version()};
+
+        res.set(boost::beast::http::field::server, "Kismet");
+        res.set(boost::beast::http::field::content_type, "text/html");
+        res.set(boost::beast::http::field::retry_after, fmt::format("{}", retry_after));
+        res.body() = std::string("<html><head><title>429 Too many requests</title></head><body>"
+                "<h1>429 Too many requests</h1><br><p>This client has used its request budget; "
+                "try again later.</p></body></html>\n");
+        res.prepare_payload();
+
+        boost::system::error_code error;
+
+        boost::beast::http::write(stream_, res, error);
+
+        if (error || client_req_close) 
+            return do_close();
+
+        return true;
+    }
+
     append_common_headers(response, uri_);
 
     if (request_.method() == boost::beast::http::verb::post) {
@@ -1438,63 +1997,168 @@ bool kis_net_beast_httpd_connection::start() {
             httpd->decode_variables(decoded_body, http_variables_);
 
             auto j_k = http_variables_.find("json");
-            if (j_k != http_variables_.end()) {
-                try {
-                    std::stringstream ss(j_k->second);
-                    ss >> json_;
-                } catch (std::exception& e) {
-                    ;
-                }
-            }
+            if (j_k != http_variables_.end())
+                json_body_ = nonstd::string_view(j_k->second.data(), j_k->second.length());
         } else if (boost::beast::iequals(content_type, "application/json") ||
                 boost::beast::iequals(content_type, "application/json; charset=UTF-8")) {
-            Json::CharReaderBuilder cbuilder;
-            cbuilder["collectComments"] = false;
-            auto reader = cbuilder.newCharReader();
-            std::string errs;
-
-            reader->parse(http_post.data(), http_post.data() + http_post.length(), &json_, &errs);
+            json_body_ = nonstd::string_view(http_post.data(), http_post.length());
         }
+
+        // The body is only parsed when an endpoint asks for it
     }
 
     response.result(boost::beast::http::status::ok);
     response.set(boost::beast::http::field::transfer_encoding, "chunked");
 
-    // Create the chunked response serializer
-    boost::beast::http::response_serializer<boost::beast::http::buffer_body,
-        boost::beast::http::fields> sr{response};
+    if (httpd->compression_level() > 0 &&
+            httpd->compressible_type(response[boost::beast::http::field::content_type])) {
+        response.set(boost::beast::http::field::vary, "Accept-Encoding");
 
+        if (accepts_gzip()) {
+            memset(&compress_stream_, 0, sizeof(compress_stream_));
 
-    // Spawn the generator thread
-    auto generator_launched = std::promise<void>();
-    auto generator_ft = generator_launched.get_future();
+            // 16 + window bits for a gzip wrapper
+            if (deflateInit2(&compress_stream_, httpd->compression_level(), Z_DEFLATED,
+                        15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+                compress_response_ = true;
+                response.set(boost::beast::http::field::content_encoding, "gzip");
+            }
+        }
+    }
 
-    std::thread tr([this, route, generator_launched = std::move(generator_launched),
-            self = shared_from_this()]() mutable {
-        thread_set_process_name("beast generator");
+    // Serializing tracked elements completes without waiting on anything else, so
+    // generate and write them directly from the connection pool
+    if (!route->long_running()) {
+        run_generator(route);
+        return write_response(client_req_close);
+    }
 
-        generator_launched.set_value();
+    // Everything else may stream indefinitely; spawn the generator and stream the
+    // response from a dedicated thread so we don't pin the connection pool
+    handed_off_ = true;
 
-        try {
-            route->invoke(self);
-        } catch (const std::exception& e) {
-            try {
-                set_status(500);
-            } catch (...) {
-                ;
-            }
+    std::thread st([this, route, client_req_close, self = shared_from_this()]() {
+        thread_set_process_name("beast stream");
 
-            std::ostream os(&response_stream_);
-            os << "ERROR: " << e.what();
-        }
+        auto generator_launched = std::promise<void>();
+        auto generator_ft = generator_launched.get_future();
+
+        std::thread tr([this, route, generator_launched = std::move(generator_launched),
+                self]() mutable {
+            thread_set_process_name("beast generator");
 
-        response_stream_.complete();
+            generator_launched.set_value();
+
+            run_generator(route);
+        });
+        tr.detach();
+
+        generator_ft.wait();
+
+        httpd->finish_connection(slot_, write_response(client_req_close));
     });
-    tr.detach();
+    st.detach();
+
+    return true;
+}
+
+void kis_net_beast_httpd_connection::run_generator(std::shared_ptr<kis_net_beast_route> route) {
+    try {
+        route->invoke(shared_from_this());
+    } catch (const std::exception& e) {
+        try {
+            set_status(500);
+        } catch (...) {
+            ;
+        }
+
+        std::ostream os(&response_stream_);
+        os << "ERROR: " << e.what();
+    }
+
+    httpd->charge_request(quota_, route, request_cost_ + 1);
+
+    response_stream_.complete();
+}
+
+bool kis_net_beast_httpd_connection::write_compressed(const std::vector<boost::asio::const_buffer>& buffers,
+        int flush, boost::system::error_code& error) {
+    size_t out_len = 0;
+
+    auto run_deflate = [&](int run_flush) -> int {
+        int r;
 
-    generator_ft.wait();
+        do {
+            if (compress_buf_.size() - out_len < 4096)
+                compress_buf_.resize(compress_buf_.size() + max_write_gather);
 
+            compress_stream_.next_out = compress_buf_.data() + out_len;
+            compress_stream_.avail_out = compress_buf_.size() - out_len;
+
+            r = deflate(&compress_stream_, run_flush);
+
+            out_len = compress_buf_.size() - compress_stream_.avail_out;
+        } while (r == Z_OK && (compress_stream_.avail_in > 0 || compress_stream_.avail_out == 0));
+
+        return r;
+    };
+
+    for (const auto& b : buffers) {
+        compress_stream_.next_in = (Bytef *) b.data();
+        compress_stream_.avail_in = b.size();
+
+        if (run_deflate(Z_NO_FLUSH) == Z_STREAM_ERROR)
+            return false;
+    }
+
+    compress_stream_.next_in = nullptr;
+    compress_stream_.avail_in = 0;
+
+    if (run_deflate(flush) == Z_STREAM_ERROR)
+        return false;
+
+    if (out_len)
+        boost::asio::write(stream_, 
+                boost::beast::http::make_chunk(boost::asio::const_buffer(compress_buf_.data(), out_len)),
+                error);
+
+    return true;
+}
+
+bool kis_net_beast_httpd_connection::write_response(bool client_req_close) {
     boost::system::error_code error;
+
+    if (not_modified_) {
+        // Anything the endpoint did generate is discarded; a 304 has no body
+        while (response_stream_.size() || response_stream_.running()) {
+            response_stream_.consume(response_stream_.size());
+            response_stream_.wait();
+        }
+
+        first_response_write = true;
+
+        response.erase(boost::beast::http::field::transfer_encoding);
+        response.erase(boost::beast::http::field::content_encoding);
+
+        response.body().data = nullptr;
+        response.body().size = 0;
+        response.body().more = false;
+
+        boost::beast::http::response_serializer<boost::beast::http::buffer_body,
+            boost::beast::http::fields> nm_sr{response};
+
+        boost::beast::http::write(stream_, nm_sr, error);
+
+        if (error || client_req_close)
+            return do_close();
+
+        return true;
+    }
+
+    // Create the chunked response serializer
+    boost::beast::http::response_serializer<boost::beast::http::buffer_body,
+        boost::beast::http::fields> sr{response};
+
     while (response_stream_.size() || response_stream_.running()) {
         auto sz = response_stream_.size();
 
@@ -1512,24 +2176,26 @@ bool kis_net_beast_httpd_connection::start() {
             // we no longer accept header modifiers
             first_response_write = true;
 
-            char *body_data;
-            auto chunk_sz = response_stream_.get(&body_data);
+            // Write everything buffered so far as a single http chunk, gathered directly
+            // from the stream buffer chunks
+            auto chunk_sz = response_stream_.get_buffers(write_buffers, max_write_gather);
 
-            response.body().data = (void *) body_data;
-            response.body().size = chunk_sz;
-            response.body().more = true;
-
-            boost::beast::http::write(stream_, sr, error);
+            if (compress_response_) {
+                if (!write_compressed(write_buffers, Z_SYNC_FLUSH, error)) {
+                    write_buffers.clear();
+                    response_stream_.cancel();
+                    return do_close();
+                }
+            } else {
+                boost::asio::write(stream_, boost::beast::http::make_chunk(write_buffers), error);
+            }
 
+            write_buffers.clear();
             response_stream_.consume(chunk_sz);
 
             // _MSG_INFO("(DEBUG) {} {} - Consumed {}/{} running {}", verb_, uri_, sz, response_stream_.size(), response_stream_.running());
 
-            if (error == boost::beast::http::error::need_buffer) {
-                // Beast returns 'need_buffer' when it's completed writing a buffer, configure
-                // as a non-error
-                error = {};
-            } else if (error) {
+            if (error) {
                 // _MSG_INFO("(DEBUG) {} {} - chunk write error {}", verb_, uri_, error.message());
                 response_stream_.cancel();
                 return do_close();
@@ -1545,11 +2211,23 @@ bool kis_net_beast_httpd_connection::start() {
     // _MSG_INFO("(DEBUG) {} {} - Out of buffer poll loop, remaining {}, running {}", verb_, uri_, response_stream_.size(), response_stream_.running());
 
     // Send the completion record for the chunked response
-    response.body().data = nullptr;
-    response.body().size = 0;
-    response.body().more = false;
+    if (!first_response_write) {
+        first_response_write = true;
 
-    boost::beast::http::write(stream_, sr, error);
+        boost::beast::http::write_header(stream_, sr, error);
+
+        if (error)
+            return do_close();
+    }
+
+    if (compress_response_) {
+        write_buffers.clear();
+
+        if (!write_compressed(write_buffers, Z_FINISH, error) || error)
+            return do_close();
+    }
+
+    boost::asio::write(stream_, boost::beast::http::make_chunk_last(), error);
 
     if (error) {
         // _MSG_INFO("(DEBUG) {} {} - Error writing conclusion of stream: {}", verb_, uri_, error.message());
@@ -1586,7 +2264,8 @@ kis_net_beast_route::kis_net_beast_route(const std::string& route,
     verbs_{verbs},
     login_{login},
     roles_{roles},
-    match_types{false} {
+    match_types{false},
+    cost_estimate_{0} {
 
     // Generate the keys list
     for (auto i = std::sregex_token_iterator(route.begin(), route.end(), path_re); 
@@ -1600,6 +2279,8 @@ kis_net_beast_route::kis_net_beast_route(const std::string& route,
     auto ext_str = std::regex_replace(route, path_re, path_capture_pattern);
     // Match the RE + http variables
     match_re = std::regex(fmt::format("^{}(\\?.*?)?$", ext_str));
+
+    compile_static();
 }
 
 kis_net_beast_route::kis_net_beast_route(const std::string& route, 
@@ -1611,7 +2292,8 @@ kis_net_beast_route::kis_net_beast_route(const std::string& route,
     verbs_{verbs},
     login_{login},
     roles_{roles},
-    match_types{true} {
+    match_types{true},
+    cost_estimate_{0} {
 
     // Generate the keys list
     for (auto i = std::sregex_token_iterator(route.begin(), route.end(), path_re); 
@@ -1644,6 +2326,181 @@ kis_net_beast_route::kis_net_beast_route(const std::string& route,
 
     // Match the RE + filetypes + http variables
     match_re = std::regex(fmt::format("^{}{}(\\?.*?)?$", ext_str, ft_regex));
+
+    extensions_ = std::vector<std::string>(extensions.begin(), extensions.end());
+
+    compile_static();
+}
+
+void kis_net_beast_route::compile_static() {
+    trace_name_ = kis_tracer::intern(route_);
+
+    // The literal part of the route ends at the first key, or at anything the
+    // route regex would treat specially
+    auto lit_end = route_.find_first_of(":.[]()*+?^$|{}\\");
+
+    static_prefix_ = route_.substr(0, lit_end);
+    static_route_ = lit_end == std::string::npos;
+}
+
+bool kis_net_beast_route::match_static(const boost::beast::string_view& path, 
+        const boost::beast::string_view& query,
+        kis_net_beast_httpd_connection::uri_param_t& uri_params, bool& matched) {
+
+    if (!static_route_)
+        return false;
+
+    matched = false;
+
+    if (path.substr(0, static_prefix_.length()) != static_prefix_)
+        return true;
+
+    if (match_types) {
+        if (path.length() < static_prefix_.length() + 2 || path[static_prefix_.length()] != '.')
+            return true;
+
+        auto ext = path.substr(static_prefix_.length() + 1);
+
+        if (extensions_.size() == 0) {
+            for (const auto& c : ext) {
+                if (!((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')))
+                    return true;
+            }
+        } else {
+            bool valid_ext = false;
+
+            for (const auto& e : extensions_) {
+                if (ext == e) {
+                    valid_ext = true;
+                    break;
+                }
+            }
+
+            if (!valid_ext)
+                return true;
+        }
+
+        uri_params.emplace(std::make_pair("FILETYPE", static_cast<std::string>(ext)));
+    } else if (path.length() != static_prefix_.length()) {
+        return true;
+    }
+
+    uri_params.emplace(std::make_pair("GETVARS", static_cast<std::string>(query)));
+    matched = true;
+
+    return true;
+}
+
+kis_net_beast_router::kis_net_beast_router(const std::vector<std::shared_ptr<kis_net_beast_route>>& routes) :
+    routes_{routes} {
+
+    for (size_t i = 0; i < routes_.size(); i++)
+        insert(routes_[i]->static_prefix(), i);
+}
+
+void kis_net_beast_router::insert(const std::string& prefix, size_t index) {
+    auto node = &root_;
+    size_t pos = 0;
+
+    while (pos < prefix.length()) {
+        trie_node *next = nullptr;
+
+        for (const auto& c : node->children) {
+            if (c->edge[0] == prefix[pos]) {
+                next = c.get();
+                break;
+            }
+        }
+
+        if (next == nullptr) {
+            auto leaf = std::make_unique<trie_node>();
+            leaf->edge = prefix.substr(pos);
+            leaf->routes.push_back(index);
+            node->children.push_back(std::move(leaf));
+            return;
+        }
+
+        // Length of the common part of the edge and the rest of the prefix
+        size_t common = 0;
+        while (common < next->edge.length() && pos + common < prefix.length() &&
+                next->edge[common] == prefix[pos + common])
+            common++;
+
+        if (common < next->edge.length()) {
+            // Split the edge, the existing node keeps the shared part
+            auto tail = std::make_unique<trie_node>();
+            tail->edge = next->edge.substr(common);
+            tail->children = std::move(next->children);
+            tail->routes = std::move(next->routes);
+
+            next->edge.resize(common);
+            next->children.clear();
+            next->routes.clear();
+            next->children.push_back(std::move(tail));
+        }
+
+        node = next;
+        pos += common;
+    }
+
+    node->routes.push_back(index);
+}
+
+std::shared_ptr<kis_net_beast_route> kis_net_beast_router::find(const std::string& url,
+        kis_net_beast_httpd_connection::uri_param_t& uri_params,
+        kis_net_beast_httpd::http_var_map_t& uri_variables) const {
+
+    auto url_view = boost::beast::string_view(url);
+    auto qpos = url_view.find('?');
+    auto path = url_view.substr(0, qpos);
+    auto query = qpos == boost::beast::string_view::npos ? 
+        boost::beast::string_view() : url_view.substr(qpos);
+
+    // Collect every route whose static prefix is a prefix of the path
+    thread_local std::vector<size_t> candidates;
+    candidates.clear();
+
+    auto node = &root_;
+    size_t pos = 0;
+
+    while (node != nullptr) {
+        candidates.insert(candidates.end(), node->routes.begin(), node->routes.end());
+
+        const trie_node *next = nullptr;
+
+        if (pos < path.length()) {
+            for (const auto& c : node->children) {
+                if (c->edge[0] == path[pos]) {
+                    if (path.substr(pos, c->edge.length()) == c->edge)
+                        next = c.get();
+                    break;
+                }
+            }
+        }
+
+        if (next != nullptr)
+            pos += next->edge.length();
+
+        node = next;
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+
+    for (const auto& i : candidates) {
+        const auto& r = routes_[i];
+        bool matched;
+
+        if (r->match_static(path, query, uri_params, matched)) {
+            if (matched)
+                return r;
+            continue;
+        }
+
+        if (r->match_url(url, uri_params, uri_variables))
+            return r;
+    }
+
+    return nullptr;
 }
 
 bool kis_net_beast_route::match_url(const std::string& url, 
@@ -1716,9 +2573,23 @@ bool kis_net_beast_route::match_role(bool login, const std::string& role) {
 }
 
 void kis_net_beast_route::invoke(std::shared_ptr<kis_net_beast_httpd_connection> connection) {
+    kis_trace_span span("httpd", trace_name_);
+
     handler->handle_request(connection);
 }
 
+void kis_net_beast_route::update_cost(uint64_t cost) {
+    // Concurrent requests may lose an update, which only nudges the estimate
+    auto est = cost_estimate_.load(std::memory_order_relaxed);
+
+    if (est == 0)
+        est = cost;
+    else
+        est = (est * 7 + cost) / 8;
+
+    cost_estimate_.store(est, std::memory_order_relaxed);
+}
+
 
 kis_net_beast_auth::kis_net_beast_auth(const Json::Value& json)  {
     try {
@@ -1780,6 +2651,9 @@ void kis_net_web_tracked_endpoint::handle_request(std::shared_ptr<kis_net_beast_
             return;
         }
 
+        if (etag_func != nullptr && con->check_etag(etag_func()))
+            return;
+
         if (generator != nullptr)
             output_content = generator(con);
         else
@@ -1809,6 +2683,64 @@ void kis_net_web_tracked_endpoint::handle_request(std::shared_ptr<kis_net_beast_
     }
 }
 
+void kis_net_web_streamed_endpoint::handle_request(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    std::ostream os(&con->response_stream());
+
+    auto serializer = 
+        Globalreg::globalreg->entrytracker->get_serializer(static_cast<std::string>(con->uri()));
+
+    if (serializer == nullptr) {
+        con->set_status(500);
+        os << "Invalid request:  Unsupported serialization type\n";
+        return;
+    }
+
+    try {
+        auto plan = 
+            tracker_element_summary_plan::from_json(con->json().get("fields", Json::Value(Json::arrayValue)));
+
+        bool first = true;
+
+        serializer->stream_vector_start(os);
+
+        generator(con, [&](std::shared_ptr<tracker_element> elem) -> bool {
+            if (!con->response_stream().running())
+                return false;
+
+            {
+                kis_unique_lock<kis_mutex> lk(mutex, std::defer_lock, "streamed endpoint");
+
+                if (use_mutex)
+                    lk.lock();
+
+                // Unchanged devices are spliced in from the fragment cache
+                Globalreg::globalreg->entrytracker->stream_vector_item(serializer, os, elem,
+                        plan, first);
+            }
+
+            first = false;
+
+            os.flush();
+
+            con->response_stream().wait_write_below(max_backlog);
+
+            return con->response_stream().running();
+        });
+
+        serializer->stream_vector_end(os);
+
+        os.flush();
+    } catch (const std::exception& e) {
+        try {
+            con->set_status(500);
+        } catch (const std::exception& e) {
+            ;
+        }
+
+        os << "ERROR: " << e.what() << "\n";
+    }
+}
+
 void kis_net_web_function_endpoint::handle_request(std::shared_ptr<kis_net_beast_httpd_connection> con) {
     kis_unique_lock<kis_mutex> lk(mutex, std::defer_lock, "function endpoint");
 
@@ -1910,13 +2842,13 @@ void kis_net_web_websocket_endpoint::handle_read(boost::beast::error_code ec, st
     }
 }
 
-void kis_net_web_websocket_endpoint::on_write(const std::string& msg) {
+void kis_net_web_websocket_endpoint::on_write(ws_buffer_t msg) {
     if (!running || !ws_.is_open())
         return;
 
     ws_write_queue_.push(msg);
 
-    // _MSG_DEBUG("ws {} write len {} queue {}", fmt::ptr(this), msg.size(), ws_write_queue_.size());
+    // _MSG_DEBUG("ws {} write len {} queue {}", fmt::ptr(this), msg->size(), ws_write_queue_.size());
 
     if (ws_write_queue_.size() > 1)
         return;
@@ -1932,7 +2864,7 @@ void kis_net_web_websocket_endpoint::handle_write() {
         return;
     }
 
-    ws_.async_write(boost::asio::buffer(ws_write_queue_.front()),
+    ws_.async_write(boost::asio::buffer(*ws_write_queue_.front()),
             boost::asio::bind_executor(
                 strand_,
                 std::bind(
@@ -1969,6 +2901,9 @@ void kis_net_web_websocket_endpoint::handle_request(std::shared_ptr<kis_net_beas
 
     running = true;
 
+    if (open_cb != nullptr)
+        open_cb(shared_from_this());
+
     auto running_future = running_promise.get_future();
 
     // Launch an async read loop
@@ -22,11 +22,16 @@
 #include "config.h"
 
 #include <atomic>
+#include <chrono>
 #include <list>
+#include <memory>
 #include <regex>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <vector>
+
+#include <zlib.h>
 
 #include "boost/asio.hpp"
 #include "boost/beast.hpp"
@@ -36,12 +41,16 @@
 #include "future_chainbuf.h"
 #include "globalregistry.h"
 #include "json/json.h"
+#include "kis_json_scan.h"
 #include "kis_mutex.h"
 #include "messagebus.h"
 #include "trackedelement.h"
 
+#include "moodycamel/blockingconcurrentqueue.h"
+
 class kis_net_beast_httpd_connection;
 class kis_net_beast_route;
+class kis_net_beast_router;
 class kis_net_beast_auth;
 class kis_net_web_endpoint;
 
@@ -102,6 +111,12 @@ public:
             std::shared_ptr<kis_net_web_endpoint> handler);
     void remove_route(const std::string& route);
 
+    // Request bodies are limited to default_body_limit bytes; endpoints which accept bulk
+    // uploads may raise the limit for their exact path
+    static constexpr size_t default_body_limit = 100000;
+    void set_body_limit(const std::string& route, size_t limit);
+    size_t body_limit(boost::beast::string_view target);
+
     // These routes do NOT require authentication; this is of course very dangerous and should
     // be limited to those endpoints used for logging in, etc
     void register_unauth_route(const std::string& route, const std::list<std::string>& verbs, 
@@ -158,10 +173,71 @@ public:
         return redirect_unknown_;
     }
 
+    // Gzip level for text responses, 0 if compression is disabled
+    int compression_level() const { return compression_level_; }
+
+    // Are responses of this content type worth compressing
+    bool compressible_type(const boost::beast::string_view& content_type) const;
+
     const std::string& redirect_unknown_target() const {
         return redirect_unknown_target_;
     }
 
+    // Accepted sockets; a connection is served one request at a time by the connection
+    // thread pool.  While waiting for a request, and while reading its header, it stays
+    // on the io reactor instead of holding a thread
+    struct connection_slot {
+        connection_slot(boost::asio::ip::tcp::socket&& socket) :
+            stream{std::move(socket)},
+            idle_timer{stream.get_executor()},
+            idle{false} { }
+
+        boost::beast::tcp_stream stream;
+        boost::asio::steady_timer idle_timer;
+        bool idle;
+
+        // Read buffer, kept across keep-alive requests, and the parser holding the header
+        // of the request about to be served
+        boost::beast::flat_buffer buffer;
+        boost::optional<boost::beast::http::request_parser<boost::beast::http::string_body>> parser;
+    };
+
+    // Complete a request on a connection; retained connections go back to waiting for
+    // the next request, otherwise the connection is closed
+    void finish_connection(std::shared_ptr<connection_slot> slot, bool retain);
+
+    // Per-client request quotas.  Each client, by session token or by address when it has
+    // no session, earns httpd_quota_rate cost units per second, banked up to 
+    // httpd_quota_burst.  A request costs one unit plus whatever work the endpoint charged
+    // with add_cost, such as the devices examined by each view filter.  Requests to routes
+    // which cost at least httpd_quota_expensive on average must be covered by the budget;
+    // they wait up to httpd_quota_wait milliseconds for it to refill, and are otherwise
+    // refused with a 429.
+    struct client_quota {
+        std::string name;
+
+        double balance;
+        std::chrono::steady_clock::time_point last_refill;
+        time_t last_seen;
+
+        uint64_t requests;
+        uint64_t charged;
+        uint64_t delayed;
+        uint64_t rejected;
+
+        // A request from this client is already waiting for budget
+        bool waiting;
+    };
+
+    // Admit a request to a route; returns 0 when admitted, possibly after waiting, otherwise
+    // the number of seconds the client should wait before retrying
+    unsigned int admit_request(std::shared_ptr<kis_net_beast_httpd_connection> con,
+            std::shared_ptr<kis_net_beast_route> route);
+
+    // Charge a completed request to the client and the route cost estimate
+    void charge_request(std::shared_ptr<client_quota> quota, 
+            std::shared_ptr<kis_net_beast_route> route, uint64_t cost);
+
 protected:
     std::atomic<bool> running;
     unsigned int port;
@@ -171,9 +247,18 @@ protected:
 
     std::unordered_map<std::string, std::string> mime_map;
 
+    // Routes are modified under the route mutex, which then publishes a new compiled
+    // router; lookups only load the current router
     kis_mutex route_mutex;
     std::vector<std::shared_ptr<kis_net_beast_route>> route_vec;
     std::vector<std::shared_ptr<kis_net_beast_route>> websocket_route_vec;
+    std::shared_ptr<kis_net_beast_router> router;
+    std::shared_ptr<kis_net_beast_router> websocket_router;
+
+    void rebuild_routers();
+
+    // Raised body limits by path, replaced under the route mutex like the routers
+    std::shared_ptr<std::unordered_map<std::string, size_t>> body_limits;
 
     kis_mutex auth_mutex;
     std::vector<std::shared_ptr<kis_net_beast_auth>> auth_vec;
@@ -197,6 +282,24 @@ protected:
     void start_accept();
     void handle_connection(const boost::system::error_code& ec, boost::asio::ip::tcp::socket socket);
 
+    // Connection pool thread
+    void connection_worker();
+    // Serve one request from a connection
+    void serve_connection(std::shared_ptr<connection_slot> slot);
+    // Wait for the next request on a new or keep-alive connection
+    void idle_connection(std::shared_ptr<connection_slot> slot);
+    // Read the request header asynchronously, then queue the connection for the pool
+    void read_request_header(std::shared_ptr<connection_slot> slot);
+    void close_connection(std::shared_ptr<connection_slot> slot);
+
+    moodycamel::BlockingConcurrentQueue<std::shared_ptr<connection_slot>> connection_queue;
+    std::vector<std::thread> connection_threads;
+
+    unsigned int n_connection_threads;
+    unsigned int max_connections;
+    unsigned int idle_timeout;
+    std::atomic<unsigned int> n_connections;
+
     bool use_ssl;
     bool serve_files;
 
@@ -208,6 +311,18 @@ protected:
     bool redirect_unknown_;
     std::string redirect_unknown_target_;
 
+    int compression_level_;
+
+    double quota_rate;
+    double quota_burst;
+    uint64_t quota_expensive;
+    unsigned int quota_wait_ms;
+
+    kis_mutex quota_mutex;
+    std::unordered_map<std::string, std::shared_ptr<client_quota>> quota_map;
+
+    void refill_quota(client_quota& quota, const std::chrono::steady_clock::time_point& now);
+
     // Yes, these are stored in ram.  yes, I'm ok with this.
     std::string admin_username, admin_password;
     bool global_login_config;
@@ -232,8 +347,13 @@ public:
 
     using uri_param_t = std::unordered_map<std::string, std::string>;
 
+    // Process a request; returns true if the connection should be kept open for another
+    // request.  Websockets and long-running generators are handed off to their own
+    // thread, which completes the connection when it finishes.
     bool start();
 
+    bool handed_off() const { return handed_off_; }
+
     boost::beast::http::request<boost::beast::http::string_body>& request() { return request_; }
     boost::beast::http::verb& verb() { return verb_; }
 
@@ -260,6 +380,12 @@ public:
     void clear_timeout();
     void append_header(const std::string& header, const std::string& value);
 
+    // Tag the response with an ETag for a version of the content; the tag also covers the
+    // request target and body, since they select what is generated from the content.
+    // Returns true if the client already has this version, in which case the response is
+    // a 304 and the endpoint should not generate anything.
+    bool check_etag(uint64_t version);
+
     const boost::beast::http::verb& verb() const { return verb_; }
     const boost::beast::string_view& uri() const { return uri_; }
 
@@ -267,7 +393,23 @@ public:
     uri_param_t& uri_params() { return uri_params_; }
     kis_net_beast_httpd::http_var_map_t& http_variables() { return http_variables_; }
     kis_net_beast_httpd::http_cookie_map_t& cookies() { return cookies_; }
-    Json::Value& json() { return json_; }
+
+    // JSON of a POST body, parsed into a document the first time it's used
+    Json::Value& json();
+
+    // Read top-level fields of the POST JSON without a document.  The string functions call
+    // in_fn with each string in an array field, and the boolean functions with each key and
+    // value of an object field.  They return false when the field is missing or null, and
+    // throw when the body is malformed or the field is the wrong shape.
+    bool json_strings(const std::string& in_key, const std::function<void (const std::string&)>& in_fn);
+    bool json_bool_members(const std::string& in_key,
+            const std::function<void (const std::string&, bool)>& in_fn);
+
+    // Charge work done for this request to the client quota, in cost units; view endpoints
+    // charge one unit for each device a filter examines
+    void add_cost(uint64_t units) {
+        request_cost_ += units;
+    }
 
     // Optional closure callback to signal to an async operation that there's a problem (for example
     // long-running packet streams)
@@ -285,14 +427,25 @@ protected:
     std::function<void ()> closure_cb;
 
     boost::beast::tcp_stream& stream_;
-    boost::beast::flat_buffer buffer;
 
-    boost::optional<boost::beast::http::request_parser<boost::beast::http::string_body>> parser_;
     boost::beast::http::request<boost::beast::http::string_body> request_;
 
     boost::beast::http::response<boost::beast::http::buffer_body> response;
     future_chainbuf response_stream_;
 
+    // Gathered views of the response stream, written as one chunk per write
+    static constexpr size_t max_write_gather = 65536;
+    std::vector<boost::asio::const_buffer> write_buffers;
+
+    // Gzip content encoding of the response; each written chunk is flushed so that
+    // streamed responses still reach the client as they are generated
+    bool compress_response_;
+    z_stream compress_stream_;
+    std::vector<Bytef> compress_buf_;
+
+    // Response is a 304 with no body
+    bool not_modified_;
+
     // Request type
     boost::beast::http::verb verb_;
 
@@ -301,7 +454,12 @@ protected:
     std::string login_role_;
 
     kis_net_beast_httpd::http_var_map_t http_variables_;
+
+    // Unparsed JSON of the body, from the body itself or its json= form variable
+    nonstd::string_view json_body_;
+    bool json_parsed_;
     Json::Value json_;
+
     kis_net_beast_httpd::http_cookie_map_t cookies_;
     std::string auth_token_;
     boost::beast::string_view uri_;
@@ -311,8 +469,29 @@ protected:
 
     std::atomic<bool> first_response_write;
 
+    // Connection this request arrived on, and if we've handed it off to another thread
+    std::shared_ptr<kis_net_beast_httpd::connection_slot> slot_;
+    bool handed_off_;
+
+    // Quota the request is charged to, if quotas are enabled, and the work charged so far
+    std::shared_ptr<kis_net_beast_httpd::client_quota> quota_;
+    std::atomic<uint64_t> request_cost_;
+
     bool do_close();
 
+    // Run the route generator and complete the response stream
+    void run_generator(std::shared_ptr<kis_net_beast_route> route);
+
+    // Write the response stream to the client as a chunked response
+    bool write_response(bool client_req_close);
+
+    // Does the client accept a gzip content encoding
+    bool accepts_gzip();
+
+    // Compress buffers and write the output as a chunk
+    bool write_compressed(const std::vector<boost::asio::const_buffer>& buffers, int flush,
+            boost::system::error_code& error);
+
     template<class Response>
     void append_common_headers(Response& r, boost::beast::string_view uri) {
         // Append the common headers
@@ -378,22 +557,10 @@ public:
     std::shared_ptr<tracker_element> summarize_with_json(std::shared_ptr<T> in_data,
             std::shared_ptr<tracker_element_serializer::rename_map> rename_map) {
 
-        auto summary_vec = std::vector<SharedElementSummary>{};
-        auto fields = json_.get("fields", Json::Value(Json::arrayValue));
-
-        for (const auto& i : fields) {
-            if (i.isString()) {
-                summary_vec.push_back(std::make_shared<tracker_element_summary>(i.asString()));
-            } else if (i.isArray()) {
-                if (i.size() != 2)
-                    throw std::runtime_error("Invalid field mapping, expected [field, name]");
-                summary_vec.push_back(std::make_shared<tracker_element_summary>(i[0].asString(), i[1].asString()));
-            } else {
-                throw std::runtime_error("Invalid field mapping, expected field or [field,rename]");
-            }
-        }
+        auto plan =
+            tracker_element_summary_plan::from_json(json().get("fields", Json::Value(Json::arrayValue)));
 
-        return summarize_tracker_element(in_data, summary_vec, rename_map);
+        return summarize_tracker_element(in_data, plan, rename_map);
     }
 };
 
@@ -404,6 +571,11 @@ public:
     virtual ~kis_net_web_endpoint() { }
 
     virtual void handle_request(std::shared_ptr<kis_net_beast_httpd_connection>) { }
+
+    // Long-running endpoints may stream indefinitely or block waiting for the client,
+    // and are given a dedicated thread; other endpoints are run inline on the 
+    // connection pool
+    virtual bool long_running() const { return false; }
 };
 
 class kis_net_web_function_endpoint : public kis_net_web_endpoint {
@@ -411,30 +583,37 @@ public:
     using function_t = std::function<void (std::shared_ptr<kis_net_beast_httpd_connection>)>;
     using wrapper_func_t = std::function<void ()>;
 
+    // Functions which stream (pcap streams, proxied helper requests, and the like) or
+    // otherwise block on the client must set long_running
     kis_net_web_function_endpoint(function_t function, wrapper_func_t pre_func = nullptr,
-            wrapper_func_t post_func = nullptr) :
+            wrapper_func_t post_func = nullptr, bool long_running = false) :
         kis_net_web_endpoint{},
         function{function},
         mutex{dfl_mutex},
         use_mutex{false},
         pre_func{pre_func},
-        post_func{post_func} { }
+        post_func{post_func},
+        long_running_{long_running} { }
 
     kis_net_web_function_endpoint(function_t function,
             kis_mutex& mutex,
             wrapper_func_t pre_func = nullptr,
-            wrapper_func_t post_func = nullptr) : 
+            wrapper_func_t post_func = nullptr,
+            bool long_running = false) : 
         kis_net_web_endpoint{},
         function{function},
         mutex{mutex},
         use_mutex{true},
         pre_func{pre_func},
-        post_func{post_func} { }
+        post_func{post_func},
+        long_running_{long_running} { }
 
     virtual ~kis_net_web_function_endpoint() { }
 
     virtual void handle_request(std::shared_ptr<kis_net_beast_httpd_connection> con) override;
 
+    virtual bool long_running() const override { return long_running_; }
+
 protected:
     function_t function;
 
@@ -443,6 +622,8 @@ protected:
     bool use_mutex;
 
     wrapper_func_t pre_func, post_func;
+
+    bool long_running_;
 };
 
 class kis_net_web_tracked_endpoint : public kis_net_web_endpoint {
@@ -450,6 +631,7 @@ public:
     using gen_func_t = 
         std::function<std::shared_ptr<tracker_element> (std::shared_ptr<kis_net_beast_httpd_connection>)>;
     using wrapper_func_t = std::function<void (std::shared_ptr<tracker_element>)>;
+    using etag_func_t = std::function<uint64_t ()>;
 
     kis_net_web_tracked_endpoint(std::shared_ptr<tracker_element> content,
             kis_mutex& mutex,
@@ -479,6 +661,15 @@ public:
         use_mutex{true},
         generator{generator} { }
 
+    // Generated content with a version; the version must change whenever the generated
+    // content would.  Clients repeating a request for an unchanged version get a 304
+    // and the content isn't generated or serialized.
+    kis_net_web_tracked_endpoint(gen_func_t generator, etag_func_t etag_func) :
+        mutex{dfl_mutex},
+        use_mutex{true},
+        generator{generator},
+        etag_func{etag_func} { }
+
     virtual void handle_request(std::shared_ptr<kis_net_beast_httpd_connection> con) override;
 
 protected:
@@ -491,6 +682,49 @@ protected:
     gen_func_t generator;
     wrapper_func_t pre_func;
     wrapper_func_t post_func;
+
+    etag_func_t etag_func;
+};
+
+// Streamed vector endpoint; the generator is handed an emit function and pushes records
+// one at a time as they are produced.  Each record is summarized and serialized as it is
+// emitted, and the generator is blocked while the unsent backlog is over max_backlog, so
+// the memory cost of a response is bounded by the backlog instead of the result size.
+//
+// The optional mutex is held only while a record is serialized, never while waiting on
+// the client.  The emit function returns false once the client has gone away, and the
+// generator should stop producing records.
+class kis_net_web_streamed_endpoint : public kis_net_web_endpoint {
+public:
+    using emit_func_t = std::function<bool (std::shared_ptr<tracker_element>)>;
+    using gen_func_t = 
+        std::function<void (std::shared_ptr<kis_net_beast_httpd_connection>, const emit_func_t&)>;
+
+    kis_net_web_streamed_endpoint(gen_func_t generator, size_t max_backlog = 256 * 1024) :
+        mutex{dfl_mutex},
+        use_mutex{false},
+        generator{generator},
+        max_backlog{max_backlog} { }
+
+    kis_net_web_streamed_endpoint(gen_func_t generator, kis_mutex& mutex,
+            size_t max_backlog = 256 * 1024) :
+        mutex{mutex},
+        use_mutex{true},
+        generator{generator},
+        max_backlog{max_backlog} { }
+
+    virtual void handle_request(std::shared_ptr<kis_net_beast_httpd_connection> con) override;
+
+    // The generator blocks on the backlog while the response is written
+    virtual bool long_running() const override { return true; }
+
+protected:
+    kis_mutex& mutex;
+    kis_mutex dfl_mutex;
+    bool use_mutex;
+
+    gen_func_t generator;
+    size_t max_backlog;
 };
 
 class kis_net_web_websocket_endpoint : public kis_net_web_endpoint, 
@@ -515,16 +749,22 @@ public:
 
     virtual void handle_request(std::shared_ptr<kis_net_beast_httpd_connection> con) override;
 
+    // Queued writes hold a reference to an immutable buffer, so one buffer can be
+    // written to any number of websockets without copying it
+    using ws_buffer_t = std::shared_ptr<const std::string>;
+
     void write(std::string data) {
-        boost::asio::post(strand_,
-                boost::beast::bind_front_handler(&kis_net_web_websocket_endpoint::on_write, 
-                    shared_from_this(), data));
+        write(std::make_shared<const std::string>(std::move(data)));
     }
 
     void write(const char *data, size_t len) {
+        write(std::make_shared<const std::string>(data, len));
+    }
+
+    void write(ws_buffer_t data) {
         boost::asio::post(strand_,
                 boost::beast::bind_front_handler(&kis_net_web_websocket_endpoint::on_write,
-                    shared_from_this(), std::string(data, len)));
+                    shared_from_this(), data));
     }
 
     virtual void close();
@@ -537,13 +777,19 @@ public:
 		ws_.text(true);
 	}
 
+    // Called once the websocket has been accepted; writes made before then are dropped,
+    // so anything sent unprompted when the client connects is sent from here
+    void set_open_cb(std::function<void (std::shared_ptr<kis_net_web_websocket_endpoint>)> cb) {
+        open_cb = cb;
+    }
+
 protected:
     virtual void close_impl();
 
     virtual void start_read(std::shared_ptr<kis_net_web_websocket_endpoint> ref);
     void handle_read(boost::beast::error_code ec, std::size_t);
 
-    void on_write(const std::string& msg);
+    void on_write(ws_buffer_t msg);
     void handle_write();
 
     boost::beast::websocket::stream<boost::beast::tcp_stream> ws_;
@@ -551,11 +797,12 @@ protected:
     boost::beast::flat_buffer buffer_;
 	boost::asio::strand<boost::asio::io_context::executor_type> strand_;
 
-	std::queue<std::string, std::deque<std::string>> ws_write_queue_;
+	std::queue<ws_buffer_t, std::deque<ws_buffer_t>> ws_write_queue_;
 
     std::promise<void> handle_pr;
 
     handler_func_t handler_cb;
+    std::function<void (std::shared_ptr<kis_net_web_websocket_endpoint>)> open_cb;
 
     std::atomic<bool> running;
     std::promise<void> running_promise;
@@ -599,8 +846,24 @@ public:
     // Invoke our registered callback
     void invoke(std::shared_ptr<kis_net_beast_httpd_connection> connection);
 
+    bool long_running() const { return handler->long_running(); }
+
+    // Moving average of the cost of requests to this route, for quota admission
+    uint64_t cost_estimate() const { return cost_estimate_.load(std::memory_order_relaxed); }
+    void update_cost(uint64_t cost);
+
     std::string& route() { return route_; }
 
+    // Literal start of the route, up to the first key; every URL the route matches
+    // begins with it
+    const std::string& static_prefix() const { return static_prefix_; }
+
+    // Match a route with no keys by comparing the path directly instead of running
+    // the regex; sets matched to whether the URL matches the route, and returns
+    // false if the route has keys and needs the full match_url
+    bool match_static(const boost::beast::string_view& path, const boost::beast::string_view& query,
+            kis_net_beast_httpd_connection::uri_param_t& uri_params, bool& matched);
+
 protected:
     std::shared_ptr<kis_net_web_endpoint> handler;
 
@@ -620,6 +883,48 @@ protected:
     std::vector<std::string> match_keys;
 
     std::regex match_re;
+
+    std::string static_prefix_;
+    bool static_route_;
+    std::vector<std::string> extensions_;
+
+    // Interned route for trace spans
+    const char *trace_name_;
+
+    std::atomic<uint64_t> cost_estimate_;
+
+    void compile_static();
+};
+
+// Compiled lookup over a set of routes.  Routes are indexed by their static prefix
+// in a radix trie, so a lookup only considers routes whose literal start matches the
+// URL; routes without keys are matched by comparing the path, and only routes with
+// keys fall back to the regex.  When several routes match, the first registered wins,
+// as it did when the routes were searched in order.
+//
+// A router is never modified once built; the server builds a new one when routes
+// change and swaps it in, so lookups don't take the route lock.
+class kis_net_beast_router {
+public:
+    kis_net_beast_router(const std::vector<std::shared_ptr<kis_net_beast_route>>& routes);
+
+    std::shared_ptr<kis_net_beast_route> find(const std::string& url,
+            kis_net_beast_httpd_connection::uri_param_t& uri_params,
+            kis_net_beast_httpd::http_var_map_t& uri_variables) const;
+
+protected:
+    struct trie_node {
+        std::string edge;
+        std::vector<std::unique_ptr<trie_node>> children;
+
+        // Indexes of the routes whose static prefix ends at this node
+        std::vector<size_t> routes;
+    };
+
+    std::vector<std::shared_ptr<kis_net_beast_route>> routes_;
+    trie_node root_;
+
+    void insert(const std::string& prefix, size_t index);
 };
 
 struct auth_construction_error : public std::exception {
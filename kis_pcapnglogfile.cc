@@ -18,96 +18,305 @@
 
 #include "config.h"
 
+#include <stdio.h>
+
+#include <fstream>
+
 #include "configfile.h"
+#include "datasourcetracker.h"
+#include "json/json.h"
 #include "kis_pcapnglogfile.h"
 #include "messagebus.h"
 
+class pcapng_log_source_worker : public datasource_tracker_worker {
+public:
+    pcapng_log_source_worker(const std::function<void (std::shared_ptr<kis_datasource>)>& in_cb) :
+        cb{in_cb} { }
+
+    virtual void handle_datasource(std::shared_ptr<kis_datasource> in_src) override {
+        cb(in_src);
+    }
+
+protected:
+    std::function<void (std::shared_ptr<kis_datasource>)> cb;
+};
+
 kis_pcapng_logfile::kis_pcapng_logfile(shared_log_builder in_builder) :
     kis_logfile(in_builder),
     buffer{4096, 1024} {
     pcapng = nullptr;
-    pcapng_file = nullptr;
 
     log_duplicate_packets =
         Globalreg::globalreg->kismet_config->fetch_opt_bool("pcapng_log_duplicate_packets", true);
     log_data_packets =
         Globalreg::globalreg->kismet_config->fetch_opt_bool("pcapng_log_data_packets", true);
 
+    per_source =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("pcapng_log_per_source", false);
+    source_group_sz =
+        std::max(1U, Globalreg::globalreg->kismet_config->fetch_opt_uint("pcapng_log_source_group", 1));
+
+    source_mutex.set_name("kis_pcapng_logfile source_mutex");
+
+    eventbus_id = 0;
+
     auto packetchain = Globalreg::fetch_mandatory_global_as<packet_chain>("PACKETCHAIN");
     pack_comp_common = packetchain->register_packet_component("COMMON");
+    pack_comp_datasrc = packetchain->register_packet_component("KISDATASRC");
 }
 
 kis_pcapng_logfile::~kis_pcapng_logfile() {
     close_log();
 }
 
-bool kis_pcapng_logfile::open_log(std::string in_path) {
-    kis_lock_guard<kis_mutex> lk(log_mutex);
+std::thread kis_pcapng_logfile::start_writer_thread(future_chainbuf& in_buffer,
+        kis_logfile_writer& in_writer) {
+    auto thread_p = std::promise<void>();
+    auto thread_f = thread_p.get_future();
 
-    set_int_log_path(in_path);
+    auto t = std::thread([&in_buffer, &in_writer, thread_p = std::move(thread_p)]() mutable {
+            thread_p.set_value();
 
-    pcapng_file = fopen(in_path.c_str(), "w");
+            while (in_buffer.running() || in_buffer.size() > 0) {
+                in_buffer.wait();
+
+                char *data;
+
+                auto sz = in_buffer.get(&data);
+
+                // The writer buffers and reports its own errors; stop feeding it once
+                // it has failed
+                if (sz > 0 && !in_writer.write(data, sz) && in_writer.get_error()) {
+                    in_buffer.consume(sz);
+                    in_buffer.cancel();
+                    return;
+                }
+
+                in_buffer.consume(sz);
+            }
+
+        });
+
+    thread_f.wait();
+
+    return t;
+}
+
+bool kis_pcapng_logfile::accept_packet(std::shared_ptr<kis_packet> in_pack) {
+    if (in_pack->filtered)
+        return false;
 
-    if (pcapng_file == nullptr) {
-        _MSG_ERROR("Failed to open pcapng log '{}' - {}",
-                in_path, kis_strerror_r(errno));
+    if (in_pack->duplicate && !log_duplicate_packets)
         return false;
+
+    if (!log_data_packets) {
+        auto ci = in_pack->fetch<kis_common_info>(pack_comp_common);
+
+        if (ci != nullptr) {
+            if (ci->type == packet_basic_data) {
+                return false;
+            }
+        }
     }
 
-    pcapng = new pcapng_stream_packetchain(buffer, 
-            [this](std::shared_ptr<kis_packet> in_pack) -> bool {
-                if (in_pack->filtered)
-                    return false;
+    return true;
+}
 
-                if (in_pack->duplicate && !log_duplicate_packets)
-                    return false;
+bool kis_pcapng_logfile::open_log(std::string in_path) {
+    kis_lock_guard<kis_mutex> lk(log_mutex);
 
-                if (!log_data_packets) {
-                    auto ci = in_pack->fetch<kis_common_info>(pack_comp_common);
+    if (per_source) {
+        group_base = in_path;
 
-                    if (ci != nullptr) {
-                        if (ci->type == packet_basic_data) {
-                            return false;
-                        }
-                    }
-                }
+        if (group_base.size() > 7 && group_base.substr(group_base.size() - 7) == ".pcapng")
+            group_base.resize(group_base.size() - 7);
+
+        index_path = group_base + ".index.json";
+
+        set_int_log_path(index_path);
+
+        {
+            kis_lock_guard<kis_mutex> slk(source_mutex, "kis_pcapng_logfile open_log");
+
+            if (!write_index())
+                return false;
+        }
+
+        _MSG_INFO("Opened pcapng log index file '{}'; each {} will be logged to its own "
+                "pcapng file", index_path, source_group_sz == 1 ? "datasource" :
+                fmt::format("group of {} datasources", source_group_sz));
+
+        set_int_log_open(true);
 
-                return true;
+        // Sources defined later get files as they appear
+        eventbus = Globalreg::fetch_mandatory_global_as<event_bus>();
+        eventbus_id =
+            eventbus->register_listener(datasource_tracker::event_new_datasource(),
+                    [this](std::shared_ptr<eventbus_event> evt) {
+                        auto ds_k = 
+                            evt->get_event_content()->find(datasource_tracker::event_new_datasource());
+
+                        if (ds_k == evt->get_event_content()->end())
+                            return;
+
+                        add_source(std::static_pointer_cast<kis_datasource>(ds_k->second));
+                    });
+
+        auto datasourcetracker =
+            Globalreg::fetch_mandatory_global_as<datasource_tracker>("DATASOURCETRACKER");
+        pcapng_log_source_worker worker([this](std::shared_ptr<kis_datasource> in_src) {
+                add_source(in_src);
+                });
+        datasourcetracker->iterate_datasources(&worker);
+
+        return true;
+    }
+
+    set_int_log_path(in_path);
+
+    if (!writer.open(in_path))
+        return false;
+
+    pcapng = new pcapng_stream_packetchain(buffer,
+            [this](std::shared_ptr<kis_packet> in_pack) -> bool {
+                return accept_packet(in_pack);
             }, nullptr, 16384);
 
     _MSG_INFO("Opened pcapng log file '{}'", in_path);
 
     set_int_log_open(true);
 
-    auto thread_p = std::promise<void>();
-    auto thread_f = thread_p.get_future();
+    stream_t = start_writer_thread(buffer, writer);
 
-    stream_t = std::thread([this, thread_p = std::move(thread_p)]() mutable {
-            thread_p.set_value();
+    pcapng->start_stream();
 
-            while (buffer.running() || buffer.size() > 0) {
-                buffer.wait();
+    return true;
+}
 
-                char *data;
+void kis_pcapng_logfile::add_source(std::shared_ptr<kis_datasource> in_source) {
+    kis_lock_guard<kis_mutex> lk(source_mutex, "kis_pcapng_logfile add_source");
 
-                auto sz = buffer.get(&data);
+    if (!get_log_open())
+        return;
 
-                if (sz > 0) {
-                    if (fwrite(data, sz, 1, pcapng_file) == 0) {
-                        _MSG_ERROR("Error writing to pcapng log '{}' - {}", get_log_path(),
-                                kis_strerror_r(errno));
-                        close_log();
-                        return;
-                    }
-                }
+    unsigned int group_idx;
 
-                buffer.consume(sz);
-            }
+    {
+        std::shared_lock<kis_shared_mutex> glk(group_mutex);
 
-        });
+        if (group_map.find(in_source.get()) != group_map.end())
+            return;
 
-    thread_f.wait();
-    pcapng->start_stream();
+        group_idx = (unsigned int) groups.size();
+
+        if (groups.size() > 0 && groups.back()->sources.size() < source_group_sz)
+            group_idx--;
+    }
+
+    if (group_idx == groups.size()) {
+        // Open the next group; it can't see any packets until its first source is mapped
+        auto group = std::unique_ptr<source_group>(new source_group());
+
+        group->path = fmt::format("{}-{}.pcapng", group_base, group_idx + 1);
+
+        if (!group->writer.open(group->path)) {
+            _MSG_ERROR("Failed to open pcapng log file '{}', packets from datasource {} will "
+                    "not be logged", group->path, in_source->get_source_name());
+            return;
+        }
+
+        group->pcapng = new pcapng_stream_packetchain(group->buffer,
+                [this, group_idx](std::shared_ptr<kis_packet> in_pack) -> bool {
+                    if (!accept_packet(in_pack))
+                        return false;
+
+                    auto datasrc = in_pack->fetch<packetchain_comp_datasource>(pack_comp_datasrc);
+
+                    if (datasrc == nullptr)
+                        return false;
+
+                    std::shared_lock<kis_shared_mutex> glk(group_mutex);
+
+                    auto gi = group_map.find(datasrc->ref_source);
+
+                    return gi != group_map.end() && gi->second == group_idx;
+                }, nullptr, 16384);
+
+        group->stream_t = start_writer_thread(group->buffer, group->writer);
+
+        // Starting the stream attaches it to the packet chain, which must not happen
+        // with the group map locked
+        group->pcapng->start_stream();
+
+        _MSG_INFO("Opened pcapng log file '{}'", group->path);
+
+        std::lock_guard<kis_shared_mutex> glk(group_mutex);
+        groups.push_back(std::move(group));
+    }
+
+    {
+        std::lock_guard<kis_shared_mutex> glk(group_mutex);
+        groups[group_idx]->sources.push_back(in_source);
+        group_map[in_source.get()] = group_idx;
+    }
+
+    write_index();
+}
+
+bool kis_pcapng_logfile::write_index() {
+    Json::Value files(Json::arrayValue);
+
+    for (const auto& g : groups) {
+        Json::Value file;
+        Json::Value sources(Json::arrayValue);
+
+        auto slash = g->path.rfind('/');
+        file["kismet.pcapng.index.file"] =
+            slash == std::string::npos ? g->path : g->path.substr(slash + 1);
+
+        for (const auto& s : g->sources) {
+            Json::Value source;
+
+            source["kismet.datasource.uuid"] = s->get_source_uuid().as_string();
+            source["kismet.datasource.name"] = s->get_source_name();
+            source["kismet.datasource.interface"] = s->get_source_interface();
+
+            if (s->get_source_builder() != nullptr)
+                source["kismet.datasource.type"] = s->get_source_builder()->get_source_type();
+
+            sources.append(source);
+        }
+
+        file["kismet.pcapng.index.sources"] = sources;
+        files.append(file);
+    }
+
+    Json::Value index;
+    index["kismet.pcapng.index.version"] = 1;
+    index["kismet.pcapng.index.files"] = files;
+
+    Json::StreamWriterBuilder wb;
+
+    // Replace the index in one step so readers never see a partial file
+    auto tmp_path = index_path + ".tmp";
+
+    {
+        std::ofstream f(tmp_path, std::ios::trunc);
+
+        if (f.good())
+            f << Json::writeString(wb, index) << "\n";
+
+        if (!f.good()) {
+            _MSG_ERROR("Failed to write pcapng log index file '{}'", tmp_path);
+            return false;
+        }
+    }
+
+    if (rename(tmp_path.c_str(), index_path.c_str()) < 0) {
+        _MSG_ERROR("Failed to write pcapng log index file '{}': {}", index_path,
+                kis_strerror_r(errno));
+        return false;
+    }
 
     return true;
 }
@@ -115,16 +324,39 @@ bool kis_pcapng_logfile::open_log(std::string in_path) {
 void kis_pcapng_logfile::close_log() {
     kis_lock_guard<kis_mutex> lk(log_mutex);
 
-    set_int_log_open(false);
+    {
+        kis_lock_guard<kis_mutex> slk(source_mutex, "kis_pcapng_logfile close_log");
+        set_int_log_open(false);
+    }
+
+    if (eventbus != nullptr) {
+        eventbus->remove_listener(eventbus_id);
+        eventbus.reset();
+    }
 
     buffer.cancel();
 
     if (stream_t.joinable())
         stream_t.join();
 
-    if (pcapng_file)
-        fclose(pcapng_file);
+    writer.close();
 
-    pcapng_file = nullptr;
-}
+    if (pcapng != nullptr) {
+        delete pcapng;
+        pcapng = nullptr;
+    }
+
+    for (const auto& g : groups) {
+        g->buffer.cancel();
+
+        if (g->stream_t.joinable())
+            g->stream_t.join();
 
+        g->writer.close();
+
+        if (g->pcapng != nullptr) {
+            delete g->pcapng;
+            g->pcapng = nullptr;
+        }
+    }
+}
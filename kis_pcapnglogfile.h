@@ -21,10 +21,22 @@
 
 #include "config.h"
 
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "eventbus.h"
 #include "globalregistry.h"
 #include "logtracker.h"
+#include "kis_logfile_writer.h"
 #include "pcapng_stream_futurebuf.h"
 
+// With pcapng_log_per_source, packets are split into one pcapng file per datasource,
+// or per group of pcapng_log_source_group sources, each with its own stream, buffer,
+// and writer thread, so the logging stage scales with the number of radios and tools
+// can process each source on its own.  The log path is then a JSON index listing the
+// files of the set and the sources in each.
 class kis_pcapng_logfile : public kis_logfile {
 public:
     kis_pcapng_logfile(shared_log_builder in_builder);
@@ -34,15 +46,60 @@ public:
     virtual void close_log() override;
 
 protected:
+    // Start the thread moving the pcapng stream in a buffer to the writer
+    static std::thread start_writer_thread(future_chainbuf& in_buffer, 
+            kis_logfile_writer& in_writer);
+
+    // Common filter of logged packets
+    bool accept_packet(std::shared_ptr<kis_packet> in_pack);
+
     pcapng_stream_packetchain *pcapng;
     future_chainbuf buffer;
-    FILE *pcapng_file;
+    kis_logfile_writer writer;
     std::thread stream_t;
 
     bool log_duplicate_packets;
     bool log_data_packets;
 
     int pack_comp_common;
+
+    // Per-source files
+    struct source_group {
+        source_group() :
+            buffer{4096, 1024},
+            pcapng{nullptr} { }
+
+        std::string path;
+        future_chainbuf buffer;
+        kis_logfile_writer writer;
+        pcapng_stream_packetchain *pcapng;
+        std::thread stream_t;
+        std::vector<std::shared_ptr<kis_datasource>> sources;
+    };
+
+    // Assign a source to a group, opening a new group file when the last one is full
+    void add_source(std::shared_ptr<kis_datasource> in_source);
+
+    // Rewrite the index of the set; must be called with source_mutex held
+    bool write_index();
+
+    bool per_source;
+    unsigned int source_group_sz;
+    std::string group_base, index_path;
+
+    // Serializes adding sources; held while a group stream starts, so the packet
+    // filters never wait on it
+    kis_mutex source_mutex;
+
+    // Group of each source, checked by the group filters on the packet threads
+    kis_shared_mutex group_mutex;
+    std::unordered_map<kis_datasource *, unsigned int> group_map;
+    std::vector<std::unique_ptr<source_group>> groups;
+
+    std::shared_ptr<event_bus> eventbus;
+    unsigned long eventbus_id;
+
+    int pack_comp_datasrc;
 };
 
 class pcapng_logfile_builder : public kis_logfile_builder {
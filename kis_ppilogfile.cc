@@ -27,6 +27,13 @@
 #include "kis_ppi.h"
 #include "phy_80211.h"
 
+struct ppi_pcap_record_hdr {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t caplen;
+    uint32_t len;
+};
+
 kis_ppi_logfile::kis_ppi_logfile(shared_log_builder in_builder) : 
     kis_logfile(in_builder) {
 
@@ -36,10 +43,6 @@ kis_ppi_logfile::kis_ppi_logfile(shared_log_builder in_builder) :
 	cbfilter = NULL;
 	cbaux = NULL;
 
-	dumpfile = NULL;
-	dumper = NULL;
-    dump_filep = NULL;
-
     log_open = false;
 
     auto packetchain = Globalreg::fetch_mandatory_global_as<packet_chain>("PACKETCHAIN");
@@ -67,39 +70,31 @@ bool kis_ppi_logfile::open_log(std::string in_path) {
     log_open = false;
     set_int_log_path(in_path);
 
-	dumpfile = NULL;
-	dumper = NULL;
-    dump_filep = NULL;
-
     auto packetchain =
         Globalreg::fetch_mandatory_global_as<packet_chain>("PACKETCHAIN");
 
-	dumpfile = pcap_open_dead(DLT_PPI, MAX_PACKET_LEN);
-
-	if (dumpfile == NULL) {
-        _MSG_ERROR("Failed to prepare pcap/ppi dump file '{}': {}",
-                in_path, kis_strerror_r(errno));
+    if (!writer.open(in_path))
         return false;
-	}
 
-    // Open as a filepointer
-    dump_filep = fopen(in_path.c_str(), "wb");
-    if (dump_filep == NULL) {
-        _MSG_ERROR("Failed to open pcap/ppi dump file '{}' for writing: {}",
-                in_path, kis_strerror_r(errno));
+    // Standard pcap file header for the PPI link type; records are written directly
+    // through the buffered log writer instead of libpcap's stdio dumper
+    struct pcap_file_header fh;
+    memset(&fh, 0, sizeof(fh));
+
+    fh.magic = 0xa1b2c3d4;
+    fh.version_major = PCAP_VERSION_MAJOR;
+    fh.version_minor = PCAP_VERSION_MINOR;
+    fh.thiszone = 0;
+    fh.sigfigs = 0;
+    fh.snaplen = MAX_PACKET_LEN;
+    fh.linktype = DLT_PPI;
+
+    if (!writer.write(&fh, sizeof(fh))) {
+        _MSG_ERROR("Unable to write pcap/ppi dump file header for '{}'", in_path);
+        writer.close();
         return false;
     }
 
-    // close it on exec
-    fcntl(fileno(dump_filep), F_SETFL, fcntl(fileno(dump_filep), F_GETFL, 0) | O_CLOEXEC);
-
-	dumper = pcap_dump_fopen(dumpfile, dump_filep);
-    if (dumper == NULL) {
-        _MSG_FATAL("Unable to open pcap/ppi dump file '{}': {}", in_path, kis_strerror_r(errno));
-        Globalreg::globalreg->fatal_condition = true;
-        return false;
-	}
-
     _MSG_INFO("Opened PPI pcap log file '{}'", in_path);
 
     log_open = true;
@@ -122,20 +117,9 @@ void kis_ppi_logfile::close_log() {
     if (packetchain != NULL) 
         packetchain->remove_handler(&kis_ppi_logfile::packet_handler, CHAINPOS_LOGGING);
 
-    // close files
-    if (dumper != NULL) {
-        pcap_dump_flush(dumper);
-        pcap_dump_close(dumper);
-    }
-
-    if (dumpfile != NULL) {
-        pcap_close(dumpfile);
-    }
-
-	dumper = NULL;
-	dumpfile = NULL;
-    dump_filep = NULL;
+    log_open = false;
 
+    writer.close();
 }
 
 kis_ppi_logfile::~kis_ppi_logfile() {
@@ -464,16 +448,16 @@ int kis_ppi_logfile::packet_handler(CHAINCALL_PARMS) {
         dump_offset += 4;
     }
 
-    // Fake a header
-    struct pcap_pkthdr wh;
-    wh.ts.tv_sec = in_pack->ts.tv_sec;
-    wh.ts.tv_usec = in_pack->ts.tv_usec;
+    // On-disk pcap record header, which always uses 32 bit timestamps
+    ppi_pcap_record_hdr wh;
+    wh.ts_sec = in_pack->ts.tv_sec;
+    wh.ts_usec = in_pack->ts.tv_usec;
     wh.caplen = wh.len = dump_len;
 
-    // Dump it
-    {
-        kis_lock_guard<kis_mutex> lk(ppilog->log_mutex);
-        pcap_dump((u_char *) ppilog->dumper, &wh, dump_data);
+    // The writer queues the record for its own thread; it never blocks on the disk
+    if (!ppilog->writer.write(&wh, sizeof(wh), dump_data, dump_len)) {
+        delete[] dump_data;
+        return 1;
     }
 
     delete[] dump_data;
@@ -34,6 +34,7 @@ extern "C" {
 #include "configfile.h"
 #include "messagebus.h"
 #include "packetchain.h"
+#include "kis_logfile_writer.h"
 #include "logtracker.h"
 
 // Plugin/module PPI callback
@@ -75,9 +76,7 @@ protected:
 	// Common internal startup
 	void startup_dumpfile();
 
-	pcap_t *dumpfile;
-	pcap_dumper_t *dumper;
-    FILE *dump_filep;
+    kis_logfile_writer writer;
 
 	int dlt;
 
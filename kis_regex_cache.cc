@@ -0,0 +1,132 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include "kis_regex_cache.h"
+
+#ifdef HAVE_LIBPCRE
+
+#include <stdexcept>
+
+#include "fmt.h"
+
+kis_pcre_pattern::kis_pcre_pattern(const std::string& in_regex, int in_options) :
+    re{nullptr},
+    study{nullptr},
+    jit{false} {
+
+    const char *compile_error, *study_error = nullptr;
+    int err_offt;
+
+    re = pcre_compile(in_regex.c_str(), in_options, &compile_error, &err_offt, NULL);
+
+    if (re == nullptr)
+        throw std::runtime_error(fmt::format("Could not parse PCRE Regex: {} at {}",
+                    compile_error, err_offt));
+
+    int study_options = 0;
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+    int have_jit = 0;
+    if (pcre_config(PCRE_CONFIG_JIT, &have_jit) == 0 && have_jit)
+        study_options |= PCRE_STUDY_JIT_COMPILE;
+#endif
+
+    study = pcre_study(re, study_options, &study_error);
+
+    if (study_error != nullptr) {
+        pcre_free(re);
+        throw std::runtime_error(fmt::format("Could not parse PCRE Regex, optimization failed: {}",
+                    study_error));
+    }
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+    // Patterns the JIT can't handle fall back to the interpreter
+    int jit_info = 0;
+    if (study != nullptr && pcre_fullinfo(re, study, PCRE_INFO_JIT, &jit_info) == 0)
+        jit = jit_info != 0;
+#endif
+}
+
+kis_pcre_pattern::~kis_pcre_pattern() {
+    if (study != nullptr) {
+#ifdef PCRE_STUDY_JIT_COMPILE
+        pcre_free_study(study);
+#else
+        pcre_free(study);
+#endif
+    }
+
+    if (re != nullptr)
+        pcre_free(re);
+}
+
+bool kis_pcre_pattern::match(const std::string& in_val) const {
+    // Captures aren't used, but give pcre room for them so it doesn't allocate
+    int ovector[30];
+
+    return pcre_exec(re, study, in_val.c_str(), in_val.length(), 0, 0, ovector, 30) >= 0;
+}
+
+kis_regex_cache& kis_regex_cache::cache() {
+    static kis_regex_cache c;
+    return c;
+}
+
+std::shared_ptr<kis_pcre_pattern> kis_regex_cache::compile(const std::string& in_regex,
+        int in_options) {
+    auto& c = cache();
+    auto key = std::make_pair(in_regex, in_options);
+
+    {
+        kis_lock_guard<kis_fast_mutex> lk(c.mutex, "kis_regex_cache compile");
+
+        auto i = c.index.find(key);
+        if (i != c.index.end()) {
+            c.lru.splice(c.lru.begin(), c.lru, i->second);
+            return i->second->second;
+        }
+    }
+
+    // Compile without holding the cache; if another thread compiled the same
+    // pattern meanwhile, theirs is kept
+    auto pattern = std::make_shared<kis_pcre_pattern>(in_regex, in_options);
+
+    kis_lock_guard<kis_fast_mutex> lk(c.mutex, "kis_regex_cache compile");
+
+    auto i = c.index.find(key);
+    if (i != c.index.end()) {
+        c.lru.splice(c.lru.begin(), c.lru, i->second);
+        return i->second->second;
+    }
+
+    c.lru.emplace_front(key, pattern);
+    c.index[key] = c.lru.begin();
+
+    // Evicted patterns stay alive as long as a filter still uses them
+    while (c.lru.size() > max_patterns) {
+        c.index.erase(c.lru.back().first);
+        c.lru.pop_back();
+    }
+
+    return pattern;
+}
+
+#endif
+
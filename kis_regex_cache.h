@@ -0,0 +1,97 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_REGEX_CACHE_H__
+#define __KIS_REGEX_CACHE_H__
+
+#include "config.h"
+
+#ifdef HAVE_LIBPCRE
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <pcre.h>
+
+#include "kis_mutex.h"
+
+// A compiled and studied PCRE; JIT compiled when libpcre supports it.  Matching is
+// thread safe, so one pattern can be shared by any number of filters.
+class kis_pcre_pattern {
+public:
+    // std::runtime_error is thrown if the regex doesn't compile
+    kis_pcre_pattern(const std::string& in_regex, int in_options);
+    ~kis_pcre_pattern();
+
+    kis_pcre_pattern(const kis_pcre_pattern&) = delete;
+    kis_pcre_pattern& operator=(const kis_pcre_pattern&) = delete;
+
+    bool match(const std::string& in_val) const;
+
+    bool is_jit() const {
+        return jit;
+    }
+
+protected:
+    pcre *re;
+    pcre_extra *study;
+    bool jit;
+};
+
+// Compiled regex cache
+//
+// Dashboards poll views with the same regex filters over and over; rather than
+// compiling and studying every filter of every request, the most recently used
+// patterns are kept, keyed by the regex and its compile options, and shared by the
+// tracked element and device view regex workers.
+class kis_regex_cache {
+public:
+    static constexpr size_t max_patterns = 256;
+
+    // Cached or newly compiled pattern; std::runtime_error is thrown if the regex
+    // doesn't compile, and failed regexes aren't cached
+    static std::shared_ptr<kis_pcre_pattern> compile(const std::string& in_regex,
+            int in_options = 0);
+
+protected:
+    using cache_key = std::pair<std::string, int>;
+
+    struct cache_key_hash {
+        size_t operator()(const cache_key& k) const {
+            return std::hash<std::string>{}(k.first) ^ static_cast<size_t>(k.second);
+        }
+    };
+
+    using lru_list = std::list<std::pair<cache_key, std::shared_ptr<kis_pcre_pattern>>>;
+
+    kis_fast_mutex mutex;
+
+    // Most recently used first
+    lru_list lru;
+    std::unordered_map<cache_key, lru_list::iterator, cache_key_hash> index;
+
+    static kis_regex_cache& cache();
+};
+
+#endif
+
+#endif
+
@@ -0,0 +1,256 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include "datasourcetracker.h"
+#include "devicetracker.h"
+#include "json/json.h"
+#include "kis_replay_benchmark.h"
+#include "messagebus.h"
+#include "packetchain.h"
+#include "timetracker.h"
+
+namespace {
+
+// Give up if no datasources have been defined by now
+const double replay_benchmark_source_timeout = 10;
+
+class benchmark_source_worker : public datasource_tracker_worker {
+public:
+    benchmark_source_worker() :
+        n_sources{0},
+        n_finished{0},
+        packets{0},
+        sources{Json::arrayValue} { }
+
+    virtual void handle_datasource(std::shared_ptr<kis_datasource> in_src) override {
+        n_sources++;
+
+        // Sources which have finished or failed are no longer running and have an
+        // error; anything else is still opening or replaying
+        bool finished = !in_src->get_source_running() && in_src->get_source_error();
+
+        if (finished)
+            n_finished++;
+
+        packets += in_src->get_source_num_packets();
+
+        Json::Value s;
+        s["name"] = in_src->get_source_name();
+        s["definition"] = in_src->get_source_definition();
+        s["packets"] = (Json::UInt64) in_src->get_source_num_packets();
+        s["error_packets"] = (Json::UInt64) in_src->get_source_num_error_packets();
+        s["finished"] = finished;
+        s["reason"] = in_src->get_source_error_reason();
+        sources.append(s);
+    }
+
+    unsigned int n_sources;
+    unsigned int n_finished;
+    uint64_t packets;
+    Json::Value sources;
+};
+
+}
+
+kis_replay_benchmark::kis_replay_benchmark(const std::string& in_report) :
+    lifetime_global(),
+    deferred_startup(),
+    report_path{in_report},
+    timer_id{-1},
+    complete{false} {
+
+    start_time = std::chrono::steady_clock::now();
+}
+
+kis_replay_benchmark::~kis_replay_benchmark() {
+    auto timetracker = Globalreg::fetch_global_as<time_tracker>();
+
+    if (timetracker != nullptr && timer_id >= 0)
+        timetracker->remove_timer(timer_id);
+
+    Globalreg::globalreg->remove_global(global_name());
+}
+
+void kis_replay_benchmark::trigger_deferred_startup() {
+    start_time = std::chrono::steady_clock::now();
+
+    _MSG_INFO("Running in benchmark mode; Kismet will exit and write a report to {} once "
+            "all datasources have finished", report_path == "-" ? "stdout" : report_path);
+
+    auto timetracker = Globalreg::fetch_mandatory_global_as<time_tracker>();
+
+    // Poll every timeslice; the report duration is accurate to within a slice
+    timer_id =
+        timetracker->register_timer(time_tracker::slice(1), true,
+                [this](int) -> int {
+                    if (complete)
+                        return 0;
+
+                    return check_complete() ? 0 : 1;
+                }, "replay benchmark");
+}
+
+bool kis_replay_benchmark::check_complete() {
+    auto datasourcetracker = Globalreg::fetch_mandatory_global_as<datasource_tracker>();
+    auto packetchain = Globalreg::fetch_mandatory_global_as<packet_chain>();
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    benchmark_source_worker worker;
+    datasourcetracker->iterate_datasources(&worker);
+
+    if (worker.n_sources == 0) {
+        if (elapsed > replay_benchmark_source_timeout) {
+            _MSG_FATAL("Benchmark mode needs at least one datasource; use '-c' to replay a "
+                    "pcapfile or kismetdb log");
+            Globalreg::globalreg->fatal_condition = true;
+            complete = true;
+            return true;
+        }
+
+        return false;
+    }
+
+    if (worker.n_finished != worker.n_sources)
+        return false;
+
+    if (packetchain->get_packets_in_flight() != 0)
+        return false;
+
+    complete = true;
+
+    write_report(elapsed);
+
+    Globalreg::globalreg->spindown = true;
+
+    return true;
+}
+
+void kis_replay_benchmark::write_report(double in_duration) {
+    auto datasourcetracker = Globalreg::fetch_mandatory_global_as<datasource_tracker>();
+    auto packetchain = Globalreg::fetch_mandatory_global_as<packet_chain>();
+    auto devicetracker = Globalreg::fetch_mandatory_global_as<device_tracker>();
+
+    benchmark_source_worker worker;
+    datasourcetracker->iterate_datasources(&worker);
+
+    Json::Value root;
+
+    root["version"] = fmt::format("{}-{}-{}", Globalreg::globalreg->version_major,
+            Globalreg::globalreg->version_minor, Globalreg::globalreg->version_tiny);
+    root["git_rev"] = Globalreg::globalreg->version_git_rev;
+    root["duration_sec"] = in_duration;
+    root["sources"] = worker.sources;
+
+    auto processed = packetchain->get_packets_processed();
+
+    Json::Value packets;
+    packets["received"] = (Json::UInt64) worker.packets;
+    packets["processed"] = (Json::UInt64) processed;
+    packets["dropped"] = (Json::UInt64) packetchain->get_packets_dropped();
+    packets["per_sec"] = in_duration > 0 ? processed / in_duration : 0;
+    root["packets"] = packets;
+
+    // Handler timings are sampled, so call counts are estimates
+    auto sample = packetchain->get_handler_stats_sample();
+    root["handler_stats_sample"] = sample;
+
+    // Stages in chain order, with the handlers of each stage
+    std::vector<std::string> stage_order;
+    std::map<std::string, Json::Value> stages;
+
+    for (const auto& h : packetchain->get_handler_stats()) {
+        auto si = stages.find(h.chain);
+
+        if (si == stages.end()) {
+            Json::Value st;
+            st["stage"] = h.chain;
+            st["calls"] = (Json::UInt64) 0;
+            st["mean_ns"] = (Json::UInt64) 0;
+            st["handlers"] = Json::Value(Json::arrayValue);
+
+            stage_order.push_back(h.chain);
+            si = stages.emplace(h.chain, st).first;
+        }
+
+        auto& st = si->second;
+        uint64_t calls = h.samples * sample;
+
+        Json::Value hj;
+        hj["name"] = h.name;
+        hj["priority"] = h.priority;
+        hj["samples"] = (Json::UInt64) h.samples;
+        hj["calls"] = (Json::UInt64) calls;
+        hj["min_ns"] = (Json::UInt64) h.min;
+        hj["mean_ns"] = (Json::UInt64) h.mean;
+        hj["p50_ns"] = (Json::UInt64) h.p50;
+        hj["p90_ns"] = (Json::UInt64) h.p90;
+        hj["p99_ns"] = (Json::UInt64) h.p99;
+        hj["p999_ns"] = (Json::UInt64) h.p999;
+        hj["max_ns"] = (Json::UInt64) h.max;
+        st["handlers"].append(hj);
+
+        // Every packet passes through every handler of a stage, so the busiest
+        // handler is the packet count of the stage
+        st["calls"] = (Json::UInt64) std::max((uint64_t) st["calls"].asUInt64(), calls);
+        st["mean_ns"] = (Json::UInt64) (st["mean_ns"].asUInt64() + h.mean);
+    }
+
+    root["stages"] = Json::Value(Json::arrayValue);
+
+    for (const auto& s : stage_order) {
+        auto& st = stages[s];
+
+        st["calls_per_sec"] = in_duration > 0 ? st["calls"].asUInt64() / in_duration : 0;
+
+        root["stages"].append(st);
+    }
+
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0)
+        root["peak_rss_kb"] = (Json::Int64) ru.ru_maxrss;
+
+    root["devices"] = devicetracker->fetch_num_devices();
+
+    if (report_path == "-") {
+        std::cout << root << std::endl;
+        return;
+    }
+
+    std::ofstream ofs(report_path);
+
+    if (!ofs.is_open()) {
+        _MSG_ERROR("Could not open benchmark report file {}, writing the report to stdout",
+                report_path);
+        std::cout << root << std::endl;
+        return;
+    }
+
+    ofs << root << std::endl;
+
+    _MSG_INFO("Wrote benchmark report to {}", report_path);
+}
@@ -0,0 +1,76 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_REPLAY_BENCHMARK_H__
+#define __KIS_REPLAY_BENCHMARK_H__
+
+#include "config.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "globalregistry.h"
+
+// Headless replay benchmark, enabled with --benchmark
+//
+// The configured datasources (normally pcapfile or kismetdb sources, which replay
+// as fast as possible unless given 'realtime' or 'pps') are processed through the
+// whole pipeline.  Once every source has finished and the packet queues have drained,
+// a JSON report of the packet rates, per-stage handler latencies, peak memory, and
+// devices created is written and the server shuts down.
+//
+// The server holds the capture path at the packet backlog limit instead of dropping
+// packets in this mode, so a replay is repeatable.
+
+class kis_replay_benchmark : public lifetime_global, public deferred_startup {
+public:
+    static std::string global_name() { return "KISMET_REPLAY_BENCHMARK"; }
+
+    static std::shared_ptr<kis_replay_benchmark> create_replay_benchmark(const std::string& in_report) {
+        std::shared_ptr<kis_replay_benchmark> shared(new kis_replay_benchmark(in_report));
+        Globalreg::globalreg->register_lifetime_global(shared);
+        Globalreg::globalreg->insert_global(global_name(), shared);
+        Globalreg::globalreg->register_deferred_global(shared);
+        return shared;
+    }
+
+private:
+    kis_replay_benchmark(const std::string& in_report);
+
+public:
+    virtual ~kis_replay_benchmark();
+
+protected:
+    virtual void trigger_deferred_startup() override;
+
+    // Check if the replay has completed; returns true once the report is written
+    bool check_complete();
+
+    void write_report(double in_duration);
+
+    // Report file, or '-' for stdout
+    std::string report_path;
+
+    std::chrono::steady_clock::time_point start_time;
+
+    int timer_id;
+    bool complete;
+};
+
+#endif
@@ -0,0 +1,727 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "channeltracker2.h"
+#include "configfile.h"
+#include "crc32.h"
+#include "datasourcetracker.h"
+#include "devicetracker.h"
+#include "json_adapter.h"
+#include "kis_rrd_archive.h"
+#include "messagebus.h"
+#include "timetracker.h"
+#include "util.h"
+
+namespace {
+
+// The file starts with the archive magic, followed by blocks of a block header and a
+// payload of the series name, the first minute, the sample count, and the samples as
+// zigzag varint deltas.  Integers are little endian.
+const char archive_magic[8] = {'K', 'I', 'S', 'R', 'R', 'D', 'A', '1'};
+const uint32_t block_magic = 0x42445252;
+const size_t block_header_len = 12;
+
+// Queries are limited in the number of buckets returned, not in the time covered
+const size_t max_query_buckets = 100000;
+
+const int64_t minutes_per_day = 24 * 60;
+
+void put_u16(std::string& out, uint16_t v) {
+    out.push_back(v & 0xFF);
+    out.push_back((v >> 8) & 0xFF);
+}
+
+void put_u32(std::string& out, uint32_t v) {
+    for (unsigned int i = 0; i < 4; i++)
+        out.push_back((v >> (i * 8)) & 0xFF);
+}
+
+void put_u64(std::string& out, uint64_t v) {
+    for (unsigned int i = 0; i < 8; i++)
+        out.push_back((v >> (i * 8)) & 0xFF);
+}
+
+void put_varint(std::string& out, int64_t v) {
+    auto z = (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+
+    while (z >= 0x80) {
+        out.push_back((z & 0x7F) | 0x80);
+        z >>= 7;
+    }
+
+    out.push_back(z);
+}
+
+uint16_t get_u16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+uint32_t get_u32(const uint8_t *p) {
+    uint32_t v = 0;
+
+    for (unsigned int i = 0; i < 4; i++)
+        v |= static_cast<uint32_t>(p[i]) << (i * 8);
+
+    return v;
+}
+
+uint64_t get_u64(const uint8_t *p) {
+    uint64_t v = 0;
+
+    for (unsigned int i = 0; i < 8; i++)
+        v |= static_cast<uint64_t>(p[i]) << (i * 8);
+
+    return v;
+}
+
+// Decode a varint, advancing p; returns false if it runs past the end
+bool get_varint(const uint8_t *& p, const uint8_t *end, int64_t& ret) {
+    uint64_t z = 0;
+    unsigned int shift = 0;
+
+    while (p < end && shift < 64) {
+        auto b = *p++;
+
+        z |= static_cast<uint64_t>(b & 0x7F) << shift;
+
+        if ((b & 0x80) == 0) {
+            ret = static_cast<int64_t>(z >> 1) ^ -static_cast<int64_t>(z & 1);
+            return true;
+        }
+
+        shift += 7;
+    }
+
+    return false;
+}
+
+// Header fields of a block, checked against the length of the file
+struct block_info {
+    std::string series;
+    int64_t start_minute;
+    uint32_t count;
+    uint32_t len;
+    const uint8_t *samples;
+    const uint8_t *end;
+};
+
+bool parse_block(const uint8_t *in_base, uint64_t in_offset, uint64_t in_size,
+        block_info& ret) {
+    if (in_offset + block_header_len > in_size)
+        return false;
+
+    auto p = in_base + in_offset;
+
+    if (get_u32(p) != block_magic)
+        return false;
+
+    ret.len = get_u32(p + 4);
+
+    if (in_offset + block_header_len + ret.len > in_size || ret.len < 2)
+        return false;
+
+    auto payload = p + block_header_len;
+    auto name_len = get_u16(payload);
+
+    if (ret.len < 2 + name_len + 12u)
+        return false;
+
+    ret.series = std::string(reinterpret_cast<const char *>(payload + 2), name_len);
+    ret.start_minute = static_cast<int64_t>(get_u64(payload + 2 + name_len));
+    ret.count = get_u32(payload + 2 + name_len + 8);
+    ret.samples = payload + 2 + name_len + 12;
+    ret.end = payload + ret.len;
+
+    return true;
+}
+
+class rrd_archive_datasource_worker : public datasource_tracker_worker {
+public:
+    rrd_archive_datasource_worker(time_t in_minute) :
+        minute{in_minute} { }
+
+    virtual void handle_datasource(std::shared_ptr<kis_datasource> in_src) override {
+        auto name = in_src->get_source_uuid().as_string();
+
+        // Only sources which have seen traffic have rrds
+        auto packet_rrd = in_src->get_tracker_source_packet_rrd();
+        if (packet_rrd != nullptr)
+            samples.push_back(std::make_pair(fmt::format("datasource/{}/packets", name),
+                        packet_rrd->get_minute_value(minute)));
+
+        auto size_rrd = in_src->get_tracker_source_packet_size_rrd();
+        if (size_rrd != nullptr)
+            samples.push_back(std::make_pair(fmt::format("datasource/{}/bytes", name),
+                        size_rrd->get_minute_value(minute)));
+    }
+
+    time_t minute;
+    std::vector<std::pair<std::string, int64_t>> samples;
+};
+
+}
+
+kis_rrd_archive::kis_rrd_archive() :
+    lifetime_global(),
+    deferred_startup(),
+    archive_fd{-1},
+    archive_size{0},
+    last_flush{0},
+    last_minute{0},
+    gather_timer{-1} {
+
+    mutex.set_name("kis_rrd_archive");
+
+    enabled = Globalreg::globalreg->kismet_config->fetch_opt_bool("rrd_archive", false);
+    archive_datasources =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("rrd_archive_datasources", true);
+    archive_channels =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("rrd_archive_channels", true);
+    archive_devices = Globalreg::globalreg->kismet_config->fetch_opt_vec("rrd_archive_device");
+    archive_path =
+        Globalreg::globalreg->kismet_config->fetch_opt_path("rrd_archive_file",
+                "%h/.kismet/rrd_archive.kra");
+    flush_interval =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<time_t>("rrd_archive_flush", 86400);
+
+    if (flush_interval < 60)
+        flush_interval = 60;
+
+    auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
+
+    httpd->register_route("/rrd_archive/series", {"GET"}, httpd->RO_ROLE, {"json"},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return series_endp_handler(con);
+                }));
+
+    httpd->register_route("/rrd_archive/query", {"GET"}, httpd->RO_ROLE, {"json"},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return query_endp_handler(con);
+                }));
+}
+
+kis_rrd_archive::~kis_rrd_archive() {
+    Globalreg::globalreg->remove_global(global_name());
+
+    auto timetracker = Globalreg::fetch_global_as<time_tracker>();
+    if (timetracker != nullptr && gather_timer >= 0)
+        timetracker->remove_timer(gather_timer);
+
+    if (archive_fd >= 0)
+        close(archive_fd);
+}
+
+void kis_rrd_archive::trigger_deferred_startup() {
+    if (!enabled)
+        return;
+
+    if (!open_archive()) {
+        enabled = false;
+        return;
+    }
+
+    auto now = time(0);
+
+    // Start with the minute in progress
+    last_minute = now / 60 - 1;
+    last_flush = now;
+
+    auto timetracker = Globalreg::fetch_mandatory_global_as<time_tracker>();
+
+    gather_timer =
+        timetracker->register_timer(std::chrono::seconds(60), 1,
+                [this](int) -> int {
+                    auto now = time(0);
+                    int64_t minute = now / 60;
+
+                    // Catch up on minutes missed by a late timer, up to the span the
+                    // rrds still hold
+                    for (auto m = std::max(last_minute + 1, minute - 59); m < minute; m++)
+                        gather_minute(m);
+
+                    last_minute = minute - 1;
+
+                    if (now - last_flush >= flush_interval) {
+                        last_flush = now;
+                        flush_pending();
+                    }
+
+                    return 1;
+                });
+}
+
+void kis_rrd_archive::trigger_deferred_shutdown() {
+    if (!enabled)
+        return;
+
+    auto timetracker = Globalreg::fetch_global_as<time_tracker>();
+    if (timetracker != nullptr && gather_timer >= 0)
+        timetracker->remove_timer(gather_timer);
+    gather_timer = -1;
+
+    flush_pending();
+}
+
+bool kis_rrd_archive::open_archive() {
+    kis_lock_guard<kis_mutex> lk(mutex, "kis_rrd_archive open_archive");
+
+    archive_fd = open(archive_path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+    if (archive_fd < 0) {
+        _MSG_ERROR("Unable to open the RRD archive {}: {}", archive_path, kis_strerror_r(errno));
+        return false;
+    }
+
+    struct stat sb;
+
+    if (fstat(archive_fd, &sb) < 0) {
+        _MSG_ERROR("Unable to open the RRD archive {}: {}", archive_path, kis_strerror_r(errno));
+        close(archive_fd);
+        archive_fd = -1;
+        return false;
+    }
+
+    if (sb.st_size == 0) {
+        if (write(archive_fd, archive_magic, sizeof(archive_magic)) != sizeof(archive_magic)) {
+            _MSG_ERROR("Unable to write the RRD archive {}: {}", archive_path,
+                    kis_strerror_r(errno));
+            close(archive_fd);
+            archive_fd = -1;
+            return false;
+        }
+
+        archive_size = sizeof(archive_magic);
+
+        _MSG_INFO("Keeping long-term RRD history in new archive {}", archive_path);
+
+        return true;
+    }
+
+    void *map = MAP_FAILED;
+
+    if (sb.st_size >= (off_t) sizeof(archive_magic))
+        map = mmap(nullptr, sb.st_size, PROT_READ, MAP_SHARED, archive_fd, 0);
+
+    if (map == MAP_FAILED || memcmp(map, archive_magic, sizeof(archive_magic)) != 0) {
+        _MSG_ERROR("Not keeping long-term RRD history; {} is not an RRD archive", archive_path);
+
+        if (map != MAP_FAILED)
+            munmap(map, sb.st_size);
+
+        close(archive_fd);
+        archive_fd = -1;
+        return false;
+    }
+
+    madvise(map, sb.st_size, MADV_SEQUENTIAL);
+
+    auto base = static_cast<const uint8_t *>(map);
+    uint64_t offset = sizeof(archive_magic);
+    size_t n_blocks = 0;
+    block_info bi;
+
+    while (parse_block(base, offset, sb.st_size, bi)) {
+        index[bi.series].push_back(block_ref{bi.start_minute, bi.count, offset, bi.len});
+        offset += block_header_len + bi.len;
+        n_blocks++;
+    }
+
+    munmap(map, sb.st_size);
+
+    // Anything past the last whole block was torn by a crash
+    if (offset != (uint64_t) sb.st_size) {
+        _MSG_ERROR("Dropping {} bytes of a partially written block from the end of the RRD "
+                "archive {}", sb.st_size - offset, archive_path);
+
+        if (ftruncate(archive_fd, offset) < 0) {
+            _MSG_ERROR("Unable to truncate the RRD archive {}: {}", archive_path,
+                    kis_strerror_r(errno));
+            close(archive_fd);
+            archive_fd = -1;
+            return false;
+        }
+    }
+
+    archive_size = offset;
+
+    _MSG_INFO("Keeping long-term RRD history in archive {}, holding {} blocks of {} series",
+            archive_path, n_blocks, index.size());
+
+    return true;
+}
+
+void kis_rrd_archive::gather_minute(int64_t in_minute) {
+    time_t minute_start = in_minute * 60;
+
+    std::vector<std::pair<std::string, int64_t>> samples;
+
+    if (archive_datasources) {
+        auto datasourcetracker = Globalreg::fetch_global_as<datasource_tracker>();
+
+        if (datasourcetracker != nullptr) {
+            rrd_archive_datasource_worker worker(minute_start);
+            datasourcetracker->iterate_datasources(&worker);
+            samples = std::move(worker.samples);
+        }
+    }
+
+    if (archive_channels) {
+        auto channeltracker = Globalreg::fetch_global_as<channel_tracker_v2>();
+
+        if (channeltracker != nullptr) {
+            channeltracker->iterate_frequencies([&](double freq,
+                        std::shared_ptr<channel_tracker_v2_channel> chan) {
+                    auto name = fmt::format("channel/{}", static_cast<uint64_t>(freq));
+
+                    samples.push_back(std::make_pair(name + "/packets",
+                                chan->get_packets_rrd()->get_minute_value(minute_start)));
+                    samples.push_back(std::make_pair(name + "/data",
+                                chan->get_data_rrd()->get_minute_value(minute_start)));
+                    samples.push_back(std::make_pair(name + "/devices",
+                                chan->get_device_rrd()->get_minute_value(minute_start)));
+                });
+        }
+    }
+
+    if (archive_devices.size()) {
+        auto devicetracker = Globalreg::fetch_global_as<device_tracker>();
+
+        if (devicetracker != nullptr) {
+            kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(),
+                    "kis_rrd_archive gather_minute");
+
+            for (const auto& m : archive_devices) {
+                mac_addr mac(m);
+
+                if (mac.error())
+                    continue;
+
+                for (const auto& dev : devicetracker->fetch_devices(mac)) {
+                    auto name = fmt::format("device/{}", dev->get_key().as_string());
+
+                    samples.push_back(std::make_pair(name + "/packets",
+                                dev->get_tracker_packets_rrd()->get_minute_value(minute_start)));
+                    samples.push_back(std::make_pair(name + "/data",
+                                dev->get_tracker_data_rrd()->get_minute_value(minute_start)));
+                }
+            }
+        }
+    }
+
+    kis_lock_guard<kis_mutex> lk(mutex, "kis_rrd_archive gather_minute");
+
+    for (const auto& s : samples)
+        append_sample(s.first, in_minute, s.second);
+}
+
+void kis_rrd_archive::append_sample(const std::string& in_series, int64_t in_minute,
+        int64_t in_value) {
+    auto& p = pending[in_series];
+
+    // Blocks hold contiguous minutes of one day
+    if (p.values.size() &&
+            (p.start_minute + (int64_t) p.values.size() != in_minute ||
+             p.start_minute / minutes_per_day != in_minute / minutes_per_day)) {
+        write_block(in_series, p);
+        p.values.clear();
+    }
+
+    if (p.values.empty())
+        p.start_minute = in_minute;
+
+    p.values.push_back(in_value);
+}
+
+void kis_rrd_archive::write_block(const std::string& in_series,
+        const pending_series& in_pending) {
+    if (archive_fd < 0 || in_pending.values.empty())
+        return;
+
+    std::string payload;
+    payload.reserve(in_series.length() + 14 + in_pending.values.size() * 2);
+
+    put_u16(payload, std::min(in_series.length(), (size_t) 0xFFFF));
+    payload.append(in_series, 0, 0xFFFF);
+    put_u64(payload, static_cast<uint64_t>(in_pending.start_minute));
+    put_u32(payload, in_pending.values.size());
+
+    int64_t prev = 0;
+
+    for (const auto& v : in_pending.values) {
+        put_varint(payload, v - prev);
+        prev = v;
+    }
+
+    std::string block;
+    block.reserve(block_header_len + payload.length());
+
+    put_u32(block, block_magic);
+    put_u32(block, payload.length());
+    put_u32(block, crc32_fast(payload.data(), payload.length()));
+    block.append(payload);
+
+    auto r = write(archive_fd, block.data(), block.length());
+
+    if (r != (ssize_t) block.length()) {
+        _MSG_ERROR("Unable to write to the RRD archive {}, no longer keeping long-term RRD "
+                "history: {}", archive_path, r < 0 ? kis_strerror_r(errno) : "short write");
+
+        // Drop a partial write so the file stays whole
+        if (r > 0 && ftruncate(archive_fd, archive_size) < 0)
+            _MSG_ERROR("Unable to truncate the RRD archive {}: {}", archive_path,
+                    kis_strerror_r(errno));
+
+        close(archive_fd);
+        archive_fd = -1;
+        return;
+    }
+
+    index[in_series].push_back(block_ref{in_pending.start_minute,
+            (uint32_t) in_pending.values.size(), archive_size, (uint32_t) payload.length()});
+
+    archive_size += block.length();
+}
+
+void kis_rrd_archive::flush_pending() {
+    kis_lock_guard<kis_mutex> lk(mutex, "kis_rrd_archive flush_pending");
+
+    for (const auto& p : pending)
+        write_block(p.first, p.second);
+
+    pending.clear();
+}
+
+std::vector<std::pair<bool, double>> kis_rrd_archive::query(const std::string& in_series,
+        time_t in_start, time_t in_end, time_t in_step) {
+    int64_t step_min = std::max((time_t) 1, in_step / 60);
+    int64_t start_min = in_start / 60;
+    int64_t end_min = in_end / 60;
+
+    if (end_min < start_min)
+        return {};
+
+    auto n_buckets = static_cast<size_t>((end_min - start_min) / step_min + 1);
+
+    if (n_buckets > max_query_buckets)
+        throw std::runtime_error(fmt::format("query would return more than {} values, use a "
+                    "larger step", max_query_buckets));
+
+    std::vector<double> sums(n_buckets, 0);
+    std::vector<uint32_t> counts(n_buckets, 0);
+
+    auto add_sample = [&](int64_t minute, int64_t value) {
+        if (minute < start_min || minute > end_min)
+            return;
+
+        auto b = (minute - start_min) / step_min;
+        sums[b] += value;
+        counts[b]++;
+    };
+
+    std::vector<block_ref> refs;
+    pending_series pend;
+    void *map = MAP_FAILED;
+    uint64_t map_size = 0;
+
+    {
+        kis_lock_guard<kis_mutex> lk(mutex, "kis_rrd_archive query");
+
+        auto ii = index.find(in_series);
+
+        if (ii != index.end()) {
+            for (const auto& r : ii->second) {
+                if (r.start_minute <= end_min && r.start_minute + r.count > start_min)
+                    refs.push_back(r);
+            }
+        }
+
+        auto pi = pending.find(in_series);
+        if (pi != pending.end())
+            pend = pi->second;
+
+        // The file is only appended to, so the mapped length stays valid once unlocked
+        if (refs.size() && archive_fd >= 0) {
+            map_size = archive_size;
+            map = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, archive_fd, 0);
+        }
+    }
+
+    if (map != MAP_FAILED) {
+        auto base = static_cast<const uint8_t *>(map);
+        block_info bi;
+
+        for (const auto& r : refs) {
+            if (!parse_block(base, r.offset, map_size, bi) || bi.series != in_series)
+                continue;
+
+            auto payload = base + r.offset + block_header_len;
+            if (crc32_fast(payload, bi.len) != get_u32(base + r.offset + 8))
+                continue;
+
+            auto p = bi.samples;
+            int64_t value = 0, delta;
+
+            for (uint32_t i = 0; i < bi.count; i++) {
+                if (!get_varint(p, bi.end, delta))
+                    break;
+
+                value += delta;
+                add_sample(bi.start_minute + i, value);
+            }
+        }
+
+        munmap(map, map_size);
+    }
+
+    for (size_t i = 0; i < pend.values.size(); i++)
+        add_sample(pend.start_minute + i, pend.values[i]);
+
+    std::vector<std::pair<bool, double>> ret;
+    ret.reserve(n_buckets);
+
+    for (size_t b = 0; b < n_buckets; b++) {
+        if (counts[b] == 0)
+            ret.push_back(std::make_pair(false, 0));
+        else
+            ret.push_back(std::make_pair(true, sums[b] / counts[b]));
+    }
+
+    return ret;
+}
+
+void kis_rrd_archive::query_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    if (!enabled)
+        throw std::runtime_error("long-term RRD history is not enabled, see 'rrd_archive' "
+                "in kismet_memory.conf");
+
+    auto series_k = con->http_variables().find("series");
+    if (series_k == con->http_variables().end())
+        throw std::runtime_error("expected 'series'");
+
+    time_t now = time(0);
+    time_t start = now - 86400, end = now, step = 60;
+
+    // Negative times are relative to now
+    auto start_k = con->http_variables().find("start");
+    if (start_k != con->http_variables().end()) {
+        auto v = string_to_n_dfl<int64_t>(start_k->second, 0);
+        start = v < 0 ? now + v : v;
+    }
+
+    auto end_k = con->http_variables().find("end");
+    if (end_k != con->http_variables().end()) {
+        auto v = string_to_n_dfl<int64_t>(end_k->second, 0);
+        end = v <= 0 ? now + v : v;
+    }
+
+    auto step_k = con->http_variables().find("step");
+    if (step_k != con->http_variables().end())
+        step = std::max((int64_t) 60, string_to_n_dfl<int64_t>(step_k->second, 60));
+
+    step = (step / 60) * 60;
+    start = (start / 60) * 60;
+
+    auto values = query(series_k->second, start, end, step);
+
+    std::ostream os(&con->response_stream());
+
+    os << "{\"kismet.rrd_archive.series\": \"";
+    json_adapter::write_escaped(os, series_k->second);
+    os << "\", \"kismet.rrd_archive.start\": " << start;
+    os << ", \"kismet.rrd_archive.step\": " << step;
+    os << ", \"kismet.rrd_archive.values\": [";
+
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i != 0)
+            os << ",";
+
+        if (values[i].first)
+            os << fmt::format("{}", values[i].second);
+        else
+            os << "null";
+    }
+
+    os << "]}";
+}
+
+void kis_rrd_archive::series_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    if (!enabled)
+        throw std::runtime_error("long-term RRD history is not enabled, see 'rrd_archive' "
+                "in kismet_memory.conf");
+
+    // First and last minute of each series
+    std::map<std::string, std::pair<int64_t, int64_t>> spans;
+
+    {
+        kis_lock_guard<kis_mutex> lk(mutex, "kis_rrd_archive series");
+
+        auto extend = [&](const std::string& name, int64_t first, int64_t last) {
+            auto si = spans.find(name);
+
+            if (si == spans.end()) {
+                spans[name] = std::make_pair(first, last);
+            } else {
+                si->second.first = std::min(si->second.first, first);
+                si->second.second = std::max(si->second.second, last);
+            }
+        };
+
+        for (const auto& i : index) {
+            for (const auto& r : i.second)
+                extend(i.first, r.start_minute, r.start_minute + r.count - 1);
+        }
+
+        for (const auto& p : pending) {
+            if (p.second.values.size())
+                extend(p.first, p.second.start_minute,
+                        p.second.start_minute + p.second.values.size() - 1);
+        }
+    }
+
+    std::ostream os(&con->response_stream());
+
+    os << "[";
+
+    bool first = true;
+
+    for (const auto& s : spans) {
+        if (!first)
+            os << ",";
+        first = false;
+
+        os << "{\"kismet.rrd_archive.series\": \"";
+        json_adapter::write_escaped(os, s.first);
+        os << "\", \"kismet.rrd_archive.first_time\": " << s.second.first * 60;
+        os << ", \"kismet.rrd_archive.last_time\": " << s.second.second * 60 << "}";
+    }
+
+    os << "]";
+}
+
@@ -0,0 +1,131 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_RRD_ARCHIVE_H__
+#define __KIS_RRD_ARCHIVE_H__
+
+#include "config.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "globalregistry.h"
+#include "kis_mutex.h"
+#include "kis_net_beast_httpd.h"
+
+// Long-term RRD history
+//
+// RRDs only hold the past day in memory.  With rrd_archive enabled, the per-minute
+// values of the datasource, channel, and selected device RRDs are collected as each
+// minute completes and appended to an archive file, so trends can be queried over
+// weeks or months without polling the server.
+//
+// Samples of each series are gathered in memory into a block per series per day, and
+// blocks are written every rrd_archive_flush seconds and at shutdown.  Blocks are
+// delta and varint encoded and checksummed; the file is only appended to, and a block
+// torn by a crash is dropped when the file is next opened.
+//
+// Only block headers are indexed in memory; queries map the file and decode the
+// blocks covering the requested range.
+//
+// Series are named by what they record, such as datasource/<uuid>/packets,
+// channel/<frequency>/devices, or device/<key>/data.
+class kis_rrd_archive : public lifetime_global, public deferred_startup {
+public:
+    static std::string global_name() { return "RRD_ARCHIVE"; }
+
+    static std::shared_ptr<kis_rrd_archive> create_rrd_archive() {
+        std::shared_ptr<kis_rrd_archive> mon(new kis_rrd_archive());
+        Globalreg::globalreg->register_lifetime_global(mon);
+        Globalreg::globalreg->register_deferred_global(mon);
+        Globalreg::globalreg->insert_global(global_name(), mon);
+        return mon;
+    }
+
+private:
+    kis_rrd_archive();
+
+public:
+    virtual ~kis_rrd_archive();
+
+    virtual void trigger_deferred_startup() override;
+    virtual void trigger_deferred_shutdown() override;
+
+    // Per-minute values of a series between two times, averaged into buckets of
+    // in_step seconds; buckets with no samples are returned as unset
+    std::vector<std::pair<bool, double>> query(const std::string& in_series, time_t in_start,
+            time_t in_end, time_t in_step);
+
+protected:
+    // Block of a series in the file
+    struct block_ref {
+        int64_t start_minute;
+        uint32_t count;
+        uint64_t offset;
+        uint32_t len;
+    };
+
+    // Samples of a series not yet written; one day at most
+    struct pending_series {
+        int64_t start_minute;
+        std::vector<int64_t> values;
+    };
+
+    bool open_archive();
+
+    // Collect the value of every series for a completed minute
+    void gather_minute(int64_t in_minute);
+
+    void append_sample(const std::string& in_series, int64_t in_minute, int64_t in_value);
+
+    // Write the pending samples of a series as a block; mutex must be held
+    void write_block(const std::string& in_series, const pending_series& in_pending);
+    void flush_pending();
+
+    void query_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
+    void series_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
+
+    kis_mutex mutex;
+
+    bool enabled;
+    bool archive_datasources;
+    bool archive_channels;
+    std::vector<std::string> archive_devices;
+
+    std::string archive_path;
+    int archive_fd;
+    uint64_t archive_size;
+
+    time_t flush_interval;
+    time_t last_flush;
+
+    // Last minute gathered
+    int64_t last_minute;
+
+    std::unordered_map<std::string, std::vector<block_ref>> index;
+    std::map<std::string, pending_series> pending;
+
+    int gather_timer;
+};
+
+#endif
+
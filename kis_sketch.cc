@@ -0,0 +1,135 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "kis_sketch.h"
+
+uint64_t kis_sketch_hash(uint64_t in_value) {
+    // splitmix64 finalizer
+    in_value += 0x9E3779B97F4A7C15ULL;
+    in_value = (in_value ^ (in_value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    in_value = (in_value ^ (in_value >> 27)) * 0x94D049BB133111EBULL;
+    return in_value ^ (in_value >> 31);
+}
+
+kis_hll_sketch::kis_hll_sketch(unsigned int in_precision) :
+    precision{std::min(std::max(in_precision, 4U), 18U)},
+    registers(1U << precision, 0) { }
+
+void kis_hll_sketch::add(uint64_t in_hash) {
+    auto idx = in_hash >> (64 - precision);
+
+    // The remaining bits, with a guard bit so an all-zero remainder still has a rank
+    auto w = (in_hash << precision) | (1ULL << (precision - 1));
+    uint8_t rank = __builtin_clzll(w) + 1;
+
+    if (rank > registers[idx])
+        registers[idx] = rank;
+}
+
+void kis_hll_sketch::merge(const kis_hll_sketch& in_sketch) {
+    if (in_sketch.precision != precision)
+        return;
+
+    for (size_t i = 0; i < registers.size(); i++)
+        registers[i] = std::max(registers[i], in_sketch.registers[i]);
+}
+
+uint64_t kis_hll_sketch::estimate() const {
+    double m = registers.size();
+    double sum = 0;
+    unsigned int zeros = 0;
+
+    for (auto r : registers) {
+        sum += ldexp(1.0, -r);
+
+        if (r == 0)
+            zeros++;
+    }
+
+    double alpha;
+
+    switch (registers.size()) {
+        case 16:
+            alpha = 0.673;
+            break;
+        case 32:
+            alpha = 0.697;
+            break;
+        case 64:
+            alpha = 0.709;
+            break;
+        default:
+            alpha = 0.7213 / (1 + 1.079 / m);
+            break;
+    }
+
+    double e = alpha * m * m / sum;
+
+    // Small cardinalities are better estimated from the registers still unset
+    if (e <= 2.5 * m && zeros != 0)
+        e = m * log(m / zeros);
+
+    return static_cast<uint64_t>(e + 0.5);
+}
+
+void kis_hll_sketch::clear() {
+    std::fill(registers.begin(), registers.end(), 0);
+}
+
+kis_count_min_sketch::kis_count_min_sketch(unsigned int in_width, unsigned int in_depth) :
+    width{std::max(in_width, 1U)},
+    depth{std::max(in_depth, 1U)},
+    counters(width * depth, 0) { }
+
+void kis_count_min_sketch::add(uint64_t in_hash, uint32_t in_count) {
+    // Each row indexes by a different combination of the two halves of the hash
+    uint32_t h1 = in_hash & 0xFFFFFFFF;
+    uint32_t h2 = (in_hash >> 32) | 1;
+
+    for (unsigned int d = 0; d < depth; d++) {
+        auto& c = counters[d * width + ((h1 + d * h2) % width)];
+
+        if (c > std::numeric_limits<uint32_t>::max() - in_count)
+            c = std::numeric_limits<uint32_t>::max();
+        else
+            c += in_count;
+    }
+}
+
+uint64_t kis_count_min_sketch::estimate(uint64_t in_hash) const {
+    uint32_t h1 = in_hash & 0xFFFFFFFF;
+    uint32_t h2 = (in_hash >> 32) | 1;
+
+    uint32_t r = std::numeric_limits<uint32_t>::max();
+
+    for (unsigned int d = 0; d < depth; d++)
+        r = std::min(r, counters[d * width + ((h1 + d * h2) % width)]);
+
+    return r;
+}
+
+void kis_count_min_sketch::clear() {
+    std::fill(counters.begin(), counters.end(), 0);
+}
@@ -0,0 +1,75 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_SKETCH_H__
+#define __KIS_SKETCH_H__
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <vector>
+
+// Fixed size probabilistic summaries of a stream of values, for counting things which
+// are too numerous to track one record each.  Values are added as 64 bit hashes; use
+// kis_sketch_hash to spread values which aren't already well distributed, such as MAC
+// addresses.
+
+uint64_t kis_sketch_hash(uint64_t in_value);
+
+// HyperLogLog estimate of the number of distinct values seen.  Holds 2^precision one
+// byte registers; the standard error is about 1.04 / sqrt(2^precision), so the
+// default precision of 12 uses 4KB and is accurate to about 1.6%.
+class kis_hll_sketch {
+public:
+    kis_hll_sketch(unsigned int in_precision = 12);
+
+    void add(uint64_t in_hash);
+
+    // Fold another sketch of the same precision into this one
+    void merge(const kis_hll_sketch& in_sketch);
+
+    uint64_t estimate() const;
+
+    void clear();
+
+protected:
+    unsigned int precision;
+    std::vector<uint8_t> registers;
+};
+
+// Count-min estimate of how many times each value was seen.  Estimates are never
+// low, and are high by at most 2/width of the total count with a probability of
+// 1 - 2^-depth.
+class kis_count_min_sketch {
+public:
+    kis_count_min_sketch(unsigned int in_width = 2048, unsigned int in_depth = 4);
+
+    void add(uint64_t in_hash, uint32_t in_count = 1);
+
+    uint64_t estimate(uint64_t in_hash) const;
+
+    void clear();
+
+protected:
+    unsigned int width, depth;
+    std::vector<uint32_t> counters;
+};
+
+#endif
+
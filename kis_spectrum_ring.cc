@@ -0,0 +1,169 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <string.h>
+
+#include <cmath>
+
+#include "endian_magic.h"
+#include "kis_external_packet.h"
+#include "kis_spectrum_ring.h"
+
+spectrum_ring::spectrum_ring(size_t in_capacity, size_t in_max_bins, bool in_int8) :
+    capacity{in_capacity == 0 ? 1 : in_capacity},
+    max_bins{in_max_bins == 0 ? 1 : in_max_bins},
+    use_int8{in_int8},
+    head{0},
+    num_segments{0},
+    next_consumer_id{1} {
+
+    mutex.set_name("spectrum_ring");
+}
+
+void spectrum_ring::add_sweep(uint64_t in_ts_sec, uint32_t in_ts_usec, uint32_t in_sweep,
+        uint64_t in_start_hz, double in_bin_hz, const float *in_bins, size_t in_num_bins) {
+
+    if (in_num_bins == 0)
+        return;
+
+    // Peak hold across each group of decimated bins
+    size_t factor = (in_num_bins + max_bins - 1) / max_bins;
+    size_t num_bins = (in_num_bins + factor - 1) / factor;
+
+    auto frame = std::string(frame_header_sz + num_bins * (use_int8 ? 1 : sizeof(float)), 0);
+    auto data = &frame[0];
+
+    uint32_t u32;
+    uint64_t u64;
+    double bin_hz = in_bin_hz * factor;
+
+    u32 = kis_htole32(frame_magic);
+    memcpy(data, &u32, 4);
+    data[4] = 1;
+    data[5] = use_int8 ? KIS_EXTERNAL_SPECTRUM_INT8 : KIS_EXTERNAL_SPECTRUM_FLOAT32;
+    u32 = kis_htole32((uint32_t) num_bins);
+    memcpy(data + 8, &u32, 4);
+    u32 = kis_htole32(in_sweep);
+    memcpy(data + 12, &u32, 4);
+    u32 = kis_htole32((uint32_t) in_ts_sec);
+    memcpy(data + 16, &u32, 4);
+    u32 = kis_htole32(in_ts_usec);
+    memcpy(data + 20, &u32, 4);
+    u64 = kis_htole64(in_start_hz);
+    memcpy(data + 24, &u64, 8);
+    memcpy(&u64, &bin_hz, 8);
+    u64 = kis_htole64(u64);
+    memcpy(data + 32, &u64, 8);
+
+    auto bins = data + frame_header_sz;
+
+    for (size_t b = 0; b < num_bins; b++) {
+        auto first = b * factor;
+        auto last = std::min(first + factor, in_num_bins);
+
+        float peak = in_bins[first];
+        for (auto i = first + 1; i < last; i++) {
+            if (in_bins[i] > peak)
+                peak = in_bins[i];
+        }
+
+        if (use_int8) {
+            // Half-dB steps, pinned to the ends of the range
+            float x = (peak - KIS_EXTERNAL_SPECTRUM_INT8_BASE) * 2;
+            int v;
+
+            if (!(x > -128))
+                v = -128;
+            else if (x > 127)
+                v = 127;
+            else
+                v = (int) std::lround(x);
+
+            bins[b] = (char) (int8_t) v;
+        } else {
+            memcpy(&u32, &peak, 4);
+            u32 = kis_htole32(u32);
+            memcpy(bins + (b * sizeof(float)), &u32, 4);
+        }
+    }
+
+    auto shared_frame = std::make_shared<const std::string>(std::move(frame));
+
+    std::vector<consumer_t> notify;
+
+    {
+        kis_lock_guard<kis_mutex> lk(mutex, "spectrum_ring add_sweep");
+
+        // Slots are only allocated once the source reports spectrum
+        if (frames.size() < capacity) {
+            frames.push_back(shared_frame);
+        } else {
+            frames[head] = shared_frame;
+            head = (head + 1) % capacity;
+        }
+
+        num_segments++;
+
+        notify.reserve(consumers.size());
+        for (const auto& c : consumers)
+            notify.push_back(c.second);
+    }
+
+    for (const auto& c : notify)
+        c(shared_frame);
+}
+
+std::vector<spectrum_ring::frame_t> spectrum_ring::get_backlog(size_t in_max) {
+    kis_lock_guard<kis_mutex> lk(mutex, "spectrum_ring get_backlog");
+
+    auto num = std::min(in_max, frames.size());
+
+    std::vector<frame_t> ret;
+    ret.reserve(num);
+
+    // head is the oldest frame once the ring has filled, and 0 until then
+    for (size_t i = frames.size() - num; i < frames.size(); i++)
+        ret.push_back(frames[(head + i) % frames.size()]);
+
+    return ret;
+}
+
+unsigned int spectrum_ring::add_consumer(consumer_t in_cb, size_t in_backlog) {
+    kis_lock_guard<kis_mutex> lk(mutex, "spectrum_ring add_consumer");
+
+    // Replay the backlog under the lock so no new frame can slip in between
+    for (const auto& f : get_backlog(in_backlog))
+        in_cb(f);
+
+    auto id = next_consumer_id++;
+    consumers[id] = in_cb;
+
+    return id;
+}
+
+void spectrum_ring::remove_consumer(unsigned int in_id) {
+    kis_lock_guard<kis_mutex> lk(mutex, "spectrum_ring remove_consumer");
+    consumers.erase(in_id);
+}
+
+uint64_t spectrum_ring::get_num_segments() {
+    kis_lock_guard<kis_mutex> lk(mutex, "spectrum_ring get_num_segments");
+    return num_segments;
+}
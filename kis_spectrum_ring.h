@@ -0,0 +1,97 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_SPECTRUM_RING_H__
+#define __KIS_SPECTRUM_RING_H__
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kis_mutex.h"
+
+// Compact ring of recent spectrum sweeps for a source
+//
+// Sweep segments wider than max_bins are decimated with a peak hold, so narrow signals
+// survive, and each segment is encoded once into a binary frame which is kept in the
+// ring and handed to every consumer without copying; streaming a sweep to any number of
+// websocket clients costs one encode.  Bins are stored as int8 in half-dB steps from
+// -64 dBm (covering -128 to -0.5 dBm), or as float32.
+//
+// Frames are little endian, so javascript can map the bins directly onto a typed array:
+//
+//   uint32   magic, 'KSPC'
+//   uint8    version, 1
+//   uint8    format, 1 float32 or 2 int8
+//   uint16   reserved
+//   uint32   number of bins
+//   uint32   sweep counter, shared by every segment of a sweep
+//   uint32   timestamp, seconds
+//   uint32   timestamp, microseconds
+//   uint64   frequency of the first bin, in Hz
+//   float64  bin width, in Hz
+//   bins, at offset 40
+
+class spectrum_ring {
+public:
+    using frame_t = std::shared_ptr<const std::string>;
+    using consumer_t = std::function<void (frame_t)>;
+
+    const static uint32_t frame_magic = 0x4B535043;
+    const static size_t frame_header_sz = 40;
+
+    spectrum_ring(size_t in_capacity, size_t in_max_bins, bool in_int8);
+
+    // Add a segment of dBm bins
+    void add_sweep(uint64_t in_ts_sec, uint32_t in_ts_usec, uint32_t in_sweep,
+            uint64_t in_start_hz, double in_bin_hz, const float *in_bins, size_t in_num_bins);
+
+    // Frames in the ring, oldest first, up to in_max
+    std::vector<frame_t> get_backlog(size_t in_max);
+
+    // Consumers are called with each new frame, from the thread adding the sweep; the
+    // most recent in_backlog frames already in the ring are passed to the consumer first
+    unsigned int add_consumer(consumer_t in_cb, size_t in_backlog = 0);
+    void remove_consumer(unsigned int in_id);
+
+    uint64_t get_num_segments();
+
+protected:
+    kis_mutex mutex;
+
+    size_t capacity;
+    size_t max_bins;
+    bool use_int8;
+
+    std::vector<frame_t> frames;
+    size_t head;
+
+    uint64_t num_segments;
+
+    std::map<unsigned int, consumer_t> consumers;
+    unsigned int next_consumer_id;
+};
+
+#endif
+
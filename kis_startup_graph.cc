@@ -0,0 +1,193 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "configfile.h"
+#include "kis_startup_graph.h"
+#include "messagebus.h"
+#include "util.h"
+
+kis_startup_graph::kis_startup_graph() :
+    running{0},
+    running_essential{0},
+    sealed{false},
+    shutdown{false} {
+
+    auto n_threads = Globalreg::globalreg->kismet_config->fetch_opt_uint("startup_threads", 0);
+
+    if (n_threads == 0)
+        n_threads = std::min(std::max(std::thread::hardware_concurrency(), 1U), 4U);
+
+    for (unsigned int i = 0; i < n_threads; i++)
+        threads.push_back(std::thread([this]() {
+                    thread_set_process_name("startup");
+                    worker();
+                    }));
+}
+
+kis_startup_graph::~kis_startup_graph() {
+    Globalreg::globalreg->remove_global(global_name());
+
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        shutdown = true;
+    }
+
+    cv.notify_all();
+
+    for (auto& t : threads)
+        if (t.joinable())
+            t.join();
+}
+
+void kis_startup_graph::add(const std::string& in_name, const std::vector<std::string>& in_deps,
+        std::function<void ()> in_func, bool in_essential) {
+    auto graph = Globalreg::fetch_global_as<kis_startup_graph>();
+
+    if (graph == nullptr) {
+        in_func();
+        return;
+    }
+
+    graph->add_task(in_name, in_deps, in_func, in_essential);
+}
+
+void kis_startup_graph::add_task(const std::string& in_name, const std::vector<std::string>& in_deps,
+        std::function<void ()> in_func, bool in_essential) {
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+
+        startup_task t;
+        t.name = in_name;
+        t.deps = in_deps;
+        t.func = in_func;
+        t.essential = in_essential;
+
+        pending.push_back(t);
+        added.insert(in_name);
+    }
+
+    cv.notify_all();
+}
+
+std::list<kis_startup_graph::startup_task>::iterator kis_startup_graph::next_task() {
+    for (auto i = pending.begin(); i != pending.end(); ++i) {
+        bool ready = true;
+
+        for (const auto& d : i->deps) {
+            if (completed.find(d) != completed.end())
+                continue;
+
+            if (sealed && added.find(d) == added.end())
+                continue;
+
+            ready = false;
+            break;
+        }
+
+        if (ready)
+            return i;
+    }
+
+    // Nothing is runnable and nothing running can complete a dependency, so the
+    // remaining tasks depend on each other
+    if (sealed && running == 0 && pending.size() != 0) {
+        _MSG_ERROR("Startup task '{}' has a circular dependency, running it anyway",
+                pending.front().name);
+        return pending.begin();
+    }
+
+    return pending.end();
+}
+
+void kis_startup_graph::worker() {
+    std::unique_lock<std::mutex> lk(mutex);
+
+    while (!shutdown) {
+        auto ti = next_task();
+
+        if (ti == pending.end()) {
+            cv.wait(lk);
+            continue;
+        }
+
+        auto task = *ti;
+        pending.erase(ti);
+
+        running++;
+        if (task.essential)
+            running_essential++;
+
+        lk.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+
+        try {
+            task.func();
+        } catch (const std::exception& e) {
+            _MSG_ERROR("Startup task '{}' failed: {}", task.name, e.what());
+        }
+
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+        _MSG_DEBUG("Startup task '{}' completed in {:.3f} seconds", task.name, elapsed.count());
+
+        lk.lock();
+
+        running--;
+        if (task.essential)
+            running_essential--;
+
+        completed.insert(task.name);
+
+        cv.notify_all();
+    }
+}
+
+void kis_startup_graph::wait_essential() {
+    std::unique_lock<std::mutex> lk(mutex);
+
+    sealed = true;
+    cv.notify_all();
+
+    cv.wait(lk, [this]() {
+            if (running_essential != 0)
+                return false;
+
+            for (const auto& t : pending)
+                if (t.essential)
+                    return false;
+
+            return true;
+            });
+}
+
+void kis_startup_graph::wait_all() {
+    std::unique_lock<std::mutex> lk(mutex);
+
+    sealed = true;
+    cv.notify_all();
+
+    cv.wait(lk, [this]() {
+            return running == 0 && pending.size() == 0;
+            });
+}
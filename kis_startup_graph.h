@@ -0,0 +1,110 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_STARTUP_GRAPH_H__
+#define __KIS_STARTUP_GRAPH_H__
+
+#include "config.h"
+
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "globalregistry.h"
+
+// Background startup tasks
+//
+// Slow startup work which does not have to be complete before the server runs, such
+// as indexing the manufacturer, ICAO, and Bluetooth reference databases, is added as
+// a named task.  Tasks run on a small pool of threads as soon as every task they
+// depend on has completed; tasks may be added at any point, and a task may depend on
+// one which has not been added yet.
+//
+// Essential tasks must complete before the deferred startup of the server, and so
+// before any datasource opens; every other task keeps running while capture starts.
+// Code using the result of a non-essential task has to handle it being incomplete.
+
+class kis_startup_graph : public lifetime_global {
+public:
+    static std::string global_name() { return "KIS_STARTUP_GRAPH"; }
+
+    static std::shared_ptr<kis_startup_graph> create_startup_graph() {
+        std::shared_ptr<kis_startup_graph> mon(new kis_startup_graph());
+        Globalreg::globalreg->register_lifetime_global(mon);
+        Globalreg::globalreg->insert_global(global_name(), mon);
+        return mon;
+    }
+
+private:
+    kis_startup_graph();
+
+public:
+    virtual ~kis_startup_graph();
+
+    // Add a task; without a startup graph (in tools which do not create one), the
+    // task runs immediately on the calling thread
+    static void add(const std::string& in_name, const std::vector<std::string>& in_deps,
+            std::function<void ()> in_func, bool in_essential = false);
+
+    void add_task(const std::string& in_name, const std::vector<std::string>& in_deps,
+            std::function<void ()> in_func, bool in_essential = false);
+
+    // Block until every essential task, and everything it depends on, has completed.
+    // Every task the server creates at startup has been added by now, so dependencies
+    // on tasks which were never added are dropped from here on
+    void wait_essential();
+
+    // Block until every task has completed
+    void wait_all();
+
+protected:
+    struct startup_task {
+        std::string name;
+        std::vector<std::string> deps;
+        std::function<void ()> func;
+        bool essential;
+    };
+
+    void worker();
+
+    // Next runnable task, or the end of the pending list; called with the mutex held
+    std::list<startup_task>::iterator next_task();
+
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    std::list<startup_task> pending;
+    std::set<std::string> added;
+    std::set<std::string> completed;
+    unsigned int running;
+    unsigned int running_essential;
+
+    // No more tasks from the startup of the server are expected
+    bool sealed;
+    bool shutdown;
+
+    std::vector<std::thread> threads;
+};
+
+#endif
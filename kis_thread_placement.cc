@@ -0,0 +1,292 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(SYS_LINUX)
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <thread>
+
+#include "configfile.h"
+#include "kis_thread_placement.h"
+#include "messagebus.h"
+#include "util.h"
+
+kis_thread_placement::kis_thread_placement() :
+    placement_policy{policy::none},
+    node{-1},
+    n_allowed{1} {
+
+    placement_mutex.set_name("kis_thread_placement");
+
+    auto policy_opt =
+        str_lower(Globalreg::globalreg->kismet_config->fetch_opt_dfl("thread_placement", "none"));
+
+    if (policy_opt == "numa") {
+        placement_policy = policy::numa;
+    } else if (policy_opt == "core") {
+        placement_policy = policy::core;
+    } else if (policy_opt != "none") {
+        _MSG_ERROR("Unknown thread_placement '{}', expected none, numa, or core; threads "
+                "will not be pinned.", policy_opt);
+    }
+
+    // CPUs available to the process
+    std::vector<int> allowed;
+
+#if defined(SYS_LINUX)
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &mask))
+                allowed.push_back(c);
+        }
+    }
+#endif
+
+    if (allowed.size() == 0) {
+        for (unsigned int c = 0; c < std::max(1U, std::thread::hardware_concurrency()); c++)
+            allowed.push_back(static_cast<int>(c));
+    }
+
+    n_allowed = static_cast<unsigned int>(allowed.size());
+
+    // Usable CPUs of each node
+    std::map<int, std::vector<int>> node_cpus;
+
+#if defined(SYS_LINUX)
+    auto dir = opendir("/sys/devices/system/node");
+
+    if (dir != nullptr) {
+        struct dirent *de;
+
+        while ((de = readdir(dir)) != nullptr) {
+            if (strncmp(de->d_name, "node", 4) != 0 || de->d_name[4] < '0' || de->d_name[4] > '9')
+                continue;
+
+            auto n = atoi(de->d_name + 4);
+
+            std::ifstream cpulist(fmt::format("/sys/devices/system/node/{}/cpulist", de->d_name));
+            std::string list;
+
+            if (!std::getline(cpulist, list))
+                continue;
+
+            std::vector<int> usable;
+
+            for (auto c : parse_cpu_list(list)) {
+                if (std::binary_search(allowed.begin(), allowed.end(), c))
+                    usable.push_back(c);
+            }
+
+            if (usable.size())
+                node_cpus[n] = usable;
+        }
+
+        closedir(dir);
+    }
+#endif
+
+    auto node_opt = Globalreg::globalreg->kismet_config->fetch_opt_int("thread_placement_node", -1);
+
+    if (node_cpus.size() == 0) {
+        // Without a topology every available CPU is treated as one node
+        cpus = allowed;
+
+        if (node_opt >= 0)
+            _MSG_ERROR("Could not read the NUMA topology from /sys/devices/system/node, "
+                    "ignoring thread_placement_node={}", node_opt);
+    } else if (node_opt >= 0) {
+        auto ni = node_cpus.find(node_opt);
+
+        if (ni == node_cpus.end()) {
+            _MSG_ERROR("thread_placement_node={} has no CPUs available to Kismet, "
+                    "placing threads on all available CPUs instead", node_opt);
+            cpus = allowed;
+        } else {
+            node = ni->first;
+            cpus = ni->second;
+        }
+    } else {
+        // The node with the most available CPUs
+        for (const auto& ni : node_cpus) {
+            if (ni.second.size() > cpus.size()) {
+                node = ni.first;
+                cpus = ni.second;
+            }
+        }
+    }
+
+    if (placement_policy != policy::none && node >= 0)
+        _MSG_INFO("Placing Kismet threads on NUMA node {}, CPUs {} ({} mode)",
+                node, format_cpu_list(cpus), get_policy_name());
+    else if (placement_policy != policy::none)
+        _MSG_INFO("Placing Kismet threads on CPUs {} ({} mode)",
+                format_cpu_list(cpus), get_policy_name());
+}
+
+kis_thread_placement::~kis_thread_placement() {
+    Globalreg::globalreg->remove_global(global_name());
+}
+
+std::string kis_thread_placement::get_policy_name() const {
+    switch (placement_policy) {
+        case policy::numa:
+            return "numa";
+        case policy::core:
+            return "core";
+        default:
+            return "none";
+    }
+}
+
+void kis_thread_placement::place_current_thread(const std::string& in_name,
+        thread_role in_role, unsigned int in_index) {
+    auto placer = Globalreg::fetch_global_as<kis_thread_placement>();
+
+    if (placer != nullptr)
+        placer->place_thread(in_name, in_role, in_index);
+}
+
+void kis_thread_placement::place_thread(const std::string& in_name, thread_role in_role,
+        unsigned int in_index) {
+    placement p;
+
+    p.name = in_name;
+    p.node = node;
+
+    switch (in_role) {
+        case thread_role::packet:
+            p.role = "packet";
+            break;
+        case thread_role::io:
+            p.role = "io";
+            break;
+        case thread_role::timer:
+            p.role = "timer";
+            break;
+        case thread_role::eventbus:
+            p.role = "eventbus";
+            break;
+    }
+
+    std::vector<int> target;
+
+    if (placement_policy == policy::core && in_role == thread_role::packet && cpus.size())
+        target.push_back(cpus[in_index % cpus.size()]);
+    else if (placement_policy != policy::none)
+        target = cpus;
+
+#if defined(SYS_LINUX)
+    p.tid = static_cast<pid_t>(syscall(SYS_gettid));
+
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+
+    if (target.size()) {
+        for (auto c : target)
+            CPU_SET(c, &mask);
+
+        auto r = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+
+        if (r != 0)
+            _MSG_ERROR("Could not pin thread '{}' to CPUs {}: {}", in_name,
+                    format_cpu_list(target), kis_strerror_r(r));
+
+        CPU_ZERO(&mask);
+    }
+
+    // Report the affinity the thread actually has
+    std::vector<int> actual;
+
+    if (pthread_getaffinity_np(pthread_self(), sizeof(mask), &mask) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &mask))
+                actual.push_back(c);
+        }
+    }
+
+    p.cpus = format_cpu_list(actual);
+#else
+    p.tid = getpid();
+    p.node = -1;
+    p.cpus = "";
+#endif
+
+    kis_lock_guard<kis_mutex> lk(placement_mutex, "kis_thread_placement place_thread");
+    placements.push_back(p);
+}
+
+std::vector<kis_thread_placement::placement> kis_thread_placement::get_placements() {
+    kis_lock_guard<kis_mutex> lk(placement_mutex, "kis_thread_placement get_placements");
+    return placements;
+}
+
+std::string kis_thread_placement::format_cpu_list(const std::vector<int>& in_cpus) {
+    std::string ret;
+
+    for (size_t i = 0; i < in_cpus.size(); i++) {
+        auto start = in_cpus[i];
+
+        while (i + 1 < in_cpus.size() && in_cpus[i + 1] == in_cpus[i] + 1)
+            i++;
+
+        if (ret.length())
+            ret += ",";
+
+        if (in_cpus[i] == start)
+            ret += fmt::format("{}", start);
+        else
+            ret += fmt::format("{}-{}", start, in_cpus[i]);
+    }
+
+    return ret;
+}
+
+std::vector<int> kis_thread_placement::parse_cpu_list(const std::string& in_list) {
+    std::vector<int> ret;
+
+    for (const auto& r : str_tokenize(in_list, ",")) {
+        int start, end;
+
+        if (sscanf(r.c_str(), "%d-%d", &start, &end) == 2) {
+            for (int c = start; c <= end; c++)
+                ret.push_back(c);
+        } else if (sscanf(r.c_str(), "%d", &start) == 1) {
+            ret.push_back(start);
+        }
+    }
+
+    std::sort(ret.begin(), ret.end());
+
+    return ret;
+}
@@ -0,0 +1,126 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_THREAD_PLACEMENT_H__
+#define __KIS_THREAD_PLACEMENT_H__
+
+#include "config.h"
+
+#include <sys/types.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "globalregistry.h"
+#include "kis_mutex.h"
+
+// Thread placement
+//
+// The packet threads, the IO threads which run the datasource IPC readers, and the
+// timer and event bus threads all touch the same device records.  On a multi-socket
+// system, letting the scheduler spread them over every socket means the records bounce
+// between the caches of each socket, so they may instead all be pinned to the CPUs of
+// one NUMA node:
+//
+//  none    threads are not pinned, placement is only reported
+//  numa    every server thread is pinned to the CPUs of one node
+//  core    as numa, and each packet thread is also pinned to its own CPU of the node
+//
+// The node is chosen with thread_placement_node, or defaults to the node with the most
+// CPUs available to the process.  CPUs outside the process affinity mask, such as from
+// taskset or a cgroup, are never used.
+//
+// Threads place themselves as they start, and every placed thread is reported by the
+// system monitor.
+class kis_thread_placement : public lifetime_global {
+public:
+    static std::string global_name() { return "KIS_THREAD_PLACEMENT"; }
+
+    static std::shared_ptr<kis_thread_placement> create_thread_placement() {
+        std::shared_ptr<kis_thread_placement> mon(new kis_thread_placement());
+        Globalreg::globalreg->register_lifetime_global(mon);
+        Globalreg::globalreg->insert_global(global_name(), mon);
+        return mon;
+    }
+
+private:
+    kis_thread_placement();
+
+public:
+    virtual ~kis_thread_placement();
+
+    enum class policy {
+        none, numa, core
+    };
+
+    enum class thread_role {
+        packet, io, timer, eventbus
+    };
+
+    struct placement {
+        std::string name;
+        std::string role;
+        pid_t tid;
+        int node;
+        std::string cpus;
+    };
+
+    // Place the calling thread; in_index spreads the threads of a role over the CPUs
+    // of the node.  Does nothing if placement has not been configured.
+    static void place_current_thread(const std::string& in_name, thread_role in_role,
+            unsigned int in_index);
+
+    // Number of CPUs the server threads run on, the default size of the thread pools;
+    // the CPUs of the node when threads are pinned, otherwise every available CPU
+    unsigned int get_num_cpus() const {
+        if (placement_policy == policy::none)
+            return n_allowed;
+        return static_cast<unsigned int>(cpus.size());
+    }
+
+    std::string get_policy_name() const;
+
+    int get_node() const {
+        return node;
+    }
+
+    std::vector<placement> get_placements();
+
+    // CPU list in the kernel cpulist format, such as 0-3,8-11
+    static std::string format_cpu_list(const std::vector<int>& in_cpus);
+    static std::vector<int> parse_cpu_list(const std::string& in_list);
+
+protected:
+    void place_thread(const std::string& in_name, thread_role in_role, unsigned int in_index);
+
+    kis_mutex placement_mutex;
+
+    policy placement_policy;
+
+    // Node threads are placed on, or -1 when the topology is unknown, and the usable
+    // CPUs of the node
+    int node;
+    std::vector<int> cpus;
+    unsigned int n_allowed;
+
+    std::vector<placement> placements;
+};
+
+#endif
+
@@ -0,0 +1,314 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "configfile.h"
+#include "fmt.h"
+#include "json_adapter.h"
+#include "kis_net_beast_httpd.h"
+#include "kis_trace.h"
+#include "messagebus.h"
+
+std::atomic<bool> kis_tracer::enabled{false};
+size_t kis_tracer::ring_size = 8192;
+std::atomic<unsigned int> kis_tracer::packet_sample_{0};
+
+namespace {
+
+// Exited threads whose rings are kept for the trace
+const size_t trace_max_exited_rings = 16;
+
+// Most distinct interned names
+const size_t trace_max_names = 4096;
+
+struct trace_registry {
+    kis_mutex mutex;
+    std::vector<std::shared_ptr<kis_trace_ring>> rings;
+    unsigned int next_tid = 1;
+
+    kis_shared_mutex name_mutex;
+    std::unordered_set<std::string> names;
+};
+
+trace_registry& registry() {
+    static trace_registry r;
+    return r;
+}
+
+// Flags the ring of a thread when the thread exits
+struct thread_ring_holder {
+    std::shared_ptr<kis_trace_ring> ring;
+
+    ~thread_ring_holder() {
+        if (ring != nullptr)
+            ring->exited = true;
+    }
+};
+
+thread_local thread_ring_holder thread_ring;
+
+struct trace_span_copy {
+    const char *cat;
+    const char *name;
+    uint64_t start_ns;
+    uint64_t dur_ns;
+    uint64_t arg;
+};
+
+}
+
+kis_trace_ring::kis_trace_ring(size_t in_size, unsigned int in_tid, const std::string& in_name) :
+    events{new kis_trace_event[in_size]},
+    mask{in_size - 1},
+    head{0},
+    tid{in_tid},
+    thread_name{in_name},
+    exited{false} {
+
+    for (size_t i = 0; i < in_size; i++) {
+        events[i].seq = 0;
+        events[i].cat = nullptr;
+        events[i].name = nullptr;
+        events[i].start_ns = 0;
+        events[i].dur_ns = 0;
+        events[i].arg = 0;
+    }
+}
+
+kis_tracer::kis_tracer() {
+    auto sz = Globalreg::globalreg->kismet_config->fetch_opt_uint("trace_buffer_size", 8192);
+
+    // Rings are indexed by mask, round up to a power of 2
+    ring_size = 64;
+    while (ring_size < sz && ring_size < (1UL << 24))
+        ring_size <<= 1;
+
+    auto sample = Globalreg::globalreg->kismet_config->fetch_opt_uint("trace_packet_sample", 64);
+
+    auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
+
+    httpd->register_route("/debug/trace", {"GET"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    std::ostream stream(&con->response_stream());
+
+                    double seconds = 10;
+
+                    auto si = con->http_variables().find("seconds");
+                    if (si != con->http_variables().end()) {
+                        try {
+                            seconds = std::stod(si->second);
+                        } catch (const std::exception& e) {
+                            throw std::runtime_error("invalid 'seconds' value");
+                        }
+                    }
+
+                    con->set_mime_type("application/json");
+
+                    write_chrome_trace(stream, seconds);
+                }, nullptr, nullptr, true));
+
+    if (Globalreg::globalreg->kismet_config->fetch_opt_bool("trace_enabled", true)) {
+        packet_sample_ = sample;
+        enabled = true;
+    } else {
+        _MSG_INFO("Tracing is disabled; /debug/trace will be empty.");
+    }
+}
+
+kis_tracer::~kis_tracer() {
+    enabled = false;
+    packet_sample_ = 0;
+
+    Globalreg::globalreg->remove_global(global_name());
+}
+
+std::shared_ptr<kis_trace_ring> kis_tracer::make_thread_ring() {
+    auto& r = registry();
+
+    std::string tname;
+
+#if defined(SYS_LINUX)
+    char nbuf[32];
+    if (pthread_getname_np(pthread_self(), nbuf, sizeof(nbuf)) == 0)
+        tname = nbuf;
+#endif
+
+    kis_lock_guard<kis_mutex> lk(r.mutex, "kis_tracer make_thread_ring");
+
+    auto tid = r.next_tid++;
+
+    if (tname.length() == 0)
+        tname = fmt::format("thread {}", tid);
+
+    auto ring = std::make_shared<kis_trace_ring>(ring_size, tid, tname);
+
+    // Drop the oldest rings of exited threads
+    size_t n_exited = 0;
+    for (const auto& er : r.rings)
+        if (er->exited)
+            n_exited++;
+
+    for (auto i = r.rings.begin(); i != r.rings.end() && n_exited > trace_max_exited_rings; ) {
+        if ((*i)->exited) {
+            i = r.rings.erase(i);
+            n_exited--;
+        } else {
+            ++i;
+        }
+    }
+
+    r.rings.push_back(ring);
+
+    return ring;
+}
+
+void kis_tracer::record(const char *in_cat, const char *in_name, uint64_t in_start_ns,
+        uint64_t in_end_ns, uint64_t in_arg) {
+    if (in_name == nullptr || !enabled.load(std::memory_order_relaxed))
+        return;
+
+    auto& ring = thread_ring.ring;
+
+    if (ring == nullptr)
+        ring = make_thread_ring();
+
+    auto h = ring->head.load(std::memory_order_relaxed);
+    auto& e = ring->events[h & ring->mask];
+
+    e.seq.store(2 * h + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    e.cat.store(in_cat, std::memory_order_relaxed);
+    e.name.store(in_name, std::memory_order_relaxed);
+    e.start_ns.store(in_start_ns, std::memory_order_relaxed);
+    e.dur_ns.store(in_end_ns > in_start_ns ? in_end_ns - in_start_ns : 0, std::memory_order_relaxed);
+    e.arg.store(in_arg, std::memory_order_relaxed);
+
+    e.seq.store(2 * h + 2, std::memory_order_release);
+    ring->head.store(h + 1, std::memory_order_release);
+}
+
+const char *kis_tracer::intern(const std::string& in_name) {
+    auto& r = registry();
+
+    {
+        std::shared_lock<kis_shared_mutex> lk(r.name_mutex);
+
+        auto i = r.names.find(in_name);
+        if (i != r.names.end())
+            return i->c_str();
+    }
+
+    kis_lock_guard<kis_shared_mutex> lk(r.name_mutex, "kis_tracer intern");
+
+    if (r.names.size() >= trace_max_names)
+        return "other";
+
+    // Set nodes are never moved, so the string stays put
+    return r.names.insert(in_name).first->c_str();
+}
+
+void kis_tracer::write_chrome_trace(std::ostream& stream, double in_seconds) {
+    std::vector<std::shared_ptr<kis_trace_ring>> rings;
+
+    {
+        auto& r = registry();
+        kis_lock_guard<kis_mutex> lk(r.mutex, "kis_tracer write_chrome_trace");
+        rings = r.rings;
+    }
+
+    auto now = now_ns();
+    uint64_t cutoff = 0;
+
+    if (in_seconds > 0 && in_seconds * 1e9 < now)
+        cutoff = now - (uint64_t) (in_seconds * 1e9);
+
+    auto pid = getpid();
+    bool first = true;
+
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    std::vector<trace_span_copy> spans;
+
+    for (const auto& ring : rings) {
+        spans.clear();
+
+        auto head = ring->head.load(std::memory_order_acquire);
+        auto n = std::min((uint64_t) ring->mask + 1, head);
+
+        for (uint64_t idx = head - n; idx < head; idx++) {
+            auto& e = ring->events[idx & ring->mask];
+
+            auto s1 = e.seq.load(std::memory_order_acquire);
+
+            // Overwritten or being written
+            if (s1 != 2 * idx + 2)
+                continue;
+
+            trace_span_copy c;
+            c.cat = e.cat.load(std::memory_order_relaxed);
+            c.name = e.name.load(std::memory_order_relaxed);
+            c.start_ns = e.start_ns.load(std::memory_order_relaxed);
+            c.dur_ns = e.dur_ns.load(std::memory_order_relaxed);
+            c.arg = e.arg.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (e.seq.load(std::memory_order_relaxed) != s1)
+                continue;
+
+            if (c.start_ns + c.dur_ns < cutoff)
+                continue;
+
+            spans.push_back(c);
+        }
+
+        if (spans.size() == 0)
+            continue;
+
+        if (!first)
+            stream << ",";
+        first = false;
+
+        stream << fmt::format("{{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":{},\"tid\":{},"
+                "\"args\":{{\"name\":\"{}\"}}}}", pid, ring->tid,
+                json_adapter::sanitize_string(ring->thread_name));
+
+        for (const auto& c : spans) {
+            stream << fmt::format(",{{\"ph\":\"X\",\"cat\":\"{}\",\"name\":\"{}\",\"pid\":{},"
+                    "\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}",
+                    c.cat, json_adapter::sanitize_string(c.name), pid, ring->tid,
+                    c.start_ns / 1000.0, c.dur_ns / 1000.0);
+
+            if (c.arg != 0)
+                stream << fmt::format(",\"args\":{{\"n\":{}}}", c.arg);
+
+            stream << "}";
+        }
+    }
+
+    stream << "]}";
+}
@@ -0,0 +1,156 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_TRACE_H__
+#define __KIS_TRACE_H__
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "globalregistry.h"
+#include "kis_mutex.h"
+
+// Lightweight always-on tracing
+//
+// Spans are recorded into a fixed-size ring per thread, so recording never takes a
+// lock or allocates once the ring of a thread exists; old spans are overwritten.
+// Readers copy the rings with a per-slot sequence number and skip any slot which
+// changed while it was being read.
+//
+// Span names and categories must outlive the tracer; use static strings, or intern
+// dynamic names (routes, timer names, event types) once with kis_tracer::intern.
+//
+// The last seconds of every ring are served from /debug/trace in the Chrome trace
+// event format, which can be loaded in chrome://tracing or Perfetto.
+
+struct kis_trace_event {
+    // Odd while being written, 2 * (index + 1) once complete
+    std::atomic<uint64_t> seq;
+
+    std::atomic<const char *> cat;
+    std::atomic<const char *> name;
+    std::atomic<uint64_t> start_ns;
+    std::atomic<uint64_t> dur_ns;
+    std::atomic<uint64_t> arg;
+};
+
+struct kis_trace_ring {
+    kis_trace_ring(size_t in_size, unsigned int in_tid, const std::string& in_name);
+
+    std::unique_ptr<kis_trace_event[]> events;
+    size_t mask;
+
+    // Index of the next event written, only written by the owning thread
+    std::atomic<uint64_t> head;
+
+    unsigned int tid;
+    std::string thread_name;
+
+    // The owning thread has exited; the ring is kept until enough newer threads
+    // have come and gone
+    std::atomic<bool> exited;
+};
+
+class kis_tracer : public lifetime_global {
+public:
+    static std::string global_name() { return "KIS_TRACER"; }
+
+    static std::shared_ptr<kis_tracer> create_tracer() {
+        std::shared_ptr<kis_tracer> mon(new kis_tracer());
+        Globalreg::globalreg->register_lifetime_global(mon);
+        Globalreg::globalreg->insert_global(global_name(), mon);
+        return mon;
+    }
+
+private:
+    kis_tracer();
+
+public:
+    virtual ~kis_tracer();
+
+    // Checked before anything is timed; false until the tracer is created and
+    // configured
+    static std::atomic<bool> enabled;
+
+    static uint64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Record a completed span on the ring of the calling thread
+    static void record(const char *in_cat, const char *in_name, uint64_t in_start_ns,
+            uint64_t in_end_ns, uint64_t in_arg);
+
+    // Stable copy of a dynamic name; once too many names have been interned, new
+    // names are all reported as 'other'
+    static const char *intern(const std::string& in_name);
+
+    // Trace every packet chain stage of 1 in N packets; 0 when tracing is disabled
+    static unsigned int packet_sample() {
+        return packet_sample_.load(std::memory_order_relaxed);
+    }
+
+    // Write every span which ended in the last in_seconds as a Chrome trace
+    void write_chrome_trace(std::ostream& stream, double in_seconds);
+
+protected:
+    static size_t ring_size;
+    static std::atomic<unsigned int> packet_sample_;
+
+    static std::shared_ptr<kis_trace_ring> make_thread_ring();
+};
+
+// Span covering the lifetime of the object; does nothing if tracing is disabled
+// when the span starts, or if the name is null
+class kis_trace_span {
+public:
+    kis_trace_span(const char *in_cat, const char *in_name, uint64_t in_arg = 0) :
+        cat{in_cat},
+        name{in_name},
+        arg{in_arg},
+        start{in_name != nullptr && kis_tracer::enabled.load(std::memory_order_relaxed) ?
+            kis_tracer::now_ns() : 0} { }
+
+    ~kis_trace_span() {
+        if (start != 0)
+            kis_tracer::record(cat, name, start, kis_tracer::now_ns(), arg);
+    }
+
+    kis_trace_span(const kis_trace_span&) = delete;
+    kis_trace_span& operator=(const kis_trace_span&) = delete;
+
+    void set_arg(uint64_t in_arg) {
+        arg = in_arg;
+    }
+
+protected:
+    const char *cat;
+    const char *name;
+    uint64_t arg;
+    uint64_t start;
+};
+
+#endif
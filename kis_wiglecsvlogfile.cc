@@ -18,12 +18,17 @@
 
 #include "config.h"
 
+#include <string.h>
+
+#include <algorithm>
+
 #include "kis_wiglecsvlogfile.h"
 
 #include "devicetracker.h"
 #include "phy_80211.h"
 #include "phy_bluetooth.h"
 #include "phy_btle.h"
+#include "timetracker.h"
 #include "version.h"
 
 // Aggressive additional mangle of text to handle converting ',' and '"' to
@@ -124,7 +129,6 @@ int frequency_to_wifi_channel(double in_freq) {
 kis_wiglecsv_logfile::kis_wiglecsv_logfile(shared_log_builder in_builder) :
     kis_logfile(in_builder) {
 
-    csvfile = nullptr;
 
     auto packetchain = Globalreg::fetch_mandatory_global_as<packet_chain>("PACKETCHAIN");
 
@@ -136,6 +140,15 @@ kis_wiglecsv_logfile::kis_wiglecsv_logfile(shared_log_builder in_builder) :
     throttle_seconds = 
         Globalreg::globalreg->kismet_config->fetch_opt_uint("wigle_log_throttle", 1);
 
+    aggregate = 
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("wigle_log_aggregate", false);
+    aggregate_max =
+        std::max(64U, Globalreg::globalreg->kismet_config->fetch_opt_uint("wigle_log_aggregate_max", 65536));
+    gzip = Globalreg::globalreg->kismet_config->fetch_opt_bool("wigle_log_gzip", false);
+
+    flush_timer_id = -1;
+    zstrm_init = false;
+
     auto devicetracker =
         Globalreg::fetch_mandatory_global_as<device_tracker>();
 
@@ -162,29 +175,61 @@ bool kis_wiglecsv_logfile::open_log(std::string in_path) {
     kis_unique_lock<kis_mutex> lk(log_mutex, "open_log");
 
     set_int_log_open(false);
+
+    // Wigle takes gzipped uploads as they are
+    if (gzip) {
+        in_path += ".gz";
+
+        memset(&zstrm, 0, sizeof(z_stream));
+
+        // 16 + window bits for a gzip wrapper
+        if (deflateInit2(&zstrm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                    Z_DEFAULT_STRATEGY) != Z_OK) {
+            _MSG_ERROR("Failed to initialize compression for wiglecsv log file '{}'", in_path);
+            return false;
+        }
+
+        zstrm_init = true;
+        zbuf.resize(65536);
+    }
+
     set_int_log_path(in_path);
 
     auto packetchain = Globalreg::fetch_mandatory_global_as<packet_chain>();
 
-    csvfile = fopen(in_path.c_str(), "wa");
-    if (csvfile == NULL) {
-        _MSG_ERROR("Failed to open wiglecsv log '{}': {}", in_path,
-                kis_strerror_r(errno));
+    if (!writer.open(in_path))
         return false;
-    }
 
     _MSG_INFO("Opened wiglecsv log file '{}'", in_path);
 
     // CSV headers
-    fmt::print(csvfile, "WigleWifi-1.4,appRelease=Kismet{0}{1}{2},model=Kismet,release={0}.{1}.{2},"
+    write_out(fmt::format("WigleWifi-1.4,appRelease=Kismet{0}{1}{2},model=Kismet,release={0}.{1}.{2},"
             "device=kismet,display=kismet,board=kismet,brand=kismet\n", 
-            VERSION_MAJOR, VERSION_MINOR, VERSION_TINY);
-    fmt::print(csvfile, "MAC,SSID,AuthMode,FirstSeen,Channel,RSSI,CurrentLatitude,CurrentLongitude,"
-            "AltitudeMeters,AccuracyMeters,Type\n");
+            VERSION_MAJOR, VERSION_MINOR, VERSION_TINY));
+    write_out("MAC,SSID,AuthMode,FirstSeen,Channel,RSSI,CurrentLatitude,CurrentLongitude,"
+            "AltitudeMeters,AccuracyMeters,Type\n", true);
 
-    set_int_log_open(true);
+    if (aggregate) {
+        auto interval =
+            std::max(1U, Globalreg::globalreg->kismet_config->fetch_opt_uint("wigle_log_aggregate_interval", 60));
 
-    fflush(csvfile);
+        auto timetracker = Globalreg::fetch_mandatory_global_as<time_tracker>();
+
+        flush_timer_id =
+            timetracker->register_timer(std::chrono::seconds(interval), true, [this](int) -> int {
+                    kis_lock_guard<kis_mutex> lk(log_mutex, "wiglecsv flush");
+
+                    if (get_log_open()) 
+                        flush_records_nl();
+
+                    return 1;
+                });
+
+        _MSG_INFO("Wiglecsv log will hold the best record of up to {} networks and write "
+                "changes every {} seconds", aggregate_max, interval);
+    }
+
+    set_int_log_open(true);
 
     lk.unlock();
 
@@ -196,12 +241,41 @@ bool kis_wiglecsv_logfile::open_log(std::string in_path) {
 void kis_wiglecsv_logfile::close_log() {
     kis_lock_guard<kis_mutex> lk(log_mutex);
 
+    auto timetracker = Globalreg::fetch_global_as<time_tracker>();
+
+    if (flush_timer_id >= 0 && timetracker != nullptr)
+        timetracker->remove_timer(flush_timer_id);
+
+    flush_timer_id = -1;
+
+    if (get_log_open() && aggregate)
+        flush_records_nl();
+
+    record_map.clear();
+
     set_int_log_open(false);
 
-    if (csvfile != nullptr)
-        fclose(csvfile);
+    if (zstrm_init) {
+        int r;
 
-    csvfile = nullptr;
+        zstrm.next_in = nullptr;
+        zstrm.avail_in = 0;
+
+        do {
+            zstrm.next_out = reinterpret_cast<Bytef *>(zbuf.data());
+            zstrm.avail_out = zbuf.size();
+
+            r = deflate(&zstrm, Z_FINISH);
+
+            if (zbuf.size() != zstrm.avail_out)
+                writer.write(zbuf.data(), zbuf.size() - zstrm.avail_out);
+        } while (r == Z_OK);
+
+        deflateEnd(&zstrm);
+        zstrm_init = false;
+    }
+
+    writer.close();
 
     auto packetchain = 
         Globalreg::fetch_global_as<packet_chain>();
@@ -210,6 +284,142 @@ void kis_wiglecsv_logfile::close_log() {
     }
 }
 
+void kis_wiglecsv_logfile::write_out(const std::string& in_data, bool in_sync) {
+    if (!zstrm_init) {
+        writer.write(in_data);
+        return;
+    }
+
+    zstrm.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in_data.data()));
+    zstrm.avail_in = in_data.length();
+
+    // Keep going until the input is consumed and, for a sync flush, the output buffer
+    // wasn't filled, so nothing is left pending in the stream
+    do {
+        zstrm.next_out = reinterpret_cast<Bytef *>(zbuf.data());
+        zstrm.avail_out = zbuf.size();
+
+        if (deflate(&zstrm, in_sync ? Z_SYNC_FLUSH : Z_NO_FLUSH) == Z_STREAM_ERROR)
+            return;
+
+        if (zbuf.size() != zstrm.avail_out)
+            writer.write(zbuf.data(), zbuf.size() - zstrm.avail_out);
+    } while (zstrm.avail_in > 0 || (in_sync && zstrm.avail_out == 0));
+}
+
+bool kis_wiglecsv_logfile::make_record(std::shared_ptr<kis_tracked_device_base> dev,
+        wigle_record& rec) {
+    char macbuf[mac_addr::max_chars];
+    auto macend = dev->get_macaddr().to_chars(macbuf);
+
+    // Break into per-phy handling
+    if (dot11_phy->device_is_a(dev)) {
+        auto dot11 = dot11_phy->fetch_dot11_record(dev);
+        if (dot11 == nullptr)
+            return false;
+
+        rec.name = "";
+        rec.crypt = "";
+
+        if (dot11->has_last_beaconed_ssid_record()) {
+            auto last_ssid_a = dot11->get_last_beaconed_ssid_record();
+            auto last_ssid = last_ssid_a->get_as<dot11_advertised_ssid>();
+
+            if (last_ssid != nullptr) {
+                rec.name = munge_for_csv(last_ssid->get_ssid());
+                rec.crypt = wifi_crypt_to_string(last_ssid->get_crypt_set());
+            }
+
+        }
+
+        rec.crypt += "[ESS]";
+        rec.channel = frequency_to_wifi_channel(dev->get_frequency());
+        rec.type = "WIFI";
+    } else if (bt_phy->device_is_a(dev)) {
+        auto bt = bt_phy->fetch_bluetooth_record(dev);
+
+        if (bt == nullptr)
+            return false;
+
+        rec.name = munge_for_csv(dev->get_commonname());
+        rec.channel = 0;
+
+        switch (static_cast<bt_device_type>(bt->get_bt_device_type())) {
+            case bt_device_type::btle:
+                rec.crypt = "Misc [LE]";
+                rec.type = "BLE";
+                break;
+            default:
+                rec.crypt = "Misc [BT]";
+                rec.type = "BT";
+                break;
+        }
+    } else {
+        return false;
+    }
+
+    rec.mac = std::string(macbuf, macend - macbuf);
+
+    std::time_t timet(dev->get_first_time());
+    std::tm tm;
+
+    gmtime_r(&timet, &tm);
+
+    char tmstr[256];
+    strftime(tmstr, 255, "%Y-%m-%d %H:%M:%S", &tm);
+    rec.first_seen = tmstr;
+
+    return true;
+}
+
+std::string kis_wiglecsv_logfile::format_record(const wigle_record& rec) {
+    if (rec.type == "WIFI")
+        return fmt::format("{},{},{},{},{},{},{:3.6f},{:3.6f},{:f},0,{}\n",
+                rec.mac, rec.name, rec.crypt, rec.first_seen, rec.channel, rec.signal,
+                rec.lat, rec.lon, rec.alt, rec.type);
+
+    return fmt::format("{},{},{},{},{},{},{:3.10f},{:3.10f},{:f},0,{}\n",
+            rec.mac, rec.name, rec.crypt, rec.first_seen, rec.channel, rec.signal,
+            rec.lat, rec.lon, rec.alt, rec.type);
+}
+
+void kis_wiglecsv_logfile::flush_records_nl() {
+    std::string out;
+
+    for (auto& r : record_map) {
+        if (!r.second.dirty)
+            continue;
+
+        out += format_record(r.second);
+        r.second.dirty = false;
+    }
+
+    if (out.length() > 0)
+        write_out(out, true);
+}
+
+void kis_wiglecsv_logfile::expire_records_nl() {
+    // Nothing is lost; the records are written first, and a network seen again starts
+    // a new record
+    flush_records_nl();
+
+    std::vector<std::pair<time_t, device_key>> idle;
+    idle.reserve(record_map.size());
+
+    for (const auto& r : record_map)
+        idle.push_back(std::make_pair(r.second.last_seen, r.first));
+
+    auto n = std::max<size_t>(1, idle.size() / 8);
+
+    std::nth_element(idle.begin(), idle.begin() + (n - 1), idle.end(),
+            [](const std::pair<time_t, device_key>& a, const std::pair<time_t, device_key>& b) {
+                return a.first < b.first;
+            });
+
+    for (size_t i = 0; i < n; i++)
+        record_map.erase(idle[i].second);
+}
+
 int kis_wiglecsv_logfile::packet_handler(CHAINCALL_PARMS) {
     kis_wiglecsv_logfile *wigle = static_cast<kis_wiglecsv_logfile *>(auxdata);
 
@@ -258,106 +468,71 @@ int kis_wiglecsv_logfile::packet_handler(CHAINCALL_PARMS) {
 
     auto dev = d_k->second;
 
-    // Stop looking at all if we're w/in the timeout for logging this device
-    const auto& time_k = wigle->timer_map.find(dev->get_key());
-    
-    if (time_k != wigle->timer_map.end()) {
-        if (time(0) < time_k->second)
-            return 1;
-    }
+    if (wigle->aggregate) {
+        auto r_k = wigle->record_map.find(dev->get_key());
 
-    // Break into per-phy handling
-    if (wigle->dot11_phy->device_is_a(dev)) {
-        auto dot11 = wigle->dot11_phy->fetch_dot11_record(dev);
-        if (dot11 == nullptr)
-            return 1;
+        if (r_k != wigle->record_map.end()) {
+            auto& rec = r_k->second;
 
-        auto timestamp = dev->get_first_time();
-        auto name = std::string("");
-        auto crypt = std::string("");
+            rec.last_seen = in_pack->ts.tv_sec;
 
-        if (dot11->has_last_beaconed_ssid_record()) {
-            auto last_ssid_a = dot11->get_last_beaconed_ssid_record();
-            auto last_ssid = last_ssid_a->get_as<dot11_advertised_ssid>();
+            // Only a stronger signal replaces the record
+            if (signal == 0 || (rec.signal != 0 && signal <= rec.signal))
+                return 1;
 
-            if (last_ssid != nullptr) {
-                name = munge_for_csv(last_ssid->get_ssid());
-                crypt = wifi_crypt_to_string(last_ssid->get_crypt_set());
-            }
+            if (!wigle->make_record(dev, rec))
+                return 1;
 
-        }
+            rec.signal = signal;
+            rec.lat = gps->lat;
+            rec.lon = gps->lon;
+            rec.alt = gps->alt;
+            rec.dirty = true;
 
-        crypt += "[ESS]";
+            return 1;
+        }
 
-        std::time_t timet(timestamp);
-        std::tm tm;
-        std::stringstream ts;
+        wigle_record rec;
 
-        gmtime_r(&timet, &tm);
+        if (!wigle->make_record(dev, rec))
+            return 1;
 
-        char tmstr[256];
-        strftime(tmstr, 255, "%Y-%m-%d %H:%M:%S", &tm);
-        ts << tmstr;
+        rec.signal = signal;
+        rec.lat = gps->lat;
+        rec.lon = gps->lon;
+        rec.alt = gps->alt;
+        rec.last_seen = in_pack->ts.tv_sec;
+        rec.dirty = true;
 
-        auto channel = frequency_to_wifi_channel(dev->get_frequency());
+        if (wigle->record_map.size() >= wigle->aggregate_max)
+            wigle->expire_records_nl();
 
-        fmt::print(wigle->csvfile, "{},{},{},{},{},{},{:3.6f},{:3.6f},{:f},0,{}\n",
-                dev->get_macaddr(),
-                name,
-                crypt,
-                ts.str(),
-                (int) channel,
-                signal,
-                gps->lat, gps->lon, gps->alt,
-                "WIFI");
+        wigle->record_map.emplace(dev->get_key(), std::move(rec));
 
-    } else if (wigle->bt_phy->device_is_a(dev)) {
-        auto bt = wigle->bt_phy->fetch_bluetooth_record(dev);
+        return 1;
+    }
 
-        if (bt == nullptr)
+    // Stop looking at all if we're w/in the timeout for logging this device
+    const auto& time_k = wigle->timer_map.find(dev->get_key());
+    
+    if (time_k != wigle->timer_map.end()) {
+        if (time(0) < time_k->second)
             return 1;
+    }
 
-        auto timestamp = dev->get_first_time();
-        auto name = munge_for_csv(dev->get_commonname());
-        auto crypt = std::string("");
-
-        std::time_t timet(timestamp);
-        std::tm tm;
-        std::stringstream ts;
-
-        gmtime_r(&timet, &tm);
-
-        char tmstr[256];
-        strftime(tmstr, 255, "%Y-%m-%d %H:%M:%S", &tm);
-        ts << tmstr;
+    wigle_record rec;
 
-        std::string type;
+    if (!wigle->make_record(dev, rec))
+        return 1;
 
-        switch (static_cast<bt_device_type>(bt->get_bt_device_type())) {
-            case bt_device_type::btle:
-                crypt = "Misc [LE]";
-                type = "BLE";
-                break;
-            default:
-                crypt = "Misc [BT]";
-                type = "BT";
-                break;
-        }
+    rec.signal = signal;
+    rec.lat = gps->lat;
+    rec.lon = gps->lon;
+    rec.alt = gps->alt;
 
-        fmt::print(wigle->csvfile, "{},{},{},{},{},{},{:3.10f},{:3.10f},{:f},0,{}\n",
-                dev->get_macaddr(),
-                name,
-                crypt,
-                ts.str(),
-                0,
-                signal,
-                gps->lat, gps->lon, gps->alt,
-                type);
-    }
+    wigle->write_out(wigle->format_record(rec));
 
     wigle->timer_map[dev->get_key()] = time(0) + wigle->throttle_seconds;
 
-    fflush(wigle->csvfile);
-
     return 1;
 }
@@ -21,8 +21,14 @@
 
 #include "config.h"
 
+#include <zlib.h>
+
+#include <unordered_map>
+#include <vector>
+
 #include "configfile.h"
 #include "globalregistry.h"
+#include "kis_logfile_writer.h"
 #include "logtracker.h"
 #include "packetchain.h"
 #include "phy_80211.h"
@@ -42,7 +48,32 @@ public:
 protected:
     static int packet_handler(CHAINCALL_PARMS);
 
-    FILE *csvfile;
+    // One CSV row
+    struct wigle_record {
+        std::string mac, name, crypt, first_seen, type;
+        int channel;
+        int signal;
+        double lat, lon, alt;
+        time_t last_seen;
+        bool dirty;
+    };
+
+    // Fill in the device fields of a record; returns false for devices which aren't
+    // wigle logged
+    bool make_record(std::shared_ptr<kis_tracked_device_base> in_dev, wigle_record& out_rec);
+    std::string format_record(const wigle_record& in_rec);
+
+    // Write to the log, through the gzip stream if the log is compressed; a sync flush
+    // makes everything written so far readable from the file
+    void write_out(const std::string& in_data, bool in_sync = false);
+
+    // Write the aggregated records which improved since the last flush
+    void flush_records_nl();
+
+    // Drop the eighth of the aggregated records not seen the longest
+    void expire_records_nl();
+
+    kis_logfile_writer writer;
 
     int pack_comp_80211, pack_comp_common, pack_comp_gps, pack_comp_l1info,
         pack_comp_device;
@@ -51,6 +82,19 @@ protected:
 
     std::unordered_map<device_key, time_t> timer_map;
 
+    // In aggregate mode each network is held in a bounded map with its strongest
+    // signal and the location it was seen at, and written when that improves, at most 
+    // once per flush interval, instead of a row per packet
+    bool aggregate;
+    unsigned int aggregate_max;
+    std::unordered_map<device_key, wigle_record> record_map;
+    int flush_timer_id;
+
+    bool gzip;
+    z_stream zstrm;
+    bool zstrm_init;
+    std::vector<char> zbuf;
+
     kis_80211_phy *dot11_phy;
     kis_bluetooth_phy *bt_phy;
     kis_btle_phy *btle_phy;
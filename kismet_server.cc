@@ -54,8 +54,11 @@
 
 #include "kis_dlt_ppi.h"
 #include "kis_dlt_radiotap.h"
+#ifdef BUILD_PHY_BTLE
 #include "kis_dlt_btle_radio.h"
+#endif
 
+#include "kis_dissection_profile.h"
 #include "kis_dissector_ipdata.h"
 
 #include "dlttracker.h"
@@ -65,32 +68,58 @@
 #include "datasource_pcapfile.h"
 #include "datasource_kismetdb.h"
 #include "datasource_linux_wifi.h"
-#include "datasource_linux_bluetooth.h"
 #include "datasource_osx_corewlan_wifi.h"
+#include "datasource_virtual.h"
+#include "datasource_dot11_scan.h"
+#include "datasource_bladerf_wiphy.h"
+
+// Datasources of the optional phys are only built with them (see --with-phys)
+#ifdef BUILD_PHY_BLUETOOTH
+#include "datasource_linux_bluetooth.h"
+#include "datasource_bluetooth_scan.h"
+#endif
+#ifdef BUILD_PHY_RTL433
 #include "datasource_rtl433.h"
+#endif
+#ifdef BUILD_PHY_METER
 #include "datasource_rtlamr.h"
+#endif
+#ifdef BUILD_PHY_ADSB
 #include "datasource_rtladsb.h"
-#include "datasource_freaklabs_zigbee.h"
+#include "datasource_adsbproxy.h"
+#endif
+#ifdef BUILD_PHY_MOUSEJACK
 #include "datasource_nrf_mousejack.h"
+#endif
+#ifdef BUILD_PHY_BTLE
 #include "datasource_ti_cc_2540.h"
 #include "datasource_nrf_51822.h"
-#include "datasource_nrf_52840.h"
 #include "datasource_ubertooth_one.h"
-#include "datasource_nxp_kw41z.h"
+#endif
+#ifdef BUILD_PHY_802154
+#include "datasource_freaklabs_zigbee.h"
+#include "datasource_nrf_52840.h"
 #include "datasource_ti_cc_2531.h"
 #include "datasource_rz_killerbee.h"
-#include "datasource_virtual.h"
-#include "datasource_dot11_scan.h"
-#include "datasource_bluetooth_scan.h"
-#include "datasource_bladerf_wiphy.h"
-#include "datasource_adsbproxy.h"
+#endif
+#if defined(BUILD_PHY_BTLE) || defined(BUILD_PHY_802154)
+#include "datasource_nxp_kw41z.h"
+#endif
+#ifdef BUILD_PHY_RADIATION
 #include "datasource_bt_geiger.h"
+#endif
 
 #include "logtracker.h"
-#include "kis_ppilogfile.h"
 #include "kis_databaselogfile.h"
+#ifdef BUILD_LOG_PCAPPPI
+#include "kis_ppilogfile.h"
+#endif
+#ifdef BUILD_LOG_PCAPNG
 #include "kis_pcapnglogfile.h"
+#endif
+#ifdef BUILD_LOG_WIGLECSV
 #include "kis_wiglecsvlogfile.h"
+#endif
 
 #include "timetracker.h"
 #include "alertracker.h"
@@ -98,6 +127,9 @@
 #include "kis_net_beast_httpd.h"
 
 #include "system_monitor.h"
+#include "kis_thread_placement.h"
+#include "kis_hugepage_slab.h"
+#include "kis_ingest_pool.h"
 #include "channeltracker2.h"
 #include "kis_httpd_registry.h"
 #include "messagebus_restclient.h"
@@ -107,24 +139,55 @@
 #include "gpstracker.h"
 
 #include "devicetracker.h"
+#include "devicetracker_pkthistory.h"
+#include "kis_rrd_archive.h"
 #include "phy_80211.h"
+#include "dot11_ssidscan.h"
+#ifdef BUILD_PHY_RTL433
 #include "phy_rtl433.h"
+#endif
+#ifdef BUILD_PHY_METER
 #include "phy_meter.h"
+#endif
+#ifdef BUILD_PHY_ADSB
 #include "phy_adsb.h"
+#endif
+#ifdef BUILD_PHY_ZWAVE
 #include "phy_zwave.h"
+#endif
+#ifdef BUILD_PHY_BLUETOOTH
 #include "phy_bluetooth.h"
+#endif
+#ifdef BUILD_PHY_UAV
 #include "phy_uav_drone.h"
+#endif
+#ifdef BUILD_PHY_MOUSEJACK
 #include "phy_nrf_mousejack.h"
+#endif
+#ifdef BUILD_PHY_BTLE
 #include "phy_btle.h"
+#endif
+#ifdef BUILD_PHY_802154
 #include "phy_802154.h"
+#endif
+#ifdef BUILD_PHY_RADIATION
 #include "phy_radiation.h"
+#endif
 
 #include "ipctracker_v2.h"
 #include "manuf.h"
+#include "kis_startup_graph.h"
 #include "entrytracker.h"
 #include "json_adapter.h"
+#include "msgpack_adapter.h"
 
 #include "kis_server_announce.h"
+#include "kis_replay_benchmark.h"
+#include "kis_lock_profile.h"
+#include "kis_metrics.h"
+#include "kis_elk_bulk.h"
+#include "kis_federation.h"
+#include "kis_trace.h"
 
 #ifndef exec_name
 char *exec_name;
@@ -177,8 +240,14 @@ void SpindownKismet() {
         Globalreg::fetch_global_as<device_tracker>();
     if (devicetracker != NULL) {
         devicetracker->databaselog_write_devices();
+        devicetracker->write_device_snapshot();
     }
 
+    // Let any startup tasks which are still indexing finish before their owners go away
+    auto startupgraph = Globalreg::fetch_global_as<kis_startup_graph>();
+    if (startupgraph != nullptr)
+        startupgraph->wait_all();
+
     // shutdown everything
     globalregistry->shutdown_deferred();
     globalregistry->spindown = 1;
@@ -263,6 +332,10 @@ int usage(char *argv) {
            "     --override <flavor>      Load an alternate configuration override \n"
            "                               from {confdir}/kismet_{flavor}.conf\n"
            "                               or as a specific override file.\n"
+           "     --benchmark <file>       Replay the datasources without the web server,\n"
+           "                               wait for them to finish, write a JSON\n"
+           "                               performance report to <file> (or '-' for\n"
+           "                               stdout), and exit\n"
            );
 
     log_tracker::usage(argv);
@@ -511,8 +584,10 @@ int main(int argc, char *argv[], char *envp[]) {
     const int cdwc = globalregistry->getopt_long_num++;
     const int ddwc = globalregistry->getopt_long_num++;
     const int ovwc = globalregistry->getopt_long_num++;
+    const int bmwc = globalregistry->getopt_long_num++;
 
     std::string override_fname;
+    std::string benchmark_report;
 
     // Standard getopt parse run
     static struct option main_longopt[] = {
@@ -527,6 +602,7 @@ int main(int argc, char *argv[], char *envp[]) {
         { "confdir", required_argument, 0, cdwc },
         { "datadir", required_argument, 0, ddwc },
         { "override", required_argument, 0, ovwc },
+        { "benchmark", required_argument, 0, bmwc },
         { 0, 0, 0, 0 }
     };
 
@@ -568,6 +644,14 @@ int main(int argc, char *argv[], char *envp[]) {
             globalregistry->data_dir = std::string(optarg);
         } else if (r == ovwc) {
             override_fname = std::string(optarg);
+        } else if (r == bmwc) {
+            benchmark_report = std::string(optarg);
+
+            // Keep stdout clean for the report
+            if (benchmark_report == "-") {
+                local_silent = 1;
+                glob_silent = 1;
+            }
         }
     }
 
@@ -702,6 +786,60 @@ int main(int argc, char *argv[], char *envp[]) {
     }
     globalregistry->kismet_config = conf;
 
+    // Benchmark replays hold the datasources instead of dropping packets, and time the
+    // packet handlers if they aren't already
+    if (benchmark_report.length() > 0) {
+        conf->set_opt("packet_backlog_block", "true", 0);
+
+        if (conf->fetch_opt_uint("packet_handler_stats_sample", 0) == 0)
+            conf->set_opt("packet_handler_stats_sample", "16", 0);
+    }
+
+    Globalreg::tracker_inline_fields = conf->fetch_opt_bool("tracker_inline_fields", true);
+    Globalreg::tracker_intern_strings = conf->fetch_opt_bool("tracker_intern_strings", true);
+
+    // Map the huge page slab before the packet and device pools are created
+    auto slab_mode_opt = str_lower(conf->fetch_opt_dfl("hugepage_pool", "off"));
+    auto slab_mode = kis_hugepage_slab::slab_mode::off;
+
+    if (slab_mode_opt == "transparent") {
+        slab_mode = kis_hugepage_slab::slab_mode::transparent;
+    } else if (slab_mode_opt == "explicit") {
+        slab_mode = kis_hugepage_slab::slab_mode::explicit_pages;
+    } else if (slab_mode_opt != "off") {
+        _MSG_ERROR("Unknown hugepage_pool '{}', expected off, transparent, or explicit", slab_mode_opt);
+    }
+
+    if (slab_mode != kis_hugepage_slab::slab_mode::off) {
+        auto slab_mb = conf->fetch_opt_as<size_t>("hugepage_pool_mb", 512);
+        auto r = kis_hugepage_slab::configure(slab_mode, slab_mb * 1024 * 1024);
+
+        if (r == kis_hugepage_slab::slab_mode::off)
+            _MSG_ERROR("Could not map {}MB for the huge page pool, packet and device "
+                    "memory will come from the heap", slab_mb);
+        else if (r != slab_mode)
+            _MSG_ERROR("Could not map {}MB of explicit huge pages for the huge page pool; "
+                    "make sure enough huge pages are reserved in /proc/sys/vm/nr_hugepages.  "
+                    "Using transparent huge pages instead.", slab_mb);
+        else
+            _MSG_INFO("Using {}MB of {} huge pages for packet and device memory", slab_mb,
+                    kis_hugepage_slab::mode_name(r));
+    }
+
+    // Thread placement has to be known before any of the thread pools are sized
+    auto threadplacement = kis_thread_placement::create_thread_placement();
+
+    // IO threads run the network and datasource IPC handlers, some of which block, so
+    // default to a few per CPU
+    globalregistry->n_io_threads = conf->fetch_opt_as<int>("io_threads", 0);
+    if (globalregistry->n_io_threads <= 0)
+        globalregistry->n_io_threads = static_cast<int>(threadplacement->get_num_cpus() * 2);
+    if (globalregistry->n_io_threads < 4)
+        globalregistry->n_io_threads = 4;
+
+    // Optional dedicated IO threads for datasource connections
+    kis_ingest_pool::create_ingest_pool();
+
     struct stat fstat;
     std::string configdir;
 
@@ -773,6 +911,15 @@ int main(int argc, char *argv[], char *envp[]) {
     if (globalregistry->fatal_condition) 
         SpindownKismet();
 
+    // Start tracing as soon as the webserver can serve the traces
+    kis_tracer::create_tracer();
+    kis_lock_profile::create_lock_profile();
+    kis_metrics::create_metrics();
+
+    // Reference databases are indexed in the background while the rest of the server
+    // starts
+    auto startupgraph = kis_startup_graph::create_startup_graph();
+
     // Create the manuf db
     globalregistry->manufdb = new kis_manuf();
     if (globalregistry->fatal_condition)
@@ -784,6 +931,8 @@ int main(int argc, char *argv[], char *envp[]) {
     entrytracker->register_serializer("ekjson", std::make_shared<ek_json_adapter::serializer>());
     entrytracker->register_serializer("itjson", std::make_shared<it_json_adapter::serializer>());
     entrytracker->register_serializer("prettyjson", std::make_shared<pretty_json_adapter::serializer>());
+    entrytracker->register_serializer("msgpack", std::make_shared<msgpack_adapter::serializer>());
+    entrytracker->register_serializer("dmsgpack", std::make_shared<dict_msgpack_adapter::serializer>());
 
     entrytracker->register_serializer("jcmd", std::make_shared<json_adapter::serializer>());
     entrytracker->register_serializer("cmd", std::make_shared<json_adapter::serializer>());
@@ -860,31 +1009,61 @@ int main(int argc, char *argv[], char *envp[]) {
     // Create the device tracker
     auto devicetracker = device_tracker::create_device_tracker();
 
+    // Recent packets of each device, when enabled
+    device_packet_history::create_packet_history();
+
     // Add channel tracking
     channel_tracker_v2::create_channeltracker();
 
+    // Long-term history of datasource, channel, and device RRDs, when enabled
+    kis_rrd_archive::create_rrd_archive();
+
     if (globalregistry->fatal_condition)
         SpindownKismet();
 
     // Register the DLT handlers
     kis_dlt_ppi::create_dlt();
     kis_dlt_radiotap::create_dlt();
+#ifdef BUILD_PHY_BTLE
     kis_dlt_btle_radio::create_dlt();
+#endif
 
-    auto ipdissector = kis_dissector_ip_data::create_dissector_ip_data();
+    // Survey deployments never look inside data frames
+    if (fetch_dissection_profile("") != kis_dissection_profile::survey)
+        kis_dissector_ip_data::create_dissector_ip_data();
 
-    // Register the base PHYs
+    // Register the base PHYs; all but 802.11 can be left out at configure time
     devicetracker->register_phy_handler(dynamic_cast<kis_phy_handler *>(new kis_80211_phy()));
+#ifdef BUILD_PHY_RTL433
     devicetracker->register_phy_handler(dynamic_cast<kis_phy_handler *>(new Kis_RTL433_Phy()));
+#endif
+#ifdef BUILD_PHY_ZWAVE
     devicetracker->register_phy_handler(dynamic_cast<kis_phy_handler *>(new Kis_Zwave_Phy()));
+#endif
+#ifdef BUILD_PHY_BLUETOOTH
     devicetracker->register_phy_handler(dynamic_cast<kis_phy_handler *>(new kis_bluetooth_phy()));
+#endif
+#ifdef BUILD_PHY_UAV
     devicetracker->register_phy_handler(dynamic_cast<kis_phy_handler *>(new Kis_UAV_Phy()));
+#endif
+#ifdef BUILD_PHY_MOUSEJACK
     devicetracker->register_phy_handler(dynamic_cast<kis_phy_handler *>(new Kis_Mousejack_Phy()));
+#endif
+#ifdef BUILD_PHY_BTLE
     devicetracker->register_phy_handler(dynamic_cast<kis_phy_handler *>(new kis_btle_phy()));
+#endif
+#ifdef BUILD_PHY_METER
     devicetracker->register_phy_handler(dynamic_cast<kis_phy_handler *>(new kis_meter_phy()));
+#endif
+#ifdef BUILD_PHY_ADSB
     devicetracker->register_phy_handler(dynamic_cast<kis_phy_handler *>(new kis_adsb_phy()));
+#endif
+#ifdef BUILD_PHY_802154
     devicetracker->register_phy_handler(dynamic_cast<kis_phy_handler *>(new kis_802154_phy()));
+#endif
+#ifdef BUILD_PHY_RADIATION
     devicetracker->register_phy_handler(dynamic_cast<kis_phy_handler *>(new kis_radiation_phy()));
+#endif
 
     if (globalregistry->fatal_condition) 
         SpindownKismet();
@@ -893,23 +1072,45 @@ int main(int argc, char *argv[], char *envp[]) {
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_pcapfile_builder()));
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_kismetdb_builder()));
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_linux_wifi_builder()));
+#ifdef BUILD_PHY_BLUETOOTH
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_linux_bluetooth_builder()));
+#endif
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_osx_corewlan_wifi_builder()));
+#ifdef BUILD_PHY_RTL433
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_rtl433_builder()));
+#endif
+#ifdef BUILD_PHY_METER
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_rtlamr_builder()));
+#endif
+#ifdef BUILD_PHY_ADSB
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_rtladsb_builder()));
+#endif
+#ifdef BUILD_PHY_802154
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_freaklabs_zigbee_builder()));
+#endif
+#ifdef BUILD_PHY_MOUSEJACK
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_nrf_mousejack_builder()));
+#endif
+#ifdef BUILD_PHY_BTLE
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_ticc2540_builder()));
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_nrf51822_builder()));
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_ubertooth_one_builder()));
+#endif
+#if defined(BUILD_PHY_BTLE) || defined(BUILD_PHY_802154)
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_nxpkw41z_builder()));
+#endif
+#ifdef BUILD_PHY_802154
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_nrf52840_builder()));
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_rzkillerbee_builder()));
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_ticc2531_builder()));
+#endif
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_bladerf_wiphy_builder()));
+#ifdef BUILD_PHY_ADSB
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_adsbproxy_builder()));
+#endif
+#ifdef BUILD_PHY_RADIATION
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_bt_geiger_builder()));
+#endif
 
     // Virtual sources get a special meta-builder
     datasource_virtual_builder::create_virtualbuilder();
@@ -917,23 +1118,45 @@ int main(int argc, char *argv[], char *envp[]) {
     // Create the database logger as a global because it's a special case
     kis_database_logfile::create_kisdatabaselog();
 
+    // Live Elasticsearch feed of devices and alerts
+    kis_elk_bulk::create_elk_bulk();
+
     auto logtracker = 
         log_tracker::create_logtracker();
 
+#ifdef BUILD_LOG_PCAPPPI
     logtracker->register_log(shared_log_builder(new ppi_logfile_builder()));
+#endif
     logtracker->register_log(shared_log_builder(new kis_database_logfile_builder()));
+#ifdef BUILD_LOG_PCAPNG
     logtracker->register_log(shared_log_builder(new pcapng_logfile_builder()));
+#endif
+#ifdef BUILD_LOG_WIGLECSV
 	logtracker->register_log(shared_log_builder(new wiglecsv_logfile_builder()));
+#endif
 
 	// Create the scan-only handlers
 	dot11_scan_source::create_dot11_scan_source();
+#ifdef BUILD_PHY_BLUETOOTH
     bluetooth_scan_source::create_bluetooth_scan_source();
+#endif
+
+    // SSID scanning takes over datasources and log filters, so it is only loaded when
+    // configured; once loaded it can be turned on and off at runtime
+    if (conf->fetch_opt_bool("dot11_ssidscan_enabled", false))
+        dot11_ssid_scan::create_ssidscan();
 
     std::shared_ptr<plugin_tracker> plugintracker;
 
 	// Start the announcement system
 	kis_server_announce::create_server_announce();
 
+    // Merge devices from downstream servers
+    kis_federation::create_federation();
+
+    if (benchmark_report.length() > 0)
+        kis_replay_benchmark::create_replay_benchmark(benchmark_report);
+
     // Start the plugin handler
     if (plugins) {
         plugintracker = plugin_tracker::create_plugintracker();
@@ -950,6 +1173,13 @@ int main(int argc, char *argv[], char *envp[]) {
     // Add system monitor 
     Systemmonitor::create_systemmonitor();
 
+    // Capture starts once the essential startup tasks are done; a benchmark waits for
+    // every index so lookups are the same in every replay
+    if (benchmark_report.length() > 0)
+        startupgraph->wait_all();
+    else
+        startupgraph->wait_essential();
+
     // Start up any code that needs everything to be loaded
     globalregistry->start_deferred();
 
@@ -994,8 +1224,11 @@ int main(int argc, char *argv[], char *envp[]) {
                 "Kismet with minimal privileges.");
     }
     
-    _MSG("Starting Kismet web server...", MSGFLAG_INFO);
-    Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>()->start_httpd();
+    // Benchmarks run headless
+    if (benchmark_report.length() == 0) {
+        _MSG("Starting Kismet web server...", MSGFLAG_INFO);
+        Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>()->start_httpd();
+    }
 
     if (globalreg->fatal_condition) {
         SpindownKismet();
@@ -1016,6 +1249,8 @@ int main(int argc, char *argv[], char *envp[]) {
     for (auto i = Globalreg::globalreg->n_io_threads - 1; i > 0; i--) {
         iov.emplace_back([i] () {
                 thread_set_process_name(fmt::format("IO {}", i));
+                kis_thread_placement::place_current_thread(fmt::format("IO {}", i),
+                        kis_thread_placement::thread_role::io, i);
                 Globalreg::globalreg->io.run();
                 });
     }
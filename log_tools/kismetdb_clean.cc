@@ -41,17 +41,28 @@
 #include "fmt.h"
 #include "packet_ieee80211.h"
 
+#include "kismetdb_rewrite.h"
+
 
 void print_help(char *argv) {
     printf("Kismetdb Cleanup\n");
     printf("Performs a basic cleanup of Kismetdb logs with an incomplete journal file\n");
     printf("usage: %s [OPTION]\n", argv);
     printf(" -i, --in [filename]          Input kismetdb file\n");
+    printf(" -o, --out [filename]         Write the cleaned log to a new file instead of\n"
+           "                              replacing the input\n");
+    printf(" -v, --verbose                Verbose output\n");
+    printf("\n"
+           "The log is rewritten in a single pass to a new file next to the target, then\n"
+           "renamed over it; no more space than the cleaned log is needed, and the\n"
+           "original is untouched until the rewrite is complete.\n");
 }
 
 int main(int argc, char *argv[]) {
     static struct option longopt[] = {
         { "in", required_argument, 0, 'i' },
+        { "out", required_argument, 0, 'o' },
+        { "verbose", no_argument, 0, 'v' },
         { "help", no_argument, 0, 'h' },
         { 0, 0, 0, 0 }
     };
@@ -60,17 +71,16 @@ int main(int argc, char *argv[]) {
     optind = 0;
     opterr = 0;
 
-    std::string in_fname;
+    std::string in_fname, out_fname;
+    unsigned int flags = 0;
 
-    int sql_r = 0;
-    char *sql_errmsg = NULL;
-    sqlite3 *db = NULL;
+    char errstr[1024];
 
     struct stat statbuf;
 
     while (1) {
         int r = getopt_long(argc, argv, 
-                            "-hi:", longopt, &option_idx);
+                            "-hi:o:v", longopt, &option_idx);
         if (r < 0) break;
 
         if (r == 'h') {
@@ -78,6 +88,10 @@ int main(int argc, char *argv[]) {
             exit(1);
         } else if (r == 'i') {
             in_fname = std::string(optarg);
+        } else if (r == 'o') {
+            out_fname = std::string(optarg);
+        } else if (r == 'v') {
+            flags |= KISMETDB_REWRITE_VERBOSE;
         }
     }
 
@@ -96,26 +110,16 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    /* Open the database and run the vacuum command to clean up any stray journals */
-    sql_r = sqlite3_open(in_fname.c_str(), &db);
-
-    if (sql_r) {
-        fmt::print(stderr, "ERROR:  Unable to open '{}': {}\n", in_fname, sqlite3_errmsg(db));
-        exit(1);
-    }
+    if (out_fname == "")
+        out_fname = in_fname;
 
     fmt::print(stderr, "* Cleaning database '{}'...\n", in_fname);
 
-    sql_r = sqlite3_exec(db, "VACUUM;", NULL, NULL, &sql_errmsg);
-
-    if (sql_r != SQLITE_OK) {
-        fmt::print(stderr, "ERROR:  Unable to clean up (vacuum) database before copying: {}\n", sql_errmsg);
-        sqlite3_close(db);
+    if (kismetdb_rewrite(in_fname.c_str(), out_fname.c_str(), flags, 
+                errstr, sizeof(errstr)) < 0) {
+        fmt::print(stderr, "ERROR:  Unable to clean up database: {}\n", errstr);
         exit(1);
     }
 
-    sqlite3_close(db);
-
     return 0;
 }
-
@@ -39,6 +39,7 @@
 #include "fmt.h"
 #include "json/json.h"
 #include "sqlite3_cpp11.h"
+#include "kismetdb_segments.h"
 
 void print_help(char *argv) {
     printf("Kismetdb to JSON\n");
@@ -198,6 +199,9 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // Read every segment of a rotated log as one log
+    kismetdb_attach_segments(db, in_fname, verbose);
+
     // Use our sql adapters
 
     using namespace kissqlite3;
@@ -0,0 +1,214 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KISMETDB_GEO_EXPORT_H__
+#define __KISMETDB_GEO_EXPORT_H__
+
+#include "config.h"
+
+#include <math.h>
+#include <time.h>
+
+#include <list>
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "sqlite3_cpp11.h"
+#include "kismetdb_pipeline.h"
+
+// Common parts of the map exports (KML and GPX)
+//
+// Device locations are averaged from a single pass over the packets and data of the
+// log instead of a query per device, and tracks can be thinned to a minimum distance
+// and time between points so multi-day logs give files mapping tools can load.
+
+// we can't do this is as a sqlite function, as cool as that would be, because sqlite functions
+// can't be part of a `where`, only a `having`, which introduces tons of problems.
+inline double distance_meters(double lat0, double lon0, double lat1, double lon1) {
+    lat0 = (M_PI / 180) * lat0;
+    lon0 = (M_PI / 180) * lon0;
+    lat1 = (M_PI / 180) * lat1;
+    lon1 = (M_PI / 180) * lon1;
+
+    double diff_lon = lon1 - lon0;
+    double diff_lat = lat1 - lat0;
+
+    double ret =
+        (2 * asin(sqrt(pow(sin(diff_lat / 2), 2) +
+                       cos(lat0) * cos(lat1) * pow(sin(diff_lon / 2), 2)))) * 6731000.0f;
+
+    return ret;
+}
+
+// lat, lon, and distance in meters
+using kismetdb_exclusion_zones = std::vector<std::tuple<double, double, double>>;
+
+inline bool kismetdb_excluded(const kismetdb_exclusion_zones& zones, double lat, double lon) {
+    for (const auto& ez : zones) {
+        if (distance_meters(lat, lon, std::get<0>(ez), std::get<1>(ez)) <= std::get<2>(ez))
+            return true;
+    }
+
+    return false;
+}
+
+// Running average location; altitude is only averaged over points which have one
+struct kismetdb_geo_average {
+    kismetdb_geo_average() :
+        sum_lat{0},
+        sum_lon{0},
+        sum_alt{0},
+        num_2d{0},
+        num_alt{0} { }
+
+    void add(double lat, double lon, double alt) {
+        sum_lat += lat;
+        sum_lon += lon;
+        num_2d++;
+
+        if (alt != 0) {
+            sum_alt += alt;
+            num_alt++;
+        }
+    }
+
+    bool valid() const {
+        return num_2d != 0;
+    }
+
+    double lat() const {
+        return sum_lat / num_2d;
+    }
+
+    double lon() const {
+        return sum_lon / num_2d;
+    }
+
+    double alt() const {
+        return num_alt ? sum_alt / num_alt : 0;
+    }
+
+    double sum_lat, sum_lon, sum_alt;
+    unsigned long num_2d, num_alt;
+};
+
+// Drop points closer than min_dist meters or min_time seconds to the last point kept;
+// the first and last points are always kept.  A limit of 0 is not applied.
+template <typename P>
+void kismetdb_decimate_track(std::vector<P>& track, double min_dist, time_t min_time) {
+    if (track.size() < 3 || (min_dist <= 0 && min_time <= 0))
+        return;
+
+    size_t kept = 0;
+
+    for (size_t i = 1; i < track.size() - 1; i++) {
+        const auto& last = track[kept];
+        const auto& p = track[i];
+
+        if (min_time > 0 && p.time - last.time < min_time)
+            continue;
+
+        if (min_dist > 0 && distance_meters(last.lat, last.lon, p.lat, p.lon) < min_dist)
+            continue;
+
+        track[++kept] = p;
+    }
+
+    track[++kept] = track.back();
+    track.resize(kept + 1);
+}
+
+// Devices are keyed by phy name and mac
+using kismetdb_geo_key = std::pair<std::string, std::string>;
+
+// Average location of every device from its packets and data records outside the
+// exclusion zones.  The log is read once; the exclusion checks run on the pipeline
+// workers.
+inline std::map<kismetdb_geo_key, kismetdb_geo_average> kismetdb_device_locations(sqlite3 *db,
+        int db_version, const kismetdb_exclusion_zones& zones, unsigned int n_threads) {
+    using namespace kissqlite3;
+
+    struct geo_row {
+        kismetdb_geo_key key;
+        double lat, lon, alt;
+        bool excluded;
+    };
+
+    std::map<kismetdb_geo_key, kismetdb_geo_average> ret;
+
+    // Packets are located by their source, data records by their device
+    std::vector<std::pair<std::string, std::string>> tables{{"packets", "sourcemac"}, {"data", "devmac"}};
+
+    for (const auto& t : tables) {
+        std::list<std::string> fields{"phyname", t.second, "lat", "lon"};
+
+        if (db_version >= 5)
+            fields.push_back("alt");
+
+        auto query = _SELECT(db, t.first, fields, _WHERE("lat", NEQ, 0, AND, "lon", NEQ, 0));
+        auto r = query.begin();
+
+        auto read_rows = [&](std::vector<geo_row>& rows, size_t max) -> bool {
+            for (; rows.size() < max && r != query.end(); ++r) {
+                geo_row row;
+
+                row.key.first = sqlite3_column_as<std::string>(*r, 0);
+                row.key.second = sqlite3_column_as<std::string>(*r, 1);
+
+                // Handle the different versions
+                if (db_version < 5) {
+                    row.lat = sqlite3_column_as<double>(*r, 2) / 100000;
+                    row.lon = sqlite3_column_as<double>(*r, 3) / 100000;
+                    row.alt = 0;
+                } else {
+                    row.lat = sqlite3_column_as<double>(*r, 2);
+                    row.lon = sqlite3_column_as<double>(*r, 3);
+                    row.alt = sqlite3_column_as<double>(*r, 4);
+                }
+
+                rows.push_back(std::move(row));
+            }
+
+            return r != query.end();
+        };
+
+        auto check_row = [&](const geo_row& row, geo_row& out) {
+            out = row;
+            out.excluded = (out.lat == 0 || out.lon == 0 || kismetdb_excluded(zones, out.lat, out.lon));
+        };
+
+        auto add_row = [&](geo_row& row) {
+            if (!row.excluded)
+                ret[row.key].add(row.lat, row.lon, row.alt);
+        };
+
+        kismetdb_pipeline<geo_row, geo_row> pipeline(zones.size() ? n_threads : 0, 4096,
+                read_rows, check_row, add_row);
+        pipeline.run();
+    }
+
+    return ret;
+}
+
+#endif
+
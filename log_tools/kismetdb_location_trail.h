@@ -0,0 +1,96 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KISMETDB_LOCATION_TRAIL_H__
+#define __KISMETDB_LOCATION_TRAIL_H__
+
+#include "config.h"
+
+#include <stdint.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include "json/json.h"
+
+// Devices logged with keep_location_trail carry their decimated location trail in the
+// device record, so the log tools can draw tracks without scanning the packets.  The
+// trail is written as hex of the packed points: per point, little endian, the time as a
+// uint32, the latitude and longitude as int32 units of 1e-7 degrees, and the altitude as
+// int32 centimeters.
+
+struct kismetdb_trail_point {
+    time_t time;
+    double lat, lon, alt;
+};
+
+inline std::vector<kismetdb_trail_point> kismetdb_device_trail(const Json::Value& device) {
+    std::vector<kismetdb_trail_point> ret;
+
+    const auto& trail = device["kismet.device.base.location_trail"];
+
+    if (!trail.isObject())
+        return ret;
+
+    auto hex = trail["kismet.common.location_trail.points"].asString();
+
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    };
+
+    std::vector<uint8_t> bytes;
+    bytes.reserve(hex.length() / 2);
+
+    for (size_t i = 0; i + 1 < hex.length(); i += 2) {
+        auto h = nibble(hex[i]);
+        auto l = nibble(hex[i + 1]);
+
+        if (h < 0 || l < 0)
+            return ret;
+
+        bytes.push_back((h << 4) | l);
+    }
+
+    auto get_u32 = [&bytes](size_t pos) -> uint32_t {
+        return bytes[pos] | (bytes[pos + 1] << 8) | (bytes[pos + 2] << 16) |
+            (static_cast<uint32_t>(bytes[pos + 3]) << 24);
+    };
+
+    for (size_t pos = 0; pos + 16 <= bytes.size(); pos += 16) {
+        kismetdb_trail_point p;
+
+        p.time = get_u32(pos);
+        p.lat = static_cast<int32_t>(get_u32(pos + 4)) / 1e7;
+        p.lon = static_cast<int32_t>(get_u32(pos + 8)) / 1e7;
+        p.alt = static_cast<int32_t>(get_u32(pos + 12)) / 100.0;
+
+        ret.push_back(p);
+    }
+
+    return ret;
+}
+
+#endif
+
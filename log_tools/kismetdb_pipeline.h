@@ -0,0 +1,256 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KISMETDB_PIPELINE_H__
+#define __KISMETDB_PIPELINE_H__
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Ordered read / decode / write pipeline for the log tools
+//
+// One reader thread steps the database query and copies rows out in batches; sqlite
+// statements belong to a single thread, and a single cursor is the fastest way through
+// a table (or the view over a segmented log).  Worker threads decode and format the
+// batches in parallel, and the calling thread writes the results in the order they
+// were read, so the output is identical to processing the log serially.
+//
+// With no workers, every stage runs in turn on the calling thread.
+
+template <typename R, typename O>
+class kismetdb_pipeline {
+public:
+    // Fill the vector with up to the batch size of rows; return false once the query
+    // is exhausted
+    using read_func = std::function<bool (std::vector<R>&, size_t)>;
+
+    // Decode a row; may run on any worker thread
+    using decode_func = std::function<void (const R&, O&)>;
+
+    // Write a decoded row, always on the calling thread and in read order
+    using write_func = std::function<void (O&)>;
+
+    kismetdb_pipeline(unsigned int in_workers, size_t in_batch,
+            read_func in_read, decode_func in_decode, write_func in_write) :
+        n_workers{in_workers},
+        batch_sz{in_batch},
+        read{in_read},
+        decode{in_decode},
+        write{in_write},
+        read_seq{0},
+        written{0},
+        read_done{false},
+        failed{false} { }
+
+    void run() {
+        if (n_workers == 0) {
+            run_serial();
+            return;
+        }
+
+        std::thread reader([this]() { reader_thread(); });
+
+        std::vector<std::thread> workers;
+        for (unsigned int i = 0; i < n_workers; i++)
+            workers.push_back(std::thread([this]() { worker_thread(); }));
+
+        try {
+            writer();
+        } catch (...) {
+            fail(std::current_exception());
+        }
+
+        reader.join();
+        for (auto& w : workers)
+            w.join();
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+protected:
+    struct batch {
+        uint64_t seq;
+        std::vector<R> rows;
+        std::vector<O> out;
+    };
+
+    void run_serial() {
+        std::vector<R> rows;
+        O out;
+        bool more = true;
+
+        while (more) {
+            rows.clear();
+            more = read(rows, batch_sz);
+
+            for (const auto& r : rows) {
+                out = O();
+                decode(r, out);
+                write(out);
+            }
+        }
+    }
+
+    void fail(std::exception_ptr e) {
+        std::lock_guard<std::mutex> lk(mutex);
+
+        if (!failed) {
+            failed = true;
+            error = e;
+        }
+
+        cv.notify_all();
+    }
+
+    void reader_thread() {
+        try {
+            bool more = true;
+
+            while (more) {
+                auto b = std::make_shared<batch>();
+                more = read(b->rows, batch_sz);
+
+                std::unique_lock<std::mutex> lk(mutex);
+
+                // Bound the rows in memory to a few batches per worker
+                cv.wait(lk, [this]() {
+                        return failed || read_seq - written < n_workers * 4;
+                        });
+
+                if (failed)
+                    return;
+
+                b->seq = read_seq++;
+                pending.push_back(b);
+
+                cv.notify_all();
+            }
+        } catch (...) {
+            fail(std::current_exception());
+            return;
+        }
+
+        std::lock_guard<std::mutex> lk(mutex);
+        read_done = true;
+        cv.notify_all();
+    }
+
+    void worker_thread() {
+        while (true) {
+            std::shared_ptr<batch> b;
+
+            {
+                std::unique_lock<std::mutex> lk(mutex);
+
+                cv.wait(lk, [this]() {
+                        return failed || pending.size() != 0 || read_done;
+                        });
+
+                if (failed || pending.size() == 0)
+                    return;
+
+                b = pending.front();
+                pending.pop_front();
+            }
+
+            try {
+                b->out.resize(b->rows.size());
+
+                for (size_t i = 0; i < b->rows.size(); i++)
+                    decode(b->rows[i], b->out[i]);
+            } catch (...) {
+                fail(std::current_exception());
+                return;
+            }
+
+            std::lock_guard<std::mutex> lk(mutex);
+            complete.emplace(b->seq, b);
+            cv.notify_all();
+        }
+    }
+
+    void writer() {
+        uint64_t next = 0;
+
+        while (true) {
+            std::shared_ptr<batch> b;
+
+            {
+                std::unique_lock<std::mutex> lk(mutex);
+
+                cv.wait(lk, [this, next]() {
+                        return failed || complete.find(next) != complete.end() ||
+                            (read_done && next == read_seq);
+                        });
+
+                if (failed)
+                    return;
+
+                auto ci = complete.find(next);
+
+                if (ci == complete.end())
+                    return;
+
+                b = ci->second;
+                complete.erase(ci);
+            }
+
+            for (auto& o : b->out)
+                write(o);
+
+            std::lock_guard<std::mutex> lk(mutex);
+            written = ++next;
+            cv.notify_all();
+        }
+    }
+
+    unsigned int n_workers;
+    size_t batch_sz;
+
+    read_func read;
+    decode_func decode;
+    write_func write;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    std::deque<std::shared_ptr<batch>> pending;
+    std::map<uint64_t, std::shared_ptr<batch>> complete;
+
+    // Batches read, and batches the writer has finished
+    uint64_t read_seq;
+    uint64_t written;
+    bool read_done;
+
+    bool failed;
+    std::exception_ptr error;
+};
+
+#endif
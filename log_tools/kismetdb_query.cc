@@ -0,0 +1,886 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*
+ * Run a single device, packet, or alert query over a collection of kismetdb logs.
+ *
+ * Every log (and every rotated series of segments, however many of its segments are
+ * given) is queried on its own connection, on a pool of threads.  Packets and alerts
+ * are merged into time order as they stream out of the logs; devices seen in more
+ * than one log are combined by device key.  Results are written as JSON lines or CSV.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <sqlite3.h>
+
+#include "getopt.h"
+#include "sqlite3_cpp11.h"
+#include "fmt.h"
+#include "kismetdb_segments.h"
+
+enum class query_type {
+    devices, packets, alerts
+};
+
+enum class column_type {
+    text, number, json
+};
+
+struct query_column {
+    std::string name;
+    column_type type;
+};
+
+struct query_row {
+    // Sort key; the first time and last time of a device
+    int64_t ts_sec;
+    int64_t ts_usec;
+
+    // Devices only, for combining records from multiple logs
+    int64_t last_time;
+    int64_t signal;
+    unsigned int n_logs;
+
+    std::vector<std::string> values;
+};
+
+struct query_filter {
+    unsigned long start_time = 0;
+    unsigned long end_time = 0;
+    std::vector<std::string> device_vec;
+    std::vector<std::string> phy_vec;
+};
+
+// Column indexes of the device query used when combining devices
+const unsigned int device_col_first = 0;
+const unsigned int device_col_last = 1;
+const unsigned int device_col_key = 2;
+const unsigned int device_col_signal = 6;
+
+std::vector<query_column> query_columns(query_type type, bool full) {
+    std::vector<query_column> cols;
+
+    if (type == query_type::devices) {
+        cols = {
+            {"first_time", column_type::number}, {"last_time", column_type::number},
+            {"devkey", column_type::text}, {"phyname", column_type::text},
+            {"devmac", column_type::text}, {"type", column_type::text},
+            {"strongest_signal", column_type::number},
+            {"min_lat", column_type::number}, {"min_lon", column_type::number},
+            {"max_lat", column_type::number}, {"max_lon", column_type::number},
+            {"avg_lat", column_type::number}, {"avg_lon", column_type::number},
+            {"bytes_data", column_type::number},
+        };
+
+        if (full)
+            cols.push_back({"device", column_type::json});
+    } else if (type == query_type::packets) {
+        cols = {
+            {"ts_sec", column_type::number}, {"ts_usec", column_type::number},
+            {"phyname", column_type::text}, {"sourcemac", column_type::text},
+            {"destmac", column_type::text}, {"transmac", column_type::text},
+            {"frequency", column_type::number}, {"devkey", column_type::text},
+            {"lat", column_type::number}, {"lon", column_type::number},
+            {"alt", column_type::number}, {"speed", column_type::number},
+            {"heading", column_type::number}, {"packet_len", column_type::number},
+            {"signal", column_type::number}, {"datasource", column_type::text},
+            {"dlt", column_type::number}, {"tags", column_type::text},
+        };
+    } else {
+        cols = {
+            {"ts_sec", column_type::number}, {"ts_usec", column_type::number},
+            {"phyname", column_type::text}, {"devmac", column_type::text},
+            {"lat", column_type::number}, {"lon", column_type::number},
+            {"header", column_type::text},
+        };
+
+        if (full)
+            cols.push_back({"json", column_type::json});
+    }
+
+    return cols;
+}
+
+// A log, or a series of log segments, with the state of its query
+struct query_log {
+    std::string fname;
+    sqlite3 *db = nullptr;
+
+    std::shared_ptr<kissqlite3::query> q;
+    kissqlite3::sqlite3_stmt_iterator iter;
+    bool started = false;
+
+    // Rows read and not yet merged; only touched with the merge mutex held
+    std::deque<query_row> rows;
+    bool busy = false;
+    bool done = false;
+};
+
+bool open_log(query_log& log, bool verbose) {
+    if (sqlite3_open_v2(log.fname.c_str(), &log.db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        fmt::print(stderr, "WARNING: Unable to open '{}', skipping: {}\n", log.fname,
+                sqlite3_errmsg(log.db));
+        sqlite3_close(log.db);
+        log.db = nullptr;
+        return false;
+    }
+
+    // Logs may still be open by a running server
+    sqlite3_busy_timeout(log.db, 5000);
+
+    auto n = kismetdb_attach_segments(log.db, log.fname, false);
+
+    if (verbose)
+        fmt::print(stderr, "* Reading '{}' ({} segment{})\n", log.fname, n, n == 1 ? "" : "s");
+
+    return true;
+}
+
+void close_log(query_log& log) {
+    log.iter = kissqlite3::sqlite3_stmt_iterator();
+    log.q.reset();
+
+    if (log.db != nullptr) {
+        sqlite3_close_v2(log.db);
+        log.db = nullptr;
+    }
+}
+
+std::shared_ptr<kissqlite3::query> make_query(sqlite3 *db, query_type type,
+        const std::vector<query_column>& cols, const query_filter& filter) {
+    using namespace kissqlite3;
+
+    std::list<std::string> fields;
+    for (const auto& c : cols)
+        fields.push_back(c.name);
+
+    auto where = _WHERE();
+    std::list<std::string> mac_fields;
+    std::string table;
+
+    if (type == query_type::devices) {
+        // Devices seen at any point in the window
+        table = "devices";
+        mac_fields = {"devmac"};
+
+        if (filter.start_time != 0)
+            where = _WHERE(where, AND, "last_time", GE, filter.start_time);
+        if (filter.end_time != 0)
+            where = _WHERE(where, AND, "first_time", LT, filter.end_time);
+    } else {
+        if (type == query_type::packets) {
+            table = "packets";
+            mac_fields = {"sourcemac", "destmac", "transmac"};
+        } else {
+            table = "alerts";
+            mac_fields = {"devmac"};
+        }
+
+        if (filter.start_time != 0)
+            where = _WHERE(where, AND, "ts_sec", GE, filter.start_time);
+        if (filter.end_time != 0)
+            where = _WHERE(where, AND, "ts_sec", LT, filter.end_time);
+    }
+
+    if (filter.device_vec.size() != 0) {
+        auto device_clause = _WHERE();
+
+        for (const auto& d : filter.device_vec)
+            for (const auto& f : mac_fields)
+                device_clause = _WHERE(device_clause, OR, f, LIKE, d);
+
+        where = _WHERE(where, AND, device_clause);
+    }
+
+    if (filter.phy_vec.size() != 0) {
+        auto phy_clause = _WHERE();
+
+        for (const auto& p : filter.phy_vec)
+            phy_clause = _WHERE(phy_clause, OR, "phyname", LIKE, p);
+
+        where = _WHERE(where, AND, phy_clause);
+    }
+
+    // Each log is read in time order so the logs can be merged as they stream
+    std::string order = type == query_type::devices ? "first_time" : "ts_sec, ts_usec";
+
+    return std::make_shared<query>(_SELECT(db, table, fields, where, ORDERBY, order));
+}
+
+query_row read_row(std::shared_ptr<sqlite3_stmt> stmt, query_type type, size_t n_cols) {
+    query_row row;
+
+    row.values.reserve(n_cols + 1);
+
+    for (size_t c = 0; c < n_cols; c++) {
+        auto t = sqlite3_column_text(stmt.get(), c);
+
+        if (t == nullptr)
+            row.values.push_back("");
+        else
+            row.values.push_back(std::string(reinterpret_cast<const char *>(t),
+                        sqlite3_column_bytes(stmt.get(), c)));
+    }
+
+    row.ts_sec = sqlite3_column_int64(stmt.get(), 0);
+    row.n_logs = 1;
+
+    if (type == query_type::devices) {
+        row.ts_usec = 0;
+        row.last_time = sqlite3_column_int64(stmt.get(), device_col_last);
+        row.signal = sqlite3_column_int64(stmt.get(), device_col_signal);
+    } else {
+        row.ts_usec = sqlite3_column_int64(stmt.get(), 1);
+        row.last_time = row.ts_sec;
+        row.signal = 0;
+    }
+
+    return row;
+}
+
+// Read up to max_rows from the log; returns false once the query is exhausted.  Errors
+// end the log with a warning so one damaged log doesn't stop the whole query.
+bool fill_rows(query_log& log, std::vector<query_row>& out, size_t max_rows, query_type type,
+        const std::vector<query_column>& cols, const query_filter& filter, bool verbose) {
+    try {
+        if (!log.started) {
+            log.started = true;
+
+            if (!open_log(log, verbose))
+                return false;
+
+            log.q = make_query(log.db, type, cols, filter);
+            log.iter = log.q->begin();
+        }
+
+        while (log.iter != log.q->end() && out.size() < max_rows) {
+            out.push_back(read_row(*log.iter, type, cols.size()));
+
+            if (type != query_type::devices)
+                out.back().values.push_back(log.fname);
+
+            ++log.iter;
+        }
+
+        if (log.iter != log.q->end())
+            return true;
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "WARNING: Unable to query '{}', skipping: {}\n", log.fname, e.what());
+    }
+
+    close_log(log);
+    return false;
+}
+
+std::string json_escape(const std::string& in) {
+    std::string out;
+    out.reserve(in.length() + 2);
+
+    out += '"';
+
+    for (auto c : in) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if ((unsigned char) c < 0x20)
+                    out += fmt::format("\\u{:04x}", (unsigned int) c);
+                else
+                    out += c;
+        }
+    }
+
+    out += '"';
+
+    return out;
+}
+
+std::string csv_escape(const std::string& in) {
+    if (in.find_first_of(",\"\r\n") == std::string::npos)
+        return in;
+
+    std::string out = "\"";
+
+    for (auto c : in) {
+        if (c == '"')
+            out += '"';
+        out += c;
+    }
+
+    out += '"';
+
+    return out;
+}
+
+class query_writer {
+public:
+    query_writer(FILE *in_out, bool in_csv, const std::vector<query_column>& in_cols) :
+        out{in_out},
+        csv{in_csv},
+        cols{in_cols},
+        n_written{0} { }
+
+    void header() {
+        if (!csv)
+            return;
+
+        std::string line;
+
+        for (const auto& c : cols) {
+            if (line.length())
+                line += ",";
+            line += c.name;
+        }
+
+        fmt::print(out, "{}\n", line);
+    }
+
+    void write(const query_row& row) {
+        std::string line;
+
+        if (csv) {
+            for (size_t i = 0; i < row.values.size() && i < cols.size(); i++) {
+                if (i != 0)
+                    line += ",";
+                line += csv_escape(row.values[i]);
+            }
+        } else {
+            line = "{";
+
+            for (size_t i = 0; i < row.values.size() && i < cols.size(); i++) {
+                if (i != 0)
+                    line += ",";
+
+                line += json_escape(cols[i].name);
+                line += ":";
+
+                if (cols[i].type == column_type::text)
+                    line += json_escape(row.values[i]);
+                else if (row.values[i].length() == 0)
+                    line += "null";
+                else
+                    line += row.values[i];
+            }
+
+            line += "}";
+        }
+
+        fmt::print(out, "{}\n", line);
+        n_written++;
+    }
+
+    uint64_t written() const { return n_written; }
+
+protected:
+    FILE *out;
+    bool csv;
+    std::vector<query_column> cols;
+    uint64_t n_written;
+};
+
+// Stream packets or alerts from every log, merged into time order.  Workers keep a few
+// batches read ahead from each log; the calling thread repeatedly writes the oldest row
+// at the head of any log, reading a log itself when it catches up with the workers.
+void merge_stream(std::vector<query_log>& logs, unsigned int n_threads, query_type type,
+        const std::vector<query_column>& cols, const query_filter& filter, bool verbose,
+        query_writer& writer) {
+    const size_t batch_sz = 256;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool shutdown = false;
+
+    // Read a batch from a log which has been marked busy, then publish it
+    auto fill = [&](query_log& log) {
+        std::vector<query_row> rows;
+        auto more = fill_rows(log, rows, batch_sz, type, cols, filter, verbose);
+
+        std::lock_guard<std::mutex> lk(mutex);
+
+        for (auto& r : rows)
+            log.rows.push_back(std::move(r));
+
+        log.done = !more;
+        log.busy = false;
+
+        cv.notify_all();
+    };
+
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lk(mutex);
+
+        while (!shutdown) {
+            // Top up the log with the fewest rows waiting
+            query_log *target = nullptr;
+
+            for (auto& l : logs) {
+                if (l.busy || l.done || l.rows.size() >= batch_sz * 2)
+                    continue;
+
+                if (target == nullptr || l.rows.size() < target->rows.size())
+                    target = &l;
+            }
+
+            if (target == nullptr) {
+                cv.wait(lk);
+                continue;
+            }
+
+            target->busy = true;
+
+            lk.unlock();
+            fill(*target);
+            lk.lock();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < n_threads; i++)
+        threads.push_back(std::thread(worker));
+
+    // Wait for the head row of a log; returns false when the log has no more rows
+    auto wait_head = [&](query_log& log) -> bool {
+        std::unique_lock<std::mutex> lk(mutex);
+
+        while (log.rows.size() == 0 && !log.done) {
+            if (log.busy) {
+                cv.wait(lk);
+                continue;
+            }
+
+            log.busy = true;
+
+            lk.unlock();
+            fill(log);
+            lk.lock();
+        }
+
+        return log.rows.size() != 0;
+    };
+
+    using merge_key = std::tuple<int64_t, int64_t, size_t>;
+    std::priority_queue<merge_key, std::vector<merge_key>, std::greater<merge_key>> heads;
+
+    for (size_t i = 0; i < logs.size(); i++) {
+        if (wait_head(logs[i])) {
+            std::lock_guard<std::mutex> lk(mutex);
+            heads.push(merge_key{logs[i].rows.front().ts_sec, logs[i].rows.front().ts_usec, i});
+        }
+    }
+
+    while (heads.size() != 0) {
+        auto idx = std::get<2>(heads.top());
+        heads.pop();
+
+        query_row row;
+
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            row = std::move(logs[idx].rows.front());
+            logs[idx].rows.pop_front();
+        }
+
+        cv.notify_all();
+
+        writer.write(row);
+
+        if (wait_head(logs[idx])) {
+            std::lock_guard<std::mutex> lk(mutex);
+            heads.push(merge_key{logs[idx].rows.front().ts_sec,
+                    logs[idx].rows.front().ts_usec, idx});
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        shutdown = true;
+    }
+
+    cv.notify_all();
+
+    for (auto& t : threads)
+        t.join();
+}
+
+// Combine records of a device from more than one log; the record from the log which saw
+// the device most recently is kept, widened to the first time and strongest signal seen
+void merge_device(query_row& into, query_row& from) {
+    auto first_time = std::min(into.ts_sec, from.ts_sec);
+
+    int64_t signal = into.signal;
+    if (signal == 0 || (from.signal != 0 && from.signal > signal))
+        signal = from.signal;
+
+    auto n_logs = into.n_logs + from.n_logs;
+
+    if (from.last_time > into.last_time)
+        std::swap(into, from);
+
+    into.ts_sec = first_time;
+    into.signal = signal;
+    into.n_logs = n_logs;
+}
+
+// Query the devices of every log in parallel, one log per thread at a time, combining
+// devices by key as they're read
+void merge_devices(std::vector<query_log>& logs, unsigned int n_threads,
+        const std::vector<query_column>& cols, const query_filter& filter, bool verbose,
+        query_writer& writer) {
+    std::mutex mutex;
+    std::unordered_map<std::string, query_row> devices;
+    std::atomic<size_t> next_log{0};
+
+    auto worker = [&]() {
+        std::unordered_map<std::string, query_row> local;
+        std::vector<query_row> rows;
+
+        while (true) {
+            auto idx = next_log++;
+
+            if (idx >= logs.size())
+                break;
+
+            bool more = true;
+
+            while (more) {
+                rows.clear();
+                more = fill_rows(logs[idx], rows, 1024, query_type::devices, cols, filter, verbose);
+
+                for (auto& r : rows) {
+                    auto key = r.values[device_col_key];
+                    auto di = local.find(key);
+
+                    if (di == local.end())
+                        local.emplace(key, std::move(r));
+                    else
+                        merge_device(di->second, r);
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lk(mutex);
+
+        for (auto& l : local) {
+            auto di = devices.find(l.first);
+
+            if (di == devices.end())
+                devices.emplace(l.first, std::move(l.second));
+            else
+                merge_device(di->second, l.second);
+        }
+    };
+
+    if (n_threads == 0) {
+        worker();
+    } else {
+        std::vector<std::thread> threads;
+        for (unsigned int i = 0; i < n_threads; i++)
+            threads.push_back(std::thread(worker));
+        for (auto& t : threads)
+            t.join();
+    }
+
+    std::vector<query_row *> sorted;
+    sorted.reserve(devices.size());
+
+    for (auto& d : devices)
+        sorted.push_back(&d.second);
+
+    std::sort(sorted.begin(), sorted.end(), [](const query_row *a, const query_row *b) {
+            if (a->ts_sec != b->ts_sec)
+                return a->ts_sec < b->ts_sec;
+            return a->values[device_col_key] < b->values[device_col_key];
+            });
+
+    for (auto d : sorted) {
+        d->values[device_col_first] = fmt::format("{}", d->ts_sec);
+        d->values[device_col_signal] = fmt::format("{}", d->signal);
+        d->values.push_back(fmt::format("{}", d->n_logs));
+        writer.write(*d);
+    }
+}
+
+void print_help(char *argv) {
+    printf("Kismetdb multi-log query\n");
+    printf("Query devices, packets, or alerts across many kismetdb logs at once.\n");
+    printf("usage: %s [OPTION] [kismetdb file] ...\n", argv);
+    printf(" -i, --in [filename]          Input kismetdb file; may be given multiple times, and\n"
+           "                              any other arguments are read as input files too\n"
+           " -l, --list [filename]        Read input kismetdb files from [filename], one per line\n"
+           " -o, --out [filename]         Output file, or '-' for stdout (the default)\n"
+           " -t, --type [type]            Query 'devices' (the default), 'packets', or 'alerts'\n"
+           "     --csv                    Write CSV instead of JSON lines\n"
+           "     --full                   Include the full device or alert JSON record\n"
+           "     --start-time [unix time] Only include records seen at or after this time\n"
+           "     --end-time [unix time]   Only include records seen before this time\n"
+           "     --device [mac]           Only include records to, from, or of this MAC address.\n"
+           "                              Multiple device arguments can be given.\n"
+           "     --phy [phyname]          Only include records from this phy.  Multiple phy\n"
+           "                              arguments can be given.\n"
+           "     --threads [num]          Query logs on [num] threads; 0 queries every log in\n"
+           "                              turn on a single thread.  Defaults to the number of CPUs.\n"
+           " -v, --verbose                Verbose output\n"
+           "\n"
+           "Any segment of a rotated log reads the whole series of segments; giving more than\n"
+           "one segment of the same series reads it once.\n"
+           "\n"
+           "Packets and alerts are written in time order.  Devices are written by first time\n"
+           "seen; a device found in multiple logs is written once, from the log which saw it\n"
+           "most recently, with the earliest first time and strongest signal of any log and\n"
+           "the count of logs it was found in.\n");
+}
+
+int main(int argc, char *argv[]) {
+#define OPT_CSV                 1000
+#define OPT_FULL                1001
+#define OPT_START_TIME          1002
+#define OPT_END_TIME            1003
+#define OPT_FILTER_DEVICE       1004
+#define OPT_FILTER_PHY          1005
+#define OPT_THREADS             1006
+    static struct option longopt[] = {
+        { "in", required_argument, 0, 'i' },
+        { "list", required_argument, 0, 'l' },
+        { "out", required_argument, 0, 'o' },
+        { "type", required_argument, 0, 't' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { "csv", no_argument, 0, OPT_CSV },
+        { "full", no_argument, 0, OPT_FULL },
+        { "start-time", required_argument, 0, OPT_START_TIME },
+        { "end-time", required_argument, 0, OPT_END_TIME },
+        { "device", required_argument, 0, OPT_FILTER_DEVICE },
+        { "phy", required_argument, 0, OPT_FILTER_PHY },
+        { "threads", required_argument, 0, OPT_THREADS },
+        { 0, 0, 0, 0 }
+    };
+
+    int option_idx = 0;
+    optind = 0;
+    opterr = 0;
+
+    std::vector<std::string> in_fnames;
+    std::string out_fname = "-";
+    query_type type = query_type::devices;
+    query_filter filter;
+    bool csv = false;
+    bool full = false;
+    bool verbose = false;
+    unsigned int n_threads = std::thread::hardware_concurrency();
+
+    struct stat statbuf;
+
+    while (1) {
+        int r = getopt_long(argc, argv,
+                            "-hi:l:o:t:v",
+                            longopt, &option_idx);
+        if (r < 0) break;
+
+        if (r == 'h') {
+            print_help(argv[0]);
+            exit(1);
+        } else if (r == 'i' || r == 1) {
+            in_fnames.push_back(std::string(optarg));
+        } else if (r == 'l') {
+            std::ifstream list(optarg);
+
+            if (!list.is_open()) {
+                fmt::print(stderr, "ERROR:  Unable to open input list '{}'\n", optarg);
+                exit(1);
+            }
+
+            std::string line;
+            while (std::getline(list, line)) {
+                if (line.length() != 0)
+                    in_fnames.push_back(line);
+            }
+        } else if (r == 'o') {
+            out_fname = std::string(optarg);
+        } else if (r == 't') {
+            auto t = std::string(optarg);
+
+            if (t == "devices") {
+                type = query_type::devices;
+            } else if (t == "packets") {
+                type = query_type::packets;
+            } else if (t == "alerts") {
+                type = query_type::alerts;
+            } else {
+                fmt::print(stderr, "ERROR: Expected --type devices, packets, or alerts\n");
+                exit(1);
+            }
+        } else if (r == 'v') {
+            verbose = true;
+        } else if (r == OPT_CSV) {
+            csv = true;
+        } else if (r == OPT_FULL) {
+            full = true;
+        } else if (r == OPT_START_TIME) {
+            if (sscanf(optarg, "%lu", &filter.start_time) != 1) {
+                fmt::print(stderr, "ERROR: Expected --start-time [unix time]\n");
+                exit(1);
+            }
+        } else if (r == OPT_END_TIME) {
+            if (sscanf(optarg, "%lu", &filter.end_time) != 1) {
+                fmt::print(stderr, "ERROR: Expected --end-time [unix time]\n");
+                exit(1);
+            }
+        } else if (r == OPT_FILTER_DEVICE) {
+            filter.device_vec.push_back(std::string(optarg));
+        } else if (r == OPT_FILTER_PHY) {
+            filter.phy_vec.push_back(std::string(optarg));
+        } else if (r == OPT_THREADS) {
+            if (sscanf(optarg, "%u", &n_threads) != 1) {
+                fmt::print(stderr, "ERROR: Expected --threads [number]\n");
+                exit(1);
+            }
+        }
+    }
+
+    if (in_fnames.size() == 0) {
+        fmt::print(stderr, "ERROR: Expected --in [kismetdb file]\n");
+        exit(1);
+    }
+
+    // The full records are JSON already, and don't fit in a CSV column
+    if (csv)
+        full = false;
+
+    // Open each series of segments only once, through the first of its segments given
+    std::vector<query_log> logs;
+    std::set<std::string> series_seen;
+
+    for (const auto& f : in_fnames) {
+        if (stat(f.c_str(), &statbuf) < 0) {
+            if (errno == ENOENT)
+                fmt::print(stderr, "WARNING: Input file '{}' does not exist, skipping.\n", f);
+            else
+                fmt::print(stderr, "WARNING: Unexpected problem checking input "
+                        "file '{}', skipping: {}\n", f, strerror(errno));
+            continue;
+        }
+
+        sqlite3 *db = nullptr;
+
+        if (sqlite3_open_v2(f.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+            fmt::print(stderr, "WARNING: Unable to open '{}', skipping: {}\n", f, sqlite3_errmsg(db));
+            sqlite3_close(db);
+            continue;
+        }
+
+        auto series = kismetdb_segment_series(db);
+        sqlite3_close(db);
+
+        if (series.length() != 0) {
+            if (series_seen.find(series) != series_seen.end()) {
+                if (verbose)
+                    fmt::print(stderr, "* Skipping '{}', already reading its log series\n", f);
+                continue;
+            }
+
+            series_seen.insert(series);
+        }
+
+        query_log log;
+        log.fname = f;
+        logs.push_back(std::move(log));
+    }
+
+    if (logs.size() == 0) {
+        fmt::print(stderr, "ERROR: No usable kismetdb files\n");
+        exit(1);
+    }
+
+    FILE *out = stdout;
+
+    if (out_fname != "-") {
+        out = fopen(out_fname.c_str(), "w");
+
+        if (out == nullptr) {
+            fmt::print(stderr, "ERROR:  Unable to open output file '{}': {}\n", out_fname,
+                    strerror(errno));
+            exit(1);
+        }
+    }
+
+    auto cols = query_columns(type, full);
+
+    // Output gets the log a record came from, or the number of logs a device was in
+    auto out_cols = cols;
+
+    if (type == query_type::devices)
+        out_cols.push_back({"logs", column_type::number});
+    else
+        out_cols.push_back({"log", column_type::text});
+
+    query_writer writer(out, csv, out_cols);
+    writer.header();
+
+    n_threads = std::min(n_threads, (unsigned int) logs.size());
+
+    if (type == query_type::devices)
+        merge_devices(logs, n_threads, cols, filter, verbose, writer);
+    else
+        merge_stream(logs, n_threads, type, cols, filter, verbose, writer);
+
+    if (out != stdout)
+        fclose(out);
+
+    if (verbose)
+        fmt::print(stderr, "* Wrote {} records from {} logs\n", writer.written(), logs.size());
+
+    return 0;
+}
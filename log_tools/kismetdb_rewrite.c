@@ -0,0 +1,376 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <sqlite3.h>
+
+#include "kismetdb_rewrite.h"
+
+/* Schema entries are copied in this order; indexes are built after the rows are
+ * loaded, which is much faster than maintaining them through the bulk insert */
+static const char *kismetdb_rewrite_schema_sql =
+    "SELECT type, name, sql FROM src.sqlite_master "
+    "WHERE sql IS NOT NULL AND name NOT LIKE 'sqlite_%' "
+    "ORDER BY CASE type WHEN 'table' THEN 0 WHEN 'index' THEN 1 "
+    "WHEN 'view' THEN 2 ELSE 3 END, rowid";
+
+typedef struct {
+    char *type;
+    char *name;
+    char *sql;
+} kismetdb_schema_t;
+
+static int kismetdb_rewrite_exec(sqlite3 *db, const char *sql, const char *what,
+        char *errstr, size_t errstr_sz) {
+    char *sql_errmsg = NULL;
+
+    if (sqlite3_exec(db, sql, NULL, NULL, &sql_errmsg) != SQLITE_OK) {
+        snprintf(errstr, errstr_sz, "Unable to %s: %s", what,
+                sql_errmsg != NULL ? sql_errmsg : sqlite3_errmsg(db));
+        sqlite3_free(sql_errmsg);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Column list to select from a source table; when stripping, the packet content is
+ * replaced with an empty value, and with it any reference to a packet dictionary */
+static char *kismetdb_rewrite_columns(sqlite3 *db, const char *table, int strip) {
+    sqlite3_stmt *stmt = NULL;
+    char *pragma;
+    char *cols = NULL;
+    const char *col;
+
+    pragma = sqlite3_mprintf("PRAGMA src.table_info(\"%w\")", table);
+
+    if (pragma == NULL)
+        return NULL;
+
+    if (sqlite3_prepare_v2(db, pragma, -1, &stmt, NULL) != SQLITE_OK) {
+        sqlite3_free(pragma);
+        return NULL;
+    }
+
+    sqlite3_free(pragma);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        col = (const char *) sqlite3_column_text(stmt, 1);
+
+        if (col == NULL)
+            continue;
+
+        if (strip && strcmp(col, "packet") == 0) {
+            cols = sqlite3_mprintf("%z%s''", cols, cols == NULL ? "" : ", ");
+        } else if (strip && strcmp(col, "compression") == 0) {
+            cols = sqlite3_mprintf("%z%s0", cols, cols == NULL ? "" : ", ");
+        } else {
+            cols = sqlite3_mprintf("%z%s\"%w\"", cols, cols == NULL ? "" : ", ", col);
+        }
+
+        if (cols == NULL)
+            break;
+    }
+
+    sqlite3_finalize(stmt);
+
+    return cols;
+}
+
+static int kismetdb_rewrite_copy_table(sqlite3 *db, const char *table, unsigned int flags,
+        char *errstr, size_t errstr_sz) {
+    char *sql;
+    char *cols;
+    int strip = 0;
+    int r;
+
+    if (flags & KISMETDB_REWRITE_STRIP_PACKETS) {
+        /* Nothing refers to the dictionaries once the packets are gone */
+        if (strcmp(table, "packet_dictionaries") == 0)
+            return 0;
+
+        strip = strcmp(table, "packets") == 0 || strcmp(table, "packet_payloads") == 0;
+    }
+
+    if (strip) {
+        cols = kismetdb_rewrite_columns(db, table, strip);
+
+        if (cols == NULL) {
+            snprintf(errstr, errstr_sz, "Unable to read the columns of table '%s': %s",
+                    table, sqlite3_errmsg(db));
+            return -1;
+        }
+
+        sql = sqlite3_mprintf("INSERT INTO main.\"%w\" SELECT %s FROM src.\"%w\"",
+                table, cols, table);
+        sqlite3_free(cols);
+    } else {
+        /* Identical tables let sqlite copy the records without decoding them */
+        sql = sqlite3_mprintf("INSERT INTO main.\"%w\" SELECT * FROM src.\"%w\"",
+                table, table);
+    }
+
+    if (sql == NULL) {
+        snprintf(errstr, errstr_sz, "Unable to allocate copy of table '%s'", table);
+        return -1;
+    }
+
+    r = kismetdb_rewrite_exec(db, sql, "copy table", errstr, errstr_sz);
+    sqlite3_free(sql);
+
+    if (r < 0)
+        return -1;
+
+    if (flags & KISMETDB_REWRITE_VERBOSE)
+        printf("* Copied %d rows from '%s'\n", sqlite3_changes(db), table);
+
+    return 0;
+}
+
+static int kismetdb_rewrite_sync(const char *fname, int directory) {
+    int fd;
+    int r;
+
+    fd = open(fname, directory ? O_RDONLY | O_DIRECTORY : O_RDONLY);
+
+    if (fd < 0)
+        return -1;
+
+    r = fsync(fd);
+    close(fd);
+
+    return r;
+}
+
+static int kismetdb_rewrite_db(sqlite3 *db, const char *in_fname, unsigned int flags,
+        char *errstr, size_t errstr_sz) {
+    sqlite3_stmt *stmt = NULL;
+    kismetdb_schema_t *schema = NULL;
+    size_t n_schema = 0, schema_sz = 0, i;
+    char *sql;
+    int has_sequence = 0;
+    int user_version = 0;
+    int r = -1;
+
+    if (kismetdb_rewrite_exec(db,
+                "PRAGMA main.journal_mode = OFF; "
+                "PRAGMA main.synchronous = OFF; "
+                "PRAGMA main.locking_mode = EXCLUSIVE; "
+                "PRAGMA cache_size = -65536; "
+                "PRAGMA temp_store = MEMORY",
+                "configure output database", errstr, errstr_sz) < 0)
+        return -1;
+
+    sql = sqlite3_mprintf("ATTACH DATABASE '%q' AS src", in_fname);
+
+    if (sql == NULL) {
+        snprintf(errstr, errstr_sz, "Unable to allocate attach of '%s'", in_fname);
+        return -1;
+    }
+
+    r = kismetdb_rewrite_exec(db, sql, "open input database", errstr, errstr_sz);
+    sqlite3_free(sql);
+
+    if (r < 0)
+        return -1;
+
+    r = -1;
+
+    if (sqlite3_prepare_v2(db, kismetdb_rewrite_schema_sql, -1, &stmt, NULL) != SQLITE_OK) {
+        snprintf(errstr, errstr_sz, "Unable to read schema of '%s': %s", in_fname,
+                sqlite3_errmsg(db));
+        return -1;
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (n_schema == schema_sz) {
+            kismetdb_schema_t *n;
+
+            schema_sz = schema_sz == 0 ? 32 : schema_sz * 2;
+            n = (kismetdb_schema_t *) realloc(schema, schema_sz * sizeof(kismetdb_schema_t));
+
+            if (n == NULL) {
+                snprintf(errstr, errstr_sz, "Unable to allocate schema of '%s'", in_fname);
+                goto end;
+            }
+
+            schema = n;
+        }
+
+        schema[n_schema].type = strdup((const char *) sqlite3_column_text(stmt, 0));
+        schema[n_schema].name = strdup((const char *) sqlite3_column_text(stmt, 1));
+        schema[n_schema].sql = strdup((const char *) sqlite3_column_text(stmt, 2));
+        n_schema++;
+    }
+
+    sqlite3_finalize(stmt);
+    stmt = NULL;
+
+    if (n_schema == 0) {
+        snprintf(errstr, errstr_sz, "'%s' does not look like a kismetdb log, no tables "
+                "found", in_fname);
+        goto end;
+    }
+
+    if (kismetdb_rewrite_exec(db, "BEGIN TRANSACTION", "begin transaction",
+                errstr, errstr_sz) < 0)
+        goto end;
+
+    for (i = 0; i < n_schema; i++) {
+        if (kismetdb_rewrite_exec(db, schema[i].sql, "create schema", errstr, errstr_sz) < 0)
+            goto end;
+
+        if (strcmp(schema[i].type, "table") == 0 &&
+                kismetdb_rewrite_copy_table(db, schema[i].name, flags, errstr, errstr_sz) < 0)
+            goto end;
+    }
+
+    /* Carry over the autoincrement counters */
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM src.sqlite_master WHERE name = 'sqlite_sequence'",
+                -1, &stmt, NULL) == SQLITE_OK) {
+        has_sequence = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+        stmt = NULL;
+    }
+
+    if (has_sequence && kismetdb_rewrite_exec(db,
+                "DELETE FROM main.sqlite_sequence; "
+                "INSERT INTO main.sqlite_sequence SELECT * FROM src.sqlite_sequence",
+                "copy autoincrement counters", errstr, errstr_sz) < 0)
+        goto end;
+
+    if (sqlite3_prepare_v2(db, "PRAGMA src.user_version", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+            user_version = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+        stmt = NULL;
+    }
+
+    if (user_version != 0) {
+        char vsql[64];
+        snprintf(vsql, sizeof(vsql), "PRAGMA main.user_version = %d", user_version);
+
+        if (kismetdb_rewrite_exec(db, vsql, "copy user version", errstr, errstr_sz) < 0)
+            goto end;
+    }
+
+    if (kismetdb_rewrite_exec(db, "COMMIT", "commit rewritten database",
+                errstr, errstr_sz) < 0)
+        goto end;
+
+    if (kismetdb_rewrite_exec(db, "DETACH DATABASE src", "close input database",
+                errstr, errstr_sz) < 0)
+        goto end;
+
+    r = 0;
+
+end:
+    if (stmt != NULL)
+        sqlite3_finalize(stmt);
+
+    for (i = 0; i < n_schema; i++) {
+        free(schema[i].type);
+        free(schema[i].name);
+        free(schema[i].sql);
+    }
+
+    free(schema);
+
+    return r;
+}
+
+int kismetdb_rewrite(const char *in_fname, const char *out_fname, unsigned int flags,
+        char *errstr, size_t errstr_sz) {
+    sqlite3 *db = NULL;
+    char *tmp_fname;
+    char *dir_fname;
+    struct stat statbuf;
+    size_t tmp_len;
+    int r;
+
+    tmp_len = strlen(out_fname) + 32;
+    tmp_fname = (char *) malloc(tmp_len);
+
+    if (tmp_fname == NULL) {
+        snprintf(errstr, errstr_sz, "Unable to allocate temporary file name");
+        return -1;
+    }
+
+    /* The new log is built next to the target so it can be renamed into place */
+    snprintf(tmp_fname, tmp_len, "%s.rewrite-%d", out_fname, (int) getpid());
+    unlink(tmp_fname);
+
+    if (sqlite3_open(tmp_fname, &db) != SQLITE_OK) {
+        snprintf(errstr, errstr_sz, "Unable to create '%s': %s", tmp_fname,
+                sqlite3_errmsg(db));
+        sqlite3_close(db);
+        unlink(tmp_fname);
+        free(tmp_fname);
+        return -1;
+    }
+
+    r = kismetdb_rewrite_db(db, in_fname, flags, errstr, errstr_sz);
+
+    if (sqlite3_close(db) != SQLITE_OK && r == 0) {
+        snprintf(errstr, errstr_sz, "Unable to close '%s'", tmp_fname);
+        r = -1;
+    }
+
+    if (r == 0 && kismetdb_rewrite_sync(tmp_fname, 0) < 0) {
+        snprintf(errstr, errstr_sz, "Unable to sync '%s': %s", tmp_fname, strerror(errno));
+        r = -1;
+    }
+
+    /* Keep the permissions of a log being replaced */
+    if (r == 0 && stat(out_fname, &statbuf) == 0)
+        chmod(tmp_fname, statbuf.st_mode & 07777);
+
+    if (r == 0 && rename(tmp_fname, out_fname) < 0) {
+        snprintf(errstr, errstr_sz, "Unable to replace '%s': %s", out_fname, strerror(errno));
+        r = -1;
+    }
+
+    if (r < 0) {
+        unlink(tmp_fname);
+        free(tmp_fname);
+        return -1;
+    }
+
+    free(tmp_fname);
+
+    /* Make the rename itself durable */
+    dir_fname = strdup(out_fname);
+
+    if (dir_fname != NULL) {
+        kismetdb_rewrite_sync(dirname(dir_fname), 1);
+        free(dir_fname);
+    }
+
+    return 0;
+}
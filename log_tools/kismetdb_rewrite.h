@@ -0,0 +1,61 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KISMETDB_REWRITE_H__
+#define __KISMETDB_REWRITE_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Single-pass kismetdb rewriter
+ *
+ * Copies every table of a kismetdb into a new database next to the target, in one
+ * transaction with journaling and syncing off, then creates the indexes, views, and
+ * triggers once the rows are in place, syncs the new file, and renames it over the
+ * target.  The target is either a new file or the input itself; the disk needed is
+ * the size of the rewritten log, instead of the two copies VACUUM needs, and the
+ * original is untouched until the rename.
+ *
+ * Opening the input rolls back any incomplete journal left by a crashed server, so
+ * the rewritten log is always consistent.
+ */
+
+/* Replace packet content with an empty value, and drop the packet dictionaries */
+#define KISMETDB_REWRITE_STRIP_PACKETS      (1 << 0)
+
+/* Print progress per table */
+#define KISMETDB_REWRITE_VERBOSE            (1 << 1)
+
+/* Rewrite in_fname into out_fname, which may be the same file.  On error, the reason
+ * is written to errstr and the target is left as it was.
+ *
+ * Returns:
+ * -1   Error
+ *  0   Success
+ */
+int kismetdb_rewrite(const char *in_fname, const char *out_fname, unsigned int flags,
+        char *errstr, size_t errstr_sz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,395 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KISMETDB_SEGMENTS_H__
+#define __KISMETDB_SEGMENTS_H__
+
+#include "config.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <string.h>
+#include <sys/stat.h>
+#include <sqlite3.h>
+#include <zlib.h>
+
+#include "fmt.h"
+
+// Kismet can rotate a long-running kismetdb log into segments.  Every segment has a
+// 'segments' manifest table holding the series uuid and the segments up to and including
+// itself; later segments are found by the same naming rule the server uses
+// (kis_database_logfile::segment_path) and confirmed by their series uuid.
+//
+// The log tools attach the other segments of a series to the database they were given
+// and shadow each log table with a temporary view over all of them, so the rest of the
+// tool reads the whole series as a single log.
+//
+// Logs with compressed packets get the same treatment; the packets view inflates each
+// packet with the dictionary it was compressed with, so tools always see raw packets.
+
+inline std::string kismetdb_segment_path(const std::string& first, unsigned int n) {
+    if (n <= 1)
+        return first;
+
+    auto slash = first.find_last_of('/');
+    auto dot = first.find_last_of('.');
+
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return fmt::format("{}-seg{:04}", first, n);
+
+    return fmt::format("{}-seg{:04}{}", first.substr(0, dot), n, first.substr(dot));
+}
+
+// kismetdb_inflate(schema, packet, compression, packet_len)
+inline void kismetdb_inflate_func(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
+    static std::map<std::pair<std::string, int64_t>, std::string> dictionaries;
+
+    auto compression = sqlite3_value_int64(argv[2]);
+
+    if (compression <= 0) {
+        sqlite3_result_value(ctx, argv[1]);
+        return;
+    }
+
+    auto schema_t = sqlite3_value_text(argv[0]);
+    std::string schema = schema_t == nullptr ? "main" : reinterpret_cast<const char *>(schema_t);
+
+    auto key = std::make_pair(schema, compression);
+    auto di = dictionaries.find(key);
+
+    if (di == dictionaries.end()) {
+        sqlite3_stmt *stmt;
+        std::string dictionary;
+
+        auto sql = fmt::format("SELECT dictionary FROM \"{}\".packet_dictionaries WHERE id = ?", 
+                schema);
+
+        if (sqlite3_prepare_v2(sqlite3_context_db_handle(ctx), sql.c_str(), -1, 
+                    &stmt, nullptr) != SQLITE_OK) {
+            sqlite3_result_error(ctx, "unable to read packet dictionaries", -1);
+            return;
+        }
+
+        sqlite3_bind_int64(stmt, 1, compression);
+
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            auto b = sqlite3_column_blob(stmt, 0);
+            if (b != nullptr)
+                dictionary = std::string(reinterpret_cast<const char *>(b), 
+                        sqlite3_column_bytes(stmt, 0));
+        }
+
+        sqlite3_finalize(stmt);
+
+        di = dictionaries.emplace(key, dictionary).first;
+    }
+
+    std::string out;
+    out.resize(sqlite3_value_int64(argv[3]));
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(z_stream));
+
+    if (inflateInit2(&zs, -15) != Z_OK) {
+        sqlite3_result_error(ctx, "unable to inflate packet", -1);
+        return;
+    }
+
+    if (di->second.length() > 0)
+        inflateSetDictionary(&zs, reinterpret_cast<const Bytef *>(di->second.data()), 
+                di->second.length());
+
+    zs.next_in = const_cast<Bytef *>(reinterpret_cast<const Bytef *>(sqlite3_value_blob(argv[1])));
+    zs.avail_in = sqlite3_value_bytes(argv[1]);
+    zs.next_out = reinterpret_cast<Bytef *>(&out[0]);
+    zs.avail_out = out.length();
+
+    auto r = inflate(&zs, Z_FINISH);
+    inflateEnd(&zs);
+
+    if (r != Z_STREAM_END) {
+        sqlite3_result_error(ctx, "unable to inflate packet", -1);
+        return;
+    }
+
+    sqlite3_result_blob(ctx, out.data(), out.length() - zs.avail_out, SQLITE_TRANSIENT);
+}
+
+inline bool kismetdb_has_column(sqlite3 *db, const std::string& schema, const std::string& table,
+        const std::string& column) {
+    sqlite3_stmt *stmt;
+    bool found = false;
+
+    auto sql = fmt::format("PRAGMA \"{}\".table_info(\"{}\")", schema, table);
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return false;
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto n = sqlite3_column_text(stmt, 1);
+        if (n != nullptr && column == reinterpret_cast<const char *>(n))
+            found = true;
+    }
+
+    sqlite3_finalize(stmt);
+
+    return found;
+}
+
+inline std::vector<std::string> kismetdb_columns(sqlite3 *db, const std::string& schema, 
+        const std::string& table) {
+    sqlite3_stmt *stmt;
+    std::vector<std::string> columns;
+
+    auto sql = fmt::format("PRAGMA \"{}\".table_info(\"{}\")", schema, table);
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return columns;
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto n = sqlite3_column_text(stmt, 1);
+        if (n != nullptr)
+            columns.push_back(reinterpret_cast<const char *>(n));
+    }
+
+    sqlite3_finalize(stmt);
+
+    return columns;
+}
+
+inline std::string kismetdb_segment_series(sqlite3 *db, unsigned int *segment = nullptr) {
+    sqlite3_stmt *stmt;
+    std::string series;
+
+    // The last row in a segment manifest is always the segment itself
+    if (sqlite3_prepare_v2(db, "SELECT series, segment FROM segments ORDER BY segment DESC LIMIT 1",
+                -1, &stmt, nullptr) != SQLITE_OK)
+        return series;
+
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto s = sqlite3_column_text(stmt, 0);
+        if (s != nullptr)
+            series = reinterpret_cast<const char *>(s);
+        if (segment != nullptr)
+            *segment = sqlite3_column_int(stmt, 1);
+    }
+
+    sqlite3_finalize(stmt);
+
+    return series;
+}
+
+// All segments in the series of the open log, oldest first; a log which was never rotated
+// is a series of one
+inline std::vector<std::string> kismetdb_find_segments(sqlite3 *db, const std::string& in_fname) {
+    std::vector<std::string> segments;
+
+    unsigned int self_segment = 0;
+    auto series = kismetdb_segment_series(db, &self_segment);
+
+    if (series.length() == 0 || self_segment == 0) {
+        segments.push_back(in_fname);
+        return segments;
+    }
+
+    auto slash = in_fname.find_last_of('/');
+    auto dir = slash == std::string::npos ? std::string("") : in_fname.substr(0, slash + 1);
+
+    sqlite3_stmt *stmt;
+
+    if (sqlite3_prepare_v2(db, "SELECT segment, path FROM segments ORDER BY segment",
+                -1, &stmt, nullptr) != SQLITE_OK) {
+        segments.push_back(in_fname);
+        return segments;
+    }
+
+    std::string first;
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto n = (unsigned int) sqlite3_column_int(stmt, 0);
+        auto p = sqlite3_column_text(stmt, 1);
+
+        if (p == nullptr)
+            continue;
+
+        auto path = dir + reinterpret_cast<const char *>(p);
+
+        if (n == 1)
+            first = path;
+
+        // Use the name we were given for ourselves
+        if (n == self_segment)
+            path = in_fname;
+
+        segments.push_back(path);
+    }
+
+    sqlite3_finalize(stmt);
+
+    if (first.length() == 0)
+        return segments;
+
+    // Look for newer segments of the same series
+    for (unsigned int n = self_segment + 1; ; n++) {
+        auto path = kismetdb_segment_path(first, n);
+        struct stat sb;
+
+        if (stat(path.c_str(), &sb) < 0)
+            break;
+
+        sqlite3 *seg_db = nullptr;
+
+        if (sqlite3_open_v2(path.c_str(), &seg_db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+            sqlite3_close(seg_db);
+            break;
+        }
+
+        auto seg_series = kismetdb_segment_series(seg_db);
+        sqlite3_close(seg_db);
+
+        if (seg_series != series)
+            break;
+
+        segments.push_back(path);
+    }
+
+    return segments;
+}
+
+// Attach every other segment of the series and replace each log table with a temporary
+// view over the whole series; returns the number of segments now visible
+inline unsigned int kismetdb_attach_segments(sqlite3 *db, const std::string& in_fname,
+        bool verbose) {
+    auto segments = kismetdb_find_segments(db, in_fname);
+
+    // Compressed packets are marked by a compression column in the packets table
+    bool compressed = kismetdb_has_column(db, "main", "packets", "compression");
+
+    if (segments.size() <= 1 && !compressed)
+        return 1;
+
+    if (compressed)
+        sqlite3_create_function(db, "kismetdb_inflate", 4, SQLITE_UTF8, nullptr, 
+                kismetdb_inflate_func, nullptr, nullptr);
+
+    auto max_attached = (size_t) sqlite3_limit(db, SQLITE_LIMIT_ATTACHED, -1);
+
+    if (segments.size() - 1 > max_attached) {
+        fmt::print(stderr, "WARNING: Log has {} segments, but only {} can be combined; only the "
+                "first {} segments will be read.\n", segments.size(), max_attached + 1,
+                max_attached + 1);
+    }
+
+    // main plus attached names, in segment order
+    std::vector<std::string> schemas;
+    unsigned int attached = 0;
+
+    for (const auto& s : segments) {
+        if (s == in_fname) {
+            schemas.push_back("main");
+            continue;
+        }
+
+        if (attached >= max_attached)
+            continue;
+
+        auto schema = fmt::format("seg{}", attached);
+
+        // Quote the path for sql
+        std::string quoted;
+        for (auto c : s) {
+            quoted += c;
+            if (c == '\'')
+                quoted += c;
+        }
+
+        auto sql = fmt::format("ATTACH DATABASE '{}' AS {}", quoted, schema);
+
+        char *err = nullptr;
+        if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+            fmt::print(stderr, "WARNING: Unable to open log segment {}, skipping: {}\n", s, err);
+            sqlite3_free(err);
+            continue;
+        }
+
+        if (verbose)
+            fmt::print(stderr, "* Reading log segment {}\n", s);
+
+        schemas.push_back(schema);
+        attached++;
+    }
+
+    // Shadow each log table and view with the union of every segment
+    std::vector<std::string> tables;
+    sqlite3_stmt *stmt;
+
+    if (sqlite3_prepare_v2(db, "SELECT name FROM main.sqlite_master WHERE type IN ('table', 'view') "
+                "AND name NOT IN ('KISMET', 'segments') AND name NOT LIKE 'sqlite_%'",
+                -1, &stmt, nullptr) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            auto n = sqlite3_column_text(stmt, 0);
+            if (n != nullptr)
+                tables.push_back(reinterpret_cast<const char *>(n));
+        }
+
+        sqlite3_finalize(stmt);
+    }
+
+    for (const auto& t : tables) {
+        std::string sql = fmt::format("CREATE TEMP VIEW \"{}\" AS ", t);
+        bool first = true;
+
+        for (const auto& s : schemas) {
+            if (!first)
+                sql += " UNION ALL ";
+            first = false;
+
+            if (compressed && t == "packets" && kismetdb_has_column(db, s, t, "compression")) {
+                std::string cols;
+
+                for (const auto& c : kismetdb_columns(db, s, t)) {
+                    if (cols.length())
+                        cols += ", ";
+
+                    if (c == "packet")
+                        cols += fmt::format("kismetdb_inflate('{}', packet, compression, "
+                                "packet_len) AS packet", s);
+                    else
+                        cols += fmt::format("\"{}\"", c);
+                }
+
+                sql += fmt::format("SELECT {} FROM {}.\"{}\"", cols, s, t);
+            } else {
+                sql += fmt::format("SELECT * FROM {}.\"{}\"", s, t);
+            }
+        }
+
+        char *err = nullptr;
+        if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+            fmt::print(stderr, "WARNING: Unable to combine the {} table across log segments: {}\n",
+                    t, err);
+            sqlite3_free(err);
+        }
+    }
+
+    return schemas.size();
+}
+
+#endif
@@ -39,6 +39,7 @@
 #include "json/json.h"
 #include "sqlite3_cpp11.h"
 #include "fmt.h"
+#include "kismetdb_segments.h"
 #include "packet_ieee80211.h"
 
 
@@ -65,7 +66,9 @@ void print_help(char *argv) {
     printf("usage: %s [OPTION]\n", argv);
     printf(" -i, --in [filename]          Input kismetdb file\n"
            " -s, --skip-clean             Don't clean (sql vacuum) input database\n"
-           " -j, --json                   Dump stats as a JSON dictionary\n");
+           " -j, --json                   Dump stats as a JSON dictionary\n"
+           " -c, --scan                   Count records by scanning the log instead of\n"
+           "                              using the summary table kept by the server\n");
 }
 
 int main(int argc, char *argv[]) {
@@ -73,6 +76,7 @@ int main(int argc, char *argv[]) {
         { "in", required_argument, 0, 'i' },
         { "skip-clean", no_argument, 0, 's' },
         { "json", no_argument, 0, 'j' },
+        { "scan", no_argument, 0, 'c' },
         { "help", no_argument, 0, 'h' },
         { 0, 0, 0, 0 }
     };
@@ -84,6 +88,7 @@ int main(int argc, char *argv[]) {
     std::string in_fname;
     bool skipclean = false;
     bool outputjson = false;
+    bool force_scan = false;
     Json::Value root;
 
     int sql_r = 0;
@@ -94,7 +99,7 @@ int main(int argc, char *argv[]) {
 
     while (1) {
         int r = getopt_long(argc, argv, 
-                            "-hi:sj", longopt, &option_idx);
+                            "-hi:sjc", longopt, &option_idx);
         if (r < 0) break;
 
         if (r == 'h') {
@@ -106,6 +111,8 @@ int main(int argc, char *argv[]) {
             skipclean = true;
         } else if (r == 'j') {
             outputjson = true;
+        } else if (r == 'c') {
+            force_scan = true;
         }
     }
 
@@ -147,6 +154,9 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // Read every segment of a rotated log as one log
+    kismetdb_attach_segments(db, in_fname, false);
+
     // Use our sql adapters
 
     using namespace kissqlite3;
@@ -167,18 +177,55 @@ int main(int argc, char *argv[]) {
             fmt::print("\n");
         }
 
+        // Logs written by a current server carry a summary table, updated at every commit,
+        // which answers the counts without scanning the packets, data, and devices tables.
+        // It counts every record written, including any since removed by a log timeout.
+        bool use_summary = false;
+
+        if (!force_scan) {
+            try {
+                auto summary_q = _SELECT(db, "summary", {"count(*)"});
+                auto summary_ret = summary_q.run();
+                use_summary = sqlite3_column_as<unsigned long>(*summary_ret, 0) != 0;
+            } catch (const std::exception& e) {
+                use_summary = false;
+            }
+        }
+
+        if (outputjson)
+            root["from_summary"] = use_summary;
+
         // Get the total counts
-        auto npackets_q = _SELECT(db, "packets", 
-                {"count(*), sum(case when (lat != 0 and lon != 0) then 1 else 0 end)"});
-        auto npackets_ret = npackets_q.run();
-        auto n_total_packets_db = sqlite3_column_as<unsigned long>(*npackets_ret, 0);
-        auto n_packets_with_loc = sqlite3_column_as<unsigned long>(*npackets_ret, 1);
-
-        auto ndata_q = _SELECT(db, "data",
-                {"count(*), sum(case when(lat != 0 and lon != 0) then 1 else 0 end)"});
-        auto ndata_ret = ndata_q.run();
-        auto n_total_data_db = sqlite3_column_as<unsigned long>(*ndata_ret, 0);
-        auto n_data_with_loc = sqlite3_column_as<unsigned long>(*ndata_ret, 1);
+        unsigned long n_total_packets_db, n_packets_with_loc;
+        unsigned long n_total_data_db, n_data_with_loc;
+
+        if (use_summary) {
+            auto npackets_q = _SELECT(db, "summary", 
+                    {"sum(count)", "sum(with_location)"},
+                    _WHERE("kind", EQ, "packets"));
+            auto npackets_ret = npackets_q.run();
+            n_total_packets_db = sqlite3_column_as<unsigned long>(*npackets_ret, 0);
+            n_packets_with_loc = sqlite3_column_as<unsigned long>(*npackets_ret, 1);
+
+            auto ndata_q = _SELECT(db, "summary", 
+                    {"sum(count)", "sum(with_location)"},
+                    _WHERE("kind", EQ, "data"));
+            auto ndata_ret = ndata_q.run();
+            n_total_data_db = sqlite3_column_as<unsigned long>(*ndata_ret, 0);
+            n_data_with_loc = sqlite3_column_as<unsigned long>(*ndata_ret, 1);
+        } else {
+            auto npackets_q = _SELECT(db, "packets", 
+                    {"count(*), sum(case when (lat != 0 and lon != 0) then 1 else 0 end)"});
+            auto npackets_ret = npackets_q.run();
+            n_total_packets_db = sqlite3_column_as<unsigned long>(*npackets_ret, 0);
+            n_packets_with_loc = sqlite3_column_as<unsigned long>(*npackets_ret, 1);
+
+            auto ndata_q = _SELECT(db, "data",
+                    {"count(*), sum(case when(lat != 0 and lon != 0) then 1 else 0 end)"});
+            auto ndata_ret = ndata_q.run();
+            n_total_data_db = sqlite3_column_as<unsigned long>(*ndata_ret, 0);
+            n_data_with_loc = sqlite3_column_as<unsigned long>(*ndata_ret, 1);
+        }
 
         if (outputjson) {
             root["packets"] = (uint64_t) n_total_packets_db;
@@ -189,7 +236,10 @@ int main(int argc, char *argv[]) {
             fmt::print("\n");
         }
        
-        auto ndevices_q = _SELECT(db, "devices", {"count(*)", "min(first_time)", "max(last_time)"});
+        auto ndevices_q = use_summary ?
+            _SELECT(db, "summary", {"sum(count)", "min(first_time)", "max(last_time)"},
+                    _WHERE("kind", EQ, "devices")) :
+            _SELECT(db, "devices", {"count(*)", "min(first_time)", "max(last_time)"});
         auto ndevices_ret = ndevices_q.run();
         auto n_total_devices = sqlite3_column_as<unsigned long>(*ndevices_ret, 0);
         auto min_time = sqlite3_column_as<time_t>(*ndevices_ret, 1);
@@ -316,9 +366,9 @@ int main(int argc, char *argv[]) {
         // Extract tags
         std::map<std::string, bool> tag_map;
 
-        auto tags_q = _SELECT(db, "packets", 
-                              {"DISTINCT tags"},
-                              _WHERE("tags", NEQ, ""));
+        auto tags_q = use_summary ?
+            _SELECT(db, "summary", {"DISTINCT tag"}, _WHERE("kind", EQ, "packettag")) :
+            _SELECT(db, "packets", {"DISTINCT tags"}, _WHERE("tags", NEQ, ""));
 
         for (auto ti : tags_q) {
             auto t = sqlite3_column_as<std::string>(ti, 0);
@@ -361,7 +411,13 @@ int main(int argc, char *argv[]) {
             fmt::print("\n\n");
         }
 
-        auto range_q = _SELECT(db, "devices",
+        auto range_q = use_summary ? 
+            _SELECT(db, "summary",
+                {"min(min_lat)", "min(min_lon)", "max(max_lat)", "max(max_lon)"},
+                _WHERE("kind", EQ, "devices",
+                    AND,
+                    "with_location", NEQ, 0)) :
+            _SELECT(db, "devices",
                 {"min(min_lat)", "min(min_lon)", "max(max_lat)", "max(max_lon)"},
                 _WHERE("min_lat", NEQ, 0, 
                     AND, 
@@ -32,9 +32,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
-#include <sqlite3.h>
-
 #include "getopt.h"
+#include "kismetdb_rewrite.h"
 
 void print_help(char *argv) {
     printf("Kismet packet content strip tool.\n");
@@ -42,15 +41,21 @@ void print_help(char *argv) {
     printf("usage: %s [OPTION]\n", argv);
     printf(" -i, --in [filename]          Input kismetdb file\n"
            " -o, --out [filename]         Output kismetdb file with packet content stripped\n"
+           " -p, --in-place               Strip the input file in place\n"
            " -v, --verbose                Verbose output\n"
-           " -f, --force                  Force writing to the target file, even if it exists.\n");
+           " -f, --force                  Force writing to the target file, even if it exists.\n"
+           "\n"
+           "The stripped log is written in a single pass to a new file next to the\n"
+           "target, then renamed over it, so no more space than the stripped log\n"
+           "is needed and the target is never left half-written.\n");
 }
 
 int main(int argc, char *argv[]) {
     static struct option longopt[] = {
         { "in", required_argument, 0, 'i' },
         { "out", required_argument, 0, 'o' },
-        { "verbose", no_argument, 0, 'b' },
+        { "in-place", no_argument, 0, 'p' },
+        { "verbose", no_argument, 0, 'v' },
         { "force", no_argument, 0, 'f' },
         { "help", no_argument, 0, 'h' },
         { 0, 0, 0, 0 }
@@ -63,20 +68,16 @@ int main(int argc, char *argv[]) {
     char *in_fname = NULL, *out_fname = NULL;
     bool verbose = false;
     bool force = false;
+    bool in_place = false;
 
-    int sql_r = 0;
-    char *sql_errmsg = NULL;
-    sqlite3 *db = NULL;
-
-    FILE *ifile = NULL, *ofile = NULL;
-    char copybuf[4096];
-    size_t copysz, writesz;
+    unsigned int flags = KISMETDB_REWRITE_STRIP_PACKETS;
+    char errstr[1024];
 
     struct stat statbuf;
 
     while (1) {
         int r = getopt_long(argc, argv, 
-                            "-hi:o:vf", 
+                            "-hi:o:pvf", 
                             longopt, &option_idx);
         if (r < 0) break;
 
@@ -87,6 +88,8 @@ int main(int argc, char *argv[]) {
             in_fname = strdup(optarg);
         } else if (r == 'o') {
             out_fname = strdup(optarg);
+        } else if (r == 'p') {
+            in_place = true;
         } else if (r == 'v') { 
             verbose = true;
         } else if (r == 'f') {
@@ -94,16 +97,20 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if (in_place && in_fname != NULL && out_fname == NULL)
+        out_fname = strdup(in_fname);
+
     if (out_fname == NULL || in_fname == NULL) {
         fprintf(stderr, "ERROR: Expected --in [kismetdb file] and "
-                "--out [stripped kismetdb file]\n");
+                "--out [stripped kismetdb file] or --in-place\n");
         exit(1);
     }
 
-    /* Open the database and run the vacuum command to clean up any stray journals */
-
-    if (verbose)
-        printf("* Preparing input database '%s'...\n", in_fname);
+    if (stat(in_fname, &statbuf) < 0) {
+        fprintf(stderr, "ERROR:  Unable to find input file '%s': %s\n",
+                in_fname, strerror(errno));
+        exit(1);
+    }
 
     if (stat(out_fname, &statbuf) < 0) {
         if (errno != ENOENT) {
@@ -111,125 +118,24 @@ int main(int argc, char *argv[]) {
                     "file '%s': %s\n", out_fname, strerror(errno));
             exit(1);
         }
-    } else if (force == false) {
+    } else if (force == false && in_place == false) {
         fprintf(stderr, "ERROR:  Output file '%s' exists already; use --force to "
                 "clobber the file.\n", out_fname);
         exit(1);
     }
 
-    sql_r = sqlite3_open(in_fname, &db);
-
-    if (sql_r) {
-        fprintf(stderr, "ERROR:  Unable to open '%s': %s\n",
-                in_fname, sqlite3_errmsg(db));
-        exit(1);
-    }
-
-    sql_r = sqlite3_exec(db, "VACUUM;", NULL, NULL, &sql_errmsg);
-
-    if (sql_r != SQLITE_OK) {
-        fprintf(stderr, "ERROR:  Unable to clean up (vacuum) database before copying: %s\n",
-                sql_errmsg);
-        sqlite3_close(db);
-        exit(1);
-    }
-
-    sqlite3_close(db);
-
-
-    /* Now that the database is closed, copy it as a binary 
-     * file to the target database */
-   
-    ifile = fopen(in_fname, "rb");
-    if (ifile == NULL) {
-        fprintf(stderr, "ERROR:  Unable to open input file for reading: %s\n", 
-                strerror(errno));
-        exit(1);
-    }
-
-    ofile = fopen(out_fname, "wb");
-    if (ofile == NULL) {
-        fprintf(stderr, "ERROR:  Unable to open output file for writing: %s\n",
-                strerror(errno));
-        exit(1);
-    }
-
-    if (verbose)
-        printf("* Copying '%s' to '%s'...\n", in_fname, out_fname);
-
-    while (true) {
-        copysz = fread(copybuf, 1, 4096, ifile);
-
-        if (copysz == 0) {
-            if (ferror(ifile)) {
-                printf("ERROR: Reading from '%s' failed: %s\n",
-                        in_fname, strerror(errno));
-                fclose(ifile);
-                fclose(ofile);
-                unlink(out_fname);
-                exit(1);
-            }
-
-            break;
-        }
-
-        writesz = fwrite(copybuf, 1, copysz, ofile);
-
-        if (writesz != copysz) {
-            printf("ERROR: Writing %lu to '%s' failed: %s\n",
-                    copysz, out_fname, strerror(errno));
-            fclose(ifile);
-            fclose(ofile);
-            unlink(out_fname);
-            exit(1);
-        }
-    }
-
-    fclose(ifile);
-    fclose(ofile);
-
-    ifile = NULL;
-    ofile = NULL;
-
-    if (verbose)
-        printf("* Cleaning packet content from output database...\n");
-
-    /* Open the target file as a sqlite3 db */
-
-    if (verbose)
-        printf("* Stripping packet data from '%s'...\n", out_fname);
-
-    sql_r = sqlite3_open(out_fname, &db);
-
-    if (sql_r) {
-        fprintf(stderr, "ERROR:  Unable to open '%s': %s\n",
-                out_fname, sqlite3_errmsg(db));
-        exit(1);
-    }
-
-    sql_r = sqlite3_exec(db, "UPDATE packets SET packet = '';", NULL, NULL, &sql_errmsg);
-
-    if (sql_r != SQLITE_OK) {
-        fprintf(stderr, "ERROR:  Unable to clear packet data: %s\n",
-                sql_errmsg);
-        sqlite3_close(db);
-        exit(1);
+    if (verbose) {
+        printf("* Stripping packet data from '%s' into '%s'...\n", in_fname, out_fname);
+        flags |= KISMETDB_REWRITE_VERBOSE;
     }
 
-    sql_r = sqlite3_exec(db, "VACUUM;", NULL, NULL, &sql_errmsg);
-
-    if (sql_r != SQLITE_OK) {
-        fprintf(stderr, "ERROR:  Unable to clean up (vacuum) database after stripping: %s\n",
-                sql_errmsg);
-        sqlite3_close(db);
+    if (kismetdb_rewrite(in_fname, out_fname, flags, errstr, sizeof(errstr)) < 0) {
+        fprintf(stderr, "ERROR:  %s\n", errstr);
         exit(1);
     }
 
-    sqlite3_close(db);
-
     if (verbose) 
         printf("* Done!\n");
 
     return 0;
 }
-
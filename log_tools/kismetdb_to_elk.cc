@@ -0,0 +1,660 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*
+ * Export the devices, alerts, and packets of a kismetdb log to Elasticsearch, as _bulk
+ * NDJSON written to a file or posted straight to the cluster over several connections.
+ *
+ * Records are written in the same form as the ekjson serializer of the server, with
+ * the dots of every field name changed to underscores, so documents exported from a
+ * log and documents streamed from the live /logging/elk/bulk.ndjson endpoint match.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <sqlite3.h>
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include "base64.h"
+#include "getopt.h"
+#include "sqlite3_cpp11.h"
+#include "fmt.h"
+#include "kismetdb_pipeline.h"
+#include "kismetdb_segments.h"
+
+// Rename every key of a JSON document the way the ekjson serializer does, changing dots
+// to underscores; strings are only rewritten when they're followed by a ':'
+std::string ek_rename_keys(const std::string& in) {
+    std::string out = in;
+    size_t pos = 0;
+
+    while (pos < out.length()) {
+        if (out[pos] != '"') {
+            pos++;
+            continue;
+        }
+
+        auto start = pos + 1;
+        auto end = start;
+
+        while (end < out.length() && out[end] != '"') {
+            if (out[end] == '\\')
+                end++;
+            end++;
+        }
+
+        if (end >= out.length())
+            break;
+
+        auto next = end + 1;
+        while (next < out.length() && isspace(out[next]))
+            next++;
+
+        if (next < out.length() && out[next] == ':')
+            std::replace(out.begin() + start, out.begin() + end, '.', '_');
+
+        pos = end + 1;
+    }
+
+    return out;
+}
+
+std::string json_escape(const std::string& in) {
+    std::string out = "\"";
+
+    for (auto c : in) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char) c < 0x20) {
+            out += fmt::format("\\u{:04x}", (unsigned int) c);
+        } else {
+            out += c;
+        }
+    }
+
+    out += "\"";
+
+    return out;
+}
+
+// Post _bulk batches to Elasticsearch; each connection is a thread with its own
+// keep-alive http connection, taking batches from a bounded queue
+class elk_bulk_sender {
+public:
+    elk_bulk_sender(const std::string& in_host, const std::string& in_port,
+            const std::string& in_target, const std::string& in_auth,
+            unsigned int in_connections) :
+        host{in_host},
+        port{in_port},
+        target{in_target},
+        auth{in_auth},
+        max_queued{in_connections * 2},
+        shutdown{false},
+        failed{false},
+        n_batches{0},
+        n_item_errors{0} {
+
+        for (unsigned int i = 0; i < in_connections; i++)
+            threads.push_back(std::thread([this]() { sender(); }));
+    }
+
+    ~elk_bulk_sender() {
+        finish();
+    }
+
+    // Queue a batch, waiting for room; returns false once a batch has failed
+    bool send(std::string&& batch) {
+        std::unique_lock<std::mutex> lk(mutex);
+
+        cv.wait(lk, [this]() { return failed || queue.size() < max_queued; });
+
+        if (failed)
+            return false;
+
+        queue.push_back(std::move(batch));
+        cv.notify_all();
+
+        return true;
+    }
+
+    // Wait for every queued batch to be sent
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            shutdown = true;
+        }
+
+        cv.notify_all();
+
+        for (auto& t : threads)
+            if (t.joinable())
+                t.join();
+    }
+
+    bool has_failed() const { return failed; }
+    std::string error() const { return failure; }
+    uint64_t batches() const { return n_batches; }
+    uint64_t item_errors() const { return n_item_errors; }
+
+protected:
+    void sender() {
+        namespace beast = boost::beast;
+        namespace http = beast::http;
+        using tcp = boost::asio::ip::tcp;
+
+        boost::asio::io_context ioc;
+        tcp::resolver resolver(ioc);
+        std::unique_ptr<beast::tcp_stream> stream;
+
+        while (true) {
+            std::string batch;
+
+            {
+                std::unique_lock<std::mutex> lk(mutex);
+
+                cv.wait(lk, [this]() { return failed || shutdown || queue.size() != 0; });
+
+                if (failed || queue.size() == 0)
+                    break;
+
+                batch = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            cv.notify_all();
+
+            // Reconnect and retry a few times, the cluster may close idle connections
+            std::string err;
+            bool sent = false;
+
+            for (unsigned int attempt = 0; attempt < 3 && !sent; attempt++) {
+                try {
+                    if (stream == nullptr) {
+                        stream.reset(new beast::tcp_stream(ioc));
+                        stream->connect(resolver.resolve(host, port));
+                    }
+
+                    http::request<http::string_body> req{http::verb::post, target, 11};
+                    req.set(http::field::host, host);
+                    req.set(http::field::user_agent, "kismetdb_to_elk");
+                    req.set(http::field::content_type, "application/x-ndjson");
+                    if (auth.length())
+                        req.set(http::field::authorization, "Basic " + auth);
+                    req.keep_alive(true);
+                    req.body() = batch;
+                    req.prepare_payload();
+
+                    http::write(*stream, req);
+
+                    beast::flat_buffer buffer;
+                    http::response<http::string_body> res;
+                    http::read(*stream, buffer, res);
+
+                    if (res.result_int() >= 300) {
+                        err = fmt::format("Elasticsearch returned {}: {}", res.result_int(),
+                                res.body().substr(0, 512));
+                        break;
+                    }
+
+                    // Individual documents can fail while the batch as a whole succeeds
+                    if (res.body().find("\"errors\":true") != std::string::npos) {
+                        uint64_t n = 0;
+                        for (size_t p = res.body().find("\"error\":"); p != std::string::npos;
+                                p = res.body().find("\"error\":", p + 1))
+                            n++;
+                        n_item_errors += n;
+                    }
+
+                    if (!res.keep_alive())
+                        stream.reset();
+
+                    sent = true;
+                } catch (const std::exception& e) {
+                    err = e.what();
+                    stream.reset();
+                }
+            }
+
+            if (!sent) {
+                std::lock_guard<std::mutex> lk(mutex);
+                if (!failed)
+                    failure = err;
+                failed = true;
+                cv.notify_all();
+                break;
+            }
+
+            n_batches++;
+        }
+    }
+
+    std::string host, port, target, auth;
+    size_t max_queued;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::string> queue;
+    bool shutdown;
+    std::atomic<bool> failed;
+    std::string failure;
+
+    std::atomic<uint64_t> n_batches;
+    std::atomic<uint64_t> n_item_errors;
+
+    std::vector<std::thread> threads;
+};
+
+struct elk_row {
+    std::string id;
+    std::string json;
+
+    // Packets are exported from their columns
+    std::vector<std::string> fields;
+};
+
+const std::vector<std::string> elk_packet_fields{
+    "ts_sec", "ts_usec", "phyname", "sourcemac", "destmac", "transmac", "frequency",
+    "devkey", "lat", "lon", "alt", "speed", "heading", "packet_len", "signal",
+    "datasource", "dlt", "tags"
+};
+
+// Packet columns exported as strings
+bool elk_packet_text(const std::string& field) {
+    return field == "phyname" || field == "sourcemac" || field == "destmac" ||
+        field == "transmac" || field == "devkey" || field == "datasource" || field == "tags";
+}
+
+void print_help(char *argv) {
+    printf("Kismetdb to Elasticsearch\n");
+    printf("Export devices, alerts, and packets as Elasticsearch _bulk records.\n");
+    printf("usage: %s [OPTION]\n", argv);
+    printf(" -i, --in [filename]          Input kismetdb file\n"
+           " -o, --out [filename]         Write _bulk NDJSON to [filename], or '-' for stdout\n"
+           " -u, --url [url]              Post to the Elasticsearch cluster at [url], such as\n"
+           "                              http://localhost:9200\n"
+           "     --auth [user:password]   Basic authentication for the cluster\n"
+           "     --index [prefix]         Index name prefix; records go to [prefix]-devices,\n"
+           "                              [prefix]-alerts, and [prefix]-packets.  Defaults to\n"
+           "                              'kismet'\n"
+           " -t, --type [type]            Export 'devices', 'alerts', or 'packets'.  Multiple\n"
+           "                              type arguments can be given; defaults to devices\n"
+           "                              and alerts\n"
+           "     --batch [num]            Documents per _bulk request, defaults to 1000\n"
+           "     --connections [num]      Parallel connections to the cluster, defaults to 4\n"
+           "     --threads [num]          Format records on [num] threads; 0 processes the\n"
+           "                              log in a single thread.  Defaults to the number of CPUs.\n"
+           " -v, --verbose                Verbose output\n"
+           "\n"
+           "Devices are indexed by device key, so exporting a log again updates the devices\n"
+           "already in the index.  Only plain http connections are supported; use --out\n"
+           "and an external tool to post to a cluster which requires https.\n");
+}
+
+int main(int argc, char *argv[]) {
+#define OPT_AUTH                1000
+#define OPT_INDEX               1001
+#define OPT_BATCH               1002
+#define OPT_CONNECTIONS         1003
+#define OPT_THREADS             1004
+    static struct option longopt[] = {
+        { "in", required_argument, 0, 'i' },
+        { "out", required_argument, 0, 'o' },
+        { "url", required_argument, 0, 'u' },
+        { "type", required_argument, 0, 't' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { "auth", required_argument, 0, OPT_AUTH },
+        { "index", required_argument, 0, OPT_INDEX },
+        { "batch", required_argument, 0, OPT_BATCH },
+        { "connections", required_argument, 0, OPT_CONNECTIONS },
+        { "threads", required_argument, 0, OPT_THREADS },
+        { 0, 0, 0, 0 }
+    };
+
+    int option_idx = 0;
+    optind = 0;
+    opterr = 0;
+
+    std::string in_fname, out_fname, url, auth;
+    std::string index_prefix = "kismet";
+    std::vector<std::string> types;
+    bool verbose = false;
+    unsigned int batch_sz = 1000;
+    unsigned int n_connections = 4;
+    unsigned int n_threads = std::thread::hardware_concurrency();
+
+    sqlite3 *db = NULL;
+
+    struct stat statbuf;
+
+    while (1) {
+        int r = getopt_long(argc, argv,
+                            "-hi:o:u:t:v",
+                            longopt, &option_idx);
+        if (r < 0) break;
+
+        if (r == 'h') {
+            print_help(argv[0]);
+            exit(1);
+        } else if (r == 'i') {
+            in_fname = std::string(optarg);
+        } else if (r == 'o') {
+            out_fname = std::string(optarg);
+        } else if (r == 'u') {
+            url = std::string(optarg);
+        } else if (r == 't') {
+            auto t = std::string(optarg);
+
+            if (t != "devices" && t != "alerts" && t != "packets") {
+                fmt::print(stderr, "ERROR: Expected --type devices, alerts, or packets\n");
+                exit(1);
+            }
+
+            if (std::find(types.begin(), types.end(), t) == types.end())
+                types.push_back(t);
+        } else if (r == 'v') {
+            verbose = true;
+        } else if (r == OPT_AUTH) {
+            auth = base64::encode(std::string(optarg));
+        } else if (r == OPT_INDEX) {
+            index_prefix = std::string(optarg);
+        } else if (r == OPT_BATCH) {
+            if (sscanf(optarg, "%u", &batch_sz) != 1 || batch_sz == 0) {
+                fmt::print(stderr, "ERROR: Expected --batch [number]\n");
+                exit(1);
+            }
+        } else if (r == OPT_CONNECTIONS) {
+            if (sscanf(optarg, "%u", &n_connections) != 1 || n_connections == 0) {
+                fmt::print(stderr, "ERROR: Expected --connections [number]\n");
+                exit(1);
+            }
+        } else if (r == OPT_THREADS) {
+            if (sscanf(optarg, "%u", &n_threads) != 1) {
+                fmt::print(stderr, "ERROR: Expected --threads [number]\n");
+                exit(1);
+            }
+        }
+    }
+
+    if (in_fname == "") {
+        fmt::print(stderr, "ERROR: Expected --in [kismetdb file]\n");
+        exit(1);
+    }
+
+    if ((out_fname == "") == (url == "")) {
+        fmt::print(stderr, "ERROR: Expected one of --out [file] or --url [elasticsearch url]\n");
+        exit(1);
+    }
+
+    if (types.size() == 0)
+        types = {"devices", "alerts"};
+
+    // http://host[:port][/path]
+    std::string host, port = "9200", target = "/_bulk";
+
+    if (url != "") {
+        if (url.find("https://") == 0) {
+            fmt::print(stderr, "ERROR: https is not supported, use --out and post the records "
+                    "with an external tool\n");
+            exit(1);
+        }
+
+        auto hp = url;
+        if (hp.find("http://") == 0)
+            hp = hp.substr(7);
+
+        auto slash = hp.find('/');
+        if (slash != std::string::npos) {
+            auto path = hp.substr(slash);
+            while (path.length() && path.back() == '/')
+                path.pop_back();
+            target = path + "/_bulk";
+            hp = hp.substr(0, slash);
+        }
+
+        auto colon = hp.find(':');
+        if (colon != std::string::npos) {
+            port = hp.substr(colon + 1);
+            hp = hp.substr(0, colon);
+        }
+
+        host = hp;
+
+        if (host.length() == 0) {
+            fmt::print(stderr, "ERROR: Expected --url http://host[:port]\n");
+            exit(1);
+        }
+    }
+
+    if (stat(in_fname.c_str(), &statbuf) < 0) {
+        if (errno == ENOENT)
+            fmt::print(stderr, "ERROR:  Input file '{}' does not exist.\n", in_fname);
+        else
+            fmt::print(stderr, "ERROR:  Unexpected problem checking input "
+                    "file '{}': {}\n", in_fname, strerror(errno));
+
+        exit(1);
+    }
+
+    if (sqlite3_open_v2(in_fname.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        fmt::print(stderr, "ERROR:  Unable to open '{}': {}\n", in_fname, sqlite3_errmsg(db));
+        exit(1);
+    }
+
+    // Read every segment of a rotated log as one log
+    kismetdb_attach_segments(db, in_fname, verbose);
+
+    FILE *out = nullptr;
+    std::unique_ptr<elk_bulk_sender> sender;
+
+    if (out_fname == "-") {
+        out = stdout;
+    } else if (out_fname != "") {
+        out = fopen(out_fname.c_str(), "w");
+
+        if (out == nullptr) {
+            fmt::print(stderr, "ERROR:  Unable to open output file '{}': {}\n", out_fname,
+                    strerror(errno));
+            exit(1);
+        }
+    } else {
+        sender.reset(new elk_bulk_sender(host, port, target, auth, n_connections));
+    }
+
+    using namespace kissqlite3;
+
+    uint64_t n_docs = 0;
+    unsigned int n_batch_docs = 0;
+    std::string batch;
+
+    auto flush_batch = [&]() {
+        if (n_batch_docs == 0)
+            return;
+
+        if (out != nullptr) {
+            if (fwrite(batch.data(), batch.length(), 1, out) != 1)
+                throw std::runtime_error(fmt::format("unable to write output: {}", strerror(errno)));
+        } else if (!sender->send(std::move(batch))) {
+            throw std::runtime_error(fmt::format("unable to post to Elasticsearch: {}",
+                        sender->error()));
+        }
+
+        batch = std::string();
+        n_batch_docs = 0;
+    };
+
+    try {
+        for (const auto& type : types) {
+            auto index = json_escape(fmt::format("{}-{}", index_prefix, type));
+
+            std::list<std::string> fields;
+
+            if (type == "devices")
+                fields = {"devkey", "device"};
+            else if (type == "alerts")
+                fields = {"json"};
+            else
+                fields = {elk_packet_fields.begin(), elk_packet_fields.end()};
+
+            auto q = _SELECT(db, type, fields);
+            auto qi = q.begin();
+
+            auto read = [&](std::vector<elk_row>& rows, size_t max) -> bool {
+                for (; qi != q.end() && rows.size() < max; ++qi) {
+                    elk_row row;
+
+                    if (type == "devices") {
+                        row.id = sqlite3_column_as<std::string>(*qi, 0);
+                        row.json = sqlite3_column_as<std::string>(*qi, 1);
+                    } else if (type == "alerts") {
+                        row.json = sqlite3_column_as<std::string>(*qi, 0);
+                    } else {
+                        for (size_t f = 0; f < elk_packet_fields.size(); f++)
+                            row.fields.push_back(sqlite3_column_as<std::string>(*qi, f));
+                    }
+
+                    rows.push_back(std::move(row));
+                }
+
+                return qi != q.end();
+            };
+
+            auto decode = [&](const elk_row& row, std::string& doc) {
+                // Empty device or alert records aren't valid documents
+                if (row.fields.size() == 0 && row.json.length() == 0)
+                    return;
+
+                if (type == "devices")
+                    doc = fmt::format("{{\"index\":{{\"_index\":{},\"_id\":{}}}}}\n", index,
+                            json_escape(row.id));
+                else
+                    doc = fmt::format("{{\"index\":{{\"_index\":{}}}}}\n", index);
+
+                if (row.fields.size() == 0) {
+                    auto json = ek_rename_keys(row.json);
+
+                    // Bulk records are one line each
+                    std::replace(json.begin(), json.end(), '\n', ' ');
+
+                    doc += json;
+                    doc += "\n";
+                    return;
+                }
+
+                doc += "{";
+
+                for (size_t f = 0; f < elk_packet_fields.size(); f++) {
+                    const auto& v = row.fields[f];
+
+                    if (f != 0)
+                        doc += ",";
+
+                    doc += json_escape(elk_packet_fields[f]) + ":";
+
+                    if (elk_packet_text(elk_packet_fields[f]))
+                        doc += json_escape(v);
+                    else if (v.length() == 0)
+                        doc += "null";
+                    else
+                        doc += v;
+                }
+
+                // Millisecond timestamp for the index time field
+                doc += fmt::format(",\"timestamp\":{}}}\n",
+                        std::stoll(row.fields[0]) * 1000 + std::stoll(row.fields[1]) / 1000);
+            };
+
+            auto write = [&](std::string& doc) {
+                if (doc.length() == 0)
+                    return;
+
+                batch += doc;
+                n_docs++;
+
+                if (++n_batch_docs >= batch_sz)
+                    flush_batch();
+            };
+
+            if (verbose)
+                fmt::print(stderr, "* Exporting {}...\n", type);
+
+            kismetdb_pipeline<elk_row, std::string> pipeline(n_threads, 1024, read, decode, write);
+            pipeline.run();
+
+            flush_batch();
+        }
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "ERROR:  Could not export '{}': {}\n", in_fname, e.what());
+
+        if (sender != nullptr)
+            sender->finish();
+
+        sqlite3_close(db);
+        exit(1);
+    }
+
+    if (sender != nullptr) {
+        sender->finish();
+
+        if (sender->has_failed()) {
+            fmt::print(stderr, "ERROR:  Unable to post to Elasticsearch: {}\n", sender->error());
+            sqlite3_close(db);
+            exit(1);
+        }
+
+        if (sender->item_errors() != 0)
+            fmt::print(stderr, "WARNING: Elasticsearch rejected {} documents\n",
+                    sender->item_errors());
+
+        if (verbose)
+            fmt::print(stderr, "* Posted {} documents in {} requests\n", n_docs,
+                    sender->batches());
+    } else {
+        if (out != stdout)
+            fclose(out);
+
+        if (verbose)
+            fmt::print(stderr, "* Wrote {} documents\n", n_docs);
+    }
+
+    sqlite3_close(db);
+
+    return 0;
+}
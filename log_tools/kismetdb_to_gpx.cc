@@ -22,10 +22,12 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <map>
 #include <iomanip>
 #include <ctime>
 #include <iostream>
+#include <thread>
 #include <tuple>
 
 #include <string.h>
@@ -43,6 +45,9 @@
 #include "json/json.h"
 #include "sqlite3_cpp11.h"
 #include "fmt.h"
+#include "kismetdb_geo_export.h"
+#include "kismetdb_location_trail.h"
+#include "kismetdb_segments.h"
 #include "packet_ieee80211.h"
 
 // Aggressive additional mangle of text to handle converting to hexcode for XML
@@ -94,24 +99,6 @@ int FrequencyToWifiChannel(double in_freq) {
         return in_freq;
 }
 
-// we can't do this is as a sqlite function, as cool as that would be, because sqlite functions
-// can't be part of a `where`, only a `having`, which introduces tons of problems.
-double distance_meters(double lat0, double lon0, double lat1, double lon1) {
-    lat0 = (M_PI / 180) * lat0;
-    lon0 = (M_PI / 180) * lon0;
-    lat1 = (M_PI / 180) * lat1;
-    lon1 = (M_PI / 180) * lon1;
-
-    double diff_lon = lon1 - lon0;
-    double diff_lat = lat1 - lat0;
-
-    double ret = 
-        (2 * asin(sqrt(pow(sin(diff_lat / 2), 2) +
-                       cos(lat0) * cos(lat1) * pow(sin(diff_lon / 2), 2)))) * 6731000.0f;
-
-    return ret;
-}
-
 std::string WifiCryptToString(unsigned long cryptset) {
     std::stringstream ss;
 
@@ -161,25 +148,44 @@ std::string WifiCryptToString(unsigned long cryptset) {
     return "";
 }
 
-// Specific points
-class gpx_point {
+// Device record as read from the log
+class gpx_device_row {
 public:
-    double lat, lon, alt;
+    std::string phyname;
+    std::string devmac;
+    double avg_lat, avg_lon;
+    std::string device;
 };
 
 // Placemark cache
 class gpx_waypoint {
 public:
-    // Running lat, lon, and alt, if we're computing it
-    double avg_lat, avg_lon, avg_alt;
-    double avg_2d_num, avg_alt_num;
+    // Set when the device was located and should be written
+    bool valid;
+
+    // Problem to report for the device
+    std::string warning;
 
     double lat, lon, alt;
 
     // Name (last known name, user name, or mac address)
     std::string name;
+
+    // Track of the location trail, if the device was logged with one
+    std::string track;
 };
 
+// Time of a track point
+std::string GpxTime(time_t in_time) {
+    char buf[32];
+    struct tm tm;
+
+    gmtime_r(&in_time, &tm);
+    strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+    return buf;
+}
+
 void print_help(char *argv) {
     printf("Kismetdb to GPX\n");
     printf("A simple tool for converting the packet data from a KismetDB log file to\n"
@@ -195,10 +201,23 @@ void print_help(char *argv) {
            "                              your home, or other sensitive locations.\n"
            " --basic-location             Use basic average location information instead of computing a\n"
            "                              high-precision location; faster, but less accurate\n"
+           " --trails                     Write the location trails of devices logged with\n"
+           "                              keep_location_trail as tracks, and locate those devices from\n"
+           "                              their trails instead of their packets\n"
+           " --decimate-distance [m]      Drop track points closer than [m] meters to the previous\n"
+           "                              point written\n"
+           " --decimate-time [s]          Drop track points less than [s] seconds after the previous\n"
+           "                              point written\n"
+           " --threads [num]              Process devices on [num] threads while reading and writing\n"
+           "                              in parallel; 0 processes the log in a single thread.\n"
+           "                              Defaults to the number of CPUs.\n"
           );
 }
 
 int main(int argc, char *argv[]) {
+#define OPT_THREADS             1
+#define OPT_DECIMATE_DISTANCE   2
+#define OPT_DECIMATE_TIME       3
     static struct option longopt[] = {
         { "in", required_argument, 0, 'i' },
         { "out", required_argument, 0, 'o' },
@@ -208,6 +227,10 @@ int main(int argc, char *argv[]) {
         { "skip-clean", no_argument, 0, 's' },
         { "exclude", required_argument, 0, 'e'},
         { "basic-location", no_argument, 0, 'B'},
+        { "trails", no_argument, 0, 'T'},
+        { "threads", required_argument, 0, OPT_THREADS },
+        { "decimate-distance", required_argument, 0, OPT_DECIMATE_DISTANCE },
+        { "decimate-time", required_argument, 0, OPT_DECIMATE_TIME },
         { 0, 0, 0, 0 }
     };
 
@@ -220,8 +243,12 @@ int main(int argc, char *argv[]) {
     bool force = false;
     bool skipclean = false;
     bool basiclocation = false;
+    bool trails = false;
+    unsigned int n_threads = std::thread::hardware_concurrency();
+    double decimate_distance = 0;
+    long decimate_time = 0;
 
-    std::vector<std::tuple<double, double, double>> exclusion_zones;
+    kismetdb_exclusion_zones exclusion_zones;
 
     int sql_r = 0;
     char *sql_errmsg = NULL;
@@ -261,6 +288,23 @@ int main(int argc, char *argv[]) {
             exclusion_zones.push_back(std::make_tuple(lat, lon, distance));
         } else if (r == 'B') {
             basiclocation = true;
+        } else if (r == 'T') {
+            trails = true;
+        } else if (r == OPT_THREADS) {
+            if (sscanf(optarg, "%u", &n_threads) != 1) {
+                fmt::print(stderr, "ERROR:  Expected --threads [number]\n");
+                exit(1);
+            }
+        } else if (r == OPT_DECIMATE_DISTANCE) {
+            if (sscanf(optarg, "%lf", &decimate_distance) != 1 || decimate_distance < 0) {
+                fmt::print(stderr, "ERROR:  Expected --decimate-distance [meters]\n");
+                exit(1);
+            }
+        } else if (r == OPT_DECIMATE_TIME) {
+            if (sscanf(optarg, "%ld", &decimate_time) != 1 || decimate_time < 0) {
+                fmt::print(stderr, "ERROR:  Expected --decimate-time [seconds]\n");
+                exit(1);
+            }
         }
     }
 
@@ -318,6 +362,9 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // Read every segment of a rotated log as one log
+    kismetdb_attach_segments(db, in_fname, verbose);
+
     // Use our sql adapters
 
     using namespace kissqlite3;
@@ -421,238 +468,208 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    std::vector<gpx_waypoint> waypoint_vec;
+    // Locations from every packet, gathered in one pass instead of a query per device
+    std::map<kismetdb_geo_key, kismetdb_geo_average> locations;
 
-    if (basiclocation) {
-        auto basic_q = 
-            _SELECT(db, "devices", 
-                    {"min_lat", "min_lon", "max_lat", "max_lon", "avg_lat", "avg_lon", "device"}, 
-                    _WHERE("avglat", NEQ, 0, AND, "avglon", NEQ, 0));
-
-        for (auto d : basic_q) {
-            double avg_lat, avg_lon;
-
-            // Handle the different versions
-            if (db_version < 5) {
-                avg_lat = sqlite3_column_as<double>(d, 4) / 100000;
-                avg_lon = sqlite3_column_as<double>(d, 5) / 100000;
-            } else {
-                avg_lat = sqlite3_column_as<double>(d, 4);
-                avg_lon = sqlite3_column_as<double>(d, 5);
-            }
+    if (!basiclocation) {
+        if (verbose)
+            fmt::print(stderr, "* Locating devices...\n");
 
-            // Check to see if we lie in any exclusion zones
-            bool violates_exclusion = false;
-            for (auto ez : exclusion_zones) {
-                if (distance_meters(avg_lat, avg_lon, std::get<0>(ez), std::get<1>(ez)) <= std::get<2>(ez)) {
-                    violates_exclusion = true;
-                    break;
-                }
-            }
+        try {
+            locations = kismetdb_device_locations(db, db_version, exclusion_zones, n_threads);
+        } catch (const std::exception& e) {
+            fmt::print(stderr, "ERROR:  Failed to locate devices: {}\n", e.what());
+            exit(1);
+        }
+    }
 
-            if (violates_exclusion) {
-                continue;
-            }
+    // Devices are parsed, located, and formatted on the worker threads
+    auto decode_device = [&](const gpx_device_row& row, gpx_waypoint& pl) {
+        pl.valid = false;
 
-            Json::Value json;
-            std::stringstream ss(sqlite3_column_as<std::string>(d, 6));
+        if (basiclocation) {
+            if (row.avg_lat == 0 || row.avg_lon == 0)
+                return;
 
-            try {
-                ss >> json;
+            // Check to see if we lie in any exclusion zones
+            if (kismetdb_excluded(exclusion_zones, row.avg_lat, row.avg_lon))
+                return;
+        }
 
-                if (avg_lat == 0 || avg_lon == 0)
-                    continue;
+        Json::Value json;
+        std::stringstream ss(row.device);
 
-                gpx_waypoint pl;
-                pl.name = json["kismet.device.base.commonname"].asString();
-                pl.lat = avg_lat;
-                pl.lon = avg_lon;
-                pl.alt = 0;
+        try {
+            ss >> json;
+            pl.name = json["kismet.device.base.commonname"].asString();
+        } catch (const std::exception& e) {
+            pl.warning = fmt::format("WARNING:  Could not process device info for '{}', skipping\n",
+                    row.devmac);
+            return;
+        }
 
+        // Trail points outside the exclusion zones
+        std::vector<kismetdb_trail_point> trail;
 
-                waypoint_vec.push_back(pl);
-            } catch (const std::exception& e) {
-                std::cerr << 
-                    fmt::format("WARNING:  Could not process device info for '{}', skipping", json) << std::endl;
-            }
+        if (trails) {
+            trail = kismetdb_device_trail(json);
 
+            trail.erase(std::remove_if(trail.begin(), trail.end(), 
+                        [&](const kismetdb_trail_point& p) {
+                            return kismetdb_excluded(exclusion_zones, p.lat, p.lon);
+                        }), trail.end());
         }
-    } else {
-        auto basic_q = 
-            _SELECT(db, "devices", {"phyname", "devmac", "device"});
 
-        for (auto d : basic_q) {
-            // Prep the packet list for different kismetdb versions
-            std::list<std::string> packet_fields;
+        if (basiclocation) {
+            pl.lat = row.avg_lat;
+            pl.lon = row.avg_lon;
+            pl.alt = 0;
+        } else {
+            kismetdb_geo_average avg;
 
-            if (db_version < 5) {
-                packet_fields = std::list<std::string>{"lat", "lon" };
+            // Devices with a trail are located from it instead of their packets
+            if (trail.size()) {
+                for (const auto& p : trail)
+                    avg.add(p.lat, p.lon, p.alt);
             } else {
-                packet_fields = std::list<std::string>{"lat", "lon", "alt"};
+                auto li = locations.find(kismetdb_geo_key(row.phyname, row.devmac));
+
+                if (li != locations.end())
+                    avg = li->second;
             }
 
-            auto phyname = sqlite3_column_as<std::string>(d, 0);
-            auto devmac = sqlite3_column_as<std::string>(d, 1);
-            Json::Value json;
+            if (!avg.valid()) {
+                pl.warning = fmt::format("WARNING:  No packets with GPS info for '{}', skipping\n",
+                        pl.name);
+                return;
+            }
 
-            std::stringstream ss(sqlite3_column_as<std::string>(d, 2));
+            pl.lat = avg.lat();
+            pl.lon = avg.lon();
+            pl.alt = avg.alt();
+        }
 
-            gpx_waypoint pl;
+        kismetdb_decimate_track(trail, decimate_distance, decimate_time);
 
-            try {
-                ss >> json;
-                pl.name = json["kismet.device.base.commonname"].asString();
-            } catch (const std::exception& e) {
-                fmt::print(stderr, "WARNING:  Could not process device info for '{}', skipping\n", json);
-                continue;
-            }
+        if (trail.size()) {
+            pl.track = fmt::format("<trk><name>{}</name><trkseg>\n", MungeForXML(pl.name));
 
-            pl.avg_alt = 0;
-            pl.avg_lat = 0;
-            pl.avg_lon = 0;
-            pl.avg_2d_num = 0;
-            pl.avg_alt = 0;
-
-            auto packet_q = _SELECT(db, "packets", packet_fields,
-                    _WHERE("sourcemac", EQ, devmac, AND, "phyname", EQ, phyname, AND, "lat", NEQ, 0, AND, "lon", NEQ, 0));
-
-            for (auto p : packet_q) {
-                double lat, lon, alt;
-
-                // Handle the different versions
-                if (db_version < 5) {
-                    lat = sqlite3_column_as<double>(p, 0) / 100000;
-                    lon = sqlite3_column_as<double>(p, 1) / 100000;
-                    alt = 0;
-                } else {
-                    lat = sqlite3_column_as<double>(p, 0);
-                    lon = sqlite3_column_as<double>(p, 1);
-                    alt = sqlite3_column_as<double>(p, 2);
-                }
-
-                if (lat == 0 || lon == 0)
-                    continue;
-
-                // Check to see if we lie in any exclusion zones
-                bool violates_exclusion = false;
-                for (auto ez : exclusion_zones) {
-                    if (distance_meters(lat, lon, std::get<0>(ez), std::get<1>(ez)) <= std::get<2>(ez)) {
-                        violates_exclusion = true;
-                        break;
-                    }
-                }
-
-                if (violates_exclusion) {
-                    continue;
-                }
-
-                pl.avg_lat += lat;
-                pl.avg_lon += lon;
-                pl.avg_2d_num++;
-
-                if (alt != 0) {
-                    pl.avg_alt += alt;
-                    pl.avg_alt_num++;
-                }
+            for (const auto& p : trail) {
+                pl.track += fmt::format("<trkpt lat=\"{}\" lon=\"{}\"><ele>{}</ele><time>{}</time></trkpt>\n",
+                        p.lat, p.lon, p.alt, GpxTime(p.time));
             }
 
-            auto data_q = _SELECT(db, "data", packet_fields,
-                    _WHERE("devmac", EQ, devmac, AND, "phyname", EQ, phyname, AND, "lat", NEQ, 0, AND, "lon", NEQ, 0));
-
-            for (auto p : data_q) {
-                double lat, lon, alt;
-
-                // Handle the different versions
-                if (db_version < 5) {
-                    lat = sqlite3_column_as<double>(p, 0) / 100000;
-                    lon = sqlite3_column_as<double>(p, 1) / 100000;
-                    alt = 0;
-                } else {
-                    lat = sqlite3_column_as<double>(p, 0);
-                    lon = sqlite3_column_as<double>(p, 1);
-                    alt = sqlite3_column_as<double>(p, 2);
-                }
-
-                if (lat == 0 || lon == 0)
-                    continue;
-
-                // Check to see if we lie in any exclusion zones
-                bool violates_exclusion = false;
-                for (auto ez : exclusion_zones) {
-                    if (distance_meters(lat, lon, std::get<0>(ez), std::get<1>(ez)) <= std::get<2>(ez)) {
-                        violates_exclusion = true;
-                        break;
-                    }
-                }
-
-                if (violates_exclusion) {
-                    continue;
-                }
-
-                pl.avg_lat += lat;
-                pl.avg_lon += lon;
-                pl.avg_2d_num++;
-
-                if (alt != 0) {
-                    pl.avg_alt += alt;
-                    pl.avg_alt_num++;
-                }
-            }
+            pl.track += "</trkseg></trk>\n";
+        }
 
-            if (pl.avg_2d_num == 0) {
-                fmt::print(stderr, "WARNING:  No packets with GPS info for '{}', skipping\n", pl.name);
-                continue;
-            }
+        pl.valid = true;
+    };
 
-            pl.lat = pl.avg_lat / pl.avg_2d_num;
-            pl.lon = pl.avg_lon / pl.avg_2d_num;
+    fmt::print(ofile, 
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<gpx version=\"1.0\">\n"
+            "<name>Kismet {}</name>\n", MungeForXML(in_fname));
 
-            if (pl.avg_alt_num)
-                pl.alt = pl.avg_alt / pl.avg_alt_num;
+    // GPX puts every waypoint before the tracks, so only the tracks are held until the
+    // devices are done
+    std::string tracks;
 
-            waypoint_vec.push_back(pl);
-        }
+    auto write_device = [&](gpx_waypoint& pl) {
+        if (pl.warning.length())
+            fmt::print(stderr, "{}", pl.warning);
 
-        fmt::print(ofile, 
-                "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
-                "<gpx version=\"1.0\">\n"
-                "<name>Kismet {}</name>\n", MungeForXML(in_fname));
+        if (!pl.valid)
+            return;
 
-        for (auto pl : waypoint_vec) {
-            fmt::print(ofile, "<wpt lat=\"{}\" lon=\"{}\">\n", pl.lat, pl.lon);
-            fmt::print(ofile, "<ele>{}</ele>\n", pl.alt);
-            fmt::print(ofile, "<name>{}</name>", MungeForXML(pl.name));
-            fmt::print(ofile, "</wpt>");
-        }
+        fmt::print(ofile, "<wpt lat=\"{}\" lon=\"{}\">\n", pl.lat, pl.lon);
+        fmt::print(ofile, "<ele>{}</ele>\n", pl.alt);
+        fmt::print(ofile, "<name>{}</name>", MungeForXML(pl.name));
+        fmt::print(ofile, "</wpt>");
+
+        tracks += pl.track;
+    };
 
-        fmt::print(ofile, "<trk><trkseg>\n");
+    auto device_q = _SELECT(db, "devices", {"phyname", "devmac", "avg_lat", "avg_lon", "device"});
 
-        auto status_q = _SELECT(db, "snapshots", {"lat", "lon"},
-                _WHERE("snaptype", EQ, "GPS"));
+    if (basiclocation)
+        device_q.append_where(AND, _WHERE("avglat", NEQ, 0, AND, "avglon", NEQ, 0));
 
-        for (auto l : status_q) {
-            double lat = 0, lon = 0;
+    auto dev = device_q.begin();
+
+    auto read_devices = [&](std::vector<gpx_device_row>& rows, size_t max) -> bool {
+        for (; rows.size() < max && dev != device_q.end(); ++dev) {
+            gpx_device_row row;
+
+            row.phyname = sqlite3_column_as<std::string>(*dev, 0);
+            row.devmac = sqlite3_column_as<std::string>(*dev, 1);
 
             // Handle the different versions
             if (db_version < 5) {
-                lat = sqlite3_column_as<double>(l, 0) / 100000;
-                lon = sqlite3_column_as<double>(l, 1) / 100000;
+                row.avg_lat = sqlite3_column_as<double>(*dev, 2) / 100000;
+                row.avg_lon = sqlite3_column_as<double>(*dev, 3) / 100000;
             } else {
-                lat = sqlite3_column_as<double>(l, 0);
-                lon = sqlite3_column_as<double>(l, 1);
+                row.avg_lat = sqlite3_column_as<double>(*dev, 2);
+                row.avg_lon = sqlite3_column_as<double>(*dev, 3);
             }
 
-            if (lat == 0 || lon == 0)
-                continue;
+            row.device = sqlite3_column_as<std::string>(*dev, 4);
+
+            rows.push_back(std::move(row));
+        }
+
+        return dev != device_q.end();
+    };
+
+    try {
+        kismetdb_pipeline<gpx_device_row, gpx_waypoint> pipeline(n_threads, 64,
+                read_devices, decode_device, write_device);
+        pipeline.run();
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "ERROR:  Failed to process devices: {}\n", e.what());
+        exit(1);
+    }
+
+    fmt::print(ofile, "{}", tracks);
+
+    // Track of the GPS itself
+    std::vector<kismetdb_trail_point> gps_track;
 
-            fmt::print(ofile, "<trkpt lat=\"{}\" lon=\"{}\"></trkpt>\n", lat, lon);
+    auto status_q = _SELECT(db, "snapshots", {"ts_sec", "lat", "lon"},
+            _WHERE("snaptype", EQ, "GPS"));
+
+    for (auto l : status_q) {
+        kismetdb_trail_point p;
+
+        p.time = sqlite3_column_as<std::uint64_t>(l, 0);
+        p.alt = 0;
+
+        // Handle the different versions
+        if (db_version < 5) {
+            p.lat = sqlite3_column_as<double>(l, 1) / 100000;
+            p.lon = sqlite3_column_as<double>(l, 2) / 100000;
+        } else {
+            p.lat = sqlite3_column_as<double>(l, 1);
+            p.lon = sqlite3_column_as<double>(l, 2);
         }
-        fmt::print(ofile, "</trkseg>\n</trk>\n");
 
-        fmt::print(ofile, "</gpx>\n");
+        if (p.lat == 0 || p.lon == 0)
+            continue;
 
+        gps_track.push_back(p);
     }
 
+    kismetdb_decimate_track(gps_track, decimate_distance, decimate_time);
+
+    fmt::print(ofile, "<trk><trkseg>\n");
+
+    for (const auto& p : gps_track)
+        fmt::print(ofile, "<trkpt lat=\"{}\" lon=\"{}\"><time>{}</time></trkpt>\n",
+                p.lat, p.lon, GpxTime(p.time));
+
+    fmt::print(ofile, "</trkseg>\n</trk>\n");
+
+    fmt::print(ofile, "</gpx>\n");
+
     if (ofile != stdout) {
         fclose(ofile);
     }
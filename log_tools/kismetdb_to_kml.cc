@@ -22,11 +22,13 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <map>
 #include <iomanip>
 #include <ctime>
 #include <iostream>
 #include <regex>
+#include <thread>
 #include <tuple>
 
 #include <string.h>
@@ -44,6 +46,9 @@
 #include "json/json.h"
 #include "sqlite3_cpp11.h"
 #include "fmt.h"
+#include "kismetdb_geo_export.h"
+#include "kismetdb_location_trail.h"
+#include "kismetdb_segments.h"
 #include "packet_ieee80211.h"
 
 // Aggressive additional mangle of text to handle converting to hexcode for XML
@@ -95,24 +100,6 @@ int FrequencyToWifiChannel(double in_freq) {
         return in_freq;
 }
 
-// we can't do this is as a sqlite function, as cool as that would be, because sqlite functions
-// can't be part of a `where`, only a `having`, which introduces tons of problems.
-double distance_meters(double lat0, double lon0, double lat1, double lon1) {
-    lat0 = (M_PI / 180) * lat0;
-    lon0 = (M_PI / 180) * lon0;
-    lat1 = (M_PI / 180) * lat1;
-    lon1 = (M_PI / 180) * lon1;
-
-    double diff_lon = lon1 - lon0;
-    double diff_lat = lat1 - lat0;
-
-    double ret = 
-        (2 * asin(sqrt(pow(sin(diff_lat / 2), 2) +
-                       cos(lat0) * cos(lat1) * pow(sin(diff_lon / 2), 2)))) * 6731000.0f;
-
-    return ret;
-}
-
 std::string WifiCryptToString(unsigned long cryptset) {
     std::stringstream ss;
 
@@ -168,12 +155,32 @@ public:
     double lat, lon, alt;
 };
 
+// Folders of grouped placemarks
+enum kml_group {
+    kml_group_bluetooth, kml_group_zigbee, kml_group_client,
+    kml_group_ap_open, kml_group_ap_wep, kml_group_ap_wpa,
+    kml_group_other, kml_group_max
+};
+
+// Device record as read from the log
+class kml_device_row {
+public:
+    std::string phyname;
+    std::string devmac;
+    double avg_lat, avg_lon;
+    std::string device;
+};
+
 // Placemark cache
 class kml_placemark {
 public:
-    // Running lat, lon, and alt, if we're computing it
-    double avg_lat, avg_lon, avg_alt;
-    double avg_2d_num, avg_alt_num;
+    // Set when the device was located and should be written
+    bool valid;
+
+    // Problem to report for the device
+    std::string warning;
+
+    kml_group group;
 
     // We might want to support multiple points per AP
     std::vector<kml_point> point_vec;
@@ -184,6 +191,9 @@ public:
     std::string description;
     std::string channel;
     std::string crypt;
+
+    // Coordinates of the location trail, if the device was logged with one
+    std::string trail_coords;
 };
 
 void print_help(char *argv) {
@@ -202,44 +212,72 @@ void print_help(char *argv) {
            " --basic-location             Use basic average location information instead of computing a\n"
            "                              high-precision location; faster, but less accurate\n"
            " -g, --group                  Group by type into folders\n"
+           " --trails                     Draw the location trails of devices logged with\n"
+           "                              keep_location_trail, and locate those devices from their\n"
+           "                              trails instead of their packets\n"
+           " --decimate-distance [m]      Drop trail points closer than [m] meters to the previous\n"
+           "                              point drawn\n"
+           " --decimate-time [s]          Drop trail points less than [s] seconds after the previous\n"
+           "                              point drawn\n"
+           " --threads [num]              Process devices on [num] threads while reading and writing\n"
+           "                              in parallel; 0 processes the log in a single thread.\n"
+           "                              Defaults to the number of CPUs.\n"
           );
 }
 
-// Helper method to add placemarks from a vector to the KML file when grouping placemarks.
-void add_placemarks_from_vec(FILE* ofile, std::vector<kml_placemark>& placemark_vec, std::string folder_name, 
-        std::string style_name, unsigned long& point_num, unsigned long& place_num) {
-    fmt::print(ofile, "<Folder>");
-    fmt::print(ofile, "<name>{}</name>", folder_name);
-    for (auto pl : placemark_vec) {
-        fmt::print(ofile, "<Placemark id=\"{}\">", place_num++);
-        fmt::print(ofile, "<name>{}</name>", MungeForXML(pl.name));
+// The trail of a placemark as a line of its own
+void add_trail_placemark(FILE *ofile, const kml_placemark& pl, const std::string& style_name,
+        unsigned long& place_num) {
+    if (pl.trail_coords.length() == 0)
+        return;
 
-        // style based on phy layer
+    fmt::print(ofile, "<Placemark id=\"{}\">", place_num++);
+    fmt::print(ofile, "<name>{} trail</name>", MungeForXML(pl.name));
+
+    if (style_name.length())
         fmt::print(ofile, "<styleUrl>{}</styleUrl>", style_name);
 
-        // add description
-        pl.description = "Name:" + MungeForXML(pl.name) + "\n";
-        pl.description += pl.phy_layer + "\n";
-        pl.description += "Channel:" + pl.channel;
+    fmt::print(ofile, "<LineString><altitudeMode>clampToGround</altitudeMode><coordinates>");
+    fmt::print(ofile, "{}", pl.trail_coords);
+    fmt::print(ofile, "</coordinates></LineString></Placemark>\n");
+}
 
-        if (pl.crypt.length() > 0)
-            pl.description += "\nCrypt:" + pl.crypt;
+void add_placemark(FILE *ofile, const kml_placemark& pl, const std::string& style_name,
+        unsigned long& point_num, unsigned long& place_num) {
+    fmt::print(ofile, "<Placemark id=\"{}\">", place_num++);
+    fmt::print(ofile, "<name>{}</name>", MungeForXML(pl.name));
 
-        fmt::print(ofile, "<description>{}</description>", pl.description);
+    if (style_name.length())
+        fmt::print(ofile, "<styleUrl>{}</styleUrl>", style_name);
 
-        for (auto p : pl.point_vec) {
-            fmt::print(ofile,
-                "<Point "
-                "id=\"{}\"><coordinates>{:3.10f},{:3.10f},{:3.10f}</coordinates></Point>",
-                point_num++, p.lon, p.lat, p.alt);
-        }
+    fmt::print(ofile, "<description>{}</description>", pl.description);
 
-        fmt::print(ofile, "</Placemark>\n");
+    for (const auto& p : pl.point_vec) {
+        fmt::print(ofile,
+            "<Point "
+            "id=\"{}\"><coordinates>{:3.10f},{:3.10f},{:3.10f}</coordinates></Point>",
+            point_num++, p.lon, p.lat, p.alt);
     }
+
+    fmt::print(ofile, "</Placemark>\n");
+
+    add_trail_placemark(ofile, pl, style_name, place_num);
+}
+
+// Helper method to add placemarks from a vector to the KML file when grouping placemarks.
+void add_placemarks_from_vec(FILE* ofile, std::vector<kml_placemark>& placemark_vec, std::string folder_name, 
+        std::string style_name, unsigned long& point_num, unsigned long& place_num) {
+    fmt::print(ofile, "<Folder>");
+    fmt::print(ofile, "<name>{}</name>", folder_name);
+    for (const auto& pl : placemark_vec)
+        add_placemark(ofile, pl, style_name, point_num, place_num);
     fmt::print(ofile, "</Folder>\n");
 }
 
 int main(int argc, char *argv[]) {
+#define OPT_THREADS             1
+#define OPT_DECIMATE_DISTANCE   2
+#define OPT_DECIMATE_TIME       3
     static struct option longopt[] = {
         { "in", required_argument, 0, 'i' },
         { "out", required_argument, 0, 'o' },
@@ -250,6 +288,10 @@ int main(int argc, char *argv[]) {
         { "exclude", required_argument, 0, 'e'},
         { "basic-location", no_argument, 0, 'B'},
         { "group", no_argument, 0, 'g' },
+        { "trails", no_argument, 0, 'T'},
+        { "threads", required_argument, 0, OPT_THREADS },
+        { "decimate-distance", required_argument, 0, OPT_DECIMATE_DISTANCE },
+        { "decimate-time", required_argument, 0, OPT_DECIMATE_TIME },
         { 0, 0, 0, 0 }
     };
 
@@ -264,8 +306,12 @@ int main(int argc, char *argv[]) {
     bool skipclean = false;
     bool basiclocation = false;
     bool group_in_folder = false;
+    bool trails = false;
+    unsigned int n_threads = std::thread::hardware_concurrency();
+    double decimate_distance = 0;
+    long decimate_time = 0;
 
-    std::vector<std::tuple<double, double, double>> exclusion_zones;
+    kismetdb_exclusion_zones exclusion_zones;
 
     int sql_r = 0;
     char *sql_errmsg = NULL;
@@ -307,6 +353,23 @@ int main(int argc, char *argv[]) {
             basiclocation = true;
         } else if (r == 'g') {
             group_in_folder = true;
+        } else if (r == 'T') {
+            trails = true;
+        } else if (r == OPT_THREADS) {
+            if (sscanf(optarg, "%u", &n_threads) != 1) {
+                fmt::print(stderr, "ERROR:  Expected --threads [number]\n");
+                exit(1);
+            }
+        } else if (r == OPT_DECIMATE_DISTANCE) {
+            if (sscanf(optarg, "%lf", &decimate_distance) != 1 || decimate_distance < 0) {
+                fmt::print(stderr, "ERROR:  Expected --decimate-distance [meters]\n");
+                exit(1);
+            }
+        } else if (r == OPT_DECIMATE_TIME) {
+            if (sscanf(optarg, "%ld", &decimate_time) != 1 || decimate_time < 0) {
+                fmt::print(stderr, "ERROR:  Expected --decimate-time [seconds]\n");
+                exit(1);
+            }
         }
     }
 
@@ -364,6 +427,9 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // Read every segment of a rotated log as one log
+    kismetdb_attach_segments(db, in_fname, verbose);
+
     // Use our sql adapters
 
     using namespace kissqlite3;
@@ -467,280 +533,213 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    std::vector<kml_placemark> placemark_vec;
+    unsigned long place_num = 0;
+    unsigned long point_num = 0;
 
-    // placemarks by types
-    std::vector<kml_placemark> ap_open_placemark_vec;
-    std::vector<kml_placemark> ap_wep_placemark_vec;
-    std::vector<kml_placemark> ap_wpa_placemark_vec;
-    std::vector<kml_placemark> client_placemark_vec;
-    std::vector<kml_placemark> other_placemark_vec;
-    std::vector<kml_placemark> zigbee_placemark_vec;
-    std::vector<kml_placemark> bluetooth_placemark_vec;
+    fmt::print(ofile, 
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<kml xmlns=\"http://www.opengis.net/kml/2.2\" xmlns:gx=\"http://www.google.com/kml/ext/2.2\">\n"
+            "<Document id=\"1\">\n"
+            "<Style id=\"btle\"><LabelStyle><color>#ffFF0000</color></LabelStyle><IconStyle><color>#ffFF0000</color></IconStyle></Style>\n"
+            "<Style id=\"zigbee\"><LabelStyle><color>#ffFF00FF</color></LabelStyle><IconStyle><color>#ffFF00FF</color></IconStyle></Style>\n"
+            "<Style id=\"wifi-ap-open\"><LabelStyle><color>#ff00FF00</color></LabelStyle><IconStyle><color>#ff00FF00</color></IconStyle></Style>\n"
+            "<Style id=\"wifi-ap-wep\"><LabelStyle><color>#ff0080FF</color></LabelStyle><IconStyle><color>#ff0080FF</color></IconStyle></Style>\n"
+            "<Style id=\"wifi-ap-wpa\"><LabelStyle><color>#ff0000FF</color></LabelStyle><IconStyle><color>#ff0000FF</color></IconStyle></Style>\n"
+            "<Style id=\"wifi-client\"><LabelStyle><color>#ff00FFFF</color></LabelStyle><IconStyle><color>#ff00FFFF</color></IconStyle></Style>\n"
+            "<Style id=\"other\"><LabelStyle><color>#ff00AAFF</color></LabelStyle><IconStyle><color>#ff00AAFF</color></IconStyle></Style>\n"
+            "<name>Kismet</name>\n"
+            "<open>1</open>");
 
-    if (basiclocation) {
-        auto basic_q = 
-            _SELECT(db, "devices", 
-                    {"min_lat", "min_lon", "max_lat", "max_lon", "avg_lat", "avg_lon", "device"}, 
-                    _WHERE("avglat", NEQ, 0, AND, "avglon", NEQ, 0));
+    // Locations from every packet, gathered in one pass instead of a query per device
+    std::map<kismetdb_geo_key, kismetdb_geo_average> locations;
 
-        for (auto d : basic_q) {
-            double avg_lat, avg_lon;
+    if (!basiclocation) {
+        if (verbose)
+            fmt::print(stderr, "* Locating devices...\n");
 
-            // Handle the different versions
-            if (db_version < 5) {
-                avg_lat = sqlite3_column_as<double>(d, 4) / 100000;
-                avg_lon = sqlite3_column_as<double>(d, 5) / 100000;
-            } else {
-                avg_lat = sqlite3_column_as<double>(d, 4);
-                avg_lon = sqlite3_column_as<double>(d, 5);
-            }
+        try {
+            locations = kismetdb_device_locations(db, db_version, exclusion_zones, n_threads);
+        } catch (const std::exception& e) {
+            fmt::print(stderr, "ERROR:  Failed to locate devices: {}\n", e.what());
+            exit(1);
+        }
+    }
 
-            // Check to see if we lie in any exclusion zones
-            bool violates_exclusion = false;
-            for (auto ez : exclusion_zones) {
-                if (distance_meters(avg_lat, avg_lon, std::get<0>(ez), std::get<1>(ez)) <= std::get<2>(ez)) {
-                    violates_exclusion = true;
-                    break;
-                }
-            }
+    // Devices are parsed, located, and formatted on the worker threads
+    auto decode_device = [&](const kml_device_row& row, kml_placemark& pl) {
+        pl.valid = false;
+
+        // Check to see if we lie in any exclusion zones
+        if (basiclocation && kismetdb_excluded(exclusion_zones, row.avg_lat, row.avg_lon))
+            return;
+
+        Json::Value json;
+        std::stringstream ss(row.device);
+
+        try {
+            ss >> json;
+            pl.name = json["kismet.device.base.commonname"].asString();
+            pl.phy_layer = json["kismet.device.base.phyname"].asString();
+            pl.channel = json["kismet.device.base.channel"].asString();
+            pl.crypt = json["kismet.device.base.crypt"].asString();
+        } catch (const std::exception& e) {
+            pl.warning = fmt::format("WARNING:  Could not process device info for '{}', skipping\n",
+                    row.devmac);
+            return;
+        }
 
-            if (violates_exclusion) {
-                continue;
-            }
+        // Trail points outside the exclusion zones
+        std::vector<kismetdb_trail_point> trail;
 
-            Json::Value json;
-            std::stringstream ss(sqlite3_column_as<std::string>(d, 6));
-
-            try {
-                ss >> json;
-
-                kml_point p;
-                p.lat = avg_lat;
-                p.lon = avg_lon;
-                p.alt = 0;
-
-                kml_placemark pl;
-                pl.name = json["kismet.device.base.commonname"].asString();
-                pl.phy_layer = json["kismet.device.base.phyname"].asString();
-                pl.channel = json["kismet.device.base.channel"].asString();
-                pl.crypt = json["kismet.device.base.crypt"].asString();
-                pl.point_vec.push_back(p);
-
-                if (group_in_folder) {
-                    // style based on phy layer
-                    if (pl.phy_layer == "Bluetooth" || pl.phy_layer == "BTLE") {
-                        bluetooth_placemark_vec.push_back(pl);
-                    } else if (pl.phy_layer == "802.15.4") {
-                        zigbee_placemark_vec.push_back(pl);
-                    } else {
-                        if (regex_match(pl.name, mac_pattern)) {
-                            client_placemark_vec.push_back(pl);
-                        } else {
-                            if (pl.crypt == "Open") {
-                                ap_open_placemark_vec.push_back(pl);
-                            } else if (pl.crypt.find("WEP") != std::string::npos) {
-                                ap_wep_placemark_vec.push_back(pl);
-                            } else if (pl.crypt.find("WPA") != std::string::npos) {
-                                ap_wpa_placemark_vec.push_back(pl);
-                            } else {
-                                other_placemark_vec.push_back(pl);
-                            }
-                        }
-                    }
-                } else {
-                    placemark_vec.push_back(pl);
-                }
-            } catch (const std::exception &e) {
-                std::cerr << fmt::format(
-                                 "WARNING:  Could not process device info for "
-                                 "'{}', skipping",
-                                 json)
-                          << std::endl;
-            }
+        if (trails) {
+            trail = kismetdb_device_trail(json);
+
+            trail.erase(std::remove_if(trail.begin(), trail.end(), 
+                        [&](const kismetdb_trail_point& p) {
+                            return kismetdb_excluded(exclusion_zones, p.lat, p.lon);
+                        }), trail.end());
         }
-    } else {
-        auto basic_q = 
-            _SELECT(db, "devices", {"phyname", "devmac", "device"});
 
-        for (auto d : basic_q) {
-            // Prep the packet list for different kismetdb versions
-            std::list<std::string> packet_fields;
+        kml_point p;
+        p.alt = 0;
 
-            if (db_version < 5) {
-                packet_fields = std::list<std::string>{"lat", "lon" };
+        if (basiclocation) {
+            p.lat = row.avg_lat;
+            p.lon = row.avg_lon;
+        } else {
+            kismetdb_geo_average avg;
+
+            // Devices with a trail are located from it instead of their packets
+            if (trail.size()) {
+                for (const auto& tp : trail)
+                    avg.add(tp.lat, tp.lon, tp.alt);
             } else {
-                packet_fields = std::list<std::string>{"lat", "lon", "alt"};
+                auto li = locations.find(kismetdb_geo_key(row.phyname, row.devmac));
+
+                if (li != locations.end())
+                    avg = li->second;
             }
 
-            auto phyname = sqlite3_column_as<std::string>(d, 0);
-            auto devmac = sqlite3_column_as<std::string>(d, 1);
-            Json::Value json;
+            if (!avg.valid()) {
+                pl.warning = fmt::format("WARNING:  No packets with GPS info for '{}', skipping\n",
+                        pl.name);
+                return;
+            }
 
-            std::stringstream ss(sqlite3_column_as<std::string>(d, 2));
+            p.lat = avg.lat();
+            p.lon = avg.lon();
+            p.alt = avg.alt();
+        }
 
-            kml_placemark pl;
+        pl.point_vec.push_back(p);
 
-            try {
-                ss >> json;
-                pl.name = json["kismet.device.base.commonname"].asString();
-                pl.phy_layer = json["kismet.device.base.phyname"].asString();
-                pl.channel = json["kismet.device.base.channel"].asString();
-                pl.crypt = json["kismet.device.base.crypt"].asString();
-            } catch (const std::exception& e) {
-                fmt::print(stderr, "WARNING:  Could not process device info for '{}', skipping\n", json);
-                continue;
-            }
+        kismetdb_decimate_track(trail, decimate_distance, decimate_time);
 
-            pl.avg_alt = 0;
-            pl.avg_lat = 0;
-            pl.avg_lon = 0;
-            pl.avg_2d_num = 0;
-            pl.avg_alt = 0;
-
-            auto packet_q = _SELECT(db, "packets", packet_fields,
-                    _WHERE("sourcemac", EQ, devmac, AND, "phyname", EQ, phyname, AND, "lat", NEQ, 0, AND, "lon", NEQ, 0));
-
-            for (auto p : packet_q) {
-                double lat, lon, alt;
-
-                // Handle the different versions
-                if (db_version < 5) {
-                    lat = sqlite3_column_as<double>(p, 0) / 100000;
-                    lon = sqlite3_column_as<double>(p, 1) / 100000;
-                    alt = 0;
-                } else {
-                    lat = sqlite3_column_as<double>(p, 0);
-                    lon = sqlite3_column_as<double>(p, 1);
-                    alt = sqlite3_column_as<double>(p, 2);
-                }
+        if (trail.size() >= 2) {
+            for (const auto& tp : trail)
+                pl.trail_coords += fmt::format("{:3.10f},{:3.10f},{:3.10f} ", tp.lon, tp.lat, tp.alt);
+        }
 
-                // Check to see if we lie in any exclusion zones
-                bool violates_exclusion = false;
-                for (auto ez : exclusion_zones) {
-                    if (distance_meters(lat, lon, std::get<0>(ez), std::get<1>(ez)) <= std::get<2>(ez)) {
-                        violates_exclusion = true;
-                        break;
-                    }
-                }
+        // add description
+        pl.description = "Name:" + MungeForXML(pl.name) + "\n";
+        pl.description += pl.phy_layer + "\n";
+        pl.description += "Channel:" + pl.channel;
 
-                if (violates_exclusion) {
-                    continue;
-                }
+        if (pl.crypt.length() > 0)
+            pl.description += "\nCrypt:" + pl.crypt;
 
-                pl.avg_lat += lat;
-                pl.avg_lon += lon;
-                pl.avg_2d_num++;
+        if (pl.phy_layer == "Bluetooth" || pl.phy_layer == "BTLE") {
+            pl.group = kml_group_bluetooth;
+        } else if (pl.phy_layer == "802.15.4") {
+            pl.group = kml_group_zigbee;
+        } else if (regex_match(pl.name, mac_pattern)) {
+            pl.group = kml_group_client;
+        } else if (pl.crypt == "Open") {
+            pl.group = kml_group_ap_open;
+        } else if (pl.crypt.find("WEP") != std::string::npos) {
+            pl.group = kml_group_ap_wep;
+        } else if (pl.crypt.find("WPA") != std::string::npos) {
+            pl.group = kml_group_ap_wpa;
+        } else {
+            pl.group = kml_group_other;
+        }
 
-                if (alt != 0) {
-                    pl.avg_alt += alt;
-                    pl.avg_alt_num++;
-                }
-            }
+        pl.valid = true;
+    };
 
-            auto data_q = _SELECT(db, "data", packet_fields,
-                    _WHERE("devmac", EQ, devmac, AND, "phyname", EQ, phyname, AND, "lat", NEQ, 0, AND, "lon", NEQ, 0));
-
-            for (auto p : data_q) {
-                double lat, lon, alt;
-
-                // Handle the different versions
-                if (db_version < 5) {
-                    lat = sqlite3_column_as<double>(p, 0) / 100000;
-                    lon = sqlite3_column_as<double>(p, 1) / 100000;
-                    alt = 0;
-                } else {
-                    lat = sqlite3_column_as<double>(p, 0);
-                    lon = sqlite3_column_as<double>(p, 1);
-                    alt = sqlite3_column_as<double>(p, 2);
-                }
+    // Placemarks by type, when grouping; otherwise placemarks are written as they're decoded
+    std::vector<std::vector<kml_placemark>> grouped_vec(kml_group_max);
 
-                // Check to see if we lie in any exclusion zones
-                bool violates_exclusion = false;
-                for (auto ez : exclusion_zones) {
-                    if (distance_meters(lat, lon, std::get<0>(ez), std::get<1>(ez)) <= std::get<2>(ez)) {
-                        violates_exclusion = true;
-                        break;
-                    }
-                }
+    auto write_device = [&](kml_placemark& pl) {
+        if (pl.warning.length())
+            fmt::print(stderr, "{}", pl.warning);
 
-                if (violates_exclusion) {
-                    continue;
-                }
+        if (!pl.valid)
+            return;
 
-                pl.avg_lat += lat;
-                pl.avg_lon += lon;
-                pl.avg_2d_num++;
+        if (group_in_folder) {
+            grouped_vec[pl.group].push_back(std::move(pl));
+            return;
+        }
 
-                if (alt != 0) {
-                    pl.avg_alt += alt;
-                    pl.avg_alt_num++;
-                }
-            }
+        // style based on phy layer
+        if (pl.group == kml_group_bluetooth)
+            add_placemark(ofile, pl, "btle", point_num, place_num);
+        else if (pl.group == kml_group_zigbee)
+            add_placemark(ofile, pl, "zigbee", point_num, place_num);
+        else
+            add_placemark(ofile, pl, "", point_num, place_num);
+    };
 
-            if (pl.avg_2d_num == 0) {
-                fmt::print(stderr, "WARNING:  No packets with GPS info for '{}', skipping\n", pl.name);
-                continue;
-            }
+    auto device_q = _SELECT(db, "devices", {"phyname", "devmac", "avg_lat", "avg_lon", "device"});
 
-            kml_point p;
-            p.lat = pl.avg_lat / pl.avg_2d_num;
-            p.lon = pl.avg_lon / pl.avg_2d_num;
+    if (basiclocation)
+        device_q.append_where(AND, _WHERE("avglat", NEQ, 0, AND, "avglon", NEQ, 0));
 
-            if (pl.avg_alt_num)
-                p.alt = pl.avg_alt / pl.avg_alt_num;
+    auto dev = device_q.begin();
 
-            pl.point_vec.push_back(p);
+    auto read_devices = [&](std::vector<kml_device_row>& rows, size_t max) -> bool {
+        for (; rows.size() < max && dev != device_q.end(); ++dev) {
+            kml_device_row row;
 
-            if(group_in_folder) {
-                // style based on phy layer
-                if(pl.phy_layer == "Bluetooth" || pl.phy_layer == "BTLE") {
-                    bluetooth_placemark_vec.push_back(pl);
-                }
-                else if(pl.phy_layer == "802.15.4") {
-                    zigbee_placemark_vec.push_back(pl);
-                }
-                else {
-                    if (regex_match(pl.name, mac_pattern)) {
-                        client_placemark_vec.push_back(pl);
-                    } else {
-                        if (pl.crypt == "Open") {
-                            ap_open_placemark_vec.push_back(pl);
-                        } else if (pl.crypt.find("WEP") != std::string::npos) {
-                            ap_wep_placemark_vec.push_back(pl);
-                        } else if (pl.crypt.find("WPA") != std::string::npos) {
-                            ap_wpa_placemark_vec.push_back(pl);
-                        } else {
-                            other_placemark_vec.push_back(pl);
-                        }
-                    }
-                }
-            }
-            else {
-                placemark_vec.push_back(pl);
+            row.phyname = sqlite3_column_as<std::string>(*dev, 0);
+            row.devmac = sqlite3_column_as<std::string>(*dev, 1);
+
+            // Handle the different versions
+            if (db_version < 5) {
+                row.avg_lat = sqlite3_column_as<double>(*dev, 2) / 100000;
+                row.avg_lon = sqlite3_column_as<double>(*dev, 3) / 100000;
+            } else {
+                row.avg_lat = sqlite3_column_as<double>(*dev, 2);
+                row.avg_lon = sqlite3_column_as<double>(*dev, 3);
             }
 
+            row.device = sqlite3_column_as<std::string>(*dev, 4);
+
+            rows.push_back(std::move(row));
         }
-    }
 
-    unsigned long place_num = 0;
-    unsigned long point_num = 0;
+        return dev != device_q.end();
+    };
 
-    fmt::print(ofile, 
-            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
-            "<kml xmlns=\"http://www.opengis.net/kml/2.2\" xmlns:gx=\"http://www.google.com/kml/ext/2.2\">\n"
-            "<Document id=\"1\">\n"
-            "<Style id=\"btle\"><LabelStyle><color>#ffFF0000</color></LabelStyle><IconStyle><color>#ffFF0000</color></IconStyle></Style>\n"
-            "<Style id=\"zigbee\"><LabelStyle><color>#ffFF00FF</color></LabelStyle><IconStyle><color>#ffFF00FF</color></IconStyle></Style>\n"
-            "<Style id=\"wifi-ap-open\"><LabelStyle><color>#ff00FF00</color></LabelStyle><IconStyle><color>#ff00FF00</color></IconStyle></Style>\n"
-            "<Style id=\"wifi-ap-wep\"><LabelStyle><color>#ff0080FF</color></LabelStyle><IconStyle><color>#ff0080FF</color></IconStyle></Style>\n"
-            "<Style id=\"wifi-ap-wpa\"><LabelStyle><color>#ff0000FF</color></LabelStyle><IconStyle><color>#ff0000FF</color></IconStyle></Style>\n"
-            "<Style id=\"wifi-client\"><LabelStyle><color>#ff00FFFF</color></LabelStyle><IconStyle><color>#ff00FFFF</color></IconStyle></Style>\n"
-            "<Style id=\"other\"><LabelStyle><color>#ff00AAFF</color></LabelStyle><IconStyle><color>#ff00AAFF</color></IconStyle></Style>\n"
-            "<name>Kismet</name>\n"
-            "<open>1</open>");
+    try {
+        kismetdb_pipeline<kml_device_row, kml_placemark> pipeline(n_threads, 64,
+                read_devices, decode_device, write_device);
+        pipeline.run();
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "ERROR:  Failed to process devices: {}\n", e.what());
+        exit(1);
+    }
 
     if (group_in_folder) {
+        auto& bluetooth_placemark_vec = grouped_vec[kml_group_bluetooth];
+        auto& zigbee_placemark_vec = grouped_vec[kml_group_zigbee];
+        auto& client_placemark_vec = grouped_vec[kml_group_client];
+        auto& ap_open_placemark_vec = grouped_vec[kml_group_ap_open];
+        auto& ap_wep_placemark_vec = grouped_vec[kml_group_ap_wep];
+        auto& ap_wpa_placemark_vec = grouped_vec[kml_group_ap_wpa];
+        auto& other_placemark_vec = grouped_vec[kml_group_other];
+
         if (!bluetooth_placemark_vec.empty()) {
             add_placemarks_from_vec(ofile, bluetooth_placemark_vec, "Bluetooth", "btle", point_num, place_num);
         }
@@ -786,37 +785,6 @@ int main(int argc, char *argv[]) {
             add_placemarks_from_vec(ofile, other_placemark_vec, "Other", "other", point_num, place_num);
         }
 
-    } else {
-        for (auto pl : placemark_vec) {
-            fmt::print(ofile, "<Placemark id=\"{}\">", place_num++);
-            fmt::print(ofile, "<name>{}</name>", MungeForXML(pl.name));
-
-            // style based on phy layer
-            if (pl.phy_layer == "Bluetooth" || pl.phy_layer == "BTLE") {
-                fmt::print(ofile, "<styleUrl>btle</styleUrl>");
-            } else if (pl.phy_layer == "802.15.4") {
-                fmt::print(ofile, "<styleUrl>zigbee</styleUrl>");
-            }
-
-            // add description
-            pl.description = "Name:" + MungeForXML(pl.name) + "\n";
-            pl.description += pl.phy_layer + "\n";
-            pl.description += "Channel:" + pl.channel;
-
-            if (pl.crypt.length() > 0)
-                pl.description += "\nCrypt:" + pl.crypt;
-
-            fmt::print(ofile, "<description>{}</description>", pl.description);
-
-            for (auto p : pl.point_vec) {
-                fmt::print(ofile,
-                    "<Point "
-                    "id=\"{}\"><coordinates>{:3.10f},{:3.10f},{:3.10f}</coordinates></Point>",
-                    point_num++, p.lon, p.lat, p.alt);
-            }
-
-            fmt::print(ofile, "</Placemark>\n");
-        }
     }
 
     fmt::print(ofile, "</Document>\n");
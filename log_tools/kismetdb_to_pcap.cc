@@ -28,6 +28,8 @@
 #include <iomanip>
 #include <ctime>
 #include <iostream>
+#include <sstream>
+#include <thread>
 #include <tuple>
 #include <string>
 
@@ -49,6 +51,8 @@
 #include "packet_ieee80211.h"
 #include "pcapng.h"
 #include "sqlite3_cpp11.h"
+#include "kismetdb_pipeline.h"
+#include "kismetdb_segments.h"
 #include "version.h"
 
 extern "C" {
@@ -159,6 +163,32 @@ public:
     std::vector<int> dlts;
 };
 
+// Packet or GPS track row, as read from the log
+struct pcap_row {
+    bool gps;
+    unsigned long ts_sec;
+    unsigned long ts_usec;
+    unsigned int dlt;
+    std::string datasource;
+
+    // Packet content, or the JSON of a GPS snapshot
+    std::string data;
+
+    double lat;
+    double lon;
+    double alt;
+    std::string tags;
+};
+
+// Formatted record, ready to write once the output file is known
+struct pcap_record {
+    bool gps;
+    unsigned int dlt;
+    std::string datasource;
+    size_t packet_sz;
+    std::string data;
+};
+
 std::vector<int> get_dlts_per_datasouce(sqlite3 *db, const std::string& uuid) {
     using namespace kissqlite3;
 
@@ -214,7 +244,19 @@ FILE *open_pcap_file(const std::string& path, bool force, unsigned int dlt) {
     return pcap_file;
 }
 
-void write_pcap_packet(FILE *pcap_file, const std::string& packet,
+// Records are formatted into a buffer, so they can be built on a worker thread and
+// written with a single write
+void buf_append(std::string& out, const void *data, size_t len) {
+    out.append(reinterpret_cast<const char *>(data), len);
+}
+
+void write_record_data(FILE *file, const std::string& data) {
+    if (fwrite(data.data(), data.size(), 1, file) != 1)
+        throw std::runtime_error(fmt::format("error writing packet: {} (errno {})",
+                    strerror(errno), errno));
+}
+
+void format_pcap_packet(std::string& out, const std::string& packet,
         unsigned long ts_sec, unsigned long ts_usec) {
     pcap_packet_hdr_t hdr;
     hdr.ts_sec = ts_sec;
@@ -222,13 +264,9 @@ void write_pcap_packet(FILE *pcap_file, const std::string& packet,
     hdr.incl_len = packet.size();
     hdr.orig_len = packet.size();
 
-    if (fwrite(&hdr, sizeof(pcap_packet_hdr_t), 1, pcap_file) != 1)
-        throw std::runtime_error(fmt::format("error writing pcap packet: {} (errno {})",
-                    strerror(errno), errno));
+    buf_append(out, &hdr, sizeof(pcap_packet_hdr_t));
 
-    if (fwrite(packet.data(), packet.size(), 1, pcap_file) != 1)
-        throw std::runtime_error(fmt::format("error writing pcap packet: {} (errno {})",
-                    strerror(errno), errno));
+    buf_append(out, packet.data(), packet.size());
 }
 
 
@@ -355,7 +393,7 @@ void write_pcapng_interface(FILE *pcapng_file, unsigned int ngindex, const std::
                     strerror(errno), errno));
 }
 
-void write_pcapng_gps(FILE *pcapng_file, unsigned long ts_sec, unsigned long ts_usec, 
+void format_pcapng_gps(std::string& out, unsigned long ts_sec, unsigned long ts_usec, 
         double lat, double lon, double alt) {
 
     if (lat == 0 || lon == 0)
@@ -377,9 +415,7 @@ void write_pcapng_gps(FILE *pcapng_file, unsigned long ts_sec, unsigned long ts_
     cb.block_length = data_sz + 4;
     cb.custom_pen = KISMET_IANA_PEN;
 
-    if (fwrite(&cb, sizeof(pcapng_custom_block_t), 1, pcapng_file) != 1)
-        throw std::runtime_error(fmt::format("error writing pcapng gps packet header: {} (errno {})",
-                strerror(errno), errno));
+    buf_append(out, &cb, sizeof(pcapng_custom_block_t));
 
     kismet_pcapng_gps_chunk_t gps;
 
@@ -395,9 +431,7 @@ void write_pcapng_gps(FILE *pcapng_file, unsigned long ts_sec, unsigned long ts_
     }
 
     // GPS header
-    if (fwrite(&gps, sizeof(kismet_pcapng_gps_chunk_t), 1, pcapng_file) != 1)
-        throw std::runtime_error(fmt::format("error writing packet gps options: {} (errno {})",
-                    strerror(errno), errno));
+    buf_append(out, &gps, sizeof(kismet_pcapng_gps_chunk_t));
 
     union block {
         uint8_t u8;
@@ -407,65 +441,52 @@ void write_pcapng_gps(FILE *pcapng_file, unsigned long ts_sec, unsigned long ts_
 
     // Lon, lat, [alt]
     u.u32 = double_to_fixed3_7(lon);
-    if (fwrite(&u, sizeof(uint32_t), 1, pcapng_file) != 1) 
-        throw std::runtime_error(fmt::format("error writing packet gps: {} (errno {})",
-                    strerror(errno), errno));
+    buf_append(out, &u, sizeof(uint32_t));
 
     u.u32 = double_to_fixed3_7(lat);
-    if (fwrite(&u, sizeof(uint32_t), 1, pcapng_file) != 1) 
-        throw std::runtime_error(fmt::format("error writing packet gps: {} (errno {})",
-                    strerror(errno), errno));
+    buf_append(out, &u, sizeof(uint32_t));
 
     if (alt != 0) {
         u.u32 = double_to_fixed6_4(alt);
-        if (fwrite(&u, sizeof(uint32_t), 1, pcapng_file) != 1) 
-            throw std::runtime_error(fmt::format("error writing packet gps: {} (errno {})",
-                        strerror(errno), errno));
+        buf_append(out, &u, sizeof(uint32_t));
     }
 
     // TS high and low
     uint64_t conv_ts = ((uint64_t) ts_sec * 1'000'000L) + ts_usec;
 
     u.u32 = (conv_ts >> 32);
-    if (fwrite(&u, sizeof(uint32_t), 1, pcapng_file) != 1) 
-        throw std::runtime_error(fmt::format("error writing packet gps: {} (errno {})",
-                    strerror(errno), errno));
+    buf_append(out, &u, sizeof(uint32_t));
 
     u.u32 = conv_ts;
-    if (fwrite(&u, sizeof(uint32_t), 1, pcapng_file) != 1) 
-        throw std::runtime_error(fmt::format("error writing packet gps: {} (errno {})",
-                    strerror(errno), errno));
+    buf_append(out, &u, sizeof(uint32_t));
 
     uint32_t pad = 0;
     auto pad_sz = PAD_TO_32BIT(gps.gps_len) - gps.gps_len;
 
     if (pad_sz > 0)
-        if (fwrite(&pad, pad_sz, 1, pcapng_file) != 1)
-            throw std::runtime_error(fmt::format("error writing pcapng packet option: {} (errno {})",
-                        strerror(errno), errno));
+        buf_append(out, &pad, pad_sz);
 
     // No options
     pcapng_option_t opt;
     opt.option_code = PCAPNG_OPT_ENDOFOPT;
     opt.option_length = 0;
 
-    if (fwrite(&opt, sizeof(pcapng_option_t), 1, pcapng_file) != 1) 
-        throw std::runtime_error(fmt::format("error writing packet end-of-options: {} (errno {})",
-                    strerror(errno), errno));
+    buf_append(out, &opt, sizeof(pcapng_option_t));
 
     data_sz += 4;
 
-    if (fwrite(&data_sz, 4, 1, pcapng_file) != 1)
-        throw std::runtime_error(fmt::format("error writing packet end-of-packet: {} (errno {})",
-                    strerror(errno), errno));
+    buf_append(out, &data_sz, 4);
 
 }
 
-void write_pcapng_packet(FILE *pcapng_file, const std::string& packet,
+// The interface of the packet is not known until it is written; the writer sets it at
+// PCAPNG_EPB_INTERFACE_OFFSET
+#define PCAPNG_EPB_INTERFACE_OFFSET     8
+
+void format_pcapng_packet(std::string& out, const std::string& packet,
         unsigned long ts_sec, unsigned long ts_usec, const std::string& tag,
-        unsigned int ngindex, double lat, double lon, double alt) {
+        double lat, double lon, double alt) {
 
-    // Assemble the packet in the file in steps to avoid another memcpy
     pcapng_epb_t epb;
 
     // Always allocate an end-of-options option
@@ -492,7 +513,7 @@ void write_pcapng_packet(FILE *pcapng_file, const std::string& packet,
 
     epb.block_type = PCAPNG_EPB_BLOCK_TYPE;
     epb.block_length = data_sz + 4;
-    epb.interface_id = ngindex;
+    epb.interface_id = 0;
 
     uint64_t conv_ts = ((uint64_t) ts_sec * 1'000'000L) + ts_usec;
     epb.timestamp_high = (conv_ts >> 32);
@@ -501,13 +522,9 @@ void write_pcapng_packet(FILE *pcapng_file, const std::string& packet,
     epb.captured_length = packet.size();
     epb.original_length = packet.size();
 
-    if (fwrite(&epb, sizeof(pcapng_epb_t), 1, pcapng_file) != 1)
-        throw std::runtime_error(fmt::format("error writing pcapng packet header: {} (errno {})",
-                strerror(errno), errno));
+    buf_append(out, &epb, sizeof(pcapng_epb_t));
 
-    if (fwrite(packet.data(), packet.size(), 1, pcapng_file) != 1)
-        throw std::runtime_error(fmt::format("error writing pcapng packet content: {} (errno {})",
-                    strerror(errno), errno));
+    buf_append(out, packet.data(), packet.size());
 
     // Data has to be 32bit padded
     uint32_t pad = 0;
@@ -516,9 +533,7 @@ void write_pcapng_packet(FILE *pcapng_file, const std::string& packet,
     pad_sz = PAD_TO_32BIT(packet.size()) - packet.size();
 
     if (pad_sz > 0)
-        if (fwrite(&pad, pad_sz, 1, pcapng_file) != 1)
-            throw std::runtime_error(fmt::format("error writing pcapng packet padding: {} (errno {})",
-                        strerror(errno), errno));
+        buf_append(out, &pad, pad_sz);
 
     pcapng_option_t opt;
 
@@ -526,20 +541,14 @@ void write_pcapng_packet(FILE *pcapng_file, const std::string& packet,
         opt.option_code = PCAPNG_OPT_COMMENT;
         opt.option_length = tag.length();
 
-        if (fwrite(&opt, sizeof(pcapng_option_t), 1, pcapng_file) != 1) 
-            throw std::runtime_error(fmt::format("error writing pcapng packet option: {} (errno {})",
-                        strerror(errno), errno));
+        buf_append(out, &opt, sizeof(pcapng_option_t));
 
-        if (fwrite(tag.c_str(), tag.length(), 1, pcapng_file) != 1)
-            throw std::runtime_error(fmt::format("error writing pcapng packet option: {} (errno {})",
-                        strerror(errno), errno));
+        buf_append(out, tag.c_str(), tag.length());
 
         pad_sz = PAD_TO_32BIT(tag.length()) - tag.length();
 
         if (pad_sz > 0)
-            if (fwrite(&pad, pad_sz, 1, pcapng_file) != 1)
-                throw std::runtime_error(fmt::format("error writing pcapng packet option: {} (errno {})",
-                            strerror(errno), errno));
+            buf_append(out, &pad, pad_sz);
     }
 
     // If we have gps data, tag the packet with a kismet custom GPS entry under the kismet PEN
@@ -573,14 +582,10 @@ void write_pcapng_packet(FILE *pcapng_file, const std::string& packet,
         gps.gps_fields_present = gps_fields;
 
         // Option + PEN custom option header
-        if (fwrite(&copt, sizeof(pcapng_custom_option_t), 1, pcapng_file) != 1)
-            throw std::runtime_error(fmt::format("error writing packet gps options: {} (errno {})",
-                        strerror(errno), errno));
+        buf_append(out, &copt, sizeof(pcapng_custom_option_t));
 
         // GPS header
-        if (fwrite(&gps, sizeof(kismet_pcapng_gps_chunk_t), 1, pcapng_file) != 1)
-            throw std::runtime_error(fmt::format("error writing packet gps options: {} (errno {})",
-                        strerror(errno), errno));
+        buf_append(out, &gps, sizeof(kismet_pcapng_gps_chunk_t));
 
         union block {
             uint8_t u8;
@@ -590,42 +595,30 @@ void write_pcapng_packet(FILE *pcapng_file, const std::string& packet,
 
         // Lon, lat, [alt]
         u.u32 = double_to_fixed3_7(lon);
-        if (fwrite(&u, sizeof(uint32_t), 1, pcapng_file) != 1) 
-            throw std::runtime_error(fmt::format("error writing packet gps: {} (errno {})",
-                        strerror(errno), errno));
+        buf_append(out, &u, sizeof(uint32_t));
 
         u.u32 = double_to_fixed3_7(lat);
-        if (fwrite(&u, sizeof(uint32_t), 1, pcapng_file) != 1) 
-            throw std::runtime_error(fmt::format("error writing packet gps: {} (errno {})",
-                        strerror(errno), errno));
+        buf_append(out, &u, sizeof(uint32_t));
 
         if (alt != 0) {
             u.u32 = double_to_fixed6_4(alt);
-            if (fwrite(&u, sizeof(uint32_t), 1, pcapng_file) != 1) 
-                throw std::runtime_error(fmt::format("error writing packet gps: {} (errno {})",
-                            strerror(errno), errno));
+            buf_append(out, &u, sizeof(uint32_t));
         }
 
         pad_sz = PAD_TO_32BIT(copt.option_length) - copt.option_length;
 
         if (pad_sz > 0)
-            if (fwrite(&pad, pad_sz, 1, pcapng_file) != 1)
-                throw std::runtime_error(fmt::format("error writing pcapng packet option: {} (errno {})",
-                            strerror(errno), errno));
+            buf_append(out, &pad, pad_sz);
     }
 
     opt.option_code = PCAPNG_OPT_ENDOFOPT;
     opt.option_length = 0;
 
-    if (fwrite(&opt, sizeof(pcapng_option_t), 1, pcapng_file) != 1) 
-        throw std::runtime_error(fmt::format("error writing packet end-of-options: {} (errno {})",
-                    strerror(errno), errno));
+    buf_append(out, &opt, sizeof(pcapng_option_t));
 
     data_sz += 4;
 
-    if (fwrite(&data_sz, 4, 1, pcapng_file) != 1)
-        throw std::runtime_error(fmt::format("error writing packet end-of-packet: {} (errno {})",
-                    strerror(errno), errno));
+    buf_append(out, &data_sz, 4);
 }
     
 
@@ -660,6 +653,14 @@ void print_help(char *argv) {
            "                                via the Kismet PEN custom fields\n"
            "     --skip-gps-track           When generating pcapng logs, don't include GPS movement\n"
            "                                track information\n"
+           "     --start-time [unix time]   Only export packets seen at or after this time\n"
+           "     --end-time [unix time]     Only export packets seen before this time\n"
+           "     --device [mac]             Only export packets to, from, or transmitted by this MAC\n"
+           "                                address.  Multiple device arguments can be given to include\n"
+           "                                multiple devices.\n"
+           "     --threads [num]            Format packets on [num] threads while reading and writing\n"
+           "                                in parallel; 0 processes the log in a single thread.\n"
+           "                                Defaults to the number of CPUs.\n"
            "\n"
            "When splitting output by datasource, the file will be named [outname]-[datasource-uuid].\n"
            "\n"
@@ -686,6 +687,10 @@ int main(int argc, char *argv[]) {
 #define OPT_SKIP_GPSTRACK       9
 #define OPT_LIST_TAGS           10
 #define OPT_FILTER_TAG          11
+#define OPT_THREADS             12
+#define OPT_START_TIME          13
+#define OPT_END_TIME            14
+#define OPT_FILTER_DEVICE       15
     static struct option longopt[] = {
         { "in", required_argument, 0, 'i' },
         { "out", required_argument, 0, 'o' },
@@ -704,6 +709,10 @@ int main(int argc, char *argv[]) {
         { "dlt", required_argument, 0, OPT_DLT },
         { "skip-gps", no_argument, 0, OPT_SKIP_GPS },
         { "skip-gps-track", no_argument, 0, OPT_SKIP_GPSTRACK },
+        { "threads", required_argument, 0, OPT_THREADS },
+        { "start-time", required_argument, 0, OPT_START_TIME },
+        { "end-time", required_argument, 0, OPT_END_TIME },
+        { "device", required_argument, 0, OPT_FILTER_DEVICE },
         { 0, 0, 0, 0 }
     };
 
@@ -726,6 +735,10 @@ int main(int argc, char *argv[]) {
     std::vector<std::string> raw_interface_vec;
     int dlt = -1;
     std::map<std::string, bool> tag_filter_map;
+    std::vector<std::string> device_filter_vec;
+    unsigned long start_time = 0;
+    unsigned long end_time = 0;
+    unsigned int n_threads = std::thread::hardware_concurrency();
 
     int sql_r = 0;
     char *sql_errmsg = NULL;
@@ -798,6 +811,23 @@ int main(int argc, char *argv[]) {
         } else if (r == OPT_SKIP_GPSTRACK) {
             fmt::print(stderr, "Skipping GPS movement/track data\n");
             skip_gps_track = true;
+        } else if (r == OPT_THREADS) {
+            if (sscanf(optarg, "%u", &n_threads) != 1) {
+                fmt::print(stderr, "ERROR: Expected --threads [number]\n");
+                exit(1);
+            }
+        } else if (r == OPT_START_TIME) {
+            if (sscanf(optarg, "%lu", &start_time) != 1) {
+                fmt::print(stderr, "ERROR: Expected --start-time [unix time]\n");
+                exit(1);
+            }
+        } else if (r == OPT_END_TIME) {
+            if (sscanf(optarg, "%lu", &end_time) != 1) {
+                fmt::print(stderr, "ERROR: Expected --end-time [unix time]\n");
+                exit(1);
+            }
+        } else if (r == OPT_FILTER_DEVICE) {
+            device_filter_vec.push_back(std::string(optarg));
         }
     }
 
@@ -857,6 +887,9 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // Read every segment of a rotated log as one log
+    kismetdb_attach_segments(db, in_fname, verbose);
+
     using namespace kissqlite3;
 
     int db_version = 0;
@@ -1074,6 +1107,26 @@ int main(int argc, char *argv[]) {
         packet_filter_q = _WHERE(packet_filter_q, AND, uuid_clause);
     }
 
+    // Time and device filters are applied by the query, so filtered packets are never
+    // read out of the log
+    if (start_time != 0)
+        packet_filter_q = _WHERE(packet_filter_q, AND, "ts_sec", GE, start_time);
+
+    if (end_time != 0)
+        packet_filter_q = _WHERE(packet_filter_q, AND, "ts_sec", LT, end_time);
+
+    if (device_filter_vec.size() != 0) {
+        auto device_clause = _WHERE();
+
+        for (const auto& d : device_filter_vec) {
+            device_clause = _WHERE(device_clause, OR, "sourcemac", LIKE, d);
+            device_clause = _WHERE(device_clause, OR, "destmac", LIKE, d);
+            device_clause = _WHERE(device_clause, OR, "transmac", LIKE, d);
+        }
+
+        packet_filter_q = _WHERE(packet_filter_q, AND, device_clause);
+    }
+
     std::list<std::string> packet_fields;
     if (db_version < 6) {
         packet_fields = 
@@ -1093,9 +1146,17 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    auto gps_filter_q = _WHERE("snaptype", EQ, "GPS");
+
+    if (start_time != 0)
+        gps_filter_q = _WHERE(gps_filter_q, AND, "ts_sec", GE, start_time);
+
+    if (end_time != 0)
+        gps_filter_q = _WHERE(gps_filter_q, AND, "ts_sec", LT, end_time);
+
     auto gps_q = _SELECT(db, "snapshots",
             {"ts_sec", "ts_usec", "json"},
-            _WHERE("snaptype", EQ, "GPS"));
+            gps_filter_q);
 
     auto pkt = packets_q.begin();
     auto gps = gps_q.begin();
@@ -1106,257 +1167,227 @@ int main(int argc, char *argv[]) {
     uint64_t pkt_time = 0, pkt_time_us = 0;
     uint64_t gps_time = 0, gps_time_us = 0;
 
-    try {
-        while (pkt != packets_q.end() || gps != gps_q.end()) {
-            if (pkt_time == 0 && pkt != packets_q.end()) {
+    // Merge packets and the GPS track in time order
+    auto read_rows = [&](std::vector<pcap_row>& rows, size_t max) -> bool {
+        while (rows.size() < max) {
+            bool have_pkt = pkt != packets_q.end();
+            bool have_gps = gps != gps_q.end();
+
+            if (!have_pkt && !have_gps)
+                return false;
+
+            if (have_pkt && pkt_time == 0) {
                 pkt_time = sqlite3_column_as<unsigned long>(*pkt, 0);
                 pkt_time_us = sqlite3_column_as<unsigned long>(*pkt, 1);
             }
 
-            if (!skip_gps_track && gps_time == 0 && gps != gps_q.end()) {
+            if (have_gps && gps_time == 0) {
                 gps_time = sqlite3_column_as<unsigned long>(*gps, 0);
                 gps_time_us = sqlite3_column_as<unsigned long>(*gps, 1);
             }
 
-            if (pkt_time != 0 && (gps_time == 0 || (pkt_time < gps_time || 
-                            ((pkt_time == gps_time && pkt_time_us < gps_time_us))))) {
-                auto ts_sec = sqlite3_column_as<unsigned long>(*pkt, 0);
-                auto ts_usec = sqlite3_column_as<unsigned long>(*pkt, 1);
-                auto pkt_dlt = sqlite3_column_as<unsigned int>(*pkt, 2);
-                auto datasource = sqlite3_column_as<std::string>(*pkt, 3);
-                auto bytes = sqlite3_column_as<std::string>(*pkt, 4);
-                auto lat = sqlite3_column_as<double>(*pkt, 5);
-                auto lon = sqlite3_column_as<double>(*pkt, 6);
-                auto alt = sqlite3_column_as<double>(*pkt, 7);
+            pcap_row row;
 
-                std::string tags;
+            if (have_pkt && (!have_gps || pkt_time < gps_time || 
+                        (pkt_time == gps_time && pkt_time_us < gps_time_us))) {
+                row.gps = false;
+                row.ts_sec = pkt_time;
+                row.ts_usec = pkt_time_us;
+                row.dlt = sqlite3_column_as<unsigned int>(*pkt, 2);
+                row.datasource = sqlite3_column_as<std::string>(*pkt, 3);
+                row.data = sqlite3_column_as<std::string>(*pkt, 4);
+                row.lat = sqlite3_column_as<double>(*pkt, 5);
+                row.lon = sqlite3_column_as<double>(*pkt, 6);
+                row.alt = sqlite3_column_as<double>(*pkt, 7);
 
                 if (db_version >= 6)
-                    tags = sqlite3_column_as<std::string>(*pkt, 8);
-
-                if (!pcapng) {
-                    std::shared_ptr<log_file> log_interface;
+                    row.tags = sqlite3_column_as<std::string>(*pkt, 8);
 
-                    if (split_interface) {
-                        auto log_index = per_interface_logs.find(datasource);
-
-                        if (log_index == per_interface_logs.end()) {
-                            log_interface = std::make_shared<log_file>();
-                            per_interface_logs[datasource] = log_interface;
-                        } else {
-                            log_interface = log_index->second;
-                        }
-
-                    } else {
-                        log_interface = single_log;
-                    }
-
-                    if (log_interface->file == nullptr) {
-                        int file_dlt = dlt;
+                // Advance the packet counter and reset its time
+                ++pkt;
 
-                        if (file_dlt < 0)
-                            file_dlt = pkt_dlt;
+                pkt_time = 0;
+                pkt_time_us = 0;
+            } else {
+                row.gps = true;
+                row.ts_sec = gps_time;
+                row.ts_usec = gps_time_us;
 
-                        auto fname = out_fname;
+                // The track is only written to a single pcapng file
+                if (pcapng && !split_interface)
+                    row.data = sqlite3_column_as<std::string>(*gps, 2);
 
-                        if (split_interface)
-                            fname = fmt::format("{}-{}", fname, datasource);
+                // Advance and reset the gps query
+                ++gps;
 
-                        if (split_packets || split_size) {
-                            fname = fmt::format("{}-{:06}", fname, log_interface->number);
-                            log_interface->number++;
-                        }
+                gps_time = 0;
+                gps_time_us = 0;
+            }
 
-                        if (verbose)
-                            fmt::print(stderr, "* Opening legacy pcap file {}\n", fname);
+            rows.push_back(std::move(row));
+        }
 
-                        log_interface->name = fname;
+        return true;
+    };
 
-                        try {
-                            log_interface->file = open_pcap_file(fname, force, file_dlt);
-                        } catch (const std::runtime_error& e) {
-                            fmt::print(stderr, "ERROR: Couldn't open {} for writing ({})\n",
-                                       log_interface->name, e.what());
-                            break;
-                        }
-                    }
+    auto decode_row = [&](const pcap_row& row, pcap_record& rec) {
+        rec.gps = row.gps;
+        rec.dlt = row.dlt;
+        rec.datasource = row.datasource;
+        rec.packet_sz = row.data.size();
 
-                    write_pcap_packet(log_interface->file, bytes, ts_sec, ts_usec);
-
-                    log_interface->sz += bytes.size();
-                    log_interface->count++;
-
-                    if (split_packets && log_interface->count >= split_packets) {
-                        if (verbose)
-                            fmt::print(stderr, "* Closing pcap file {} after {} packets\n",
-                                    log_interface->name, log_interface->count);
-
-                        fclose(log_interface->file);
-                        log_interface->file = nullptr;
-                        log_interface->count = 0;
-                    } else if (split_size && log_interface->sz >= split_size * 1024) {
-                        if (verbose)
-                            fmt::print(stderr, "* Closing pcap file {} after {}kb\n",
-                                    log_interface->name, log_interface->sz / 1024);
-                        fclose(log_interface->file);
-                        log_interface->file = nullptr;
-                        log_interface->sz = 0;
-                    }
-                } else {
-                    // pcapng
+        if (row.gps) {
+            if (row.data.length() == 0)
+                return;
 
-                    std::shared_ptr<log_file> log_interface;
+            Json::Value json;
+            std::stringstream ss(row.data);
 
-                    if (split_interface) {
-                        auto log_index = per_interface_logs.find(datasource);
+            try {
+                ss >> json;
 
-                        if (log_index == per_interface_logs.end()) {
-                            log_interface = std::make_shared<log_file>();
-                            per_interface_logs[datasource] = log_interface;
-                        } else {
-                            log_interface = log_index->second;
-                        }
+                auto alt = json["kismet.gps.last_location"]["kismet.common.location.alt"].asDouble();
+                auto lat = json["kismet.gps.last_location"]["kismet.common.location.geopoint"][1].asDouble();
+                auto lon = json["kismet.gps.last_location"]["kismet.common.location.geopoint"][0].asDouble();
 
-                    } else {
-                        log_interface = single_log;
-                    }
+                format_pcapng_gps(rec.data, row.ts_sec, row.ts_usec, lat, lon, alt);
+            } catch (const std::exception& e) {
+                fmt::print(stderr, "WARNING: Could not process GPS JSON, skipping ({})\n", e.what());
+            }
 
-                    if (log_interface->file == nullptr) {
-                        int file_dlt = dlt;
+            return;
+        }
 
-                        if (file_dlt < 0)
-                            file_dlt = pkt_dlt;
+        if (!pcapng) {
+            format_pcap_packet(rec.data, row.data, row.ts_sec, row.ts_usec);
+            return;
+        }
 
-                        auto fname = out_fname;
+        if (skip_gps)
+            format_pcapng_packet(rec.data, row.data, row.ts_sec, row.ts_usec, row.tags, 0, 0, 0);
+        else
+            format_pcapng_packet(rec.data, row.data, row.ts_sec, row.ts_usec, row.tags, 
+                    row.lat, row.lon, row.alt);
+    };
 
-                        if (split_interface)
-                            fname = fmt::format("{}-{}", fname, datasource);
+    auto write_record = [&](pcap_record& rec) {
+        if (rec.gps) {
+            if (rec.data.length() == 0)
+                return;
 
-                        if (split_packets || split_size) {
-                            fname = fmt::format("{}-{:06}", fname, log_interface->number);
-                            log_interface->number++;
-                        }
+            if (single_log->file == nullptr) {
+                auto fname = out_fname;
 
-                        if (verbose)
-                            fmt::print(stderr, "* Opening pcapng file {}\n", fname);
+                if (verbose)
+                    fmt::print(stderr, "* Opening pcapng file {}\n", fname);
 
-                        log_interface->name = fname;
+                single_log->name = fname;
+                single_log->file = open_pcapng_file(fname, force);
+            }
 
-                        try {
-                            log_interface->file = open_pcapng_file(fname, force);
-                        } catch (const std::runtime_error& e) {
-                            fmt::print(stderr, "ERROR: Couldn't open {} for writing ({})\n",
-                                       log_interface->name, e.what());
-                            break;
-                        }
-                    }
+            write_record_data(single_log->file, rec.data);
 
-                    auto source_combo = fmt::format("{}-{}", datasource, pkt_dlt);
-                    auto source_key = log_interface->ng_interface_map.find(source_combo);
-                    unsigned int ngindex = 0;
+            return;
+        }
 
-                    if (source_key == log_interface->ng_interface_map.end()) {
-                        std::shared_ptr<db_interface> dbinterface;
+        std::shared_ptr<log_file> log_interface;
 
-                        for (auto dbi : interface_vec) {
-                            if (dbi->uuid == datasource) {
-                                auto desc = fmt::format("Kismet datasource {} ({} - {})",
-                                        dbi->name, dbi->interface, dbi->definition);
-                                ngindex = log_interface->ng_interface_map.size();
+        if (split_interface) {
+            auto log_index = per_interface_logs.find(rec.datasource);
 
-                                log_interface->ng_interface_map[source_combo] = ngindex;
+            if (log_index == per_interface_logs.end()) {
+                log_interface = std::make_shared<log_file>();
+                per_interface_logs[rec.datasource] = log_interface;
+            } else {
+                log_interface = log_index->second;
+            }
 
-                                write_pcapng_interface(log_interface->file, ngindex,
-                                        dbi->interface, pkt_dlt, desc);
+        } else {
+            log_interface = single_log;
+        }
 
-                                break;
-                            }
-                        }
-                    } else {
-                        ngindex = source_key->second;
-                    }
+        if (log_interface->file == nullptr) {
+            int file_dlt = dlt;
 
-                    if (skip_gps) {
-                        lat = 0;
-                        lon = 0;
-                        alt = 0;
-                    }
+            if (file_dlt < 0)
+                file_dlt = rec.dlt;
 
-                    write_pcapng_packet(log_interface->file, bytes, ts_sec, ts_usec, tags, ngindex,
-                            lat, lon, alt);
-
-                    log_interface->sz += bytes.size();
-                    log_interface->count++;
-
-                    if (split_packets && log_interface->count >= split_packets) {
-                        if (verbose)
-                            fmt::print(stderr, "* Closing pcapng file {} after {} packets\n",
-                                    log_interface->name, log_interface->count);
-
-                        fclose(log_interface->file);
-                        log_interface->file = nullptr;
-                        log_interface->count = 0;
-                    } else if (split_size && log_interface->sz >= split_size * 1024) {
-                        if (verbose)
-                            fmt::print(stderr, "* Closing pcap file {} after {}kb\n",
-                                    log_interface->name, log_interface->sz / 1024);
-                        fclose(log_interface->file);
-                        log_interface->file = nullptr;
-                        log_interface->sz = 0;
-                    }
-                }
+            auto fname = out_fname;
 
-                // Advance the packet counter and reset its time
-                ++pkt;
+            if (split_interface)
+                fname = fmt::format("{}-{}", fname, rec.datasource);
 
-                pkt_time = 0;
-                pkt_time_us = 0;
-            } else if (gps_time != 0) {
-                auto ts_sec = sqlite3_column_as<unsigned long>(*gps, 0);
-                auto ts_usec = sqlite3_column_as<unsigned long>(*gps, 1);
+            if (split_packets || split_size) {
+                fname = fmt::format("{}-{:06}", fname, log_interface->number);
+                log_interface->number++;
+            }
 
-                if (pcapng && !split_interface) {
-                    Json::Value json;
-                    std::stringstream ss(sqlite3_column_as<std::string>(*gps, 2));
+            if (verbose)
+                fmt::print(stderr, "* Opening {} file {}\n", pcapng ? "pcapng" : "legacy pcap", fname);
 
-                    try {
-                        ss >> json;
+            log_interface->name = fname;
 
-                        auto alt = json["kismet.gps.last_location"]["kismet.common.location.alt"].asDouble();
-                        auto lat = json["kismet.gps.last_location"]["kismet.common.location.geopoint"][1].asDouble();
-                        auto lon = json["kismet.gps.last_location"]["kismet.common.location.geopoint"][0].asDouble();
+            if (pcapng)
+                log_interface->file = open_pcapng_file(fname, force);
+            else
+                log_interface->file = open_pcap_file(fname, force, file_dlt);
+        }
 
-                        try {
-                            if (single_log->file == nullptr) {
-                                auto fname = out_fname;
+        if (pcapng) {
+            auto source_combo = fmt::format("{}-{}", rec.datasource, rec.dlt);
+            auto source_key = log_interface->ng_interface_map.find(source_combo);
+            uint32_t ngindex = 0;
 
-                                if (verbose)
-                                    fmt::print(stderr, "* Opening pcapng file {}\n", fname);
+            if (source_key == log_interface->ng_interface_map.end()) {
+                for (auto dbi : interface_vec) {
+                    if (dbi->uuid == rec.datasource) {
+                        auto desc = fmt::format("Kismet datasource {} ({} - {})",
+                                dbi->name, dbi->interface, dbi->definition);
+                        ngindex = log_interface->ng_interface_map.size();
 
-                                single_log->name = fname;
-                                single_log->file = open_pcapng_file(fname, force);
-                            }
-                        } catch (const std::runtime_error& e) {
-                            fmt::print(stderr, "ERROR: Couldn't open {} for writing ({})\n",
-                                       single_log->name, e.what());
-                            break;
-                        }
+                        log_interface->ng_interface_map[source_combo] = ngindex;
 
-                        write_pcapng_gps(single_log->file, ts_sec, ts_usec, lat, lon, alt);
+                        write_pcapng_interface(log_interface->file, ngindex,
+                                dbi->interface, rec.dlt, desc);
 
-                    } catch (const std::exception& e) {
-                        fmt::print(stderr, "WARNING: Could not process GPS JSON, skipping ({})\n", e.what());
+                        break;
                     }
                 }
-
-                // Advance and reset the gps query
-                ++gps;
-
-                gps_time = 0;
-                gps_time_us = 0;
+            } else {
+                ngindex = source_key->second;
             }
 
+            memcpy(&rec.data[PCAPNG_EPB_INTERFACE_OFFSET], &ngindex, sizeof(uint32_t));
         }
+
+        write_record_data(log_interface->file, rec.data);
+
+        log_interface->sz += rec.packet_sz;
+        log_interface->count++;
+
+        if (split_packets && log_interface->count >= split_packets) {
+            if (verbose)
+                fmt::print(stderr, "* Closing pcap file {} after {} packets\n",
+                        log_interface->name, log_interface->count);
+
+            fclose(log_interface->file);
+            log_interface->file = nullptr;
+            log_interface->count = 0;
+        } else if (split_size && log_interface->sz >= split_size * 1024) {
+            if (verbose)
+                fmt::print(stderr, "* Closing pcap file {} after {}kb\n",
+                        log_interface->name, log_interface->sz / 1024);
+            fclose(log_interface->file);
+            log_interface->file = nullptr;
+            log_interface->sz = 0;
+        }
+    };
+
+    try {
+        kismetdb_pipeline<pcap_row, pcap_record> pipeline(n_threads, 1024,
+                read_rows, decode_row, write_record);
+
+        pipeline.run();
     } catch (const std::exception& e) {
         fmt::print(stderr, "*ERROR: Failed to extract and write packets: {}\n", e.what());
         exit(0);
@@ -24,9 +24,13 @@
 #include "config.h"
 
 #include <map>
+#include <memory>
+#include <mutex>
 #include <iomanip>
 #include <ctime>
 #include <iostream>
+#include <sstream>
+#include <thread>
 #include <tuple>
 
 #include <string.h>
@@ -44,6 +48,8 @@
 #include "json/json.h"
 #include "sqlite3_cpp11.h"
 #include "fmt.h"
+#include "kismetdb_pipeline.h"
+#include "kismetdb_segments.h"
 #include "packet_ieee80211.h"
 #include "version.h"
 
@@ -165,6 +171,43 @@ std::string WifiCryptToString(unsigned long cryptset) {
     return "";
 }
 
+// Packet or Bluetooth data record, as read from the log
+struct wigle_row {
+    bool bt;
+    uint64_t ts;
+    std::string sourcemac;
+    std::string phy;
+    double lat;
+    double lon;
+    double alt;
+    int signal;
+    double frequency;
+};
+
+// Cached device record; devices which are unknown, or are not exported, are invalid
+struct wigle_device {
+    wigle_device() :
+        valid{false},
+        filtered{false} { }
+
+    bool valid;
+    std::string first_time;
+    std::string name;
+    std::string crypto;
+    std::string type;
+    bool filtered;
+};
+
+struct wigle_record {
+    wigle_record() :
+        row{nullptr},
+        excluded{false} { }
+
+    const wigle_row *row;
+    bool excluded;
+    std::shared_ptr<wigle_device> device;
+};
+
 void print_help(char *argv) {
     printf("Kismetdb to WigleCSV\n");
     printf("A simple tool for converting the packet data from a KismetDB log file to\n"
@@ -180,10 +223,21 @@ void print_help(char *argv) {
            " -s, --skip-clean             Don't clean (sql vacuum) input database\n"
            " -e, --exclude lat,lon,dist   Exclude records within 'dist' *meters* of the lat,lon\n"
            "                              provided.  This can be used to exclude packets close to\n"
-           "                              your home, or other sensitive locations.\n");
+           "                              your home, or other sensitive locations.\n"
+           "     --start-time [unix time] Only export records seen at or after this time\n"
+           "     --end-time [unix time]   Only export records seen before this time\n"
+           "     --device [mac]           Only export records of this MAC address.  Multiple device\n"
+           "                              arguments can be given to include multiple devices.\n"
+           "     --threads [num]          Resolve devices on [num] threads while reading and writing\n"
+           "                              in parallel; 0 processes the log in a single thread.\n"
+           "                              Defaults to the number of CPUs.\n");
 }
 
 int main(int argc, char *argv[]) {
+#define OPT_THREADS             1
+#define OPT_START_TIME          2
+#define OPT_END_TIME            3
+#define OPT_FILTER_DEVICE       4
     static struct option longopt[] = {
         { "in", required_argument, 0, 'i' },
         { "out", required_argument, 0, 'o' },
@@ -195,6 +249,10 @@ int main(int argc, char *argv[]) {
         { "cache-limit", required_argument, 0, 'c'},
         { "exclude", required_argument, 0, 'e'},
         { "filter", required_argument, 0, 'F' },
+        { "threads", required_argument, 0, OPT_THREADS },
+        { "start-time", required_argument, 0, OPT_START_TIME },
+        { "end-time", required_argument, 0, OPT_END_TIME },
+        { "device", required_argument, 0, OPT_FILTER_DEVICE },
         { 0, 0, 0, 0 }
     };
 
@@ -269,6 +327,11 @@ int main(int argc, char *argv[]) {
     unsigned int rate_limit = 1;
     unsigned int cache_limit = 1000;
 
+    std::vector<std::string> device_filter_vec;
+    unsigned long start_time = 0;
+    unsigned long end_time = 0;
+    unsigned int n_threads = std::thread::hardware_concurrency();
+
     while (1) {
         int r = getopt_long(argc, argv, 
                             "-hi:o:r:c:e:vfsF:", 
@@ -321,6 +384,23 @@ int main(int argc, char *argv[]) {
                 fmt::print(stderr, "ERROR:  Could not process regex: {}", e.what());
                 exit(1);
             }
+        } else if (r == OPT_THREADS) {
+            if (sscanf(optarg, "%u", &n_threads) != 1) {
+                fmt::print(stderr, "ERROR:  Expected --threads [number]\n");
+                exit(1);
+            }
+        } else if (r == OPT_START_TIME) {
+            if (sscanf(optarg, "%lu", &start_time) != 1) {
+                fmt::print(stderr, "ERROR:  Expected --start-time [unix time]\n");
+                exit(1);
+            }
+        } else if (r == OPT_END_TIME) {
+            if (sscanf(optarg, "%lu", &end_time) != 1) {
+                fmt::print(stderr, "ERROR:  Expected --end-time [unix time]\n");
+                exit(1);
+            }
+        } else if (r == OPT_FILTER_DEVICE) {
+            device_filter_vec.push_back(std::string(optarg));
         }
     }
 
@@ -378,6 +458,9 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // Read every segment of a rotated log as one log
+    kismetdb_attach_segments(db, in_fname, verbose);
+
     // Use our sql adapters
 
     using namespace kissqlite3;
@@ -449,412 +532,398 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    // Define a simple cache; we don't need to use a proper kismet macaddr here, just operate
-    // on it as a string
-    class cache_obj {
-    public:
-        cache_obj(std::string t, std::string s, std::string c) :
-            first_time{t},
-            name{s},
-            crypto{c},
-            last_time_sec{0},
-            type{""},
-            filtered{false} { }
-
-        cache_obj(std::string t, std::string s, std::string c, std::string type) :
-            first_time{t},
-            name{s},
-            crypto{c},
-            last_time_sec{0},
-            type{type},
-            filtered{false} { }
-
-        void filter(bool f) {
-            filtered = f;
-        }
-
-        std::string first_time;
-        std::string name;
-        std::string crypto;
-        uint64_t last_time_sec;
-        std::string type;
-        bool filtered;
-    };
-
-    std::map<std::string, std::shared_ptr<cache_obj>> device_cache_map;
-
-    if (verbose) 
-        fmt::print(stderr, "* Starting to process file, max device cache {}\n", cache_limit);
-
-    // CSV headers
-    fmt::print(ofile, "WigleWifi-1.4,appRelease=Kismet{0}{1}{2},model=Kismet,release={0}.{1}.{2}.{3},"
-            "device=kismet,display=kismet,board=kismet,brand=kismet\n", 
-            VERSION_MAJOR, VERSION_MINOR, VERSION_TINY, db_version);
-    fmt::print(ofile, "MAC,SSID,AuthMode,FirstSeen,Channel,RSSI,CurrentLatitude,CurrentLongitude,"
-            "AltitudeMeters,AccuracyMeters,Type\n");
-
-    // Prep the packet list for different kismetdb versions
-    std::list<std::string> packet_fields;
-
-    if (db_version < 5) {
-        packet_fields = std::list<std::string>{"ts_sec", "sourcemac", "phyname", "lat", "lon", 
-            "signal", "frequency"};
-    } else {
-        packet_fields = std::list<std::string>{"ts_sec", "sourcemac", "phyname", "lat", "lon", 
-            "signal", "frequency", "alt", "speed"};
-    }
+    // Device records are resolved on the worker threads, each with its own connection
+    // to the log, and cached; we don't need to use a proper kismet macaddr here, just
+    // operate on it as a string
+    std::mutex device_cache_mutex;
+    std::map<std::string, std::shared_ptr<wigle_device>> device_cache_map;
 
-    std::list<std::string> bt_fields;
-    switch (db_version) {
-        case 1:
-        case 2:
-        case 3:
-        case 4:
-            bt_fields = std::list<std::string>{"ts_sec", "devmac", "phyname", "lat", "lon"};
-            break;
-        default:
-            bt_fields = std::list<std::string>{"ts_sec", "devmac", "phyname", "lat", "lon", "alt"};
-            break;
-    }
+    std::mutex db_pool_mutex;
+    std::vector<sqlite3 *> db_pool;
 
-    auto query = _SELECT(db, "packets", packet_fields,
-            _WHERE("sourcemac", NEQ, "00:00:00:00:00:00", 
-                AND, 
-                "lat", NEQ, 0,
-                AND,
-                "lon", NEQ, 0));
+    auto fetch_device = [&](const wigle_row& row) -> std::shared_ptr<wigle_device> {
+        auto key = fmt::format("{}/{}", row.phy, row.sourcemac);
 
-    auto bt_query = _SELECT(db, "data", bt_fields,
-            _WHERE("lat", NEQ, 0, AND, "lon", NEQ, 0));
-    bt_query.append_where(AND, _WHERE("phyname", EQ, "Bluetooth", OR, "phyname", EQ, "BTLE"));
+        {
+            std::lock_guard<std::mutex> lk(device_cache_mutex);
 
-    unsigned long n_logs = 0;
-    unsigned long n_saved = 0;
-    unsigned long n_discarded_logs_rate = 0;
-    unsigned long n_discarded_logs_zones = 0;
-    unsigned long n_division = (n_packets_db / 20);
-
-    if (n_division <= 0)
-        n_division = 1;
-
-    for (auto p : query) {
-        // Brute-force cache maintenance; if we're full at the start of the 
-        // processing loop, nuke the ENTIRE cache and rebuild it; this is
-        // cleaner than constantly re-sorting it.
-        if (device_cache_map.size() >= cache_limit) {
-            if (verbose)
-                fmt::print(stderr, "* Cleaning cache...\n");
-
-            device_cache_map.clear();
+            auto ci = device_cache_map.find(key);
+            if (ci != device_cache_map.end())
+                return ci->second;
         }
 
-        n_logs++;
-        if (n_logs % n_division == 0 && verbose)
-            std::cerr << 
-                fmt::format("* {}%% processed {} records, {} discarded from rate limiting, {} discarded from exclusion zones, {} cached",
-                    (int) (((float) n_logs / (float) n_packets_db) * 100) + 1, 
-                    n_logs, n_discarded_logs_rate, n_discarded_logs_zones, device_cache_map.size()) << std::endl;
-
-        auto ts = sqlite3_column_as<std::uint64_t>(p, 0);
-        auto sourcemac = sqlite3_column_as<std::string>(p, 1);
-        auto phy = sqlite3_column_as<std::string>(p, 2);
+        sqlite3 *dev_db = nullptr;
 
-        auto lat = 0.0f, lon = 0.0f, alt = 0.0f;
+        {
+            std::lock_guard<std::mutex> lk(db_pool_mutex);
 
-        auto signal = sqlite3_column_as<int>(p, 5);
-        auto channel = sqlite3_column_as<double>(p, 6);
+            if (db_pool.size() != 0) {
+                dev_db = db_pool.back();
+                db_pool.pop_back();
+            }
+        }
 
-        auto crypt = std::string{""};
+        if (dev_db == nullptr) {
+            if (sqlite3_open_v2(in_fname.c_str(), &dev_db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+                auto err = fmt::format("Unable to open '{}': {}", in_fname, sqlite3_errmsg(dev_db));
+                sqlite3_close(dev_db);
+                throw std::runtime_error(err);
+            }
 
-        // Handle the different versions
-        if (db_version < 5) {
-            lat = sqlite3_column_as<double>(p, 3) / 100000;
-            lon = sqlite3_column_as<double>(p, 4) / 100000;
-        } else {
-            lat = sqlite3_column_as<double>(p, 3);
-            lon = sqlite3_column_as<double>(p, 4);
-            alt = sqlite3_column_as<double>(p, 7);
+            kismetdb_attach_segments(dev_db, in_fname, false);
         }
 
-        auto ci = device_cache_map.find(sourcemac);
-        std::shared_ptr<cache_obj> cached;
+        auto device = std::make_shared<wigle_device>();
+        std::string dev_json;
+        bool found = false;
 
-        if (ci != device_cache_map.end()) {
-            cached = ci->second;
-        } else {
-            auto dev_query = _SELECT(db, "devices", {"device"},
-                    _WHERE("devmac", EQ, sourcemac,
+        {
+            auto dev_query = _SELECT(dev_db, "devices", {"device"},
+                    _WHERE("devmac", EQ, row.sourcemac,
                         AND,
-                        "phyname", EQ, phy));
+                        "phyname", EQ, row.phy));
 
             auto dev = dev_query.begin();
 
-            if (dev == dev_query.end()) {
-                // printf("Could not find device record for %s\n", sqlite3_column_as<std::string>(p, 0).c_str());
-                continue;
-            }
-
-            // Check to see if we lie in any exclusion zones
-            bool violates_exclusion = false;
-            for (auto ez : exclusion_zones) {
-                if (distance_meters(lat, lon, std::get<0>(ez), std::get<1>(ez)) <= std::get<2>(ez)) {
-                    violates_exclusion = true;
-                    break;
-                }
+            if (dev != dev_query.end()) {
+                dev_json = sqlite3_column_as<std::string>(*dev, 0);
+                found = true;
             }
+        }
 
-            if (violates_exclusion) {
-                n_discarded_logs_zones++;
-                continue;
-            }
+        {
+            std::lock_guard<std::mutex> lk(db_pool_mutex);
+            db_pool.push_back(dev_db);
+        }
 
+        if (found) {
             Json::Value json;
-            std::stringstream ss(sqlite3_column_as<std::string>(*dev, 0));
+            std::stringstream ss(dev_json);
 
             try {
                 ss >> json;
 
                 auto timestamp = json["kismet.device.base.first_time"].asUInt64();
-                auto name = std::string{""};
-                auto crypt = std::string{""};
                 auto type = json["kismet.device.base.type"].asString();
 
-                if (phy == "IEEE802.11") {
-                    if (type != "Wi-Fi AP")
-                        continue;
+                if (row.bt) {
+                    device->name = MungeForCSV(json["kismet.device.base.commonname"].asString());
 
-                    if (json["dot11.device"]["dot11.device.last_beaconed_ssid"].isString()) {
-                        name = MungeForCSV(json["dot11.device"]["dot11.device.last_beaconed_ssid"].asString());
-                    } else if (!json["dot11.device"]["dot11.device.last_beaconed_ssid_record"].isNull()) {
-                        name = MungeForCSV(json["dot11.device"]["dot11.device.last_beaconed_ssid_record"]["dot11.advertisedssid.ssid"].asString());
-                    } else {
-                        name = "";
-                    }
-                    if (json["dot11.device"]["dot11.device.last_beaconed_ssid"].isString()) {
-                        name = MungeForCSV(json["dot11.device"]["dot11.device.last_beaconed_ssid"].asString());
-                    } else if (json["dot11.device"]["dot11.device.last_beaconed_ssid_record"]["dot11.advertisedssid.ssid"].isString()) {
-                        name = MungeForCSV(json["dot11.device"]["dot11.device.last_beaconed_ssid_record"]["dot11.advertisedssid.ssid"].asString());
-                    } else {
-                        name = "";
-                    }
+                    if (device->name == row.sourcemac)
+                        device->name = "";
 
-                    // Handle the aliased ssid_record for modern info
-                    if (!json["dot11.device"]["dot11.device.last_beaconed_ssid_record"].isNull()) {
-                        crypt = WifiCryptToString(json["dot11.device"]["dot11.device.last_beaconed_ssid_record"]["dot11.advertisedssid.crypt_set"].asUInt64());
+                    if (type == "BTLE") {
+                        device->crypto = "Misc [LE]";
+                        device->type = "BLE";
                     } else {
-                        auto last_ssid_key = 
-                            json["dot11.device"]["dot11.device.last_beaconed_ssid_checksum"].asUInt64();
-                        std::stringstream ss;
-
-                        ss << last_ssid_key;
+                        device->crypto = "Misc [BT]";
+                        device->type = "BT";
+                    }
 
-                        crypt = WifiCryptToString(json["dot11.device"]["dot11.device.advertised_ssid_map"][ss.str()]["dot11.advertisedssid.crypt_set"].asUInt64());
+                    device->valid = true;
+                } else if (row.phy != "IEEE802.11" || type == "Wi-Fi AP") {
+                    if (row.phy == "IEEE802.11") {
+                        if (json["dot11.device"]["dot11.device.last_beaconed_ssid"].isString()) {
+                            device->name = MungeForCSV(json["dot11.device"]["dot11.device.last_beaconed_ssid"].asString());
+                        } else if (json["dot11.device"]["dot11.device.last_beaconed_ssid_record"]["dot11.advertisedssid.ssid"].isString()) {
+                            device->name = MungeForCSV(json["dot11.device"]["dot11.device.last_beaconed_ssid_record"]["dot11.advertisedssid.ssid"].asString());
+                        }
+
+                        // Handle the aliased ssid_record for modern info
+                        if (!json["dot11.device"]["dot11.device.last_beaconed_ssid_record"].isNull()) {
+                            device->crypto = WifiCryptToString(json["dot11.device"]["dot11.device.last_beaconed_ssid_record"]["dot11.advertisedssid.crypt_set"].asUInt64());
+                        } else {
+                            auto last_ssid_key = 
+                                json["dot11.device"]["dot11.device.last_beaconed_ssid_checksum"].asUInt64();
+                            std::stringstream ks;
+
+                            ks << last_ssid_key;
+
+                            device->crypto = WifiCryptToString(json["dot11.device"]["dot11.device.advertised_ssid_map"][ks.str()]["dot11.advertisedssid.crypt_set"].asUInt64());
+                        }
+
+                        device->crypto += "[ESS]";
                     }
 
-                    crypt += "[ESS]";
+                    device->type = "WIFI";
+                    device->valid = true;
 
+#ifdef HAVE_LIBPCRE
+                    for (const auto& i : pcre_list) {
+                        if (i->match(device->name))
+                            device->filtered = true;
+                    }
+#endif
                 }
 
                 std::time_t timet(timestamp);
                 std::tm tm;
-                std::stringstream ts;
 
                 gmtime_r(&timet, &tm);
 
                 char tmstr[256];
                 strftime(tmstr, 255, "%Y-%m-%d %H:%M:%S", &tm);
-                ts << tmstr;
-
-                // because apparently gcc4 is still a thing?
-                // ts << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-
-                cached = std::make_shared<cache_obj>(ts.str(), name, crypt);
-
-                device_cache_map[sourcemac] = cached;
-
-#ifdef HAVE_LIBPCRE
-                for (const auto& i : pcre_list) {
-                    if (i->match(name))
-                        cached->filter(true);
-                }
-#endif
-
+                device->first_time = tmstr;
             } catch (const std::exception& e) {
                 std::cerr << 
-                    fmt::format("WARNING:  Could not process device info for {}/{}, skipping", sourcemac, phy) << std::endl;
+                    fmt::format("WARNING:  Could not process device info for {}/{}, skipping", 
+                            row.sourcemac, row.phy) << std::endl;
+                device->valid = false;
             }
         }
 
-        if (cached == nullptr)
-            continue;
+        std::lock_guard<std::mutex> lk(device_cache_mutex);
 
-        if (cached->filtered)
-            continue;
+        // Brute-force cache maintenance; if we're full, nuke the ENTIRE cache and 
+        // rebuild it; this is cleaner than constantly re-sorting it.
+        if (device_cache_map.size() >= cache_limit) {
+            if (verbose)
+                fmt::print(stderr, "* Cleaning cache...\n");
 
-        // Rate throttle
-        if (rate_limit != 0 && cached->last_time_sec != 0) {
-            if (cached->last_time_sec + rate_limit < ts) {
-                n_discarded_logs_rate++;
-                continue;
-            }
-        } 
-        cached->last_time_sec = ts;
+            device_cache_map.clear();
+        }
 
-        if (phy == "IEEE802.11")
-            channel = FrequencyToWifiChannel(channel);
+        device_cache_map[key] = device;
 
-        // printf("MAC,SSID,AuthMode,FirstSeen,Channel,RSSI,CurrentLatitude,CurrentLongitude,AltitudeMeters,AccuracyMeters,Type\n");
+        return device;
+    };
 
-        fmt::print(ofile, "{},{},{},{},{},{},{:3.10f},{:3.10f},{:f},0,{}\n",
-                sourcemac,
-                cached->name,
-                cached->crypto,
-                cached->first_time,
-                (int) channel,
-                signal,
-                lat, lon, alt,
-                "WIFI");
+    auto decode_row = [&](const wigle_row& row, wigle_record& rec) {
+        rec.row = &row;
 
-        n_saved++;
-    }
+        // Check to see if we lie in any exclusion zones
+        for (auto ez : exclusion_zones) {
+            if (distance_meters(row.lat, row.lon, std::get<0>(ez), std::get<1>(ez)) <= std::get<2>(ez)) {
+                rec.excluded = true;
+                return;
+            }
+        }
 
-    // Clear the cache before bluetooth processing
-    device_cache_map.clear();
+        rec.device = fetch_device(row);
+    };
 
-    for (auto p : bt_query) {
-        // Brute-force cache maintenance; if we're full at the start of the 
-        // processing loop, nuke the ENTIRE cache and rebuild it; this is
-        // cleaner than constantly re-sorting it.
-        if (device_cache_map.size() >= cache_limit) {
-            if (verbose)
-                fmt::print(stderr, "* Cleaning cache...\n");
+    unsigned long n_logs = 0;
+    unsigned long n_saved = 0;
+    unsigned long n_discarded_logs_rate = 0;
+    unsigned long n_discarded_logs_zones = 0;
+    unsigned long n_division = (n_packets_db / 20);
 
-            device_cache_map.clear();
-        }
+    if (n_division <= 0)
+        n_division = 1;
+
+    // Last record written per device, for rate limiting
+    std::map<std::string, uint64_t> last_time_map;
 
+    auto write_record = [&](wigle_record& rec) {
         n_logs++;
         if (n_logs % n_division == 0 && verbose)
             std::cerr << 
                 fmt::format("* {}%% processed {} records, {} discarded from rate limiting, {} discarded from exclusion zones, {} cached",
                     (int) (((float) n_logs / (float) n_packets_db) * 100) + 1, 
-                    n_logs, n_discarded_logs_rate, n_discarded_logs_zones, device_cache_map.size()) << std::endl;
+                    n_logs, n_discarded_logs_rate, n_discarded_logs_zones, last_time_map.size()) << std::endl;
+
+        if (rec.excluded) {
+            n_discarded_logs_zones++;
+            return;
+        }
+
+        if (rec.device == nullptr || !rec.device->valid || rec.device->filtered)
+            return;
 
-        auto ts = sqlite3_column_as<std::uint64_t>(p, 0);
-        auto sourcemac = sqlite3_column_as<std::string>(p, 1);
-        auto phy = sqlite3_column_as<std::string>(p, 2);
+        const auto& row = *rec.row;
 
-        auto lat = 0.0f, lon = 0.0f, alt = 0.0f;
+        if (last_time_map.size() >= cache_limit)
+            last_time_map.clear();
 
-        if (db_version < 5) {
-            lat = sqlite3_column_as<double>(p, 3) / 100000;
-            lon = sqlite3_column_as<double>(p, 4) / 100000;
+        auto& last_time_sec = last_time_map[row.sourcemac];
+
+        // Rate throttle
+        if (rate_limit != 0 && last_time_sec != 0) {
+            if (last_time_sec + rate_limit < row.ts) {
+                n_discarded_logs_rate++;
+                return;
+            }
+        } 
+        last_time_sec = row.ts;
+
+        if (row.bt) {
+            fmt::print(ofile, "{},{},{},{},{},{},{:3.10f},{:3.10f},{:f},0,{}\n",
+                    row.sourcemac,
+                    rec.device->name,
+                    rec.device->crypto,
+                    rec.device->first_time,
+                    0, // channel always 0
+                    0, // currently no bt signal in kismet
+                    row.lat, row.lon, row.alt,
+                    rec.device->type);
         } else {
-            lat = sqlite3_column_as<double>(p, 3);
-            lon = sqlite3_column_as<double>(p, 4);
-            alt = sqlite3_column_as<double>(p, 7);
+            auto channel = row.frequency;
+
+            if (row.phy == "IEEE802.11")
+                channel = FrequencyToWifiChannel(channel);
+
+            fmt::print(ofile, "{},{},{},{},{},{},{:3.10f},{:3.10f},{:f},0,{}\n",
+                    row.sourcemac,
+                    rec.device->name,
+                    rec.device->crypto,
+                    rec.device->first_time,
+                    (int) channel,
+                    row.signal,
+                    row.lat, row.lon, row.alt,
+                    rec.device->type);
         }
 
-        auto ci = device_cache_map.find(sourcemac);
-        std::shared_ptr<cache_obj> cached;
+        n_saved++;
+    };
 
-        if (ci != device_cache_map.end()) {
-            cached = ci->second;
-        } else {
-            auto dev_query = _SELECT(db, "devices", {"device"},
-                    _WHERE("devmac", EQ, sourcemac,
-                        AND,
-                        "phyname", EQ, phy));
+    if (verbose) 
+        fmt::print(stderr, "* Starting to process file, max device cache {}\n", cache_limit);
 
-            auto dev = dev_query.begin();
+    // CSV headers
+    fmt::print(ofile, "WigleWifi-1.4,appRelease=Kismet{0}{1}{2},model=Kismet,release={0}.{1}.{2}.{3},"
+            "device=kismet,display=kismet,board=kismet,brand=kismet\n", 
+            VERSION_MAJOR, VERSION_MINOR, VERSION_TINY, db_version);
+    fmt::print(ofile, "MAC,SSID,AuthMode,FirstSeen,Channel,RSSI,CurrentLatitude,CurrentLongitude,"
+            "AltitudeMeters,AccuracyMeters,Type\n");
 
-            if (dev == dev_query.end()) {
-                // printf("Could not find device record for %s\n", sqlite3_column_as<std::string>(p, 0).c_str());
-                continue;
-            }
+    // Prep the packet list for different kismetdb versions
+    std::list<std::string> packet_fields;
 
-            // Check to see if we lie in any exclusion zones
-            bool violates_exclusion = false;
-            for (auto ez : exclusion_zones) {
-                if (distance_meters(lat, lon, std::get<0>(ez), std::get<1>(ez)) <= std::get<2>(ez)) {
-                    violates_exclusion = true;
-                    break;
-                }
-            }
+    if (db_version < 5) {
+        packet_fields = std::list<std::string>{"ts_sec", "sourcemac", "phyname", "lat", "lon", 
+            "signal", "frequency"};
+    } else {
+        packet_fields = std::list<std::string>{"ts_sec", "sourcemac", "phyname", "lat", "lon", 
+            "signal", "frequency", "alt", "speed"};
+    }
 
-            if (violates_exclusion) {
-                n_discarded_logs_zones++;
-                continue;
-            }
+    std::list<std::string> bt_fields;
+    switch (db_version) {
+        case 1:
+        case 2:
+        case 3:
+        case 4:
+            bt_fields = std::list<std::string>{"ts_sec", "devmac", "phyname", "lat", "lon"};
+            break;
+        default:
+            bt_fields = std::list<std::string>{"ts_sec", "devmac", "phyname", "lat", "lon", "alt"};
+            break;
+    }
 
-            Json::Value json;
-            std::stringstream ss(sqlite3_column_as<std::string>(*dev, 0));
+    auto query = _SELECT(db, "packets", packet_fields,
+            _WHERE("sourcemac", NEQ, "00:00:00:00:00:00", 
+                AND, 
+                "lat", NEQ, 0,
+                AND,
+                "lon", NEQ, 0));
 
-            try {
-                ss >> json;
+    auto bt_query = _SELECT(db, "data", bt_fields,
+            _WHERE("lat", NEQ, 0, AND, "lon", NEQ, 0));
+    bt_query.append_where(AND, _WHERE("phyname", EQ, "Bluetooth", OR, "phyname", EQ, "BTLE"));
 
-                auto timestamp = json["kismet.device.base.first_time"].asUInt64();
-                auto type = json["kismet.device.base.type"].asString();
-                auto name = MungeForCSV(json["kismet.device.base.commonname"].asString());
+    // Time and device filters are applied by the query, so filtered records are never
+    // read out of the log
+    if (start_time != 0) {
+        query.append_where(AND, _WHERE("ts_sec", GE, start_time));
+        bt_query.append_where(AND, _WHERE("ts_sec", GE, start_time));
+    }
 
-                if (name == sourcemac)
-                    name = "";
+    if (end_time != 0) {
+        query.append_where(AND, _WHERE("ts_sec", LT, end_time));
+        bt_query.append_where(AND, _WHERE("ts_sec", LT, end_time));
+    }
 
-                std::time_t timet(timestamp);
-                std::tm tm;
-                std::stringstream ts;
-                auto crypt = std::string{""};
-                auto mod_type = std::string("");
+    if (device_filter_vec.size() != 0) {
+        auto device_clause = _WHERE();
+        auto bt_device_clause = _WHERE();
 
-                gmtime_r(&timet, &tm);
+        for (const auto& d : device_filter_vec) {
+            device_clause = _WHERE(device_clause, OR, "sourcemac", LIKE, d);
+            bt_device_clause = _WHERE(bt_device_clause, OR, "devmac", LIKE, d);
+        }
 
-                char tmstr[256];
-                strftime(tmstr, 255, "%Y-%m-%d %H:%M:%S", &tm);
-                ts << tmstr;
-
-                if (type == "BTLE") {
-                    crypt = "Misc [LE]";
-                    mod_type = "BLE";
-                } else {
-                    crypt = "Misc [BT]";
-                    mod_type = "BT";
-                }
+        query.append_where(AND, device_clause);
+        bt_query.append_where(AND, bt_device_clause);
+    }
 
-                cached = std::make_shared<cache_obj>(ts.str(), name, crypt, mod_type);
+    auto pkt = query.begin();
 
-                device_cache_map[sourcemac] = cached;
+    auto read_packets = [&](std::vector<wigle_row>& rows, size_t max) -> bool {
+        for (; rows.size() < max && pkt != query.end(); ++pkt) {
+            wigle_row row;
 
-            } catch (const std::exception& e) {
-                std::cerr << 
-                    fmt::format("WARNING:  Could not process device info for {}/{}, skipping", sourcemac, phy) << std::endl;
+            row.bt = false;
+            row.ts = sqlite3_column_as<std::uint64_t>(*pkt, 0);
+            row.sourcemac = sqlite3_column_as<std::string>(*pkt, 1);
+            row.phy = sqlite3_column_as<std::string>(*pkt, 2);
+            row.signal = sqlite3_column_as<int>(*pkt, 5);
+            row.frequency = sqlite3_column_as<double>(*pkt, 6);
+
+            // Handle the different versions
+            if (db_version < 5) {
+                row.lat = sqlite3_column_as<double>(*pkt, 3) / 100000;
+                row.lon = sqlite3_column_as<double>(*pkt, 4) / 100000;
+                row.alt = 0;
+            } else {
+                row.lat = sqlite3_column_as<double>(*pkt, 3);
+                row.lon = sqlite3_column_as<double>(*pkt, 4);
+                row.alt = sqlite3_column_as<double>(*pkt, 7);
             }
+
+            rows.push_back(std::move(row));
         }
 
-        if (cached == nullptr)
-            continue;
+        return pkt != query.end();
+    };
 
-        // Rate throttle
-        if (rate_limit != 0 && cached->last_time_sec != 0) {
-            if (cached->last_time_sec + rate_limit < ts) {
-                n_discarded_logs_rate++;
-                continue;
+    auto bt = bt_query.begin();
+
+    auto read_bt = [&](std::vector<wigle_row>& rows, size_t max) -> bool {
+        for (; rows.size() < max && bt != bt_query.end(); ++bt) {
+            wigle_row row;
+
+            row.bt = true;
+            row.ts = sqlite3_column_as<std::uint64_t>(*bt, 0);
+            row.sourcemac = sqlite3_column_as<std::string>(*bt, 1);
+            row.phy = sqlite3_column_as<std::string>(*bt, 2);
+            row.signal = 0;
+            row.frequency = 0;
+
+            if (db_version < 5) {
+                row.lat = sqlite3_column_as<double>(*bt, 3) / 100000;
+                row.lon = sqlite3_column_as<double>(*bt, 4) / 100000;
+                row.alt = 0;
+            } else {
+                row.lat = sqlite3_column_as<double>(*bt, 3);
+                row.lon = sqlite3_column_as<double>(*bt, 4);
+                row.alt = sqlite3_column_as<double>(*bt, 5);
             }
-        } 
 
-        cached->last_time_sec = ts;
+            rows.push_back(std::move(row));
+        }
 
-        fmt::print(ofile, "{},{},{},{},{},{},{:3.10f},{:3.10f},{:f},0,{}\n",
-                sourcemac,
-                cached->name,
-                cached->crypto,
-                cached->first_time,
-                0, // channel always 0
-                0, // currently no bt signal in kismet
-                lat, lon, alt,
-                cached->type);
+        return bt != bt_query.end();
+    };
 
-        n_saved++;
+    try {
+        kismetdb_pipeline<wigle_row, wigle_record> pipeline(n_threads, 1024,
+                read_packets, decode_row, write_record);
+        pipeline.run();
+
+        // Clear the cache before bluetooth processing
+        device_cache_map.clear();
+        last_time_map.clear();
+
+        kismetdb_pipeline<wigle_row, wigle_record> bt_pipeline(n_threads, 1024,
+                read_bt, decode_row, write_record);
+        bt_pipeline.run();
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "ERROR:  Failed to process log: {}\n", e.what());
+        exit(1);
     }
 
+    for (auto d : db_pool)
+        sqlite3_close(d);
 
     if (ofile != stdout) {
         fclose(ofile);
@@ -0,0 +1,55 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include "mac_filter_table.h"
+
+void mac_filter_table::add(const mac_addr& in_mac, bool in_value) {
+    unsigned int bits = in_mac.maskbits > 64 ? 64 : in_mac.maskbits;
+
+    auto li = levels.begin();
+
+    while (li != levels.end() && li->bits > bits)
+        ++li;
+
+    if (li == levels.end() || li->bits != bits) {
+        prefix_level l;
+        l.bits = bits;
+        l.mask = prefix_mask(bits);
+        li = levels.insert(li, l);
+    }
+
+    li->entries[in_mac.longmac & li->mask] = in_value;
+}
+
+void mac_filter_table::remove(const mac_addr& in_mac) {
+    unsigned int bits = in_mac.maskbits > 64 ? 64 : in_mac.maskbits;
+
+    for (auto li = levels.begin(); li != levels.end(); ++li) {
+        if (li->bits != bits)
+            continue;
+
+        li->entries.erase(in_mac.longmac & li->mask);
+
+        if (li->entries.size() == 0)
+            levels.erase(li);
+
+        return;
+    }
+}
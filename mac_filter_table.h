@@ -0,0 +1,96 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __MAC_FILTER_TABLE_H__
+#define __MAC_FILTER_TABLE_H__
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "macaddr.h"
+
+// Compiled MAC filter lookup table
+//
+// A filter entry is a MAC address with an optional mask; an unmasked address matches
+// only itself, and a masked address (such as an OUI) matches every address sharing
+// the prefix.  The table keeps one hash table of prefixes per mask length in use, and
+// a lookup probes them from the longest mask down, so the most specific entry wins
+// and a lookup costs one probe per distinct mask length, however many entries the
+// list holds.
+//
+// Entries are keyed by both the prefix and the mask length, so an OUI entry and an
+// address inside that OUI are kept apart; an ordered map of mac_addr treats them as
+// the same key, since masked addresses compare equal to everything they match.
+//
+// Filters keep a working table which is edited, and copy it into a new table which
+// lookups use whenever the entries change, so lookups never need a lock.
+
+class mac_filter_table {
+public:
+    mac_filter_table() { }
+
+    // Add or replace an entry
+    void add(const mac_addr& in_mac, bool in_value);
+
+    // Remove an entry with the same address and mask
+    void remove(const mac_addr& in_mac);
+
+    bool empty() const {
+        return levels.size() == 0;
+    }
+
+    // Find the most specific entry matching an address
+    bool match(const mac_addr& in_mac, bool& ret_value) const {
+        for (const auto& l : levels) {
+            auto i = l.entries.find(in_mac.longmac & l.mask);
+
+            if (i != l.entries.end()) {
+                ret_value = i->second;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+protected:
+    static uint64_t prefix_mask(unsigned int bits) {
+        if (bits == 0)
+            return 0;
+
+        if (bits >= 64)
+            return (uint64_t) -1;
+
+        return ((uint64_t) -1) << (64 - bits);
+    }
+
+    struct prefix_level {
+        unsigned int bits;
+        uint64_t mask;
+        std::unordered_map<uint64_t, bool> entries;
+    };
+
+    // Longest mask first
+    std::vector<prefix_level> levels;
+};
+
+#endif
@@ -108,20 +108,70 @@ struct mac_addr {
         state.len = len - 1;
     }
 
+    // Value of a hex digit, or -1, and the upper case hex digits of every byte value
+    static const int8_t hex_values[256];
+    static const char hex_pairs[513];
+
+    // Longest formatted address, 8 octets with separators
+    static const size_t max_chars = MAC_LEN_MAX * 3 - 1;
+
+    // Parse one or two hex digits, returning the number of digits consumed
+    static unsigned int parse_hex_byte(const char *in, const char *end, unsigned int& ret_byte) {
+        if (in >= end || hex_values[(uint8_t) in[0]] < 0)
+            return 0;
+
+        ret_byte = hex_values[(uint8_t) in[0]];
+
+        if (in + 1 < end && hex_values[(uint8_t) in[1]] >= 0) {
+            ret_byte = (ret_byte << 4) | hex_values[(uint8_t) in[1]];
+            return 2;
+        }
+
+        return 1;
+    }
+
     void string2long(const char *in) {
+        string2long(in, strlen(in));
+    }
+
+    void string2long(const char *in, size_t in_len) {
         state.len = 5;
         state.error = 0;
 
         longmac = 0;
         auto longmask = (uint64_t) -1;
 
-        short unsigned int byte;
+        const char *end = in + in_len;
+
+        unsigned int byte;
 
         int nbyte = 0;
         int mode = 0;
         int len = 0;
 
-        while (*in) {
+        // Common case of a full XX:XX:XX:XX:XX:XX address
+        if (in_len == 17) {
+            uint64_t v = 0;
+            bool ok = true;
+
+            for (unsigned int x = 0; x < 6 && ok; x++) {
+                auto h = hex_values[(uint8_t) in[x * 3]];
+                auto l = hex_values[(uint8_t) in[x * 3 + 1]];
+
+                ok = h >= 0 && l >= 0 && (x == 5 || in[x * 3 + 2] == ':');
+
+                if (ok)
+                    v = (v << 8) | (uint64_t) ((h << 4) | l);
+            }
+
+            if (ok) {
+                longmac = v << 16;
+                maskbits = 64;
+                return;
+            }
+        }
+
+        while (in < end) {
             if (in[0] == ':') {
                 in++;
                 continue;
@@ -135,15 +185,14 @@ struct mac_addr {
                 continue;
             }
 
-            if (sscanf(in, "%2hX", &byte) != 1) {
+            auto digits = parse_hex_byte(in, end, byte);
+
+            if (digits == 0) {
                 state.error = true;
                 break;
             }
 
-            if (strlen(in) >= 2)
-                in += 2;
-            else
-                in++;
+            in += digits;
 
             if (nbyte >= MAC_LEN_MAX) {
                 state.error = true;
@@ -185,7 +234,7 @@ struct mac_addr {
     }
 
     mac_addr(const std::string& in) {
-        string2long(in.c_str());
+        string2long(in.data(), in.length());
     }
 
     constexpr mac_addr(int in __attribute__((unused)))  :
@@ -239,32 +288,35 @@ struct mac_addr {
     // Convert a string to a positional search fragment, places fragment
     // in ret_term and length of fragment in ret_len
     inline static bool prepare_search_term(const std::string& s, uint64_t &ret_term, unsigned int &ret_len) {
-        short unsigned int byte;
+        unsigned int byte;
         int nbyte = 0;
-        const char *in = s.c_str();
+        const char *in = s.data();
+        const char *end = in + s.length();
 
         uint64_t temp_long = 0LL;
 
         ret_term = 0LL;
 
         // Parse the same way as we parse a string into a mac, count the number 
-        // of bytes we found
-        while (*in) {
+        // of bytes we found; a trailing single digit is not a byte
+        while (in < end) {
             if (in[0] == ':') {
                 in++;
                 continue;
             }
 
-            if (sscanf(in, "%2hX", &byte) != 1) {
+            auto digits = parse_hex_byte(in, end, byte);
+
+            if (digits == 0) {
                 ret_len = 0;
                 return false;
             }
 
-            if (strlen(in) >= 2)
-                in += 2;
-            else
+            if (digits < 2)
                 break;
 
+            in += digits;
+
             if (nbyte >= MAC_LEN_MAX) {
                 ret_len = 0;
                 return false;
@@ -386,83 +438,38 @@ struct mac_addr {
         return mac_to_string();
     }
 
-    inline std::string mac_to_string() const {
-        switch (state.len) {
-            case 0:
-                return fmt::format("{:02X}", 
-                        index64(longmac, 0));
-            case 1:
-                return fmt::format("{:02X}:{:02X}",
-                        index64(longmac, 0), index64(longmac, 1));
-            case 2:
-                return fmt::format("{:02X}:{:02X}:{:02X}",
-                        index64(longmac, 0), index64(longmac, 1), index64(longmac, 2));
-            case 3:
-                return fmt::format("{:02X}:{:02X}:{:02X}:{:02X}",
-                        index64(longmac, 0), index64(longmac, 1), index64(longmac, 2),
-                        index64(longmac, 3));
-            case 4:
-                return fmt::format("{:02X}:{:02X}:{:02X}:{:02X}:{:02X}",
-                        index64(longmac, 0), index64(longmac, 1), index64(longmac, 2),
-                        index64(longmac, 3), index64(longmac, 4));
-            case 5:
-                return fmt::format("{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}",
-                        index64(longmac, 0), index64(longmac, 1), index64(longmac, 2),
-                        index64(longmac, 3), index64(longmac, 4), index64(longmac, 5));
-            case 6:
-                return fmt::format("{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}",
-                        index64(longmac, 0), index64(longmac, 1), index64(longmac, 2),
-                        index64(longmac, 3), index64(longmac, 4), index64(longmac, 5),
-                        index64(longmac, 6));
-            case 7:
-            default:
-                return fmt::format("{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}",
-                        index64(longmac, 0), index64(longmac, 1), index64(longmac, 2),
-                        index64(longmac, 3), index64(longmac, 4), index64(longmac, 5),
-                        index64(longmac, 6), index64(longmac, 7));
+    // Format the address into a buffer of at least max_chars, without a terminating
+    // null, returning the end of the formatted address
+    char *to_chars(char *out) const {
+        return format_octets(out, longmac, state.len + 1);
+    }
 
+    char *mask_to_chars(char *out) const {
+        return format_octets(out, bits_to_mask(maskbits), state.len + 1);
+    }
 
-        }
+    inline std::string mac_to_string() const {
+        char buf[max_chars];
+        return std::string(buf, to_chars(buf) - buf);
     }
 
     inline std::string mac_mask_to_string() const {
-        auto longmask = bits_to_mask(maskbits);
-        switch (state.len) {
-            case 0:
-                return fmt::format("{:02X}", 
-                        index64(longmask, 0));
-            case 1:
-                return fmt::format("{:02X}:{:02X}",
-                        index64(longmask, 0), index64(longmask, 1));
-            case 2:
-                return fmt::format("{:02X}:{:02X}:{:02X}",
-                        index64(longmask, 0), index64(longmask, 1), index64(longmask, 2));
-            case 3:
-                return fmt::format("{:02X}:{:02X}:{:02X}:{:02X}",
-                        index64(longmask, 0), index64(longmask, 1), index64(longmask, 2),
-                        index64(longmask, 3));
-            case 4:
-                return fmt::format("{:02X}:{:02X}:{:02X}:{:02X}:{:02X}",
-                        index64(longmask, 0), index64(longmask, 1), index64(longmask, 2),
-                        index64(longmask, 3), index64(longmask, 4));
-            case 5:
-                return fmt::format("{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}",
-                        index64(longmask, 0), index64(longmask, 1), index64(longmask, 2),
-                        index64(longmask, 3), index64(longmask, 4), index64(longmask, 5));
-            case 6:
-                return fmt::format("{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}",
-                        index64(longmask, 0), index64(longmask, 1), index64(longmask, 2),
-                        index64(longmask, 3), index64(longmask, 4), index64(longmask, 5),
-                        index64(longmask, 6));
-            case 7:
-            default:
-                return fmt::format("{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}",
-                        index64(longmask, 0), index64(longmask, 1), index64(longmask, 2),
-                        index64(longmask, 3), index64(longmask, 4), index64(longmask, 5),
-                        index64(longmask, 6), index64(longmask, 7));
+        char buf[max_chars];
+        return std::string(buf, mask_to_chars(buf) - buf);
+    }
 
+    static char *format_octets(char *out, uint64_t in_val, unsigned int in_len) {
+        for (unsigned int x = 0; x < in_len; x++) {
+            auto b = (uint8_t) (in_val >> ((MAC_LEN_MAX - x - 1) * 8));
 
+            if (x != 0)
+                *out++ = ':';
+
+            memcpy(out, &hex_pairs[b * 2], 2);
+            out += 2;
         }
+
+        return out;
     }
 
     constexpr17 uint64_t get_as_long() const {
@@ -470,7 +477,11 @@ struct mac_addr {
     }
 
     inline std::string mac_full_to_string() const {
-        return fmt::format("{}/{}", mac_to_string(), mac_mask_to_string());
+        char buf[max_chars * 2 + 1];
+        auto e = to_chars(buf);
+        *e++ = '/';
+        e = mask_to_chars(e);
+        return std::string(buf, e - buf);
     }
 
     friend std::ostream& operator<<(std::ostream& os, const mac_addr& m);
@@ -19,13 +19,30 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "configfile.h"
+#include "endian_magic.h"
 #include "entrytracker.h"
+#include "kis_startup_graph.h"
 #include "messagebus.h"
 #include "util.h"
 #include "manuf.h"
 
-kis_manuf::kis_manuf() {
+kis_manuf::kis_manuf() :
+    ouidb_map{nullptr},
+    ouidb_map_sz{0},
+    ouidb_count{0},
+    ouidb_ouis{nullptr},
+    ouidb_names{nullptr},
+    ouidb_name_table{nullptr},
+    ouidb_names_len{0},
+    index_complete{false},
+    zmfile{nullptr} {
+
     auto entrytracker = Globalreg::fetch_mandatory_global_as<entry_tracker>();
 
     manuf_id = 
@@ -64,13 +81,23 @@ kis_manuf::kis_manuf() {
             md.oui = oui;
             md.manuf = std::make_shared<tracker_element_string>(manuf_id);
             md.manuf->set(m_pair[1]);
-            oui_map[oui] = md;
+            config_map[oui] = md;
         } else {
             _MSG_ERROR("Expected 'manuf=AA:BB:CC,Name' for a config file manuf record.");
             continue;
         }
     }
 
+    // Prefer the prebuilt table, and fall back to indexing the text file
+    for (auto f : Globalreg::globalreg->kismet_config->fetch_opt_vec("ouidb")) {
+        auto expanded = Globalreg::globalreg->kismet_config->expand_log_path(f, "", "", 0, 1);
+
+        if (open_ouidb(expanded)) {
+            _MSG_INFO("Opened OUI table '{}', {} manufacturers", expanded, ouidb_count);
+            return;
+        }
+    }
+
     auto fname = Globalreg::globalreg->kismet_config->fetch_opt_vec("ouifile");
     if (fname.size() == 0) {
         _MSG("Missing 'ouifile' option in config, will not resolve manufacturer "
@@ -95,7 +122,125 @@ kis_manuf::kis_manuf() {
         return;
     }
 
-    IndexOUI();
+    kis_startup_graph::add("manuf index", {}, [this]() { IndexOUI(); });
+}
+
+kis_manuf::~kis_manuf() {
+    if (ouidb_map != nullptr)
+        munmap(ouidb_map, ouidb_map_sz);
+
+    if (zmfile != nullptr)
+        gzclose(zmfile);
+}
+
+bool kis_manuf::open_ouidb(const std::string& in_fname) {
+    int fd = open(in_fname.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        _MSG_INFO("Could not open OUI table '{}': {}", in_fname, kis_strerror_r(errno));
+        return false;
+    }
+
+    struct stat sb;
+
+    if (fstat(fd, &sb) < 0 || sb.st_size < (off_t) sizeof(kis_ouidb_header)) {
+        _MSG_ERROR("Invalid OUI table '{}', file too short", in_fname);
+        close(fd);
+        return false;
+    }
+
+    auto map = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping holds its own reference to the file
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        _MSG_ERROR("Could not map OUI table '{}': {}", in_fname, kis_strerror_r(errno));
+        return false;
+    }
+
+    auto hdr = static_cast<const kis_ouidb_header *>(map);
+    auto count = kis_letoh32(hdr->count);
+    auto names_len = kis_letoh32(hdr->names_len);
+
+    if (kis_letoh32(hdr->magic) != KIS_OUIDB_MAGIC || 
+            kis_letoh32(hdr->version) != KIS_OUIDB_VERSION ||
+            sizeof(kis_ouidb_header) + ((uint64_t) count * 8) + names_len != (uint64_t) sb.st_size ||
+            names_len == 0) {
+        _MSG_ERROR("Invalid OUI table '{}', unknown version or invalid size; regenerate it "
+                "with tools/create_oui_db.py", in_fname);
+        munmap(map, sb.st_size);
+        return false;
+    }
+
+    auto name_table = static_cast<const char *>(map) + sizeof(kis_ouidb_header) + (count * 8);
+
+    // Every name must be terminated within the table
+    if (name_table[names_len - 1] != 0) {
+        _MSG_ERROR("Invalid OUI table '{}', unterminated name table", in_fname);
+        munmap(map, sb.st_size);
+        return false;
+    }
+
+    ouidb_map = map;
+    ouidb_map_sz = sb.st_size;
+    ouidb_count = count;
+    ouidb_ouis = reinterpret_cast<const uint32_t *>(static_cast<const char *>(map) + 
+            sizeof(kis_ouidb_header));
+    ouidb_names = ouidb_ouis + count;
+    ouidb_name_table = name_table;
+    ouidb_names_len = names_len;
+
+    ouidb_manufs.reset(new std::shared_ptr<tracker_element_string>[count]);
+
+    return true;
+}
+
+ssize_t kis_manuf::search_ouidb(uint32_t in_oui) const {
+    if (ouidb_count == 0)
+        return -1;
+
+    // Branch-free lower bound; the comparison compiles to a conditional move, so the 
+    // search takes the same log2(count) steps for every OUI
+    const uint32_t *base = ouidb_ouis;
+    size_t n = ouidb_count;
+
+    while (n > 1) {
+        size_t half = n / 2;
+        base = (kis_letoh32(base[half]) <= in_oui) ? base + half : base;
+        n -= half;
+    }
+
+    if (kis_letoh32(*base) != in_oui)
+        return -1;
+
+    return base - ouidb_ouis;
+}
+
+std::shared_ptr<tracker_element_string> kis_manuf::lookup_ouidb(uint32_t in_oui) {
+    auto pos = search_ouidb(in_oui);
+
+    if (pos < 0)
+        return unknown_manuf;
+
+    auto manuf = std::atomic_load(&ouidb_manufs[pos]);
+
+    if (manuf != nullptr)
+        return manuf;
+
+    auto offt = kis_letoh32(ouidb_names[pos]);
+
+    if (offt >= ouidb_names_len)
+        return unknown_manuf;
+
+    auto created = std::make_shared<tracker_element_string>(manuf_id);
+    created->set(munge_to_printable(std::string(ouidb_name_table + offt)));
+
+    // Another thread may have created the record first; everyone uses the first one
+    if (std::atomic_compare_exchange_strong(&ouidb_manufs[pos], &manuf, created))
+        return created;
+
+    return manuf;
 }
 
 void kis_manuf::IndexOUI() {
@@ -157,96 +302,12 @@ void kis_manuf::IndexOUI() {
 
     _MSG("Completed indexing manufacturer db, " + int_to_string(line) + " lines " +
          int_to_string(index_vec.size()) + " indexes", MSGFLAG_INFO);
+
+    index_complete = true;
 }
 
 std::shared_ptr<tracker_element_string> kis_manuf::lookup_oui(mac_addr in_mac) {
-    uint32_t soui = in_mac.OUI(), toui;
-    int matched = -1;
-    char buf[1024];
-    short int m[3];
-
-    if (zmfile == nullptr)
-        return unknown_manuf;
-
-    {
-        kis_lock_guard<kis_mutex> lk(mutex);
-
-        // Use the cache first
-        if (oui_map.find(soui) != oui_map.end()) {
-            return oui_map[soui].manuf;
-        }
-
-        for (unsigned int x = 0; x < index_vec.size(); x++) {
-            if (soui > index_vec[x].oui) {
-                matched = x;
-                continue;
-            }
-
-            break;
-        }
-
-        // Cache unknown to save us effort in the future
-        if (matched < 0) {
-            manuf_data md;
-            md.oui = soui;
-            md.manuf = unknown_manuf;
-            oui_map[soui] = md;
-
-            return md.manuf;
-        }
-
-        // Jump backwards one index in the matching unless we're in the first block
-        if (matched > 0)
-            matched -= 1;
-    }
-
-    {
-        kis_lock_guard<kis_mutex> lk(mutex);
-
-        gzseek(zmfile, index_vec[matched].pos, SEEK_SET);
-
-        while (!gzeof(zmfile)) {
-            if (gzgets(zmfile, buf, 1024) == nullptr || gzeof(zmfile))
-                break;
-
-            if (strlen(buf) < 10)
-                continue;
-
-            // Trim \n
-            auto mlen = strlen(buf + 9) - 1;
-
-            if (mlen == 0)
-                continue;
-
-
-            if (sscanf(buf, "%hx:%hx:%hx\t", &(m[0]), &(m[1]), &(m[2])) == 3) {
-
-                // Log a position at the previous pos - which is the line before
-                // this one, so we're inclusive
-                toui = mac_addr::OUI(m);
-
-                if (toui == soui) {
-                    manuf_data md;
-                    md.oui = soui;
-
-                    md.manuf = std::make_shared<tracker_element_string>(manuf_id);
-                    md.manuf->set(munge_to_printable(std::string(buf + 9, mlen)));
-                    oui_map[soui] = md;
-                    return md.manuf;
-                }
-
-                if (toui > soui) {
-                    manuf_data md;
-                    md.oui = soui;
-                    md.manuf = unknown_manuf;
-                    oui_map[soui] = md;
-                    return md.manuf;
-                }
-            }
-        }
-    }
-
-    return unknown_manuf;
+    return lookup_oui(in_mac.OUI());
 }
 
 std::shared_ptr<tracker_element_string> kis_manuf::lookup_oui(uint32_t in_oui) {
@@ -255,7 +316,17 @@ std::shared_ptr<tracker_element_string> kis_manuf::lookup_oui(uint32_t in_oui) {
     char buf[1024];
     short int m[3];
 
-    if (zmfile == nullptr)
+    if (config_map.size() != 0) {
+        auto ci = config_map.find(soui);
+
+        if (ci != config_map.end())
+            return ci->second.manuf;
+    }
+
+    if (ouidb_map != nullptr)
+        return lookup_ouidb(soui);
+
+    if (zmfile == nullptr || !index_complete)
         return unknown_manuf;
 
     {
@@ -34,6 +34,8 @@
 
 #include <zlib.h>
 
+#include <atomic>
+#include <memory>
 #include <string>
 
 #include "globalregistry.h"
@@ -41,9 +43,30 @@
 #include "trackedelement.h"
 #include "util.h"
 
+// Prebuilt OUI table, generated by tools/create_oui_db.py --binary.  All values are
+// little-endian:
+//
+//   header                 magic, version, count, length of the name table
+//   uint32_t ouis[count]   OUIs, sorted
+//   uint32_t names[count]  Offset of each OUI name in the name table
+//   char name_table[]      NUL-terminated names
+//
+// The table is mapped read-only and searched in place, so looking up an OUI takes no
+// lock and loading it costs nothing until it is used.
+#define KIS_OUIDB_MAGIC         0x494F554B
+#define KIS_OUIDB_VERSION       1
+
+struct kis_ouidb_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t names_len;
+};
+
 class kis_manuf {
 public:
     kis_manuf();
+    ~kis_manuf();
 
     void IndexOUI();
 
@@ -69,8 +92,36 @@ public:
     bool is_unknown_manuf(std::shared_ptr<tracker_element_string> in_manuf);
 
 protected:
+    // Map a prebuilt OUI table
+    bool open_ouidb(const std::string& in_fname);
+
+    // Position of an OUI in the prebuilt table, or -1
+    ssize_t search_ouidb(uint32_t in_oui) const;
+
+    std::shared_ptr<tracker_element_string> lookup_ouidb(uint32_t in_oui);
+
+    // Prebuilt table mapping, and the OUI, name offset, and name arrays within it
+    void *ouidb_map;
+    size_t ouidb_map_sz;
+    uint32_t ouidb_count;
+    const uint32_t *ouidb_ouis;
+    const uint32_t *ouidb_names;
+    const char *ouidb_name_table;
+    uint32_t ouidb_names_len;
+
+    // Name records of table entries, created the first time each is looked up and
+    // swapped in atomically
+    std::unique_ptr<std::shared_ptr<tracker_element_string>[]> ouidb_manufs;
+
+    // Manufacturers defined in the config file, which override the OUI files; not
+    // modified after startup
+    robin_hood::unordered_node_map<uint32_t, manuf_data> config_map;
+
     kis_mutex mutex;
 
+    // The text file index is built in the background at startup; until it completes,
+    // OUIs which are only in the text file resolve as unknown and are not cached
+    std::atomic<bool> index_complete;
     std::vector<index_pos> index_vec;
 
     robin_hood::unordered_node_map<uint32_t, manuf_data> oui_map;
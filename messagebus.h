@@ -118,10 +118,15 @@ public:
         return get_timestamp() < comp.get_timestamp();
     }
 
+    // Position in the message backlog
+    uint64_t get_backlog_seq() const { return backlog_seq; }
+    void set_backlog_seq(uint64_t in_seq) { backlog_seq = in_seq; }
+
     void reset() {
         message->reset();
         flags->reset();
         timestamp->reset();
+        backlog_seq = 0;
     }
 
 protected:
@@ -136,6 +141,8 @@ protected:
     std::shared_ptr<tracker_element_string> message;
     std::shared_ptr<tracker_element_int32> flags;
     std::shared_ptr<tracker_element_uint64> timestamp;
+
+    uint64_t backlog_seq{0};
 };
 
 // Minimal stub of a messagebus that just holds the event IDs and passes it all into the eventbus now
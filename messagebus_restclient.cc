@@ -18,11 +18,75 @@
 
 #include "config.h"
 
+#include <algorithm>
+
+#include "configfile.h"
 #include "messagebus.h"
 #include "messagebus_restclient.h"
 
 #include "json_adapter.h"
 
+void message_backlog_ring::push(std::shared_ptr<tracked_message> in_msg) {
+    if (slots.size() == 0)
+        return;
+
+    auto seq = head.fetch_add(1, std::memory_order_acq_rel);
+    in_msg->set_backlog_seq(seq);
+
+    auto& slot = slots[seq % slots.size()];
+
+    // A writer which lapped us may already have filled the slot with a newer message
+    auto cur = std::atomic_load(&slot);
+
+    while (cur == nullptr || cur->get_backlog_seq() < seq) {
+        if (std::atomic_compare_exchange_weak(&slot, &cur, in_msg))
+            break;
+    }
+}
+
+std::shared_ptr<tracker_element_vector> message_backlog_ring::since(uint64_t in_seq,
+        time_t in_ts, int in_id, uint64_t in_end, uint64_t *out_next) const {
+    auto ret = std::make_shared<tracker_element_vector>(in_id);
+
+    auto end = std::min(next_seq(), in_end);
+
+    if (out_next != nullptr)
+        *out_next = end;
+
+    if (slots.size() == 0)
+        return ret;
+
+    uint64_t start = std::max(in_seq, end > slots.size() ? end - slots.size() : 0);
+
+    for (auto seq = end; seq > start; seq--) {
+        auto m = std::atomic_load(&slots[(seq - 1) % slots.size()]);
+
+        // Not written yet; a slower writer is still storing it.  Drop anything newer we
+        // collected and resume from here next time, so the poller can't step past it
+        if (m == nullptr || m->get_backlog_seq() < seq - 1) {
+            ret->clear();
+
+            if (out_next != nullptr)
+                *out_next = seq - 1;
+
+            continue;
+        }
+
+        // Overwritten while we walked; everything older is gone too
+        if (m->get_backlog_seq() > seq - 1)
+            break;
+
+        if (m->get_timestamp() <= in_ts)
+            break;
+
+        ret->push_back(m);
+    }
+
+    std::reverse(ret->begin(), ret->end());
+
+    return ret;
+}
+
 rest_message_client::rest_message_client() :
     lifetime_global() {
 
@@ -38,6 +102,13 @@ rest_message_client::rest_message_client() :
                 tracker_element_factory<tracker_element_uint64>(),
                 "message update timestamp");
 
+    message_cursor_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.messagebus.cursor",
+                tracker_element_factory<tracker_element_uint64>(),
+                "cursor to request the following messages with");
+
+    message_backlog.resize(Globalreg::globalreg->kismet_config->fetch_opt_uint("messagebacklog", 50));
+
     listener_id = 
         eventbus->register_listener(message_bus::event_message(), 
                 [this](std::shared_ptr<eventbus_event> evt) {
@@ -46,13 +117,7 @@ rest_message_client::rest_message_client() :
                 if (msg_k == evt->get_event_content()->end())
                     return;
 
-                auto msg = std::static_pointer_cast<tracked_message>(msg_k->second);
-
-                kis_lock_guard<kis_mutex> lk(msg_mutex, "rest_message_client message_event");
-                message_list.push_back(msg);
-
-                if (message_list.size() > 50)
-                    message_list.pop_front();
+                message_backlog.push(std::static_pointer_cast<tracked_message>(msg_k->second));
                 });
 
     auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
@@ -63,16 +128,36 @@ rest_message_client::rest_message_client() :
                     auto ts_k = con->uri_params().find(":timestamp");
                     auto ts = string_to_n<long>(ts_k->second);
 
-                    kis_lock_guard<kis_mutex> lk(msg_mutex, "/messagebus/last-time/messages");
-                    auto wrapper = std::make_shared<tracker_element_map>();
-                    auto msgvec = std::make_shared<tracker_element_vector>(message_vec_id);
+                    uint64_t cursor;
 
-                    wrapper->insert(msgvec);
+                    auto wrapper = std::make_shared<tracker_element_map>();
+                    wrapper->insert(message_backlog.since(0, ts, message_vec_id, UINT64_MAX, &cursor));
                     wrapper->insert(std::make_shared<tracker_element_uint64>(message_timestamp_id, time(0)));
+                    wrapper->insert(std::make_shared<tracker_element_uint64>(message_cursor_id, cursor));
 
-                    for (auto i : message_list) 
-                        if (ts < i->get_timestamp()) 
-                            msgvec->push_back(i);
+                    return wrapper;
+                }));
+
+    // Poll by sequence rather than time; messages in the same second are never missed
+    // or repeated, and the returned cursor is passed to the next request
+    httpd->register_route("/messagebus/cursor/:cursor/messages", {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) -> std::shared_ptr<tracker_element> {
+                    uint64_t since_seq;
+
+                    try {
+                        since_seq = string_to_n<uint64_t>(con->uri_params().find(":cursor")->second);
+                    } catch (const std::exception& e) {
+                        con->set_status(400);
+                        return nullptr;
+                    }
+
+                    uint64_t cursor;
+
+                    auto wrapper = std::make_shared<tracker_element_map>();
+                    wrapper->insert(message_backlog.since(since_seq, 0, message_vec_id, UINT64_MAX, &cursor));
+                    wrapper->insert(std::make_shared<tracker_element_uint64>(message_timestamp_id, time(0)));
+                    wrapper->insert(std::make_shared<tracker_element_uint64>(message_cursor_id, cursor));
 
                     return wrapper;
                 }));
@@ -80,13 +165,7 @@ rest_message_client::rest_message_client() :
     httpd->register_route("/messagebus/all_messages", {"GET", "POST"}, httpd->RO_ROLE, {},
             std::make_shared<kis_net_web_tracked_endpoint>(
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
-                    kis_lock_guard<kis_mutex> lk(msg_mutex, "/messagebus/all_messages");
-
-                    auto ret = std::make_shared<tracker_element_vector>();
-                    for (auto i : message_list) 
-                        ret->push_back(i);
-
-                    return ret;
+                    return message_backlog.since(0, 0, message_vec_id);
                 }));
 
 }
@@ -95,7 +174,4 @@ rest_message_client::~rest_message_client() {
     eventbus->remove_listener(listener_id);
 
     Globalreg::globalreg->remove_global("REST_MSG_CLIENT");
-
-    message_list.clear();
 }
-
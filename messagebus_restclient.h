@@ -22,6 +22,7 @@
 
 #include "config.h"
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -33,6 +34,37 @@
 #include "trackedcomponent.h"
 #include "kis_net_beast_httpd.h"
 
+// Fixed size ring of the most recent messages, the same as the alert backlog.  Writers
+// claim the next sequence number and store the message in its slot; readers walk back
+// from the newest sequence and stop at a slot which has been overwritten, so polling
+// clients neither copy the backlog nor hold up messages being added.
+class message_backlog_ring {
+public:
+    message_backlog_ring() { }
+
+    // Sized once, before messages arrive
+    void resize(size_t in_size) {
+        slots = std::vector<std::shared_ptr<tracked_message>>(in_size);
+    }
+
+    void push(std::shared_ptr<tracked_message> in_msg);
+
+    // Sequence number the next message will get
+    uint64_t next_seq() const {
+        return head.load(std::memory_order_acquire);
+    }
+
+    // Messages with a sequence number of at least in_seq and below in_end, and newer 
+    // than in_ts, oldest first.  The walk stops short of a slot still being written; 
+    // out_next, if given, gets the sequence to resume from so that message isn't skipped
+    std::shared_ptr<tracker_element_vector> since(uint64_t in_seq, time_t in_ts, int in_id,
+            uint64_t in_end = UINT64_MAX, uint64_t *out_next = nullptr) const;
+
+protected:
+    std::vector<std::shared_ptr<tracked_message>> slots;
+    std::atomic<uint64_t> head{0};
+};
+
 class rest_message_client : public lifetime_global {
 public:
     static std::shared_ptr<rest_message_client> 
@@ -50,15 +82,13 @@ public:
 	virtual ~rest_message_client();
 
 protected:
-    kis_mutex msg_mutex;
-
     std::shared_ptr<event_bus> eventbus;
 
-    std::list<std::shared_ptr<tracked_message> > message_list;
+    message_backlog_ring message_backlog;
 
     unsigned long listener_id;
 
-    int message_vec_id, message_timestamp_id;
+    int message_vec_id, message_timestamp_id, message_cursor_id;
 };
 
 
@@ -0,0 +1,468 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <string.h>
+
+#include "entrytracker.h"
+#include "msgpack_adapter.h"
+
+namespace {
+    // Big-endian fixed width writers
+    void put_be16(std::string& buf, uint16_t v) {
+        buf.push_back((char) (v >> 8));
+        buf.push_back((char) v);
+    }
+
+    void put_be32(std::string& buf, uint32_t v) {
+        buf.push_back((char) (v >> 24));
+        buf.push_back((char) (v >> 16));
+        buf.push_back((char) (v >> 8));
+        buf.push_back((char) v);
+    }
+
+    void put_be64(std::string& buf, uint64_t v) {
+        put_be32(buf, (uint32_t) (v >> 32));
+        put_be32(buf, (uint32_t) v);
+    }
+
+    void pack_nil(std::string& buf) {
+        buf.push_back((char) 0xc0);
+    }
+
+    void pack_uint(std::string& buf, uint64_t v) {
+        if (v < 0x80) {
+            buf.push_back((char) v);
+        } else if (v <= 0xff) {
+            buf.push_back((char) 0xcc);
+            buf.push_back((char) v);
+        } else if (v <= 0xffff) {
+            buf.push_back((char) 0xcd);
+            put_be16(buf, (uint16_t) v);
+        } else if (v <= 0xffffffff) {
+            buf.push_back((char) 0xce);
+            put_be32(buf, (uint32_t) v);
+        } else {
+            buf.push_back((char) 0xcf);
+            put_be64(buf, v);
+        }
+    }
+
+    void pack_int(std::string& buf, int64_t v) {
+        if (v >= 0) {
+            pack_uint(buf, (uint64_t) v);
+        } else if (v >= -32) {
+            buf.push_back((char) v);
+        } else if (v >= INT8_MIN) {
+            buf.push_back((char) 0xd0);
+            buf.push_back((char) v);
+        } else if (v >= INT16_MIN) {
+            buf.push_back((char) 0xd1);
+            put_be16(buf, (uint16_t) v);
+        } else if (v >= INT32_MIN) {
+            buf.push_back((char) 0xd2);
+            put_be32(buf, (uint32_t) v);
+        } else {
+            buf.push_back((char) 0xd3);
+            put_be64(buf, (uint64_t) v);
+        }
+    }
+
+    void pack_float(std::string& buf, float v) {
+        uint32_t u;
+        memcpy(&u, &v, sizeof(u));
+        buf.push_back((char) 0xca);
+        put_be32(buf, u);
+    }
+
+    void pack_double(std::string& buf, double v) {
+        uint64_t u;
+        memcpy(&u, &v, sizeof(u));
+        buf.push_back((char) 0xcb);
+        put_be64(buf, u);
+    }
+
+    void pack_str(std::string& buf, const std::string& s) {
+        auto len = s.length();
+
+        if (len < 32) {
+            buf.push_back((char) (0xa0 | len));
+        } else if (len <= 0xff) {
+            buf.push_back((char) 0xd9);
+            buf.push_back((char) len);
+        } else if (len <= 0xffff) {
+            buf.push_back((char) 0xda);
+            put_be16(buf, (uint16_t) len);
+        } else {
+            buf.push_back((char) 0xdb);
+            put_be32(buf, (uint32_t) len);
+        }
+
+        buf.append(s);
+    }
+
+    void pack_bin(std::string& buf, const std::string& s) {
+        auto len = s.length();
+
+        if (len <= 0xff) {
+            buf.push_back((char) 0xc4);
+            buf.push_back((char) len);
+        } else if (len <= 0xffff) {
+            buf.push_back((char) 0xc5);
+            put_be16(buf, (uint16_t) len);
+        } else {
+            buf.push_back((char) 0xc6);
+            put_be32(buf, (uint32_t) len);
+        }
+
+        buf.append(s);
+    }
+
+    void pack_array_header(std::string& buf, size_t n) {
+        if (n < 16) {
+            buf.push_back((char) (0x90 | n));
+        } else if (n <= 0xffff) {
+            buf.push_back((char) 0xdc);
+            put_be16(buf, (uint16_t) n);
+        } else {
+            buf.push_back((char) 0xdd);
+            put_be32(buf, (uint32_t) n);
+        }
+    }
+
+    void pack_map_header(std::string& buf, size_t n) {
+        if (n < 16) {
+            buf.push_back((char) (0x80 | n));
+        } else if (n <= 0xffff) {
+            buf.push_back((char) 0xde);
+            put_be16(buf, (uint16_t) n);
+        } else {
+            buf.push_back((char) 0xdf);
+            put_be32(buf, (uint32_t) n);
+        }
+    }
+
+    void pack_key(std::string& buf, int k) {
+        pack_int(buf, k);
+    }
+
+    void pack_key(std::string& buf, size_t k) {
+        pack_uint(buf, k);
+    }
+
+    void pack_key(std::string& buf, double k) {
+        pack_double(buf, k);
+    }
+
+    void pack_key(std::string& buf, const std::string& k) {
+        pack_str(buf, k);
+    }
+
+    template<typename K>
+    void pack_key(std::string& buf, const K& k) {
+        // mac, uuid, and device keys are keyed by their string forms
+        pack_str(buf, k.as_string());
+    }
+
+    // Generic object-valued keyed map
+    template<typename M>
+    void pack_keyed_map(std::string& buf, M *m,
+            std::shared_ptr<tracker_element_serializer::rename_map> name_map) {
+        auto as_vector = m->as_vector();
+        auto as_key_vector = m->as_key_vector();
+
+        size_t n = 0;
+        for (const auto& i : *m) {
+            if (i.second != nullptr || as_key_vector)
+                n++;
+        }
+
+        if (as_vector || as_key_vector)
+            pack_array_header(buf, n);
+        else
+            pack_map_header(buf, n);
+
+        for (const auto& i : *m) {
+            if (i.second == nullptr && !as_key_vector)
+                continue;
+
+            if (!as_vector)
+                pack_key(buf, i.first);
+
+            if (!as_key_vector)
+                msgpack_adapter::pack(buf, i.second, name_map);
+        }
+    }
+}
+
+void msgpack_adapter::pack(std::string& buf, shared_tracker_element e,
+        std::shared_ptr<tracker_element_serializer::rename_map> name_map) {
+
+    if (e == nullptr) {
+        pack_nil(buf);
+        return;
+    }
+
+    serializer_scope s(e, name_map);
+
+    // If we're serializing an alias, remap as the aliased element
+    if (e->get_type() == tracker_type::tracker_alias) {
+        e = static_cast<tracker_element_alias *>(e.get())->get();
+
+        if (e == nullptr) {
+            pack_nil(buf);
+            return;
+        }
+    }
+
+    switch (e->get_type()) {
+        case tracker_type::tracker_string:
+            pack_str(buf, static_cast<tracker_element_string *>(e.get())->get());
+            break;
+        case tracker_type::tracker_byte_array:
+            pack_bin(buf, static_cast<tracker_element_byte_array *>(e.get())->get());
+            break;
+        case tracker_type::tracker_int8:
+            pack_int(buf, static_cast<tracker_element_int8 *>(e.get())->get());
+            break;
+        case tracker_type::tracker_uint8:
+            pack_uint(buf, static_cast<tracker_element_uint8 *>(e.get())->get());
+            break;
+        case tracker_type::tracker_int16:
+            pack_int(buf, static_cast<tracker_element_int16 *>(e.get())->get());
+            break;
+        case tracker_type::tracker_uint16:
+            pack_uint(buf, static_cast<tracker_element_uint16 *>(e.get())->get());
+            break;
+        case tracker_type::tracker_int32:
+            pack_int(buf, static_cast<tracker_element_int32 *>(e.get())->get());
+            break;
+        case tracker_type::tracker_uint32:
+            pack_uint(buf, static_cast<tracker_element_uint32 *>(e.get())->get());
+            break;
+        case tracker_type::tracker_int64:
+            pack_int(buf, static_cast<tracker_element_int64 *>(e.get())->get());
+            break;
+        case tracker_type::tracker_uint64:
+            pack_uint(buf, static_cast<tracker_element_uint64 *>(e.get())->get());
+            break;
+        case tracker_type::tracker_float:
+            pack_float(buf, static_cast<tracker_element_float *>(e.get())->get());
+            break;
+        case tracker_type::tracker_double:
+            pack_double(buf, static_cast<tracker_element_double *>(e.get())->get());
+            break;
+        case tracker_type::tracker_mac_addr:
+        case tracker_type::tracker_uuid:
+        case tracker_type::tracker_key:
+        case tracker_type::tracker_ipv4_addr:
+            pack_str(buf, e->as_string());
+            break;
+        case tracker_type::tracker_placeholder_missing:
+            pack_nil(buf);
+            break;
+        case tracker_type::tracker_pair_double:
+            {
+                const auto& p = static_cast<tracker_element_pair_double *>(e.get())->get();
+                pack_array_header(buf, 2);
+                pack_double(buf, std::get<0>(p));
+                pack_double(buf, std::get<1>(p));
+            }
+            break;
+        case tracker_type::tracker_vector:
+            {
+                auto v = static_cast<tracker_element_vector *>(e.get());
+
+                size_t n = 0;
+                for (const auto& i : *v) {
+                    if (i != nullptr)
+                        n++;
+                }
+
+                pack_array_header(buf, n);
+
+                for (const auto& i : *v) {
+                    if (i != nullptr)
+                        pack(buf, i, name_map);
+                }
+            }
+            break;
+        case tracker_type::tracker_vector_double:
+            {
+                auto v = static_cast<tracker_element_vector_double *>(e.get());
+
+                pack_array_header(buf, v->size());
+
+                for (const auto& i : *v)
+                    pack_double(buf, i);
+            }
+            break;
+        case tracker_type::tracker_vector_string:
+            {
+                auto v = static_cast<tracker_element_vector_string *>(e.get());
+
+                pack_array_header(buf, v->size());
+
+                for (const auto& i : *v)
+                    pack_str(buf, i);
+            }
+            break;
+        case tracker_type::tracker_map:
+            {
+                auto m = static_cast<tracker_element_map *>(e.get());
+                auto as_vector = m->as_vector() || m->as_key_vector();
+
+                size_t n = 0;
+                for (const auto& i : *m) {
+                    if (i.second != nullptr)
+                        n++;
+                }
+
+                if (as_vector)
+                    pack_array_header(buf, n);
+                else
+                    pack_map_header(buf, n);
+
+                for (const auto& i : *m) {
+                    if (i.second == nullptr)
+                        continue;
+
+                    if (!as_vector) {
+                        bool named = false;
+
+                        if (name_map != nullptr) {
+                            auto nmi = name_map->find(i.second);
+                            if (nmi != name_map->end() && nmi->second->rename.length() != 0) {
+                                pack_str(buf, nmi->second->rename);
+                                named = true;
+                            }
+                        }
+
+                        if (!named &&
+                                i.second->get_type() == tracker_type::tracker_placeholder_missing) {
+                            const auto& pn =
+                                static_cast<tracker_element_placeholder *>(i.second.get())->get_name();
+                            if (pn.length() != 0) {
+                                pack_str(buf, pn);
+                                named = true;
+                            }
+                        } else if (!named &&
+                                i.second->get_type() == tracker_type::tracker_alias) {
+                            const auto& an =
+                                static_cast<tracker_element_alias *>(i.second.get())->get_alias_name();
+                            if (an.length() != 0) {
+                                pack_str(buf, an);
+                                named = true;
+                            }
+                        }
+
+                        if (!named)
+                            pack_uint(buf, i.first);
+                    }
+
+                    pack(buf, i.second, name_map);
+                }
+            }
+            break;
+        case tracker_type::tracker_int_map:
+            pack_keyed_map(buf, static_cast<tracker_element_int_map *>(e.get()), name_map);
+            break;
+        case tracker_type::tracker_mac_map:
+            pack_keyed_map(buf, static_cast<tracker_element_mac_map *>(e.get()), name_map);
+            break;
+        case tracker_type::tracker_uuid_map:
+            pack_keyed_map(buf, static_cast<tracker_element_uuid_map *>(e.get()), name_map);
+            break;
+        case tracker_type::tracker_string_map:
+            pack_keyed_map(buf, static_cast<tracker_element_string_map *>(e.get()), name_map);
+            break;
+        case tracker_type::tracker_double_map:
+            pack_keyed_map(buf, static_cast<tracker_element_double_map *>(e.get()), name_map);
+            break;
+        case tracker_type::tracker_hashkey_map:
+            pack_keyed_map(buf, static_cast<tracker_element_hashkey_map *>(e.get()), name_map);
+            break;
+        case tracker_type::tracker_key_map:
+            pack_keyed_map(buf, static_cast<tracker_element_device_key_map *>(e.get()), name_map);
+            break;
+        case tracker_type::tracker_double_map_double:
+            {
+                auto m = static_cast<tracker_element_double_map_double *>(e.get());
+                auto as_vector = m->as_vector();
+                auto as_key_vector = m->as_key_vector();
+
+                if (as_vector || as_key_vector)
+                    pack_array_header(buf, m->size());
+                else
+                    pack_map_header(buf, m->size());
+
+                for (const auto& i : *m) {
+                    if (!as_vector)
+                        pack_double(buf, i.first);
+
+                    if (!as_key_vector)
+                        pack_double(buf, i.second);
+                }
+            }
+            break;
+        default:
+            pack_nil(buf);
+            break;
+    }
+}
+
+void msgpack_adapter::pack_dictionary(std::string& buf) {
+    auto fields = Globalreg::globalreg->entrytracker->get_field_names();
+
+    pack_map_header(buf, fields.size());
+
+    for (const auto& f : fields) {
+        pack_uint(buf, f.first);
+        pack_str(buf, f.second);
+    }
+}
+
+int msgpack_adapter::serializer::serialize(shared_tracker_element in_elem, std::ostream &stream,
+        std::shared_ptr<rename_map> name_map) {
+    std::string buf;
+
+    pack(buf, in_elem, name_map);
+    stream.write(buf.data(), buf.length());
+
+    return 0;
+}
+
+int dict_msgpack_adapter::serializer::serialize(shared_tracker_element in_elem, std::ostream &stream,
+        std::shared_ptr<rename_map> name_map) {
+    std::string buf;
+
+    msgpack_adapter::pack_dictionary(buf);
+    msgpack_adapter::pack(buf, in_elem, name_map);
+    stream.write(buf.data(), buf.length());
+
+    return 0;
+}
+
+void dict_msgpack_adapter::serializer::stream_vector_start(std::ostream& stream) {
+    std::string buf;
+
+    msgpack_adapter::pack_dictionary(buf);
+    stream.write(buf.data(), buf.length());
+}
+
@@ -0,0 +1,98 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __MSGPACK_ADAPTER_H__
+#define __MSGPACK_ADAPTER_H__
+
+#include "config.h"
+
+#include <string>
+
+#include "globalregistry.h"
+#include "trackedelement.h"
+
+// Binary msgpack serialization adapter.  Tracked types map directly to msgpack types
+// (integers, float32/float64, str, bin, array, and map), so no number formatting or
+// string escaping is done.
+//
+// Field-keyed maps are keyed by the numeric field id instead of the field name; renamed
+// summary fields, placeholders, and named aliases are keyed by their name string.  Field
+// ids are stable for the lifetime of the server, so clients can resolve them once from
+// the field dictionary.
+//
+// Mac addresses, uuids, and device keys are encoded as their string forms, and missing
+// placeholder fields are encoded as nil.
+namespace msgpack_adapter {
+
+// Append the packed element to the output buffer
+void pack(std::string& buf, shared_tracker_element e,
+        std::shared_ptr<tracker_element_serializer::rename_map> name_map = nullptr);
+
+// Append a map of every registered field id to field name
+void pack_dictionary(std::string& buf);
+
+class serializer : public tracker_element_serializer {
+public:
+    serializer() :
+        tracker_element_serializer() { }
+
+    virtual int serialize(shared_tracker_element in_elem, std::ostream &stream,
+            std::shared_ptr<rename_map> name_map = nullptr) override;
+
+    // Streamed vectors are emitted as a msgpack stream of one object per record, since
+    // the array length is not known in advance
+    virtual void stream_vector_start(std::ostream& stream) override { }
+
+    virtual void stream_vector_item(shared_tracker_element in_elem, std::ostream& stream,
+            std::shared_ptr<rename_map> name_map, bool first) override {
+        if (in_elem == nullptr)
+            return;
+
+        msgpack_adapter::serializer::serialize(in_elem, stream, name_map);
+    }
+
+    virtual void stream_vector_fragment(const std::string& in_item, std::ostream& stream,
+            bool first) override {
+        stream << in_item;
+    }
+
+    virtual void stream_vector_end(std::ostream& stream) override { }
+};
+
+}
+
+// Msgpack with a field dictionary header; the payload is preceded by a map of every
+// registered field id to name, as a separate object in the msgpack stream.  Clients
+// polling at high rates should fetch the dictionary once and use plain msgpack.
+namespace dict_msgpack_adapter {
+
+class serializer : public msgpack_adapter::serializer {
+public:
+    serializer() :
+        msgpack_adapter::serializer() { }
+
+    virtual int serialize(shared_tracker_element in_elem, std::ostream &stream,
+            std::shared_ptr<rename_map> name_map = nullptr) override;
+
+    virtual void stream_vector_start(std::ostream& stream) override;
+};
+
+}
+
+#endif
+
@@ -21,6 +21,9 @@
 
 #include "config.h"
 
+#include <stddef.h>
+#include <stdint.h>
+
 // Very hacky workaround for older distros and compilers that can't support modern
 // constexpr features
 
@@ -36,5 +39,18 @@
 #define constexpr17
 #endif
 
+// 64 bit FNV-1a, evaluated at compile time for string literals where constexpr loops are
+// supported
+constexpr14 inline uint64_t constexpr_fnv1a_64(const char *in, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= static_cast<uint8_t>(in[i]);
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
 #endif
 
@@ -21,15 +21,29 @@
 
 #include <functional>
 #include <memory>
+#include <new>
 #include <stack>
 #include <thread>
 #include <mutex>
+#include <vector>
 
+#include "kis_hugepage_slab.h"
 #include "kis_mutex.h"
 
+// Pooled objects are allocated from the huge page slab, when it is enabled
+template <class T>
+struct pool_object_delete {
+    void operator()(T *ptr) const {
+        ptr->~T();
+        kis_hugepage_slab::release(ptr, sizeof(T));
+    }
+};
+
 template <class T>
 class shared_object_pool {
 private:
+    using object_ptr = std::unique_ptr<T, pool_object_delete<T>>;
+
     struct pool_deleter {
     public:
         explicit pool_deleter(std::weak_ptr<shared_object_pool<T>* > pool, 
@@ -41,14 +55,14 @@ private:
             if (auto pool_ptr = pool_.lock()) {
                 try {
                     reset_(ptr);
-                    (*pool_ptr.get())->add(std::unique_ptr<T>{ptr});
+                    (*pool_ptr.get())->recycle(object_ptr{ptr});
                     return;
                 } catch(...) {
 
                 }
             }
 
-            std::default_delete<T>{}(ptr);
+            pool_object_delete<T>{}(ptr);
         }
 
     private:
@@ -62,37 +76,74 @@ public:
     shared_object_pool() : 
         this_(new shared_object_pool<T>*(this)),
         max_sz{0},
+        thread_cache_sz{0},
         reset_{[](T*) {}} { }
 
     shared_object_pool(size_t maxsz) :
         this_(new shared_object_pool<T>*(this)),
         max_sz{maxsz},
+        thread_cache_sz{0},
         reset_([](T*) {}) { }
 
     virtual ~shared_object_pool() { }
 
     void set_max(size_t sz) {
-        kis_lock_guard<kis_mutex> lg(pool_mutex);
+        kis_lock_guard<kis_fast_mutex> lg(pool_mutex);
         max_sz = sz;
     }
 
+    // Keep up to sz released objects in a per-thread cache which is checked before
+    // the locked pool; the per-thread cache is shared by all pools of the same type.
+    // Must be set before the pool is used.
+    void set_thread_cache(size_t sz) {
+        kis_lock_guard<kis_fast_mutex> lg(pool_mutex);
+        thread_cache_sz = sz;
+    }
+
     void set_reset(std::function<void (T*)> reset) {
-        kis_lock_guard<kis_mutex> lg(pool_mutex);
+        kis_lock_guard<kis_fast_mutex> lg(pool_mutex);
         reset_ = reset;
     }
 
-    void add(std::unique_ptr<T> t) {
-        kis_lock_guard<kis_mutex> lg(pool_mutex);
+    // An object the pool has no room for is destroyed once the pool is unlocked, since
+    // destroying it may release other objects back to this pool
+    void add(object_ptr t) {
+        kis_lock_guard<kis_fast_mutex> lg(pool_mutex);
 
-        if (max_sz == 0 || (max_sz != 0 && size() < max_sz)) {
+        if (max_sz == 0 || pool_.size() < max_sz) {
             pool_.push(std::move(t));
         } 
     }
 
+    // Return a released object to the thread cache if there is room, otherwise the pool
+    void recycle(object_ptr t) {
+        if (thread_cache_sz != 0) {
+            auto& cache = thread_cache();
+
+            if (cache.size() < thread_cache_sz) {
+                cache.push_back(std::move(t));
+                return;
+            }
+        }
+
+        add(std::move(t));
+    }
+
     ptr_type acquire() {
-        kis_lock_guard<kis_mutex> lg(pool_mutex);
+        if (thread_cache_sz != 0) {
+            auto& cache = thread_cache();
+
+            if (!cache.empty()) {
+                ptr_type tmp(cache.back().release(),
+                        pool_deleter{std::weak_ptr<shared_object_pool<T>*>{this_}, reset_});
+                cache.pop_back();
+                return tmp;
+            }
+        }
+
+        kis_lock_guard<kis_fast_mutex> lg(pool_mutex);
         if (pool_.empty()) {
-            return ptr_type(new T(), 
+            return ptr_type(new_object(),
                     pool_deleter{std::weak_ptr<shared_object_pool<T>*>{this_}, reset_});
         } else {
             ptr_type tmp(pool_.top().release(),
@@ -103,20 +154,37 @@ public:
     }
 
     bool empty() {
-        kis_lock_guard<kis_mutex> lg(pool_mutex);
+        kis_lock_guard<kis_fast_mutex> lg(pool_mutex);
         return pool_.empty();
     }
 
     size_t size() {
-        kis_lock_guard<kis_mutex> lg(pool_mutex);
+        kis_lock_guard<kis_fast_mutex> lg(pool_mutex);
         return pool_.size();
     }
 
 private:
+    static T *new_object() {
+        auto m = kis_hugepage_slab::allocate(sizeof(T));
+
+        try {
+            return new (m) T();
+        } catch (...) {
+            kis_hugepage_slab::release(m, sizeof(T));
+            throw;
+        }
+    }
+
+    static std::vector<object_ptr>& thread_cache() {
+        static thread_local std::vector<object_ptr> cache;
+        return cache;
+    }
+
     std::shared_ptr<shared_object_pool<T>* > this_;
-    std::stack<std::unique_ptr<T> > pool_;
-    kis_mutex pool_mutex;
+    std::stack<object_ptr> pool_;
+    kis_fast_mutex pool_mutex;
     size_t max_sz;
+    size_t thread_cache_sz;
     std::function<void (T*)> reset_;
 };
 
@@ -43,18 +43,14 @@ kis_packet::kis_packet() {
     crc_ok = 0;
 	filtered = 0;
     duplicate = 0;
+    sample_weight = 1;
     hash = 0;
 
-    raw_data.reserve(MAX_PACKET_LEN);
     data = nonstd::string_view(raw_data);
 }
 
 kis_packet::~kis_packet() {
-    try {
-        mutex.unlock();
-    } catch (...) {
-        ;
-    }
+
 }
    
 void kis_packet::insert(const unsigned int index, std::shared_ptr<packet_component> data) {
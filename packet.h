@@ -29,6 +29,7 @@
 #endif
 
 #include <algorithm>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <map>
@@ -93,15 +94,24 @@ public:
     // Are we a duplicate?
     int duplicate;
 
+    // Number of frames this packet stands for when data frames are sampled; 0 for a
+    // frame which was only counted, and skips the rest of the chain up to logging
+    unsigned int sample_weight;
+
     // What hash has been calculated, if any?
     uint32_t hash;
 
     // Raw packet data; other packet components refer to this via stringviews
-    // whenever possible to minimize the copy duplication.  It is pre-reserved as a
-    // max packet size block
+    // whenever possible to minimize the copy duplication.  Copied data normally
+    // lives in a size-classed buffer held by data_owner instead.
     std::string raw_data;
     nonstd::string_view data;
 
+    // Optional owner of the memory 'data' refers to, when the packet data was not
+    // copied into raw_data; typically the decoded datasource report the packet came
+    // from.  Released (and recycled to its pool, if any) when the packet is reset.
+    std::shared_ptr<void> data_owner;
+
     // Original length of capture, if truncated
     uint64_t original_len;
 
@@ -124,11 +134,13 @@ public:
         crc_ok = p.crc_ok;
         filtered = p.filtered;
         duplicate = p.duplicate;
+        sample_weight = p.sample_weight;
         original = p.original;
         hash = p.hash;
         process_complete_events = std::move(p.process_complete_events);
         raw_data = std::move(p.raw_data);
         data = std::move(p.data);
+        data_owner = std::move(p.data_owner);
 
         for (int c = 0; c < MAX_PACKET_COMPONENTS; c++)
             content_vec[c] = p.content_vec[c];
@@ -141,14 +153,17 @@ public:
         crc_ok = 0;
         filtered = 0;
         duplicate = 0;
+        sample_weight = 1;
 
         original.reset();
 
         hash = 0;
 
-        // Reset and re-reserve in case we were resized somehow
-        raw_data = "";
-        raw_data.reserve(MAX_PACKET_LEN);
+        // Keep any existing allocation for the next copied packet, but don't
+        // reserve a full frame for packets which reference their data
+        raw_data.clear();
+        data = nonstd::string_view{};
+        data_owner.reset();
 
         process_complete_events.clear();
 
@@ -159,14 +174,35 @@ public:
     }
 
     void set_data(const std::string& sdata) {
-        raw_data = sdata;
-        data = nonstd::string_view{raw_data};
+        set_data(sdata.data(), sdata.length());
     }
 
+    // Copy packet data into a size-classed buffer from the packetchain pools
     template<typename T>
     void set_data(const T* tdata, size_t len) {
-        raw_data = std::string(tdata, len);
-        data = nonstd::string_view{raw_data};
+        static_assert(sizeof(T) == 1, "packet data must be byte-sized");
+
+        if (Globalreg::globalreg->packetchain == nullptr) {
+            data_owner.reset();
+            raw_data = std::string(reinterpret_cast<const char *>(tdata), len);
+            data = nonstd::string_view{raw_data};
+            return;
+        }
+
+        auto buf = Globalreg::globalreg->packetchain->new_packet_buffer(len);
+        memcpy(buf->data(), tdata, len);
+
+        raw_data.clear();
+        data_owner = buf;
+        data = nonstd::string_view{buf->data(), len};
+    }
+
+    // Set the packet data without copying; the view must remain valid as long as
+    // the owner is held
+    void set_data_ref(std::shared_ptr<void> owner, const nonstd::string_view& view) {
+        raw_data.clear();
+        data_owner = owner;
+        data = view;
     }
 
     // Preferred smart pointers
@@ -217,8 +253,8 @@ public:
     // Original packet if we're a duplicate
     std::shared_ptr<kis_packet> original;
 
-    // Packet lock
-    kis_mutex mutex;
+    // Packet lock, held from the dedupe check until the end of logging
+    kis_fast_mutex mutex;
 };
 
 
@@ -113,7 +113,9 @@ bool packet_filter::filterstring_to_bool(const std::string& str) {
 }
 
 packet_filter_mac_addr::packet_filter_mac_addr(const std::string& in_id, const std::string& in_description) :
-    packet_filter(in_id, in_description, "mac_addr") {
+    packet_filter(in_id, in_description, "mac_addr"),
+    compiled_filters{std::make_shared<compiled_filter_map>()},
+    filters_dirty{false} {
 
         register_fields();
         reserve_fields(nullptr);
@@ -185,6 +187,28 @@ void packet_filter_mac_addr::update_phy_map(std::shared_ptr<eventbus_event> evt)
     // Copy the filter-engine code over to the new one
     phy_mac_filter_map[phy->fetch_phy_id()] = unknown_key->second;
     unknown_phy_mac_filter_map.erase(unknown_key);
+
+    compile_filters();
+}
+
+void packet_filter_mac_addr::compile_filters() {
+    auto compiled = std::make_shared<compiled_filter_map>(phy_mac_filter_map);
+
+    filters_dirty = false;
+    std::atomic_store(&compiled_filters, compiled);
+}
+
+std::shared_ptr<packet_filter_mac_addr::compiled_filter_map> packet_filter_mac_addr::fetch_compiled_filters() {
+    // Filters set outside of the REST endpoints, such as from the config file, are
+    // copied once by the first packet after them
+    if (filters_dirty) {
+        kis_lock_guard<kis_mutex> lk(mutex, "packet_filter_mac_addr compile");
+
+        if (filters_dirty)
+            compile_filters();
+    }
+
+    return std::atomic_load(&compiled_filters);
 }
 
 void packet_filter_mac_addr::set_filter(mac_addr in_mac, const std::string& in_phy, 
@@ -254,29 +278,31 @@ void packet_filter_mac_addr::set_filter(mac_addr in_mac, const std::string& in_p
 	// Cache unknown for future lookups
 	if (phy == nullptr) {
         if (in_block == "source")
-            unknown_phy_mac_filter_map[in_phy].filter_source[in_mac] = value;
+            unknown_phy_mac_filter_map[in_phy].filter_source.add(in_mac, value);
         else if (in_block == "destination")
-            unknown_phy_mac_filter_map[in_phy].filter_dest[in_mac] = value;
+            unknown_phy_mac_filter_map[in_phy].filter_dest.add(in_mac, value);
         else if (in_block == "network")
-            unknown_phy_mac_filter_map[in_phy].filter_network[in_mac] = value;
+            unknown_phy_mac_filter_map[in_phy].filter_network.add(in_mac, value);
         else if (in_block == "other")
-            unknown_phy_mac_filter_map[in_phy].filter_other[in_mac] = value;
+            unknown_phy_mac_filter_map[in_phy].filter_other.add(in_mac, value);
         else if (in_block == "any")
-            unknown_phy_mac_filter_map[in_phy].filter_any[in_mac] = value;
+            unknown_phy_mac_filter_map[in_phy].filter_any.add(in_mac, value);
         return;
 	}
 
 	// Set known phy types
     if (in_block == "source")
-        phy_mac_filter_map[phy->fetch_phy_id()].filter_source[in_mac] = value;
+        phy_mac_filter_map[phy->fetch_phy_id()].filter_source.add(in_mac, value);
     else if (in_block == "destination")
-        phy_mac_filter_map[phy->fetch_phy_id()].filter_dest[in_mac] = value;
+        phy_mac_filter_map[phy->fetch_phy_id()].filter_dest.add(in_mac, value);
     else if (in_block == "network")
-        phy_mac_filter_map[phy->fetch_phy_id()].filter_network[in_mac] = value;
+        phy_mac_filter_map[phy->fetch_phy_id()].filter_network.add(in_mac, value);
     else if (in_block == "other")
-        phy_mac_filter_map[phy->fetch_phy_id()].filter_other[in_mac] = value;
+        phy_mac_filter_map[phy->fetch_phy_id()].filter_other.add(in_mac, value);
     else if (in_block == "any")
-        phy_mac_filter_map[phy->fetch_phy_id()].filter_any[in_mac] = value;
+        phy_mac_filter_map[phy->fetch_phy_id()].filter_any.add(in_mac, value);
+
+    filters_dirty = true;
 }
 
 void packet_filter_mac_addr::remove_filter(mac_addr in_mac, const std::string& in_phy, 
@@ -327,73 +353,55 @@ void packet_filter_mac_addr::remove_filter(mac_addr in_mac, const std::string& i
 	// Cache unknown for future lookups
 	if (phy == nullptr) {
         if (in_block == "source") {
-            auto k = unknown_phy_mac_filter_map[in_phy].filter_source.find(in_mac);
-            if (k != unknown_phy_mac_filter_map[in_phy].filter_source.end())
-                unknown_phy_mac_filter_map[in_phy].filter_source.erase(k);
+            unknown_phy_mac_filter_map[in_phy].filter_source.remove(in_mac);
         } else if (in_block == "destination") {
-            auto k = unknown_phy_mac_filter_map[in_phy].filter_dest.find(in_mac);
-            if (k != unknown_phy_mac_filter_map[in_phy].filter_dest.end())
-                unknown_phy_mac_filter_map[in_phy].filter_dest.erase(k);
+            unknown_phy_mac_filter_map[in_phy].filter_dest.remove(in_mac);
         } else if (in_block == "network") {
-            auto k = unknown_phy_mac_filter_map[in_phy].filter_network.find(in_mac);
-            if (k != unknown_phy_mac_filter_map[in_phy].filter_network.end())
-                unknown_phy_mac_filter_map[in_phy].filter_network.erase(k);
+            unknown_phy_mac_filter_map[in_phy].filter_network.remove(in_mac);
         } else if (in_block == "other") {
-            auto k = unknown_phy_mac_filter_map[in_phy].filter_other.find(in_mac);
-            if (k != unknown_phy_mac_filter_map[in_phy].filter_other.end())
-                unknown_phy_mac_filter_map[in_phy].filter_other.erase(k);
+            unknown_phy_mac_filter_map[in_phy].filter_other.remove(in_mac);
         } else if (in_block == "any") {
-            auto k = unknown_phy_mac_filter_map[in_phy].filter_any.find(in_mac);
-            if (k != unknown_phy_mac_filter_map[in_phy].filter_any.end())
-                unknown_phy_mac_filter_map[in_phy].filter_any.erase(k);
+            unknown_phy_mac_filter_map[in_phy].filter_any.remove(in_mac);
         }
         return;
 	}
 
     if (in_block == "source") {
-        auto k = phy_mac_filter_map[phy->fetch_phy_id()].filter_source.find(in_mac);
-        if (k != phy_mac_filter_map[phy->fetch_phy_id()].filter_source.end())
-            phy_mac_filter_map[phy->fetch_phy_id()].filter_source.erase(k);
+        phy_mac_filter_map[phy->fetch_phy_id()].filter_source.remove(in_mac);
     } else if (in_block == "destination") {
-        auto k = phy_mac_filter_map[phy->fetch_phy_id()].filter_dest.find(in_mac);
-        if (k != phy_mac_filter_map[phy->fetch_phy_id()].filter_dest.end())
-            phy_mac_filter_map[phy->fetch_phy_id()].filter_dest.erase(k);
+        phy_mac_filter_map[phy->fetch_phy_id()].filter_dest.remove(in_mac);
     } else if (in_block == "network") {
-        auto k = phy_mac_filter_map[phy->fetch_phy_id()].filter_network.find(in_mac);
-        if (k != phy_mac_filter_map[phy->fetch_phy_id()].filter_network.end())
-            phy_mac_filter_map[phy->fetch_phy_id()].filter_network.erase(k);
+        phy_mac_filter_map[phy->fetch_phy_id()].filter_network.remove(in_mac);
     } else if (in_block == "other") {
-        auto k = phy_mac_filter_map[phy->fetch_phy_id()].filter_other.find(in_mac);
-        if (k != phy_mac_filter_map[phy->fetch_phy_id()].filter_other.end())
-            phy_mac_filter_map[phy->fetch_phy_id()].filter_other.erase(k);
+        phy_mac_filter_map[phy->fetch_phy_id()].filter_other.remove(in_mac);
     } else if (in_block == "any") {
-        auto k = phy_mac_filter_map[phy->fetch_phy_id()].filter_any.find(in_mac);
-        if (k != phy_mac_filter_map[phy->fetch_phy_id()].filter_any.end())
-            phy_mac_filter_map[phy->fetch_phy_id()].filter_any.erase(k);
+        phy_mac_filter_map[phy->fetch_phy_id()].filter_any.remove(in_mac);
     }
+
+    filters_dirty = true;
 }
 
 void packet_filter_mac_addr::edit_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
     std::ostream stream(&con->response_stream());
     
-    auto filter = con->json()["filter"];
+    // Filter lists are read from the body without building a document
+    auto found = con->json_bool_members("filter", [&](const std::string& i, bool v) {
+            mac_addr m(i);
+
+            if (m.state.error) 
+                throw std::runtime_error(fmt::format("Invalid MAC address: '{}'",
+                            con->escape_html(i)));
 
-    if (!filter.isObject()) {
+            set_filter(m, con->uri_params()[":phyname"], con->uri_params()[":block"], v);
+            });
+
+    if (!found) {
         con->set_status(500);
         stream << "Expected 'filter' to be a dictionary\n";
         return;
     }
 
-    for (const auto& i : filter.getMemberNames()) {
-        mac_addr m(i);
-        bool v = filter[i].asBool();
-
-        if (m.state.error) 
-            throw std::runtime_error(fmt::format("Invalid MAC address: '{}'",
-                        con->escape_html(i)));
-
-        set_filter(m, con->uri_params()[":phyname"], con->uri_params()[":block"], v);
-    }
+    compile_filters();
 
     stream << "set filter\n";
     return;
@@ -402,23 +410,23 @@ void packet_filter_mac_addr::edit_endp_handler(std::shared_ptr<kis_net_beast_htt
 void packet_filter_mac_addr::remove_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
     std::ostream stream(&con->response_stream());
 
-    auto filter = con->json()["filter"];
+    auto found = con->json_strings("filter", [&](const std::string& i) {
+            mac_addr m{i};
+
+            if (m.state.error) 
+                throw std::runtime_error(fmt::format("Invalid MAC address: '{}'",
+                            con->escape_html(i)));
+
+            remove_filter(m, con->uri_params()[":phyname"], con->uri_params()[":block"]);
+            });
 
-    if (!filter.isArray()) {
+    if (!found) {
         con->set_status(500);
         stream << "Expected 'filter' to be an array\n";
         return;
     }
 
-    for (auto i : filter) {
-        mac_addr m{i.asString()};
-
-        if (m.state.error) 
-            throw std::runtime_error(fmt::format("Invalid MAC address: '{}'",
-                        con->escape_html(i.asString())));
-
-        remove_filter(m, con->uri_params()[":phyname"], con->uri_params()[":block"]);
-    }
+    compile_filters();
 
     stream << "Removed filter\n";
 }
@@ -429,48 +437,41 @@ bool packet_filter_mac_addr::filter_packet(std::shared_ptr<kis_packet> packet) {
     if (common == nullptr)
         return get_filter_default();
 
-    auto phy_filter_group =
-        phy_mac_filter_map.find(common->phyid);
+    auto compiled = fetch_compiled_filters();
 
-    if (phy_filter_group == phy_mac_filter_map.end())
+    auto phy_filter_group = compiled->find(common->phyid);
+
+    if (phy_filter_group == compiled->end())
         return get_filter_default();
 
-    auto si = phy_filter_group->second.filter_source.find(common->source);
-    if (si != phy_filter_group->second.filter_source.end()) {
-        return si->second;
-    }
+    const auto& tables = phy_filter_group->second;
+    bool value;
 
-    auto di = phy_filter_group->second.filter_dest.find(common->dest);
-    if (di != phy_filter_group->second.filter_dest.end()) {
-        return di->second;
-    }
+    if (tables.filter_source.match(common->source, value))
+        return value;
 
-    auto ni = phy_filter_group->second.filter_network.find(common->network);
-    if (ni != phy_filter_group->second.filter_network.end()) {
-        return ni->second;
-    }
+    if (tables.filter_dest.match(common->dest, value))
+        return value;
 
-    auto oi = phy_filter_group->second.filter_other.find(common->transmitter);
-    if (oi != phy_filter_group->second.filter_other.end()) {
-        return oi->second;
-    }
+    if (tables.filter_network.match(common->network, value))
+        return value;
 
-    auto ai = phy_filter_group->second.filter_any.find(common->source);
+    if (tables.filter_other.match(common->transmitter, value))
+        return value;
 
-    if (ai == phy_filter_group->second.filter_any.end())
-        ai = phy_filter_group->second.filter_any.find(common->dest);
+    if (!tables.filter_any.empty()) {
+        if (tables.filter_any.match(common->source, value))
+            return value;
 
-    if (ai == phy_filter_group->second.filter_any.end())
-        ai = phy_filter_group->second.filter_any.find(common->network);
-    
-    if (ai == phy_filter_group->second.filter_any.end())
-        ai = phy_filter_group->second.filter_any.find(common->transmitter);
-   
-    if (ai == phy_filter_group->second.filter_any.end())
-        ai = phy_filter_group->second.filter_any.find(common->dest);
+        if (tables.filter_any.match(common->dest, value))
+            return value;
 
-    if (ai != phy_filter_group->second.filter_any.end())
-        return ai->second;
+        if (tables.filter_any.match(common->network, value))
+            return value;
+
+        if (tables.filter_any.match(common->transmitter, value))
+            return value;
+    }
 
     return get_filter_default();
 }
@@ -488,3 +489,70 @@ void packet_filter_mac_addr::build_self_content(std::shared_ptr<tracker_element_
 }
 
 
+packet_filter_expression::packet_filter_expression(const std::string& in_id,
+        const std::string& in_description) :
+    packet_filter(in_id, in_description, "expression"),
+    program{packet_filter_program::compile("")} {
+
+    register_fields();
+    reserve_fields(nullptr);
+
+    auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
+
+    auto seturl = fmt::format("{}/set_expression", base_uri);
+
+    httpd->register_route(seturl, {"POST"}, httpd->LOGON_ROLE, {"cmd"},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this, seturl](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    kis_lock_guard<kis_mutex> lk(mutex, seturl);
+                    return expression_endp_handler(con);
+                }));
+}
+
+bool packet_filter_expression::filter_packet(std::shared_ptr<kis_packet> packet) {
+    auto prog = std::atomic_load(&program);
+
+    if (prog->get_expression().empty())
+        return get_filter_default();
+
+    return !prog->match(packet);
+}
+
+void packet_filter_expression::set_expression(const std::string& in_expression) {
+    auto prog = packet_filter_program::compile(in_expression);
+
+    kis_lock_guard<kis_mutex> lk(mutex, "packet_filter_expression set_expression");
+
+    set_tracker_value<std::string>(filter_expression, in_expression);
+    std::atomic_store(&program, prog);
+}
+
+void packet_filter_expression::expression_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    std::ostream stream(&con->response_stream());
+
+    try {
+        auto expression = con->json()["expression"].asString();
+        auto prog = packet_filter_program::compile(expression);
+
+        set_tracker_value<std::string>(filter_expression, expression);
+        std::atomic_store(&program, prog);
+
+        stream << "Filter expression: " << con->escape_html(expression) << "\n";
+    } catch (const std::exception& e) {
+        con->set_status(500);
+        stream << "Invalid request: " << con->escape_html(e.what()) << "\n";
+    }
+}
+
+std::shared_ptr<tracker_element_map> packet_filter_expression::self_endp_handler() {
+    auto ret = std::make_shared<tracker_element_map>();
+    build_self_content(ret);
+    return ret;
+}
+
+void packet_filter_expression::build_self_content(std::shared_ptr<tracker_element_map> content) {
+    packet_filter::build_self_content(content);
+
+    content->insert(filter_expression);
+}
+
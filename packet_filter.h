@@ -18,6 +18,10 @@
 
 #include "config.h"
 
+#include <atomic>
+
+#include "mac_filter_table.h"
+#include "packet_filter_program.h"
 #include "packetchain.h"
 #include "packet.h"
 #include "trackedcomponent.h"
@@ -152,11 +156,11 @@ protected:
     std::shared_ptr<tracker_element_string_map> filter_phy_blocks;
 
     struct phy_filter_group {
-        std::map<mac_addr, bool> filter_source;
-        std::map<mac_addr, bool> filter_dest;
-        std::map<mac_addr, bool> filter_network;
-        std::map<mac_addr, bool> filter_other;
-        std::map<mac_addr, bool> filter_any;
+        mac_filter_table filter_source;
+        mac_filter_table filter_dest;
+        mac_filter_table filter_network;
+        mac_filter_table filter_other;
+        mac_filter_table filter_any;
     };
 
 	// Internal fast lookup tables per-phy we use for actual filtering
@@ -164,6 +168,19 @@ protected:
 	// Internal unknown phy map for filters registered before we had a phy ID
 	std::map<std::string, struct phy_filter_group> unknown_phy_mac_filter_map;
 
+    // Copy of phy_mac_filter_map which packets are checked against; replaced when the
+    // filters change, so filtering never takes the lock
+    using compiled_filter_map = std::map<int, struct phy_filter_group>;
+
+    std::shared_ptr<compiled_filter_map> compiled_filters;
+    std::atomic<bool> filters_dirty;
+
+    // Replace the lookup tables; called with the mutex held
+    void compile_filters();
+
+    // Current lookup tables, replacing them first if the filters changed since
+    std::shared_ptr<compiled_filter_map> fetch_compiled_filters();
+
     // Address management endpoint keyed on path
     void edit_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
     void remove_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
@@ -172,3 +189,35 @@ protected:
     virtual void build_self_content(std::shared_ptr<tracker_element_map> content) override;
 };
 
+
+// Expression filter; packets matching the expression are passed, everything else is
+// blocked.  An empty expression falls back to the default filter term.  See
+// packet_filter_program.h for the expression syntax.
+class packet_filter_expression : public packet_filter {
+public:
+    packet_filter_expression(const std::string& in_id, const std::string& in_description);
+    virtual ~packet_filter_expression() { }
+
+    virtual bool filter_packet(std::shared_ptr<kis_packet> packet) override;
+
+    // Compile and install a new expression; throws std::runtime_error and keeps the
+    // current expression if it does not compile
+    void set_expression(const std::string& in_expression);
+
+protected:
+    virtual void register_fields() override {
+        packet_filter::register_fields();
+
+        register_field("kismet.packetfilter.expression", "Filter expression", &filter_expression);
+    }
+
+    std::shared_ptr<tracker_element_string> filter_expression;
+
+    // Compiled expression, replaced atomically so filtering never takes the lock
+    std::shared_ptr<packet_filter_program> program;
+
+    void expression_endp_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
+
+    virtual std::shared_ptr<tracker_element_map> self_endp_handler() override;
+    virtual void build_self_content(std::shared_ptr<tracker_element_map> content) override;
+};
@@ -0,0 +1,1056 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <stdexcept>
+
+#include "fmt.h"
+#include "devicetracker.h"
+#include "kis_datasource.h"
+#include "packet.h"
+#include "packetchain.h"
+#include "packet_filter_program.h"
+#include "phyhandler.h"
+#include "util.h"
+
+namespace {
+    struct filter_token {
+        enum class kind {
+            word, string, op, lparen, rparen, end
+        };
+
+        kind k;
+        std::string text;
+        size_t pos;
+    };
+
+    bool is_word_char(char c) {
+        return isalnum((unsigned char) c) || c == '_' || c == ':' || c == '.' ||
+            c == '-' || c == '/' || c == '*' || c == '+';
+    }
+
+    struct field_def {
+        const char *name;
+        packet_filter_program::field fld;
+    };
+
+    const field_def filter_fields[] = {
+        { "phy", packet_filter_program::field::phy },
+        { "dlt", packet_filter_program::field::dlt },
+        { "type", packet_filter_program::field::type },
+        { "subtype", packet_filter_program::field::subtype },
+        { "datasource", packet_filter_program::field::datasource },
+        { "signal", packet_filter_program::field::signal },
+        { "channel", packet_filter_program::field::channel },
+        { "freq", packet_filter_program::field::freq },
+        { "src", packet_filter_program::field::src },
+        { "dst", packet_filter_program::field::dst },
+        { "bssid", packet_filter_program::field::bssid },
+        { "transmitter", packet_filter_program::field::transmitter },
+        { "addr", packet_filter_program::field::addr },
+        { "ssid", packet_filter_program::field::ssid },
+    };
+
+    struct name_value {
+        const char *name;
+        int value;
+    };
+
+    const name_value frame_types[] = {
+        { "mgmt", 0 }, { "ctrl", 1 }, { "data", 2 },
+    };
+
+    const name_value mgmt_subtypes[] = {
+        { "assocreq", 0 }, { "assocresp", 1 }, { "reassocreq", 2 }, { "reassocresp", 3 },
+        { "probereq", 4 }, { "proberesp", 5 }, { "beacon", 8 }, { "atim", 9 },
+        { "disassoc", 10 }, { "auth", 11 }, { "deauth", 12 }, { "action", 13 },
+    };
+
+    // Parse a whole string as a signed integer
+    bool parse_int(const std::string& in_str, int64_t& ret) {
+        if (in_str.empty())
+            return false;
+
+        char *end;
+        errno = 0;
+        auto v = strtoll(in_str.c_str(), &end, 10);
+
+        if (errno != 0 || *end != 0)
+            return false;
+
+        ret = v;
+        return true;
+    }
+}
+
+class packet_filter_compiler {
+public:
+    packet_filter_compiler(const std::string& in_expression,
+            std::shared_ptr<packet_filter_program> in_program) :
+        expression{in_expression},
+        program{in_program},
+        offset{0},
+        cur_token{0} { }
+
+    void compile() {
+        tokenize();
+
+        if (tokens.size() == 1)
+            return;
+
+        parse_or();
+
+        if (peek().k != filter_token::kind::end)
+            fail("unexpected '" + peek().text + "'", peek().pos);
+    }
+
+protected:
+    using prog = packet_filter_program;
+
+    [[noreturn]] void fail(const std::string& in_err, size_t in_pos) {
+        throw std::runtime_error(fmt::format("invalid packet filter: {} at position {}",
+                    in_err, in_pos + 1));
+    }
+
+    void tokenize() {
+        while (offset < expression.length()) {
+            auto c = expression[offset];
+
+            if (isspace((unsigned char) c)) {
+                offset++;
+                continue;
+            }
+
+            auto start = offset;
+
+            if (c == '(') {
+                tokens.push_back({filter_token::kind::lparen, "(", start});
+                offset++;
+            } else if (c == ')') {
+                tokens.push_back({filter_token::kind::rparen, ")", start});
+                offset++;
+            } else if (c == '"' || c == '\'') {
+                std::string str;
+                offset++;
+
+                while (offset < expression.length() && expression[offset] != c) {
+                    if (expression[offset] == '\\' && offset + 1 < expression.length())
+                        offset++;
+                    str += expression[offset++];
+                }
+
+                if (offset >= expression.length())
+                    fail("unterminated string", start);
+
+                offset++;
+                tokens.push_back({filter_token::kind::string, str, start});
+            } else if (c == '=' || c == '!' || c == '<' || c == '>' || c == '~' ||
+                    c == '&' || c == '|') {
+                std::string op(1, c);
+
+                if (offset + 1 < expression.length()) {
+                    auto n = expression[offset + 1];
+
+                    if ((n == '=' && c != '~' && c != '&' && c != '|') ||
+                            (c == '&' && n == '&') || (c == '|' && n == '|'))
+                        op += n;
+                }
+
+                if (op == "=" || op == "&" || op == "|")
+                    fail("unknown operator '" + op + "'", start);
+
+                offset += op.length();
+                tokens.push_back({filter_token::kind::op, op, start});
+            } else if (is_word_char(c)) {
+                while (offset < expression.length() && is_word_char(expression[offset]))
+                    offset++;
+
+                auto word = expression.substr(start, offset - start);
+
+                if (str_lower(word) == "and")
+                    tokens.push_back({filter_token::kind::op, "&&", start});
+                else if (str_lower(word) == "or")
+                    tokens.push_back({filter_token::kind::op, "||", start});
+                else if (str_lower(word) == "not")
+                    tokens.push_back({filter_token::kind::op, "!", start});
+                else
+                    tokens.push_back({filter_token::kind::word, word, start});
+            } else {
+                fail(fmt::format("unexpected character '{}'", c), start);
+            }
+        }
+
+        tokens.push_back({filter_token::kind::end, "end of expression", expression.length()});
+    }
+
+    const filter_token& peek() const {
+        return tokens[cur_token];
+    }
+
+    const filter_token& next() {
+        const auto& t = tokens[cur_token];
+        if (t.k != filter_token::kind::end)
+            cur_token++;
+        return t;
+    }
+
+    bool accept_op(const std::string& in_op) {
+        if (peek().k == filter_token::kind::op && peek().text == in_op) {
+            next();
+            return true;
+        }
+
+        return false;
+    }
+
+    size_t emit(prog::opcode in_op, prog::field in_fld = prog::field::phy,
+            prog::comparison in_cmp = prog::comparison::eq, uint32_t in_arg = 0,
+            int64_t in_num = 0) {
+        program->code.push_back({in_op, in_fld, in_cmp, in_arg, in_num});
+        return program->code.size() - 1;
+    }
+
+    void patch(const std::vector<size_t>& in_jumps) {
+        for (auto j : in_jumps)
+            program->code[j].arg = program->code.size();
+    }
+
+    // Chains of and / or leave the result of the last evaluated test in the accumulator,
+    // jumping to the end of the chain as soon as the result is known
+    void parse_or() {
+        std::vector<size_t> jumps;
+
+        parse_and();
+
+        while (accept_op("||")) {
+            jumps.push_back(emit(prog::opcode::jump_true));
+            parse_and();
+        }
+
+        patch(jumps);
+    }
+
+    void parse_and() {
+        std::vector<size_t> jumps;
+
+        parse_unary();
+
+        while (accept_op("&&")) {
+            jumps.push_back(emit(prog::opcode::jump_false));
+            parse_unary();
+        }
+
+        patch(jumps);
+    }
+
+    void parse_unary() {
+        if (accept_op("!")) {
+            parse_unary();
+            emit(prog::opcode::negate);
+            return;
+        }
+
+        if (peek().k == filter_token::kind::lparen) {
+            auto lp = next();
+
+            parse_or();
+
+            if (peek().k != filter_token::kind::rparen)
+                fail("unclosed '('", lp.pos);
+
+            next();
+            return;
+        }
+
+        parse_test();
+    }
+
+    void parse_test() {
+        auto ft = next();
+
+        if (ft.k != filter_token::kind::word)
+            fail(fmt::format("expected a field, found '{}'", ft.text), ft.pos);
+
+        auto fname = str_lower(ft.text);
+        bool found = false;
+        prog::field fld = prog::field::phy;
+
+        for (const auto& f : filter_fields) {
+            if (fname == f.name) {
+                fld = f.fld;
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+            fail(fmt::format("unknown field '{}'", ft.text), ft.pos);
+
+        auto cmp = prog::comparison::eq;
+        auto op_pos = peek().pos;
+
+        if (peek().k == filter_token::kind::op && peek().text != "&&" &&
+                peek().text != "||" && peek().text != "!") {
+            auto op = next().text;
+
+            if (op == "==")
+                cmp = prog::comparison::eq;
+            else if (op == "!=")
+                cmp = prog::comparison::ne;
+            else if (op == "<")
+                cmp = prog::comparison::lt;
+            else if (op == "<=")
+                cmp = prog::comparison::le;
+            else if (op == ">")
+                cmp = prog::comparison::gt;
+            else if (op == ">=")
+                cmp = prog::comparison::ge;
+            else if (op == "~")
+                cmp = prog::comparison::contains;
+            else
+                fail(fmt::format("unexpected '{}'", op), op_pos);
+        }
+
+        auto vt = next();
+
+        if (vt.k != filter_token::kind::word && vt.k != filter_token::kind::string)
+            fail(fmt::format("expected a value for '{}', found '{}'", ft.text, vt.text), vt.pos);
+
+        const auto& value = vt.text;
+        bool equality = cmp == prog::comparison::eq || cmp == prog::comparison::ne;
+        bool relational = cmp != prog::comparison::contains;
+        bool textual = equality || cmp == prog::comparison::contains;
+
+        auto check_cmp = [&](bool in_ok) {
+            if (!in_ok)
+                fail(fmt::format("operator not supported for '{}'", ft.text), op_pos);
+        };
+
+        switch (fld) {
+            case prog::field::phy:
+                check_cmp(equality);
+                program->strings.push_back(value);
+                emit(prog::opcode::test, fld, cmp, program->strings.size() - 1);
+                break;
+
+            case prog::field::dlt:
+            case prog::field::signal:
+                {
+                    int64_t n;
+                    check_cmp(relational);
+                    if (!parse_int(value, n))
+                        fail(fmt::format("expected a number for '{}'", ft.text), vt.pos);
+                    emit(prog::opcode::test, fld, cmp, 0, n);
+                }
+                break;
+
+            case prog::field::type:
+                {
+                    int64_t n = -1;
+                    check_cmp(relational);
+
+                    for (const auto& t : frame_types)
+                        if (str_lower(value) == t.name)
+                            n = t.value;
+
+                    if (n < 0 && (!parse_int(value, n) || n < 0 || n > 3))
+                        fail(fmt::format("unknown frame type '{}'", value), vt.pos);
+
+                    emit(prog::opcode::test, fld, cmp, 0, n);
+                }
+                break;
+
+            case prog::field::subtype:
+                {
+                    int64_t n = -1;
+                    check_cmp(relational);
+
+                    for (const auto& t : mgmt_subtypes)
+                        if (str_lower(value) == t.name)
+                            n = t.value;
+
+                    // Named subtypes are management subtypes; test the type and subtype
+                    // together so a beacon is not confused with a data subtype 8
+                    if (n >= 0) {
+                        check_cmp(equality);
+                        emit(prog::opcode::test, prog::field::type_subtype, cmp, 0, n);
+                        break;
+                    }
+
+                    if (!parse_int(value, n) || n < 0 || n > 15)
+                        fail(fmt::format("unknown frame subtype '{}'", value), vt.pos);
+
+                    emit(prog::opcode::test, fld, cmp, 0, n);
+                }
+                break;
+
+            case prog::field::datasource:
+                {
+                    check_cmp(textual);
+
+                    auto u = uuid(value);
+
+                    if (!u.error && cmp != prog::comparison::contains) {
+                        program->uuids.push_back(u);
+                        emit(prog::opcode::test, fld, cmp, program->uuids.size() - 1, 1);
+                    } else {
+                        program->strings.push_back(value);
+                        emit(prog::opcode::test, fld, cmp, program->strings.size() - 1, 0);
+                    }
+                }
+                break;
+
+            case prog::field::channel:
+                {
+                    int64_t n;
+
+                    // Numbers compare against the channel number, anything else
+                    // against the channel string
+                    if (parse_int(value, n)) {
+                        check_cmp(relational);
+                        emit(prog::opcode::test, prog::field::channel_num, cmp, 0, n);
+                    } else {
+                        check_cmp(textual);
+                        program->strings.push_back(value);
+                        emit(prog::opcode::test, fld, cmp, program->strings.size() - 1);
+                    }
+                }
+                break;
+
+            case prog::field::freq:
+                {
+                    check_cmp(relational);
+
+                    auto lv = str_lower(value);
+                    double mult = 1;
+
+                    auto suffix = [&](const std::string& in_sfx, double in_mult) {
+                        if (lv.length() > in_sfx.length() &&
+                                lv.compare(lv.length() - in_sfx.length(), in_sfx.length(), in_sfx) == 0) {
+                            lv = lv.substr(0, lv.length() - in_sfx.length());
+                            mult = in_mult;
+                            return true;
+                        }
+                        return false;
+                    };
+
+                    if (!suffix("khz", 1))
+                        if (!suffix("mhz", 1000))
+                            suffix("ghz", 1000000);
+
+                    char *end;
+                    auto f = strtod(lv.c_str(), &end);
+
+                    if (lv.empty() || *end != 0)
+                        fail(fmt::format("expected a frequency for '{}'", ft.text), vt.pos);
+
+                    emit(prog::opcode::test, fld, cmp, 0, (int64_t) (f * mult + 0.5));
+                }
+                break;
+
+            case prog::field::src:
+            case prog::field::dst:
+            case prog::field::bssid:
+            case prog::field::transmitter:
+            case prog::field::addr:
+                {
+                    check_cmp(equality);
+
+                    auto m = mac_addr(value);
+
+                    if (m.error())
+                        fail(fmt::format("invalid MAC address '{}'", value), vt.pos);
+
+                    program->macs.push_back(m);
+                    emit(prog::opcode::test, fld, cmp, program->macs.size() - 1);
+                }
+                break;
+
+            case prog::field::ssid:
+                check_cmp(textual);
+                program->strings.push_back(value);
+                emit(prog::opcode::test, fld, cmp, program->strings.size() - 1);
+                break;
+
+            case prog::field::type_subtype:
+            case prog::field::channel_num:
+                break;
+        }
+    }
+
+    const std::string& expression;
+    std::shared_ptr<packet_filter_program> program;
+
+    size_t offset;
+    std::vector<filter_token> tokens;
+    size_t cur_token;
+};
+
+std::shared_ptr<packet_filter_program> packet_filter_program::compile(const std::string& in_expression) {
+    auto packetchain = Globalreg::fetch_mandatory_global_as<packet_chain>();
+    return compile(in_expression, packetchain.get());
+}
+
+std::shared_ptr<packet_filter_program> packet_filter_program::compile(const std::string& in_expression,
+        packet_chain *packetchain) {
+    auto program = std::shared_ptr<packet_filter_program>(new packet_filter_program());
+
+    program->expression = in_expression;
+
+    packet_filter_compiler(in_expression, program).compile();
+
+    program->phy_ids.reset(new std::atomic<int>[program->strings.size() + 1]);
+    for (size_t i = 0; i < program->strings.size() + 1; i++)
+        program->phy_ids[i] = -2;
+
+    program->pack_comp_common = packetchain->register_packet_component("COMMON");
+    program->pack_comp_l1 = packetchain->register_packet_component("RADIODATA");
+    program->pack_comp_datasrc = packetchain->register_packet_component("KISDATASRC");
+    program->pack_comp_linkframe = packetchain->register_packet_component("LINKFRAME");
+    program->pack_comp_decap = packetchain->register_packet_component("DECAP");
+
+    return program;
+}
+
+// Packet components and the 802.11 header, fetched the first time a test needs them
+struct packet_filter_program::eval_context {
+    eval_context(const std::shared_ptr<kis_packet>& in_pack) :
+        pack{in_pack} { }
+
+    const std::shared_ptr<kis_packet>& pack;
+
+    bool have_common = false;
+    std::shared_ptr<kis_common_info> common;
+
+    bool have_l1 = false;
+    std::shared_ptr<kis_layer1_packinfo> l1;
+
+    bool have_datasrc = false;
+    std::shared_ptr<packetchain_comp_datasource> datasrc;
+
+    bool have_frame = false;
+    std::shared_ptr<kis_datachunk> linkframe;
+
+    // Parsed 802.11 header
+    bool dot11 = false;
+    unsigned int type = 0;
+    unsigned int subtype = 0;
+    nonstd::string_view frame;
+
+    // Addresses, and which of them the frame has
+    enum {
+        addr_src = 0, addr_dst = 1, addr_bssid = 2, addr_transmitter = 3,
+    };
+    mac_addr addrs[4];
+    bool have_addr[4] = { false, false, false, false };
+
+    bool have_ssid = false;
+    bool ssid_valid = false;
+    nonstd::string_view ssid;
+};
+
+bool packet_filter_program::match(const std::shared_ptr<kis_packet>& in_pack) const {
+    if (code.empty())
+        return true;
+
+    eval_context ctx(in_pack);
+    bool acc = false;
+    size_t pc = 0;
+
+    while (pc < code.size()) {
+        const auto& insn = code[pc];
+
+        switch (insn.op) {
+            case opcode::test:
+                acc = eval_test(insn, ctx);
+                break;
+            case opcode::jump_false:
+                if (!acc) {
+                    pc = insn.arg;
+                    continue;
+                }
+                break;
+            case opcode::jump_true:
+                if (acc) {
+                    pc = insn.arg;
+                    continue;
+                }
+                break;
+            case opcode::negate:
+                acc = !acc;
+                break;
+        }
+
+        pc++;
+    }
+
+    return acc;
+}
+
+bool packet_filter_program::compare_num(comparison in_cmp, int64_t in_value,
+        int64_t in_operand) const {
+    switch (in_cmp) {
+        case comparison::eq:
+            return in_value == in_operand;
+        case comparison::ne:
+            return in_value != in_operand;
+        case comparison::lt:
+            return in_value < in_operand;
+        case comparison::le:
+            return in_value <= in_operand;
+        case comparison::gt:
+            return in_value > in_operand;
+        case comparison::ge:
+            return in_value >= in_operand;
+        case comparison::contains:
+            return false;
+    }
+
+    return false;
+}
+
+int packet_filter_program::resolve_phy(uint32_t in_idx) const {
+    auto id = phy_ids[in_idx].load();
+
+    if (id != -2)
+        return id;
+
+    auto devicetracker = Globalreg::fetch_global_as<device_tracker>();
+
+    if (devicetracker == nullptr)
+        return -1;
+
+    auto phy = devicetracker->fetch_phy_handler_by_name(strings[in_idx]);
+
+    if (phy == nullptr)
+        return -1;
+
+    id = phy->fetch_phy_id();
+    phy_ids[in_idx] = id;
+
+    return id;
+}
+
+namespace {
+    bool compare_str(packet_filter_program::comparison in_cmp, const nonstd::string_view& in_value,
+            const std::string& in_operand) {
+        switch (in_cmp) {
+            case packet_filter_program::comparison::eq:
+                return in_value == in_operand;
+            case packet_filter_program::comparison::ne:
+                return in_value != in_operand;
+            case packet_filter_program::comparison::contains:
+                return in_value.find(in_operand) != nonstd::string_view::npos;
+            default:
+                return false;
+        }
+    }
+}
+
+bool packet_filter_program::eval_test(const instruction& insn, eval_context& ctx) const {
+    auto fetch_frame = [&]() {
+        if (ctx.have_frame)
+            return;
+
+        ctx.have_frame = true;
+
+        ctx.linkframe = ctx.pack->fetch<kis_datachunk>(pack_comp_linkframe);
+        auto chunk = ctx.pack->fetch<kis_datachunk>(pack_comp_decap, pack_comp_linkframe);
+
+        if (chunk == nullptr || chunk->dlt != KDLT_IEEE802_11 || chunk->length() < 10)
+            return;
+
+        const auto data = reinterpret_cast<const uint8_t *>(chunk->data());
+        const auto len = chunk->length();
+
+        ctx.frame = nonstd::string_view(chunk->data(), len);
+        ctx.type = (data[0] >> 2) & 0x03;
+        ctx.subtype = (data[0] >> 4) & 0x0F;
+
+        if (ctx.type == 3)
+            return;
+
+        ctx.dot11 = true;
+
+        auto set_addr = [&](int in_slot, size_t in_offt) {
+            if (in_offt + 6 > len)
+                return;
+            ctx.addrs[in_slot] = mac_addr(data + in_offt, 6);
+            ctx.have_addr[in_slot] = true;
+        };
+
+        if (ctx.type == 1) {
+            // Control frames carry the receiver, and usually the transmitter
+            set_addr(eval_context::addr_dst, 4);
+            set_addr(eval_context::addr_src, 10);
+            return;
+        }
+
+        if (len < 24)
+            return;
+
+        switch (data[1] & 0x03) {
+            case 0:
+                set_addr(eval_context::addr_dst, 4);
+                set_addr(eval_context::addr_src, 10);
+                set_addr(eval_context::addr_bssid, 16);
+                break;
+            case 1:
+                set_addr(eval_context::addr_bssid, 4);
+                set_addr(eval_context::addr_src, 10);
+                set_addr(eval_context::addr_dst, 16);
+                break;
+            case 2:
+                set_addr(eval_context::addr_dst, 4);
+                set_addr(eval_context::addr_bssid, 10);
+                set_addr(eval_context::addr_src, 16);
+                break;
+            case 3:
+                set_addr(eval_context::addr_transmitter, 10);
+                set_addr(eval_context::addr_dst, 16);
+                set_addr(eval_context::addr_src, 24);
+                break;
+        }
+    };
+
+    auto fetch_common = [&]() {
+        if (!ctx.have_common) {
+            ctx.have_common = true;
+            ctx.common = ctx.pack->fetch<kis_common_info>(pack_comp_common);
+        }
+        return ctx.common;
+    };
+
+    auto fetch_l1 = [&]() {
+        if (!ctx.have_l1) {
+            ctx.have_l1 = true;
+            ctx.l1 = ctx.pack->fetch<kis_layer1_packinfo>(pack_comp_l1);
+        }
+        return ctx.l1;
+    };
+
+    // Addresses from the dissectors when the packet has been dissected, otherwise
+    // from the frame
+    auto fetch_addr = [&](int in_slot, mac_addr& ret) {
+        auto common = fetch_common();
+
+        if (common != nullptr && common->phyid >= 0) {
+            switch (in_slot) {
+                case eval_context::addr_src:
+                    ret = common->source;
+                    break;
+                case eval_context::addr_dst:
+                    ret = common->dest;
+                    break;
+                case eval_context::addr_bssid:
+                    ret = common->network;
+                    break;
+                case eval_context::addr_transmitter:
+                    ret = common->transmitter;
+                    break;
+            }
+
+            return ret.longmac != 0;
+        }
+
+        fetch_frame();
+
+        if (!ctx.have_addr[in_slot])
+            return false;
+
+        ret = ctx.addrs[in_slot];
+        return true;
+    };
+
+    switch (insn.fld) {
+        case field::phy:
+            {
+                auto common = fetch_common();
+                bool eq;
+
+                if (common != nullptr && common->phyid >= 0) {
+                    eq = common->phyid == resolve_phy(insn.arg);
+                } else {
+                    fetch_frame();
+                    if (!ctx.dot11)
+                        return false;
+                    eq = strings[insn.arg] == "IEEE802.11";
+                }
+
+                return insn.cmp == comparison::eq ? eq : !eq;
+            }
+
+        case field::dlt:
+            fetch_frame();
+            if (ctx.linkframe == nullptr)
+                return false;
+            return compare_num(insn.cmp, ctx.linkframe->dlt, insn.num);
+
+        case field::type:
+            fetch_frame();
+            if (!ctx.dot11)
+                return false;
+            return compare_num(insn.cmp, ctx.type, insn.num);
+
+        case field::subtype:
+            fetch_frame();
+            if (!ctx.dot11)
+                return false;
+            return compare_num(insn.cmp, ctx.subtype, insn.num);
+
+        case field::type_subtype:
+            fetch_frame();
+            if (!ctx.dot11)
+                return false;
+            return compare_num(insn.cmp, ctx.type == 0 && ctx.subtype == insn.num, 1);
+
+        case field::datasource:
+            {
+                if (!ctx.have_datasrc) {
+                    ctx.have_datasrc = true;
+                    ctx.datasrc = ctx.pack->fetch<packetchain_comp_datasource>(pack_comp_datasrc);
+                }
+
+                if (ctx.datasrc == nullptr || ctx.datasrc->ref_source == nullptr)
+                    return false;
+
+                if (insn.num == 1) {
+                    bool eq = ctx.datasrc->ref_source->get_source_uuid() == uuids[insn.arg];
+                    return insn.cmp == comparison::eq ? eq : !eq;
+                }
+
+                return compare_str(insn.cmp, ctx.datasrc->ref_source->get_source_name(),
+                        strings[insn.arg]);
+            }
+
+        case field::signal:
+            {
+                auto l1 = fetch_l1();
+
+                // 0 is no signal reported
+                if (l1 == nullptr || l1->signal_dbm == 0)
+                    return false;
+
+                return compare_num(insn.cmp, l1->signal_dbm, insn.num);
+            }
+
+        case field::channel:
+        case field::channel_num:
+            {
+                auto l1 = fetch_l1();
+                const std::string *channel = nullptr;
+
+                if (l1 != nullptr && l1->channel != "0" && l1->channel.length() > 0) {
+                    channel = &l1->channel;
+                } else {
+                    auto common = fetch_common();
+                    if (common != nullptr && common->channel != "0" && common->channel.length() > 0)
+                        channel = &common->channel;
+                }
+
+                if (channel == nullptr)
+                    return false;
+
+                if (insn.fld == field::channel_num) {
+                    // Channels like "6HT40+" compare by their leading number
+                    char *end;
+                    auto n = strtol(channel->c_str(), &end, 10);
+
+                    if (end == channel->c_str())
+                        return false;
+
+                    return compare_num(insn.cmp, n, insn.num);
+                }
+
+                return compare_str(insn.cmp, *channel, strings[insn.arg]);
+            }
+
+        case field::freq:
+            {
+                auto l1 = fetch_l1();
+                double freq = 0;
+
+                if (l1 != nullptr && l1->freq_khz != 0) {
+                    freq = l1->freq_khz;
+                } else {
+                    auto common = fetch_common();
+                    if (common != nullptr)
+                        freq = common->freq_khz;
+                }
+
+                if (freq == 0)
+                    return false;
+
+                return compare_num(insn.cmp, (int64_t) freq, insn.num);
+            }
+
+        case field::src:
+        case field::dst:
+        case field::bssid:
+        case field::transmitter:
+            {
+                const int slot = insn.fld == field::src ? eval_context::addr_src :
+                    insn.fld == field::dst ? eval_context::addr_dst :
+                    insn.fld == field::bssid ? eval_context::addr_bssid :
+                    eval_context::addr_transmitter;
+
+                mac_addr m;
+
+                if (!fetch_addr(slot, m))
+                    return false;
+
+                bool eq = macs[insn.arg] == m;
+                return insn.cmp == comparison::eq ? eq : !eq;
+            }
+
+        case field::addr:
+            {
+                bool any = false;
+
+                for (int slot = 0; slot < 4; slot++) {
+                    mac_addr m;
+
+                    if (!fetch_addr(slot, m))
+                        continue;
+
+                    any = true;
+
+                    if (macs[insn.arg] == m)
+                        return insn.cmp == comparison::eq;
+                }
+
+                return any && insn.cmp == comparison::ne;
+            }
+
+        case field::ssid:
+            {
+                if (!ctx.have_ssid) {
+                    ctx.have_ssid = true;
+
+                    fetch_frame();
+
+                    // Fixed parameters before the tagged parameters, by management subtype
+                    size_t fixed = 0;
+
+                    if (ctx.dot11 && ctx.type == 0) {
+                        switch (ctx.subtype) {
+                            case 0:
+                                fixed = 4;
+                                break;
+                            case 2:
+                                fixed = 10;
+                                break;
+                            case 4:
+                                fixed = 0;
+                                break;
+                            case 5:
+                            case 8:
+                                fixed = 12;
+                                break;
+                            default:
+                                return false;
+                        }
+
+                        auto offt = 24 + fixed;
+
+                        // The SSID is the first tag
+                        if (ctx.frame.length() >= offt + 2 && ctx.frame[offt] == 0) {
+                            auto len = (uint8_t) ctx.frame[offt + 1];
+
+                            if (ctx.frame.length() >= offt + 2 + len) {
+                                ctx.ssid = ctx.frame.substr(offt + 2, len);
+                                ctx.ssid_valid = true;
+                            }
+                        }
+                    }
+                }
+
+                if (!ctx.ssid_valid)
+                    return false;
+
+                return compare_str(insn.cmp, ctx.ssid, strings[insn.arg]);
+            }
+    }
+
+    return false;
+}
+
+std::string packet_filter_program::disassemble() const {
+    static const char *field_names[] = {
+        "phy", "dlt", "type", "subtype", "type_subtype", "datasource", "signal", "channel",
+        "channel_num", "freq", "src", "dst", "bssid", "transmitter", "addr", "ssid",
+    };
+
+    static const char *cmp_names[] = {
+        "==", "!=", "<", "<=", ">", ">=", "~",
+    };
+
+    std::string ret;
+
+    for (size_t i = 0; i < code.size(); i++) {
+        const auto& insn = code[i];
+
+        switch (insn.op) {
+            case opcode::test:
+                ret += fmt::format("{:4}  test {} {} ", i, field_names[(int) insn.fld],
+                        cmp_names[(int) insn.cmp]);
+
+                switch (insn.fld) {
+                    case field::phy:
+                    case field::channel:
+                    case field::ssid:
+                        ret += fmt::format("\"{}\"", strings[insn.arg]);
+                        break;
+                    case field::src:
+                    case field::dst:
+                    case field::bssid:
+                    case field::transmitter:
+                    case field::addr:
+                        ret += macs[insn.arg].mac_to_string();
+                        break;
+                    case field::datasource:
+                        if (insn.num == 1)
+                            ret += uuids[insn.arg].as_string();
+                        else
+                            ret += fmt::format("\"{}\"", strings[insn.arg]);
+                        break;
+                    default:
+                        ret += fmt::format("{}", insn.num);
+                        break;
+                }
+
+                ret += "\n";
+                break;
+            case opcode::jump_false:
+                ret += fmt::format("{:4}  jump_false {}\n", i, insn.arg);
+                break;
+            case opcode::jump_true:
+                ret += fmt::format("{:4}  jump_true {}\n", i, insn.arg);
+                break;
+            case opcode::negate:
+                ret += fmt::format("{:4}  negate\n", i);
+                break;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,152 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __PACKET_FILTER_PROGRAM_H__
+#define __PACKET_FILTER_PROGRAM_H__
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "macaddr.h"
+#include "uuid.h"
+
+class kis_packet;
+class packet_chain;
+
+// Packet filter expressions
+//
+// A small filter language, compiled to bytecode once and evaluated per packet.  An
+// expression selects the packets it matches:
+//
+//   expr  := term { ("or" | "||") term }
+//   term  := unary { ("and" | "&&") unary }
+//   unary := ("not" | "!") unary | "(" expr ")" | test
+//   test  := field [op] value
+//   op    := "==" | "!=" | "<" | "<=" | ">" | ">=" | "~"     (default "==")
+//
+// Fields:
+//   phy           phy name, such as IEEE802.11
+//   dlt           link type of the captured frame
+//   type          802.11 frame type; mgmt, ctrl, data, or a number
+//   subtype       802.11 subtype; a number, or a management subtype name
+//                 (beacon, probereq, proberesp, assocreq, assocresp, reassocreq,
+//                 reassocresp, disassoc, auth, deauth, action), which also
+//                 implies the type
+//   datasource    datasource UUID or name
+//   signal        signal in dBm
+//   channel       channel; compared by number when the value is a number
+//   freq          frequency; in kHz, or with a khz, mhz, or ghz suffix
+//   src, dst, bssid, transmitter
+//                 addresses, with an optional mask (aa:bb:cc:00:00:00/ff:ff:ff:00:00:00)
+//   addr          any of the addresses
+//   ssid          SSID of a beacon, probe, or association; "~" matches a substring
+//
+// Fields are read from the captured frame and the capture metadata, so an expression
+// can be evaluated before the packet has been dissected; before dissection the phy is
+// only known for 802.11 frames, and once dissected the phy and addresses come from
+// the dissectors.  A test on a field the packet does not have is false.
+//
+//   type mgmt and not datasource "wlan1" and signal > -80
+//   subtype beacon and ssid ~ "guest"
+//   not (src 00:11:22:00:00:00/ff:ff:ff:00:00:00 or dst 00:11:22:00:00:00/ff:ff:ff:00:00:00)
+
+class packet_filter_program {
+public:
+    // Compile an expression; throws std::runtime_error describing the problem and where
+    // in the expression it is
+    static std::shared_ptr<packet_filter_program> compile(const std::string& in_expression);
+
+    // Compile against a specific packet chain, for the packet chain itself, which is not
+    // yet registered when it loads its filters
+    static std::shared_ptr<packet_filter_program> compile(const std::string& in_expression,
+            packet_chain *in_chain);
+
+    // Does the packet match the expression?  An empty expression matches every packet.
+    bool match(const std::shared_ptr<kis_packet>& in_pack) const;
+
+    const std::string& get_expression() const {
+        return expression;
+    }
+
+    // Bytecode listing, for debugging filters
+    std::string disassemble() const;
+
+    enum class opcode : uint8_t {
+        // Evaluate a test into the accumulator
+        test,
+        // Jump to the target if the accumulator is false, or true; used to
+        // short-circuit and / or
+        jump_false,
+        jump_true,
+        // Invert the accumulator
+        negate,
+    };
+
+    enum class field : uint8_t {
+        phy, dlt, type, subtype, type_subtype, datasource, signal, channel, channel_num, freq,
+        src, dst, bssid, transmitter, addr, ssid,
+    };
+
+    enum class comparison : uint8_t {
+        eq, ne, lt, le, gt, ge, contains,
+    };
+
+    struct instruction {
+        opcode op;
+        field fld;
+        comparison cmp;
+        // Jump target, or index of a string, MAC, or UUID constant
+        uint32_t arg;
+        int64_t num;
+    };
+
+protected:
+    packet_filter_program() { }
+
+    struct eval_context;
+
+    bool eval_test(const instruction& in_insn, eval_context& ctx) const;
+
+    bool compare_num(comparison in_cmp, int64_t in_value, int64_t in_operand) const;
+
+    int resolve_phy(uint32_t in_idx) const;
+
+    std::string expression;
+    std::vector<instruction> code;
+
+    std::vector<std::string> strings;
+    std::vector<mac_addr> macs;
+    std::vector<uuid> uuids;
+
+    // Phy ids of phy name constants, resolved the first time they are used since the
+    // phys are registered after the filters are compiled; -2 is unresolved
+    mutable std::unique_ptr<std::atomic<int>[]> phy_ids;
+
+    int pack_comp_common, pack_comp_l1, pack_comp_datasrc, pack_comp_linkframe,
+        pack_comp_decap;
+
+    friend class packet_filter_compiler;
+};
+
+#endif
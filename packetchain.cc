@@ -31,11 +31,16 @@
 #include "configfile.h"
 #include "globalregistry.h"
 #include "kis_datasource.h"
+#include "kis_thread_placement.h"
 #include "messagebus.h"
 #include "packet.h"
 #include "packetchain.h"
 
 #include "crc32.h"
+#include "kis_trace.h"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
 
 class SortLinkPriority {
 public:
@@ -47,27 +52,118 @@ public:
     }
 };
 
+std::atomic<size_t> packet_component_registry::next_slot{0};
+
+thread_local packet_chain::batch_context *packet_chain::thread_batch_ctx = nullptr;
+
+thread_local uint64_t packet_chain::thread_sample_rng =
+    std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1;
+
+thread_local unsigned int packet_chain::thread_trace_counter = 0;
+
+thread_local std::string packet_chain::thread_handler_owner;
+
+// Trace span names of the per-thread chain stages, in run order
+static const char *const trace_stage_names[] = {
+    "llcdissect", "decrypt", "datadissect", "classifier", "tracker", "logging"
+};
+
 packet_chain::packet_chain() {
     packetcomp_mutex.set_name("packetchain packet_comp");
     packetchain_mutex.set_name("packetchain packetchain");
-    pack_no_mutex.set_name("packetchain packetno");
 
     unique_packet_no = 1;
 
-    dedupe_list_pos = 0;
+    dedupe_hits = 0;
+    dedupe_misses = 0;
+    dedupe_evictions = 0;
 
     Globalreg::enable_pool_type<kis_tracked_packet>([](auto *a) { a->reset(); });
 
     next_componentid = 1;
 	next_handlerid = 1;
 
+    n_batch_handlers = 0;
+
+    for (unsigned int i = 0; i < MAX_PACKET_COMPONENT_POOLS; i++)
+        component_pools[i] = nullptr;
+
     last_packet_queue_user_warning = 0;
     last_packet_drop_user_warning = 0;
 
     packet_queue_warning = 
         Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_log_warning", 0);
-    packet_queue_drop =
+    packet_queue_drop_cfg =
         Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_backlog_limit", 8192);
+    packet_queue_drop = packet_queue_drop_cfg;
+
+    handler_stats_sample =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_handler_stats_sample", 0);
+
+    async_backlog = 0;
+    async_backlog_limit =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_async_backlog", 4096);
+    async_handler_names =
+        str_tokenize(Globalreg::globalreg->kismet_config->fetch_opt("packet_async_handlers"), ",", 0);
+
+    packet_backlog_block =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("packet_backlog_block", false);
+    packets_dropped = 0;
+    packets_error = 0;
+    packets_duplicate = 0;
+
+    // Nothing is shed when the capture path is held at the limit
+    drop_policy_enabled =
+        !packet_backlog_block &&
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("packet_drop_policy", true);
+    shed_duplicate_pct =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_drop_duplicates_pct", 50);
+    shed_fair_pct =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_drop_fairness_pct", 65);
+    shed_data_pct =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_drop_data_pct", 80);
+
+    for (size_t i = 0; i < n_source_slots; i++)
+        source_backlog[i] = 0;
+    total_backlog = 0;
+
+    shed_duplicates = 0;
+    shed_fairness = 0;
+    shed_data = 0;
+
+    sample_data_ratio =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_sample_data", 1);
+    sample_data_rate =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_sample_rate", 0);
+
+    for (size_t i = 0; i < n_sample_shards; i++) {
+        sample_shards[i] = std::unique_ptr<sample_shard>(new sample_shard());
+        sample_shards[i]->mutex.set_name(fmt::format("packetchain sample shard {}", i));
+    }
+
+    sampled_processed = 0;
+    sampled_skipped = 0;
+
+    auto dedupe_size =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_dedup_size", 2048);
+    auto dedupe_n_shards =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_dedup_shards", 16);
+    dedupe_max_age =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_dedup_timeout", 5);
+
+    if (dedupe_n_shards == 0)
+        dedupe_n_shards = 1;
+
+    dedupe_shard_depth = dedupe_size / dedupe_n_shards;
+    if (dedupe_shard_depth == 0)
+        dedupe_shard_depth = 1;
+
+    for (unsigned int i = 0; i < dedupe_n_shards; i++) {
+        auto shard = std::unique_ptr<dedupe_shard>(new dedupe_shard());
+        shard->mutex.set_name(fmt::format("packetchain dedupe shard {}", i));
+        shard->hash_map.reserve(dedupe_shard_depth);
+        dedupe_shards.push_back(std::move(shard));
+    }
 
     auto entrytracker = 
         Globalreg::fetch_mandatory_global_as<entry_tracker>();
@@ -125,12 +221,167 @@ packet_chain::packet_chain() {
     packet_processed_rrd =
         std::make_shared<kis_tracked_rrd<>>(packet_processed_rrd_id);
 
+    dedupe_hits_elem =
+        entrytracker->register_and_get_field_as<tracker_element_uint64>("kismet.packetchain.dedupe_hits",
+                tracker_element_factory<tracker_element_uint64>(),
+                "packets matched in the dedupe index");
+    dedupe_misses_elem =
+        entrytracker->register_and_get_field_as<tracker_element_uint64>("kismet.packetchain.dedupe_misses",
+                tracker_element_factory<tracker_element_uint64>(),
+                "packets not found in the dedupe index");
+    dedupe_evictions_elem =
+        entrytracker->register_and_get_field_as<tracker_element_uint64>("kismet.packetchain.dedupe_evictions",
+                tracker_element_factory<tracker_element_uint64>(),
+                "records evicted from the dedupe index");
+
+    handler_stats_vec_id =
+        entrytracker->register_field("kismet.packetchain.handlers",
+                tracker_element_factory<tracker_element_vector>(),
+                "packet chain handler timing");
+    handler_stat_id =
+        entrytracker->register_field("kismet.packetchain.handler.id",
+                tracker_element_factory<tracker_element_int32>(),
+                "handler id");
+    handler_stat_name_id =
+        entrytracker->register_field("kismet.packetchain.handler.name",
+                tracker_element_factory<tracker_element_string>(),
+                "handler name");
+    handler_stat_chain_id =
+        entrytracker->register_field("kismet.packetchain.handler.chain",
+                tracker_element_factory<tracker_element_string>(),
+                "packet chain");
+    handler_stat_priority_id =
+        entrytracker->register_field("kismet.packetchain.handler.priority",
+                tracker_element_factory<tracker_element_int32>(),
+                "handler priority in chain");
+    handler_stat_samples_id =
+        entrytracker->register_field("kismet.packetchain.handler.samples",
+                tracker_element_factory<tracker_element_uint64>(),
+                "number of timed calls");
+    handler_stat_min_id =
+        entrytracker->register_field("kismet.packetchain.handler.min_ns",
+                tracker_element_factory<tracker_element_uint64>(),
+                "minimum call time (ns)");
+    handler_stat_max_id =
+        entrytracker->register_field("kismet.packetchain.handler.max_ns",
+                tracker_element_factory<tracker_element_uint64>(),
+                "maximum call time (ns)");
+    handler_stat_mean_id =
+        entrytracker->register_field("kismet.packetchain.handler.mean_ns",
+                tracker_element_factory<tracker_element_uint64>(),
+                "mean call time (ns)");
+    handler_stat_p50_id =
+        entrytracker->register_field("kismet.packetchain.handler.p50_ns",
+                tracker_element_factory<tracker_element_uint64>(),
+                "50th percentile call time (ns)");
+    handler_stat_p90_id =
+        entrytracker->register_field("kismet.packetchain.handler.p90_ns",
+                tracker_element_factory<tracker_element_uint64>(),
+                "90th percentile call time (ns)");
+    handler_stat_p99_id =
+        entrytracker->register_field("kismet.packetchain.handler.p99_ns",
+                tracker_element_factory<tracker_element_uint64>(),
+                "99th percentile call time (ns)");
+    handler_stat_p999_id =
+        entrytracker->register_field("kismet.packetchain.handler.p999_ns",
+                tracker_element_factory<tracker_element_uint64>(),
+                "99.9th percentile call time (ns)");
+    handler_stat_owner_id =
+        entrytracker->register_field("kismet.packetchain.handler.owner",
+                tracker_element_factory<tracker_element_string>(),
+                "plugin which registered the handler");
+    handler_stat_async_id =
+        entrytracker->register_field("kismet.packetchain.handler.async",
+                tracker_element_factory<tracker_element_uint8>(),
+                "handler is called from the async stage");
+
+    shed_duplicates_elem =
+        entrytracker->register_and_get_field_as<tracker_element_uint64>("kismet.packetchain.shed_duplicates",
+                tracker_element_factory<tracker_element_uint64>(),
+                "duplicate packets shed by the drop policy");
+    shed_fairness_elem =
+        entrytracker->register_and_get_field_as<tracker_element_uint64>("kismet.packetchain.shed_fairness",
+                tracker_element_factory<tracker_element_uint64>(),
+                "packets shed by the drop policy from datasources over their backlog share");
+    shed_data_elem =
+        entrytracker->register_and_get_field_as<tracker_element_uint64>("kismet.packetchain.shed_data",
+                tracker_element_factory<tracker_element_uint64>(),
+                "data frames shed by the drop policy");
+
+    sampled_processed_elem =
+        entrytracker->register_and_get_field_as<tracker_element_uint64>("kismet.packetchain.sampled_processed",
+                tracker_element_factory<tracker_element_uint64>(),
+                "sampled data frames which were fully processed");
+    sampled_skipped_elem =
+        entrytracker->register_and_get_field_as<tracker_element_uint64>("kismet.packetchain.sampled_skipped",
+                tracker_element_factory<tracker_element_uint64>(),
+                "sampled data frames which were only counted");
+
+    reorder_late_elem =
+        entrytracker->register_and_get_field_as<tracker_element_uint64>("kismet.packetchain.reorder_late",
+                tracker_element_factory<tracker_element_uint64>(),
+                "packets which reached the reorder stage after a later packet was released");
+    reorder_early_elem =
+        entrytracker->register_and_get_field_as<tracker_element_uint64>("kismet.packetchain.reorder_early",
+                tracker_element_factory<tracker_element_uint64>(),
+                "packets released from the reorder stage early because it was full");
+
+    packets_filtered_elem =
+        entrytracker->register_and_get_field_as<tracker_element_uint64>("kismet.packetchain.filtered",
+                tracker_element_factory<tracker_element_uint64>(),
+                "packets discarded by the capture filter");
+    capture_filter_elem =
+        entrytracker->register_and_get_field_as<tracker_element_string>("kismet.packetchain.packet_filter",
+                tracker_element_factory<tracker_element_string>(),
+                "capture filter expression");
+
+    packet_threads_vec_id =
+        entrytracker->register_field("kismet.packetchain.threads",
+                tracker_element_factory<tracker_element_vector>(),
+                "packet processing threads");
+    packet_thread_id =
+        entrytracker->register_field("kismet.packetchain.thread.id",
+                tracker_element_factory<tracker_element_uint32>(),
+                "packet thread number");
+    packet_thread_depth_id =
+        entrytracker->register_field("kismet.packetchain.thread.queue_depth",
+                tracker_element_factory<tracker_element_uint64>(),
+                "packets queued for this thread");
+    packet_thread_processed_id =
+        entrytracker->register_field("kismet.packetchain.thread.processed",
+                tracker_element_factory<tracker_element_uint64>(),
+                "packets processed by this thread");
+    packet_thread_steals_id =
+        entrytracker->register_field("kismet.packetchain.thread.steals",
+                tracker_element_factory<tracker_element_uint64>(),
+                "assignment groups stolen from other threads");
+    packet_thread_busy_id =
+        entrytracker->register_field("kismet.packetchain.thread.busy_ns",
+                tracker_element_factory<tracker_element_uint64>(),
+                "time spent processing packets, in nanoseconds");
+    packet_thread_active_id =
+        entrytracker->register_field("kismet.packetchain.thread.active",
+                tracker_element_factory<tracker_element_uint8>(),
+                "thread is taking work, and not parked by the autoscaler");
+
     packet_stats_map = 
         std::make_shared<tracker_element_map>();
     packet_stats_map->insert(packet_peak_rrd);
     packet_stats_map->insert(packet_rate_rrd);
     packet_stats_map->insert(packet_error_rrd);
     packet_stats_map->insert(packet_dupe_rrd);
+    packet_stats_map->insert(dedupe_hits_elem);
+    packet_stats_map->insert(dedupe_misses_elem);
+    packet_stats_map->insert(dedupe_evictions_elem);
+    packet_stats_map->insert(shed_duplicates_elem);
+    packet_stats_map->insert(shed_fairness_elem);
+    packet_stats_map->insert(shed_data_elem);
+    packet_stats_map->insert(sampled_processed_elem);
+    packet_stats_map->insert(sampled_skipped_elem);
+    packet_stats_map->insert(packets_filtered_elem);
+    packet_stats_map->insert(reorder_late_elem);
+    packet_stats_map->insert(reorder_early_elem);
+    packet_stats_map->insert(capture_filter_elem);
     packet_stats_map->insert(packet_queue_rrd);
     packet_stats_map->insert(packet_drop_rrd);
     packet_stats_map->insert(packet_processed_rrd);
@@ -138,6 +389,34 @@ packet_chain::packet_chain() {
     packet_pool.set_max(1024);
     packet_pool.set_reset([](kis_packet *p) { p->reset(); });
 
+    auto buffer_classes = 
+        Globalreg::globalreg->kismet_config->fetch_opt_dfl("packet_buffer_classes", "256,2048,8192");
+    std::vector<size_t> buffer_sizes;
+
+    for (const auto& c : str_tokenize(buffer_classes, ",")) {
+        try {
+            auto sz = string_to_n<size_t>(c);
+            if (sz > 0)
+                buffer_sizes.push_back(sz);
+        } catch (const std::exception& e) {
+            _MSG_ERROR("Invalid packet_buffer_classes size '{}', expected a list of sizes in bytes", c);
+        }
+    }
+
+    if (buffer_sizes.size() == 0)
+        buffer_sizes.push_back(MAX_PACKET_LEN);
+
+    std::sort(buffer_sizes.begin(), buffer_sizes.end());
+
+    for (auto sz : buffer_sizes) {
+        auto bc = std::unique_ptr<packet_buffer_class>(new packet_buffer_class());
+        auto bcp = bc.get();
+        bc->size = sz;
+        bc->pool.set_max(1024);
+        bc->pool.set_reset([bcp](packet_data_buffer *) { bcp->in_use--; });
+        packet_buffer_classes.push_back(std::move(bc));
+    }
+
     auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
 
     // We now protect RRDs from complex ops w/ internal mutexes, so we can just share these 
@@ -158,9 +437,61 @@ packet_chain::packet_chain() {
             std::make_shared<kis_net_web_tracked_endpoint>(packet_drop_rrd));
     httpd->register_route("/packetchain/packet_processed", {"GET", "POST"}, httpd->RO_ROLE, {},
             std::make_shared<kis_net_web_tracked_endpoint>(packet_processed_rrd));
+    httpd->register_route("/packetchain/packet_threads", {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection>) {
+                    return packet_threads_endp_handler();
+                }));
+    httpd->register_route("/packetchain/handler_stats", {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection>) {
+                    return handler_stats_endp_handler();
+                }));
+    httpd->register_route("/packetchain/set_packet_filter", {"POST"}, httpd->LOGON_ROLE, {"cmd"},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    std::ostream stream(&con->response_stream());
+
+                    try {
+                        auto expression = con->json()["expression"].asString();
+                        set_packet_filter(expression);
+                        stream << "Packet filter: " << con->escape_html(expression) << "\n";
+                    } catch (const std::exception& e) {
+                        con->set_status(500);
+                        stream << "Invalid request: " << con->escape_html(e.what()) << "\n";
+                    }
+                }));
 
     packetchain_shutdown = false;
 
+    reorder_budget = std::chrono::microseconds(
+            Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("packet_reorder_usec", 0));
+    reorder_max =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("packet_reorder_max", 4096);
+    if (reorder_max == 0)
+        reorder_max = 1;
+    reorder_seq = 0;
+    reorder_last_ts = 0;
+    reorder_late = 0;
+    reorder_early = 0;
+
+    n_packet_threads = 0;
+    n_active_threads = 0;
+
+    autoscale_enabled = false;
+    autoscale_min_threads = 0;
+    autoscale_up_pct = 0;
+    autoscale_down_pct = 0;
+    autoscale_idle_checks = 0;
+    autoscale_idle_count = 0;
+    autoscale_last_busy = 0;
+    autoscale_timer_id = -1;
+
+    packet_group_batch =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("kismet_packet_group_batch", 64);
+    if (packet_group_batch == 0)
+        packet_group_batch = 1;
+
    timetracker = Globalreg::fetch_mandatory_global_as<time_tracker>();
     eventbus = Globalreg::fetch_mandatory_global_as<event_bus>();
 
@@ -168,12 +499,24 @@ packet_chain::packet_chain() {
         timetracker->register_timer(std::chrono::seconds(1), true, 
                 [this](int) -> int {
 
+                dedupe_hits_elem->set(dedupe_hits.load());
+                dedupe_misses_elem->set(dedupe_misses.load());
+                dedupe_evictions_elem->set(dedupe_evictions.load());
+                shed_duplicates_elem->set(shed_duplicates.load());
+                shed_fairness_elem->set(shed_fairness.load());
+                shed_data_elem->set(shed_data.load());
+                sampled_processed_elem->set(sampled_processed.load());
+                sampled_skipped_elem->set(sampled_skipped.load());
+                packets_filtered_elem->set(packets_filtered.load());
+                reorder_late_elem->set(reorder_late.load());
+                reorder_early_elem->set(reorder_early.load());
+
                 auto evt = eventbus->get_eventbus_event(event_packetstats());
                 evt->get_event_content()->insert(event_packetstats(), packet_stats_map);
                 eventbus->publish(evt);
 
                 return 1;
-                });
+                }, "packet_chain stats");
 
 	pack_comp_linkframe = register_packet_component("LINKFRAME");
 	pack_comp_decap = register_packet_component("DECAP");
@@ -181,6 +524,33 @@ packet_chain::packet_chain() {
     pack_comp_l1_agg = register_packet_component("RADIODATA_AGG");
 	pack_comp_datasource = register_packet_component("KISDATASRC");
 
+    // Filters are compiled once the components they use are registered
+    packets_filtered = 0;
+    capture_filter = packet_filter_program::compile("", this);
+
+    auto filter_expr =
+        Globalreg::globalreg->kismet_config->fetch_opt_dfl("packet_filter", "");
+
+    try {
+        capture_filter = packet_filter_program::compile(filter_expr, this);
+        capture_filter_elem->set(filter_expr);
+
+        if (filter_expr.length())
+            _MSG_INFO("Discarding packets which do not match the packet filter '{}'", filter_expr);
+    } catch (const std::exception& e) {
+        _MSG_ERROR("Ignoring packet_filter: {}", e.what());
+    }
+
+    auto keep_expr =
+        Globalreg::globalreg->kismet_config->fetch_opt_dfl("packet_drop_keep", "");
+
+    try {
+        if (keep_expr.length())
+            drop_keep_filter = packet_filter_program::compile(keep_expr, this);
+    } catch (const std::exception& e) {
+        _MSG_ERROR("Ignoring packet_drop_keep: {}", e.what());
+    }
+
     // Checksum and dedupe function runs at the end of LLC dissection, which should be
     // after any phy demangling and DLT demangling; lock the packet for the rest of the 
     // packet chain
@@ -196,87 +566,161 @@ packet_chain::packet_chain() {
         // Lock every packet at the beginning of the dupe check
         in_pack->mutex.lock();
 
-        kis_lock_guard<kis_shared_mutex> lk(pack_no_mutex, "hash handler");
+        in_pack->hash = crc32_hw(chunk->data(), chunk->length(), 0);
 
-        in_pack->hash = crc32_16bytes_prefetch(chunk->data(), chunk->length(), 0);
+        time_t now = Globalreg::globalreg->last_tv_sec;
+        auto shard = dedupe_shards[in_pack->hash % dedupe_shards.size()].get();
+        std::shared_ptr<kis_packet> original_pkt;
+        uint64_t original_packno = 0;
 
-        for (unsigned int i = 0; i < 1024; i++) {
-            if (dedupe_list[i].hash == in_pack->hash) {
-                in_pack->duplicate = true;
-                in_pack->packet_no = dedupe_list[i].packno;
-                in_pack->original = dedupe_list[i].original_pkt;
+        {
+            kis_lock_guard<kis_fast_mutex> lk(shard->mutex, "hash handler");
 
-                // We have to wait until everything is done being changed in the packet
-                // before we can copy the duplicate decoded state over, grab the lock that
-                // is released at the end of the chain
-                kis_lock_guard<kis_mutex> lg(dedupe_list[i].original_pkt->mutex);
-                for (unsigned int c = 0; c < MAX_PACKET_COMPONENTS; c++) {
-                    auto cp = dedupe_list[i].original_pkt->content_vec[c];
-                    if (cp != nullptr) {
-                        if (cp->unique())
-                            continue;
+            dedupe_expire_shard(shard, now);
 
-                        in_pack->content_vec[c] = cp;
-                    }
-                }
+            auto dk = shard->hash_map.find(in_pack->hash);
 
-                // Merge the signal levels
-                if (in_pack->has(pack_comp_l1) && in_pack->has(pack_comp_datasource)) {
-                    auto l1 = in_pack->original->fetch<kis_layer1_packinfo>(pack_comp_l1);
-                    auto radio_agg = in_pack->fetch_or_add<kis_layer1_aggregate_packinfo>(pack_comp_l1_agg);
-                    auto datasrc = in_pack->fetch<packetchain_comp_datasource>(pack_comp_datasource);
-                    radio_agg->source_l1_map[datasrc->ref_source->get_source_uuid()] = l1;
-                }
+            if (dk != shard->hash_map.end()) {
+                original_pkt = dk->second.original_pkt;
+                original_packno = dk->second.packno;
+            } else {
+                // Assign a new packet number and cache it in the dedupe
+                in_pack->packet_no = unique_packet_no++;
+
+                auto& rec = shard->hash_map[in_pack->hash];
+                rec.hash = in_pack->hash;
+                rec.packno = in_pack->packet_no;
+                rec.ts = now;
+                rec.original_pkt = in_pack;
+
+                shard->fifo.push_back(std::make_pair(in_pack->hash, in_pack->packet_no));
+            }
+        }
+
+        if (original_pkt == nullptr) {
+            dedupe_misses++;
+            return 1;
+        }
 
+        // We have to wait until everything is done being changed in the packet
+        // before we can copy the duplicate decoded state over, grab the lock that
+        // is released at the end of the chain.  The shard lock is released first
+        // so other packets hashing to this shard aren't held behind the original.
+        //
+        // Under batch dispatch this thread may hold the original itself (in the same
+        // batch), and other threads hold their whole batch until logging completes, so
+        // we can't block; defer the packet until our batch is done instead.
+        std::unique_lock<kis_fast_mutex> lg(original_pkt->mutex, std::defer_lock);
+
+        auto ctx = thread_batch_ctx;
+
+        if (ctx != nullptr) {
+            auto in_batch =
+                std::find(ctx->batch->begin(), ctx->batch->end(), original_pkt) != ctx->batch->end();
+
+            if (in_batch || !lg.try_lock()) {
+                ctx->deferred.push_back(in_pack);
+                in_pack->mutex.unlock();
+                return 1;
             }
+        } else {
+            lg.lock();
         }
 
-        // Assign a new packet number and cache it in the dedupe
-        if (!in_pack->duplicate) {
-            auto listpos = dedupe_list_pos++ % 1024;
-            in_pack->packet_no = unique_packet_no++;
-            dedupe_list[listpos].hash = in_pack->hash;
-            dedupe_list[listpos].packno = unique_packet_no++;
-            dedupe_list[listpos].original_pkt = in_pack;
+        dedupe_hits++;
+
+        in_pack->duplicate = true;
+        in_pack->packet_no = original_packno;
+        in_pack->original = original_pkt;
+
+        for (unsigned int c = 0; c < MAX_PACKET_COMPONENTS; c++) {
+            auto cp = original_pkt->content_vec[c];
+            if (cp != nullptr) {
+                if (cp->unique())
+                    continue;
+
+                in_pack->content_vec[c] = cp;
+            }
+        }
+
+        lg.unlock();
+
+        // Merge the signal levels
+        if (in_pack->has(pack_comp_l1) && in_pack->has(pack_comp_datasource)) {
+            auto l1 = in_pack->original->fetch<kis_layer1_packinfo>(pack_comp_l1);
+            auto radio_agg = in_pack->fetch_or_add<kis_layer1_aggregate_packinfo>(pack_comp_l1_agg);
+            auto datasrc = in_pack->fetch<packetchain_comp_datasource>(pack_comp_datasource);
+            radio_agg->source_l1_map[datasrc->ref_source->get_source_uuid()] = l1;
         }
 
         return 1;
-    }, CHAINPOS_LLCDISSECT, 10000);
+    }, CHAINPOS_LLCDISSECT, 10000, "packet_chain dedupe");
+
+    // Data frames are sampled once they're dissected and known not to be duplicates;
+    // see packet_sample_data
+    if (sample_data_ratio > 1 || sample_data_rate > 0) {
+        _MSG_INFO("Sampling 802.11 data frames, fully processing 1 in {} data frames per "
+                "transmitter{}", std::max(1U, sample_data_ratio),
+                sample_data_rate > 0 ? 
+                    fmt::format(", or about {} per second per datasource", sample_data_rate) : "");
+
+        register_handler([this](std::shared_ptr<kis_packet> in_pack) -> int {
+            packet_sample_data(in_pack);
+            return 1;
+        }, CHAINPOS_LLCDISSECT, 20000, "packet_chain data sampling");
+    }
 
     // Unlock at the end of logging
     register_handler([](std::shared_ptr<kis_packet> in_pack) -> int {
         in_pack->mutex.unlock();
         return 1;
-    }, CHAINPOS_LOGGING, 1000000);
+    }, CHAINPOS_LOGGING, 1000000, "packet_chain unlock");
 
 }
 
 packet_chain::~packet_chain() {
     timetracker->remove_timer(event_timer_id);
 
+    if (autoscale_timer_id >= 0)
+        timetracker->remove_timer(autoscale_timer_id);
+
     {
-        // Tell the packet thread we're dying and unlock it
-        packetchain_shutdown = true;
+        // Stop the reorder stage first; anything it still holds is discarded
+        {
+            std::lock_guard<std::mutex> lk(reorder_mutex);
+            packetchain_shutdown = true;
+        }
+        reorder_cv.notify_all();
 
-        // packet_queue.enqueue(nullptr);
+        if (reorder_thread.joinable())
+            reorder_thread.join();
 
-        for (size_t i = 0; i < n_packet_threads; i++) {
-            auto t = packet_threads[i];
+        while (!reorder_queue.empty())
+            reorder_queue.pop();
 
-            if (t == nullptr)
-                continue;
+        // Tell the packet threads we're dying and wake them all up, including any
+        // which are parked
+        packetchain_shutdown = true;
 
-            t->packet_queue.enqueue(nullptr);
+        packet_runq_sem.signal(static_cast<int>(n_packet_threads));
 
-            if (t->packet_thread.joinable())
-                t->packet_thread.join();
+        {
+            std::lock_guard<std::mutex> lk(park_mutex);
+        }
+        park_cv.notify_all();
 
-            delete(t);
-            packet_threads[i] = nullptr;
+        for (auto& t : packet_threads) {
+            if (t->thread.joinable())
+                t->thread.join();
         }
 
-        delete[] packet_threads;
-        packet_threads = nullptr;
+        packet_threads.clear();
+        packet_groups.clear();
+
+        if (async_thread.joinable()) {
+            async_queue.enqueue(async_rec{-1, nullptr});
+            async_thread.join();
+        }
     }
 
     {
@@ -320,21 +764,190 @@ packet_chain::~packet_chain() {
 void packet_chain::start_processing() {
     n_packet_threads = Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("kismet_packet_threads", 0);
 
-    if (n_packet_threads == 0)
-        n_packet_threads = static_cast<unsigned int>(std::thread::hardware_concurrency());
+    if (n_packet_threads == 0) {
+        auto placer = Globalreg::fetch_global_as<kis_thread_placement>();
+
+        if (placer != nullptr)
+            n_packet_threads = placer->get_num_cpus();
+        else
+            n_packet_threads = static_cast<unsigned int>(std::thread::hardware_concurrency());
+    }
+
+    auto n_groups =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("kismet_packet_groups", 256);
+
+    if (n_groups < n_packet_threads)
+        n_groups = n_packet_threads;
+
+    for (unsigned int g = 0; g < n_groups; g++) {
+        auto group = std::unique_ptr<packet_group>(new packet_group());
+        group->mutex.set_name(fmt::format("packetchain group {}", g));
+        group->home = g % n_packet_threads;
+        packet_groups.push_back(std::move(group));
+    }
+
+    for (unsigned int n = 0; n < n_packet_threads; n++) {
+        auto t = std::unique_ptr<packet_thread>(new packet_thread());
+        t->runq_mutex.set_name(fmt::format("packetchain runq {}", n));
+        packet_threads.push_back(std::move(t));
+    }
 
-    packet_threads = new packet_thread*[n_packet_threads];
+    // Autoscaled threads start at the minimum and grow with the load; every thread is
+    // created up front so growing only has to wake a parked thread
+    autoscale_enabled =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("packet_thread_autoscale", false);
+    autoscale_min_threads =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("packet_threads_min", 1);
+    autoscale_up_pct =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("packet_thread_autoscale_up_pct", 75);
+    autoscale_down_pct =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("packet_thread_autoscale_down_pct", 25);
+    autoscale_idle_checks =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("packet_thread_autoscale_idle", 6);
+    auto autoscale_interval =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("packet_thread_autoscale_interval", 5);
+
+    if (autoscale_min_threads == 0)
+        autoscale_min_threads = 1;
+    if (autoscale_min_threads > n_packet_threads)
+        autoscale_min_threads = n_packet_threads;
+    if (autoscale_down_pct >= autoscale_up_pct)
+        autoscale_down_pct = autoscale_up_pct / 2;
+    if (autoscale_interval == 0)
+        autoscale_interval = 1;
+
+    if (autoscale_enabled && autoscale_min_threads < n_packet_threads) {
+        n_active_threads = autoscale_min_threads;
+
+        _MSG_INFO("Autoscaling between {} and {} packet threads", autoscale_min_threads,
+                n_packet_threads);
+
+        autoscale_last_check = std::chrono::steady_clock::now();
+        autoscale_timer_id =
+            timetracker->register_timer(std::chrono::seconds(autoscale_interval), true,
+                    [this](int) -> int {
+                        packet_autoscale();
+                        return 1;
+                    }, "packet_chain autoscale");
+    } else {
+        autoscale_enabled = false;
+        n_active_threads = n_packet_threads;
+    }
 
     for (unsigned int n = 0; n < n_packet_threads; n++) {
-        packet_threads[n] = new packet_thread();
-        packet_threads[n]->packet_thread = 
+        packet_threads[n]->thread = 
             std::thread([this, n]() {
             auto name = fmt::format("PACKET {}/{}", n, n_packet_threads);
             thread_set_process_name(name);
-            packet_queue_processor(&packet_threads[n]->packet_queue);
+            kis_thread_placement::place_current_thread(name,
+                    kis_thread_placement::thread_role::packet, n);
+            packet_queue_processor(n);
         });
     }
 
+    if (reorder_budget.count() != 0) {
+        _MSG_INFO("Reordering packets from all datasources by capture time, holding "
+                "packets for up to {}us", reorder_budget.count());
+
+        reorder_thread = std::thread([this]() {
+            thread_set_process_name("PACKET REORDER");
+            kis_thread_placement::place_current_thread("PACKET REORDER",
+                    kis_thread_placement::thread_role::packet, n_packet_threads);
+            packet_reorder_processor();
+        });
+    }
+}
+
+void packet_chain::packet_reorder_insert(std::shared_ptr<kis_packet> in_pack, time_t now) {
+    auto ts = static_cast<uint64_t>(in_pack->ts.tv_sec) * 1000000ULL + in_pack->ts.tv_usec;
+
+    std::unique_lock<std::mutex> lk(reorder_mutex);
+
+    // Already behind the packets we've released, pass it through as it is
+    if (ts < reorder_last_ts) {
+        reorder_late++;
+        packet_enqueue(in_pack, now);
+        return;
+    }
+
+    // Out of room; release the oldest packet early to make space
+    if (reorder_queue.size() >= reorder_max) {
+        auto& top = reorder_queue.top();
+        reorder_last_ts = top.ts_usec;
+        packet_enqueue(top.packet, now);
+        reorder_queue.pop();
+        reorder_early++;
+
+        if (ts < reorder_last_ts) {
+            reorder_late++;
+            packet_enqueue(in_pack, now);
+            return;
+        }
+    }
+
+    // Only wake the release thread when the next packet due changes
+    bool wake = reorder_queue.empty() || reorder_later()(reorder_queue.top(),
+            reorder_rec{ts, reorder_seq, {}, nullptr});
+
+    reorder_queue.push(reorder_rec{ts, reorder_seq++, 
+            std::chrono::steady_clock::now() + reorder_budget, in_pack});
+
+    lk.unlock();
+
+    if (wake)
+        reorder_cv.notify_one();
+}
+
+void packet_chain::packet_reorder_processor() {
+    std::unique_lock<std::mutex> lk(reorder_mutex);
+
+    while (!packetchain_shutdown) {
+        if (reorder_queue.empty()) {
+            reorder_cv.wait(lk);
+            continue;
+        }
+
+        // The oldest packet is released once it has waited out the budget; packets
+        // behind it wait for it, so the release order always follows capture time
+        auto deadline = reorder_queue.top().deadline;
+
+        if (std::chrono::steady_clock::now() < deadline) {
+            reorder_cv.wait_until(lk, deadline);
+            continue;
+        }
+
+        auto now = (time_t) Globalreg::globalreg->last_tv_sec;
+
+        while (!reorder_queue.empty() && 
+                reorder_queue.top().deadline <= std::chrono::steady_clock::now()) {
+            auto& top = reorder_queue.top();
+            reorder_last_ts = top.ts_usec;
+            packet_enqueue(top.packet, now);
+            reorder_queue.pop();
+        }
+    }
+}
+
+void packet_chain::dedupe_expire_shard(dedupe_shard *shard, time_t now) {
+    while (!shard->fifo.empty()) {
+        const auto& head = shard->fifo.front();
+
+        auto dk = shard->hash_map.find(head.first);
+
+        // Stale fifo record for an entry which has already been removed
+        if (dk == shard->hash_map.end() || dk->second.packno != head.second) {
+            shard->fifo.pop_front();
+            continue;
+        }
+
+        if (shard->fifo.size() <= dedupe_shard_depth &&
+                (dedupe_max_age == 0 || now - dk->second.ts <= dedupe_max_age))
+            break;
+
+        shard->hash_map.erase(dk);
+        shard->fifo.pop_front();
+        dedupe_evictions++;
+    }
 }
 
 int packet_chain::register_packet_component(std::string in_component) {
@@ -391,91 +1004,905 @@ std::shared_ptr<kis_packet> packet_chain::generate_packet() {
     // return std::make_shared<kis_packet>();
 }
 
-void packet_chain::packet_queue_processor(moodycamel::BlockingConcurrentQueue<std::shared_ptr<kis_packet>> *packet_queue) {
-    std::shared_ptr<kis_packet> packet;
+std::shared_ptr<packet_data_buffer> packet_chain::new_packet_buffer(size_t in_len) {
+    for (const auto& bc : packet_buffer_classes) {
+        if (in_len > bc->size)
+            continue;
 
-    while (!packetchain_shutdown && 
-            !Globalreg::globalreg->spindown && 
-            !Globalreg::globalreg->fatal_condition &&
-            !Globalreg::globalreg->complete) {
+        std::shared_ptr<packet_data_buffer> buf = bc->pool.acquire();
+        buf->reserve(bc->size);
+        bc->in_use++;
 
-        packet_queue->wait_dequeue(packet);
+        return buf;
+    }
+
+    auto buf = std::make_shared<packet_data_buffer>();
+    buf->reserve(in_len);
+    return buf;
+}
+
+std::vector<packet_chain::packet_buffer_stats> packet_chain::get_packet_buffer_stats() {
+    std::vector<packet_buffer_stats> ret;
+
+    for (const auto& bc : packet_buffer_classes)
+        ret.push_back(packet_buffer_stats{bc->size, bc->in_use.load(), bc->pool.size()});
+
+    return ret;
+}
+
+uint64_t packet_chain::get_packets_in_flight() {
+    uint64_t n = 0;
+
+    for (const auto& t : packet_threads)
+        n += t->queue_depth.load();
+
+    return n;
+}
+
+uint64_t packet_chain::get_packets_processed() {
+    uint64_t n = 0;
+
+    for (const auto& t : packet_threads)
+        n += t->processed.load();
+
+    return n;
+}
+
+std::vector<packet_chain::packet_thread_stats> packet_chain::get_packet_thread_stats() {
+    std::vector<packet_thread_stats> ret;
+
+    auto active = n_active_threads.load();
+
+    for (size_t n = 0; n < packet_threads.size(); n++) {
+        const auto& t = packet_threads[n];
+        ret.push_back(packet_thread_stats{t->queue_depth.load(), t->processed.load(),
+                t->steals.load(), t->busy_ns.load(), n < active});
+    }
+
+    return ret;
+}
+
+std::vector<packet_chain::packet_handler_stats> packet_chain::get_handler_stats() {
+    std::vector<packet_handler_stats> ret;
+
+    std::shared_lock<kis_shared_mutex> lk(packetchain_mutex);
+
+    const std::vector<pc_link *> *chains[] = {
+        &postcap_chain, &llcdissect_chain, &decrypt_chain, &datadissect_chain,
+        &classifier_chain, &tracker_chain, &logging_chain
+    };
+
+    for (const auto c : chains) {
+        for (const auto pcl : *c) {
+            const auto& h = pcl->stats;
+            packet_handler_stats s;
+
+            s.id = pcl->id;
+            s.name = pcl->name;
+            s.chain = chain_name(pcl->chain);
+            s.priority = pcl->priority;
+            s.samples = h->get_count();
+            s.min = h->get_min();
+            s.max = h->get_max();
+            s.mean = s.samples == 0 ? 0 : h->get_sum() / s.samples;
+            s.p50 = h->percentile(50);
+            s.p90 = h->percentile(90);
+            s.p99 = h->percentile(99);
+            s.p999 = h->percentile(99.9);
+            s.owner = pcl->owner;
+            s.async = pcl->async;
+
+            ret.push_back(s);
+        }
+    }
+
+    return ret;
+}
+
+std::vector<packet_chain::packet_owner_stats> packet_chain::get_owner_stats() {
+    std::map<std::string, packet_owner_stats> owners;
 
-        if (packet == nullptr)
+    std::shared_lock<kis_shared_mutex> lk(packetchain_mutex);
+
+    const std::vector<pc_link *> *chains[] = {
+        &postcap_chain, &llcdissect_chain, &decrypt_chain, &datadissect_chain,
+        &classifier_chain, &tracker_chain, &logging_chain
+    };
+
+    for (const auto c : chains) {
+        for (const auto pcl : *c) {
+            if (pcl->cost == nullptr)
+                continue;
+
+            auto& o = owners.emplace(pcl->owner, packet_owner_stats{pcl->owner, 0, 0, 0, 0, 0, 0, 0}).first->second;
+
+            o.handlers++;
+            if (pcl->async)
+                o.async_handlers++;
+            o.calls += pcl->cost->calls.load();
+            o.wall_ns += pcl->cost->wall_ns.load();
+            o.cpu_ns += pcl->cost->cpu_ns.load();
+            o.async_queued += pcl->cost->async_queued.load();
+            o.async_dropped += pcl->cost->async_dropped.load();
+        }
+    }
+
+    std::vector<packet_owner_stats> ret;
+
+    for (const auto& o : owners)
+        ret.push_back(o.second);
+
+    return ret;
+}
+
+void packet_chain::packet_async_processor() {
+    async_rec r;
+
+    while (true) {
+        async_queue.wait_dequeue(r);
+
+        if (r.link_id < 0)
             break;
 
-        {
-            // Lock the chain mutexes until we're done processing this packet
-            std::shared_lock<kis_shared_mutex> lk(packetchain_mutex);
-
-            // These can only be perturbed inside a sync, which can only occur when
-            // the worker thread is in the sync block above, so we shouldn't
-            // need to worry about the integrity of these vectors while running
-
-            /* Postcap is now handled before it gets into the per-thread chain
-            for (const auto& pcl : postcap_chain) {
-                if (pcl->callback != nullptr)
-                    pcl->callback(pcl->auxdata, packet);
-                else if (pcl->l_callback != nullptr)
-                    pcl->l_callback(packet);
+        async_backlog--;
+
+        std::shared_lock<kis_shared_mutex> lk(packetchain_mutex);
+
+        auto li = async_links.find(r.link_id);
+
+        if (li == async_links.end())
+            continue;
+
+        packet_call_link_costed(li->second, r.packet, nullptr);
+    }
+}
+
+std::string packet_chain::chain_name(int in_chain) {
+    switch (in_chain) {
+        case CHAINPOS_POSTCAP:
+            return "postcap";
+        case CHAINPOS_LLCDISSECT:
+            return "llcdissect";
+        case CHAINPOS_DECRYPT:
+            return "decrypt";
+        case CHAINPOS_DATADISSECT:
+            return "datadissect";
+        case CHAINPOS_CLASSIFIER:
+            return "classifier";
+        case CHAINPOS_TRACKER:
+            return "tracker";
+        case CHAINPOS_LOGGING:
+            return "logging";
+    }
+
+    return "unknown";
+}
+
+std::shared_ptr<tracker_element> packet_chain::handler_stats_endp_handler() {
+    auto ret = std::make_shared<tracker_element_vector>(handler_stats_vec_id);
+
+    for (const auto& s : get_handler_stats()) {
+        auto hmap = std::make_shared<tracker_element_map>();
+        hmap->insert(std::make_shared<tracker_element_int32>(handler_stat_id, s.id));
+        hmap->insert(std::make_shared<tracker_element_string>(handler_stat_name_id, s.name));
+        hmap->insert(std::make_shared<tracker_element_string>(handler_stat_chain_id, s.chain));
+        hmap->insert(std::make_shared<tracker_element_int32>(handler_stat_priority_id, s.priority));
+        hmap->insert(std::make_shared<tracker_element_uint64>(handler_stat_samples_id, s.samples));
+        hmap->insert(std::make_shared<tracker_element_uint64>(handler_stat_min_id, s.min));
+        hmap->insert(std::make_shared<tracker_element_uint64>(handler_stat_max_id, s.max));
+        hmap->insert(std::make_shared<tracker_element_uint64>(handler_stat_mean_id, s.mean));
+        hmap->insert(std::make_shared<tracker_element_uint64>(handler_stat_p50_id, s.p50));
+        hmap->insert(std::make_shared<tracker_element_uint64>(handler_stat_p90_id, s.p90));
+        hmap->insert(std::make_shared<tracker_element_uint64>(handler_stat_p99_id, s.p99));
+        hmap->insert(std::make_shared<tracker_element_uint64>(handler_stat_p999_id, s.p999));
+        hmap->insert(std::make_shared<tracker_element_string>(handler_stat_owner_id, s.owner));
+        hmap->insert(std::make_shared<tracker_element_uint8>(handler_stat_async_id, s.async));
+
+        ret->push_back(hmap);
+    }
+
+    return ret;
+}
+
+std::shared_ptr<tracker_element> packet_chain::packet_threads_endp_handler() {
+    auto ret = std::make_shared<tracker_element_vector>(packet_threads_vec_id);
+
+    auto stats = get_packet_thread_stats();
+
+    for (size_t n = 0; n < stats.size(); n++) {
+        const auto& t = stats[n];
+
+        auto tmap = std::make_shared<tracker_element_map>();
+        tmap->insert(std::make_shared<tracker_element_uint32>(packet_thread_id, n));
+        tmap->insert(std::make_shared<tracker_element_uint64>(packet_thread_depth_id, t.queue_depth));
+        tmap->insert(std::make_shared<tracker_element_uint64>(packet_thread_processed_id, t.processed));
+        tmap->insert(std::make_shared<tracker_element_uint64>(packet_thread_steals_id, t.steals));
+        tmap->insert(std::make_shared<tracker_element_uint64>(packet_thread_busy_id, t.busy_ns));
+        tmap->insert(std::make_shared<tracker_element_uint8>(packet_thread_active_id, t.active));
+
+        ret->push_back(tmap);
+    }
+
+    return ret;
+}
+
+packet_chain::packet_group *packet_chain::packet_fetch_group(unsigned int thread_n) {
+    // Every group on a run queue holds one semaphore count, so once we've taken a
+    // count there is a group somewhere for us; check our own queue first, then
+    // steal from the other threads starting with our neighbor
+    while (!packetchain_shutdown) {
+        for (size_t i = 0; i < n_packet_threads; i++) {
+            auto victim = (thread_n + i) % n_packet_threads;
+            auto& t = packet_threads[victim];
+
+            kis_lock_guard<kis_fast_mutex> lk(t->runq_mutex, "packet_fetch_group");
+
+            if (t->run_queue.empty())
+                continue;
+
+            packet_group *group;
+
+            if (victim == thread_n) {
+                group = t->run_queue.front();
+                t->run_queue.pop_front();
+            } else {
+                // Steal from the far end of the victims queue, the group it would
+                // get to last
+                group = t->run_queue.back();
+                t->run_queue.pop_back();
+                packet_threads[thread_n]->steals++;
+            }
+
+            return group;
+        }
+
+        // A group was queued but picked up out from under us by a thread which
+        // hadn't consumed its own count yet; it will be along shortly
+        std::this_thread::yield();
+    }
+
+    return nullptr;
+}
+
+void packet_chain::packet_run_group(unsigned int thread_n, packet_group *group) {
+    auto& home = packet_threads[group->home];
+
+    kis_trace_span span("packetchain", "packet group");
+
+    packet_batch batch;
+    batch.reserve(packet_group_batch);
+
+    {
+        kis_lock_guard<kis_fast_mutex> lk(group->mutex, "packet_run_group");
+
+        if (group->queue.empty()) {
+            group->scheduled = false;
+            return;
+        }
+
+        while (!group->queue.empty() && batch.size() < packet_group_batch) {
+            batch.push_back(std::move(group->queue.front()));
+            group->queue.pop_front();
+        }
+    }
+
+    home->queue_depth -= batch.size();
+
+    span.set_arg(batch.size());
+
+    if (n_batch_handlers > 0 && batch.size() > 1) {
+        packet_run_batch(batch);
+    } else {
+        for (const auto& packet : batch)
+            packet_run_chains(packet);
+    }
+
+    packet_threads[thread_n]->processed += batch.size();
+
+    // If the group still has work put it back on our own queue, still scheduled, 
+    // so other groups get a turn (or another thread can steal it)
+    {
+        kis_lock_guard<kis_fast_mutex> lk(group->mutex, "packet_run_group");
+
+        if (group->queue.empty()) {
+            group->scheduled = false;
+            return;
+        }
+    }
+
+    {
+        auto& t = packet_threads[thread_n];
+        kis_lock_guard<kis_fast_mutex> lk(t->runq_mutex, "packet_run_group");
+        t->run_queue.push_back(group);
+    }
+
+    packet_runq_sem.signal();
+}
+
+void packet_chain::packet_run_chains(std::shared_ptr<kis_packet> packet) {
+    {
+        // Lock the chain mutexes until we're done processing this packet
+        std::shared_lock<kis_shared_mutex> lk(packetchain_mutex);
+
+        // These can only be perturbed inside a sync, which can only occur when
+        // the worker thread is in the sync block above, so we shouldn't
+        // need to worry about the integrity of these vectors while running
+
+        /* Postcap is now handled before it gets into the per-thread chain
+        for (const auto& pcl : postcap_chain)
+            packet_call_link(pcl, packet);
+        */
+
+        packet_run_from(packet, 0, nullptr, 0);
+    }
+
+    packet_complete(packet);
+}
+
+const packet_chain::pc_route_table& packet_chain::packet_route(size_t in_chain,
+        const std::shared_ptr<kis_packet>& in_pack) const {
+    const auto& dlt_routes = chain_dlt_routes[in_chain];
+
+    if (dlt_routes.size() == 0)
+        return chain_routes[in_chain];
+
+    auto chunk = in_pack->fetch<kis_datachunk>(pack_comp_decap, pack_comp_linkframe);
+
+    if (chunk == nullptr)
+        return chain_routes[in_chain];
+
+    auto ri = dlt_routes.find(chunk->dlt);
+
+    if (ri == dlt_routes.end())
+        return chain_routes[in_chain];
+
+    return ri->second;
+}
+
+void packet_chain::rebuild_routes() {
+    auto chains = run_chains();
+
+    for (size_t c = 0; c < chains.size(); c++) {
+        const auto& chain = *chains[c];
+        auto& dlt_routes = chain_dlt_routes[c];
+        auto& routes = chain_routes[c];
+
+        dlt_routes.clear();
+        routes.clear();
+
+        for (const auto& pcl : chain) {
+            for (auto d : pcl->dlts)
+                dlt_routes[d];
+        }
+
+        // Chains are already in priority order, and so are the tables built from them
+        for (const auto& pcl : chain) {
+            if (pcl->dlts.size() == 0) {
+                routes.push_back(pc_route{pcl, pcl->component});
+
+                for (auto& t : dlt_routes)
+                    t.second.push_back(pc_route{pcl, pcl->component});
+
+                continue;
             }
-            */
 
-            for (const auto& pcl : llcdissect_chain) {
-                if (pcl->callback != nullptr)
-                    pcl->callback(pcl->auxdata, packet);
-                else if (pcl->l_callback != nullptr)
-                    pcl->l_callback(packet);
+            // Handlers routed on DLT are always called for their own DLTs, and for
+            // other DLTs only when they have the component
+            for (auto& t : dlt_routes) {
+                if (std::find(pcl->dlts.begin(), pcl->dlts.end(), t.first) != pcl->dlts.end())
+                    t.second.push_back(pc_route{pcl, -1});
+                else if (pcl->component >= 0)
+                    t.second.push_back(pc_route{pcl, pcl->component});
             }
 
-            for (const auto& pcl : decrypt_chain) {
-                if (pcl->callback != nullptr)
-                    pcl->callback(pcl->auxdata, packet);
-                else if (pcl->l_callback != nullptr)
-                    pcl->l_callback(packet);
+            if (pcl->component >= 0)
+                routes.push_back(pc_route{pcl, pcl->component});
+        }
+    }
+}
+
+void packet_chain::packet_run_from(std::shared_ptr<kis_packet> packet, size_t chain_pos,
+        const pc_route_table *route, size_t link_pos) {
+    // Only a sample of packets are traced per stage, the group span covers the rest
+    auto trace_sample = kis_tracer::packet_sample();
+    bool trace = trace_sample != 0 && (++thread_trace_counter % trace_sample) == 0;
+
+    for (size_t c = chain_pos; c < PACKET_RUN_CHAINS; c++) {
+        // Data frames skipped by sampling go straight from dissection to logging
+        if (packet->sample_weight == 0 && c > 0 && c != PACKET_RUN_CHAINS - 1)
+            continue;
+
+        // The route is looked up per chain, as dissection may decapsulate the packet
+        const auto& table = (c == chain_pos && route != nullptr) ? *route : packet_route(c, packet);
+
+        kis_trace_span span("packetchain", trace ? trace_stage_names[c] : nullptr);
+
+        for (size_t l = (c == chain_pos ? link_pos : 0); l < table.size(); l++) {
+            const auto& r = table[l];
+
+            if (r.component >= 0 && !packet->has(r.component))
+                continue;
+
+            packet_call_link(r.link, packet);
+        }
+    }
+}
+
+void packet_chain::packet_run_batch(packet_batch& batch) {
+    // Packets which had to wait on an original packet, and where in the chain to
+    // resume them
+    struct resume_rec {
+        std::shared_ptr<kis_packet> packet;
+        size_t chain_pos;
+        const pc_route_table *route;
+        size_t link_pos;
+    };
+
+    std::vector<resume_rec> resume_vec;
+
+    batch_context ctx;
+    ctx.batch = &batch;
+
+    {
+        // Lock the chain mutexes until we're done processing this batch
+        std::shared_lock<kis_shared_mutex> lk(packetchain_mutex);
+
+        packet_batch active = batch;
+
+        // Data frames skipped by sampling, held out of the batch until logging
+        packet_batch skipped;
+
+        thread_batch_ctx = &ctx;
+
+        size_t c;
+
+        // Run part of the batch through the route table of a chain
+        auto run_route = [&](const pc_route_table& table, packet_batch& part) {
+            packet_batch with;
+
+            for (size_t l = 0; l < table.size(); l++) {
+                const auto& r = table[l];
+
+                if (r.link->b_callback != nullptr) {
+                    if (r.component < 0) {
+                        packet_call_batch_link(r.link, part);
+                    } else {
+                        with.clear();
+
+                        for (const auto& packet : part) {
+                            if (packet->has(r.component))
+                                with.push_back(packet);
+                        }
+
+                        if (with.size())
+                            packet_call_batch_link(r.link, with);
+                    }
+                } else {
+                    for (const auto& packet : part) {
+                        if (r.component >= 0 && !packet->has(r.component))
+                            continue;
+
+                        packet_call_link(r.link, packet);
+                    }
+                }
+
+                if (ctx.deferred.size() == 0)
+                    continue;
+
+                // Pull deferred packets out of the rest of the batch; they resume at
+                // the link which deferred them once the batch is finished
+                for (const auto& d : ctx.deferred) {
+                    resume_vec.push_back(resume_rec{d, c, &table, l});
+                    part.erase(std::remove(part.begin(), part.end(), d), part.end());
+
+                    if (&part != &active)
+                        active.erase(std::remove(active.begin(), active.end(), d), active.end());
+                }
+
+                ctx.deferred.clear();
             }
+        };
+
+        // Parts of a batch with different route tables
+        std::vector<std::pair<const pc_route_table *, packet_batch>> parts;
 
-            for (const auto& pcl : datadissect_chain) {
-                if (pcl->callback != nullptr)
-                    pcl->callback(pcl->auxdata, packet);
-                else if (pcl->l_callback != nullptr)
-                    pcl->l_callback(packet);
+        for (c = 0; c < PACKET_RUN_CHAINS; c++) {
+            if (c == 1) {
+                for (const auto& packet : active) {
+                    if (packet->sample_weight == 0)
+                        skipped.push_back(packet);
+                }
+
+                if (skipped.size())
+                    active.erase(std::remove_if(active.begin(), active.end(),
+                                [](const std::shared_ptr<kis_packet>& p) { 
+                                    return p->sample_weight == 0; 
+                                }), active.end());
             }
 
-            for (const auto& pcl : classifier_chain) {
-                if (pcl->callback != nullptr)
-                    pcl->callback(pcl->auxdata, packet);
-                else if (pcl->l_callback != nullptr)
-                    pcl->l_callback(packet);
+            if (c == PACKET_RUN_CHAINS - 1 && skipped.size()) {
+                active.insert(active.end(), skipped.begin(), skipped.end());
+                skipped.clear();
             }
 
-            for (const auto& pcl : tracker_chain) {
-                if (pcl->callback != nullptr)
-                    pcl->callback(pcl->auxdata, packet);
-                else if (pcl->l_callback != nullptr)
-                    pcl->l_callback(packet);
+            kis_trace_span span("packetchain", trace_stage_names[c], active.size());
+
+            // A batch is from one assignment group and almost always one DLT, and runs
+            // through its table whole; mixed batches are split by table, keeping the
+            // order of the packets within each part
+            const pc_route_table *route = &chain_routes[c];
+            bool mixed = false;
+
+            for (size_t p = 0; p < active.size(); p++) {
+                auto r = &packet_route(c, active[p]);
+
+                if (p == 0)
+                    route = r;
+                else if (r != route)
+                    mixed = true;
             }
 
-            for (const auto& pcl : logging_chain) {
-                if (pcl->callback != nullptr)
-                    pcl->callback(pcl->auxdata, packet);
-                else if (pcl->l_callback != nullptr)
-                    pcl->l_callback(packet);
+            if (!mixed) {
+                run_route(*route, active);
+                continue;
             }
+
+            parts.clear();
+
+            for (const auto& packet : active) {
+                auto r = &packet_route(c, packet);
+
+                auto pi = std::find_if(parts.begin(), parts.end(),
+                        [r](const std::pair<const pc_route_table *, packet_batch>& pt) {
+                            return pt.first == r;
+                        });
+
+                if (pi == parts.end()) {
+                    parts.push_back(std::make_pair(r, packet_batch{}));
+                    pi = parts.end() - 1;
+                }
+
+                pi->second.push_back(packet);
+            }
+
+            for (auto& pt : parts)
+                run_route(*pt.first, pt.second);
         }
 
-        uint64_t now = Globalreg::globalreg->last_tv_sec;
+        thread_batch_ctx = nullptr;
+
+        for (const auto& packet : active)
+            packet_complete(packet);
 
-        if (packet->error)
-            packet_error_rrd->add_sample(1, now);
+        // Every packet still in the batch has finished logging and released its
+        // lock, so we can now block on any original packets
+        for (const auto& r : resume_vec) {
+            packet_run_from(r.packet, r.chain_pos, r.route, r.link_pos);
+            packet_complete(r.packet);
+        }
+    }
+}
+
+void packet_chain::packet_complete(const std::shared_ptr<kis_packet>& packet) {
+    uint64_t now = Globalreg::globalreg->last_tv_sec;
 
-        if (packet->duplicate)
-            packet_dupe_rrd->add_sample(1, now);
+    source_backlog[packet_source_slot(packet)]--;
+    total_backlog--;
 
-        packet_processed_rrd->add_sample(1, now);
+    if (packet->error) {
+        packets_error++;
+        packet_error_rrd->add_sample(1, now);
+    }
 
-        continue;
+    if (packet->duplicate) {
+        packets_duplicate++;
+        packet_dupe_rrd->add_sample(1, now);
     }
+
+    packet_processed_rrd->add_sample(1, now);
+}
+
+void packet_chain::packet_queue_processor(unsigned int thread_n) {
+    while (!packetchain_shutdown && 
+            !Globalreg::globalreg->spindown && 
+            !Globalreg::globalreg->fatal_condition &&
+            !Globalreg::globalreg->complete) {
+
+        // Parked threads don't take semaphore counts, so every queued group is left
+        // for an active thread to pick up or steal
+        if (thread_n >= n_active_threads.load()) {
+            std::unique_lock<std::mutex> lk(park_mutex);
+            park_cv.wait(lk, [this, thread_n]() {
+                    return thread_n < n_active_threads.load() || packetchain_shutdown;
+                    });
+            continue;
+        }
+
+        packet_runq_sem.wait();
+
+        if (packetchain_shutdown)
+            break;
+
+        auto group = packet_fetch_group(thread_n);
+
+        if (group == nullptr)
+            break;
+
+        auto start = std::chrono::steady_clock::now();
+
+        packet_run_group(thread_n, group);
+
+        packet_threads[thread_n]->busy_ns +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+void packet_chain::set_active_packet_threads(unsigned int in_active) {
+    {
+        std::lock_guard<std::mutex> lk(park_mutex);
+        n_active_threads = in_active;
+    }
+
+    park_cv.notify_all();
+}
+
+void packet_chain::set_packets_backlog_pct(unsigned int in_pct) {
+    if (packet_queue_drop_cfg == 0)
+        return;
+
+    auto limit = static_cast<uint64_t>(packet_queue_drop_cfg) * std::min(in_pct, 100U) / 100;
+
+    packet_queue_drop = static_cast<unsigned int>(std::max(limit, static_cast<uint64_t>(1)));
+}
+
+void packet_chain::packet_autoscale() {
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - autoscale_last_check).count();
+
+    uint64_t busy = 0;
+    for (const auto& t : packet_threads)
+        busy += t->busy_ns.load();
+
+    auto active = n_active_threads.load();
+
+    if (elapsed_ns <= 0 || active == 0)
+        return;
+
+    auto util = ((busy - autoscale_last_busy) * 100) / (static_cast<uint64_t>(elapsed_ns) * active);
+
+    autoscale_last_check = now;
+    autoscale_last_busy = busy;
+
+    auto backlog = total_backlog.load();
+    unsigned int target = active;
+
+    if (backlog > (int64_t) (active * packet_group_batch * 4)) {
+        // The backlog is growing faster than the active threads can clear it, ramp up
+        // quickly
+        target = std::min(static_cast<unsigned int>(n_packet_threads), active * 2);
+    } else if (util >= autoscale_up_pct) {
+        target = std::min(static_cast<unsigned int>(n_packet_threads), active + 1);
+    } else if (active > autoscale_min_threads && util < autoscale_down_pct &&
+            (util * active) / (active - 1) < autoscale_up_pct) {
+        // Only shrink when the remaining threads would not immediately be busy enough
+        // to grow again
+        if (++autoscale_idle_count >= autoscale_idle_checks)
+            target = active - 1;
+    } else {
+        autoscale_idle_count = 0;
+    }
+
+    if (target == active)
+        return;
+
+    autoscale_idle_count = 0;
+
+    _MSG_DEBUG("Packet threads {}% busy, backlog {}; changing active packet threads "
+            "from {} to {}", util, backlog, active, target);
+
+    set_active_packet_threads(target);
+}
+
+void packet_chain::packet_dropped(const std::shared_ptr<kis_packet>& in_pack, time_t now) {
+    packets_dropped++;
+    packet_drop_rrd->add_sample(1, now);
+
+    auto datasrc = in_pack->fetch<packetchain_comp_datasource>(pack_comp_datasource);
+
+    if (datasrc != nullptr && datasrc->ref_source != nullptr)
+        datasrc->ref_source->get_source_chain_drop_rrd()->add_sample(1, now);
+}
+
+size_t packet_chain::packet_source_slot(const std::shared_ptr<kis_packet>& in_pack) {
+    auto datasrc = in_pack->fetch<packetchain_comp_datasource>(pack_comp_datasource);
+
+    if (datasrc == nullptr)
+        return 0;
+
+    return std::hash<kis_datasource *>{}(datasrc->ref_source) % n_source_slots;
+}
+
+packet_chain::dot11_frame_class packet_chain::packet_dot11_frame_class(const std::shared_ptr<kis_packet>& in_pack) {
+    // DLT decapsulation happens in postcap, so we normally have the raw 802.11 frame
+    auto chunk = in_pack->fetch<kis_datachunk>(pack_comp_decap, pack_comp_linkframe);
+
+    if (chunk == nullptr || chunk->dlt != KDLT_IEEE802_11 || chunk->length() < 24)
+        return dot11_frame_class::other;
+
+    auto fc0 = static_cast<uint8_t>(chunk->data()[0]);
+    auto fc1 = static_cast<uint8_t>(chunk->data()[1]);
+    auto type = (fc0 >> 2) & 0x03;
+
+    // Management frames create devices
+    if (type == 0)
+        return dot11_frame_class::other;
+
+    if (type == 1)
+        return dot11_frame_class::control;
+
+    if (type != 2)
+        return dot11_frame_class::other;
+
+    // Protected frames can't be cleartext EAPOL
+    if (fc1 & 0x40)
+        return dot11_frame_class::data;
+
+    size_t hdr_len = 24;
+
+    // 4-address frames
+    if ((fc1 & 0x03) == 0x03)
+        hdr_len += 6;
+
+    // QoS data, and the HT control field when ordered
+    if (fc0 & 0x80) {
+        hdr_len += 2;
+
+        if (fc1 & 0x80)
+            hdr_len += 4;
+    }
+
+    // Keep EAPOL (LLC/SNAP ethertype 0x888e) for handshakes
+    const uint8_t eapol_snap[] = { 0xAA, 0xAA, 0x03, 0x00, 0x00, 0x00, 0x88, 0x8E };
+
+    if (chunk->length() >= hdr_len + sizeof(eapol_snap) &&
+            memcmp(chunk->data() + hdr_len, eapol_snap, sizeof(eapol_snap)) == 0)
+        return dot11_frame_class::eapol;
+
+    return dot11_frame_class::data;
+}
+
+bool packet_chain::packet_is_sheddable_data(const std::shared_ptr<kis_packet>& in_pack) {
+    // Management frames and EAPOL are always kept
+    auto fclass = packet_dot11_frame_class(in_pack);
+
+    return fclass == dot11_frame_class::control || fclass == dot11_frame_class::data;
+}
+
+void packet_chain::packet_sample_data(const std::shared_ptr<kis_packet>& in_pack) {
+    if (in_pack->duplicate || in_pack->error || in_pack->filtered)
+        return;
+
+    if (packet_dot11_frame_class(in_pack) != dot11_frame_class::data)
+        return;
+
+    auto datasrc = in_pack->fetch<packetchain_comp_datasource>(pack_comp_datasource);
+
+    if (datasrc == nullptr || datasrc->ref_source == nullptr)
+        return;
+
+    auto ratio = datasrc->ref_source->count_sample_frame(Globalreg::globalreg->last_tv_sec,
+            sample_data_ratio, sample_data_rate);
+
+    // Transmitter address of the frame, which the frame class has already checked is
+    // present
+    auto chunk = in_pack->fetch<kis_datachunk>(pack_comp_decap, pack_comp_linkframe);
+
+    uint64_t ta = 0;
+    memcpy(&ta, chunk->data() + 10, 6);
+
+    auto shard = sample_shards[std::hash<uint64_t>{}(ta) % n_sample_shards].get();
+
+    unsigned int weight;
+
+    {
+        kis_lock_guard<kis_fast_mutex> lk(shard->mutex, "packet_chain sample");
+
+        auto ci = shard->counts.find(ta);
+
+        if (ci == shard->counts.end()) {
+            // First frame of a transmitter
+            if (shard->counts.size() >= sample_shard_max)
+                shard->counts.clear();
+
+            shard->counts[ta] = 0;
+            weight = 1;
+        } else if (++ci->second >= ratio) {
+            weight = ci->second;
+            ci->second = 0;
+        } else {
+            weight = 0;
+        }
+    }
+
+    in_pack->sample_weight = weight;
+
+    if (weight == 0) {
+        sampled_skipped++;
+    } else {
+        sampled_processed++;
+        datasrc->ref_source->count_sample_processed();
+    }
+}
+
+bool packet_chain::packet_is_known_duplicate(const std::shared_ptr<kis_packet>& in_pack) {
+    auto chunk = in_pack->fetch<kis_datachunk>(pack_comp_decap, pack_comp_linkframe);
+
+    if (chunk == nullptr || chunk->length() == 0)
+        return false;
+
+    auto hash = crc32_hw(chunk->data(), chunk->length(), 0);
+    auto shard = dedupe_shards[hash % dedupe_shards.size()].get();
+
+    kis_lock_guard<kis_fast_mutex> lk(shard->mutex, "packet_is_known_duplicate");
+    auto dk = shard->hash_map.find(hash);
+
+    if (dk == shard->hash_map.end())
+        return false;
+
+    time_t now = Globalreg::globalreg->last_tv_sec;
+
+    return dedupe_max_age == 0 || now - dk->second.ts <= dedupe_max_age;
+}
+
+packet_chain::packet_shed_reason packet_chain::packet_drop_policy(const std::shared_ptr<kis_packet>& in_pack,
+        uint64_t qsize) {
+    unsigned int drop_limit = packet_queue_drop;
+
+    if (!drop_policy_enabled || drop_limit == 0)
+        return packet_shed_reason::none;
+
+    auto pct = (qsize * 100) / drop_limit;
+
+    if (pct < shed_duplicate_pct && pct < shed_fair_pct && pct < shed_data_pct)
+        return packet_shed_reason::none;
+
+    if (drop_keep_filter != nullptr && drop_keep_filter->match(in_pack))
+        return packet_shed_reason::none;
+
+    if (pct >= shed_duplicate_pct && packet_is_known_duplicate(in_pack))
+        return packet_shed_reason::duplicate;
+
+    if (pct >= shed_fair_pct) {
+        int64_t active = 0;
+
+        for (size_t i = 0; i < n_source_slots; i++) {
+            if (source_backlog[i] > 0)
+                active++;
+        }
+
+        if (active > 1 && source_backlog[packet_source_slot(in_pack)] > total_backlog / active)
+            return packet_shed_reason::fairness;
+    }
+
+    if (pct >= shed_data_pct && packet_is_sheddable_data(in_pack))
+        return packet_shed_reason::data;
+
+    return packet_shed_reason::none;
+}
+
+void packet_chain::set_packet_filter(const std::string& in_expression) {
+    auto filter = packet_filter_program::compile(in_expression, this);
+
+    kis_lock_guard<kis_mutex> lk(capture_filter_mutex, "set_packet_filter");
+
+    std::atomic_store(&capture_filter, filter);
+    capture_filter_elem->set(in_expression);
+
+    if (in_expression.length())
+        _MSG_INFO("Discarding packets which do not match the packet filter '{}'", in_expression);
+    else
+        _MSG_INFO("Packet filter cleared, accepting all packets");
 }
 
 int packet_chain::process_packet(std::shared_ptr<kis_packet> in_pack) {
@@ -488,28 +1915,50 @@ int packet_chain::process_packet(std::shared_ptr<kis_packet> in_pack) {
     packet_rate_rrd->add_sample(1, now);
     packet_peak_rrd->add_sample(1, now);
 
+    // Wait for the packet threads to catch up instead of dropping; this stalls the IO
+    // thread feeding us, which pushes back to the datasource
+    if (packet_backlog_block && packet_queue_drop != 0) {
+        while (total_backlog.load() >= (int64_t) packet_queue_drop && !packetchain_shutdown)
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
     // Lock the chain mutexes until we're done processing this packet
     std::shared_lock<kis_shared_mutex> lk(packetchain_mutex);
 
     // Run the post-capture processing
-    for (const auto& pcl : postcap_chain) {
-        if (pcl->callback != nullptr)
-            pcl->callback(pcl->auxdata, in_pack);
-        else if (pcl->l_callback != nullptr)
-            pcl->l_callback(in_pack);
+    for (const auto& pcl : postcap_chain)
+        packet_call_link(pcl, in_pack);
+
+    // Discard filtered packets before they are queued or dissected; they are not
+    // counted as drops
+    if (!std::atomic_load(&capture_filter)->match(in_pack)) {
+        packets_filtered++;
+        return 1;
     }
 
-    // assign it to a thread
-    unsigned int processing_id;
+    if (reorder_budget.count() != 0)
+        packet_reorder_insert(in_pack, now);
+    else
+        packet_enqueue(in_pack, now);
+
+    return 1;
+}
+
+void packet_chain::packet_enqueue(std::shared_ptr<kis_packet> in_pack, time_t now) {
+    // assign it to a group
+    unsigned int group_id;
 
-    // If there is no assignment id, randomly assign the packet to a thread.
-    // Otherwise transform the assignment id to a consistent thread.
+    // If there is no assignment id, randomly assign the packet to a group.
+    // Otherwise transform the assignment id to a consistent group.
     if (in_pack->assignment_id == 0)
-        processing_id = rand() % n_packet_threads;
+        group_id = rand() % packet_groups.size();
     else
-        processing_id = in_pack->assignment_id % n_packet_threads;
+        group_id = in_pack->assignment_id % packet_groups.size();
 
-    auto qsize = packet_threads[processing_id]->packet_queue.size_approx();
+    auto group = packet_groups[group_id].get();
+    auto& home = packet_threads[group->home];
+
+    auto qsize = home->queue_depth.load();
 
     if (packet_queue_drop != 0 && qsize > packet_queue_drop) {
         time_t offt = now - last_packet_drop_user_warning;
@@ -525,15 +1974,35 @@ int packet_chain::process_packet(std::shared_ptr<kis_packet> in_pack) {
                         "will start dropping packets.  Your system may not have enough CPU to keep "
                         "up with the packet rate in your environment or other processes may be "
                         "taking up the CPU.  You can increase the packet backlog with the "
-                        "packet_backlog_limit configuration parameter.", packet_queue_drop), -1);
+                        "packet_backlog_limit configuration parameter.", packet_queue_drop.load()), -1);
         }
 
-        packet_drop_rrd->add_sample(1, now);
+        packet_dropped(in_pack, now);
 
-        return 1;
+        return;
     }
 
-    if (qsize > packet_queue_warning && packet_queue_warning != 0) {
+    switch (packet_drop_policy(in_pack, qsize)) {
+        case packet_shed_reason::none:
+            break;
+        case packet_shed_reason::duplicate:
+            shed_duplicates++;
+            packet_dropped(in_pack, now);
+            return;
+        case packet_shed_reason::fairness:
+            shed_fairness++;
+            packet_dropped(in_pack, now);
+            return;
+        case packet_shed_reason::data:
+            shed_data++;
+            packet_dropped(in_pack, now);
+            return;
+    }
+
+    // While the autoscaler can still add threads a backlog is handled by growing, so
+    // only warn once there are no more threads to add
+    if (qsize > packet_queue_warning && packet_queue_warning != 0 &&
+            n_active_threads.load() >= n_packet_threads) {
         time_t offt = now - last_packet_queue_user_warning;
 
         if (offt > 30) {
@@ -551,16 +2020,45 @@ int packet_chain::process_packet(std::shared_ptr<kis_packet> in_pack) {
     }
 
 
-    // Queue the packet to the target thread
-    packet_threads[processing_id]->packet_queue.enqueue(in_pack);
-    packet_queue_rrd->add_sample(qsize, now);
+    // Queue the packet to the target group, and if the group isn't already running
+    // somewhere, put it on the run queue of its home thread
+    bool schedule = false;
 
-    return 1;
+    home->queue_depth++;
+    source_backlog[packet_source_slot(in_pack)]++;
+    total_backlog++;
+
+    {
+        kis_lock_guard<kis_fast_mutex> lk(group->mutex, "process_packet");
+        group->queue.push_back(in_pack);
+
+        if (!group->scheduled) {
+            group->scheduled = true;
+            schedule = true;
+        }
+    }
+
+    if (schedule) {
+        // Groups homed to a parked thread are run by an active thread
+        auto active = n_active_threads.load();
+        auto& runner = group->home < active ? home : packet_threads[group->home % active];
+
+        {
+            kis_lock_guard<kis_fast_mutex> lk(runner->runq_mutex, "process_packet");
+            runner->run_queue.push_back(group);
+        }
+
+        packet_runq_sem.signal();
+    }
+
+    packet_queue_rrd->add_sample(qsize, now);
 }
 
 int packet_chain::register_int_handler(pc_callback in_cb, void *in_aux,
         std::function<int (std::shared_ptr<kis_packet>)> in_l_cb, 
-        int in_chain, int in_prio) {
+        std::function<int (const packet_batch&)> in_b_cb,
+        int in_chain, int in_prio, const std::string& in_name,
+        const std::vector<unsigned int>& in_dlts, int in_component) {
 
     kis_lock_guard<kis_shared_mutex> lk(packetchain_mutex, "register_int_handler");
 
@@ -571,8 +2069,62 @@ int packet_chain::register_int_handler(pc_callback in_cb, void *in_aux,
     link->priority = in_prio;
     link->callback = in_cb;
     link->l_callback = in_l_cb;
+    link->b_callback = in_b_cb;
     link->auxdata = in_aux;
     link->id = next_handlerid++;
+    link->chain = in_chain;
+    link->name = in_name;
+    link->stats = std::make_shared<packet_handler_histogram>();
+    link->owner = thread_handler_owner;
+    link->async = false;
+    link->dlts = in_dlts;
+    link->component = in_component;
+
+    if (link->owner.length() != 0)
+        link->cost = std::make_shared<packet_handler_cost>();
+
+    // Name callback handlers by their symbol, if we can find it
+    Dl_info dl_info;
+
+    if (link->name.length() == 0 && in_cb != nullptr &&
+            dladdr(reinterpret_cast<void *>(in_cb), &dl_info) != 0 && dl_info.dli_sname != nullptr) {
+        int status;
+        char *demangled = abi::__cxa_demangle(dl_info.dli_sname, nullptr, nullptr, &status);
+
+        if (status == 0 && demangled != nullptr)
+            link->name = demangled;
+        else
+            link->name = dl_info.dli_sname;
+
+        free(demangled);
+    }
+
+    if (link->name.length() == 0)
+        link->name = fmt::format("handler {}", link->id);
+
+    // Only logging handlers can move to the async stage; the packet is finished with
+    // once logging starts, but earlier handlers may be modifying it
+    if (link->cost != nullptr &&
+            std::find_if(async_handler_names.begin(), async_handler_names.end(),
+                [link](const std::string& n) {
+                    return n == link->owner || n == link->name;
+                }) != async_handler_names.end()) {
+        if (in_chain != CHAINPOS_LOGGING) {
+            _MSG_ERROR("Packet handler '{}' from '{}' is listed in packet_async_handlers, but "
+                    "only logging handlers can be called asynchronously; it will still "
+                    "be called from the packet threads.", link->name, link->owner);
+        } else {
+            link->async = true;
+            async_links[link->id] = link;
+
+            if (!async_thread.joinable()) {
+                async_thread = std::thread([this]() {
+                    thread_set_process_name("PACKET ASYNC");
+                    packet_async_processor();
+                });
+            }
+        }
+    }
 
     switch (in_chain) {
         case CHAINPOS_POSTCAP:
@@ -623,26 +2175,53 @@ int packet_chain::register_int_handler(pc_callback in_cb, void *in_aux,
             return -1;
     }
 
+    if (link->b_callback != nullptr)
+        n_batch_handlers++;
+
+    rebuild_routes();
+
     return link->id;
 }
 
 int packet_chain::register_handler(pc_callback in_cb, void *in_aux, int in_chain, int in_prio) {
-    return register_int_handler(in_cb, in_aux, NULL, in_chain, in_prio);
+    return register_int_handler(in_cb, in_aux, NULL, NULL, in_chain, in_prio, "");
+}
+
+int packet_chain::register_handler(pc_callback in_cb, void *in_aux, int in_chain, int in_prio,
+        const std::vector<unsigned int>& in_dlts, int in_component) {
+    return register_int_handler(in_cb, in_aux, NULL, NULL, in_chain, in_prio, "",
+            in_dlts, in_component);
 }
 
-int packet_chain::register_handler(std::function<int (std::shared_ptr<kis_packet>)> in_cb, int in_chain, int in_prio) {
-    return register_int_handler(NULL, NULL, in_cb, in_chain, in_prio);
+int packet_chain::register_handler(std::function<int (std::shared_ptr<kis_packet>)> in_cb, int in_chain, int in_prio,
+        const std::string& in_name) {
+    return register_int_handler(NULL, NULL, in_cb, NULL, in_chain, in_prio, in_name);
+}
+
+int packet_chain::register_batch_handler(std::function<int (const packet_batch&)> in_cb, int in_chain, int in_prio,
+        const std::string& in_name) {
+    if (in_chain == CHAINPOS_POSTCAP) {
+        _MSG("packet_chain::register_batch_handler can not register batch handlers in the "
+                "post-capture chain", MSGFLAG_ERROR);
+        return -1;
+    }
+
+    return register_int_handler(NULL, NULL, NULL, in_cb, in_chain, in_prio, in_name);
 }
 
 int packet_chain::remove_handler(int in_id, int in_chain) {
     kis_lock_guard<kis_shared_mutex> lk(packetchain_mutex, "remove_handler");
 
+    async_links.erase(in_id);
+
     unsigned int x;
 
     switch (in_chain) {
         case CHAINPOS_POSTCAP:
             for (x = 0; x < postcap_chain.size(); x++) {
                 if (postcap_chain[x]->id == in_id) {
+                    if (postcap_chain[x]->b_callback != nullptr)
+                        n_batch_handlers--;
                     postcap_chain.erase(postcap_chain.begin() + x);
                 }
             }
@@ -651,6 +2230,8 @@ int packet_chain::remove_handler(int in_id, int in_chain) {
         case CHAINPOS_LLCDISSECT:
             for (x = 0; x < llcdissect_chain.size(); x++) {
                 if (llcdissect_chain[x]->id == in_id) {
+                    if (llcdissect_chain[x]->b_callback != nullptr)
+                        n_batch_handlers--;
                     llcdissect_chain.erase(llcdissect_chain.begin() + x);
                 }
             }
@@ -659,6 +2240,8 @@ int packet_chain::remove_handler(int in_id, int in_chain) {
         case CHAINPOS_DECRYPT:
             for (x = 0; x < decrypt_chain.size(); x++) {
                 if (decrypt_chain[x]->id == in_id) {
+                    if (decrypt_chain[x]->b_callback != nullptr)
+                        n_batch_handlers--;
                     decrypt_chain.erase(decrypt_chain.begin() + x);
                 }
             }
@@ -667,6 +2250,8 @@ int packet_chain::remove_handler(int in_id, int in_chain) {
         case CHAINPOS_DATADISSECT:
             for (x = 0; x < datadissect_chain.size(); x++) {
                 if (datadissect_chain[x]->id == in_id) {
+                    if (datadissect_chain[x]->b_callback != nullptr)
+                        n_batch_handlers--;
                     datadissect_chain.erase(datadissect_chain.begin() + x);
                 }
             }
@@ -675,6 +2260,8 @@ int packet_chain::remove_handler(int in_id, int in_chain) {
         case CHAINPOS_CLASSIFIER:
             for (x = 0; x < classifier_chain.size(); x++) {
                 if (classifier_chain[x]->id == in_id) {
+                    if (classifier_chain[x]->b_callback != nullptr)
+                        n_batch_handlers--;
                     classifier_chain.erase(classifier_chain.begin() + x);
                 }
             }
@@ -683,6 +2270,8 @@ int packet_chain::remove_handler(int in_id, int in_chain) {
         case CHAINPOS_TRACKER:
             for (x = 0; x < tracker_chain.size(); x++) {
                 if (tracker_chain[x]->id == in_id) {
+                    if (tracker_chain[x]->b_callback != nullptr)
+                        n_batch_handlers--;
                     tracker_chain.erase(tracker_chain.begin() + x);
                 }
             }
@@ -691,6 +2280,8 @@ int packet_chain::remove_handler(int in_id, int in_chain) {
         case CHAINPOS_LOGGING:
             for (x = 0; x < logging_chain.size(); x++) {
                 if (logging_chain[x]->id == in_id) {
+                    if (logging_chain[x]->b_callback != nullptr)
+                        n_batch_handlers--;
                     logging_chain.erase(logging_chain.begin() + x);
                 }
             }
@@ -702,12 +2293,21 @@ int packet_chain::remove_handler(int in_id, int in_chain) {
             return -1;
     }
 
+    rebuild_routes();
+
     return 1;
 }
 
 int packet_chain::remove_handler(pc_callback in_cb, int in_chain) {
     kis_lock_guard<kis_shared_mutex> lk(packetchain_mutex, "remove_handler");
 
+    for (auto ai = async_links.begin(); ai != async_links.end(); ) {
+        if (ai->second->callback == in_cb && ai->second->chain == in_chain)
+            ai = async_links.erase(ai);
+        else
+            ++ai;
+    }
+
     unsigned int x;
 
     switch (in_chain) {
@@ -773,6 +2373,8 @@ int packet_chain::remove_handler(pc_callback in_cb, int in_chain) {
             return -1;
     }
 
+    rebuild_routes();
+
     return 1;
 }
 
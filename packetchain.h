@@ -29,18 +29,28 @@
 #endif
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <string>
 #include <vector>
 #include <map>
 #include <functional>
+#include <mutex>
 #include <queue>
 #include <thread>
 
+#include <time.h>
+
 #include "eventbus.h"
 #include "globalregistry.h"
+#include "kis_histogram.h"
+#include "kis_hugepage_slab.h"
 #include "kis_mutex.h"
 #include "kis_net_beast_httpd.h"
 #include "objectpool.h"
+#include "packet_filter_program.h"
 #include "robin_hood.h"
 #include "timetracker.h"
 #include "trackedelement.h"
@@ -71,6 +81,11 @@
  *
  * (assignment to mapped packet chain based on post-capture packet identifier 
  * hash mapped to number of packet processing chains we have)
+ *
+ * Assignment ids are folded into a fixed set of assignment groups; each group has
+ * a home packet thread, but a group with pending packets is only ever run by one
+ * thread at a time, so idle threads may steal entire groups from busy threads
+ * without re-ordering the packets of any single device.
  * 
  * DISSECT
  * 
@@ -95,12 +110,68 @@
 #define CHAINPOS_TRACKER		7
 #define CHAINPOS_LOGGING        8
 
+// Per-thread chains, LLCDISSECT through LOGGING
+#define PACKET_RUN_CHAINS       6
+
 #define CHAINCALL_PARMS \
     void *auxdata __attribute__ ((unused)), \
     std::shared_ptr<kis_packet> in_pack
 
 class kis_packet;
 
+// Maximum number of distinct packet component types which can be pooled
+#define MAX_PACKET_COMPONENT_POOLS  128
+
+// Each packet component type is assigned a fixed pool slot the first time it is
+// allocated; after that the slot is a constant for the type, so pool lookups are
+// a direct index instead of a locked typeid map search.
+class packet_component_registry {
+public:
+    template<typename T>
+    static size_t slot() {
+        static const size_t s = next_slot++;
+        return s;
+    }
+
+protected:
+    static std::atomic<size_t> next_slot;
+};
+
+// Sampled latency histogram of a packet chain handler
+typedef kis_latency_histogram packet_handler_histogram;
+
+// Copied packet data is held in pooled, size-classed buffers instead of a full
+// MAX_PACKET_LEN reservation per packet
+struct packet_data_buffer {
+    packet_data_buffer() :
+        buf{nullptr},
+        capacity{0} { }
+
+    ~packet_data_buffer() {
+        kis_hugepage_slab::release(buf, capacity);
+    }
+
+    packet_data_buffer(const packet_data_buffer&) = delete;
+    packet_data_buffer& operator=(const packet_data_buffer&) = delete;
+
+    void reserve(size_t sz) {
+        if (capacity < sz) {
+            kis_hugepage_slab::release(buf, capacity);
+            buf = nullptr;
+            capacity = 0;
+            buf = static_cast<char *>(kis_hugepage_slab::allocate(sz));
+            capacity = sz;
+        }
+    }
+
+    char *data() {
+        return buf;
+    }
+
+    char *buf;
+    size_t capacity;
+};
+
 class packet_chain : public lifetime_global {
 public:
     static std::string global_name() { return "PACKETCHAIN"; }
@@ -130,20 +201,212 @@ public:
 
     // Inject a packet into the chain
     int process_packet(std::shared_ptr<kis_packet> in_pack);
+
+    // Get a packet data buffer of at least in_len bytes from the smallest size class
+    // which fits; lengths larger than the largest class are allocated directly
+    std::shared_ptr<packet_data_buffer> new_packet_buffer(size_t in_len);
+
+    struct packet_buffer_stats {
+        size_t size;
+        uint64_t in_use;
+        uint64_t pooled;
+    };
+
+    std::vector<packet_buffer_stats> get_packet_buffer_stats();
+
+    // Packets queued for the packet threads and not yet processed
+    uint64_t get_packets_in_flight();
+
+    // Packets discarded by the capture filter before being queued
+    uint64_t get_packets_filtered() {
+        return packets_filtered.load();
+    }
+
+    // Replace the capture filter; packets not matching the expression are discarded
+    // as soon as they are decapsulated, before any dissection.  Throws
+    // std::runtime_error if the expression does not compile.
+    void set_packet_filter(const std::string& in_expression);
+
+    // Packets completed by the packet threads, and packets dropped or shed instead of
+    // being queued
+    uint64_t get_packets_processed();
+    uint64_t get_packets_dropped() {
+        return packets_dropped.load();
+    }
+
+    // Completed packets flagged as errors or as duplicates
+    uint64_t get_packets_error() {
+        return packets_error.load();
+    }
+    uint64_t get_packets_duplicate() {
+        return packets_duplicate.load();
+    }
+
+    // Packets accepted from all sources and not yet completed
+    int64_t get_packets_backlog() {
+        return total_backlog.load();
+    }
+
+    // Backlog at which packets are dropped, 0 if unlimited
+    unsigned int get_packets_backlog_limit() const {
+        return packet_queue_drop;
+    }
+
+    // Scale the backlog limit to a percentage of the configured packet_backlog_limit,
+    // such as when memory runs short; 100 restores it.  An unlimited backlog stays
+    // unlimited.
+    void set_packets_backlog_pct(unsigned int in_pct);
+
+    struct packet_dedupe_stats {
+        uint64_t hits, misses, evictions;
+    };
+
+    packet_dedupe_stats get_dedupe_stats() {
+        return packet_dedupe_stats{dedupe_hits.load(), dedupe_misses.load(), dedupe_evictions.load()};
+    }
+
+    // Packets shed by the drop policy, by reason
+    struct packet_shed_stats {
+        uint64_t duplicates, fairness, data;
+    };
+
+    packet_shed_stats get_shed_stats() {
+        return packet_shed_stats{shed_duplicates.load(), shed_fairness.load(), shed_data.load()};
+    }
+
+    struct packet_thread_stats {
+        uint64_t queue_depth;
+        uint64_t processed;
+        uint64_t steals;
+        uint64_t busy_ns;
+        bool active;
+    };
+
+    std::vector<packet_thread_stats> get_packet_thread_stats();
+
+    // Packet threads currently taking work; with packet_thread_autoscale this moves
+    // between packet_threads_min and kismet_packet_threads with the load
+    unsigned int get_active_packet_threads() const {
+        return n_active_threads.load();
+    }
+
+    // Latency summary of a packet chain handler, in nanoseconds; samples is the number
+    // of timed calls, 1 in get_handler_stats_sample() of all calls
+    struct packet_handler_stats {
+        int id;
+        std::string name;
+        std::string chain;
+        int priority;
+        uint64_t samples;
+        uint64_t min, max, mean;
+        uint64_t p50, p90, p99, p999;
+        std::string owner;
+        bool async;
+    };
+
+    std::vector<packet_handler_stats> get_handler_stats();
+
+    // Handlers registered from a thread while it has an owner set, such as by the plugin
+    // tracker while a plugin activates, are attributed to that owner; owned handlers
+    // have every call accounted for wall and thread CPU time.  Owned logging handlers
+    // listed in packet_async_handlers are called from a separate thread instead of the
+    // packet threads, so a slow plugin costs dropped calls instead of stalling capture.
+    void set_handler_owner(const std::string& in_owner) {
+        thread_handler_owner = in_owner;
+    }
+
+    void clear_handler_owner() {
+        thread_handler_owner.clear();
+    }
+
+    struct packet_owner_stats {
+        std::string owner;
+        unsigned int handlers;
+        unsigned int async_handlers;
+        uint64_t calls;
+        uint64_t wall_ns;
+        uint64_t cpu_ns;
+        uint64_t async_queued;
+        uint64_t async_dropped;
+    };
+
+    std::vector<packet_owner_stats> get_owner_stats();
+
+    unsigned int get_handler_stats_sample() const {
+        return handler_stats_sample;
+    }
  
     // Callback and information 
     typedef int (*pc_callback)(CHAINCALL_PARMS);
+    typedef std::vector<std::shared_ptr<kis_packet>> packet_batch;
+
+    // Running cost of an owned handler
+    struct packet_handler_cost {
+        packet_handler_cost() :
+            calls{0},
+            wall_ns{0},
+            cpu_ns{0},
+            async_queued{0},
+            async_dropped{0} { }
+
+        std::atomic<uint64_t> calls;
+        std::atomic<uint64_t> wall_ns;
+        std::atomic<uint64_t> cpu_ns;
+        std::atomic<uint64_t> async_queued;
+        std::atomic<uint64_t> async_dropped;
+    };
     typedef struct {
         int priority;
 		packet_chain::pc_callback callback;
         std::function<int (std::shared_ptr<kis_packet>)> l_callback;
+        std::function<int (const packet_batch&)> b_callback;
         void *auxdata;
 		int id;
+        int chain;
+        // Handler name, for handler stats
+        std::string name;
+        std::shared_ptr<packet_handler_histogram> stats;
+        std::string owner;
+        std::shared_ptr<packet_handler_cost> cost;
+        bool async;
+        // DLTs and packet component the handler is routed on, if any
+        std::vector<unsigned int> dlts;
+        int component;
     } pc_link;
 
-    // Register a callback, aux data, a chain to put it in, and the priority 
+    // A handler in a route table; a handler which only applies to this table for packets
+    // with a component is listed with the component, and skipped for packets without it
+    struct pc_route {
+        pc_link *link;
+        int component;
+    };
+
+    typedef std::vector<pc_route> pc_route_table;
+
+    // Register a callback, aux data, a chain to put it in, and the priority.  Lambda
+    // handlers may be given a name to identify them in the handler stats; callback
+    // handlers are named by their symbol.
     int register_handler(pc_callback in_cb, void *in_aux, int in_chain, int in_prio);
-    int register_handler(std::function<int (std::shared_ptr<kis_packet>)> in_cb, int in_chain, int in_prio);
+    int register_handler(std::function<int (std::shared_ptr<kis_packet>)> in_cb, int in_chain, int in_prio,
+            const std::string& in_name = "");
+
+    // Register a callback routed on the DLT of the packet (the decapsulated frame if there
+    // is one, otherwise the link frame) and, optionally, the presence of a packet
+    // component; the handler is only called for packets with one of the DLTs or with the
+    // component.  Either may be left empty (or -1) to route on the other alone.  The
+    // per-thread chains are kept as per-DLT tables, so a packet only visits the handlers
+    // of its own phy instead of paying for the early-out of every other phy.  Handlers
+    // in the post-capture chain are not routed and are called for every packet.
+    int register_handler(pc_callback in_cb, void *in_aux, int in_chain, int in_prio,
+            const std::vector<unsigned int>& in_dlts, int in_component = -1);
+
+    // Register a batch handler; batch handlers are called once per chain stage with
+    // all the packets of a batch (up to kismet_packet_group_batch packets from the same
+    // assignment group), in order.  Registering any batch handler switches the packet
+    // threads to stage-wise batch dispatch, where every stage runs over the whole batch
+    // before the next stage runs; per-packet handlers are still called per packet.
+    int register_batch_handler(std::function<int (const packet_batch&)> in_cb, int in_chain, int in_prio,
+            const std::string& in_name = "");
     int remove_handler(pc_callback in_cb, int in_chain);
 	int remove_handler(int in_id, int in_chain);
 
@@ -151,28 +414,239 @@ public:
 
     template<typename T>
     std::shared_ptr<T> new_packet_component() {
-        kis_lock_guard<kis_mutex> lk(packetcomp_mutex);
-
-        auto p = component_pool_map.find(typeid(T).hash_code());
-
-        if (p != component_pool_map.end()) {
-            return std::static_pointer_cast<shared_object_pool<T>>(p->second)->acquire();
-        } else {
-            auto pool = std::make_shared<shared_object_pool<T>>();
-            pool->set_max(1024);
-            pool->set_reset([](T *c) { c->reset(); });
-            component_pool_map.insert({typeid(T).hash_code(), pool});
-            return pool->acquire();
+        auto slot = packet_component_registry::slot<T>();
+
+        if (slot >= MAX_PACKET_COMPONENT_POOLS)
+            throw std::runtime_error(fmt::format("packet component pool slot {} exceeds the maximum "
+                        "{}; this implies too many packet component types are in use", 
+                        slot, MAX_PACKET_COMPONENT_POOLS));
+
+        // Fast path, the pool already exists
+        auto pool = static_cast<shared_object_pool<T> *>(component_pools[slot].load(std::memory_order_acquire));
+
+        if (pool == nullptr) {
+            kis_lock_guard<kis_mutex> lk(packetcomp_mutex, "new_packet_component");
+
+            pool = static_cast<shared_object_pool<T> *>(component_pools[slot].load(std::memory_order_acquire));
+
+            if (pool == nullptr) {
+                auto p = std::make_shared<shared_object_pool<T>>();
+                p->set_max(1024);
+                p->set_thread_cache(64);
+                p->set_reset([](T *c) { c->reset(); });
+                component_pool_vec.push_back(p);
+                pool = p.get();
+                component_pools[slot].store(pool, std::memory_order_release);
+            }
         }
+
+        return pool->acquire();
     }
 
 protected:
-    void packet_queue_processor(moodycamel::BlockingConcurrentQueue<std::shared_ptr<kis_packet>> *packet_queue);
+    struct packet_thread;
+    struct packet_group;
+
+    void packet_queue_processor(unsigned int thread_n);
+
+    // Find a runnable group, first from our own queue and then by stealing from
+    // another thread
+    packet_group *packet_fetch_group(unsigned int thread_n);
+
+    // Queue a packet which has passed the capture filter to its assignment group,
+    // applying the backlog limit and drop policy
+    void packet_enqueue(std::shared_ptr<kis_packet> in_pack, time_t now);
+
+    // Hold a packet in the reorder stage
+    void packet_reorder_insert(std::shared_ptr<kis_packet> in_pack, time_t now);
+
+    // Release held packets once their time in the reorder stage is up
+    void packet_reorder_processor();
+
+    // Process pending packets from an assignment group
+    void packet_run_group(unsigned int thread_n, packet_group *group);
+
+    // Grow or shrink the active packet threads from the utilization and backlog since
+    // the last check
+    void packet_autoscale();
+
+    // Change the number of active packet threads and wake any which are resumed
+    void set_active_packet_threads(unsigned int in_active);
+
+    // Process a single packet through the per-thread chains
+    void packet_run_chains(std::shared_ptr<kis_packet> packet);
+
+    // Process a batch of packets through the per-thread chains stage by stage
+    void packet_run_batch(packet_batch& batch);
+
+    // Run a single packet through the per-thread chains from a given chain and
+    // link position in a route table, or the start of the table of the packet if none
+    // is given; the chain mutex must be held
+    void packet_run_from(std::shared_ptr<kis_packet> packet, size_t chain_pos,
+            const pc_route_table *route, size_t link_pos);
+
+    // Update the processing stats for a completed packet
+    void packet_complete(const std::shared_ptr<kis_packet>& packet);
 
-    // Common function for both insertion methods
+    // Backpressure drop policy; as the backlog of the target thread grows past the
+    // configured percentages of packet_backlog_limit, duplicates are shed first, then
+    // packets from datasources using more than their share of the backlog, then
+    // data frames.  Management frames, EAPOL, and non-802.11 packets are only lost
+    // at the hard backlog limit.
+    enum class packet_shed_reason {
+        none, duplicate, fairness, data
+    };
+
+    packet_shed_reason packet_drop_policy(const std::shared_ptr<kis_packet>& in_pack, uint64_t qsize);
+
+    // Coarse class of a raw 802.11 frame; EAPOL is told apart from other data
+    enum class dot11_frame_class {
+        other, control, data, eapol
+    };
+
+    dot11_frame_class packet_dot11_frame_class(const std::shared_ptr<kis_packet>& in_pack);
+
+    // Is this packet a sheddable 802.11 data or control frame?
+    bool packet_is_sheddable_data(const std::shared_ptr<kis_packet>& in_pack);
+
+    // Data frame sampling
+    //
+    // On saturated channels most of the work of the chain goes into data frames which
+    // only feed device counters and RRDs.  With packet_sample_data or
+    // packet_sample_rate set, only 1 in N 802.11 data frames of each transmitter go
+    // through decryption, dissection, and tracking; the rest are only counted, and the
+    // frame which is processed carries the number of frames it stands for in
+    // sample_weight, which the device tracker scales packet and data counts by.
+    // Management frames, EAPOL, and the first frame of a transmitter are always
+    // processed.  The ratio is set per datasource, and reported by it.
+    void packet_sample_data(const std::shared_ptr<kis_packet>& in_pack);
+
+    // Is this packet already in the dedupe index?
+    bool packet_is_known_duplicate(const std::shared_ptr<kis_packet>& in_pack);
+
+    // Backlog accounting slot of a packets datasource
+    size_t packet_source_slot(const std::shared_ptr<kis_packet>& in_pack);
+
+    // Count a dropped packet, globally and against its datasource
+    void packet_dropped(const std::shared_ptr<kis_packet>& in_pack, time_t now);
+
+    std::shared_ptr<tracker_element> packet_threads_endp_handler();
+    std::shared_ptr<tracker_element> handler_stats_endp_handler();
+
+    // Common function for all insertion methods
     int register_int_handler(pc_callback in_cb, void *in_aux, 
             std::function<int (std::shared_ptr<kis_packet>)> in_l_cb, 
-            int in_chain, int in_prio);
+            std::function<int (const packet_batch&)> in_b_cb,
+            int in_chain, int in_prio, const std::string& in_name,
+            const std::vector<unsigned int>& in_dlts = {}, int in_component = -1);
+
+    // Should this handler call be timed?  Sampling is random per call so handlers
+    // aren't aliased against the length of the chain.
+    bool packet_sample_handler() {
+        if (handler_stats_sample == 0)
+            return false;
+
+        // xorshift64
+        auto x = thread_sample_rng;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        thread_sample_rng = x;
+
+        return (x % handler_stats_sample) == 0;
+    }
+
+    // Call a link with a single packet
+    void packet_call_link_int(const pc_link *pcl, const std::shared_ptr<kis_packet>& packet) {
+        if (pcl->callback != nullptr)
+            pcl->callback(pcl->auxdata, packet);
+        else if (pcl->l_callback != nullptr)
+            pcl->l_callback(packet);
+        else if (pcl->b_callback != nullptr)
+            pcl->b_callback(packet_batch{packet});
+    }
+
+    // Call an owned link, accounting the wall and thread CPU time of the call
+    void packet_call_link_costed(const pc_link *pcl, const std::shared_ptr<kis_packet>& packet,
+            const packet_batch *batch) {
+        struct timespec cpu_start, cpu_end;
+
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+        auto start = std::chrono::steady_clock::now();
+
+        if (batch != nullptr)
+            pcl->b_callback(*batch);
+        else
+            packet_call_link_int(pcl, packet);
+
+        auto wall = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+
+        pcl->cost->calls++;
+        pcl->cost->wall_ns += wall;
+        pcl->cost->cpu_ns += (cpu_end.tv_sec - cpu_start.tv_sec) * 1000000000LL +
+            (cpu_end.tv_nsec - cpu_start.tv_nsec);
+        pcl->stats->record(wall);
+    }
+
+    // Queue a packet for an async link, dropping it when the async backlog is full
+    void packet_queue_async(const pc_link *pcl, const std::shared_ptr<kis_packet>& packet) {
+        if (async_backlog.load() >= async_backlog_limit) {
+            pcl->cost->async_dropped++;
+            return;
+        }
+
+        async_backlog++;
+        pcl->cost->async_queued++;
+        async_queue.enqueue(async_rec{pcl->id, packet});
+    }
+
+    void packet_call_link(const pc_link *pcl, const std::shared_ptr<kis_packet>& packet) {
+        if (pcl->cost != nullptr) {
+            if (pcl->async)
+                packet_queue_async(pcl, packet);
+            else
+                packet_call_link_costed(pcl, packet, nullptr);
+            return;
+        }
+
+        if (!packet_sample_handler()) {
+            packet_call_link_int(pcl, packet);
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        packet_call_link_int(pcl, packet);
+        pcl->stats->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+    }
+
+    // Call a batch handler with a batch of packets
+    void packet_call_batch_link(const pc_link *pcl, const packet_batch& batch) {
+        if (pcl->cost != nullptr) {
+            if (pcl->async) {
+                for (const auto& packet : batch)
+                    packet_queue_async(pcl, packet);
+            } else {
+                packet_call_link_costed(pcl, nullptr, &batch);
+            }
+            return;
+        }
+
+        if (!packet_sample_handler()) {
+            pcl->b_callback(batch);
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        pcl->b_callback(batch);
+        pcl->stats->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+    }
+
+    // Name of a chain position, for handler stats
+    static std::string chain_name(int in_chain);
 
     int next_componentid, next_handlerid;
 
@@ -188,26 +662,223 @@ protected:
 	std::vector<packet_chain::pc_link *> tracker_chain;
     std::vector<packet_chain::pc_link *> logging_chain;
 
-    // Packet component mutex
+    // Routed copies of the per-thread chains, in run order, rebuilt whenever a handler
+    // is added or removed.  Each DLT a handler is routed on gets its own table of
+    // the handlers which apply to it; packets of any other DLT use the table of the
+    // handlers not routed on DLT.
+    robin_hood::unordered_map<unsigned int, pc_route_table> chain_dlt_routes[PACKET_RUN_CHAINS];
+    pc_route_table chain_routes[PACKET_RUN_CHAINS];
+
+    // Per-thread chains in run order
+    std::array<const std::vector<pc_link *> *, PACKET_RUN_CHAINS> run_chains() const {
+        return {{ &llcdissect_chain, &decrypt_chain, &datadissect_chain,
+            &classifier_chain, &tracker_chain, &logging_chain }};
+    }
+
+    // Rebuild the route tables; the chain mutex must be held
+    void rebuild_routes();
+
+    // Route table of a packet in a chain
+    const pc_route_table& packet_route(size_t in_chain, const std::shared_ptr<kis_packet>& in_pack) const;
+
+    // Number of registered batch handlers; when non-zero packet threads use batch dispatch.
+    std::atomic<unsigned int> n_batch_handlers;
+
+    // Per-thread batch dispatch state, used by the dedupe handler to avoid waiting on
+    // an original packet which is still in flight in the same (or another) batch
+    struct batch_context {
+        const packet_batch *batch;
+        packet_batch deferred;
+    };
+
+    static thread_local batch_context *thread_batch_ctx;
+
+    // Owner of handlers registered from this thread
+    static thread_local std::string thread_handler_owner;
+
+    // Owners and handler names moved to the async stage
+    std::vector<std::string> async_handler_names;
+
+    // Async stage; packets are queued by handler id, and owned by the queue until the
+    // async thread has called the handler
+    struct async_rec {
+        int link_id;
+        std::shared_ptr<kis_packet> packet;
+    };
+
+    void packet_async_processor();
+
+    moodycamel::BlockingConcurrentQueue<async_rec> async_queue;
+    std::atomic<uint64_t> async_backlog;
+    uint64_t async_backlog_limit;
+    std::map<int, pc_link *> async_links;
+    std::thread async_thread;
+
+    // Handler timing sample rate, 1 in N calls are timed, or 0 for disabled
+    unsigned int handler_stats_sample;
+    static thread_local uint64_t thread_sample_rng;
+
+    // Packets run by this thread, for sampling the per-stage trace spans
+    static thread_local unsigned int thread_trace_counter;
+
+    int handler_stats_vec_id, handler_stat_id, handler_stat_name_id, handler_stat_chain_id,
+        handler_stat_priority_id, handler_stat_samples_id, handler_stat_min_id,
+        handler_stat_max_id, handler_stat_mean_id, handler_stat_p50_id, handler_stat_p90_id,
+        handler_stat_p99_id, handler_stat_p999_id, handler_stat_owner_id, handler_stat_async_id;
+
+    // Packet component registration and component pool creation mutex
     kis_mutex packetcomp_mutex;
 
     // Packet chain mutex
     kis_shared_mutex packetchain_mutex;
 
+    // Assignment group; all packets with the same assignment id land in the same
+    // group, and a group is only scheduled on one packet thread at a time
+    struct packet_group {
+        packet_group() :
+            scheduled{false},
+            home{0} { }
+
+        kis_fast_mutex mutex;
+        std::deque<std::shared_ptr<kis_packet>> queue;
+
+        // Are we on a run queue or being processed by a thread?
+        bool scheduled;
+
+        // Home thread for this group
+        unsigned int home;
+    };
+
     struct packet_thread {
-        std::thread packet_thread;
-        moodycamel::BlockingConcurrentQueue<std::shared_ptr<kis_packet>> packet_queue;
+        packet_thread() :
+            queue_depth{0},
+            processed{0},
+            steals{0},
+            busy_ns{0} { }
+
+        std::thread thread;
+
+        kis_fast_mutex runq_mutex;
+        std::deque<packet_group *> run_queue;
+
+        // Packets pending in groups homed to this thread
+        std::atomic<uint64_t> queue_depth;
+        // Packets processed by this thread
+        std::atomic<uint64_t> processed;
+        // Groups this thread has stolen from other threads
+        std::atomic<uint64_t> steals;
+        // Time spent processing groups
+        std::atomic<uint64_t> busy_ns;
     };
 
-    packet_thread **packet_threads;
+    std::vector<std::unique_ptr<packet_thread>> packet_threads;
     size_t n_packet_threads;
 
+    // Threads at or past the active count are parked, and the groups homed to them
+    // are run by the active threads instead
+    std::atomic<unsigned int> n_active_threads;
+    std::mutex park_mutex;
+    std::condition_variable park_cv;
+
+    // Thread autoscaling; threads are added when the active threads are busier than
+    // the up percentage or the backlog is more than a few batches per thread, and
+    // removed once they have been less busy than the down percentage for the idle
+    // number of checks
+    bool autoscale_enabled;
+    unsigned int autoscale_min_threads;
+    unsigned int autoscale_up_pct, autoscale_down_pct, autoscale_idle_checks;
+    unsigned int autoscale_idle_count;
+    uint64_t autoscale_last_busy;
+    std::chrono::steady_clock::time_point autoscale_last_check;
+    int autoscale_timer_id;
+
+    std::vector<std::unique_ptr<packet_group>> packet_groups;
+
+    // Optional reorder stage ahead of the packet threads; packets from every datasource
+    // are held for up to reorder_budget and released to their groups in capture 
+    // timestamp order, so packets of the same device seen by several radios with 
+    // different IPC or network latency are tracked in the order they were captured.
+    // A packet older than the last one released can't be put back in order and is
+    // passed through as late; at most reorder_max packets are held, the oldest being
+    // released early when the stage is full.
+    struct reorder_rec {
+        uint64_t ts_usec;
+        uint64_t seq;
+        std::chrono::steady_clock::time_point deadline;
+        std::shared_ptr<kis_packet> packet;
+    };
+
+    struct reorder_later {
+        bool operator()(const reorder_rec& a, const reorder_rec& b) const {
+            if (a.ts_usec != b.ts_usec)
+                return a.ts_usec > b.ts_usec;
+            return a.seq > b.seq;
+        }
+    };
+
+    std::chrono::microseconds reorder_budget;
+    size_t reorder_max;
+
+    std::mutex reorder_mutex;
+    std::condition_variable reorder_cv;
+    std::priority_queue<reorder_rec, std::vector<reorder_rec>, reorder_later> reorder_queue;
+    uint64_t reorder_seq;
+    uint64_t reorder_last_ts;
+    std::thread reorder_thread;
+
+    std::atomic<uint64_t> reorder_late, reorder_early;
+    std::shared_ptr<tracker_element_uint64> reorder_late_elem;
+    std::shared_ptr<tracker_element_uint64> reorder_early_elem;
+
+    // One count per group placed on any run queue
+    moodycamel::LightweightSemaphore packet_runq_sem;
+
+    // Maximum number of packets to process from a group before yielding it
+    unsigned int packet_group_batch;
+
+    int packet_threads_vec_id, packet_thread_id, packet_thread_depth_id,
+        packet_thread_processed_id, packet_thread_steals_id, packet_thread_busy_id,
+        packet_thread_active_id;
+
     bool packetchain_shutdown;
 
     // Warning and discard levels for packet queue being full
-    unsigned int packet_queue_warning, packet_queue_drop;
+    unsigned int packet_queue_warning;
+    std::atomic<unsigned int> packet_queue_drop;
+    unsigned int packet_queue_drop_cfg;
     time_t last_packet_queue_user_warning, last_packet_drop_user_warning;
 
+    // Hold the capture path at the backlog limit instead of dropping
+    bool packet_backlog_block;
+    std::atomic<uint64_t> packets_dropped;
+    std::atomic<uint64_t> packets_error, packets_duplicate;
+
+    // Drop policy thresholds, as a percentage of packet_queue_drop
+    bool drop_policy_enabled;
+    unsigned int shed_duplicate_pct, shed_fair_pct, shed_data_pct;
+
+    // Capture filter, and packets the drop policy never sheds; replaced atomically so
+    // the capture path never takes a lock for them.  The drop policy filter is null
+    // when nothing is protected.
+    std::shared_ptr<packet_filter_program> capture_filter;
+    std::shared_ptr<packet_filter_program> drop_keep_filter;
+    std::atomic<uint64_t> packets_filtered;
+    std::shared_ptr<tracker_element_uint64> packets_filtered_elem;
+    std::shared_ptr<tracker_element_string> capture_filter_elem;
+    kis_mutex capture_filter_mutex;
+
+    // Queued packets per datasource, hashed into a fixed set of slots so accounting
+    // doesn't need a lock; fairness is approximate when sources share a slot
+    static const size_t n_source_slots = 64;
+    std::atomic<int64_t> source_backlog[n_source_slots];
+    std::atomic<int64_t> total_backlog;
+
+    std::atomic<uint64_t> shed_duplicates, shed_fairness, shed_data;
+
+    std::shared_ptr<tracker_element_uint64> shed_duplicates_elem;
+    std::shared_ptr<tracker_element_uint64> shed_fairness_elem;
+    std::shared_ptr<tracker_element_uint64> shed_data_elem;
+
     std::shared_ptr<kis_tracked_rrd<kis_tracked_rrd_default_aggregator,
         kis_tracked_rrd_prev_pos_extreme_aggregator, 
         kis_tracked_rrd_prev_pos_extreme_aggregator>> packet_peak_rrd;
@@ -240,30 +911,82 @@ protected:
     // Packet & data component pools
     shared_object_pool<kis_packet> packet_pool;
 
-    robin_hood::unordered_map<size_t, std::shared_ptr<void>> component_pool_map;
+    struct packet_buffer_class {
+        packet_buffer_class() :
+            size{0},
+            in_use{0} { }
+
+        size_t size;
+        shared_object_pool<packet_data_buffer> pool;
+        std::atomic<uint64_t> in_use;
+    };
 
-    // Unique lock for packet number and dedupe
-    kis_shared_mutex pack_no_mutex;
+    // Packet data size classes, smallest first
+    std::vector<std::unique_ptr<packet_buffer_class>> packet_buffer_classes;
+
+    // Packet component pools, indexed by packet_component_registry slot; pools are
+    // only created under packetcomp_mutex, and owned by component_pool_vec
+    std::atomic<void *> component_pools[MAX_PACKET_COMPONENT_POOLS];
+    std::vector<std::shared_ptr<void>> component_pool_vec;
 
     // Next unique packet number
     std::atomic<uint64_t> unique_packet_no;
 
-    // A simple array of hash to packet ID for the past 1024 unique packets
+    // Hash-indexed dedupe of recent unique packets.  The index is split into shards
+    // by packet hash so that packet threads only contend when they land on the same
+    // shard; each shard is bounded by depth and age, and evicts in insertion order.
     typedef struct packno_map {
         packno_map() {
             hash = 0;
             packno = 0;
+            ts = 0;
         }
 
         uint32_t hash;
         uint64_t packno;
+        time_t ts;
         std::shared_ptr<kis_packet> original_pkt;
     } packno_map_t;
 
-    packno_map_t dedupe_list[1024];
+    struct dedupe_shard {
+        kis_fast_mutex mutex;
+        robin_hood::unordered_map<uint32_t, packno_map_t> hash_map;
+        // Insertion order of hash and packet number, used for eviction
+        std::deque<std::pair<uint32_t, uint64_t>> fifo;
+    };
+
+    // Remove expired and over-depth records from the head of a shard; must be called
+    // with the shard locked
+    void dedupe_expire_shard(dedupe_shard *shard, time_t now);
+
+    std::vector<std::unique_ptr<dedupe_shard>> dedupe_shards;
+    size_t dedupe_shard_depth;
+    time_t dedupe_max_age;
+
+    std::atomic<uint64_t> dedupe_hits, dedupe_misses, dedupe_evictions;
+
+    std::shared_ptr<tracker_element_uint64> dedupe_hits_elem;
+    std::shared_ptr<tracker_element_uint64> dedupe_misses_elem;
+    std::shared_ptr<tracker_element_uint64> dedupe_evictions_elem;
+
+    // Sampling ratio and target rate of fully processed data frames per source, and
+    // the data frames of each transmitter since its last processed frame, sharded by
+    // transmitter; shards are cleared when they grow too large, which only makes
+    // the next frame of each transmitter a first frame again
+    unsigned int sample_data_ratio, sample_data_rate;
+
+    struct sample_shard {
+        kis_fast_mutex mutex;
+        robin_hood::unordered_flat_map<uint64_t, uint32_t> counts;
+    };
+
+    static const size_t n_sample_shards = 16;
+    static const size_t sample_shard_max = 65536;
+    std::unique_ptr<sample_shard> sample_shards[n_sample_shards];
 
-    // Current position in the dedupe list
-    std::atomic<unsigned int> dedupe_list_pos;
+    std::atomic<uint64_t> sampled_processed, sampled_skipped;
+    std::shared_ptr<tracker_element_uint64> sampled_processed_elem;
+    std::shared_ptr<tracker_element_uint64> sampled_skipped_elem;
 
 	int pack_comp_linkframe, pack_comp_decap, pack_comp_l1_agg, pack_comp_l1, pack_comp_datasource;
     
@@ -59,9 +59,9 @@ void pcapng_stream_futurebuf::start_stream() {
 
 bool pcapng_stream_futurebuf::block_until(size_t req_bytes) {
     if (!block_for_buffer)
-        return chainbuf.size() + req_bytes < max_backlog;
+        return chainbuf.size() + req_bytes < buffer_allowance(max_backlog);
 
-    while (chainbuf.size() + req_bytes > max_backlog) {
+    while (chainbuf.size() + req_bytes > buffer_allowance(max_backlog)) {
         if (!chainbuf.running())
             return false;
 
@@ -300,6 +300,26 @@ int pcapng_stream_futurebuf::pcapng_write_packet(std::shared_ptr<kis_packet> in_
         ng_interface_id = ds_id_rec->second;
     }
 
+    size_t buf_sz;
+
+    auto buf = pcapng_encode_epb(in_packet, in_data, ng_interface_id, gpsinfo, buf_sz);
+
+    if (buf == nullptr)
+        return -1;
+
+    if (!block_until(buf_sz))
+        return 0;
+
+    chainbuf.put_data(buf, buf_sz);
+
+    log_size += buf_sz;
+
+    return 1;
+}
+
+std::shared_ptr<char> pcapng_stream_futurebuf::pcapng_encode_epb(std::shared_ptr<kis_packet> in_packet,
+        std::shared_ptr<kis_datachunk> in_data, int ng_interface_id,
+        std::shared_ptr<kis_gps_packinfo> gpsinfo, size_t& out_sz) {
     std::shared_ptr<char> buf;
 
     // Total buffer size starts header + data + options + end of option
@@ -333,9 +353,6 @@ int pcapng_stream_futurebuf::pcapng_write_packet(std::shared_ptr<kis_packet> in_
     }
 
     // Allocate 4 bytes larger to hold the final length
-    if (!block_until(buf_sz + 4))
-        return 0;
-
     pcapng_epb *epb;
     pcapng_option *opt;
 
@@ -443,13 +460,12 @@ int pcapng_stream_futurebuf::pcapng_write_packet(std::shared_ptr<kis_packet> in_
     auto end_sz = reinterpret_cast<uint32_t *>(buf.get() + buf_sz);
     *end_sz = buf_sz + 4;
 
-    chainbuf.put_data(buf, buf_sz + 4);
-
-    log_size += buf_sz + 4;
+    out_sz = buf_sz + 4;
 
-    return 1;
+    return buf;
 }
 
+
 int pcapng_stream_futurebuf::pcapng_write_packet(int ng_interface_id, const struct timeval& ts, 
         const std::string& in_data) {
     kis_lock_guard<kis_mutex> lk(pcap_mutex, "pcapng_futurebuf pcapng_write_packet");
@@ -527,7 +543,15 @@ void pcapng_stream_futurebuf::handle_packet(std::shared_ptr<kis_packet> in_packe
 
     kis_lock_guard<kis_mutex> lk(pcap_mutex, "pcapng_futurebuf handle_packet");
 
-    pcapng_write_packet(in_packet, target_datachunk);
+    // Packet threads can't wait for the rate limit or for buffer space, so packets over 
+    // the limits are dropped
+    if (rate_delay(sizeof(pcapng_epb) + target_datachunk->length()) > 0 ||
+            pcapng_write_packet(in_packet, target_datachunk) <= 0) {
+        dropped_packets++;
+        return;
+    }
+
+    account_buffered(chainbuf.size());
 
     log_packets++;
 
@@ -539,22 +563,296 @@ void pcapng_stream_futurebuf::handle_packet(std::shared_ptr<kis_packet> in_packe
 
 
 
+constexpr size_t pcapng_packetchain_fanout::ring_slots;
+constexpr size_t pcapng_packetchain_fanout::max_consumers;
+constexpr uint64_t pcapng_packetchain_fanout::slot_busy;
+
+std::shared_ptr<pcapng_packetchain_fanout> pcapng_packetchain_fanout::get_fanout() {
+    static std::mutex fanout_mutex;
+    static std::weak_ptr<pcapng_packetchain_fanout> fanout_w;
+
+    std::lock_guard<std::mutex> lk(fanout_mutex);
+
+    auto fanout = fanout_w.lock();
+
+    if (fanout == nullptr) {
+        fanout = std::make_shared<pcapng_packetchain_fanout>();
+        fanout_w = fanout;
+    }
+
+    return fanout;
+}
+
+pcapng_packetchain_fanout::pcapng_packetchain_fanout() :
+    ring{new slot[ring_slots]},
+    write_seq{0},
+    num_consumers{0},
+    waiters{0} {
+
+    consumer_mutex.set_name("pcapng_packetchain_fanout consumers");
+    interface_mutex.set_name("pcapng_packetchain_fanout interfaces");
+
+    for (size_t i = 0; i < ring_slots; i++)
+        ring[i].seq = 0;
+
+    consumers.fill(nullptr);
+
+    packetchain = Globalreg::fetch_mandatory_global_as<packet_chain>();
+    pack_comp_linkframe = packetchain->register_packet_component("LINKFRAME");
+    pack_comp_datasrc = packetchain->register_packet_component("KISDATASRC");
+    pack_comp_gpsinfo = packetchain->register_packet_component("GPS");
+
+    packethandler_id = 
+        packetchain->register_handler([this](std::shared_ptr<kis_packet> packet) {
+            handle_packet(packet);
+            return 1;
+        }, CHAINPOS_LOGGING, -100);
+}
+
+pcapng_packetchain_fanout::~pcapng_packetchain_fanout() {
+    packetchain->remove_handler(packethandler_id, CHAINPOS_LOGGING);
+}
+
+int pcapng_packetchain_fanout::add_consumer(pcapng_stream_packetchain *consumer, uint64_t& cursor) {
+    std::lock_guard<kis_shared_mutex> lk(consumer_mutex);
+
+    for (size_t i = 0; i < max_consumers; i++) {
+        if (consumers[i] != nullptr)
+            continue;
+
+        consumers[i] = consumer;
+        num_consumers++;
+
+        // Sequences are claimed under the shared consumer lock, so nothing written after
+        // this point was filtered without this consumer
+        cursor = write_seq + 1;
+
+        return i;
+    }
+
+    return -1;
+}
+
+void pcapng_packetchain_fanout::remove_consumer(int slot) {
+    if (slot < 0 || slot >= (int) max_consumers)
+        return;
+
+    std::lock_guard<kis_shared_mutex> lk(consumer_mutex);
+
+    if (consumers[slot] != nullptr) {
+        consumers[slot] = nullptr;
+        num_consumers--;
+    }
+}
+
+int pcapng_packetchain_fanout::fetch(uint64_t seq, std::shared_ptr<block>& blk) {
+    auto& s = ring[seq % ring_slots];
+
+    auto pre = s.seq.load(std::memory_order_acquire);
+
+    if ((pre & ~slot_busy) < seq)
+        return 0;
+
+    if (pre != seq)
+        return (pre & ~slot_busy) == seq ? 0 : -1;
+
+    blk = std::atomic_load(&s.blk);
+
+    // Replaced while we were copying it out
+    if (s.seq.load(std::memory_order_acquire) != seq) {
+        blk.reset();
+        return -1;
+    }
+
+    return 1;
+}
+
+uint64_t pcapng_packetchain_fanout::resume_seq() const {
+    auto head = write_seq.load();
+
+    // Resume half a ring back so the consumer isn't immediately overrun again
+    if (head < ring_slots / 2)
+        return 1;
+
+    return head - (ring_slots / 2) + 1;
+}
+
+void pcapng_packetchain_fanout::wait_for_blocks(uint64_t seq, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lk(wait_mutex);
+
+    if (write_seq >= seq)
+        return;
+
+    // Writers only signal when someone is waiting, and don't take the wait lock to do so;
+    // the timeout bounds a missed wakeup
+    waiters++;
+    wait_cv.wait_for(lk, timeout);
+    waiters--;
+}
+
+void pcapng_packetchain_fanout::wake() {
+    wait_cv.notify_all();
+}
+
+bool pcapng_packetchain_fanout::get_interface(unsigned int id, interface_rec& rec) {
+    std::shared_lock<kis_shared_mutex> lk(interface_mutex);
+
+    if (id >= interface_vec.size())
+        return false;
+
+    rec = interface_vec[id];
+
+    return true;
+}
+
+int pcapng_packetchain_fanout::lookup_interface(kis_datasource *in_datasource, int in_dlt) {
+    auto h1 = std::hash<unsigned int>{}(in_datasource->get_source_number());
+    auto h2 = std::hash<unsigned int>{}(in_dlt);
+    auto index = h1 ^ (h2 << 1);
+
+    {
+        std::shared_lock<kis_shared_mutex> lk(interface_mutex);
+
+        auto k = interface_map.find(index);
+        if (k != interface_map.end())
+            return k->second;
+    }
+
+    std::lock_guard<kis_shared_mutex> lk(interface_mutex);
+
+    auto k = interface_map.find(index);
+    if (k != interface_map.end())
+        return k->second;
+
+    interface_rec rec;
+    rec.source_number = in_datasource->get_source_number();
+    rec.name = in_datasource->get_source_name();
+    if (in_datasource->get_source_cap_interface() != in_datasource->get_source_interface())
+        rec.desc = fmt::format("capture interface for {}", in_datasource->get_source_interface());
+    rec.dlt = in_dlt;
+
+    unsigned int id = interface_vec.size();
+    interface_vec.push_back(rec);
+    interface_map[index] = id;
+
+    return id;
+}
+
+void pcapng_packetchain_fanout::handle_packet(std::shared_ptr<kis_packet> in_packet) {
+    std::shared_lock<kis_shared_mutex> lk(consumer_mutex);
+
+    if (num_consumers == 0)
+        return;
+
+    uint64_t accept_mask = 0;
+
+    for (size_t i = 0; i < max_consumers; i++) {
+        auto c = consumers[i];
+
+        if (c == nullptr || c->get_stream_paused())
+            continue;
+
+        if (c->accept_cb != nullptr && c->accept_cb(in_packet) == false)
+            continue;
+
+        accept_mask |= (1ULL << i);
+    }
+
+    if (accept_mask == 0)
+        return;
+
+    auto linkframe = in_packet->fetch<kis_datachunk>(pack_comp_linkframe);
+    auto datasrcinfo = in_packet->fetch<packetchain_comp_datasource>(pack_comp_datasrc);
+
+    if (linkframe == nullptr || linkframe->dlt == 0 || datasrcinfo == nullptr)
+        return;
+
+    auto blk = std::make_shared<block>();
+    blk->accept_mask = accept_mask;
+    blk->interface_id = lookup_interface(datasrcinfo->ref_source, linkframe->dlt);
+    blk->data = pcapng_stream_futurebuf::pcapng_encode_epb(in_packet, linkframe, blk->interface_id,
+            in_packet->fetch<kis_gps_packinfo>(pack_comp_gpsinfo), blk->len);
+
+    if (blk->data == nullptr)
+        return;
+
+    auto seq = ++write_seq;
+    auto& s = ring[seq % ring_slots];
+
+    // Claim the slot, unless a writer a full ring ahead of us already has
+    auto cur = s.seq.load(std::memory_order_acquire);
+    while (true) {
+        if (cur & slot_busy) {
+            cur = s.seq.load(std::memory_order_acquire);
+            continue;
+        }
+
+        if (cur >= seq)
+            return;
+
+        if (s.seq.compare_exchange_weak(cur, seq | slot_busy, std::memory_order_acq_rel))
+            break;
+    }
+
+    std::atomic_store(&s.blk, blk);
+    s.seq.store(seq, std::memory_order_release);
+
+    if (waiters > 0)
+        wake();
+}
+
+
 pcapng_stream_packetchain::pcapng_stream_packetchain(future_chainbuf& buffer,
             std::function<bool (std::shared_ptr<kis_packet>)> accept_filter,
             std::function<std::shared_ptr<kis_datachunk>(std::shared_ptr<kis_packet>)> data_selector,
             size_t backlog_sz) :
-    pcapng_stream_futurebuf{buffer, accept_filter, data_selector, backlog_sz, false} {
+    pcapng_stream_futurebuf{buffer, accept_filter, data_selector, backlog_sz, false},
+    packethandler_id{-1},
+    fanout_slot{-1},
+    fanout_cursor{0},
+    fanout_interfaces{0},
+    drain_shutdown{false} {
 
 }
 
 pcapng_stream_packetchain::~pcapng_stream_packetchain() {
-    packetchain->remove_handler(packethandler_id, CHAINPOS_LOGGING);
+    drain_shutdown = true;
+
+    if (fanout != nullptr) {
+        fanout->remove_consumer(fanout_slot);
+        fanout->wake();
+    }
+
     chainbuf.cancel();
+
+    if (drain_thread.joinable()) {
+        if (drain_thread.get_id() == std::this_thread::get_id())
+            drain_thread.detach();
+        else
+            drain_thread.join();
+    }
+
+    if (packethandler_id >= 0)
+        packetchain->remove_handler(packethandler_id, CHAINPOS_LOGGING);
 }
 
 void pcapng_stream_packetchain::start_stream() {
     pcapng_stream_futurebuf::start_stream();
 
+    if (selector_cb == nullptr) {
+        fanout = pcapng_packetchain_fanout::get_fanout();
+        fanout_slot = fanout->add_consumer(this, fanout_cursor);
+
+        if (fanout_slot >= 0) {
+            drain_thread = std::thread([this]() {
+                    drain_fanout();
+                    });
+            return;
+        }
+
+        fanout.reset();
+    }
+
     packethandler_id = 
         packetchain->register_handler([this](std::shared_ptr<kis_packet> packet) {
             handle_packet(packet);
@@ -563,6 +861,18 @@ void pcapng_stream_packetchain::start_stream() {
 }
 
 void pcapng_stream_packetchain::stop_stream(std::string in_reason) {
+    drain_shutdown = true;
+
+    if (fanout != nullptr) {
+        fanout->remove_consumer(fanout_slot);
+        fanout->wake();
+    }
+
+    if (packethandler_id < 0) {
+        pcapng_stream_futurebuf::stop_stream(in_reason);
+        return;
+    }
+
     // We have to spawn a thread to deal with this because we're inside the locking
     // chain of the buffer handler when we get a stream stop event, sometimes
     std::thread t([this]() {
@@ -573,3 +883,84 @@ void pcapng_stream_packetchain::stop_stream(std::string in_reason) {
     t.join();
 }
 
+void pcapng_stream_packetchain::drain_fanout() {
+    while (!drain_shutdown && chainbuf.running()) {
+        std::shared_ptr<pcapng_packetchain_fanout::block> blk;
+
+        auto r = fanout->fetch(fanout_cursor, blk);
+
+        if (r == 0) {
+            // Keep the buffer accounting current while the stream is idle
+            account_buffered(chainbuf.size());
+
+            fanout->wait_for_blocks(fanout_cursor, std::chrono::milliseconds(100));
+            continue;
+        }
+
+        if (r < 0) {
+            // Overrun by the writers; skip what was lost
+            auto resume = std::max(fanout->resume_seq(), fanout_cursor + 1);
+            dropped_packets += resume - fanout_cursor;
+            fanout_cursor = resume;
+            continue;
+        }
+
+        fanout_cursor++;
+
+        if ((blk->accept_mask & (1ULL << fanout_slot)) == 0)
+            continue;
+
+        if (!write_fanout_block(*blk))
+            continue;
+
+        log_packets++;
+
+        if (check_over_size() || check_over_packets())
+            chainbuf.cancel();
+    }
+}
+
+bool pcapng_stream_packetchain::write_fanout_block(const pcapng_packetchain_fanout::block& blk) {
+    kis_lock_guard<kis_mutex> lk(pcap_mutex, "pcapng_stream_packetchain write_fanout_block");
+
+    // Only this stream's own rate limit and backlog stall us; the packet threads keep
+    // writing the ring, so a stalled stream drops the oldest packets when it falls behind
+    uint64_t delay;
+
+    while ((delay = rate_delay(blk.len)) > 0) {
+        if (drain_shutdown || !chainbuf.running())
+            return false;
+
+        std::this_thread::sleep_for(std::chrono::microseconds(std::min<uint64_t>(delay, 100000)));
+    }
+
+    auto allowance = buffer_allowance(max_backlog);
+    chainbuf.wait_write_below(allowance > blk.len ? allowance - blk.len : 0);
+
+    if (!chainbuf.running())
+        return false;
+
+    while (fanout_interfaces <= blk.interface_id) {
+        pcapng_packetchain_fanout::interface_rec rec;
+
+        if (!fanout->get_interface(fanout_interfaces, rec))
+            return false;
+
+        chainbuf.wait_write_below(max_backlog / 2);
+
+        // Interface ids are positional, so they have to be written in order
+        if (pcapng_make_idb(rec.source_number, rec.name, rec.desc, rec.dlt) != 
+                (int) fanout_interfaces)
+            return false;
+
+        fanout_interfaces++;
+    }
+
+    chainbuf.put_data(blk.data, blk.len);
+
+    log_size += blk.len;
+
+    account_buffered(chainbuf.size());
+
+    return true;
+}
@@ -21,7 +21,11 @@
 
 #include "config.h"
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -55,6 +59,13 @@ public:
     virtual void stop_stream(std::string in_reason) override;
 
     virtual void block_until_stream_done();
+
+    // Build an EPB for a packet, returning the buffer (including the trailing length) and
+    // setting out_sz, or nullptr on failure
+    static std::shared_ptr<char> pcapng_encode_epb(std::shared_ptr<kis_packet> in_packet,
+            std::shared_ptr<kis_datachunk> in_data, int ng_interface_id,
+            std::shared_ptr<kis_gps_packinfo> gpsinfo, size_t& out_sz);
+
 protected:
     kis_mutex pcap_mutex;
 
@@ -94,6 +105,93 @@ protected:
     }
 };
 
+class pcapng_stream_packetchain;
+
+// Shared pcapng encoder for live packetchain streams.  One packetchain handler checks the
+// filter of every attached stream, and encodes each packet accepted by any of them into an
+// EPB exactly once, in a ring shared by all streams.  Each stream drains the ring from its
+// own cursor on its own thread; packet threads never wait on a stream, and a stream which
+// falls a full ring behind skips the packets which were overwritten.
+//
+// Interface ids are assigned by the fanout in order of first use, and each stream writes
+// the IDBs for every interface up to the one a packet references, so the ids in the shared
+// EPBs are valid in every stream.
+class pcapng_packetchain_fanout {
+public:
+    struct block {
+        // Bit per consumer slot which accepted the packet
+        uint64_t accept_mask;
+        unsigned int interface_id;
+        std::shared_ptr<char> data;
+        size_t len;
+    };
+
+    struct interface_rec {
+        unsigned int source_number;
+        std::string name;
+        std::string desc;
+        int dlt;
+    };
+
+    static constexpr size_t ring_slots = 4096;
+    static constexpr size_t max_consumers = 64;
+
+    // Fanout shared by all live streams, created with the first of them
+    static std::shared_ptr<pcapng_packetchain_fanout> get_fanout();
+
+    pcapng_packetchain_fanout();
+    ~pcapng_packetchain_fanout();
+
+    // Attach a stream, returning the consumer slot or -1 if all slots are in use, and 
+    // setting the cursor to the next block written
+    int add_consumer(pcapng_stream_packetchain *consumer, uint64_t& cursor);
+    void remove_consumer(int slot);
+
+    // Fetch the block at sequence seq; returns 1 if it was fetched, 0 if it has not been
+    // written yet, and -1 if it has been overwritten
+    int fetch(uint64_t seq, std::shared_ptr<block>& blk);
+
+    // Oldest sequence a lagging consumer can resume from
+    uint64_t resume_seq() const;
+
+    // Wait for new blocks, for at most the timeout
+    void wait_for_blocks(uint64_t seq, std::chrono::milliseconds timeout);
+    void wake();
+
+    bool get_interface(unsigned int id, interface_rec& rec);
+
+protected:
+    struct slot {
+        // Sequence number of the block in this slot, with slot_busy set while it is replaced
+        std::atomic<uint64_t> seq;
+        std::shared_ptr<block> blk;
+    };
+
+    static constexpr uint64_t slot_busy = (1ULL << 63);
+
+    std::unique_ptr<slot[]> ring;
+    std::atomic<uint64_t> write_seq;
+
+    kis_shared_mutex consumer_mutex;
+    std::array<pcapng_stream_packetchain *, max_consumers> consumers;
+    size_t num_consumers;
+
+    kis_shared_mutex interface_mutex;
+    std::unordered_map<unsigned int, unsigned int> interface_map;
+    std::vector<interface_rec> interface_vec;
+
+    std::mutex wait_mutex;
+    std::condition_variable wait_cv;
+    std::atomic<unsigned int> waiters;
+
+    std::shared_ptr<packet_chain> packetchain;
+    int pack_comp_linkframe, pack_comp_datasrc, pack_comp_gpsinfo;
+    int packethandler_id;
+
+    int lookup_interface(kis_datasource *in_datasource, int in_dlt);
+    void handle_packet(std::shared_ptr<kis_packet> in_packet);
+};
+
 class pcapng_stream_packetchain : public pcapng_stream_futurebuf {
 public:
     pcapng_stream_packetchain(future_chainbuf& buffer, 
@@ -106,7 +204,22 @@ public:
     virtual void stop_stream(std::string in_reason) override;
 
 protected:
+    friend class pcapng_packetchain_fanout;
+
+    // Streams with a custom data selector, or started when every fanout slot is in use,
+    // register their own packetchain handler instead
     int packethandler_id;
+
+    std::shared_ptr<pcapng_packetchain_fanout> fanout;
+    int fanout_slot;
+    uint64_t fanout_cursor;
+    unsigned int fanout_interfaces;
+
+    std::atomic<bool> drain_shutdown;
+    std::thread drain_thread;
+
+    void drain_fanout();
+    bool write_fanout_block(const pcapng_packetchain_fanout::block& blk);
 };
 
 
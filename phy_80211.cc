@@ -25,6 +25,7 @@
 #include <vector>
 #include <algorithm>
 #include <string>
+#include <unordered_set>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -50,6 +51,7 @@
 #include "devicetracker.h"
 #include "devicetracker_component.h"
 #include "phy_80211.h"
+#include "kis_datasource.h"
 
 #include "kis_httpd_registry.h"
 
@@ -105,6 +107,10 @@ int phydot11_packethook_wep(CHAINCALL_PARMS) {
     return ((kis_80211_phy *) auxdata)->packet_wep_decryptor(in_pack);
 }
 
+int phydot11_packethook_ccmp(CHAINCALL_PARMS) {
+    return ((kis_80211_phy *) auxdata)->packet_ccmp_decryptor(in_pack);
+}
+
 int phydot11_packethook_dot11(CHAINCALL_PARMS) {
     return ((kis_80211_phy *) auxdata)->packet_dot11_dissector(in_pack);
 }
@@ -138,12 +144,8 @@ kis_80211_phy::kis_80211_phy(int in_phyid) :
     Globalreg::enable_pool_type<dot11_ie_36_supported_channels>([](auto *a) { a->reset(); });
 
     Globalreg::enable_pool_type<dot11_ie_45_ht_cap>([](auto *a) { a->reset(); });
-    Globalreg::enable_pool_type<dot11_ie_45_ht_cap::dot11_ie_45_rx_mcs>([](auto *a) { a->reset(); });
 
     Globalreg::enable_pool_type<dot11_ie_48_rsn>([](auto *a) { a->reset(); });
-    Globalreg::enable_pool_type<dot11_ie_48_rsn::dot11_ie_48_rsn_rsn_cipher>([](auto *a) { a->reset(); });
-    Globalreg::enable_pool_type<dot11_ie_48_rsn::dot11_ie_48_rsn_rsn_management>([](auto *a) { a->reset(); });
-    Globalreg::enable_pool_type<dot11_ie_48_rsn::shared_rsn_cipher_vector>([](auto *a) { a->clear(); });
     Globalreg::enable_pool_type<dot11_ie_48_rsn_partial>([](auto *a) { a->reset(); });
 
     Globalreg::enable_pool_type<dot11_ie_54_mobility>([](auto *a) { a->reset(); });
@@ -197,12 +199,6 @@ kis_80211_phy::kis_80211_phy(int in_phyid) :
                 "IEEE802.11 device");
     dot11_builder = std::make_shared<dot11_tracked_device>(dot11_device_entry_id);
 
-    // Packet classifier - makes basic records plus dot11 data
-    packetchain->register_handler(&packet_dot11_common_classifier, this, CHAINPOS_CLASSIFIER, -100);
-    packetchain->register_handler(&packet_dot11_scan_json_classifier, this, CHAINPOS_CLASSIFIER, -99);
-    packetchain->register_handler(&phydot11_packethook_wep, this, CHAINPOS_DECRYPT, -100);
-    packetchain->register_handler(&phydot11_packethook_dot11, this, CHAINPOS_LLCDISSECT, -100);
-
     // If we haven't registered packet components yet, do so.  We have to
     // co-exist with the old tracker core for some time
     pack_comp_80211 =
@@ -238,6 +234,19 @@ kis_80211_phy::kis_80211_phy(int in_phyid) :
     pack_comp_json =
         packetchain->register_packet_component("JSON");
 
+    pack_comp_datasrc =
+        packetchain->register_packet_component("KISDATASRC");
+
+    // Packet classifier - makes basic records plus dot11 data; the dissector only
+    // sees 802.11 frames and the classifiers only packets with dot11 or scan data
+    packetchain->register_handler(&packet_dot11_common_classifier, this, CHAINPOS_CLASSIFIER, -100,
+            {}, pack_comp_80211);
+    packetchain->register_handler(&packet_dot11_scan_json_classifier, this, CHAINPOS_CLASSIFIER, -99,
+            {}, pack_comp_json);
+    packetchain->register_handler(&phydot11_packethook_wep, this, CHAINPOS_DECRYPT, -100);
+    packetchain->register_handler(&phydot11_packethook_dot11, this, CHAINPOS_LLCDISSECT, -100,
+            {KDLT_IEEE802_11});
+
     devtype_adhoc = devicetracker->get_cached_devicetype("Wi-Fi Ad-Hoc");
     devtype_ap = devicetracker->get_cached_devicetype("Wi-Fi AP");
     devtype_client = devicetracker->get_cached_devicetype("Wi-Fi Client"); 
@@ -597,6 +606,55 @@ kis_80211_phy::kis_80211_phy(int in_phyid) :
     signal_too_loud_threshold = 
         Globalreg::globalreg->kismet_config->fetch_opt_int("dot11_max_signal", -10);
 
+    // Per-packet alerts which depend only on the frame itself are checked by the rule 
+    // engine, which only tests a packet against the rules for its type and subtype
+    alert_rules = std::make_shared<dot11_alert_rules>(alertracker);
+
+    auto tooloud_rule = std::make_shared<dot11_alert_rule>(alert_tooloud_ref);
+    tooloud_rule->add_type(packet_management);
+    tooloud_rule->add_type(packet_phy);
+    tooloud_rule->add_type(packet_data);
+    tooloud_rule->match = [this](dot11_packinfo *, kis_layer1_packinfo *l1info) -> bool {
+        return l1info != nullptr && l1info->signal_dbm > signal_too_loud_threshold &&
+            l1info->signal_dbm < 0;
+    };
+    tooloud_rule->text = [this](dot11_packinfo *, kis_layer1_packinfo *l1info) -> std::string {
+        return fmt::format("Saw packet with a reported signal level of {} which is above the "
+                "threshold of {}.  Excessively high signal levels can be caused by misconfigured "
+                "external amplifiers and lead to lost packets.", l1info->signal_dbm,
+                signal_too_loud_threshold);
+    };
+    alert_rules->add_rule(tooloud_rule);
+
+    auto bcastdcon_rule = std::make_shared<dot11_alert_rule>(alert_bcastdcon_ref);
+    bcastdcon_rule->add_subtype(packet_management, packet_sub_disassociation);
+    bcastdcon_rule->add_subtype(packet_management, packet_sub_deauthentication);
+    bcastdcon_rule->flags_set = DOT11_RULE_FLAG_BROADCAST;
+    bcastdcon_rule->text = [](dot11_packinfo *dot11info, kis_layer1_packinfo *) -> std::string {
+        return fmt::format("IEEE80211 Access Point BSSID {} broadcast deauthentication "
+                "or disassociation of all clients; Either the AP is shutting down or this "
+                "is indicative of a possible denial of service attack.", dot11info->bssid_mac);
+    };
+    alert_rules->add_rule(bcastdcon_rule);
+
+    auto l33t_rule = std::make_shared<dot11_alert_rule>(alert_l33t_ref);
+    l33t_rule->add_subtype(packet_management, packet_sub_probe_resp);
+    l33t_rule->match_source = true;
+    l33t_rule->source = mac_addr((uint8_t *) "\x00\x13\x37\x00\x00\x00", 6, 24);
+    l33t_rule->fixed_text = "IEEE80211 probe response from OUI 00:13:37 seen, "
+        "which typically implies a Karma AP impersonation attack.";
+    alert_rules->add_rule(l33t_rule);
+
+    for (const auto& r : Globalreg::globalreg->kismet_config->fetch_opt_vec("dot11_alert_rule"))
+        alert_rules->add_config_rule(r, phyid);
+
+    // The dissection profile sets the defaults for the dissection options below
+    dissection_profile = fetch_dissection_profile("dot11");
+
+    if (dissection_profile != kis_dissection_profile::forensic)
+        _MSG_INFO("PHY802.11 using the '{}' dissection profile",
+                dissection_profile_to_string(dissection_profile));
+
     // Do we process the whole data packet?
     if (Globalreg::globalreg->kismet_config->fetch_opt_bool("hidedata", 0) ||
             Globalreg::globalreg->kismet_config->fetch_opt_bool("dontbeevil", 0)) {
@@ -604,9 +662,27 @@ kis_80211_phy::kis_80211_phy(int in_phyid) :
                 "of data packets entirely", MSGFLAG_INFO);
         dissect_data = 0;
     } else {
-        dissect_data = 1;
+        dissect_data = 
+            Globalreg::globalreg->kismet_config->fetch_opt_bool("dot11_dissect_data",
+                    dissection_profile != kis_dissection_profile::survey);
     }
 
+    // WPS M3 frames are only decoded to detect WPS brute force attacks
+    dissect_wps_m3 =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("dot11_dissect_wps_m3",
+                dissection_profile != kis_dissection_profile::survey);
+
+    // Capability IEs only shown in the UI, WPS, and the vendor IEs which are only
+    // inspected for exploits
+    dissect_ie_detail =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("dot11_dissect_ie_detail",
+                dissection_profile != kis_dissection_profile::survey);
+
+    // WPS device name, manufacturer, model, serial, and UUID
+    dissect_wps_identity =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("dot11_dissect_wps_identity",
+                dissection_profile == kis_dissection_profile::forensic);
+
 #if 0
     // There is no actual handling of phy packets and nothing uses this config option,
     // scheduled for removal unless something new is found that makes phy packets actually
@@ -642,6 +718,15 @@ kis_80211_phy::kis_80211_phy(int in_phyid) :
         return;
     }
 
+    // Load the WPA2-PSK networks we decrypt
+    ccmp_decryptor.reset(new dot11_ccmp_decryptor());
+
+    if (Globalreg::globalreg->fatal_condition)
+        return;
+
+    if (ccmp_decryptor->num_psks() > 0)
+        packetchain->register_handler(&phydot11_packethook_ccmp, this, CHAINPOS_DECRYPT, -99);
+
     // TODO turn into REST endpoint
     if (Globalreg::globalreg->kismet_config->fetch_opt_bool("allowkeytransmit", 0)) {
         _MSG("Allowing Kismet clients to view WEP keys", MSGFLAG_INFO);
@@ -747,6 +832,8 @@ kis_80211_phy::kis_80211_phy(int in_phyid) :
         ssid_regex_vec->push_back(ssida);
     }
 
+    build_ssid_alert_index();
+
     if (Globalreg::globalreg->kismet_config->fetch_opt_bool("dot11_fingerprint_devices", true)) {
         auto fingerprint_s = 
             Globalreg::globalreg->kismet_config->fetch_opt_dfl("dot11_beacon_ie_fingerprint",
@@ -806,7 +893,8 @@ kis_80211_phy::kis_80211_phy(int in_phyid) :
 
 
     keep_eapol_packets =
-        Globalreg::globalreg->kismet_config->fetch_opt_bool("dot11_keep_eapol", true);
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("dot11_keep_eapol",
+                dissection_profile != kis_dissection_profile::survey);
     if (keep_eapol_packets)
         _MSG_INFO("Keeping EAPOL packets in memory for easy download and WIDS functionality; this can use "
                 "more RAM.");
@@ -851,6 +939,7 @@ kis_80211_phy::kis_80211_phy(int in_phyid) :
 
                     return false;
                     });
+        ap_view->set_update_deps(VIEW_DEP_TYPE);
         devicetracker->add_view(ap_view);
 
         bss_ts_group_usec = Globalreg::globalreg->kismet_config->fetch_opt_ulong("dot11_related_bss_window", 10'000'000);
@@ -866,39 +955,26 @@ kis_80211_phy::kis_80211_phy(int in_phyid) :
 
     auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
 
+    httpd->register_route("/phy/phy80211/ccmp/stats", {"GET"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return ccmp_decryptor->get_stats();
+                }));
+
     httpd->register_route("/phy/phy80211/clients-of/:key/clients", {"GET", "POST"}, httpd->RO_ROLE, {},
             std::make_shared<kis_net_web_tracked_endpoint>(
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
-                    auto cl = std::make_shared<tracker_element_vector>();
                     auto key = string_to_n<device_key>(con->uri_params()[":key"]);
 
                     if (key.get_error())
                         throw std::runtime_error("invalid key");
 
-                    auto dev = devicetracker->fetch_device(key);
-
-                    if (dev == nullptr)
-                        return cl;
-
-                    auto dot11 = dev->get_sub_as<dot11_tracked_device>(dot11_device_entry_id);
-
-                    if (dot11 == nullptr)
-                        return cl;
-
-                    for (const auto& ci : *dot11->get_associated_client_map()) {
-                        auto dk = std::static_pointer_cast<tracker_element_device_key>(ci.second);
-                        auto d = devicetracker->fetch_device(dk->get());
-                        if (d != nullptr)
-                            cl->push_back(d);
-                    }
-
-                    return cl;
+                    return fetch_related(relations.clients_of({key}));
                 }));
 
     httpd->register_route("/phy/phy80211/related-to/:key/devices", {"GET", "POST"}, httpd->RO_ROLE, {},
             std::make_shared<kis_net_web_tracked_endpoint>(
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
-                    auto cl = std::make_shared<tracker_element_vector>();
                     auto key = string_to_n<device_key>(con->uri_params()[":key"]);
 
                     if (key.get_error())
@@ -906,49 +982,49 @@ kis_80211_phy::kis_80211_phy(int in_phyid) :
 
                     auto dev = devicetracker->fetch_device(key);
 
-                    if (dev == nullptr)
-                        return cl;
-
-                    auto dot11 = dev->get_sub_as<dot11_tracked_device>(dot11_device_entry_id);
-
-                    if (dot11 == nullptr)
-                        return cl;
-
-                    // Make a map of devices we've already looked at
-                    std::map<device_key, bool> seen_nodes;
+                    if (dev == nullptr || 
+                            dev->get_sub_as<dot11_tracked_device>(dot11_device_entry_id) == nullptr)
+                        return std::make_shared<tracker_element_vector>();
 
-                    std::function<void (std::shared_ptr<kis_tracked_device_base>)> find_clients = 
-                        [&](std::shared_ptr<kis_tracked_device_base> dev) {
+                    // The device, and the clients of every device found, repeatedly
+                    std::unordered_set<device_key> seen_nodes{key};
+                    std::vector<device_key> found{key};
+                    std::vector<device_key> frontier{key};
 
-                        // Don't add non-dot11 devices
-                        auto dot11 =
-                            dev->get_sub_as<dot11_tracked_device>(dot11_device_entry_id);
+                    while (frontier.size() > 0) {
+                        std::vector<device_key> next;
 
-                        if (dot11 == nullptr)
-                            return;
-
-                        // Don't add devices we've already added
-                        if (seen_nodes.find(dev->get_key()) != seen_nodes.end())
-                            return;
+                        for (const auto& c : relations.clients_of(frontier)) {
+                            if (seen_nodes.insert(c).second) {
+                                found.push_back(c);
+                                next.push_back(c);
+                            }
+                        }
 
-                        // Add this device
-                        seen_nodes[dev->get_key()] = true;
-                        cl->push_back(dev);
+                        frontier = std::move(next);
+                    }
 
-                        // For every client, repeat, looking for associated clients and shard APs
-                        for (const auto& ci : *dot11->get_associated_client_map()) {
-                            auto dk = std::static_pointer_cast<tracker_element_device_key>(ci.second);
-                            auto d = devicetracker->fetch_device(dk->get());
+                    return fetch_related(found);
+                }, devicetracker->get_devicelist_mutex()));
 
-                            if (d != nullptr)
-                                find_clients(d);
-                        }
-                    };
+    // Related devices of a list of devices, from the relation index
+    httpd->register_route("/phy/phy80211/relations/clients", {"POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return fetch_related(relations.clients_of(request_device_keys(con)));
+                }));
 
-                    find_clients(dev);
+    httpd->register_route("/phy/phy80211/relations/aps", {"POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return fetch_related(relations.aps_of(request_device_keys(con)));
+                }));
 
-                    return cl;
-                }, devicetracker->get_devicelist_mutex()));
+    httpd->register_route("/phy/phy80211/relations/stats", {"GET"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return relations.get_stats();
+                }));
 
     httpd->register_route("/phy/phy80211/by-key/:key/device/:device/pcap/handshake", {"GET"}, httpd->RO_ROLE, {"pcap"},
             std::make_shared<kis_net_web_function_endpoint>(
@@ -1035,12 +1111,13 @@ kis_80211_phy::kis_80211_phy(int in_phyid) :
                     pcapng->block_until_stream_done();
 
                     streamtracker->remove_streamer(sid);
-                }));
+                }, nullptr, nullptr, true));
 
 }
 
 kis_80211_phy::~kis_80211_phy() {
 	packetchain->remove_handler(&phydot11_packethook_wep, CHAINPOS_DECRYPT);
+	packetchain->remove_handler(&phydot11_packethook_ccmp, CHAINPOS_DECRYPT);
 	packetchain->remove_handler(&phydot11_packethook_dot11, CHAINPOS_LLCDISSECT);
 	packetchain->remove_handler(&packet_dot11_common_classifier, CHAINPOS_CLASSIFIER);
 
@@ -1128,8 +1205,72 @@ std::shared_ptr<dot11_tracked_device> kis_80211_phy::fetch_dot11_record(
     return dev->get_sub_as<dot11_tracked_device>(dot11_device_entry_id);
 }
 
+std::shared_ptr<dot11_tracked_device> kis_80211_phy::new_dot11_device(
+        std::shared_ptr<kis_tracked_device_base> base) {
+    tracker_arena_scope as(base->get_arena());
+    return tracker_arena_make_shared<dot11_tracked_device>(dot11_builder.get());
+}
+
 // Common classifier responsible for generating the common devices & mapping wifi packets
 // to those devices
+void kis_80211_phy::build_ssid_alert_index() {
+    for (const auto& s : *ssid_regex_vec) {
+        auto sa = std::static_pointer_cast<dot11_tracked_ssid_alert>(s);
+        auto literal = string_multimatch::regex_required_literal(sa->get_regex());
+
+        ssid_alert_literals.add_pattern(literal);
+        ssid_alert_has_literal.push_back(literal.length() != 0);
+        ssid_alert_is_literal.push_back(string_multimatch::regex_is_literal(sa->get_regex()));
+    }
+
+    ssid_alert_literals.compile();
+}
+
+std::vector<unsigned int> kis_80211_phy::match_ssid_alerts(const std::string& in_ssid,
+        uint32_t in_ssid_hash) {
+    std::vector<unsigned int> ret;
+
+    if (ssid_regex_vec->size() == 0)
+        return ret;
+
+    {
+        kis_lock_guard<kis_mutex> lk(ssid_alert_cache_mutex, "match_ssid_alerts");
+
+        auto ci = ssid_alert_cache.find(in_ssid_hash);
+        if (ci != ssid_alert_cache.end() && ci->second.first == in_ssid)
+            return ci->second.second;
+    }
+
+    std::vector<bool> found;
+    ssid_alert_literals.match(in_ssid, found);
+
+    for (unsigned int i = 0; i < ssid_regex_vec->size(); i++) {
+        if (ssid_alert_has_literal[i] && !found[i])
+            continue;
+
+#ifdef HAVE_LIBPCRE
+        if (ssid_alert_is_literal[i]) {
+            ret.push_back(i);
+            continue;
+        }
+#endif
+
+        auto sa = std::static_pointer_cast<dot11_tracked_ssid_alert>(ssid_regex_vec->at(i));
+
+        if (sa->match_ssid(in_ssid))
+            ret.push_back(i);
+    }
+
+    kis_lock_guard<kis_mutex> lk(ssid_alert_cache_mutex, "match_ssid_alerts");
+
+    if (ssid_alert_cache.size() >= ssid_alert_cache_max)
+        ssid_alert_cache.clear();
+
+    ssid_alert_cache[in_ssid_hash] = std::make_pair(in_ssid, ret);
+
+    return ret;
+}
+
 int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
     // packetnum++;
 
@@ -1174,24 +1315,6 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
 
     auto pack_l1info = in_pack->fetch<kis_layer1_packinfo>(d11phy->pack_comp_l1info);
 
-    if (pack_l1info != nullptr && pack_l1info->signal_dbm > d11phy->signal_too_loud_threshold && 
-            pack_l1info->signal_dbm < 0 && 
-            d11phy->alertracker->potential_alert(d11phy->alert_tooloud_ref)) {
-
-        std::stringstream ss;
-
-        ss << "Saw packet with a reported signal level of " <<
-            pack_l1info->signal_dbm << " which is above the threshold of " <<
-            d11phy->signal_too_loud_threshold << ".  Excessively high signal levels can " <<
-            "be caused by misconfigured external amplifiers and lead to lost " <<
-            "packets.";
-
-        d11phy->alertracker->raise_alert(d11phy->alert_tooloud_ref, in_pack, 
-                dot11info->bssid_mac, dot11info->source_mac, 
-                dot11info->dest_mac, dot11info->other_mac, 
-                dot11info->channel, ss.str());
-    }
-
     // Do nothing if it's corrupt
     if (dot11info->type == packet_noise || dot11info->corrupt ||
             in_pack->error || dot11info->type == packet_unknown ||
@@ -1200,6 +1323,8 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
         return 0;
     }
 
+    d11phy->alert_rules->process_packet(in_pack, dot11info.get(), pack_l1info.get());
+
     // Get the checksum info; 
     //
     // We don't do anything if the packet is invalid;  in the future we might want
@@ -1301,7 +1426,27 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                         "Wi-Fi Device");
         }
 
-        if (dot11info->source_mac != dot11info->bssid_mac &&
+        // Probing clients using randomized (locally administered) addresses may be 
+        // grouped by the fingerprint of their probes, or counted instead of tracked
+        bool source_random =
+            dot11info->subtype == packet_sub_probe_req &&
+            (dot11info->source_mac[0] & 0x02);
+
+        uint64_t source_group = 0;
+
+        bool source_grouped =
+            source_random &&
+            d11phy->devicetracker->groups_phy(d11phy) &&
+            d11phy->devicetracker->group_device(d11phy, dot11info->source_mac,
+                    d11phy->probe_group_features(in_pack, dot11info), in_pack, source_group);
+
+        bool source_sketched =
+            source_grouped ||
+            (source_random &&
+             d11phy->devicetracker->sketch_device(d11phy, dot11info->source_mac, in_pack));
+
+        if (!source_sketched &&
+                dot11info->source_mac != dot11info->bssid_mac &&
                 dot11info->source_mac != Globalreg::globalreg->empty_mac && 
                 !(dot11info->source_mac.bitwise_and(Globalreg::globalreg->multicast_mac)) ) {
 
@@ -1318,6 +1463,8 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                 d11phy->devicetracker->update_common_device(commoninfo, 
                         dot11info->source_mac, d11phy, in_pack, 
                         bflags, "Wi-Fi Device");
+
+            d11phy->devicetracker->set_device_group(dot11info->source_dev, source_group);
         }
 
         if (dot11info->dest_mac != dot11info->source_mac &&
@@ -1348,7 +1495,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                         dot11info->bssid_dev->get_macaddr().mac_to_string());
 
                 dot11info->bssid_dot11 =
-                    std::make_shared<dot11_tracked_device>(d11phy->dot11_builder.get());
+                    d11phy->new_dot11_device(dot11info->bssid_dev);
 
                 dot11_tracked_device::attach_base_parent(dot11info->bssid_dot11, 
                         dot11info->bssid_dev);
@@ -1447,7 +1594,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                 dot11info->bssid_dot11->bitset_type_set(DOT11_DEVICE_TYPE_PROBE_AP);
             }
 
-            d11phy->devicetracker->update_view_device(dot11info->bssid_dev);
+            d11phy->devicetracker->update_view_device(dot11info->bssid_dev, VIEW_DEP_TYPE);
         }
 
         if (dot11info->source_dev != NULL) {
@@ -1460,7 +1607,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                         dot11info->source_dev->get_macaddr().mac_to_string());
 
                 dot11info->source_dot11 =
-                    std::make_shared<dot11_tracked_device>(d11phy->dot11_builder.get());
+                    d11phy->new_dot11_device(dot11info->source_dev);
 
                 dot11_tracked_device::attach_base_parent(dot11info->source_dot11, 
                         dot11info->source_dev);
@@ -1507,7 +1654,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                 handle_probed_ssid = true;
             }
 
-            d11phy->devicetracker->update_view_device(dot11info->source_dev);
+            d11phy->devicetracker->update_view_device(dot11info->source_dev, VIEW_DEP_TYPE);
         }
 
         if (dot11info->dest_dev != NULL) {
@@ -1519,7 +1666,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                 _MSG_INFO("Detected new 802.11 Wi-Fi device {}", dot11info->dest_dev->get_macaddr());
 
                 dot11info->dest_dot11 =
-                    std::make_shared<dot11_tracked_device>(d11phy->dot11_builder.get());
+                    d11phy->new_dot11_device(dot11info->dest_dev);
 
                 dot11_tracked_device::attach_base_parent(dot11info->dest_dot11, dot11info->dest_dev);
                 
@@ -1536,7 +1683,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
             dot11info->dest_dev->bitclear_basic_type_set(KIS_DEVICE_BASICTYPE_WIRED);
             dot11info->dest_dev->bitset_basic_type_set(KIS_DEVICE_BASICTYPE_CLIENT);
 
-            d11phy->devicetracker->update_view_device(dot11info->dest_dev);
+            d11phy->devicetracker->update_view_device(dot11info->dest_dev, VIEW_DEP_TYPE);
         }
 
         // Safety check that our BSSID device exists
@@ -1597,23 +1744,6 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                 }
             }
 
-            // alerts on broadcast deauths
-            if  ((dot11info->subtype == packet_sub_disassociation ||
-                        dot11info->subtype == packet_sub_deauthentication) &&
-                    dot11info->dest_mac == Globalreg::globalreg->broadcast_mac &&
-                    d11phy->alertracker->potential_alert(d11phy->alert_bcastdcon_ref)) {
-
-                auto al = fmt::format("IEEE80211 Access Point BSSID {} broadcast deauthentication "
-                        "or disassociation of all clients; Either the AP is shutting down or this "
-                        "is indicative of a possible denial of service attack.", 
-                        dot11info->bssid_dev->get_macaddr());
-
-                d11phy->alertracker->raise_alert(d11phy->alert_bcastdcon_ref, in_pack, 
-                        dot11info->bssid_mac, dot11info->source_mac, 
-                        dot11info->dest_mac, dot11info->other_mac, 
-                        dot11info->channel, al);
-            }
-
         }
 
 #if 0
@@ -1784,7 +1914,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                 _MSG_INFO("Detected new 802.11 Wi-Fi device {}", dot11info->bssid_dev->get_macaddr());
 
                 dot11info->bssid_dot11 =
-                    std::make_shared<dot11_tracked_device>(d11phy->dot11_builder.get());
+                    d11phy->new_dot11_device(dot11info->bssid_dev);
 
                 dot11_tracked_device::attach_base_parent(dot11info->bssid_dot11, dot11info->bssid_dev);
 
@@ -1857,7 +1987,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                 _MSG_INFO("Detected new 802.11 Wi-Fi device {}", dot11info->source_dev->get_macaddr());
 
                 dot11info->source_dot11 =
-                    std::make_shared<dot11_tracked_device>(d11phy->dot11_builder.get());
+                    d11phy->new_dot11_device(dot11info->source_dev);
 
                 dot11_tracked_device::attach_base_parent(dot11info->source_dot11, 
                         dot11info->source_dev);
@@ -1924,7 +2054,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
             }
 
             // Look for WPS floods
-            int wps = d11phy->packet_dot11_wps_m3(in_pack);
+            int wps = d11phy->dissect_wps_m3 ? d11phy->packet_dot11_wps_m3(in_pack) : 0;
 
             if (wps) {
                 // if we're w/in time of the last one, update, otherwise clear
@@ -1964,7 +2094,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                 _MSG_INFO("Detected new 802.11 Wi-Fi device {}", dot11info->dest_dev->get_macaddr());
 
                 dot11info->dest_dot11 =
-                    std::make_shared<dot11_tracked_device>(d11phy->dot11_builder.get());
+                    d11phy->new_dot11_device(dot11info->dest_dev);
 
                 dot11_tracked_device::attach_base_parent(dot11info->dest_dot11, 
                         dot11info->dest_dev);
@@ -2015,7 +2145,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                         dot11info->transmit_dev->get_macaddr());
 
                 dot11info->transmit_dot11 =
-                    std::make_shared<dot11_tracked_device>(d11phy->dot11_builder.get());
+                    d11phy->new_dot11_device(dot11info->transmit_dev);
                 
                 dot11_tracked_device::attach_base_parent(dot11info->transmit_dot11, 
                         dot11info->transmit_dev);
@@ -2063,7 +2193,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                         dot11info->receive_dev->get_macaddr());
 
                 dot11info->receive_dot11 =
-                    std::make_shared<dot11_tracked_device>(d11phy->dot11_builder.get());
+                    d11phy->new_dot11_device(dot11info->receive_dev);
                 
                 dot11_tracked_device::attach_base_parent(dot11info->receive_dot11, 
                         dot11info->receive_dev);
@@ -2226,7 +2356,7 @@ int kis_80211_phy::packet_dot11_scan_json_classifier(CHAINCALL_PARMS) {
                     bssid_dev->get_macaddr().mac_to_string());
 
             bssid_dot11 =
-                std::make_shared<dot11_tracked_device>(d11phy->dot11_builder.get());
+                d11phy->new_dot11_device(bssid_dev);
 
             dot11_tracked_device::attach_base_parent(bssid_dot11, bssid_dev);
         }
@@ -2391,11 +2521,11 @@ int kis_80211_phy::packet_dot11_scan_json_classifier(CHAINCALL_PARMS) {
             // regex compares to see if we trigger apspoof
             if (ssid_str.length() != 0 &&
                     d11phy->alertracker->potential_alert(d11phy->alert_ssidmatch_ref)) {
-                for (const auto& s : *d11phy->ssid_regex_vec) {
-                    std::shared_ptr<dot11_tracked_ssid_alert> sa =
-                        std::static_pointer_cast<dot11_tracked_ssid_alert>(s);
+                for (auto i : d11phy->match_ssid_alerts(ssid_str, ssid_csum)) {
+                    auto sa =
+                        std::static_pointer_cast<dot11_tracked_ssid_alert>(d11phy->ssid_regex_vec->at(i));
 
-                    if (sa->compare_ssid(ssid_str, commoninfo->source)) {
+                    if (!sa->is_allowed_mac(commoninfo->source)) {
                         auto al = fmt::format("IEEE80211 Unauthorized device ({}) advertising  "
                                 "for SSID '{}', matching APSPOOF rule {} which may indicate "
                                 "spoofing or impersonation.", commoninfo->source, 
@@ -2480,7 +2610,7 @@ int kis_80211_phy::packet_dot11_scan_json_classifier(CHAINCALL_PARMS) {
             ssid->set_channel(commoninfo->channel); 
         }
 
-        d11phy->devicetracker->update_view_device(bssid_dev);
+        d11phy->devicetracker->update_view_device(bssid_dev, VIEW_DEP_TYPE);
 
     } catch (const std::exception& e) {
         _MSG_ERROR("Invalid phy80211/Wi-Fi scan report: {}", e.what());
@@ -2528,6 +2658,25 @@ void kis_80211_phy::add_wep_key(mac_addr bssid, uint8_t *key, unsigned int len,
     wepkeys.insert(std::make_pair(winfo->bssid, winfo));
 }
 
+void kis_80211_phy::update_ssid_location(std::shared_ptr<dot11_advertised_ssid> ssid,
+        std::shared_ptr<kis_gps_packinfo> pack_gpsinfo) {
+    if (pack_gpsinfo == nullptr || pack_gpsinfo->fix <= 1)
+        return;
+
+    auto loc = ssid->get_location();
+
+    if (loc->get_last_location_time() != Globalreg::globalreg->last_tv_sec) {
+        loc->set_last_location_time(Globalreg::globalreg->last_tv_sec);
+        loc->add_loc_with_avg(pack_gpsinfo->lat, pack_gpsinfo->lon,
+                pack_gpsinfo->alt, pack_gpsinfo->fix, pack_gpsinfo->speed,
+                pack_gpsinfo->heading);
+    } else {
+        loc->add_loc(pack_gpsinfo->lat, pack_gpsinfo->lon,
+                pack_gpsinfo->alt, pack_gpsinfo->fix, pack_gpsinfo->speed,
+                pack_gpsinfo->heading);
+    }
+}
+
 void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev,
         std::shared_ptr<dot11_tracked_device> dot11dev,
         std::shared_ptr<kis_packet> in_pack,
@@ -2542,30 +2691,6 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
         return;
     }
 
-    // If we've processed an identical ssid, don't waste time parsing again, just tweak
-    // the few fields we need to update
-    if (dot11dev->get_last_adv_ie_csum() == dot11info->ietag_csum) {
-        ssid = dot11dev->get_last_adv_ssid();
-
-        if (ssid != nullptr) {
-            if (ssid->get_last_time() < in_pack->ts.tv_sec)
-                ssid->set_last_time(in_pack->ts.tv_sec);
-
-            if (dot11info->subtype == packet_sub_beacon) {
-                ssid->inc_beacons_sec();
-            }
-        }
-
-        return;
-    }
-
-    dot11dev->set_last_adv_ie_csum(dot11info->ietag_csum);
-
-    // If we fail parsing...
-    if (packet_dot11_ie_dissector(in_pack, dot11info) < 0) {
-        return;
-    }
-
     // If we're looking for the beacon, snapshot it
     if (dot11info->subtype == packet_sub_beacon &&
             dot11dev->get_snap_next_beacon()) {
@@ -2590,6 +2715,40 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
 
     }
 
+    // If we've processed an identical beacon or response from this BSSID, don't waste 
+    // time parsing again, just tweak the few fields we need to update.  Beacons and 
+    // probe responses carry different tags, so they're cached separately.
+    bool is_beacon = dot11info->subtype == packet_sub_beacon;
+
+    auto last_fingerprint = is_beacon ? dot11dev->get_last_adv_ie_csum() : 
+        dot11dev->get_last_resp_ie_csum();
+
+    if (dot11info->ietag_fingerprint != 0 && last_fingerprint == dot11info->ietag_fingerprint) {
+        ssid = is_beacon ? dot11dev->get_last_adv_ssid() : dot11dev->get_last_resp_ssid();
+
+        if (ssid != nullptr) {
+            if (ssid->get_last_time() < in_pack->ts.tv_sec)
+                ssid->set_last_time(in_pack->ts.tv_sec);
+
+            if (is_beacon) 
+                ssid->inc_beacons_sec();
+
+            update_ssid_location(ssid, pack_gpsinfo);
+
+            return;
+        }
+    }
+
+    if (is_beacon)
+        dot11dev->set_last_adv_ie_csum(dot11info->ietag_fingerprint);
+    else
+        dot11dev->set_last_resp_ie_csum(dot11info->ietag_fingerprint);
+
+    // If we fail parsing...
+    if (packet_dot11_ie_dissector(in_pack, dot11info) < 0) {
+        return;
+    }
+
     if (dot11info->channel != "0" && dot11info->channel != "") {
         basedev->set_channel(dot11info->channel);
     }
@@ -2804,11 +2963,11 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
         // If we have a new ssid and we can consider raising an alert, do the 
         // regex compares to see if we trigger apspoof
         if (dot11info->ssid_len != 0 && alertracker->potential_alert(alert_ssidmatch_ref)) {
-            for (const auto& s : *ssid_regex_vec) {
-                std::shared_ptr<dot11_tracked_ssid_alert> sa =
-                    std::static_pointer_cast<dot11_tracked_ssid_alert>(s);
+            for (auto i : match_ssid_alerts(dot11info->ssid, dot11info->ssid_csum)) {
+                auto sa =
+                    std::static_pointer_cast<dot11_tracked_ssid_alert>(ssid_regex_vec->at(i));
 
-                if (sa->compare_ssid(dot11info->ssid, dot11info->source_mac)) {
+                if (!sa->is_allowed_mac(dot11info->source_mac)) {
                     std::string ntype = 
                         dot11info->subtype == packet_sub_beacon ? std::string("advertising") :
                         std::string("responding for");
@@ -2834,7 +2993,10 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
             ssid->set_last_time(in_pack->ts.tv_sec);
     }
 
-    dot11dev->set_last_adv_ssid(ssid);
+    if (is_beacon)
+        dot11dev->set_last_adv_ssid(ssid);
+    else
+        dot11dev->set_last_resp_ssid(ssid);
 
     ssid->set_ietag_checksum(dot11info->ietag_csum);
 
@@ -2845,7 +3007,7 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
             ssid->get_ie_tag_list()->push_back(std::get<0>(ti));
 
         // If we snapshot the ie tags, do so
-        ssid->set_ietag_content_from_packet(dot11info->ie_tags);
+        ssid->set_ietag_content_from_packet(dot11info->ie_tags, ietag_store);
     }
 
     // Alias the last ssid snapshot
@@ -2991,21 +3153,6 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
             }
         }
     } else if (dot11info->subtype == packet_sub_probe_resp) {
-        if (mac_addr((uint8_t *) "\x00\x13\x37\x00\x00\x00", 6, 24) == 
-                dot11info->source_mac) {
-
-            if (alertracker->potential_alert(alert_l33t_ref)) {
-                std::string al = "IEEE80211 probe response from OUI 00:13:37 seen, "
-                    "which typically implies a Karma AP impersonation attack.";
-
-                alertracker->raise_alert(alert_l33t_ref, in_pack, 
-                        dot11info->bssid_mac, dot11info->source_mac, 
-                        dot11info->dest_mac, dot11info->other_mac, 
-                        dot11info->channel, al);
-            }
-
-        }
-
         ssid->set_ssid_probe_response(true);
     }
 
@@ -3173,21 +3320,7 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
     ssid->set_maxrate(dot11info->maxrate);
 
     // Add the location data, if any
-    if (pack_gpsinfo != NULL && pack_gpsinfo->fix > 1) {
-        auto loc = ssid->get_location();
-
-        if (loc->get_last_location_time() != Globalreg::globalreg->last_tv_sec) {
-            loc->set_last_location_time(Globalreg::globalreg->last_tv_sec);
-            loc->add_loc_with_avg(pack_gpsinfo->lat, pack_gpsinfo->lon,
-                    pack_gpsinfo->alt, pack_gpsinfo->fix, pack_gpsinfo->speed,
-                    pack_gpsinfo->heading);
-        } else {
-            loc->add_loc(pack_gpsinfo->lat, pack_gpsinfo->lon,
-                    pack_gpsinfo->alt, pack_gpsinfo->fix, pack_gpsinfo->speed,
-                    pack_gpsinfo->heading);
-        }
-
-    }
+    update_ssid_location(ssid, pack_gpsinfo);
 
     // Finalize processing and add it to the maps
     if (dot11info->subtype == packet_sub_probe_resp) {
@@ -3407,6 +3540,42 @@ void kis_80211_phy::handle_probed_ssid(std::shared_ptr<kis_tracked_device_base>
 
 }
 
+std::shared_ptr<tracker_element_vector> 
+kis_80211_phy::fetch_related(const std::vector<device_key>& keys) {
+    auto ret = std::make_shared<tracker_element_vector>();
+
+    for (const auto& k : keys) {
+        auto d = devicetracker->fetch_device(k);
+
+        if (d != nullptr)
+            ret->push_back(d);
+        else
+            relations.forget(k);
+    }
+
+    return ret;
+}
+
+std::vector<device_key> 
+kis_80211_phy::request_device_keys(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    std::vector<device_key> keys;
+
+    if (con->json()["devices"].isNull())
+        throw std::runtime_error("Missing 'devices' key in command dictionary");
+
+    for (const auto& k : con->json()["devices"]) {
+        device_key ka{k.asString()};
+
+        if (ka.get_error()) 
+            throw std::runtime_error(fmt::format("Invalid device key '{}' in 'devices' list",
+                        con->escape_html(k.asString())));
+
+        keys.push_back(ka);
+    }
+
+    return keys;
+}
+
 // Associate a client device and a dot11 access point
 void kis_80211_phy::process_client(std::shared_ptr<kis_tracked_device_base> bssiddev,
         std::shared_ptr<dot11_tracked_device> bssiddot11,
@@ -3598,11 +3767,38 @@ void kis_80211_phy::process_client(std::shared_ptr<kis_tracked_device_base> bssi
     }
 
     // Update the backwards map to the client
+    bool new_associated = false;
+
     if (bssiddot11->get_associated_client_map()->find(clientdev->get_macaddr()) ==
             bssiddot11->get_associated_client_map()->end()) {
         bssiddot11->get_associated_client_map()->insert(clientdev->get_macaddr(),
                 clientdev->get_tracker_key());
+        new_associated = true;
     }
+
+    // Either side being new means the pairing may not be indexed yet
+    if (new_client_record || new_associated)
+        relations.associate(bssiddev->get_key(), clientdev->get_key());
+}
+
+dot11_handshake_state& kis_80211_phy::fetch_handshake_state(std::shared_ptr<dot11_tracked_device> bssid_dot11,
+        const mac_addr& client_mac) {
+    if (bssid_dot11->has_handshake_state(client_mac))
+        return bssid_dot11->get_handshake_state(client_mac);
+
+    auto& hs_state = bssid_dot11->get_handshake_state(client_mac);
+
+    if (bssid_dot11->has_wpa_key_map()) {
+        auto bssid_map = bssid_dot11->get_wpa_key_map();
+        auto bssid_vec_i = bssid_map->find(client_mac);
+
+        if (bssid_vec_i != bssid_map->end()) {
+            for (const auto& k : *std::static_pointer_cast<tracker_element_vector>(bssid_vec_i->second))
+                hs_state.update(std::static_pointer_cast<dot11_tracked_eapol>(k));
+        }
+    }
+
+    return hs_state;
 }
 
 void kis_80211_phy::process_wpa_handshake(std::shared_ptr<kis_tracked_device_base> bssid_dev,
@@ -3617,6 +3813,13 @@ void kis_80211_phy::process_wpa_handshake(std::shared_ptr<kis_tracked_device_bas
     if (eapol == NULL)
         return;
 
+    // Handshakes are worth staying on a channel for
+    auto datasrc = in_pack->fetch<packetchain_comp_datasource>(pack_comp_datasrc);
+    auto commoninfo = in_pack->fetch<kis_common_info>(pack_comp_common);
+
+    if (datasrc != nullptr && datasrc->ref_source != nullptr && commoninfo != nullptr)
+        datasrc->ref_source->record_channel_activity(commoninfo->channel, 0, 4);
+
     if (!keep_eapol_packets)
         return;
 
@@ -3626,63 +3829,44 @@ void kis_80211_phy::process_wpa_handshake(std::shared_ptr<kis_tracked_device_bas
     // We want to start looking for the next advertised ssid
     bssid_dot11->set_snap_next_beacon(true);
 
-    auto bssid_map(bssid_dot11->get_wpa_key_map());
-
     // Do we have a pmkid and need one?  set the pmkid packet.
     if (bssid_dot11->get_pmkid_needed() && eapol->get_rsnpmkid_bytes().length() != 0) {
         auto pmkid_packet = bssid_dot11->get_pmkid_packet();
         pmkid_packet->copy_packet(eapol->get_eapol_packet());
+        bssid_dot11->get_pmkid_pcap_cache().invalidate();
     }
 
-    // Start doing something smart here about eliminating
-    // records - we want to do our best to keep a 1, 2, 3, 4
-    // handshake sequence, so find out what duplicates we have
-    // and eliminate the oldest one of them if we need to
-    uint8_t keymask = 0;
-
-    auto bssid_vec_i = bssid_map->find(dest_dev->get_macaddr());
-    auto bssid_vec = std::shared_ptr<tracker_element_vector>();
-
-    if (bssid_vec_i == bssid_map->end()) {
-        bssid_vec = Globalreg::new_from_pool<tracker_element_vector>();
-        bssid_map->insert(std::make_pair(dest_dev->get_macaddr(), bssid_vec));
-    } else {
-        bssid_vec = std::static_pointer_cast<tracker_element_vector>(bssid_vec_i->second);
-    }
+    auto client_mac = dest_dev->get_macaddr();
+    auto& hs_state = fetch_handshake_state(bssid_dot11, client_mac);
 
-    if (bssid_vec->size() > 16) {
-        for (tracker_element_vector::iterator kvi = bssid_vec->begin();
-                kvi != bssid_vec->end(); ++kvi) {
-            auto ke = std::static_pointer_cast<dot11_tracked_eapol>(*kvi);
+    // Only a change to the stored handshake updates the exported frames and
+    // announces the handshake; retransmissions and frames past a complete
+    // handshake stop here
+    if (hs_state.update(eapol)) {
+        auto bssid_map(bssid_dot11->get_wpa_key_map());
+        auto bssid_vec_i = bssid_map->find(client_mac);
+        auto bssid_vec = std::shared_ptr<tracker_element_vector>();
 
-            uint8_t knum = (1 << ke->get_eapol_msg_num());
+        if (bssid_vec_i == bssid_map->end()) {
+            bssid_vec = Globalreg::new_from_pool<tracker_element_vector>();
+            bssid_map->insert(std::make_pair(client_mac, bssid_vec));
+        } else {
+            bssid_vec = std::static_pointer_cast<tracker_element_vector>(bssid_vec_i->second);
+        }
 
-            // If this is a duplicate handshake number, we can get
-            // rid of this one
-            if ((keymask & knum) == knum) {
-                bssid_vec->erase(kvi);
-                break;
-            }
+        bssid_vec->clear();
 
-            // Otherwise put this key in the keymask
-            keymask |= knum;
+        for (const auto& k : hs_state.eapol) {
+            if (k != nullptr)
+                bssid_vec->push_back(k);
         }
-    }
 
-    bssid_vec->push_back(eapol);
-
-    // Calculate the key mask of seen handshake keys
-    keymask = 0;
-    for (const auto& kvi : *bssid_vec) {
-        keymask |= (1 << std::static_pointer_cast<dot11_tracked_eapol>(kvi)->get_eapol_msg_num());
+        auto evt = eventbus->get_eventbus_event(dot11_wpa_handshake_event);
+        evt->get_event_content()->insert(dot11_wpa_handshake_event_base, bssid_dev);
+        evt->get_event_content()->insert(dot11_wpa_handshake_event_dot11, bssid_dot11);
+        eventbus->publish(evt);
     }
 
-
-    auto evt = eventbus->get_eventbus_event(dot11_wpa_handshake_event);
-    evt->get_event_content()->insert(dot11_wpa_handshake_event_base, bssid_dev);
-    evt->get_event_content()->insert(dot11_wpa_handshake_event_dot11, bssid_dot11);
-    eventbus->publish(evt);
-
     // Look for replays against the target (which might be the bssid, or might
     // be a client, depending on the direction); we track the EAPOL records per
     // destination in the destination device record
@@ -4004,69 +4188,70 @@ void kis_80211_phy::generate_handshake_pcap(std::shared_ptr<kis_net_beast_httpd_
         uint32_t caplen;
     } pkt_hdr;
 
-    std::ostream stream(&con->response_stream());
-
-    stream.write((const char *) &hdr, sizeof(hdr));
-
-    kis_unique_lock<kis_mutex> list_locker(devicetracker->get_devicelist_mutex(),
-            "phy80211 generate_handshake_pcap");
-
-
-    /* Write the beacon */
-    if (dot11dev->get_beacon_packet_present()) {
-        auto packet = dot11dev->get_ssid_beacon_packet();
-
+    auto append_packet = [&pkt_hdr](std::string& pcap, std::shared_ptr<kis_tracked_packet> packet) {
         pkt_hdr.timeval_s = packet->get_ts_sec();
         pkt_hdr.timeval_us = packet->get_ts_usec();
 
         pkt_hdr.len = packet->get_data()->length();
         pkt_hdr.caplen = pkt_hdr.len;
 
-        stream.write((const char *) &pkt_hdr, sizeof(pkt_hdr));
-        stream.write((const char *) packet->get_data()->get().data(), pkt_hdr.len);
-    }
-
-    if (mode == "handshake") {
-        // Write all the handshakes
-        if (dot11dev->has_wpa_key_map()) {
-            const auto hsm = dot11dev->get_wpa_key_map();
-            const auto hsi = hsm->find(target_mac);
+        pcap.append((const char *) &pkt_hdr, sizeof(pkt_hdr));
+        pcap.append(packet->get_data()->get().data(), pkt_hdr.len);
+    };
 
-            if (hsi != hsm->end()) {
-                const auto hsv = std::static_pointer_cast<tracker_element_vector>(hsi->second);
-                for (const auto& i : *(hsv)) {
-                    auto eapol =
-                        std::static_pointer_cast<dot11_tracked_eapol>(i);
+    std::ostream stream(&con->response_stream());
 
-                    auto packet = eapol->get_eapol_packet();
+    kis_unique_lock<kis_mutex> list_locker(devicetracker->get_devicelist_mutex(),
+            "phy80211 generate_handshake_pcap");
 
-                    // Make a pcap header
-                    pkt_hdr.timeval_s = packet->get_ts_sec();
-                    pkt_hdr.timeval_us = packet->get_ts_usec();
+    // The rendered pcap is cached until the handshake changes or the beacon is
+    // snapshotted
+    dot11_pcap_cache *cache = nullptr;
+    dot11_handshake_state *hs_state = nullptr;
 
-                    pkt_hdr.len = packet->get_data()->length();
-                    pkt_hdr.caplen = pkt_hdr.len;
+    // Don't create state for clients which have never had a handshake
+    dot11_handshake_state empty_state;
 
-                    stream.write((const char *) &pkt_hdr, sizeof(pkt_hdr));
-                    stream.write((const char *) packet->get_data()->get().data(), pkt_hdr.len);
-                }
-            }
-        }
+    if (mode == "handshake") {
+        if (dot11dev->has_handshake_state(target_mac) ||
+                (dot11dev->has_wpa_key_map() &&
+                 dot11dev->get_wpa_key_map()->find(target_mac) != dot11dev->get_wpa_key_map()->end()))
+            hs_state = &(fetch_handshake_state(dot11dev, target_mac));
+        else
+            hs_state = &empty_state;
+
+        cache = &(hs_state->pcap_cache);
     } else if (mode == "pmkid") {
-        // Write just the pmkid
-        if (dot11dev->get_pmkid_present()) {
-            auto packet = dot11dev->get_pmkid_packet();
+        cache = &(dot11dev->get_pmkid_pcap_cache());
+    } else {
+        return;
+    }
 
-            pkt_hdr.timeval_s = packet->get_ts_sec();
-            pkt_hdr.timeval_us = packet->get_ts_usec();
+    if (!cache->valid || cache->beacon != dot11dev->get_beacon_packet_present()) {
+        cache->pcap.clear();
+        cache->pcap.append((const char *) &hdr, sizeof(hdr));
 
-            pkt_hdr.len = packet->get_data()->length();
-            pkt_hdr.caplen = pkt_hdr.len;
+        /* Write the beacon */
+        cache->beacon = dot11dev->get_beacon_packet_present();
+        if (cache->beacon)
+            append_packet(cache->pcap, dot11dev->get_ssid_beacon_packet());
 
-            stream.write((const char *) &pkt_hdr, sizeof(pkt_hdr));
-            stream.write((const char *) packet->get_data()->get().data(), pkt_hdr.len);
+        if (mode == "handshake") {
+            // Write the handshake, in message order
+            for (const auto& eapol : hs_state->eapol) {
+                if (eapol != nullptr)
+                    append_packet(cache->pcap, eapol->get_eapol_packet());
+            }
+        } else if (mode == "pmkid") {
+            // Write just the pmkid
+            if (dot11dev->get_pmkid_present())
+                append_packet(cache->pcap, dot11dev->get_pmkid_packet());
         }
+
+        cache->valid = true;
     }
+
+    stream.write(cache->pcap.data(), cache->pcap.length());
 }
 
 class phy80211_devicetracker_expire_worker : public device_tracker_view_worker {
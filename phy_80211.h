@@ -30,6 +30,7 @@
 #include <vector>
 #include <algorithm>
 #include <string>
+#include <unordered_map>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -42,11 +43,16 @@
 #include "gpstracker.h"
 #include "uuid.h"
 #include "streamtracker.h"
+#include "string_multimatch.h"
 
 #include "devicetracker.h"
 #include "devicetracker_component.h"
+#include "kis_dissection_profile.h"
 #include "kis_net_beast_httpd.h"
+#include "phy_80211_alertrules.h"
+#include "phy_80211_ccmp.h"
 #include "phy_80211_components.h"
+#include "phy_80211_relations.h"
 #include "phy_80211_ssidtracker.h"
 
 #include "datasource_dot11_scan.h"
@@ -150,6 +156,7 @@ class dot11_packinfo : public packet_component {
 
             // Many of these will not be available until the IE tags are parsed
             ietag_csum = 0;
+            ietag_fingerprint = 0;
 
             dot11d_country = "";
 
@@ -271,6 +278,10 @@ class dot11_packinfo : public packet_component {
 
         uint32_t ssid_csum;
         uint32_t ietag_csum;
+        // Checksum of the beacon interval, capabilities, and IE tags, minus the
+        // tags which change from beacon to beacon (TIM); identical fingerprints
+        // from the same BSSID don't need to be dissected again
+        uint32_t ietag_fingerprint;
 
         // Tupled hash map
         std::multimap<std::tuple<uint8_t, uint32_t, uint8_t>, size_t> ietag_hash_map;
@@ -383,6 +394,8 @@ public:
 
     // Dot11 decoders, wep decryptors, etc
     int packet_wep_decryptor(std::shared_ptr<kis_packet> in_pack);
+    // WPA2-PSK CCMP decryption; follows handshakes in EAPOL frames and decrypts data
+    int packet_ccmp_decryptor(std::shared_ptr<kis_packet> in_pack);
     // Top-level dissector; decodes basic type and populates the dot11 packet
     int packet_dot11_dissector(std::shared_ptr<kis_packet> in_pack);
     // Expects an existing dot11 packet with the basic type intact, interprets
@@ -393,6 +406,11 @@ public:
     std::shared_ptr<std::vector<ie_tag_tuple>> packet_dot11_ie_list(std::shared_ptr<kis_packet> in_pack, 
             std::shared_ptr<dot11_packinfo> in_dot11info);
 
+    // Features of a probe request which stay the same when a client changes address,
+    // for grouping clients using randomized addresses (see device_tracker::group_device)
+    std::vector<uint64_t> probe_group_features(std::shared_ptr<kis_packet> in_pack,
+            std::shared_ptr<dot11_packinfo> in_dot11info);
+
     // Special decoders, not called as part of a chain
 
     // Is packet a WPS M3 message?  Used to detect Reaver, etc
@@ -450,6 +468,10 @@ public:
     const std::string dot11_new_probed_ssid = "DOT11_PROBED_SSID";
     const std::string dot11_new_response_ssid = "DOT11_RESPONSE_SSID";
 
+    // Beacon and probe response fingerprint; fixed parameters excluding the 
+    // timestamp, and all IE tags except those which change every beacon
+    static uint32_t ie_fingerprint(const uint8_t *frame, size_t frame_len, size_t header_offset);
+
     static size_t ssid_hash(const std::string& ssid, unsigned int ssid_len) {
         auto hash = xx_hash_cpp{};
 
@@ -478,6 +500,10 @@ protected:
     std::atomic<unsigned int> recent_packet_checksum_pos;
 
     // Handle advertised SSIDs
+    // Update the location of an advertised ssid
+    void update_ssid_location(std::shared_ptr<dot11_advertised_ssid> ssid,
+            std::shared_ptr<kis_gps_packinfo> pack_gpsinfo);
+
     void handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev, 
             std::shared_ptr<dot11_tracked_device> dot11dev,
             std::shared_ptr<kis_packet> in_pack,
@@ -508,6 +534,11 @@ protected:
             std::shared_ptr<dot11_tracked_device> dest_dot11,
             std::shared_ptr<kis_packet> in_pack, std::shared_ptr<dot11_packinfo> dot11info);
 
+    // Handshake state of a client of a bssid, rebuilt from the exported frames of
+    // devices restored from storage
+    dot11_handshake_state& fetch_handshake_state(std::shared_ptr<dot11_tracked_device> bssid_dot11,
+            const mac_addr& client_mac);
+
     void generate_handshake_pcap(std::shared_ptr<kis_net_beast_httpd_connection> con,
             std::shared_ptr<kis_tracked_device_base> dev, 
             std::shared_ptr<dot11_tracked_device> dot11dev, 
@@ -529,12 +560,19 @@ protected:
     int pack_comp_80211, pack_comp_basicdata, pack_comp_mangleframe,
         pack_comp_strings, pack_comp_checksum, pack_comp_linkframe,
         pack_comp_decap, pack_comp_common, pack_comp_datapayload,
-        pack_comp_gps, pack_comp_l1info, pack_comp_json;
+        pack_comp_gps, pack_comp_l1info, pack_comp_json, pack_comp_datasrc;
+
+    kis_dissection_profile dissection_profile;
 
     // Do we do any data dissection or do we hide it all (legal safety
     // cutout)
     int dissect_data;
 
+    // Optional dissection, defaulted by the dissection profile
+    bool dissect_wps_m3;
+    bool dissect_ie_detail;
+    bool dissect_wps_identity;
+
     // Do we pull strings?
     int dissect_strings, dissect_all_strings;
 
@@ -542,6 +580,20 @@ protected:
     std::shared_ptr<tracker_element_vector> ssid_regex_vec;
     int ssid_regex_vec_element_id;
 
+    // SSID alerts are prefiltered by the literal each regex requires, compiled into one
+    // matcher; alerts whose regex is only a literal never run the regex.  The alerts an
+    // SSID matches are cached by the SSID hash, so a busy SSID is matched once
+    string_multimatch ssid_alert_literals;
+    std::vector<bool> ssid_alert_has_literal;
+    std::vector<bool> ssid_alert_is_literal;
+
+    void build_ssid_alert_index();
+    std::vector<unsigned int> match_ssid_alerts(const std::string& in_ssid, uint32_t in_ssid_hash);
+
+    kis_mutex ssid_alert_cache_mutex;
+    std::unordered_map<uint32_t, std::pair<std::string, std::vector<unsigned int>>> ssid_alert_cache;
+    const static size_t ssid_alert_cache_max = 4096;
+
     // Dissector alert references
     int alert_netstumbler_ref, alert_nullproberesp_ref, alert_lucenttest_ref,
         alert_msfbcomssid_ref, alert_msfdlinkrate_ref, alert_msfnetgearbeacon_ref,
@@ -559,6 +611,19 @@ protected:
     // Generated WEP identity / base
     unsigned char wep_identity[256];
 
+    // CCMP decryption of configured WPA2-PSK networks
+    std::unique_ptr<dot11_ccmp_decryptor> ccmp_decryptor;
+
+    // AP and client relationships
+    dot11_relation_index relations;
+
+    // Tracked devices of related device keys; keys of devices which are no longer
+    // tracked are dropped from the relation index
+    std::shared_ptr<tracker_element_vector> fetch_related(const std::vector<device_key>& keys);
+
+    // Device keys from the 'devices' list of a request
+    std::vector<device_key> request_device_keys(std::shared_ptr<kis_net_beast_httpd_connection> con);
+
     // Tracker alert references
     int alert_chan_ref, alert_dhcpcon_ref, alert_bcastdcon_ref, alert_airjackssid_ref,
         alert_wepflap_ref, alert_dhcpname_ref, alert_dhcpos_ref, alert_adhoc_ref,
@@ -570,6 +635,9 @@ protected:
 
     int signal_too_loud_threshold;
 
+    // Per-packet alerts, built-in and from 'dot11_alert_rule' config lines
+    std::shared_ptr<dot11_alert_rules> alert_rules;
+
     // Command refs
     int addfiltercmd_ref, addnetclifiltercmd_ref;
 
@@ -612,6 +680,9 @@ protected:
     // Do we store the last beaconed tags in the ssid record?
     bool keep_ie_tags_per_bssid;
 
+    // Parsed tags shared by the ssid records
+    dot11_ietag_store ietag_store;
+
     // Do we keep WPA packets?
     bool keep_eapol_packets;
 
@@ -628,6 +699,10 @@ protected:
     std::shared_ptr<tracker_element_string> devtype_device;
 
     std::shared_ptr<dot11_tracked_device> dot11_builder;
+
+    // Build a new 802.11 record for a device, in the device arena if it has one
+    std::shared_ptr<dot11_tracked_device> 
+        new_dot11_device(std::shared_ptr<kis_tracked_device_base> base);
 };
 
 #endif
@@ -0,0 +1,328 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include "alertracker.h"
+#include "messagebus.h"
+#include "phy_80211.h"
+#include "phy_80211_alertrules.h"
+#include "util.h"
+
+void dot11_alert_rule::add_subtype(unsigned int in_type, unsigned int in_subtype) {
+    if (in_type >= DOT11_RULE_TYPES || in_subtype >= DOT11_RULE_SUBTYPES)
+        return;
+
+    subtypes[in_type] |= (1 << in_subtype);
+}
+
+void dot11_alert_rule::add_type(unsigned int in_type) {
+    if (in_type >= DOT11_RULE_TYPES)
+        return;
+
+    subtypes[in_type] = 0xFFFF;
+}
+
+void dot11_alert_rules::add_rule(std::shared_ptr<dot11_alert_rule> in_rule) {
+    if (in_rule->alert_ref < 0)
+        return;
+
+    rules.push_back(in_rule);
+
+    for (unsigned int t = 0; t < DOT11_RULE_TYPES; t++) {
+        for (unsigned int s = 0; s < DOT11_RULE_SUBTYPES; s++) {
+            if (in_rule->subtypes[t] & (1 << s))
+                rule_table[t * DOT11_RULE_SUBTYPES + s].push_back(in_rule.get());
+        }
+    }
+}
+
+bool dot11_alert_rules::add_config_rule(const std::string& in_line, int in_phyid) {
+    auto cpos = in_line.find(':');
+
+    if (cpos == std::string::npos) {
+        _MSG_ERROR("Invalid 'dot11_alert_rule' configuration line, expected "
+                "'name:option=value,...' but got '{}'", in_line);
+        return false;
+    }
+
+    auto name = str_upper(in_line.substr(0, cpos));
+
+    std::vector<opt_pair> optvec;
+    string_to_opts(in_line.substr(cpos + 1, in_line.length()), ",", &optvec);
+
+    // Parse everything before activating the alert, so an invalid rule doesn't leave
+    // an alert behind
+    std::vector<unsigned int> types;
+    auto type_s = str_lower(fetch_opt("type", &optvec, "any"));
+
+    if (type_s == "management" || type_s == "mgmt")
+        types.push_back(packet_management);
+    else if (type_s == "control" || type_s == "ctrl" || type_s == "phy")
+        types.push_back(packet_phy);
+    else if (type_s == "data")
+        types.push_back(packet_data);
+    else if (type_s == "any")
+        types = {packet_management, packet_phy, packet_data};
+    else {
+        _MSG_ERROR("Invalid 'dot11_alert_rule' {}, unknown frame type '{}'", name, type_s);
+        return false;
+    }
+
+    static const std::map<std::string, unsigned int> mgmt_subtypes = {
+        {"association_req", packet_sub_association_req},
+        {"association_resp", packet_sub_association_resp},
+        {"reassociation_req", packet_sub_reassociation_req},
+        {"reassociation_resp", packet_sub_reassociation_resp},
+        {"probe_req", packet_sub_probe_req},
+        {"probe_resp", packet_sub_probe_resp},
+        {"beacon", packet_sub_beacon},
+        {"atim", packet_sub_atim},
+        {"disassociation", packet_sub_disassociation},
+        {"authentication", packet_sub_authentication},
+        {"deauthentication", packet_sub_deauthentication},
+        {"action", packet_sub_action},
+        {"action_noack", packet_sub_action_noack},
+    };
+
+    std::vector<unsigned int> subtypes;
+
+    for (const auto& s : str_tokenize(str_lower(fetch_opt("subtype", &optvec)), ",", true)) {
+        auto mi = mgmt_subtypes.find(s);
+
+        if (mi != mgmt_subtypes.end()) {
+            if (types.size() != 1 || types[0] != packet_management) {
+                _MSG_ERROR("Invalid 'dot11_alert_rule' {}, subtype '{}' requires "
+                        "type=management", name, s);
+                return false;
+            }
+
+            subtypes.push_back(mi->second);
+            continue;
+        }
+
+        auto st = string_to_n_dfl<unsigned int>(s, DOT11_RULE_SUBTYPES);
+
+        if (st >= DOT11_RULE_SUBTYPES) {
+            _MSG_ERROR("Invalid 'dot11_alert_rule' {}, unknown subtype '{}'", name, s);
+            return false;
+        }
+
+        subtypes.push_back(st);
+    }
+
+    static const std::map<std::string, uint32_t> flag_names = {
+        {"broadcast", DOT11_RULE_FLAG_BROADCAST},
+        {"retry", DOT11_RULE_FLAG_RETRY},
+        {"fragmented", DOT11_RULE_FLAG_FRAGMENTED},
+        {"protected", DOT11_RULE_FLAG_PROTECTED},
+        {"qos", DOT11_RULE_FLAG_QOS},
+        {"fromds", DOT11_RULE_FLAG_FROMDS},
+        {"tods", DOT11_RULE_FLAG_TODS},
+        {"wds", DOT11_RULE_FLAG_WDS},
+        {"adhoc", DOT11_RULE_FLAG_ADHOC},
+    };
+
+    auto parse_flags = [&](const std::string& in_opt, uint32_t *ret_flags) -> bool {
+        for (const auto& f : str_tokenize(str_lower(fetch_opt(in_opt, &optvec)), ",", true)) {
+            auto fi = flag_names.find(f);
+
+            if (fi == flag_names.end()) {
+                _MSG_ERROR("Invalid 'dot11_alert_rule' {}, unknown flag '{}'", name, f);
+                return false;
+            }
+
+            *ret_flags |= fi->second;
+        }
+
+        return true;
+    };
+
+    uint32_t flags_set = 0, flags_clear = 0;
+
+    if (!parse_flags("flags", &flags_set) || !parse_flags("notflags", &flags_clear))
+        return false;
+
+    auto parse_mac = [&](const std::string& in_opt, bool *ret_match, mac_addr *ret_mac) -> bool {
+        auto m = fetch_opt(in_opt, &optvec);
+
+        if (m.length() == 0)
+            return true;
+
+        *ret_mac = mac_addr(m);
+
+        if (ret_mac->state.error) {
+            _MSG_ERROR("Invalid 'dot11_alert_rule' {}, invalid {} MAC '{}'", name, in_opt, m);
+            return false;
+        }
+
+        *ret_match = true;
+        return true;
+    };
+
+    auto rule = std::make_shared<dot11_alert_rule>(-1);
+
+    if (!parse_mac("source", &rule->match_source, &rule->source) ||
+            !parse_mac("dest", &rule->match_dest, &rule->dest) ||
+            !parse_mac("bssid", &rule->match_bssid, &rule->bssid))
+        return false;
+
+    auto signal_s = fetch_opt("signal", &optvec);
+
+    if (signal_s.length() != 0) {
+        rule->match_signal = true;
+        rule->min_signal = string_to_n_dfl<int>(signal_s, 0);
+    }
+
+    auto severity_s = str_lower(fetch_opt("severity", &optvec, "medium"));
+    kis_alert_severity severity;
+
+    if (severity_s == "info")
+        severity = kis_alert_severity::info;
+    else if (severity_s == "low")
+        severity = kis_alert_severity::low;
+    else if (severity_s == "medium")
+        severity = kis_alert_severity::medium;
+    else if (severity_s == "high")
+        severity = kis_alert_severity::high;
+    else if (severity_s == "critical")
+        severity = kis_alert_severity::critical;
+    else {
+        _MSG_ERROR("Invalid 'dot11_alert_rule' {}, unknown severity '{}'", name, severity_s);
+        return false;
+    }
+
+    rule->fixed_text = fetch_opt("text", &optvec,
+            fmt::format("IEEE80211 frame matched alert rule {}", name));
+    rule->flags_set = flags_set;
+    rule->flags_clear = flags_clear;
+
+    for (auto t : types) {
+        if (subtypes.size() == 0)
+            rule->add_type(t);
+
+        for (auto s : subtypes)
+            rule->add_subtype(t, s);
+    }
+
+    rule->alert_ref =
+        alertracker->activate_configured_alert(name,
+                str_upper(fetch_opt("class", &optvec, "OTHER")), severity,
+                rule->fixed_text, in_phyid);
+
+    if (rule->alert_ref < 0)
+        return false;
+
+    add_rule(rule);
+
+    return true;
+}
+
+uint32_t dot11_alert_rules::packet_flags(dot11_packinfo *in_dot11info) {
+    uint32_t flags = 0;
+
+    if (in_dot11info->dest_mac == Globalreg::globalreg->broadcast_mac)
+        flags |= DOT11_RULE_FLAG_BROADCAST;
+    if (in_dot11info->retry)
+        flags |= DOT11_RULE_FLAG_RETRY;
+    if (in_dot11info->fragmented)
+        flags |= DOT11_RULE_FLAG_FRAGMENTED;
+    if (in_dot11info->encrypted)
+        flags |= DOT11_RULE_FLAG_PROTECTED;
+    if (in_dot11info->qos)
+        flags |= DOT11_RULE_FLAG_QOS;
+
+    switch (in_dot11info->distrib) {
+        case distrib_from:
+            flags |= DOT11_RULE_FLAG_FROMDS;
+            break;
+        case distrib_to:
+            flags |= DOT11_RULE_FLAG_TODS;
+            break;
+        case distrib_inter:
+            flags |= DOT11_RULE_FLAG_WDS;
+            break;
+        case distrib_adhoc:
+            flags |= DOT11_RULE_FLAG_ADHOC;
+            break;
+        default:
+            break;
+    }
+
+    return flags;
+}
+
+bool dot11_alert_rules::matches(dot11_alert_rule *in_rule, uint32_t in_flags,
+        dot11_packinfo *in_dot11info, kis_layer1_packinfo *in_l1info) {
+    if ((in_flags & in_rule->flags_set) != in_rule->flags_set)
+        return false;
+
+    if (in_flags & in_rule->flags_clear)
+        return false;
+
+    if (in_rule->match_source && !(in_rule->source == in_dot11info->source_mac))
+        return false;
+
+    if (in_rule->match_dest && !(in_rule->dest == in_dot11info->dest_mac))
+        return false;
+
+    if (in_rule->match_bssid && !(in_rule->bssid == in_dot11info->bssid_mac))
+        return false;
+
+    if (in_rule->match_signal &&
+            (in_l1info == nullptr || in_l1info->signal_dbm == 0 ||
+             in_l1info->signal_dbm < in_rule->min_signal))
+        return false;
+
+    if (in_rule->match != nullptr && !in_rule->match(in_dot11info, in_l1info))
+        return false;
+
+    return true;
+}
+
+void dot11_alert_rules::process_packet(std::shared_ptr<kis_packet> in_pack,
+        dot11_packinfo *in_dot11info, kis_layer1_packinfo *in_l1info) {
+
+    if (in_dot11info->type < 0 || in_dot11info->type >= DOT11_RULE_TYPES ||
+            in_dot11info->subtype < 0 || in_dot11info->subtype >= DOT11_RULE_SUBTYPES)
+        return;
+
+    const auto& candidates =
+        rule_table[in_dot11info->type * DOT11_RULE_SUBTYPES + in_dot11info->subtype];
+
+    if (candidates.size() == 0)
+        return;
+
+    auto flags = packet_flags(in_dot11info);
+
+    for (auto r : candidates) {
+        if (!matches(r, flags, in_dot11info, in_l1info))
+            continue;
+
+        if (!alertracker->potential_alert(r->alert_ref))
+            continue;
+
+        auto text = r->text != nullptr ? r->text(in_dot11info, in_l1info) : r->fixed_text;
+
+        alertracker->raise_alert(r->alert_ref, in_pack,
+                in_dot11info->bssid_mac, in_dot11info->source_mac,
+                in_dot11info->dest_mac, in_dot11info->other_mac,
+                in_dot11info->channel, text);
+    }
+}
+
@@ -0,0 +1,127 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __PHY_80211_ALERTRULES_H__
+#define __PHY_80211_ALERTRULES_H__
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "macaddr.h"
+
+class alert_tracker;
+class dot11_packinfo;
+class kis_layer1_packinfo;
+class kis_packet;
+
+// Frame flags a rule may require to be set or clear
+#define DOT11_RULE_FLAG_BROADCAST       (1 << 0)
+#define DOT11_RULE_FLAG_RETRY           (1 << 1)
+#define DOT11_RULE_FLAG_FRAGMENTED      (1 << 2)
+#define DOT11_RULE_FLAG_PROTECTED       (1 << 3)
+#define DOT11_RULE_FLAG_QOS             (1 << 4)
+#define DOT11_RULE_FLAG_FROMDS          (1 << 5)
+#define DOT11_RULE_FLAG_TODS            (1 << 6)
+#define DOT11_RULE_FLAG_WDS             (1 << 7)
+#define DOT11_RULE_FLAG_ADHOC           (1 << 8)
+
+// Frame types indexed by the rule table; management, control (phy), and data, each
+// with 16 subtypes
+#define DOT11_RULE_TYPES                3
+#define DOT11_RULE_SUBTYPES             16
+
+// A per-packet 802.11 alert.  The frame types and subtypes a rule can fire on, and the
+// frame flags it needs, are known when the rule is added, so a packet is only tested
+// against the rules which could match it; the remaining conditions, and the alert rate
+// limits, are only checked for those.
+class dot11_alert_rule {
+public:
+    using match_func = std::function<bool (dot11_packinfo *, kis_layer1_packinfo *)>;
+    using text_func = std::function<std::string (dot11_packinfo *, kis_layer1_packinfo *)>;
+
+    dot11_alert_rule(int in_alert_ref) :
+        alert_ref{in_alert_ref} { }
+
+    // Fire on a subtype of a type, or on every subtype of a type
+    void add_subtype(unsigned int in_type, unsigned int in_subtype);
+    void add_type(unsigned int in_type);
+
+    int alert_ref;
+
+    // Bitmask of the subtypes of each type the rule fires on
+    std::array<uint16_t, DOT11_RULE_TYPES> subtypes{{0, 0, 0}};
+
+    // DOT11_RULE_FLAG_ flags which must be set, and which must be clear
+    uint32_t flags_set{0};
+    uint32_t flags_clear{0};
+
+    // Optional (maskable) addresses which must match
+    bool match_source{false}, match_dest{false}, match_bssid{false};
+    mac_addr source, dest, bssid;
+
+    // Optional minimum signal level
+    bool match_signal{false};
+    int min_signal{0};
+
+    // Optional further test of the packet, for rules which can't be described by the above
+    match_func match;
+
+    // Alert text; rules without a text function use the fixed text
+    text_func text;
+    std::string fixed_text;
+};
+
+class dot11_alert_rules {
+public:
+    dot11_alert_rules(std::shared_ptr<alert_tracker> in_alertracker) :
+        alertracker{in_alertracker} { }
+
+    // Rules are added while the phy is initialized, before packets are processed,
+    // and are not changed afterwards
+    void add_rule(std::shared_ptr<dot11_alert_rule> in_rule);
+
+    // Define a rule from a 'dot11_alert_rule' config line
+    bool add_config_rule(const std::string& in_line, int in_phyid);
+
+    // Raise the alerts of every rule matching a packet
+    void process_packet(std::shared_ptr<kis_packet> in_pack, dot11_packinfo *in_dot11info,
+            kis_layer1_packinfo *in_l1info);
+
+    static uint32_t packet_flags(dot11_packinfo *in_dot11info);
+
+protected:
+    std::shared_ptr<alert_tracker> alertracker;
+
+    std::vector<std::shared_ptr<dot11_alert_rule>> rules;
+
+    // Candidate rules for each type and subtype
+    std::array<std::vector<dot11_alert_rule *>, DOT11_RULE_TYPES * DOT11_RULE_SUBTYPES> rule_table;
+
+    bool matches(dot11_alert_rule *in_rule, uint32_t in_flags, dot11_packinfo *in_dot11info,
+            kis_layer1_packinfo *in_l1info);
+};
+
+#endif
+
@@ -0,0 +1,464 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "configfile.h"
+#include "globalregistry.h"
+#include "messagebus.h"
+#include "phy_80211_ccmp.h"
+#include "sha1.h"
+#include "util.h"
+
+namespace {
+    // EAPOL-Key frame layout, from the start of the 802.1X header
+    const size_t eapol_key_info_pos = 5;
+    const size_t eapol_nonce_pos = 17;
+    const size_t eapol_mic_pos = 81;
+    const size_t eapol_mic_len = 16;
+    const size_t eapol_data_len_pos = 97;
+    const size_t eapol_min_len = 99;
+
+    const uint16_t key_info_version_mask = 0x0007;
+    const uint16_t key_info_version_aes_hmac_sha1 = 2;
+    const uint16_t key_info_pairwise = 0x0008;
+    const uint16_t key_info_ack = 0x0080;
+    const uint16_t key_info_mic = 0x0100;
+
+    // CCMP header and MIC
+    const size_t ccmp_hdr_len = 8;
+
+    // Handshakes which never complete are dropped after this long
+    const time_t handshake_timeout = 60;
+
+    inline uint16_t be16(const uint8_t *p) {
+        return (uint16_t) ((p[0] << 8) | p[1]);
+    }
+
+    inline void mac_bytes(const mac_addr& m, uint8_t *out) {
+        for (unsigned int i = 0; i < 6; i++)
+            out[i] = (uint8_t) m[i];
+    }
+
+    inline int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+dot11_ccmp_decryptor::dot11_ccmp_decryptor() :
+    budget_ns{0},
+    window_start_ns{0},
+    window_used_ns{0},
+    handshakes_verified{0},
+    handshakes_failed{0},
+    frames_decrypted{0},
+    frames_failed{0},
+    frames_no_key{0},
+    frames_over_budget{0} {
+
+    mutex.set_name("dot11_ccmp_decryptor");
+
+    max_clients =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<size_t>("dot11_ccmp_max_clients", 4096);
+
+    auto budget =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("dot11_ccmp_cpu_budget", 50);
+    budget_ns = (int64_t) std::min(budget, 100U) * 10000000LL;
+
+    for (const auto& l : Globalreg::globalreg->kismet_config->fetch_opt_vec("dot11_psk")) {
+        auto comma = l.find(',');
+
+        if (comma == std::string::npos || !add_psk(l.substr(0, comma), l.substr(comma + 1))) {
+            _MSG_FATAL("Malformed 'dot11_psk' option in the config file, expected "
+                    "dot11_psk=ssid,passphrase or dot11_psk=ssid,64-character-hex-psk");
+            Globalreg::globalreg->fatal_condition = 1;
+            return;
+        }
+    }
+
+    if (pmks.size() > 0)
+        _MSG_INFO("Decrypting WPA2-PSK CCMP traffic of {} configured network(s) using {} AES",
+                pmks.size(), aes128_ccm::impl_name());
+}
+
+bool dot11_ccmp_decryptor::add_psk(const std::string& ssid, const std::string& key) {
+    if (ssid.length() == 0 || ssid.length() > 32)
+        return false;
+
+    psk_entry e;
+    e.ssid = ssid;
+
+    if (key.length() == pmk_len * 2) {
+        for (size_t i = 0; i < pmk_len; i++) {
+            auto d1 = x_to_i(key[i * 2]);
+            auto d2 = x_to_i(key[i * 2 + 1]);
+
+            if (d1 < 0 || d2 < 0)
+                return false;
+
+            e.pmk[i] = (uint8_t) ((d1 << 4) | d2);
+        }
+    } else if (key.length() >= 8 && key.length() <= 63) {
+        pbkdf2_hmac_sha1(key.data(), key.length(), ssid.data(), ssid.length(), 4096,
+                e.pmk, pmk_len);
+    } else {
+        return false;
+    }
+
+    kis_lock_guard<kis_mutex> lk(mutex, "dot11_ccmp_decryptor add_psk");
+    pmks.push_back(e);
+
+    return true;
+}
+
+void dot11_ccmp_decryptor::handle_eapol(const mac_addr& bssid, const mac_addr& client,
+        bool from_ap, const uint8_t *eapol, size_t eapol_len) {
+
+    // EAPOL-Key frames only
+    if (eapol_len < eapol_min_len || eapol[1] != 3)
+        return;
+
+    size_t frame_len = 4 + be16(eapol + 2);
+
+    if (frame_len > eapol_len || frame_len < eapol_min_len)
+        return;
+
+    // RSN or WPA key descriptors
+    if (eapol[4] != 2 && eapol[4] != 254)
+        return;
+
+    auto info = be16(eapol + eapol_key_info_pos);
+
+    if ((info & key_info_version_mask) != key_info_version_aes_hmac_sha1 ||
+            !(info & key_info_pairwise))
+        return;
+
+    auto key = std::make_pair(bssid, client);
+    auto now = time(0);
+
+    kis_lock_guard<kis_mutex> lk(mutex, "dot11_ccmp_decryptor handle_eapol");
+
+    if (pmks.size() == 0)
+        return;
+
+    auto hi = handshakes.find(key);
+
+    if (hi == handshakes.end()) {
+        if (handshakes.size() >= max_clients) {
+            for (auto i = handshakes.begin(); i != handshakes.end(); ) {
+                if (now - i->second.last_time > handshake_timeout)
+                    i = handshakes.erase(i);
+                else
+                    ++i;
+            }
+
+            if (handshakes.size() >= max_clients)
+                return;
+        }
+
+        hi = handshakes.emplace(key, handshake()).first;
+    }
+
+    auto& hs = hi->second;
+    hs.last_time = now;
+
+    if (from_ap && (info & key_info_ack)) {
+        // Messages 1 and 3 both carry the ANonce
+        memcpy(hs.anonce, eapol + eapol_nonce_pos, nonce_len);
+        hs.have_anonce = true;
+    } else if (!from_ap && (info & key_info_mic) && !(info & key_info_ack) &&
+            be16(eapol + eapol_data_len_pos) != 0) {
+        // Message 2; message 4 carries no key data
+        memcpy(hs.snonce, eapol + eapol_nonce_pos, nonce_len);
+        hs.m2.assign(reinterpret_cast<const char *>(eapol), frame_len);
+        hs.have_m2 = true;
+    } else {
+        return;
+    }
+
+    if (hs.have_anonce && hs.have_m2)
+        derive_ptk(key, hs);
+}
+
+void dot11_ccmp_decryptor::derive_ptk(const client_key& key, handshake& hs) {
+    // Each message 2 is only tried once
+    hs.have_m2 = false;
+
+    // min(AA, SPA) || max(AA, SPA) || min(ANonce, SNonce) || max(ANonce, SNonce)
+    uint8_t data[12 + nonce_len * 2];
+    bool ap_first = key.first < key.second;
+    bool anonce_first = memcmp(hs.anonce, hs.snonce, nonce_len) < 0;
+
+    mac_bytes(ap_first ? key.first : key.second, data);
+    mac_bytes(ap_first ? key.second : key.first, data + 6);
+    memcpy(data + 12, anonce_first ? hs.anonce : hs.snonce, nonce_len);
+    memcpy(data + 12 + nonce_len, anonce_first ? hs.snonce : hs.anonce, nonce_len);
+
+    static const char label[] = "Pairwise key expansion";
+
+    std::string m2 = hs.m2;
+    memset(&m2[eapol_mic_pos], 0, eapol_mic_len);
+
+    for (const auto& p : pmks) {
+        // PRF-384:  KCK, KEK, TK
+        uint8_t ptk[sha1_hash::digest_len * 3];
+
+        hmac_sha1 prf(p.pmk, pmk_len);
+
+        for (uint8_t i = 0; i < 3; i++) {
+            uint8_t zero = 0;
+
+            prf.reset();
+            prf.update(label, sizeof(label) - 1);
+            prf.update(&zero, 1);
+            prf.update(data, sizeof(data));
+            prf.update(&i, 1);
+            prf.final(ptk + i * sha1_hash::digest_len);
+        }
+
+        uint8_t mic[sha1_hash::digest_len];
+
+        hmac_sha1 kck(ptk, 16);
+        kck.update(m2.data(), m2.length());
+        kck.final(mic);
+
+        if (memcmp(mic, hs.m2.data() + eapol_mic_pos, eapol_mic_len) != 0)
+            continue;
+
+        auto ptk_e = std::make_shared<pairwise_key>(ptk + 32);
+        ptk_e->ssid = p.ssid;
+        ptk_e->last_time = time(0);
+
+        if (ptks.find(key) == ptks.end() && ptks.size() >= max_clients) {
+            // Replace the key which has gone unused longest
+            auto oldest = std::min_element(ptks.begin(), ptks.end(),
+                    [](const auto& a, const auto& b) {
+                        return a.second->last_time < b.second->last_time;
+                    });
+            ptks.erase(oldest);
+        }
+
+        ptks[key] = ptk_e;
+        handshakes_verified++;
+
+        _MSG_INFO("Decrypting CCMP traffic between {} and {} on '{}'",
+                key.first.mac_to_string(), key.second.mac_to_string(), p.ssid);
+
+        return;
+    }
+
+    handshakes_failed++;
+}
+
+bool dot11_ccmp_decryptor::within_budget(int64_t now) {
+    if (budget_ns == 0)
+        return true;
+
+    auto start = window_start_ns.load();
+
+    if (now - start >= 1000000000LL && window_start_ns.compare_exchange_strong(start, now))
+        window_used_ns = 0;
+
+    return window_used_ns.load() < budget_ns;
+}
+
+std::shared_ptr<kis_datachunk> dot11_ccmp_decryptor::decrypt(const mac_addr& bssid,
+        const mac_addr& client, const uint8_t *frame, size_t len) {
+
+    if (len < 24)
+        return nullptr;
+
+    uint8_t fc0 = frame[0];
+    uint8_t fc1 = frame[1];
+
+    // Protected data frames only
+    if (((fc0 >> 2) & 0x03) != 2 || !(fc1 & 0x40))
+        return nullptr;
+
+    bool a4 = (fc1 & 0x03) == 0x03;
+    bool qos = (fc0 & 0x80) != 0;
+
+    size_t hdr_len = 24;
+    size_t qos_pos = 0;
+
+    if (a4)
+        hdr_len += 6;
+
+    if (qos) {
+        qos_pos = hdr_len;
+        hdr_len += 2;
+
+        // HT control
+        if (fc1 & 0x80)
+            hdr_len += 4;
+    }
+
+    if (len < hdr_len + ccmp_hdr_len + aes128_ccm::mic_len)
+        return nullptr;
+
+    const uint8_t *ccmp = frame + hdr_len;
+
+    // Extended IV, and the always zero reserved byte which TKIP uses for the WEP seed
+    if (!(ccmp[3] & 0x20) || ccmp[2] != 0)
+        return nullptr;
+
+    std::shared_ptr<pairwise_key> ptk;
+
+    {
+        kis_lock_guard<kis_mutex> lk(mutex, "dot11_ccmp_decryptor decrypt");
+
+        auto pi = ptks.find(std::make_pair(bssid, client));
+
+        if (pi != ptks.end())
+            ptk = pi->second;
+    }
+
+    if (ptk == nullptr) {
+        frames_no_key++;
+        return nullptr;
+    }
+
+    auto start = now_ns();
+
+    if (!within_budget(start)) {
+        frames_over_budget++;
+        return nullptr;
+    }
+
+    // Priority, transmitter address, and the packet number, most significant first
+    uint8_t nonce[aes128_ccm::nonce_len];
+    nonce[0] = qos ? (frame[qos_pos] & 0x0F) : 0;
+    memcpy(nonce + 1, frame + 10, 6);
+    nonce[7] = ccmp[7];
+    nonce[8] = ccmp[6];
+    nonce[9] = ccmp[5];
+    nonce[10] = ccmp[4];
+    nonce[11] = ccmp[1];
+    nonce[12] = ccmp[0];
+
+    // Frame control with the subtype, retry, power management and more data bits
+    // masked, the addresses, the fragment number, and the TID
+    uint8_t aad[aes128_ccm::max_aad_len];
+    size_t aad_len = 0;
+
+    aad[aad_len++] = fc0 & 0x8F;
+    aad[aad_len++] = (uint8_t) (((fc1 & ~0x38) | 0x40) & (qos ? 0x7F : 0xFF));
+    memcpy(aad + aad_len, frame + 4, 18);
+    aad_len += 18;
+    aad[aad_len++] = frame[22] & 0x0F;
+    aad[aad_len++] = 0;
+
+    if (a4) {
+        memcpy(aad + aad_len, frame + 24, 6);
+        aad_len += 6;
+    }
+
+    if (qos) {
+        aad[aad_len++] = frame[qos_pos] & 0x0F;
+        aad[aad_len++] = 0;
+    }
+
+    size_t data_len = len - hdr_len - ccmp_hdr_len - aes128_ccm::mic_len;
+
+    auto manglechunk = std::make_shared<kis_datachunk>();
+    manglechunk->dlt = KDLT_IEEE802_11;
+
+    auto& raw = manglechunk->raw();
+    raw.resize(hdr_len + data_len);
+    memcpy(&raw[0], frame, hdr_len);
+
+    bool ok = ptk->tk.decrypt(nonce, aad, aad_len, ccmp + ccmp_hdr_len, data_len,
+            reinterpret_cast<uint8_t *>(&raw[hdr_len]));
+
+    window_used_ns += now_ns() - start;
+
+    if (!ok) {
+        ptk->failed++;
+        frames_failed++;
+        return nullptr;
+    }
+
+    // Clear the protected bit
+    raw[1] &= ~0x40;
+    manglechunk->set_data(raw);
+
+    ptk->last_time = time(0);
+    ptk->decrypted++;
+    frames_decrypted++;
+
+    return manglechunk;
+}
+
+std::shared_ptr<tracker_element> dot11_ccmp_decryptor::get_stats() {
+    // As with the other status endpoints, a full tracked component isn't worth it here
+    auto ret = std::make_shared<tracker_element_string_map>();
+    auto clients = std::make_shared<tracker_element_vector>();
+
+    ret->insert(std::make_pair("kismet.dot11.ccmp.aes_impl",
+                std::make_shared<tracker_element_string>(aes128_ccm::impl_name())));
+    ret->insert(std::make_pair("kismet.dot11.ccmp.cpu_budget_ns",
+                std::make_shared<tracker_element_uint64>(0, budget_ns)));
+    ret->insert(std::make_pair("kismet.dot11.ccmp.handshakes_verified",
+                std::make_shared<tracker_element_uint64>(0, handshakes_verified)));
+    ret->insert(std::make_pair("kismet.dot11.ccmp.handshakes_failed",
+                std::make_shared<tracker_element_uint64>(0, handshakes_failed)));
+    ret->insert(std::make_pair("kismet.dot11.ccmp.decrypted",
+                std::make_shared<tracker_element_uint64>(0, frames_decrypted)));
+    ret->insert(std::make_pair("kismet.dot11.ccmp.failed",
+                std::make_shared<tracker_element_uint64>(0, frames_failed)));
+    ret->insert(std::make_pair("kismet.dot11.ccmp.no_key",
+                std::make_shared<tracker_element_uint64>(0, frames_no_key)));
+    ret->insert(std::make_pair("kismet.dot11.ccmp.over_budget",
+                std::make_shared<tracker_element_uint64>(0, frames_over_budget)));
+
+    kis_lock_guard<kis_mutex> lk(mutex, "dot11_ccmp_decryptor get_stats");
+
+    ret->insert(std::make_pair("kismet.dot11.ccmp.networks",
+                std::make_shared<tracker_element_uint64>(0, pmks.size())));
+
+    for (const auto& pi : ptks) {
+        auto cmap = std::make_shared<tracker_element_string_map>();
+
+        cmap->insert(std::make_pair("kismet.dot11.ccmp.client.bssid",
+                    std::make_shared<tracker_element_mac_addr>(0, pi.first.first)));
+        cmap->insert(std::make_pair("kismet.dot11.ccmp.client.mac",
+                    std::make_shared<tracker_element_mac_addr>(0, pi.first.second)));
+        cmap->insert(std::make_pair("kismet.dot11.ccmp.client.ssid",
+                    std::make_shared<tracker_element_string>(pi.second->ssid)));
+        cmap->insert(std::make_pair("kismet.dot11.ccmp.client.last_time",
+                    std::make_shared<tracker_element_uint64>(0, pi.second->last_time.load())));
+        cmap->insert(std::make_pair("kismet.dot11.ccmp.client.decrypted",
+                    std::make_shared<tracker_element_uint64>(0, pi.second->decrypted.load())));
+        cmap->insert(std::make_pair("kismet.dot11.ccmp.client.failed",
+                    std::make_shared<tracker_element_uint64>(0, pi.second->failed.load())));
+
+        clients->push_back(cmap);
+    }
+
+    ret->insert(std::make_pair("kismet.dot11.ccmp.clients", clients));
+
+    return ret;
+}
+
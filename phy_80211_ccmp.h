@@ -0,0 +1,152 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __PHY_80211_CCMP_H__
+#define __PHY_80211_CCMP_H__
+
+#include "config.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "aes_ccm.h"
+#include "kis_mutex.h"
+#include "macaddr.h"
+#include "packet.h"
+#include "trackedelement.h"
+
+// WPA2-PSK CCMP decryption of our own networks
+//
+// With the passphrase (or the raw PSK) of a network configured via dot11_psk, the
+// pairwise keys of every client are derived from the 4-way handshakes seen on the
+// air, and unicast CCMP data frames between the AP and that client are decrypted so
+// the data dissectors can see the traffic, the same as with WEP keys.
+//
+// Only the PSK / HMAC-SHA1 AKM (key descriptor version 2) is handled; group traffic is
+// encrypted with the GTK, which is not followed.  A client is only decrypted if the
+// handshake was seen, and the MIC of message 2 verifies with one of the configured
+// keys.
+//
+// Derived pairwise keys are cached per BSSID and client.  Decryption time is tracked
+// against dot11_ccmp_cpu_budget, the share of one CPU which may be spent decrypting;
+// frames arriving once the budget of the current second is spent are passed through
+// still encrypted rather than holding up the packet chain.
+class dot11_ccmp_decryptor {
+public:
+    static constexpr size_t pmk_len = 32;
+    static constexpr size_t nonce_len = 32;
+
+    dot11_ccmp_decryptor();
+
+    // Add a network key, from a passphrase or a 64 character hex PSK; returns false if
+    // the key is invalid
+    bool add_psk(const std::string& ssid, const std::string& key);
+
+    size_t num_psks() const {
+        return pmks.size();
+    }
+
+    // Follow the handshake in an unprotected EAPOL-Key frame
+    void handle_eapol(const mac_addr& bssid, const mac_addr& client, bool from_ap,
+            const uint8_t *eapol, size_t eapol_len);
+
+    // Decrypt a CCMP protected data frame between a BSSID and a client; returns the
+    // frame with the CCMP header and MIC removed and the protected bit cleared, or
+    // nullptr when there is no key for the client, the frame doesn't verify, or the
+    // CPU budget is spent
+    std::shared_ptr<kis_datachunk> decrypt(const mac_addr& bssid, const mac_addr& client,
+            const uint8_t *frame, size_t len);
+
+    std::shared_ptr<tracker_element> get_stats();
+
+protected:
+    struct psk_entry {
+        std::string ssid;
+        uint8_t pmk[pmk_len];
+    };
+
+    // Handshake in progress between an AP and a client
+    struct handshake {
+        handshake() :
+            have_anonce{false},
+            have_m2{false},
+            last_time{0} { }
+
+        bool have_anonce;
+        uint8_t anonce[nonce_len];
+
+        // Message 2, kept until the ANonce is known if message 1 was missed
+        bool have_m2;
+        uint8_t snonce[nonce_len];
+        std::string m2;
+
+        time_t last_time;
+    };
+
+    struct pairwise_key {
+        pairwise_key(const uint8_t *in_tk) :
+            tk{in_tk},
+            last_time{0},
+            decrypted{0},
+            failed{0} { }
+
+        aes128_ccm tk;
+
+        std::string ssid;
+        std::atomic<time_t> last_time;
+        std::atomic<uint64_t> decrypted;
+        std::atomic<uint64_t> failed;
+    };
+
+    using client_key = std::pair<mac_addr, mac_addr>;
+
+    // Try every configured PMK against a complete handshake, and install the pairwise
+    // key of the one the MIC verifies with
+    void derive_ptk(const client_key& key, handshake& hs);
+
+    bool within_budget(int64_t now_ns);
+
+    kis_mutex mutex;
+
+    std::vector<psk_entry> pmks;
+
+    std::map<client_key, handshake> handshakes;
+    std::map<client_key, std::shared_ptr<pairwise_key>> ptks;
+
+    size_t max_clients;
+
+    // Nanoseconds of decryption allowed per second, or 0 for no limit, and the use of
+    // the current second
+    int64_t budget_ns;
+    std::atomic<int64_t> window_start_ns;
+    std::atomic<int64_t> window_used_ns;
+
+    std::atomic<uint64_t> handshakes_verified;
+    std::atomic<uint64_t> handshakes_failed;
+    std::atomic<uint64_t> frames_decrypted;
+    std::atomic<uint64_t> frames_failed;
+    std::atomic<uint64_t> frames_no_key;
+    std::atomic<uint64_t> frames_over_budget;
+};
+
+#endif
+
@@ -96,6 +96,10 @@ void dot11_tracked_ssid_alert::set_allowed_macs(std::vector<mac_addr> mvec) {
 }
 
 bool dot11_tracked_ssid_alert::compare_ssid(const std::string& ssid, mac_addr mac) {
+    return match_ssid(ssid) && !is_allowed_mac(mac);
+}
+
+bool dot11_tracked_ssid_alert::match_ssid(const std::string& ssid) {
     kis_lock_guard<kis_mutex> lk(ssid_mutex);
 
 #ifdef HAVE_LIBPCRE
@@ -104,23 +108,22 @@ bool dot11_tracked_ssid_alert::compare_ssid(const std::string& ssid, mac_addr ma
 
     rc = pcre_exec(ssid_re, ssid_study, ssid.c_str(), ssid.length(), 0, 0, ovector, 128);
 
-    if (rc > 0) {
-        bool valid = false;
+    if (rc > 0)
+        return true;
+#endif
 
-        for (const auto& m : *allowed_macs_vec) {
-            if (get_tracker_value<mac_addr>(m) == mac) {
-                valid = true;
-                break;
-            }
-        }
+    return false;
+}
+
+bool dot11_tracked_ssid_alert::is_allowed_mac(const mac_addr& mac) {
+    kis_lock_guard<kis_mutex> lk(ssid_mutex);
 
-        if (!valid)
+    for (const auto& m : *allowed_macs_vec) {
+        if (get_tracker_value<mac_addr>(m) == mac)
             return true;
     }
-#endif
 
     return false;
-
 }
 
 void dot11_tracked_nonce::register_fields() {
@@ -147,6 +150,41 @@ void dot11_tracked_nonce::set_from_eapol(shared_tracker_element in_tracked_eapol
     set_eapol_nonce_bytes(e->get_eapol_nonce_bytes());
 }
 
+bool dot11_handshake_state::update(std::shared_ptr<dot11_tracked_eapol> in_eapol) {
+    auto msg_num = in_eapol->get_eapol_msg_num();
+
+    if (msg_num < 1 || msg_num > 4)
+        return false;
+
+    // A complete handshake is kept as it is
+    if (get_complete())
+        return false;
+
+    auto slot = msg_num - 1;
+    auto& existing = eapol[slot];
+
+    // Retransmissions of a frame we already have don't change anything
+    if (existing != nullptr &&
+            existing->get_eapol_replay_counter() == in_eapol->get_eapol_replay_counter() &&
+            existing->get_eapol_nonce_bytes() == in_eapol->get_eapol_nonce_bytes())
+        return false;
+
+    // A new M1 nonce is a new exchange, and the rest of the old one is useless
+    if (msg_num == 1 && existing != nullptr &&
+            existing->get_eapol_nonce_bytes() != in_eapol->get_eapol_nonce_bytes()) {
+        for (unsigned int i = 1; i < 4; i++)
+            eapol[i].reset();
+        keymask = 0;
+    }
+
+    existing = in_eapol;
+    keymask |= (1 << slot);
+
+    pcap_cache.invalidate();
+
+    return true;
+}
+
 void dot11_probed_ssid::register_fields() {
     register_field("dot11.probedssid.ssid", "probed ssid string (sanitized)", &ssid);
     register_field("dot11.probedssid.ssidlen", 
@@ -331,20 +369,87 @@ void dot11_advertised_ssid::register_fields() {
                 "802.11s Mesh forwarding enabled");
 }
 
-void dot11_advertised_ssid::set_ietag_content_from_packet(std::shared_ptr<dot11_ie> tags) {
-    auto tagmap = get_ie_tag_content();
+void dot11_advertised_ssid::set_ietag_content_from_packet(std::shared_ptr<dot11_ie> tags,
+        dot11_ietag_store& store) {
+    store.populate(tags, ie_tag_builder.get(), get_ie_tag_content());
+}
 
-    tagmap->clear();
+dot11_ietag_store::dot11_ietag_store() :
+    sweep_at{1024},
+    shared{0},
+    parsed{0} {
+    mutex.set_name("dot11_ietag_store");
+}
 
-    if (tags == nullptr)
+void dot11_ietag_store::populate(std::shared_ptr<dot11_ie> tags, const dot11_tracked_ietag *builder,
+        std::shared_ptr<tracker_element_int_map> tagmap) {
+    if (tags == nullptr) {
+        tagmap->clear();
         return;
+    }
+
+    auto hash = std::hash<std::string_view>{};
+    std::vector<std::shared_ptr<dot11_tracked_ietag>> found;
+
+    found.reserve(tags->n_tags());
+
+    {
+        kis_lock_guard<kis_mutex> lk(mutex, "dot11_ietag_store populate");
 
-    for (auto t : *(tags->tags())) {
-        auto tag =
-            Globalreg::new_from_pool<dot11_tracked_ietag>(ie_tag_builder.get());
-        tag->set_from_tag(t);
-        tagmap->insert(tag->get_unique_tag_id(), tag);
+        for (size_t n = 0; n < tags->n_tags(); n++) {
+            auto num = tags->tag_num(n);
+            auto view = tags->tag_view(n);
+            auto key = hash(view) * 31 + num;
+
+            std::shared_ptr<dot11_tracked_ietag> tag;
+
+            auto range = tag_map.equal_range(key);
+            for (auto i = range.first; i != range.second; ++i) {
+                auto t = i->second.lock();
+
+                if (t != nullptr && t->matches(num, view)) {
+                    tag = t;
+                    break;
+                }
+            }
+
+            if (tag != nullptr) {
+                shared++;
+            } else {
+                tag = Globalreg::new_from_pool<dot11_tracked_ietag>(builder);
+                tag->set_from_tag(tags->tag(n));
+                tag_map.emplace(key, tag);
+                parsed++;
+            }
+
+            found.push_back(tag);
+        }
+
+        // Tags which change every beacon, like the TIM, leave a trail of released
+        // references; sweep them once the map has doubled
+        if (tag_map.size() >= sweep_at) {
+            for (auto i = tag_map.begin(); i != tag_map.end(); ) {
+                if (i->second.expired())
+                    i = tag_map.erase(i);
+                else
+                    ++i;
+            }
+
+            sweep_at = std::max<size_t>(1024, tag_map.size() * 2);
+        }
     }
+
+    // The previous content is only released now, so tags which haven't changed since
+    // the last beacon were found above instead of being parsed again
+    tagmap->clear();
+
+    for (const auto& t : found)
+        tagmap->insert(t->get_unique_tag_id(), t);
+}
+
+size_t dot11_ietag_store::size() {
+    kis_lock_guard<kis_mutex> lk(mutex, "dot11_ietag_store size");
+    return tag_map.size();
 }
 
 void dot11_advertised_ssid::set_dot11d_vec(std::vector<dot11_packinfo_dot11d_entry> vec) {
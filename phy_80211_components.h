@@ -24,9 +24,12 @@
 #include <time.h>
 
 #include <algorithm>
+#include <atomic>
 #include <list>
 #include <map>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -37,6 +40,7 @@
 #include "devicetracker_component.h"
 #include "entrytracker.h"
 #include "globalregistry.h"
+#include "kis_mutex.h"
 #include "trackedcomponent.h"
 
 #include "dot11_parsers/dot11_ie.h"
@@ -86,7 +90,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -157,7 +161,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -186,6 +190,54 @@ protected:
     std::shared_ptr<tracker_element_uint64> eapol_replay_counter;
 };
 
+// Cached pcap rendering of snapshotted packets; the beacon is snapshotted after the
+// handshake, so the cache also records if it included one
+struct dot11_pcap_cache {
+    dot11_pcap_cache() :
+        valid{false},
+        beacon{false} { }
+
+    void invalidate() {
+        valid = false;
+        pcap.clear();
+    }
+
+    std::string pcap;
+    bool valid;
+    bool beacon;
+};
+
+// Per-client WPA handshake state
+//
+// Keeps only the latest copy of each of M1 through M4 of the current exchange; an
+// M1 with a new nonce starts a new exchange, and once all four messages have been
+// seen the handshake is kept as it is.  The keymask tracks the filled slots so
+// completion is known without looking at the stored frames.
+class dot11_handshake_state {
+public:
+    dot11_handshake_state() :
+        keymask{0} { }
+
+    // Record a handshake frame; returns true if the stored handshake changed
+    bool update(std::shared_ptr<dot11_tracked_eapol> in_eapol);
+
+    bool get_complete() const {
+        return keymask == 0x0F;
+    }
+
+    uint8_t get_keymask() const {
+        return keymask;
+    }
+
+    // Stored frames, in message order
+    std::shared_ptr<dot11_tracked_eapol> eapol[4];
+
+    dot11_pcap_cache pcap_cache;
+
+protected:
+    uint8_t keymask;
+};
+
 class dot11_tracked_ssid_alert : public tracker_component {
 public:
     dot11_tracked_ssid_alert() :
@@ -251,7 +303,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -267,6 +319,11 @@ public:
 
     bool compare_ssid(const std::string& ssid, mac_addr mac);
 
+    // The regex alone, and the allowed macs alone, for callers which have already
+    // prefiltered the ssid
+    bool match_ssid(const std::string& ssid);
+    bool is_allowed_mac(const mac_addr& mac);
+
 protected:
     kis_mutex ssid_mutex;
 
@@ -319,7 +376,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -377,7 +434,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -390,6 +447,11 @@ public:
 
     void set_from_tag(std::shared_ptr<dot11_ie::dot11_ie_tag> ie);
 
+    // Does this tag hold exactly this tag number and content
+    bool matches(uint8_t in_num, std::string_view in_data) {
+        return get_tag_number() == in_num && complete_tag_data->get() == in_data;
+    }
+
 protected:
     virtual void register_fields() override;
 
@@ -401,6 +463,45 @@ protected:
     std::shared_ptr<tracker_element_byte_array> complete_tag_data;
 };
 
+// Parsed IE tags shared between advertised SSID records
+//
+// APs in enterprise and mesh deployments often advertise byte-identical vendor, WPS,
+// and capability tags.  Instead of every SSID record parsing and holding its own copy,
+// tags are looked up by content, and every record advertising the same tag references
+// one parsed tag.  The store only holds weak references; a tag is freed once no record
+// references it.
+class dot11_ietag_store {
+public:
+    dot11_ietag_store();
+
+    // Fill a tag content map with the shared parsed tags of an IE block, parsing only
+    // tags no other record currently holds
+    void populate(std::shared_ptr<dot11_ie> tags, const dot11_tracked_ietag *builder,
+            std::shared_ptr<tracker_element_int_map> tagmap);
+
+    size_t size();
+
+    uint64_t get_shared() const {
+        return shared;
+    }
+
+    uint64_t get_parsed() const {
+        return parsed;
+    }
+
+protected:
+    kis_mutex mutex;
+
+    // Hash of the tag number and content to parsed tags
+    std::unordered_multimap<size_t, std::weak_ptr<dot11_tracked_ietag>> tag_map;
+
+    // Size at which released tags are next swept from the map
+    size_t sweep_at;
+
+    std::atomic<uint64_t> shared;
+    std::atomic<uint64_t> parsed;
+};
+
 class dot11_probed_ssid : public tracker_component {
 public:
     dot11_probed_ssid() :
@@ -459,11 +560,11 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
-    __Proxy(ssid, std::string, std::string, std::string, ssid);
+    __ProxyInternedString(ssid, ssid);
     __Proxy(ssid_len, uint32_t, unsigned int, unsigned int, ssid_len);
     __Proxy(bssid, mac_addr, mac_addr, mac_addr, bssid);
     __Proxy(first_time, uint64_t, time_t, time_t, first_time);
@@ -629,11 +730,11 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
-    __Proxy(ssid, std::string, std::string, std::string, ssid);
+    __ProxyInternedString(ssid, ssid);
     __Proxy(ssid_len, uint32_t, unsigned int, unsigned int, ssid_len);
 
     __Proxy(ssid_hash, uint64_t, uint64_t, uint64_t, ssid_hash);
@@ -645,7 +746,7 @@ public:
     __Proxy(ssid_beacon, uint8_t, bool, bool, ssid_beacon);
     __Proxy(ssid_probe_response, uint8_t, bool, bool, ssid_probe_response);
 
-    __Proxy(channel, std::string, std::string, std::string, channel);
+    __ProxyInternedString(channel, channel);
     __Proxy(ht_mode, std::string, std::string, std::string, ht_mode);
     __Proxy(ht_center_1, uint64_t, uint64_t, uint64_t, ht_center_1);
     __Proxy(ht_center_2, uint64_t, uint64_t, uint64_t, ht_center_2);
@@ -709,7 +810,8 @@ public:
     __ProxyFullyDynamicTrackable(ie_tag_list, tracker_element_vector_double, ie_tag_list_id);
     __ProxyFullyDynamicTrackable(ie_tag_content, tracker_element_int_map, ie_tag_content_id);
 
-    void set_ietag_content_from_packet(std::shared_ptr<dot11_ie> tags);
+    // Tag content is shared with other records advertising identical tags
+    void set_ietag_content_from_packet(std::shared_ptr<dot11_ie> tags, dot11_ietag_store& store);
 
     __ProxyFullyDynamic(meshid, std::string, std::string, std::string, tracker_element_string, meshid_id);
 	__ProxyFullyDynamic(mesh_gateway, uint8_t, bool, bool, tracker_element_uint8, mesh_gateway_id);
@@ -888,7 +990,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -1030,6 +1132,7 @@ public:
         tracker_component() {
 
         last_adv_ie_csum = 0;
+        last_resp_ie_csum = 0;
         last_bss_invalid = 0;
         bss_invalid_count = 0;
         snapshot_next_beacon = false;
@@ -1042,6 +1145,7 @@ public:
         tracker_component(in_id) { 
 
         last_adv_ie_csum = 0;
+        last_resp_ie_csum = 0;
         last_bss_invalid = 0;
         bss_invalid_count = 0;
         snapshot_next_beacon = false;
@@ -1054,6 +1158,7 @@ public:
         tracker_component(in_id) {
 
         last_adv_ie_csum = 0;
+        last_resp_ie_csum = 0;
         last_bss_invalid = 0;
         bss_invalid_count = 0;
         snapshot_next_beacon = false;
@@ -1066,6 +1171,7 @@ public:
         tracker_component{p} {
 
             last_adv_ie_csum = 0;
+            last_resp_ie_csum = 0;
             last_bss_invalid = 0;
             bss_invalid_count = 0;
             snapshot_next_beacon = false;
@@ -1146,7 +1252,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -1252,6 +1358,15 @@ public:
         last_adv_ssid = adv_ssid;
     }
 
+    uint32_t get_last_resp_ie_csum() { return last_resp_ie_csum; }
+    void set_last_resp_ie_csum(uint32_t csum) { last_resp_ie_csum = csum; }
+    std::shared_ptr<dot11_advertised_ssid> get_last_resp_ssid() {
+        return last_resp_ssid;
+    }
+    void set_last_resp_ssid(std::shared_ptr<dot11_advertised_ssid> resp_ssid) {
+        last_resp_ssid = resp_ssid;
+    }
+
     virtual void pre_serialize() override {
         if (client_map != nullptr)
             set_num_client_aps(client_map->size());
@@ -1300,6 +1415,20 @@ public:
     bool get_pmkid_needed() { return pmkid_packet == nullptr; }
     bool get_pmkid_present() { return pmkid_packet != nullptr; }
 
+    // Handshake state for a client, created as needed; not exported, the frames are
+    // mirrored into the wpa_key_map vector for the client
+    dot11_handshake_state& get_handshake_state(const mac_addr& in_client) {
+        return handshake_state_map[in_client];
+    }
+
+    bool has_handshake_state(const mac_addr& in_client) const {
+        return handshake_state_map.find(in_client) != handshake_state_map.end();
+    }
+
+    dot11_pcap_cache& get_pmkid_pcap_cache() {
+        return pmkid_pcap_cache;
+    }
+
     __ProxyDynamicTrackable(last_beaconed_ssid_record, tracker_element_alias, 
             last_beaconed_ssid_record, last_beaconed_ssid_record_id);
 
@@ -1586,9 +1715,15 @@ protected:
     std::shared_ptr<kis_tracked_packet> pmkid_packet;
     int pmkid_packet_id;
 
-    // Un-exposed internal tracking options
+    std::map<mac_addr, dot11_handshake_state> handshake_state_map;
+    dot11_pcap_cache pmkid_pcap_cache;
+
+    // Un-exposed internal tracking options; the last beacon and probe response
+    // fingerprints and the ssid records they resolved to
     uint32_t last_adv_ie_csum;
     std::shared_ptr<dot11_advertised_ssid> last_adv_ssid;
+    uint32_t last_resp_ie_csum;
+    std::shared_ptr<dot11_advertised_ssid> last_resp_ssid;
 
     // Advertised in association requests but device-centric
     std::shared_ptr<tracker_element_uint8> min_tx_power;
@@ -554,8 +554,8 @@ int kis_80211_phy::packet_dot11_dissector(std::shared_ptr<kis_packet> in_pack) {
                 packinfo->bssid_mac = mac_addr(addr2, PHY80211_MAC_LEN);
 
                 packinfo->ietag_csum =
-                    crc32_16bytes_prefetch(chunk->data() + packinfo->header_offset,
-                                           chunk->length() - packinfo->header_offset);
+                    crc32_hw(chunk->data() + packinfo->header_offset,
+                             chunk->length() - packinfo->header_offset);
 
                 break;
 
@@ -576,8 +576,8 @@ int kis_80211_phy::packet_dot11_dissector(std::shared_ptr<kis_packet> in_pack) {
                 packinfo->bssid_mac = mac_addr(addr2, PHY80211_MAC_LEN);
 
                 packinfo->ietag_csum =
-                    crc32_16bytes_prefetch(chunk->data() + packinfo->header_offset,
-                                           chunk->length() - packinfo->header_offset);
+                    crc32_hw(chunk->data() + packinfo->header_offset,
+                             chunk->length() - packinfo->header_offset);
 
                 break;
 
@@ -598,8 +598,8 @@ int kis_80211_phy::packet_dot11_dissector(std::shared_ptr<kis_packet> in_pack) {
                 packinfo->bssid_mac = mac_addr(addr2, PHY80211_MAC_LEN);
 
                 packinfo->ietag_csum =
-                    crc32_16bytes_prefetch(chunk->data() + packinfo->header_offset,
-                                           chunk->length() - packinfo->header_offset);
+                    crc32_hw(chunk->data() + packinfo->header_offset,
+                             chunk->length() - packinfo->header_offset);
 
                 break;
 
@@ -624,8 +624,8 @@ int kis_80211_phy::packet_dot11_dissector(std::shared_ptr<kis_packet> in_pack) {
                 packinfo->bssid_mac = mac_addr(addr2, PHY80211_MAC_LEN);
 
                 packinfo->ietag_csum =
-                    crc32_16bytes_prefetch(chunk->data() + packinfo->header_offset,
-                                           chunk->length() - packinfo->header_offset);
+                    crc32_hw(chunk->data() + packinfo->header_offset,
+                             chunk->length() - packinfo->header_offset);
 
                 break;
 
@@ -646,8 +646,12 @@ int kis_80211_phy::packet_dot11_dissector(std::shared_ptr<kis_packet> in_pack) {
                 packinfo->bssid_mac = mac_addr(addr2, PHY80211_MAC_LEN);
 
                 packinfo->ietag_csum =
-                    crc32_16bytes_prefetch(chunk->data() + packinfo->header_offset,
-                                           chunk->length() - packinfo->header_offset);
+                    crc32_hw(chunk->data() + packinfo->header_offset,
+                             chunk->length() - packinfo->header_offset);
+
+                packinfo->ietag_fingerprint =
+                    ie_fingerprint(reinterpret_cast<const uint8_t *>(chunk->data()), chunk->length(),
+                            packinfo->header_offset);
 
                 break;
 
@@ -691,8 +695,12 @@ int kis_80211_phy::packet_dot11_dissector(std::shared_ptr<kis_packet> in_pack) {
                 packinfo->beacon_interval = kis_letoh16(fixparm->beacon);
 
                 packinfo->ietag_csum =
-                    crc32_16bytes_prefetch(chunk->data() + packinfo->header_offset,
-                                           chunk->length() - packinfo->header_offset);
+                    crc32_hw(chunk->data() + packinfo->header_offset,
+                             chunk->length() - packinfo->header_offset);
+
+                packinfo->ietag_fingerprint =
+                    ie_fingerprint(reinterpret_cast<const uint8_t *>(chunk->data()), chunk->length(),
+                            packinfo->header_offset);
 
                 break;
 
@@ -1182,6 +1190,35 @@ eap_end:
     return 1;
 }
 
+uint32_t kis_80211_phy::ie_fingerprint(const uint8_t *frame, size_t frame_len, size_t header_offset) {
+    // Beacon interval and capabilities follow the 8 byte timestamp
+    if (header_offset < 24 + 12 || frame_len < header_offset)
+        return 0;
+
+    uint32_t csum = crc32_hw(frame + 24 + 8, 4, 0);
+
+    size_t pos = header_offset;
+
+    while (pos + 2 <= frame_len) {
+        size_t tlen = 2 + frame[pos + 1];
+
+        // Checksum any trailing garbage as-is
+        if (pos + tlen > frame_len)
+            tlen = frame_len - pos;
+
+        // Skip the TIM, the DTIM count and traffic map change every beacon
+        if (frame[pos] != 5)
+            csum = crc32_hw(frame + pos, tlen, csum);
+
+        pos += tlen;
+    }
+
+    if (pos < frame_len)
+        csum = crc32_hw(frame + pos, frame_len - pos, csum);
+
+    return csum;
+}
+
 std::shared_ptr<std::vector<kis_80211_phy::ie_tag_tuple>> kis_80211_phy::packet_dot11_ie_list(
         std::shared_ptr<kis_packet> in_pack, 
         std::shared_ptr<dot11_packinfo> packinfo) {
@@ -1213,51 +1250,83 @@ std::shared_ptr<std::vector<kis_80211_phy::ie_tag_tuple>> kis_80211_phy::packet_
         if (chunk->dlt != KDLT_IEEE802_11)
             return packinfo->ie_tags_listed;
 
-        membuf tags_membuf((char *) &(chunk->data()[packinfo->header_offset]), 
-                (char *) &(chunk->data()[chunk->length()]));
-        std::istream istream_ietags(&tags_membuf);
+        if (packinfo->header_offset > chunk->length())
+            return packinfo->ie_tags_listed;
 
 		packinfo->ie_tags = Globalreg::new_from_pool<dot11_ie>();
 
         try {
-            std::shared_ptr<kaitai::kstream> stream_ietags(new kaitai::kstream(&istream_ietags));
-            packinfo->ie_tags->parse(stream_ietags);
+            packinfo->ie_tags->parse((const char *) &(chunk->data()[packinfo->header_offset]), 
+                    chunk->length() - packinfo->header_offset);
         } catch (const std::exception& e) {
             return packinfo->ie_tags_listed;
         }
     }
 
-    for (auto ie_tag : *(packinfo->ie_tags->tags())) {
-        if (ie_tag->tag_num() == 150) {
-            try {
-                ie_tag->tag_data_stream()->seek(0);
+    // Build the list from the tag index; we don't need the tag objects
+    const auto& ie_tags = packinfo->ie_tags;
 
-				auto vendor = Globalreg::new_from_pool<dot11_ie_150_vendor>();
-                vendor->parse(ie_tag->tag_data_stream());
+    for (size_t ie_n = 0; ie_n < ie_tags->n_tags(); ie_n++) {
+        auto tag_num = ie_tags->tag_num(ie_n);
 
-                packinfo->ie_tags_listed->push_back(ie_tag_tuple{150, vendor->vendor_oui_int(), vendor->vendor_oui_type()});
-            } catch (const std::exception &e) {
+        if (tag_num == 150 || tag_num == 221) {
+            if (ie_tags->tag_len(ie_n) < 3)
                 return packinfo->ie_tags_listed;
-            }
-        } else if (ie_tag->tag_num() == 221) {
-            try {
-                ie_tag->tag_data_stream()->seek(0);
 
-				auto vendor = Globalreg::new_from_pool<dot11_ie_221_vendor>();
-                vendor->parse(ie_tag->tag_data_stream());
-
-                packinfo->ie_tags_listed->push_back(ie_tag_tuple{221, vendor->vendor_oui_int(), vendor->vendor_oui_type()});
-            } catch (const std::exception &e) {
-                return packinfo->ie_tags_listed;
-            }
+            packinfo->ie_tags_listed->push_back(ie_tag_tuple{tag_num, ie_tags->tag_vendor_oui(ie_n), 
+                    ie_tags->tag_vendor_type(ie_n)});
         } else {
-            packinfo->ie_tags_listed->push_back(ie_tag_tuple{ie_tag->tag_num(), 0, 0});
+            packinfo->ie_tags_listed->push_back(ie_tag_tuple{tag_num, 0, 0});
         }
     }
 
     return packinfo->ie_tags_listed;
 }
 
+std::vector<uint64_t> kis_80211_phy::probe_group_features(std::shared_ptr<kis_packet> in_pack,
+        std::shared_ptr<dot11_packinfo> packinfo) {
+    std::vector<uint64_t> features;
+
+    // Listing the tags parses them if nothing has yet
+    packet_dot11_ie_list(in_pack, packinfo);
+
+    if (packinfo->ie_tags == nullptr)
+        return features;
+
+    const auto& ie_tags = packinfo->ie_tags;
+    uint64_t order = 0;
+
+    for (size_t ie_n = 0; ie_n < ie_tags->n_tags(); ie_n++) {
+        auto tag_num = ie_tags->tag_num(ie_n);
+        auto tag = ie_tags->tag_view(ie_n);
+
+        // The order of the tags is as much a part of the fingerprint as their contents
+        order = device_group_feature(order, &tag_num, 1);
+
+        switch (tag_num) {
+            case 0:
+            case 3:
+                // The SSID and the channel vary between probes of the same client
+                features.push_back(device_group_feature(tag_num));
+                break;
+            case 150:
+            case 221:
+                // Vendor tags can carry per-device values such as the WPS UUID; only
+                // the vendor, type, and length are kept
+                features.push_back(device_group_feature(tag_num, tag.data(), std::min<size_t>(4, tag.length())));
+                features.push_back(device_group_feature(0x100 + tag_num, &tag_num, 1) ^ tag.length());
+                break;
+            default:
+                features.push_back(device_group_feature(tag_num, tag.data(), tag.length()));
+                break;
+        }
+    }
+
+    features.push_back(device_group_feature(0x200, &order, sizeof(order)));
+
+    return features;
+}
+
 int kis_80211_phy::packet_dot11_ie_dissector(std::shared_ptr<kis_packet> in_pack, 
         std::shared_ptr<dot11_packinfo> packinfo) {
     // If we can't have IE tags at all
@@ -1281,15 +1350,16 @@ int kis_80211_phy::packet_dot11_ie_dissector(std::shared_ptr<kis_packet> in_pack
         return 0;
 
     if (packinfo->ie_tags == nullptr) {
-        membuf tags_membuf((char *) &(chunk->data()[packinfo->header_offset]), 
-                (char *) &(chunk->data()[chunk->length()]));
-        std::istream istream_ietags(&tags_membuf);
+        if (packinfo->header_offset > chunk->length()) {
+            packinfo->corrupt = 1;
+            return -1;
+        }
 
 		packinfo->ie_tags = Globalreg::new_from_pool<dot11_ie>();
 
         try {
-            std::shared_ptr<kaitai::kstream> stream_ietags(new kaitai::kstream(&istream_ietags));
-            packinfo->ie_tags->parse(stream_ietags);
+            packinfo->ie_tags->parse((const char *) &(chunk->data()[packinfo->header_offset]),
+                    chunk->length() - packinfo->header_offset);
         } catch (const std::exception& e) {
             // fmt::print(stderr, "debug - IE tag structure corrupt\n");
             packinfo->corrupt = 1;
@@ -1306,126 +1376,410 @@ int kis_80211_phy::packet_dot11_ie_dissector(std::shared_ptr<kis_packet> in_pack
     // bool seen_mcsrates = false;
     unsigned int wmmtspec_responses = 0;
 
-    for (auto ie_tag : *(packinfo->ie_tags->tags())) {
-        auto hash = std::hash<std::string>{};
+    const auto& ie_tags = packinfo->ie_tags;
+    auto hash = std::hash<std::string_view>{};
 
-        if (ie_tag->tag_num() == 150) {
-            try {
-				auto vendor = Globalreg::new_from_pool<dot11_ie_150_vendor>();
-                vendor->parse(ie_tag->tag_data_stream());
+    for (size_t ie_n = 0; ie_n < ie_tags->n_tags(); ie_n++) {
+        auto tag_num = ie_tags->tag_num(ie_n);
 
-                packinfo->ietag_hash_map.insert(std::make_pair(ie_tag_tuple{150, vendor->vendor_oui_int(), 
-                    vendor->vendor_oui_type()}, hash(ie_tag->tag_data())));
-            } catch (const std::exception& e) {
+        // Hash every tag straight from the tag index
+        if (tag_num == 150 || tag_num == 221) {
+            if (ie_tags->tag_len(ie_n) < 3) {
                 packinfo->corrupt = 1;
                 return -1;
             }
-        } else if (ie_tag->tag_num() == 221) {
-            try {
-				auto vendor = Globalreg::new_from_pool<dot11_ie_221_vendor>();
-                vendor->parse(ie_tag->tag_data_stream());
 
-                packinfo->ietag_hash_map.insert(std::make_pair(ie_tag_tuple{221, vendor->vendor_oui_int(), 
-                    vendor->vendor_oui_type()}, hash(ie_tag->tag_data())));
-            } catch (const std::exception& e) {
-                packinfo->corrupt = 1;
-                return -1;
-            }
+            packinfo->ietag_hash_map.insert(std::make_pair(ie_tag_tuple{tag_num, 
+                        ie_tags->tag_vendor_oui(ie_n), ie_tags->tag_vendor_type(ie_n)}, 
+                        hash(ie_tags->tag_view(ie_n))));
         } else {
-            packinfo->ietag_hash_map.insert(std::make_pair(ie_tag_tuple{ie_tag->tag_num(), 0, 0}, 
-                                                           hash(ie_tag->tag_data())));
+            packinfo->ietag_hash_map.insert(std::make_pair(ie_tag_tuple{tag_num, 0, 0}, 
+                        hash(ie_tags->tag_view(ie_n))));
         }
 
-        // IE 0 SSID
-        if (ie_tag->tag_num() == 0) {
+        // Tags with view parsers are dissected straight from the tag index, without
+        // building a tag object
+        if (tag_num == 45) {
             /*
-            if (seen_ssid) {
-                fprintf(stderr, "debug - multiple SSID ie tags?\n");
-            }
+            if (seen_mcsrates) {
+                fprintf(stderr, "debug - duplicate ie45 mcs rates\n");
+            } 
 
-            seen_ssid = true;
+            seen_mcsrates = true;
             */
 
-            packinfo->ssid_len = ie_tag->tag_data().length();
-            packinfo->ssid_csum = kis_80211_phy::ssid_hash(ie_tag->tag_data().data(), 
-                    ie_tag->tag_data().length());
+            std::vector<std::string> mcsrates;
 
-            if (packinfo->ssid_len == 0) {
-                packinfo->ssid_blank = true;
-                continue;
-            }
+            try {
+				auto ht = Globalreg::new_from_pool<dot11_ie_45_ht_cap>();
+                ht->parse(ie_tags->tag_view(ie_n));
 
-            if (packinfo->ssid_len <= DOT11_PROTO_SSID_LEN) {
-                if (ie_tag->tag_data().find_first_not_of('\0') == std::string::npos) {
-                    packinfo->ssid_blank = true;
-                } else {
-                    packinfo->ssid = munge_to_printable(ie_tag->tag_data().data());
+                std::stringstream mcsstream;
+
+                // See if we support 40mhz channels and aren't 40mhz intolerant
+                bool ch40 = (ht->ht_cap_40mhz_channel() && !ht->ht_cap_40mhz_intolerant());
+
+                bool gi20 = ht->ht_cap_20mhz_shortgi();
+                bool gi40 = ht->ht_cap_40mhz_shortgi();
+
+                uint8_t mcs_byte;
+                uint8_t mcs_offt = 0;
+
+                for (int x = 0; x < 4; x++) {
+                    mcs_byte = ht->mcs().rx_mcs()[x];
+                    for (int i = 0; i < 8; i++) {
+                        if (mcs_byte & (1 << i)) {
+                            int mcsindex = mcs_offt + i;
+                            if (mcsindex < 0 || mcsindex > MCS_MAX) 
+                                continue;
+
+                            if (mcsindex == 32) {
+                                if (ch40) {
+                                    mcsstream.str("");
+                                    mcsstream << "MCS" << mcsindex << "(" <<
+                                        "HTDUP" << ")";
+                                    mcsrates.push_back(mcsstream.str());
+                                }
+
+                                continue;
+                            }
+
+                            double rate;
+
+                            mcsstream.str("");
+                            mcsstream << "MCS" << mcsindex;
+
+                            if (ch40 && gi40) {
+                                rate = mcs_table[mcsindex][CH40GI400];
+                            } else if (ch40) {
+                                rate = mcs_table[mcsindex][CH40GI800];
+                            } else if (gi20) {
+                                rate = mcs_table[mcsindex][CH20GI400];
+                            } else {
+                                rate = mcs_table[mcsindex][CH20GI800];
+                            }
+
+                            if (packinfo->maxrate < rate)
+                                packinfo->maxrate = rate;
+
+                            mcsrates.push_back(mcsstream.str());
+                        }
+                    }
+
+                    mcs_offt += 8;
                 }
-            } else { 
-                _ALERT(alert_longssid_ref, in_pack, packinfo,
-                        "Invalid SSID (ssid advertised as more than 32 bytes) seen, "
-                        "this may indicate an exploit attempt against a Wi-Fi driver which "
-                        "does not properly handle invalid packets.");
-                // Otherwise we're corrupt, set it and stop processing
+
+            } catch (const std::exception& e) {
+                // fprintf(stderr, "debug -corrupt HT\n");
                 packinfo->corrupt = 1;
                 return -1;
             }
 
+            packinfo->mcs_rates = mcsrates;
             continue;
         }
 
-        // IE 1 Basic Rates
-        // IE 50 Extended Rates
-        if (ie_tag->tag_num() == 1 || ie_tag->tag_num() == 50) {
-            if (ie_tag->tag_num() == 1) {
-                /*
-                if (seen_basicrates) {
-                    fprintf(stderr, "debug - seen multiple basicrates?\n");
+        // IE 48, RSN
+        if (tag_num == 48) {
+            bool rsn_invalid = false;
+
+            try {
+				auto rsn = Globalreg::new_from_pool<dot11_ie_48_rsn>();
+                rsn->parse(ie_tags->tag_view(ie_n));
+
+                // TODO - don't aggregate these in the future
+
+                // Merge the group cipher
+                packinfo->cryptset |= 
+                    wpa_cipher_conv(rsn->group_cipher().cipher_type());
+
+                // Merge the unicast ciphers
+                for (const auto& i : rsn->pairwise_ciphers()) {
+                    packinfo->cryptset |= wpa_cipher_conv(i.cipher_type());
                 }
 
-                seen_basicrates = true;
-                */
+                // Merge the authkey types
+                for (const auto& i : rsn->akm_ciphers()) {
+                    packinfo->cryptset |= wpa_key_mgt_conv(i.management_type());
+                }
+
+                // IF we're advertised using IE48 RSN, we're wpa2 or wpa3.  WPA3
+                // sets SAE...
+                if (packinfo->cryptset & crypt_sae) {
+                    packinfo->cryptset |= crypt_version_wpa3;
+                } else {
+                    packinfo->cryptset |= crypt_version_wpa2;
+                }
+
+                common->basic_crypt_set |= KIS_DEVICE_BASICCRYPT_ENCRYPTED;
 
+                packinfo->rsn = rsn;
+            } catch (const std::exception& e) {
+                rsn_invalid = true;
+                packinfo->corrupt = 1;
             }
 
-            if (ie_tag->tag_num() == 50) {
-                /*
-                if (seen_extendedrates) {
-                    fprintf(stderr, "debug - seen multiple extendedrates?\n");
+            // Re-parse using the limited RSN object to see if we're 
+            // getting hit with something that looks like
+            // https://pleasestopnamingvulnerabilities.com/
+            // CVE-2017-9714
+            if (rsn_invalid) {
+                try {
+					auto rsn = Globalreg::new_from_pool<dot11_ie_48_rsn_partial>();
+                    rsn->parse(ie_tags->tag_view(ie_n));
+
+                    if (rsn->pairwise_count() > 1024) {
+                        alertracker->raise_alert(alert_atheros_rsnloop_ref, 
+                                in_pack,
+                                packinfo->bssid_mac, packinfo->source_mac, 
+                                packinfo->dest_mac, packinfo->other_mac,
+                                packinfo->channel,
+                                "Invalid 802.11i RSN IE seen with extremely "
+                                "large number of pairwise ciphers; this may "
+                                "be an attack against Atheros drivers per "
+                                "CVE-2017-9714 and "
+                                "https://pleasestopnamingvulnerabilities.com/");
+                    }
+
+                } catch (const std::exception& e) {
+                    // Do nothing with the secondary error; we already know
+                    // something is wrong we're just trying to extract the
+                    // better errors
                 }
 
-                seen_extendedrates = true;
-                */
+                return -1;
             }
 
-            if (ie_tag->tag_data().find("\x75\xEB\x49") != std::string::npos) {
-                _ALERT(alert_msfdlinkrate_ref, in_pack, packinfo,
-                        "MSF-style poisoned rate field in beacon for network " +
-                        packinfo->bssid_mac.mac_to_string() + ", exploit attempt "
-                        "against D-Link drivers");
+            continue;
+        }
 
-                packinfo->corrupt = 1;
-                return -1;
+        // IE 61 HT
+        if (tag_num == 61) {
+            try {
+				auto ht = Globalreg::new_from_pool<dot11_ie_61_ht_op>();
+                ht->parse(ie_tags->tag_view(ie_n));
+                packinfo->dot11ht = ht;
+            } catch (const std::exception& e) {
+                // fprintf(stderr, "debug - unparsable HT\n");
+                // Don't consider unparsable HT a corrupt packet (for now)
+                continue;
             }
 
-            std::vector<std::string> basicrates;
-            for (uint8_t r : ie_tag->tag_data()) {
-                std::string rate;
+            continue;
+        }
 
-                switch (r) {
-                    case 0x02:
-                        rate = "1";
-                        break;
-                    case 0x03:
-                        rate = "1.5";
-                        break;
-                    case 0x04:
-                        rate = "2";
-                        break;
-                    case 0x05:
-                        rate = "2.5";
-                        break;
-                    case 0x06:
+        // IE 191 VHT Capabilities TODO compbine with VHT OP to derive actual usable
+        // rate
+        if (tag_num == 191) {
+            try {
+				auto vht = Globalreg::new_from_pool<dot11_ie_191_vht_cap>();
+                vht->parse(ie_tags->tag_view(ie_n));
+
+                bool gi80 = vht->vht_cap_80mhz_shortgi();
+                bool gi160 = vht->vht_cap_160mhz_shortgi();
+                bool supp160 = vht->vht_cap_160mhz();
+
+                int stream = -1;
+                unsigned int mcs = 0;
+                unsigned int gi = 0;
+
+                if (supp160) {
+                    if (gi160) {
+                        gi = CH160GI400;
+                    } else {
+                        gi = CH160GI800;
+                    }
+                } else {
+                    if (gi80) {
+                        gi = CH80GI400;
+                    } else {
+                        gi = CH80GI800;
+                    }
+                }
+
+                // Count back from stream 4 looking for the highest MCS setting
+                if (vht->rx_mcs_s4() == 2) {
+                    stream = 3;
+                    mcs = 9;
+                } else if (vht->rx_mcs_s4() == 1) {
+                    stream = 3;
+                    mcs = 7;
+                } else if (vht->rx_mcs_s3() == 2) {
+                    stream = 2;
+                    mcs = 9;
+                } else if (vht->rx_mcs_s3() == 1) {
+                    stream = 2;
+                    mcs = 7;
+                } else if (vht->rx_mcs_s2() == 2) {
+                    stream = 1;
+                    mcs = 9;
+                } else if (vht->rx_mcs_s2() == 1) {
+                    stream = 1;
+                    mcs = 7;
+                } else if (vht->rx_mcs_s1() == 2) {
+                    stream = 0;
+                    mcs = 9;
+                } else if (vht->rx_mcs_s1() == 1) {
+                    stream = 0;
+                    mcs = 7;
+                }
+
+                // What?  Invalid steam index
+                if (stream < 0 || stream > 3) {
+                    continue;
+                }
+
+                // Get the index
+                int mcsofft = (stream * 10) + mcs;
+                if (mcsofft < 0 || mcsofft > VHT_MCS_MAX)
+                    continue;
+
+                double speed = vht_mcs_table[mcsofft][gi];
+
+                if (packinfo->maxrate < speed)
+                    packinfo->maxrate = speed;
+
+
+            } catch (const std::exception& e) {
+                fprintf(stderr, "debug - vht 191 error %s\n", e.what());
+                // Don't consider this a corrupt packet just because we didn't parse it
+            }
+
+            continue;
+        }
+
+        // IE 192 VHT Operation
+        if (tag_num == 192) {
+            try {
+				auto vht = Globalreg::new_from_pool<dot11_ie_192_vht_op>();
+                vht->parse(ie_tags->tag_view(ie_n));
+                packinfo->dot11vht = vht;
+
+            } catch (const std::exception& e) {
+                // fprintf(stderr, "debug - vht 192 error %s\n", e.what());
+                // Don't consider this a corrupt packet just because we didn't parse it
+            }
+
+            continue;
+        }
+
+        // Only build tag objects for the tags we dissect
+        switch (tag_num) {
+            case 0:
+            case 1:
+            case 3:
+            case 7:
+            case 11:
+            case 36:
+            case 50:
+            case 221:
+                break;
+            case 33:
+            case 54:
+            case 113:
+            case 127:
+            case 133:
+            case 150:
+                // Capabilities only shown in the UI, or only checked for exploits
+                if (!dissect_ie_detail)
+                    continue;
+                break;
+            default:
+                continue;
+        }
+
+        auto ie_tag = ie_tags->tag(ie_n);
+
+        // IE 0 SSID
+        if (ie_tag->tag_num() == 0) {
+            /*
+            if (seen_ssid) {
+                fprintf(stderr, "debug - multiple SSID ie tags?\n");
+            }
+
+            seen_ssid = true;
+            */
+
+            packinfo->ssid_len = ie_tag->tag_data().length();
+            packinfo->ssid_csum = kis_80211_phy::ssid_hash(ie_tag->tag_data().data(), 
+                    ie_tag->tag_data().length());
+
+            if (packinfo->ssid_len == 0) {
+                packinfo->ssid_blank = true;
+                continue;
+            }
+
+            if (packinfo->ssid_len <= DOT11_PROTO_SSID_LEN) {
+                if (ie_tag->tag_data().find_first_not_of('\0') == std::string::npos) {
+                    packinfo->ssid_blank = true;
+                } else {
+                    packinfo->ssid = munge_to_printable(ie_tag->tag_data().data());
+                }
+            } else { 
+                _ALERT(alert_longssid_ref, in_pack, packinfo,
+                        "Invalid SSID (ssid advertised as more than 32 bytes) seen, "
+                        "this may indicate an exploit attempt against a Wi-Fi driver which "
+                        "does not properly handle invalid packets.");
+                // Otherwise we're corrupt, set it and stop processing
+                packinfo->corrupt = 1;
+                return -1;
+            }
+
+            continue;
+        }
+
+        // IE 1 Basic Rates
+        // IE 50 Extended Rates
+        if (ie_tag->tag_num() == 1 || ie_tag->tag_num() == 50) {
+            if (ie_tag->tag_num() == 1) {
+                /*
+                if (seen_basicrates) {
+                    fprintf(stderr, "debug - seen multiple basicrates?\n");
+                }
+
+                seen_basicrates = true;
+                */
+
+            }
+
+            if (ie_tag->tag_num() == 50) {
+                /*
+                if (seen_extendedrates) {
+                    fprintf(stderr, "debug - seen multiple extendedrates?\n");
+                }
+
+                seen_extendedrates = true;
+                */
+            }
+
+            if (ie_tag->tag_data().find("\x75\xEB\x49") != std::string::npos) {
+                _ALERT(alert_msfdlinkrate_ref, in_pack, packinfo,
+                        "MSF-style poisoned rate field in beacon for network " +
+                        packinfo->bssid_mac.mac_to_string() + ", exploit attempt "
+                        "against D-Link drivers");
+
+                packinfo->corrupt = 1;
+                return -1;
+            }
+
+            std::vector<std::string> basicrates;
+            for (uint8_t r : ie_tag->tag_data()) {
+                std::string rate;
+
+                switch (r) {
+                    case 0x02:
+                        rate = "1";
+                        break;
+                    case 0x03:
+                        rate = "1.5";
+                        break;
+                    case 0x04:
+                        rate = "2";
+                        break;
+                    case 0x05:
+                        rate = "2.5";
+                        break;
+                    case 0x06:
                         rate = "3";
                         break;
                     case 0x09:
@@ -1647,161 +2001,6 @@ int kis_80211_phy::packet_dot11_ie_dissector(std::shared_ptr<kis_packet> in_pack
         }
 #endif
 
-        if (ie_tag->tag_num() == 45) {
-            /*
-            if (seen_mcsrates) {
-                fprintf(stderr, "debug - duplicate ie45 mcs rates\n");
-            } 
-
-            seen_mcsrates = true;
-            */
-
-            std::vector<std::string> mcsrates;
-
-            try {
-				auto ht = Globalreg::new_from_pool<dot11_ie_45_ht_cap>();
-                ht->parse(ie_tag->tag_data_stream());
-
-                std::stringstream mcsstream;
-
-                // See if we support 40mhz channels and aren't 40mhz intolerant
-                bool ch40 = (ht->ht_cap_40mhz_channel() && !ht->ht_cap_40mhz_intolerant());
-
-                bool gi20 = ht->ht_cap_20mhz_shortgi();
-                bool gi40 = ht->ht_cap_40mhz_shortgi();
-
-                uint8_t mcs_byte;
-                uint8_t mcs_offt = 0;
-
-                for (int x = 0; x < 4; x++) {
-                    mcs_byte = ht->mcs()->rx_mcs()[x];
-                    for (int i = 0; i < 8; i++) {
-                        if (mcs_byte & (1 << i)) {
-                            int mcsindex = mcs_offt + i;
-                            if (mcsindex < 0 || mcsindex > MCS_MAX) 
-                                continue;
-
-                            if (mcsindex == 32) {
-                                if (ch40) {
-                                    mcsstream.str("");
-                                    mcsstream << "MCS" << mcsindex << "(" <<
-                                        "HTDUP" << ")";
-                                    mcsrates.push_back(mcsstream.str());
-                                }
-
-                                continue;
-                            }
-
-                            double rate;
-
-                            mcsstream.str("");
-                            mcsstream << "MCS" << mcsindex;
-
-                            if (ch40 && gi40) {
-                                rate = mcs_table[mcsindex][CH40GI400];
-                            } else if (ch40) {
-                                rate = mcs_table[mcsindex][CH40GI800];
-                            } else if (gi20) {
-                                rate = mcs_table[mcsindex][CH20GI400];
-                            } else {
-                                rate = mcs_table[mcsindex][CH20GI800];
-                            }
-
-                            if (packinfo->maxrate < rate)
-                                packinfo->maxrate = rate;
-
-                            mcsrates.push_back(mcsstream.str());
-                        }
-                    }
-
-                    mcs_offt += 8;
-                }
-
-            } catch (const std::exception& e) {
-                // fprintf(stderr, "debug -corrupt HT\n");
-                packinfo->corrupt = 1;
-                return -1;
-            }
-
-            packinfo->mcs_rates = mcsrates;
-            continue;
-        }
-
-        // IE 48, RSN
-        if (ie_tag->tag_num() == 48) {
-            bool rsn_invalid = false;
-
-            try {
-				auto rsn = Globalreg::new_from_pool<dot11_ie_48_rsn>();
-                rsn->parse(ie_tag->tag_data_stream());
-
-                // TODO - don't aggregate these in the future
-
-                // Merge the group cipher
-                packinfo->cryptset |= 
-                    wpa_cipher_conv(rsn->group_cipher()->cipher_type());
-
-                // Merge the unicast ciphers
-                for (auto i : *(rsn->pairwise_ciphers())) {
-                    packinfo->cryptset |= wpa_cipher_conv(i->cipher_type());
-                }
-
-                // Merge the authkey types
-                for (auto i : *(rsn->akm_ciphers())) {
-                    packinfo->cryptset |= wpa_key_mgt_conv(i->management_type());
-                }
-
-                // IF we're advertised using IE48 RSN, we're wpa2 or wpa3.  WPA3
-                // sets SAE...
-                if (packinfo->cryptset & crypt_sae) {
-                    packinfo->cryptset |= crypt_version_wpa3;
-                } else {
-                    packinfo->cryptset |= crypt_version_wpa2;
-                }
-
-                common->basic_crypt_set |= KIS_DEVICE_BASICCRYPT_ENCRYPTED;
-
-                packinfo->rsn = rsn;
-            } catch (const std::exception& e) {
-                rsn_invalid = true;
-                packinfo->corrupt = 1;
-            }
-
-            // Re-parse using the limited RSN object to see if we're 
-            // getting hit with something that looks like
-            // https://pleasestopnamingvulnerabilities.com/
-            // CVE-2017-9714
-            if (rsn_invalid) {
-                try {
-					auto rsn = Globalreg::new_from_pool<dot11_ie_48_rsn_partial>();
-                    ie_tag->tag_data_stream()->seek(0);
-                    rsn->parse(ie_tag->tag_data_stream());
-
-                    if (rsn->pairwise_count() > 1024) {
-                        alertracker->raise_alert(alert_atheros_rsnloop_ref, 
-                                in_pack,
-                                packinfo->bssid_mac, packinfo->source_mac, 
-                                packinfo->dest_mac, packinfo->other_mac,
-                                packinfo->channel,
-                                "Invalid 802.11i RSN IE seen with extremely "
-                                "large number of pairwise ciphers; this may "
-                                "be an attack against Atheros drivers per "
-                                "CVE-2017-9714 and "
-                                "https://pleasestopnamingvulnerabilities.com/");
-                    }
-
-                } catch (const std::exception& e) {
-                    // Do nothing with the secondary error; we already know
-                    // something is wrong we're just trying to extract the
-                    // better errors
-                }
-
-                return -1;
-            }
-
-            continue;
-        }
-
         // IE 54 Mobility
         if (ie_tag->tag_num() == 54) {
             try {
@@ -1815,21 +2014,6 @@ int kis_80211_phy::packet_dot11_ie_dissector(std::shared_ptr<kis_packet> in_pack
             continue;
         }
 
-        // IE 61 HT
-        if (ie_tag->tag_num() == 61) {
-            try {
-				auto ht = Globalreg::new_from_pool<dot11_ie_61_ht_op>();
-                ht->parse(ie_tag->tag_data_stream());
-                packinfo->dot11ht = ht;
-            } catch (const std::exception& e) {
-                // fprintf(stderr, "debug - unparsable HT\n");
-                // Don't consider unparsable HT a corrupt packet (for now)
-                continue;
-            }
-
-            continue;
-        }
-
         // IE 133 CISCO CCX
         if (ie_tag->tag_num() == 133) {
             try {
@@ -1874,87 +2058,6 @@ int kis_80211_phy::packet_dot11_ie_dissector(std::shared_ptr<kis_packet> in_pack
             continue;
 		}
 
-        // IE 191 VHT Capabilities TODO compbine with VHT OP to derive actual usable
-        // rate
-        if (ie_tag->tag_num() == 191) {
-            try {
-				auto vht = Globalreg::new_from_pool<dot11_ie_191_vht_cap>();
-                vht->parse(ie_tag->tag_data_stream());
-
-                bool gi80 = vht->vht_cap_80mhz_shortgi();
-                bool gi160 = vht->vht_cap_160mhz_shortgi();
-                bool supp160 = vht->vht_cap_160mhz();
-
-                int stream = -1;
-                unsigned int mcs = 0;
-                unsigned int gi = 0;
-
-                if (supp160) {
-                    if (gi160) {
-                        gi = CH160GI400;
-                    } else {
-                        gi = CH160GI800;
-                    }
-                } else {
-                    if (gi80) {
-                        gi = CH80GI400;
-                    } else {
-                        gi = CH80GI800;
-                    }
-                }
-
-                // Count back from stream 4 looking for the highest MCS setting
-                if (vht->rx_mcs_s4() == 2) {
-                    stream = 3;
-                    mcs = 9;
-                } else if (vht->rx_mcs_s4() == 1) {
-                    stream = 3;
-                    mcs = 7;
-                } else if (vht->rx_mcs_s3() == 2) {
-                    stream = 2;
-                    mcs = 9;
-                } else if (vht->rx_mcs_s3() == 1) {
-                    stream = 2;
-                    mcs = 7;
-                } else if (vht->rx_mcs_s2() == 2) {
-                    stream = 1;
-                    mcs = 9;
-                } else if (vht->rx_mcs_s2() == 1) {
-                    stream = 1;
-                    mcs = 7;
-                } else if (vht->rx_mcs_s1() == 2) {
-                    stream = 0;
-                    mcs = 9;
-                } else if (vht->rx_mcs_s1() == 1) {
-                    stream = 0;
-                    mcs = 7;
-                }
-
-                // What?  Invalid steam index
-                if (stream < 0 || stream > 3) {
-                    continue;
-                }
-
-                // Get the index
-                int mcsofft = (stream * 10) + mcs;
-                if (mcsofft < 0 || mcsofft > VHT_MCS_MAX)
-                    continue;
-
-                double speed = vht_mcs_table[mcsofft][gi];
-
-                if (packinfo->maxrate < speed)
-                    packinfo->maxrate = speed;
-
-
-            } catch (const std::exception& e) {
-                fprintf(stderr, "debug - vht 191 error %s\n", e.what());
-                // Don't consider this a corrupt packet just because we didn't parse it
-            }
-
-            continue;
-        }
-
-
         // Vendor 150 collection
         if (ie_tag->tag_num() == 150) {
             try {
@@ -1976,21 +2079,6 @@ int kis_80211_phy::packet_dot11_ie_dissector(std::shared_ptr<kis_packet> in_pack
             continue;
         }
 
-        // IE 192 VHT Operation
-        if (ie_tag->tag_num() == 192) {
-            try {
-				auto vht = Globalreg::new_from_pool<dot11_ie_192_vht_op>();
-                vht->parse(ie_tag->tag_data_stream());
-                packinfo->dot11vht = vht;
-
-            } catch (const std::exception& e) {
-                // fprintf(stderr, "debug - vht 192 error %s\n", e.what());
-                // Don't consider this a corrupt packet just because we didn't parse it
-            }
-
-            continue;
-        }
-
         if (ie_tag->tag_num() == 221) {
             try {
 				auto vendor = Globalreg::new_from_pool<dot11_ie_221_vendor>();
@@ -1998,7 +2086,8 @@ int kis_80211_phy::packet_dot11_ie_dissector(std::shared_ptr<kis_packet> in_pack
                 vendor->parse(ie_tag->tag_data_stream());
 
                 // Match mis-sized WMM
-                if (packinfo->subtype == packet_sub_beacon &&
+                if (dissect_ie_detail &&
+                        packinfo->subtype == packet_sub_beacon &&
                         vendor->vendor_oui_int() == 0x0050f2 &&
                         vendor->vendor_oui_type() == 2 &&
                         ie_tag->tag_data().length() > 24) {
@@ -2018,7 +2107,8 @@ int kis_80211_phy::packet_dot11_ie_dissector(std::shared_ptr<kis_packet> in_pack
                 // Count wmmtspec frames; per
                 // CVE-2017-11013 
                 // https://pleasestopnamingvulnerabilities.com/
-                if (packinfo->subtype == packet_sub_association_resp &&
+                if (dissect_ie_detail &&
+                        packinfo->subtype == packet_sub_association_resp &&
                         vendor->vendor_oui_int() == 0x0050f2 &&
                         vendor->vendor_oui_type() == 2) {
                     dot11_ie_221_ms_wmm wmm;
@@ -2107,7 +2197,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(std::shared_ptr<kis_packet> in_pack
                 }
 
                 // Look for WFA p2p to check the rtlwifi exploit
-                if (vendor->vendor_oui_int() == dot11_ie_221_wfa::wfa_oui()) {
+                if (dissect_ie_detail && vendor->vendor_oui_int() == dot11_ie_221_wfa::wfa_oui()) {
 					auto wfa = Globalreg::new_from_pool<dot11_ie_221_wfa>();
                     vendor->vendor_tag_stream()->seek(0);
                     wfa->parse(vendor->vendor_tag_stream());
@@ -2137,11 +2227,11 @@ int kis_80211_phy::packet_dot11_ie_dissector(std::shared_ptr<kis_packet> in_pack
                 }
 
                 // Look for WPS MS
-                if (vendor->vendor_oui_int() == dot11_ie_221_ms_wps::ms_wps_oui() && 
+                if (dissect_ie_detail &&
+                        vendor->vendor_oui_int() == dot11_ie_221_ms_wps::ms_wps_oui() && 
                         vendor->vendor_oui_type() == dot11_ie_221_ms_wps::ms_wps_subtype()) {
 					auto wps = Globalreg::new_from_pool<dot11_ie_221_ms_wps>();
-                    vendor->vendor_tag_stream()->seek(0);
-                    wps->parse(vendor->vendor_tag_stream());
+                    wps->parse(ie_tags->tag_view(ie_n).substr(3));
 
                     for (auto wpselem : *(wps->wps_elements())) {
                         auto version = wpselem->sub_element_version();
@@ -2176,6 +2266,10 @@ int kis_80211_phy::packet_dot11_ie_dissector(std::shared_ptr<kis_packet> in_pack
                             continue;
                         }
 
+                        // Everything else identifies the device
+                        if (!dissect_wps_identity)
+                            continue;
+
                         auto device_name = wpselem->sub_element_name();
                         if (device_name != NULL) {
                             packinfo->wps_device_name = munge_to_printable(device_name->str());
@@ -2413,6 +2507,84 @@ int kis_80211_phy::packet_wep_decryptor(std::shared_ptr<kis_packet> in_pack) {
     return 1;
 }
 
+int kis_80211_phy::packet_ccmp_decryptor(std::shared_ptr<kis_packet> in_pack) {
+    if (in_pack->error)
+        return 0;
+
+    auto packinfo = in_pack->fetch<dot11_packinfo>(pack_comp_80211);
+
+    if (packinfo == nullptr)
+        return 0;
+
+    if (packinfo->corrupt || packinfo->decrypted)
+        return 0;
+
+    if (packinfo->type != packet_data || 
+        (packinfo->subtype != packet_sub_data &&
+         packinfo->subtype != packet_sub_data_qos_data))
+        return 0;
+
+    // Only traffic between an AP and its clients
+    mac_addr client;
+    bool from_ap;
+
+    if (packinfo->distrib == distrib_from) {
+        client = packinfo->dest_mac;
+        from_ap = true;
+    } else if (packinfo->distrib == distrib_to) {
+        client = packinfo->source_mac;
+        from_ap = false;
+    } else {
+        return 0;
+    }
+
+    auto chunk = in_pack->fetch<kis_datachunk>(pack_comp_decap, pack_comp_linkframe);
+
+    if (chunk == nullptr || chunk->dlt != KDLT_IEEE802_11)
+        return 0;
+
+    if (chunk->length() < 24 || packinfo->header_offset >= chunk->length())
+        return 0;
+
+    auto frame = reinterpret_cast<const uint8_t *>(chunk->data());
+
+    // Unprotected frames may be part of a handshake
+    if (!(frame[1] & 0x40)) {
+        uint8_t eapol_llc[] = { 0xaa, 0xaa, 0x03, 0x00, 0x00, 0x00, 0x88, 0x8e };
+        auto pos = packinfo->header_offset;
+
+        if (pos + sizeof(eapol_llc) < chunk->length() &&
+                memcmp(frame + pos, eapol_llc, sizeof(eapol_llc)) == 0)
+            ccmp_decryptor->handle_eapol(packinfo->bssid_mac, client, from_ap,
+                    frame + pos + sizeof(eapol_llc), chunk->length() - pos - sizeof(eapol_llc));
+
+        return 0;
+    }
+
+    auto manglechunk =
+        ccmp_decryptor->decrypt(packinfo->bssid_mac, client, frame, chunk->length());
+
+    if (manglechunk == nullptr)
+        return 0;
+
+    packinfo->decrypted = 1;
+
+    in_pack->insert(pack_comp_mangleframe, manglechunk);
+
+    in_pack->erase(pack_comp_datapayload);
+
+    if (manglechunk->length() > packinfo->header_offset) {
+        auto datachunk = packetchain->new_packet_component<kis_datachunk>();
+
+        datachunk->set_data(manglechunk->substr(packinfo->header_offset, manglechunk->length() - 
+                                                packinfo->header_offset));
+
+        in_pack->insert(pack_comp_datapayload, datachunk);
+    }
+
+    return 1;
+}
+
 int kis_80211_phy::packet_dot11_wps_m3(std::shared_ptr<kis_packet> in_pack) {
     if (in_pack->error) {
         return 0;
@@ -0,0 +1,111 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include "phy_80211_relations.h"
+
+void dot11_relation_index::associate(const device_key& ap, const device_key& client) {
+    if (ap == client)
+        return;
+
+    kis_lock_guard<kis_fast_mutex> lk(mutex, "dot11_relation_index associate");
+
+    if (ap_clients[ap].insert(client).second) {
+        client_aps[client].insert(ap);
+        n_relations++;
+    }
+}
+
+void dot11_relation_index::unlink(adjacency_map& adj, const device_key& from, const device_key& to) {
+    auto ai = adj.find(from);
+
+    if (ai == adj.end())
+        return;
+
+    ai->second.erase(to);
+
+    if (ai->second.empty())
+        adj.erase(ai);
+}
+
+void dot11_relation_index::forget(const device_key& dev) {
+    kis_lock_guard<kis_fast_mutex> lk(mutex, "dot11_relation_index forget");
+
+    auto ci = ap_clients.find(dev);
+    if (ci != ap_clients.end()) {
+        for (const auto& c : ci->second)
+            unlink(client_aps, c, dev);
+        n_relations -= ci->second.size();
+        ap_clients.erase(ci);
+    }
+
+    auto ai = client_aps.find(dev);
+    if (ai != client_aps.end()) {
+        for (const auto& a : ai->second)
+            unlink(ap_clients, a, dev);
+        n_relations -= ai->second.size();
+        client_aps.erase(ai);
+    }
+}
+
+std::vector<device_key> dot11_relation_index::neighbors(const adjacency_map& adj,
+        const std::vector<device_key>& keys) {
+    std::vector<device_key> ret;
+    key_set seen;
+
+    kis_lock_guard<kis_fast_mutex> lk(mutex, "dot11_relation_index neighbors");
+
+    for (const auto& k : keys) {
+        auto ai = adj.find(k);
+
+        if (ai == adj.end())
+            continue;
+
+        for (const auto& n : ai->second) {
+            if (seen.insert(n).second)
+                ret.push_back(n);
+        }
+    }
+
+    return ret;
+}
+
+std::vector<device_key> dot11_relation_index::clients_of(const std::vector<device_key>& aps) {
+    return neighbors(ap_clients, aps);
+}
+
+std::vector<device_key> dot11_relation_index::aps_of(const std::vector<device_key>& clients) {
+    return neighbors(client_aps, clients);
+}
+
+std::shared_ptr<tracker_element> dot11_relation_index::get_stats() {
+    auto ret = std::make_shared<tracker_element_string_map>();
+
+    kis_lock_guard<kis_fast_mutex> lk(mutex, "dot11_relation_index get_stats");
+
+    ret->insert(std::make_pair("kismet.dot11.relations.aps",
+                std::make_shared<tracker_element_uint64>(0, ap_clients.size())));
+    ret->insert(std::make_pair("kismet.dot11.relations.clients",
+                std::make_shared<tracker_element_uint64>(0, client_aps.size())));
+    ret->insert(std::make_pair("kismet.dot11.relations.relations",
+                std::make_shared<tracker_element_uint64>(0, n_relations)));
+
+    return ret;
+}
+
@@ -0,0 +1,79 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __PHY_80211_RELATIONS_H__
+#define __PHY_80211_RELATIONS_H__
+
+#include "config.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "devicetracker_component.h"
+#include "kis_mutex.h"
+#include "trackedelement.h"
+
+// AP and client relationships between dot11 devices
+//
+// The client and associated client maps of each dot11 device record the same
+// relationships, but answering 'every client of these APs' from them means walking the
+// map of every AP and fetching each client by key.  The relation index keeps both
+// directions as adjacency sets keyed by device key; it is updated by process_client
+// whenever a new AP (BSSID or WDS transmitter) and client pairing is recorded.
+//
+// Devices are not removed from the index when they are removed from tracking; the
+// relationships of devices which no longer exist are dropped when a query runs into them.
+class dot11_relation_index {
+public:
+    dot11_relation_index() :
+        n_relations{0} {
+        mutex.set_name("dot11_relation_index");
+    }
+
+    // Record a client of an AP
+    void associate(const device_key& ap, const device_key& client);
+
+    // Drop every relationship of a device which is no longer tracked
+    void forget(const device_key& dev);
+
+    // Clients of any of the APs, or APs of any of the clients; each device is listed
+    // once, in the order first found
+    std::vector<device_key> clients_of(const std::vector<device_key>& aps);
+    std::vector<device_key> aps_of(const std::vector<device_key>& clients);
+
+    std::shared_ptr<tracker_element> get_stats();
+
+protected:
+    using key_set = std::unordered_set<device_key>;
+    using adjacency_map = std::unordered_map<device_key, key_set>;
+
+    std::vector<device_key> neighbors(const adjacency_map& adj, const std::vector<device_key>& keys);
+
+    static void unlink(adjacency_map& adj, const device_key& from, const device_key& to);
+
+    kis_fast_mutex mutex;
+
+    adjacency_map ap_clients;
+    adjacency_map client_aps;
+
+    size_t n_relations;
+};
+
+#endif
+
@@ -85,10 +85,7 @@ void dot11_tracked_ssid_group::reserve_fields(std::shared_ptr<tracker_element_ma
 
 }
 
-void dot11_tracked_ssid_group::add_advertising_device(std::shared_ptr<kis_tracked_device_base> device) {
-    kis_lock_guard<kis_mutex> lk(mutex);
-    advertising_device_map->insert(device->get_key(), nullptr);
-
+void dot11_tracked_ssid_group::update_times(const std::shared_ptr<kis_tracked_device_base>& device) {
     if (device->get_first_time() < get_first_time() || get_first_time() == 0)
         set_first_time(device->get_first_time());
 
@@ -96,26 +93,40 @@ void dot11_tracked_ssid_group::add_advertising_device(std::shared_ptr<kis_tracke
         set_last_time(device->get_last_time());
 }
 
-void dot11_tracked_ssid_group::add_probing_device(std::shared_ptr<kis_tracked_device_base> device) {
+bool dot11_tracked_ssid_group::add_advertising_device(std::shared_ptr<kis_tracked_device_base> device) {
+    kis_lock_guard<kis_mutex> lk(mutex);
+    advertising_device_map->insert(device->get_key(), nullptr);
+
+    auto first = get_advertising_device_len() == 0;
+    set_advertising_device_len(advertising_device_map->size());
+
+    update_times(device);
+
+    return first;
+}
+
+bool dot11_tracked_ssid_group::add_probing_device(std::shared_ptr<kis_tracked_device_base> device) {
     kis_lock_guard<kis_mutex> lk(mutex);
     probing_device_map->insert(device->get_key(), nullptr);
 
-    if (device->get_first_time() < get_first_time() || get_first_time() == 0)
-        set_first_time(device->get_first_time());
+    auto first = get_probing_device_len() == 0;
+    set_probing_device_len(probing_device_map->size());
 
-    if (device->get_last_time() > get_last_time())
-        set_last_time(device->get_last_time());
+    update_times(device);
+
+    return first;
 }
 
-void dot11_tracked_ssid_group::add_responding_device(std::shared_ptr<kis_tracked_device_base> device) {
+bool dot11_tracked_ssid_group::add_responding_device(std::shared_ptr<kis_tracked_device_base> device) {
     kis_lock_guard<kis_mutex> lk(mutex);
     responding_device_map->insert(device->get_key(), nullptr);
 
-    if (device->get_first_time() < get_first_time() || get_first_time() == 0)
-        set_first_time(device->get_first_time());
+    auto first = get_responding_device_len() == 0;
+    set_responding_device_len(responding_device_map->size());
 
-    if (device->get_last_time() > get_last_time())
-        set_last_time(device->get_last_time());
+    update_times(device);
+
+    return first;
 }
 
 phy_80211_ssid_tracker::phy_80211_ssid_tracker() {
@@ -131,8 +142,14 @@ phy_80211_ssid_tracker::phy_80211_ssid_tracker() {
                 "Tracked SSID grouping");
     group_builder = std::make_shared<dot11_tracked_ssid_group>(tracked_ssid_id);
 
+    ssid_field_path = tracker_element_summary("dot11.ssidgroup.ssid").resolved_path;
+
     ssid_vector = std::make_shared<tracker_element_vector>();
 
+    num_advertised = 0;
+    num_responded = 0;
+    num_probed = 0;
+
     ssid_tracking_enabled = true;
 
     if (!Globalreg::globalreg->kismet_config->fetch_opt_bool("dot11_view_ssids", true)) {
@@ -151,6 +168,12 @@ phy_80211_ssid_tracker::phy_80211_ssid_tracker() {
                     return ssid_endpoint_handler(con);
                 }));
 
+    httpd->register_route("/phy/phy80211/ssids/summary", {"GET", "POST"}, httpd->RO_ROLE, {},
+            std::make_shared<kis_net_web_tracked_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    return summary_endpoint_handler(con);
+                }));
+
     httpd->register_route("/phy/phy80211/ssids/by-hash/:hash/ssid", {"GET", "POST"}, httpd->RO_ROLE, {},
             std::make_shared<kis_net_web_tracked_endpoint>(
                 [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
@@ -169,7 +192,7 @@ phy_80211_ssid_tracker::~phy_80211_ssid_tracker() {
 void phy_80211_ssid_tracker::ssid_endpoint_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
     std::ostream stream(&con->response_stream());
 
-    auto summary_vec = std::vector<SharedElementSummary>{};
+    auto summary_plan = tracker_element_summary_plan::from_json(Json::Value(Json::arrayValue));
     auto rename_map = Globalreg::new_from_pool<tracker_element_serializer::rename_map>();
 
     time_t timestamp_min = 0;
@@ -182,6 +205,8 @@ void phy_80211_ssid_tracker::ssid_endpoint_handler(std::shared_ptr<kis_net_beast
 
     auto regex = con->json()["regex"];
 
+    auto ssid_prefix = con->json().get("ssid_prefix", "").asString();
+
     std::shared_ptr<tracker_element_string_map> wrapper_elem;
 
     std::shared_ptr<tracker_element> transmit;
@@ -201,18 +226,7 @@ void phy_80211_ssid_tracker::ssid_endpoint_handler(std::shared_ptr<kis_net_beast
         // compute the search path so we have to implement our own copy of the code
         auto fields = con->json().get("fields", Json::Value(Json::arrayValue));
 
-        for (const auto& i : fields) {
-            if (i.isString()) {
-                summary_vec.push_back(std::make_shared<tracker_element_summary>(i.asString()));
-            } else if (i.isArray()) {
-                if (i.size() != 2) 
-                    throw std::runtime_error("Invalid field map, expected [field, rename]");
-
-                summary_vec.push_back(std::make_shared<tracker_element_summary>(i[0].asString(), i[1].asString()));
-            } else {
-                throw std::runtime_error("Invalid field map, exected field or [field, rename]");
-            }
-        }
+        summary_plan = tracker_element_summary_plan::from_json(fields);
 
         // Capture timestamp and negative-offset timestamp
         auto raw_ts = con->json().get("last_time", 0).asInt64();
@@ -252,7 +266,7 @@ void phy_80211_ssid_tracker::ssid_endpoint_handler(std::shared_ptr<kis_net_beast
 
         // Search every field we return
         if (search_term.length() != 0) 
-            for (const auto& svi : summary_vec)
+            for (const auto& svi : summary_plan->summaries)
                 search_paths.push_back(svi->resolved_path);
 
         // We only allow ordering by a single column, we don't do sub-ordering;
@@ -310,14 +324,75 @@ void phy_80211_ssid_tracker::ssid_endpoint_handler(std::shared_ptr<kis_net_beast
     // Next vector we do work on
     auto next_work_vec = std::make_shared<tracker_element_vector>();
 
-    // Copy the entire vector list, under lock, to the next work vector; this makes it an independent copy
-    // which is protected from the main vector being grown/shrank.  While we're in there, log the total
+    bool order_by_ssid = in_order_column_num.length() && order_field == ssid_field_path;
+    bool unfiltered = timestamp_min == 0 && search_term.length() == 0 && regex.isNull();
+
+    // Unfiltered queries in the order SSIDs were seen, or sorted by SSID, only need the 
+    // requested window; take it straight from the vector or the SSID index
+    if (unfiltered && ssid_prefix.length() == 0 && (order_field.size() == 0 || order_by_ssid)) {
+        {
+            kis_lock_guard<kis_mutex> lk(mutex);
+
+            total_sz_elem->set(ssid_vector->size());
+            filtered_sz_elem->set(ssid_vector->size());
+
+            if (in_window_start >= ssid_vector->size())
+                in_window_start = 0;
+
+            size_t end = ssid_vector->size();
+
+            if (in_window_len != 0 && in_window_start + in_window_len < end)
+                end = in_window_start + in_window_len;
+
+            if (!order_by_ssid) {
+                next_work_vec->set(std::next(ssid_vector->begin(), in_window_start),
+                        std::next(ssid_vector->begin(), end));
+            } else if (in_order_direction == 0) {
+                // Matches the sort direction of the general path below
+                auto i = std::next(ssid_index.begin(), in_window_start);
+                for (auto n = in_window_start; n < end; ++n, ++i)
+                    next_work_vec->push_back(i->second);
+            } else {
+                auto i = std::next(ssid_index.rbegin(), in_window_start);
+                for (auto n = in_window_start; n < end; ++n, ++i)
+                    next_work_vec->push_back(i->second);
+            }
+        }
+
+        start_elem->set(in_window_start);
+        length_elem->set(next_work_vec->size());
+
+        for (const auto& i : *next_work_vec)
+            output_ssids_elem->push_back(summarize_tracker_element(i, summary_plan, rename_map));
+
+        if (transmit == nullptr)
+            transmit = output_ssids_elem;
+
+        Globalreg::globalreg->entrytracker->serialize(static_cast<std::string>(con->uri()), stream, 
+                transmit, rename_map);
+
+        return;
+    }
+
+    // Copy the vector list, under lock, to the next work vector; this makes it an independent copy
+    // which is protected from the main vector being grown/shrank.  A SSID prefix only copies the 
+    // matching range of the index, already in SSID order.  While we're in there, log the total
     // size of the original vector for windowed ops.
     {
         kis_lock_guard<kis_mutex> lk(mutex);
 
-        next_work_vec->set(ssid_vector->begin(), ssid_vector->end());
-        total_sz_elem->set(next_work_vec->size());
+        if (ssid_prefix.length() != 0) {
+            for (auto i = ssid_index.lower_bound(ssid_prefix); i != ssid_index.end() &&
+                    i->first.compare(0, ssid_prefix.length(), ssid_prefix) == 0; ++i)
+                next_work_vec->push_back(i->second);
+
+            if (order_by_ssid && in_order_direction != 0)
+                std::reverse(next_work_vec->begin(), next_work_vec->end());
+        } else {
+            next_work_vec->set(ssid_vector->begin(), ssid_vector->end());
+        }
+
+        total_sz_elem->set(ssid_vector->size());
     }
 
     // If we have a time filter, apply that first, it's the fastest.
@@ -372,8 +447,10 @@ void phy_80211_ssid_tracker::ssid_endpoint_handler(std::shared_ptr<kis_net_beast
     // Update the end
     length_elem->set(ei - si);
 
-    // Unfortunately we need to do a stable sort to get a consistent display
-    if (in_order_column_num.length() && order_field.size() > 0) {
+    // Unfortunately we need to do a stable sort to get a consistent display; prefix matches
+    // are already in SSID order
+    if (in_order_column_num.length() && order_field.size() > 0 &&
+            !(ssid_prefix.length() != 0 && order_by_ssid)) {
         std::stable_sort(next_work_vec->begin(), next_work_vec->end(),
                 [&](shared_tracker_element a, shared_tracker_element b) -> bool {
                 shared_tracker_element fa;
@@ -397,7 +474,7 @@ void phy_80211_ssid_tracker::ssid_endpoint_handler(std::shared_ptr<kis_net_beast
 
     // Summarize into the output element
     for (auto i = si; i != ei; ++i) {
-        output_ssids_elem->push_back(summarize_tracker_element(*i, summary_vec, rename_map));
+        output_ssids_elem->push_back(summarize_tracker_element(*i, summary_plan, rename_map));
     }
 
     // If the transmit wasn't assigned to a wrapper...
@@ -409,6 +486,25 @@ void phy_80211_ssid_tracker::ssid_endpoint_handler(std::shared_ptr<kis_net_beast
             transmit, rename_map);
 }
 
+std::shared_ptr<tracker_element> phy_80211_ssid_tracker::summary_endpoint_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
+    kis_lock_guard<kis_mutex> lk(mutex, "phy_80211_ssid_tracker summary_endpoint_handler");
+
+    auto ret = std::make_shared<tracker_element_string_map>();
+
+    auto add_count = [&ret](const std::string& name, uint64_t count) {
+        auto e = std::make_shared<tracker_element_uint64>();
+        e->set(count);
+        ret->insert(name, e);
+    };
+
+    add_count("total", ssid_map.size());
+    add_count("advertised", num_advertised);
+    add_count("responded", num_responded);
+    add_count("probed", num_probed);
+
+    return ret;
+}
+
 std::shared_ptr<tracker_element> phy_80211_ssid_tracker::detail_endpoint_handler(std::shared_ptr<kis_net_beast_httpd_connection> con) {
     kis_lock_guard<kis_mutex> lk(mutex, "phy_80211_ssid_tracker detail_endpoint_handler");
 
@@ -422,6 +518,23 @@ std::shared_ptr<tracker_element> phy_80211_ssid_tracker::detail_endpoint_handler
 }
 
 
+std::shared_ptr<dot11_tracked_ssid_group> phy_80211_ssid_tracker::fetch_group(const std::string& ssid,
+        unsigned int ssid_len, uint64_t crypt_set) {
+    auto key = kis_80211_phy::ssid_hash(ssid, ssid_len);
+
+    auto mapdev = ssid_map.find(key);
+
+    if (mapdev != ssid_map.end())
+        return mapdev->second;
+
+    auto tssid = std::make_shared<dot11_tracked_ssid_group>(group_builder.get(), ssid, ssid_len, crypt_set);
+    ssid_map[key] = tssid;
+    ssid_vector->push_back(tssid);
+    ssid_index.emplace(tssid->get_ssid(), tssid);
+
+    return tssid;
+}
+
 void phy_80211_ssid_tracker::handle_broadcast_ssid(const std::string& ssid, unsigned int ssid_len, 
         uint64_t crypt_set, std::shared_ptr<kis_tracked_device_base> device) {
 
@@ -431,21 +544,10 @@ void phy_80211_ssid_tracker::handle_broadcast_ssid(const std::string& ssid, unsi
     if (ssid_len == 0)
         return;
 
-    auto key = kis_80211_phy::ssid_hash(ssid, ssid_len);
-
     kis_lock_guard<kis_mutex> lk(mutex);
 
-    auto mapdev = ssid_map.find(key);
-
-    if (mapdev == ssid_map.end()) {
-        auto tssid = std::make_shared<dot11_tracked_ssid_group>(group_builder.get(), ssid, ssid_len, crypt_set);
-        tssid->add_advertising_device(device);
-        ssid_map[key] = tssid;
-        ssid_vector->push_back(tssid);
-    } else {
-        auto tssid = std::static_pointer_cast<dot11_tracked_ssid_group>(mapdev->second);
-        tssid->add_advertising_device(device);
-    }
+    if (fetch_group(ssid, ssid_len, crypt_set)->add_advertising_device(device))
+        num_advertised++;
 }
 
 void phy_80211_ssid_tracker::handle_response_ssid(const std::string& ssid, unsigned int ssid_len, 
@@ -457,22 +559,10 @@ void phy_80211_ssid_tracker::handle_response_ssid(const std::string& ssid, unsig
     if (ssid_len == 0)
         return;
 
-    auto key = kis_80211_phy::ssid_hash(ssid, ssid_len);
-
     kis_lock_guard<kis_mutex> lk(mutex);
 
-    auto mapdev = ssid_map.find(key);
-
-    if (mapdev == ssid_map.end()) {
-        auto tssid = std::make_shared<dot11_tracked_ssid_group>(group_builder.get(), ssid, ssid_len, crypt_set);
-        tssid->add_responding_device(device);
-        ssid_map[key] = tssid;
-        ssid_vector->push_back(tssid);
-    } else {
-        auto tssid = std::static_pointer_cast<dot11_tracked_ssid_group>(mapdev->second);
-        tssid->add_responding_device(device);
-    }
-
+    if (fetch_group(ssid, ssid_len, crypt_set)->add_responding_device(device))
+        num_responded++;
 }
 
 void phy_80211_ssid_tracker::handle_probe_ssid(const std::string& ssid, unsigned int ssid_len, 
@@ -484,21 +574,8 @@ void phy_80211_ssid_tracker::handle_probe_ssid(const std::string& ssid, unsigned
     if (ssid_len == 0)
         return;
 
-    auto key = kis_80211_phy::ssid_hash(ssid, ssid_len);
-
     kis_lock_guard<kis_mutex> lk(mutex);
 
-    auto mapdev = ssid_map.find(key);
-
-    if (mapdev == ssid_map.end()) {
-        auto tssid = std::make_shared<dot11_tracked_ssid_group>(group_builder.get(), ssid, ssid_len, crypt_set);
-        tssid->add_probing_device(device);
-        ssid_map[key] = tssid;
-        ssid_vector->push_back(tssid);
-    } else {
-        auto tssid = std::static_pointer_cast<dot11_tracked_ssid_group>(mapdev->second);
-        tssid->add_probing_device(device);
-    }
-
+    if (fetch_group(ssid, ssid_len, crypt_set)->add_probing_device(device))
+        num_probed++;
 }
-
@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <functional>
+#include <map>
 
 #include "devicetracker.h"
 #include "devicetracker_component.h"
@@ -106,17 +107,15 @@ public:
     __Proxy(probing_device_len, uint64_t, uint64_t, uint64_t, probing_device_len);
     __Proxy(responding_device_len, uint64_t, uint64_t, uint64_t, responding_device_len);
 
-    void add_advertising_device(std::shared_ptr<kis_tracked_device_base> device);
-    void add_probing_device(std::shared_ptr<kis_tracked_device_base> device);
-    void add_responding_device(std::shared_ptr<kis_tracked_device_base> device);
+    // Add a device, returning true if it is the first device of that kind in the group;
+    // the device counts are kept up to date as devices are added
+    bool add_advertising_device(std::shared_ptr<kis_tracked_device_base> device);
+    bool add_probing_device(std::shared_ptr<kis_tracked_device_base> device);
+    bool add_responding_device(std::shared_ptr<kis_tracked_device_base> device);
 
     virtual void pre_serialize() override {
         // We have to protect our maps so we lock around them
         mutex.lock();
-
-        set_advertising_device_len(advertising_device_map->size());
-        set_probing_device_len(probing_device_map->size());
-        set_responding_device_len(responding_device_map->size());
     }
 
     virtual void post_serialize() override {
@@ -129,6 +128,8 @@ protected:
     virtual void register_fields() override;
     virtual void reserve_fields(std::shared_ptr<tracker_element_map> e) override;
 
+    void update_times(const std::shared_ptr<kis_tracked_device_base>& device);
+
     std::shared_ptr<tracker_element_uint64> ssid_hash;
 
     std::shared_ptr<tracker_element_string> ssid;
@@ -181,10 +182,23 @@ protected:
     robin_hood::unordered_node_map<size_t, std::shared_ptr<dot11_tracked_ssid_group>> ssid_map;
     std::shared_ptr<tracker_element_vector> ssid_vector;
 
+    // Groups ordered by SSID, maintained as groups are added, so queries sorted by SSID
+    // or by SSID prefix walk the index instead of copying and sorting every group
+    std::multimap<std::string, std::shared_ptr<dot11_tracked_ssid_group>> ssid_index;
+    std::vector<int> ssid_field_path;
+
+    // Number of groups which have been advertised, responded for, and probed for
+    uint64_t num_advertised, num_responded, num_probed;
+
     int tracked_ssid_id;
     std::shared_ptr<dot11_tracked_ssid_group> group_builder;
 
+    // Find or create the group for a SSID; must be called under the tracker mutex
+    std::shared_ptr<dot11_tracked_ssid_group> fetch_group(const std::string& ssid, 
+            unsigned int ssid_len, uint64_t crypt_set);
+
     void ssid_endpoint_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
+    std::shared_ptr<tracker_element> summary_endpoint_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
     std::shared_ptr<tracker_element> detail_endpoint_handler(std::shared_ptr<kis_net_beast_httpd_connection> con);
 
     int cleanup_timer_id;
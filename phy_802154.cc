@@ -19,6 +19,7 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include <list>
 #include <map>
@@ -34,40 +35,167 @@
 #include "devicetracker.h"
 #include "dlttracker.h"
 #include "manuf.h"
+#include "configfile.h"
 #include "messagebus.h"
 
 #include "phy_802154.h"
 
+#include "xxhash.h"
+
 #define BEACON_802154   0x00
 #define DATA_802154     0x01
 #define ACK_802154      0x02
 #define CMD_802154      0x03
 
-uint8_t chan = 0;
-uint8_t sigstr = 0;
-
-// 802.15.4 header
-struct _802_15_4_fcf {
-    unsigned char type : 3;
-    unsigned char security : 1;
-    unsigned char pending : 1;
-    unsigned char ack_req : 1;
-    unsigned char pan_id_comp : 1;
-    unsigned char reserved : 1;
-    unsigned char sns : 1;
-    unsigned char iep : 1;
-    unsigned char dest_addr_mode : 2;
-    unsigned char frame_ver : 2;
-    unsigned char src_addr_mode : 2;
+// 802.15.4 MAC header, parsed in place; addresses are stored in display order, 
+// reversed from the little-endian order on the air
+struct kis_802154_header {
+    uint8_t type;
+    bool security;
+    bool pending;
+    bool ack_req;
+    bool pan_id_comp;
+    bool sns;
+    bool iep;
+    uint8_t dest_addr_mode;
+    uint8_t frame_ver;
+    uint8_t src_addr_mode;
+
+    uint8_t seqno;
+
+    uint16_t dest_pan;
+    uint16_t src_pan;
+
+    uint8_t dest[8];
+    uint8_t src[8];
+
+    // Offset of the frame payload
+    size_t header_len;
+
+    size_t dest_len() const {
+        return dest_addr_mode == 0x03 ? 8 : 2;
+    }
+
+    size_t src_len() const {
+        return src_addr_mode == 0x03 ? 8 : 2;
+    }
+};
+
+class kis_802154_packinfo : public packet_component {
+public:
+    kis_802154_packinfo() :
+        repeat{false} { }
+
+    void reset() {
+        repeat = false;
+    }
+
+    kis_802154_header header;
+
+    // Repeated beacon or ack from a known source, which only needs counting
+    bool repeat;
 };
 
-uint8_t dest[2] = {0x00, 0x00};
-uint8_t dest_pan[2] = {0x00, 0x00};
-uint8_t src[2] = {0x00, 0x00};
-uint8_t src_pan[2] = {0x00, 0x00};
+// Parse and validate the MAC header of the frame in data
+static bool parse_802154_header(const uint8_t *data, size_t len, kis_802154_header& hdr) {
+    size_t pos = 0;
+
+    memset(&hdr, 0, sizeof(kis_802154_header));
+
+    // Do we have enough for the frame control field?
+    if (pos + 2 >= len)
+        return false;
+
+    uint16_t fcf = data[pos] | (data[pos + 1] << 8);
+    pos += 2;
+
+    hdr.type = fcf & 0x07;
+    hdr.security = (fcf >> 3) & 0x01;
+    hdr.pending = (fcf >> 4) & 0x01;
+    hdr.ack_req = (fcf >> 5) & 0x01;
+    hdr.pan_id_comp = (fcf >> 6) & 0x01;
+    hdr.sns = (fcf >> 8) & 0x01;
+    hdr.iep = (fcf >> 9) & 0x01;
+    hdr.dest_addr_mode = (fcf >> 10) & 0x03;
+    hdr.frame_ver = (fcf >> 12) & 0x03;
+    hdr.src_addr_mode = (fcf >> 14) & 0x03;
+
+    // only parsing specific types of packets
+    if (hdr.type > 0x03)
+        return false;
+
+    // Check if the specific packet types are actually valid
+    switch (hdr.type) {
+        case BEACON_802154:
+            // Beacon should not have security enabled, a dest, or sns, and frame
+            // version 3 is not valid for this header type
+            if (hdr.security || hdr.dest_addr_mode != 0x00 || hdr.sns || hdr.frame_ver == 0x03)
+                return false;
+            break;
+        case DATA_802154:
+            if (hdr.dest_addr_mode == 0x01 || hdr.frame_ver == 0x03)
+                return false;
+            break;
+        case ACK_802154:
+            // Ack needs a source, and sns is not valid for version 0 acks
+            if (hdr.src_addr_mode <= 0x01 || hdr.dest_addr_mode == 0x01 || hdr.security ||
+                    (hdr.sns && hdr.frame_ver == 0x00))
+                return false;
+            break;
+        case CMD_802154:
+            // Command needs a source
+            if (hdr.src_addr_mode <= 0x01 || hdr.sns || hdr.frame_ver == 0x03)
+                return false;
+            break;
+    }
+
+    // sns not valid for any header type we handle
+    if (hdr.sns)
+        return false;
+
+    hdr.seqno = data[pos];
+    pos++;
+
+    // Address mode 1 is not valid under this spec
+    if (hdr.dest_addr_mode == 0x01 || hdr.src_addr_mode == 0x01)
+        return false;
+
+    if (hdr.dest_addr_mode >= 0x02) {
+        // We would go past the end to check this
+        if (pos + 2 + hdr.dest_len() >= len)
+            return false;
+
+        hdr.dest_pan = data[pos] | (data[pos + 1] << 8);
+        pos += 2;
+
+        for (size_t i = 0; i < hdr.dest_len(); i++)
+            hdr.dest[hdr.dest_len() - i - 1] = data[pos + i];
+        pos += hdr.dest_len();
+    }
+
+    if (hdr.src_addr_mode >= 0x02) {
+        if (!hdr.pan_id_comp) {
+            if (pos + 2 >= len)
+                return false;
+
+            hdr.src_pan = data[pos] | (data[pos + 1] << 8);
+            pos += 2;
+        } else {
+            hdr.src_pan = hdr.dest_pan;
+        }
+
+        if (pos + hdr.src_len() >= len)
+            return false;
+
+        for (size_t i = 0; i < hdr.src_len(); i++)
+            hdr.src[hdr.src_len() - i - 1] = data[pos + i];
+        pos += hdr.src_len();
+    }
+
+    hdr.header_len = pos;
 
-uint8_t ext_dest[8];
-uint8_t ext_source[8];
+    return true;
+}
 
 kis_802154_phy::kis_802154_phy(int in_phyid) :
     kis_phy_handler(in_phyid) {
@@ -89,14 +217,23 @@ kis_802154_phy::kis_802154_phy(int in_phyid) :
     pack_comp_common = packetchain->register_packet_component("COMMON");
 	pack_comp_linkframe = packetchain->register_packet_component("LINKFRAME");
     pack_comp_l1info = packetchain->register_packet_component("RADIODATA");
+    pack_comp_802154 = packetchain->register_packet_component("802154");
 
     // Extract the dynamic DLT
     auto dltt = 
         Globalreg::fetch_mandatory_global_as<dlt_tracker>("DLTTRACKER");
     dlt = KDLT_IEEE802_15_4_NOFCS;
 
-    packetchain->register_handler(&dissector802154, this, CHAINPOS_LLCDISSECT, -100);
-    packetchain->register_handler(&commonclassifier802154, this, CHAINPOS_CLASSIFIER, -100);
+    frame_mutex.set_name("kis_802154_phy frame_cache");
+
+    frame_window_usec =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<double>("802154_dedupe_window", 1) * 1000000;
+    frame_last_purge = 0;
+
+    packetchain->register_handler(&dissector802154, this, CHAINPOS_LLCDISSECT, -100,
+            {KDLT_IEEE802_15_4_NOFCS, KDLT_IEEE802_15_4_TAP});
+    packetchain->register_handler(&commonclassifier802154, this, CHAINPOS_CLASSIFIER, -100,
+            {KDLT_IEEE802_15_4_NOFCS, KDLT_IEEE802_15_4_TAP});
 }
 
 kis_802154_phy::~kis_802154_phy() {
@@ -104,6 +241,43 @@ kis_802154_phy::~kis_802154_phy() {
     packetchain->remove_handler(&commonclassifier802154, CHAINPOS_CLASSIFIER);
 }
 
+bool kis_802154_phy::frame_is_repeat(std::shared_ptr<kis_packet> in_pack, uint64_t in_key,
+        uint32_t in_hash) {
+    uint64_t ts_usec = (uint64_t) in_pack->ts.tv_sec * 1000000 + in_pack->ts.tv_usec;
+
+    kis_lock_guard<kis_mutex> lk(frame_mutex, "802154 frame_is_repeat");
+
+    // Drop expired records periodically so short-lived addresses don't accumulate
+    if (in_pack->ts.tv_sec - frame_last_purge > 60) {
+        frame_last_purge = in_pack->ts.tv_sec;
+
+        for (auto i = frame_cache.begin(); i != frame_cache.end(); ) {
+            if (ts_usec - i->second.ts_usec > frame_window_usec)
+                i = frame_cache.erase(i);
+            else
+                ++i;
+        }
+    }
+
+    auto fi = frame_cache.find(in_key);
+
+    if (fi == frame_cache.end()) {
+        frame_cache.emplace(in_key, frame_record{in_hash, ts_usec});
+        return false;
+    }
+
+    // The window restarts with every full update, so a source repeating one beacon is
+    // still fully updated once per window
+    if (fi->second.hash == in_hash && ts_usec >= fi->second.ts_usec &&
+            ts_usec - fi->second.ts_usec < frame_window_usec)
+        return true;
+
+    fi->second.hash = in_hash;
+    fi->second.ts_usec = ts_usec;
+
+    return false;
+}
+
 int kis_802154_phy::dissector802154(CHAINCALL_PARMS) {
     auto mphy = static_cast<kis_802154_phy *>(auxdata);
 
@@ -111,19 +285,12 @@ int kis_802154_phy::dissector802154(CHAINCALL_PARMS) {
         return 1;
 
     auto packdata = in_pack->fetch<kis_datachunk>(mphy->pack_comp_linkframe);
-    _802_15_4_tap *tap_header = nullptr;
-
-    unsigned short fcf = 0;
-    auto hdr_802_15_4_fcf = reinterpret_cast<_802_15_4_fcf *>(&fcf);
 
     if (packdata == NULL)
         return 0;
 
     // Is it a packet we care about?
-    if (packdata == NULL ||
-        (packdata != NULL &&
-            (packdata->dlt != KDLT_IEEE802_15_4_NOFCS &&
-                packdata->dlt != KDLT_IEEE802_15_4_TAP)))
+    if (packdata->dlt != KDLT_IEEE802_15_4_NOFCS && packdata->dlt != KDLT_IEEE802_15_4_TAP)
         return 0;
 
     // Do we have enough data for an OUI? and are within the Zigbee spec
@@ -136,244 +303,62 @@ int kis_802154_phy::dissector802154(CHAINCALL_PARMS) {
     if (common != NULL)
         return 0;
 
-    unsigned int pkt_ctr = 0;
-    if (packdata->dlt == KDLT_IEEE802_15_4_TAP) {
-        uint64_t tap_header_size = sizeof(_802_15_4_tap);
-        uint8_t tmp_header[32];
-        memset(tmp_header, 0x00, 32);
-        memcpy(tmp_header, &packdata->data()[pkt_ctr], tap_header_size);
-        tap_header = (_802_15_4_tap *) &tmp_header;
-
-        // Really we are going to want to iterate through them to pull them
-        // correctly.
-        chan = kis_letoh32(tap_header->tlv[2].value);
-        sigstr = kis_letoh32(tap_header->tlv[1].value);
-        pkt_ctr += tap_header_size;
-    }
-
-    // Are we more than just a header?
-    if (pkt_ctr >= packdata->length())
-        return 0;
-
-    if (packdata->dlt == KDLT_IEEE802_15_4_NOFCS ||
-        packdata->dlt == KDLT_IEEE802_15_4_TAP) {
-
-        // Do we have enough for the frame control field?
-        if (pkt_ctr + 2 >= packdata->length())
-            return 0;
-
-        fcf = (((short) packdata->data()[pkt_ctr + 1]) << 8) |
-            (0x00ff & packdata->data()[pkt_ctr]);
+    auto data = reinterpret_cast<const uint8_t *>(packdata->data());
+    size_t len = packdata->length();
 
-        pkt_ctr += 2;
-
-        // only parsing specific types of packets
-        if (hdr_802_15_4_fcf->type > 0x03) {
+    if (packdata->dlt == KDLT_IEEE802_15_4_TAP) {
+        // Are we more than just a header?
+        if (len <= sizeof(_802_15_4_tap))
             return 0;
-        }
-
-        // Check if the specific packet types are actually valid
-
-        // Look for an invalid  Beacon
-        if (hdr_802_15_4_fcf->type == BEACON_802154) {
-            // Beacon should not have security enabled
-            if (hdr_802_15_4_fcf->security == 0x01)
-                return 0;
-
-            // Beacon should not have a dest
-            if (hdr_802_15_4_fcf->dest_addr_mode != 0x00)
-                return 0;
 
-            // sns not valid for this header type
-            if (hdr_802_15_4_fcf->sns)
-                return 0;
-
-            // Frame version not valid for this header type
-            if (hdr_802_15_4_fcf->frame_ver == 0x03)
-                return 0;
-        }
+        data += sizeof(_802_15_4_tap);
+        len -= sizeof(_802_15_4_tap);
+    }
 
-        // Look for invalid Data packet
-        if (hdr_802_15_4_fcf->type == DATA_802154) {
-            // Data should not have a dest 0x01
-            if (hdr_802_15_4_fcf->dest_addr_mode == 0x01)
-                return 0;
+    auto info = mphy->packetchain->new_packet_component<kis_802154_packinfo>();
+    auto& hdr = info->header;
 
-            // Frame version not valid for this header type
-            if (hdr_802_15_4_fcf->frame_ver == 0x03)
-                return 0;
-        }
+    if (!parse_802154_header(data, len, hdr))
+        return 0;
 
-        // Look for invalid Ack packet
-        if (hdr_802_15_4_fcf->type == ACK_802154) {
-            // Ack needs a source
-            if (hdr_802_15_4_fcf->src_addr_mode <= 0x01)
-                return 0;
+    // Setting the source and dest
+    if (hdr.src_addr_mode < 0x02 && hdr.dest_addr_mode < 0x02)
+        return 1;
 
-            // Ack should not have a dest 0x01
-            if (hdr_802_15_4_fcf->dest_addr_mode == 0x01)
-                return 0;
+    common = mphy->packetchain->new_packet_component<kis_common_info>();
+    common->phyid = mphy->fetch_phy_id();
+    common->basic_crypt_set = crypt_none;
+    common->type = packet_basic_data;
 
-            // Ack should not have security enabled
-            if (hdr_802_15_4_fcf->security == 0x01)
-                return 0;
+    if (hdr.src_addr_mode >= 0x02)
+        common->source = mac_addr(hdr.src, hdr.src_len());
 
-            // sns not valid for this header type
-            if (hdr_802_15_4_fcf->sns && hdr_802_15_4_fcf->frame_ver == 0x00)
-                return 0;
-        }
+    if (hdr.dest_addr_mode >= 0x02)
+        common->dest = mac_addr(hdr.dest, hdr.dest_len());
 
-        // Look for invalid Cmd packet
-        if (hdr_802_15_4_fcf->type == CMD_802154) {
-            // Command needs a source
-            if (hdr_802_15_4_fcf->src_addr_mode <= 0x01)
-                return 0;
+    // Beacons and acks from a source, on the same PAN, which have nothing new since its
+    // last full update are only counted
+    if (mphy->frame_window_usec > 0 && hdr.src_addr_mode >= 0x02 &&
+            (hdr.type == BEACON_802154 || hdr.type == ACK_802154)) {
+        uint8_t keybuf[11];
 
-            // sns not valid for this header type
-            if (hdr_802_15_4_fcf->sns)
-                return 0;
+        keybuf[0] = hdr.src_pan & 0xFF;
+        keybuf[1] = (hdr.src_pan >> 8) & 0xFF;
+        keybuf[2] = hdr.src_addr_mode;
+        memcpy(keybuf + 3, hdr.src, 8);
 
-            // Frame version not valid for this header type
-            if (hdr_802_15_4_fcf->frame_ver == 0x03)
-                return 0;
-        }
+        auto key = XXH64(keybuf, sizeof(keybuf), 0);
 
-        if (!hdr_802_15_4_fcf->sns) {
-            pkt_ctr++;
-        } else {
-            // sns not valid for this header type
-            return 0;
-        }
+        uint32_t hash = 0;
 
-        // dest address
-        if (hdr_802_15_4_fcf->dest_addr_mode == 0x01) {
-            // This address mode is not valid under this spec
-            return 0;
-        } else if (hdr_802_15_4_fcf->dest_addr_mode == 0x02) {
-            // We would go past the end to check this
-            if ((pkt_ctr + 4) >= packdata->length())
-                return 0;
-
-            dest[1] = packdata->data()[pkt_ctr];
-            dest[0] = packdata->data()[pkt_ctr + 1];
-            pkt_ctr += 2;
-
-            dest_pan[1] = packdata->data()[pkt_ctr];
-            dest_pan[0] = packdata->data()[pkt_ctr + 1];
-            pkt_ctr += 2;
-        } else if (hdr_802_15_4_fcf->dest_addr_mode == 0x03) {
-            // We would go past the end to check this
-            if ((pkt_ctr + 10) >= packdata->length())
-                return 0;
-
-            // Length means we actually have an extended dest
-            dest[1] = packdata->data()[pkt_ctr];
-            dest[0] = packdata->data()[pkt_ctr + 1];
-            pkt_ctr += 2;
-
-            // Extended dest which is what were are looking for
-            ext_dest[7] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-            ext_dest[6] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-            ext_dest[5] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-            ext_dest[4] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-            ext_dest[3] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-            ext_dest[2] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-            ext_dest[1] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-            ext_dest[0] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-        }
+        if (hdr.type == BEACON_802154)
+            hash = XXH32(data + hdr.header_len, len - hdr.header_len, 0);
 
-        // src address
-        if (hdr_802_15_4_fcf->src_addr_mode == 0x01) {
-            // This address mode is not valid under this spec
-            return 0;
-        } else if (hdr_802_15_4_fcf->src_addr_mode == 0x02) {
-            if (!hdr_802_15_4_fcf->pan_id_comp) {
-                // We would go past the end to check this
-                if ((pkt_ctr + 2) >= packdata->length())
-                    return 0;
-                // src pan
-                src_pan[1] = packdata->data()[pkt_ctr];
-                src_pan[0] = packdata->data()[pkt_ctr + 1];
-                pkt_ctr += 2;
-            }
-
-            // We would go past the end to check this
-            if ((pkt_ctr + 2) >= packdata->length())
-                return 0;
-
-            src[1] = packdata->data()[pkt_ctr];
-            src[0] = packdata->data()[pkt_ctr + 1];
-            pkt_ctr += 2;
-        } else if (hdr_802_15_4_fcf->src_addr_mode == 0x03) {
-            // srcpan
-            // extended source
-            if (!hdr_802_15_4_fcf->pan_id_comp) {
-                // We would go past the end to check this
-                if ((pkt_ctr + 2) >= packdata->length())
-                    return 0;
-
-                src_pan[1] = packdata->data()[pkt_ctr];
-                src_pan[0] = packdata->data()[pkt_ctr + 1];
-                pkt_ctr += 2;
-            }
-
-            // We would go past the end to check this
-            if ((pkt_ctr + 8) >= packdata->length())
-                return 0;
-
-            // extended source which is what were are looking for
-            ext_source[7] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-            ext_source[6] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-            ext_source[5] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-            ext_source[4] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-            ext_source[3] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-            ext_source[2] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-            ext_source[1] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-            ext_source[0] = packdata->data()[pkt_ctr];
-            pkt_ctr++;
-        }
+        info->repeat = mphy->frame_is_repeat(in_pack, key, hash);
     }
 
-    // Setting the source and dest
-    if (hdr_802_15_4_fcf->src_addr_mode >= 0x02 ||
-        hdr_802_15_4_fcf->dest_addr_mode >= 0x02) {
-        common = std::make_shared<kis_common_info>();
-        common->phyid = mphy->fetch_phy_id();
-        common->basic_crypt_set = crypt_none;
-        common->type = packet_basic_data;
-
-        if (hdr_802_15_4_fcf->src_addr_mode == 0x03) {
-            common->source = mac_addr(ext_source, 8);
-        } else if (hdr_802_15_4_fcf->src_addr_mode == 0x02 &&
-            hdr_802_15_4_fcf->pan_id_comp) {
-            common->source = mac_addr(src, 2);
-        } else if (hdr_802_15_4_fcf->src_addr_mode == 0x02) {
-            common->source = mac_addr(src, 2);
-        }
-
-        if (hdr_802_15_4_fcf->dest_addr_mode == 0x03) {
-            common->dest = mac_addr(ext_dest, 8);
-        } else if (hdr_802_15_4_fcf->dest_addr_mode == 0x02) {
-            common->dest = mac_addr(dest, 2);
-        }
-
-        in_pack->insert(mphy->pack_comp_common, common);
-    }
+    in_pack->insert(mphy->pack_comp_common, common);
+    in_pack->insert(mphy->pack_comp_802154, info);
 
     return 1;
 }
@@ -397,56 +382,77 @@ int kis_802154_phy::commonclassifier802154(CHAINCALL_PARMS) {
 
     // Did we classify this?
     auto common = in_pack->fetch<kis_common_info>(mphy->pack_comp_common);
+    auto info = in_pack->fetch<kis_802154_packinfo>(mphy->pack_comp_802154);
 
-    if (common == NULL)
+    if (common == NULL || info == nullptr)
         return 0;
 
+    auto& hdr = info->header;
+
     if (in_pack->duplicate) {
+        if (hdr.src_addr_mode >= 0x02)
+            mphy->devicetracker->update_common_device(common,
+                    common->source, mphy, in_pack,
+                    (UCD_UPDATE_SIGNAL | UCD_UPDATE_FREQUENCIES | 
+                     UCD_UPDATE_LOCATION | UCD_UPDATE_SEENBY),
+                    "802.15.4");
+        return 1;
+    }
+
+    // Repeats only count the packet against a source which is already tracked; a
+    // source which has timed out is rebuilt from the full update
+    if (info->repeat) {
         auto source_dev = mphy->devicetracker->update_common_device(common,
                 common->source, mphy, in_pack,
-                (UCD_UPDATE_SIGNAL | UCD_UPDATE_FREQUENCIES | 
-                 UCD_UPDATE_LOCATION | UCD_UPDATE_SEENBY),
+                (UCD_UPDATE_PACKETS | UCD_UPDATE_EXISTING_ONLY),
                 "802.15.4");
+
+        if (source_dev != nullptr)
+            return 1;
     }
 
     // as source
     // Update with all the options in case we can add signal and frequency
     // in the future
-    auto source_dev = mphy->devicetracker->update_common_device(common,
-        common->source, mphy, in_pack,
-        (UCD_UPDATE_SIGNAL | UCD_UPDATE_FREQUENCIES | UCD_UPDATE_PACKETS |
-            UCD_UPDATE_LOCATION | UCD_UPDATE_SEENBY | UCD_UPDATE_ENCRYPTION),
-        "802.15.4");
-
-    auto source_kis_802154 = source_dev->get_sub_as<kis_802154_tracked_device>(
-        mphy->kis_802154_device_entry_id);
-
-    if (source_kis_802154 == NULL) {
-        _MSG_INFO(
-            "Detected new 802.15.4 device {}", common->source.mac_to_string());
-        source_kis_802154 = std::make_shared<kis_802154_tracked_device>(
+    if (hdr.src_addr_mode >= 0x02) {
+        auto source_dev = mphy->devicetracker->update_common_device(common,
+            common->source, mphy, in_pack,
+            (UCD_UPDATE_SIGNAL | UCD_UPDATE_FREQUENCIES | UCD_UPDATE_PACKETS |
+                UCD_UPDATE_LOCATION | UCD_UPDATE_SEENBY | UCD_UPDATE_ENCRYPTION),
+            "802.15.4");
+
+        auto source_kis_802154 = source_dev->get_sub_as<kis_802154_tracked_device>(
             mphy->kis_802154_device_entry_id);
-        source_dev->insert(source_kis_802154);
+
+        if (source_kis_802154 == NULL) {
+            _MSG_INFO(
+                "Detected new 802.15.4 device {}", common->source.mac_to_string());
+            source_kis_802154 = std::make_shared<kis_802154_tracked_device>(
+                mphy->kis_802154_device_entry_id);
+            source_dev->insert(source_kis_802154);
+        }
     }
 
     // as destination
     // Update with all the options in case we can add signal and frequency
     // in the future
-    auto dest_dev = mphy->devicetracker->update_common_device(common,
-        common->dest, mphy, in_pack,
-        (UCD_UPDATE_SIGNAL | UCD_UPDATE_FREQUENCIES | UCD_UPDATE_PACKETS |
-            UCD_UPDATE_LOCATION | UCD_UPDATE_SEENBY | UCD_UPDATE_ENCRYPTION),
-        "802.15.4");
-
-    auto dest_kis_802154 = dest_dev->get_sub_as<kis_802154_tracked_device>(
-        mphy->kis_802154_device_entry_id);
-
-    if (dest_kis_802154 == NULL) {
-        _MSG_INFO(
-            "Detected new 802.15.4 device {}", common->dest.mac_to_string());
-        dest_kis_802154 = std::make_shared<kis_802154_tracked_device>(
+    if (hdr.dest_addr_mode >= 0x02) {
+        auto dest_dev = mphy->devicetracker->update_common_device(common,
+            common->dest, mphy, in_pack,
+            (UCD_UPDATE_SIGNAL | UCD_UPDATE_FREQUENCIES | UCD_UPDATE_PACKETS |
+                UCD_UPDATE_LOCATION | UCD_UPDATE_SEENBY | UCD_UPDATE_ENCRYPTION),
+            "802.15.4");
+
+        auto dest_kis_802154 = dest_dev->get_sub_as<kis_802154_tracked_device>(
             mphy->kis_802154_device_entry_id);
-        dest_dev->insert(dest_kis_802154);
+
+        if (dest_kis_802154 == NULL) {
+            _MSG_INFO(
+                "Detected new 802.15.4 device {}", common->dest.mac_to_string());
+            dest_kis_802154 = std::make_shared<kis_802154_tracked_device>(
+                mphy->kis_802154_device_entry_id);
+            dest_dev->insert(dest_kis_802154);
+        }
     }
 
     return 1;
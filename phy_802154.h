@@ -28,6 +28,7 @@
 #include <vector>
 #include <algorithm>
 #include <string>
+#include <unordered_map>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -120,10 +121,24 @@ protected:
 
     int kis_802154_device_entry_id;
     int dev_comp_common;
-    int pack_comp_common, pack_comp_l1info, pack_comp_linkframe;
+    int pack_comp_common, pack_comp_l1info, pack_comp_linkframe, pack_comp_802154;
 
     int dlt;
 
+    // Last beacon from each source address on each PAN, and when the source was last
+    // fully updated; beacons repeating it and acks within 802154_dedupe_window only
+    // update the packet counts of a device which is already tracked
+    struct frame_record {
+        uint32_t hash;
+        uint64_t ts_usec;
+    };
+
+    kis_mutex frame_mutex;
+    std::unordered_map<uint64_t, frame_record> frame_cache;
+    uint64_t frame_window_usec;
+    time_t frame_last_purge;
+
+    bool frame_is_repeat(std::shared_ptr<kis_packet> in_pack, uint64_t in_key, uint32_t in_hash);
 };
 
 #endif
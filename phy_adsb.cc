@@ -19,6 +19,8 @@
 
 #include "config.h"
 
+#include <algorithm>
+
 #include "phy_adsb.h"
 #include "datasource_virtual.h"
 
@@ -26,6 +28,7 @@
 #include "endian_magic.h"
 #include "macaddr.h"
 #include "kis_httpd_registry.h"
+#include "kis_startup_graph.h"
 #include "manuf.h"
 #include "messagebus.h"
 
@@ -53,12 +56,16 @@ kis_adsb_phy::kis_adsb_phy(int in_phyid) :
         packetchain->register_packet_component("GPS");
     pack_comp_datasource =
         packetchain->register_packet_component("KISDATASRC");
+    pack_comp_linkframe =
+        packetchain->register_packet_component("LINKFRAME");
 
     adsb_adsb_id =
         Globalreg::globalreg->entrytracker->register_field("adsb.device",
                 tracker_element_factory<adsb_tracked_adsb>(),
                 "ADSB adsb");
 
+    adsb_builder = std::make_shared<adsb_tracked_adsb>(adsb_adsb_id);
+
 
     map_min_lat_id = 
         Globalreg::globalreg->entrytracker->register_field("kismet.adsb.map.min_lat",
@@ -89,10 +96,23 @@ kis_adsb_phy::kis_adsb_phy(int in_phyid) :
         Globalreg::fetch_mandatory_global_as<kis_httpd_registry>();
     httpregistry->register_js_module("kismet_ui_adsb", "js/kismet.ui.adsb.js");
 
-	packetchain->register_handler(&packet_handler, this, CHAINPOS_CLASSIFIER, -100);
+    // Surveillance and Comm-B replies overlay the address on their parity, so they
+    // only add altitude to aircraft already known from their squitters
+    decode_surveillance =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("adsb_decode_surveillance",
+                fetch_dissection_profile("adsb") != kis_dissection_profile::survey);
+
+    last_frame_error = 0;
+
+    // Raw Mode S frames, or decoded reports from the json datasources
+	packetchain->register_handler(&packet_handler, this, CHAINPOS_CLASSIFIER, -100,
+            {KDLT_ADSB_MODES}, pack_comp_json);
 
     icaodb = std::make_shared<kis_adsb_icao>();
 
+    auto icao = icaodb;
+    kis_startup_graph::add("adsb icao index", {}, [icao]() { icao->index(); });
+
     auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
 
     httpd->register_route("/phy/ADSB/proxy/create", {"POST"}, httpd->LOGON_ROLE, {"cmd"},
@@ -165,19 +185,25 @@ kis_adsb_phy::kis_adsb_phy(int in_phyid) :
                                                 return;
                                             }
 
-                                            // Proxy input
+                                            auto raw = hex_to_bytes(bufstr.substr(1, bufstr.length() - 3));
+
+                                            if (raw.length() != ADSB_MODES_SHORT_LEN &&
+                                                    raw.length() != ADSB_MODES_LONG_LEN) {
+                                                _MSG_DEBUG("Invalid adsb proxy {}", bufstr);
+                                                return;
+                                            }
+
+                                            // Proxy input, as a raw frame
                                             auto packet = packetchain->generate_packet();
                                             gettimeofday(&(packet->ts), NULL);
 
-                                            auto jsoninfo = std::make_shared<kis_json_packinfo>();
-
-                                            jsoninfo->type = "adsb";
+                                            auto datachunk = packetchain->new_packet_component<kis_datachunk>();
 
-                                            jsoninfo->json_string = 
-                                                fmt::format("{{\"adsb_raw_msg\": \"{}\"}}",
-                                                        bufstr.substr(1, bufstr.length() - 3));
+                                            datachunk->dlt = KDLT_ADSB_MODES;
+                                            datachunk->copy_raw_data(raw);
+                                            packet->original_len = raw.length();
 
-                                            packet->insert(pack_comp_json, jsoninfo);
+                                            packet->insert(pack_comp_linkframe, datachunk);
 
                                             virtual_source->handle_rx_packet(packet);
 
@@ -219,21 +245,11 @@ kis_adsb_phy::kis_adsb_phy(int in_phyid) :
                             if (in_pack->error || in_pack->filtered || in_pack->duplicate)
                                 return 0;
 
-                            auto json = in_pack->fetch<kis_json_packinfo>(pack_comp_json);
-                            
-                            if (json == NULL)
-                                return 0;
-
-                            if (json->type != "adsb")
-                                return 0;
-
-                            std::stringstream ss(json->json_string);
-                            Json::Value device_json;
-
                             try {
-                                ss >> device_json;
+                                auto adsb_content = packet_raw_frame(in_pack);
 
-                                auto adsb_content = hex_to_bytes(device_json["adsb_raw_msg"].asString());
+                                if (adsb_content.size() == 0)
+                                    return 0;
 
                                 if (adsb_content.size() != 7 && adsb_content.size() != 14) {
                                     _MSG_DEBUG("unexpected content length {}", adsb_content.size());
@@ -304,22 +320,14 @@ kis_adsb_phy::kis_adsb_phy(int in_phyid) :
                             if (in_pack->error || in_pack->filtered || in_pack->duplicate)
                                 return 0;
 
-                            auto json = in_pack->fetch<kis_json_packinfo>(pack_comp_json);
-                            
-                            if (json == NULL)
-                                return 0;
-
-                            if (json->type != "adsb")
-                                return 0;
-
-                            std::stringstream ss(json->json_string);
-                            Json::Value device_json;
-
                             try {
-                                ss >> device_json;
+                                auto raw = packet_raw_frame(in_pack);
+
+                                if (raw.size() == 0)
+                                    return 0;
 
                                 auto adsb_content = 
-                                    fmt::format("*{};\n", device_json["adsb_raw_msg"].asString());
+                                    fmt::format("*{};\n", uint8_to_hex_str((uint8_t *) raw.data(), raw.length()));
 
                                 ws->write(adsb_content);
                             } catch (std::exception& e) {
@@ -365,14 +373,6 @@ kis_adsb_phy::kis_adsb_phy(int in_phyid) :
                             if (in_pack->error || in_pack->filtered || in_pack->duplicate)
                                 return 0;
 
-                            auto json = in_pack->fetch<kis_json_packinfo>(pack_comp_json);
-                            
-                            if (json == nullptr)
-                                return 0;
-
-                            if (json->type != "adsb")
-                                return 0;
-
                             auto src = in_pack->fetch<packetchain_comp_datasource>(pack_comp_datasource);
 
                             if (src == nullptr)
@@ -381,14 +381,14 @@ kis_adsb_phy::kis_adsb_phy(int in_phyid) :
                             if (src->ref_source->get_source_uuid() != srcuuid)
                                 return 0;
 
-                            std::stringstream ss(json->json_string);
-                            Json::Value device_json;
-
                             try {
-                                ss >> device_json;
+                                auto raw = packet_raw_frame(in_pack);
+
+                                if (raw.size() == 0)
+                                    return 0;
 
                                 auto adsb_content = 
-                                    fmt::format("*{};\n", device_json["adsb_raw_msg"].asString());
+                                    fmt::format("*{};\n", uint8_to_hex_str((uint8_t *) raw.data(), raw.length()));
 
                                 ws->write(adsb_content);
                             } catch (std::exception& e) {
@@ -416,11 +416,11 @@ kis_adsb_phy::~kis_adsb_phy() {
     packetchain->remove_handler(&packet_handler, CHAINPOS_CLASSIFIER);
 }
 
-mac_addr kis_adsb_phy::json_to_mac(Json::Value json) {
-    // Derive a mac addr from the model and device id data
+mac_addr kis_adsb_phy::icao_to_mac(const std::string& icao) {
+    // Derive a mac addr from the icao
     //
-    // We turn the model string into 4 bytes using the adler32 checksum,
-    // then we use the model as a (potentially) 16bit int
+    // We turn the icao string into 4 bytes using the adler32 checksum,
+    // then we use the icao as a (potentially) 16bit int
     //
     // Finally we set the locally assigned bit on the first octet
     
@@ -430,52 +430,110 @@ mac_addr kis_adsb_phy::json_to_mac(Json::Value json) {
 
     memset(bytes, 0, 6);
 
-    std::string smodel = "unk";
+    *checksum = adler32_checksum(icao.c_str(), icao.length());
+
+    int icaoint = std::stoi(icao, 0, 16);
+    *model = kis_hton16((uint16_t) icaoint);
 
-    if (json.isMember("icao")) {
-        Json::Value m = json["icao"];
-        if (m.isString()) {
-            smodel = m.asString();
+    // Set the local bit
+    bytes[0] |= 0x2;
+
+    return mac_addr(bytes, 6);
+}
+
+bool kis_adsb_phy::json_to_frame(const kis_json_report& json, adsb_modes_frame& frame) {
+    frame.reset();
+
+    if (json.isMember("crc_valid")) {
+        if (!json["crc_valid"].asBool()) {
+            return false;
         }
     }
 
-    *checksum = adler32_checksum(smodel.c_str(), smodel.length());
+    auto icao_j = json["icao"];
+
+    if (!icao_j.isString())
+        return false;
 
-    bool set_model = false;
+    frame.icao = string_to_n<uint32_t>(icao_j.asString(), std::hex);
 
-    if (json.isMember("icao")) {
-        Json::Value i = json["icao"];
-        if (i.isString()) {
-	    std::string icaotmp = i.asString();
-	    int icaoint = std::stoi(icaotmp, 0, 16);
-            *model = kis_hton16((uint16_t) icaoint);
-            set_model = true;
+    if (json.isMember("callsign")) {
+        auto callsign_j = json["callsign"];
+        if (callsign_j.isString()) {
+            frame.has_callsign = true;
+            frame.callsign = callsign_j.asString();
         }
     }
-  
-    if (!set_model) {
-        *model = 0x0000;
+
+    if (json.isMember("altitude")) {
+        auto altitude_j = json["altitude"];
+        if (altitude_j.isDouble()) {
+            frame.has_altitude = true;
+            frame.altitude = altitude_j.asDouble();
+        }
     }
 
-    // Set the local bit
-    bytes[0] |= 0x2;
+    if (json.isMember("speed")) {
+        auto speed_j = json["speed"];
+        if (speed_j.isDouble()) {
+            frame.has_speed = true;
+            frame.speed = speed_j.asDouble();
+        }
+    }
 
-    return mac_addr(bytes, 6);
+    if (json.isMember("heading")) {
+        auto heading_j = json["heading"];
+        if (heading_j.isDouble()) {
+            frame.has_heading = true;
+            frame.heading = heading_j.asDouble();
+        }
+    }
+
+    if (json.isMember("gsas")) {
+        auto gsas_j = json["gsas"];
+        if (gsas_j.isString()) {
+            frame.gsas = gsas_j.asString();
+        }
+    }
+
+    if (json.isMember("raw_lat") && json.isMember("raw_lon") &&
+            json.isMember("coordpair_even")) {
+        frame.has_position = true;
+        frame.cpr_lat = json["raw_lat"].asUInt();
+        frame.cpr_lon = json["raw_lon"].asUInt();
+        frame.cpr_odd = !json["coordpair_even"].asBool();
+    }
+
+    return true;
 }
 
-bool kis_adsb_phy::json_to_rtl(Json::Value json, std::shared_ptr<kis_packet> packet) {
-    std::string err;
-    std::string v;
+bool kis_adsb_phy::json_to_rtl(const kis_json_report& json, std::shared_ptr<kis_packet> packet) {
+    static thread_local adsb_modes_frame frame;
 
-    if (json.isMember("crc_valid")) {
-        if (!json["crc_valid"].asBool()) {
-            return false;
+    if (!json_to_frame(json, frame))
+        return false;
+
+    std::string channel;
+
+    // If this json record has a channel
+    if (json.isMember("channel")) {
+        auto c = json["channel"];
+        if (c.isNumeric()) {
+            channel = int_to_string(c.asInt());
+        } else if (c.isString()) {
+            channel = munge_to_printable(c.asString());
         }
     }
 
+    return frame_to_rtl(frame, packet, channel);
+}
+
+bool kis_adsb_phy::frame_to_rtl(const adsb_modes_frame& frame, std::shared_ptr<kis_packet> packet,
+        const std::string& channel) {
+    auto icao_s = frame.icao_str();
 
     // synth a mac out of it
-    mac_addr rtlmac = json_to_mac(json);
+    mac_addr rtlmac = icao_to_mac(icao_s);
 
     if (rtlmac.state.error) {
         return false;
@@ -487,15 +545,8 @@ bool kis_adsb_phy::json_to_rtl(Json::Value json, std::shared_ptr<kis_packet> pac
     common->phyid = fetch_phy_id();
     common->datasize = 0;
 
-    // If this json record has a channel
-    if (json.isMember("channel")) {
-        Json::Value c = json["channel"];
-        if (c.isNumeric()) {
-            common->channel = int_to_string(c.asInt());
-        } else if (c.isString()) {
-            common->channel = munge_to_printable(c.asString());
-        }
-    }
+    if (channel.length() != 0)
+        common->channel = channel;
 
     common->freq_khz = 1090000;
     common->source = rtlmac;
@@ -511,22 +562,12 @@ bool kis_adsb_phy::json_to_rtl(Json::Value json, std::shared_ptr<kis_packet> pac
 
     kis_lock_guard<kis_mutex> lk(devicetracker->get_devicelist_mutex(), "adsb_json_to_rtl");
 
-    std::string dn = "Airplane";
-
-    auto icao_j = json["icao"];
-    if (icao_j.isString()) {
-        dn = icao_j.asString();
-    }
-
     basedev->set_manuf(rtl_manuf);
 
     basedev->set_tracker_type_string(devicetracker->get_cached_devicetype("Airplane"));
-    basedev->set_devicename(fmt::format("ADSB {}", dn));
+    basedev->set_devicename(fmt::format("ADSB {}", icao_s));
 
-    std::shared_ptr<adsb_tracked_adsb> adsbdev;
-
-    if (is_adsb(json))
-        adsbdev = add_adsb(packet, json, basedev);
+    auto adsbdev = add_adsb(packet, frame, basedev);
 
     if (adsbdev == nullptr)
         return false;
@@ -606,135 +647,128 @@ bool kis_adsb_phy::json_to_rtl(Json::Value json, std::shared_ptr<kis_packet> pac
     return true;
 }
 
-bool kis_adsb_phy::is_adsb(Json::Value json) {
-
-    //fprintf(stderr, "ADSB: checking to see if it is a adsb\n");
-    auto icao_j = json["icao"];
-
-    if (!icao_j.isNull()) {
-        return true;
-    }
-
-    return false;
-}
-
 std::shared_ptr<adsb_tracked_adsb> kis_adsb_phy::add_adsb(std::shared_ptr<kis_packet> packet,
-        Json::Value json, std::shared_ptr<kis_tracked_device_base> rtlholder) {
-    auto icao_j = json["icao"];
+        const adsb_modes_frame& frame, std::shared_ptr<kis_tracked_device_base> rtlholder) {
     bool new_adsb = false;
     std::stringstream new_ss;
 
-    if (!icao_j.isNull()) {
-        auto adsbdev = 
-            rtlholder->get_sub_as<adsb_tracked_adsb>(adsb_adsb_id);
+    auto icao_s = frame.icao_str();
 
-        if (adsbdev == NULL) {
-            adsbdev = 
-                std::make_shared<adsb_tracked_adsb>(adsb_adsb_id);
-            rtlholder->insert(adsbdev);
-            new_adsb = true;
-
-            new_ss << "Detected new ADSB device ICAO " << icao_j.asString();
-        }
+    auto adsbdev = 
+        rtlholder->get_sub_as<adsb_tracked_adsb>(adsb_adsb_id);
 
-        adsbdev->set_icao(icao_j.asString());
+    if (adsbdev == NULL) {
+        adsbdev = 
+            tracker_arena_make_shared<adsb_tracked_adsb>(adsb_builder.get());
+        rtlholder->insert(adsbdev);
+        new_adsb = true;
 
-        auto icao_record = icaodb->lookup_icao(icao_j.asString());
-        adsbdev->set_icao_record(icao_record);
+        new_ss << "Detected new ADSB device ICAO " << icao_s;
+    }
 
-        if (json.isMember("callsign")) {
-            auto callsign_j = json["callsign"];
-            if (callsign_j.isString()) {
-                auto raw_cs = callsign_j.asString();
+    adsbdev->set_icao(icao_s);
 
-                std::string mangle_cs;
+    auto icao_record = icaodb->lookup_icao(frame.icao);
+    adsbdev->set_icao_record(icao_record);
 
-                for (size_t i = 0; i < raw_cs.length(); i++) {
-                    if (raw_cs[i] != '_') {
-                        mangle_cs += raw_cs[i];
-                    }
-                }
+    if (frame.has_callsign) {
+        std::string mangle_cs;
 
-                adsbdev->set_callsign(mangle_cs);
-                if (adsbdev->get_callsign() != "")
-                    new_ss << adsbdev->get_callsign();
+        for (size_t i = 0; i < frame.callsign.length(); i++) {
+            if (frame.callsign[i] != '_') {
+                mangle_cs += frame.callsign[i];
             }
         }
 
-        if (icao_record != icaodb->get_unknown_icao()) {
-            new_ss << " " << icao_record->get_model();
-            new_ss << " " << icao_record->get_model_type();
-            new_ss << " " << icao_record->get_owner();
-            new_ss << " " << icao_record->get_atype()->get();
-        }
+        adsbdev->set_callsign(mangle_cs);
+        if (adsbdev->get_callsign() != "")
+            new_ss << adsbdev->get_callsign();
+    }
 
-        if (json.isMember("altitude")) {
-            auto altitude_j = json["altitude"];
-            if (altitude_j.isDouble()) {
-                adsbdev->alt = altitude_j.asDouble() * 0.3048;
-                adsbdev->update_location = true;
-            }
-        }
+    if (icao_record != icaodb->get_unknown_icao()) {
+        new_ss << " " << icao_record->get_model();
+        new_ss << " " << icao_record->get_model_type();
+        new_ss << " " << icao_record->get_owner();
+        new_ss << " " << icao_record->get_atype()->get();
+    }
 
-        if (json.isMember("speed")) {
-            auto speed_j = json["speed"];
-            if (speed_j.isDouble()) {
-                adsbdev->speed = speed_j.asDouble() * 1.60934;
-                adsbdev->update_location = true;
-            }
-        }
+    if (frame.has_altitude) {
+        adsbdev->alt = frame.altitude * 0.3048;
+        adsbdev->update_location = true;
+    }
 
-        if (json.isMember("heading")) {
-            auto heading_j = json["heading"];
-            if (heading_j.isDouble()) {
-                adsbdev->heading = heading_j.asDouble();
-                adsbdev->update_location = true;
-            }
-        }
+    if (frame.has_speed) {
+        adsbdev->speed = frame.speed * 1.60934;
+        adsbdev->update_location = true;
+    }
 
-        if (json.isMember("gsas")) {
-            auto gsas_j = json["gsas"];
-            if (gsas_j.isString()) {
-                adsbdev->set_gsas(gsas_j.asString());
-            }
-        }
+    if (frame.has_heading) {
+        adsbdev->heading = frame.heading;
+        adsbdev->update_location = true;
+    }
 
-        if (json.isMember("raw_lat") && json.isMember("raw_lon") &&
-                json.isMember("coordpair_even")) {
-            auto raw_lat = json["raw_lat"].asDouble();
-            auto raw_lon = json["raw_lon"].asDouble();
-            auto raw_even = json["coordpair_even"].asBool();
-            bool calc_coords = false;
+    if (frame.gsas.length() != 0) {
+        adsbdev->set_gsas(frame.gsas);
+    }
 
-            if (raw_even) {
-                adsbdev->set_even_raw_lat(raw_lat);
-                adsbdev->set_even_raw_lon(raw_lon);
-                adsbdev->set_even_ts(time(0));
+    if (frame.has_position) {
+        uint64_t ts_usec = (uint64_t) packet->ts.tv_sec * 1000000 + packet->ts.tv_usec;
+        bool calc_coords = false;
 
-                if (adsbdev->get_even_ts() - adsbdev->get_odd_ts() < 10)
-                    calc_coords = true;
+        // Even and odd positions are only paired when they're within 10 seconds
+        // of each other
+        if (frame.cpr_odd) {
+            adsbdev->cpr_odd = {frame.cpr_lat, frame.cpr_lon, ts_usec};
 
-            } else {
-                adsbdev->set_odd_raw_lat(raw_lat);
-                adsbdev->set_odd_raw_lon(raw_lon);
-                adsbdev->set_odd_ts(time(0));
+            adsbdev->set_odd_raw_lat(frame.cpr_lat);
+            adsbdev->set_odd_raw_lon(frame.cpr_lon);
+            adsbdev->set_odd_ts(packet->ts.tv_sec);
 
-                if (adsbdev->get_odd_ts() - adsbdev->get_even_ts() < 10)
-                    calc_coords = true;
-            }
+            if (adsbdev->cpr_even.ts_usec != 0 && 
+                    ts_usec - adsbdev->cpr_even.ts_usec < 10 * 1000000)
+                calc_coords = true;
+        } else {
+            adsbdev->cpr_even = {frame.cpr_lat, frame.cpr_lon, ts_usec};
 
-            if (calc_coords)
-                decode_cpr(adsbdev, packet);
-        }
+            adsbdev->set_even_raw_lat(frame.cpr_lat);
+            adsbdev->set_even_raw_lon(frame.cpr_lon);
+            adsbdev->set_even_ts(packet->ts.tv_sec);
 
-        if (new_adsb) {
-            _MSG_INFO("{}", new_ss.str());
+            if (adsbdev->cpr_odd.ts_usec != 0 && 
+                    ts_usec - adsbdev->cpr_odd.ts_usec < 10 * 1000000)
+                calc_coords = true;
         }
-        
-        return adsbdev;
+
+        if (calc_coords)
+            decode_cpr(adsbdev);
     }
 
-    return nullptr;
+    if (new_adsb) {
+        _MSG_INFO("{}", new_ss.str());
+    }
+
+    return adsbdev;
+}
+
+std::string kis_adsb_phy::packet_raw_frame(std::shared_ptr<kis_packet> packet) {
+    auto linkdata = packet->fetch<kis_datachunk>(pack_comp_linkframe);
+
+    if (linkdata != nullptr && linkdata->dlt == KDLT_ADSB_MODES)
+        return std::string(linkdata->data(), linkdata->length());
+
+    auto json = packet->fetch<kis_json_packinfo>(pack_comp_json);
+
+    if (json == nullptr)
+        return "";
+
+    if (json->type != "adsb" && json->type != "RTLadsb")
+        return "";
+
+    static thread_local kis_json_report device_json;
+
+    device_json.parse(json->json_string);
+
+    return hex_to_bytes(device_json["adsb_raw_msg"].asString());
 }
 
 int kis_adsb_phy::packet_handler(CHAINCALL_PARMS) {
@@ -745,6 +779,38 @@ int kis_adsb_phy::packet_handler(CHAINCALL_PARMS) {
     if (in_pack->error || in_pack->filtered || in_pack->duplicate)
         return 0;
 
+    // Raw frames from the datasources are decoded directly
+    auto linkdata = in_pack->fetch<kis_datachunk>(adsb->pack_comp_linkframe);
+
+    if (linkdata != nullptr && linkdata->dlt == KDLT_ADSB_MODES) {
+        static thread_local adsb_modes_frame frame;
+
+        // Skip anything but all-call replies and extended squitters before
+        // checking the CRC
+        if (!adsb->decode_surveillance && linkdata->length() > 0) {
+            auto df = static_cast<uint8_t>(linkdata->data()[0]) >> 3;
+
+            if (df != 11 && df != 17)
+                return 0;
+        }
+
+        if (!frame.decode(reinterpret_cast<const uint8_t *>(linkdata->data()), linkdata->length()))
+            return 0;
+
+        try {
+            adsb->frame_to_rtl(frame, in_pack, "");
+        } catch (std::exception& e) {
+            auto now = time(0);
+            auto last = adsb->last_frame_error.load();
+
+            if (now - last >= 60 && adsb->last_frame_error.compare_exchange_strong(last, now))
+                _MSG_DEBUG("Error processing ADSB frame: {}", e.what());
+            return 0;
+        }
+
+        return 1;
+    }
+
     auto json = in_pack->fetch<kis_json_packinfo>(adsb->pack_comp_json);
     if (json == NULL)
         return 0;
@@ -755,11 +821,12 @@ int kis_adsb_phy::packet_handler(CHAINCALL_PARMS) {
     if (json->type != "adsb" && json->type != "RTLadsb")
         return 0;
 
-    std::stringstream ss(json->json_string);
-    Json::Value device_json;
+    // Reports are indexed in place instead of building a JSON tree; the
+    // per-thread index keeps its capacity between packets
+    static thread_local kis_json_report device_json;
 
     try {
-        ss >> device_json;
+        device_json.parse(json->json_string);
 
         // Copy the JSON as the meta field for logging, if it's valid
         if (adsb->json_to_rtl(device_json, in_pack)) {
@@ -788,70 +855,30 @@ int kis_adsb_phy::cpr_mod(int a, int b) {
 }
 
 int kis_adsb_phy::cpr_nl(double lat) {
-    // Precomputed table from 1090-WP-9-14
-    //
+    // Precomputed table from 1090-WP-9-14; the number of longitude zones
+    // drops by one at each of these latitudes, from 59 at the equator to 1
+    // at the poles
+    static const double nl_lat[] = {
+        10.47047130, 14.82817437, 18.18626357, 21.02939493, 23.54504487,
+        25.82924707, 27.93898710, 29.91135686, 31.77209708, 33.53993436,
+        35.22899598, 36.85025108, 38.41241892, 39.92256684, 41.38651832,
+        42.80914012, 44.19454951, 45.54626723, 46.86733252, 48.16039128,
+        49.42776439, 50.67150166, 51.89342469, 53.09516153, 54.27817472,
+        55.44378444, 56.59318756, 57.72747354, 58.84763776, 59.95459277,
+        61.04917774, 62.13216659, 63.20427479, 64.26616523, 65.31845310,
+        66.36171008, 67.39646774, 68.42322022, 69.44242631, 70.45451075,
+        71.45986473, 72.45884545, 73.45177442, 74.43893416, 75.42056257,
+        76.39684391, 77.36789461, 78.33374083, 79.29428225, 80.24923213,
+        81.19801349, 82.13956981, 83.07199445, 83.99173563, 84.89166191,
+        85.75541621, 86.53536998, 87.00000000
+    };
+
+    static const auto nl_lat_end = nl_lat + (sizeof(nl_lat) / sizeof(double));
+
     if (lat < 0) 
         lat = -lat;
 
-    if (lat < 10.47047130) return 59;
-    if (lat < 14.82817437) return 58;
-    if (lat < 18.18626357) return 57;
-    if (lat < 21.02939493) return 56;
-    if (lat < 23.54504487) return 55;
-    if (lat < 25.82924707) return 54;
-    if (lat < 27.93898710) return 53;
-    if (lat < 29.91135686) return 52;
-    if (lat < 31.77209708) return 51;
-    if (lat < 33.53993436) return 50;
-    if (lat < 35.22899598) return 49;
-    if (lat < 36.85025108) return 48;
-    if (lat < 38.41241892) return 47;
-    if (lat < 39.92256684) return 46;
-    if (lat < 41.38651832) return 45;
-    if (lat < 42.80914012) return 44;
-    if (lat < 44.19454951) return 43;
-    if (lat < 45.54626723) return 42;
-    if (lat < 46.86733252) return 41;
-    if (lat < 48.16039128) return 40;
-    if (lat < 49.42776439) return 39;
-    if (lat < 50.67150166) return 38;
-    if (lat < 51.89342469) return 37;
-    if (lat < 53.09516153) return 36;
-    if (lat < 54.27817472) return 35;
-    if (lat < 55.44378444) return 34;
-    if (lat < 56.59318756) return 33;
-    if (lat < 57.72747354) return 32;
-    if (lat < 58.84763776) return 31;
-    if (lat < 59.95459277) return 30;
-    if (lat < 61.04917774) return 29;
-    if (lat < 62.13216659) return 28;
-    if (lat < 63.20427479) return 27;
-    if (lat < 64.26616523) return 26;
-    if (lat < 65.31845310) return 25;
-    if (lat < 66.36171008) return 24;
-    if (lat < 67.39646774) return 23;
-    if (lat < 68.42322022) return 22;
-    if (lat < 69.44242631) return 21;
-    if (lat < 70.45451075) return 20;
-    if (lat < 71.45986473) return 19;
-    if (lat < 72.45884545) return 18;
-    if (lat < 73.45177442) return 17;
-    if (lat < 74.43893416) return 16;
-    if (lat < 75.42056257) return 15;
-    if (lat < 76.39684391) return 14;
-    if (lat < 77.36789461) return 13;
-    if (lat < 78.33374083) return 12;
-    if (lat < 79.29428225) return 11;
-    if (lat < 80.24923213) return 10;
-    if (lat < 81.19801349) return 9;
-    if (lat < 82.13956981) return 8;
-    if (lat < 83.07199445) return 7;
-    if (lat < 83.99173563) return 6;
-    if (lat < 84.89166191) return 5;
-    if (lat < 85.75541621) return 4;
-    if (lat < 86.53536998) return 3;
-    if (lat < 87.00000000) return 2;
-    else return 1;
+    return 59 - (std::upper_bound(nl_lat, nl_lat_end, lat) - nl_lat);
 }
 
 int kis_adsb_phy::cpr_n(double lat, int odd) {
@@ -867,26 +894,24 @@ double kis_adsb_phy::cpr_dlon(double lat, int odd) {
     return 360.0 / cpr_n(lat, odd);
 }
 
-void kis_adsb_phy::decode_cpr(std::shared_ptr<adsb_tracked_adsb> adsb,
-        std::shared_ptr<kis_packet> packet) {
+void kis_adsb_phy::decode_cpr(std::shared_ptr<adsb_tracked_adsb> adsb) {
     /* This algorithm comes from:
      * http://www.lll.lu/~edward/edward/adsb/DecodingADSBposition.html.
      *
      *
      * A few remarks:
      * 1) 131072 is 2^17 since CPR latitude and longitude are encoded in 17 bits.
-     * 2) We assume that we always received the odd packet as last packet for
-     *    simplicity. This may provide a position that is less fresh of a few
-     *    seconds.
+     * 2) The position is resolved from whichever of the even and odd frames
+     *    arrived last.
      */
 
     const double dlat0 = 360.0 / 60;
     const double dlat1 = 360.0 / 59;
 
-    double lat0 = adsb->get_even_raw_lat();
-    double lat1 = adsb->get_odd_raw_lat();
-    double lon0 = adsb->get_even_raw_lon();
-    double lon1 = adsb->get_odd_raw_lon();
+    double lat0 = adsb->cpr_even.lat;
+    double lat1 = adsb->cpr_odd.lat;
+    double lon0 = adsb->cpr_even.lon;
+    double lon1 = adsb->cpr_odd.lon;
 
     int j = floor(((59 * lat0 - 60 * lat1) / 131072) + 0.5);
 
@@ -899,21 +924,24 @@ void kis_adsb_phy::decode_cpr(std::shared_ptr<adsb_tracked_adsb> adsb,
     if (rlat1 >= 270)
         rlat1 -= 360;
 
+    int nl0 = cpr_nl(rlat0);
+    int nl1 = cpr_nl(rlat1);
+
     // If they're not both in the same zone, fail
-    if (cpr_nl(rlat0) != cpr_nl(rlat1))
+    if (nl0 != nl1)
         return;
 
-    if (adsb->get_even_ts() > adsb->get_odd_ts()) {
+    if (adsb->cpr_even.ts_usec > adsb->cpr_odd.ts_usec) {
         int ni = cpr_n(rlat0, 0);
-        int m = floor((((lon0 * (cpr_nl(rlat0) - 1)) -
-                        (lon1 * cpr_nl(rlat0))) / 131072) + 0.5);
+        int m = floor((((lon0 * (nl0 - 1)) -
+                        (lon1 * nl0)) / 131072) + 0.5);
 
         adsb->lon = cpr_dlon(rlat0, 0) * (cpr_mod(m, ni) + lon0 / 131072);
         adsb->lat = rlat0;
     } else {
         int ni = cpr_n(rlat1, 1);
-        int m = floor((((lon0 * (cpr_nl(rlat1) - 1)) -
-                        (lon1 * cpr_nl(rlat1))) / 131072.0) + 0.5);
+        int m = floor((((lon0 * (nl1 - 1)) -
+                        (lon1 * nl1)) / 131072.0) + 0.5);
         adsb->lon = cpr_dlon(rlat1, 1) * (cpr_mod(m, ni) + lon1 / 131072);
         adsb->lat = rlat1;
     }
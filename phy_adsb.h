@@ -22,11 +22,15 @@
 
 #include "config.h"
 
+#include <atomic>
 
 #include "adsb_icao.h"
+#include "adsb_modes.h"
 #include "datasourcetracker.h"
 #include "devicetracker_component.h"
 #include "globalregistry.h"
+#include "kis_dissection_profile.h"
+#include "kis_json_report.h"
 #include "kis_net_beast_httpd.h"
 #include "phyhandler.h"
 #include "trackedelement.h"
@@ -74,14 +78,32 @@ public:
         update_location = false;
     }
 
+    adsb_tracked_adsb(const adsb_tracked_adsb *p) :
+        tracker_component{p} {
+        __ImportField(icao, p);
+        __ImportField(icao_record, p);
+        __ImportField(gsas, p);
+        __ImportField(callsign, p);
+        __ImportField(odd_raw_lat, p);
+        __ImportField(odd_raw_lon, p);
+        __ImportField(odd_ts, p);
+        __ImportField(even_raw_lat, p);
+        __ImportField(even_raw_lon, p);
+        __ImportField(even_ts, p);
+
+        lat = lon = alt = heading = speed = 0;
+        update_location = false;
+
+        reserve_fields(nullptr);
+    }
+
     virtual uint32_t get_signature() const override {
         return adler32_checksum("adsb_tracked_adsb");
     }
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>();
-        r->set_id(this->get_id());
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -126,6 +148,17 @@ protected:
     std::shared_ptr<tracker_element_double> even_raw_lon;
     std::shared_ptr<tracker_element_uint64> even_ts;
 
+    // Most recent even and odd CPR positions; frames are paired from these, the
+    // tracked raw fields above are only kept up to date for export
+    struct cpr_frame {
+        uint32_t lat;
+        uint32_t lon;
+        uint64_t ts_usec;
+    };
+
+    cpr_frame cpr_even{0, 0, 0};
+    cpr_frame cpr_odd{0, 0, 0};
+
     // Aggregated location turned into a packet location later
     double lat, lon, alt, heading, speed;
     bool update_location;
@@ -156,33 +189,52 @@ protected:
 
     int pack_comp_gps;
 
-    // Convert a JSON record to a RTL-based device key
-    mac_addr json_to_mac(Json::Value in_json);
+    // Convert an ICAO address to a RTL-based device key
+    mac_addr icao_to_mac(const std::string& in_icao);
+
+    // Fill a frame from a JSON report from an older datasource, return false
+    // if it's not a valid ADSB report
+    bool json_to_frame(const kis_json_report& in_json, adsb_modes_frame& frame);
 
     // convert to a device record & push into device tracker, return false
     // if we can't do anything with it
-    bool json_to_rtl(Json::Value in_json, std::shared_ptr<kis_packet> packet);
-
-    bool is_adsb(Json::Value json);
+    bool json_to_rtl(const kis_json_report& in_json, std::shared_ptr<kis_packet> packet);
+    bool frame_to_rtl(const adsb_modes_frame& frame, std::shared_ptr<kis_packet> packet,
+            const std::string& channel);
 
     std::shared_ptr<adsb_tracked_adsb> add_adsb(std::shared_ptr<kis_packet> packet, 
-            Json::Value json, std::shared_ptr<kis_tracked_device_base> rtlholder);
+            const adsb_modes_frame& frame, std::shared_ptr<kis_tracked_device_base> rtlholder);
+
+    // Raw Mode-S frame carried by a packet, from either a binary frame or the
+    // hex of a JSON report; empty if the packet has no ADSB frame
+    std::string packet_raw_frame(std::shared_ptr<kis_packet> packet);
 
     double f_to_c(double f);
 
-    int cpr_mod(int a, int b);
-    int cpr_nl(double lat);
-    int cpr_n(double lat, int odd);
-    double cpr_dlon(double lat, int odd);
-    void decode_cpr(std::shared_ptr<adsb_tracked_adsb> adsb, std::shared_ptr<kis_packet> packet);
+    static int cpr_mod(int a, int b);
+    static int cpr_nl(double lat);
+    static int cpr_n(double lat, int odd);
+    static double cpr_dlon(double lat, int odd);
+    void decode_cpr(std::shared_ptr<adsb_tracked_adsb> adsb);
 
     std::shared_ptr<packet_chain> packetchain;
     std::shared_ptr<entry_tracker> entrytracker;
     std::shared_ptr<device_tracker> devicetracker;
 
     int adsb_adsb_id;
+    
+    // Prototype device records are cloned from
+    std::shared_ptr<adsb_tracked_adsb> adsb_builder;
+
+    int pack_comp_common, pack_comp_json, pack_comp_meta, pack_comp_datasource,
+        pack_comp_linkframe;
+
+    // Are surveillance and Comm-B replies decoded, or only squitters; defaulted by
+    // the dissection profile
+    bool decode_surveillance;
 
-    int pack_comp_common, pack_comp_json, pack_comp_meta, pack_comp_datasource;
+    // Last time a bad frame was reported, so a bad feed can't flood the message bus
+    std::atomic<time_t> last_frame_error;
 
     std::shared_ptr<tracker_element_string> rtl_manuf;
 
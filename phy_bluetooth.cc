@@ -54,16 +54,20 @@ kis_bluetooth_phy::kis_bluetooth_phy(int in_phyid) :
                 tracker_element_factory<bluetooth_tracked_device>(),
                 "Bluetooth device");
 
-    packetchain->register_handler(&common_classifier_bluetooth, this, CHAINPOS_CLASSIFIER, -100);
-    packetchain->register_handler(&packet_tracker_bluetooth, this, CHAINPOS_TRACKER, -100);
-    packetchain->register_handler(&packet_bluetooth_scan_json_classifier, this, CHAINPOS_CLASSIFIER, -99);
-    
+    bluetooth_builder = std::make_shared<bluetooth_tracked_device>(bluetooth_device_entry_id);
+
     pack_comp_btdevice = packetchain->register_packet_component("BTDEVICE");
 	pack_comp_common = packetchain->register_packet_component("COMMON");
     pack_comp_l1info = packetchain->register_packet_component("RADIODATA");
     pack_comp_meta = packetchain->register_packet_component("METABLOB");
     pack_comp_json = packetchain->register_packet_component("JSON");
 
+    packetchain->register_handler(&common_classifier_bluetooth, this, CHAINPOS_CLASSIFIER, -100,
+            {}, pack_comp_btdevice);
+    packetchain->register_handler(&packet_tracker_bluetooth, this, CHAINPOS_TRACKER, -100);
+    packetchain->register_handler(&packet_bluetooth_scan_json_classifier, this, CHAINPOS_CLASSIFIER, -99,
+            {}, pack_comp_json);
+
     btdev_bredr = devicetracker->get_cached_devicetype("BR/EDR");
     btdev_btle = devicetracker->get_cached_devicetype("BTLE");
     btdev_bt = devicetracker->get_cached_devicetype("BT");
@@ -206,7 +210,7 @@ int kis_bluetooth_phy::packet_bluetooth_scan_json_classifier(CHAINCALL_PARMS) {
             _MSG_INFO(newdevstr.str());
 
             btdev_bluetooth = 
-                std::make_shared<bluetooth_tracked_device>(btphy->bluetooth_device_entry_id);
+                tracker_arena_make_shared<bluetooth_tracked_device>(btphy->bluetooth_builder.get());
 
             btdev->insert(btdev_bluetooth);
         }
@@ -281,7 +285,7 @@ int kis_bluetooth_phy::packet_tracker_bluetooth(CHAINCALL_PARMS) {
         _MSG(ss.str(), MSGFLAG_INFO);
 
         btdev =
-            std::make_shared<bluetooth_tracked_device>(btphy->bluetooth_device_entry_id);
+            tracker_arena_make_shared<bluetooth_tracked_device>(btphy->bluetooth_builder.get());
 
         basedev->insert(btdev);
     }
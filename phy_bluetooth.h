@@ -91,14 +91,26 @@ public:
         reserve_fields(e);
     }
 
+    bluetooth_tracked_device(const bluetooth_tracked_device *p) :
+        tracker_component{p} {
+        __ImportField(bt_device_type, p);
+        __ImportField(service_uuid_vec, p);
+        __ImportField(solicitation_uuid_vec, p);
+        __ImportField(scan_data_bytes, p);
+        __ImportField(service_data_bytes, p);
+        __ImportField(txpower, p);
+        __ImportField(pathloss, p);
+
+        reserve_fields(nullptr);
+    }
+
     virtual uint32_t get_signature() const override {
         return adler32_checksum("bluetooth_tracked_device");
     }
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>();
-        r->set_id(this->get_id());
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -185,6 +197,9 @@ protected:
     std::shared_ptr<device_tracker> devicetracker;
 
     int bluetooth_device_entry_id;
+    
+    // Prototype device records are cloned from
+    std::shared_ptr<bluetooth_tracked_device> bluetooth_builder;
 
 	// Device components
 	int dev_comp_bluetooth, dev_comp_common;
@@ -20,6 +20,7 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include <list>
 #include <map>
@@ -42,6 +43,7 @@
 
 #include "kaitai/kaitaistream.h"
 #include "bluetooth_parsers/btle.h"
+#include "xxhash.h"
 
 #ifndef KDLT_BLUETOOTH_LE_LL
 #define KDLT_BLUETOOTH_LE_LL        251
@@ -53,15 +55,26 @@
 
 class btle_packinfo : public packet_component {
 public:
-    btle_packinfo() { }
+    btle_packinfo() :
+        repeat{false},
+        txaddr_random{false} { }
 
     void reset() {
         btle_decode.reset();
+        repeat = false;
+        txaddr_random = false;
     }
 
     std::shared_ptr<bluetooth_btle> btle_decode;
+
+    // Repeat of the last advert from this address, which is not decoded
+    bool repeat;
+    bool txaddr_random;
 };
 
+#define BTLE_ADVERTISING_AA                     0x8E89BED6
+#define BTLE_HEADER_TXADD_RANDOM                (1 << 6)
+
 #define BTLE_ADVDATA_FLAGS                      0x01
 #define BTLE_ADVDATA_SERVICE_UUID_INCOMPLETE    0x02
 #define BTLE_ADVDATA_DEVICE_NAME                0x09
@@ -79,62 +92,59 @@ public:
  *           payload_len is the Length field from the BTLE PDU header
  *           crc_init as defined in the specifications
  *
- * This implementation operates on nibbles and is therefore
- * endian-neutral.
- *
- * Taken from the Wireshark implementation
+ * The CRC is computed a byte at a time in bit-reversed (LSB first) form, using
+ * the table of the reflected polynomial; the result is returned in the same form
+ * as the nibble-wise Wireshark implementation it replaces.
  */
 uint32_t kis_btle_phy::calc_btle_crc(uint32_t crc_init, const char *payload, size_t len) {
-    static const uint16_t btle_crc_next_state_flips[256] = {
-        0x0000, 0x32d8, 0x196c, 0x2bb4, 0x0cb6, 0x3e6e, 0x15da, 0x2702,
-        0x065b, 0x3483, 0x1f37, 0x2def, 0x0aed, 0x3835, 0x1381, 0x2159,
-        0x065b, 0x3483, 0x1f37, 0x2def, 0x0aed, 0x3835, 0x1381, 0x2159,
-        0x0000, 0x32d8, 0x196c, 0x2bb4, 0x0cb6, 0x3e6e, 0x15da, 0x2702,
-        0x0cb6, 0x3e6e, 0x15da, 0x2702, 0x0000, 0x32d8, 0x196c, 0x2bb4,
-        0x0aed, 0x3835, 0x1381, 0x2159, 0x065b, 0x3483, 0x1f37, 0x2def,
-        0x0aed, 0x3835, 0x1381, 0x2159, 0x065b, 0x3483, 0x1f37, 0x2def,
-        0x0cb6, 0x3e6e, 0x15da, 0x2702, 0x0000, 0x32d8, 0x196c, 0x2bb4,
-        0x196c, 0x2bb4, 0x0000, 0x32d8, 0x15da, 0x2702, 0x0cb6, 0x3e6e,
-        0x1f37, 0x2def, 0x065b, 0x3483, 0x1381, 0x2159, 0x0aed, 0x3835,
-        0x1f37, 0x2def, 0x065b, 0x3483, 0x1381, 0x2159, 0x0aed, 0x3835,
-        0x196c, 0x2bb4, 0x0000, 0x32d8, 0x15da, 0x2702, 0x0cb6, 0x3e6e,
-        0x15da, 0x2702, 0x0cb6, 0x3e6e, 0x196c, 0x2bb4, 0x0000, 0x32d8,
-        0x1381, 0x2159, 0x0aed, 0x3835, 0x1f37, 0x2def, 0x065b, 0x3483,
-        0x1381, 0x2159, 0x0aed, 0x3835, 0x1f37, 0x2def, 0x065b, 0x3483,
-        0x15da, 0x2702, 0x0cb6, 0x3e6e, 0x196c, 0x2bb4, 0x0000, 0x32d8,
-        0x32d8, 0x0000, 0x2bb4, 0x196c, 0x3e6e, 0x0cb6, 0x2702, 0x15da,
-        0x3483, 0x065b, 0x2def, 0x1f37, 0x3835, 0x0aed, 0x2159, 0x1381,
-        0x3483, 0x065b, 0x2def, 0x1f37, 0x3835, 0x0aed, 0x2159, 0x1381,
-        0x32d8, 0x0000, 0x2bb4, 0x196c, 0x3e6e, 0x0cb6, 0x2702, 0x15da,
-        0x3e6e, 0x0cb6, 0x2702, 0x15da, 0x32d8, 0x0000, 0x2bb4, 0x196c,
-        0x3835, 0x0aed, 0x2159, 0x1381, 0x3483, 0x065b, 0x2def, 0x1f37,
-        0x3835, 0x0aed, 0x2159, 0x1381, 0x3483, 0x065b, 0x2def, 0x1f37,
-        0x3e6e, 0x0cb6, 0x2702, 0x15da, 0x32d8, 0x0000, 0x2bb4, 0x196c,
-        0x2bb4, 0x196c, 0x32d8, 0x0000, 0x2702, 0x15da, 0x3e6e, 0x0cb6,
-        0x2def, 0x1f37, 0x3483, 0x065b, 0x2159, 0x1381, 0x3835, 0x0aed,
-        0x2def, 0x1f37, 0x3483, 0x065b, 0x2159, 0x1381, 0x3835, 0x0aed,
-        0x2bb4, 0x196c, 0x32d8, 0x0000, 0x2702, 0x15da, 0x3e6e, 0x0cb6,
-        0x2702, 0x15da, 0x3e6e, 0x0cb6, 0x2bb4, 0x196c, 0x32d8, 0x0000,
-        0x2159, 0x1381, 0x3835, 0x0aed, 0x2def, 0x1f37, 0x3483, 0x065b,
-        0x2159, 0x1381, 0x3835, 0x0aed, 0x2def, 0x1f37, 0x3483, 0x065b,
-        0x2702, 0x15da, 0x3e6e, 0x0cb6, 0x2bb4, 0x196c, 0x32d8, 0x0000
+    static const uint32_t btle_crc_reflected[256] = {
+        0x000000, 0x01b4c0, 0x036980, 0x02dd40, 0x06d300, 0x0767c0, 0x05ba80, 0x040e40,
+        0x0da600, 0x0c12c0, 0x0ecf80, 0x0f7b40, 0x0b7500, 0x0ac1c0, 0x081c80, 0x09a840,
+        0x1b4c00, 0x1af8c0, 0x182580, 0x199140, 0x1d9f00, 0x1c2bc0, 0x1ef680, 0x1f4240,
+        0x16ea00, 0x175ec0, 0x158380, 0x143740, 0x103900, 0x118dc0, 0x135080, 0x12e440,
+        0x369800, 0x372cc0, 0x35f180, 0x344540, 0x304b00, 0x31ffc0, 0x332280, 0x329640,
+        0x3b3e00, 0x3a8ac0, 0x385780, 0x39e340, 0x3ded00, 0x3c59c0, 0x3e8480, 0x3f3040,
+        0x2dd400, 0x2c60c0, 0x2ebd80, 0x2f0940, 0x2b0700, 0x2ab3c0, 0x286e80, 0x29da40,
+        0x207200, 0x21c6c0, 0x231b80, 0x22af40, 0x26a100, 0x2715c0, 0x25c880, 0x247c40,
+        0x6d3000, 0x6c84c0, 0x6e5980, 0x6fed40, 0x6be300, 0x6a57c0, 0x688a80, 0x693e40,
+        0x609600, 0x6122c0, 0x63ff80, 0x624b40, 0x664500, 0x67f1c0, 0x652c80, 0x649840,
+        0x767c00, 0x77c8c0, 0x751580, 0x74a140, 0x70af00, 0x711bc0, 0x73c680, 0x727240,
+        0x7bda00, 0x7a6ec0, 0x78b380, 0x790740, 0x7d0900, 0x7cbdc0, 0x7e6080, 0x7fd440,
+        0x5ba800, 0x5a1cc0, 0x58c180, 0x597540, 0x5d7b00, 0x5ccfc0, 0x5e1280, 0x5fa640,
+        0x560e00, 0x57bac0, 0x556780, 0x54d340, 0x50dd00, 0x5169c0, 0x53b480, 0x520040,
+        0x40e400, 0x4150c0, 0x438d80, 0x423940, 0x463700, 0x4783c0, 0x455e80, 0x44ea40,
+        0x4d4200, 0x4cf6c0, 0x4e2b80, 0x4f9f40, 0x4b9100, 0x4a25c0, 0x48f880, 0x494c40,
+        0xda6000, 0xdbd4c0, 0xd90980, 0xd8bd40, 0xdcb300, 0xdd07c0, 0xdfda80, 0xde6e40,
+        0xd7c600, 0xd672c0, 0xd4af80, 0xd51b40, 0xd11500, 0xd0a1c0, 0xd27c80, 0xd3c840,
+        0xc12c00, 0xc098c0, 0xc24580, 0xc3f140, 0xc7ff00, 0xc64bc0, 0xc49680, 0xc52240,
+        0xcc8a00, 0xcd3ec0, 0xcfe380, 0xce5740, 0xca5900, 0xcbedc0, 0xc93080, 0xc88440,
+        0xecf800, 0xed4cc0, 0xef9180, 0xee2540, 0xea2b00, 0xeb9fc0, 0xe94280, 0xe8f640,
+        0xe15e00, 0xe0eac0, 0xe23780, 0xe38340, 0xe78d00, 0xe639c0, 0xe4e480, 0xe55040,
+        0xf7b400, 0xf600c0, 0xf4dd80, 0xf56940, 0xf16700, 0xf0d3c0, 0xf20e80, 0xf3ba40,
+        0xfa1200, 0xfba6c0, 0xf97b80, 0xf8cf40, 0xfcc100, 0xfd75c0, 0xffa880, 0xfe1c40,
+        0xb75000, 0xb6e4c0, 0xb43980, 0xb58d40, 0xb18300, 0xb037c0, 0xb2ea80, 0xb35e40,
+        0xbaf600, 0xbb42c0, 0xb99f80, 0xb82b40, 0xbc2500, 0xbd91c0, 0xbf4c80, 0xbef840,
+        0xac1c00, 0xada8c0, 0xaf7580, 0xaec140, 0xaacf00, 0xab7bc0, 0xa9a680, 0xa81240,
+        0xa1ba00, 0xa00ec0, 0xa2d380, 0xa36740, 0xa76900, 0xa6ddc0, 0xa40080, 0xa5b440,
+        0x81c800, 0x807cc0, 0x82a180, 0x831540, 0x871b00, 0x86afc0, 0x847280, 0x85c640,
+        0x8c6e00, 0x8ddac0, 0x8f0780, 0x8eb340, 0x8abd00, 0x8b09c0, 0x89d480, 0x886040,
+        0x9a8400, 0x9b30c0, 0x99ed80, 0x985940, 0x9c5700, 0x9de3c0, 0x9f3e80, 0x9e8a40,
+        0x972200, 0x9696c0, 0x944b80, 0x95ff40, 0x91f100, 0x9045c0, 0x929880, 0x932c40,
     };
 
-    uint8_t offset = 4;
-    uint32_t state = crc_init;
+    // Reversing each byte of a byte-swapped value reverses all 24 bits
+    auto reverse_24 = [](uint32_t v) -> uint32_t {
+        return reverse_bits(((v & 0xFF) << 16) | (v & 0xFF00) | ((v >> 16) & 0xFF));
+    };
 
-    for (size_t pos = offset; pos < len; pos++) {
-        uint8_t byte = payload[pos];
-        uint8_t nibble = (byte & 0xF);
-        uint8_t byte_index = ((state >> 16) & 0xF0) | nibble;
+    uint8_t offset = 4;
+    uint32_t state = reverse_24(crc_init & 0xFFFFFF);
+    auto data = reinterpret_cast<const uint8_t *>(payload);
 
-        state = ((state << 4) ^ btle_crc_next_state_flips[byte_index]) & 0xFFFFFF;
-        nibble = ((byte >> 4) & 0xF);
-        byte_index = ((state >> 16) & 0xF0) | nibble;
-        state = ((state << 4) ^ btle_crc_next_state_flips[byte_index]) & 0xFFFFFF;
-    }
+    for (size_t pos = offset; pos < len; pos++)
+        state = (state >> 8) ^ btle_crc_reflected[(state ^ data[pos]) & 0xFF];
 
-    return state;
+    return reverse_24(state);
 }
 
 /*
@@ -165,6 +175,67 @@ uint32_t kis_btle_phy::reverse_bits(const uint32_t val) {
     return retval;
 }
 
+/*
+ * Whitening is an XOR with the output of the x^7 + x^4 + 1 LFSR seeded from
+ * the channel index (BT spec, Vol 6, Part B, Section 3.2); the sequence for
+ * each channel is generated once, so dewhitening is a plain XOR of the frame.
+ */
+void kis_btle_phy::dewhiten(unsigned int channel, const char *in_data, char *out_data, size_t len) {
+    // Longest PDU header, payload, and CRC
+    const size_t max_whitened = 2 + 255 + 3;
+
+    struct whitening_table {
+        uint8_t seq[40][max_whitened];
+
+        whitening_table() {
+            for (unsigned int c = 0; c < 40; c++) {
+                // Position 0 of the LFSR is set to 1 and positions 1-6 hold the
+                // channel index, MSB first; this keeps the register bit-reversed
+                uint8_t lfsr = 0;
+
+                for (unsigned int b = 0; b < 6; b++) {
+                    if (c & (1 << b))
+                        lfsr |= 1 << (7 - b);
+                }
+
+                lfsr |= 0x02;
+
+                for (size_t i = 0; i < max_whitened; i++) {
+                    uint8_t w = 0;
+
+                    for (unsigned int b = 0; b < 8; b++) {
+                        if (lfsr & 0x80) {
+                            lfsr ^= 0x11;
+                            w |= 1 << b;
+                        }
+
+                        lfsr <<= 1;
+                    }
+
+                    seq[c][i] = w;
+                }
+            }
+        }
+    };
+
+    static const whitening_table table;
+
+    auto in = reinterpret_cast<const uint8_t *>(in_data);
+    auto out = reinterpret_cast<uint8_t *>(out_data);
+
+    // Anything past the longest frame, or on an unknown channel, is copied as-is
+    size_t wlen = channel < 40 ? std::min(len, max_whitened) : 0;
+
+    if (wlen > 0) {
+        const auto seq = table.seq[channel];
+
+        for (size_t i = 0; i < wlen; i++)
+            out[i] = in[i] ^ seq[i];
+    }
+
+    if (len > wlen && in != out)
+        memmove(out + wlen, in + wlen, len - wlen);
+}
 
 kis_btle_phy::kis_btle_phy(int in_phyid) :
     kis_phy_handler(in_phyid) {
@@ -193,14 +264,18 @@ kis_btle_phy::kis_btle_phy(int in_phyid) :
                 "BleedingTooth attacks use over-sized advertisement packets.",
                 phyid);
 
-    packetchain->register_handler(&dissector, this, CHAINPOS_LLCDISSECT, -100);
-    packetchain->register_handler(&common_classifier, this, CHAINPOS_CLASSIFIER, -100);
+    packetchain->register_handler(&dissector, this, CHAINPOS_LLCDISSECT, -100,
+            {KDLT_BLUETOOTH_LE_LL});
+    packetchain->register_handler(&common_classifier, this, CHAINPOS_CLASSIFIER, -100,
+            {}, pack_comp_btle);
 
     btle_device_id = 
         entrytracker->register_field("btle.device",
                 tracker_element_factory<btle_tracked_device>(),
                 "BTLE device");
 
+    btle_builder = std::make_shared<btle_tracked_device>(btle_device_id);
+
     btle_uuid_id = 
         entrytracker->register_field("btle.common.uuid_vendor",
                 tracker_element_factory<tracker_element_string>(),
@@ -212,6 +287,17 @@ kis_btle_phy::kis_btle_phy(int in_phyid) :
     if (ignore_random)
         _MSG_INFO("Ignoring BTLE devices with random MAC addresses");
 
+    // Survey deployments don't look for exploits
+    check_advert_length =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("btle_check_advert_length",
+                fetch_dissection_profile("btle") != kis_dissection_profile::survey);
+
+    advert_mutex.set_name("kis_btle_phy advert_cache");
+
+    advert_window_usec = 
+        Globalreg::globalreg->kismet_config->fetch_opt_as<double>("btle_dedupe_window", 1) * 1000000;
+    advert_last_purge = 0;
+
     // Register js module for UI
     auto httpregistry = Globalreg::fetch_mandatory_global_as<kis_httpd_registry>();
     httpregistry->register_js_module("kismet_ui_btle", "js/kismet.ui.btle.js");
@@ -222,6 +308,61 @@ kis_btle_phy::~kis_btle_phy() {
     packetchain->remove_handler(&dissector, CHAINPOS_LLCDISSECT);
 }
 
+bool kis_btle_phy::advert_is_repeat(std::shared_ptr<kis_packet> in_pack,
+        std::shared_ptr<kis_datachunk> packdata) {
+    // Advertising access address, header, address, and CRC
+    if (packdata->length() < 4 + 2 + 6 + 3)
+        return false;
+
+    auto data = reinterpret_cast<const uint8_t *>(packdata->data());
+
+    uint32_t aa = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+
+    if (aa != BTLE_ADVERTISING_AA)
+        return false;
+
+    // Key by the address and address type, and hash the PDU without the CRC
+    uint64_t key = data[4] & BTLE_HEADER_TXADD_RANDOM;
+
+    for (unsigned int i = 0; i < 6; i++)
+        key = (key << 8) | data[6 + i];
+
+    auto hash = XXH32(data + 4, packdata->length() - 4 - 3, 0);
+    uint64_t ts_usec = (uint64_t) in_pack->ts.tv_sec * 1000000 + in_pack->ts.tv_usec;
+
+    kis_lock_guard<kis_mutex> lk(advert_mutex, "btle advert_is_repeat");
+
+    // Drop expired records periodically so random addresses don't accumulate
+    if (in_pack->ts.tv_sec - advert_last_purge > 60) {
+        advert_last_purge = in_pack->ts.tv_sec;
+
+        for (auto i = advert_cache.begin(); i != advert_cache.end(); ) {
+            if (ts_usec - i->second.ts_usec > advert_window_usec)
+                i = advert_cache.erase(i);
+            else
+                ++i;
+        }
+    }
+
+    auto ai = advert_cache.find(key);
+
+    if (ai == advert_cache.end()) {
+        advert_cache.emplace(key, advert_record{hash, ts_usec});
+        return false;
+    }
+
+    // The window restarts with every advert which is parsed, so a device repeating one
+    // advert is still fully updated once per window
+    if (ai->second.hash == hash && ts_usec >= ai->second.ts_usec &&
+            ts_usec - ai->second.ts_usec < advert_window_usec)
+        return true;
+
+    ai->second.hash = hash;
+    ai->second.ts_usec = ts_usec;
+
+    return false;
+}
+
 bool kis_btle_phy::device_is_a(std::shared_ptr<kis_tracked_device_base> dev) {
     return (dev->get_sub_as<btle_tracked_device>(btle_device_id) != nullptr);
 }
@@ -272,10 +413,6 @@ int kis_btle_phy::dissector(CHAINCALL_PARMS) {
         }
     }
 
-    membuf btle_membuf((char *) packdata->data(), (char *) &packdata->data()[packdata->length()]);
-    std::istream btle_istream(&btle_membuf);
-    auto btle_stream = std::make_shared<kaitai::kstream>(&btle_istream);
-
     common = mphy->packetchain->new_packet_component<kis_common_info>();
     common->phyid = mphy->fetch_phy_id();
     common->basic_crypt_set = crypt_none;
@@ -283,6 +420,31 @@ int kis_btle_phy::dissector(CHAINCALL_PARMS) {
 
     auto btle_info = mphy->packetchain->new_packet_component<btle_packinfo>();
 
+    // Repeated adverts only need the address for the classifier to update the device
+    if (mphy->advert_window_usec > 0 && mphy->advert_is_repeat(in_pack, packdata)) {
+        auto data = reinterpret_cast<const uint8_t *>(packdata->data());
+        uint8_t addr[6];
+
+        // BTLE stores the MAC address backwards
+        for (unsigned int i = 0; i < 6; i++)
+            addr[i] = data[6 + 5 - i];
+
+        common->source = mac_addr(addr, 6);
+        common->transmitter = common->source;
+
+        btle_info->repeat = true;
+        btle_info->txaddr_random = (data[4] & BTLE_HEADER_TXADD_RANDOM) != 0;
+
+        in_pack->insert(mphy->pack_comp_common, common);
+        in_pack->insert(mphy->pack_comp_btle, btle_info);
+
+        return 0;
+    }
+
+    membuf btle_membuf((char *) packdata->data(), (char *) &packdata->data()[packdata->length()]);
+    std::istream btle_istream(&btle_membuf);
+    auto btle_stream = std::make_shared<kaitai::kstream>(&btle_istream);
+
     try {
         auto btle = std::make_shared<bluetooth_btle>();
         btle->parse(btle_stream);
@@ -293,6 +455,7 @@ int kis_btle_phy::dissector(CHAINCALL_PARMS) {
         // up from there automatically
 
         btle_info->btle_decode = btle;
+        btle_info->txaddr_random = btle->is_txaddr_random();
 
         in_pack->insert(mphy->pack_comp_common, common);
         in_pack->insert(mphy->pack_comp_btle, btle_info);
@@ -303,6 +466,61 @@ int kis_btle_phy::dissector(CHAINCALL_PARMS) {
     return 0;
 }
 
+// Features of an advert which stay the same when a device changes address: the PDU type,
+// the order, types, and lengths of the AD structures, and the contents of those which
+// describe the kind of device rather than carry changing state
+static std::vector<uint64_t> btle_group_features(const std::shared_ptr<bluetooth_btle>& in_btle) {
+    std::vector<uint64_t> features;
+
+    uint8_t pdu_type = in_btle->pdu_type();
+    uint64_t order = device_group_feature(0x300, &pdu_type, 1);
+
+    features.push_back(order);
+
+    for (const auto& ad : *in_btle->advertised_data()) {
+        uint8_t ad_type = ad->type();
+        uint8_t ad_len = ad->length();
+        auto data = ad->data();
+
+        order = device_group_feature(order, &ad_type, 1);
+
+        switch (ad_type) {
+            case BTLE_ADVDATA_FLAGS:
+            case 0x02:
+            case 0x03:
+            case 0x04:
+            case 0x05:
+            case 0x06:
+            case 0x07:
+            case 0x08:
+            case 0x09:
+            case 0x0A:
+            case 0x19:
+                // Flags, service lists, names, tx power, and appearance
+                features.push_back(device_group_feature(ad_type, data.data(), data.length()));
+                break;
+            case 0x16:
+                // Service data; the service but not its changing payload
+                features.push_back(device_group_feature(ad_type, data.data(),
+                            std::min<size_t>(2, data.length())) ^ ad_len);
+                break;
+            case 0xFF:
+                // Manufacturer data; the company and the first byte after it, which
+                // is usually the kind of message, but not the payload
+                features.push_back(device_group_feature(ad_type, data.data(),
+                            std::min<size_t>(3, data.length())) ^ ad_len);
+                break;
+            default:
+                features.push_back(device_group_feature(ad_type, &ad_len, 1));
+                break;
+        }
+    }
+
+    features.push_back(device_group_feature(0x301, &order, sizeof(order)));
+
+    return features;
+}
+
 int kis_btle_phy::common_classifier(CHAINCALL_PARMS) {
     auto mphy = static_cast<kis_btle_phy *>(auxdata);
 
@@ -317,13 +535,38 @@ int kis_btle_phy::common_classifier(CHAINCALL_PARMS) {
     if (common == nullptr)
         return 0;
 
-    if (btle_info->btle_decode == nullptr)
+    if (btle_info->btle_decode == nullptr && !btle_info->repeat)
         return 0;
 
     // Drop randoms 
-    if (btle_info->btle_decode->is_txaddr_random() && mphy->ignore_random)
+    if (btle_info->txaddr_random && mphy->ignore_random)
         return 0;
 
+    // Group them by the structure of their adverts
+    uint64_t group = 0;
+
+    if (btle_info->txaddr_random && btle_info->btle_decode != nullptr &&
+            mphy->devicetracker->groups_phy(mphy) &&
+            mphy->devicetracker->group_device(mphy, common->source,
+                btle_group_features(btle_info->btle_decode), in_pack, group))
+        return 1;
+
+    // Or count them without tracking them
+    if (btle_info->txaddr_random &&
+            mphy->devicetracker->sketch_device(mphy, common->source, in_pack))
+        return 1;
+
+    // Repeated adverts have nothing new to record beyond the signal and counts
+    if (btle_info->repeat) {
+        mphy->devicetracker->update_common_device(common,
+                common->source, mphy, in_pack,
+                (UCD_UPDATE_SIGNAL | UCD_UPDATE_FREQUENCIES |
+                 UCD_UPDATE_LOCATION | UCD_UPDATE_SEENBY | UCD_UPDATE_EXISTING_ONLY |
+                 (in_pack->duplicate ? 0 : UCD_UPDATE_PACKETS)),
+                "BTLE Device");
+        return 1;
+    }
+
     if (in_pack->duplicate) {
         auto device = 
             mphy->devicetracker->update_common_device(common,
@@ -345,6 +588,8 @@ int kis_btle_phy::common_classifier(CHAINCALL_PARMS) {
                  UCD_UPDATE_SEENBY | UCD_UPDATE_ENCRYPTION),
                 "BTLE Device");
 
+    mphy->devicetracker->set_device_group(device, group);
+
     kis_lock_guard<kis_mutex> lk(mphy->devicetracker->get_devicelist_mutex(), "btle_common_classifier");
 
     auto new_dev = false;
@@ -353,7 +598,7 @@ int kis_btle_phy::common_classifier(CHAINCALL_PARMS) {
         device->get_sub_as<btle_tracked_device>(mphy->btle_device_id);
 
     if (btle_dev == nullptr) {
-        btle_dev = std::make_shared<btle_tracked_device>(mphy->btle_device_id);
+        btle_dev = tracker_arena_make_shared<btle_tracked_device>(mphy->btle_builder.get());
         device->insert(btle_dev);
 
         new_dev = true;
@@ -363,8 +608,9 @@ int kis_btle_phy::common_classifier(CHAINCALL_PARMS) {
         device->set_manuf(Globalreg::globalreg->manufdb->get_random_manuf());
 
     for (auto ad : *btle_info->btle_decode->advertised_data()) {
-        if (btle_info->btle_decode->pdu_type() == btle_info->btle_decode->pdu_adv_ind() ||
-                btle_info->btle_decode->pdu_type() == btle_info->btle_decode->pdu_adv_scan_ind()) {
+        if (mphy->check_advert_length &&
+                (btle_info->btle_decode->pdu_type() == btle_info->btle_decode->pdu_adv_ind() ||
+                 btle_info->btle_decode->pdu_type() == btle_info->btle_decode->pdu_adv_scan_ind())) {
             if (ad->length() > 31) {
                 auto al = fmt::format("Saw a BTLE advertisement packet with an advertised content "
                         "over 31 bytes; this may indicate a BleedingTooth style attack on the "
@@ -26,6 +26,7 @@
 #include <time.h>
 #include <list>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <algorithm>
 #include <string>
@@ -42,6 +43,7 @@
 
 #include "devicetracker.h"
 #include "devicetracker_component.h"
+#include "kis_dissection_profile.h"
 
 class btle_tracked_advertised_service : public tracker_component {
 public:
@@ -109,14 +111,24 @@ public:
         reserve_fields(e);
     }
 
+    btle_tracked_device(const btle_tracked_device *p) :
+        tracker_component{p} {
+        __ImportField(le_limited_discoverable, p);
+        __ImportField(le_general_discoverable, p);
+        __ImportField(br_edr_unsupported, p);
+        __ImportField(simultaneous_br_edr_controller, p);
+        __ImportField(simultaneous_br_edr_host, p);
+
+        reserve_fields(nullptr);
+    }
+
     virtual uint32_t get_signature() const override {
         return adler32_checksum("btle_tracked_device");
     }
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>();
-        r->set_id(this->get_id());
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -173,6 +185,11 @@ public:
     static uint32_t calc_btle_crc(uint32_t crc_init, const char *data, size_t len);
     static uint32_t reverse_bits(const uint32_t val);
 
+    // Dewhiten the PDU and CRC of a frame received on a BTLE channel index (0-39);
+    // the access address is not whitened and must not be included.  in_data and
+    // out_data may be the same buffer
+    static void dewhiten(unsigned int channel, const char *in_data, char *out_data, size_t len);
+
     virtual bool device_is_a(std::shared_ptr<kis_tracked_device_base> dev) override;
 
 protected:
@@ -184,12 +201,33 @@ protected:
     int pack_comp_common, pack_comp_linkframe, pack_comp_decap, pack_comp_btle;
 
     int btle_device_id, btle_uuid_id;
+    
+    // Prototype device records are cloned from
+    std::shared_ptr<btle_tracked_device> btle_builder;
 
     std::unordered_map<uint16_t, std::shared_ptr<tracker_element_string>> btle_uuid_cache;
 
     bool ignore_random;
 
     int alert_bleedingtooth_ref;
+
+    // Are advertisements checked for over-sized content; defaulted by the
+    // dissection profile
+    bool check_advert_length;
+
+    // Hash of the last advert from each advertising address; adverts repeating it
+    // within btle_dedupe_window are counted without being parsed again
+    struct advert_record {
+        uint32_t hash;
+        uint64_t ts_usec;
+    };
+
+    kis_mutex advert_mutex;
+    std::unordered_map<uint64_t, advert_record> advert_cache;
+    uint64_t advert_window_usec;
+    time_t advert_last_purge;
+
+    bool advert_is_repeat(std::shared_ptr<kis_packet> in_pack, std::shared_ptr<kis_datachunk> packdata);
 };
 
 #endif
@@ -51,6 +51,8 @@ kis_meter_phy::kis_meter_phy(int in_phyid) :
                 tracker_element_factory<tracked_meter>(),
                 "RF Meter");
 
+    meter_builder = std::make_shared<tracked_meter>(tracked_meter_id);
+
     // Make the manuf string
     meter_manuf = Globalreg::globalreg->manufdb->make_manuf("RF METER");
 
@@ -58,7 +60,7 @@ kis_meter_phy::kis_meter_phy(int in_phyid) :
     auto httpregistry = Globalreg::fetch_mandatory_global_as<kis_httpd_registry>();
     httpregistry->register_js_module("kismet_ui_meter", "js/kismet.ui.meter.js");
 
-	packetchain->register_handler(&PacketHandler, this, CHAINPOS_CLASSIFIER, -100);
+	packetchain->register_handler(&PacketHandler, this, CHAINPOS_CLASSIFIER, -100, {}, pack_comp_json);
 }
 
 kis_meter_phy::~kis_meter_phy() {
@@ -66,7 +68,7 @@ kis_meter_phy::~kis_meter_phy() {
 }
 
 
-mac_addr kis_meter_phy::json_to_mac(Json::Value json) {
+mac_addr kis_meter_phy::json_to_mac(const kis_json_report& json) {
     // Derive a mac addr from the model and device id data
     //
     // We turn the model string into 4 bytes using the adler32 checksum,
@@ -95,7 +97,7 @@ mac_addr kis_meter_phy::json_to_mac(Json::Value json) {
     return mac_addr(bytes, 6);
 }
 
-bool kis_meter_phy::rtlamr_json_to_phy(Json::Value json, std::shared_ptr<kis_packet> packet) {
+bool kis_meter_phy::rtlamr_json_to_phy(const kis_json_report& json, std::shared_ptr<kis_packet> packet) {
     std::string err;
     std::string v;
 
@@ -146,7 +148,7 @@ bool kis_meter_phy::rtlamr_json_to_phy(Json::Value json, std::shared_ptr<kis_pac
 
     if (meterdev == nullptr) {
         meterdev = 
-            std::make_shared<tracked_meter>(tracked_meter_id);
+            tracker_arena_make_shared<tracked_meter>(meter_builder.get());
 
         basedev->set_manuf(meter_manuf);
 
@@ -210,11 +212,10 @@ int kis_meter_phy::PacketHandler(CHAINCALL_PARMS) {
         return 0;
 
     if (json->type == "RTLamr") {
-        std::stringstream ss(json->json_string);
-        Json::Value device_json;
+        static thread_local kis_json_report device_json;
 
         try {
-            ss >> device_json;
+            device_json.parse(json->json_string);
 
             if (phy->rtlamr_json_to_phy(device_json, in_pack)) {
                 auto adata = in_pack->fetch_or_add<packet_metablob>(phy->pack_comp_meta);
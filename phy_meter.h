@@ -22,6 +22,7 @@
 
 #include "config.h"
 #include "globalregistry.h"
+#include "kis_json_report.h"
 #include "trackedelement.h"
 #include "devicetracker_component.h"
 #include "phyhandler.h"
@@ -111,14 +112,26 @@ public:
         reserve_fields(e);
     }
 
+    tracked_meter(const tracked_meter *p) :
+        tracker_component{p} {
+        __ImportField(meter_id, p);
+        __ImportField(meter_type, p);
+        __ImportField(meter_type_code, p);
+        __ImportField(phy_tamper_flags, p);
+        __ImportField(endpoint_tamper_flags, p);
+        __ImportField(consumption, p);
+        __ImportField(consumption_rrd, p);
+
+        reserve_fields(nullptr);
+    }
+
     virtual uint32_t get_signature() const override {
         return adler32_checksum("tracked_meter");
     }
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>();
-        r->set_id(this->get_id());
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -176,15 +189,15 @@ public:
 
 protected:
     // Convert a JSON record to a device key
-    mac_addr json_to_mac(Json::Value in_json);
+    mac_addr json_to_mac(const kis_json_report& in_json);
 
     // convert to a device record & push into device tracker, return false
     // if we can't do anything with it
-    bool rtlamr_json_to_phy(Json::Value in_json, std::shared_ptr<kis_packet> packet);
+    bool rtlamr_json_to_phy(const kis_json_report& in_json, std::shared_ptr<kis_packet> packet);
 
-    bool is_amr_meter(Json::Value json);
+    bool is_amr_meter(const kis_json_report& json);
 
-    void add_amr_meter(Json::Value json, std::shared_ptr<kis_tracked_device_base> phyholder);
+    void add_amr_meter(const kis_json_report& json, std::shared_ptr<kis_tracked_device_base> phyholder);
 
 protected:
     std::shared_ptr<packet_chain> packetchain;
@@ -192,6 +205,9 @@ protected:
     std::shared_ptr<device_tracker> devicetracker;
 
     int tracked_meter_id;
+    
+    // Prototype device records are cloned from
+    std::shared_ptr<tracked_meter> meter_builder;
 
     int pack_comp_common, pack_comp_json, pack_comp_meta, pack_comp_radiodata;
 
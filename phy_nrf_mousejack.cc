@@ -73,8 +73,10 @@ Kis_Mousejack_Phy::Kis_Mousejack_Phy(int in_phyid) :
     mj_manuf_microsoft = Globalreg::globalreg->manufdb->make_manuf("Microsoft");
     mj_manuf_nrf = Globalreg::globalreg->manufdb->make_manuf("nRF/Mousejack HID");
 
-    packetchain->register_handler(&DissectorMousejack, this, CHAINPOS_LLCDISSECT, -100);
-    packetchain->register_handler(&CommonClassifierMousejack, this, CHAINPOS_CLASSIFIER, -100);
+    packetchain->register_handler(&DissectorMousejack, this, CHAINPOS_LLCDISSECT, -100,
+            {static_cast<unsigned int>(dlt)});
+    packetchain->register_handler(&CommonClassifierMousejack, this, CHAINPOS_CLASSIFIER, -100,
+            {static_cast<unsigned int>(dlt)});
 }
 
 Kis_Mousejack_Phy::~Kis_Mousejack_Phy() {
@@ -40,7 +40,7 @@ kis_radiation_phy::kis_radiation_phy(int in_phyid) :
     pack_comp_meta =
         packetchain->register_packet_component("METABLOB");
 
-	packetchain->register_handler(&packet_handler, this, CHAINPOS_CLASSIFIER, -100);
+	packetchain->register_handler(&packet_handler, this, CHAINPOS_CLASSIFIER, -100, {}, pack_comp_json);
 }
 
 kis_radiation_phy::~kis_radiation_phy() {
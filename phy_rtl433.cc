@@ -94,7 +94,7 @@ Kis_RTL433_Phy::Kis_RTL433_Phy(int in_phyid) :
         Globalreg::fetch_mandatory_global_as<kis_httpd_registry>();
     httpregistry->register_js_module("kismet_ui_rtl433", "js/kismet.ui.rtl433.js");
 
-	packetchain->register_handler(&PacketHandler, this, CHAINPOS_CLASSIFIER, -100);
+	packetchain->register_handler(&PacketHandler, this, CHAINPOS_CLASSIFIER, -100, {}, pack_comp_json);
 }
 
 Kis_RTL433_Phy::~Kis_RTL433_Phy() {
@@ -105,7 +105,7 @@ double Kis_RTL433_Phy::f_to_c(double f) {
     return (f - 32) / (double) 1.8f;
 }
 
-mac_addr Kis_RTL433_Phy::json_to_mac(Json::Value json) {
+mac_addr Kis_RTL433_Phy::json_to_mac(const kis_json_report& json) {
     // Derive a mac addr from the model and device id data
     //
     // We turn the model string into 4 bytes using the adler32 checksum,
@@ -122,7 +122,7 @@ mac_addr Kis_RTL433_Phy::json_to_mac(Json::Value json) {
     std::string smodel = "unk";
 
     if (json.isMember("model")) {
-        Json::Value m = json["model"];
+        auto m = json["model"];
         if (m.isString()) {
             smodel = m.asString();
         }
@@ -132,7 +132,7 @@ mac_addr Kis_RTL433_Phy::json_to_mac(Json::Value json) {
 
     bool set_model = false;
     if (json.isMember("id")) {
-        Json::Value i = json["id"];
+        auto i = json["id"];
         if (i.isNumeric()) {
             *model = kis_hton16((uint16_t) i.asUInt());
             set_model = true;
@@ -147,7 +147,7 @@ mac_addr Kis_RTL433_Phy::json_to_mac(Json::Value json) {
     }
 
     if (json.isMember("from_id")) {
-        Json::Value i = json["from_id"];
+        auto i = json["from_id"];
         if (i.isString()) {
             smodel = i.asString();
             *checksum = adler32_checksum(smodel.c_str(), smodel.length());
@@ -158,7 +158,7 @@ mac_addr Kis_RTL433_Phy::json_to_mac(Json::Value json) {
     }
 
     if (!set_model && json.isMember("device")) {
-        Json::Value d = json["device"];
+        auto d = json["device"];
         if (d.isNumeric()) {
             *model = kis_hton16((uint16_t) d.asUInt());
             set_model = true;
@@ -175,7 +175,7 @@ mac_addr Kis_RTL433_Phy::json_to_mac(Json::Value json) {
     return mac_addr(bytes, 6);
 }
 
-bool Kis_RTL433_Phy::json_to_rtl(Json::Value json, std::shared_ptr<kis_packet> packet) {
+bool Kis_RTL433_Phy::json_to_rtl(const kis_json_report& json, std::shared_ptr<kis_packet> packet) {
     std::string err;
     std::string v;
 
@@ -199,7 +199,7 @@ bool Kis_RTL433_Phy::json_to_rtl(Json::Value json, std::shared_ptr<kis_packet> p
 
     // If this json record has a channel
     if (json.isMember("channel")) {
-        Json::Value c = json["channel"];
+        auto c = json["channel"];
         if (c.isNumeric()) {
             common->channel = int_to_string(c.asInt());
         } else if (c.isString()) {
@@ -251,7 +251,7 @@ bool Kis_RTL433_Phy::json_to_rtl(Json::Value json, std::shared_ptr<kis_packet> p
 
         bool set_id = false;
         if (json.isMember("id")) {
-            Json::Value id_j = json["id"];
+            auto id_j = json["id"];
             if (id_j.isNumeric()) {
                 std::stringstream ss;
                 ss << id_j.asUInt64();
@@ -264,7 +264,7 @@ bool Kis_RTL433_Phy::json_to_rtl(Json::Value json, std::shared_ptr<kis_packet> p
         }
 
         if (!set_id && json.isMember("device")) {
-            Json::Value device_j = json["device"];
+            auto device_j = json["device"];
             if (device_j.isNumeric()) {
                 std::stringstream ss;
                 ss << device_j.asUInt64();
@@ -359,7 +359,7 @@ bool Kis_RTL433_Phy::json_to_rtl(Json::Value json, std::shared_ptr<kis_packet> p
     return true;
 }
 
-bool Kis_RTL433_Phy::is_weather_station(Json::Value json) {
+bool Kis_RTL433_Phy::is_weather_station(const kis_json_report& json) {
     auto direction_j = json["direction_deg"];
     auto windstrength_j = json["windstrength"];
     auto winddirection_j = json["winddirection"];
@@ -378,7 +378,7 @@ bool Kis_RTL433_Phy::is_weather_station(Json::Value json) {
     return false;
 }
 
-bool Kis_RTL433_Phy::is_thermometer(Json::Value json) {
+bool Kis_RTL433_Phy::is_thermometer(const kis_json_report& json) {
     auto humidity_j = json["humidity"];
     auto moisture_j = json["moisture"];
     auto temp_f_j = json["temperature_F"];
@@ -391,7 +391,7 @@ bool Kis_RTL433_Phy::is_thermometer(Json::Value json) {
     return false;
 }
 
-bool Kis_RTL433_Phy::is_tpms(Json::Value json) {
+bool Kis_RTL433_Phy::is_tpms(const kis_json_report& json) {
     auto type_j = json["type"];
 
     if (type_j.isString() && type_j.asString() == "TPMS")
@@ -400,7 +400,7 @@ bool Kis_RTL433_Phy::is_tpms(Json::Value json) {
     return false;
 }
 
-bool Kis_RTL433_Phy::is_switch(Json::Value json) {
+bool Kis_RTL433_Phy::is_switch(const kis_json_report& json) {
     auto sw0_j = json["switch0"];
     auto sw1_j = json["switch1"];
     auto sw2_j = json["switch2"];
@@ -415,7 +415,7 @@ bool Kis_RTL433_Phy::is_switch(Json::Value json) {
     return false;
 }
 
-bool Kis_RTL433_Phy::is_insteon(Json::Value json) {
+bool Kis_RTL433_Phy::is_insteon(const kis_json_report& json) {
     auto from_id_j = json["from_id"];
     auto to_id_j = json["to_id"];
     auto msg_type_j = json["msg_type"];
@@ -430,7 +430,7 @@ bool Kis_RTL433_Phy::is_insteon(Json::Value json) {
     return false;
 }
 
-bool Kis_RTL433_Phy::is_lightning(Json::Value json) {
+bool Kis_RTL433_Phy::is_lightning(const kis_json_report& json) {
     auto strike_j = json["strike_count"];
     auto storm_j = json["storm_dist"];
     auto active_j = json["active"];
@@ -442,7 +442,7 @@ bool Kis_RTL433_Phy::is_lightning(Json::Value json) {
     return true;
 }
 
-void Kis_RTL433_Phy::add_weather_station(Json::Value json, 
+void Kis_RTL433_Phy::add_weather_station(const kis_json_report& json, 
         std::shared_ptr<tracker_element_map> rtlholder) {
     auto direction_j = json["direction_deg"];
     auto windstrength_j = json["windstrength"];
@@ -516,7 +516,7 @@ void Kis_RTL433_Phy::add_weather_station(Json::Value json,
     }
 }
 
-void Kis_RTL433_Phy::add_thermometer(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder) {
+void Kis_RTL433_Phy::add_thermometer(const kis_json_report& json, std::shared_ptr<tracker_element_map> rtlholder) {
     auto humidity_j = json["humidity"];
     auto moisture_j = json["moisture"];
     auto temp_f_j = json["temperature_F"];
@@ -550,7 +550,7 @@ void Kis_RTL433_Phy::add_thermometer(Json::Value json, std::shared_ptr<tracker_e
     }
 }
 
-void Kis_RTL433_Phy::add_tpms(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder) {
+void Kis_RTL433_Phy::add_tpms(const kis_json_report& json, std::shared_ptr<tracker_element_map> rtlholder) {
     auto type_j = json["type"];
     auto pressure_j = json["pressure_bar"];
     auto pressurekpa_j = json["pressure_kPa"];
@@ -597,20 +597,13 @@ void Kis_RTL433_Phy::add_tpms(Json::Value json, std::shared_ptr<tracker_element_
 
 }
 
-void Kis_RTL433_Phy::add_switch(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder) {
+void Kis_RTL433_Phy::add_switch(const kis_json_report& json, std::shared_ptr<tracker_element_map> rtlholder) {
     //{"time" : "2021-08-18 16:16:54", "model" : "Interlogix-Security", "subtype" : "contact", "id" : "a55b4b", "battery_ok" : 1, "switch1" : "OPEN", "switch2" : "OPEN", "switch3" : "OPEN", "switch4" : "OPEN", "switch5" : "OPEN", "raw_message" : "2dd4ac"}
-    auto sw0_j = json["switch0"];
     auto sw1_j = json["switch1"];
     auto sw2_j = json["switch2"];
     auto sw3_j = json["switch3"];
     auto sw4_j = json["switch4"];
     auto sw5_j = json["switch5"];
-    auto model_j = json["model"];
-    auto subtype_j = json["subtype"];
-    auto battery_j = json["battery_ok"];
-    auto msg_j = json["raw_message"];
-
-    auto sw_id = json["id"];
 
     if (sw1_j.isNull() || sw2_j.isNull() || sw3_j.isNull() || sw4_j.isNull() || sw5_j.isNull()) 
         return;
@@ -647,7 +640,7 @@ void Kis_RTL433_Phy::add_switch(Json::Value json, std::shared_ptr<tracker_elemen
     
 }
 
-void Kis_RTL433_Phy::add_insteon(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder) {
+void Kis_RTL433_Phy::add_insteon(const kis_json_report& json, std::shared_ptr<tracker_element_map> rtlholder) {
     //{"time" : "2021-08-19 18:52:48", "model" : "Insteon", "from_id" : "CCFF79", "to_id" : "9F39E6", "msg_type" : 7, "msg_str" : "NAK of Group Cleanup Direct Message", "extended" : 0, "hopsmax" : 3, "hopsleft" : 0, "formatted" : "E3 : 9F39E6 : CCFF79 : 39 E7  B7", "mic" : "CRC", "payload" : "E3E6399F79FFCC39E7B7", "cmd_dat" : [57, 231], "mod" : "FSK", "freq1" : 914.909, "freq2" : 915.069, "rssi" : -0.212, "snr" : 25.305, "noise" : -25.517}
     auto from_id_j = json["from_id"];
     auto to_id_j = json["to_id"];
@@ -655,7 +648,6 @@ void Kis_RTL433_Phy::add_insteon(Json::Value json, std::shared_ptr<tracker_eleme
     auto msg_str_j = json["msg_str"];
     auto hopsmax_j = json["hopsmax"];
     auto hopsleft_j = json["hopsleft"];
-    auto model_j = json["model"];
 
     if (from_id_j.isNull() || to_id_j.isNull() || msg_type_j.isNull() || msg_str_j.isNull() || hopsmax_j.isNull() || hopsleft_j.isNull())
         return;
@@ -694,7 +686,7 @@ void Kis_RTL433_Phy::add_insteon(Json::Value json, std::shared_ptr<tracker_eleme
 }
 
 
-void Kis_RTL433_Phy::add_lightning(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder) {
+void Kis_RTL433_Phy::add_lightning(const kis_json_report& json, std::shared_ptr<tracker_element_map> rtlholder) {
     // {"time" : "2019-02-24 22:12:13", "model" : "Acurite Lightning 6045M", "id" : 15580, "channel" : "B", "temperature_F" : 38.300, "humidity" : 53, "strike_count" : 1, "storm_dist" : 8, "active" : 1, "rfi" : 0, "ussb1" : 0, "battery" : "OK", "exception" : 0, "raw_msg" : "bcdc6f354edb81886e"}
     auto strike_j = json["strike_count"];
     auto storm_j = json["storm_dist"];
@@ -739,11 +731,10 @@ int Kis_RTL433_Phy::PacketHandler(CHAINCALL_PARMS) {
     if (json->type != "RTL433")
         return 0;
 
-    std::stringstream ss(json->json_string);
-    Json::Value device_json;
+    static thread_local kis_json_report device_json;
 
     try {
-        ss >> device_json;
+        device_json.parse(json->json_string);
 
         // Copy the JSON as the meta field for logging, if it's valid
         if (rtl433->json_to_rtl(device_json, in_pack)) {
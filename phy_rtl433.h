@@ -22,6 +22,7 @@
 
 #include "config.h"
 #include "globalregistry.h"
+#include "kis_json_report.h"
 #include "trackedelement.h"
 #include "devicetracker_component.h"
 #include "phyhandler.h"
@@ -561,25 +562,25 @@ public:
 
 protected:
     // Convert a JSON record to a RTL-based device key
-    mac_addr json_to_mac(Json::Value in_json);
+    mac_addr json_to_mac(const kis_json_report& in_json);
 
     // convert to a device record & push into device tracker, return false
     // if we can't do anything with it
-    bool json_to_rtl(Json::Value in_json, std::shared_ptr<kis_packet> packet);
-
-    bool is_weather_station(Json::Value json);
-    bool is_thermometer(Json::Value json);
-    bool is_tpms(Json::Value json);
-    bool is_switch(Json::Value json);
-    bool is_insteon(Json::Value json);
-    bool is_lightning(Json::Value json);
-
-    void add_weather_station(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder);
-    void add_thermometer(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder);
-    void add_tpms(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder);
-    void add_switch(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder);
-    void add_insteon(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder);
-    void add_lightning(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder);
+    bool json_to_rtl(const kis_json_report& in_json, std::shared_ptr<kis_packet> packet);
+
+    bool is_weather_station(const kis_json_report& json);
+    bool is_thermometer(const kis_json_report& json);
+    bool is_tpms(const kis_json_report& json);
+    bool is_switch(const kis_json_report& json);
+    bool is_insteon(const kis_json_report& json);
+    bool is_lightning(const kis_json_report& json);
+
+    void add_weather_station(const kis_json_report& json, std::shared_ptr<tracker_element_map> rtlholder);
+    void add_thermometer(const kis_json_report& json, std::shared_ptr<tracker_element_map> rtlholder);
+    void add_tpms(const kis_json_report& json, std::shared_ptr<tracker_element_map> rtlholder);
+    void add_switch(const kis_json_report& json, std::shared_ptr<tracker_element_map> rtlholder);
+    void add_insteon(const kis_json_report& json, std::shared_ptr<tracker_element_map> rtlholder);
+    void add_lightning(const kis_json_report& json, std::shared_ptr<tracker_element_map> rtlholder);
 
     double f_to_c(double f);
 
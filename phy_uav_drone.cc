@@ -19,6 +19,8 @@
 
 #include "config.h"
 
+#include <algorithm>
+
 #include "phy_uav_drone.h"
 #include "phy_80211.h"
 #include "kis_httpd_registry.h"
@@ -77,6 +79,79 @@ bool uav_manuf_match::match_record(const mac_addr& in_mac, const std::string& in
     return false;
 }
 
+uav_manuf_index::uav_manuf_index(std::shared_ptr<tracker_element_vector> in_matches) {
+    for (const auto& mi : *in_matches) {
+        auto m = std::static_pointer_cast<uav_manuf_match>(mi);
+        unsigned int n = matches.size();
+
+        matches.push_back(m);
+
+        auto mac = m->get_uav_manuf_mac();
+
+        if (mac.longmac != 0) {
+            if (mac.maskbits == 24)
+                oui_matches[mac.OUI()].push_back(n);
+            else
+                masked_matches.push_back(n);
+        } else {
+            ssid_matches.push_back(n);
+        }
+
+        auto literal = 
+            string_multimatch::regex_required_literal(m->get_uav_manuf_ssid_regex());
+        has_literal.push_back(literal.length() != 0);
+        ssid_literals.add_pattern(literal);
+    }
+
+    ssid_literals.compile();
+}
+
+std::shared_ptr<uav_manuf_match> uav_manuf_index::match(const mac_addr& in_mac, 
+        const std::string& in_ssid) const {
+    std::vector<unsigned int> candidates;
+
+    auto oui_k = oui_matches.find(in_mac.OUI());
+    if (oui_k != oui_matches.end())
+        candidates.insert(candidates.end(), oui_k->second.begin(), oui_k->second.end());
+
+    for (auto n : masked_matches) {
+        if (matches[n]->get_uav_manuf_mac() == in_mac)
+            candidates.push_back(n);
+    }
+
+    candidates.insert(candidates.end(), ssid_matches.begin(), ssid_matches.end());
+
+    if (candidates.empty())
+        return nullptr;
+
+    std::sort(candidates.begin(), candidates.end());
+
+    // Which literals are in the SSID
+    std::vector<bool> found;
+    ssid_literals.match(in_ssid, found);
+
+    for (auto n : candidates) {
+        const auto& m = matches[n];
+
+        // Matches which accept the mac alone don't need the SSID
+        bool mac_only = m->get_uav_manuf_mac().longmac != 0 && 
+            (m->get_uav_manuf_partial() || m->get_uav_manuf_ssid_regex() == "");
+
+        if (!mac_only) {
+            if (m->get_uav_manuf_ssid_regex() == "")
+                continue;
+
+            if (has_literal[n] && !found[n])
+                continue;
+        }
+
+        if (m->match_record(in_mac, in_ssid))
+            return m;
+    }
+
+    return nullptr;
+}
+
 
 Kis_UAV_Phy::Kis_UAV_Phy(int in_phyid) :
     kis_phy_handler(in_phyid) { 
@@ -100,6 +175,8 @@ Kis_UAV_Phy::Kis_UAV_Phy(int in_phyid) :
                 tracker_element_factory<uav_tracked_device>(),
                 "UAV device");
 
+    uav_builder = std::make_shared<uav_tracked_device>(uav_device_id);
+
     manuf_match_vec =
         std::make_shared<tracker_element_vector>();
 
@@ -117,6 +194,8 @@ Kis_UAV_Phy::Kis_UAV_Phy(int in_phyid) :
     for (auto l : uav_lines)
         parse_manuf_definition(l);
 
+    manuf_index = std::make_shared<uav_manuf_index>(manuf_match_vec);
+
     auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
 
     httpd->register_route("/phy/phyuav/manuf_matchers", {"GET", "POST"}, httpd->RO_ROLE, {},
@@ -186,7 +265,7 @@ int Kis_UAV_Phy::CommonClassifier(CHAINCALL_PARMS) {
 
                         if (uavdev == nullptr) {
                             uavdev =
-                                std::make_shared<uav_tracked_device>(uavphy->uav_device_id);
+                                tracker_arena_make_shared<uav_tracked_device>(uavphy->uav_builder.get());
                             basedev->insert(uavdev);
                         }
 
@@ -204,7 +283,7 @@ int Kis_UAV_Phy::CommonClassifier(CHAINCALL_PARMS) {
 
                     if (uavdev == nullptr) {
                         uavdev =
-                            std::make_shared<uav_tracked_device>(uavphy->uav_device_id);
+                            tracker_arena_make_shared<uav_tracked_device>(uavphy->uav_builder.get());
                         basedev->insert(uavdev);
                     }
 
@@ -255,7 +334,7 @@ int Kis_UAV_Phy::CommonClassifier(CHAINCALL_PARMS) {
 
                     if (uavdev == NULL) {
                         uavdev =
-                            std::make_shared<uav_tracked_device>(uavphy->uav_device_id);
+                            tracker_arena_make_shared<uav_tracked_device>(uavphy->uav_builder.get());
                         basedev->insert(uavdev);
                     }
 
@@ -273,27 +352,23 @@ int Kis_UAV_Phy::CommonClassifier(CHAINCALL_PARMS) {
         if (dot11info->new_adv_ssid && dot11info->type == packet_management && 
                 (dot11info->subtype == packet_sub_beacon || dot11info->subtype == packet_sub_probe_resp)) {
 
-            for (auto mi : *(uavphy->manuf_match_vec)) {
-                auto m = std::static_pointer_cast<uav_manuf_match>(mi);
+            auto m = uavphy->manuf_index->match(dot11info->bssid_mac, dot11info->ssid);
 
-                if (m->match_record(dot11info->bssid_mac, dot11info->ssid)) {
-                    auto uavdev =
-                        basedev->get_sub_as<uav_tracked_device>(uavphy->uav_device_id);
+            if (m != nullptr) {
+                auto uavdev =
+                    basedev->get_sub_as<uav_tracked_device>(uavphy->uav_device_id);
 
-                    if (uavdev == nullptr) {
-                        uavdev =
-                            std::make_shared<uav_tracked_device>(uavphy->uav_device_id);
-                        basedev->insert(uavdev);
-                        uavdev->set_uav_manufacturer(m->get_uav_manuf_name());
-                        uavdev->set_uav_model(m->get_uav_manuf_model());
-                    }
-
-                    uavdev->set_tracker_matched_type(m);
+                if (uavdev == nullptr) {
+                    uavdev =
+                        tracker_arena_make_shared<uav_tracked_device>(uavphy->uav_builder.get());
+                    basedev->insert(uavdev);
+                    uavdev->set_uav_manufacturer(m->get_uav_manuf_name());
+                    uavdev->set_uav_model(m->get_uav_manuf_model());
+                }
 
-                    uavdev->set_uav_match_type("UAV Fingerprint");
+                uavdev->set_tracker_matched_type(m);
 
-                    break;
-                }
+                uavdev->set_uav_match_type("UAV Fingerprint");
             }
         }
     }
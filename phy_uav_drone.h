@@ -20,10 +20,14 @@
 #ifndef __PHY_UAV_DRONE_H__
 #define __PHY_UAV_DRONE_H__
 
+#include <unordered_map>
+#include <vector>
+
 #include "trackedelement.h"
 #include "trackedlocation.h"
 #include "phyhandler.h"
 #include "packetchain.h"
+#include "string_multimatch.h"
 
 #include "dot11_parsers/dot11_ie_221_dji_droneid.h"
 
@@ -255,6 +259,35 @@ protected:
 #endif
 };
 
+// Compiled index of the manufacturer matches
+//
+// Matches with an OUI mac mask are indexed by OUI, and the longest literal each SSID
+// regex requires is added to an Aho-Corasick automaton, so one hash lookup and one pass
+// over the SSID select the few matches which could apply to a device; only those run
+// their regex.  The index is built once from the configured matches and is immutable,
+// so it is read without locking.
+class uav_manuf_index {
+public:
+    uav_manuf_index(std::shared_ptr<tracker_element_vector> in_matches);
+
+    // First match, in configuration order, for a device and SSID; nullptr if none
+    std::shared_ptr<uav_manuf_match> match(const mac_addr& in_mac, const std::string& in_ssid) const;
+
+protected:
+    std::vector<std::shared_ptr<uav_manuf_match>> matches;
+
+    // Matches whose regex has a literal in the automaton
+    std::vector<bool> has_literal;
+
+    std::unordered_map<uint32_t, std::vector<unsigned int>> oui_matches;
+    // Matches by a mac with any other mask, and matches by SSID only
+    std::vector<unsigned int> masked_matches;
+    std::vector<unsigned int> ssid_matches;
+
+    // Required literal of each match, by match index
+    string_multimatch ssid_literals;
+};
+
 /* A 'light' phy which attaches additional records to existing phys */
 class uav_tracked_device : public tracker_component {
 public:
@@ -278,6 +311,27 @@ public:
         reserve_fields(e);
     }
 
+    uav_tracked_device(const uav_tracked_device *p) :
+        tracker_component{p} {
+        __ImportField(uav_manufacturer, p);
+        __ImportField(uav_model, p);
+        __ImportField(uav_serialnumber, p);
+        __ImportField(last_telem_loc, p);
+        __ImportField(uav_telem_history, p);
+        __ImportField(uav_match_type, p);
+        __ImportField(home_location, p);
+        __ImportField(app_location, p);
+        __ImportField(matched_type, p);
+
+        __ImportId(last_telem_loc_id, p);
+        __ImportId(telem_history_entry_id, p);
+        __ImportId(home_location_id, p);
+        __ImportId(app_location_id, p);
+        __ImportId(matched_type_id, p);
+
+        reserve_fields(nullptr);
+    }
+
     virtual ~uav_tracked_device() { }
 
     virtual uint32_t get_signature() const override {
@@ -286,8 +340,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>();
-        r->set_id(this->get_id());
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -411,8 +464,12 @@ protected:
     int pack_comp_common, pack_comp_80211, pack_comp_device;
 
     int uav_device_id;
+    
+    // Prototype device records are cloned from
+    std::shared_ptr<uav_tracked_device> uav_builder;
 
     std::shared_ptr<tracker_element_vector> manuf_match_vec;
+    std::shared_ptr<const uav_manuf_index> manuf_index;
 };
 
 #endif
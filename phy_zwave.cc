@@ -47,6 +47,8 @@ Kis_Zwave_Phy::Kis_Zwave_Phy(int in_phyid) :
                 tracker_element_factory<zwave_tracked_device>(),
                 "Z-Wave device");
 
+    zwave_builder = std::make_shared<zwave_tracked_device>(zwave_device_id);
+
     zwave_manuf = Globalreg::globalreg->manufdb->make_manuf("Z-Wave");
 
     // Register js module for UI
@@ -183,7 +185,7 @@ bool Kis_Zwave_Phy::json_to_record(Json::Value json) {
 
     if (zdev == NULL) {
         zdev = 
-            std::make_shared<zwave_tracked_device>(zwave_device_id);
+            tracker_arena_make_shared<zwave_tracked_device>(zwave_builder.get());
         basedev->insert(zdev);
         newzdev = true;
     }
@@ -56,14 +56,21 @@ public:
         reserve_fields(e);
     }
 
+    zwave_tracked_device(const zwave_tracked_device *p) :
+        tracker_component{p} {
+        __ImportField(homeid, p);
+        __ImportField(deviceid, p);
+
+        reserve_fields(nullptr);
+    }
+
     virtual uint32_t get_signature() const override {
         return adler32_checksum("zwave_tracked_device");
     }
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>();
-        r->set_id(this->get_id());
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -104,6 +111,9 @@ protected:
     std::shared_ptr<device_tracker> devicetracker;
 
     int zwave_device_id;
+    
+    // Prototype device records are cloned from
+    std::shared_ptr<zwave_tracked_device> zwave_builder;
 
     int pack_comp_common;
 
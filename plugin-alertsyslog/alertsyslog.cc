@@ -38,52 +38,40 @@
 #include <alertracker.h>
 #include <version.h>
 
-int pack_comp_alert;
-
-int alertsyslog_chain_hook(CHAINCALL_PARMS) {
-    std::shared_ptr<kis_alert_component> alrtinfo;
-
-	if (in_pack->error)
-		return 0;
-
-	// Grab the alerts
-    alrtinfo = in_pack->fetch<kis_alert_component>(pack_comp_alert);
-
-	if (alrtinfo == NULL)
-		return 0;
-
-	for (unsigned int x = 0; x < alrtinfo->alert_vec.size(); x++) {
-		syslog(LOG_CRIT, "%s server-ts=%u bssid=%s source=%s dest=%s channel=%s %s",
-			   alrtinfo->alert_vec[x]->header.c_str(),
-			   (unsigned int) alrtinfo->alert_vec[x]->tm.tv_sec,
-			   alrtinfo->alert_vec[x]->bssid.mac_to_string().c_str(),
-			   alrtinfo->alert_vec[x]->source.mac_to_string().c_str(),
-			   alrtinfo->alert_vec[x]->dest.mac_to_string().c_str(),
-			   alrtinfo->alert_vec[x]->channel.c_str(),
-			   alrtinfo->alert_vec[x]->text.c_str());
-	}
+// Alerts are logged from the alert forwarding thread, so a slow or blocked syslog
+// socket never holds up the packet chain
+class alertsyslog_exporter : public alert_exporter {
+public:
+    virtual std::string exporter_name() const override {
+        return "local syslog";
+    }
 
-	return 1;
-}
+    virtual bool send_alerts(const std::vector<std::shared_ptr<kis_alert_info>>& in_alerts) override {
+        for (const auto& a : in_alerts) {
+            syslog(LOG_CRIT, "%s server-ts=%u bssid=%s source=%s dest=%s channel=%s %s",
+                    a->header.c_str(),
+                    (unsigned int) a->tm.tv_sec,
+                    a->bssid.mac_to_string().c_str(),
+                    a->source.mac_to_string().c_str(),
+                    a->dest.mac_to_string().c_str(),
+                    a->channel.c_str(),
+                    a->text.c_str());
+        }
+
+        return true;
+    }
+};
 
 int alertsyslog_openlog(global_registry *in_globalreg) {
-    // We can't use the templated fetch_global_as here because the template object code
-    // won't exist in the server object
-    std::shared_ptr<packet_chain> packetchain =
-        std::static_pointer_cast<packet_chain>(in_globalreg->fetch_global(std::string("PACKETCHAIN")));
-
-    if (packetchain == NULL) {
-        _MSG("Unable to register syslog plugin, packetchain was unavailable",
+    if (in_globalreg->alertracker == NULL) {
+        _MSG("Unable to register syslog plugin, alertracker was unavailable",
                 MSGFLAG_ERROR);
         return -1;
     }
 
-    pack_comp_alert = packetchain->register_packet_component("alert");
-
     openlog(in_globalreg->servername.c_str(), LOG_NDELAY, LOG_USER);
 
-    packetchain->register_handler(&alertsyslog_chain_hook, NULL,
-            CHAINPOS_LOGGING, -100);
+    in_globalreg->alertracker->add_alert_exporter(std::make_shared<alertsyslog_exporter>());
 
     return 1;
 }
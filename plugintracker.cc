@@ -46,6 +46,16 @@ void plugin_registration_data::activate_external_http() {
     }
 }
 
+void plugin_registration_data::set_packet_cost(const packet_chain::packet_owner_stats& in_stats) {
+    packet_handlers->set(in_stats.handlers);
+    packet_async_handlers->set(in_stats.async_handlers);
+    packet_calls->set(in_stats.calls);
+    packet_wall_ns->set(in_stats.wall_ns);
+    packet_cpu_ns->set(in_stats.cpu_ns);
+    packet_async_queued->set(in_stats.async_queued);
+    packet_async_dropped->set(in_stats.async_dropped);
+}
+
 plugin_tracker::plugin_tracker() :
     lifetime_global() {
 
@@ -95,7 +105,26 @@ plugin_tracker::plugin_tracker() :
     plugins_active = 1;
 
     httpd->register_route("/plugins/all_plugins", {"GET", "POST"}, httpd->RO_ROLE, {},
-            std::make_shared<kis_net_web_tracked_endpoint>(plugin_registry_vec, plugin_lock));
+            std::make_shared<kis_net_web_tracked_endpoint>(plugin_registry_vec, plugin_lock,
+                [](std::shared_ptr<tracker_element> content) {
+                    auto packetchain = Globalreg::globalreg->packetchain;
+
+                    if (packetchain == nullptr)
+                        return;
+
+                    auto costs = packetchain->get_owner_stats();
+
+                    for (const auto& p : *std::static_pointer_cast<tracker_element_vector>(content)) {
+                        auto pd = std::static_pointer_cast<plugin_registration_data>(p);
+
+                        for (const auto& c : costs) {
+                            if (c.owner == pd->get_plugin_name()) {
+                                pd->set_packet_cost(c);
+                                break;
+                            }
+                        }
+                    }
+                }));
 }
 
 plugin_tracker::~plugin_tracker() {
@@ -380,7 +409,18 @@ int plugin_tracker::activate_plugins() {
                 continue;
             }
 
-            if ((act_sym)(Globalreg::globalreg) < 0) {
+            // Attribute the packet handlers the plugin registers to it
+            auto packetchain = Globalreg::globalreg->packetchain;
+
+            if (packetchain != nullptr)
+                packetchain->set_handler_owner(x->get_plugin_name());
+
+            auto act_r = (act_sym)(Globalreg::globalreg);
+
+            if (packetchain != nullptr)
+                packetchain->clear_handler_owner();
+
+            if (act_r < 0) {
                 _MSG("Plugin '" + x->get_plugin_path() + "' failed to activate, "
                         "skipping.", MSGFLAG_ERROR);
                 continue;
@@ -456,7 +496,17 @@ int plugin_tracker::finalize_plugins() {
             if (final_sym == NULL)
                 continue;
 
-            if ((final_sym)(Globalreg::globalreg) < 0) {
+            auto packetchain = Globalreg::globalreg->packetchain;
+
+            if (packetchain != nullptr)
+                packetchain->set_handler_owner(pd->get_plugin_name());
+
+            auto final_r = (final_sym)(Globalreg::globalreg);
+
+            if (packetchain != nullptr)
+                packetchain->clear_handler_owner();
+
+            if (final_r < 0) {
                 _MSG("Plugin '" + pd->get_plugin_path() + "' failed to complete "
                         "activation...", MSGFLAG_ERROR);
                 continue;
@@ -107,6 +107,7 @@
 #include "kis_external.h"
 #include "kis_net_beast_httpd.h"
 #include "messagebus.h"
+#include "packetchain.h"
 #include "trackedelement.h"
 #include "trackedcomponent.h"
 
@@ -179,6 +180,9 @@ public:
 
     void activate_external_http();
 
+    // Update the packet chain cost of the plugin's handlers
+    void set_packet_cost(const packet_chain::packet_owner_stats& in_stats);
+
 protected:
     virtual void register_fields() override {
         tracker_component::register_fields();
@@ -195,6 +199,21 @@ protected:
         register_field("kismet.plugin.path", "path to plugin content", &plugin_path);
         register_field("kismet.plugin.jsmodule", "Plugin javascript module", &plugin_js);
 
+        register_field("kismet.plugin.packet.handlers", "packet chain handlers registered", 
+                &packet_handlers);
+        register_field("kismet.plugin.packet.async_handlers", 
+                "packet chain handlers called from the async stage", &packet_async_handlers);
+        register_field("kismet.plugin.packet.calls", "packet chain handler calls", &packet_calls);
+        register_field("kismet.plugin.packet.wall_ns", 
+                "packet chain handler time (ns)", &packet_wall_ns);
+        register_field("kismet.plugin.packet.cpu_ns", 
+                "packet chain handler thread CPU time (ns)", &packet_cpu_ns);
+        register_field("kismet.plugin.packet.async_queued",
+                "packets queued to async handlers", &packet_async_queued);
+        register_field("kismet.plugin.packet.async_dropped",
+                "packets dropped from async handlers because the async backlog was full",
+                &packet_async_dropped);
+
     }
 
     std::shared_ptr<tracker_element_string> plugin_name;
@@ -210,6 +229,14 @@ protected:
 
     std::shared_ptr<tracker_element_string> plugin_js;
 
+    std::shared_ptr<tracker_element_uint32> packet_handlers;
+    std::shared_ptr<tracker_element_uint32> packet_async_handlers;
+    std::shared_ptr<tracker_element_uint64> packet_calls;
+    std::shared_ptr<tracker_element_uint64> packet_wall_ns;
+    std::shared_ptr<tracker_element_uint64> packet_cpu_ns;
+    std::shared_ptr<tracker_element_uint64> packet_async_queued;
+    std::shared_ptr<tracker_element_uint64> packet_async_dropped;
+
     void *dlfile;
 
     std::shared_ptr<external_http_plugin_harness> external_http;
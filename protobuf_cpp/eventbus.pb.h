@@ -0,0 +1,2419 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+// source: eventbus.proto
+
+#ifndef GOOGLE_PROTOBUF_INCLUDED_eventbus_2eproto
+#define GOOGLE_PROTOBUF_INCLUDED_eventbus_2eproto
+
+#include <limits>
+#include <string>
+
+#include <google/protobuf/port_def.inc>
+#if PROTOBUF_VERSION < 3021000
+#error This file was generated by a newer version of protoc which is
+#error incompatible with your Protocol Buffer headers. Please update
+#error your headers.
+#endif
+#if 3021012 < PROTOBUF_MIN_PROTOC_VERSION
+#error This file was generated by an older version of protoc which is
+#error incompatible with your Protocol Buffer headers. Please
+#error regenerate this file with a newer version of protoc.
+#endif
+
+#include <google/protobuf/port_undef.inc>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/arena.h>
+#include <google/protobuf/arenastring.h>
+#include <google/protobuf/generated_message_util.h>
+#include <google/protobuf/metadata_lite.h>
+#include <google/protobuf/message_lite.h>
+#include <google/protobuf/repeated_field.h>  // IWYU pragma: export
+#include <google/protobuf/extension_set.h>  // IWYU pragma: export
+// @@protoc_insertion_point(includes)
+#include <google/protobuf/port_def.inc>
+#define PROTOBUF_INTERNAL_EXPORT_eventbus_2eproto
+PROTOBUF_NAMESPACE_OPEN
+namespace internal {
+class AnyMetadata;
+}  // namespace internal
+PROTOBUF_NAMESPACE_CLOSE
+
+// Internal implementation detail -- do not use these members.
+struct TableStruct_eventbus_2eproto {
+  static const uint32_t offsets[];
+};
+namespace KismetEventBus {
+class EventbusBinaryEvent;
+struct EventbusBinaryEventDefaultTypeInternal;
+extern EventbusBinaryEventDefaultTypeInternal _EventbusBinaryEvent_default_instance_;
+class EventbusBinaryField;
+struct EventbusBinaryFieldDefaultTypeInternal;
+extern EventbusBinaryFieldDefaultTypeInternal _EventbusBinaryField_default_instance_;
+class EventbusEvent;
+struct EventbusEventDefaultTypeInternal;
+extern EventbusEventDefaultTypeInternal _EventbusEvent_default_instance_;
+class EventbusFieldMatch;
+struct EventbusFieldMatchDefaultTypeInternal;
+extern EventbusFieldMatchDefaultTypeInternal _EventbusFieldMatch_default_instance_;
+class EventbusPublishEvent;
+struct EventbusPublishEventDefaultTypeInternal;
+extern EventbusPublishEventDefaultTypeInternal _EventbusPublishEvent_default_instance_;
+class EventbusRegisterListener;
+struct EventbusRegisterListenerDefaultTypeInternal;
+extern EventbusRegisterListenerDefaultTypeInternal _EventbusRegisterListener_default_instance_;
+class EventbusSubscription;
+struct EventbusSubscriptionDefaultTypeInternal;
+extern EventbusSubscriptionDefaultTypeInternal _EventbusSubscription_default_instance_;
+}  // namespace KismetEventBus
+PROTOBUF_NAMESPACE_OPEN
+template<> ::KismetEventBus::EventbusBinaryEvent* Arena::CreateMaybeMessage<::KismetEventBus::EventbusBinaryEvent>(Arena*);
+template<> ::KismetEventBus::EventbusBinaryField* Arena::CreateMaybeMessage<::KismetEventBus::EventbusBinaryField>(Arena*);
+template<> ::KismetEventBus::EventbusEvent* Arena::CreateMaybeMessage<::KismetEventBus::EventbusEvent>(Arena*);
+template<> ::KismetEventBus::EventbusFieldMatch* Arena::CreateMaybeMessage<::KismetEventBus::EventbusFieldMatch>(Arena*);
+template<> ::KismetEventBus::EventbusPublishEvent* Arena::CreateMaybeMessage<::KismetEventBus::EventbusPublishEvent>(Arena*);
+template<> ::KismetEventBus::EventbusRegisterListener* Arena::CreateMaybeMessage<::KismetEventBus::EventbusRegisterListener>(Arena*);
+template<> ::KismetEventBus::EventbusSubscription* Arena::CreateMaybeMessage<::KismetEventBus::EventbusSubscription>(Arena*);
+PROTOBUF_NAMESPACE_CLOSE
+namespace KismetEventBus {
+
+// ===================================================================
+
+class EventbusEvent final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetEventBus.EventbusEvent) */ {
+ public:
+  inline EventbusEvent() : EventbusEvent(nullptr) {}
+  ~EventbusEvent() override;
+  explicit PROTOBUF_CONSTEXPR EventbusEvent(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  EventbusEvent(const EventbusEvent& from);
+  EventbusEvent(EventbusEvent&& from) noexcept
+    : EventbusEvent() {
+    *this = ::std::move(from);
+  }
+
+  inline EventbusEvent& operator=(const EventbusEvent& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline EventbusEvent& operator=(EventbusEvent&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const EventbusEvent& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const EventbusEvent* internal_default_instance() {
+    return reinterpret_cast<const EventbusEvent*>(
+               &_EventbusEvent_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    0;
+
+  friend void swap(EventbusEvent& a, EventbusEvent& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(EventbusEvent* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(EventbusEvent* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  EventbusEvent* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<EventbusEvent>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const EventbusEvent& from);
+  void MergeFrom(const EventbusEvent& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(EventbusEvent* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetEventBus.EventbusEvent";
+  }
+  protected:
+  explicit EventbusEvent(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kEventJsonFieldNumber = 1,
+  };
+  // required string event_json = 1;
+  bool has_event_json() const;
+  private:
+  bool _internal_has_event_json() const;
+  public:
+  void clear_event_json();
+  const std::string& event_json() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_event_json(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_event_json();
+  PROTOBUF_NODISCARD std::string* release_event_json();
+  void set_allocated_event_json(std::string* event_json);
+  private:
+  const std::string& _internal_event_json() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_event_json(const std::string& value);
+  std::string* _internal_mutable_event_json();
+  public:
+
+  // @@protoc_insertion_point(class_scope:KismetEventBus.EventbusEvent)
+ private:
+  class _Internal;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr event_json_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_eventbus_2eproto;
+};
+// -------------------------------------------------------------------
+
+class EventbusBinaryField final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetEventBus.EventbusBinaryField) */ {
+ public:
+  inline EventbusBinaryField() : EventbusBinaryField(nullptr) {}
+  ~EventbusBinaryField() override;
+  explicit PROTOBUF_CONSTEXPR EventbusBinaryField(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  EventbusBinaryField(const EventbusBinaryField& from);
+  EventbusBinaryField(EventbusBinaryField&& from) noexcept
+    : EventbusBinaryField() {
+    *this = ::std::move(from);
+  }
+
+  inline EventbusBinaryField& operator=(const EventbusBinaryField& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline EventbusBinaryField& operator=(EventbusBinaryField&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const EventbusBinaryField& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const EventbusBinaryField* internal_default_instance() {
+    return reinterpret_cast<const EventbusBinaryField*>(
+               &_EventbusBinaryField_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    1;
+
+  friend void swap(EventbusBinaryField& a, EventbusBinaryField& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(EventbusBinaryField* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(EventbusBinaryField* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  EventbusBinaryField* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<EventbusBinaryField>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const EventbusBinaryField& from);
+  void MergeFrom(const EventbusBinaryField& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(EventbusBinaryField* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetEventBus.EventbusBinaryField";
+  }
+  protected:
+  explicit EventbusBinaryField(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kBytesValueFieldNumber = 5,
+    kJsonValueFieldNumber = 6,
+    kIntValueFieldNumber = 2,
+    kUintValueFieldNumber = 3,
+    kDoubleValueFieldNumber = 4,
+    kIndexFieldNumber = 1,
+  };
+  // optional bytes bytes_value = 5;
+  bool has_bytes_value() const;
+  private:
+  bool _internal_has_bytes_value() const;
+  public:
+  void clear_bytes_value();
+  const std::string& bytes_value() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_bytes_value(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_bytes_value();
+  PROTOBUF_NODISCARD std::string* release_bytes_value();
+  void set_allocated_bytes_value(std::string* bytes_value);
+  private:
+  const std::string& _internal_bytes_value() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_bytes_value(const std::string& value);
+  std::string* _internal_mutable_bytes_value();
+  public:
+
+  // optional string json_value = 6;
+  bool has_json_value() const;
+  private:
+  bool _internal_has_json_value() const;
+  public:
+  void clear_json_value();
+  const std::string& json_value() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_json_value(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_json_value();
+  PROTOBUF_NODISCARD std::string* release_json_value();
+  void set_allocated_json_value(std::string* json_value);
+  private:
+  const std::string& _internal_json_value() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_json_value(const std::string& value);
+  std::string* _internal_mutable_json_value();
+  public:
+
+  // optional sint64 int_value = 2;
+  bool has_int_value() const;
+  private:
+  bool _internal_has_int_value() const;
+  public:
+  void clear_int_value();
+  int64_t int_value() const;
+  void set_int_value(int64_t value);
+  private:
+  int64_t _internal_int_value() const;
+  void _internal_set_int_value(int64_t value);
+  public:
+
+  // optional uint64 uint_value = 3;
+  bool has_uint_value() const;
+  private:
+  bool _internal_has_uint_value() const;
+  public:
+  void clear_uint_value();
+  uint64_t uint_value() const;
+  void set_uint_value(uint64_t value);
+  private:
+  uint64_t _internal_uint_value() const;
+  void _internal_set_uint_value(uint64_t value);
+  public:
+
+  // optional double double_value = 4;
+  bool has_double_value() const;
+  private:
+  bool _internal_has_double_value() const;
+  public:
+  void clear_double_value();
+  double double_value() const;
+  void set_double_value(double value);
+  private:
+  double _internal_double_value() const;
+  void _internal_set_double_value(double value);
+  public:
+
+  // required uint32 index = 1;
+  bool has_index() const;
+  private:
+  bool _internal_has_index() const;
+  public:
+  void clear_index();
+  uint32_t index() const;
+  void set_index(uint32_t value);
+  private:
+  uint32_t _internal_index() const;
+  void _internal_set_index(uint32_t value);
+  public:
+
+  // @@protoc_insertion_point(class_scope:KismetEventBus.EventbusBinaryField)
+ private:
+  class _Internal;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr bytes_value_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr json_value_;
+    int64_t int_value_;
+    uint64_t uint_value_;
+    double double_value_;
+    uint32_t index_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_eventbus_2eproto;
+};
+// -------------------------------------------------------------------
+
+class EventbusBinaryEvent final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetEventBus.EventbusBinaryEvent) */ {
+ public:
+  inline EventbusBinaryEvent() : EventbusBinaryEvent(nullptr) {}
+  ~EventbusBinaryEvent() override;
+  explicit PROTOBUF_CONSTEXPR EventbusBinaryEvent(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  EventbusBinaryEvent(const EventbusBinaryEvent& from);
+  EventbusBinaryEvent(EventbusBinaryEvent&& from) noexcept
+    : EventbusBinaryEvent() {
+    *this = ::std::move(from);
+  }
+
+  inline EventbusBinaryEvent& operator=(const EventbusBinaryEvent& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline EventbusBinaryEvent& operator=(EventbusBinaryEvent&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const EventbusBinaryEvent& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const EventbusBinaryEvent* internal_default_instance() {
+    return reinterpret_cast<const EventbusBinaryEvent*>(
+               &_EventbusBinaryEvent_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    2;
+
+  friend void swap(EventbusBinaryEvent& a, EventbusBinaryEvent& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(EventbusBinaryEvent* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(EventbusBinaryEvent* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  EventbusBinaryEvent* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<EventbusBinaryEvent>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const EventbusBinaryEvent& from);
+  void MergeFrom(const EventbusBinaryEvent& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(EventbusBinaryEvent* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetEventBus.EventbusBinaryEvent";
+  }
+  protected:
+  explicit EventbusBinaryEvent(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kFieldFieldNumber = 2,
+    kEventFieldNumber = 1,
+  };
+  // repeated .KismetEventBus.EventbusBinaryField field = 2;
+  int field_size() const;
+  private:
+  int _internal_field_size() const;
+  public:
+  void clear_field();
+  ::KismetEventBus::EventbusBinaryField* mutable_field(int index);
+  ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusBinaryField >*
+      mutable_field();
+  private:
+  const ::KismetEventBus::EventbusBinaryField& _internal_field(int index) const;
+  ::KismetEventBus::EventbusBinaryField* _internal_add_field();
+  public:
+  const ::KismetEventBus::EventbusBinaryField& field(int index) const;
+  ::KismetEventBus::EventbusBinaryField* add_field();
+  const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusBinaryField >&
+      field() const;
+
+  // required string event = 1;
+  bool has_event() const;
+  private:
+  bool _internal_has_event() const;
+  public:
+  void clear_event();
+  const std::string& event() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_event(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_event();
+  PROTOBUF_NODISCARD std::string* release_event();
+  void set_allocated_event(std::string* event);
+  private:
+  const std::string& _internal_event() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_event(const std::string& value);
+  std::string* _internal_mutable_event();
+  public:
+
+  // @@protoc_insertion_point(class_scope:KismetEventBus.EventbusBinaryEvent)
+ private:
+  class _Internal;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusBinaryField > field_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr event_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_eventbus_2eproto;
+};
+// -------------------------------------------------------------------
+
+class EventbusFieldMatch final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetEventBus.EventbusFieldMatch) */ {
+ public:
+  inline EventbusFieldMatch() : EventbusFieldMatch(nullptr) {}
+  ~EventbusFieldMatch() override;
+  explicit PROTOBUF_CONSTEXPR EventbusFieldMatch(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  EventbusFieldMatch(const EventbusFieldMatch& from);
+  EventbusFieldMatch(EventbusFieldMatch&& from) noexcept
+    : EventbusFieldMatch() {
+    *this = ::std::move(from);
+  }
+
+  inline EventbusFieldMatch& operator=(const EventbusFieldMatch& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline EventbusFieldMatch& operator=(EventbusFieldMatch&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const EventbusFieldMatch& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const EventbusFieldMatch* internal_default_instance() {
+    return reinterpret_cast<const EventbusFieldMatch*>(
+               &_EventbusFieldMatch_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    3;
+
+  friend void swap(EventbusFieldMatch& a, EventbusFieldMatch& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(EventbusFieldMatch* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(EventbusFieldMatch* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  EventbusFieldMatch* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<EventbusFieldMatch>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const EventbusFieldMatch& from);
+  void MergeFrom(const EventbusFieldMatch& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(EventbusFieldMatch* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetEventBus.EventbusFieldMatch";
+  }
+  protected:
+  explicit EventbusFieldMatch(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kPathFieldNumber = 1,
+    kValueFieldNumber = 2,
+  };
+  // required string path = 1;
+  bool has_path() const;
+  private:
+  bool _internal_has_path() const;
+  public:
+  void clear_path();
+  const std::string& path() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_path(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_path();
+  PROTOBUF_NODISCARD std::string* release_path();
+  void set_allocated_path(std::string* path);
+  private:
+  const std::string& _internal_path() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_path(const std::string& value);
+  std::string* _internal_mutable_path();
+  public:
+
+  // required string value = 2;
+  bool has_value() const;
+  private:
+  bool _internal_has_value() const;
+  public:
+  void clear_value();
+  const std::string& value() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_value(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_value();
+  PROTOBUF_NODISCARD std::string* release_value();
+  void set_allocated_value(std::string* value);
+  private:
+  const std::string& _internal_value() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_value(const std::string& value);
+  std::string* _internal_mutable_value();
+  public:
+
+  // @@protoc_insertion_point(class_scope:KismetEventBus.EventbusFieldMatch)
+ private:
+  class _Internal;
+
+  // helper for ByteSizeLong()
+  size_t RequiredFieldsByteSizeFallback() const;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr path_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr value_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_eventbus_2eproto;
+};
+// -------------------------------------------------------------------
+
+class EventbusSubscription final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetEventBus.EventbusSubscription) */ {
+ public:
+  inline EventbusSubscription() : EventbusSubscription(nullptr) {}
+  ~EventbusSubscription() override;
+  explicit PROTOBUF_CONSTEXPR EventbusSubscription(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  EventbusSubscription(const EventbusSubscription& from);
+  EventbusSubscription(EventbusSubscription&& from) noexcept
+    : EventbusSubscription() {
+    *this = ::std::move(from);
+  }
+
+  inline EventbusSubscription& operator=(const EventbusSubscription& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline EventbusSubscription& operator=(EventbusSubscription&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const EventbusSubscription& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const EventbusSubscription* internal_default_instance() {
+    return reinterpret_cast<const EventbusSubscription*>(
+               &_EventbusSubscription_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    4;
+
+  friend void swap(EventbusSubscription& a, EventbusSubscription& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(EventbusSubscription* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(EventbusSubscription* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  EventbusSubscription* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<EventbusSubscription>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const EventbusSubscription& from);
+  void MergeFrom(const EventbusSubscription& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(EventbusSubscription* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetEventBus.EventbusSubscription";
+  }
+  protected:
+  explicit EventbusSubscription(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kMatchFieldNumber = 2,
+    kFieldFieldNumber = 3,
+    kEventFieldNumber = 1,
+    kBinaryFieldNumber = 4,
+  };
+  // repeated .KismetEventBus.EventbusFieldMatch match = 2;
+  int match_size() const;
+  private:
+  int _internal_match_size() const;
+  public:
+  void clear_match();
+  ::KismetEventBus::EventbusFieldMatch* mutable_match(int index);
+  ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusFieldMatch >*
+      mutable_match();
+  private:
+  const ::KismetEventBus::EventbusFieldMatch& _internal_match(int index) const;
+  ::KismetEventBus::EventbusFieldMatch* _internal_add_match();
+  public:
+  const ::KismetEventBus::EventbusFieldMatch& match(int index) const;
+  ::KismetEventBus::EventbusFieldMatch* add_match();
+  const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusFieldMatch >&
+      match() const;
+
+  // repeated string field = 3;
+  int field_size() const;
+  private:
+  int _internal_field_size() const;
+  public:
+  void clear_field();
+  const std::string& field(int index) const;
+  std::string* mutable_field(int index);
+  void set_field(int index, const std::string& value);
+  void set_field(int index, std::string&& value);
+  void set_field(int index, const char* value);
+  void set_field(int index, const char* value, size_t size);
+  std::string* add_field();
+  void add_field(const std::string& value);
+  void add_field(std::string&& value);
+  void add_field(const char* value);
+  void add_field(const char* value, size_t size);
+  const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string>& field() const;
+  ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string>* mutable_field();
+  private:
+  const std::string& _internal_field(int index) const;
+  std::string* _internal_add_field();
+  public:
+
+  // required string event = 1;
+  bool has_event() const;
+  private:
+  bool _internal_has_event() const;
+  public:
+  void clear_event();
+  const std::string& event() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_event(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_event();
+  PROTOBUF_NODISCARD std::string* release_event();
+  void set_allocated_event(std::string* event);
+  private:
+  const std::string& _internal_event() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_event(const std::string& value);
+  std::string* _internal_mutable_event();
+  public:
+
+  // optional bool binary = 4;
+  bool has_binary() const;
+  private:
+  bool _internal_has_binary() const;
+  public:
+  void clear_binary();
+  bool binary() const;
+  void set_binary(bool value);
+  private:
+  bool _internal_binary() const;
+  void _internal_set_binary(bool value);
+  public:
+
+  // @@protoc_insertion_point(class_scope:KismetEventBus.EventbusSubscription)
+ private:
+  class _Internal;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusFieldMatch > match_;
+    ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string> field_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr event_;
+    bool binary_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_eventbus_2eproto;
+};
+// -------------------------------------------------------------------
+
+class EventbusRegisterListener final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetEventBus.EventbusRegisterListener) */ {
+ public:
+  inline EventbusRegisterListener() : EventbusRegisterListener(nullptr) {}
+  ~EventbusRegisterListener() override;
+  explicit PROTOBUF_CONSTEXPR EventbusRegisterListener(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  EventbusRegisterListener(const EventbusRegisterListener& from);
+  EventbusRegisterListener(EventbusRegisterListener&& from) noexcept
+    : EventbusRegisterListener() {
+    *this = ::std::move(from);
+  }
+
+  inline EventbusRegisterListener& operator=(const EventbusRegisterListener& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline EventbusRegisterListener& operator=(EventbusRegisterListener&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const EventbusRegisterListener& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const EventbusRegisterListener* internal_default_instance() {
+    return reinterpret_cast<const EventbusRegisterListener*>(
+               &_EventbusRegisterListener_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    5;
+
+  friend void swap(EventbusRegisterListener& a, EventbusRegisterListener& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(EventbusRegisterListener* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(EventbusRegisterListener* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  EventbusRegisterListener* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<EventbusRegisterListener>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const EventbusRegisterListener& from);
+  void MergeFrom(const EventbusRegisterListener& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(EventbusRegisterListener* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetEventBus.EventbusRegisterListener";
+  }
+  protected:
+  explicit EventbusRegisterListener(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kEventFieldNumber = 1,
+    kSubscriptionFieldNumber = 2,
+  };
+  // repeated string event = 1;
+  int event_size() const;
+  private:
+  int _internal_event_size() const;
+  public:
+  void clear_event();
+  const std::string& event(int index) const;
+  std::string* mutable_event(int index);
+  void set_event(int index, const std::string& value);
+  void set_event(int index, std::string&& value);
+  void set_event(int index, const char* value);
+  void set_event(int index, const char* value, size_t size);
+  std::string* add_event();
+  void add_event(const std::string& value);
+  void add_event(std::string&& value);
+  void add_event(const char* value);
+  void add_event(const char* value, size_t size);
+  const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string>& event() const;
+  ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string>* mutable_event();
+  private:
+  const std::string& _internal_event(int index) const;
+  std::string* _internal_add_event();
+  public:
+
+  // repeated .KismetEventBus.EventbusSubscription subscription = 2;
+  int subscription_size() const;
+  private:
+  int _internal_subscription_size() const;
+  public:
+  void clear_subscription();
+  ::KismetEventBus::EventbusSubscription* mutable_subscription(int index);
+  ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusSubscription >*
+      mutable_subscription();
+  private:
+  const ::KismetEventBus::EventbusSubscription& _internal_subscription(int index) const;
+  ::KismetEventBus::EventbusSubscription* _internal_add_subscription();
+  public:
+  const ::KismetEventBus::EventbusSubscription& subscription(int index) const;
+  ::KismetEventBus::EventbusSubscription* add_subscription();
+  const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusSubscription >&
+      subscription() const;
+
+  // @@protoc_insertion_point(class_scope:KismetEventBus.EventbusRegisterListener)
+ private:
+  class _Internal;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string> event_;
+    ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusSubscription > subscription_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_eventbus_2eproto;
+};
+// -------------------------------------------------------------------
+
+class EventbusPublishEvent final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetEventBus.EventbusPublishEvent) */ {
+ public:
+  inline EventbusPublishEvent() : EventbusPublishEvent(nullptr) {}
+  ~EventbusPublishEvent() override;
+  explicit PROTOBUF_CONSTEXPR EventbusPublishEvent(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  EventbusPublishEvent(const EventbusPublishEvent& from);
+  EventbusPublishEvent(EventbusPublishEvent&& from) noexcept
+    : EventbusPublishEvent() {
+    *this = ::std::move(from);
+  }
+
+  inline EventbusPublishEvent& operator=(const EventbusPublishEvent& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline EventbusPublishEvent& operator=(EventbusPublishEvent&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const EventbusPublishEvent& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const EventbusPublishEvent* internal_default_instance() {
+    return reinterpret_cast<const EventbusPublishEvent*>(
+               &_EventbusPublishEvent_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    6;
+
+  friend void swap(EventbusPublishEvent& a, EventbusPublishEvent& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(EventbusPublishEvent* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(EventbusPublishEvent* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  EventbusPublishEvent* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<EventbusPublishEvent>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const EventbusPublishEvent& from);
+  void MergeFrom(const EventbusPublishEvent& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(EventbusPublishEvent* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetEventBus.EventbusPublishEvent";
+  }
+  protected:
+  explicit EventbusPublishEvent(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kEventTypeFieldNumber = 1,
+    kEventContentJsonFieldNumber = 2,
+  };
+  // required string event_type = 1;
+  bool has_event_type() const;
+  private:
+  bool _internal_has_event_type() const;
+  public:
+  void clear_event_type();
+  const std::string& event_type() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_event_type(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_event_type();
+  PROTOBUF_NODISCARD std::string* release_event_type();
+  void set_allocated_event_type(std::string* event_type);
+  private:
+  const std::string& _internal_event_type() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_event_type(const std::string& value);
+  std::string* _internal_mutable_event_type();
+  public:
+
+  // required string event_content_json = 2;
+  bool has_event_content_json() const;
+  private:
+  bool _internal_has_event_content_json() const;
+  public:
+  void clear_event_content_json();
+  const std::string& event_content_json() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_event_content_json(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_event_content_json();
+  PROTOBUF_NODISCARD std::string* release_event_content_json();
+  void set_allocated_event_content_json(std::string* event_content_json);
+  private:
+  const std::string& _internal_event_content_json() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_event_content_json(const std::string& value);
+  std::string* _internal_mutable_event_content_json();
+  public:
+
+  // @@protoc_insertion_point(class_scope:KismetEventBus.EventbusPublishEvent)
+ private:
+  class _Internal;
+
+  // helper for ByteSizeLong()
+  size_t RequiredFieldsByteSizeFallback() const;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr event_type_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr event_content_json_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_eventbus_2eproto;
+};
+// ===================================================================
+
+
+// ===================================================================
+
+#ifdef __GNUC__
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Wstrict-aliasing"
+#endif  // __GNUC__
+// EventbusEvent
+
+// required string event_json = 1;
+inline bool EventbusEvent::_internal_has_event_json() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  return value;
+}
+inline bool EventbusEvent::has_event_json() const {
+  return _internal_has_event_json();
+}
+inline void EventbusEvent::clear_event_json() {
+  _impl_.event_json_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000001u;
+}
+inline const std::string& EventbusEvent::event_json() const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusEvent.event_json)
+  return _internal_event_json();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void EventbusEvent::set_event_json(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000001u;
+ _impl_.event_json_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusEvent.event_json)
+}
+inline std::string* EventbusEvent::mutable_event_json() {
+  std::string* _s = _internal_mutable_event_json();
+  // @@protoc_insertion_point(field_mutable:KismetEventBus.EventbusEvent.event_json)
+  return _s;
+}
+inline const std::string& EventbusEvent::_internal_event_json() const {
+  return _impl_.event_json_.Get();
+}
+inline void EventbusEvent::_internal_set_event_json(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  _impl_.event_json_.Set(value, GetArenaForAllocation());
+}
+inline std::string* EventbusEvent::_internal_mutable_event_json() {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  return _impl_.event_json_.Mutable(GetArenaForAllocation());
+}
+inline std::string* EventbusEvent::release_event_json() {
+  // @@protoc_insertion_point(field_release:KismetEventBus.EventbusEvent.event_json)
+  if (!_internal_has_event_json()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  auto* p = _impl_.event_json_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.event_json_.IsDefault()) {
+    _impl_.event_json_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void EventbusEvent::set_allocated_event_json(std::string* event_json) {
+  if (event_json != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  _impl_.event_json_.SetAllocated(event_json, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.event_json_.IsDefault()) {
+    _impl_.event_json_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetEventBus.EventbusEvent.event_json)
+}
+
+// -------------------------------------------------------------------
+
+// EventbusBinaryField
+
+// required uint32 index = 1;
+inline bool EventbusBinaryField::_internal_has_index() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000020u) != 0;
+  return value;
+}
+inline bool EventbusBinaryField::has_index() const {
+  return _internal_has_index();
+}
+inline void EventbusBinaryField::clear_index() {
+  _impl_.index_ = 0u;
+  _impl_._has_bits_[0] &= ~0x00000020u;
+}
+inline uint32_t EventbusBinaryField::_internal_index() const {
+  return _impl_.index_;
+}
+inline uint32_t EventbusBinaryField::index() const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusBinaryField.index)
+  return _internal_index();
+}
+inline void EventbusBinaryField::_internal_set_index(uint32_t value) {
+  _impl_._has_bits_[0] |= 0x00000020u;
+  _impl_.index_ = value;
+}
+inline void EventbusBinaryField::set_index(uint32_t value) {
+  _internal_set_index(value);
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusBinaryField.index)
+}
+
+// optional sint64 int_value = 2;
+inline bool EventbusBinaryField::_internal_has_int_value() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000004u) != 0;
+  return value;
+}
+inline bool EventbusBinaryField::has_int_value() const {
+  return _internal_has_int_value();
+}
+inline void EventbusBinaryField::clear_int_value() {
+  _impl_.int_value_ = int64_t{0};
+  _impl_._has_bits_[0] &= ~0x00000004u;
+}
+inline int64_t EventbusBinaryField::_internal_int_value() const {
+  return _impl_.int_value_;
+}
+inline int64_t EventbusBinaryField::int_value() const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusBinaryField.int_value)
+  return _internal_int_value();
+}
+inline void EventbusBinaryField::_internal_set_int_value(int64_t value) {
+  _impl_._has_bits_[0] |= 0x00000004u;
+  _impl_.int_value_ = value;
+}
+inline void EventbusBinaryField::set_int_value(int64_t value) {
+  _internal_set_int_value(value);
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusBinaryField.int_value)
+}
+
+// optional uint64 uint_value = 3;
+inline bool EventbusBinaryField::_internal_has_uint_value() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000008u) != 0;
+  return value;
+}
+inline bool EventbusBinaryField::has_uint_value() const {
+  return _internal_has_uint_value();
+}
+inline void EventbusBinaryField::clear_uint_value() {
+  _impl_.uint_value_ = uint64_t{0u};
+  _impl_._has_bits_[0] &= ~0x00000008u;
+}
+inline uint64_t EventbusBinaryField::_internal_uint_value() const {
+  return _impl_.uint_value_;
+}
+inline uint64_t EventbusBinaryField::uint_value() const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusBinaryField.uint_value)
+  return _internal_uint_value();
+}
+inline void EventbusBinaryField::_internal_set_uint_value(uint64_t value) {
+  _impl_._has_bits_[0] |= 0x00000008u;
+  _impl_.uint_value_ = value;
+}
+inline void EventbusBinaryField::set_uint_value(uint64_t value) {
+  _internal_set_uint_value(value);
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusBinaryField.uint_value)
+}
+
+// optional double double_value = 4;
+inline bool EventbusBinaryField::_internal_has_double_value() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000010u) != 0;
+  return value;
+}
+inline bool EventbusBinaryField::has_double_value() const {
+  return _internal_has_double_value();
+}
+inline void EventbusBinaryField::clear_double_value() {
+  _impl_.double_value_ = 0;
+  _impl_._has_bits_[0] &= ~0x00000010u;
+}
+inline double EventbusBinaryField::_internal_double_value() const {
+  return _impl_.double_value_;
+}
+inline double EventbusBinaryField::double_value() const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusBinaryField.double_value)
+  return _internal_double_value();
+}
+inline void EventbusBinaryField::_internal_set_double_value(double value) {
+  _impl_._has_bits_[0] |= 0x00000010u;
+  _impl_.double_value_ = value;
+}
+inline void EventbusBinaryField::set_double_value(double value) {
+  _internal_set_double_value(value);
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusBinaryField.double_value)
+}
+
+// optional bytes bytes_value = 5;
+inline bool EventbusBinaryField::_internal_has_bytes_value() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  return value;
+}
+inline bool EventbusBinaryField::has_bytes_value() const {
+  return _internal_has_bytes_value();
+}
+inline void EventbusBinaryField::clear_bytes_value() {
+  _impl_.bytes_value_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000001u;
+}
+inline const std::string& EventbusBinaryField::bytes_value() const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusBinaryField.bytes_value)
+  return _internal_bytes_value();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void EventbusBinaryField::set_bytes_value(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000001u;
+ _impl_.bytes_value_.SetBytes(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusBinaryField.bytes_value)
+}
+inline std::string* EventbusBinaryField::mutable_bytes_value() {
+  std::string* _s = _internal_mutable_bytes_value();
+  // @@protoc_insertion_point(field_mutable:KismetEventBus.EventbusBinaryField.bytes_value)
+  return _s;
+}
+inline const std::string& EventbusBinaryField::_internal_bytes_value() const {
+  return _impl_.bytes_value_.Get();
+}
+inline void EventbusBinaryField::_internal_set_bytes_value(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  _impl_.bytes_value_.Set(value, GetArenaForAllocation());
+}
+inline std::string* EventbusBinaryField::_internal_mutable_bytes_value() {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  return _impl_.bytes_value_.Mutable(GetArenaForAllocation());
+}
+inline std::string* EventbusBinaryField::release_bytes_value() {
+  // @@protoc_insertion_point(field_release:KismetEventBus.EventbusBinaryField.bytes_value)
+  if (!_internal_has_bytes_value()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  auto* p = _impl_.bytes_value_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.bytes_value_.IsDefault()) {
+    _impl_.bytes_value_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void EventbusBinaryField::set_allocated_bytes_value(std::string* bytes_value) {
+  if (bytes_value != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  _impl_.bytes_value_.SetAllocated(bytes_value, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.bytes_value_.IsDefault()) {
+    _impl_.bytes_value_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetEventBus.EventbusBinaryField.bytes_value)
+}
+
+// optional string json_value = 6;
+inline bool EventbusBinaryField::_internal_has_json_value() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000002u) != 0;
+  return value;
+}
+inline bool EventbusBinaryField::has_json_value() const {
+  return _internal_has_json_value();
+}
+inline void EventbusBinaryField::clear_json_value() {
+  _impl_.json_value_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000002u;
+}
+inline const std::string& EventbusBinaryField::json_value() const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusBinaryField.json_value)
+  return _internal_json_value();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void EventbusBinaryField::set_json_value(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000002u;
+ _impl_.json_value_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusBinaryField.json_value)
+}
+inline std::string* EventbusBinaryField::mutable_json_value() {
+  std::string* _s = _internal_mutable_json_value();
+  // @@protoc_insertion_point(field_mutable:KismetEventBus.EventbusBinaryField.json_value)
+  return _s;
+}
+inline const std::string& EventbusBinaryField::_internal_json_value() const {
+  return _impl_.json_value_.Get();
+}
+inline void EventbusBinaryField::_internal_set_json_value(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000002u;
+  _impl_.json_value_.Set(value, GetArenaForAllocation());
+}
+inline std::string* EventbusBinaryField::_internal_mutable_json_value() {
+  _impl_._has_bits_[0] |= 0x00000002u;
+  return _impl_.json_value_.Mutable(GetArenaForAllocation());
+}
+inline std::string* EventbusBinaryField::release_json_value() {
+  // @@protoc_insertion_point(field_release:KismetEventBus.EventbusBinaryField.json_value)
+  if (!_internal_has_json_value()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000002u;
+  auto* p = _impl_.json_value_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.json_value_.IsDefault()) {
+    _impl_.json_value_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void EventbusBinaryField::set_allocated_json_value(std::string* json_value) {
+  if (json_value != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000002u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000002u;
+  }
+  _impl_.json_value_.SetAllocated(json_value, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.json_value_.IsDefault()) {
+    _impl_.json_value_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetEventBus.EventbusBinaryField.json_value)
+}
+
+// -------------------------------------------------------------------
+
+// EventbusBinaryEvent
+
+// required string event = 1;
+inline bool EventbusBinaryEvent::_internal_has_event() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  return value;
+}
+inline bool EventbusBinaryEvent::has_event() const {
+  return _internal_has_event();
+}
+inline void EventbusBinaryEvent::clear_event() {
+  _impl_.event_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000001u;
+}
+inline const std::string& EventbusBinaryEvent::event() const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusBinaryEvent.event)
+  return _internal_event();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void EventbusBinaryEvent::set_event(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000001u;
+ _impl_.event_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusBinaryEvent.event)
+}
+inline std::string* EventbusBinaryEvent::mutable_event() {
+  std::string* _s = _internal_mutable_event();
+  // @@protoc_insertion_point(field_mutable:KismetEventBus.EventbusBinaryEvent.event)
+  return _s;
+}
+inline const std::string& EventbusBinaryEvent::_internal_event() const {
+  return _impl_.event_.Get();
+}
+inline void EventbusBinaryEvent::_internal_set_event(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  _impl_.event_.Set(value, GetArenaForAllocation());
+}
+inline std::string* EventbusBinaryEvent::_internal_mutable_event() {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  return _impl_.event_.Mutable(GetArenaForAllocation());
+}
+inline std::string* EventbusBinaryEvent::release_event() {
+  // @@protoc_insertion_point(field_release:KismetEventBus.EventbusBinaryEvent.event)
+  if (!_internal_has_event()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  auto* p = _impl_.event_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.event_.IsDefault()) {
+    _impl_.event_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void EventbusBinaryEvent::set_allocated_event(std::string* event) {
+  if (event != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  _impl_.event_.SetAllocated(event, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.event_.IsDefault()) {
+    _impl_.event_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetEventBus.EventbusBinaryEvent.event)
+}
+
+// repeated .KismetEventBus.EventbusBinaryField field = 2;
+inline int EventbusBinaryEvent::_internal_field_size() const {
+  return _impl_.field_.size();
+}
+inline int EventbusBinaryEvent::field_size() const {
+  return _internal_field_size();
+}
+inline void EventbusBinaryEvent::clear_field() {
+  _impl_.field_.Clear();
+}
+inline ::KismetEventBus::EventbusBinaryField* EventbusBinaryEvent::mutable_field(int index) {
+  // @@protoc_insertion_point(field_mutable:KismetEventBus.EventbusBinaryEvent.field)
+  return _impl_.field_.Mutable(index);
+}
+inline ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusBinaryField >*
+EventbusBinaryEvent::mutable_field() {
+  // @@protoc_insertion_point(field_mutable_list:KismetEventBus.EventbusBinaryEvent.field)
+  return &_impl_.field_;
+}
+inline const ::KismetEventBus::EventbusBinaryField& EventbusBinaryEvent::_internal_field(int index) const {
+  return _impl_.field_.Get(index);
+}
+inline const ::KismetEventBus::EventbusBinaryField& EventbusBinaryEvent::field(int index) const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusBinaryEvent.field)
+  return _internal_field(index);
+}
+inline ::KismetEventBus::EventbusBinaryField* EventbusBinaryEvent::_internal_add_field() {
+  return _impl_.field_.Add();
+}
+inline ::KismetEventBus::EventbusBinaryField* EventbusBinaryEvent::add_field() {
+  ::KismetEventBus::EventbusBinaryField* _add = _internal_add_field();
+  // @@protoc_insertion_point(field_add:KismetEventBus.EventbusBinaryEvent.field)
+  return _add;
+}
+inline const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusBinaryField >&
+EventbusBinaryEvent::field() const {
+  // @@protoc_insertion_point(field_list:KismetEventBus.EventbusBinaryEvent.field)
+  return _impl_.field_;
+}
+
+// -------------------------------------------------------------------
+
+// EventbusFieldMatch
+
+// required string path = 1;
+inline bool EventbusFieldMatch::_internal_has_path() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  return value;
+}
+inline bool EventbusFieldMatch::has_path() const {
+  return _internal_has_path();
+}
+inline void EventbusFieldMatch::clear_path() {
+  _impl_.path_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000001u;
+}
+inline const std::string& EventbusFieldMatch::path() const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusFieldMatch.path)
+  return _internal_path();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void EventbusFieldMatch::set_path(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000001u;
+ _impl_.path_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusFieldMatch.path)
+}
+inline std::string* EventbusFieldMatch::mutable_path() {
+  std::string* _s = _internal_mutable_path();
+  // @@protoc_insertion_point(field_mutable:KismetEventBus.EventbusFieldMatch.path)
+  return _s;
+}
+inline const std::string& EventbusFieldMatch::_internal_path() const {
+  return _impl_.path_.Get();
+}
+inline void EventbusFieldMatch::_internal_set_path(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  _impl_.path_.Set(value, GetArenaForAllocation());
+}
+inline std::string* EventbusFieldMatch::_internal_mutable_path() {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  return _impl_.path_.Mutable(GetArenaForAllocation());
+}
+inline std::string* EventbusFieldMatch::release_path() {
+  // @@protoc_insertion_point(field_release:KismetEventBus.EventbusFieldMatch.path)
+  if (!_internal_has_path()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  auto* p = _impl_.path_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.path_.IsDefault()) {
+    _impl_.path_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void EventbusFieldMatch::set_allocated_path(std::string* path) {
+  if (path != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  _impl_.path_.SetAllocated(path, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.path_.IsDefault()) {
+    _impl_.path_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetEventBus.EventbusFieldMatch.path)
+}
+
+// required string value = 2;
+inline bool EventbusFieldMatch::_internal_has_value() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000002u) != 0;
+  return value;
+}
+inline bool EventbusFieldMatch::has_value() const {
+  return _internal_has_value();
+}
+inline void EventbusFieldMatch::clear_value() {
+  _impl_.value_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000002u;
+}
+inline const std::string& EventbusFieldMatch::value() const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusFieldMatch.value)
+  return _internal_value();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void EventbusFieldMatch::set_value(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000002u;
+ _impl_.value_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusFieldMatch.value)
+}
+inline std::string* EventbusFieldMatch::mutable_value() {
+  std::string* _s = _internal_mutable_value();
+  // @@protoc_insertion_point(field_mutable:KismetEventBus.EventbusFieldMatch.value)
+  return _s;
+}
+inline const std::string& EventbusFieldMatch::_internal_value() const {
+  return _impl_.value_.Get();
+}
+inline void EventbusFieldMatch::_internal_set_value(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000002u;
+  _impl_.value_.Set(value, GetArenaForAllocation());
+}
+inline std::string* EventbusFieldMatch::_internal_mutable_value() {
+  _impl_._has_bits_[0] |= 0x00000002u;
+  return _impl_.value_.Mutable(GetArenaForAllocation());
+}
+inline std::string* EventbusFieldMatch::release_value() {
+  // @@protoc_insertion_point(field_release:KismetEventBus.EventbusFieldMatch.value)
+  if (!_internal_has_value()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000002u;
+  auto* p = _impl_.value_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.value_.IsDefault()) {
+    _impl_.value_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void EventbusFieldMatch::set_allocated_value(std::string* value) {
+  if (value != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000002u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000002u;
+  }
+  _impl_.value_.SetAllocated(value, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.value_.IsDefault()) {
+    _impl_.value_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetEventBus.EventbusFieldMatch.value)
+}
+
+// -------------------------------------------------------------------
+
+// EventbusSubscription
+
+// required string event = 1;
+inline bool EventbusSubscription::_internal_has_event() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  return value;
+}
+inline bool EventbusSubscription::has_event() const {
+  return _internal_has_event();
+}
+inline void EventbusSubscription::clear_event() {
+  _impl_.event_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000001u;
+}
+inline const std::string& EventbusSubscription::event() const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusSubscription.event)
+  return _internal_event();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void EventbusSubscription::set_event(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000001u;
+ _impl_.event_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusSubscription.event)
+}
+inline std::string* EventbusSubscription::mutable_event() {
+  std::string* _s = _internal_mutable_event();
+  // @@protoc_insertion_point(field_mutable:KismetEventBus.EventbusSubscription.event)
+  return _s;
+}
+inline const std::string& EventbusSubscription::_internal_event() const {
+  return _impl_.event_.Get();
+}
+inline void EventbusSubscription::_internal_set_event(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  _impl_.event_.Set(value, GetArenaForAllocation());
+}
+inline std::string* EventbusSubscription::_internal_mutable_event() {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  return _impl_.event_.Mutable(GetArenaForAllocation());
+}
+inline std::string* EventbusSubscription::release_event() {
+  // @@protoc_insertion_point(field_release:KismetEventBus.EventbusSubscription.event)
+  if (!_internal_has_event()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  auto* p = _impl_.event_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.event_.IsDefault()) {
+    _impl_.event_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void EventbusSubscription::set_allocated_event(std::string* event) {
+  if (event != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  _impl_.event_.SetAllocated(event, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.event_.IsDefault()) {
+    _impl_.event_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetEventBus.EventbusSubscription.event)
+}
+
+// repeated .KismetEventBus.EventbusFieldMatch match = 2;
+inline int EventbusSubscription::_internal_match_size() const {
+  return _impl_.match_.size();
+}
+inline int EventbusSubscription::match_size() const {
+  return _internal_match_size();
+}
+inline void EventbusSubscription::clear_match() {
+  _impl_.match_.Clear();
+}
+inline ::KismetEventBus::EventbusFieldMatch* EventbusSubscription::mutable_match(int index) {
+  // @@protoc_insertion_point(field_mutable:KismetEventBus.EventbusSubscription.match)
+  return _impl_.match_.Mutable(index);
+}
+inline ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusFieldMatch >*
+EventbusSubscription::mutable_match() {
+  // @@protoc_insertion_point(field_mutable_list:KismetEventBus.EventbusSubscription.match)
+  return &_impl_.match_;
+}
+inline const ::KismetEventBus::EventbusFieldMatch& EventbusSubscription::_internal_match(int index) const {
+  return _impl_.match_.Get(index);
+}
+inline const ::KismetEventBus::EventbusFieldMatch& EventbusSubscription::match(int index) const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusSubscription.match)
+  return _internal_match(index);
+}
+inline ::KismetEventBus::EventbusFieldMatch* EventbusSubscription::_internal_add_match() {
+  return _impl_.match_.Add();
+}
+inline ::KismetEventBus::EventbusFieldMatch* EventbusSubscription::add_match() {
+  ::KismetEventBus::EventbusFieldMatch* _add = _internal_add_match();
+  // @@protoc_insertion_point(field_add:KismetEventBus.EventbusSubscription.match)
+  return _add;
+}
+inline const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusFieldMatch >&
+EventbusSubscription::match() const {
+  // @@protoc_insertion_point(field_list:KismetEventBus.EventbusSubscription.match)
+  return _impl_.match_;
+}
+
+// repeated string field = 3;
+inline int EventbusSubscription::_internal_field_size() const {
+  return _impl_.field_.size();
+}
+inline int EventbusSubscription::field_size() const {
+  return _internal_field_size();
+}
+inline void EventbusSubscription::clear_field() {
+  _impl_.field_.Clear();
+}
+inline std::string* EventbusSubscription::add_field() {
+  std::string* _s = _internal_add_field();
+  // @@protoc_insertion_point(field_add_mutable:KismetEventBus.EventbusSubscription.field)
+  return _s;
+}
+inline const std::string& EventbusSubscription::_internal_field(int index) const {
+  return _impl_.field_.Get(index);
+}
+inline const std::string& EventbusSubscription::field(int index) const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusSubscription.field)
+  return _internal_field(index);
+}
+inline std::string* EventbusSubscription::mutable_field(int index) {
+  // @@protoc_insertion_point(field_mutable:KismetEventBus.EventbusSubscription.field)
+  return _impl_.field_.Mutable(index);
+}
+inline void EventbusSubscription::set_field(int index, const std::string& value) {
+  _impl_.field_.Mutable(index)->assign(value);
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusSubscription.field)
+}
+inline void EventbusSubscription::set_field(int index, std::string&& value) {
+  _impl_.field_.Mutable(index)->assign(std::move(value));
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusSubscription.field)
+}
+inline void EventbusSubscription::set_field(int index, const char* value) {
+  GOOGLE_DCHECK(value != nullptr);
+  _impl_.field_.Mutable(index)->assign(value);
+  // @@protoc_insertion_point(field_set_char:KismetEventBus.EventbusSubscription.field)
+}
+inline void EventbusSubscription::set_field(int index, const char* value, size_t size) {
+  _impl_.field_.Mutable(index)->assign(
+    reinterpret_cast<const char*>(value), size);
+  // @@protoc_insertion_point(field_set_pointer:KismetEventBus.EventbusSubscription.field)
+}
+inline std::string* EventbusSubscription::_internal_add_field() {
+  return _impl_.field_.Add();
+}
+inline void EventbusSubscription::add_field(const std::string& value) {
+  _impl_.field_.Add()->assign(value);
+  // @@protoc_insertion_point(field_add:KismetEventBus.EventbusSubscription.field)
+}
+inline void EventbusSubscription::add_field(std::string&& value) {
+  _impl_.field_.Add(std::move(value));
+  // @@protoc_insertion_point(field_add:KismetEventBus.EventbusSubscription.field)
+}
+inline void EventbusSubscription::add_field(const char* value) {
+  GOOGLE_DCHECK(value != nullptr);
+  _impl_.field_.Add()->assign(value);
+  // @@protoc_insertion_point(field_add_char:KismetEventBus.EventbusSubscription.field)
+}
+inline void EventbusSubscription::add_field(const char* value, size_t size) {
+  _impl_.field_.Add()->assign(reinterpret_cast<const char*>(value), size);
+  // @@protoc_insertion_point(field_add_pointer:KismetEventBus.EventbusSubscription.field)
+}
+inline const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string>&
+EventbusSubscription::field() const {
+  // @@protoc_insertion_point(field_list:KismetEventBus.EventbusSubscription.field)
+  return _impl_.field_;
+}
+inline ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string>*
+EventbusSubscription::mutable_field() {
+  // @@protoc_insertion_point(field_mutable_list:KismetEventBus.EventbusSubscription.field)
+  return &_impl_.field_;
+}
+
+// optional bool binary = 4;
+inline bool EventbusSubscription::_internal_has_binary() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000002u) != 0;
+  return value;
+}
+inline bool EventbusSubscription::has_binary() const {
+  return _internal_has_binary();
+}
+inline void EventbusSubscription::clear_binary() {
+  _impl_.binary_ = false;
+  _impl_._has_bits_[0] &= ~0x00000002u;
+}
+inline bool EventbusSubscription::_internal_binary() const {
+  return _impl_.binary_;
+}
+inline bool EventbusSubscription::binary() const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusSubscription.binary)
+  return _internal_binary();
+}
+inline void EventbusSubscription::_internal_set_binary(bool value) {
+  _impl_._has_bits_[0] |= 0x00000002u;
+  _impl_.binary_ = value;
+}
+inline void EventbusSubscription::set_binary(bool value) {
+  _internal_set_binary(value);
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusSubscription.binary)
+}
+
+// -------------------------------------------------------------------
+
+// EventbusRegisterListener
+
+// repeated string event = 1;
+inline int EventbusRegisterListener::_internal_event_size() const {
+  return _impl_.event_.size();
+}
+inline int EventbusRegisterListener::event_size() const {
+  return _internal_event_size();
+}
+inline void EventbusRegisterListener::clear_event() {
+  _impl_.event_.Clear();
+}
+inline std::string* EventbusRegisterListener::add_event() {
+  std::string* _s = _internal_add_event();
+  // @@protoc_insertion_point(field_add_mutable:KismetEventBus.EventbusRegisterListener.event)
+  return _s;
+}
+inline const std::string& EventbusRegisterListener::_internal_event(int index) const {
+  return _impl_.event_.Get(index);
+}
+inline const std::string& EventbusRegisterListener::event(int index) const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusRegisterListener.event)
+  return _internal_event(index);
+}
+inline std::string* EventbusRegisterListener::mutable_event(int index) {
+  // @@protoc_insertion_point(field_mutable:KismetEventBus.EventbusRegisterListener.event)
+  return _impl_.event_.Mutable(index);
+}
+inline void EventbusRegisterListener::set_event(int index, const std::string& value) {
+  _impl_.event_.Mutable(index)->assign(value);
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusRegisterListener.event)
+}
+inline void EventbusRegisterListener::set_event(int index, std::string&& value) {
+  _impl_.event_.Mutable(index)->assign(std::move(value));
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusRegisterListener.event)
+}
+inline void EventbusRegisterListener::set_event(int index, const char* value) {
+  GOOGLE_DCHECK(value != nullptr);
+  _impl_.event_.Mutable(index)->assign(value);
+  // @@protoc_insertion_point(field_set_char:KismetEventBus.EventbusRegisterListener.event)
+}
+inline void EventbusRegisterListener::set_event(int index, const char* value, size_t size) {
+  _impl_.event_.Mutable(index)->assign(
+    reinterpret_cast<const char*>(value), size);
+  // @@protoc_insertion_point(field_set_pointer:KismetEventBus.EventbusRegisterListener.event)
+}
+inline std::string* EventbusRegisterListener::_internal_add_event() {
+  return _impl_.event_.Add();
+}
+inline void EventbusRegisterListener::add_event(const std::string& value) {
+  _impl_.event_.Add()->assign(value);
+  // @@protoc_insertion_point(field_add:KismetEventBus.EventbusRegisterListener.event)
+}
+inline void EventbusRegisterListener::add_event(std::string&& value) {
+  _impl_.event_.Add(std::move(value));
+  // @@protoc_insertion_point(field_add:KismetEventBus.EventbusRegisterListener.event)
+}
+inline void EventbusRegisterListener::add_event(const char* value) {
+  GOOGLE_DCHECK(value != nullptr);
+  _impl_.event_.Add()->assign(value);
+  // @@protoc_insertion_point(field_add_char:KismetEventBus.EventbusRegisterListener.event)
+}
+inline void EventbusRegisterListener::add_event(const char* value, size_t size) {
+  _impl_.event_.Add()->assign(reinterpret_cast<const char*>(value), size);
+  // @@protoc_insertion_point(field_add_pointer:KismetEventBus.EventbusRegisterListener.event)
+}
+inline const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string>&
+EventbusRegisterListener::event() const {
+  // @@protoc_insertion_point(field_list:KismetEventBus.EventbusRegisterListener.event)
+  return _impl_.event_;
+}
+inline ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string>*
+EventbusRegisterListener::mutable_event() {
+  // @@protoc_insertion_point(field_mutable_list:KismetEventBus.EventbusRegisterListener.event)
+  return &_impl_.event_;
+}
+
+// repeated .KismetEventBus.EventbusSubscription subscription = 2;
+inline int EventbusRegisterListener::_internal_subscription_size() const {
+  return _impl_.subscription_.size();
+}
+inline int EventbusRegisterListener::subscription_size() const {
+  return _internal_subscription_size();
+}
+inline void EventbusRegisterListener::clear_subscription() {
+  _impl_.subscription_.Clear();
+}
+inline ::KismetEventBus::EventbusSubscription* EventbusRegisterListener::mutable_subscription(int index) {
+  // @@protoc_insertion_point(field_mutable:KismetEventBus.EventbusRegisterListener.subscription)
+  return _impl_.subscription_.Mutable(index);
+}
+inline ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusSubscription >*
+EventbusRegisterListener::mutable_subscription() {
+  // @@protoc_insertion_point(field_mutable_list:KismetEventBus.EventbusRegisterListener.subscription)
+  return &_impl_.subscription_;
+}
+inline const ::KismetEventBus::EventbusSubscription& EventbusRegisterListener::_internal_subscription(int index) const {
+  return _impl_.subscription_.Get(index);
+}
+inline const ::KismetEventBus::EventbusSubscription& EventbusRegisterListener::subscription(int index) const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusRegisterListener.subscription)
+  return _internal_subscription(index);
+}
+inline ::KismetEventBus::EventbusSubscription* EventbusRegisterListener::_internal_add_subscription() {
+  return _impl_.subscription_.Add();
+}
+inline ::KismetEventBus::EventbusSubscription* EventbusRegisterListener::add_subscription() {
+  ::KismetEventBus::EventbusSubscription* _add = _internal_add_subscription();
+  // @@protoc_insertion_point(field_add:KismetEventBus.EventbusRegisterListener.subscription)
+  return _add;
+}
+inline const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetEventBus::EventbusSubscription >&
+EventbusRegisterListener::subscription() const {
+  // @@protoc_insertion_point(field_list:KismetEventBus.EventbusRegisterListener.subscription)
+  return _impl_.subscription_;
+}
+
+// -------------------------------------------------------------------
+
+// EventbusPublishEvent
+
+// required string event_type = 1;
+inline bool EventbusPublishEvent::_internal_has_event_type() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  return value;
+}
+inline bool EventbusPublishEvent::has_event_type() const {
+  return _internal_has_event_type();
+}
+inline void EventbusPublishEvent::clear_event_type() {
+  _impl_.event_type_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000001u;
+}
+inline const std::string& EventbusPublishEvent::event_type() const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusPublishEvent.event_type)
+  return _internal_event_type();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void EventbusPublishEvent::set_event_type(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000001u;
+ _impl_.event_type_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusPublishEvent.event_type)
+}
+inline std::string* EventbusPublishEvent::mutable_event_type() {
+  std::string* _s = _internal_mutable_event_type();
+  // @@protoc_insertion_point(field_mutable:KismetEventBus.EventbusPublishEvent.event_type)
+  return _s;
+}
+inline const std::string& EventbusPublishEvent::_internal_event_type() const {
+  return _impl_.event_type_.Get();
+}
+inline void EventbusPublishEvent::_internal_set_event_type(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  _impl_.event_type_.Set(value, GetArenaForAllocation());
+}
+inline std::string* EventbusPublishEvent::_internal_mutable_event_type() {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  return _impl_.event_type_.Mutable(GetArenaForAllocation());
+}
+inline std::string* EventbusPublishEvent::release_event_type() {
+  // @@protoc_insertion_point(field_release:KismetEventBus.EventbusPublishEvent.event_type)
+  if (!_internal_has_event_type()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  auto* p = _impl_.event_type_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.event_type_.IsDefault()) {
+    _impl_.event_type_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void EventbusPublishEvent::set_allocated_event_type(std::string* event_type) {
+  if (event_type != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  _impl_.event_type_.SetAllocated(event_type, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.event_type_.IsDefault()) {
+    _impl_.event_type_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetEventBus.EventbusPublishEvent.event_type)
+}
+
+// required string event_content_json = 2;
+inline bool EventbusPublishEvent::_internal_has_event_content_json() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000002u) != 0;
+  return value;
+}
+inline bool EventbusPublishEvent::has_event_content_json() const {
+  return _internal_has_event_content_json();
+}
+inline void EventbusPublishEvent::clear_event_content_json() {
+  _impl_.event_content_json_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000002u;
+}
+inline const std::string& EventbusPublishEvent::event_content_json() const {
+  // @@protoc_insertion_point(field_get:KismetEventBus.EventbusPublishEvent.event_content_json)
+  return _internal_event_content_json();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void EventbusPublishEvent::set_event_content_json(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000002u;
+ _impl_.event_content_json_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetEventBus.EventbusPublishEvent.event_content_json)
+}
+inline std::string* EventbusPublishEvent::mutable_event_content_json() {
+  std::string* _s = _internal_mutable_event_content_json();
+  // @@protoc_insertion_point(field_mutable:KismetEventBus.EventbusPublishEvent.event_content_json)
+  return _s;
+}
+inline const std::string& EventbusPublishEvent::_internal_event_content_json() const {
+  return _impl_.event_content_json_.Get();
+}
+inline void EventbusPublishEvent::_internal_set_event_content_json(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000002u;
+  _impl_.event_content_json_.Set(value, GetArenaForAllocation());
+}
+inline std::string* EventbusPublishEvent::_internal_mutable_event_content_json() {
+  _impl_._has_bits_[0] |= 0x00000002u;
+  return _impl_.event_content_json_.Mutable(GetArenaForAllocation());
+}
+inline std::string* EventbusPublishEvent::release_event_content_json() {
+  // @@protoc_insertion_point(field_release:KismetEventBus.EventbusPublishEvent.event_content_json)
+  if (!_internal_has_event_content_json()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000002u;
+  auto* p = _impl_.event_content_json_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.event_content_json_.IsDefault()) {
+    _impl_.event_content_json_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void EventbusPublishEvent::set_allocated_event_content_json(std::string* event_content_json) {
+  if (event_content_json != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000002u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000002u;
+  }
+  _impl_.event_content_json_.SetAllocated(event_content_json, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.event_content_json_.IsDefault()) {
+    _impl_.event_content_json_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetEventBus.EventbusPublishEvent.event_content_json)
+}
+
+#ifdef __GNUC__
+  #pragma GCC diagnostic pop
+#endif  // __GNUC__
+// -------------------------------------------------------------------
+
+// -------------------------------------------------------------------
+
+// -------------------------------------------------------------------
+
+// -------------------------------------------------------------------
+
+// -------------------------------------------------------------------
+
+// -------------------------------------------------------------------
+
+
+// @@protoc_insertion_point(namespace_scope)
+
+}  // namespace KismetEventBus
+
+// @@protoc_insertion_point(global_scope)
+
+#include <google/protobuf/port_undef.inc>
+#endif  // GOOGLE_PROTOBUF_INCLUDED_GOOGLE_PROTOBUF_INCLUDED_eventbus_2eproto
@@ -0,0 +1,1522 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+// source: kismet.proto
+
+#ifndef GOOGLE_PROTOBUF_INCLUDED_kismet_2eproto
+#define GOOGLE_PROTOBUF_INCLUDED_kismet_2eproto
+
+#include <limits>
+#include <string>
+
+#include <google/protobuf/port_def.inc>
+#if PROTOBUF_VERSION < 3021000
+#error This file was generated by a newer version of protoc which is
+#error incompatible with your Protocol Buffer headers. Please update
+#error your headers.
+#endif
+#if 3021012 < PROTOBUF_MIN_PROTOC_VERSION
+#error This file was generated by an older version of protoc which is
+#error incompatible with your Protocol Buffer headers. Please
+#error regenerate this file with a newer version of protoc.
+#endif
+
+#include <google/protobuf/port_undef.inc>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/arena.h>
+#include <google/protobuf/arenastring.h>
+#include <google/protobuf/generated_message_util.h>
+#include <google/protobuf/metadata_lite.h>
+#include <google/protobuf/message_lite.h>
+#include <google/protobuf/repeated_field.h>  // IWYU pragma: export
+#include <google/protobuf/extension_set.h>  // IWYU pragma: export
+#include <google/protobuf/generated_enum_util.h>
+// @@protoc_insertion_point(includes)
+#include <google/protobuf/port_def.inc>
+#define PROTOBUF_INTERNAL_EXPORT_kismet_2eproto
+PROTOBUF_NAMESPACE_OPEN
+namespace internal {
+class AnyMetadata;
+}  // namespace internal
+PROTOBUF_NAMESPACE_CLOSE
+
+// Internal implementation detail -- do not use these members.
+struct TableStruct_kismet_2eproto {
+  static const uint32_t offsets[];
+};
+namespace KismetExternal {
+class Command;
+struct CommandDefaultTypeInternal;
+extern CommandDefaultTypeInternal _Command_default_instance_;
+class ExternalShutdown;
+struct ExternalShutdownDefaultTypeInternal;
+extern ExternalShutdownDefaultTypeInternal _ExternalShutdown_default_instance_;
+class MsgbusMessage;
+struct MsgbusMessageDefaultTypeInternal;
+extern MsgbusMessageDefaultTypeInternal _MsgbusMessage_default_instance_;
+class Ping;
+struct PingDefaultTypeInternal;
+extern PingDefaultTypeInternal _Ping_default_instance_;
+class Pong;
+struct PongDefaultTypeInternal;
+extern PongDefaultTypeInternal _Pong_default_instance_;
+class SystemRegister;
+struct SystemRegisterDefaultTypeInternal;
+extern SystemRegisterDefaultTypeInternal _SystemRegister_default_instance_;
+}  // namespace KismetExternal
+PROTOBUF_NAMESPACE_OPEN
+template<> ::KismetExternal::Command* Arena::CreateMaybeMessage<::KismetExternal::Command>(Arena*);
+template<> ::KismetExternal::ExternalShutdown* Arena::CreateMaybeMessage<::KismetExternal::ExternalShutdown>(Arena*);
+template<> ::KismetExternal::MsgbusMessage* Arena::CreateMaybeMessage<::KismetExternal::MsgbusMessage>(Arena*);
+template<> ::KismetExternal::Ping* Arena::CreateMaybeMessage<::KismetExternal::Ping>(Arena*);
+template<> ::KismetExternal::Pong* Arena::CreateMaybeMessage<::KismetExternal::Pong>(Arena*);
+template<> ::KismetExternal::SystemRegister* Arena::CreateMaybeMessage<::KismetExternal::SystemRegister>(Arena*);
+PROTOBUF_NAMESPACE_CLOSE
+namespace KismetExternal {
+
+enum MsgbusMessage_MessageType : int {
+  MsgbusMessage_MessageType_DEBUG = 1,
+  MsgbusMessage_MessageType_INFO = 2,
+  MsgbusMessage_MessageType_ERROR = 4,
+  MsgbusMessage_MessageType_ALERT = 8,
+  MsgbusMessage_MessageType_FATAL = 16
+};
+bool MsgbusMessage_MessageType_IsValid(int value);
+constexpr MsgbusMessage_MessageType MsgbusMessage_MessageType_MessageType_MIN = MsgbusMessage_MessageType_DEBUG;
+constexpr MsgbusMessage_MessageType MsgbusMessage_MessageType_MessageType_MAX = MsgbusMessage_MessageType_FATAL;
+constexpr int MsgbusMessage_MessageType_MessageType_ARRAYSIZE = MsgbusMessage_MessageType_MessageType_MAX + 1;
+
+const std::string& MsgbusMessage_MessageType_Name(MsgbusMessage_MessageType value);
+template<typename T>
+inline const std::string& MsgbusMessage_MessageType_Name(T enum_t_value) {
+  static_assert(::std::is_same<T, MsgbusMessage_MessageType>::value ||
+    ::std::is_integral<T>::value,
+    "Incorrect type passed to function MsgbusMessage_MessageType_Name.");
+  return MsgbusMessage_MessageType_Name(static_cast<MsgbusMessage_MessageType>(enum_t_value));
+}
+bool MsgbusMessage_MessageType_Parse(
+    ::PROTOBUF_NAMESPACE_ID::ConstStringParam name, MsgbusMessage_MessageType* value);
+// ===================================================================
+
+class Command final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetExternal.Command) */ {
+ public:
+  inline Command() : Command(nullptr) {}
+  ~Command() override;
+  explicit PROTOBUF_CONSTEXPR Command(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  Command(const Command& from);
+  Command(Command&& from) noexcept
+    : Command() {
+    *this = ::std::move(from);
+  }
+
+  inline Command& operator=(const Command& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline Command& operator=(Command&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const Command& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const Command* internal_default_instance() {
+    return reinterpret_cast<const Command*>(
+               &_Command_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    0;
+
+  friend void swap(Command& a, Command& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(Command* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(Command* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  Command* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<Command>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const Command& from);
+  void MergeFrom(const Command& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(Command* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetExternal.Command";
+  }
+  protected:
+  explicit Command(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kCommandFieldNumber = 1,
+    kContentFieldNumber = 3,
+    kSeqnoFieldNumber = 2,
+  };
+  // required string command = 1;
+  bool has_command() const;
+  private:
+  bool _internal_has_command() const;
+  public:
+  void clear_command();
+  const std::string& command() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_command(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_command();
+  PROTOBUF_NODISCARD std::string* release_command();
+  void set_allocated_command(std::string* command);
+  private:
+  const std::string& _internal_command() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_command(const std::string& value);
+  std::string* _internal_mutable_command();
+  public:
+
+  // required bytes content = 3;
+  bool has_content() const;
+  private:
+  bool _internal_has_content() const;
+  public:
+  void clear_content();
+  const std::string& content() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_content(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_content();
+  PROTOBUF_NODISCARD std::string* release_content();
+  void set_allocated_content(std::string* content);
+  private:
+  const std::string& _internal_content() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_content(const std::string& value);
+  std::string* _internal_mutable_content();
+  public:
+
+  // required uint32 seqno = 2;
+  bool has_seqno() const;
+  private:
+  bool _internal_has_seqno() const;
+  public:
+  void clear_seqno();
+  uint32_t seqno() const;
+  void set_seqno(uint32_t value);
+  private:
+  uint32_t _internal_seqno() const;
+  void _internal_set_seqno(uint32_t value);
+  public:
+
+  // @@protoc_insertion_point(class_scope:KismetExternal.Command)
+ private:
+  class _Internal;
+
+  // helper for ByteSizeLong()
+  size_t RequiredFieldsByteSizeFallback() const;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr command_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr content_;
+    uint32_t seqno_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_kismet_2eproto;
+};
+// -------------------------------------------------------------------
+
+class MsgbusMessage final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetExternal.MsgbusMessage) */ {
+ public:
+  inline MsgbusMessage() : MsgbusMessage(nullptr) {}
+  ~MsgbusMessage() override;
+  explicit PROTOBUF_CONSTEXPR MsgbusMessage(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  MsgbusMessage(const MsgbusMessage& from);
+  MsgbusMessage(MsgbusMessage&& from) noexcept
+    : MsgbusMessage() {
+    *this = ::std::move(from);
+  }
+
+  inline MsgbusMessage& operator=(const MsgbusMessage& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline MsgbusMessage& operator=(MsgbusMessage&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const MsgbusMessage& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const MsgbusMessage* internal_default_instance() {
+    return reinterpret_cast<const MsgbusMessage*>(
+               &_MsgbusMessage_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    1;
+
+  friend void swap(MsgbusMessage& a, MsgbusMessage& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(MsgbusMessage* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(MsgbusMessage* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  MsgbusMessage* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<MsgbusMessage>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const MsgbusMessage& from);
+  void MergeFrom(const MsgbusMessage& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(MsgbusMessage* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetExternal.MsgbusMessage";
+  }
+  protected:
+  explicit MsgbusMessage(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  typedef MsgbusMessage_MessageType MessageType;
+  static constexpr MessageType DEBUG =
+    MsgbusMessage_MessageType_DEBUG;
+  static constexpr MessageType INFO =
+    MsgbusMessage_MessageType_INFO;
+  static constexpr MessageType ERROR =
+    MsgbusMessage_MessageType_ERROR;
+  static constexpr MessageType ALERT =
+    MsgbusMessage_MessageType_ALERT;
+  static constexpr MessageType FATAL =
+    MsgbusMessage_MessageType_FATAL;
+  static inline bool MessageType_IsValid(int value) {
+    return MsgbusMessage_MessageType_IsValid(value);
+  }
+  static constexpr MessageType MessageType_MIN =
+    MsgbusMessage_MessageType_MessageType_MIN;
+  static constexpr MessageType MessageType_MAX =
+    MsgbusMessage_MessageType_MessageType_MAX;
+  static constexpr int MessageType_ARRAYSIZE =
+    MsgbusMessage_MessageType_MessageType_ARRAYSIZE;
+  template<typename T>
+  static inline const std::string& MessageType_Name(T enum_t_value) {
+    static_assert(::std::is_same<T, MessageType>::value ||
+      ::std::is_integral<T>::value,
+      "Incorrect type passed to function MessageType_Name.");
+    return MsgbusMessage_MessageType_Name(enum_t_value);
+  }
+  static inline bool MessageType_Parse(::PROTOBUF_NAMESPACE_ID::ConstStringParam name,
+      MessageType* value) {
+    return MsgbusMessage_MessageType_Parse(name, value);
+  }
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kMsgtextFieldNumber = 2,
+    kMsgtypeFieldNumber = 1,
+  };
+  // required string msgtext = 2;
+  bool has_msgtext() const;
+  private:
+  bool _internal_has_msgtext() const;
+  public:
+  void clear_msgtext();
+  const std::string& msgtext() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_msgtext(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_msgtext();
+  PROTOBUF_NODISCARD std::string* release_msgtext();
+  void set_allocated_msgtext(std::string* msgtext);
+  private:
+  const std::string& _internal_msgtext() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_msgtext(const std::string& value);
+  std::string* _internal_mutable_msgtext();
+  public:
+
+  // required .KismetExternal.MsgbusMessage.MessageType msgtype = 1;
+  bool has_msgtype() const;
+  private:
+  bool _internal_has_msgtype() const;
+  public:
+  void clear_msgtype();
+  ::KismetExternal::MsgbusMessage_MessageType msgtype() const;
+  void set_msgtype(::KismetExternal::MsgbusMessage_MessageType value);
+  private:
+  ::KismetExternal::MsgbusMessage_MessageType _internal_msgtype() const;
+  void _internal_set_msgtype(::KismetExternal::MsgbusMessage_MessageType value);
+  public:
+
+  // @@protoc_insertion_point(class_scope:KismetExternal.MsgbusMessage)
+ private:
+  class _Internal;
+
+  // helper for ByteSizeLong()
+  size_t RequiredFieldsByteSizeFallback() const;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr msgtext_;
+    int msgtype_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_kismet_2eproto;
+};
+// -------------------------------------------------------------------
+
+class Ping final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetExternal.Ping) */ {
+ public:
+  inline Ping() : Ping(nullptr) {}
+  ~Ping() override;
+  explicit PROTOBUF_CONSTEXPR Ping(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  Ping(const Ping& from);
+  Ping(Ping&& from) noexcept
+    : Ping() {
+    *this = ::std::move(from);
+  }
+
+  inline Ping& operator=(const Ping& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline Ping& operator=(Ping&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const Ping& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const Ping* internal_default_instance() {
+    return reinterpret_cast<const Ping*>(
+               &_Ping_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    2;
+
+  friend void swap(Ping& a, Ping& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(Ping* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(Ping* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  Ping* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<Ping>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const Ping& from);
+  void MergeFrom(const Ping& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(Ping* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetExternal.Ping";
+  }
+  protected:
+  explicit Ping(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  // @@protoc_insertion_point(class_scope:KismetExternal.Ping)
+ private:
+  class _Internal;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_kismet_2eproto;
+};
+// -------------------------------------------------------------------
+
+class Pong final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetExternal.Pong) */ {
+ public:
+  inline Pong() : Pong(nullptr) {}
+  ~Pong() override;
+  explicit PROTOBUF_CONSTEXPR Pong(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  Pong(const Pong& from);
+  Pong(Pong&& from) noexcept
+    : Pong() {
+    *this = ::std::move(from);
+  }
+
+  inline Pong& operator=(const Pong& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline Pong& operator=(Pong&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const Pong& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const Pong* internal_default_instance() {
+    return reinterpret_cast<const Pong*>(
+               &_Pong_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    3;
+
+  friend void swap(Pong& a, Pong& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(Pong* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(Pong* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  Pong* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<Pong>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const Pong& from);
+  void MergeFrom(const Pong& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(Pong* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetExternal.Pong";
+  }
+  protected:
+  explicit Pong(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kPingSeqnoFieldNumber = 1,
+  };
+  // required uint32 ping_seqno = 1;
+  bool has_ping_seqno() const;
+  private:
+  bool _internal_has_ping_seqno() const;
+  public:
+  void clear_ping_seqno();
+  uint32_t ping_seqno() const;
+  void set_ping_seqno(uint32_t value);
+  private:
+  uint32_t _internal_ping_seqno() const;
+  void _internal_set_ping_seqno(uint32_t value);
+  public:
+
+  // @@protoc_insertion_point(class_scope:KismetExternal.Pong)
+ private:
+  class _Internal;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    uint32_t ping_seqno_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_kismet_2eproto;
+};
+// -------------------------------------------------------------------
+
+class ExternalShutdown final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetExternal.ExternalShutdown) */ {
+ public:
+  inline ExternalShutdown() : ExternalShutdown(nullptr) {}
+  ~ExternalShutdown() override;
+  explicit PROTOBUF_CONSTEXPR ExternalShutdown(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  ExternalShutdown(const ExternalShutdown& from);
+  ExternalShutdown(ExternalShutdown&& from) noexcept
+    : ExternalShutdown() {
+    *this = ::std::move(from);
+  }
+
+  inline ExternalShutdown& operator=(const ExternalShutdown& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline ExternalShutdown& operator=(ExternalShutdown&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const ExternalShutdown& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const ExternalShutdown* internal_default_instance() {
+    return reinterpret_cast<const ExternalShutdown*>(
+               &_ExternalShutdown_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    4;
+
+  friend void swap(ExternalShutdown& a, ExternalShutdown& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(ExternalShutdown* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(ExternalShutdown* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  ExternalShutdown* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<ExternalShutdown>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const ExternalShutdown& from);
+  void MergeFrom(const ExternalShutdown& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(ExternalShutdown* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetExternal.ExternalShutdown";
+  }
+  protected:
+  explicit ExternalShutdown(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kReasonFieldNumber = 1,
+  };
+  // required string reason = 1;
+  bool has_reason() const;
+  private:
+  bool _internal_has_reason() const;
+  public:
+  void clear_reason();
+  const std::string& reason() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_reason(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_reason();
+  PROTOBUF_NODISCARD std::string* release_reason();
+  void set_allocated_reason(std::string* reason);
+  private:
+  const std::string& _internal_reason() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_reason(const std::string& value);
+  std::string* _internal_mutable_reason();
+  public:
+
+  // @@protoc_insertion_point(class_scope:KismetExternal.ExternalShutdown)
+ private:
+  class _Internal;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr reason_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_kismet_2eproto;
+};
+// -------------------------------------------------------------------
+
+class SystemRegister final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetExternal.SystemRegister) */ {
+ public:
+  inline SystemRegister() : SystemRegister(nullptr) {}
+  ~SystemRegister() override;
+  explicit PROTOBUF_CONSTEXPR SystemRegister(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  SystemRegister(const SystemRegister& from);
+  SystemRegister(SystemRegister&& from) noexcept
+    : SystemRegister() {
+    *this = ::std::move(from);
+  }
+
+  inline SystemRegister& operator=(const SystemRegister& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline SystemRegister& operator=(SystemRegister&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const SystemRegister& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const SystemRegister* internal_default_instance() {
+    return reinterpret_cast<const SystemRegister*>(
+               &_SystemRegister_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    5;
+
+  friend void swap(SystemRegister& a, SystemRegister& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(SystemRegister* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(SystemRegister* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  SystemRegister* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<SystemRegister>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const SystemRegister& from);
+  void MergeFrom(const SystemRegister& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(SystemRegister* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetExternal.SystemRegister";
+  }
+  protected:
+  explicit SystemRegister(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kSubsystemFieldNumber = 1,
+  };
+  // required string subsystem = 1;
+  bool has_subsystem() const;
+  private:
+  bool _internal_has_subsystem() const;
+  public:
+  void clear_subsystem();
+  const std::string& subsystem() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_subsystem(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_subsystem();
+  PROTOBUF_NODISCARD std::string* release_subsystem();
+  void set_allocated_subsystem(std::string* subsystem);
+  private:
+  const std::string& _internal_subsystem() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_subsystem(const std::string& value);
+  std::string* _internal_mutable_subsystem();
+  public:
+
+  // @@protoc_insertion_point(class_scope:KismetExternal.SystemRegister)
+ private:
+  class _Internal;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr subsystem_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_kismet_2eproto;
+};
+// ===================================================================
+
+
+// ===================================================================
+
+#ifdef __GNUC__
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Wstrict-aliasing"
+#endif  // __GNUC__
+// Command
+
+// required string command = 1;
+inline bool Command::_internal_has_command() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  return value;
+}
+inline bool Command::has_command() const {
+  return _internal_has_command();
+}
+inline void Command::clear_command() {
+  _impl_.command_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000001u;
+}
+inline const std::string& Command::command() const {
+  // @@protoc_insertion_point(field_get:KismetExternal.Command.command)
+  return _internal_command();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void Command::set_command(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000001u;
+ _impl_.command_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetExternal.Command.command)
+}
+inline std::string* Command::mutable_command() {
+  std::string* _s = _internal_mutable_command();
+  // @@protoc_insertion_point(field_mutable:KismetExternal.Command.command)
+  return _s;
+}
+inline const std::string& Command::_internal_command() const {
+  return _impl_.command_.Get();
+}
+inline void Command::_internal_set_command(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  _impl_.command_.Set(value, GetArenaForAllocation());
+}
+inline std::string* Command::_internal_mutable_command() {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  return _impl_.command_.Mutable(GetArenaForAllocation());
+}
+inline std::string* Command::release_command() {
+  // @@protoc_insertion_point(field_release:KismetExternal.Command.command)
+  if (!_internal_has_command()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  auto* p = _impl_.command_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.command_.IsDefault()) {
+    _impl_.command_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void Command::set_allocated_command(std::string* command) {
+  if (command != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  _impl_.command_.SetAllocated(command, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.command_.IsDefault()) {
+    _impl_.command_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetExternal.Command.command)
+}
+
+// required uint32 seqno = 2;
+inline bool Command::_internal_has_seqno() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000004u) != 0;
+  return value;
+}
+inline bool Command::has_seqno() const {
+  return _internal_has_seqno();
+}
+inline void Command::clear_seqno() {
+  _impl_.seqno_ = 0u;
+  _impl_._has_bits_[0] &= ~0x00000004u;
+}
+inline uint32_t Command::_internal_seqno() const {
+  return _impl_.seqno_;
+}
+inline uint32_t Command::seqno() const {
+  // @@protoc_insertion_point(field_get:KismetExternal.Command.seqno)
+  return _internal_seqno();
+}
+inline void Command::_internal_set_seqno(uint32_t value) {
+  _impl_._has_bits_[0] |= 0x00000004u;
+  _impl_.seqno_ = value;
+}
+inline void Command::set_seqno(uint32_t value) {
+  _internal_set_seqno(value);
+  // @@protoc_insertion_point(field_set:KismetExternal.Command.seqno)
+}
+
+// required bytes content = 3;
+inline bool Command::_internal_has_content() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000002u) != 0;
+  return value;
+}
+inline bool Command::has_content() const {
+  return _internal_has_content();
+}
+inline void Command::clear_content() {
+  _impl_.content_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000002u;
+}
+inline const std::string& Command::content() const {
+  // @@protoc_insertion_point(field_get:KismetExternal.Command.content)
+  return _internal_content();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void Command::set_content(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000002u;
+ _impl_.content_.SetBytes(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetExternal.Command.content)
+}
+inline std::string* Command::mutable_content() {
+  std::string* _s = _internal_mutable_content();
+  // @@protoc_insertion_point(field_mutable:KismetExternal.Command.content)
+  return _s;
+}
+inline const std::string& Command::_internal_content() const {
+  return _impl_.content_.Get();
+}
+inline void Command::_internal_set_content(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000002u;
+  _impl_.content_.Set(value, GetArenaForAllocation());
+}
+inline std::string* Command::_internal_mutable_content() {
+  _impl_._has_bits_[0] |= 0x00000002u;
+  return _impl_.content_.Mutable(GetArenaForAllocation());
+}
+inline std::string* Command::release_content() {
+  // @@protoc_insertion_point(field_release:KismetExternal.Command.content)
+  if (!_internal_has_content()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000002u;
+  auto* p = _impl_.content_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.content_.IsDefault()) {
+    _impl_.content_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void Command::set_allocated_content(std::string* content) {
+  if (content != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000002u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000002u;
+  }
+  _impl_.content_.SetAllocated(content, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.content_.IsDefault()) {
+    _impl_.content_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetExternal.Command.content)
+}
+
+// -------------------------------------------------------------------
+
+// MsgbusMessage
+
+// required .KismetExternal.MsgbusMessage.MessageType msgtype = 1;
+inline bool MsgbusMessage::_internal_has_msgtype() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000002u) != 0;
+  return value;
+}
+inline bool MsgbusMessage::has_msgtype() const {
+  return _internal_has_msgtype();
+}
+inline void MsgbusMessage::clear_msgtype() {
+  _impl_.msgtype_ = 1;
+  _impl_._has_bits_[0] &= ~0x00000002u;
+}
+inline ::KismetExternal::MsgbusMessage_MessageType MsgbusMessage::_internal_msgtype() const {
+  return static_cast< ::KismetExternal::MsgbusMessage_MessageType >(_impl_.msgtype_);
+}
+inline ::KismetExternal::MsgbusMessage_MessageType MsgbusMessage::msgtype() const {
+  // @@protoc_insertion_point(field_get:KismetExternal.MsgbusMessage.msgtype)
+  return _internal_msgtype();
+}
+inline void MsgbusMessage::_internal_set_msgtype(::KismetExternal::MsgbusMessage_MessageType value) {
+  assert(::KismetExternal::MsgbusMessage_MessageType_IsValid(value));
+  _impl_._has_bits_[0] |= 0x00000002u;
+  _impl_.msgtype_ = value;
+}
+inline void MsgbusMessage::set_msgtype(::KismetExternal::MsgbusMessage_MessageType value) {
+  _internal_set_msgtype(value);
+  // @@protoc_insertion_point(field_set:KismetExternal.MsgbusMessage.msgtype)
+}
+
+// required string msgtext = 2;
+inline bool MsgbusMessage::_internal_has_msgtext() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  return value;
+}
+inline bool MsgbusMessage::has_msgtext() const {
+  return _internal_has_msgtext();
+}
+inline void MsgbusMessage::clear_msgtext() {
+  _impl_.msgtext_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000001u;
+}
+inline const std::string& MsgbusMessage::msgtext() const {
+  // @@protoc_insertion_point(field_get:KismetExternal.MsgbusMessage.msgtext)
+  return _internal_msgtext();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void MsgbusMessage::set_msgtext(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000001u;
+ _impl_.msgtext_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetExternal.MsgbusMessage.msgtext)
+}
+inline std::string* MsgbusMessage::mutable_msgtext() {
+  std::string* _s = _internal_mutable_msgtext();
+  // @@protoc_insertion_point(field_mutable:KismetExternal.MsgbusMessage.msgtext)
+  return _s;
+}
+inline const std::string& MsgbusMessage::_internal_msgtext() const {
+  return _impl_.msgtext_.Get();
+}
+inline void MsgbusMessage::_internal_set_msgtext(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  _impl_.msgtext_.Set(value, GetArenaForAllocation());
+}
+inline std::string* MsgbusMessage::_internal_mutable_msgtext() {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  return _impl_.msgtext_.Mutable(GetArenaForAllocation());
+}
+inline std::string* MsgbusMessage::release_msgtext() {
+  // @@protoc_insertion_point(field_release:KismetExternal.MsgbusMessage.msgtext)
+  if (!_internal_has_msgtext()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  auto* p = _impl_.msgtext_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.msgtext_.IsDefault()) {
+    _impl_.msgtext_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void MsgbusMessage::set_allocated_msgtext(std::string* msgtext) {
+  if (msgtext != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  _impl_.msgtext_.SetAllocated(msgtext, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.msgtext_.IsDefault()) {
+    _impl_.msgtext_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetExternal.MsgbusMessage.msgtext)
+}
+
+// -------------------------------------------------------------------
+
+// Ping
+
+// -------------------------------------------------------------------
+
+// Pong
+
+// required uint32 ping_seqno = 1;
+inline bool Pong::_internal_has_ping_seqno() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  return value;
+}
+inline bool Pong::has_ping_seqno() const {
+  return _internal_has_ping_seqno();
+}
+inline void Pong::clear_ping_seqno() {
+  _impl_.ping_seqno_ = 0u;
+  _impl_._has_bits_[0] &= ~0x00000001u;
+}
+inline uint32_t Pong::_internal_ping_seqno() const {
+  return _impl_.ping_seqno_;
+}
+inline uint32_t Pong::ping_seqno() const {
+  // @@protoc_insertion_point(field_get:KismetExternal.Pong.ping_seqno)
+  return _internal_ping_seqno();
+}
+inline void Pong::_internal_set_ping_seqno(uint32_t value) {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  _impl_.ping_seqno_ = value;
+}
+inline void Pong::set_ping_seqno(uint32_t value) {
+  _internal_set_ping_seqno(value);
+  // @@protoc_insertion_point(field_set:KismetExternal.Pong.ping_seqno)
+}
+
+// -------------------------------------------------------------------
+
+// ExternalShutdown
+
+// required string reason = 1;
+inline bool ExternalShutdown::_internal_has_reason() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  return value;
+}
+inline bool ExternalShutdown::has_reason() const {
+  return _internal_has_reason();
+}
+inline void ExternalShutdown::clear_reason() {
+  _impl_.reason_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000001u;
+}
+inline const std::string& ExternalShutdown::reason() const {
+  // @@protoc_insertion_point(field_get:KismetExternal.ExternalShutdown.reason)
+  return _internal_reason();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void ExternalShutdown::set_reason(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000001u;
+ _impl_.reason_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetExternal.ExternalShutdown.reason)
+}
+inline std::string* ExternalShutdown::mutable_reason() {
+  std::string* _s = _internal_mutable_reason();
+  // @@protoc_insertion_point(field_mutable:KismetExternal.ExternalShutdown.reason)
+  return _s;
+}
+inline const std::string& ExternalShutdown::_internal_reason() const {
+  return _impl_.reason_.Get();
+}
+inline void ExternalShutdown::_internal_set_reason(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  _impl_.reason_.Set(value, GetArenaForAllocation());
+}
+inline std::string* ExternalShutdown::_internal_mutable_reason() {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  return _impl_.reason_.Mutable(GetArenaForAllocation());
+}
+inline std::string* ExternalShutdown::release_reason() {
+  // @@protoc_insertion_point(field_release:KismetExternal.ExternalShutdown.reason)
+  if (!_internal_has_reason()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  auto* p = _impl_.reason_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.reason_.IsDefault()) {
+    _impl_.reason_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void ExternalShutdown::set_allocated_reason(std::string* reason) {
+  if (reason != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  _impl_.reason_.SetAllocated(reason, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.reason_.IsDefault()) {
+    _impl_.reason_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetExternal.ExternalShutdown.reason)
+}
+
+// -------------------------------------------------------------------
+
+// SystemRegister
+
+// required string subsystem = 1;
+inline bool SystemRegister::_internal_has_subsystem() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  return value;
+}
+inline bool SystemRegister::has_subsystem() const {
+  return _internal_has_subsystem();
+}
+inline void SystemRegister::clear_subsystem() {
+  _impl_.subsystem_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000001u;
+}
+inline const std::string& SystemRegister::subsystem() const {
+  // @@protoc_insertion_point(field_get:KismetExternal.SystemRegister.subsystem)
+  return _internal_subsystem();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void SystemRegister::set_subsystem(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000001u;
+ _impl_.subsystem_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetExternal.SystemRegister.subsystem)
+}
+inline std::string* SystemRegister::mutable_subsystem() {
+  std::string* _s = _internal_mutable_subsystem();
+  // @@protoc_insertion_point(field_mutable:KismetExternal.SystemRegister.subsystem)
+  return _s;
+}
+inline const std::string& SystemRegister::_internal_subsystem() const {
+  return _impl_.subsystem_.Get();
+}
+inline void SystemRegister::_internal_set_subsystem(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  _impl_.subsystem_.Set(value, GetArenaForAllocation());
+}
+inline std::string* SystemRegister::_internal_mutable_subsystem() {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  return _impl_.subsystem_.Mutable(GetArenaForAllocation());
+}
+inline std::string* SystemRegister::release_subsystem() {
+  // @@protoc_insertion_point(field_release:KismetExternal.SystemRegister.subsystem)
+  if (!_internal_has_subsystem()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  auto* p = _impl_.subsystem_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.subsystem_.IsDefault()) {
+    _impl_.subsystem_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void SystemRegister::set_allocated_subsystem(std::string* subsystem) {
+  if (subsystem != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  _impl_.subsystem_.SetAllocated(subsystem, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.subsystem_.IsDefault()) {
+    _impl_.subsystem_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetExternal.SystemRegister.subsystem)
+}
+
+#ifdef __GNUC__
+  #pragma GCC diagnostic pop
+#endif  // __GNUC__
+// -------------------------------------------------------------------
+
+// -------------------------------------------------------------------
+
+// -------------------------------------------------------------------
+
+// -------------------------------------------------------------------
+
+// -------------------------------------------------------------------
+
+
+// @@protoc_insertion_point(namespace_scope)
+
+}  // namespace KismetExternal
+
+PROTOBUF_NAMESPACE_OPEN
+
+template <> struct is_proto_enum< ::KismetExternal::MsgbusMessage_MessageType> : ::std::true_type {};
+
+PROTOBUF_NAMESPACE_CLOSE
+
+// @@protoc_insertion_point(global_scope)
+
+#include <google/protobuf/port_undef.inc>
+#endif  // GOOGLE_PROTOBUF_INCLUDED_GOOGLE_PROTOBUF_INCLUDED_kismet_2eproto
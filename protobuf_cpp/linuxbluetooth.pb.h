@@ -0,0 +1,2234 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+// source: linuxbluetooth.proto
+
+#ifndef GOOGLE_PROTOBUF_INCLUDED_linuxbluetooth_2eproto
+#define GOOGLE_PROTOBUF_INCLUDED_linuxbluetooth_2eproto
+
+#include <limits>
+#include <string>
+
+#include <google/protobuf/port_def.inc>
+#if PROTOBUF_VERSION < 3021000
+#error This file was generated by a newer version of protoc which is
+#error incompatible with your Protocol Buffer headers. Please update
+#error your headers.
+#endif
+#if 3021012 < PROTOBUF_MIN_PROTOC_VERSION
+#error This file was generated by an older version of protoc which is
+#error incompatible with your Protocol Buffer headers. Please
+#error regenerate this file with a newer version of protoc.
+#endif
+
+#include <google/protobuf/port_undef.inc>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/arena.h>
+#include <google/protobuf/arenastring.h>
+#include <google/protobuf/generated_message_util.h>
+#include <google/protobuf/metadata_lite.h>
+#include <google/protobuf/message_lite.h>
+#include <google/protobuf/repeated_field.h>  // IWYU pragma: export
+#include <google/protobuf/extension_set.h>  // IWYU pragma: export
+#include "kismet.pb.h"
+#include "datasource.pb.h"
+// @@protoc_insertion_point(includes)
+#include <google/protobuf/port_def.inc>
+#define PROTOBUF_INTERNAL_EXPORT_linuxbluetooth_2eproto
+PROTOBUF_NAMESPACE_OPEN
+namespace internal {
+class AnyMetadata;
+}  // namespace internal
+PROTOBUF_NAMESPACE_CLOSE
+
+// Internal implementation detail -- do not use these members.
+struct TableStruct_linuxbluetooth_2eproto {
+  static const uint32_t offsets[];
+};
+namespace KismetLinuxBluetooth {
+class LinuxBluetoothAdvertReport;
+struct LinuxBluetoothAdvertReportDefaultTypeInternal;
+extern LinuxBluetoothAdvertReportDefaultTypeInternal _LinuxBluetoothAdvertReport_default_instance_;
+class LinuxBluetoothDataReport;
+struct LinuxBluetoothDataReportDefaultTypeInternal;
+extern LinuxBluetoothDataReportDefaultTypeInternal _LinuxBluetoothDataReport_default_instance_;
+class SubLinuxBluetoothAdvert;
+struct SubLinuxBluetoothAdvertDefaultTypeInternal;
+extern SubLinuxBluetoothAdvertDefaultTypeInternal _SubLinuxBluetoothAdvert_default_instance_;
+class SubLinuxBluetoothDevice;
+struct SubLinuxBluetoothDeviceDefaultTypeInternal;
+extern SubLinuxBluetoothDeviceDefaultTypeInternal _SubLinuxBluetoothDevice_default_instance_;
+}  // namespace KismetLinuxBluetooth
+PROTOBUF_NAMESPACE_OPEN
+template<> ::KismetLinuxBluetooth::LinuxBluetoothAdvertReport* Arena::CreateMaybeMessage<::KismetLinuxBluetooth::LinuxBluetoothAdvertReport>(Arena*);
+template<> ::KismetLinuxBluetooth::LinuxBluetoothDataReport* Arena::CreateMaybeMessage<::KismetLinuxBluetooth::LinuxBluetoothDataReport>(Arena*);
+template<> ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert* Arena::CreateMaybeMessage<::KismetLinuxBluetooth::SubLinuxBluetoothAdvert>(Arena*);
+template<> ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* Arena::CreateMaybeMessage<::KismetLinuxBluetooth::SubLinuxBluetoothDevice>(Arena*);
+PROTOBUF_NAMESPACE_CLOSE
+namespace KismetLinuxBluetooth {
+
+// ===================================================================
+
+class SubLinuxBluetoothDevice final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetLinuxBluetooth.SubLinuxBluetoothDevice) */ {
+ public:
+  inline SubLinuxBluetoothDevice() : SubLinuxBluetoothDevice(nullptr) {}
+  ~SubLinuxBluetoothDevice() override;
+  explicit PROTOBUF_CONSTEXPR SubLinuxBluetoothDevice(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  SubLinuxBluetoothDevice(const SubLinuxBluetoothDevice& from);
+  SubLinuxBluetoothDevice(SubLinuxBluetoothDevice&& from) noexcept
+    : SubLinuxBluetoothDevice() {
+    *this = ::std::move(from);
+  }
+
+  inline SubLinuxBluetoothDevice& operator=(const SubLinuxBluetoothDevice& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline SubLinuxBluetoothDevice& operator=(SubLinuxBluetoothDevice&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const SubLinuxBluetoothDevice& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const SubLinuxBluetoothDevice* internal_default_instance() {
+    return reinterpret_cast<const SubLinuxBluetoothDevice*>(
+               &_SubLinuxBluetoothDevice_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    0;
+
+  friend void swap(SubLinuxBluetoothDevice& a, SubLinuxBluetoothDevice& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(SubLinuxBluetoothDevice* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(SubLinuxBluetoothDevice* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  SubLinuxBluetoothDevice* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<SubLinuxBluetoothDevice>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const SubLinuxBluetoothDevice& from);
+  void MergeFrom(const SubLinuxBluetoothDevice& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(SubLinuxBluetoothDevice* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetLinuxBluetooth.SubLinuxBluetoothDevice";
+  }
+  protected:
+  explicit SubLinuxBluetoothDevice(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kUuidListFieldNumber = 7,
+    kAddressFieldNumber = 3,
+    kNameFieldNumber = 4,
+    kTimeSecFieldNumber = 1,
+    kTimeUsecFieldNumber = 2,
+    kTxpowerFieldNumber = 5,
+    kTypeFieldNumber = 6,
+  };
+  // repeated string uuid_list = 7;
+  int uuid_list_size() const;
+  private:
+  int _internal_uuid_list_size() const;
+  public:
+  void clear_uuid_list();
+  const std::string& uuid_list(int index) const;
+  std::string* mutable_uuid_list(int index);
+  void set_uuid_list(int index, const std::string& value);
+  void set_uuid_list(int index, std::string&& value);
+  void set_uuid_list(int index, const char* value);
+  void set_uuid_list(int index, const char* value, size_t size);
+  std::string* add_uuid_list();
+  void add_uuid_list(const std::string& value);
+  void add_uuid_list(std::string&& value);
+  void add_uuid_list(const char* value);
+  void add_uuid_list(const char* value, size_t size);
+  const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string>& uuid_list() const;
+  ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string>* mutable_uuid_list();
+  private:
+  const std::string& _internal_uuid_list(int index) const;
+  std::string* _internal_add_uuid_list();
+  public:
+
+  // required string address = 3;
+  bool has_address() const;
+  private:
+  bool _internal_has_address() const;
+  public:
+  void clear_address();
+  const std::string& address() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_address(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_address();
+  PROTOBUF_NODISCARD std::string* release_address();
+  void set_allocated_address(std::string* address);
+  private:
+  const std::string& _internal_address() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_address(const std::string& value);
+  std::string* _internal_mutable_address();
+  public:
+
+  // required string name = 4;
+  bool has_name() const;
+  private:
+  bool _internal_has_name() const;
+  public:
+  void clear_name();
+  const std::string& name() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_name(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_name();
+  PROTOBUF_NODISCARD std::string* release_name();
+  void set_allocated_name(std::string* name);
+  private:
+  const std::string& _internal_name() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_name(const std::string& value);
+  std::string* _internal_mutable_name();
+  public:
+
+  // required uint64 time_sec = 1;
+  bool has_time_sec() const;
+  private:
+  bool _internal_has_time_sec() const;
+  public:
+  void clear_time_sec();
+  uint64_t time_sec() const;
+  void set_time_sec(uint64_t value);
+  private:
+  uint64_t _internal_time_sec() const;
+  void _internal_set_time_sec(uint64_t value);
+  public:
+
+  // required uint64 time_usec = 2;
+  bool has_time_usec() const;
+  private:
+  bool _internal_has_time_usec() const;
+  public:
+  void clear_time_usec();
+  uint64_t time_usec() const;
+  void set_time_usec(uint64_t value);
+  private:
+  uint64_t _internal_time_usec() const;
+  void _internal_set_time_usec(uint64_t value);
+  public:
+
+  // required int32 txpower = 5;
+  bool has_txpower() const;
+  private:
+  bool _internal_has_txpower() const;
+  public:
+  void clear_txpower();
+  int32_t txpower() const;
+  void set_txpower(int32_t value);
+  private:
+  int32_t _internal_txpower() const;
+  void _internal_set_txpower(int32_t value);
+  public:
+
+  // required int32 type = 6;
+  bool has_type() const;
+  private:
+  bool _internal_has_type() const;
+  public:
+  void clear_type();
+  int32_t type() const;
+  void set_type(int32_t value);
+  private:
+  int32_t _internal_type() const;
+  void _internal_set_type(int32_t value);
+  public:
+
+  // @@protoc_insertion_point(class_scope:KismetLinuxBluetooth.SubLinuxBluetoothDevice)
+ private:
+  class _Internal;
+
+  // helper for ByteSizeLong()
+  size_t RequiredFieldsByteSizeFallback() const;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string> uuid_list_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr address_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr name_;
+    uint64_t time_sec_;
+    uint64_t time_usec_;
+    int32_t txpower_;
+    int32_t type_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_linuxbluetooth_2eproto;
+};
+// -------------------------------------------------------------------
+
+class LinuxBluetoothDataReport final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetLinuxBluetooth.LinuxBluetoothDataReport) */ {
+ public:
+  inline LinuxBluetoothDataReport() : LinuxBluetoothDataReport(nullptr) {}
+  ~LinuxBluetoothDataReport() override;
+  explicit PROTOBUF_CONSTEXPR LinuxBluetoothDataReport(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  LinuxBluetoothDataReport(const LinuxBluetoothDataReport& from);
+  LinuxBluetoothDataReport(LinuxBluetoothDataReport&& from) noexcept
+    : LinuxBluetoothDataReport() {
+    *this = ::std::move(from);
+  }
+
+  inline LinuxBluetoothDataReport& operator=(const LinuxBluetoothDataReport& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline LinuxBluetoothDataReport& operator=(LinuxBluetoothDataReport&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const LinuxBluetoothDataReport& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const LinuxBluetoothDataReport* internal_default_instance() {
+    return reinterpret_cast<const LinuxBluetoothDataReport*>(
+               &_LinuxBluetoothDataReport_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    1;
+
+  friend void swap(LinuxBluetoothDataReport& a, LinuxBluetoothDataReport& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(LinuxBluetoothDataReport* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(LinuxBluetoothDataReport* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  LinuxBluetoothDataReport* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<LinuxBluetoothDataReport>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const LinuxBluetoothDataReport& from);
+  void MergeFrom(const LinuxBluetoothDataReport& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(LinuxBluetoothDataReport* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetLinuxBluetooth.LinuxBluetoothDataReport";
+  }
+  protected:
+  explicit LinuxBluetoothDataReport(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kWarningFieldNumber = 3,
+    kGpsFieldNumber = 1,
+    kMessageFieldNumber = 2,
+    kSignalFieldNumber = 4,
+    kBtdeviceFieldNumber = 5,
+  };
+  // optional string warning = 3;
+  bool has_warning() const;
+  private:
+  bool _internal_has_warning() const;
+  public:
+  void clear_warning();
+  const std::string& warning() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_warning(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_warning();
+  PROTOBUF_NODISCARD std::string* release_warning();
+  void set_allocated_warning(std::string* warning);
+  private:
+  const std::string& _internal_warning() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_warning(const std::string& value);
+  std::string* _internal_mutable_warning();
+  public:
+
+  // optional .KismetDatasource.SubGps gps = 1;
+  bool has_gps() const;
+  private:
+  bool _internal_has_gps() const;
+  public:
+  void clear_gps();
+  const ::KismetDatasource::SubGps& gps() const;
+  PROTOBUF_NODISCARD ::KismetDatasource::SubGps* release_gps();
+  ::KismetDatasource::SubGps* mutable_gps();
+  void set_allocated_gps(::KismetDatasource::SubGps* gps);
+  private:
+  const ::KismetDatasource::SubGps& _internal_gps() const;
+  ::KismetDatasource::SubGps* _internal_mutable_gps();
+  public:
+  void unsafe_arena_set_allocated_gps(
+      ::KismetDatasource::SubGps* gps);
+  ::KismetDatasource::SubGps* unsafe_arena_release_gps();
+
+  // optional .KismetExternal.MsgbusMessage message = 2;
+  bool has_message() const;
+  private:
+  bool _internal_has_message() const;
+  public:
+  void clear_message();
+  const ::KismetExternal::MsgbusMessage& message() const;
+  PROTOBUF_NODISCARD ::KismetExternal::MsgbusMessage* release_message();
+  ::KismetExternal::MsgbusMessage* mutable_message();
+  void set_allocated_message(::KismetExternal::MsgbusMessage* message);
+  private:
+  const ::KismetExternal::MsgbusMessage& _internal_message() const;
+  ::KismetExternal::MsgbusMessage* _internal_mutable_message();
+  public:
+  void unsafe_arena_set_allocated_message(
+      ::KismetExternal::MsgbusMessage* message);
+  ::KismetExternal::MsgbusMessage* unsafe_arena_release_message();
+
+  // optional .KismetDatasource.SubSignal signal = 4;
+  bool has_signal() const;
+  private:
+  bool _internal_has_signal() const;
+  public:
+  void clear_signal();
+  const ::KismetDatasource::SubSignal& signal() const;
+  PROTOBUF_NODISCARD ::KismetDatasource::SubSignal* release_signal();
+  ::KismetDatasource::SubSignal* mutable_signal();
+  void set_allocated_signal(::KismetDatasource::SubSignal* signal);
+  private:
+  const ::KismetDatasource::SubSignal& _internal_signal() const;
+  ::KismetDatasource::SubSignal* _internal_mutable_signal();
+  public:
+  void unsafe_arena_set_allocated_signal(
+      ::KismetDatasource::SubSignal* signal);
+  ::KismetDatasource::SubSignal* unsafe_arena_release_signal();
+
+  // required .KismetLinuxBluetooth.SubLinuxBluetoothDevice btdevice = 5;
+  bool has_btdevice() const;
+  private:
+  bool _internal_has_btdevice() const;
+  public:
+  void clear_btdevice();
+  const ::KismetLinuxBluetooth::SubLinuxBluetoothDevice& btdevice() const;
+  PROTOBUF_NODISCARD ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* release_btdevice();
+  ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* mutable_btdevice();
+  void set_allocated_btdevice(::KismetLinuxBluetooth::SubLinuxBluetoothDevice* btdevice);
+  private:
+  const ::KismetLinuxBluetooth::SubLinuxBluetoothDevice& _internal_btdevice() const;
+  ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* _internal_mutable_btdevice();
+  public:
+  void unsafe_arena_set_allocated_btdevice(
+      ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* btdevice);
+  ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* unsafe_arena_release_btdevice();
+
+  // @@protoc_insertion_point(class_scope:KismetLinuxBluetooth.LinuxBluetoothDataReport)
+ private:
+  class _Internal;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr warning_;
+    ::KismetDatasource::SubGps* gps_;
+    ::KismetExternal::MsgbusMessage* message_;
+    ::KismetDatasource::SubSignal* signal_;
+    ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* btdevice_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_linuxbluetooth_2eproto;
+};
+// -------------------------------------------------------------------
+
+class SubLinuxBluetoothAdvert final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetLinuxBluetooth.SubLinuxBluetoothAdvert) */ {
+ public:
+  inline SubLinuxBluetoothAdvert() : SubLinuxBluetoothAdvert(nullptr) {}
+  ~SubLinuxBluetoothAdvert() override;
+  explicit PROTOBUF_CONSTEXPR SubLinuxBluetoothAdvert(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  SubLinuxBluetoothAdvert(const SubLinuxBluetoothAdvert& from);
+  SubLinuxBluetoothAdvert(SubLinuxBluetoothAdvert&& from) noexcept
+    : SubLinuxBluetoothAdvert() {
+    *this = ::std::move(from);
+  }
+
+  inline SubLinuxBluetoothAdvert& operator=(const SubLinuxBluetoothAdvert& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline SubLinuxBluetoothAdvert& operator=(SubLinuxBluetoothAdvert&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const SubLinuxBluetoothAdvert& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const SubLinuxBluetoothAdvert* internal_default_instance() {
+    return reinterpret_cast<const SubLinuxBluetoothAdvert*>(
+               &_SubLinuxBluetoothAdvert_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    2;
+
+  friend void swap(SubLinuxBluetoothAdvert& a, SubLinuxBluetoothAdvert& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(SubLinuxBluetoothAdvert* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(SubLinuxBluetoothAdvert* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  SubLinuxBluetoothAdvert* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<SubLinuxBluetoothAdvert>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const SubLinuxBluetoothAdvert& from);
+  void MergeFrom(const SubLinuxBluetoothAdvert& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(SubLinuxBluetoothAdvert* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetLinuxBluetooth.SubLinuxBluetoothAdvert";
+  }
+  protected:
+  explicit SubLinuxBluetoothAdvert(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kAddressFieldNumber = 3,
+    kDataFieldNumber = 8,
+    kTimeSecFieldNumber = 1,
+    kTimeUsecFieldNumber = 2,
+    kTypeFieldNumber = 4,
+    kEventTypeFieldNumber = 5,
+    kRssiFieldNumber = 6,
+    kTxpowerFieldNumber = 7,
+    kCountFieldNumber = 9,
+  };
+  // required bytes address = 3;
+  bool has_address() const;
+  private:
+  bool _internal_has_address() const;
+  public:
+  void clear_address();
+  const std::string& address() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_address(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_address();
+  PROTOBUF_NODISCARD std::string* release_address();
+  void set_allocated_address(std::string* address);
+  private:
+  const std::string& _internal_address() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_address(const std::string& value);
+  std::string* _internal_mutable_address();
+  public:
+
+  // optional bytes data = 8;
+  bool has_data() const;
+  private:
+  bool _internal_has_data() const;
+  public:
+  void clear_data();
+  const std::string& data() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_data(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_data();
+  PROTOBUF_NODISCARD std::string* release_data();
+  void set_allocated_data(std::string* data);
+  private:
+  const std::string& _internal_data() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_data(const std::string& value);
+  std::string* _internal_mutable_data();
+  public:
+
+  // required uint64 time_sec = 1;
+  bool has_time_sec() const;
+  private:
+  bool _internal_has_time_sec() const;
+  public:
+  void clear_time_sec();
+  uint64_t time_sec() const;
+  void set_time_sec(uint64_t value);
+  private:
+  uint64_t _internal_time_sec() const;
+  void _internal_set_time_sec(uint64_t value);
+  public:
+
+  // required uint64 time_usec = 2;
+  bool has_time_usec() const;
+  private:
+  bool _internal_has_time_usec() const;
+  public:
+  void clear_time_usec();
+  uint64_t time_usec() const;
+  void set_time_usec(uint64_t value);
+  private:
+  uint64_t _internal_time_usec() const;
+  void _internal_set_time_usec(uint64_t value);
+  public:
+
+  // required int32 type = 4;
+  bool has_type() const;
+  private:
+  bool _internal_has_type() const;
+  public:
+  void clear_type();
+  int32_t type() const;
+  void set_type(int32_t value);
+  private:
+  int32_t _internal_type() const;
+  void _internal_set_type(int32_t value);
+  public:
+
+  // optional uint32 event_type = 5;
+  bool has_event_type() const;
+  private:
+  bool _internal_has_event_type() const;
+  public:
+  void clear_event_type();
+  uint32_t event_type() const;
+  void set_event_type(uint32_t value);
+  private:
+  uint32_t _internal_event_type() const;
+  void _internal_set_event_type(uint32_t value);
+  public:
+
+  // optional sint32 rssi = 6;
+  bool has_rssi() const;
+  private:
+  bool _internal_has_rssi() const;
+  public:
+  void clear_rssi();
+  int32_t rssi() const;
+  void set_rssi(int32_t value);
+  private:
+  int32_t _internal_rssi() const;
+  void _internal_set_rssi(int32_t value);
+  public:
+
+  // optional sint32 txpower = 7;
+  bool has_txpower() const;
+  private:
+  bool _internal_has_txpower() const;
+  public:
+  void clear_txpower();
+  int32_t txpower() const;
+  void set_txpower(int32_t value);
+  private:
+  int32_t _internal_txpower() const;
+  void _internal_set_txpower(int32_t value);
+  public:
+
+  // optional uint32 count = 9;
+  bool has_count() const;
+  private:
+  bool _internal_has_count() const;
+  public:
+  void clear_count();
+  uint32_t count() const;
+  void set_count(uint32_t value);
+  private:
+  uint32_t _internal_count() const;
+  void _internal_set_count(uint32_t value);
+  public:
+
+  // @@protoc_insertion_point(class_scope:KismetLinuxBluetooth.SubLinuxBluetoothAdvert)
+ private:
+  class _Internal;
+
+  // helper for ByteSizeLong()
+  size_t RequiredFieldsByteSizeFallback() const;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr address_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr data_;
+    uint64_t time_sec_;
+    uint64_t time_usec_;
+    int32_t type_;
+    uint32_t event_type_;
+    int32_t rssi_;
+    int32_t txpower_;
+    uint32_t count_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_linuxbluetooth_2eproto;
+};
+// -------------------------------------------------------------------
+
+class LinuxBluetoothAdvertReport final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:KismetLinuxBluetooth.LinuxBluetoothAdvertReport) */ {
+ public:
+  inline LinuxBluetoothAdvertReport() : LinuxBluetoothAdvertReport(nullptr) {}
+  ~LinuxBluetoothAdvertReport() override;
+  explicit PROTOBUF_CONSTEXPR LinuxBluetoothAdvertReport(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  LinuxBluetoothAdvertReport(const LinuxBluetoothAdvertReport& from);
+  LinuxBluetoothAdvertReport(LinuxBluetoothAdvertReport&& from) noexcept
+    : LinuxBluetoothAdvertReport() {
+    *this = ::std::move(from);
+  }
+
+  inline LinuxBluetoothAdvertReport& operator=(const LinuxBluetoothAdvertReport& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline LinuxBluetoothAdvertReport& operator=(LinuxBluetoothAdvertReport&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  inline const std::string& unknown_fields() const {
+    return _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString);
+  }
+  inline std::string* mutable_unknown_fields() {
+    return _internal_metadata_.mutable_unknown_fields<std::string>();
+  }
+
+  static const LinuxBluetoothAdvertReport& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const LinuxBluetoothAdvertReport* internal_default_instance() {
+    return reinterpret_cast<const LinuxBluetoothAdvertReport*>(
+               &_LinuxBluetoothAdvertReport_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    3;
+
+  friend void swap(LinuxBluetoothAdvertReport& a, LinuxBluetoothAdvertReport& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(LinuxBluetoothAdvertReport* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(LinuxBluetoothAdvertReport* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  LinuxBluetoothAdvertReport* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<LinuxBluetoothAdvertReport>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const LinuxBluetoothAdvertReport& from);
+  void MergeFrom(const LinuxBluetoothAdvertReport& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(LinuxBluetoothAdvertReport* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "KismetLinuxBluetooth.LinuxBluetoothAdvertReport";
+  }
+  protected:
+  explicit LinuxBluetoothAdvertReport(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kAdvertFieldNumber = 2,
+    kGpsFieldNumber = 1,
+  };
+  // repeated .KismetLinuxBluetooth.SubLinuxBluetoothAdvert advert = 2;
+  int advert_size() const;
+  private:
+  int _internal_advert_size() const;
+  public:
+  void clear_advert();
+  ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert* mutable_advert(int index);
+  ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert >*
+      mutable_advert();
+  private:
+  const ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert& _internal_advert(int index) const;
+  ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert* _internal_add_advert();
+  public:
+  const ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert& advert(int index) const;
+  ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert* add_advert();
+  const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert >&
+      advert() const;
+
+  // optional .KismetDatasource.SubGps gps = 1;
+  bool has_gps() const;
+  private:
+  bool _internal_has_gps() const;
+  public:
+  void clear_gps();
+  const ::KismetDatasource::SubGps& gps() const;
+  PROTOBUF_NODISCARD ::KismetDatasource::SubGps* release_gps();
+  ::KismetDatasource::SubGps* mutable_gps();
+  void set_allocated_gps(::KismetDatasource::SubGps* gps);
+  private:
+  const ::KismetDatasource::SubGps& _internal_gps() const;
+  ::KismetDatasource::SubGps* _internal_mutable_gps();
+  public:
+  void unsafe_arena_set_allocated_gps(
+      ::KismetDatasource::SubGps* gps);
+  ::KismetDatasource::SubGps* unsafe_arena_release_gps();
+
+  // @@protoc_insertion_point(class_scope:KismetLinuxBluetooth.LinuxBluetoothAdvertReport)
+ private:
+  class _Internal;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::HasBits<1> _has_bits_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+    ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert > advert_;
+    ::KismetDatasource::SubGps* gps_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_linuxbluetooth_2eproto;
+};
+// ===================================================================
+
+
+// ===================================================================
+
+#ifdef __GNUC__
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Wstrict-aliasing"
+#endif  // __GNUC__
+// SubLinuxBluetoothDevice
+
+// required uint64 time_sec = 1;
+inline bool SubLinuxBluetoothDevice::_internal_has_time_sec() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000004u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothDevice::has_time_sec() const {
+  return _internal_has_time_sec();
+}
+inline void SubLinuxBluetoothDevice::clear_time_sec() {
+  _impl_.time_sec_ = uint64_t{0u};
+  _impl_._has_bits_[0] &= ~0x00000004u;
+}
+inline uint64_t SubLinuxBluetoothDevice::_internal_time_sec() const {
+  return _impl_.time_sec_;
+}
+inline uint64_t SubLinuxBluetoothDevice::time_sec() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothDevice.time_sec)
+  return _internal_time_sec();
+}
+inline void SubLinuxBluetoothDevice::_internal_set_time_sec(uint64_t value) {
+  _impl_._has_bits_[0] |= 0x00000004u;
+  _impl_.time_sec_ = value;
+}
+inline void SubLinuxBluetoothDevice::set_time_sec(uint64_t value) {
+  _internal_set_time_sec(value);
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothDevice.time_sec)
+}
+
+// required uint64 time_usec = 2;
+inline bool SubLinuxBluetoothDevice::_internal_has_time_usec() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000008u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothDevice::has_time_usec() const {
+  return _internal_has_time_usec();
+}
+inline void SubLinuxBluetoothDevice::clear_time_usec() {
+  _impl_.time_usec_ = uint64_t{0u};
+  _impl_._has_bits_[0] &= ~0x00000008u;
+}
+inline uint64_t SubLinuxBluetoothDevice::_internal_time_usec() const {
+  return _impl_.time_usec_;
+}
+inline uint64_t SubLinuxBluetoothDevice::time_usec() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothDevice.time_usec)
+  return _internal_time_usec();
+}
+inline void SubLinuxBluetoothDevice::_internal_set_time_usec(uint64_t value) {
+  _impl_._has_bits_[0] |= 0x00000008u;
+  _impl_.time_usec_ = value;
+}
+inline void SubLinuxBluetoothDevice::set_time_usec(uint64_t value) {
+  _internal_set_time_usec(value);
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothDevice.time_usec)
+}
+
+// required string address = 3;
+inline bool SubLinuxBluetoothDevice::_internal_has_address() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothDevice::has_address() const {
+  return _internal_has_address();
+}
+inline void SubLinuxBluetoothDevice::clear_address() {
+  _impl_.address_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000001u;
+}
+inline const std::string& SubLinuxBluetoothDevice::address() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothDevice.address)
+  return _internal_address();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void SubLinuxBluetoothDevice::set_address(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000001u;
+ _impl_.address_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothDevice.address)
+}
+inline std::string* SubLinuxBluetoothDevice::mutable_address() {
+  std::string* _s = _internal_mutable_address();
+  // @@protoc_insertion_point(field_mutable:KismetLinuxBluetooth.SubLinuxBluetoothDevice.address)
+  return _s;
+}
+inline const std::string& SubLinuxBluetoothDevice::_internal_address() const {
+  return _impl_.address_.Get();
+}
+inline void SubLinuxBluetoothDevice::_internal_set_address(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  _impl_.address_.Set(value, GetArenaForAllocation());
+}
+inline std::string* SubLinuxBluetoothDevice::_internal_mutable_address() {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  return _impl_.address_.Mutable(GetArenaForAllocation());
+}
+inline std::string* SubLinuxBluetoothDevice::release_address() {
+  // @@protoc_insertion_point(field_release:KismetLinuxBluetooth.SubLinuxBluetoothDevice.address)
+  if (!_internal_has_address()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  auto* p = _impl_.address_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.address_.IsDefault()) {
+    _impl_.address_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void SubLinuxBluetoothDevice::set_allocated_address(std::string* address) {
+  if (address != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  _impl_.address_.SetAllocated(address, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.address_.IsDefault()) {
+    _impl_.address_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetLinuxBluetooth.SubLinuxBluetoothDevice.address)
+}
+
+// required string name = 4;
+inline bool SubLinuxBluetoothDevice::_internal_has_name() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000002u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothDevice::has_name() const {
+  return _internal_has_name();
+}
+inline void SubLinuxBluetoothDevice::clear_name() {
+  _impl_.name_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000002u;
+}
+inline const std::string& SubLinuxBluetoothDevice::name() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothDevice.name)
+  return _internal_name();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void SubLinuxBluetoothDevice::set_name(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000002u;
+ _impl_.name_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothDevice.name)
+}
+inline std::string* SubLinuxBluetoothDevice::mutable_name() {
+  std::string* _s = _internal_mutable_name();
+  // @@protoc_insertion_point(field_mutable:KismetLinuxBluetooth.SubLinuxBluetoothDevice.name)
+  return _s;
+}
+inline const std::string& SubLinuxBluetoothDevice::_internal_name() const {
+  return _impl_.name_.Get();
+}
+inline void SubLinuxBluetoothDevice::_internal_set_name(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000002u;
+  _impl_.name_.Set(value, GetArenaForAllocation());
+}
+inline std::string* SubLinuxBluetoothDevice::_internal_mutable_name() {
+  _impl_._has_bits_[0] |= 0x00000002u;
+  return _impl_.name_.Mutable(GetArenaForAllocation());
+}
+inline std::string* SubLinuxBluetoothDevice::release_name() {
+  // @@protoc_insertion_point(field_release:KismetLinuxBluetooth.SubLinuxBluetoothDevice.name)
+  if (!_internal_has_name()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000002u;
+  auto* p = _impl_.name_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.name_.IsDefault()) {
+    _impl_.name_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void SubLinuxBluetoothDevice::set_allocated_name(std::string* name) {
+  if (name != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000002u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000002u;
+  }
+  _impl_.name_.SetAllocated(name, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.name_.IsDefault()) {
+    _impl_.name_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetLinuxBluetooth.SubLinuxBluetoothDevice.name)
+}
+
+// required int32 txpower = 5;
+inline bool SubLinuxBluetoothDevice::_internal_has_txpower() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000010u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothDevice::has_txpower() const {
+  return _internal_has_txpower();
+}
+inline void SubLinuxBluetoothDevice::clear_txpower() {
+  _impl_.txpower_ = 0;
+  _impl_._has_bits_[0] &= ~0x00000010u;
+}
+inline int32_t SubLinuxBluetoothDevice::_internal_txpower() const {
+  return _impl_.txpower_;
+}
+inline int32_t SubLinuxBluetoothDevice::txpower() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothDevice.txpower)
+  return _internal_txpower();
+}
+inline void SubLinuxBluetoothDevice::_internal_set_txpower(int32_t value) {
+  _impl_._has_bits_[0] |= 0x00000010u;
+  _impl_.txpower_ = value;
+}
+inline void SubLinuxBluetoothDevice::set_txpower(int32_t value) {
+  _internal_set_txpower(value);
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothDevice.txpower)
+}
+
+// required int32 type = 6;
+inline bool SubLinuxBluetoothDevice::_internal_has_type() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000020u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothDevice::has_type() const {
+  return _internal_has_type();
+}
+inline void SubLinuxBluetoothDevice::clear_type() {
+  _impl_.type_ = 0;
+  _impl_._has_bits_[0] &= ~0x00000020u;
+}
+inline int32_t SubLinuxBluetoothDevice::_internal_type() const {
+  return _impl_.type_;
+}
+inline int32_t SubLinuxBluetoothDevice::type() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothDevice.type)
+  return _internal_type();
+}
+inline void SubLinuxBluetoothDevice::_internal_set_type(int32_t value) {
+  _impl_._has_bits_[0] |= 0x00000020u;
+  _impl_.type_ = value;
+}
+inline void SubLinuxBluetoothDevice::set_type(int32_t value) {
+  _internal_set_type(value);
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothDevice.type)
+}
+
+// repeated string uuid_list = 7;
+inline int SubLinuxBluetoothDevice::_internal_uuid_list_size() const {
+  return _impl_.uuid_list_.size();
+}
+inline int SubLinuxBluetoothDevice::uuid_list_size() const {
+  return _internal_uuid_list_size();
+}
+inline void SubLinuxBluetoothDevice::clear_uuid_list() {
+  _impl_.uuid_list_.Clear();
+}
+inline std::string* SubLinuxBluetoothDevice::add_uuid_list() {
+  std::string* _s = _internal_add_uuid_list();
+  // @@protoc_insertion_point(field_add_mutable:KismetLinuxBluetooth.SubLinuxBluetoothDevice.uuid_list)
+  return _s;
+}
+inline const std::string& SubLinuxBluetoothDevice::_internal_uuid_list(int index) const {
+  return _impl_.uuid_list_.Get(index);
+}
+inline const std::string& SubLinuxBluetoothDevice::uuid_list(int index) const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothDevice.uuid_list)
+  return _internal_uuid_list(index);
+}
+inline std::string* SubLinuxBluetoothDevice::mutable_uuid_list(int index) {
+  // @@protoc_insertion_point(field_mutable:KismetLinuxBluetooth.SubLinuxBluetoothDevice.uuid_list)
+  return _impl_.uuid_list_.Mutable(index);
+}
+inline void SubLinuxBluetoothDevice::set_uuid_list(int index, const std::string& value) {
+  _impl_.uuid_list_.Mutable(index)->assign(value);
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothDevice.uuid_list)
+}
+inline void SubLinuxBluetoothDevice::set_uuid_list(int index, std::string&& value) {
+  _impl_.uuid_list_.Mutable(index)->assign(std::move(value));
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothDevice.uuid_list)
+}
+inline void SubLinuxBluetoothDevice::set_uuid_list(int index, const char* value) {
+  GOOGLE_DCHECK(value != nullptr);
+  _impl_.uuid_list_.Mutable(index)->assign(value);
+  // @@protoc_insertion_point(field_set_char:KismetLinuxBluetooth.SubLinuxBluetoothDevice.uuid_list)
+}
+inline void SubLinuxBluetoothDevice::set_uuid_list(int index, const char* value, size_t size) {
+  _impl_.uuid_list_.Mutable(index)->assign(
+    reinterpret_cast<const char*>(value), size);
+  // @@protoc_insertion_point(field_set_pointer:KismetLinuxBluetooth.SubLinuxBluetoothDevice.uuid_list)
+}
+inline std::string* SubLinuxBluetoothDevice::_internal_add_uuid_list() {
+  return _impl_.uuid_list_.Add();
+}
+inline void SubLinuxBluetoothDevice::add_uuid_list(const std::string& value) {
+  _impl_.uuid_list_.Add()->assign(value);
+  // @@protoc_insertion_point(field_add:KismetLinuxBluetooth.SubLinuxBluetoothDevice.uuid_list)
+}
+inline void SubLinuxBluetoothDevice::add_uuid_list(std::string&& value) {
+  _impl_.uuid_list_.Add(std::move(value));
+  // @@protoc_insertion_point(field_add:KismetLinuxBluetooth.SubLinuxBluetoothDevice.uuid_list)
+}
+inline void SubLinuxBluetoothDevice::add_uuid_list(const char* value) {
+  GOOGLE_DCHECK(value != nullptr);
+  _impl_.uuid_list_.Add()->assign(value);
+  // @@protoc_insertion_point(field_add_char:KismetLinuxBluetooth.SubLinuxBluetoothDevice.uuid_list)
+}
+inline void SubLinuxBluetoothDevice::add_uuid_list(const char* value, size_t size) {
+  _impl_.uuid_list_.Add()->assign(reinterpret_cast<const char*>(value), size);
+  // @@protoc_insertion_point(field_add_pointer:KismetLinuxBluetooth.SubLinuxBluetoothDevice.uuid_list)
+}
+inline const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string>&
+SubLinuxBluetoothDevice::uuid_list() const {
+  // @@protoc_insertion_point(field_list:KismetLinuxBluetooth.SubLinuxBluetoothDevice.uuid_list)
+  return _impl_.uuid_list_;
+}
+inline ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField<std::string>*
+SubLinuxBluetoothDevice::mutable_uuid_list() {
+  // @@protoc_insertion_point(field_mutable_list:KismetLinuxBluetooth.SubLinuxBluetoothDevice.uuid_list)
+  return &_impl_.uuid_list_;
+}
+
+// -------------------------------------------------------------------
+
+// LinuxBluetoothDataReport
+
+// optional .KismetDatasource.SubGps gps = 1;
+inline bool LinuxBluetoothDataReport::_internal_has_gps() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000002u) != 0;
+  PROTOBUF_ASSUME(!value || _impl_.gps_ != nullptr);
+  return value;
+}
+inline bool LinuxBluetoothDataReport::has_gps() const {
+  return _internal_has_gps();
+}
+inline const ::KismetDatasource::SubGps& LinuxBluetoothDataReport::_internal_gps() const {
+  const ::KismetDatasource::SubGps* p = _impl_.gps_;
+  return p != nullptr ? *p : reinterpret_cast<const ::KismetDatasource::SubGps&>(
+      ::KismetDatasource::_SubGps_default_instance_);
+}
+inline const ::KismetDatasource::SubGps& LinuxBluetoothDataReport::gps() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.LinuxBluetoothDataReport.gps)
+  return _internal_gps();
+}
+inline void LinuxBluetoothDataReport::unsafe_arena_set_allocated_gps(
+    ::KismetDatasource::SubGps* gps) {
+  if (GetArenaForAllocation() == nullptr) {
+    delete reinterpret_cast<::PROTOBUF_NAMESPACE_ID::MessageLite*>(_impl_.gps_);
+  }
+  _impl_.gps_ = gps;
+  if (gps) {
+    _impl_._has_bits_[0] |= 0x00000002u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000002u;
+  }
+  // @@protoc_insertion_point(field_unsafe_arena_set_allocated:KismetLinuxBluetooth.LinuxBluetoothDataReport.gps)
+}
+inline ::KismetDatasource::SubGps* LinuxBluetoothDataReport::release_gps() {
+  _impl_._has_bits_[0] &= ~0x00000002u;
+  ::KismetDatasource::SubGps* temp = _impl_.gps_;
+  _impl_.gps_ = nullptr;
+#ifdef PROTOBUF_FORCE_COPY_IN_RELEASE
+  auto* old =  reinterpret_cast<::PROTOBUF_NAMESPACE_ID::MessageLite*>(temp);
+  temp = ::PROTOBUF_NAMESPACE_ID::internal::DuplicateIfNonNull(temp);
+  if (GetArenaForAllocation() == nullptr) { delete old; }
+#else  // PROTOBUF_FORCE_COPY_IN_RELEASE
+  if (GetArenaForAllocation() != nullptr) {
+    temp = ::PROTOBUF_NAMESPACE_ID::internal::DuplicateIfNonNull(temp);
+  }
+#endif  // !PROTOBUF_FORCE_COPY_IN_RELEASE
+  return temp;
+}
+inline ::KismetDatasource::SubGps* LinuxBluetoothDataReport::unsafe_arena_release_gps() {
+  // @@protoc_insertion_point(field_release:KismetLinuxBluetooth.LinuxBluetoothDataReport.gps)
+  _impl_._has_bits_[0] &= ~0x00000002u;
+  ::KismetDatasource::SubGps* temp = _impl_.gps_;
+  _impl_.gps_ = nullptr;
+  return temp;
+}
+inline ::KismetDatasource::SubGps* LinuxBluetoothDataReport::_internal_mutable_gps() {
+  _impl_._has_bits_[0] |= 0x00000002u;
+  if (_impl_.gps_ == nullptr) {
+    auto* p = CreateMaybeMessage<::KismetDatasource::SubGps>(GetArenaForAllocation());
+    _impl_.gps_ = p;
+  }
+  return _impl_.gps_;
+}
+inline ::KismetDatasource::SubGps* LinuxBluetoothDataReport::mutable_gps() {
+  ::KismetDatasource::SubGps* _msg = _internal_mutable_gps();
+  // @@protoc_insertion_point(field_mutable:KismetLinuxBluetooth.LinuxBluetoothDataReport.gps)
+  return _msg;
+}
+inline void LinuxBluetoothDataReport::set_allocated_gps(::KismetDatasource::SubGps* gps) {
+  ::PROTOBUF_NAMESPACE_ID::Arena* message_arena = GetArenaForAllocation();
+  if (message_arena == nullptr) {
+    delete reinterpret_cast< ::PROTOBUF_NAMESPACE_ID::MessageLite*>(_impl_.gps_);
+  }
+  if (gps) {
+    ::PROTOBUF_NAMESPACE_ID::Arena* submessage_arena =
+        ::PROTOBUF_NAMESPACE_ID::Arena::InternalGetOwningArena(
+                reinterpret_cast<::PROTOBUF_NAMESPACE_ID::MessageLite*>(gps));
+    if (message_arena != submessage_arena) {
+      gps = ::PROTOBUF_NAMESPACE_ID::internal::GetOwnedMessage(
+          message_arena, gps, submessage_arena);
+    }
+    _impl_._has_bits_[0] |= 0x00000002u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000002u;
+  }
+  _impl_.gps_ = gps;
+  // @@protoc_insertion_point(field_set_allocated:KismetLinuxBluetooth.LinuxBluetoothDataReport.gps)
+}
+
+// optional .KismetExternal.MsgbusMessage message = 2;
+inline bool LinuxBluetoothDataReport::_internal_has_message() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000004u) != 0;
+  PROTOBUF_ASSUME(!value || _impl_.message_ != nullptr);
+  return value;
+}
+inline bool LinuxBluetoothDataReport::has_message() const {
+  return _internal_has_message();
+}
+inline const ::KismetExternal::MsgbusMessage& LinuxBluetoothDataReport::_internal_message() const {
+  const ::KismetExternal::MsgbusMessage* p = _impl_.message_;
+  return p != nullptr ? *p : reinterpret_cast<const ::KismetExternal::MsgbusMessage&>(
+      ::KismetExternal::_MsgbusMessage_default_instance_);
+}
+inline const ::KismetExternal::MsgbusMessage& LinuxBluetoothDataReport::message() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.LinuxBluetoothDataReport.message)
+  return _internal_message();
+}
+inline void LinuxBluetoothDataReport::unsafe_arena_set_allocated_message(
+    ::KismetExternal::MsgbusMessage* message) {
+  if (GetArenaForAllocation() == nullptr) {
+    delete reinterpret_cast<::PROTOBUF_NAMESPACE_ID::MessageLite*>(_impl_.message_);
+  }
+  _impl_.message_ = message;
+  if (message) {
+    _impl_._has_bits_[0] |= 0x00000004u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000004u;
+  }
+  // @@protoc_insertion_point(field_unsafe_arena_set_allocated:KismetLinuxBluetooth.LinuxBluetoothDataReport.message)
+}
+inline ::KismetExternal::MsgbusMessage* LinuxBluetoothDataReport::release_message() {
+  _impl_._has_bits_[0] &= ~0x00000004u;
+  ::KismetExternal::MsgbusMessage* temp = _impl_.message_;
+  _impl_.message_ = nullptr;
+#ifdef PROTOBUF_FORCE_COPY_IN_RELEASE
+  auto* old =  reinterpret_cast<::PROTOBUF_NAMESPACE_ID::MessageLite*>(temp);
+  temp = ::PROTOBUF_NAMESPACE_ID::internal::DuplicateIfNonNull(temp);
+  if (GetArenaForAllocation() == nullptr) { delete old; }
+#else  // PROTOBUF_FORCE_COPY_IN_RELEASE
+  if (GetArenaForAllocation() != nullptr) {
+    temp = ::PROTOBUF_NAMESPACE_ID::internal::DuplicateIfNonNull(temp);
+  }
+#endif  // !PROTOBUF_FORCE_COPY_IN_RELEASE
+  return temp;
+}
+inline ::KismetExternal::MsgbusMessage* LinuxBluetoothDataReport::unsafe_arena_release_message() {
+  // @@protoc_insertion_point(field_release:KismetLinuxBluetooth.LinuxBluetoothDataReport.message)
+  _impl_._has_bits_[0] &= ~0x00000004u;
+  ::KismetExternal::MsgbusMessage* temp = _impl_.message_;
+  _impl_.message_ = nullptr;
+  return temp;
+}
+inline ::KismetExternal::MsgbusMessage* LinuxBluetoothDataReport::_internal_mutable_message() {
+  _impl_._has_bits_[0] |= 0x00000004u;
+  if (_impl_.message_ == nullptr) {
+    auto* p = CreateMaybeMessage<::KismetExternal::MsgbusMessage>(GetArenaForAllocation());
+    _impl_.message_ = p;
+  }
+  return _impl_.message_;
+}
+inline ::KismetExternal::MsgbusMessage* LinuxBluetoothDataReport::mutable_message() {
+  ::KismetExternal::MsgbusMessage* _msg = _internal_mutable_message();
+  // @@protoc_insertion_point(field_mutable:KismetLinuxBluetooth.LinuxBluetoothDataReport.message)
+  return _msg;
+}
+inline void LinuxBluetoothDataReport::set_allocated_message(::KismetExternal::MsgbusMessage* message) {
+  ::PROTOBUF_NAMESPACE_ID::Arena* message_arena = GetArenaForAllocation();
+  if (message_arena == nullptr) {
+    delete reinterpret_cast< ::PROTOBUF_NAMESPACE_ID::MessageLite*>(_impl_.message_);
+  }
+  if (message) {
+    ::PROTOBUF_NAMESPACE_ID::Arena* submessage_arena =
+        ::PROTOBUF_NAMESPACE_ID::Arena::InternalGetOwningArena(
+                reinterpret_cast<::PROTOBUF_NAMESPACE_ID::MessageLite*>(message));
+    if (message_arena != submessage_arena) {
+      message = ::PROTOBUF_NAMESPACE_ID::internal::GetOwnedMessage(
+          message_arena, message, submessage_arena);
+    }
+    _impl_._has_bits_[0] |= 0x00000004u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000004u;
+  }
+  _impl_.message_ = message;
+  // @@protoc_insertion_point(field_set_allocated:KismetLinuxBluetooth.LinuxBluetoothDataReport.message)
+}
+
+// optional string warning = 3;
+inline bool LinuxBluetoothDataReport::_internal_has_warning() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  return value;
+}
+inline bool LinuxBluetoothDataReport::has_warning() const {
+  return _internal_has_warning();
+}
+inline void LinuxBluetoothDataReport::clear_warning() {
+  _impl_.warning_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000001u;
+}
+inline const std::string& LinuxBluetoothDataReport::warning() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.LinuxBluetoothDataReport.warning)
+  return _internal_warning();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void LinuxBluetoothDataReport::set_warning(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000001u;
+ _impl_.warning_.Set(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.LinuxBluetoothDataReport.warning)
+}
+inline std::string* LinuxBluetoothDataReport::mutable_warning() {
+  std::string* _s = _internal_mutable_warning();
+  // @@protoc_insertion_point(field_mutable:KismetLinuxBluetooth.LinuxBluetoothDataReport.warning)
+  return _s;
+}
+inline const std::string& LinuxBluetoothDataReport::_internal_warning() const {
+  return _impl_.warning_.Get();
+}
+inline void LinuxBluetoothDataReport::_internal_set_warning(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  _impl_.warning_.Set(value, GetArenaForAllocation());
+}
+inline std::string* LinuxBluetoothDataReport::_internal_mutable_warning() {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  return _impl_.warning_.Mutable(GetArenaForAllocation());
+}
+inline std::string* LinuxBluetoothDataReport::release_warning() {
+  // @@protoc_insertion_point(field_release:KismetLinuxBluetooth.LinuxBluetoothDataReport.warning)
+  if (!_internal_has_warning()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  auto* p = _impl_.warning_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.warning_.IsDefault()) {
+    _impl_.warning_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void LinuxBluetoothDataReport::set_allocated_warning(std::string* warning) {
+  if (warning != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  _impl_.warning_.SetAllocated(warning, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.warning_.IsDefault()) {
+    _impl_.warning_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetLinuxBluetooth.LinuxBluetoothDataReport.warning)
+}
+
+// optional .KismetDatasource.SubSignal signal = 4;
+inline bool LinuxBluetoothDataReport::_internal_has_signal() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000008u) != 0;
+  PROTOBUF_ASSUME(!value || _impl_.signal_ != nullptr);
+  return value;
+}
+inline bool LinuxBluetoothDataReport::has_signal() const {
+  return _internal_has_signal();
+}
+inline const ::KismetDatasource::SubSignal& LinuxBluetoothDataReport::_internal_signal() const {
+  const ::KismetDatasource::SubSignal* p = _impl_.signal_;
+  return p != nullptr ? *p : reinterpret_cast<const ::KismetDatasource::SubSignal&>(
+      ::KismetDatasource::_SubSignal_default_instance_);
+}
+inline const ::KismetDatasource::SubSignal& LinuxBluetoothDataReport::signal() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.LinuxBluetoothDataReport.signal)
+  return _internal_signal();
+}
+inline void LinuxBluetoothDataReport::unsafe_arena_set_allocated_signal(
+    ::KismetDatasource::SubSignal* signal) {
+  if (GetArenaForAllocation() == nullptr) {
+    delete reinterpret_cast<::PROTOBUF_NAMESPACE_ID::MessageLite*>(_impl_.signal_);
+  }
+  _impl_.signal_ = signal;
+  if (signal) {
+    _impl_._has_bits_[0] |= 0x00000008u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000008u;
+  }
+  // @@protoc_insertion_point(field_unsafe_arena_set_allocated:KismetLinuxBluetooth.LinuxBluetoothDataReport.signal)
+}
+inline ::KismetDatasource::SubSignal* LinuxBluetoothDataReport::release_signal() {
+  _impl_._has_bits_[0] &= ~0x00000008u;
+  ::KismetDatasource::SubSignal* temp = _impl_.signal_;
+  _impl_.signal_ = nullptr;
+#ifdef PROTOBUF_FORCE_COPY_IN_RELEASE
+  auto* old =  reinterpret_cast<::PROTOBUF_NAMESPACE_ID::MessageLite*>(temp);
+  temp = ::PROTOBUF_NAMESPACE_ID::internal::DuplicateIfNonNull(temp);
+  if (GetArenaForAllocation() == nullptr) { delete old; }
+#else  // PROTOBUF_FORCE_COPY_IN_RELEASE
+  if (GetArenaForAllocation() != nullptr) {
+    temp = ::PROTOBUF_NAMESPACE_ID::internal::DuplicateIfNonNull(temp);
+  }
+#endif  // !PROTOBUF_FORCE_COPY_IN_RELEASE
+  return temp;
+}
+inline ::KismetDatasource::SubSignal* LinuxBluetoothDataReport::unsafe_arena_release_signal() {
+  // @@protoc_insertion_point(field_release:KismetLinuxBluetooth.LinuxBluetoothDataReport.signal)
+  _impl_._has_bits_[0] &= ~0x00000008u;
+  ::KismetDatasource::SubSignal* temp = _impl_.signal_;
+  _impl_.signal_ = nullptr;
+  return temp;
+}
+inline ::KismetDatasource::SubSignal* LinuxBluetoothDataReport::_internal_mutable_signal() {
+  _impl_._has_bits_[0] |= 0x00000008u;
+  if (_impl_.signal_ == nullptr) {
+    auto* p = CreateMaybeMessage<::KismetDatasource::SubSignal>(GetArenaForAllocation());
+    _impl_.signal_ = p;
+  }
+  return _impl_.signal_;
+}
+inline ::KismetDatasource::SubSignal* LinuxBluetoothDataReport::mutable_signal() {
+  ::KismetDatasource::SubSignal* _msg = _internal_mutable_signal();
+  // @@protoc_insertion_point(field_mutable:KismetLinuxBluetooth.LinuxBluetoothDataReport.signal)
+  return _msg;
+}
+inline void LinuxBluetoothDataReport::set_allocated_signal(::KismetDatasource::SubSignal* signal) {
+  ::PROTOBUF_NAMESPACE_ID::Arena* message_arena = GetArenaForAllocation();
+  if (message_arena == nullptr) {
+    delete reinterpret_cast< ::PROTOBUF_NAMESPACE_ID::MessageLite*>(_impl_.signal_);
+  }
+  if (signal) {
+    ::PROTOBUF_NAMESPACE_ID::Arena* submessage_arena =
+        ::PROTOBUF_NAMESPACE_ID::Arena::InternalGetOwningArena(
+                reinterpret_cast<::PROTOBUF_NAMESPACE_ID::MessageLite*>(signal));
+    if (message_arena != submessage_arena) {
+      signal = ::PROTOBUF_NAMESPACE_ID::internal::GetOwnedMessage(
+          message_arena, signal, submessage_arena);
+    }
+    _impl_._has_bits_[0] |= 0x00000008u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000008u;
+  }
+  _impl_.signal_ = signal;
+  // @@protoc_insertion_point(field_set_allocated:KismetLinuxBluetooth.LinuxBluetoothDataReport.signal)
+}
+
+// required .KismetLinuxBluetooth.SubLinuxBluetoothDevice btdevice = 5;
+inline bool LinuxBluetoothDataReport::_internal_has_btdevice() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000010u) != 0;
+  PROTOBUF_ASSUME(!value || _impl_.btdevice_ != nullptr);
+  return value;
+}
+inline bool LinuxBluetoothDataReport::has_btdevice() const {
+  return _internal_has_btdevice();
+}
+inline void LinuxBluetoothDataReport::clear_btdevice() {
+  if (_impl_.btdevice_ != nullptr) _impl_.btdevice_->Clear();
+  _impl_._has_bits_[0] &= ~0x00000010u;
+}
+inline const ::KismetLinuxBluetooth::SubLinuxBluetoothDevice& LinuxBluetoothDataReport::_internal_btdevice() const {
+  const ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* p = _impl_.btdevice_;
+  return p != nullptr ? *p : reinterpret_cast<const ::KismetLinuxBluetooth::SubLinuxBluetoothDevice&>(
+      ::KismetLinuxBluetooth::_SubLinuxBluetoothDevice_default_instance_);
+}
+inline const ::KismetLinuxBluetooth::SubLinuxBluetoothDevice& LinuxBluetoothDataReport::btdevice() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.LinuxBluetoothDataReport.btdevice)
+  return _internal_btdevice();
+}
+inline void LinuxBluetoothDataReport::unsafe_arena_set_allocated_btdevice(
+    ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* btdevice) {
+  if (GetArenaForAllocation() == nullptr) {
+    delete reinterpret_cast<::PROTOBUF_NAMESPACE_ID::MessageLite*>(_impl_.btdevice_);
+  }
+  _impl_.btdevice_ = btdevice;
+  if (btdevice) {
+    _impl_._has_bits_[0] |= 0x00000010u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000010u;
+  }
+  // @@protoc_insertion_point(field_unsafe_arena_set_allocated:KismetLinuxBluetooth.LinuxBluetoothDataReport.btdevice)
+}
+inline ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* LinuxBluetoothDataReport::release_btdevice() {
+  _impl_._has_bits_[0] &= ~0x00000010u;
+  ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* temp = _impl_.btdevice_;
+  _impl_.btdevice_ = nullptr;
+#ifdef PROTOBUF_FORCE_COPY_IN_RELEASE
+  auto* old =  reinterpret_cast<::PROTOBUF_NAMESPACE_ID::MessageLite*>(temp);
+  temp = ::PROTOBUF_NAMESPACE_ID::internal::DuplicateIfNonNull(temp);
+  if (GetArenaForAllocation() == nullptr) { delete old; }
+#else  // PROTOBUF_FORCE_COPY_IN_RELEASE
+  if (GetArenaForAllocation() != nullptr) {
+    temp = ::PROTOBUF_NAMESPACE_ID::internal::DuplicateIfNonNull(temp);
+  }
+#endif  // !PROTOBUF_FORCE_COPY_IN_RELEASE
+  return temp;
+}
+inline ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* LinuxBluetoothDataReport::unsafe_arena_release_btdevice() {
+  // @@protoc_insertion_point(field_release:KismetLinuxBluetooth.LinuxBluetoothDataReport.btdevice)
+  _impl_._has_bits_[0] &= ~0x00000010u;
+  ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* temp = _impl_.btdevice_;
+  _impl_.btdevice_ = nullptr;
+  return temp;
+}
+inline ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* LinuxBluetoothDataReport::_internal_mutable_btdevice() {
+  _impl_._has_bits_[0] |= 0x00000010u;
+  if (_impl_.btdevice_ == nullptr) {
+    auto* p = CreateMaybeMessage<::KismetLinuxBluetooth::SubLinuxBluetoothDevice>(GetArenaForAllocation());
+    _impl_.btdevice_ = p;
+  }
+  return _impl_.btdevice_;
+}
+inline ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* LinuxBluetoothDataReport::mutable_btdevice() {
+  ::KismetLinuxBluetooth::SubLinuxBluetoothDevice* _msg = _internal_mutable_btdevice();
+  // @@protoc_insertion_point(field_mutable:KismetLinuxBluetooth.LinuxBluetoothDataReport.btdevice)
+  return _msg;
+}
+inline void LinuxBluetoothDataReport::set_allocated_btdevice(::KismetLinuxBluetooth::SubLinuxBluetoothDevice* btdevice) {
+  ::PROTOBUF_NAMESPACE_ID::Arena* message_arena = GetArenaForAllocation();
+  if (message_arena == nullptr) {
+    delete _impl_.btdevice_;
+  }
+  if (btdevice) {
+    ::PROTOBUF_NAMESPACE_ID::Arena* submessage_arena =
+        ::PROTOBUF_NAMESPACE_ID::Arena::InternalGetOwningArena(btdevice);
+    if (message_arena != submessage_arena) {
+      btdevice = ::PROTOBUF_NAMESPACE_ID::internal::GetOwnedMessage(
+          message_arena, btdevice, submessage_arena);
+    }
+    _impl_._has_bits_[0] |= 0x00000010u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000010u;
+  }
+  _impl_.btdevice_ = btdevice;
+  // @@protoc_insertion_point(field_set_allocated:KismetLinuxBluetooth.LinuxBluetoothDataReport.btdevice)
+}
+
+// -------------------------------------------------------------------
+
+// SubLinuxBluetoothAdvert
+
+// required uint64 time_sec = 1;
+inline bool SubLinuxBluetoothAdvert::_internal_has_time_sec() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000004u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothAdvert::has_time_sec() const {
+  return _internal_has_time_sec();
+}
+inline void SubLinuxBluetoothAdvert::clear_time_sec() {
+  _impl_.time_sec_ = uint64_t{0u};
+  _impl_._has_bits_[0] &= ~0x00000004u;
+}
+inline uint64_t SubLinuxBluetoothAdvert::_internal_time_sec() const {
+  return _impl_.time_sec_;
+}
+inline uint64_t SubLinuxBluetoothAdvert::time_sec() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.time_sec)
+  return _internal_time_sec();
+}
+inline void SubLinuxBluetoothAdvert::_internal_set_time_sec(uint64_t value) {
+  _impl_._has_bits_[0] |= 0x00000004u;
+  _impl_.time_sec_ = value;
+}
+inline void SubLinuxBluetoothAdvert::set_time_sec(uint64_t value) {
+  _internal_set_time_sec(value);
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.time_sec)
+}
+
+// required uint64 time_usec = 2;
+inline bool SubLinuxBluetoothAdvert::_internal_has_time_usec() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000008u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothAdvert::has_time_usec() const {
+  return _internal_has_time_usec();
+}
+inline void SubLinuxBluetoothAdvert::clear_time_usec() {
+  _impl_.time_usec_ = uint64_t{0u};
+  _impl_._has_bits_[0] &= ~0x00000008u;
+}
+inline uint64_t SubLinuxBluetoothAdvert::_internal_time_usec() const {
+  return _impl_.time_usec_;
+}
+inline uint64_t SubLinuxBluetoothAdvert::time_usec() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.time_usec)
+  return _internal_time_usec();
+}
+inline void SubLinuxBluetoothAdvert::_internal_set_time_usec(uint64_t value) {
+  _impl_._has_bits_[0] |= 0x00000008u;
+  _impl_.time_usec_ = value;
+}
+inline void SubLinuxBluetoothAdvert::set_time_usec(uint64_t value) {
+  _internal_set_time_usec(value);
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.time_usec)
+}
+
+// required bytes address = 3;
+inline bool SubLinuxBluetoothAdvert::_internal_has_address() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothAdvert::has_address() const {
+  return _internal_has_address();
+}
+inline void SubLinuxBluetoothAdvert::clear_address() {
+  _impl_.address_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000001u;
+}
+inline const std::string& SubLinuxBluetoothAdvert::address() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.address)
+  return _internal_address();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void SubLinuxBluetoothAdvert::set_address(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000001u;
+ _impl_.address_.SetBytes(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.address)
+}
+inline std::string* SubLinuxBluetoothAdvert::mutable_address() {
+  std::string* _s = _internal_mutable_address();
+  // @@protoc_insertion_point(field_mutable:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.address)
+  return _s;
+}
+inline const std::string& SubLinuxBluetoothAdvert::_internal_address() const {
+  return _impl_.address_.Get();
+}
+inline void SubLinuxBluetoothAdvert::_internal_set_address(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  _impl_.address_.Set(value, GetArenaForAllocation());
+}
+inline std::string* SubLinuxBluetoothAdvert::_internal_mutable_address() {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  return _impl_.address_.Mutable(GetArenaForAllocation());
+}
+inline std::string* SubLinuxBluetoothAdvert::release_address() {
+  // @@protoc_insertion_point(field_release:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.address)
+  if (!_internal_has_address()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  auto* p = _impl_.address_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.address_.IsDefault()) {
+    _impl_.address_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void SubLinuxBluetoothAdvert::set_allocated_address(std::string* address) {
+  if (address != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  _impl_.address_.SetAllocated(address, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.address_.IsDefault()) {
+    _impl_.address_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.address)
+}
+
+// required int32 type = 4;
+inline bool SubLinuxBluetoothAdvert::_internal_has_type() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000010u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothAdvert::has_type() const {
+  return _internal_has_type();
+}
+inline void SubLinuxBluetoothAdvert::clear_type() {
+  _impl_.type_ = 0;
+  _impl_._has_bits_[0] &= ~0x00000010u;
+}
+inline int32_t SubLinuxBluetoothAdvert::_internal_type() const {
+  return _impl_.type_;
+}
+inline int32_t SubLinuxBluetoothAdvert::type() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.type)
+  return _internal_type();
+}
+inline void SubLinuxBluetoothAdvert::_internal_set_type(int32_t value) {
+  _impl_._has_bits_[0] |= 0x00000010u;
+  _impl_.type_ = value;
+}
+inline void SubLinuxBluetoothAdvert::set_type(int32_t value) {
+  _internal_set_type(value);
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.type)
+}
+
+// optional uint32 event_type = 5;
+inline bool SubLinuxBluetoothAdvert::_internal_has_event_type() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000020u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothAdvert::has_event_type() const {
+  return _internal_has_event_type();
+}
+inline void SubLinuxBluetoothAdvert::clear_event_type() {
+  _impl_.event_type_ = 0u;
+  _impl_._has_bits_[0] &= ~0x00000020u;
+}
+inline uint32_t SubLinuxBluetoothAdvert::_internal_event_type() const {
+  return _impl_.event_type_;
+}
+inline uint32_t SubLinuxBluetoothAdvert::event_type() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.event_type)
+  return _internal_event_type();
+}
+inline void SubLinuxBluetoothAdvert::_internal_set_event_type(uint32_t value) {
+  _impl_._has_bits_[0] |= 0x00000020u;
+  _impl_.event_type_ = value;
+}
+inline void SubLinuxBluetoothAdvert::set_event_type(uint32_t value) {
+  _internal_set_event_type(value);
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.event_type)
+}
+
+// optional sint32 rssi = 6;
+inline bool SubLinuxBluetoothAdvert::_internal_has_rssi() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000040u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothAdvert::has_rssi() const {
+  return _internal_has_rssi();
+}
+inline void SubLinuxBluetoothAdvert::clear_rssi() {
+  _impl_.rssi_ = 0;
+  _impl_._has_bits_[0] &= ~0x00000040u;
+}
+inline int32_t SubLinuxBluetoothAdvert::_internal_rssi() const {
+  return _impl_.rssi_;
+}
+inline int32_t SubLinuxBluetoothAdvert::rssi() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.rssi)
+  return _internal_rssi();
+}
+inline void SubLinuxBluetoothAdvert::_internal_set_rssi(int32_t value) {
+  _impl_._has_bits_[0] |= 0x00000040u;
+  _impl_.rssi_ = value;
+}
+inline void SubLinuxBluetoothAdvert::set_rssi(int32_t value) {
+  _internal_set_rssi(value);
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.rssi)
+}
+
+// optional sint32 txpower = 7;
+inline bool SubLinuxBluetoothAdvert::_internal_has_txpower() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000080u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothAdvert::has_txpower() const {
+  return _internal_has_txpower();
+}
+inline void SubLinuxBluetoothAdvert::clear_txpower() {
+  _impl_.txpower_ = 0;
+  _impl_._has_bits_[0] &= ~0x00000080u;
+}
+inline int32_t SubLinuxBluetoothAdvert::_internal_txpower() const {
+  return _impl_.txpower_;
+}
+inline int32_t SubLinuxBluetoothAdvert::txpower() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.txpower)
+  return _internal_txpower();
+}
+inline void SubLinuxBluetoothAdvert::_internal_set_txpower(int32_t value) {
+  _impl_._has_bits_[0] |= 0x00000080u;
+  _impl_.txpower_ = value;
+}
+inline void SubLinuxBluetoothAdvert::set_txpower(int32_t value) {
+  _internal_set_txpower(value);
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.txpower)
+}
+
+// optional bytes data = 8;
+inline bool SubLinuxBluetoothAdvert::_internal_has_data() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000002u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothAdvert::has_data() const {
+  return _internal_has_data();
+}
+inline void SubLinuxBluetoothAdvert::clear_data() {
+  _impl_.data_.ClearToEmpty();
+  _impl_._has_bits_[0] &= ~0x00000002u;
+}
+inline const std::string& SubLinuxBluetoothAdvert::data() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.data)
+  return _internal_data();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void SubLinuxBluetoothAdvert::set_data(ArgT0&& arg0, ArgT... args) {
+ _impl_._has_bits_[0] |= 0x00000002u;
+ _impl_.data_.SetBytes(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.data)
+}
+inline std::string* SubLinuxBluetoothAdvert::mutable_data() {
+  std::string* _s = _internal_mutable_data();
+  // @@protoc_insertion_point(field_mutable:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.data)
+  return _s;
+}
+inline const std::string& SubLinuxBluetoothAdvert::_internal_data() const {
+  return _impl_.data_.Get();
+}
+inline void SubLinuxBluetoothAdvert::_internal_set_data(const std::string& value) {
+  _impl_._has_bits_[0] |= 0x00000002u;
+  _impl_.data_.Set(value, GetArenaForAllocation());
+}
+inline std::string* SubLinuxBluetoothAdvert::_internal_mutable_data() {
+  _impl_._has_bits_[0] |= 0x00000002u;
+  return _impl_.data_.Mutable(GetArenaForAllocation());
+}
+inline std::string* SubLinuxBluetoothAdvert::release_data() {
+  // @@protoc_insertion_point(field_release:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.data)
+  if (!_internal_has_data()) {
+    return nullptr;
+  }
+  _impl_._has_bits_[0] &= ~0x00000002u;
+  auto* p = _impl_.data_.Release();
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.data_.IsDefault()) {
+    _impl_.data_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  return p;
+}
+inline void SubLinuxBluetoothAdvert::set_allocated_data(std::string* data) {
+  if (data != nullptr) {
+    _impl_._has_bits_[0] |= 0x00000002u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000002u;
+  }
+  _impl_.data_.SetAllocated(data, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.data_.IsDefault()) {
+    _impl_.data_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.data)
+}
+
+// optional uint32 count = 9;
+inline bool SubLinuxBluetoothAdvert::_internal_has_count() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000100u) != 0;
+  return value;
+}
+inline bool SubLinuxBluetoothAdvert::has_count() const {
+  return _internal_has_count();
+}
+inline void SubLinuxBluetoothAdvert::clear_count() {
+  _impl_.count_ = 0u;
+  _impl_._has_bits_[0] &= ~0x00000100u;
+}
+inline uint32_t SubLinuxBluetoothAdvert::_internal_count() const {
+  return _impl_.count_;
+}
+inline uint32_t SubLinuxBluetoothAdvert::count() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.count)
+  return _internal_count();
+}
+inline void SubLinuxBluetoothAdvert::_internal_set_count(uint32_t value) {
+  _impl_._has_bits_[0] |= 0x00000100u;
+  _impl_.count_ = value;
+}
+inline void SubLinuxBluetoothAdvert::set_count(uint32_t value) {
+  _internal_set_count(value);
+  // @@protoc_insertion_point(field_set:KismetLinuxBluetooth.SubLinuxBluetoothAdvert.count)
+}
+
+// -------------------------------------------------------------------
+
+// LinuxBluetoothAdvertReport
+
+// optional .KismetDatasource.SubGps gps = 1;
+inline bool LinuxBluetoothAdvertReport::_internal_has_gps() const {
+  bool value = (_impl_._has_bits_[0] & 0x00000001u) != 0;
+  PROTOBUF_ASSUME(!value || _impl_.gps_ != nullptr);
+  return value;
+}
+inline bool LinuxBluetoothAdvertReport::has_gps() const {
+  return _internal_has_gps();
+}
+inline const ::KismetDatasource::SubGps& LinuxBluetoothAdvertReport::_internal_gps() const {
+  const ::KismetDatasource::SubGps* p = _impl_.gps_;
+  return p != nullptr ? *p : reinterpret_cast<const ::KismetDatasource::SubGps&>(
+      ::KismetDatasource::_SubGps_default_instance_);
+}
+inline const ::KismetDatasource::SubGps& LinuxBluetoothAdvertReport::gps() const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.LinuxBluetoothAdvertReport.gps)
+  return _internal_gps();
+}
+inline void LinuxBluetoothAdvertReport::unsafe_arena_set_allocated_gps(
+    ::KismetDatasource::SubGps* gps) {
+  if (GetArenaForAllocation() == nullptr) {
+    delete reinterpret_cast<::PROTOBUF_NAMESPACE_ID::MessageLite*>(_impl_.gps_);
+  }
+  _impl_.gps_ = gps;
+  if (gps) {
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  // @@protoc_insertion_point(field_unsafe_arena_set_allocated:KismetLinuxBluetooth.LinuxBluetoothAdvertReport.gps)
+}
+inline ::KismetDatasource::SubGps* LinuxBluetoothAdvertReport::release_gps() {
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  ::KismetDatasource::SubGps* temp = _impl_.gps_;
+  _impl_.gps_ = nullptr;
+#ifdef PROTOBUF_FORCE_COPY_IN_RELEASE
+  auto* old =  reinterpret_cast<::PROTOBUF_NAMESPACE_ID::MessageLite*>(temp);
+  temp = ::PROTOBUF_NAMESPACE_ID::internal::DuplicateIfNonNull(temp);
+  if (GetArenaForAllocation() == nullptr) { delete old; }
+#else  // PROTOBUF_FORCE_COPY_IN_RELEASE
+  if (GetArenaForAllocation() != nullptr) {
+    temp = ::PROTOBUF_NAMESPACE_ID::internal::DuplicateIfNonNull(temp);
+  }
+#endif  // !PROTOBUF_FORCE_COPY_IN_RELEASE
+  return temp;
+}
+inline ::KismetDatasource::SubGps* LinuxBluetoothAdvertReport::unsafe_arena_release_gps() {
+  // @@protoc_insertion_point(field_release:KismetLinuxBluetooth.LinuxBluetoothAdvertReport.gps)
+  _impl_._has_bits_[0] &= ~0x00000001u;
+  ::KismetDatasource::SubGps* temp = _impl_.gps_;
+  _impl_.gps_ = nullptr;
+  return temp;
+}
+inline ::KismetDatasource::SubGps* LinuxBluetoothAdvertReport::_internal_mutable_gps() {
+  _impl_._has_bits_[0] |= 0x00000001u;
+  if (_impl_.gps_ == nullptr) {
+    auto* p = CreateMaybeMessage<::KismetDatasource::SubGps>(GetArenaForAllocation());
+    _impl_.gps_ = p;
+  }
+  return _impl_.gps_;
+}
+inline ::KismetDatasource::SubGps* LinuxBluetoothAdvertReport::mutable_gps() {
+  ::KismetDatasource::SubGps* _msg = _internal_mutable_gps();
+  // @@protoc_insertion_point(field_mutable:KismetLinuxBluetooth.LinuxBluetoothAdvertReport.gps)
+  return _msg;
+}
+inline void LinuxBluetoothAdvertReport::set_allocated_gps(::KismetDatasource::SubGps* gps) {
+  ::PROTOBUF_NAMESPACE_ID::Arena* message_arena = GetArenaForAllocation();
+  if (message_arena == nullptr) {
+    delete reinterpret_cast< ::PROTOBUF_NAMESPACE_ID::MessageLite*>(_impl_.gps_);
+  }
+  if (gps) {
+    ::PROTOBUF_NAMESPACE_ID::Arena* submessage_arena =
+        ::PROTOBUF_NAMESPACE_ID::Arena::InternalGetOwningArena(
+                reinterpret_cast<::PROTOBUF_NAMESPACE_ID::MessageLite*>(gps));
+    if (message_arena != submessage_arena) {
+      gps = ::PROTOBUF_NAMESPACE_ID::internal::GetOwnedMessage(
+          message_arena, gps, submessage_arena);
+    }
+    _impl_._has_bits_[0] |= 0x00000001u;
+  } else {
+    _impl_._has_bits_[0] &= ~0x00000001u;
+  }
+  _impl_.gps_ = gps;
+  // @@protoc_insertion_point(field_set_allocated:KismetLinuxBluetooth.LinuxBluetoothAdvertReport.gps)
+}
+
+// repeated .KismetLinuxBluetooth.SubLinuxBluetoothAdvert advert = 2;
+inline int LinuxBluetoothAdvertReport::_internal_advert_size() const {
+  return _impl_.advert_.size();
+}
+inline int LinuxBluetoothAdvertReport::advert_size() const {
+  return _internal_advert_size();
+}
+inline void LinuxBluetoothAdvertReport::clear_advert() {
+  _impl_.advert_.Clear();
+}
+inline ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert* LinuxBluetoothAdvertReport::mutable_advert(int index) {
+  // @@protoc_insertion_point(field_mutable:KismetLinuxBluetooth.LinuxBluetoothAdvertReport.advert)
+  return _impl_.advert_.Mutable(index);
+}
+inline ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert >*
+LinuxBluetoothAdvertReport::mutable_advert() {
+  // @@protoc_insertion_point(field_mutable_list:KismetLinuxBluetooth.LinuxBluetoothAdvertReport.advert)
+  return &_impl_.advert_;
+}
+inline const ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert& LinuxBluetoothAdvertReport::_internal_advert(int index) const {
+  return _impl_.advert_.Get(index);
+}
+inline const ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert& LinuxBluetoothAdvertReport::advert(int index) const {
+  // @@protoc_insertion_point(field_get:KismetLinuxBluetooth.LinuxBluetoothAdvertReport.advert)
+  return _internal_advert(index);
+}
+inline ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert* LinuxBluetoothAdvertReport::_internal_add_advert() {
+  return _impl_.advert_.Add();
+}
+inline ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert* LinuxBluetoothAdvertReport::add_advert() {
+  ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert* _add = _internal_add_advert();
+  // @@protoc_insertion_point(field_add:KismetLinuxBluetooth.LinuxBluetoothAdvertReport.advert)
+  return _add;
+}
+inline const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::KismetLinuxBluetooth::SubLinuxBluetoothAdvert >&
+LinuxBluetoothAdvertReport::advert() const {
+  // @@protoc_insertion_point(field_list:KismetLinuxBluetooth.LinuxBluetoothAdvertReport.advert)
+  return _impl_.advert_;
+}
+
+#ifdef __GNUC__
+  #pragma GCC diagnostic pop
+#endif  // __GNUC__
+// -------------------------------------------------------------------
+
+// -------------------------------------------------------------------
+
+// -------------------------------------------------------------------
+
+
+// @@protoc_insertion_point(namespace_scope)
+
+}  // namespace KismetLinuxBluetooth
+
+// @@protoc_insertion_point(global_scope)
+
+#include <google/protobuf/port_undef.inc>
+#endif  // GOOGLE_PROTOBUF_INCLUDED_GOOGLE_PROTOBUF_INCLUDED_linuxbluetooth_2eproto
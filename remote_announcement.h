@@ -36,4 +36,51 @@ typedef struct _kismet_remote_announce {
     char name[32]; /* NULL TERMINATED server name */
 } __attribute__((packed)) kismet_remote_announce;
 
+/* Remote capture load query.  A capture helper given several servers sends a query
+ * datagram to the remote capture port of each, over UDP, and connects to the server
+ * reporting the lowest load; connected helpers repeat the query to migrate away from
+ * a saturated server. */
+#define REMOTE_LOAD_TAG             0x4b49534c4f4144
+#define REMOTE_LOAD_VERSION         1
+
+typedef struct _kismet_remote_load_query {
+    uint64_t tag;
+    uint16_t load_version; /* Load protocol version, BE */
+    uint32_t nonce; /* Echoed in the report, BE */
+} __attribute__((packed)) kismet_remote_load_query;
+
+typedef struct _kismet_remote_load_report {
+    uint64_t tag;
+    uint16_t load_version; /* Load protocol version, BE */
+    uint32_t nonce; /* Nonce from the query, BE */
+    uint32_t packet_backlog; /* Packets queued and not yet processed, BE */
+    uint32_t packet_backlog_limit; /* Backlog at which packets are dropped, 0 if none, BE */
+    uint32_t cpu_permille; /* Server process CPU use in 1/1000 of one core, BE */
+    uint16_t num_cpus; /* Cores available to the server, BE */
+    uint32_t num_sources; /* Running datasources, BE */
+    char uuid[36]; /* NOT null terminated server UUID */
+} __attribute__((packed)) kismet_remote_load_report;
+
+/* Remote capture datagrams.  When the server offers a datagram token in KDSOPENSOURCE,
+ * a helper connected over TCP sends its packet batches as datagrams to the remote
+ * capture port instead of on the connection: a lost datagram costs the packets in it
+ * instead of stalling every frame queued behind a retransmit.  Commands and replies stay
+ * on TCP.  Each datagram holds exactly one v2 or v3 KDSDATABATCH or KDSDATAREPORT frame;
+ * the sequence number counts datagrams sent by the source, so the server can account for
+ * lost and late datagrams. */
+#define REMOTE_DATAGRAM_TAG         0x4b495344475241
+#define REMOTE_DATAGRAM_VERSION     1
+
+/* Largest datagram including the header, the maximum UDP payload over IPv4 */
+#define REMOTE_DATAGRAM_MAX_SZ      65507
+
+typedef struct _kismet_remote_datagram {
+    uint64_t tag;
+    uint16_t datagram_version; /* Datagram protocol version, BE */
+    uint16_t reserved;
+    uint32_t seqno; /* Per-source datagram sequence, BE */
+    uint64_t token; /* Token offered by the server in KDSOPENSOURCE, BE */
+    uint8_t data[0]; /* Single external protocol frame */
+} __attribute__((packed)) kismet_remote_datagram;
+
 #endif /* ifndef REMOTE_ANNOUNCEMENT_H */
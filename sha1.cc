@@ -0,0 +1,213 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "sha1.h"
+
+namespace {
+    inline uint32_t rol32(uint32_t v, unsigned int n) {
+        return (v << n) | (v >> (32 - n));
+    }
+}
+
+void sha1_hash::reset() {
+    state[0] = 0x67452301;
+    state[1] = 0xEFCDAB89;
+    state[2] = 0x98BADCFE;
+    state[3] = 0x10325476;
+    state[4] = 0xC3D2E1F0;
+    total_len = 0;
+    buf_len = 0;
+}
+
+void sha1_hash::transform(const uint8_t *block) {
+    uint32_t w[80];
+
+    for (unsigned int i = 0; i < 16; i++)
+        w[i] = ((uint32_t) block[i * 4] << 24) | ((uint32_t) block[i * 4 + 1] << 16) |
+            ((uint32_t) block[i * 4 + 2] << 8) | ((uint32_t) block[i * 4 + 3]);
+
+    for (unsigned int i = 16; i < 80; i++)
+        w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+    for (unsigned int i = 0; i < 80; i++) {
+        uint32_t f, k;
+
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+
+        uint32_t t = rol32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rol32(b, 30);
+        b = a;
+        a = t;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+void sha1_hash::update(const void *data, size_t len) {
+    auto p = static_cast<const uint8_t *>(data);
+
+    total_len += len;
+
+    if (buf_len != 0) {
+        auto n = std::min(len, block_len - buf_len);
+        memcpy(buf + buf_len, p, n);
+        buf_len += n;
+        p += n;
+        len -= n;
+
+        if (buf_len < block_len)
+            return;
+
+        transform(buf);
+        buf_len = 0;
+    }
+
+    while (len >= block_len) {
+        transform(p);
+        p += block_len;
+        len -= block_len;
+    }
+
+    if (len != 0) {
+        memcpy(buf, p, len);
+        buf_len = len;
+    }
+}
+
+void sha1_hash::final(uint8_t *digest) {
+    uint64_t bits = total_len * 8;
+    uint8_t pad = 0x80;
+
+    update(&pad, 1);
+
+    pad = 0;
+    while (buf_len != block_len - 8)
+        update(&pad, 1);
+
+    uint8_t len_be[8];
+    for (unsigned int i = 0; i < 8; i++)
+        len_be[i] = (uint8_t) (bits >> (56 - i * 8));
+
+    update(len_be, 8);
+
+    for (unsigned int i = 0; i < 5; i++) {
+        digest[i * 4] = (uint8_t) (state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t) (state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t) (state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t) (state[i]);
+    }
+}
+
+hmac_sha1::hmac_sha1(const void *key, size_t key_len) {
+    uint8_t k[sha1_hash::block_len];
+
+    memset(k, 0, sizeof(k));
+
+    if (key_len > sha1_hash::block_len) {
+        sha1_hash h;
+        h.update(key, key_len);
+        h.final(k);
+    } else {
+        memcpy(k, key, key_len);
+    }
+
+    for (size_t i = 0; i < sha1_hash::block_len; i++) {
+        ipad[i] = k[i] ^ 0x36;
+        opad[i] = k[i] ^ 0x5c;
+    }
+
+    reset();
+}
+
+void hmac_sha1::reset() {
+    inner.reset();
+    inner.update(ipad, sizeof(ipad));
+}
+
+void hmac_sha1::final(uint8_t *digest) {
+    uint8_t ihash[sha1_hash::digest_len];
+
+    inner.final(ihash);
+
+    sha1_hash outer;
+    outer.update(opad, sizeof(opad));
+    outer.update(ihash, sizeof(ihash));
+    outer.final(digest);
+}
+
+void pbkdf2_hmac_sha1(const void *pass, size_t pass_len, const void *salt, size_t salt_len,
+        unsigned int iterations, uint8_t *out, size_t out_len) {
+    hmac_sha1 mac(pass, pass_len);
+
+    for (uint32_t block = 1; out_len != 0; block++) {
+        uint8_t u[sha1_hash::digest_len];
+        uint8_t t[sha1_hash::digest_len];
+        uint8_t block_be[4] = {
+            (uint8_t) (block >> 24), (uint8_t) (block >> 16),
+            (uint8_t) (block >> 8), (uint8_t) block
+        };
+
+        mac.reset();
+        mac.update(salt, salt_len);
+        mac.update(block_be, sizeof(block_be));
+        mac.final(u);
+
+        memcpy(t, u, sizeof(t));
+
+        for (unsigned int i = 1; i < iterations; i++) {
+            mac.reset();
+            mac.update(u, sizeof(u));
+            mac.final(u);
+
+            for (size_t j = 0; j < sizeof(t); j++)
+                t[j] ^= u[j];
+        }
+
+        auto n = std::min(out_len, sizeof(t));
+        memcpy(out, t, n);
+        out += n;
+        out_len -= n;
+    }
+}
+
@@ -0,0 +1,78 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __SHA1_H__
+#define __SHA1_H__
+
+#include "config.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+// SHA1 and the HMAC and PBKDF2 constructions built on it, as used by the WPA key
+// hierarchy.  SHA1 is only used here to derive and verify keys, never to protect
+// anything Kismet stores.
+
+class sha1_hash {
+public:
+    static constexpr size_t digest_len = 20;
+    static constexpr size_t block_len = 64;
+
+    sha1_hash() {
+        reset();
+    }
+
+    void reset();
+    void update(const void *data, size_t len);
+    void final(uint8_t *digest);
+
+protected:
+    void transform(const uint8_t *block);
+
+    uint32_t state[5];
+    uint64_t total_len;
+    uint8_t buf[block_len];
+    size_t buf_len;
+};
+
+// HMAC-SHA1 over several discontiguous buffers, which saves assembling the 802.11
+// PRF and EAPOL MIC inputs into one buffer
+class hmac_sha1 {
+public:
+    hmac_sha1(const void *key, size_t key_len);
+
+    void update(const void *data, size_t len) {
+        inner.update(data, len);
+    }
+
+    void final(uint8_t *digest);
+
+    // Start a new MAC with the same key
+    void reset();
+
+protected:
+    sha1_hash inner;
+    uint8_t ipad[sha1_hash::block_len];
+    uint8_t opad[sha1_hash::block_len];
+};
+
+void pbkdf2_hmac_sha1(const void *pass, size_t pass_len, const void *salt, size_t salt_len,
+        unsigned int iterations, uint8_t *out, size_t out_len);
+
+#endif
+
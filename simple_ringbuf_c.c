@@ -51,9 +51,9 @@ kis_simple_ringbuf_t *kis_simple_ringbuf_create(size_t size) {
     char tmpfname[256];
 #endif
 
-    rb = (kis_simple_ringbuf_t *) malloc(sizeof(kis_simple_ringbuf_t));
-
-    if (rb == NULL)
+    /* Keep the read and write sides on their own cache lines */
+    if (posix_memalign((void **) &rb, KIS_SIMPLE_RINGBUF_CACHELINE, 
+                sizeof(kis_simple_ringbuf_t)) != 0)
         return NULL;
 
 #ifdef USE_MMAP_RBUF
@@ -108,8 +108,8 @@ kis_simple_ringbuf_t *kis_simple_ringbuf_create(size_t size) {
 #endif
 
     rb->buffer_sz = size;
-    rb->start_pos = 0;
-    rb->length = 0;
+    rb->head = 0;
+    rb->tail = 0;
     rb->mid_peek = 0;
     rb->mid_commit = 0;
     rb->free_peek = 0;
@@ -132,23 +132,82 @@ void kis_simple_ringbuf_free(kis_simple_ringbuf_t *ringbuf) {
     free(ringbuf);
 }
 
+/* Positions run from 0 to twice the buffer size; the offset into the buffer is the
+ * position modulo the buffer size */
+static size_t rb_offset(kis_simple_ringbuf_t *ringbuf, size_t pos) {
+    return pos >= ringbuf->buffer_sz ? pos - ringbuf->buffer_sz : pos;
+}
+
+static size_t rb_advance(kis_simple_ringbuf_t *ringbuf, size_t pos, size_t amt) {
+    pos += amt;
+
+    if (pos >= ringbuf->buffer_sz * 2)
+        pos -= ringbuf->buffer_sz * 2;
+
+    return pos;
+}
+
+static size_t rb_used(kis_simple_ringbuf_t *ringbuf, size_t head, size_t tail) {
+    if (head >= tail)
+        return head - tail;
+
+    return head + (ringbuf->buffer_sz * 2) - tail;
+}
+
+/* Copy into the buffer at a write position, wrapping around the end */
+static void rb_copy_in(kis_simple_ringbuf_t *ringbuf, size_t pos, const void *data, size_t length) {
+    size_t offt = rb_offset(ringbuf, pos);
+
+#ifdef USE_MMAP_RBUF
+    memcpy(ringbuf->buffer + offt, data, length);
+#else
+    if (offt + length <= ringbuf->buffer_sz) {
+        memcpy(ringbuf->buffer + offt, data, length);
+    } else {
+        size_t chunk_a = ringbuf->buffer_sz - offt;
+
+        memcpy(ringbuf->buffer + offt, data, chunk_a);
+        memcpy(ringbuf->buffer, (const uint8_t *) data + chunk_a, length - chunk_a);
+    }
+#endif
+}
+
+/* Copy out of the buffer at a read position, wrapping around the end */
+static void rb_copy_out(kis_simple_ringbuf_t *ringbuf, size_t pos, void *ptr, size_t length) {
+    size_t offt = rb_offset(ringbuf, pos);
+
+#ifdef USE_MMAP_RBUF
+    memcpy(ptr, ringbuf->buffer + offt, length);
+#else
+    if (offt + length <= ringbuf->buffer_sz) {
+        memcpy(ptr, ringbuf->buffer + offt, length);
+    } else {
+        size_t chunk_a = ringbuf->buffer_sz - offt;
+
+        memcpy(ptr, ringbuf->buffer + offt, chunk_a);
+        memcpy((uint8_t *) ptr + chunk_a, ringbuf->buffer, length - chunk_a);
+    }
+#endif
+}
+
 /* Clear ring buffer
  */
 void kis_simple_ringbuf_clear(kis_simple_ringbuf_t *ringbuf) {
-    ringbuf->start_pos = 0;
-    ringbuf->length = 0;
+    __atomic_store_n(&ringbuf->head, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ringbuf->tail, 0, __ATOMIC_SEQ_CST);
 }
 
 /* Get available space
  */
 size_t kis_simple_ringbuf_available(kis_simple_ringbuf_t *ringbuf) {
-    return ringbuf->buffer_sz - ringbuf->length;
+    return ringbuf->buffer_sz - kis_simple_ringbuf_used(ringbuf);
 }
 
 /* Get used space
  */
 size_t kis_simple_ringbuf_used(kis_simple_ringbuf_t *ringbuf) {
-    return ringbuf->length;
+    return rb_used(ringbuf, __atomic_load_n(&ringbuf->head, __ATOMIC_ACQUIRE),
+            __atomic_load_n(&ringbuf->tail, __ATOMIC_ACQUIRE));
 }
 
 /* Get total space
@@ -163,46 +222,21 @@ size_t kis_simple_ringbuf_size(kis_simple_ringbuf_t *ringbuf) {
  */
 size_t kis_simple_ringbuf_write(kis_simple_ringbuf_t *ringbuf, 
         void *data, size_t length) {
-    size_t copy_start;
+    size_t head = __atomic_load_n(&ringbuf->head, __ATOMIC_RELAXED);
 
     if (kis_simple_ringbuf_available(ringbuf) < length)
         return 0;
 
-    copy_start = 
-        (ringbuf->start_pos + ringbuf->length) % ringbuf->buffer_sz;
+    rb_copy_in(ringbuf, head, data, length);
 
-#ifdef USE_MMAP_RBUF
-    memcpy(ringbuf->buffer + copy_start, data, length);
-    ringbuf->length += length;
+    /* Publish the data to the reader */
+    __atomic_store_n(&ringbuf->head, rb_advance(ringbuf, head, length), __ATOMIC_RELEASE);
 
     return length;
-#else
-    /* Does the write op fit w/out looping? */
-    if (copy_start + length < ringbuf->buffer_sz) {
-        memcpy(ringbuf->buffer + copy_start, data, length);
-        ringbuf->length += length;
-
-        return length;
-    } else {
-        /* We have to split up, figure out the length of the two chunks */
-        size_t chunk_a = ringbuf->buffer_sz - copy_start;
-        size_t chunk_b = length - chunk_a;
-
-        memcpy(ringbuf->buffer + ringbuf->start_pos + ringbuf->length, data, chunk_a);
-        memcpy(ringbuf->buffer, (uint8_t *) data + chunk_a, chunk_b);
-
-        /* Increase the length of the buffer */
-        ringbuf->length += length;
-
-        return length;
-    }
-#endif
-
-    return 0;
 }
 
 size_t kis_simple_ringbuf_reserve(kis_simple_ringbuf_t *ringbuf, void **data, size_t size) {
-    size_t copy_start;
+    size_t offt;
 
     if (ringbuf->mid_commit) {
         fprintf(stderr, "ERROR: kis_simple_ringbuf_t mid-commit when reserve called\n");
@@ -215,25 +249,24 @@ size_t kis_simple_ringbuf_reserve(kis_simple_ringbuf_t *ringbuf, void **data, si
 
     ringbuf->mid_commit = 1;
 
-    copy_start = 
-        (ringbuf->start_pos + ringbuf->length) % ringbuf->buffer_sz;
+    offt = rb_offset(ringbuf, __atomic_load_n(&ringbuf->head, __ATOMIC_RELAXED));
 
 #ifdef USE_MMAP_RBUF
-    ringbuf->mid_commit = 1;
     ringbuf->free_commit = 0;
-    *data = ringbuf->buffer + copy_start;
+    *data = ringbuf->buffer + offt;
     return size;
 #else
     /* Does the write op fit w/out looping? */
-    if (copy_start + size < ringbuf->buffer_sz) {
+    if (offt + size <= ringbuf->buffer_sz) {
         ringbuf->free_commit = 0;
-        *data = ringbuf->buffer + copy_start;
+        *data = ringbuf->buffer + offt;
         return size;
     } else {
         *data = malloc(size);
 
         if (*data == NULL) {
             fprintf(stderr, "ERROR:  Could not allocate split-op sz write buffer\n");
+            ringbuf->mid_commit = 0;
             return 0;
         }
 
@@ -247,50 +280,22 @@ size_t kis_simple_ringbuf_reserve(kis_simple_ringbuf_t *ringbuf, void **data, si
 }
 
 size_t kis_simple_ringbuf_commit(kis_simple_ringbuf_t *ringbuf, void *data, size_t size) {
+    size_t head = __atomic_load_n(&ringbuf->head, __ATOMIC_RELAXED);
+
     if (!ringbuf->mid_commit) {
         fprintf(stderr, "ERROR: kis_simple_ringbuf_t not in a commit when commit called\n");
         return 0;
     }
 
-#ifdef USE_MMAP_RBUF
     ringbuf->mid_commit = 0;
-    ringbuf->length += size;
-    return size;
-#else
-    size_t copy_start;
 
-    copy_start = 
-        (ringbuf->start_pos + ringbuf->length) % ringbuf->buffer_sz;
-
-    ringbuf->mid_commit = 0;
-
-    if (!ringbuf->free_commit) {
-        ringbuf->length += size;
-        return size;
-    } else {
-        /* Does the write op fit w/out looping? */
-        if (copy_start + size < ringbuf->buffer_sz) {
-            memcpy(ringbuf->buffer + copy_start, data, size);
-            ringbuf->length += size;
-
-            return size;
-        } else {
-            /* We have to split up, figure out the length of the two chunks */
-            size_t chunk_a = ringbuf->buffer_sz - copy_start;
-            size_t chunk_b = size - chunk_a;
-
-            memcpy(ringbuf->buffer + ringbuf->start_pos + ringbuf->length, data, chunk_a);
-            memcpy(ringbuf->buffer, (uint8_t *) data + chunk_a, chunk_b);
-
-            /* Increase the length of the buffer */
-            ringbuf->length += size;
+    /* Split reservations were written to a temporary buffer */
+    if (ringbuf->free_commit)
+        rb_copy_in(ringbuf, head, data, size);
 
-            return size;
-        }
-    }
-#endif
+    __atomic_store_n(&ringbuf->head, rb_advance(ringbuf, head, size), __ATOMIC_RELEASE);
 
-    return 0;
+    return size;
 }
 
 /* Free a previously reserved chunk without committing it.
@@ -314,6 +319,8 @@ void kis_simple_ringbuf_reserve_free(kis_simple_ringbuf_t *ringbuf, void *data)
  */
 size_t kis_simple_ringbuf_read(kis_simple_ringbuf_t *ringbuf, void *ptr, 
         size_t size) {
+    size_t tail = __atomic_load_n(&ringbuf->tail, __ATOMIC_RELAXED);
+
     /* Start with how much we have available - no matter what was
      * requested, we can't read more than this */
     size_t opsize = kis_simple_ringbuf_used(ringbuf);
@@ -325,42 +332,13 @@ size_t kis_simple_ringbuf_read(kis_simple_ringbuf_t *ringbuf, void *ptr,
     if (opsize > size)
         opsize = size;
 
-#ifdef USE_MMAP_RBUF
     if (ptr != NULL)
-        memcpy(ptr, ringbuf->buffer + ringbuf->start_pos, opsize);
+        rb_copy_out(ringbuf, tail, ptr, opsize);
 
-    ringbuf->start_pos = (ringbuf->start_pos + opsize) % ringbuf->buffer_sz;
-    ringbuf->length -= opsize;
+    /* Hand the space back to the writer */
+    __atomic_store_n(&ringbuf->tail, rb_advance(ringbuf, tail, opsize), __ATOMIC_RELEASE);
 
     return opsize;
-#else
-    /* Simple contiguous read */
-    if (ringbuf->start_pos + opsize < ringbuf->buffer_sz) {
-        if (ptr != NULL)
-            memcpy(ptr, ringbuf->buffer + ringbuf->start_pos, opsize);
-        ringbuf->start_pos += opsize;
-        ringbuf->length -= opsize;
-        return opsize;
-    } else {
-        /* First chunk, start to end of buffer */
-        size_t chunk_a = ringbuf->buffer_sz - ringbuf->start_pos;
-        /* Second chunk, 0 to remaining data */
-        size_t chunk_b = opsize - chunk_a;
-
-        if (ptr != NULL) {
-            memcpy(ptr, ringbuf->buffer + ringbuf->start_pos, chunk_a);
-            memcpy((uint8_t *) ptr + chunk_a, ringbuf->buffer, chunk_b);
-        }
-
-        /* Fastforward around the ring to where we finished reading */
-        ringbuf->start_pos = chunk_b;
-        ringbuf->length -= opsize;
-
-        return opsize;
-    }
-#endif
-
-    return 0;
 }
 
 /* Peeks at data by copying into provided buffer.  Does NOT advance ringbuf
@@ -384,34 +362,16 @@ size_t kis_simple_ringbuf_peek(kis_simple_ringbuf_t *ringbuf, void *ptr,
     if (opsize > size)
         opsize = size;
 
-#ifdef USE_MMAP_RBUF
-    memcpy(ptr, ringbuf->buffer + ringbuf->start_pos, opsize);
-    return opsize;
-#else
-    /* Simple contiguous read */
-    if (ringbuf->start_pos + opsize < ringbuf->buffer_sz) {
-        memcpy(ptr, ringbuf->buffer + ringbuf->start_pos, opsize);
-        return opsize;
-    } else {
-        /* First chunk, start to end of buffer */
-        size_t chunk_a = ringbuf->buffer_sz - ringbuf->start_pos;
-        /* Second chunk, 0 to remaining data */
-        size_t chunk_b = opsize - chunk_a;
-
-        memcpy(ptr, ringbuf->buffer + ringbuf->start_pos, chunk_a);
-        memcpy((uint8_t *) ptr + chunk_a, ringbuf->buffer, chunk_b);
+    rb_copy_out(ringbuf, __atomic_load_n(&ringbuf->tail, __ATOMIC_RELAXED), ptr, opsize);
 
-        return opsize;
-    }
-#endif
-
-    return 0;
+    return opsize;
 }
 
 size_t kis_simple_ringbuf_peek_zc(kis_simple_ringbuf_t *ringbuf, void **ptr, size_t size) {
     /* Start with how much we have available - no matter what was
      * requested, we can't read more than this */
     size_t opsize = kis_simple_ringbuf_used(ringbuf);
+    size_t offt;
 
     if (ringbuf->mid_peek) {
         fprintf(stderr, "ERROR: simple_ringbuf_peek_zc mid-peek already\n");
@@ -419,6 +379,7 @@ size_t kis_simple_ringbuf_peek_zc(kis_simple_ringbuf_t *ringbuf, void **ptr, siz
     }
     
     ringbuf->mid_peek = 1;
+    ringbuf->free_peek = 0;
 
     if (opsize == 0)
         return 0;
@@ -430,23 +391,17 @@ size_t kis_simple_ringbuf_peek_zc(kis_simple_ringbuf_t *ringbuf, void **ptr, siz
     if (opsize > size)
         opsize = size;
 
+    offt = rb_offset(ringbuf, __atomic_load_n(&ringbuf->tail, __ATOMIC_RELAXED));
+
 #ifdef USE_MMAP_RBUF
-    ringbuf->mid_peek = 1;
-    ringbuf->free_peek = 0;
-    *ptr = ringbuf->buffer + ringbuf->start_pos;
+    *ptr = ringbuf->buffer + offt;
     return opsize;
 #else
     /* Simple contiguous read */
-    if (ringbuf->start_pos + opsize < ringbuf->buffer_sz) {
-        ringbuf->free_peek = 0;
-        *ptr = ringbuf->buffer + ringbuf->start_pos;
+    if (offt + opsize <= ringbuf->buffer_sz) {
+        *ptr = ringbuf->buffer + offt;
         return opsize;
     } else {
-        /* First chunk, start to end of buffer */
-        size_t chunk_a = ringbuf->buffer_sz - ringbuf->start_pos;
-        /* Second chunk, 0 to remaining data */
-        size_t chunk_b = opsize - chunk_a;
-
         *ptr = malloc(opsize);
 
         if (*ptr == NULL) {
@@ -456,8 +411,7 @@ size_t kis_simple_ringbuf_peek_zc(kis_simple_ringbuf_t *ringbuf, void **ptr, siz
 
         ringbuf->free_peek = 1;
 
-        memcpy(*ptr, ringbuf->buffer + ringbuf->start_pos, chunk_a);
-        memcpy((uint8_t *) *ptr + chunk_a, ringbuf->buffer, chunk_b);
+        rb_copy_out(ringbuf, __atomic_load_n(&ringbuf->tail, __ATOMIC_RELAXED), *ptr, opsize);
 
         return opsize;
     }
@@ -477,4 +431,3 @@ void kis_simple_ringbuf_peek_free(kis_simple_ringbuf_t *ringbuf, void *ptr) {
 
     ringbuf->mid_peek = 0;
 }
-
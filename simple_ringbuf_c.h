@@ -33,14 +33,20 @@
 // #define USE_MMAP_RBUF
 #endif
 
+/* The write and read positions are kept separately, each only ever moved by one side,
+ * so one thread may write (write, reserve, commit) while one other thread reads (read,
+ * peek) with no lock between them.  Several writers, or several readers, still need to
+ * serialize among themselves.
+ *
+ * Positions run from 0 to twice the buffer size so a full buffer can be told from an
+ * empty one, and the write and read sides are kept on separate cache lines so the
+ * writer and reader threads don't bounce the same line for every packet.
+ */
+#define KIS_SIMPLE_RINGBUF_CACHELINE    64
+
 struct kis_simple_ringbuf {
     uint8_t *buffer;
     size_t buffer_sz;
-    size_t start_pos; /* Where reading starts from */
-    size_t length; /* Amount of data in the buffer */
-
-    int mid_peek, mid_commit; /* Are we in a peek or reserve? */
-    int free_peek, free_commit; /* Do we need to free the peek or reserved buffers */
 
 #ifdef USE_MMAP_RBUF
     void *mmap_region0;
@@ -48,6 +54,14 @@ struct kis_simple_ringbuf {
 
     int mmap_fd;
 #endif
+
+    /* Write side */
+    size_t head __attribute__((aligned(KIS_SIMPLE_RINGBUF_CACHELINE)));
+    int mid_commit, free_commit; /* Are we in a reserve, do we need to free it */
+
+    /* Read side */
+    size_t tail __attribute__((aligned(KIS_SIMPLE_RINGBUF_CACHELINE)));
+    int mid_peek, free_peek; /* Are we in a peek, do we need to free it */
 };
 typedef struct kis_simple_ringbuf kis_simple_ringbuf_t;
 
@@ -61,7 +75,7 @@ kis_simple_ringbuf_t *kis_simple_ringbuf_create(size_t size);
  */
 void kis_simple_ringbuf_free(kis_simple_ringbuf_t *ringbuf);
 
-/* Clear ring buffer
+/* Clear ring buffer; must not be called while the buffer is being read or written
  */
 void kis_simple_ringbuf_clear(kis_simple_ringbuf_t *ringbuf);
 
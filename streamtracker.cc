@@ -18,8 +18,93 @@
 
 #include "config.h"
 
+#include <sys/time.h>
+
+#include "configfile.h"
 #include "streamtracker.h"
 #include "entrytracker.h"
+#include "messagebus.h"
+#include "util.h"
+
+uint64_t streaming_agent::rate_delay(size_t in_sz) {
+    uint64_t rate = rate_limit;
+
+    if (rate == 0)
+        return 0;
+
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    uint64_t now_usec = (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+
+    // Refill, holding at most a second of data so an idle stream can't burst past the cap
+    if (rate_last_usec == 0)
+        rate_tokens = rate;
+    else if (now_usec > rate_last_usec)
+        rate_tokens = std::min((double) rate, 
+                rate_tokens + (double) (now_usec - rate_last_usec) * rate / 1000000);
+
+    rate_last_usec = now_usec;
+
+    // Writes larger than the bucket go through once it's full
+    double need = std::min((double) in_sz, (double) rate);
+
+    if (rate_tokens >= need) {
+        rate_tokens -= in_sz;
+        return 0;
+    }
+
+    return (uint64_t) ((need - rate_tokens) * 1000000 / rate) + 1;
+}
+
+size_t streaming_agent::buffer_allowance(size_t in_max) {
+    if (memory_pool == nullptr || memory_pool->limit == 0)
+        return in_max;
+
+    // Lower priorities may only fill part of the pool
+    double share;
+
+    switch (get_priority()) {
+        case stream_priority::low:
+            share = 0.5;
+            break;
+        case stream_priority::normal:
+            share = 0.75;
+            break;
+        default:
+            share = 1;
+            break;
+    }
+
+    int64_t others = memory_pool->used - (int64_t) buffered;
+    int64_t allowed = (int64_t) (memory_pool->limit * share) - std::max((int64_t) 0, others);
+
+    if (allowed <= 0)
+        return 0;
+
+    return std::min(in_max, (size_t) allowed);
+}
+
+void streaming_agent::account_buffered(size_t in_sz) {
+    auto prev = buffered.exchange(in_sz);
+
+    if (memory_pool != nullptr)
+        memory_pool->used += (int64_t) in_sz - (int64_t) prev;
+}
+
+bool stream_tracker::parse_priority(const std::string& in_str, stream_priority& out_prio) {
+    auto p = str_lower(in_str);
+
+    if (p == "low")
+        out_prio = stream_priority::low;
+    else if (p == "normal")
+        out_prio = stream_priority::normal;
+    else if (p == "high")
+        out_prio = stream_priority::high;
+    else
+        return false;
+
+    return true;
+}
 
 stream_tracker::stream_tracker() :
     lifetime_global() {
@@ -35,6 +120,22 @@ stream_tracker::stream_tracker() :
 
     next_stream_id = 1;
 
+    memory_pool = std::make_shared<stream_memory_pool>();
+    memory_pool->limit =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<uint64_t>("stream_buffer_max", 
+                64 * 1024 * 1024);
+
+    default_rate_limit =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<uint64_t>("stream_rate_limit", 0);
+
+    default_priority = stream_priority::normal;
+
+    auto prio_opt = 
+        Globalreg::globalreg->kismet_config->fetch_opt_dfl("stream_priority", "normal");
+    if (!parse_priority(prio_opt, default_priority))
+        _MSG_ERROR("Unknown 'stream_priority' option '{}', expected low, normal, or high; "
+                "using normal.", prio_opt);
+
     auto httpd = Globalreg::fetch_mandatory_global_as<kis_net_beast_httpd>();
 
     httpd->register_route("/streams/all_streams", {"GET", "POST"}, httpd->RO_ROLE, {},
@@ -70,6 +171,38 @@ stream_tracker::stream_tracker() :
 
                     stream << "OK";
                 }));
+
+    httpd->register_route("/streams/by-id/:id/configure_stream", {"POST"}, httpd->LOGON_ROLE, {},
+            std::make_shared<kis_net_web_function_endpoint>(
+                [this](std::shared_ptr<kis_net_beast_httpd_connection> con) {
+                    std::ostream stream(&con->response_stream());
+
+                    auto id = string_to_n<int>(con->uri_params()[":id"]);
+
+                    kis_lock_guard<kis_mutex> lk(mutex, "stream_tracker configure_stream");
+
+                    auto s_k = tracked_stream_map->find(id);
+
+                    if (s_k == tracked_stream_map->end())
+                        throw std::runtime_error("invalid key");
+
+                    auto agent = 
+                        std::static_pointer_cast<streaming_info_record>(s_k->second)->get_agent();
+
+                    if (con->json().isMember("priority")) {
+                        stream_priority prio;
+
+                        if (!parse_priority(con->json()["priority"].asString(), prio))
+                            throw std::runtime_error("invalid priority, expected low, normal, or high");
+
+                        agent->set_priority(prio);
+                    }
+
+                    if (con->json().isMember("rate_limit"))
+                        agent->set_rate_limit(con->json()["rate_limit"].asUInt64());
+
+                    stream << "OK";
+                }));
 }
 
 stream_tracker::~stream_tracker() {
@@ -96,6 +229,12 @@ double stream_tracker::register_streamer(std::shared_ptr<streaming_agent> in_age
     streamrec->set_agent(in_agent);
     in_agent->set_stream_id(next_stream_id++);
 
+    in_agent->set_memory_pool(memory_pool);
+    in_agent->set_priority(default_priority);
+
+    if (in_agent->get_rate_limit() == 0)
+        in_agent->set_rate_limit(default_rate_limit);
+
     streamrec->set_log_name(in_name);
     streamrec->set_log_type(in_type);
     streamrec->set_log_path(in_path);
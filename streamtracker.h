@@ -21,6 +21,7 @@
 
 #include "config.h"
 
+#include <atomic>
 #include <memory>
 
 #include "globalregistry.h"
@@ -29,6 +30,25 @@
 #include "kis_net_beast_httpd.h"
 #include "devicetracker_component.h"
 
+// Streams of a lower priority are held to a smaller share of the stream buffer memory
+// when it runs short, so a slow client of a low priority stream stalls first
+enum class stream_priority : uint8_t {
+    low = 0,
+    normal = 1,
+    high = 2
+};
+
+// Buffer memory shared by all streams registered with the stream tracker; each stream
+// accounts the bytes it has buffered and not yet sent against the limit
+struct stream_memory_pool {
+    stream_memory_pool() :
+        used{0},
+        limit{0} { }
+
+    std::atomic<int64_t> used;
+    uint64_t limit;
+};
+
 class streaming_agent {
 public:
     streaming_agent() {
@@ -38,9 +58,19 @@ public:
         max_size = 0;
         max_packets = 0;
         stream_paused = false;
+
+        rate_limit = 0;
+        priority = stream_priority::normal;
+        rate_tokens = 0;
+        rate_last_usec = 0;
+        dropped_packets = 0;
+        buffered = 0;
     }
 
-    virtual ~streaming_agent() { };
+    virtual ~streaming_agent() {
+        if (memory_pool != nullptr)
+            memory_pool->used -= buffered;
+    };
 
     virtual void stop_stream(std::string in_reason __attribute__((unused))) { };
 
@@ -68,6 +98,23 @@ public:
     virtual void pause_stream() { stream_paused = true; }
     virtual void resume_stream() { stream_paused = false; }
 
+    // Bandwidth cap in bytes per second, or 0 for none
+    void set_rate_limit(uint64_t in_rate) { rate_limit = in_rate; }
+    uint64_t get_rate_limit() { return rate_limit; }
+
+    void set_priority(stream_priority in_prio) { priority = in_prio; }
+    stream_priority get_priority() { return priority; }
+
+    // Packets dropped by the limits, or because the stream fell behind
+    uint64_t get_dropped_packets() { return dropped_packets; }
+
+    // Bytes buffered and not yet sent, as last accounted by the stream
+    uint64_t get_buffered() { return buffered; }
+
+    void set_memory_pool(std::shared_ptr<stream_memory_pool> in_pool) {
+        memory_pool = in_pool;
+    }
+
 protected:
     double stream_id;
     uint64_t log_size;
@@ -77,6 +124,29 @@ protected:
     uint64_t max_packets;
 
     bool stream_paused;
+
+    std::atomic<uint64_t> rate_limit;
+    std::atomic<stream_priority> priority;
+    std::atomic<uint64_t> dropped_packets;
+    std::atomic<uint64_t> buffered;
+
+    std::shared_ptr<stream_memory_pool> memory_pool;
+
+    // Token bucket for the rate limit, holding up to a second of data; only touched by the
+    // thread writing the stream, under its own lock
+    double rate_tokens;
+    uint64_t rate_last_usec;
+
+    // Take in_sz bytes from the rate limit; returns 0 if they can be sent now, or the
+    // time in microseconds until they can, without taking them
+    uint64_t rate_delay(size_t in_sz);
+
+    // Bytes this stream may hold buffered, at most in_max, given its priority and what
+    // the other streams are holding
+    size_t buffer_allowance(size_t in_max);
+
+    // Account the current buffered size against the memory pool
+    void account_buffered(size_t in_sz);
 };
 
 class streaming_info_record : public tracker_component {
@@ -129,6 +199,11 @@ public:
 
     __Proxy(log_paused, uint8_t, bool, bool, log_paused);
 
+    __Proxy(rate_limit, uint64_t, uint64_t, uint64_t, rate_limit);
+    __Proxy(priority, uint8_t, uint8_t, uint8_t, priority);
+    __Proxy(dropped_packets, uint64_t, uint64_t, uint64_t, dropped_packets);
+    __Proxy(buffered, uint64_t, uint64_t, uint64_t, buffered);
+
     void set_agent(std::shared_ptr<streaming_agent> in_agent) {
         agent = in_agent;
     }
@@ -148,6 +223,10 @@ public:
             set_max_packets(agent->get_max_packets());
             set_max_size(agent->get_max_size());
             set_log_paused(agent->get_stream_paused());
+            set_rate_limit(agent->get_rate_limit());
+            set_priority(static_cast<uint8_t>(agent->get_priority()));
+            set_dropped_packets(agent->get_dropped_packets());
+            set_buffered(agent->get_buffered());
         }
     }
 
@@ -168,6 +247,14 @@ protected:
         register_field("kismet.stream.max_packets", "Maximum number of packets", &max_packets);
         register_field("kismet.stream.max_size", "Maximum allowed size (bytes)", &max_size);
         register_field("kismet.stream.paused", "Stream processing paused", &log_paused);
+        register_field("kismet.stream.rate_limit", "Bandwidth cap (bytes per second, 0 for none)", 
+                &rate_limit);
+        register_field("kismet.stream.priority", "Stream priority (0 low, 1 normal, 2 high)", 
+                &priority);
+        register_field("kismet.stream.dropped_packets", 
+                "Packets dropped by the stream limits or because the stream fell behind",
+                &dropped_packets);
+        register_field("kismet.stream.buffered", "Bytes buffered and not yet sent", &buffered);
     }
 
     std::shared_ptr<tracker_element_double> stream_id;
@@ -185,6 +272,11 @@ protected:
 
     std::shared_ptr<tracker_element_uint8> log_paused;
 
+    std::shared_ptr<tracker_element_uint64> rate_limit;
+    std::shared_ptr<tracker_element_uint8> priority;
+    std::shared_ptr<tracker_element_uint64> dropped_packets;
+    std::shared_ptr<tracker_element_uint64> buffered;
+
     std::shared_ptr<streaming_agent> agent;
 };
 
@@ -219,6 +311,13 @@ protected:
     int info_builder_id;
 
     double next_stream_id;
+
+    // Limits given to every registered stream
+    std::shared_ptr<stream_memory_pool> memory_pool;
+    uint64_t default_rate_limit;
+    stream_priority default_priority;
+
+    static bool parse_priority(const std::string& in_str, stream_priority& out_prio);
 };
 
 #endif
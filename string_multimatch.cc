@@ -0,0 +1,205 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <string.h>
+
+#include <deque>
+#include <stdexcept>
+
+#include "string_multimatch.h"
+
+string_multimatch::string_multimatch() :
+    compiled{false},
+    num_patterns{0} {
+    next.assign(256, 0);
+    out.resize(1);
+}
+
+unsigned int string_multimatch::add_pattern(const std::string& in_pattern) {
+    if (compiled)
+        throw std::runtime_error("string_multimatch patterns added after compiling");
+
+    auto id = num_patterns++;
+
+    // An empty pattern is never reported
+    if (in_pattern.length() == 0)
+        return id;
+
+    uint32_t state = 0;
+
+    for (auto c : in_pattern) {
+        auto t = state * 256 + (uint8_t) c;
+
+        if (next[t] == 0) {
+            next[t] = out.size();
+            out.resize(out.size() + 1);
+            next.resize(out.size() * 256, 0);
+        }
+
+        state = next[t];
+    }
+
+    out[state].push_back(id);
+
+    return id;
+}
+
+void string_multimatch::compile() {
+    if (compiled)
+        return;
+
+    compiled = true;
+
+    // Breadth first from the root, fill in the failure transitions so every state has a
+    // transition for every byte, and merge the patterns of each state's failure state
+    std::vector<uint32_t> fail(out.size(), 0);
+    std::deque<uint32_t> queue;
+
+    for (unsigned int c = 0; c < 256; c++) {
+        if (next[c] != 0)
+            queue.push_back(next[c]);
+    }
+
+    while (!queue.empty()) {
+        auto state = queue.front();
+        queue.pop_front();
+
+        const auto& fail_out = out[fail[state]];
+        out[state].insert(out[state].end(), fail_out.begin(), fail_out.end());
+
+        for (unsigned int c = 0; c < 256; c++) {
+            auto t = state * 256 + c;
+
+            if (next[t] != 0) {
+                fail[next[t]] = next[fail[state] * 256 + c];
+                queue.push_back(next[t]);
+            } else {
+                next[t] = next[fail[state] * 256 + c];
+            }
+        }
+    }
+}
+
+void string_multimatch::match(const std::string& in_str, std::vector<bool>& in_found) const {
+    in_found.assign(num_patterns, false);
+
+    uint32_t state = 0;
+
+    for (auto c : in_str) {
+        state = next[state * 256 + (uint8_t) c];
+
+        for (auto id : out[state])
+            in_found[id] = true;
+    }
+}
+
+std::string string_multimatch::regex_required_literal(const std::string& in_regex) {
+    // Walk the top level of the expression collecting runs of plain characters; groups,
+    // classes, escapes, and wildcards end a run, a character followed by a quantifier
+    // which allows zero of it is not required, and any top-level alternation means
+    // no single literal is required at all
+    std::string best, run;
+    int depth = 0;
+
+    // Inline options may make the match case insensitive
+    for (auto p = in_regex.find("(?"); p != std::string::npos; p = in_regex.find("(?", p + 2)) {
+        if (p + 2 < in_regex.length() && strchr("imsxJU-", in_regex[p + 2]) != nullptr)
+            return "";
+    }
+
+    auto end_run = [&]() {
+        if (run.length() > best.length())
+            best = run;
+        run.clear();
+    };
+
+    for (size_t i = 0; i < in_regex.length(); i++) {
+        auto c = in_regex[i];
+
+        if (depth > 0) {
+            if (c == '\\')
+                i++;
+            else if (c == '(')
+                depth++;
+            else if (c == ')')
+                depth--;
+            continue;
+        }
+
+        switch (c) {
+            case '|':
+                return "";
+            case '(':
+                end_run();
+                depth++;
+                break;
+            case '[':
+                end_run();
+                // Skip the class, allowing a leading ] or ^]
+                i++;
+                if (i < in_regex.length() && in_regex[i] == '^')
+                    i++;
+                if (i < in_regex.length() && in_regex[i] == ']')
+                    i++;
+                while (i < in_regex.length() && in_regex[i] != ']') {
+                    if (in_regex[i] == '\\')
+                        i++;
+                    i++;
+                }
+                break;
+            case '\\':
+                end_run();
+                i++;
+                break;
+            case '*':
+            case '?':
+            case '{':
+                if (run.length())
+                    run.pop_back();
+                end_run();
+                if (c == '{') {
+                    while (i < in_regex.length() && in_regex[i] != '}')
+                        i++;
+                }
+                break;
+            case '+':
+            case '.':
+            case '^':
+            case '$':
+                end_run();
+                break;
+            default:
+                run += c;
+                break;
+        }
+    }
+
+    end_run();
+
+    return best;
+}
+
+bool string_multimatch::regex_is_literal(const std::string& in_regex) {
+    if (in_regex.length() == 0)
+        return false;
+
+    return in_regex.find_first_of("\\^$.|?*+()[]{}") == std::string::npos;
+}
+
@@ -0,0 +1,73 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __STRING_MULTIMATCH_H__
+#define __STRING_MULTIMATCH_H__
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+// Multi-pattern substring matcher
+//
+// An Aho-Corasick automaton over any number of literal patterns, which finds every
+// pattern present in a string in one pass.  Patterns are added, the automaton is
+// compiled once, and it is then immutable and safe to share between threads without
+// locking.
+//
+// Regex based matches use it as a prefilter: the literal a regex requires is added as a
+// pattern, and only the regexes whose literal is found need to be run.
+class string_multimatch {
+public:
+    string_multimatch();
+
+    // Add a pattern, returning its id; patterns may not be added once compiled
+    unsigned int add_pattern(const std::string& in_pattern);
+
+    void compile();
+
+    size_t size() const {
+        return num_patterns;
+    }
+
+    // Mark every pattern found in the string; in_found is resized to the number of
+    // patterns
+    void match(const std::string& in_str, std::vector<bool>& in_found) const;
+
+    // Longest literal any string matching a PCRE expression must contain; empty if no
+    // literal is certain, such as with a top-level alternation or inline options
+    static std::string regex_required_literal(const std::string& in_regex);
+
+    // Is the expression only a literal, so that finding the literal is a match?
+    static bool regex_is_literal(const std::string& in_regex);
+
+protected:
+    bool compiled;
+    unsigned int num_patterns;
+
+    // Dense transition table of 256 entries per state, and the patterns found on
+    // reaching each state
+    std::vector<uint32_t> next;
+    std::vector<std::vector<unsigned int>> out;
+};
+
+#endif
+
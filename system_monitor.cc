@@ -36,6 +36,9 @@
 #include "globalregistry.h"
 #include "json_adapter.h"
 #include "kis_databaselogfile.h"
+#include "kis_hugepage_slab.h"
+#include "kis_thread_placement.h"
+#include "packetchain.h"
 #include "system_monitor.h"
 #include "util.h"
 #include "version.h"
@@ -236,6 +239,57 @@ Systemmonitor::Systemmonitor() :
                 return 1;
                 });
 
+    governor_budget_kb = static_cast<uint64_t>(
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("memory_governor_budget_mb", 0)) * 1024;
+    governor_relax_pct =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("memory_governor_relax_pct", 10);
+    governor_relax_time =
+        Globalreg::globalreg->kismet_config->fetch_opt_int("memory_governor_relax_time", 60);
+    governor_device_timeout =
+        Globalreg::globalreg->kismet_config->fetch_opt_int("memory_governor_device_timeout", 1800);
+    governor_rrd_idle =
+        Globalreg::globalreg->kismet_config->fetch_opt_int("memory_governor_rrd_idle", 600);
+    governor_backlog_pct =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("memory_governor_backlog_pct", 25);
+
+    for (const auto& st : str_tokenize(Globalreg::globalreg->kismet_config->fetch_opt_dfl("memory_governor_steps",
+                    "75,85,90,95"), ",", true)) {
+        auto pct = string_to_n_dfl<unsigned int>(st, 0);
+
+        // There are only four steps, and each must be above the previous one
+        if (pct == 0 || governor_steps.size() == 4 ||
+                (governor_steps.size() && pct <= governor_steps.back())) {
+            _MSG_ERROR("Ignoring invalid memory_governor_steps value '{}'; steps must be "
+                    "increasing percentages of the budget, up to four steps.", st);
+            continue;
+        }
+
+        governor_steps.push_back(pct);
+    }
+
+    governor_level = 0;
+    governor_below_since = 0;
+
+    status->set_governor_budget(governor_budget_kb);
+    status->set_governor_level(0);
+    status->set_governor_state(governor_level_name(0));
+
+    if (governor_budget_kb > 0 && governor_steps.size() > 0) {
+        _MSG_INFO("Limiting Kismet to a memory budget of {} MB; device retention will be "
+                "reduced as memory use reaches {}% of the budget.", governor_budget_kb / 1024,
+                governor_steps[0]);
+
+        governor_timer_id =
+            timetracker->register_timer(std::chrono::seconds(std::max(1U,
+                        Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("memory_governor_interval", 5))),
+                    true,
+                    [this](int) -> int {
+                        memory_governor();
+                        return 1;
+                    });
+    } else {
+        governor_timer_id = -1;
+    }
 }
 
 Systemmonitor::~Systemmonitor() {
@@ -246,10 +300,106 @@ Systemmonitor::~Systemmonitor() {
     timetracker->remove_timer(timer_id);
     timetracker->remove_timer(kismetdb_log_timer);
     timetracker->remove_timer(event_timer_id);
+    timetracker->remove_timer(governor_timer_id);
 
     eventbus->remove_listener(logopen_evt_id);
 }
 
+std::string Systemmonitor::governor_level_name(unsigned int in_level) {
+    switch (in_level) {
+        case 0:
+            return "normal";
+        case 1:
+            return "expiring idle devices";
+        case 2:
+            return "dropping device history";
+        case 3:
+            return "sketching random devices";
+        default:
+            return "reducing packet backlog";
+    }
+}
+
+void Systemmonitor::memory_governor() {
+    unsigned int prev_level, level;
+    uint64_t rss;
+    std::shared_ptr<eventbus_event> evt;
+
+    {
+        kis_lock_guard<kis_mutex> lg(monitor_mutex, "system monitor memory_governor");
+
+        rss = status->get_memory();
+        prev_level = level = governor_level;
+
+        time_t now = Globalreg::globalreg->last_tv_sec;
+
+        // Tighten as many steps as the RSS has crossed at once, since a crowd can fill
+        // memory faster than one step per interval
+        while (level < governor_steps.size() && rss * 100 >= governor_budget_kb * governor_steps[level])
+            level++;
+
+        if (level == prev_level && level > 0) {
+            auto relax_pct = governor_steps[level - 1] > governor_relax_pct ?
+                governor_steps[level - 1] - governor_relax_pct : 0;
+
+            if (rss * 100 < governor_budget_kb * relax_pct) {
+                if (governor_below_since == 0)
+                    governor_below_since = now;
+
+                if (now - governor_below_since >= governor_relax_time) {
+                    level--;
+                    governor_below_since = now;
+                }
+            } else {
+                governor_below_since = 0;
+            }
+        } else if (level != prev_level) {
+            governor_below_since = 0;
+        }
+
+        if (level == prev_level)
+            return;
+
+        governor_level = level;
+
+        status->set_governor_level(level);
+        status->set_governor_state(governor_level_name(level));
+
+        evt = eventbus->get_eventbus_event(event_memory_pressure());
+
+        auto pe = std::make_shared<tracker_element_map>();
+        pe->insert(status->get_tracker_memory());
+        pe->insert(status->get_tracker_governor_budget());
+        pe->insert(status->get_tracker_governor_level());
+        pe->insert(status->get_tracker_governor_state());
+
+        evt->get_event_content()->insert(event_memory_pressure(), pe);
+    }
+
+    // The retention changes take the devicelist lock, so they are made outside of
+    // the monitor lock
+    apply_governor_level(level);
+
+    if (level > prev_level)
+        _MSG_ERROR("Memory use is {} MB of the {} MB budget; Kismet is {}.", rss / 1024,
+                governor_budget_kb / 1024, governor_level_name(level));
+    else
+        _MSG_INFO("Memory use is down to {} MB of the {} MB budget; Kismet is {}.", rss / 1024,
+                governor_budget_kb / 1024, governor_level_name(level));
+
+    eventbus->publish(evt);
+}
+
+void Systemmonitor::apply_governor_level(unsigned int in_level) {
+    devicetracker->set_pressure_idle_expiration(in_level >= 1 ? governor_device_timeout : 0);
+    devicetracker->set_pressure_rrd(in_level >= 2, governor_rrd_idle);
+    devicetracker->set_pressure_sketch(in_level >= 3);
+
+    if (Globalreg::globalreg->packetchain != nullptr)
+        Globalreg::globalreg->packetchain->set_packets_backlog_pct(in_level >= 4 ?
+                governor_backlog_pct : 100);
+}
+
 void tracked_system_status::register_fields() {
     register_field("kismet.system.battery.percentage", "remaining battery percentage", &battery_perc);
     register_field("kismet.system.battery.charging", "battery charging state", &battery_charging);
@@ -279,6 +429,57 @@ void tracked_system_status::register_fields() {
     register_field("kismet.system.num_fields", "number of allocated tracked element fields", &num_fields);
     register_field("kismet.system.num_components", "number of allocated tracked element components", &num_components);
     register_field("kismet.system.num_http_connections", "number of concurrent http connections", &num_http_connections);
+
+    register_field("kismet.system.memory.packet_buffers", "packet data buffer pool occupancy", &packet_buffers);
+    packet_buffer_entry_id =
+        register_field("kismet.system.memory.packet_buffer",
+                tracker_element_factory<tracked_packet_buffer_class>(),
+                "packet data buffer size class");
+
+    register_field("kismet.system.thread_placement", "thread placement policy", &thread_placement);
+    register_field("kismet.system.threads", "placement of server threads", &threads);
+    thread_entry_id =
+        register_field("kismet.system.thread",
+                tracker_element_factory<tracked_thread_placement>(),
+                "server thread placement");
+
+    register_field("kismet.system.memory.subsystem.devices",
+            "estimated bytes held by tracked devices", &memory_devices);
+    register_field("kismet.system.memory.subsystem.packets_in_flight",
+            "packets queued and not yet processed", &memory_packets_in_flight);
+    register_field("kismet.system.memory.subsystem.packets_bytes",
+            "bytes of packet data buffers held by packets", &memory_packets_bytes);
+    register_field("kismet.system.memory.subsystem.pools_bytes",
+            "bytes of free packet data buffers held in pools", &memory_pools_bytes);
+    register_field("kismet.system.memory.subsystem.string_pool",
+            "number of records in the shared string pool", &memory_string_pool);
+    register_field("kismet.system.memory.subsystem.log_queue",
+            "number of records waiting to be written to the kismetdb log", &memory_log_queue);
+
+    register_field("kismet.system.memory.hugepage.mode",
+            "huge page pool mode (off, transparent, explicit)", &hugepage_mode);
+    register_field("kismet.system.memory.hugepage.reserved",
+            "bytes of address space mapped for the huge page pool", &hugepage_reserved);
+    register_field("kismet.system.memory.hugepage.slab_bytes",
+            "bytes of the huge page pool carved into slabs", &hugepage_slab_bytes);
+    register_field("kismet.system.memory.hugepage.in_use",
+            "bytes of the huge page pool held by packets and devices", &hugepage_in_use);
+    register_field("kismet.system.memory.hugepage.backed",
+            "bytes of the huge page pool backed by huge pages", &hugepage_backed);
+    register_field("kismet.system.memory.hugepage.fallbacks",
+            "allocations from the heap after the huge page pool was exhausted", &hugepage_fallbacks);
+
+    register_field("kismet.system.memory.governor.budget",
+            "memory governor RSS budget in kbytes, 0 if disabled", &governor_budget);
+    register_field("kismet.system.memory.governor.level",
+            "memory governor retention step, 0 when not under pressure", &governor_level);
+    register_field("kismet.system.memory.governor.state",
+            "memory governor retention policy", &governor_state);
+}
+
+uint64_t Systemmonitor::get_memory_kb() {
+    kis_lock_guard<kis_mutex> lg(monitor_mutex, "system monitor get_memory_kb");
+    return status->get_memory();
 }
 
 int Systemmonitor::timetracker_event(int eventid) {
@@ -445,5 +646,68 @@ void tracked_system_status::pre_serialize() {
     set_num_fields(Globalreg::n_tracked_fields);
     set_num_components(Globalreg::n_tracked_components);
     set_num_http_connections(Globalreg::n_tracked_http_connections);
+
+    packet_buffers->clear();
+
+    uint64_t packets_bytes = 0, pools_bytes = 0;
+
+    if (Globalreg::globalreg->packetchain != nullptr) {
+        for (const auto& bs : Globalreg::globalreg->packetchain->get_packet_buffer_stats()) {
+            auto bc = std::make_shared<tracked_packet_buffer_class>(packet_buffer_entry_id);
+            bc->set_size(bs.size);
+            bc->set_in_use(bs.in_use);
+            bc->set_pooled(bs.pooled);
+            bc->set_bytes((bs.in_use + bs.pooled) * bs.size);
+            packet_buffers->push_back(bc);
+
+            packets_bytes += bs.in_use * bs.size;
+            pools_bytes += bs.pooled * bs.size;
+        }
+
+        set_memory_packets_in_flight(Globalreg::globalreg->packetchain->get_packets_in_flight());
+    }
+
+    threads->clear();
+
+    auto placer = Globalreg::fetch_global_as<kis_thread_placement>();
+    if (placer != nullptr) {
+        thread_placement->set(placer->get_policy_name());
+
+        for (const auto& p : placer->get_placements()) {
+            auto t = std::make_shared<tracked_thread_placement>(thread_entry_id);
+            t->set_name(p.name);
+            t->set_role(p.role);
+            t->set_tid(p.tid);
+            t->set_node(p.node);
+            t->set_cpus(p.cpus);
+            threads->push_back(t);
+        }
+    }
+
+    set_memory_packets_bytes(packets_bytes);
+    set_memory_pools_bytes(pools_bytes);
+    set_memory_string_pool(tracker_string_pool::size());
+
+    auto kismetdb = Globalreg::fetch_global_as<kis_database_logfile>();
+    if (kismetdb != nullptr)
+        set_memory_log_queue(kismetdb->get_write_queue_size());
+
+    auto slab = kis_hugepage_slab::get_stats();
+    hugepage_mode->set(kis_hugepage_slab::mode_name(slab.mode));
+    hugepage_reserved->set(slab.reserved_bytes);
+    hugepage_slab_bytes->set(slab.slab_bytes);
+    hugepage_in_use->set(slab.in_use_bytes);
+    hugepage_fallbacks->set(slab.fallbacks);
+
+    if (now.tv_sec - memory_devices_ts >= 5) {
+        hugepage_backed->set(kis_hugepage_slab::get_hugepage_bytes());
+
+        auto devtracker = Globalreg::fetch_global_as<device_tracker>();
+
+        if (devtracker != nullptr) {
+            set_memory_devices(devtracker->devices_memory_size());
+            memory_devices_ts = now.tv_sec;
+        }
+    }
 } 
 
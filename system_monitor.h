@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <string>
+#include <vector>
 
 #include "kis_mutex.h"
 #include "trackedelement.h"
@@ -32,6 +33,107 @@
 
 class event_bus;
 
+// Occupancy of a packet buffer size class
+class tracked_packet_buffer_class : public tracker_component {
+public:
+    tracked_packet_buffer_class() :
+        tracker_component() {
+        register_fields();
+        reserve_fields(nullptr);
+    }
+
+    tracked_packet_buffer_class(int in_id) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(nullptr);
+    }
+
+    tracked_packet_buffer_class(int in_id, std::shared_ptr<tracker_element_map> e) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(e);
+    }
+
+    virtual std::shared_ptr<tracker_element> clone_type() override {
+        using this_t = typename std::remove_pointer<decltype(this)>::type;
+        auto r = std::make_shared<this_t>();
+        r->set_id(this->get_id());
+        return r;
+    }
+
+    virtual ~tracked_packet_buffer_class() { }
+
+    __Proxy(size, uint64_t, uint64_t, uint64_t, size);
+    __Proxy(in_use, uint64_t, uint64_t, uint64_t, in_use);
+    __Proxy(pooled, uint64_t, uint64_t, uint64_t, pooled);
+    __Proxy(bytes, uint64_t, uint64_t, uint64_t, bytes);
+
+protected:
+    virtual void register_fields() override {
+        register_field("kismet.system.packet_buffer.size", "buffer size class, in bytes", &size);
+        register_field("kismet.system.packet_buffer.in_use", "buffers held by packets", &in_use);
+        register_field("kismet.system.packet_buffer.pooled", "free buffers held in the pool", &pooled);
+        register_field("kismet.system.packet_buffer.bytes", "total bytes in use and pooled", &bytes);
+    }
+
+    std::shared_ptr<tracker_element_uint64> size;
+    std::shared_ptr<tracker_element_uint64> in_use;
+    std::shared_ptr<tracker_element_uint64> pooled;
+    std::shared_ptr<tracker_element_uint64> bytes;
+};
+
+// Placement of a server thread
+class tracked_thread_placement : public tracker_component {
+public:
+    tracked_thread_placement() :
+        tracker_component() {
+        register_fields();
+        reserve_fields(nullptr);
+    }
+
+    tracked_thread_placement(int in_id) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(nullptr);
+    }
+
+    tracked_thread_placement(int in_id, std::shared_ptr<tracker_element_map> e) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(e);
+    }
+
+    virtual std::shared_ptr<tracker_element> clone_type() override {
+        using this_t = typename std::remove_pointer<decltype(this)>::type;
+        auto r = std::make_shared<this_t>();
+        r->set_id(this->get_id());
+        return r;
+    }
+
+    virtual ~tracked_thread_placement() { }
+
+    __Proxy(name, std::string, std::string, std::string, name);
+    __Proxy(role, std::string, std::string, std::string, role);
+    __Proxy(tid, int64_t, int64_t, int64_t, tid);
+    __Proxy(node, int32_t, int32_t, int32_t, node);
+    __Proxy(cpus, std::string, std::string, std::string, cpus);
+
+protected:
+    virtual void register_fields() override {
+        register_field("kismet.system.thread.name", "thread name", &name);
+        register_field("kismet.system.thread.role", "thread role (packet, io, timer, eventbus)", &role);
+        register_field("kismet.system.thread.tid", "kernel thread id", &tid);
+        register_field("kismet.system.thread.node", "NUMA node threads are placed on, or -1", &node);
+        register_field("kismet.system.thread.cpus", "CPUs the thread may run on", &cpus);
+    }
+
+    std::shared_ptr<tracker_element_string> name;
+    std::shared_ptr<tracker_element_string> role;
+    std::shared_ptr<tracker_element_int64> tid;
+    std::shared_ptr<tracker_element_int32> node;
+    std::shared_ptr<tracker_element_string> cpus;
+};
+
 class tracked_system_status : public tracker_component {
 public:
     tracked_system_status() :
@@ -95,6 +197,19 @@ public:
     __Proxy(num_components, uint64_t, uint64_t, uint64_t, num_components);
     __Proxy(num_http_connections, uint64_t, uint64_t, uint64_t, num_http_connections);
 
+    __ProxyTrackable(packet_buffers, tracker_element_vector, packet_buffers);
+
+    __Proxy(memory_devices, uint64_t, uint64_t, uint64_t, memory_devices);
+    __Proxy(memory_packets_in_flight, uint64_t, uint64_t, uint64_t, memory_packets_in_flight);
+    __Proxy(memory_packets_bytes, uint64_t, uint64_t, uint64_t, memory_packets_bytes);
+    __Proxy(memory_pools_bytes, uint64_t, uint64_t, uint64_t, memory_pools_bytes);
+    __Proxy(memory_string_pool, uint64_t, uint64_t, uint64_t, memory_string_pool);
+    __Proxy(memory_log_queue, uint64_t, uint64_t, uint64_t, memory_log_queue);
+
+    __Proxy(governor_budget, uint64_t, uint64_t, uint64_t, governor_budget);
+    __Proxy(governor_level, uint8_t, unsigned int, unsigned int, governor_level);
+    __Proxy(governor_state, std::string, std::string, std::string, governor_state);
+
     virtual void pre_serialize() override;
 
 protected:
@@ -130,6 +245,37 @@ protected:
     std::shared_ptr<tracker_element_uint64> num_fields;
     std::shared_ptr<tracker_element_uint64> num_components;
     std::shared_ptr<tracker_element_uint64> num_http_connections;
+
+    std::shared_ptr<tracker_element_vector> packet_buffers;
+    int packet_buffer_entry_id;
+
+    std::shared_ptr<tracker_element_string> thread_placement;
+    std::shared_ptr<tracker_element_vector> threads;
+    int thread_entry_id;
+
+    // Memory held by each subsystem; the device estimate walks every device, so it is
+    // only refreshed every few seconds
+    std::shared_ptr<tracker_element_uint64> memory_devices;
+    std::shared_ptr<tracker_element_uint64> memory_packets_in_flight;
+    std::shared_ptr<tracker_element_uint64> memory_packets_bytes;
+    std::shared_ptr<tracker_element_uint64> memory_pools_bytes;
+    std::shared_ptr<tracker_element_uint64> memory_string_pool;
+    std::shared_ptr<tracker_element_uint64> memory_log_queue;
+    time_t memory_devices_ts{0};
+
+    // Huge page slab usage; the huge page count comes from smaps, so it is refreshed
+    // with the device estimate
+    std::shared_ptr<tracker_element_string> hugepage_mode;
+    std::shared_ptr<tracker_element_uint64> hugepage_reserved;
+    std::shared_ptr<tracker_element_uint64> hugepage_slab_bytes;
+    std::shared_ptr<tracker_element_uint64> hugepage_in_use;
+    std::shared_ptr<tracker_element_uint64> hugepage_backed;
+    std::shared_ptr<tracker_element_uint64> hugepage_fallbacks;
+
+    // Memory governor budget in KB (0 when disabled), step, and the policy of the step
+    std::shared_ptr<tracker_element_uint64> governor_budget;
+    std::shared_ptr<tracker_element_uint8> governor_level;
+    std::shared_ptr<tracker_element_string> governor_state;
 };
 
 class Systemmonitor : public lifetime_global, public time_tracker_event {
@@ -152,9 +298,13 @@ public:
     // time_tracker callback
     virtual int timetracker_event(int eventid) override;
 
+    // Resident memory, in KB, as of the last update
+    uint64_t get_memory_kb();
+
     static std::string event_timestamp() { return "TIMESTAMP"; }
     static std::string event_battery() { return "BATTERY"; }
     static std::string event_stats() { return "STATISTICS"; }
+    static std::string event_memory_pressure() { return "MEMORY_PRESSURE"; }
 
 protected:
     kis_mutex monitor_mutex;
@@ -176,6 +326,34 @@ protected:
     int event_timer_id;
     int kismetdb_log_timer;
 
+    // Memory governor; as RSS crosses each step of memory_governor_steps, as a
+    // percentage of the budget, retention is tightened one more step:
+    //
+    //  1  idle devices expire after memory_governor_device_timeout
+    //  2  device RRDs stop recording, and the RRDs of devices idle longer than
+    //     memory_governor_rrd_idle are freed
+    //  3  devices with random addresses of the memory_governor_sketch_phy phys are
+    //     sketched instead of tracked
+    //  4  the packet backlog limit is cut to memory_governor_backlog_pct
+    //
+    // Steps are relaxed one at a time once RSS has stayed memory_governor_relax_pct
+    // below a step for memory_governor_relax_time seconds.  Each change is published
+    // as a MEMORY_PRESSURE event.
+    uint64_t governor_budget_kb;
+    std::vector<unsigned int> governor_steps;
+    unsigned int governor_relax_pct;
+    int governor_relax_time;
+    int governor_device_timeout;
+    int governor_rrd_idle;
+    unsigned int governor_backlog_pct;
+
+    unsigned int governor_level;
+    time_t governor_below_since;
+    int governor_timer_id;
+
+    void memory_governor();
+    void apply_governor_level(unsigned int in_level);
+    static std::string governor_level_name(unsigned int in_level);
 };
 
 #endif
@@ -25,16 +25,16 @@
 
 #include "timetracker.h"
 
+#include "kis_net_beast_httpd.h"
+#include "kis_thread_placement.h"
+#include "kis_trace.h"
 #include "messagebus.h"
 
 time_tracker::time_tracker() {
     time_mutex.set_name("time_tracker");
-    removed_id_mutex.set_name("time_tracker_removed_id");
 
     next_timer_id = 1;
 
-    timer_sort_required = true;
-
     struct timeval cur_tm;
     gettimeofday(&cur_tm, NULL);
 
@@ -44,30 +44,52 @@ time_tracker::time_tracker() {
 
     shutdown = false;
 
-    // Allocate workers and fill them with joinable threads
-    auto n_worker_threads = static_cast<unsigned int>(std::thread::hardware_concurrency());
-    time_workers.resize(n_worker_threads);
+    wheel_epoch = std::chrono::steady_clock::now();
+    wheel_tick = 0;
+
+    timer_stats_vec_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.timetracker.timers",
+                tracker_element_factory<tracker_element_vector>(),
+                "timer statistics");
+    timer_stats_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.timetracker.timer",
+                tracker_element_factory<tracked_timer_stats>(),
+                "timer statistics");
+}
 
-    for (unsigned int x = 0; x < time_workers.size(); x++) {
-        time_workers[x] = std::thread([]() { });
+void time_tracker::spawn_timetracker_thread() {
+    // Workers are persistent; a timer firing only costs a queue push
+    auto n_worker_threads = std::max(2U, std::thread::hardware_concurrency());
+
+    auto placer = Globalreg::fetch_global_as<kis_thread_placement>();
+    if (placer != nullptr)
+        n_worker_threads = std::max(2U, placer->get_num_cpus());
+
+    for (unsigned int x = 0; x < n_worker_threads; x++) {
+        time_workers.push_back(std::thread([this, x]() {
+                    thread_set_process_name("TIME_EVT");
+                    kis_thread_placement::place_current_thread("TIME_EVT",
+                            kis_thread_placement::thread_role::timer, x);
+                    time_worker();
+                    }));
     }
 
-    /*
     time_dispatch_t =
         std::thread([this]() {
                 thread_set_process_name("timers");
+                kis_thread_placement::place_current_thread("timers",
+                        kis_thread_placement::thread_role::timer, 0);
                 time_dispatcher();
             });
-            */
 
-}
-
-void time_tracker::spawn_timetracker_thread() {
-    time_dispatch_t =
-        std::thread([this]() {
-                thread_set_process_name("timers");
-                time_dispatcher();
-            });
+    auto httpd = Globalreg::fetch_global_as<kis_net_beast_httpd>();
+    if (httpd != nullptr) {
+        httpd->register_route("/timetracker/timers", {"GET", "POST"}, httpd->RO_ROLE, {},
+                std::make_shared<kis_net_web_tracked_endpoint>(
+                    [this](std::shared_ptr<kis_net_beast_httpd_connection>) -> std::shared_ptr<tracker_element> {
+                        return timer_stats_endp_handler();
+                    }));
+    }
 }
 
 time_tracker::~time_tracker() {
@@ -76,347 +98,280 @@ time_tracker::~time_tracker() {
     if (time_dispatch_t.joinable())
         time_dispatch_t.join();
 
-    // time_dispatch_t.join();
+    for (unsigned int x = 0; x < time_workers.size(); x++)
+        worker_queue.enqueue(nullptr);
+
+    for (auto& w : time_workers) {
+        if (w.joinable())
+            w.join();
+    }
 
     Globalreg::globalreg->remove_global("TIMETRACKER");
     Globalreg::globalreg->timetracker = NULL;
 }
 
 void time_tracker::time_dispatcher() {
-    while (!shutdown && !Globalreg::globalreg->spindown && !Globalreg::globalreg->fatal_condition) {
-        kis_unique_lock<kis_mutex> lock(time_mutex, std::defer_lock, "time_tracker time_dispatcher");
+    const auto tick_len = std::chrono::milliseconds(1000 / SERVER_TIMESLICES_SEC);
+    std::vector<std::shared_ptr<timer_event>> expired;
 
-        // Calculate the next tick
-        auto start = std::chrono::system_clock::now();
-        auto end = start + std::chrono::milliseconds(1000 / SERVER_TIMESLICES_SEC);
-
-        // Handle scheduled events
+    while (!shutdown && !Globalreg::globalreg->spindown && !Globalreg::globalreg->fatal_condition) {
         struct timeval cur_tm;
         gettimeofday(&cur_tm, NULL);
 
         Globalreg::globalreg->last_tv_sec = cur_tm.tv_sec;
         Globalreg::globalreg->last_tv_usec = cur_tm.tv_usec;
 
-        // Sort and duplicate the vector to a safe list; we have to re-sort 
-        // timers from recurring events
-        lock.lock();
-
-        if (timer_sort_required)
-            sort(sorted_timers.begin(), sorted_timers.end(), sort_timer_events_trigger());
+        auto target_tick = static_cast<uint64_t>((std::chrono::steady_clock::now() - wheel_epoch) / tick_len);
 
-        timer_sort_required = false;
+        std::chrono::steady_clock::time_point next_tick;
 
-        // Sort the timers
-        auto action_timers = std::vector<std::shared_ptr<timer_event>>(sorted_timers.begin(), sorted_timers.end());
-        lock.unlock();
+        {
+            kis_lock_guard<kis_mutex> lk(time_mutex, "time_tracker time_dispatcher");
 
-        for (auto evt : action_timers) {
-            // If we're pending cancellation, throw us out
-            if (evt->timer_cancelled) {
-                kis_lock_guard<kis_mutex> rl(removed_id_mutex);
-                removed_timer_ids.push_back(evt->timer_id);
-                continue;
-            }
+            // Turn the wheel to the current time; if we were delayed this catches up
+            // every tick we missed
+            while (wheel_tick < target_tick)
+                wheel_advance(expired);
 
-            // We're into the future, bail
-            if ((cur_tm.tv_sec < evt->trigger_tm.tv_sec) ||
-                    ((cur_tm.tv_sec == evt->trigger_tm.tv_sec) && (cur_tm.tv_usec < evt->trigger_tm.tv_usec))) {
-                break;
-            }
+            next_tick = wheel_epoch + (wheel_tick + 1) * tick_len;
+        }
 
-            // Find a usable worker slot; this is a fast-burn while loop for now
-            // to see how it performs, if we need to add a sleep we will
-            bool launched = false;
-            time_t started_looking = time(0);
-            while (!launched) {
-                // Catch an unwinnable situation for timers; 5 seconds is actually excessively long for
-                // timers that could be executing at 10Hz.
-                if (started_looking - time(0) > 5) {
-                    throw std::runtime_error("Couldn't find a slot in the timer handlers in 5 seconds; something "
-                                             "has gone wrong, most likely thread deadlocks.");
-                }
-
-                for (unsigned int t = 0; t < time_workers.size(); t++) {
-                    // Found a worker slot
-                    if (time_workers[t].joinable()) {
-                        time_workers[t].join();
-
-                        time_workers[t] = std::thread([evt, this]() {
-                            thread_set_process_name("TIME_EVT");
-
-                            // Call the function with the given parameters
-                            int ret = 0;
-                            if (evt->callback != NULL) {
-                                ret = (*evt->callback)(evt.get(), evt->callback_parm, Globalreg::globalreg);
-                            } else if (evt->event != NULL) {
-                                ret = evt->event->timetracker_event(evt->timer_id);
-                            } else if (evt->event_func != NULL) {
-                                ret = evt->event_func(evt->timer_id);
-                            }
-
-                            if (ret > 0 && evt->timeslices != -1 && evt->recurring) {
-                                kis_lock_guard<kis_mutex> tl(time_mutex, "event rescheduler");
-
-                                struct timeval cur_tm;
-                                gettimeofday(&cur_tm, NULL);
-
-                                evt->schedule_tm.tv_sec = cur_tm.tv_sec;
-                                evt->schedule_tm.tv_usec = cur_tm.tv_usec;
-                                evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + (evt->timeslices / SERVER_TIMESLICES_SEC);
-                                evt->trigger_tm.tv_usec = evt->schedule_tm.tv_usec + 
-                                    ((evt->timeslices % SERVER_TIMESLICES_SEC) * (1000000L / SERVER_TIMESLICES_SEC));
-
-                                if (evt->trigger_tm.tv_usec >= 999999L) {
-                                    evt->trigger_tm.tv_sec++;
-                                    evt->trigger_tm.tv_usec %= 1000000L;
-                                }
-
-                                timer_sort_required = true;
-                            } else {
-                                kis_lock_guard<kis_mutex> rl(removed_id_mutex);
-                                removed_timer_ids.push_back(evt->timer_id);
-                            }
-                        });
-
-                        launched = true;
-                        break;
-                    }
-                }
-            }
+        for (auto& evt : expired) {
+            if (!evt->timer_cancelled)
+                worker_queue.enqueue(evt);
         }
 
+        expired.clear();
+
+        std::this_thread::sleep_until(next_tick);
+    }
+}
+
+void time_tracker::time_worker() {
+    const auto tick_len = std::chrono::milliseconds(1000 / SERVER_TIMESLICES_SEC);
+
+    while (true) {
+        std::shared_ptr<timer_event> evt;
+
+        worker_queue.wait_dequeue(evt);
+
+        if (evt == nullptr)
+            return;
+
+        if (evt->timer_cancelled)
+            continue;
+
+        auto start_tm = std::chrono::steady_clock::now();
+
+        // Call the function with the given parameters
+        int ret = 0;
+
         {
-            // Actually remove the timers under dual lock
-            std::lock(time_mutex, removed_id_mutex);
-            kis_lock_guard<kis_mutex> l(time_mutex, std::adopt_lock);
-            kis_lock_guard<kis_mutex> rl(removed_id_mutex, std::adopt_lock);
-
-            for (auto x : removed_timer_ids) {
-                auto itr = timer_map.find(x);
-
-                if (itr != timer_map.end()) {
-                    for (auto sorted_itr = sorted_timers.begin(); sorted_itr != sorted_timers.end(); ++sorted_itr) {
-                        if ((*sorted_itr)->timer_id == x) {
-                            sorted_timers.erase(sorted_itr);
-                            break;
-                        }
-                    }
-
-                    timer_map.erase(itr);
-                }
+            kis_trace_span span("timer", evt->trace_name);
+
+            if (evt->callback != NULL) {
+                ret = (*evt->callback)(evt.get(), evt->callback_parm, Globalreg::globalreg);
+            } else if (evt->event != NULL) {
+                ret = evt->event->timetracker_event(evt->timer_id);
+            } else if (evt->event_func != NULL) {
+                ret = evt->event_func(evt->timer_id);
             }
-
-            removed_timer_ids.clear();
         }
 
-        /*
-        if (std::chrono::system_clock::now() >= end) {
-            fmt::print("debug - timetracker missed time slot by {} ms\n",
-                    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - end).count());
+        auto end_tm = std::chrono::steady_clock::now();
+
+        auto run_us = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(end_tm - start_tm).count());
+        auto latency_us = start_tm > evt->due_tm ? static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(start_tm - evt->due_tm).count()) : 0;
+
+        evt->n_runs++;
+        evt->last_run_us = run_us;
+        evt->total_run_us += run_us;
+        evt->last_latency_us = latency_us;
+        evt->last_ms = run_us / 1000.0f;
+        evt->total_ms += evt->last_ms;
+
+        if (run_us > evt->max_run_us)
+            evt->max_run_us = run_us;
+        if (latency_us > evt->max_latency_us)
+            evt->max_latency_us = latency_us;
+
+        // An overrun is a timer which started more than a tick late, or a recurring
+        // timer which ran longer than its own interval
+        const auto tick_us = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(tick_len).count());
+
+        if (latency_us > tick_us || 
+                (evt->recurring && evt->timeslices > 0 && run_us > tick_us * evt->timeslices))
+            evt->n_overruns++;
+
+        kis_lock_guard<kis_mutex> tl(time_mutex, "event rescheduler");
+
+        if (ret > 0 && evt->timeslices != -1 && evt->recurring && !evt->timer_cancelled) {
+            gettimeofday(&evt->schedule_tm, NULL);
+            wheel_schedule(evt, evt->timeslices);
+        } else {
+            auto itr = timer_map.find(evt->timer_id);
+            if (itr != timer_map.end() && itr->second == evt)
+                timer_map.erase(itr);
         }
-        */
-
-
-        std::this_thread::sleep_until(end);
     }
 }
 
-int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
-                               int in_recurring, 
-                               int (*in_callback)(TIMEEVENT_PARMS),
-                               void *in_parm) {
-    kis_lock_guard<kis_mutex> lk(time_mutex);
+void time_tracker::wheel_schedule(std::shared_ptr<timer_event> evt, uint64_t in_ticks) {
+    const auto tick_len = std::chrono::milliseconds(1000 / SERVER_TIMESLICES_SEC);
 
-    auto evt = std::make_shared<timer_event>();
+    // Timers always wait at least one tick
+    if (in_ticks == 0)
+        in_ticks = 1;
 
-    evt->total_ms = 0;
-    evt->last_ms = 0;
+    evt->expire_tick = wheel_tick + in_ticks;
+    evt->due_tm = wheel_epoch + evt->expire_tick * tick_len;
 
-    evt->timer_id = next_timer_id++;
-    gettimeofday(&(evt->schedule_tm), NULL);
+    evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + (in_ticks / SERVER_TIMESLICES_SEC);
+    evt->trigger_tm.tv_usec = evt->schedule_tm.tv_usec + 
+        ((in_ticks % SERVER_TIMESLICES_SEC) * (1000000L / SERVER_TIMESLICES_SEC));
 
-    if (in_trigger != NULL) {
-        evt->trigger_tm.tv_sec = in_trigger->tv_sec;
-        evt->trigger_tm.tv_usec = in_trigger->tv_usec;
-        evt->timeslices = -1;
-    } else {
-        evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + (in_timeslices / 10);
-        evt->trigger_tm.tv_usec = evt->schedule_tm.tv_usec + (in_timeslices % 10);
-        evt->timeslices = in_timeslices;
+    if (evt->trigger_tm.tv_usec >= 1000000L) {
+        evt->trigger_tm.tv_sec++;
+        evt->trigger_tm.tv_usec %= 1000000L;
     }
 
-    evt->recurring = in_recurring;
-    evt->callback = in_callback;
-    evt->callback_parm = in_parm;
-    evt->event = NULL;
+    wheel_insert(evt);
+}
 
-    timer_map[evt->timer_id] = evt;
-    sorted_timers.push_back(evt);
+void time_tracker::wheel_insert(std::shared_ptr<timer_event> evt) {
+    auto delta = evt->expire_tick > wheel_tick ? evt->expire_tick - wheel_tick : 0;
 
-    // Resort the list
-    timer_sort_required = true;
+    for (unsigned int l = 0; l < wheel_levels; l++) {
+        if (delta < (1ULL << (wheel_bits * (l + 1)))) {
+            auto slot = (evt->expire_tick >> (wheel_bits * l)) & (wheel_slots - 1);
+            timer_wheel[l][slot].push_back(evt);
+            return;
+        }
+    }
 
-    return evt->timer_id;
+    timer_overflow.push_back(evt);
 }
 
-int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
-        int in_recurring, time_tracker_event *in_event) {
-    kis_lock_guard<kis_mutex> lk(time_mutex);
+void time_tracker::wheel_cascade(std::vector<std::shared_ptr<timer_event>>& slot) {
+    std::vector<std::shared_ptr<timer_event>> cascade;
+    cascade.swap(slot);
 
-    auto evt = std::make_shared<timer_event>();
+    for (auto& evt : cascade) {
+        if (!evt->timer_cancelled)
+            wheel_insert(evt);
+    }
+}
 
-    evt->total_ms = 0;
-    evt->last_ms = 0;
+void time_tracker::wheel_advance(std::vector<std::shared_ptr<timer_event>>& expired) {
+    wheel_tick++;
 
-    evt->timer_cancelled = false;
-    evt->timer_id = next_timer_id++;
+    // When a level wraps, redistribute the next slot of the level above it, from the 
+    // top down so that events can fall through multiple levels in one tick
+    for (int l = wheel_levels; l > 0; l--) {
+        auto mask = (1ULL << (wheel_bits * l)) - 1;
 
-    gettimeofday(&(evt->schedule_tm), NULL);
+        if ((wheel_tick & mask) != 0)
+            continue;
 
-    if (in_trigger != NULL) {
-        evt->trigger_tm.tv_sec = in_trigger->tv_sec;
-        evt->trigger_tm.tv_usec = in_trigger->tv_usec;
-        evt->timeslices = -1;
-    } else {
-        evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + 
-            (in_timeslices / SERVER_TIMESLICES_SEC);
-        evt->trigger_tm.tv_usec = evt->schedule_tm.tv_usec + 
-            ((in_timeslices % SERVER_TIMESLICES_SEC) *
-             (1000000L / SERVER_TIMESLICES_SEC));
-
-        if (evt->trigger_tm.tv_usec >= 999999L) {
-            evt->trigger_tm.tv_sec++;
-            evt->trigger_tm.tv_usec %= 1000000L;
-        }
-            
-        evt->timeslices = in_timeslices;
+        if (l == static_cast<int>(wheel_levels))
+            wheel_cascade(timer_overflow);
+        else
+            wheel_cascade(timer_wheel[l][(wheel_tick >> (wheel_bits * l)) & (wheel_slots - 1)]);
     }
 
-    evt->recurring = in_recurring;
-    evt->callback = NULL;
-    evt->callback_parm = NULL;
-    evt->event = in_event;
-
-    timer_map[evt->timer_id] = evt;
-    sorted_timers.push_back(evt);
+    auto& slot = timer_wheel[0][wheel_tick & (wheel_slots - 1)];
 
-    // Resort the list
-    timer_sort_required = true;
+    for (auto& evt : slot) {
+        if (!evt->timer_cancelled)
+            expired.push_back(evt);
+    }
 
-    return evt->timer_id;
+    slot.clear();
 }
 
-int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
-        int in_recurring, std::function<int (int)> in_event) {
-    kis_lock_guard<kis_mutex> lk(time_mutex);
-
-    auto evt = std::make_shared<timer_event>();
+int time_tracker::add_timer(std::shared_ptr<timer_event> evt, struct timeval *in_trigger, 
+        int in_timeslices) {
+    kis_lock_guard<kis_mutex> lk(time_mutex, "time_tracker add_timer");
 
     evt->total_ms = 0;
     evt->last_ms = 0;
 
+    evt->n_runs = 0;
+    evt->n_overruns = 0;
+    evt->last_run_us = 0;
+    evt->max_run_us = 0;
+    evt->total_run_us = 0;
+    evt->last_latency_us = 0;
+    evt->max_latency_us = 0;
+
     evt->timer_cancelled = false;
     evt->timer_id = next_timer_id++;
 
+    // Unnamed timers share one trace name instead of interning every id
+    if (evt->name.length() == 0) {
+        evt->name = fmt::format("timer {}", evt->timer_id);
+        evt->trace_name = "timer";
+    } else {
+        evt->trace_name = kis_tracer::intern(evt->name);
+    }
+
     gettimeofday(&(evt->schedule_tm), NULL);
 
+    timer_map[evt->timer_id] = evt;
+
     if (in_trigger != NULL) {
+        // Convert an absolute trigger time to ticks from now, rounding up
+        auto delta_us = (static_cast<int64_t>(in_trigger->tv_sec) - evt->schedule_tm.tv_sec) * 1000000L +
+            (static_cast<int64_t>(in_trigger->tv_usec) - evt->schedule_tm.tv_usec);
+        const int64_t tick_us = 1000000L / SERVER_TIMESLICES_SEC;
+
+        evt->timeslices = -1;
+        wheel_schedule(evt, delta_us <= 0 ? 0 : (delta_us + tick_us - 1) / tick_us);
+
         evt->trigger_tm.tv_sec = in_trigger->tv_sec;
         evt->trigger_tm.tv_usec = in_trigger->tv_usec;
-        evt->timeslices = -1;
     } else {
-        evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + 
-            (in_timeslices / SERVER_TIMESLICES_SEC);
-        evt->trigger_tm.tv_usec = evt->schedule_tm.tv_usec + 
-            ((in_timeslices % SERVER_TIMESLICES_SEC) * 
-             (1000000L / SERVER_TIMESLICES_SEC));
         evt->timeslices = in_timeslices;
-
-        if (evt->trigger_tm.tv_usec >= 999999L) {
-            evt->trigger_tm.tv_sec++;
-            evt->trigger_tm.tv_usec %= 1000000L;
-        }
+        wheel_schedule(evt, in_timeslices < 0 ? 0 : in_timeslices);
     }
 
-    evt->recurring = in_recurring;
-    evt->callback = NULL;
-    evt->callback_parm = NULL;
-    evt->event = NULL;
-    
-    evt->event_func = in_event;
-
-    timer_map[evt->timer_id] = evt;
-    sorted_timers.push_back(evt);
-
-    // Resort the list
-    timer_sort_required = true;
-
     return evt->timer_id;
 }
 
-int time_tracker::register_timer(const slice& in_timeslices,
+int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
                                int in_recurring, 
                                int (*in_callback)(TIMEEVENT_PARMS),
                                void *in_parm) {
-    kis_lock_guard<kis_mutex> lk(time_mutex);
-
     auto evt = std::make_shared<timer_event>();
 
-    evt->total_ms = 0;
-    evt->last_ms = 0;
-
-    evt->timer_id = next_timer_id++;
-    gettimeofday(&(evt->schedule_tm), NULL);
-
-    evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + (in_timeslices.count() / 10);
-    evt->trigger_tm.tv_usec = evt->schedule_tm.tv_usec + (in_timeslices.count() % 10);
-    evt->timeslices = in_timeslices.count();
-
-    if (evt->trigger_tm.tv_usec >= 999999L) {
-        evt->trigger_tm.tv_sec++;
-        evt->trigger_tm.tv_usec %= 1000000L;
-    }
-
     evt->recurring = in_recurring;
     evt->callback = in_callback;
     evt->callback_parm = in_parm;
     evt->event = NULL;
 
-    timer_map[evt->timer_id] = evt;
-    sorted_timers.push_back(evt);
-
-    // Resort the list
-    timer_sort_required = true;
-
-    return evt->timer_id;
+    return add_timer(evt, in_trigger, in_timeslices);
 }
 
-int time_tracker::register_timer(const slice& in_timeslices,
-        int in_recurring, std::function<int (int)> in_event) {
-    kis_lock_guard<kis_mutex> lk(time_mutex);
-
+int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
+        int in_recurring, time_tracker_event *in_event) {
     auto evt = std::make_shared<timer_event>();
 
-    evt->total_ms = 0;
-    evt->last_ms = 0;
-
-    evt->timer_cancelled = false;
-    evt->timer_id = next_timer_id++;
-
-    gettimeofday(&(evt->schedule_tm), NULL);
+    evt->recurring = in_recurring;
+    evt->callback = NULL;
+    evt->callback_parm = NULL;
+    evt->event = in_event;
 
-    evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + 
-        (in_timeslices.count() / SERVER_TIMESLICES_SEC);
-    evt->trigger_tm.tv_usec = evt->schedule_tm.tv_usec + 
-        ((in_timeslices.count() % SERVER_TIMESLICES_SEC) * 
-         (1000000L / SERVER_TIMESLICES_SEC));
-    evt->timeslices = in_timeslices.count();
+    return add_timer(evt, in_trigger, in_timeslices);
+}
 
-    if (evt->trigger_tm.tv_usec >= 999999L) {
-        evt->trigger_tm.tv_sec++;
-        evt->trigger_tm.tv_usec %= 1000000L;
-    }
+int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
+        int in_recurring, std::function<int (int)> in_event, const std::string& in_name) {
+    auto evt = std::make_shared<timer_event>();
 
+    evt->name = in_name;
     evt->recurring = in_recurring;
     evt->callback = NULL;
     evt->callback_parm = NULL;
@@ -424,32 +379,64 @@ int time_tracker::register_timer(const slice& in_timeslices,
     
     evt->event_func = in_event;
 
-    timer_map[evt->timer_id] = evt;
-    sorted_timers.push_back(evt);
+    return add_timer(evt, in_trigger, in_timeslices);
+}
 
-    // Resort the list
-    timer_sort_required = true;
+int time_tracker::register_timer(const slice& in_timeslices,
+                               int in_recurring, 
+                               int (*in_callback)(TIMEEVENT_PARMS),
+                               void *in_parm) {
+    return register_timer(in_timeslices.count(), NULL, in_recurring, in_callback, in_parm);
+}
 
-    return evt->timer_id;
+int time_tracker::register_timer(const slice& in_timeslices,
+        int in_recurring, std::function<int (int)> in_event, const std::string& in_name) {
+    return register_timer(in_timeslices.count(), NULL, in_recurring, in_event, in_name);
 }
 
 int time_tracker::remove_timer(int in_timerid) {
-    // Removing a timer sets the atomic cancelled and puts us on the abort list;
-    // we'll get cleaned out of the main list the next iteration through the main code.
-    
-    kis_lock_guard<kis_mutex> lk(time_mutex);
+    // Removing a timer marks it cancelled; the wheel drops it the next time its slot
+    // is visited, and a running instance will not be rescheduled
+    kis_lock_guard<kis_mutex> lk(time_mutex, "time_tracker remove_timer");
 
     auto itr = timer_map.find(in_timerid);
 
-    if (itr != timer_map.end()) {
-        itr->second->timer_cancelled = true;
-
-        kis_lock_guard<kis_mutex> lk(removed_id_mutex);
-        removed_timer_ids.push_back(in_timerid);
-    } else {
+    if (itr == timer_map.end())
         return 0;
-    }
+
+    itr->second->timer_cancelled = true;
+    timer_map.erase(itr);
 
     return 1;
 }
 
+std::shared_ptr<tracker_element> time_tracker::timer_stats_endp_handler() {
+    auto ret = std::make_shared<tracker_element_vector>(timer_stats_vec_id);
+
+    kis_lock_guard<kis_mutex> lk(time_mutex, "time_tracker timer_stats");
+
+    for (const auto& ti : timer_map) {
+        const auto& evt = ti.second;
+
+        auto stats = std::make_shared<tracked_timer_stats>(timer_stats_id);
+
+        uint64_t runs = evt->n_runs;
+
+        stats->set_timer_id(evt->timer_id);
+        stats->set_timer_name(evt->name);
+        stats->set_interval_ms(evt->timeslices > 0 ? 
+                evt->timeslices * (1000 / SERVER_TIMESLICES_SEC) : 0);
+        stats->set_recurring(evt->recurring);
+        stats->set_runs(runs);
+        stats->set_overruns(evt->n_overruns);
+        stats->set_last_run_us(evt->last_run_us);
+        stats->set_max_run_us(evt->max_run_us);
+        stats->set_mean_run_us(runs == 0 ? 0 : evt->total_run_us / runs);
+        stats->set_last_latency_us(evt->last_latency_us);
+        stats->set_max_latency_us(evt->max_latency_us);
+
+        ret->push_back(stats);
+    }
+
+    return ret;
+}
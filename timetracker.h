@@ -31,9 +31,13 @@
 #include <vector>
 
 #include <functional>
+#include <thread>
 
 #include "globalregistry.h"
 #include "kis_mutex.h"
+#include "trackedcomponent.h"
+
+#include "moodycamel/blockingconcurrentqueue.h"
 
 // For ubertooth and a few older plugins that compile against both svn and old
 #define KIS_NEW_TIMER_PARM	1
@@ -43,6 +47,99 @@
 
 class time_tracker_event;
 
+// Per-timer execution statistics
+class tracked_timer_stats : public tracker_component {
+public:
+    tracked_timer_stats() :
+        tracker_component() {
+        register_fields();
+        reserve_fields(nullptr);
+    }
+
+    tracked_timer_stats(int in_id) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(nullptr);
+    }
+
+    tracked_timer_stats(int in_id, std::shared_ptr<tracker_element_map> e) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(e);
+    }
+
+    tracked_timer_stats(const tracked_timer_stats *p) :
+        tracker_component{p} {
+        __ImportField(timer_id, p);
+        __ImportField(timer_name, p);
+        __ImportField(interval_ms, p);
+        __ImportField(recurring, p);
+        __ImportField(runs, p);
+        __ImportField(overruns, p);
+        __ImportField(last_run_us, p);
+        __ImportField(max_run_us, p);
+        __ImportField(mean_run_us, p);
+        __ImportField(last_latency_us, p);
+        __ImportField(max_latency_us, p);
+        reserve_fields(nullptr);
+    }
+
+    virtual uint32_t get_signature() const override {
+        return adler32_checksum("tracked_timer_stats");
+    }
+
+    virtual std::shared_ptr<tracker_element> clone_type() override {
+        using this_t = typename std::remove_pointer<decltype(this)>::type;
+        auto r = std::make_shared<this_t>(this);
+        return r;
+    }
+
+    __Proxy(timer_id, int32_t, int, int, timer_id);
+    __Proxy(timer_name, std::string, std::string, std::string, timer_name);
+    __Proxy(interval_ms, uint64_t, uint64_t, uint64_t, interval_ms);
+    __Proxy(recurring, uint8_t, bool, bool, recurring);
+    __Proxy(runs, uint64_t, uint64_t, uint64_t, runs);
+    __Proxy(overruns, uint64_t, uint64_t, uint64_t, overruns);
+    __Proxy(last_run_us, uint64_t, uint64_t, uint64_t, last_run_us);
+    __Proxy(max_run_us, uint64_t, uint64_t, uint64_t, max_run_us);
+    __Proxy(mean_run_us, uint64_t, uint64_t, uint64_t, mean_run_us);
+    __Proxy(last_latency_us, uint64_t, uint64_t, uint64_t, last_latency_us);
+    __Proxy(max_latency_us, uint64_t, uint64_t, uint64_t, max_latency_us);
+
+protected:
+    virtual void register_fields() override {
+        tracker_component::register_fields();
+
+        register_field("kismet.timetracker.timer.id", "timer id", &timer_id);
+        register_field("kismet.timetracker.timer.name", "timer name", &timer_name);
+        register_field("kismet.timetracker.timer.interval_ms", "timer interval (ms, 0 for one-shot)", 
+                &interval_ms);
+        register_field("kismet.timetracker.timer.recurring", "timer is recurring", &recurring);
+        register_field("kismet.timetracker.timer.runs", "number of times timer has run", &runs);
+        register_field("kismet.timetracker.timer.overruns", 
+                "number of times timer ran late or ran longer than its interval", &overruns);
+        register_field("kismet.timetracker.timer.last_run_us", "last run time (us)", &last_run_us);
+        register_field("kismet.timetracker.timer.max_run_us", "maximum run time (us)", &max_run_us);
+        register_field("kismet.timetracker.timer.mean_run_us", "mean run time (us)", &mean_run_us);
+        register_field("kismet.timetracker.timer.last_latency_us", 
+                "last dispatch latency after trigger time (us)", &last_latency_us);
+        register_field("kismet.timetracker.timer.max_latency_us", 
+                "maximum dispatch latency after trigger time (us)", &max_latency_us);
+    }
+
+    std::shared_ptr<tracker_element_int32> timer_id;
+    std::shared_ptr<tracker_element_string> timer_name;
+    std::shared_ptr<tracker_element_uint64> interval_ms;
+    std::shared_ptr<tracker_element_uint8> recurring;
+    std::shared_ptr<tracker_element_uint64> runs;
+    std::shared_ptr<tracker_element_uint64> overruns;
+    std::shared_ptr<tracker_element_uint64> last_run_us;
+    std::shared_ptr<tracker_element_uint64> max_run_us;
+    std::shared_ptr<tracker_element_uint64> mean_run_us;
+    std::shared_ptr<tracker_element_uint64> last_latency_us;
+    std::shared_ptr<tracker_element_uint64> max_latency_us;
+};
+
 class time_tracker : public lifetime_global {
 public:
     using slice = std::chrono::duration<int, std::ratio<1, 10>>;
@@ -53,6 +150,9 @@ public:
         // Event name
         std::string name;
 
+        // Interned name for trace spans
+        const char *trace_name;
+
         // Time running in ms
         double total_ms;
         double last_ms;
@@ -79,20 +179,19 @@ public:
         // C function, if we weren't
         int (*callback)(timer_event *, void *, global_registry *);
         void *callback_parm;
-    };
 
-    // Sort alerts by alert trigger time
-    class sort_timer_events_trigger {
-    public:
-        inline bool operator() (std::shared_ptr<time_tracker::timer_event> x, 
-								std::shared_ptr<time_tracker::timer_event> y) const {
-            if ((x->trigger_tm.tv_sec < y->trigger_tm.tv_sec) ||
-                ((x->trigger_tm.tv_sec == y->trigger_tm.tv_sec) && 
-				 (x->trigger_tm.tv_usec < y->trigger_tm.tv_usec)))
-                return 1;
-
-            return 0;
-        }
+        // Timer wheel tick this event expires on, and the matching deadline
+        uint64_t expire_tick;
+        std::chrono::steady_clock::time_point due_tm;
+
+        // Execution accounting, updated by the worker running the event
+        std::atomic<uint64_t> n_runs;
+        std::atomic<uint64_t> n_overruns;
+        std::atomic<uint64_t> last_run_us;
+        std::atomic<uint64_t> max_run_us;
+        std::atomic<uint64_t> total_run_us;
+        std::atomic<uint64_t> last_latency_us;
+        std::atomic<uint64_t> max_latency_us;
     };
 
     static std::string global_name() { return "TIMETRACKER"; }
@@ -121,7 +220,8 @@ public:
             int in_recurring, time_tracker_event *event);
 
     int register_timer(int timeslices, struct timeval *in_trigger,
-            int in_recurring, std::function<int (int)> event);
+            int in_recurring, std::function<int (int)> event,
+            const std::string& in_name = "");
 
     int register_timer(const slice& in_timeslices,
             int in_recurring,
@@ -129,7 +229,8 @@ public:
             void *in_parm); 
 
     int register_timer(const slice& in_timeslices,
-            int in_recurring, std::function<int (int)> event);
+            int in_recurring, std::function<int (int)> event,
+            const std::string& in_name = "");
 
     // Remove a timer that's going to execute
     int remove_timer(int timer_id);
@@ -139,24 +240,46 @@ public:
 protected:
     kis_mutex time_mutex;
 
+    // Persistent worker pool; the dispatcher queues expired events and the workers
+    // run them
     std::vector<std::thread> time_workers;
+    moodycamel::BlockingConcurrentQueue<std::shared_ptr<timer_event>> worker_queue;
 
     void time_dispatcher(void);
+    void time_worker(void);
 
-    // Do we have to re-sort the list of timers?
-    std::atomic<bool> timer_sort_required;
+    // Common timer setup; takes ownership of the event and schedules it
+    int add_timer(std::shared_ptr<timer_event> evt, struct timeval *in_trigger, int in_timeslices);
 
     // Next timer ID to be assigned
     std::atomic<int> next_timer_id;
 
     std::map<int, std::shared_ptr<timer_event>> timer_map;
-    std::vector<std::shared_ptr<timer_event>> sorted_timers;
 
-    kis_mutex removed_id_mutex;
-    std::vector<int> removed_timer_ids;
+    // Hierarchical timer wheel of 100ms ticks; each level covers wheel_slots times 
+    // the span of the level below it, and anything beyond the last level waits in
+    // the overflow list until it cascades down.  All wheel operations require
+    // time_mutex.
+    static constexpr unsigned int wheel_bits = 6;
+    static constexpr unsigned int wheel_slots = 1 << wheel_bits;
+    static constexpr unsigned int wheel_levels = 3;
+
+    std::vector<std::shared_ptr<timer_event>> timer_wheel[wheel_levels][wheel_slots];
+    std::vector<std::shared_ptr<timer_event>> timer_overflow;
+
+    std::chrono::steady_clock::time_point wheel_epoch;
+    uint64_t wheel_tick;
+
+    void wheel_schedule(std::shared_ptr<timer_event> evt, uint64_t in_ticks);
+    void wheel_insert(std::shared_ptr<timer_event> evt);
+    void wheel_cascade(std::vector<std::shared_ptr<timer_event>>& slot);
+    void wheel_advance(std::vector<std::shared_ptr<timer_event>>& expired);
 
     std::thread time_dispatch_t;
     std::atomic<bool> shutdown;
+
+    int timer_stats_vec_id, timer_stats_id;
+    std::shared_ptr<tracker_element> timer_stats_endp_handler();
 };
 
 class time_tracker_event {
@@ -1,12 +1,23 @@
 #!/usr/bin/env python3
 
+# Generates the Kismet manuf database from the IEEE OUI list.
+#
+# By default the OUI list is downloaded and printed as the text manuf file
+# (kismet_manuf.txt.gz, once compressed).  With --binary, the prebuilt OUI
+# table loaded by 'ouidb=' is written as well; with --from, an existing text
+# manuf file (optionally gzip'd) is converted instead of downloading the list.
+
 from __future__ import print_function
+import argparse
+import gzip
 import os
 import sys
 import re
-import requests
+import struct
 
-manufs = []
+# Must match KIS_OUIDB_MAGIC and KIS_OUIDB_VERSION in manuf.h
+OUIDB_MAGIC = 0x494F554B
+OUIDB_VERSION = 1
 
 # Original IEEE URI
 # OUIURI = "http://standards-oui.ieee.org/oui.txt"
@@ -14,20 +25,99 @@ manufs = []
 # Sanitized and cleaned up maintained version
 OUIURI = "http://linuxnet.ca/ieee/oui.txt"
 
-with requests.get(OUIURI) as r:
-    for rl in r.iter_lines():
-        l = rl.decode('UTF-8')
-        p = re.compile("([0-9A-F]{2}-[0-9A-F]{2}-[0-9A-F]{2}) +\(hex\)\t+(.*)")
-        m = p.match(l)
-        
-        if m is not None and len(m.groups()) == 2:
-            oui = m.group(1).replace("-", ":")
-            manufs.append("{}\t{}".format(oui, m.group(2)))
+def fetch_manufs():
+    import requests
+
+    manufs = []
+
+    p = re.compile("([0-9A-F]{2}-[0-9A-F]{2}-[0-9A-F]{2}) +\(hex\)\t+(.*)")
+
+    with requests.get(OUIURI) as r:
+        for rl in r.iter_lines():
+            l = rl.decode('UTF-8')
+            m = p.match(l)
+
+            if m is not None and len(m.groups()) == 2:
+                oui = m.group(1).replace("-", ":")
+                manufs.append("{}\t{}".format(oui, m.group(2)))
+
+    return manufs
+
+def read_manufs(fname):
+    manufs = []
+
+    opener = gzip.open if fname.endswith(".gz") else open
+
+    with opener(fname, "rt", encoding="UTF-8", errors="replace") as f:
+        for l in f:
+            l = l.rstrip("\n")
+
+            if len(l) < 10 or l[8] != "\t":
+                continue
+
+            manufs.append(l)
+
+    return manufs
+
+def write_binary(manufs, fname):
+    ouis = []
+    offsets = []
+    names = bytearray()
+    name_offsets = {}
+
+    entries = sorted([(int(m[0:8].replace(":", ""), 16), m[9:]) for m in manufs],
+            key=lambda e: e[0])
+
+    last_oui = -1
+
+    for (oui, n) in entries:
+        name = n.encode("UTF-8")
+
+        # Sorted input may still repeat an OUI; the first record wins
+        if oui == last_oui:
+            continue
+
+        last_oui = oui
+
+        # Many OUIs share a manufacturer, so each name is stored once
+        if name not in name_offsets:
+            name_offsets[name] = len(names)
+            names += name + b"\0"
+
+        ouis.append(oui)
+        offsets.append(name_offsets[name])
+
+    if len(names) == 0:
+        names += b"\0"
+
+    with open(fname, "wb") as f:
+        f.write(struct.pack("<IIII", OUIDB_MAGIC, OUIDB_VERSION, len(ouis), len(names)))
+        f.write(struct.pack("<{}I".format(len(ouis)), *ouis))
+        f.write(struct.pack("<{}I".format(len(offsets)), *offsets))
+        f.write(names)
+
+    print("Wrote {} OUIs to {}".format(len(ouis), fname), file=sys.stderr)
+
+parser = argparse.ArgumentParser(description="Kismet OUI database generator")
+parser.add_argument("--from", dest="source", action="store",
+        help="Convert an existing text manuf file instead of downloading the OUI list")
+parser.add_argument("--binary", action="store",
+        help="Write the prebuilt OUI table to this file")
+
+args = parser.parse_args()
+
+if args.source is not None:
+    manufs = read_manufs(args.source)
+else:
+    manufs = fetch_manufs()
 
 print("Parsed {} manufs".format(len(manufs)), file=sys.stderr)
 
 manufs.sort()
 
-for m in manufs:
-    print(m)
-    
+if args.binary is not None:
+    write_binary(manufs, args.binary)
+
+if args.source is None:
+    for m in manufs:
+        print(m)
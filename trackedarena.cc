@@ -0,0 +1,75 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "kis_hugepage_slab.h"
+#include "trackedarena.h"
+
+tracker_arena::tracker_arena(size_t in_chunk_sz) :
+    chunk_sz{in_chunk_sz},
+    pos{nullptr},
+    remaining{0},
+    allocated{0} {
+    mutex.set_name("tracker_arena");
+}
+
+tracker_arena::~tracker_arena() {
+    for (const auto& c : chunks)
+        kis_hugepage_slab::release(c.first, c.second);
+}
+
+void *tracker_arena::allocate(size_t in_sz, size_t in_align) {
+    kis_lock_guard<kis_mutex> lk(mutex, "tracker_arena allocate");
+
+    // Chunks are aligned for any fundamental type; anything
+    // over-aligned beyond that can't be placed safely
+    if (in_align > alignof(std::max_align_t))
+        throw std::bad_alloc();
+
+    // Large allocations get a chunk of their own so they don't waste the rest of
+    // the current one
+    if (in_sz > chunk_sz / 4) {
+        auto c = static_cast<uint8_t *>(kis_hugepage_slab::allocate(in_sz));
+        chunks.push_back(std::make_pair(c, in_sz));
+        allocated += in_sz;
+        return c;
+    }
+
+    auto pad = (in_align - (reinterpret_cast<uintptr_t>(pos) % in_align)) % in_align;
+
+    if (pos == nullptr || pad + in_sz > remaining) {
+        pos = static_cast<uint8_t *>(kis_hugepage_slab::allocate(chunk_sz));
+        chunks.push_back(std::make_pair(pos, chunk_sz));
+        remaining = chunk_sz;
+        pad = 0;
+    }
+
+    auto r = pos + pad;
+
+    pos += pad + in_sz;
+    remaining -= pad + in_sz;
+    allocated += pad + in_sz;
+
+    return r;
+}
+
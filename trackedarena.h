@@ -0,0 +1,139 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __TRACKEDARENA_H__
+#define __TRACKEDARENA_H__
+
+#include "config.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "kis_mutex.h"
+
+// Arena for the tracked elements making up one record, such as a device.  
+//
+// Elements are carved out of large chunks and never freed individually; every element
+// allocated from the arena holds a reference to it through its allocator, so the
+// chunks are all released at once when the last element of the record is destroyed.
+// This avoids scattering hundreds of small allocations per device across the heap, 
+// and fragmenting it as devices time out over long runs.
+//
+// Elements are placed in an arena while a tracker_arena_scope for it is active on the
+// current thread; anything built through tracker_arena_make_shared or 
+// Globalreg::new_from_pool in that scope comes from the arena.  Since arena memory is 
+// only released with the whole arena, scopes should only cover building the record,
+// not churn during its lifetime.
+class tracker_arena {
+public:
+    tracker_arena(size_t in_chunk_sz = 8192);
+    ~tracker_arena();
+
+    void *allocate(size_t in_sz, size_t in_align);
+
+    size_t get_allocated() const {
+        return allocated;
+    }
+
+    // Arena used by the scope active on this thread, if any
+    static std::shared_ptr<tracker_arena>& current() {
+        thread_local std::shared_ptr<tracker_arena> arena;
+        return arena;
+    }
+
+protected:
+    kis_mutex mutex;
+
+    size_t chunk_sz;
+    // Chunks and their sizes; chunks come from the huge page slab when it is enabled
+    std::vector<std::pair<uint8_t *, size_t>> chunks;
+
+    uint8_t *pos;
+    size_t remaining;
+
+    size_t allocated;
+};
+
+template<typename T>
+class tracker_arena_allocator {
+public:
+    using value_type = T;
+
+    explicit tracker_arena_allocator(std::shared_ptr<tracker_arena> in_arena) :
+        arena{in_arena} { }
+
+    template<typename U>
+    tracker_arena_allocator(const tracker_arena_allocator<U>& a) :
+        arena{a.arena} { }
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // Released with the arena
+    void deallocate(T *p, size_t n) noexcept { }
+
+    template<typename U>
+    bool operator==(const tracker_arena_allocator<U>& a) const {
+        return arena == a.arena;
+    }
+
+    template<typename U>
+    bool operator!=(const tracker_arena_allocator<U>& a) const {
+        return arena != a.arena;
+    }
+
+    std::shared_ptr<tracker_arena> arena;
+};
+
+// Place elements built on this thread in an arena until the scope ends; a null arena
+// leaves allocation unchanged
+class tracker_arena_scope {
+public:
+    tracker_arena_scope(std::shared_ptr<tracker_arena> in_arena) :
+        prev{tracker_arena::current()} {
+        if (in_arena != nullptr)
+            tracker_arena::current() = in_arena;
+    }
+
+    ~tracker_arena_scope() {
+        tracker_arena::current() = prev;
+    }
+
+    tracker_arena_scope(const tracker_arena_scope&) = delete;
+    tracker_arena_scope& operator=(const tracker_arena_scope&) = delete;
+
+protected:
+    std::shared_ptr<tracker_arena> prev;
+};
+
+// make_shared from the active arena, or the heap if there is none
+template<typename T, typename... Args>
+std::shared_ptr<T> tracker_arena_make_shared(Args&&... args) {
+    auto& arena = tracker_arena::current();
+
+    if (arena != nullptr)
+        return std::allocate_shared<T>(tracker_arena_allocator<T>(arena), 
+                std::forward<Args>(args)...);
+
+    return std::make_shared<T>(std::forward<Args>(args)...);
+}
+
+#endif
+
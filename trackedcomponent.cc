@@ -20,6 +20,27 @@
 
 #include "trackedcomponent.h"
 
+tracker_field_block::~tracker_field_block() {
+    size_t pos = 0;
+
+    for (unsigned int i = 0; i < n_elements; i++) {
+        auto e = reinterpret_cast<tracker_element *>(mem + pos);
+        pos += slot_size(e->inline_size());
+        e->~tracker_element();
+    }
+
+    delete[] mem;
+}
+
+tracker_element *tracker_field_block::emplace(const tracker_element *builder) {
+    auto e = builder->clone_inline(mem + used);
+
+    used += slot_size(builder->inline_size());
+    n_elements++;
+
+    return e;
+}
+
 std::string tracker_component::get_name() {
     return Globalreg::globalreg->entrytracker->get_field_name(get_id());
 }
@@ -50,6 +71,9 @@ void tracker_component::reserve_fields(std::shared_ptr<tracker_element_map> e) {
     if (registered_fields == nullptr)
         return;
 
+    if (e == nullptr && Globalreg::tracker_inline_fields)
+        reserve_inline_fields();
+
     for (auto& rf : *registered_fields) {
         if (rf->assign != nullptr) {
             // We use negative IDs to indicate dynamic to eke out 4 more bytes
@@ -70,6 +94,44 @@ void tracker_component::reserve_fields(std::shared_ptr<tracker_element_map> e) {
     registered_fields = nullptr;
 }
 
+void tracker_component::reserve_inline_fields() {
+    std::vector<std::pair<registered_field *, std::shared_ptr<tracker_element>>> inline_fields;
+    size_t block_sz = 0;
+
+    for (auto& rf : *registered_fields) {
+        if (rf->assign == nullptr || rf->id < 0)
+            continue;
+
+        // A parent class may already have built this field
+        auto existing = find(rf->id);
+        if (existing != end() && existing->second != nullptr)
+            continue;
+
+        auto builder = Globalreg::globalreg->entrytracker->get_field_builder(rf->id);
+        if (builder == nullptr)
+            continue;
+
+        auto sz = builder->inline_size();
+        if (sz == 0 || builder->inline_align() > tracker_field_block::slot_align)
+            continue;
+
+        block_sz += tracker_field_block::slot_size(sz);
+        inline_fields.push_back(std::make_pair(rf.get(), builder));
+    }
+
+    // Not worth a block for a single field
+    if (inline_fields.size() < 2)
+        return;
+
+    auto block = std::make_shared<tracker_field_block>(block_sz);
+
+    for (auto& f : inline_fields) {
+        auto elem = std::shared_ptr<tracker_element>(block, block->emplace(f.second.get()));
+        *(f.first->assign) = elem;
+        insert(elem);
+    }
+}
+
 shared_tracker_element tracker_component::import_or_new(std::shared_ptr<tracker_element_map> e, int i) {
     shared_tracker_element r;
 
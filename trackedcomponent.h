@@ -35,10 +35,40 @@
 #include "globalregistry.h"
 #include "trackedelement.h"
 #include "entrytracker.h"
+#include "trackedstringpool.h"
 #include "kis_mutex.h"
 #include "json/json.h"
 
 
+// Shared storage for the simple fields of a component, which are constructed in place
+// one after another; each field is handed out as a shared_ptr aliasing the block, so
+// the block is released when the component and the last outstanding field are gone.
+class tracker_field_block {
+public:
+    // Every slot is aligned to a tracker element; fields needing more fall back to
+    // normal allocation
+    static constexpr size_t slot_align = alignof(tracker_element);
+
+    static size_t slot_size(size_t sz) {
+        return (sz + slot_align - 1) & ~(slot_align - 1);
+    }
+
+    tracker_field_block(size_t in_sz) :
+        mem{new uint8_t[in_sz]},
+        used{0},
+        n_elements{0} { }
+
+    ~tracker_field_block();
+
+    // Construct a clone of the builder in the next slot
+    tracker_element *emplace(const tracker_element *builder);
+
+protected:
+    uint8_t *mem;
+    size_t used;
+    unsigned int n_elements;
+};
+
 // Complex trackable unit based on trackertype dataunion.
 //
 // All tracker_components are built from maps.
@@ -627,6 +657,7 @@ class tracker_component : public tracker_element_map {
 // built)
 #define __ProxyDynamicTrackable(name, ttype, cvar, id) \
     inline std::shared_ptr<ttype> get_##name() { \
+        adopt_dynamic_field(cvar, id); \
         if (cvar == NULL) { \
             cvar = Globalreg::globalreg->entrytracker->get_shared_instance_as<ttype>(id); \
             if (cvar != NULL) \
@@ -644,10 +675,11 @@ class tracker_component : public tracker_element_map {
         } \
     } \
     inline std::shared_ptr<ttype> get_tracker_##name() { \
+        adopt_dynamic_field(cvar, id); \
         return cvar; \
     } \
     inline bool has_##name() const { \
-        return cvar != NULL; \
+        return cvar != NULL || has_dynamic_field(id); \
     } \
     inline void clear_##name() { \
         erase(cvar); \
@@ -658,6 +690,7 @@ class tracker_component : public tracker_element_map {
 // built); provided function is called when created
 #define __ProxyDynamicTrackableFunc(name, ttype, cvar, id, creator) \
     inline std::shared_ptr<ttype> get_##name() { \
+        adopt_dynamic_field(cvar, id); \
         if (cvar == NULL) { \
             cvar = Globalreg::globalreg->entrytracker->get_shared_instance_as<ttype>(id); \
             if (cvar != NULL) \
@@ -676,10 +709,11 @@ class tracker_component : public tracker_element_map {
         } \
     } \
     inline std::shared_ptr<ttype> get_tracker_##name() { \
+        adopt_dynamic_field(cvar, id); \
         return cvar; \
     } \
     inline bool has_##name() const { \
-        return cvar != NULL; \
+        return cvar != NULL || has_dynamic_field(id); \
     } \
     inline void clear_##name() { \
         erase(cvar); \
@@ -691,6 +725,7 @@ class tracker_component : public tracker_element_map {
 #define __ProxyDynamicTrackableM(name, ttype, cvar, id, mutex) \
     inline std::shared_ptr<ttype> get_##name() { \
         kis_lock_guard<kis_mutex> lk(mutex, __func__); \
+        adopt_dynamic_field(cvar, id); \
         if (cvar == NULL) { \
             cvar = Globalreg::globalreg->entrytracker->get_shared_instance_as<ttype>(id); \
             if (cvar != NULL) \
@@ -710,11 +745,12 @@ class tracker_component : public tracker_element_map {
     } \
     inline std::shared_ptr<ttype> get_tracker_##name() { \
         kis_lock_guard<kis_mutex> lk(mutex); \
+        adopt_dynamic_field(cvar, id); \
         return cvar; \
     } \
     inline bool has_##name() { \
         kis_lock_guard<kis_mutex> lk(mutex); \
-        return cvar != NULL; \
+        return cvar != NULL || has_dynamic_field(id); \
     } \
     inline void clear_##name() { \
         erase(cvar); \
@@ -726,6 +762,7 @@ class tracker_component : public tracker_element_map {
 #define __ProxyDynamicTrackableMS(name, ttype, cvar, id, mutex) \
     inline std::shared_ptr<ttype> get_##name() { \
         kis_lock_guard<kis_mutex> lk(mutex); \
+        adopt_dynamic_field(cvar, id); \
         if (cvar == NULL) { \
             cvar = Globalreg::globalreg->entrytracker->get_shared_instance_as<ttype>(id); \
             if (cvar != NULL) \
@@ -745,11 +782,12 @@ class tracker_component : public tracker_element_map {
     } \
     inline shared_tracker_element get_tracker_##name() { \
         kis_lock_guard<kis_mutex> lk(mutex); \
+        adopt_dynamic_field(cvar, id); \
         return std::static_pointer_cast<tracker_element>(cvar); \
     } \
     inline bool has_##name() { \
         kis_lock_guard<kis_mutex> lk(mutex); \
-        return cvar != NULL; \
+        return cvar != NULL || has_dynamic_field(id); \
     }
 
 // Simplified swapping of tracked elements
@@ -766,6 +804,26 @@ class tracker_component : public tracker_element_map {
             cvar = in; \
         }
 
+// Proxy a low-cardinality string field through the shared string pool (name, class var);
+// setting the field swaps in the pool record for the value, see tracker_string_pool
+#define __ProxyInternedString(name, cvar) \
+    inline shared_tracker_element get_tracker_##name() const { \
+        return (std::shared_ptr<tracker_element>) cvar; \
+    } \
+    inline std::string get_##name() const { \
+        return cvar->get(); \
+    } \
+    inline void set_##name(const std::string& in) { \
+        if (cvar->get() == in) \
+            return; \
+        if (!Globalreg::tracker_intern_strings) { \
+            cvar->set(in); \
+            return; \
+        } \
+        cvar = tracker_string_pool::intern(cvar->get_id(), in); \
+        insert(cvar); \
+    }
+
 // Proxy bitset functions (name, trackable type, data type, class var)
 #define __ProxyBitset(name, dtype, cvar) \
     inline void bitset_##name(dtype bs) { \
@@ -901,6 +959,23 @@ public:
     shared_tracker_element get_child_path(const std::vector<std::string>& in_path);
 
 protected:
+    // Dynamic fields placed directly into the map, such as when a record is rebuilt from
+    // storage, are picked up by their proxies on first use
+    template<typename T>
+    void adopt_dynamic_field(std::shared_ptr<T>& cvar, int id) {
+        if (cvar != nullptr)
+            return;
+
+        auto i = find(id);
+        if (i != end() && i->second != nullptr)
+            cvar = std::static_pointer_cast<T>(i->second);
+    }
+
+    bool has_dynamic_field(int id) const {
+        auto i = find(id);
+        return i != cend() && i->second != nullptr;
+    }
+
     // Register a field via the entrytracker, using standard entrytracker build methods.
     // This field will be automatically assigned or created during the reservefields 
     // stage.
@@ -921,6 +996,21 @@ protected:
                 reinterpret_cast<shared_tracker_element *>(in_dest));
     }
 
+    // Register a field named by a string literal.  The name is hashed at compile time,
+    // and once the field exists it is resolved from the entry tracker hashed name table, 
+    // so constructing another component doesn't build a builder, copy the name and the
+    // description, or look the name up under the registry lock.
+    template<typename T, size_t N, typename D>
+    int register_field(const char (&in_name)[N], const D& in_desc, std::shared_ptr<T> *in_dest) {
+        using build_type = typename std::remove_reference<decltype(**in_dest)>::type;
+
+        auto id = resolve_hashed_field<build_type>(static_field_name(in_name), in_desc);
+
+        record_registered_field(id, reinterpret_cast<shared_tracker_element *>(in_dest), false);
+
+        return id;
+    }
+
     // Register a field, automatically deriving its type from the provided destination
     // field.  The destination field must be specified.
     //
@@ -949,6 +1039,20 @@ protected:
         return id;
     }
 
+    // Register a dynamic field named by a string literal, resolved like literal fields
+    // given to register_field
+    template<typename T, size_t N, typename D>
+    int register_dynamic_field(const char (&in_name)[N], const D& in_desc, 
+            std::shared_ptr<T> *in_dest) {
+        using build_type = typename std::remove_reference<decltype(**in_dest)>::type;
+
+        auto id = resolve_hashed_field<build_type>(static_field_name(in_name), in_desc);
+
+        record_registered_field(id, reinterpret_cast<shared_tracker_element *>(in_dest), true);
+
+        return id;
+    }
+
     template<typename T>
     int register_dynamic_field(const std::string& in_name, const std::string& in_desc) {
         using build_type = T;
@@ -983,6 +1087,35 @@ protected:
     // Add imported or new field to our map for use tracking.
     virtual shared_tracker_element import_or_new(std::shared_ptr<tracker_element_map> e, int i);
 
+    // Build all the simple fields in a single block instead of allocating them one at
+    // a time
+    void reserve_inline_fields();
+
+    template<typename B, typename D>
+    int resolve_hashed_field(const static_field_name& in_name, const D& in_desc) {
+        auto id = Globalreg::globalreg->entrytracker->find_hashed_field(in_name, typeid(B));
+
+        if (id < 0) {
+            id = Globalreg::globalreg->entrytracker->register_field(
+                    std::string(in_name.name, in_name.len), tracker_element_factory<B>(), in_desc);
+            Globalreg::globalreg->entrytracker->publish_hashed_field(in_name, typeid(B), id);
+        }
+
+        return id;
+    }
+
+    void record_registered_field(int in_id, shared_tracker_element *in_dest, bool in_dynamic) {
+        if (registered_fields == nullptr)
+            registered_fields = new std::vector<std::unique_ptr<registered_field>>();
+
+        if (in_dynamic)
+            registered_fields->push_back(std::unique_ptr<registered_field>(
+                        new registered_field(in_id, in_dest, true)));
+        else if (in_dest != nullptr)
+            registered_fields->push_back(std::unique_ptr<registered_field>(
+                        new registered_field(in_id, in_dest)));
+    }
+
     std::vector<std::unique_ptr<registered_field>> *registered_fields;
 };
 
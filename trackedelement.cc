@@ -193,6 +193,33 @@ void tracker_element_mac_addr::coercive_set(const shared_tracker_element& e) {
     }
 }
 
+void tracker_element_ipv4_addr::coercive_set(const std::string& in_str) {
+    struct in_addr addr;
+
+    if (inet_aton(in_str.c_str(), &addr) != 1)
+        throw std::runtime_error("Could not coerce string to ipv4 address");
+
+    value = addr.s_addr;
+}
+
+void tracker_element_ipv4_addr::coercive_set(double in_num) {
+    throw std::runtime_error("Cannot coerce ipv4 address from number");
+}
+
+void tracker_element_ipv4_addr::coercive_set(const shared_tracker_element& e) {
+    switch (e->get_type()) {
+        case tracker_type::tracker_ipv4_addr:
+            value = static_cast<tracker_element_ipv4_addr *>(e.get())->get();
+            break;
+        case tracker_type::tracker_string:
+            coercive_set(e->as_string());
+            break;
+        default:
+            throw std::runtime_error(fmt::format("Could not coerce {} to {}",
+                        e->get_type_as_string(), get_type_as_string()));
+    }
+}
+
 std::string tracker_element::type_to_string(tracker_type t) {
     switch (t) {
         case tracker_type::tracker_unassigned:
@@ -1431,29 +1458,189 @@ std::shared_ptr<tracker_element> summarize_tracker_element(std::shared_ptr<track
     return ret_elem;
 }
 
-std::shared_ptr<tracker_element> summarize_tracker_element_with_json(std::shared_ptr<tracker_element> data, 
-        const Json::Value& json, std::shared_ptr<tracker_element_serializer::rename_map> rename_map) {
+tracker_element_summary_plan::tracker_element_summary_plan(const std::vector<SharedElementSummary>& in_summaries) :
+    summaries{in_summaries},
+    complete{true} {
 
-    auto summary_vec = std::vector<SharedElementSummary>{};
-    auto fields = json.get("fields", Json::Value(Json::arrayValue));
+    unsigned int fn = 0;
+
+    for (const auto& si : summaries) {
+        fn++;
+
+        if (si->resolved_path.size() == 0)
+            continue;
+
+        plan_step step;
+
+        step.summary = si;
+        step.direct_id = si->resolved_path.size() == 1 ? si->resolved_path[0] : -1;
+        step.mapped = si->rename.length() != 0 || si->resolved_path.size() > 1;
+
+        for (const auto& id : si->resolved_path) {
+            if (id < 0) {
+                complete = false;
+                break;
+            }
+        }
+
+        step.placeholder_id = 
+            Globalreg::globalreg->entrytracker->register_field(fmt::format("unknown{}", fn),
+                    tracker_element_factory<tracker_element_placeholder>(),
+                    "unallocated field");
+
+        if (si->rename.length() != 0) {
+            step.placeholder_name = si->rename;
+        } else {
+            int lastid = si->resolved_path[si->resolved_path.size() - 1];
+
+            if (lastid >= 0)
+                step.placeholder_name = Globalreg::globalreg->entrytracker->get_field_name(lastid);
+        }
+
+        steps.push_back(step);
+    }
+}
+
+namespace {
+    kis_mutex summary_plan_mutex;
+    std::unordered_map<size_t, std::pair<std::string, shared_summary_plan>> summary_plan_cache;
+
+    // Field specs are supplied by clients, so bound the cache rather than letting
+    // arbitrary specs accumulate
+    const size_t summary_plan_cache_max = 128;
+}
+
+shared_summary_plan tracker_element_summary_plan::from_json(const Json::Value& fields) {
+    // Flatten the field spec to a key string while validating it
+    std::string spec;
 
     for (const auto& i : fields) {
         if (i.isString()) {
-            auto sum = Globalreg::new_from_pool<tracker_element_summary>();
-            sum->assign(i.asString());
-            summary_vec.push_back(sum);
+            spec += i.asString();
+            spec += '\x1e';
         } else if (i.isArray()) {
             if (i.size() != 2)
                 throw std::runtime_error("Invalid field mapping, expected [field, name]");
-            auto sum = Globalreg::new_from_pool<tracker_element_summary>();
-            sum->assign(i[0].asString(), i[1].asString());
-            summary_vec.push_back(sum);
+            spec += i[0].asString();
+            spec += '\x1f';
+            spec += i[1].asString();
+            spec += '\x1e';
         } else {
             throw std::runtime_error("Invalid field mapping, expected field or [field,rename]");
         }
     }
 
-    return summarize_tracker_element(data, summary_vec, rename_map);
+    auto spec_hash = std::hash<std::string>{}(spec);
+
+    {
+        kis_lock_guard<kis_mutex> lk(summary_plan_mutex, "summary plan lookup");
+
+        auto ci = summary_plan_cache.find(spec_hash);
+        if (ci != summary_plan_cache.end() && ci->second.first == spec)
+            return ci->second.second;
+    }
+
+    auto summary_vec = std::vector<SharedElementSummary>{};
+
+    for (const auto& i : fields) {
+        if (i.isString())
+            summary_vec.push_back(std::make_shared<tracker_element_summary>(i.asString()));
+        else
+            summary_vec.push_back(std::make_shared<tracker_element_summary>(i[0].asString(), 
+                        i[1].asString()));
+    }
+
+    auto plan = std::make_shared<tracker_element_summary_plan>(summary_vec);
+    plan->spec = spec;
+
+    if (plan->complete) {
+        kis_lock_guard<kis_mutex> lk(summary_plan_mutex, "summary plan insert");
+
+        if (summary_plan_cache.size() >= summary_plan_cache_max)
+            summary_plan_cache.clear();
+
+        summary_plan_cache[spec_hash] = std::make_pair(spec, plan);
+    }
+
+    return plan;
+}
+
+std::shared_ptr<tracker_element> summarize_tracker_element(std::shared_ptr<tracker_element> in,
+        const shared_summary_plan& in_plan,
+        std::shared_ptr<tracker_element_serializer::rename_map> rename_map) {
+
+    auto ret_elem = Globalreg::new_from_pool<tracker_element_map>();
+
+    if (in == nullptr)
+        return ret_elem;
+
+    switch (in->get_type()) {
+        case tracker_type::tracker_vector:
+            {
+                auto ret = Globalreg::new_from_pool<tracker_element_vector>();
+
+                for (const auto& i : *std::static_pointer_cast<tracker_element_vector>(in))
+                    ret->push_back(summarize_tracker_element(i, in_plan, rename_map));
+
+                return ret;
+            }
+        case tracker_type::tracker_map:
+            break;
+        default:
+            // Keyed maps and anything else take the generic path
+            return summarize_tracker_element(in, in_plan->summaries, rename_map);
+    }
+
+    in->pre_serialize();
+
+    if (in_plan->summaries.size() == 0) {
+        in->post_serialize();
+        return in;
+    }
+
+    auto in_map = static_cast<tracker_element_map *>(in.get());
+
+    for (const auto& step : in_plan->steps) {
+        shared_tracker_element f;
+
+        if (step.direct_id >= 0)
+            f = in_map->get_sub(step.direct_id);
+        else
+            f = get_tracker_element_path(step.summary->resolved_path, in);
+
+        if (f == nullptr) {
+            auto p = Globalreg::new_from_pool<tracker_element_placeholder>();
+            p->set_id(step.placeholder_id);
+            p->set(0);
+
+            if (step.placeholder_name.length() != 0)
+                p->set_name(step.placeholder_name);
+
+            f = p;
+        }
+
+        if (step.mapped) {
+            auto sum = Globalreg::new_from_pool<tracker_element_summary>();
+            sum->assign(step.summary);
+            sum->parent_element = in;
+            (*rename_map)[f] = sum;
+        }
+
+        ret_elem->insert(f);
+    }
+
+    in->post_serialize();
+
+    return ret_elem;
+}
+
+std::shared_ptr<tracker_element> summarize_tracker_element_with_json(std::shared_ptr<tracker_element> data, 
+        const Json::Value& json, std::shared_ptr<tracker_element_serializer::rename_map> rename_map) {
+
+    auto plan = 
+        tracker_element_summary_plan::from_json(json.get("fields", Json::Value(Json::arrayValue)));
+
+    return summarize_tracker_element(data, plan, rename_map);
 
 }
 
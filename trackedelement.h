@@ -36,11 +36,14 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <new>
+#include <typeinfo>
 #include <unordered_map>
 
 #include "fmt.h"
 #include "globalregistry.h"
 #include "json/json.h"
+#include "kis_flat_map.h"
 #include "kis_mutex.h"
 #include "macaddr.h"
 #include "robin_hood.h"
@@ -239,6 +242,27 @@ public:
     // Called after serialization is completed
     virtual void post_serialize() { }
 
+    // Key and modification sequence the serialized form of the element can be cached
+    // under, for elements which track their changes; see kis_fragment_cache
+    virtual bool get_serial_cache_key(device_key& key, uint64_t& seq) {
+        return false;
+    }
+
+    // Simple elements can be cloned in place, so that a component can build all of its
+    // scalar fields in a single block (see tracker_component::reserve_fields); elements
+    // which can't report an inline size of 0
+    virtual size_t inline_size() const {
+        return 0;
+    }
+
+    virtual size_t inline_align() const {
+        return 0;
+    }
+
+    virtual tracker_element *clone_inline(void *mem) const {
+        return nullptr;
+    }
+
     template<typename CT>
     static std::shared_ptr<CT> safe_cast_as(const std::shared_ptr<tracker_element>& e) {
         if (e == nullptr)
@@ -330,6 +354,22 @@ std::ostream& operator<<(std::ostream& os, const tracker_element& e);
 std::istream& operator>>(std::istream& is, tracker_element& e);
 std::ostream& operator<<(std::ostream& os, std::shared_ptr<tracker_element>& se);
 
+// Allow a leaf element class to be cloned in place; subclasses which don't declare it
+// of their own fall back to normal allocation
+#define __TrackerInlineClone() \
+    virtual size_t inline_size() const override { \
+        using this_t = typename std::remove_cv<typename std::remove_pointer<decltype(this)>::type>::type; \
+        return typeid(*this) == typeid(this_t) ? sizeof(this_t) : 0; \
+    } \
+    virtual size_t inline_align() const override { \
+        using this_t = typename std::remove_cv<typename std::remove_pointer<decltype(this)>::type>::type; \
+        return alignof(this_t); \
+    } \
+    virtual tracker_element *clone_inline(void *mem) const override { \
+        using this_t = typename std::remove_cv<typename std::remove_pointer<decltype(this)>::type>::type; \
+        return new (mem) this_t(this->get_id()); \
+    }
+
 // Basic generator function for making various elements; objects may also prefer pooling allocation
 // to minimize malloc thrash
 template<typename SUB, typename... Args>
@@ -564,6 +604,8 @@ public:
         return r;
     }
 
+    __TrackerInlineClone()
+
     using tracker_element_core_scalar<std::string>::less_than;
     inline bool less_than(const tracker_element_string& rhs) const;
 
@@ -734,6 +776,8 @@ public:
         r->set_id(this->get_id());
         return r;
     }
+
+    __TrackerInlineClone()
 };
 
 class tracker_element_uuid : public tracker_element_core_scalar<uuid> {
@@ -784,6 +828,8 @@ public:
         r->set_id(this->get_id());
         return r;
     }
+
+    __TrackerInlineClone()
 };
 
 class tracker_element_mac_addr : public tracker_element_core_scalar<mac_addr> {
@@ -840,6 +886,8 @@ public:
         r->set_id(this->get_id());
         return r;
     }
+
+    __TrackerInlineClone()
 };
 
 class tracker_element_ipv4_addr : public tracker_element_core_scalar<uint32_t> {
@@ -1017,6 +1065,8 @@ public:
         return r;
     }
 
+    __TrackerInlineClone()
+
     N& get() {
         return value;
     }
@@ -1447,21 +1497,21 @@ public:
 };
 
 // int::element
-using tracker_element_int_map = tracker_element_core_map<robin_hood::unordered_node_map<int, std::shared_ptr<tracker_element>>, int, std::shared_ptr<tracker_element>, tracker_type::tracker_int_map>;
+using tracker_element_int_map = tracker_element_core_map<kis_flat_map<int, std::shared_ptr<tracker_element>>, int, std::shared_ptr<tracker_element>, tracker_type::tracker_int_map>;
 
 // hash::element
-using tracker_element_hashkey_map = tracker_element_core_map<robin_hood::unordered_node_map<size_t, std::shared_ptr<tracker_element>>, size_t, std::shared_ptr<tracker_element>, tracker_type::tracker_hashkey_map>;
+using tracker_element_hashkey_map = tracker_element_core_map<kis_flat_map<size_t, std::shared_ptr<tracker_element>>, size_t, std::shared_ptr<tracker_element>, tracker_type::tracker_hashkey_map>;
 
 // double::element
 using tracker_element_double_map = tracker_element_core_map<robin_hood::unordered_node_map<double, std::shared_ptr<tracker_element>>, double, std::shared_ptr<tracker_element>, tracker_type::tracker_double_map>;
 
 // mac::element, keyed as *unordered*, does not allow mask operations.  for generating mac maps which allow
 // masks, use tracker_element_macfilter_map
-using tracker_element_mac_map = tracker_element_core_map<robin_hood::unordered_node_map<mac_addr, std::shared_ptr<tracker_element>>, mac_addr, std::shared_ptr<tracker_element>, tracker_type::tracker_mac_map>;
+using tracker_element_mac_map = tracker_element_core_map<kis_flat_map<mac_addr, std::shared_ptr<tracker_element>>, mac_addr, std::shared_ptr<tracker_element>, tracker_type::tracker_mac_map>;
 using tracker_element_macfilter_map = tracker_element_core_map<std::map<mac_addr, std::shared_ptr<tracker_element>>, mac_addr, std::shared_ptr<tracker_element>, tracker_type::tracker_mac_map>;
 
 // string::element
-using tracker_element_string_map = tracker_element_core_map<robin_hood::unordered_node_map<std::string, std::shared_ptr<tracker_element>>, std::string, std::shared_ptr<tracker_element>, tracker_type::tracker_string_map>;
+using tracker_element_string_map = tracker_element_core_map<kis_flat_map<std::string, std::shared_ptr<tracker_element>>, std::string, std::shared_ptr<tracker_element>, tracker_type::tracker_string_map>;
 
 // devicekey::element
 using tracker_element_device_key_map = tracker_element_core_map<robin_hood::unordered_node_map<device_key, std::shared_ptr<tracker_element>>, device_key, std::shared_ptr<tracker_element>, tracker_type::tracker_key_map>;
@@ -1469,7 +1519,7 @@ using tracker_element_device_key_map = tracker_element_core_map<robin_hood::unor
 using tracker_element_uuid_map = tracker_element_core_map<robin_hood::unordered_node_map<uuid, std::shared_ptr<tracker_element>>, uuid, std::shared_ptr<tracker_element>, tracker_type::tracker_uuid_map>;
 
 // double::double
-using tracker_element_double_map_double = tracker_element_core_map<robin_hood::unordered_node_map<double, double>, double, double, tracker_type::tracker_double_map_double>;
+using tracker_element_double_map_double = tracker_element_core_map<kis_flat_map<double, double>, double, double, tracker_type::tracker_double_map_double>;
 
 // Core vector
 template<typename T, tracker_type TT>
@@ -1847,6 +1897,48 @@ protected:
     void parse_path(const std::vector<std::string>& in_path, const std::string& in_rename);
 };
 
+// Compiled summarization plan.  The field paths of a summary request are resolved to
+// field ids once, the placeholder fields for missing paths are registered up front,
+// and the result is applied to every record as a flat list of steps.  Plans built from
+// a json field spec are cached by the hash of the spec so that repeated requests for
+// the same columns skip path resolution entirely.
+class tracker_element_summary_plan;
+using shared_summary_plan = std::shared_ptr<tracker_element_summary_plan>;
+
+class tracker_element_summary_plan {
+public:
+    struct plan_step {
+        SharedElementSummary summary;
+
+        // First field id, used to resolve single-element paths directly
+        int direct_id;
+
+        // Placeholder field id and name used when the path is missing in a record
+        int placeholder_id;
+        std::string placeholder_name;
+
+        // Does this step need a rename map record
+        bool mapped;
+    };
+
+    tracker_element_summary_plan(const std::vector<SharedElementSummary>& in_summaries);
+
+    // Original summary records, used by callers which also search by path
+    std::vector<SharedElementSummary> summaries;
+    std::vector<plan_step> steps;
+
+    // Were all path components resolved; only complete plans are cached, since
+    // unresolved fields may be registered later
+    bool complete;
+
+    // Flattened field spec of plans compiled from json; plans built directly from
+    // summaries have none, and can't be told apart by the fragment cache
+    std::string spec;
+
+    // Fetch a cached plan, or compile and cache a plan, from a json 'fields' spec
+    static shared_summary_plan from_json(const Json::Value& fields);
+};
+
 // Generic serializer class to allow easy swapping of serializers
 class tracker_element_serializer {
 public:
@@ -1859,6 +1951,34 @@ public:
     virtual int serialize(shared_tracker_element in_elem, 
             std::ostream &stream, std::shared_ptr<rename_map> name_map) = 0;
 
+    // Streamed vector serialization, used to emit a vector one record at a time
+    // as the records are produced instead of assembling the complete vector first.
+    // The defaults produce a JSON array; line-oriented serializers emit one record
+    // per line instead.
+    virtual void stream_vector_start(std::ostream& stream) {
+        stream << "[";
+    }
+
+    virtual void stream_vector_item(shared_tracker_element in_elem, std::ostream& stream,
+            std::shared_ptr<rename_map> name_map, bool first) {
+        if (!first)
+            stream << ",";
+        serialize(in_elem, stream, name_map);
+    }
+
+    // Write an item already serialized by stream_vector_item as the first item of a
+    // vector; serializers which override stream_vector_item override this to match
+    virtual void stream_vector_fragment(const std::string& in_item, std::ostream& stream,
+            bool first) {
+        if (!first)
+            stream << ",";
+        stream << in_item;
+    }
+
+    virtual void stream_vector_end(std::ostream& stream) {
+        stream << "]";
+    }
+
     // Fields extracted from a summary path need to preserialize their parent
     // paths or updates may not happen in the expected fashion, serializers should
     // call this when necessary
@@ -1945,6 +2065,11 @@ std::shared_ptr<tracker_element> summarize_tracker_element(std::shared_ptr<track
         const std::vector<std::shared_ptr<tracker_element_summary>>&,
         std::shared_ptr<tracker_element_serializer::rename_map>);
 
+// Summarize using a compiled summary plan
+std::shared_ptr<tracker_element> summarize_tracker_element(std::shared_ptr<tracker_element>,
+        const shared_summary_plan&,
+        std::shared_ptr<tracker_element_serializer::rename_map>);
+
 // Handle comparing fields
 bool sort_tracker_element_less(const std::shared_ptr<tracker_element> lhs, 
         const std::shared_ptr<tracker_element> rhs);
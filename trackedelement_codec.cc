@@ -0,0 +1,985 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <string.h>
+
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "entrytracker.h"
+#include "globalregistry.h"
+#include "trackedcomponent.h"
+#include "trackedelement_codec.h"
+
+// Record layout:
+//   uint8_t type, uint16_t id, payload
+// A type of null_record marks a null value in a keyed map, with no id or payload.
+static constexpr uint8_t null_record = 0xFF;
+
+template<typename T>
+static void codec_put(std::string& out, const T& v) {
+    static_assert(std::is_trivially_copyable<T>::value, "codec values must be plain data");
+    out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+template<typename T>
+static T codec_get(const std::string& in, size_t& pos) {
+    static_assert(std::is_trivially_copyable<T>::value, "codec values must be plain data");
+
+    if (pos + sizeof(T) > in.size())
+        throw std::runtime_error("truncated tracked element record");
+
+    T v;
+    memcpy(&v, in.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return v;
+}
+
+static void codec_put_str(std::string& out, const std::string& s) {
+    codec_put<uint32_t>(out, s.length());
+    out.append(s);
+}
+
+static std::string codec_get_str(const std::string& in, size_t& pos) {
+    auto len = codec_get<uint32_t>(in, pos);
+
+    if (pos + len > in.size())
+        throw std::runtime_error("truncated tracked element string");
+
+    auto r = in.substr(pos, len);
+    pos += len;
+    return r;
+}
+
+// Reserve a count, to be filled in once the entries which can be encoded are known
+static size_t codec_put_count(std::string& out) {
+    auto pos = out.size();
+    codec_put<uint32_t>(out, 0);
+    return pos;
+}
+
+static void codec_set_count(std::string& out, size_t pos, uint32_t count) {
+    memcpy(&out[pos], &count, sizeof(uint32_t));
+}
+
+// Map keys
+static void codec_put_key(std::string& out, int k) { codec_put<int64_t>(out, k); }
+static void codec_put_key(std::string& out, size_t k) { codec_put<uint64_t>(out, k); }
+static void codec_put_key(std::string& out, double k) { codec_put<double>(out, k); }
+static void codec_put_key(std::string& out, const std::string& k) { codec_put_str(out, k); }
+static void codec_put_key(std::string& out, const mac_addr& k) {
+    codec_put_str(out, k.mac_full_to_string());
+}
+static void codec_put_key(std::string& out, const device_key& k) {
+    codec_put_str(out, k.as_string());
+}
+static void codec_put_key(std::string& out, const uuid& k) {
+    codec_put_str(out, k.uuid_to_string());
+}
+
+static void codec_get_key(const std::string& in, size_t& pos, int& k) {
+    k = codec_get<int64_t>(in, pos);
+}
+static void codec_get_key(const std::string& in, size_t& pos, size_t& k) {
+    k = codec_get<uint64_t>(in, pos);
+}
+static void codec_get_key(const std::string& in, size_t& pos, double& k) {
+    k = codec_get<double>(in, pos);
+}
+static void codec_get_key(const std::string& in, size_t& pos, std::string& k) {
+    k = codec_get_str(in, pos);
+}
+static void codec_get_key(const std::string& in, size_t& pos, mac_addr& k) {
+    k = mac_addr(codec_get_str(in, pos));
+}
+static void codec_get_key(const std::string& in, size_t& pos, device_key& k) {
+    k = device_key(codec_get_str(in, pos));
+}
+static void codec_get_key(const std::string& in, size_t& pos, uuid& k) {
+    k = uuid(codec_get_str(in, pos));
+}
+
+template<typename M>
+static void codec_put_keyed_map(std::string& out, M *m) {
+    codec_put<uint8_t>(out, (m->as_vector() ? 0x01 : 0) | (m->as_key_vector() ? 0x02 : 0));
+
+    auto count_pos = codec_put_count(out);
+    uint32_t count = 0;
+
+    for (const auto& i : *m) {
+        auto rewind = out.size();
+
+        codec_put_key(out, i.first);
+
+        if (i.second == nullptr) {
+            codec_put<uint8_t>(out, null_record);
+        } else if (!tracker_element_encode(i.second, out)) {
+            out.resize(rewind);
+            continue;
+        }
+
+        count++;
+    }
+
+    codec_set_count(out, count_pos, count);
+}
+
+static shared_tracker_element codec_decode(const std::string& in, size_t& pos,
+        shared_tracker_element in_into, const tracker_element_id_map *ids);
+
+// Map a field id of the writing run to this run; unmapped fields come back as 0
+static uint16_t codec_map_id(uint16_t id, const tracker_element_id_map *ids) {
+    if (ids == nullptr || id == 0)
+        return id;
+
+    auto i = ids->find(id);
+
+    if (i == ids->end())
+        return 0;
+
+    return i->second;
+}
+
+template<typename M>
+static void codec_get_keyed_map(const std::string& in, size_t& pos, M *m,
+        const tracker_element_id_map *ids) {
+    auto flags = codec_get<uint8_t>(in, pos);
+    m->set_as_vector(flags & 0x01);
+    m->set_as_key_vector(flags & 0x02);
+
+    auto count = codec_get<uint32_t>(in, pos);
+
+    for (uint32_t n = 0; n < count; n++) {
+        typename M::map_t::key_type k;
+        codec_get_key(in, pos, k);
+
+        auto existing = m->find(k);
+        auto v = codec_decode(in, pos,
+                existing != m->end() ? existing->second : nullptr, ids);
+
+        m->replace(k, v);
+    }
+}
+
+bool tracker_element_encode(const shared_tracker_element& in_elem, std::string& out) {
+    if (in_elem == nullptr)
+        return false;
+
+    auto type = in_elem->get_type();
+
+    switch (type) {
+        case tracker_type::tracker_alias:
+        case tracker_type::tracker_placeholder_missing:
+        case tracker_type::tracker_unassigned:
+            return false;
+        default:
+            break;
+    }
+
+    codec_put<uint8_t>(out, static_cast<uint8_t>(type));
+    codec_put<uint16_t>(out, in_elem->get_id());
+
+    switch (type) {
+        case tracker_type::tracker_int8:
+            codec_put<int64_t>(out, static_cast<tracker_element_int8 *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_uint8:
+            codec_put<uint64_t>(out, static_cast<tracker_element_uint8 *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_int16:
+            codec_put<int64_t>(out, static_cast<tracker_element_int16 *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_uint16:
+            codec_put<uint64_t>(out, static_cast<tracker_element_uint16 *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_int32:
+            codec_put<int64_t>(out, static_cast<tracker_element_int32 *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_uint32:
+            codec_put<uint64_t>(out, static_cast<tracker_element_uint32 *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_int64:
+            codec_put<int64_t>(out, static_cast<tracker_element_int64 *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_uint64:
+            codec_put<uint64_t>(out, static_cast<tracker_element_uint64 *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_float:
+            codec_put<double>(out, static_cast<tracker_element_float *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_double:
+            codec_put<double>(out, static_cast<tracker_element_double *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_string:
+        case tracker_type::tracker_byte_array:
+            codec_put_str(out, static_cast<tracker_element_string *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_mac_addr:
+            codec_put_key(out, static_cast<tracker_element_mac_addr *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_uuid:
+            codec_put_key(out, static_cast<tracker_element_uuid *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_key:
+            codec_put_key(out, static_cast<tracker_element_device_key *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_ipv4_addr:
+            codec_put<uint32_t>(out, static_cast<tracker_element_ipv4_addr *>(in_elem.get())->get());
+            break;
+        case tracker_type::tracker_pair_double: {
+            auto& p = static_cast<tracker_element_pair_double *>(in_elem.get())->get();
+            codec_put<double>(out, p.first);
+            codec_put<double>(out, p.second);
+            break;
+        }
+        case tracker_type::tracker_vector: {
+            auto v = static_cast<tracker_element_vector *>(in_elem.get());
+            auto count_pos = codec_put_count(out);
+            uint32_t count = 0;
+
+            for (const auto& i : *v) {
+                if (tracker_element_encode(i, out))
+                    count++;
+            }
+
+            codec_set_count(out, count_pos, count);
+            break;
+        }
+        case tracker_type::tracker_vector_double: {
+            auto v = static_cast<tracker_element_vector_double *>(in_elem.get());
+            codec_put<uint32_t>(out, v->size());
+
+            for (const auto& i : *v)
+                codec_put<double>(out, i);
+            break;
+        }
+        case tracker_type::tracker_vector_string: {
+            auto v = static_cast<tracker_element_vector_string *>(in_elem.get());
+            codec_put<uint32_t>(out, v->size());
+
+            for (const auto& i : *v)
+                codec_put_str(out, i);
+            break;
+        }
+        case tracker_type::tracker_map: {
+            auto m = static_cast<tracker_element_map *>(in_elem.get());
+            codec_put<uint8_t>(out, (m->as_vector() ? 0x01 : 0) | (m->as_key_vector() ? 0x02 : 0));
+
+            auto count_pos = codec_put_count(out);
+            uint32_t count = 0;
+
+            for (const auto& i : *m) {
+                if (tracker_element_encode(i.second, out))
+                    count++;
+            }
+
+            codec_set_count(out, count_pos, count);
+            break;
+        }
+        case tracker_type::tracker_int_map:
+            codec_put_keyed_map(out, static_cast<tracker_element_int_map *>(in_elem.get()));
+            break;
+        case tracker_type::tracker_hashkey_map:
+            codec_put_keyed_map(out, static_cast<tracker_element_hashkey_map *>(in_elem.get()));
+            break;
+        case tracker_type::tracker_double_map:
+            codec_put_keyed_map(out, static_cast<tracker_element_double_map *>(in_elem.get()));
+            break;
+        case tracker_type::tracker_mac_map:
+            // Filter maps share the type of mac maps
+            if (auto fm = dynamic_cast<tracker_element_macfilter_map *>(in_elem.get()))
+                codec_put_keyed_map(out, fm);
+            else
+                codec_put_keyed_map(out, static_cast<tracker_element_mac_map *>(in_elem.get()));
+            break;
+        case tracker_type::tracker_string_map:
+            codec_put_keyed_map(out, static_cast<tracker_element_string_map *>(in_elem.get()));
+            break;
+        case tracker_type::tracker_key_map:
+            codec_put_keyed_map(out, static_cast<tracker_element_device_key_map *>(in_elem.get()));
+            break;
+        case tracker_type::tracker_uuid_map:
+            codec_put_keyed_map(out, static_cast<tracker_element_uuid_map *>(in_elem.get()));
+            break;
+        case tracker_type::tracker_double_map_double: {
+            auto m = static_cast<tracker_element_double_map_double *>(in_elem.get());
+            codec_put<uint32_t>(out, m->size());
+
+            for (const auto& i : *m) {
+                codec_put<double>(out, i.first);
+                codec_put<double>(out, i.second);
+            }
+            break;
+        }
+        default:
+            throw std::runtime_error(fmt::format("cannot encode tracked element type {}",
+                        tracker_element::type_to_string(type)));
+    }
+
+    return true;
+}
+
+// Build an element for a decoded record; registered fields use their builder so that
+// components come back as their own classes
+static shared_tracker_element codec_build(uint16_t id, tracker_type type) {
+    if (id != 0) {
+        auto b = Globalreg::globalreg->entrytracker->get_shared_instance(id);
+
+        if (b != nullptr && b->get_type() == type)
+            return b;
+    }
+
+    switch (type) {
+        case tracker_type::tracker_int8:
+            return std::make_shared<tracker_element_int8>(id);
+        case tracker_type::tracker_uint8:
+            return std::make_shared<tracker_element_uint8>(id);
+        case tracker_type::tracker_int16:
+            return std::make_shared<tracker_element_int16>(id);
+        case tracker_type::tracker_uint16:
+            return std::make_shared<tracker_element_uint16>(id);
+        case tracker_type::tracker_int32:
+            return std::make_shared<tracker_element_int32>(id);
+        case tracker_type::tracker_uint32:
+            return std::make_shared<tracker_element_uint32>(id);
+        case tracker_type::tracker_int64:
+            return std::make_shared<tracker_element_int64>(id);
+        case tracker_type::tracker_uint64:
+            return std::make_shared<tracker_element_uint64>(id);
+        case tracker_type::tracker_float:
+            return std::make_shared<tracker_element_float>(id);
+        case tracker_type::tracker_double:
+            return std::make_shared<tracker_element_double>(id);
+        case tracker_type::tracker_string:
+            return std::make_shared<tracker_element_string>(id);
+        case tracker_type::tracker_byte_array:
+            return std::make_shared<tracker_element_byte_array>(id);
+        case tracker_type::tracker_mac_addr:
+            return std::make_shared<tracker_element_mac_addr>(id);
+        case tracker_type::tracker_uuid:
+            return std::make_shared<tracker_element_uuid>(id);
+        case tracker_type::tracker_key:
+            return std::make_shared<tracker_element_device_key>(id);
+        case tracker_type::tracker_ipv4_addr:
+            return std::make_shared<tracker_element_ipv4_addr>(id);
+        case tracker_type::tracker_pair_double:
+            return std::make_shared<tracker_element_pair_double>(id);
+        case tracker_type::tracker_vector:
+            return std::make_shared<tracker_element_vector>(id);
+        case tracker_type::tracker_vector_double:
+            return std::make_shared<tracker_element_vector_double>(id);
+        case tracker_type::tracker_vector_string:
+            return std::make_shared<tracker_element_vector_string>(id);
+        case tracker_type::tracker_map:
+            return std::make_shared<tracker_element_map>(id);
+        case tracker_type::tracker_int_map:
+            return std::make_shared<tracker_element_int_map>(id);
+        case tracker_type::tracker_hashkey_map:
+            return std::make_shared<tracker_element_hashkey_map>(id);
+        case tracker_type::tracker_double_map:
+            return std::make_shared<tracker_element_double_map>(id);
+        case tracker_type::tracker_mac_map:
+            return std::make_shared<tracker_element_mac_map>(id);
+        case tracker_type::tracker_string_map:
+            return std::make_shared<tracker_element_string_map>(id);
+        case tracker_type::tracker_key_map:
+            return std::make_shared<tracker_element_device_key_map>(id);
+        case tracker_type::tracker_uuid_map:
+            return std::make_shared<tracker_element_uuid_map>(id);
+        case tracker_type::tracker_double_map_double:
+            return std::make_shared<tracker_element_double_map_double>(id);
+        default:
+            throw std::runtime_error(fmt::format("cannot decode tracked element type {}",
+                        tracker_element::type_to_string(type)));
+    }
+}
+
+shared_tracker_element tracker_element_decode(const std::string& in, size_t& pos,
+        shared_tracker_element in_into) {
+    return codec_decode(in, pos, in_into, nullptr);
+}
+
+shared_tracker_element tracker_element_decode(const std::string& in, size_t& pos,
+        const tracker_element_id_map& in_ids, shared_tracker_element in_into) {
+    return codec_decode(in, pos, in_into, &in_ids);
+}
+
+static shared_tracker_element codec_decode(const std::string& in, size_t& pos,
+        shared_tracker_element in_into, const tracker_element_id_map *ids) {
+    auto t = codec_get<uint8_t>(in, pos);
+
+    if (t == null_record)
+        return nullptr;
+
+    auto type = static_cast<tracker_type>(t);
+    auto id = codec_map_id(codec_get<uint16_t>(in, pos), ids);
+
+    auto e = in_into;
+
+    if (e == nullptr || e->get_type() != type)
+        e = codec_build(id, type);
+
+    switch (type) {
+        case tracker_type::tracker_int8:
+            static_cast<tracker_element_int8 *>(e.get())->set(codec_get<int64_t>(in, pos));
+            break;
+        case tracker_type::tracker_uint8:
+            static_cast<tracker_element_uint8 *>(e.get())->set(codec_get<uint64_t>(in, pos));
+            break;
+        case tracker_type::tracker_int16:
+            static_cast<tracker_element_int16 *>(e.get())->set(codec_get<int64_t>(in, pos));
+            break;
+        case tracker_type::tracker_uint16:
+            static_cast<tracker_element_uint16 *>(e.get())->set(codec_get<uint64_t>(in, pos));
+            break;
+        case tracker_type::tracker_int32:
+            static_cast<tracker_element_int32 *>(e.get())->set(codec_get<int64_t>(in, pos));
+            break;
+        case tracker_type::tracker_uint32:
+            static_cast<tracker_element_uint32 *>(e.get())->set(codec_get<uint64_t>(in, pos));
+            break;
+        case tracker_type::tracker_int64:
+            static_cast<tracker_element_int64 *>(e.get())->set(codec_get<int64_t>(in, pos));
+            break;
+        case tracker_type::tracker_uint64:
+            static_cast<tracker_element_uint64 *>(e.get())->set(codec_get<uint64_t>(in, pos));
+            break;
+        case tracker_type::tracker_float:
+            static_cast<tracker_element_float *>(e.get())->set(codec_get<double>(in, pos));
+            break;
+        case tracker_type::tracker_double:
+            static_cast<tracker_element_double *>(e.get())->set(codec_get<double>(in, pos));
+            break;
+        case tracker_type::tracker_string:
+        case tracker_type::tracker_byte_array: {
+            // Leave matching values alone; the record may be shared through the
+            // string pool
+            auto str = codec_get_str(in, pos);
+            auto se = static_cast<tracker_element_string *>(e.get());
+            if (se->get() != str)
+                se->set(str);
+            break;
+        }
+        case tracker_type::tracker_mac_addr: {
+            mac_addr m;
+            codec_get_key(in, pos, m);
+            static_cast<tracker_element_mac_addr *>(e.get())->set(m);
+            break;
+        }
+        case tracker_type::tracker_uuid: {
+            uuid u;
+            codec_get_key(in, pos, u);
+            static_cast<tracker_element_uuid *>(e.get())->set(u);
+            break;
+        }
+        case tracker_type::tracker_key: {
+            device_key k;
+            codec_get_key(in, pos, k);
+            static_cast<tracker_element_device_key *>(e.get())->set(k);
+            break;
+        }
+        case tracker_type::tracker_ipv4_addr:
+            static_cast<tracker_element_ipv4_addr *>(e.get())->set(codec_get<uint32_t>(in, pos));
+            break;
+        case tracker_type::tracker_pair_double: {
+            auto a = codec_get<double>(in, pos);
+            auto b = codec_get<double>(in, pos);
+            static_cast<tracker_element_pair_double *>(e.get())->set(a, b);
+            break;
+        }
+        case tracker_type::tracker_vector: {
+            auto v = static_cast<tracker_element_vector *>(e.get());
+            auto count = codec_get<uint32_t>(in, pos);
+
+            v->clear();
+
+            for (uint32_t n = 0; n < count; n++)
+                v->push_back(codec_decode(in, pos, nullptr, ids));
+            break;
+        }
+        case tracker_type::tracker_vector_double: {
+            auto v = static_cast<tracker_element_vector_double *>(e.get());
+            auto count = codec_get<uint32_t>(in, pos);
+
+            v->clear();
+            v->reserve(count);
+
+            for (uint32_t n = 0; n < count; n++)
+                v->push_back(codec_get<double>(in, pos));
+            break;
+        }
+        case tracker_type::tracker_vector_string: {
+            auto v = static_cast<tracker_element_vector_string *>(e.get());
+            auto count = codec_get<uint32_t>(in, pos);
+
+            v->clear();
+
+            for (uint32_t n = 0; n < count; n++)
+                v->push_back(codec_get_str(in, pos));
+            break;
+        }
+        case tracker_type::tracker_map: {
+            auto m = static_cast<tracker_element_map *>(e.get());
+
+            auto flags = codec_get<uint8_t>(in, pos);
+            m->set_as_vector(flags & 0x01);
+            m->set_as_key_vector(flags & 0x02);
+
+            auto count = codec_get<uint32_t>(in, pos);
+
+            for (uint32_t n = 0; n < count; n++) {
+                // Peek the id of the field so it merges into the existing field record
+                size_t peek = pos;
+                codec_get<uint8_t>(in, peek);
+                auto raw_fid = codec_get<uint16_t>(in, peek);
+                auto fid = codec_map_id(raw_fid, ids);
+
+                // Fields this run doesn't have are decoded and dropped
+                if (raw_fid != 0 && fid == 0) {
+                    codec_decode(in, pos, nullptr, ids);
+                    continue;
+                }
+
+                auto existing = m->get_sub(fid);
+                auto v = codec_decode(in, pos, existing, ids);
+
+                if (v != existing)
+                    m->insert(v);
+            }
+            break;
+        }
+        case tracker_type::tracker_int_map:
+            codec_get_keyed_map(in, pos, static_cast<tracker_element_int_map *>(e.get()), ids);
+            break;
+        case tracker_type::tracker_hashkey_map:
+            codec_get_keyed_map(in, pos, static_cast<tracker_element_hashkey_map *>(e.get()), ids);
+            break;
+        case tracker_type::tracker_double_map:
+            codec_get_keyed_map(in, pos, static_cast<tracker_element_double_map *>(e.get()), ids);
+            break;
+        case tracker_type::tracker_mac_map:
+            if (auto fm = dynamic_cast<tracker_element_macfilter_map *>(e.get()))
+                codec_get_keyed_map(in, pos, fm, ids);
+            else
+                codec_get_keyed_map(in, pos, static_cast<tracker_element_mac_map *>(e.get()), ids);
+            break;
+        case tracker_type::tracker_string_map:
+            codec_get_keyed_map(in, pos, static_cast<tracker_element_string_map *>(e.get()), ids);
+            break;
+        case tracker_type::tracker_key_map:
+            codec_get_keyed_map(in, pos, static_cast<tracker_element_device_key_map *>(e.get()), ids);
+            break;
+        case tracker_type::tracker_uuid_map:
+            codec_get_keyed_map(in, pos, static_cast<tracker_element_uuid_map *>(e.get()), ids);
+            break;
+        case tracker_type::tracker_double_map_double: {
+            auto m = static_cast<tracker_element_double_map_double *>(e.get());
+            auto count = codec_get<uint32_t>(in, pos);
+
+            for (uint32_t n = 0; n < count; n++) {
+                auto k = codec_get<double>(in, pos);
+                auto v = codec_get<double>(in, pos);
+                m->replace(k, v);
+            }
+            break;
+        }
+        default:
+            throw std::runtime_error(fmt::format("cannot decode tracked element type {}",
+                        tracker_element::type_to_string(type)));
+    }
+
+    return e;
+}
+
+
+// Deep copies keep a map of each original element to its copy, so aliases can be pointed
+// at the copies of their targets once the whole tree is copied
+class tracker_element_copier {
+public:
+    shared_tracker_element copy(const shared_tracker_element& src, 
+            shared_tracker_element into = nullptr);
+
+    void resolve_aliases();
+
+protected:
+    template<typename M>
+    void copy_keyed_map(M *dst, M *src) {
+        dst->set_as_vector(src->as_vector());
+        dst->set_as_key_vector(src->as_key_vector());
+        dst->clear();
+
+        for (const auto& i : *src)
+            dst->insert(i.first, copy(i.second));
+    }
+
+    std::unordered_map<const tracker_element *, shared_tracker_element> copies;
+    std::vector<std::pair<std::shared_ptr<tracker_element_alias>, shared_tracker_element>> aliases;
+};
+
+shared_tracker_element tracker_element_copier::copy(const shared_tracker_element& src,
+        shared_tracker_element into) {
+    if (src == nullptr)
+        return nullptr;
+
+    auto type = src->get_type();
+
+    switch (type) {
+        case tracker_type::tracker_placeholder_missing:
+        case tracker_type::tracker_unassigned:
+            return nullptr;
+        case tracker_type::tracker_alias: {
+            auto sa = static_cast<tracker_element_alias *>(src.get());
+            auto a = std::make_shared<tracker_element_alias>(src->get_id(), nullptr);
+            a->set_name(sa->get_alias_name());
+            aliases.push_back(std::make_pair(a, sa->get()));
+            return a;
+        }
+        default:
+            break;
+    }
+
+    auto e = into;
+
+    if (e == nullptr || e->get_type() != type)
+        e = src->clone_type();
+
+    copies[src.get()] = e;
+
+    switch (type) {
+        case tracker_type::tracker_int8:
+            static_cast<tracker_element_int8 *>(e.get())->set(static_cast<tracker_element_int8 *>(src.get())->get());
+            break;
+        case tracker_type::tracker_uint8:
+            static_cast<tracker_element_uint8 *>(e.get())->set(static_cast<tracker_element_uint8 *>(src.get())->get());
+            break;
+        case tracker_type::tracker_int16:
+            static_cast<tracker_element_int16 *>(e.get())->set(static_cast<tracker_element_int16 *>(src.get())->get());
+            break;
+        case tracker_type::tracker_uint16:
+            static_cast<tracker_element_uint16 *>(e.get())->set(static_cast<tracker_element_uint16 *>(src.get())->get());
+            break;
+        case tracker_type::tracker_int32:
+            static_cast<tracker_element_int32 *>(e.get())->set(static_cast<tracker_element_int32 *>(src.get())->get());
+            break;
+        case tracker_type::tracker_uint32:
+            static_cast<tracker_element_uint32 *>(e.get())->set(static_cast<tracker_element_uint32 *>(src.get())->get());
+            break;
+        case tracker_type::tracker_int64:
+            static_cast<tracker_element_int64 *>(e.get())->set(static_cast<tracker_element_int64 *>(src.get())->get());
+            break;
+        case tracker_type::tracker_uint64:
+            static_cast<tracker_element_uint64 *>(e.get())->set(static_cast<tracker_element_uint64 *>(src.get())->get());
+            break;
+        case tracker_type::tracker_float:
+            static_cast<tracker_element_float *>(e.get())->set(static_cast<tracker_element_float *>(src.get())->get());
+            break;
+        case tracker_type::tracker_double:
+            static_cast<tracker_element_double *>(e.get())->set(static_cast<tracker_element_double *>(src.get())->get());
+            break;
+        case tracker_type::tracker_string:
+        case tracker_type::tracker_byte_array:
+            static_cast<tracker_element_string *>(e.get())->set(static_cast<tracker_element_string *>(src.get())->get());
+            break;
+        case tracker_type::tracker_mac_addr:
+            static_cast<tracker_element_mac_addr *>(e.get())->set(static_cast<tracker_element_mac_addr *>(src.get())->get());
+            break;
+        case tracker_type::tracker_uuid:
+            static_cast<tracker_element_uuid *>(e.get())->set(static_cast<tracker_element_uuid *>(src.get())->get());
+            break;
+        case tracker_type::tracker_key:
+            static_cast<tracker_element_device_key *>(e.get())->set(static_cast<tracker_element_device_key *>(src.get())->get());
+            break;
+        case tracker_type::tracker_ipv4_addr:
+            static_cast<tracker_element_ipv4_addr *>(e.get())->set(static_cast<tracker_element_ipv4_addr *>(src.get())->get());
+            break;
+        case tracker_type::tracker_pair_double: {
+            auto& p = static_cast<tracker_element_pair_double *>(src.get())->get();
+            static_cast<tracker_element_pair_double *>(e.get())->set(p.first, p.second);
+            break;
+        }
+        case tracker_type::tracker_vector: {
+            auto d = static_cast<tracker_element_vector *>(e.get());
+            d->clear();
+
+            for (const auto& i : *static_cast<tracker_element_vector *>(src.get()))
+                d->push_back(copy(i));
+            break;
+        }
+        case tracker_type::tracker_vector_double: {
+            auto s = static_cast<tracker_element_vector_double *>(src.get());
+            static_cast<tracker_element_vector_double *>(e.get())->set(s->begin(), s->end());
+            break;
+        }
+        case tracker_type::tracker_vector_string: {
+            auto s = static_cast<tracker_element_vector_string *>(src.get());
+            static_cast<tracker_element_vector_string *>(e.get())->set(s->begin(), s->end());
+            break;
+        }
+        case tracker_type::tracker_map: {
+            auto d = static_cast<tracker_element_map *>(e.get());
+            auto s = static_cast<tracker_element_map *>(src.get());
+
+            d->set_as_vector(s->as_vector());
+            d->set_as_key_vector(s->as_key_vector());
+
+            // Copy into the fields the component built for itself, so its own field 
+            // records hold the values
+            for (const auto& i : *s) {
+                auto existing = d->get_sub(i.first);
+                auto v = copy(i.second, existing);
+
+                if (v == nullptr)
+                    continue;
+
+                if (v != existing)
+                    d->insert(i.first, v);
+            }
+
+            // Drop any fields the original doesn't have
+            for (auto i = d->begin(); i != d->end(); ) {
+                if (s->find(i->first) == s->end())
+                    i = d->erase(i);
+                else
+                    ++i;
+            }
+            break;
+        }
+        case tracker_type::tracker_int_map:
+            copy_keyed_map(static_cast<tracker_element_int_map *>(e.get()),
+                    static_cast<tracker_element_int_map *>(src.get()));
+            break;
+        case tracker_type::tracker_hashkey_map:
+            copy_keyed_map(static_cast<tracker_element_hashkey_map *>(e.get()),
+                    static_cast<tracker_element_hashkey_map *>(src.get()));
+            break;
+        case tracker_type::tracker_double_map:
+            copy_keyed_map(static_cast<tracker_element_double_map *>(e.get()),
+                    static_cast<tracker_element_double_map *>(src.get()));
+            break;
+        case tracker_type::tracker_mac_map:
+            if (auto fm = dynamic_cast<tracker_element_macfilter_map *>(src.get()))
+                copy_keyed_map(static_cast<tracker_element_macfilter_map *>(e.get()), fm);
+            else
+                copy_keyed_map(static_cast<tracker_element_mac_map *>(e.get()),
+                        static_cast<tracker_element_mac_map *>(src.get()));
+            break;
+        case tracker_type::tracker_string_map:
+            copy_keyed_map(static_cast<tracker_element_string_map *>(e.get()),
+                    static_cast<tracker_element_string_map *>(src.get()));
+            break;
+        case tracker_type::tracker_key_map:
+            copy_keyed_map(static_cast<tracker_element_device_key_map *>(e.get()),
+                    static_cast<tracker_element_device_key_map *>(src.get()));
+            break;
+        case tracker_type::tracker_uuid_map:
+            copy_keyed_map(static_cast<tracker_element_uuid_map *>(e.get()),
+                    static_cast<tracker_element_uuid_map *>(src.get()));
+            break;
+        case tracker_type::tracker_double_map_double: {
+            auto d = static_cast<tracker_element_double_map_double *>(e.get());
+            d->clear();
+
+            for (const auto& i : *static_cast<tracker_element_double_map_double *>(src.get()))
+                d->insert(i.first, i.second);
+            break;
+        }
+        default:
+            throw std::runtime_error(fmt::format("cannot copy tracked element type {}",
+                        tracker_element::type_to_string(type)));
+    }
+
+    return e;
+}
+
+void tracker_element_copier::resolve_aliases() {
+    // Copying a target outside the tree may add more aliases
+    for (size_t i = 0; i < aliases.size(); i++) {
+        auto target = aliases[i].second;
+
+        if (target == nullptr)
+            continue;
+
+        auto c = copies.find(target.get());
+
+        if (c != copies.end())
+            aliases[i].first->set(c->second);
+        else
+            aliases[i].first->set(copy(target));
+    }
+}
+
+shared_tracker_element tracker_element_deep_copy(const shared_tracker_element& in_elem) {
+    tracker_element_copier copier;
+
+    auto r = copier.copy(in_elem);
+    copier.resolve_aliases();
+
+    return r;
+}
+
+// Per-entry overhead of a node map over its value: the node link and the bucket slot
+#define NODE_MAP_ENTRY_OVERHEAD     (2 * sizeof(void *))
+// Control block of a separately allocated shared element
+#define SHARED_ELEMENT_OVERHEAD     (2 * sizeof(long))
+
+static size_t size_of_string(const std::string& s) {
+    // Short strings are held inside the string object
+    if (s.capacity() < sizeof(std::string))
+        return 0;
+
+    return s.capacity() + 1;
+}
+
+class tracker_element_sizer {
+public:
+    size_t size(const shared_tracker_element& e);
+
+protected:
+    template<typename M>
+    size_t keyed_map_size(M *m, size_t entry_overhead) {
+        size_t sz = sizeof(M) + m->size() * (sizeof(typename M::pair) + entry_overhead);
+
+        for (const auto& i : *m) {
+            sz += key_size(i.first);
+            sz += size(i.second);
+        }
+
+        return sz;
+    }
+
+    template<typename K>
+    size_t key_size(const K& k) {
+        return 0;
+    }
+
+    size_t key_size(const std::string& k) {
+        return size_of_string(k);
+    }
+
+    // Records can be reached more than once, through aliases or records shared between
+    // maps, and are only counted the first time
+    std::unordered_set<const tracker_element *> seen;
+};
+
+size_t tracker_element_sizer::size(const shared_tracker_element& e) {
+    if (e == nullptr)
+        return 0;
+
+    if (!seen.insert(e.get()).second)
+        return 0;
+
+    size_t sz = SHARED_ELEMENT_OVERHEAD;
+
+    switch (e->get_type()) {
+        case tracker_type::tracker_string:
+        case tracker_type::tracker_byte_array:
+            sz += sizeof(tracker_element_string);
+            sz += size_of_string(static_cast<tracker_element_string *>(e.get())->get());
+            break;
+        case tracker_type::tracker_vector: {
+            auto v = static_cast<tracker_element_vector *>(e.get());
+            sz += sizeof(tracker_element_vector) + v->size() * sizeof(shared_tracker_element);
+
+            for (const auto& i : *v)
+                sz += size(i);
+            break;
+        }
+        case tracker_type::tracker_vector_double: {
+            auto v = static_cast<tracker_element_vector_double *>(e.get());
+            sz += sizeof(tracker_element_vector_double) + v->size() * sizeof(double);
+            break;
+        }
+        case tracker_type::tracker_vector_string: {
+            auto v = static_cast<tracker_element_vector_string *>(e.get());
+            sz += sizeof(tracker_element_vector_string) + v->size() * sizeof(std::string);
+
+            for (const auto& i : *v)
+                sz += size_of_string(i);
+            break;
+        }
+        case tracker_type::tracker_map: {
+            auto m = static_cast<tracker_element_map *>(e.get());
+
+            // Components hold their own pointer to each of their fields, and their field
+            // builders are shared by the class
+            if (dynamic_cast<tracker_component *>(e.get()) != nullptr)
+                sz += sizeof(tracker_component) + m->size() * sizeof(shared_tracker_element);
+
+            sz += keyed_map_size(m, NODE_MAP_ENTRY_OVERHEAD);
+            break;
+        }
+        case tracker_type::tracker_int_map:
+            sz += keyed_map_size(static_cast<tracker_element_int_map *>(e.get()), 0);
+            break;
+        case tracker_type::tracker_hashkey_map:
+            sz += keyed_map_size(static_cast<tracker_element_hashkey_map *>(e.get()), 0);
+            break;
+        case tracker_type::tracker_double_map:
+            sz += keyed_map_size(static_cast<tracker_element_double_map *>(e.get()), 
+                    NODE_MAP_ENTRY_OVERHEAD);
+            break;
+        case tracker_type::tracker_mac_map:
+            if (auto fm = dynamic_cast<tracker_element_macfilter_map *>(e.get()))
+                sz += keyed_map_size(fm, NODE_MAP_ENTRY_OVERHEAD);
+            else
+                sz += keyed_map_size(static_cast<tracker_element_mac_map *>(e.get()), 0);
+            break;
+        case tracker_type::tracker_string_map:
+            sz += keyed_map_size(static_cast<tracker_element_string_map *>(e.get()), 0);
+            break;
+        case tracker_type::tracker_key_map:
+            sz += keyed_map_size(static_cast<tracker_element_device_key_map *>(e.get()),
+                    NODE_MAP_ENTRY_OVERHEAD);
+            break;
+        case tracker_type::tracker_uuid_map:
+            sz += keyed_map_size(static_cast<tracker_element_uuid_map *>(e.get()),
+                    NODE_MAP_ENTRY_OVERHEAD);
+            break;
+        case tracker_type::tracker_double_map_double: {
+            auto m = static_cast<tracker_element_double_map_double *>(e.get());
+            sz += sizeof(tracker_element_double_map_double) + 
+                m->size() * sizeof(tracker_element_double_map_double::pair);
+            break;
+        }
+        case tracker_type::tracker_alias:
+            // The target is counted by whatever owns it
+            sz += sizeof(tracker_element_alias);
+            break;
+        default:
+            // Leaf scalars report their own size; anything else is counted as the 
+            // largest of them
+            if (e->inline_size() != 0)
+                sz += e->inline_size();
+            else
+                sz += sizeof(tracker_element_uuid);
+            break;
+    }
+
+    return sz;
+}
+
+size_t tracker_element_estimate_size(const shared_tracker_element& in_elem) {
+    tracker_element_sizer sizer;
+    return sizer.size(in_elem);
+}
@@ -0,0 +1,77 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __TRACKEDELEMENT_CODEC_H__
+#define __TRACKEDELEMENT_CODEC_H__
+
+#include "config.h"
+
+#include <string>
+#include <unordered_map>
+
+#include "trackedelement.h"
+
+// Compact binary encoding of tracked element trees, used to hold records outside of
+// memory for a while (see the device spill store in device_tracker).
+//
+// The encoding writes field ids and host-order values as-is, so it is only meaningful
+// to the running server which wrote it; it is not an export format.
+//
+// Aliases and placeholders are not encoded; they are rebuilt by whatever set them 
+// originally.
+
+// Append the encoding of an element; returns false, writing nothing, if the element
+// can not be encoded
+bool tracker_element_encode(const shared_tracker_element& in_elem, std::string& out);
+
+// Decode the element at pos, advancing pos past it.  
+//
+// When in_into is an element of the same type, the decoded values are merged into it
+// and it is returned; fields of maps are merged into existing fields of the same id,
+// so a component keeps its own field records.  Otherwise a new element is built, 
+// using the registered field builder where there is one so components come back as
+// their own classes.
+//
+// Throws std::runtime_error on a malformed record.
+shared_tracker_element tracker_element_decode(const std::string& in, size_t& pos,
+        shared_tracker_element in_into = nullptr);
+
+// Field ids are assigned as fields are registered, so they differ between runs.  Records
+// kept across runs (see the device snapshot in device_tracker) are written with the
+// names and types of their fields; the ids of the writing run are mapped to the ids of
+// the same fields in this run, and fields of maps whose ids aren't mapped are skipped.
+typedef std::unordered_map<uint16_t, uint16_t> tracker_element_id_map;
+
+shared_tracker_element tracker_element_decode(const std::string& in, size_t& pos,
+        const tracker_element_id_map& in_ids, shared_tracker_element in_into = nullptr);
+
+// Deep copy of an element tree, such as a device snapshot which can be serialized
+// while the original keeps changing.  Components are copied through their own
+// clone_type, so they keep their classes and serialization hooks, and aliases are
+// pointed at the copies of their targets.  Placeholders are not copied.
+shared_tracker_element tracker_element_deep_copy(const shared_tracker_element& in_elem);
+
+// Estimate of the memory held by an element tree, in bytes: the elements, their 
+// container storage, and string contents.  Records reached more than once are counted
+// once; the targets of aliases are not counted.  Allocator overhead and memory held
+// outside of tracked elements are not known, so this is a relative measure for finding
+// the largest records rather than an exact total.
+size_t tracker_element_estimate_size(const shared_tracker_element& in_elem);
+
+#endif
+
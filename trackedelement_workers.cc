@@ -42,32 +42,10 @@ bool tracker_element_function_worker::match_element(std::shared_ptr<tracker_elem
 }
 
 #ifdef HAVE_LIBPCRE
-tracker_element_regex_worker::pcre_filter::pcre_filter(const std::string& in_target, const std::string& in_regex) {
-    const char *compile_error, *study_error;
-    int err_offt;
-
-    target = in_target;
-
-    re = pcre_compile(in_regex.c_str(), 0, &compile_error, &err_offt, NULL);
-
-    if (re == nullptr)
-        throw std::runtime_error(fmt::format("Could not parse PCRE Regex: {} at {}",
-                    compile_error, err_offt));
-
-    study = pcre_study(re, 0, &study_error);
-    if (study_error != nullptr) {
-        pcre_free(re);
-        throw std::runtime_error(fmt::format("Could not parse PCRE Regex, optimization failed: {}",
-                    study_error));
-    }
-}
-
-tracker_element_regex_worker::pcre_filter::~pcre_filter() {
-    if (re != NULL)
-        pcre_free(re);
-    if (study != NULL)
-        pcre_free(study);
-}
+tracker_element_regex_worker::pcre_filter::pcre_filter(const std::string& in_target,
+        const std::string& in_regex) :
+    target{in_target},
+    re{kis_regex_cache::compile(in_regex)} { }
 #endif
 
 tracker_element_regex_worker::tracker_element_regex_worker(const std::vector<std::shared_ptr<tracker_element_regex_worker::pcre_filter>>& in_filter_vec) {
@@ -134,13 +112,8 @@ bool tracker_element_regex_worker::match_element(std::shared_ptr<tracker_element
             else
                 continue;
 
-            int rc;
-            int ovector[128];
-
-            rc = pcre_exec(i->re, i->study, val.c_str(), val.length(), 0, 0, ovector, 128);
-
             // Stop matching as soon as we find a hit
-            if (rc >= 0) {
+            if (i->re->match(val)) {
                 matched = true;
                 break;
             }
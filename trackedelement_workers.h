@@ -28,9 +28,7 @@
 #include "trackedcomponent.h"
 #include "json/json.h"
 
-#ifdef HAVE_LIBPCRE
-#include <pcre.h>
-#endif
+#include "kis_regex_cache.h"
 
 class tracker_element_worker {
 public:
@@ -81,11 +79,9 @@ public:
     struct pcre_filter {
 #ifdef HAVE_LIBPCRE
         pcre_filter(const std::string& target, const std::string& in_regex);
-        ~pcre_filter();
 
         std::string target;
-        pcre *re;
-        pcre_extra *study;
+        std::shared_ptr<kis_pcre_pattern> re;
 #endif
     };
 
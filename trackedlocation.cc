@@ -434,3 +434,255 @@ void kis_tracked_location::register_fields() {
                 "Last location", &last_loc);
 }
 
+
+kis_location_trail::trail_params kis_location_trail::params = {
+    10, 5, 300, 5, 32, 256
+};
+
+namespace {
+
+void trail_put_u32(std::string& out, uint32_t v) {
+    for (unsigned int i = 0; i < 4; i++)
+        out.push_back((v >> (i * 8)) & 0xFF);
+}
+
+uint32_t trail_get_u32(const char *p) {
+    uint32_t v = 0;
+
+    for (unsigned int i = 0; i < 4; i++)
+        v |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (i * 8);
+
+    return v;
+}
+
+int32_t trail_fixed(double v, double scale) {
+    return static_cast<int32_t>(std::max(-2147483647.0, std::min(2147483647.0, 
+                    std::round(v * scale))));
+}
+
+void trail_put_point(std::string& out, const kis_location_trail::trail_point& p) {
+    trail_put_u32(out, static_cast<uint32_t>(p.time));
+    trail_put_u32(out, static_cast<uint32_t>(trail_fixed(p.lat, 1e7)));
+    trail_put_u32(out, static_cast<uint32_t>(trail_fixed(p.lon, 1e7)));
+    trail_put_u32(out, static_cast<uint32_t>(trail_fixed(p.alt, 100)));
+}
+
+// Flat projection in meters around a reference latitude; trails are short enough
+// between passes for the error not to matter to thinning
+struct trail_projection {
+    trail_projection(double in_lat) :
+        kx{cos(in_lat * M_PI / 180) * 111320},
+        ky{110540} { }
+
+    double kx, ky;
+};
+
+double trail_distance(const trail_projection& proj, const kis_location_trail::trail_point& a,
+        const kis_location_trail::trail_point& b) {
+    auto dx = (b.lon - a.lon) * proj.kx;
+    auto dy = (b.lat - a.lat) * proj.ky;
+
+    return sqrt(dx * dx + dy * dy);
+}
+
+// Distance from p to the segment a-b
+double trail_segment_distance(const trail_projection& proj, 
+        const kis_location_trail::trail_point& p, const kis_location_trail::trail_point& a, 
+        const kis_location_trail::trail_point& b) {
+    auto bx = (b.lon - a.lon) * proj.kx;
+    auto by = (b.lat - a.lat) * proj.ky;
+    auto px = (p.lon - a.lon) * proj.kx;
+    auto py = (p.lat - a.lat) * proj.ky;
+
+    auto len2 = bx * bx + by * by;
+
+    if (len2 == 0)
+        return sqrt(px * px + py * py);
+
+    auto t = std::max(0.0, std::min(1.0, (px * bx + py * by) / len2));
+
+    auto dx = px - t * bx;
+    auto dy = py - t * by;
+
+    return sqrt(dx * dx + dy * dy);
+}
+
+}
+
+kis_location_trail::kis_location_trail() :
+    tracker_component(0) {
+    register_fields();
+    reserve_fields(nullptr);
+}
+
+kis_location_trail::kis_location_trail(int in_id) :
+    tracker_component(in_id) {
+    register_fields();
+    reserve_fields(nullptr);
+}
+
+kis_location_trail::kis_location_trail(int in_id, std::shared_ptr<tracker_element_map> e) :
+    tracker_component(in_id) {
+    register_fields();
+    reserve_fields(e);
+}
+
+kis_location_trail::kis_location_trail(const kis_location_trail *p) :
+    tracker_component(p) {
+
+    __ImportField(points, p);
+    __ImportField(thinned, p);
+    __ImportField(simplified, p);
+
+    reserve_fields(nullptr);
+}
+
+void kis_location_trail::register_fields() {
+    tracker_component::register_fields();
+
+    register_field("kismet.common.location_trail.points", 
+            "decimated location trail, packed fixed point", &points);
+    register_field("kismet.common.location_trail.thinned",
+            "fixes dropped when thinning by distance and time", &thinned);
+    register_field("kismet.common.location_trail.simplified",
+            "points removed by simplification", &simplified);
+}
+
+void kis_location_trail::reserve_fields(std::shared_ptr<tracker_element_map> e) {
+    tracker_component::reserve_fields(e);
+
+    // Restored trails are simplified again from the start on the next pass
+    simplified_len = 0;
+}
+
+kis_location_trail::trail_point kis_location_trail::get_point(size_t in_pos) const {
+    auto p = points->get().data() + in_pos * point_len;
+
+    trail_point r;
+    r.time = trail_get_u32(p);
+    r.lat = static_cast<int32_t>(trail_get_u32(p + 4)) / 1e7;
+    r.lon = static_cast<int32_t>(trail_get_u32(p + 8)) / 1e7;
+    r.alt = static_cast<int32_t>(trail_get_u32(p + 12)) / 100.0;
+
+    return r;
+}
+
+std::vector<kis_location_trail::trail_point> kis_location_trail::get_points() const {
+    std::vector<trail_point> ret;
+
+    auto n = size();
+    ret.reserve(n);
+
+    for (size_t i = 0; i < n; i++)
+        ret.push_back(get_point(i));
+
+    return ret;
+}
+
+void kis_location_trail::add_fix(double in_lat, double in_lon, double in_alt, time_t in_time) {
+    trail_point fix{in_time, in_lat, in_lon, in_alt};
+
+    auto n = size();
+
+    if (n > 0) {
+        auto last = get_point(n - 1);
+
+        if (in_time < last.time) {
+            (*thinned) += 1;
+            return;
+        }
+
+        auto dt = in_time - last.time;
+        auto d = trail_distance(trail_projection(last.lat), last, fix);
+
+        if (dt < params.max_interval && (dt < params.min_interval || d < params.min_distance)) {
+            (*thinned) += 1;
+            return;
+        }
+    }
+
+    trail_put_point(points->get(), fix);
+
+    if (size() - simplified_len >= params.flush_points) {
+        // Start from the last simplified point so the new part joins the old
+        simplify(simplified_len ? simplified_len - 1 : 0, params.tolerance);
+        simplified_len = size();
+    }
+
+    if (size() > params.max_points) {
+        auto target = std::max((size_t) 2, params.max_points * 3 / 4);
+        auto tolerance = params.tolerance * 2;
+
+        for (unsigned int i = 0; i < 8 && size() > target; i++) {
+            simplify(0, tolerance);
+            tolerance *= 2;
+        }
+
+        if (size() > target) {
+            auto drop = size() - target;
+            points->get().erase(0, drop * point_len);
+            (*simplified) += drop;
+        }
+
+        simplified_len = size();
+    }
+}
+
+void kis_location_trail::simplify(size_t in_start, double in_tolerance) {
+    auto n = size();
+
+    if (n < in_start + 3)
+        return;
+
+    std::vector<trail_point> pts;
+    pts.reserve(n - in_start);
+
+    for (size_t i = in_start; i < n; i++)
+        pts.push_back(get_point(i));
+
+    trail_projection proj(pts[0].lat);
+
+    std::vector<bool> keep(pts.size(), false);
+    keep.front() = true;
+    keep.back() = true;
+
+    std::vector<std::pair<size_t, size_t>> spans;
+    spans.push_back(std::make_pair(0, pts.size() - 1));
+
+    while (spans.size()) {
+        auto span = spans.back();
+        spans.pop_back();
+
+        double max_d = 0;
+        size_t max_i = 0;
+
+        for (size_t i = span.first + 1; i < span.second; i++) {
+            auto d = trail_segment_distance(proj, pts[i], pts[span.first], pts[span.second]);
+
+            if (d > max_d) {
+                max_d = d;
+                max_i = i;
+            }
+        }
+
+        if (max_i != 0 && max_d > in_tolerance) {
+            keep[max_i] = true;
+            spans.push_back(std::make_pair(span.first, max_i));
+            spans.push_back(std::make_pair(max_i, span.second));
+        }
+    }
+
+    auto& packed = points->get();
+    packed.resize(in_start * point_len);
+
+    size_t removed = 0;
+
+    for (size_t i = 0; i < pts.size(); i++) {
+        if (keep[i])
+            trail_put_point(packed, pts[i]);
+        else
+            removed++;
+    }
+
+    (*simplified) += removed;
+}
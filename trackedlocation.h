@@ -170,7 +170,7 @@ public:
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
         // auto r = Globalreg::new_from_pool<this_t>(this);
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
@@ -238,6 +238,83 @@ protected:
     time_t last_location_time;
 };
 
+// Decimated location trail
+//
+// Fixes are thinned as they arrive: a fix is only kept once the device has moved
+// min_distance meters and min_interval seconds from the previous kept fix, or after
+// max_interval seconds regardless.  Once flush_points fixes have been kept since the
+// last pass, the new part of the trail is simplified with Douglas-Peucker to within
+// tolerance meters; when the trail grows past max_points the whole trail is simplified
+// again with a growing tolerance, and the oldest fixes are dropped if that is not
+// enough.
+//
+// Points are packed as fixed point, little endian: the time as a uint32, the latitude
+// and longitude as int32 units of 1e-7 degrees, and the altitude as int32 centimeters,
+// 16 bytes a point.
+class kis_location_trail : public tracker_component {
+public:
+    struct trail_params {
+        double min_distance;
+        time_t min_interval;
+        time_t max_interval;
+        double tolerance;
+        size_t flush_points;
+        size_t max_points;
+    };
+
+    // Shared by every trail; set by the device tracker from the config
+    static trail_params params;
+
+    static constexpr size_t point_len = 16;
+
+    struct trail_point {
+        time_t time;
+        double lat, lon, alt;
+    };
+
+    kis_location_trail();
+    kis_location_trail(int in_id);
+    kis_location_trail(int in_id, std::shared_ptr<tracker_element_map> e);
+    kis_location_trail(const kis_location_trail *p);
+
+    virtual uint32_t get_signature() const override {
+        return adler32_checksum("kis_location_trail");
+    }
+
+    virtual std::shared_ptr<tracker_element> clone_type() override {
+        using this_t = std::remove_pointer<decltype(this)>::type;
+        auto dup = std::shared_ptr<this_t>(new this_t(this));
+        return dup;
+    }
+
+    void add_fix(double in_lat, double in_lon, double in_alt, time_t in_time);
+
+    size_t size() const {
+        return points->get().length() / point_len;
+    }
+
+    trail_point get_point(size_t in_pos) const;
+
+    std::vector<trail_point> get_points() const;
+
+    __ProxyGet(thinned, uint64_t, uint64_t, thinned);
+    __ProxyGet(simplified, uint64_t, uint64_t, simplified);
+
+protected:
+    virtual void register_fields() override;
+    virtual void reserve_fields(std::shared_ptr<tracker_element_map> e) override;
+
+    // Simplify the points from in_start to the end of the trail
+    void simplify(size_t in_start, double in_tolerance);
+
+    std::shared_ptr<tracker_element_byte_array> points;
+    std::shared_ptr<tracker_element_uint64> thinned;
+    std::shared_ptr<tracker_element_uint64> simplified;
+
+    // Points at the start of the trail which have already been simplified
+    size_t simplified_len;
+};
+
 // Historic location track; used in the averaging / rrd historic location.
 // Signal is tracked agnostically as whatever type of signal the owning device
 // presents (dbm or rssi)
@@ -277,7 +354,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>(this);
+        auto r = tracker_arena_make_shared<this_t>(this);
         return r;
     }
 
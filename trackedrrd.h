@@ -110,7 +110,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>();
+        auto r = tracker_arena_make_shared<this_t>();
         r->set_id(this->get_id());
         return r;
     }
@@ -136,6 +136,8 @@ public:
     void add_sample(int64_t in_s, time_t in_time) {
         kis_lock_guard<kis_mutex> lk(mutex, "kis_tracked_rrd add_sample");
 
+        build_buckets();
+
         M_Aggregator m_agg;
         H_Aggregator h_agg;
         D_Aggregator d_agg;
@@ -299,6 +301,39 @@ public:
         set_last_time(in_time);
     }
 
+    // Average of the per-second samples in the minute before now; the minute vector is
+    // a ring indexed by second, so slots newer than the last update are stale
+    double get_minute_avg(time_t now) {
+        kis_lock_guard<kis_mutex> lk(mutex, "kis_tracked_rrd get_minute_avg");
+
+        time_t last = std::min((time_t) get_last_time(), now);
+
+        if (!buckets_valid() || now - last >= 60)
+            return 0;
+
+        double sum = 0;
+
+        for (time_t t = now - 59; t <= last; t++)
+            sum += (*minute_vec)[t % 60];
+
+        return sum / 60;
+    }
+
+    // Value of the minute starting at in_minute from the past hour, which is an
+    // average of its seconds, or the blank value if nothing was recorded in it
+    int64_t get_minute_value(time_t in_minute) {
+        kis_lock_guard<kis_mutex> lk(mutex, "kis_tracked_rrd get_minute_value");
+
+        H_Aggregator h_agg;
+
+        time_t last = get_last_time();
+
+        if (!buckets_valid() || last < in_minute || last - in_minute >= 60 * 60)
+            return h_agg.default_val();
+
+        return (*hour_vec)[(in_minute / 60) % 60];
+    }
+
     virtual void pre_serialize() override {
         kis_lock_guard<kis_mutex> lk(mutex, kismet::retain_lock, "kis_tracked_rrd serialize");
 
@@ -308,6 +343,12 @@ public:
         uint64_t now = Globalreg::globalreg->last_tv_sec;
         set_serial_time(now);
 
+        // Buckets with no data are only filled in for the serializer
+        if (!buckets_valid() || now - get_last_time() > (60 * 60 * 24)) {
+            serial_buckets = true;
+            build_buckets();
+        }
+
         // Update the averages
         if (update_first) {
             add_sample(m_agg.default_val(), now);
@@ -316,6 +357,11 @@ public:
 
     virtual void post_serialize() override {
         kis_lock_guard<kis_mutex> lk(mutex, std::adopt_lock);
+
+        if (serial_buckets) {
+            serial_buckets = false;
+            release_buckets();
+        }
     }
 
 protected:
@@ -361,6 +407,30 @@ protected:
         }
     }
 
+    // Buckets are only built once there is a sample to put in them, so records which
+    // are never updated (such as most devices seen only once) don't carry them; they
+    // are filled in temporarily when serialized.  Once the data is over a day old every
+    // bucket would be wiped by the next sample anyway, so they're released again after
+    // serializing.
+    bool buckets_valid() const {
+        return minute_vec->size() == 60 && hour_vec->size() == 60 && day_vec->size() == 24;
+    }
+
+    void build_buckets() {
+        if (buckets_valid())
+            return;
+
+        minute_vec->get().assign(60, 0);
+        hour_vec->get().assign(60, 0);
+        day_vec->get().assign(24, 0);
+    }
+
+    void release_buckets() {
+        tracker_element_vector_double::vector_t().swap(minute_vec->get());
+        tracker_element_vector_double::vector_t().swap(hour_vec->get());
+        tracker_element_vector_double::vector_t().swap(day_vec->get());
+    }
+
     virtual void register_fields() override {
         tracker_component::register_fields();
 
@@ -391,25 +461,9 @@ protected:
     virtual void reserve_fields(std::shared_ptr<tracker_element_map> e) override {
         tracker_component::reserve_fields(e);
 
-        // Build slots for all the times
-        int x;
-        if ((x = minute_vec->size()) != 60) {
-            for ( ; x < 60; x++) {
-                minute_vec->push_back(0);
-            }
-        }
-
-        if ((x = hour_vec->size()) != 60) {
-            for ( ; x < 60; x++) {
-                hour_vec->push_back(0);
-            }
-        }
-
-        if ((x = day_vec->size()) != 24) {
-            for ( ; x < 24; x++) {
-                day_vec->push_back(0);
-            }
-        }
+        // Imported records keep their data; partial buckets are rebuilt on the next
+        // sample
+        serial_buckets = false;
 
         M_Aggregator m_agg;
         (*blank_val).set(m_agg.default_val());
@@ -431,6 +485,9 @@ protected:
     int hour_entry_id;
 
     bool update_first;
+
+    // Buckets were only built for serialization
+    bool serial_buckets;
 };
 
 // Easier to make this it's own class since for a single-minute RRD the logic is
@@ -472,7 +529,7 @@ public:
 
     virtual std::shared_ptr<tracker_element> clone_type() override {
         using this_t = typename std::remove_pointer<decltype(this)>::type;
-        auto r = std::make_shared<this_t>();
+        auto r = tracker_arena_make_shared<this_t>();
         r->set_id(this->get_id());
         return r;
     }
@@ -493,6 +550,8 @@ public:
     void add_sample(int64_t in_s, time_t in_time) {
         kis_lock_guard<kis_mutex> lk(mutex, "kis_tracked_minute_rrd add_sample");
 
+        build_buckets();
+
         Aggregator agg;
 
         int sec_bucket = in_time % 60;
@@ -546,6 +605,11 @@ public:
 
         set_serial_time(now);
 
+        if (!buckets_valid() || now - get_last_time() > 60) {
+            serial_buckets = true;
+            build_buckets();
+        }
+
         if (update_first) {
             add_sample(agg.default_val(), now);
         }
@@ -553,6 +617,11 @@ public:
 
     virtual void post_serialize() override {
         kis_lock_guard<kis_mutex> lk(mutex, std::adopt_lock);
+
+        if (serial_buckets) {
+            serial_buckets = false;
+            release_buckets();
+        }
     }
 
 protected:
@@ -570,6 +639,23 @@ protected:
         }
     }
 
+    // Buckets are built on the first sample and released again once they only hold
+    // data older than a minute, as with kis_tracked_rrd
+    bool buckets_valid() const {
+        return minute_vec->size() == 60;
+    }
+
+    void build_buckets() {
+        if (buckets_valid())
+            return;
+
+        minute_vec->get().assign(60, 0);
+    }
+
+    void release_buckets() {
+        tracker_element_vector_double::vector_t().swap(minute_vec->get());
+    }
+
     virtual void register_fields() override {
         tracker_component::register_fields();
 
@@ -591,13 +677,7 @@ protected:
 
         set_last_time(0);
 
-        // Build slots for all the times
-        int x;
-        if ((x = minute_vec->size()) != 60) {
-            for ( ; x < 60; x++) {
-                minute_vec->push_back(0);
-            }
-        }
+        serial_buckets = false;
 
         Aggregator agg;
         (*blank_val).set(agg.default_val());
@@ -613,6 +693,9 @@ protected:
     int second_entry_id;
 
     bool update_first;
+
+    // Buckets were only built for serialization
+    bool serial_buckets;
 };
 
 // Signal level RRD, peak selector on overlap, averages signal but ignores
@@ -0,0 +1,72 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <algorithm>
+
+#include "trackedstringpool.h"
+
+tracker_string_pool::tracker_string_pool() :
+    purge_sz{1024} {
+    mutex.set_name("tracker_string_pool");
+}
+
+tracker_string_pool& tracker_string_pool::instance() {
+    static tracker_string_pool p;
+    return p;
+}
+
+std::shared_ptr<tracker_element_string> tracker_string_pool::intern(uint16_t in_id,
+        const std::string& in_str) {
+    auto& p = instance();
+    kis_lock_guard<kis_mutex> lk(p.mutex, "tracker_string_pool intern");
+
+    auto k = std::make_pair(in_id, in_str);
+    auto i = p.pool.find(k);
+
+    if (i != p.pool.end())
+        return i->second;
+
+    if (p.pool.size() >= p.purge_sz)
+        p.purge();
+
+    // Pool records are shared between devices, so they must never come from the 
+    // arena of the device being built
+    auto r = std::make_shared<tracker_element_string>(in_id, in_str);
+    p.pool.emplace(std::move(k), r);
+
+    return r;
+}
+
+size_t tracker_string_pool::size() {
+    auto& p = instance();
+    kis_lock_guard<kis_mutex> lk(p.mutex, "tracker_string_pool size");
+    return p.pool.size();
+}
+
+void tracker_string_pool::purge() {
+    for (auto i = pool.begin(); i != pool.end(); ) {
+        if (i->second.use_count() == 1)
+            i = pool.erase(i);
+        else
+            ++i;
+    }
+
+    purge_sz = std::max(static_cast<size_t>(1024), pool.size() * 2);
+}
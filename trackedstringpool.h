@@ -0,0 +1,62 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __TRACKEDSTRINGPOOL_H__
+#define __TRACKEDSTRINGPOOL_H__
+
+#include "config.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "kis_mutex.h"
+#include "trackedelement.h"
+
+// Pool of shared string records for low-cardinality fields, such as crypt and channel
+// strings and SSIDs, which repeat across thousands of devices.
+//
+// Fields proxied with __ProxyInternedString hold the pool record for their value 
+// instead of their own copy; setting the field swaps in the record for the new value.
+// Pool records are shared, and must never be modified directly.  Records no longer
+// used by any field are dropped as the pool grows.
+class tracker_string_pool {
+public:
+    // Shared record for a field id and value
+    static std::shared_ptr<tracker_element_string> intern(uint16_t in_id, 
+            const std::string& in_str);
+
+    static size_t size();
+
+protected:
+    tracker_string_pool();
+
+    static tracker_string_pool& instance();
+
+    void purge();
+
+    kis_mutex mutex;
+
+    std::map<std::pair<uint16_t, std::string>, std::shared_ptr<tracker_element_string>> pool;
+
+    size_t purge_sz;
+};
+
+#endif
+
@@ -0,0 +1,3 @@
+#include "version.h"
+const char *VERSION_GIT_COMMIT = "6bff340";
+const char *VERSION_BUILD_TIME = "";